@@ -11,11 +11,22 @@
 #endif
 
 #include <retro_assert.h>
+#include <retro_miscellaneous.h>
 #include <compat/strl.h>
+#include <features/features_cpu.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "../deps/game_ai_lib/GameAI.h"
 
 #define GAME_AI_MAX_PLAYERS 2
+/* Frames between the frame a job is taken from and the frame its
+ * actions apply to, at the least; later if inference runs longer. */
+#define GAME_AI_ACTION_DELAY GAMEAI_SKIPFRAMES
+/* The frame handed to the worker is point sampled down to about this
+ * many lines; the models shrink it to 84x84 themselves. */
+#define GAME_AI_FRAME_LINES 168
 
 void *                     ga = NULL;
 volatile void *            g_ram_ptr = NULL;
@@ -40,6 +51,40 @@ game_ai_lib_think_t           game_ai_lib_think = NULL;
 game_ai_lib_set_show_debug_t  game_ai_lib_set_show_debug = NULL;
 game_ai_lib_set_debug_log_t   game_ai_lib_set_debug_log = NULL;
 
+/* Inference runs on its own thread, on a copy of frame N and of RAM.
+ * The emulation thread only hands a job over when the worker is idle,
+ * and picks the actions up once frame N + GAME_AI_ACTION_DELAY comes. */
+typedef struct game_ai_worker
+{
+#ifdef HAVE_THREADS
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+#endif
+   uint8_t *frame;
+   uint8_t *ram;
+   size_t frame_size;
+   unsigned frame_width;
+   unsigned frame_height;
+   unsigned frame_pitch;
+   unsigned pixel_format;
+   unsigned job_frame;
+   unsigned result_frame;
+   signed short int result_bits[GAME_AI_MAX_PLAYERS];
+   bool ports[GAME_AI_MAX_PLAYERS];
+   bool show_debug;
+   bool busy;
+   bool has_result;
+   bool quit;
+   struct game_ai_stats stats;
+   retro_time_t think_usec;
+   unsigned latency_sum;
+   unsigned applied;
+} game_ai_worker_t;
+
+static game_ai_worker_t *g_worker = NULL;
+static unsigned g_frame           = 0;
+
 /* Helper functions */
 void game_ai_debug_log(int level, const char *fmt, ...)
 {
@@ -58,6 +103,205 @@ void array_to_bits_16(volatile signed short *result, const bool b[16])
       *result |= b[bit] ? (1 << bit) : 0;
 }
 
+static void game_ai_think_ports(const bool ports[GAME_AI_MAX_PLAYERS],
+      signed short int bits[GAME_AI_MAX_PLAYERS],
+      const void *frame_data, unsigned int frame_width,
+      unsigned int frame_height, unsigned int frame_pitch,
+      unsigned int pixel_format)
+{
+   int port;
+
+   for (port = 0; port < GAME_AI_MAX_PLAYERS; port++)
+   {
+      bool b[GAMEAI_MAX_BUTTONS] = {0};
+
+      bits[port] = 0;
+      if (!ports[port])
+         continue;
+      game_ai_lib_think(ga, b, port, frame_data, frame_width,
+            frame_height, frame_pitch, pixel_format);
+      array_to_bits_16(&bits[port], b);
+   }
+}
+
+static void game_ai_stats_add(game_ai_worker_t *worker,
+      retro_time_t usec)
+{
+   worker->stats.jobs++;
+   worker->think_usec      += usec;
+   worker->stats.think_ms   = worker->think_usec
+      / (worker->stats.jobs * 1000.0f);
+   if (usec / 1000.0f > worker->stats.max_think_ms)
+      worker->stats.max_think_ms = usec / 1000.0f;
+}
+
+/* Copies every step-th pixel of every step-th line, so the worker gets
+ * a frame of about GAME_AI_FRAME_LINES lines in the same pixel format. */
+static bool game_ai_copy_frame(game_ai_worker_t *worker,
+      const void *frame_data, unsigned int frame_width,
+      unsigned int frame_height, unsigned int frame_pitch,
+      unsigned int pixel_format)
+{
+   unsigned x, y;
+   unsigned bpp    = (pixel_format == RETRO_PIXEL_FORMAT_XRGB8888) ? 4 : 2;
+   unsigned step   = MAX(MIN(frame_width, frame_height)
+         / GAME_AI_FRAME_LINES, 1);
+   unsigned width  = frame_width  / step;
+   unsigned height = frame_height / step;
+   size_t size     = (size_t)width * height * bpp;
+
+   if (!frame_data || frame_data == RETRO_HW_FRAME_BUFFER_VALID
+         || !width || !height)
+      return false;
+
+   if (size > worker->frame_size)
+   {
+      uint8_t *frame = (uint8_t*)realloc(worker->frame, size);
+      if (!frame)
+         return false;
+      worker->frame      = frame;
+      worker->frame_size = size;
+   }
+
+   for (y = 0; y < height; y++)
+   {
+      const uint8_t *src = (const uint8_t*)frame_data
+         + (size_t)y * step * frame_pitch;
+      uint8_t *dst       = worker->frame + (size_t)y * width * bpp;
+
+      if (step == 1)
+         memcpy(dst, src, width * bpp);
+      else if (bpp == 4)
+         for (x = 0; x < width; x++)
+            ((uint32_t*)dst)[x] = ((const uint32_t*)src)[x * step];
+      else
+         for (x = 0; x < width; x++)
+            ((uint16_t*)dst)[x] = ((const uint16_t*)src)[x * step];
+   }
+
+   worker->frame_width  = width;
+   worker->frame_height = height;
+   worker->frame_pitch  = width * bpp;
+   worker->pixel_format = pixel_format;
+   return true;
+}
+
+#ifdef HAVE_THREADS
+static void game_ai_worker_loop(void *data)
+{
+   game_ai_worker_t *worker = (game_ai_worker_t*)data;
+
+   slock_lock(worker->lock);
+   for (;;)
+   {
+      retro_time_t start;
+      signed short int bits[GAME_AI_MAX_PLAYERS];
+
+      while (!worker->busy && !worker->quit)
+         scond_wait(worker->cond, worker->lock);
+      if (worker->quit)
+         break;
+      slock_unlock(worker->lock);
+
+      /* Nothing below is touched by the emulation thread while busy */
+      start = cpu_features_get_time_usec();
+      game_ai_lib_set_show_debug(ga, worker->show_debug);
+      game_ai_think_ports(worker->ports, bits, worker->frame,
+            worker->frame_width, worker->frame_height,
+            worker->frame_pitch, worker->pixel_format);
+
+      slock_lock(worker->lock);
+      game_ai_stats_add(worker, cpu_features_get_time_usec() - start);
+      memcpy(worker->result_bits, bits, sizeof(bits));
+      worker->result_frame = worker->job_frame;
+      worker->has_result   = true;
+      worker->busy         = false;
+   }
+   slock_unlock(worker->lock);
+}
+#endif
+
+static void game_ai_worker_free(void)
+{
+   game_ai_worker_t *worker = g_worker;
+
+   if (!worker)
+      return;
+#ifdef HAVE_THREADS
+   if (worker->thread)
+   {
+      slock_lock(worker->lock);
+      worker->quit = true;
+      scond_signal(worker->cond);
+      slock_unlock(worker->lock);
+      sthread_join(worker->thread);
+   }
+   if (worker->cond)
+      scond_free(worker->cond);
+   if (worker->lock)
+      slock_free(worker->lock);
+#endif
+   free(worker->frame);
+   free(worker->ram);
+   free(worker);
+   g_worker = NULL;
+}
+
+/* The library is handed the RAM copy in place of the core's RAM, so
+ * it reads a snapshot as old as the frame it is thinking on. Without
+ * threads, or if the worker won't start, inference stays inline. */
+static void *game_ai_worker_init(void)
+{
+#ifdef HAVE_THREADS
+   game_ai_worker_t *worker = (game_ai_worker_t*)
+      calloc(1, sizeof(*worker));
+
+   if (!worker)
+      return (void*)g_ram_ptr;
+   g_worker = worker;
+
+   if (     !(worker->ram  = (uint8_t*)malloc(g_ram_size))
+         || !(worker->lock = slock_new())
+         || !(worker->cond = scond_new())
+         || !(worker->thread = sthread_create(game_ai_worker_loop, worker)))
+   {
+      game_ai_worker_free();
+      return (void*)g_ram_ptr;
+   }
+   memcpy(worker->ram, (const void*)g_ram_ptr, g_ram_size);
+   worker->stats.threaded = true;
+   return worker->ram;
+#else
+   return (void*)g_ram_ptr;
+#endif
+}
+
+static void game_ai_destroy(void)
+{
+   game_ai_worker_free();
+   if (ga)
+   {
+      destroy_game_ai(ga);
+      ga = NULL;
+   }
+}
+
+bool game_ai_get_stats(struct game_ai_stats *stats)
+{
+   game_ai_worker_t *worker = g_worker;
+
+   if (!ga || !worker)
+      return false;
+#ifdef HAVE_THREADS
+   slock_lock(worker->lock);
+#endif
+   *stats = worker->stats;
+#ifdef HAVE_THREADS
+   slock_unlock(worker->lock);
+#endif
+   return true;
+}
+
 /* Interface to RA */
 
 signed short int game_ai_input(unsigned int port, unsigned int device,
@@ -135,11 +379,7 @@ void game_ai_shutdown(void)
 {
    if (g_lib_handle)
    {
-      if (ga)
-      {
-         destroy_game_ai(ga);
-         ga = NULL;
-      }
+      game_ai_destroy();
 #ifdef _WIN32
       FreeLibrary(g_lib_handle);
 #else
@@ -157,19 +397,18 @@ void game_ai_load(const char * name, void * ram_ptr, int ram_size, retro_log_pri
 
    g_log      = log;
 
-   if (ga)
-   {
-      destroy_game_ai(ga);
-      ga = NULL;
-   }
+   game_ai_destroy();
 }
 
+/* Called once a frame. Every GAMEAI_SKIPFRAMES frames the current one
+ * is handed to the worker if it is idle; otherwise the actions already
+ * in use are kept and the frame counts as skipped. */
 void game_ai_think(bool override_p1, bool override_p2, bool show_debug,
       const void *frame_data, unsigned int frame_width, unsigned int frame_height,
       unsigned int frame_pitch, unsigned int pixel_format)
 {
-   if (ga)
-      game_ai_lib_set_show_debug(ga, show_debug);
+   game_ai_worker_t *worker;
+   bool ports[GAME_AI_MAX_PLAYERS];
 
    if (!ga && g_ram_ptr)
    {
@@ -183,33 +422,80 @@ void game_ai_think(bool override_p1, bool override_p2, bool show_debug,
          strcat(&data_path[0], "/data/");
          strcat(&data_path[0], (char *)g_game_name);
 
-         game_ai_lib_init(ga, (void *) g_ram_ptr, g_ram_size);
+         game_ai_lib_init(ga, game_ai_worker_init(), g_ram_size);
          game_ai_lib_set_debug_log(ga, game_ai_debug_log);
+
+         /* Inline inference keeps its stats here too */
+         if (!g_worker)
+            g_worker = (game_ai_worker_t*)calloc(1, sizeof(*g_worker));
       }
    }
 
-   if (g_frameCount >= (GAMEAI_SKIPFRAMES - 1))
-   {
-      if (ga)
-      {
-         bool b[GAMEAI_MAX_BUTTONS] = {0};
+   g_frame++;
+   if (!ga || !(worker = g_worker))
+      return;
 
-         g_buttons_bits[0]=0;
-         g_buttons_bits[1]=0;
+   ports[0] = override_p1;
+   ports[1] = override_p2;
 
-         if (override_p1)
-         {
-            game_ai_lib_think(ga, b, 0, frame_data, frame_width, frame_height, frame_pitch, pixel_format);
-            array_to_bits_16(&g_buttons_bits[0], b);
-         }
+#ifdef HAVE_THREADS
+   if (worker->thread)
+   {
+      slock_lock(worker->lock);
+      if (     worker->has_result
+            && g_frame - worker->result_frame >= GAME_AI_ACTION_DELAY)
+      {
+         int port;
+         unsigned latency = g_frame - worker->result_frame;
+
+         for (port = 0; port < GAME_AI_MAX_PLAYERS; port++)
+            g_buttons_bits[port] = worker->result_bits[port];
+         worker->has_result               = false;
+         worker->latency_sum             += latency;
+         worker->stats.latency_frames     = latency;
+         worker->stats.avg_latency_frames = (float)worker->latency_sum
+            / ++worker->applied;
+      }
 
-         if (override_p2)
+      if (g_frameCount >= (GAMEAI_SKIPFRAMES - 1))
+      {
+         g_frameCount = 0;
+         if (worker->busy || worker->has_result)
+            worker->stats.skipped++;
+         else if ((override_p1 || override_p2) && game_ai_copy_frame(worker,
+                  frame_data, frame_width, frame_height,
+                  frame_pitch, pixel_format))
          {
-            game_ai_lib_think(ga, b, 1, frame_data, frame_width, frame_height, frame_pitch, pixel_format);
-            array_to_bits_16(&g_buttons_bits[1], b);
+            memcpy(worker->ram, (const void*)g_ram_ptr, g_ram_size);
+            memcpy(worker->ports, ports, sizeof(ports));
+            worker->show_debug = show_debug;
+            worker->job_frame  = g_frame;
+            worker->busy       = true;
+            scond_signal(worker->cond);
          }
       }
-      g_frameCount=0;
+      else
+         g_frameCount++;
+      slock_unlock(worker->lock);
+      return;
+   }
+#endif
+
+   game_ai_lib_set_show_debug(ga, show_debug);
+
+   if (g_frameCount >= (GAMEAI_SKIPFRAMES - 1))
+   {
+      int port;
+      signed short int bits[GAME_AI_MAX_PLAYERS];
+      retro_time_t start = cpu_features_get_time_usec();
+
+      game_ai_think_ports(ports, bits, frame_data, frame_width,
+            frame_height, frame_pitch, pixel_format);
+      if (override_p1 || override_p2)
+         game_ai_stats_add(worker, cpu_features_get_time_usec() - start);
+      for (port = 0; port < GAME_AI_MAX_PLAYERS; port++)
+         g_buttons_bits[port] = bits[port];
+      g_frameCount = 0;
    }
    else
       g_frameCount++;
@@ -25,6 +25,17 @@
 
 RETRO_BEGIN_DECLS
 
+struct game_ai_stats
+{
+   float think_ms;            /* average inference time per frame thought on */
+   float max_think_ms;
+   float avg_latency_frames;  /* frames from a frame to its actions */
+   unsigned latency_frames;   /* the same, for the actions in use */
+   unsigned jobs;
+   unsigned skipped;          /* frames passed over while the worker was busy */
+   bool threaded;
+};
+
 signed short int game_ai_input(unsigned int port, unsigned int device,
       unsigned int idx, unsigned int id, signed short int result);
 
@@ -39,6 +50,8 @@ void game_ai_think(bool override_p1, bool override_p2, bool show_debug,
       const void *frame_data, unsigned int frame_w, unsigned int frame_h,
       unsigned int frame_pitch, unsigned int pixel_format);
 
+bool game_ai_get_stats(struct game_ai_stats *stats);
+
 RETRO_END_DECLS
 
 #endif
@@ -155,7 +155,15 @@ enum audio_driver_state_flags
     * Indicates that the audio driver is forcing gain to 0.
     * Used for temporary rewind and fast-forward muting.
     */
-   AUDIO_FLAG_MUTED        = (1 << 6)
+   AUDIO_FLAG_MUTED        = (1 << 6),
+
+   /**
+    * Indicates that the audio device was left open while one core was
+    * unloaded, for the next one to reuse.
+    *
+    * @see audio_driver_keep_alive
+    */
+   AUDIO_FLAG_KEPT_ALIVE   = (1 << 7)
 };
 
 typedef struct audio_statistics
@@ -165,6 +173,11 @@ typedef struct audio_statistics
    float std_deviation_percentage;
    float close_to_underrun;
    float close_to_blocking;
+   /* Flushes that found the driver's buffer empty, i.e. it had
+    * run dry since the last one, and full, i.e. the write had to
+    * block or drop samples */
+   unsigned underruns;
+   unsigned overruns;
 } audio_statistics_t;
 
 RETRO_END_DECLS
@@ -81,6 +81,10 @@
  * a consistent pitch when fast-forwarding. */
 #define AUDIO_FF_EXP_AVG_SAMPLES       16
 
+/* Input frames taken through all the flush stages at a time, so
+ * that the float buffers stay in the CPU cache between stages */
+#define AUDIO_FLUSH_BLOCK_FRAMES       256
+
 #define MENU_SOUND_FORMATS "ogg|mod|xm|s3m|mp3|flac|wav"
 
  /* Converts decibels to voltage gain. Returns voltage gain value. */
@@ -133,6 +137,9 @@ audio_driver_t *audio_drivers[] = {
 #ifdef HAVE_SL
    &audio_opensl,
 #endif
+#ifdef HAVE_AAUDIO
+   &audio_aaudio,
+#endif
 #ifdef HAVE_ROAR
    &audio_roar,
 #endif
@@ -297,6 +304,8 @@ static void audio_driver_report_audio_buffer_statistics(void)
    audio_stats.std_deviation_percentage  = 0.0f;
    audio_stats.close_to_underrun         = 0.0f;
    audio_stats.close_to_blocking         = 0.0f;
+   audio_stats.underruns                 = 0;
+   audio_stats.overruns                  = 0;
 
    if (!audio_compute_buffer_statistics(&audio_stats))
       return;
@@ -304,11 +313,27 @@ static void audio_driver_report_audio_buffer_statistics(void)
    RARCH_LOG("[Audio] Average audio buffer saturation: %.2f %%,"
          " standard deviation (percentage points): %.2f %%.\n"
          "[Audio] Amount of time spent close to underrun: %.2f %%."
-         " Close to blocking: %.2f %%.\n",
+         " Close to blocking: %.2f %%.\n"
+         "[Audio] Underruns: %u, overruns: %u.\n",
          audio_stats.average_buffer_saturation,
          audio_stats.std_deviation_percentage,
          audio_stats.close_to_underrun,
-         audio_stats.close_to_blocking);
+         audio_stats.close_to_blocking,
+         audio_stats.underruns,
+         audio_stats.overruns);
+
+#ifdef HAVE_DSP_FILTER
+   {
+      unsigned i;
+      float load;
+      const char *ident;
+
+      for (i = 0; retro_dsp_filter_get_load(audio_driver_st.dsp, i,
+               &ident, &load); i++)
+         RARCH_LOG("[Audio] DSP filter \"%s\": %.2f %% CPU.\n",
+               ident, load);
+   }
+#endif
 }
 #endif
 
@@ -326,9 +351,18 @@ static void audio_driver_deinit_resampler(void)
 static bool audio_driver_deinit_internal(bool audio_enable)
 {
    audio_driver_state_t *audio_st = &audio_driver_st;
-   if (     audio_st->current_audio
+   if (     (audio_st->flags & AUDIO_FLAG_KEPT_ALIVE)
+         && audio_enable)
+   {
+      /* Silent until the next core's first samples */
+      if (audio_st->context_audio_data)
+         audio_st->current_audio->stop(audio_st->context_audio_data);
+      RARCH_LOG("[Audio] Keeping the audio device open for the next core.\n");
+   }
+   else if (audio_st->current_audio
          && audio_st->current_audio->free)
    {
+      audio_st->flags &= ~AUDIO_FLAG_KEPT_ALIVE;
       if (audio_st->context_audio_data)
          audio_st->current_audio->free(audio_st->context_audio_data);
       audio_st->context_audio_data = NULL;
@@ -363,12 +397,12 @@ static bool audio_driver_deinit_internal(bool audio_enable)
       memalign_free(audio_st->output_samples_buf);
    audio_st->output_samples_buf = NULL;
 
-#ifdef HAVE_DSP_FILTER
-   audio_driver_dsp_filter_free();
-#endif
 #ifdef DEBUG
    audio_driver_report_audio_buffer_statistics();
 #endif
+#ifdef HAVE_DSP_FILTER
+   audio_driver_dsp_filter_free();
+#endif
 
    return true;
 }
@@ -399,6 +433,18 @@ bool audio_driver_deinit(void)
    return audio_driver_deinit_internal(config_get_ptr()->bools.audio_enable);
 }
 
+bool audio_driver_keep_alive(void)
+{
+   audio_driver_state_t *audio_st = &audio_driver_st;
+
+   if (     !audio_st->context_audio_data
+         || !audio_st->current_audio
+         ||  audio_st->callback.callback)
+      return false;
+   audio_st->flags |= AUDIO_FLAG_KEPT_ALIVE;
+   return true;
+}
+
 bool audio_driver_find_driver(const char *audio_drv,
       const char *prefix, bool verbosity_enabled)
 {
@@ -445,64 +491,72 @@ bool audio_driver_find_driver(const char *audio_drv,
  * @param is_slowmotion True if the core is currently running in slow motion.
  * @param is_fastmotion True if the core is currently running in fast-forward.
  **/
-static void audio_driver_flush(audio_driver_state_t *audio_st,
-      float slowmotion_ratio,
-      const int16_t *data, size_t samples,
-      bool is_slowmotion, bool is_fastforward)
+/* Resamples src_data, mixes in the mixer streams and writes
+ * the result to the driver */
+static void audio_driver_flush_output(audio_driver_state_t *audio_st,
+      struct resampler_data *src_data)
 {
-   struct resampler_data src_data;
-   float audio_volume_gain           =
-         (audio_st->mute_enable || audio_st->flags & AUDIO_FLAG_MUTED)
-               ? 0.0f
-               : audio_st->volume_gain;
-
-   src_data.data_out                 = NULL;
-   src_data.output_frames            = 0;
-   /* We'll assign a proper output to the resampler later in this function */
-
-   convert_s16_to_float(audio_st->input_data, data, samples,
-         audio_volume_gain);
+   src_data->data_out                = audio_st->output_samples_buf;
+   src_data->output_frames           = 0;
 
-   /* The resampler operates on floating-point frames,
-    * so we have to convert the input first */
-   src_data.data_in                  = audio_st->input_data;
-   src_data.input_frames             = samples >> 1;
-
-   /* Remember, we allocated buffers that are twice as big as needed.
-    * (see audio_driver_init) */
+   /* Now the resampler will write to the driver state's scratch buffer */
+   audio_st->resampler->process(audio_st->resampler_data, src_data);
 
-#ifdef HAVE_DSP_FILTER
-   /* If we want to process our audio for reasons besides resampling... */
-   if (audio_st->dsp)
+#ifdef HAVE_AUDIOMIXER
+   if (audio_st->flags & AUDIO_FLAG_MIXER_ACTIVE)
    {
-      struct retro_dsp_data dsp_data;
+      bool override                       = true;
+      float mixer_gain                    = 0.0f;
+      bool audio_driver_mixer_mute_enable = audio_st->mixer_mute_enable;
 
-      dsp_data.input                 = audio_st->input_data;
-      dsp_data.input_frames          = (unsigned)(samples >> 1);
-      dsp_data.output                = NULL;
-      dsp_data.output_frames         = 0;
+      if (!audio_driver_mixer_mute_enable)
+      {
+         if (audio_st->mixer_volume_gain == 1.0f)
+            override                      = false;
+         mixer_gain                       = audio_st->mixer_volume_gain;
 
-      /* Initialize the DSP input/output.
-       * Our DSP implementations generally operate directly on the
-       * input buffer, so the output/output_frames attributes here are zero;
-       * the DSP filter will set them to useful values, most likely to be
-       * the same as the inputs. */
+      }
+      audio_mixer_mix(audio_st->output_samples_buf,
+            src_data->output_frames, mixer_gain, override);
+   }
+#endif
 
-      retro_dsp_filter_process(audio_st->dsp, &dsp_data);
+   /* Now we write our processed audio output to the driver.
+    * It may not be played immediately, depending on
+    * the driver implementation. */
+   {
+      const void *output_data = audio_st->output_samples_buf;
+      unsigned output_frames  = (unsigned)src_data->output_frames; /* Unit: frames */
 
-      /* If the DSP filter succeeded... */
-      if (dsp_data.output)
+      /* If the audio driver supports float samples,
+       * we don't have to do conversion */
+      if (audio_st->flags & AUDIO_FLAG_USE_FLOAT)
+         output_frames       *= sizeof(float); /* Unit: bytes */
+      else
       {
-         /* Then let's pass the DSP's output to the resampler's input */
-         src_data.data_in            = dsp_data.output;
-         src_data.input_frames       = dsp_data.output_frames;
+         convert_float_to_s16(audio_st->output_samples_conv_buf,
+               (const float*)output_data, output_frames * 2);
+
+         output_data          = audio_st->output_samples_conv_buf;
+         output_frames       *= sizeof(int16_t);  /* Unit: bytes */
       }
-   }
-#endif
 
-   src_data.data_out                 = audio_st->output_samples_buf;
+      audio_st->current_audio->write(audio_st->context_audio_data,
+            output_data, output_frames * 2);
+   }
+}
 
-   /* Now the resampler will write to the driver state's scratch buffer */
+static void audio_driver_flush(audio_driver_state_t *audio_st,
+      float slowmotion_ratio,
+      const int16_t *data, size_t samples,
+      bool is_slowmotion, bool is_fastforward)
+{
+   struct resampler_data src_data;
+   size_t frames                     = samples >> 1;
+   float audio_volume_gain           =
+         (audio_st->mute_enable || audio_st->flags & AUDIO_FLAG_MUTED)
+               ? 0.0f
+               : audio_st->volume_gain;
 
    /* Count samples. */
    {
@@ -549,7 +603,7 @@ static void audio_driver_flush(audio_driver_state_t *audio_st,
       {
          /* What we should see if the speed was 1.0x, converted to microsecs */
          const double expected_flush_delta =
-            (src_data.input_frames / audio_st->input * 1000000);
+            (frames / audio_st->input * 1000000);
          /* Exponential moving average of the last AUDIO_FF_EXP_AVG_SAMPLES
             samples. This helps make sure pitches are recognizable by avoiding
             too much variance flush-to-flush.
@@ -576,50 +630,75 @@ static void audio_driver_flush(audio_driver_state_t *audio_st,
       audio_st->last_flush_time = flush_time;
    }
 
-   audio_st->resampler->process(audio_st->resampler_data, &src_data);
-
-#ifdef HAVE_AUDIOMIXER
-   if (audio_st->flags & AUDIO_FLAG_MIXER_ACTIVE)
+   /* The resampler and the mixer carry their state from one call
+    * to the next, so the input can be taken through them a block
+    * at a time. The DSP filter works on the whole input in place,
+    * and input from audio_driver_sample() sits in the buffer the
+    * s16 output goes to; both go through in one pass. */
+   if (     (data != audio_st->output_samples_conv_buf)
+#ifdef HAVE_DSP_FILTER
+         && !audio_st->dsp
+#endif
+      )
    {
-      bool override                       = true;
-      float mixer_gain                    = 0.0f;
-      bool audio_driver_mixer_mute_enable = audio_st->mixer_mute_enable;
-
-      if (!audio_driver_mixer_mute_enable)
+      while (frames > 0)
       {
-         if (audio_st->mixer_volume_gain == 1.0f)
-            override                      = false;
-         mixer_gain                       = audio_st->mixer_volume_gain;
+         size_t block_frames  = MIN(frames, AUDIO_FLUSH_BLOCK_FRAMES);
+
+         convert_s16_to_float(audio_st->input_data, data,
+               block_frames << 1, audio_volume_gain);
 
+         src_data.data_in      = audio_st->input_data;
+         src_data.input_frames = block_frames;
+         audio_driver_flush_output(audio_st, &src_data);
+
+         data                 += block_frames << 1;
+         frames               -= block_frames;
       }
-      audio_mixer_mix(audio_st->output_samples_buf,
-            src_data.output_frames, mixer_gain, override);
+      return;
    }
-#endif
 
-   /* Now we write our processed audio output to the driver.
-    * It may not be played immediately, depending on
-    * the driver implementation. */
+   /* The resampler operates on floating-point frames,
+    * so we have to convert the input first */
+   convert_s16_to_float(audio_st->input_data, data, samples,
+         audio_volume_gain);
+
+   src_data.data_in                  = audio_st->input_data;
+   src_data.input_frames             = frames;
+
+   /* Remember, we allocated buffers that are twice as big as needed.
+    * (see audio_driver_init) */
+
+#ifdef HAVE_DSP_FILTER
+   /* If we want to process our audio for reasons besides resampling... */
+   if (audio_st->dsp)
    {
-      const void *output_data = audio_st->output_samples_buf;
-      unsigned output_frames  = (unsigned)src_data.output_frames; /* Unit: frames */
+      struct retro_dsp_data dsp_data;
 
-      /* If the audio driver supports float samples,
-       * we don't have to do conversion */
-      if (audio_st->flags & AUDIO_FLAG_USE_FLOAT)
-         output_frames       *= sizeof(float); /* Unit: bytes */
-      else
-      {
-         convert_float_to_s16(audio_st->output_samples_conv_buf,
-               (const float*)output_data, output_frames * 2);
+      dsp_data.input                 = audio_st->input_data;
+      dsp_data.input_frames          = (unsigned)frames;
+      dsp_data.output                = NULL;
+      dsp_data.output_frames         = 0;
 
-         output_data          = audio_st->output_samples_conv_buf;
-         output_frames       *= sizeof(int16_t);  /* Unit: bytes */
-      }
+      /* Initialize the DSP input/output.
+       * Our DSP implementations generally operate directly on the
+       * input buffer, so the output/output_frames attributes here are zero;
+       * the DSP filter will set them to useful values, most likely to be
+       * the same as the inputs. */
 
-      audio_st->current_audio->write(audio_st->context_audio_data,
-            output_data, output_frames * 2);
+      retro_dsp_filter_process(audio_st->dsp, &dsp_data);
+
+      /* If the DSP filter succeeded... */
+      if (dsp_data.output)
+      {
+         /* Then let's pass the DSP's output to the resampler's input */
+         src_data.data_in            = dsp_data.output;
+         src_data.input_frames       = dsp_data.output_frames;
+      }
    }
+#endif
+
+   audio_driver_flush_output(audio_st, &src_data);
 }
 
 #ifdef HAVE_AUDIOMIXER
@@ -696,6 +775,24 @@ bool audio_driver_init_internal(void *settings_data, bool audio_cb_inited)
 
    audio_driver_st.flags     |= AUDIO_FLAG_ACTIVE;
 
+   /* A device kept from the last core is reused unless this one
+    * wants threaded audio */
+   if (audio_driver_st.flags & AUDIO_FLAG_KEPT_ALIVE)
+   {
+      audio_driver_st.flags &= ~AUDIO_FLAG_KEPT_ALIVE;
+      if (!audio_cb_inited && audio_driver_st.context_audio_data)
+      {
+         RARCH_LOG("[Audio] Reusing the audio device of the last core.\n");
+         audio_driver_st.current_audio->start(
+               audio_driver_st.context_audio_data, false);
+         goto device_ready;
+      }
+      if (audio_driver_st.context_audio_data)
+         audio_driver_st.current_audio->free(
+               audio_driver_st.context_audio_data);
+      audio_driver_st.context_audio_data = NULL;
+   }
+
    if (!(audio_driver_find_driver(settings->arrays.audio_driver,
          "audio driver", verbosity_enabled)))
    {
@@ -751,6 +848,7 @@ bool audio_driver_init_internal(void *settings_data, bool audio_cb_inited)
       audio_driver_st.flags &= ~AUDIO_FLAG_ACTIVE;
    }
 
+device_ready:
    audio_driver_st.flags    &= ~AUDIO_FLAG_USE_FLOAT;
    if (     (audio_driver_st.flags & AUDIO_FLAG_ACTIVE)
          && audio_driver_st.current_audio->use_float(
@@ -1258,42 +1356,47 @@ bool audio_driver_mixer_add_stream(audio_mixer_stream_params_t *params)
    if (params->state == AUDIO_STREAM_STATE_NONE)
       return false;
 
-   if (!(buf = malloc(params->bufsize)))
-      return false;
+   if (params->handle)
+      handle = params->handle;
+   else
+   {
+      if (!(buf = malloc(params->bufsize)))
+         return false;
 
-   memcpy(buf, params->buf, params->bufsize);
+      memcpy(buf, params->buf, params->bufsize);
 
-   switch (params->type)
-   {
-      case AUDIO_MIXER_TYPE_WAV:
-         handle = audio_mixer_load_wav(buf, (int32_t)params->bufsize,
-               audio_driver_st.resampler_ident,
-               audio_driver_st.resampler_quality);
-         /* WAV is a special case - input buffer is not
-          * free()'d when sound playback is complete (it is
-          * converted to a PCM buffer, which is free()'d instead),
-          * so have to do it here */
-         free(buf);
-         buf = NULL;
-         break;
-      case AUDIO_MIXER_TYPE_OGG:
-         handle = audio_mixer_load_ogg(buf, (int32_t)params->bufsize);
-         break;
-      case AUDIO_MIXER_TYPE_MOD:
-         handle = audio_mixer_load_mod(buf, (int32_t)params->bufsize);
-         break;
-      case AUDIO_MIXER_TYPE_FLAC:
+      switch (params->type)
+      {
+         case AUDIO_MIXER_TYPE_WAV:
+            handle = audio_mixer_load_wav(buf, (int32_t)params->bufsize,
+                  audio_driver_st.resampler_ident,
+                  audio_driver_st.resampler_quality);
+            /* WAV is a special case - input buffer is not
+             * free()'d when sound playback is complete (it is
+             * converted to a PCM buffer, which is free()'d instead),
+             * so have to do it here */
+            free(buf);
+            buf = NULL;
+            break;
+         case AUDIO_MIXER_TYPE_OGG:
+            handle = audio_mixer_load_ogg(buf, (int32_t)params->bufsize);
+            break;
+         case AUDIO_MIXER_TYPE_MOD:
+            handle = audio_mixer_load_mod(buf, (int32_t)params->bufsize);
+            break;
+         case AUDIO_MIXER_TYPE_FLAC:
 #ifdef HAVE_DR_FLAC
-         handle = audio_mixer_load_flac(buf, (int32_t)params->bufsize);
+            handle = audio_mixer_load_flac(buf, (int32_t)params->bufsize);
 #endif
-         break;
-      case AUDIO_MIXER_TYPE_MP3:
+            break;
+         case AUDIO_MIXER_TYPE_MP3:
 #ifdef HAVE_DR_MP3
-         handle = audio_mixer_load_mp3(buf, (int32_t)params->bufsize);
+            handle = audio_mixer_load_mp3(buf, (int32_t)params->bufsize);
 #endif
-         break;
-      case AUDIO_MIXER_TYPE_NONE:
-         break;
+            break;
+         case AUDIO_MIXER_TYPE_NONE:
+            break;
+      }
    }
 
    if (!handle)
@@ -1853,6 +1956,8 @@ bool audio_compute_buffer_statistics(audio_statistics_t *stats)
    uint64_t accum_var             = 0;
    unsigned low_water_count       = 0;
    unsigned high_water_count      = 0;
+   unsigned empty_count           = 0;
+   unsigned full_count            = 0;
    audio_driver_state_t *audio_st = &audio_driver_st;
    unsigned samples               = MIN(
          (unsigned)audio_st->free_samples_count,
@@ -1902,14 +2007,26 @@ bool audio_compute_buffer_statistics(audio_statistics_t *stats)
 
    for (i = 1; i < samples; i++)
    {
-      if (audio_st->free_samples_buf[i] >= low_water_size)
+      unsigned free_samples = audio_st->free_samples_buf[i];
+
+      if (free_samples >= low_water_size)
+      {
          low_water_count++;
-      else if (audio_st->free_samples_buf[i] <= high_water_size)
+         if (free_samples >= audio_st->buffer_size)
+            empty_count++;
+      }
+      else if (free_samples <= high_water_size)
+      {
          high_water_count++;
+         if (!free_samples)
+            full_count++;
+      }
    }
 
    stats->close_to_underrun      = (100.0f * low_water_count)  / (samples - 1);
    stats->close_to_blocking      = (100.0f * high_water_count) / (samples - 1);
+   stats->underruns              = empty_count;
+   stats->overruns               = full_count;
 
    return true;
 }
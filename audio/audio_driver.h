@@ -66,6 +66,9 @@ typedef struct audio_mixer_stream_params
    void *buf;
    char *basename;
    audio_mixer_stop_cb_t cb;
+   /* A sound loaded already, which the stream takes over on success
+    * instead of loading 'buf' */
+   audio_mixer_sound_t *handle;
    size_t bufsize;
    unsigned slot_selection_idx;
    float volume;
@@ -337,6 +340,19 @@ bool audio_driver_init_internal(void *data, bool audio_cb_inited);
 
 bool audio_driver_deinit(void);
 
+/**
+ * audio_driver_keep_alive:
+ *
+ * Leaves the audio device open across the next audio_driver_deinit,
+ * so the core loaded after it starts without reopening the device.
+ * Everything that depends on the core (input rate, resampler, buffers)
+ * is still set up again by audio_driver_init_internal. Not done for
+ * threaded audio, which belongs to the core's audio callback.
+ *
+ * @return true if the device will be kept.
+ */
+bool audio_driver_keep_alive(void);
+
 bool audio_driver_find_driver(const char *audio_drv,
       const char *prefix, bool verbosity_enabled);
 
@@ -401,6 +417,7 @@ extern audio_driver_t audio_tinyalsa;
 extern audio_driver_t audio_roar;
 extern audio_driver_t audio_openal;
 extern audio_driver_t audio_opensl;
+extern audio_driver_t audio_aaudio;
 extern audio_driver_t audio_jack;
 extern audio_driver_t audio_sdl;
 extern audio_driver_t audio_xa;
@@ -62,6 +62,8 @@ static void audio_thread_loop(void *data)
    if (!thr)
       return;
 
+   sthread_role_register("audio");
+
    thr->driver_data   = thr->driver->init(
          thr->device, thr->out_rate, thr->latency,
          thr->block_frames, thr->new_rate);
@@ -73,7 +75,10 @@ static void audio_thread_loop(void *data)
    slock_unlock(thr->lock);
 
    if (thr->inited < 0)
+   {
+      sthread_role_unregister();
       return;
+   }
 
    /* Wait until we start to avoid calling
     * stop immediately after initialization. */
@@ -115,6 +120,7 @@ static void audio_thread_loop(void *data)
    }
 
    thr->driver->free(thr->driver_data);
+   sthread_role_unregister();
 }
 
 /**
@@ -0,0 +1,414 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <dynamic/dylib.h>
+#include <features/features_cpu.h>
+#include <queues/spsc_ring.h>
+#include <rthreads/rthreads.h>
+#include <retro_miscellaneous.h>
+
+#include "../audio_driver.h"
+#include "../../verbosity.h"
+
+/* AAudio arrived with Android 8.0, above our minimum API level, so it is
+ * loaded at run time and declared here rather than from <aaudio/AAudio.h>.
+ * The values are from that header. */
+typedef struct AAudioStreamStruct        AAudioStream;
+typedef struct AAudioStreamBuilderStruct AAudioStreamBuilder;
+typedef int32_t aaudio_result_t;
+
+#define AAUDIO_OK                           0
+#define AAUDIO_ERROR_DISCONNECTED           -899
+#define AAUDIO_DIRECTION_OUTPUT             0
+#define AAUDIO_FORMAT_PCM_I16               1
+#define AAUDIO_SHARING_MODE_EXCLUSIVE       0
+#define AAUDIO_PERFORMANCE_MODE_LOW_LATENCY 12
+#define AAUDIO_CALLBACK_RESULT_CONTINUE     0
+
+typedef int32_t (*aaudio_data_cb_t)(AAudioStream *stream,
+      void *user, void *data, int32_t frames);
+typedef void (*aaudio_error_cb_t)(AAudioStream *stream,
+      void *user, aaudio_result_t error);
+
+/* Bursts the device buffer holds past the one being played */
+#define AAUDIO_BUFFER_BURSTS 2
+
+typedef struct aaudio_symbols
+{
+   aaudio_result_t (*create_builder)(AAudioStreamBuilder **builder);
+   void (*set_direction)(AAudioStreamBuilder *builder, int32_t direction);
+   void (*set_sample_rate)(AAudioStreamBuilder *builder, int32_t rate);
+   void (*set_channel_count)(AAudioStreamBuilder *builder, int32_t channels);
+   void (*set_format)(AAudioStreamBuilder *builder, int32_t format);
+   void (*set_sharing_mode)(AAudioStreamBuilder *builder, int32_t mode);
+   void (*set_performance_mode)(AAudioStreamBuilder *builder, int32_t mode);
+   void (*set_data_callback)(AAudioStreamBuilder *builder,
+         aaudio_data_cb_t cb, void *user);
+   void (*set_error_callback)(AAudioStreamBuilder *builder,
+         aaudio_error_cb_t cb, void *user);
+   aaudio_result_t (*open_stream)(AAudioStreamBuilder *builder,
+         AAudioStream **stream);
+   aaudio_result_t (*delete_builder)(AAudioStreamBuilder *builder);
+   aaudio_result_t (*request_start)(AAudioStream *stream);
+   aaudio_result_t (*request_pause)(AAudioStream *stream);
+   aaudio_result_t (*request_stop)(AAudioStream *stream);
+   aaudio_result_t (*close)(AAudioStream *stream);
+   int32_t (*get_sample_rate)(AAudioStream *stream);
+   int32_t (*get_sharing_mode)(AAudioStream *stream);
+   int32_t (*get_frames_per_burst)(AAudioStream *stream);
+   int32_t (*get_buffer_capacity)(AAudioStream *stream);
+   aaudio_result_t (*set_buffer_size)(AAudioStream *stream, int32_t frames);
+   int32_t (*get_xrun_count)(AAudioStream *stream);
+   const char *(*result_to_text)(aaudio_result_t result);
+} aaudio_symbols_t;
+
+typedef struct aaudio
+{
+   dylib_t lib;
+   aaudio_symbols_t sym;
+   AAudioStream *stream;
+   slock_t *lock;
+   scond_t *cond;
+   /* Samples on their way to the callback; lock-free,
+    * so that writing never holds up the audio thread */
+   spsc_ring_t ring;
+   /* Kept by the callback, reported on free */
+   retro_time_t last_callback;
+   retro_time_t max_jitter;
+   unsigned callbacks;
+   unsigned underruns;
+   unsigned rate;
+   int32_t burst;
+   int32_t buffer_frames;
+   /* Set by the error callback; the stream is reopened on the next write */
+   volatile bool disconnected;
+   bool nonblock;
+   bool is_paused;
+} aaudio_t;
+
+static bool aaudio_load(aaudio_t *aa)
+{
+   aaudio_symbols_t *sym = &aa->sym;
+
+   if (!(aa->lib = dylib_load("libaaudio.so")))
+      return false;
+
+#define AAUDIO_SYM(field, name) \
+   if (!(*(function_t*)&sym->field = dylib_proc(aa->lib, name))) \
+      return false
+
+   AAUDIO_SYM(create_builder,       "AAudio_createStreamBuilder");
+   AAUDIO_SYM(set_direction,        "AAudioStreamBuilder_setDirection");
+   AAUDIO_SYM(set_sample_rate,      "AAudioStreamBuilder_setSampleRate");
+   AAUDIO_SYM(set_channel_count,    "AAudioStreamBuilder_setChannelCount");
+   AAUDIO_SYM(set_format,           "AAudioStreamBuilder_setFormat");
+   AAUDIO_SYM(set_sharing_mode,     "AAudioStreamBuilder_setSharingMode");
+   AAUDIO_SYM(set_performance_mode, "AAudioStreamBuilder_setPerformanceMode");
+   AAUDIO_SYM(set_data_callback,    "AAudioStreamBuilder_setDataCallback");
+   AAUDIO_SYM(set_error_callback,   "AAudioStreamBuilder_setErrorCallback");
+   AAUDIO_SYM(open_stream,          "AAudioStreamBuilder_openStream");
+   AAUDIO_SYM(delete_builder,       "AAudioStreamBuilder_delete");
+   AAUDIO_SYM(request_start,        "AAudioStream_requestStart");
+   AAUDIO_SYM(request_pause,        "AAudioStream_requestPause");
+   AAUDIO_SYM(request_stop,         "AAudioStream_requestStop");
+   AAUDIO_SYM(close,                "AAudioStream_close");
+   AAUDIO_SYM(get_sample_rate,      "AAudioStream_getSampleRate");
+   AAUDIO_SYM(get_sharing_mode,     "AAudioStream_getSharingMode");
+   AAUDIO_SYM(get_frames_per_burst, "AAudioStream_getFramesPerBurst");
+   AAUDIO_SYM(get_buffer_capacity,  "AAudioStream_getBufferCapacityInFrames");
+   AAUDIO_SYM(set_buffer_size,      "AAudioStream_setBufferSizeInFrames");
+   AAUDIO_SYM(get_xrun_count,       "AAudioStream_getXRunCount");
+   AAUDIO_SYM(result_to_text,       "AAudio_convertResultToText");
+
+#undef AAUDIO_SYM
+
+   return true;
+}
+
+static int32_t aaudio_data_cb(AAudioStream *stream, void *user,
+      void *data, int32_t frames)
+{
+   aaudio_t        *aa = (aaudio_t*)user;
+   size_t         size = (size_t)frames * 2 * sizeof(int16_t);
+   size_t         _len = spsc_ring_read(&aa->ring, data, size);
+   retro_time_t    now = cpu_features_get_time_usec();
+
+   scond_signal(aa->cond);
+
+   /* How far this callback strayed from the period its frames play for */
+   if (aa->last_callback)
+   {
+      retro_time_t expected = (retro_time_t)frames * 1000000 / aa->rate;
+      retro_time_t jitter   = now - aa->last_callback - expected;
+      if (jitter < 0)
+         jitter = -jitter;
+      if (jitter > aa->max_jitter)
+         aa->max_jitter = jitter;
+   }
+   aa->last_callback = now;
+   aa->callbacks++;
+
+   /* If underrun, fill rest with silence. */
+   if (_len < size)
+   {
+      memset((uint8_t*)data + _len, 0, size - _len);
+      if (!aa->is_paused)
+         aa->underruns++;
+   }
+
+   return AAUDIO_CALLBACK_RESULT_CONTINUE;
+}
+
+static void aaudio_error_cb(AAudioStream *stream, void *user,
+      aaudio_result_t error)
+{
+   aaudio_t *aa = (aaudio_t*)user;
+   /* The stream can't be closed from its own callback */
+   if (error == AAUDIO_ERROR_DISCONNECTED)
+   {
+      aa->disconnected = true;
+      /* No more data callbacks will make room */
+      scond_signal(aa->cond);
+   }
+}
+
+static void aaudio_close_stream(aaudio_t *aa)
+{
+   if (!aa->stream)
+      return;
+   aa->sym.request_stop(aa->stream);
+   aa->sym.close(aa->stream);
+   aa->stream = NULL;
+}
+
+static bool aaudio_open_stream(aaudio_t *aa, unsigned rate)
+{
+   aaudio_result_t res;
+   int32_t capacity;
+   AAudioStreamBuilder *builder = NULL;
+
+   if ((res = aa->sym.create_builder(&builder)) != AAUDIO_OK)
+      goto error;
+
+   aa->sym.set_direction(builder, AAUDIO_DIRECTION_OUTPUT);
+   aa->sym.set_sample_rate(builder, (int32_t)rate);
+   aa->sym.set_channel_count(builder, 2);
+   aa->sym.set_format(builder, AAUDIO_FORMAT_PCM_I16);
+   /* Exclusive low latency streams get the MMAP path where the device
+    * has one; AAudio quietly falls back to a shared stream otherwise */
+   aa->sym.set_sharing_mode(builder, AAUDIO_SHARING_MODE_EXCLUSIVE);
+   aa->sym.set_performance_mode(builder, AAUDIO_PERFORMANCE_MODE_LOW_LATENCY);
+   aa->sym.set_data_callback(builder, aaudio_data_cb, aa);
+   aa->sym.set_error_callback(builder, aaudio_error_cb, aa);
+
+   res = aa->sym.open_stream(builder, &aa->stream);
+   aa->sym.delete_builder(builder);
+   if (res != AAUDIO_OK)
+      goto error;
+
+   aa->rate          = (unsigned)aa->sym.get_sample_rate(aa->stream);
+   aa->burst         = aa->sym.get_frames_per_burst(aa->stream);
+   capacity          = aa->sym.get_buffer_capacity(aa->stream);
+   aa->buffer_frames = MIN(aa->burst * AAUDIO_BUFFER_BURSTS, capacity);
+   if ((res = aa->sym.set_buffer_size(aa->stream, aa->buffer_frames)) > 0)
+      aa->buffer_frames = res;
+   aa->last_callback = 0;
+   aa->disconnected  = false;
+
+   RARCH_LOG("[AAudio] Opened %s stream at %u Hz: %d frames per burst, "
+         "%d frames buffered (%.2f ms).\n",
+         aa->sym.get_sharing_mode(aa->stream) == AAUDIO_SHARING_MODE_EXCLUSIVE
+         ? "an exclusive" : "a shared",
+         aa->rate, (int)aa->burst, (int)aa->buffer_frames,
+         aa->buffer_frames * 1000.0 / aa->rate);
+
+   if ((res = aa->sym.request_start(aa->stream)) != AAUDIO_OK)
+   {
+      aaudio_close_stream(aa);
+      goto error;
+   }
+
+   return true;
+
+error:
+   RARCH_ERR("[AAudio] Couldn't open output stream: %s.\n",
+         aa->sym.result_to_text(res));
+   return false;
+}
+
+static void aaudio_free(void *data)
+{
+   aaudio_t *aa = (aaudio_t*)data;
+
+   if (!aa)
+      return;
+
+   if (aa->stream)
+   {
+      RARCH_LOG("[AAudio] %u callbacks, max jitter %u us, "
+            "ran out of samples %u times, %d device xruns.\n",
+            aa->callbacks, (unsigned)aa->max_jitter, aa->underruns,
+            (int)aa->sym.get_xrun_count(aa->stream));
+      aaudio_close_stream(aa);
+   }
+
+   spsc_ring_deinitialize(&aa->ring);
+   if (aa->lock)
+      slock_free(aa->lock);
+   if (aa->cond)
+      scond_free(aa->cond);
+   if (aa->lib)
+      dylib_close(aa->lib);
+   free(aa);
+}
+
+static void *aaudio_init(const char *device, unsigned rate, unsigned latency,
+      unsigned block_frames,
+      unsigned *new_rate)
+{
+   size_t bufsize;
+   aaudio_t *aa = (aaudio_t*)calloc(1, sizeof(*aa));
+
+   if (!aa)
+      return NULL;
+
+   if (!aaudio_load(aa))
+   {
+      RARCH_ERR("[AAudio] AAudio is not available.\n");
+      goto error;
+   }
+
+   if (   !(aa->lock = slock_new())
+       || !(aa->cond = scond_new()))
+      goto error;
+
+   if (!aaudio_open_stream(aa, rate))
+      goto error;
+
+   /* The rest of the requested latency is queued up on our side */
+   bufsize = (size_t)latency * aa->rate / 1000;
+   if (bufsize < (size_t)aa->burst * 2)
+      bufsize = (size_t)aa->burst * 2;
+   bufsize *= 2 * sizeof(int16_t);
+
+   if (!spsc_ring_initialize(&aa->ring, bufsize))
+      goto error;
+
+   *new_rate = aa->rate;
+   return aa;
+
+error:
+   aaudio_free(aa);
+   return NULL;
+}
+
+static ssize_t aaudio_write(void *data, const void *s, size_t len)
+{
+   size_t _len  = 0;
+   aaudio_t *aa = (aaudio_t*)data;
+
+   if (aa->disconnected)
+   {
+      /* Such as headphones unplugged; carry on with the new route */
+      RARCH_LOG("[AAudio] Output device changed, reopening stream.\n");
+      aaudio_close_stream(aa);
+      if (!aaudio_open_stream(aa, aa->rate))
+         return -1;
+   }
+
+   if (aa->nonblock)
+      return spsc_ring_write(&aa->ring, s, len);
+
+   while (_len < len && !aa->disconnected)
+   {
+      size_t write_amt = spsc_ring_write(&aa->ring,
+            (const uint8_t*)s + _len, len - _len);
+
+      _len += write_amt;
+
+      if (!write_amt)
+      {
+         slock_lock(aa->lock);
+         /* Unless the callback made room since we looked */
+         if (!spsc_ring_write_avail(&aa->ring) && !aa->disconnected)
+            scond_wait(aa->cond, aa->lock);
+         slock_unlock(aa->lock);
+      }
+   }
+
+   return _len;
+}
+
+static bool aaudio_stop(void *data)
+{
+   aaudio_t *aa = (aaudio_t*)data;
+   aa->is_paused = true;
+   return aa->sym.request_pause(aa->stream) == AAUDIO_OK;
+}
+
+static bool aaudio_alive(void *data)
+{
+   aaudio_t *aa = (aaudio_t*)data;
+   if (!aa)
+      return false;
+   return !aa->is_paused;
+}
+
+static bool aaudio_start(void *data, bool is_shutdown)
+{
+   aaudio_t *aa = (aaudio_t*)data;
+   aa->is_paused = aa->sym.request_start(aa->stream) != AAUDIO_OK;
+   return !aa->is_paused;
+}
+
+static void aaudio_set_nonblock_state(void *data, bool state)
+{
+   aaudio_t *aa = (aaudio_t*)data;
+   if (aa)
+      aa->nonblock = state;
+}
+
+static bool aaudio_use_float(void *data) { return false; }
+
+static size_t aaudio_write_avail(void *data)
+{
+   aaudio_t *aa = (aaudio_t*)data;
+   return spsc_ring_write_avail(&aa->ring);
+}
+
+static size_t aaudio_buffer_size(void *data)
+{
+   aaudio_t *aa = (aaudio_t*)data;
+   return aa->ring.size - 1;
+}
+
+audio_driver_t audio_aaudio = {
+   aaudio_init,
+   aaudio_write,
+   aaudio_stop,
+   aaudio_start,
+   aaudio_alive,
+   aaudio_set_nonblock_state,
+   aaudio_free,
+   aaudio_use_float,
+   "aaudio",
+   NULL,
+   NULL,
+   aaudio_write_avail,
+   aaudio_buffer_size,
+};
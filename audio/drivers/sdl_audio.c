@@ -23,6 +23,7 @@
 #include <boolean.h>
 #include <rthreads/rthreads.h>
 #include <queues/fifo_queue.h>
+#include <queues/spsc_ring.h>
 #include <retro_inline.h>
 #include <retro_math.h>
 #include <lists/string_list.h>
@@ -446,8 +447,12 @@ typedef struct sdl_audio
     * The queue used to store outgoing samples to be played by the driver.
     * Audio from the core ultimately makes its way here,
     * the last stop before the driver plays it.
+    * Lock-free, so that writing never holds up the SDL speaker thread.
     */
-   fifo_buffer_t *speaker_buffer;
+   spsc_ring_t speaker_ring;
+   /* Callbacks that ran out of samples; only the SDL speaker thread
+    * touches it while the device is open */
+   unsigned underruns;
    bool nonblock;
    bool is_paused;
    SDL_AudioSpec device_spec;
@@ -457,14 +462,17 @@ typedef struct sdl_audio
 static void sdl_audio_playback_cb(void *data, Uint8 *stream, int len)
 {
    sdl_audio_t  *sdl = (sdl_audio_t*)data;
-   size_t      avail = FIFO_READ_AVAIL(sdl->speaker_buffer);
-   size_t       _len = (len > (int)avail) ? avail : (size_t)len;
-   fifo_read(sdl->speaker_buffer, stream, _len);
+   size_t       _len = spsc_ring_read(&sdl->speaker_ring, stream, (size_t)len);
 #ifdef HAVE_THREADS
    scond_signal(sdl->cond);
 #endif
    /* If underrun, fill rest with silence. */
-   memset(stream + _len, 0, len - _len);
+   if (_len < (size_t)len)
+   {
+      memset(stream + _len, 0, len - _len);
+      if (!sdl->is_paused)
+         sdl->underruns++;
+   }
 }
 
 static void *sdl_audio_list_new(void *u)
@@ -586,11 +594,22 @@ static void *sdl_audio_init(const char *device,
    /* Create a buffer twice as big as needed and prefill the buffer. */
    bufsize             = sdl->device_spec.samples * 4 * (SDL_AUDIO_BITSIZE(sdl->device_spec.format) / 8);
    tmp                 = calloc(1, bufsize);
-   sdl->speaker_buffer = fifo_new(bufsize);
+
+   if (!spsc_ring_initialize(&sdl->speaker_ring, bufsize))
+   {
+      free(tmp);
+      SDL_CloseAudioDevice(sdl->speaker_device);
+#ifdef HAVE_THREADS
+      slock_free(sdl->lock);
+      scond_free(sdl->cond);
+#endif
+      free(sdl);
+      return NULL;
+   }
 
    if (tmp)
    {
-      fifo_write(sdl->speaker_buffer, tmp, bufsize);
+      spsc_ring_write(&sdl->speaker_ring, tmp, bufsize);
       free(tmp);
    }
 
@@ -608,49 +627,31 @@ static ssize_t sdl_audio_write(void *data, const void *s, size_t len)
 
    /* If we shouldn't wait for space in a full outgoing sample queue... */
    if (sdl->nonblock)
-   {
-      size_t avail, write_amt;
-      SDL_LockAudioDevice(sdl->speaker_device); /* Stop the SDL speaker thread from running */
-      avail     = FIFO_WRITE_AVAIL(sdl->speaker_buffer);
-      write_amt = (avail > len) ? len : avail; /* Enqueue as much data as we can */
-      fifo_write(sdl->speaker_buffer, s, write_amt);
-      SDL_UnlockAudioDevice(sdl->speaker_device); /* Let the speaker thread run again */
-      _len      = write_amt; /* If the queue was full...well, too bad. */
-   }
+      /* Enqueue as much data as we can; if the queue was full...well, too bad. */
+      _len = spsc_ring_write(&sdl->speaker_ring, s, len);
    else
    {
       /* Until we've written all the sample data we have available... */
       while (_len < len)
       {
-         size_t avail;
+         /* Enqueue as many samples as we can without overflowing the queue */
+         size_t write_amt = spsc_ring_write(&sdl->speaker_ring,
+               (const char*)s + _len, len - _len);
 
-         /* Stop the SDL speaker thread from running */
-         SDL_LockAudioDevice(sdl->speaker_device);
-         avail = FIFO_WRITE_AVAIL(sdl->speaker_buffer);
+         _len += write_amt;
 
          /* If the outgoing sample queue is full... */
-         if (avail == 0)
+         if (!write_amt)
          {
-            SDL_UnlockAudioDevice(sdl->speaker_device);
-            /* Let the SDL speaker thread run so it can play the enqueued samples,
-             * which will free up space for us to write new ones. */
 #ifdef HAVE_THREADS
             slock_lock(sdl->lock);
-            /* Let *only* the SDL speaker thread touch the outgoing sample queue */
-            scond_wait(sdl->cond, sdl->lock);
-            /* Block until SDL tells us that it's made room for new samples */
+            /* Block until SDL tells us that it's made room for new samples,
+             * unless it did so since we looked */
+            if (!spsc_ring_write_avail(&sdl->speaker_ring))
+               scond_wait(sdl->cond, sdl->lock);
             slock_unlock(sdl->lock);
-            /* Now let this thread use the outgoing sample queue (which we'll do next iteration) */
 #endif
          }
-         else
-         {
-            size_t write_amt = len - _len > avail ? avail : len - _len;
-            fifo_write(sdl->speaker_buffer, (const char*)s + _len, write_amt);
-            /* Enqueue as many samples as we have available without overflowing the queue */
-            SDL_UnlockAudioDevice(sdl->speaker_device); /* Let the SDL speaker thread run again */
-            _len += write_amt;
-         }
       }
    }
 
@@ -699,8 +700,11 @@ static void sdl_audio_free(void *data)
          SDL_CloseAudioDevice(sdl->speaker_device);
       }
 
-      if (sdl->speaker_buffer)
-         fifo_free(sdl->speaker_buffer);
+      if (sdl->underruns)
+         RARCH_LOG("[SDL audio] Speaker ran out of samples %u times.\n",
+               sdl->underruns);
+
+      spsc_ring_deinitialize(&sdl->speaker_ring);
 
 #ifdef HAVE_THREADS
       slock_free(sdl->lock);
@@ -718,8 +722,17 @@ static bool sdl_audio_use_float(void *data)
    return SDL_AUDIO_ISFLOAT(sdl->device_spec.format) ? true : false;
 }
 
-/* TODO/FIXME - implement */
-static size_t sdl_audio_write_avail(void *data) { return 0; }
+static size_t sdl_audio_write_avail(void *data)
+{
+   sdl_audio_t *sdl = (sdl_audio_t*)data;
+   return spsc_ring_write_avail(&sdl->speaker_ring);
+}
+
+static size_t sdl_audio_buffer_size(void *data)
+{
+   sdl_audio_t *sdl = (sdl_audio_t*)data;
+   return sdl->speaker_ring.size - 1;
+}
 
 static void sdl_audio_list_free(void *u, void *slp)
 {
@@ -746,5 +759,5 @@ audio_driver_t audio_sdl = {
    sdl_audio_list_new,
    sdl_audio_list_free,
    sdl_audio_write_avail,
-   NULL
+   sdl_audio_buffer_size
 };
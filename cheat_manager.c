@@ -26,8 +26,13 @@
 #include <compat/posix_string.h>
 #include <string/stdstring.h>
 #include <retro_miscellaneous.h>
+#include <retro_inline.h>
 #include <features/features_cpu.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
@@ -760,6 +765,37 @@ void cheat_manager_alloc_if_empty(void)
       cheat_manager_new(0);
 }
 
+/* The match flags are a bitset, one bit per search item: a byte, a
+ * 16 or 32-bit value, or a 1, 2 or 4-bit slice of a byte, the lowest
+ * slice first. */
+static unsigned cheat_manager_num_items(
+      const cheat_manager_t *cheat_st, unsigned bitsize)
+{
+   return (unsigned)(((uint64_t)cheat_st->total_memory_size * 8) >> bitsize);
+}
+
+/* Marks every item of the current search size as a match */
+static bool cheat_manager_reset_matches(cheat_manager_t *cheat_st)
+{
+   unsigned items = cheat_manager_num_items(cheat_st,
+         cheat_st->search_bit_size);
+   size_t     len = (items + 7) / 8;
+   uint8_t   *buf = (uint8_t*)realloc(cheat_st->matches, len ? len : 1);
+
+   if (!buf)
+      return false;
+
+   memset(buf, 0xFF, len);
+   /* Past the last item stays clear, so whole bytes can be counted */
+   if (items & 7)
+      buf[len - 1] = (1 << (items & 7)) - 1;
+
+   cheat_st->matches          = buf;
+   cheat_st->matches_bit_size = cheat_st->search_bit_size;
+   cheat_st->num_matches      = items;
+   return true;
+}
+
 int cheat_manager_initialize_memory(rarch_setting_t *setting, size_t idx, bool wraparound)
 {
    unsigned i;
@@ -883,16 +919,7 @@ int cheat_manager_initialize_memory(rarch_setting_t *setting, size_t idx, bool w
          return 0;
       }
 
-      if (cheat_st->matches)
-      {
-         free(cheat_st->matches);
-         cheat_st->matches = NULL;
-      }
-
-      cheat_st->matches = (uint8_t*)calloc(
-            cheat_st->total_memory_size, sizeof(uint8_t));
-
-      if (!cheat_st->matches)
+      if (!cheat_manager_reset_matches(cheat_st))
       {
          char msg[128];
          size_t _len = strlcpy(msg, msg_hash_to_str(MSG_CHEAT_INIT_FAIL), sizeof(msg));
@@ -903,8 +930,6 @@ int cheat_manager_initialize_memory(rarch_setting_t *setting, size_t idx, bool w
          return 0;
       }
 
-      memset(cheat_st->matches, 0xFF, cheat_st->total_memory_size);
-
       offset = 0;
 
       for (i = 0; i < cheat_st->num_memory_buffers; i++)
@@ -997,26 +1022,437 @@ static void cheat_manager_setup_search_meta(
    }
 }
 
+static bool cheat_manager_is_match(const cheat_manager_t *cheat_st,
+      enum cheat_search_type search_type, unsigned curr, unsigned prev)
+{
+   switch (search_type)
+   {
+      case CHEAT_SEARCH_TYPE_EXACT:
+         return (curr == cheat_st->search_exact_value);
+      case CHEAT_SEARCH_TYPE_LT:
+         return (curr < prev);
+      case CHEAT_SEARCH_TYPE_GT:
+         return (curr > prev);
+      case CHEAT_SEARCH_TYPE_LTE:
+         return (curr <= prev);
+      case CHEAT_SEARCH_TYPE_GTE:
+         return (curr >= prev);
+      case CHEAT_SEARCH_TYPE_EQ:
+         return (curr == prev);
+      case CHEAT_SEARCH_TYPE_NEQ:
+         return (curr != prev);
+      case CHEAT_SEARCH_TYPE_EQPLUS:
+         return (curr == prev + cheat_st->search_eqplus_value);
+      case CHEAT_SEARCH_TYPE_EQMINUS:
+         return (curr == prev - cheat_st->search_eqminus_value);
+   }
+   return false;
+}
+
+/* Byte @address of the core memory, or of the last snapshot */
+static unsigned cheat_manager_read_byte(const cheat_manager_t *cheat_st,
+      unsigned address, bool snapshot)
+{
+   unsigned i;
+   unsigned offset = 0;
+
+   if (address >= cheat_st->total_memory_size)
+      return 0;
+   if (snapshot)
+      return cheat_st->prev_memory_buf[address];
+
+   for (i = 0; i < cheat_st->num_memory_buffers; i++)
+   {
+      if (address < offset + cheat_st->memory_size_list[i])
+         return cheat_st->memory_buf_list[i][address - offset];
+      offset += cheat_st->memory_size_list[i];
+   }
+   return 0;
+}
+
+/* The @bytes_per_item wide value at @address, which may span
+ * two memory buffers */
+static unsigned cheat_manager_read_value(const cheat_manager_t *cheat_st,
+      unsigned address, unsigned bytes_per_item, bool snapshot)
+{
+   unsigned i;
+   unsigned val = 0;
+
+   for (i = 0; i < bytes_per_item; i++)
+   {
+      unsigned b = cheat_manager_read_byte(cheat_st, address + i, snapshot);
+      if (cheat_st->big_endian)
+         val = (val << 8) | b;
+      else
+         val |= b << (8 * i);
+   }
+   return val;
+}
+
+/* The value of a @bytes_per_item wide item at @p */
+static INLINE unsigned cheat_manager_load_value(const uint8_t *p,
+      unsigned bytes_per_item, bool big_endian)
+{
+   switch (bytes_per_item)
+   {
+      case 2:
+         return big_endian
+            ? ((unsigned)p[0] << 8) | p[1]
+            : p[0] | ((unsigned)p[1] << 8);
+      case 4:
+         return big_endian
+            ? ((unsigned)p[0] << 24) | ((unsigned)p[1] << 16)
+            | ((unsigned)p[2] << 8) | p[3]
+            : p[0] | ((unsigned)p[1] << 8)
+            | ((unsigned)p[2] << 16) | ((unsigned)p[3] << 24);
+      default:
+         break;
+   }
+   return p[0];
+}
+
+/* Address and address mask of match @item */
+static unsigned cheat_manager_item_address(unsigned bitsize,
+      unsigned item, unsigned *address_mask)
+{
+   if (bitsize < 3)
+   {
+      unsigned bits     = 1 << bitsize;
+      unsigned per_byte = 8 >> bitsize;
+      *address_mask     = ((1 << bits) - 1) << ((item % per_byte) * bits);
+      return item / per_byte;
+   }
+   *address_mask = 0xFF;
+   return item << (bitsize - 3);
+}
+
+/* The first match at or after @item, or @items if there is none */
+static unsigned cheat_manager_next_match(const cheat_manager_t *cheat_st,
+      unsigned item, unsigned items)
+{
+   while (item < items)
+   {
+      unsigned byte = cheat_st->matches[item >> 3] >> (item & 7);
+      if (!byte)
+      {
+         item = (item | 7) + 1;
+         continue;
+      }
+      while (!(byte & 1))
+      {
+         byte >>= 1;
+         item++;
+      }
+      return item;
+   }
+   return items;
+}
+
+static unsigned cheat_manager_count_matches(const cheat_manager_t *cheat_st,
+      unsigned items)
+{
+   size_t i;
+   size_t len     = (items + 7) / 8;
+   unsigned count = 0;
+
+   for (i = 0; i + 4 <= len; i += 4)
+   {
+      uint32_t v;
+      memcpy(&v, cheat_st->matches + i, sizeof(v));
+      v      = v - ((v >> 1) & 0x55555555);
+      v      = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+      count += (((v + (v >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+   }
+   for (; i < len; i++)
+   {
+      unsigned v = cheat_st->matches[i];
+      for (; v; v &= v - 1)
+         count++;
+   }
+   return count;
+}
+
+#if defined(__SSE2__)
+#define CHEAT_SEARCH_SIMD
+
+/* Compares as unsigned values of @width bits */
+static INLINE __m128i cheat_sse2_cmpeq(__m128i a, __m128i b, unsigned width)
+{
+   if (width == 8)
+      return _mm_cmpeq_epi8(a, b);
+   if (width == 16)
+      return _mm_cmpeq_epi16(a, b);
+   return _mm_cmpeq_epi32(a, b);
+}
+
+static INLINE __m128i cheat_sse2_cmpgt(__m128i a, __m128i b, unsigned width)
+{
+   __m128i sign;
+   if (width == 8)
+      return _mm_xor_si128(_mm_cmpeq_epi8(_mm_max_epu8(a, b), b),
+            _mm_set1_epi8(-1));
+   if (width == 16)
+   {
+      sign = _mm_set1_epi16((short)0x8000);
+      return _mm_cmpgt_epi16(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+   }
+   sign = _mm_set1_epi32((int)0x80000000);
+   return _mm_cmpgt_epi32(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+}
+
+static INLINE __m128i cheat_sse2_sub(__m128i a, __m128i b, unsigned width)
+{
+   if (width == 8)
+      return _mm_sub_epi8(a, b);
+   if (width == 16)
+      return _mm_sub_epi16(a, b);
+   return _mm_sub_epi32(a, b);
+}
+
+static INLINE __m128i cheat_sse2_load(const uint8_t *p, unsigned width,
+      bool big_endian)
+{
+   __m128i v = _mm_loadu_si128((const __m128i*)p);
+   if (big_endian && width > 8)
+   {
+      v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+      if (width == 32)
+         v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v,
+                  _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+   }
+   return v;
+}
+
+/* Lanes of @c (current) and @p (previous) that match, all ones.
+ * @value is the exact or delta value and @limit the widest previous
+ * value an EQPLUS match can start from. */
+static INLINE __m128i cheat_sse2_match(enum cheat_search_type search_type,
+      __m128i c, __m128i p, __m128i value, __m128i limit, unsigned width)
+{
+   __m128i ones = _mm_set1_epi8(-1);
+
+   switch (search_type)
+   {
+      case CHEAT_SEARCH_TYPE_EXACT:
+         return cheat_sse2_cmpeq(c, value, width);
+      case CHEAT_SEARCH_TYPE_LT:
+         return cheat_sse2_cmpgt(p, c, width);
+      case CHEAT_SEARCH_TYPE_GT:
+         return cheat_sse2_cmpgt(c, p, width);
+      case CHEAT_SEARCH_TYPE_LTE:
+         return _mm_xor_si128(cheat_sse2_cmpgt(c, p, width), ones);
+      case CHEAT_SEARCH_TYPE_GTE:
+         return _mm_xor_si128(cheat_sse2_cmpgt(p, c, width), ones);
+      case CHEAT_SEARCH_TYPE_EQ:
+         return cheat_sse2_cmpeq(c, p, width);
+      case CHEAT_SEARCH_TYPE_NEQ:
+         return _mm_xor_si128(cheat_sse2_cmpeq(c, p, width), ones);
+      case CHEAT_SEARCH_TYPE_EQPLUS:
+         /* Below 32 bits, prev + value must not carry out */
+         if (width == 32)
+            return cheat_sse2_cmpeq(cheat_sse2_sub(c, p, width), value, width);
+         return _mm_andnot_si128(cheat_sse2_cmpgt(p, limit, width),
+               cheat_sse2_cmpeq(cheat_sse2_sub(c, p, width), value, width));
+      case CHEAT_SEARCH_TYPE_EQMINUS:
+         /* ...nor prev - value borrow */
+         if (width == 32)
+            return cheat_sse2_cmpeq(cheat_sse2_sub(p, c, width), value, width);
+         return _mm_andnot_si128(cheat_sse2_cmpgt(value, p, width),
+               cheat_sse2_cmpeq(cheat_sse2_sub(p, c, width), value, width));
+   }
+   return _mm_setzero_si128();
+}
+
+/* Searches @blocks runs of 16 bytes of @curr against @prev, clearing
+ * the bits at @matches of the items that fail. Each run is 16 items
+ * (two match bytes) at 8 bits, 8 items (one byte) at 16 and 32 bits,
+ * where a 32-bit run is 32 bytes. */
+static void cheat_manager_search_sse2(const cheat_manager_t *cheat_st,
+      enum cheat_search_type search_type, const uint8_t *curr,
+      const uint8_t *prev, uint8_t *matches, size_t blocks, unsigned width)
+{
+   size_t i;
+   __m128i value, limit;
+   unsigned delta = 0;
+   bool big_endian = cheat_st->big_endian;
+
+   if (search_type == CHEAT_SEARCH_TYPE_EXACT)
+      delta = cheat_st->search_exact_value;
+   else if (search_type == CHEAT_SEARCH_TYPE_EQPLUS)
+      delta = cheat_st->search_eqplus_value;
+   else if (search_type == CHEAT_SEARCH_TYPE_EQMINUS)
+      delta = cheat_st->search_eqminus_value;
+
+   switch (width)
+   {
+      case 8:
+         value = _mm_set1_epi8((char)delta);
+         limit = _mm_set1_epi8((char)(0xFF - delta));
+         for (i = 0; i < blocks; i++, curr += 16, prev += 16, matches += 2)
+         {
+            unsigned m = matches[0] | (matches[1] << 8);
+            if (!m)
+               continue;
+            m &= _mm_movemask_epi8(cheat_sse2_match(search_type,
+                     cheat_sse2_load(curr, 8, false),
+                     _mm_loadu_si128((const __m128i*)prev),
+                     value, limit, 8));
+            matches[0] = (uint8_t)m;
+            matches[1] = (uint8_t)(m >> 8);
+         }
+         break;
+      case 16:
+         value = _mm_set1_epi16((short)delta);
+         limit = _mm_set1_epi16((short)(0xFFFF - delta));
+         for (i = 0; i < blocks; i++, curr += 16, prev += 16, matches++)
+         {
+            __m128i r;
+            if (!*matches)
+               continue;
+            r = cheat_sse2_match(search_type,
+                  cheat_sse2_load(curr, 16, big_endian),
+                  cheat_sse2_load(prev, 16, big_endian),
+                  value, limit, 16);
+            *matches &= _mm_movemask_epi8(_mm_packs_epi16(r, r));
+         }
+         break;
+      default:
+         value = _mm_set1_epi32((int)delta);
+         limit = value;
+         for (i = 0; i < blocks; i++, curr += 32, prev += 32, matches++)
+         {
+            __m128i r0, r1;
+            if (!*matches)
+               continue;
+            r0 = cheat_sse2_match(search_type,
+                  cheat_sse2_load(curr, 32, big_endian),
+                  cheat_sse2_load(prev, 32, big_endian),
+                  value, limit, 32);
+            r1 = cheat_sse2_match(search_type,
+                  cheat_sse2_load(curr + 16, 32, big_endian),
+                  cheat_sse2_load(prev + 16, 32, big_endian),
+                  value, limit, 32);
+            r0 = _mm_packs_epi32(r0, r1);
+            *matches &= _mm_movemask_epi8(_mm_packs_epi16(r0, r0));
+         }
+         break;
+   }
+}
+#endif
+
+/* Searches the items [@first, @last), all inside the memory buffer
+ * @buf that starts at address @offset */
+static void cheat_manager_search_items(const cheat_manager_t *cheat_st,
+      enum cheat_search_type search_type, const uint8_t *buf,
+      unsigned offset, unsigned first, unsigned last,
+      unsigned bytes_per_item, unsigned mask)
+{
+   unsigned item         = first;
+   const uint8_t *prev   = cheat_st->prev_memory_buf;
+   uint8_t *matches      = cheat_st->matches;
+   bool big_endian       = cheat_st->big_endian;
+#ifdef CHEAT_SEARCH_SIMD
+   /* Items per SIMD run */
+   unsigned run          = (bytes_per_item == 1) ? 16 : 8;
+   /* An exact or delta value wider than the item never matches,
+    * left to the scalar loop */
+   bool use_simd         = true;
+
+   if (     (search_type == CHEAT_SEARCH_TYPE_EXACT
+            && cheat_st->search_exact_value > mask)
+         || (search_type == CHEAT_SEARCH_TYPE_EQPLUS
+            && cheat_st->search_eqplus_value > mask)
+         || (search_type == CHEAT_SEARCH_TYPE_EQMINUS
+            && cheat_st->search_eqminus_value > mask))
+      use_simd = false;
+#endif
+
+   while (item < last)
+   {
+      unsigned address;
+
+#ifdef CHEAT_SEARCH_SIMD
+      if (use_simd && !(item & (run - 1)) && last - item >= run)
+      {
+         size_t blocks = (last - item) / run;
+         address       = item * bytes_per_item;
+         cheat_manager_search_sse2(cheat_st, search_type,
+               buf + address - offset, prev + address, matches + item / 8,
+               blocks, bytes_per_item * 8);
+         item         += (unsigned)(blocks * run);
+         continue;
+      }
+#endif
+
+      address = item * bytes_per_item;
+      if (     (matches[item >> 3] & (1 << (item & 7)))
+            && !cheat_manager_is_match(cheat_st, search_type,
+               cheat_manager_load_value(buf + address - offset,
+                  bytes_per_item, big_endian),
+               cheat_manager_load_value(prev + address,
+                  bytes_per_item, big_endian)))
+         matches[item >> 3] &= ~(1 << (item & 7));
+      item++;
+   }
+}
+
+/* Searches the 1, 2 or 4-bit slices of the bytes [@first, @last)
+ * of the memory buffer @buf that starts at address @offset */
+static void cheat_manager_search_slices(const cheat_manager_t *cheat_st,
+      enum cheat_search_type search_type, const uint8_t *buf,
+      unsigned offset, unsigned first, unsigned last,
+      unsigned bits, unsigned mask)
+{
+   unsigned address;
+   unsigned per_byte   = 8 / bits;
+   const uint8_t *prev = cheat_st->prev_memory_buf;
+   uint8_t *matches    = cheat_st->matches;
+
+   for (address = first; address < last; address++)
+   {
+      unsigned part;
+      unsigned item       = address * per_byte;
+      unsigned curr_val   = buf[address - offset];
+      unsigned prev_val   = prev[address];
+      uint8_t *match_byte = &matches[item >> 3];
+
+      if (!((*match_byte >> (item & 7)) & ((1 << per_byte) - 1)))
+         continue;
+
+      for (part = 0; part < per_byte; part++)
+      {
+         unsigned bit = 1 << ((item + part) & 7);
+         if (     (*match_byte & bit)
+               && !cheat_manager_is_match(cheat_st, search_type,
+                  (curr_val >> (part * bits)) & mask,
+                  (prev_val >> (part * bits)) & mask))
+            *match_byte &= ~bit;
+      }
+   }
+}
+
+/* Narrows the matches down to the items that compare to the last
+ * snapshot as @search_type asks, then takes a new snapshot. Memory is
+ * walked buffer by buffer; items that span two buffers are read
+ * apart. */
 static int cheat_manager_search(enum cheat_search_type search_type)
 {
    size_t _len;
    char msg[100];
    cheat_manager_t   *cheat_st = &cheat_manager_state;
-   unsigned char *curr         = cheat_st->curr_memory_buf;
-   unsigned char *prev         = cheat_st->prev_memory_buf;
-   unsigned int idx            = 0;
-   unsigned int curr_val       = 0;
-   unsigned int prev_val       = 0;
    unsigned int mask           = 0;
    unsigned int bytes_per_item = 1;
    unsigned int bits           = 8;
    unsigned int offset         = 0;
+   unsigned int items          = 0;
    unsigned int i              = 0;
 #ifdef HAVE_MENU
    struct menu_state *menu_st  = menu_state_get_ptr();
 #endif
 
-   if (cheat_st->num_memory_buffers == 0 || !prev || !cheat_st->matches)
+   if (     cheat_st->num_memory_buffers == 0
+         || !cheat_st->prev_memory_buf
+         || !cheat_st->matches)
    {
       _len = strlcpy(msg, msg_hash_to_str(MSG_CHEAT_SEARCH_NOT_INITIALIZED), sizeof(msg));
       runloop_msg_queue_push(msg, _len, 1, 180, true, NULL,
@@ -1024,99 +1460,47 @@ static int cheat_manager_search(enum cheat_search_type search_type)
       return 0;
    }
 
+   /* The search size changed since the last search; start over */
+   if (     cheat_st->matches_bit_size != cheat_st->search_bit_size
+         && !cheat_manager_reset_matches(cheat_st))
+      return 0;
+
    cheat_manager_setup_search_meta(cheat_st->search_bit_size, &bytes_per_item, &mask, &bits);
+   items = cheat_manager_num_items(cheat_st, cheat_st->search_bit_size);
 
-   /* little endian FF000000 = 256 */
-   for (idx = 0; idx < cheat_st->total_memory_size; idx = idx + bytes_per_item)
+   for (i = 0; i < cheat_st->num_memory_buffers; i++)
    {
-      unsigned byte_part;
-
-      offset = translate_address(idx, &curr);
+      const uint8_t *buf = cheat_st->memory_buf_list[i];
+      unsigned end       = offset + cheat_st->memory_size_list[i];
 
-      switch (bytes_per_item)
+      if (bits < 8)
+         cheat_manager_search_slices(cheat_st, search_type, buf, offset,
+               offset, end, bits, mask);
+      else
       {
-         case 2:
-            curr_val = cheat_st->big_endian ?
-               (*(curr + idx - offset) * 256) + *(curr + idx + 1 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256);
-            prev_val = cheat_st->big_endian ?
-               (*(prev + idx) * 256) + *(prev + idx + 1) :
-               *(prev + idx) + (*(prev + idx + 1) * 256);
-            break;
-         case 4:
-            curr_val = cheat_st->big_endian ?
-               (*(curr + idx - offset) * 256 * 256 * 256) + (*(curr + idx + 1 - offset) * 256 * 256) + (*(curr + idx + 2 - offset) * 256) + *(curr + idx + 3 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256) + (*(curr + idx + 2 - offset) * 256 * 256) + (*(curr + idx + 3 - offset) * 256 * 256 * 256);
-            prev_val = cheat_st->big_endian ?
-               (*(prev + idx) * 256 * 256 * 256) + (*(prev + idx + 1) * 256 * 256) + (*(prev + idx + 2) * 256) + *(prev + idx + 3) :
-               *(prev + idx) + (*(prev + idx + 1) * 256) + (*(prev + idx + 2) * 256 * 256) + (*(prev + idx + 3) * 256 * 256 * 256);
-            break;
-         case 1:
-         default:
-            curr_val = *(curr - offset + idx);
-            prev_val = *(prev + idx);
-            break;
+         unsigned first = (offset + bytes_per_item - 1) / bytes_per_item;
+         unsigned last  = MIN(end / bytes_per_item, items);
+
+         if (first < last)
+            cheat_manager_search_items(cheat_st, search_type, buf, offset,
+                  first, last, bytes_per_item, mask);
+
+         /* The item that runs into the next buffer */
+         if (last < items && last * bytes_per_item < end
+               && (cheat_st->matches[last >> 3] & (1 << (last & 7)))
+               && !cheat_manager_is_match(cheat_st, search_type,
+                  cheat_manager_read_value(cheat_st,
+                     last * bytes_per_item, bytes_per_item, false),
+                  cheat_manager_read_value(cheat_st,
+                     last * bytes_per_item, bytes_per_item, true)))
+            cheat_st->matches[last >> 3] &= ~(1 << (last & 7));
       }
 
-      for (byte_part = 0; byte_part < 8 / bits; byte_part++)
-      {
-         unsigned int curr_subval = (curr_val >> (byte_part * bits)) & mask;
-         unsigned int prev_subval = (prev_val >> (byte_part * bits)) & mask;
-         unsigned int prev_match;
-
-         if (bits < 8)
-            prev_match = *(cheat_st->matches + idx) & (mask << (byte_part * bits));
-         else
-            prev_match = *(cheat_st->matches + idx);
-
-         if (prev_match > 0)
-         {
-            bool match = false;
-            switch (search_type)
-            {
-               case CHEAT_SEARCH_TYPE_EXACT:
-                  match = (curr_subval == cheat_st->search_exact_value);
-                  break;
-               case CHEAT_SEARCH_TYPE_LT:
-                  match = (curr_subval < prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_GT:
-                  match = (curr_subval > prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_LTE:
-                  match = (curr_subval <= prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_GTE:
-                  match = (curr_subval >= prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_EQ:
-                  match = (curr_subval == prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_NEQ:
-                  match = (curr_subval != prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_EQPLUS:
-                  match = (curr_subval == prev_subval + cheat_st->search_eqplus_value);
-                  break;
-               case CHEAT_SEARCH_TYPE_EQMINUS:
-                  match = (curr_subval == prev_subval - cheat_st->search_eqminus_value);
-                  break;
-            }
-
-            if (!match)
-            {
-               if (bits < 8)
-                  *(cheat_st->matches + idx) = *(cheat_st->matches + idx) &
-                     ((~(mask << (byte_part * bits))) & 0xFF);
-               else
-                  memset(cheat_st->matches + idx, 0, bytes_per_item);
-               if (cheat_st->num_matches > 0)
-                  cheat_st->num_matches--;
-            }
-         }
-      }
+      offset = end;
    }
 
+   cheat_st->num_matches = cheat_manager_count_matches(cheat_st, items);
+
    offset = 0;
 
    for (i = 0; i < cheat_st->num_memory_buffers; i++)
@@ -1210,19 +1594,21 @@ int cheat_manager_add_matches(const char *path,
 {
    size_t _len;
    char msg[100];
-   unsigned          byte_part = 0;
-   unsigned            int idx = 0;
+   unsigned           int item = 0;
+   unsigned          int items = 0;
    unsigned           int mask = 0;
    unsigned int bytes_per_item = 1;
    unsigned           int bits = 8;
-   unsigned       int curr_val = 0;
-   unsigned         int offset = 0;
    cheat_manager_t   *cheat_st = &cheat_manager_state;
-   unsigned char         *curr = cheat_st->curr_memory_buf;
 #ifdef HAVE_MENU
    struct menu_state *menu_st  = menu_state_get_ptr();
 #endif
 
+   if (     cheat_st->matches
+         && cheat_st->matches_bit_size != cheat_st->search_bit_size
+         && !cheat_manager_reset_matches(cheat_st))
+      return 0;
+
    if (cheat_st->num_matches + cheat_st->size > 100)
    {
       _len = strlcpy(msg, msg_hash_to_str(MSG_CHEAT_SEARCH_ADDED_MATCHES_TOO_MANY), sizeof(msg));
@@ -1231,63 +1617,25 @@ int cheat_manager_add_matches(const char *path,
       return 0;
    }
    cheat_manager_setup_search_meta(cheat_st->search_bit_size, &bytes_per_item, &mask, &bits);
+   items = cheat_st->matches
+      ? cheat_manager_num_items(cheat_st, cheat_st->search_bit_size) : 0;
 
-   for (idx = 0; idx < cheat_st->total_memory_size; idx = idx + bytes_per_item)
+   for (item = cheat_manager_next_match(cheat_st, 0, items); item < items;
+         item = cheat_manager_next_match(cheat_st, item + 1, items))
    {
-      offset = translate_address(idx, &curr);
-
-      switch (bytes_per_item)
-      {
-         case 2:
-            curr_val = cheat_st->big_endian ?
-               (*(curr + idx - offset) * 256) + *(curr + idx + 1 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256);
-            break;
-         case 4:
-            curr_val = cheat_st->big_endian ?
-               (*(curr + idx - offset) * 256 * 256 * 256) + (*(curr + idx + 1 - offset) * 256 * 256) + (*(curr + idx + 2 - offset) * 256) + *(curr + idx + 3 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256) + (*(curr + idx + 2 - offset) * 256 * 256) + (*(curr + idx + 3 - offset) * 256 * 256 * 256);
-            break;
-         case 1:
-         default:
-            curr_val = *(curr - offset + idx);
-            break;
-      }
-      for (byte_part = 0; byte_part < 8 / bits; byte_part++)
+      unsigned address_mask;
+      unsigned address = cheat_manager_item_address(
+            cheat_st->search_bit_size, item, &address_mask);
+
+      if (!cheat_manager_add_new_code(cheat_st->search_bit_size, address,
+               address_mask, cheat_st->big_endian,
+               cheat_manager_read_value(cheat_st, address,
+                  bytes_per_item, false)))
       {
-         unsigned int prev_match;
-
-         if (bits < 8)
-         {
-            prev_match = *(cheat_st->matches + idx) & (mask << (byte_part * bits));
-            if (prev_match)
-            {
-               if (!cheat_manager_add_new_code(cheat_st->search_bit_size, idx, (mask << (byte_part * bits)),
-                        cheat_st->big_endian, curr_val))
-               {
-                  _len = strlcpy(msg, msg_hash_to_str(MSG_CHEAT_SEARCH_ADDED_MATCHES_FAIL), sizeof(msg));
-                  runloop_msg_queue_push(msg, _len, 1, 180, true, NULL,
-                        MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                  return 0;
-               }
-            }
-         }
-         else
-         {
-            prev_match = *(cheat_st->matches + idx);
-            if (prev_match)
-            {
-               if (!cheat_manager_add_new_code(cheat_st->search_bit_size, idx, 0xFF,
-                        cheat_st->big_endian, curr_val))
-               {
-                  _len = strlcpy(msg, msg_hash_to_str(MSG_CHEAT_SEARCH_ADDED_MATCHES_FAIL), sizeof(msg));
-                  runloop_msg_queue_push(msg, _len, 1, 180, true, NULL,
-                        MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                  return 0;
-               }
-            }
-         }
-
+         _len = strlcpy(msg, msg_hash_to_str(MSG_CHEAT_SEARCH_ADDED_MATCHES_FAIL), sizeof(msg));
+         runloop_msg_queue_push(msg, _len, 1, 180, true, NULL,
+               MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+         return 0;
       }
    }
 
@@ -1589,17 +1937,15 @@ void cheat_manager_apply_retro_cheats(void)
 void cheat_manager_match_action(enum cheat_match_action_type match_action, unsigned int target_match_idx, unsigned int *address, unsigned int *address_mask,
       unsigned int *prev_value, unsigned int *curr_value)
 {
-   unsigned int byte_part;
+   unsigned int item;
+   unsigned int items;
    unsigned int idx;
-   unsigned int start_idx;
+   unsigned int idx_mask;
    unsigned int           mask = 0;
    unsigned int bytes_per_item = 1;
    unsigned int           bits = 8;
    unsigned int       curr_val = 0;
-   unsigned int       prev_val = 0;
-   unsigned int         offset = 0;
    cheat_manager_t   *cheat_st = &cheat_manager_state;
-   unsigned char         *curr = cheat_st->curr_memory_buf;
    unsigned char         *prev = cheat_st->prev_memory_buf;
    unsigned int curr_match_idx = 0;
 
@@ -1612,163 +1958,77 @@ void cheat_manager_match_action(enum cheat_match_action_type match_action, unsig
    cheat_manager_setup_search_meta(cheat_st->search_bit_size, &bytes_per_item, &mask, &bits);
 
    if (match_action == CHEAT_MATCH_ACTION_TYPE_BROWSE)
-      start_idx = *address;
-   else
-      start_idx = 0;
-
-   for (idx = start_idx; idx < cheat_st->total_memory_size; idx = idx + bytes_per_item)
    {
-      offset = translate_address(idx, &curr);
-
-      switch (bytes_per_item)
+      if (*address < cheat_st->total_memory_size)
       {
-         case 2:
-            curr_val = cheat_st->big_endian ?
-               (*(curr + idx - offset) * 256) + *(curr + idx + 1 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256);
-            if (prev)
-               prev_val = cheat_st->big_endian ?
-                  (*(prev + idx) * 256) + *(prev + idx + 1) :
-                  *(prev + idx) + (*(prev + idx + 1) * 256);
-            break;
-         case 4:
-            curr_val = cheat_st->big_endian ?
-               (*(curr + idx - offset) * 256 * 256 * 256) + (*(curr + idx + 1 - offset) * 256 * 256) + (*(curr + idx + 2 - offset) * 256) + *(curr + idx + 3 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256) + (*(curr + idx + 2 - offset) * 256 * 256) + (*(curr + idx + 3 - offset) * 256 * 256 * 256);
-            if (prev)
-               prev_val = cheat_st->big_endian ?
-                  (*(prev + idx) * 256 * 256 * 256) + (*(prev + idx + 1) * 256 * 256) + (*(prev + idx + 2) * 256) + *(prev + idx + 3) :
-                  *(prev + idx) + (*(prev + idx + 1) * 256) + (*(prev + idx + 2) * 256 * 256) + (*(prev + idx + 3) * 256 * 256 * 256);
-            break;
-         case 1:
-         default:
-            curr_val = *(curr + idx - offset);
-            if (prev)
-               prev_val = *(prev + idx);
-            break;
+         *curr_value = cheat_manager_read_value(cheat_st, *address,
+               bytes_per_item, false);
+         *prev_value = prev ? cheat_manager_read_value(cheat_st, *address,
+               bytes_per_item, true) : 0;
       }
+      return;
+   }
 
-      if (match_action == CHEAT_MATCH_ACTION_TYPE_BROWSE)
-      {
-         *curr_value = curr_val;
-         *prev_value = prev_val;
-         return;
-      }
+   if (!prev || !cheat_st->matches)
+      return;
 
-      if (!prev)
-         return;
+   if (     cheat_st->matches_bit_size != cheat_st->search_bit_size
+         && !cheat_manager_reset_matches(cheat_st))
+      return;
 
-      for (byte_part = 0; byte_part < 8 / bits; byte_part++)
-      {
-         unsigned int prev_match;
+   items = cheat_manager_num_items(cheat_st, cheat_st->search_bit_size);
 
-         if (bits < 8)
+   for (item = cheat_manager_next_match(cheat_st, 0, items); item < items;
+         item = cheat_manager_next_match(cheat_st, item + 1, items))
+   {
+      if (curr_match_idx++ == target_match_idx)
+         break;
+   }
+
+   if (item >= items)
+      return;
+
+   idx      = cheat_manager_item_address(cheat_st->search_bit_size,
+         item, &idx_mask);
+   curr_val = cheat_manager_read_value(cheat_st, idx, bytes_per_item, false);
+
+   switch (match_action)
+   {
+      case CHEAT_MATCH_ACTION_TYPE_BROWSE:
+         return;
+      case CHEAT_MATCH_ACTION_TYPE_VIEW:
+         *address      = idx;
+         *address_mask = idx_mask;
+         *curr_value   = curr_val;
+         *prev_value   = cheat_manager_read_value(cheat_st, idx,
+               bytes_per_item, true);
+         return;
+      case CHEAT_MATCH_ACTION_TYPE_COPY:
+         if (!cheat_manager_add_new_code(cheat_st->search_bit_size, idx, idx_mask,
+               cheat_st->big_endian, curr_val))
          {
-            prev_match = *(cheat_st->matches + idx) & (mask << (byte_part * bits));
-            if (prev_match)
-            {
-               if (target_match_idx == curr_match_idx)
-               {
-                  switch (match_action)
-                  {
-                  case CHEAT_MATCH_ACTION_TYPE_BROWSE:
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_VIEW:
-                     *address = idx;
-                     *address_mask = (mask << (byte_part * bits));
-                     *curr_value = curr_val;
-                     *prev_value = prev_val;
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_COPY:
-                     if (!cheat_manager_add_new_code(cheat_st->search_bit_size, idx, (mask << (byte_part * bits)),
-                           cheat_st->big_endian, curr_val))
-                     {
-                        const char *_msg = msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_FAIL);
-                        runloop_msg_queue_push(_msg, strlen(_msg), 1, 180, true, NULL,
-                              MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                     }
-                     else
-                     {
-                        const char *_msg = msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_SUCCESS);
-                        runloop_msg_queue_push(_msg, strlen(_msg), 1, 180, true, NULL,
-                              MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                     }
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_DELETE:
-                     {
-                        const char *_msg;
-                        if (bits < 8)
-                           *(cheat_st->matches + idx) = *(cheat_st->matches + idx) &
-                              ((~(mask << (byte_part * bits))) & 0xFF);
-                        else
-                           memset(cheat_st->matches + idx, 0, bytes_per_item);
-                        if (cheat_st->num_matches > 0)
-                           cheat_st->num_matches--;
-                        _msg = msg_hash_to_str(MSG_CHEAT_SEARCH_DELETE_MATCH_SUCCESS);
-                        runloop_msg_queue_push(_msg, strlen(_msg), 1, 180, true, NULL,
-                              MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                     }
-                     return;
-                  }
-                  return;
-               }
-               curr_match_idx++;
-            }
+            const char *_msg = msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_FAIL);
+            runloop_msg_queue_push(_msg, strlen(_msg), 1, 180, true, NULL,
+                  MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
          }
          else
          {
-            prev_match = *(cheat_st->matches + idx);
-            if (prev_match)
-            {
-               if (target_match_idx == curr_match_idx)
-               {
-                  switch (match_action)
-                  {
-                  case CHEAT_MATCH_ACTION_TYPE_BROWSE:
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_VIEW:
-                     *address = idx;
-                     *address_mask = 0xFF;
-                     *curr_value = curr_val;
-                     *prev_value = prev_val;
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_COPY:
-                     if (!cheat_manager_add_new_code(cheat_st->search_bit_size, idx, 0xFF,
-                           cheat_st->big_endian, curr_val))
-                     {
-                        const char *_msg = msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_FAIL);
-                        runloop_msg_queue_push(_msg, strlen(_msg), 1, 180, true, NULL,
-                              MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                     }
-                     else
-                     {
-                        const char *_msg = msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_SUCCESS);
-                        runloop_msg_queue_push(_msg, strlen(_msg), 1, 180, true, NULL,
-                              MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                     }
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_DELETE:
-                     {
-                        const char *_msg;
-                        if (bits < 8)
-                           *(cheat_st->matches + idx) = *(cheat_st->matches + idx) &
-                              ((~(mask << (byte_part * bits))) & 0xFF);
-                        else
-                           memset(cheat_st->matches + idx, 0, bytes_per_item);
-                        if (cheat_st->num_matches > 0)
-                           cheat_st->num_matches--;
-                        _msg = msg_hash_to_str(MSG_CHEAT_SEARCH_DELETE_MATCH_SUCCESS);
-                        runloop_msg_queue_push(_msg, strlen(_msg), 1, 180, true, NULL,
-                              MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                        return;
-                     }
-                  }
-               }
-
-               curr_match_idx++;
-            }
+            const char *_msg = msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_SUCCESS);
+            runloop_msg_queue_push(_msg, strlen(_msg), 1, 180, true, NULL,
+                  MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
          }
-      }
+         return;
+      case CHEAT_MATCH_ACTION_TYPE_DELETE:
+         {
+            const char *_msg;
+            cheat_st->matches[item >> 3] &= ~(1 << (item & 7));
+            if (cheat_st->num_matches > 0)
+               cheat_st->num_matches--;
+            _msg = msg_hash_to_str(MSG_CHEAT_SEARCH_DELETE_MATCH_SUCCESS);
+            runloop_msg_queue_push(_msg, strlen(_msg), 1, 180, true, NULL,
+                  MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+         }
+         return;
    }
 }
 
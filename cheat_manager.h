@@ -175,6 +175,8 @@ struct cheat_manager
    unsigned match_idx;
    unsigned match_action;
    unsigned search_bit_size;
+   /* The search_bit_size the matches bitset was made for */
+   unsigned matches_bit_size;
    unsigned dummy;
    unsigned search_exact_value;
    unsigned search_eqplus_value;
@@ -89,6 +89,8 @@ static rcheevos_locals_t rcheevos_locals =
 {
    NULL, /* client */
    {{0}},/* memory */
+   0,    /* memory_region */
+   0,    /* memory_region_start */
 #ifdef HAVE_THREADS
    CMD_EVENT_NONE, /* queued_command */
 #endif
@@ -118,6 +120,9 @@ Supporting functions.
 
 #define CMD_CHEEVOS_FINALIZE_LOAD -1
 static void rcheevos_finalize_game_load_on_ui_thread(void);
+#ifdef HAVE_THREADS
+static void rcheevos_frame_wait(void);
+#endif
 
 #ifndef CHEEVOS_VERBOSE
 void rcheevos_log(const char* fmt, ...)
@@ -182,6 +187,8 @@ static int rcheevos_init_memory(rcheevos_locals_t* locals)
    rc_libretro_init_verbose_message_callback(rcheevos_handle_log_message);
    result = rc_libretro_memory_init(&locals->memory, &mmap,
          rcheevos_get_core_memory_info, console_id);
+   locals->memory_region       = 0;
+   locals->memory_region_start = 0;
 
    free(descriptors);
    return result;
@@ -224,6 +231,9 @@ void rcheevos_spectating_changed(void)
 
 bool rcheevos_is_pause_allowed(void)
 {
+#ifdef HAVE_THREADS
+   rcheevos_frame_wait();
+#endif
    return rc_client_can_pause(rcheevos_locals.client, NULL);
 }
 
@@ -537,8 +547,51 @@ static void rcheevos_server_reconnected(void)
 #endif
 }
 
+#ifdef HAVE_THREADS
+/* Largest core memory copied each frame for the frame thread; games
+ * with more are tested on the main thread, as the copy would cost
+ * more than the test */
+#define RCHEEVOS_FRAME_SNAPSHOT_MAX CHEEVOS_MB(4)
+
+/* Keeps an event raised on the frame thread for the main thread. The
+ * events rc_client_do_frame() raises point at the game's achievements
+ * and leaderboards, which live until the game is unloaded. */
+static void rcheevos_frame_queue_event(const rc_client_event_t* event)
+{
+   rcheevos_locals_t* locals = &rcheevos_locals;
+
+   if (locals->frame_event_count == locals->frame_event_capacity)
+   {
+      unsigned capacity                   = locals->frame_event_capacity
+         ? locals->frame_event_capacity * 2 : 8;
+      rc_client_event_t* events           = (rc_client_event_t*)
+         realloc(locals->frame_events, capacity * sizeof(*events));
+
+      if (!events)
+      {
+         CHEEVOS_ERR(RCHEEVOS_TAG "Dropped rc_client event %u\n", event->type);
+         return;
+      }
+
+      locals->frame_events                = events;
+      locals->frame_event_capacity        = capacity;
+   }
+
+   locals->frame_events[locals->frame_event_count++] = *event;
+}
+#endif
+
 static void rcheevos_client_event_handler(const rc_client_event_t* event, rc_client_t* client)
 {
+#ifdef HAVE_THREADS
+   if (     rcheevos_locals.frame_thread
+         && sthread_isself(rcheevos_locals.frame_thread))
+   {
+      rcheevos_frame_queue_event(event);
+      return;
+   }
+#endif
+
    switch (event->type)
    {
 #ifdef HAVE_GFX_WIDGETS
@@ -605,6 +658,190 @@ static void rcheevos_client_event_handler(const rc_client_event_t* event, rc_cli
    }
 }
 
+#ifdef HAVE_THREADS
+static void rcheevos_frame_thread(void* userdata)
+{
+   rcheevos_locals_t* locals = (rcheevos_locals_t*)userdata;
+
+   slock_lock(locals->frame_lock);
+   for (;;)
+   {
+      while (!locals->frame_pending && !locals->frame_quit)
+         scond_wait(locals->frame_cond, locals->frame_lock);
+      if (locals->frame_quit)
+         break;
+      slock_unlock(locals->frame_lock);
+
+      rc_client_do_frame(locals->client);
+
+      slock_lock(locals->frame_lock);
+      locals->frame_pending = false;
+      scond_signal(locals->frame_cond);
+   }
+   slock_unlock(locals->frame_lock);
+}
+
+/* Waits for the frame thread to finish testing its frame, so that the
+ * client can be used, or the memory changed, as of the end of it */
+static void rcheevos_frame_wait(void)
+{
+   rcheevos_locals_t* locals = &rcheevos_locals;
+
+   if (!locals->frame_thread)
+      return;
+
+   slock_lock(locals->frame_lock);
+   while (locals->frame_pending)
+      scond_wait(locals->frame_cond, locals->frame_lock);
+   slock_unlock(locals->frame_lock);
+}
+
+/* Waits for the frame thread, then handles the events its frame
+ * raised, in the order they were raised */
+static void rcheevos_frame_finish(void)
+{
+   unsigned i, count;
+   rcheevos_locals_t* locals = &rcheevos_locals;
+
+   rcheevos_frame_wait();
+
+   count                     = locals->frame_event_count;
+   locals->frame_event_count = 0;
+
+   /* An event may end up stopping the thread, which frees the queue */
+   for (i = 0; i < count && locals->frame_events; i++)
+      rcheevos_client_event_handler(&locals->frame_events[i],
+            locals->client);
+}
+
+static bool rcheevos_frame_start(void)
+{
+   rcheevos_locals_t* locals = &rcheevos_locals;
+
+   locals->frame_pending     = false;
+   locals->frame_quit        = false;
+
+   if (!(locals->frame_lock = slock_new()))
+      return false;
+   if (!(locals->frame_cond = scond_new()))
+   {
+      slock_free(locals->frame_lock);
+      locals->frame_lock     = NULL;
+      return false;
+   }
+   if (!(locals->frame_thread = sthread_create(
+               rcheevos_frame_thread, locals)))
+   {
+      scond_free(locals->frame_cond);
+      slock_free(locals->frame_lock);
+      locals->frame_cond     = NULL;
+      locals->frame_lock     = NULL;
+      return false;
+   }
+
+   CHEEVOS_LOG(RCHEEVOS_TAG "Testing achievements on a separate thread\n");
+   return true;
+}
+
+static void rcheevos_frame_stop(void)
+{
+   rcheevos_locals_t* locals = &rcheevos_locals;
+
+   if (!locals->frame_thread)
+      return;
+
+   rcheevos_frame_finish();
+
+   slock_lock(locals->frame_lock);
+   locals->frame_quit = true;
+   scond_signal(locals->frame_cond);
+   slock_unlock(locals->frame_lock);
+
+   /* Cleared only once joined, reads still check it until then */
+   sthread_join(locals->frame_thread);
+   locals->frame_thread = NULL;
+
+   scond_free(locals->frame_cond);
+   slock_free(locals->frame_lock);
+   free(locals->frame_snapshot);
+   free(locals->frame_events);
+   locals->frame_cond           = NULL;
+   locals->frame_lock           = NULL;
+   locals->frame_snapshot       = NULL;
+   locals->frame_snapshot_size  = 0;
+   locals->frame_events         = NULL;
+   locals->frame_event_count    = 0;
+   locals->frame_event_capacity = 0;
+}
+
+/* Hands the frame that just ran to the frame thread, once the one
+ * before it is done. Returns false to test it here instead. */
+static bool rcheevos_frame_begin(void)
+{
+   unsigned i;
+   size_t size                                 = 0;
+   rcheevos_locals_t* locals                   = &rcheevos_locals;
+   const rc_libretro_memory_regions_t* regions = &locals->memory;
+
+   for (i = 0; i < regions->count; i++)
+      size += regions->size[i];
+
+   if (     !config_get_ptr()->bools.cheevos_threaded
+         || size > RCHEEVOS_FRAME_SNAPSHOT_MAX)
+   {
+      rcheevos_frame_stop();
+      return false;
+   }
+
+   if (!locals->frame_thread && !rcheevos_frame_start())
+      return false;
+
+   rcheevos_frame_finish();
+
+   /* One of the events may have stopped the thread */
+   if (!locals->frame_thread)
+      return false;
+
+   if (locals->frame_snapshot_size < size)
+   {
+      uint8_t* snapshot = (uint8_t*)realloc(locals->frame_snapshot, size);
+      if (!snapshot)
+      {
+         rcheevos_frame_stop();
+         return false;
+      }
+      locals->frame_snapshot      = snapshot;
+      locals->frame_snapshot_size = size;
+   }
+
+   /* Same layout as the core memory; the region cache is redone each
+    * frame in case the layout changed */
+   for (i = 0, size = 0; i < regions->count; i++)
+   {
+      locals->frame_memory.size[i] = regions->size[i];
+      if (regions->data[i])
+      {
+         locals->frame_memory.data[i] = locals->frame_snapshot + size;
+         memcpy(locals->frame_memory.data[i],
+               regions->data[i], regions->size[i]);
+      }
+      else
+         locals->frame_memory.data[i] = NULL;
+      size += regions->size[i];
+   }
+   locals->frame_memory.count      = regions->count;
+   locals->frame_memory.total_size = size;
+   locals->frame_region            = 0;
+   locals->frame_region_start      = 0;
+
+   slock_lock(locals->frame_lock);
+   locals->frame_pending = true;
+   scond_signal(locals->frame_cond);
+   slock_unlock(locals->frame_lock);
+   return true;
+}
+#endif
+
 int rcheevos_get_richpresence(char* s, size_t len)
 {
    if (!rcheevos_is_player_active())
@@ -650,6 +887,10 @@ void rcheevos_reset_game(bool widgets_ready)
    rcheevos_hide_widgets(widgets_ready);
 #endif
 
+#ifdef HAVE_THREADS
+   rcheevos_frame_wait();
+#endif
+
    rc_client_reset(rcheevos_locals.client);
 
    /* Some cores reallocate memory on reset,
@@ -660,6 +901,9 @@ void rcheevos_reset_game(bool widgets_ready)
 
 void rcheevos_refresh_memory(void)
 {
+#ifdef HAVE_THREADS
+   rcheevos_frame_wait();
+#endif
    if (rcheevos_locals.memory.total_size > 0)
       rcheevos_init_memory(&rcheevos_locals);
 }
@@ -685,7 +929,13 @@ void rcheevos_pause_hardcore(void)
 
 bool rcheevos_unload(void)
 {
-   const bool was_loaded = rcheevos_is_game_loaded();
+   bool was_loaded;
+
+#ifdef HAVE_THREADS
+   rcheevos_frame_stop();
+#endif
+
+   was_loaded = rcheevos_is_game_loaded();
 
 #ifdef HAVE_GFX_WIDGETS
    rcheevos_hide_widgets(gfx_widgets_ready());
@@ -840,6 +1090,10 @@ static void rcheevos_toggle_hardcore_active(rcheevos_locals_t* locals)
 
 void rcheevos_toggle_hardcore_paused(void)
 {
+#ifdef HAVE_THREADS
+   rcheevos_frame_wait();
+#endif
+
    /* if hardcore mode is not enabled, we can't toggle whether its active */
    if (config_get_ptr()->bools.cheevos_hardcore_mode_enable)
       rcheevos_toggle_hardcore_active(&rcheevos_locals);
@@ -1007,28 +1261,52 @@ void rcheevos_test(void)
 #endif
 
    if (rcheevos_locals.memory.count != 0)
+   {
+#ifdef HAVE_THREADS
+      if (rcheevos_frame_begin())
+         return;
+#endif
       rc_client_do_frame(rcheevos_locals.client);
+   }
    else
+   {
+#ifdef HAVE_THREADS
+      rcheevos_frame_stop();
+#endif
       rc_client_idle(rcheevos_locals.client);
+   }
 }
 
 void rcheevos_idle(void)
 {
+#ifdef HAVE_THREADS
+   rcheevos_frame_finish();
+#endif
    rc_client_idle(rcheevos_locals.client);
 }
 
 size_t rcheevos_get_serialize_size(void)
 {
+#ifdef HAVE_THREADS
+   rcheevos_frame_wait();
+#endif
    return rc_client_progress_size(rcheevos_locals.client);
 }
 
 bool rcheevos_get_serialized_data(void* buffer)
 {
+#ifdef HAVE_THREADS
+   rcheevos_frame_wait();
+#endif
    return (rc_client_serialize_progress(rcheevos_locals.client, (uint8_t*)buffer) == RC_OK);
 }
 
 bool rcheevos_set_serialized_data(void* buffer)
 {
+#ifdef HAVE_THREADS
+   rcheevos_frame_wait();
+#endif
+
    if (rcheevos_is_game_loaded() && buffer)
    {
       const int result = rc_client_deserialize_progress(
@@ -1287,10 +1565,62 @@ static void rcheevos_show_game_placard(void)
    }
 }
 
+static uint32_t rcheevos_read_regions(
+   const rc_libretro_memory_regions_t* regions,
+   uint32_t* region, uint32_t* region_start,
+   uint32_t address, uint8_t* buffer, uint32_t num_bytes)
+{
+   uint32_t i     = *region;
+   uint32_t start = *region_start;
+
+   /* rcheevos reads each memref once a frame, mostly in runs within
+    * one region; try the region of the last read before walking the
+    * map from the start */
+   if (     i < regions->count
+         && address >= start
+         && address - start < regions->size[i]
+         && regions->size[i] - (address - start) >= num_bytes
+         && regions->data[i])
+   {
+      const uint8_t* src = &regions->data[i][address - start];
+      if (num_bytes == 1)
+         *buffer = *src;
+      else
+         memcpy(buffer, src, num_bytes);
+      return num_bytes;
+   }
+
+   for (i = 0, start = 0; i < regions->count; ++i)
+   {
+      if (address - start < regions->size[i])
+      {
+         *region       = i;
+         *region_start = start;
+         break;
+      }
+      start += (uint32_t)regions->size[i];
+   }
+
+   return rc_libretro_memory_read(regions, address, buffer, num_bytes);
+}
+
 static uint32_t rcheevos_client_read_memory(uint32_t address,
    uint8_t* buffer, uint32_t num_bytes, rc_client_t* client)
 {
-   return rc_libretro_memory_read(&rcheevos_locals.memory, address, buffer, num_bytes);
+#ifdef HAVE_THREADS
+   /* The frame thread tests the copy taken at the end of its frame */
+   if (rcheevos_locals.frame_thread
+         && sthread_isself(rcheevos_locals.frame_thread))
+      return rcheevos_read_regions(&rcheevos_locals.frame_memory,
+            &rcheevos_locals.frame_region,
+            &rcheevos_locals.frame_region_start,
+            address, buffer, num_bytes);
+#endif
+
+   return rcheevos_read_regions(&rcheevos_locals.memory,
+         &rcheevos_locals.memory_region,
+         &rcheevos_locals.memory_region_start,
+         address, buffer, num_bytes);
 }
 
 static uint32_t rcheevos_client_read_memory_dummy(uint32_t address,
@@ -1551,6 +1881,7 @@ bool rcheevos_load(const void *data)
       && settings->bools.cheevos_enable;
 
 #ifdef HAVE_THREADS
+   rcheevos_frame_stop();
    rcheevos_locals.queued_command = CMD_EVENT_NONE;
 #endif
 
@@ -1700,6 +2031,9 @@ static void rcheevos_client_change_media_callback(int result,
 
 void rcheevos_change_disc(const char* new_disc_path, bool initial_disc)
 {
+#ifdef HAVE_THREADS
+   rcheevos_frame_wait();
+#endif
    if (rcheevos_locals.client)
    {
       rc_client_begin_identify_and_change_media(rcheevos_locals.client, new_disc_path,
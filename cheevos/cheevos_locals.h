@@ -83,6 +83,8 @@ typedef struct rcheevos_locals_t
 {
    rc_client_t* client;               /* rcheevos client state */
    rc_libretro_memory_regions_t memory;/* achievement addresses to core memory mappings */
+   uint32_t memory_region;            /* region of memory the last read landed in */
+   uint32_t memory_region_start;      /* first address of memory_region */
 
 #ifdef HAVE_THREADS
    enum event_command queued_command; /* action queued by background thread to be run on main thread */
@@ -102,6 +104,22 @@ typedef struct rcheevos_locals_t
    bool hardcore_being_enabled;       /* allows callers to detect hardcore mode while it's being enabled */
 
    bool core_supports;                /* false if core explicitly disables achievements */
+
+#ifdef HAVE_THREADS
+   sthread_t* frame_thread;           /* tests the last frame against frame_memory while the next one runs */
+   slock_t* frame_lock;
+   scond_t* frame_cond;
+   uint8_t* frame_snapshot;           /* copy of the core memory taken at the end of the frame */
+   size_t frame_snapshot_size;
+   rc_libretro_memory_regions_t frame_memory; /* memory regions pointing into frame_snapshot */
+   uint32_t frame_region;             /* memory_region for reads of frame_memory */
+   uint32_t frame_region_start;
+   rc_client_event_t* frame_events;   /* events raised by frame_thread, handled on the main thread */
+   unsigned frame_event_count;
+   unsigned frame_event_capacity;
+   bool frame_pending;                /* frame_thread has a frame to test */
+   bool frame_quit;
+#endif
 } rcheevos_locals_t;
 
 rcheevos_locals_t* get_rcheevos_locals(void);
@@ -0,0 +1,178 @@
+/**
+ *  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ *  more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with RetroArch. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <string.h>
+
+#include <compat/strl.h>
+#include <string/stdstring.h>
+
+#include "clock_governor.h"
+#include "frame_timeline.h"
+
+/* Frames between decisions, also the frame timeline's window for
+ * the longest frame interval */
+#define CLOCK_GOVERNOR_WINDOW       60
+/* Share of the frame period that is too close to missing it */
+#define CLOCK_GOVERNOR_LOAD_UP      0.80f
+/* Share the next level down may be expected to take */
+#define CLOCK_GOVERNOR_LOAD_DOWN    0.65f
+/* A frame interval this many periods long was a missed frame */
+#define CLOCK_GOVERNOR_MISS         1.5f
+/* Windows in a row the slower level must look safe */
+#define CLOCK_GOVERNOR_DOWN_WINDOWS 3
+#define CLOCK_GOVERNOR_CORES        8
+
+struct clock_governor_core
+{
+   char name[64];
+   unsigned level;
+};
+
+typedef struct clock_governor
+{
+   const unsigned *rates;
+   clock_governor_apply_t apply;
+   struct clock_governor_core cores[CLOCK_GOVERNOR_CORES];
+   unsigned count;
+   unsigned level;
+   unsigned frames;
+   unsigned quiet;
+   unsigned next_core;
+   char core[64];
+} clock_governor_t;
+
+static clock_governor_t clock_governor_st;
+
+void clock_governor_init(const unsigned *rates, unsigned count,
+      unsigned level, clock_governor_apply_t apply)
+{
+   clock_governor_t *governor = &clock_governor_st;
+
+   if (!rates || !count || !apply)
+      return;
+
+   /* Carry the cores' levels over when the same clock is set up again */
+   if (governor->rates != rates || governor->count != count)
+   {
+      memset(governor, 0, sizeof(*governor));
+      governor->level = level < count ? level : count - 1;
+   }
+   governor->rates  = rates;
+   governor->count  = count;
+   governor->apply  = apply;
+   governor->apply(governor->level);
+}
+
+void clock_governor_deinit(void)
+{
+   clock_governor_st.apply = NULL;
+}
+
+bool clock_governor_is_active(void)
+{
+   return clock_governor_st.apply != NULL;
+}
+
+static void clock_governor_set_level(clock_governor_t *governor,
+      unsigned level)
+{
+   governor->quiet = 0;
+   if (level == governor->level)
+      return;
+   governor->level = level;
+   governor->apply(level);
+}
+
+/* Saves the level for the core that stopped and takes up the
+ * one last picked for the core that started */
+static void clock_governor_switch_core(clock_governor_t *governor,
+      const char *core_name)
+{
+   unsigned i;
+   struct clock_governor_core *core = NULL;
+
+   for (i = 0; i < CLOCK_GOVERNOR_CORES; i++)
+      if (string_is_equal(governor->cores[i].name, governor->core))
+         core = &governor->cores[i];
+   if (!core && !string_is_empty(governor->core))
+   {
+      core = &governor->cores[governor->next_core];
+      governor->next_core = (governor->next_core + 1) % CLOCK_GOVERNOR_CORES;
+      strlcpy(core->name, governor->core, sizeof(core->name));
+   }
+   if (core)
+      core->level = governor->level;
+
+   strlcpy(governor->core, core_name, sizeof(governor->core));
+   for (i = 0; i < CLOCK_GOVERNOR_CORES; i++)
+      if (string_is_equal(governor->cores[i].name, governor->core))
+         clock_governor_set_level(governor, governor->cores[i].level);
+}
+
+void clock_governor_frame(float period_ms, const char *core_name,
+      bool netplay)
+{
+   float busy_ms, load;
+   struct frame_timeline_stats stats;
+   clock_governor_t *governor = &clock_governor_st;
+
+   if (!governor->apply || period_ms <= 0.0f)
+      return;
+   if (++governor->frames < CLOCK_GOVERNOR_WINDOW)
+      return;
+   governor->frames = 0;
+
+   if (!core_name)
+      core_name = "";
+   if (!string_is_equal(core_name, governor->core))
+   {
+      clock_governor_switch_core(governor, core_name);
+      return;
+   }
+
+   /* What the CPU spends on a frame: not the wait for vsync in the
+    * driver's present */
+   frame_timeline_get_stats(&stats);
+   busy_ms = stats.stage_ms[FRAME_TIMELINE_INPUT_POLL]
+      + stats.stage_ms[FRAME_TIMELINE_CORE_RUN]
+      + stats.stage_ms[FRAME_TIMELINE_VIDEO_FRAME]
+      - stats.stage_ms[FRAME_TIMELINE_DRIVER_FRAME];
+   load    = busy_ms / period_ms;
+
+   if (     load > CLOCK_GOVERNOR_LOAD_UP
+         || stats.max_interval_ms > period_ms * CLOCK_GOVERNOR_MISS)
+   {
+      if (governor->level > 0)
+         clock_governor_set_level(governor, governor->level - 1);
+      else
+         governor->quiet = 0;
+      return;
+   }
+
+   if (netplay || governor->level + 1 >= governor->count)
+      return;
+
+   /* The work takes longer in proportion to the slower clock */
+   if (     load * governor->rates[governor->level]
+         < CLOCK_GOVERNOR_LOAD_DOWN * governor->rates[governor->level + 1])
+   {
+      if (++governor->quiet >= CLOCK_GOVERNOR_DOWN_WINDOWS)
+         clock_governor_set_level(governor, governor->level + 1);
+   }
+   else
+      governor->quiet = 0;
+}
@@ -0,0 +1,51 @@
+/**
+ *  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ *  more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with RetroArch. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef __RARCH_CLOCK_GOVERNOR_H
+#define __RARCH_CLOCK_GOVERNOR_H
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/* Sets the clock to one of the governor's levels */
+typedef void (*clock_governor_apply_t)(unsigned level);
+
+/* Picks a CPU clock from the frame timeline: a level faster when the
+ * core and the CPU side of the video frame come near the frame period
+ * or a frame runs late, a level slower when the slower clock would
+ * still leave headroom for a few seconds running. The level last
+ * picked is kept for every core, and netplay only ever steps up, so
+ * the clock doesn't sink under a match's rollbacks.
+ *
+ * @rates are the @count levels' clocks, fastest first, in any unit;
+ * the governor starts at @level and calls @apply on every change. */
+void clock_governor_init(const unsigned *rates, unsigned count,
+      unsigned level, clock_governor_apply_t apply);
+
+void clock_governor_deinit(void);
+
+bool clock_governor_is_active(void);
+
+/* Once per frame the core runs */
+void clock_governor_frame(float period_ms, const char *core_name,
+      bool netplay);
+
+RETRO_END_DECLS
+
+#endif
@@ -29,6 +29,9 @@
 #include <streams/stdin_stream.h>
 #include <streams/file_stream.h>
 #include <string/stdstring.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -68,6 +71,7 @@
 #include "version.h"
 #include "version_git.h"
 #include "tasks/task_content.h"
+#include "tasks/tasks_internal.h"
 
 #define CMD_BUF_SIZE 4096
 
@@ -179,6 +183,20 @@ static void command_parse_msg(command_t *handle, char *buf)
 }
 
 #if defined(HAVE_NETWORK_CMD)
+typedef struct
+{
+   uint32_t address;
+   uint16_t length;
+} command_binary_range_t;
+
+typedef struct
+{
+   struct sockaddr_storage addr;
+   socklen_t addr_len;
+   unsigned count;
+   command_binary_range_t ranges[COMMAND_BINARY_MAX_RANGES];
+} command_binary_sub_t;
+
 typedef struct
 {
    /* Network socket FD */
@@ -187,8 +205,15 @@ typedef struct
    struct sockaddr_storage cmd_source;
    /* Size of the previous structure in use */
    socklen_t cmd_source_len;
+   /* Binary replies are built here, allocated on the first one */
+   uint8_t *binary_buf;
+   command_binary_sub_t subs[COMMAND_BINARY_MAX_SUBSCRIBERS];
 } command_network_t;
 
+static void command_network_binary(command_network_t *netcmd,
+      const uint8_t *buf, size_t len);
+static void command_network_binary_push(command_network_t *netcmd);
+
 static void network_command_reply(command_t *cmd,
    const char *s, size_t len)
 {
@@ -205,6 +230,7 @@ static void network_command_free(command_t *handle)
    if (netcmd->net_fd >= 0)
       socket_close(netcmd->net_fd);
 
+   free(netcmd->binary_buf);
    free(netcmd);
    free(handle);
 }
@@ -225,12 +251,21 @@ static void command_network_poll(command_t *handle)
       if ((ret = recvfrom(netcmd->net_fd, buf, sizeof(buf) - 1, 0,
                   (struct sockaddr*)&netcmd->cmd_source,
                   &netcmd->cmd_source_len)) <= 0)
-         return;
+         break;
+
+      if (     ret >= COMMAND_BINARY_MAGIC_LEN
+            && !memcmp(buf, COMMAND_BINARY_MAGIC, COMMAND_BINARY_MAGIC_LEN))
+      {
+         command_network_binary(netcmd, (const uint8_t*)buf, (size_t)ret);
+         continue;
+      }
 
       buf[ret] = '\0';
 
       command_parse_msg(handle, buf);
    }
+
+   command_network_binary_push(netcmd);
 }
 
 command_t* command_network_new(uint16_t port)
@@ -845,6 +880,36 @@ bool command_seek_replay(command_t *cmd, const char *arg)
 #endif
 }
 
+bool command_rewind_seconds(command_t *cmd, const char *arg)
+{
+#ifdef HAVE_REWIND
+   char reply[32];
+   size_t _len;
+   runloop_state_t *runloop_st    = runloop_state_get_ptr();
+   video_driver_state_t *video_st = video_state_get_ptr();
+   unsigned granularity           = config_get_ptr()->uints.rewind_granularity;
+   double seconds                 = strtod(arg, NULL);
+   double entries                 = seconds * video_st->av_info.timing.fps
+      / (granularity ? granularity : 1);
+   bool ret                       = entries >= 1.0;
+#ifdef HAVE_CHEEVOS
+   if (rcheevos_hardcore_active())
+      ret = false;
+#endif
+   if (ret)
+      ret = state_manager_rewind_seek(&runloop_st->rewind_st,
+            entries > (double)UINT_MAX ? UINT_MAX : (unsigned)entries);
+   _len = strlcpy(reply, ret ? "OK" : "NO", sizeof(reply));
+   reply[_len] = '\n';
+   reply[++_len] = '\0';
+   cmd->replier(cmd, reply, _len);
+   return ret;
+#else
+   cmd->replier(cmd, "NO\n", 4);
+   return false;
+#endif
+}
+
 bool command_save_savefiles(command_t *cmd, const char* arg)
 {
    char reply[4];
@@ -953,6 +1018,17 @@ bool command_load_core(command_t *cmd, const char* arg)
    return true;
 }
 
+#ifdef HAVE_CHD
+/* Replies once the verification is queued; the result is logged
+ * and shown as the task's message */
+bool command_verify_chd(command_t *cmd, const char* arg)
+{
+   bool ret = task_push_chd_verify(arg, NULL, NULL);
+   cmd->replier(cmd, ret ? "OK\n" : "NO\n", 4);
+   return ret;
+}
+#endif
+
 static const rarch_memory_descriptor_t* command_memory_get_descriptor(const rarch_memory_map_t* mmap, unsigned address, size_t* offset)
 {
    const rarch_memory_descriptor_t* desc = mmap->descriptors;
@@ -1071,6 +1147,81 @@ bool command_get_status(command_t *cmd, const char* arg)
    return true;
 }
 
+/* Replies with the performance counters and, during a GGPO session with
+ * its stats shown, the session's network and state numbers. Counters
+ * only run with perfcnt enabled (--perfcnt). */
+bool command_get_perf_counters(command_t *cmd, const char* arg)
+{
+   size_t _len;
+   char *reply;
+   const size_t reply_size     = 16384;
+   runloop_state_t *runloop_st = runloop_state_get_ptr();
+#ifdef HAVE_NETWORKING
+   net_driver_state_t *net_st  = networking_state_get_ptr();
+#endif
+
+   if (!runloop_st->perfcnt_enable)
+   {
+      static const char disabled[] = "GET_PERF_COUNTERS DISABLED\n";
+      cmd->replier(cmd, disabled, STRLEN_CONST(disabled));
+      return true;
+   }
+
+   if (!(reply = (char*)malloc(reply_size)))
+      return false;
+
+   _len  = strlcpy(reply, "GET_PERF_COUNTERS\n", reply_size);
+   _len += runloop_perf_window_format(reply + _len, reply_size - _len);
+#ifdef HAVE_NETWORKING
+   if (net_st->ggpo_stats_valid && _len < reply_size)
+   {
+      int n = snprintf(reply + _len, reply_size - _len,
+            "ggpo ping_us=%d kbps_sent=%d frames_behind=%d"
+            " rollback_frames=%u latch_us=%u"
+            " state_size=%u state_save_us=%u state_load_us=%u\n",
+            net_st->ggpo_stats_ping_us,
+            net_st->ggpo_stats_kbps_sent,
+            net_st->ggpo_stats_local_frames_behind,
+            (unsigned)net_st->ggpo_stats_rollback_frames,
+            (unsigned)net_st->ggpo_stats_latch_us,
+            (unsigned)net_st->ggpo_state_size,
+            (unsigned)net_st->ggpo_state_save_avg_us,
+            (unsigned)net_st->ggpo_state_load_avg_us);
+      if (n > 0)
+         _len = MIN(_len + (size_t)n, reply_size - 1);
+   }
+   if (net_st->data && _len < reply_size)
+   {
+      int n = snprintf(reply + _len, reply_size - _len,
+            "netplay merge_us=%u merge_max_us=%u\n",
+            (unsigned)net_st->merge_us_avg,
+            (unsigned)net_st->merge_us_max);
+      if (n > 0)
+         _len = MIN(_len + (size_t)n, reply_size - 1);
+   }
+#endif
+#ifdef HAVE_THREADS
+   {
+      unsigned i;
+      const char *role;
+      int64_t usec;
+      /* CPU time per thread role, so the pinning can be checked */
+      for (i = 0; _len < reply_size
+            && sthread_role_get_cpu_time(i, &role, &usec); i++)
+      {
+         int n = snprintf(reply + _len, reply_size - _len,
+               "thread %s cpu_ms=%lld\n", role, (long long)(usec / 1000));
+         if (n > 0)
+            _len = MIN(_len + (size_t)n, reply_size - 1);
+      }
+   }
+#endif
+
+   cmd->replier(cmd, reply, _len);
+   free(reply);
+   return true;
+}
+
 bool command_read_memory(command_t *cmd, const char *arg)
 {
    unsigned i;
@@ -1151,6 +1302,152 @@ bool command_write_memory(command_t *cmd, const char *arg)
    cmd->replier(cmd, reply, strlen(reply));
    return true;
 }
+
+#if defined(HAVE_NETWORK_CMD)
+static size_t command_binary_reply(uint8_t *out, uint8_t op,
+      const command_binary_range_t *ranges, unsigned count)
+{
+   unsigned i;
+   runloop_state_t *runloop_st         = runloop_state_get_ptr();
+   const rarch_system_info_t *sys_info = &runloop_st->system;
+   uint32_t frame                      = (uint32_t)
+      video_state_get_ptr()->frame_count;
+   size_t _len                         = COMMAND_BINARY_MAGIC_LEN;
+
+   memcpy(out, COMMAND_BINARY_MAGIC, COMMAND_BINARY_MAGIC_LEN);
+   out[_len++] = op;
+   out[_len++] = 0;
+   out[_len++] = (uint8_t)(frame);
+   out[_len++] = (uint8_t)(frame >>  8);
+   out[_len++] = (uint8_t)(frame >> 16);
+   out[_len++] = (uint8_t)(frame >> 24);
+
+   for (i = 0; i < count && _len + 2 <= COMMAND_BINARY_MAX_REPLY; i++)
+   {
+      char error[64];
+      unsigned int max_bytes = 0;
+      size_t length          = 0;
+      uint8_t *data          = command_memory_get_pointer(sys_info,
+            ranges[i].address, &max_bytes, 0, error, sizeof(error));
+
+      if (data)
+      {
+         length = MIN(MIN((size_t)ranges[i].length, (size_t)max_bytes),
+               COMMAND_BINARY_MAX_REPLY - _len - 2);
+         memcpy(out + _len + 2, data, length);
+      }
+
+      out[_len]     = (uint8_t)(length);
+      out[_len + 1] = (uint8_t)(length >> 8);
+      _len         += 2 + length;
+   }
+
+   /* Ranges past a full reply are left out */
+   out[COMMAND_BINARY_MAGIC_LEN + 1] = (uint8_t)i;
+   return _len;
+}
+
+static void command_network_binary_send(command_network_t *netcmd,
+      const struct sockaddr_storage *addr, socklen_t addr_len,
+      uint8_t op, const command_binary_range_t *ranges, unsigned count)
+{
+   size_t _len;
+
+   if (!netcmd->binary_buf && !(netcmd->binary_buf =
+            (uint8_t*)malloc(COMMAND_BINARY_MAX_REPLY)))
+      return;
+
+   _len = command_binary_reply(netcmd->binary_buf, op, ranges, count);
+   sendto(netcmd->net_fd, (const char*)netcmd->binary_buf, _len, 0,
+         (const struct sockaddr*)addr, addr_len);
+}
+
+static void command_network_binary(command_network_t *netcmd,
+      const uint8_t *buf, size_t len)
+{
+   unsigned i;
+   unsigned count;
+   uint8_t op;
+   command_binary_range_t ranges[COMMAND_BINARY_MAX_RANGES];
+   command_binary_sub_t *sub      = NULL;
+   command_binary_sub_t *free_sub = NULL;
+
+   if (len < COMMAND_BINARY_MAGIC_LEN + 2)
+      return;
+
+   op    = buf[COMMAND_BINARY_MAGIC_LEN];
+   count = buf[COMMAND_BINARY_MAGIC_LEN + 1];
+   buf  += COMMAND_BINARY_MAGIC_LEN + 2;
+   len  -= COMMAND_BINARY_MAGIC_LEN + 2;
+
+   if (count > COMMAND_BINARY_MAX_RANGES || len < count * 6)
+   {
+      RARCH_WARN("[NetCMD] Malformed binary command.\n");
+      return;
+   }
+
+   for (i = 0; i < count; i++, buf += 6)
+   {
+      ranges[i].address = (uint32_t)buf[0]       | ((uint32_t)buf[1] << 8)
+                       | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+      ranges[i].length  = (uint16_t)(buf[4] | (buf[5] << 8));
+   }
+
+   if (op == COMMAND_BINARY_READ)
+   {
+      command_network_binary_send(netcmd, &netcmd->cmd_source,
+            netcmd->cmd_source_len, op, ranges, count);
+      return;
+   }
+
+   for (i = 0; i < COMMAND_BINARY_MAX_SUBSCRIBERS; i++)
+   {
+      command_binary_sub_t *s = &netcmd->subs[i];
+      if (!s->count)
+      {
+         if (!free_sub)
+            free_sub = s;
+      }
+      else if (   s->addr_len == netcmd->cmd_source_len
+               && !memcmp(&s->addr, &netcmd->cmd_source, s->addr_len))
+         sub = s;
+   }
+
+   switch (op)
+   {
+      case COMMAND_BINARY_SUBSCRIBE:
+         if (!sub && !(sub = free_sub))
+         {
+            RARCH_WARN("[NetCMD] Too many binary subscribers.\n");
+            return;
+         }
+         memcpy(&sub->addr, &netcmd->cmd_source, netcmd->cmd_source_len);
+         sub->addr_len = netcmd->cmd_source_len;
+         sub->count    = count;
+         memcpy(sub->ranges, ranges, count * sizeof(ranges[0]));
+         break;
+      case COMMAND_BINARY_UNSUBSCRIBE:
+         if (sub)
+            sub->count = 0;
+         break;
+      default:
+         RARCH_WARN("[NetCMD] Unknown binary command %u.\n", (unsigned)op);
+         break;
+   }
+}
+
+static void command_network_binary_push(command_network_t *netcmd)
+{
+   unsigned i;
+   for (i = 0; i < COMMAND_BINARY_MAX_SUBSCRIBERS; i++)
+   {
+      command_binary_sub_t *sub = &netcmd->subs[i];
+      if (sub->count)
+         command_network_binary_send(netcmd, &sub->addr, sub->addr_len,
+               COMMAND_BINARY_SUBSCRIBE, sub->ranges, sub->count);
+   }
+}
+#endif
 #endif
 
 void command_event_set_volume(
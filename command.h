@@ -283,7 +283,9 @@ enum event_command
    CMD_EVENT_MICROPHONE_REINIT,
 #endif
    /* Add a playlist entry to another playlist. */
-   CMD_EVENT_ADD_TO_PLAYLIST
+   CMD_EVENT_ADD_TO_PLAYLIST,
+   /* Measures input-to-present latency. */
+   CMD_EVENT_LATENCY_TEST
 };
 
 enum cmd_source_t
@@ -341,6 +343,34 @@ bool command_event(enum event_command action, void *data);
 
 /* Constructors for the supported drivers */
 #ifdef HAVE_NETWORK_CMD
+/* Binary network commands, for clients reading memory every frame.
+ * A datagram starting with COMMAND_BINARY_MAGIC is one request rather
+ * than text; integers are little-endian:
+ *
+ *   magic[4] op:u8 count:u8 { address:u32 length:u16 } * count
+ *
+ * READ replies once, SUBSCRIBE replies on every input poll until
+ * UNSUBSCRIBE (count 0) or until another SUBSCRIBE from the same
+ * address replaces the ranges. A reply is
+ *
+ *   magic[4] op:u8 count:u8 frame:u32 { length:u16 data[length] } * count
+ *
+ * where frame is the video frame count, and length is 0 for a range
+ * with no memory map behind it and shortened to fit the map and
+ * COMMAND_BINARY_MAX_REPLY. */
+#define COMMAND_BINARY_MAGIC           "RACB"
+#define COMMAND_BINARY_MAGIC_LEN       4
+#define COMMAND_BINARY_MAX_RANGES      64
+#define COMMAND_BINARY_MAX_SUBSCRIBERS 4
+#define COMMAND_BINARY_MAX_REPLY       65000
+
+enum command_binary_op
+{
+   COMMAND_BINARY_READ = 1,
+   COMMAND_BINARY_SUBSCRIBE,
+   COMMAND_BINARY_UNSUBSCRIBE
+};
+
 command_t* command_network_new(uint16_t port);
 bool command_network_send(const char *cmd_);
 #endif
@@ -424,11 +454,13 @@ struct cmd_action_map
 
 bool command_version(command_t *cmd, const char* arg);
 bool command_get_status(command_t *cmd, const char* arg);
+bool command_get_perf_counters(command_t *cmd, const char* arg);
 bool command_get_config_param(command_t *cmd, const char* arg);
 bool command_show_osd_msg(command_t *cmd, const char* arg);
 bool command_load_state_slot(command_t *cmd, const char* arg);
 bool command_play_replay_slot(command_t *cmd, const char* arg);
 bool command_seek_replay(command_t *cmd, const char *arg);
+bool command_rewind_seconds(command_t *cmd, const char *arg);
 bool command_save_savefiles(command_t *cmd, const char* arg);
 bool command_load_savefiles(command_t *cmd, const char* arg);
 #ifdef HAVE_CHEEVOS
@@ -438,6 +470,9 @@ bool command_write_ram(command_t *cmd, const char *arg);
 bool command_read_memory(command_t *cmd, const char *arg);
 bool command_write_memory(command_t *cmd, const char *arg);
 bool command_load_core(command_t *cmd, const char* arg);
+#ifdef HAVE_CHD
+bool command_verify_chd(command_t *cmd, const char* arg);
+#endif
 
 static const struct cmd_action_map action_map[] = {
 #if defined(HAVE_CG) || defined(HAVE_GLSL) || defined(HAVE_SLANG) || defined(HAVE_HLSL)
@@ -445,6 +480,7 @@ static const struct cmd_action_map action_map[] = {
 #endif
    { "VERSION",          command_version,          "No argument"},
    { "GET_STATUS",       command_get_status,       "No argument" },
+   { "GET_PERF_COUNTERS",command_get_perf_counters,"No argument" },
    { "GET_CONFIG_PARAM", command_get_config_param, "<param name>" },
    { "SHOW_MSG",         command_show_osd_msg,     "No argument" },
 #if defined(HAVE_CHEEVOS)
@@ -459,11 +495,15 @@ static const struct cmd_action_map action_map[] = {
    { "LOAD_STATE_SLOT",command_load_state_slot, "<slot number>"},
    { "PLAY_REPLAY_SLOT",command_play_replay_slot, "<slot number>"},
    { "SEEK_REPLAY",command_seek_replay, "<frame number>"},
+   { "REWIND_SECONDS",command_rewind_seconds, "<seconds>"},
 
    { "SAVE_FILES", command_save_savefiles, "No argument"},
    { "LOAD_FILES", command_load_savefiles, "No argument"},
 
    { "LOAD_CORE", command_load_core, "<core path>"},
+#ifdef HAVE_CHD
+   { "VERIFY_CHD", command_verify_chd, "<chd path>"},
+#endif
 };
 
 static const struct cmd_map map[] = {
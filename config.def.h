@@ -185,6 +185,11 @@
 
 #define DEFAULT_DRIVER_SWITCH_ENABLE true
 
+/* Keep the video and audio drivers running across a content
+ * switch when the next core draws the same way, and preload
+ * the highlighted playlist entry while browsing. */
+#define DEFAULT_CONTENT_SWITCH_SEAMLESS false
+
 #define DEFAULT_USER_LANGUAGE 0
 
 #define DEFAULT_GAMEMODE_ENABLE true
@@ -344,6 +349,11 @@
  * load times on platforms with slow IO */
 #define DEFAULT_CORE_INFO_CACHE_ENABLE true
 
+/* Specifies whether to keep soft-patched
+ * content in the cache directory, so that
+ * later loads skip applying the patches */
+#define DEFAULT_CONTENT_PATCH_CACHE_ENABLE false
+
 /* Specifies whether to ignore core info
  * savestate capabilities, allowing to
  * experiment with related features
@@ -390,6 +400,11 @@
  * Can reduce latency at cost of performance. */
 #define DEFAULT_HARD_SYNC false
 
+/* KMS only: hands software frames straight to an overlay
+ * plane, scaled by the display controller, whenever nothing
+ * would be drawn over or around them. */
+#define DEFAULT_VIDEO_KMS_DIRECT_SCANOUT false
+
 /* Configures how many frames the GPU can run ahead of CPU.
  * 0: Syncs to GPU immediately.
  * 1: Syncs to previous frame.
@@ -456,6 +471,10 @@
 #define DEFAULT_THREADED_DATA_RUNLOOP_ENABLE false
 #endif
 
+/* Task workers besides the latency one; 0 picks two fewer
+ * than the CPU has cores */
+#define DEFAULT_THREADED_DATA_RUNLOOP_WORKERS 0
+
 /* Set to true if HW render cores should get their private context. */
 #define DEFAULT_VIDEO_SHARED_CONTEXT false
 
@@ -979,6 +998,8 @@
 
 #define DEFAULT_LOG_TO_FILE_TIMESTAMP false
 
+#define DEFAULT_FRAME_TIMELINE_ENABLE false
+
 /* Crop overscanned frames. */
 #define DEFAULT_CROP_OVERSCAN true
 
@@ -1020,6 +1041,10 @@
  * when selecting shader presets/passes via the menu */
 #define DEFAULT_VIDEO_SHADER_REMEMBER_LAST_DIR false
 
+/* Keep the SPIR-V of compiled slang shaders, and the
+ * Vulkan pipeline cache, in the cache directory */
+#define DEFAULT_VIDEO_SHADER_CACHE_ENABLE true
+
 /* Screenshots named automatically. */
 #define DEFAULT_AUTO_SCREENSHOT_FILENAME true
 
@@ -1304,6 +1329,10 @@
 #define DEFAULT_REWIND_GRANULARITY 1
 #endif
 
+/* MB of older rewind history to keep in the cache directory, once
+ * the buffer in RAM is full. 0 disables it. */
+#define DEFAULT_REWIND_DISK_BUFFER_SIZE 0
+
 /* Pause gameplay when window loses focus. */
 #define DEFAULT_PAUSE_NONACTIVE true
 
@@ -1394,9 +1423,18 @@
 #define DEFAULT_NETPLAY_GGPO_SEND_INTERVAL 0
 
 #define DEFAULT_NETPLAY_GGPO_MAX_INPUT_BITS 0
+#define DEFAULT_NETPLAY_GGPO_INPUT_FEC 0
+#define DEFAULT_NETPLAY_GGPO_DRIFT_CORRECTION 2
 
 #define DEFAULT_NETPLAY_GGPO_PREDICTION_FRAMES 0
 
+#define DEFAULT_NETPLAY_GGPO_KEYFRAME_INTERVAL 0
+#define DEFAULT_NETPLAY_GGPO_CHECKSUM_INTERVAL 1
+#define DEFAULT_NETPLAY_GGPO_REPLAY_CROSSFADE false
+/* Core frames of GGPO audio held back for rollbacks to correct */
+#define DEFAULT_NETPLAY_GGPO_AUDIO_SPLICE_FRAMES 0
+#define DEFAULT_NETPLAY_GGPO_NETWORK_THREAD false
+
 #ifdef HAVE_NETWORKING
 #define DEFAULT_NETPLAY_MAX_CONNECTIONS 3
 #define DEFAULT_NETPLAY_MAX_PING 0
@@ -1447,6 +1485,9 @@
  * deterministic but in some cores produces janky results depending on
  * when inputs are processed. */
 #define DEFAULT_REPLAY_CHECKPOINT_DESERIALIZE true
+/* Specifies whether a recording replay file is flushed out every time
+ * a checkpoint is written, so a crash loses at most the frames since. */
+#define DEFAULT_REPLAY_CHECKPOINT_FLUSH false
 
 /* Automatically saves a savestate at the end of RetroArch's lifetime.
  * The path is $SRAM_PATH.auto.
@@ -1484,6 +1525,10 @@
 /* Skip frames when fast forwarding. */
 #define DEFAULT_FASTFORWARD_FRAMESKIP true
 
+/* Run several core frames per display refresh when fast forwarding,
+ * presenting and mixing only the last one. */
+#define DEFAULT_FASTFORWARD_FRAME_BATCH false
+
 /* Enable runloop for variable refresh rate screens. Force x1 speed while handling fast forward too. */
 #define DEFAULT_VRR_RUNLOOP_ENABLE false
 
@@ -1493,6 +1538,13 @@
 /* When using the Run Ahead feature, use a secondary instance of the core. */
 #define DEFAULT_RUN_AHEAD_SECONDARY_INSTANCE true
 
+/* Run the secondary instance's frame on its own thread while input is held. */
+#define DEFAULT_RUN_AHEAD_SECONDARY_THREAD false
+
+/* How Run Ahead and netplay rollback guess input they have not seen
+ * yet: 0 repeats the last input, 1 follows button hold patterns. */
+#define DEFAULT_INPUT_PREDICTOR 0
+
 /* Hide warning messages when using the Run Ahead feature. */
 #define DEFAULT_RUN_AHEAD_HIDE_WARNINGS false
 
@@ -1505,6 +1557,10 @@
 #define DEFAULT_NETWORK_BUILDBOT_AUTO_EXTRACT_ARCHIVE true
 #define DEFAULT_NETWORK_BUILDBOT_SHOW_EXPERIMENTAL_CORES false
 
+/* Downloads that may make progress at the same time
+ * when the data runloop is threaded */
+#define DEFAULT_NETWORK_HTTP_CONCURRENT_DOWNLOADS 2
+
 /* Automatically create a backup whenever a core is
  * updated via the online updater
  * > Enable by default on all modern platforms with
@@ -1686,6 +1742,8 @@
 #define DEFAULT_INPUT_BIND_HOLD 0
 #endif
 #define DEFAULT_INPUT_POLL_TYPE_BEHAVIOR 2
+/* Poll the joypad driver every millisecond on its own thread. */
+#define DEFAULT_INPUT_JOYPAD_THREAD false
 #define DEFAULT_INPUT_HOTKEY_BLOCK_DELAY 5
 #define DEFAULT_INPUT_HOTKEY_DEVICE_MERGE false
 #define DEFAULT_INPUT_HOTKEY_FOLLOWS_PLAYER1 false
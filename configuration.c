@@ -78,6 +78,10 @@
 #include <time.h>
 #endif
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 enum video_driver_enum
 {
    VIDEO_GL                 = 0,
@@ -891,6 +895,22 @@ struct defaults g_defaults;
 
 static settings_t *config_st = NULL;
 
+/* The typed settings as config_load_file() reads them, built
+ * on the first load. The binds only point into the settings,
+ * so stay valid for as long as the settings do. */
+static struct config_bind *config_load_binds     = NULL;
+static config_bind_table_t config_load_bind_table;
+static settings_t *config_load_binds_settings    = NULL;
+
+static void config_load_binds_free(void)
+{
+   if (config_load_binds)
+      config_bind_table_free(&config_load_bind_table);
+   free(config_load_binds);
+   config_load_binds          = NULL;
+   config_load_binds_settings = NULL;
+}
+
 settings_t *config_get_ptr(void)
 {
    return config_st;
@@ -1561,6 +1581,8 @@ static struct config_array_setting *populate_settings_array(
    SETTING_ARRAY("video_driver",                 settings->arrays.video_driver, false, NULL, true);
    SETTING_ARRAY("video_context_driver",         settings->arrays.video_context_driver, false, NULL, true);
    SETTING_ARRAY("crt_switch_timings",           settings->arrays.crt_switch_timings, false, NULL, true);
+   SETTING_ARRAY("thread_affinity",              settings->arrays.thread_affinity, false, NULL, true);
+   SETTING_ARRAY("thread_priority",              settings->arrays.thread_priority, false, NULL, true);
 
    SETTING_ARRAY("input_driver",                 settings->arrays.input_driver, false, NULL, true);
    SETTING_ARRAY("input_joypad_driver",          settings->arrays.input_joypad_driver, false, NULL, true);
@@ -1741,6 +1763,7 @@ static struct config_bool_setting *populate_settings_bool(
 
    SETTING_BOOL("accessibility_enable",          &settings->bools.accessibility_enable, true, DEFAULT_ACCESSIBILITY_ENABLE, false);
    SETTING_BOOL("driver_switch_enable",          &settings->bools.driver_switch_enable, true, DEFAULT_DRIVER_SWITCH_ENABLE, false);
+   SETTING_BOOL("content_switch_seamless",       &settings->bools.content_switch_seamless, true, DEFAULT_CONTENT_SWITCH_SEAMLESS, false);
    SETTING_BOOL("ui_companion_start_on_boot",    &settings->bools.ui_companion_start_on_boot, true, DEFAULT_UI_COMPANION_START_ON_BOOT, false);
    SETTING_BOOL("ui_companion_enable",           &settings->bools.ui_companion_enable, true, DEFAULT_UI_COMPANION_ENABLE, false);
    SETTING_BOOL("ui_companion_toggle",           &settings->bools.ui_companion_toggle, false, DEFAULT_UI_COMPANION_TOGGLE, false);
@@ -1756,6 +1779,7 @@ static struct config_bool_setting *populate_settings_bool(
 #else
    SETTING_BOOL("core_info_cache_enable",        &settings->bools.core_info_cache_enable, true, DEFAULT_CORE_INFO_CACHE_ENABLE, false);
 #endif
+   SETTING_BOOL("content_patch_cache_enable",    &settings->bools.content_patch_cache_enable, true, DEFAULT_CONTENT_PATCH_CACHE_ENABLE, false);
    SETTING_BOOL("core_set_supports_no_game_enable", &settings->bools.set_supports_no_game_enable, true, true, false);
    SETTING_BOOL("core_updater_auto_extract_archive", &settings->bools.network_buildbot_auto_extract_archive, true, DEFAULT_NETWORK_BUILDBOT_AUTO_EXTRACT_ARCHIVE, false);
    SETTING_BOOL("core_updater_show_experimental_cores", &settings->bools.network_buildbot_show_experimental_cores, true, DEFAULT_NETWORK_BUILDBOT_SHOW_EXPERIMENTAL_CORES, false);
@@ -1779,10 +1803,12 @@ static struct config_bool_setting *populate_settings_bool(
    SETTING_BOOL("apply_cheats_after_load",       &settings->bools.apply_cheats_after_load, true, DEFAULT_APPLY_CHEATS_AFTER_LOAD, false);
    SETTING_BOOL("rewind_enable",                 &settings->bools.rewind_enable, true, DEFAULT_REWIND_ENABLE, false);
    SETTING_BOOL("fastforward_frameskip",         &settings->bools.fastforward_frameskip, true, DEFAULT_FASTFORWARD_FRAMESKIP, false);
+   SETTING_BOOL("fastforward_frame_batch",       &settings->bools.fastforward_frame_batch, true, DEFAULT_FASTFORWARD_FRAME_BATCH, false);
    SETTING_BOOL("vrr_runloop_enable",            &settings->bools.vrr_runloop_enable, true, DEFAULT_VRR_RUNLOOP_ENABLE, false);
    SETTING_BOOL("menu_throttle_framerate",       &settings->bools.menu_throttle_framerate, true, true, false);
    SETTING_BOOL("run_ahead_enabled",             &settings->bools.run_ahead_enabled, true, false, false);
    SETTING_BOOL("run_ahead_secondary_instance",  &settings->bools.run_ahead_secondary_instance, true, DEFAULT_RUN_AHEAD_SECONDARY_INSTANCE, false);
+   SETTING_BOOL("run_ahead_secondary_thread",    &settings->bools.run_ahead_secondary_thread, true, DEFAULT_RUN_AHEAD_SECONDARY_THREAD, false);
    SETTING_BOOL("run_ahead_hide_warnings",       &settings->bools.run_ahead_hide_warnings, true, DEFAULT_RUN_AHEAD_HIDE_WARNINGS, false);
    SETTING_BOOL("preemptive_frames_enable",      &settings->bools.preemptive_frames_enable, true, false, false);
 #if HAVE_MENU
@@ -1836,6 +1862,7 @@ static struct config_bool_setting *populate_settings_bool(
 #endif
    SETTING_BOOL("log_to_file",                   &settings->bools.log_to_file, true, DEFAULT_LOG_TO_FILE, false);
    SETTING_OVERRIDE(RARCH_OVERRIDE_SETTING_LOG_TO_FILE);
+   SETTING_BOOL("frame_timeline_enable",         &settings->bools.frame_timeline_enable, true, DEFAULT_FRAME_TIMELINE_ENABLE, false);
    SETTING_BOOL("log_to_file_timestamp",         &settings->bools.log_to_file_timestamp, true, DEFAULT_LOG_TO_FILE_TIMESTAMP, false);
    SETTING_BOOL("ai_service_enable",             &settings->bools.ai_service_enable, true, DEFAULT_AI_SERVICE_ENABLE, false);
    SETTING_BOOL("ai_service_pause",              &settings->bools.ai_service_pause, true, DEFAULT_AI_SERVICE_PAUSE, false);
@@ -1886,6 +1913,7 @@ static struct config_bool_setting *populate_settings_bool(
    SETTING_BOOL("video_shader_enable",           &settings->bools.video_shader_enable, true, DEFAULT_SHADER_ENABLE, false);
    SETTING_BOOL("video_shader_watch_files",      &settings->bools.video_shader_watch_files, true, DEFAULT_VIDEO_SHADER_WATCH_FILES, false);
    SETTING_BOOL("video_shader_remember_last_dir", &settings->bools.video_shader_remember_last_dir, true, DEFAULT_VIDEO_SHADER_REMEMBER_LAST_DIR, false);
+   SETTING_BOOL("video_shader_cache_enable",      &settings->bools.video_shader_cache_enable, true, DEFAULT_VIDEO_SHADER_CACHE_ENABLE, false);
    SETTING_BOOL("video_shader_preset_save_reference_enable", &settings->bools.video_shader_preset_save_reference_enable, true, DEFAULT_VIDEO_SHADER_PRESET_SAVE_REFERENCE_ENABLE, false);
 
    /* Let implementation decide if automatic, or 1:1 PAR. */
@@ -1917,6 +1945,7 @@ static struct config_bool_setting *populate_settings_bool(
    SETTING_BOOL("video_vsync",                   &settings->bools.video_vsync, true, DEFAULT_VSYNC, false);
    SETTING_BOOL("video_adaptive_vsync",          &settings->bools.video_adaptive_vsync, true, DEFAULT_ADAPTIVE_VSYNC, false);
    SETTING_BOOL("video_hard_sync",               &settings->bools.video_hard_sync, true, DEFAULT_HARD_SYNC, false);
+   SETTING_BOOL("video_kms_direct_scanout",      &settings->bools.video_kms_direct_scanout, true, DEFAULT_VIDEO_KMS_DIRECT_SCANOUT, false);
    SETTING_BOOL("video_waitable_swapchains",     &settings->bools.video_waitable_swapchains, true, DEFAULT_WAITABLE_SWAPCHAINS, false);
    SETTING_BOOL("video_disable_composition",     &settings->bools.video_disable_composition, true, DEFAULT_DISABLE_COMPOSITION, false);
    SETTING_BOOL("video_gpu_screenshot",          &settings->bools.video_gpu_screenshot, true, DEFAULT_GPU_SCREENSHOT, false);
@@ -2135,6 +2164,7 @@ static struct config_bool_setting *populate_settings_bool(
    SETTING_BOOL("cheevos_auto_screenshot",       &settings->bools.cheevos_auto_screenshot, true, false, false);
    SETTING_BOOL("cheevos_badges_enable",         &settings->bools.cheevos_badges_enable, true, false, false);
    SETTING_BOOL("cheevos_start_active",          &settings->bools.cheevos_start_active, true, false, false);
+   SETTING_BOOL("cheevos_threaded",              &settings->bools.cheevos_threaded, true, false, false);
    SETTING_BOOL("cheevos_appearance_padding_auto", &settings->bools.cheevos_appearance_padding_auto, true, DEFAULT_CHEEVOS_APPEARANCE_PADDING_AUTO, false);
    SETTING_BOOL("cheevos_visibility_unlock",     &settings->bools.cheevos_visibility_unlock, true, DEFAULT_CHEEVOS_VISIBILITY_UNLOCK, false);
    SETTING_BOOL("cheevos_visibility_mastery",    &settings->bools.cheevos_visibility_mastery, true, DEFAULT_CHEEVOS_VISIBILITY_MASTERY, false);
@@ -2195,6 +2225,9 @@ static struct config_bool_setting *populate_settings_bool(
    SETTING_BOOL("input_nowinkey_enable",         &settings->bools.input_nowinkey_enable, true, false, false);
 #endif
    SETTING_BOOL("input_sensors_enable",          &settings->bools.input_sensors_enable, true, DEFAULT_INPUT_SENSORS_ENABLE, false);
+#ifdef HAVE_THREADS
+   SETTING_BOOL("input_joypad_thread",           &settings->bools.input_joypad_thread, true, DEFAULT_INPUT_JOYPAD_THREAD, false);
+#endif
    SETTING_BOOL("vibrate_on_keypress",           &settings->bools.vibrate_on_keypress, true, DEFAULT_VIBRATE_ON_KEYPRESS, false);
    SETTING_BOOL("enable_device_vibration",       &settings->bools.enable_device_vibration, true, DEFAULT_ENABLE_DEVICE_VIBRATION, false);
    SETTING_BOOL("sustained_performance_mode",    &settings->bools.sustained_performance_mode, true, DEFAULT_SUSTAINED_PERFORMANCE_MODE, false);
@@ -2256,6 +2289,8 @@ static struct config_bool_setting *populate_settings_bool(
    SETTING_BOOL("netplay_request_device_p16",    &settings->bools.netplay_request_devices[15], true, false, false);
    SETTING_BOOL("netplay_ping_show",             &settings->bools.netplay_ping_show, true, DEFAULT_NETPLAY_PING_SHOW, false);
    SETTING_BOOL("netplay_ggpo_stats_show",       &settings->bools.netplay_ggpo_stats_show, true, DEFAULT_NETPLAY_GGPO_STATS_SHOW, false);
+   SETTING_BOOL("netplay_ggpo_replay_crossfade", &settings->bools.netplay_ggpo_replay_crossfade, true, DEFAULT_NETPLAY_GGPO_REPLAY_CROSSFADE, false);
+   SETTING_BOOL("netplay_ggpo_network_thread",   &settings->bools.netplay_ggpo_network_thread, true, DEFAULT_NETPLAY_GGPO_NETWORK_THREAD, false);
    SETTING_BOOL("network_on_demand_thumbnails",  &settings->bools.network_on_demand_thumbnails, true, DEFAULT_NETWORK_ON_DEMAND_THUMBNAILS, false);
 #ifdef HAVE_NETWORKGAMEPAD
    SETTING_BOOL("network_remote_enable",         &settings->bools.network_remote_enable, false, false /* TODO */, false);
@@ -2263,6 +2298,7 @@ static struct config_bool_setting *populate_settings_bool(
 #endif
 #ifdef HAVE_BSV_MOVIE
    SETTING_BOOL("replay_checkpoint_deserialize", &settings->bools.replay_checkpoint_deserialize,  true, DEFAULT_REPLAY_CHECKPOINT_DESERIALIZE, false);
+   SETTING_BOOL("replay_checkpoint_flush", &settings->bools.replay_checkpoint_flush,  true, DEFAULT_REPLAY_CHECKPOINT_FLUSH, false);
 #endif
 
 #ifdef ANDROID
@@ -2410,11 +2446,17 @@ static struct config_uint_setting *populate_settings_uint(
    SETTING_UINT("libretro_log_level",            &settings->uints.libretro_log_level, true, DEFAULT_LIBRETRO_LOG_LEVEL, false);
    SETTING_UINT("fps_update_interval",           &settings->uints.fps_update_interval, true, DEFAULT_FPS_UPDATE_INTERVAL, false);
    SETTING_UINT("memory_update_interval",        &settings->uints.memory_update_interval, true, DEFAULT_MEMORY_UPDATE_INTERVAL, false);
+#ifdef HAVE_THREADS
+   SETTING_UINT("threaded_data_runloop_workers", &settings->uints.threaded_data_runloop_workers, true, DEFAULT_THREADED_DATA_RUNLOOP_WORKERS, false);
+#endif
    SETTING_UINT("core_updater_auto_backup_history_size", &settings->uints.core_updater_auto_backup_history_size, true, DEFAULT_CORE_UPDATER_AUTO_BACKUP_HISTORY_SIZE, false);
+   SETTING_UINT("network_http_concurrent_downloads", &settings->uints.network_http_concurrent_downloads, true, DEFAULT_NETWORK_HTTP_CONCURRENT_DOWNLOADS, false);
    SETTING_UINT("autosave_interval",             &settings->uints.autosave_interval,  true, DEFAULT_AUTOSAVE_INTERVAL, false);
    SETTING_UINT("rewind_granularity",            &settings->uints.rewind_granularity, true, DEFAULT_REWIND_GRANULARITY, false);
    SETTING_UINT("rewind_buffer_size_step",       &settings->uints.rewind_buffer_size_step, true, DEFAULT_REWIND_BUFFER_SIZE_STEP, false);
+   SETTING_UINT("rewind_disk_buffer_size",       &settings->uints.rewind_disk_buffer_size, true, DEFAULT_REWIND_DISK_BUFFER_SIZE, false);
    SETTING_UINT("run_ahead_frames",              &settings->uints.run_ahead_frames, true, 1,  false);
+   SETTING_UINT("input_predictor",               &settings->uints.input_predictor, true, DEFAULT_INPUT_PREDICTOR, false);
    SETTING_UINT("replay_max_keep",               &settings->uints.replay_max_keep, true, DEFAULT_REPLAY_MAX_KEEP, false);
    SETTING_UINT("replay_checkpoint_interval",    &settings->uints.replay_checkpoint_interval,  true, DEFAULT_REPLAY_CHECKPOINT_INTERVAL, false);
    SETTING_UINT("savestate_max_keep",            &settings->uints.savestate_max_keep, true, DEFAULT_SAVESTATE_MAX_KEEP, false);
@@ -2623,7 +2665,12 @@ static struct config_uint_setting *populate_settings_uint(
    SETTING_UINT("netplay_ggpo_oop_percent",           &settings->uints.netplay_ggpo_oop_percent, true, DEFAULT_NETPLAY_GGPO_OOP_PERCENT, false);
    SETTING_UINT("netplay_ggpo_send_interval",         &settings->uints.netplay_ggpo_send_interval, true, DEFAULT_NETPLAY_GGPO_SEND_INTERVAL, false);
    SETTING_UINT("netplay_ggpo_max_input_bits",        &settings->uints.netplay_ggpo_max_input_bits, true, DEFAULT_NETPLAY_GGPO_MAX_INPUT_BITS, false);
+   SETTING_UINT("netplay_ggpo_input_fec",             &settings->uints.netplay_ggpo_input_fec, true, DEFAULT_NETPLAY_GGPO_INPUT_FEC, false);
+   SETTING_UINT("netplay_ggpo_drift_correction",      &settings->uints.netplay_ggpo_drift_correction, true, DEFAULT_NETPLAY_GGPO_DRIFT_CORRECTION, false);
    SETTING_UINT("netplay_ggpo_prediction_frames",     &settings->uints.netplay_ggpo_prediction_frames, true, DEFAULT_NETPLAY_GGPO_PREDICTION_FRAMES, false);
+   SETTING_UINT("netplay_ggpo_keyframe_interval",     &settings->uints.netplay_ggpo_keyframe_interval, true, DEFAULT_NETPLAY_GGPO_KEYFRAME_INTERVAL, false);
+   SETTING_UINT("netplay_ggpo_checksum_interval",     &settings->uints.netplay_ggpo_checksum_interval, true, DEFAULT_NETPLAY_GGPO_CHECKSUM_INTERVAL, false);
+   SETTING_UINT("netplay_ggpo_audio_splice_frames",   &settings->uints.netplay_ggpo_audio_splice_frames, true, DEFAULT_NETPLAY_GGPO_AUDIO_SPLICE_FRAMES, false);
    SETTING_UINT("netplay_share_digital",              &settings->uints.netplay_share_digital, true, DEFAULT_NETPLAY_SHARE_DIGITAL, false);
    SETTING_UINT("netplay_share_analog",               &settings->uints.netplay_share_analog,  true, DEFAULT_NETPLAY_SHARE_ANALOG, false);
 #endif
@@ -3788,6 +3835,190 @@ static void check_verbosity_settings(config_file_t *conf,
    }
 }
 
+static bool config_load_binds_init(settings_t *settings,
+      const struct config_bool_setting *bool_settings, int bool_settings_size,
+      const struct config_int_setting *int_settings, int int_settings_size,
+      const struct config_uint_setting *uint_settings, int uint_settings_size,
+      const struct config_size_setting *size_settings, int size_settings_size,
+      const struct config_float_setting *float_settings, int float_settings_size,
+      const struct config_array_setting *array_settings, int array_settings_size)
+{
+   int i;
+   size_t count = 0;
+
+   if (config_load_binds && config_load_binds_settings == settings)
+      return true;
+
+   config_load_binds_free();
+
+   if (!(config_load_binds = (struct config_bind*)malloc(
+         (bool_settings_size + int_settings_size + uint_settings_size
+          + size_settings_size + float_settings_size + array_settings_size
+          + 1) * sizeof(*config_load_binds))))
+      return false;
+
+#define CONFIG_LOAD_BIND(_settings, _size, _type) \
+   for (i = 0; i < (_size); i++) \
+   { \
+      config_load_binds[count].key  = (_settings)[i].ident; \
+      config_load_binds[count].ptr  = (_settings)[i].ptr; \
+      config_load_binds[count].len  = 0; \
+      config_load_binds[count].type = (_type); \
+      count++; \
+   }
+
+   CONFIG_LOAD_BIND(bool_settings,  bool_settings_size,  CONFIG_BIND_BOOL);
+   CONFIG_LOAD_BIND(int_settings,   int_settings_size,   CONFIG_BIND_INT);
+   CONFIG_LOAD_BIND(uint_settings,  uint_settings_size,  CONFIG_BIND_UINT);
+   CONFIG_LOAD_BIND(size_settings,  size_settings_size,  CONFIG_BIND_SIZE);
+   CONFIG_LOAD_BIND(float_settings, float_settings_size, CONFIG_BIND_FLOAT);
+#undef CONFIG_LOAD_BIND
+
+   for (i = 0; i < array_settings_size; i++)
+   {
+      if (!(array_settings[i].flags & CFG_BOOL_FLG_HANDLE))
+         continue;
+      config_load_binds[count].key  = array_settings[i].ident;
+      config_load_binds[count].ptr  = array_settings[i].ptr;
+      config_load_binds[count].len  = PATH_MAX_LENGTH;
+      config_load_binds[count].type = CONFIG_BIND_ARRAY;
+      count++;
+   }
+
+   if (!config_bind_table_init(&config_load_bind_table,
+            config_load_binds, count))
+   {
+      free(config_load_binds);
+      config_load_binds = NULL;
+      return false;
+   }
+
+   config_load_binds_settings = settings;
+   return true;
+}
+
+#ifdef HAVE_THREADS
+#define CONFIG_THREAD_ROLES_MAX 16
+
+typedef struct config_thread_role
+{
+   uint64_t cpu_mask;
+   enum sthread_priority_class priority;
+   char name[24];
+} config_thread_role_t;
+
+/* "2-3,5" to a mask of CPUs 2, 3 and 5 */
+static uint64_t config_parse_cpu_list(const char *s)
+{
+   uint64_t mask = 0;
+
+   for (;;)
+   {
+      char *end;
+      unsigned long first = strtoul(s, &end, 10);
+      unsigned long last  = first;
+
+      if (end == s)
+         break;
+      if (*end == '-')
+      {
+         s    = end + 1;
+         last = strtoul(s, &end, 10);
+         if (end == s)
+            break;
+      }
+      for (; first <= last && first < 64; first++)
+         mask |= (uint64_t)1 << first;
+      if (*end != ',')
+         break;
+      s = end + 1;
+   }
+
+   return mask;
+}
+
+static enum sthread_priority_class config_parse_thread_priority(
+      const char *s)
+{
+   if (string_is_equal(s, "realtime"))
+      return STHREAD_PRIORITY_CLASS_REALTIME;
+   if (string_is_equal(s, "high"))
+      return STHREAD_PRIORITY_CLASS_HIGH;
+   if (string_is_equal(s, "background"))
+      return STHREAD_PRIORITY_CLASS_BACKGROUND;
+   return STHREAD_PRIORITY_CLASS_DEFAULT;
+}
+
+/**
+ * config_apply_thread_roles:
+ *
+ * Hands thread_affinity ("main=2 video=3 audio=4-5 ggpo_net=6,7") and
+ * thread_priority ("main=high audio=realtime tasks=background") to the
+ * rthreads role registry, then registers the calling (main) thread.
+ * Threads pick their role's profile up when they start, so changes
+ * apply to threads started afterwards.
+ **/
+static void config_apply_thread_roles(const settings_t *settings)
+{
+   config_thread_role_t roles[CONFIG_THREAD_ROLES_MAX];
+   unsigned count = 0;
+   unsigned pass, i;
+
+   if (!sthread_role_init())
+      return;
+
+   for (pass = 0; pass < 2; pass++)
+   {
+      const char *s = pass
+         ? settings->arrays.thread_priority
+         : settings->arrays.thread_affinity;
+
+      while (*s)
+      {
+         char entry[64];
+         char *value;
+         size_t len;
+
+         while (*s == ' ' || *s == ';')
+            s++;
+         for (len = 0; s[len] && s[len] != ' ' && s[len] != ';'; len++);
+         if (!len)
+            break;
+         strlcpy(entry, s, MIN(len + 1, sizeof(entry)));
+         s += len;
+
+         if (!(value = strchr(entry, '=')) || value == entry)
+            continue;
+         *value++ = '\0';
+
+         for (i = 0; i < count; i++)
+            if (string_is_equal(roles[i].name, entry))
+               break;
+         if (i == count)
+         {
+            if (count == CONFIG_THREAD_ROLES_MAX)
+               continue;
+            roles[count].cpu_mask = 0;
+            roles[count].priority = STHREAD_PRIORITY_CLASS_DEFAULT;
+            strlcpy(roles[count].name, entry, sizeof(roles[count].name));
+            count++;
+         }
+
+         if (pass)
+            roles[i].priority = config_parse_thread_priority(value);
+         else
+            roles[i].cpu_mask = config_parse_cpu_list(value);
+      }
+   }
+
+   for (i = 0; i < count; i++)
+      sthread_role_configure(roles[i].name, roles[i].cpu_mask,
+            roles[i].priority);
+
+   sthread_role_register("main");
+}
+#endif
+
 /**
  * config_load:
  * @path                : path to be read from.
@@ -3959,14 +4190,30 @@ static bool config_load_file(global_t *global,
    if (rarch_flags & RARCH_FLAGS_HAS_SET_USERNAME)
       override_username = strdup(settings->paths.username);
 
-   /* Boolean settings */
-
-   for (i = 0; i < (unsigned)bool_settings_size; i++)
-   {
-      bool tmp = false;
-      if (config_get_bool(conf, bool_settings[i].ident, &tmp))
-         *bool_settings[i].ptr = tmp;
-   }
+   /* Boolean, integer, size, float and array settings,
+    * in one pass over the file */
+   if (config_load_binds_init(settings,
+            bool_settings,  bool_settings_size,
+            int_settings,   int_settings_size,
+            uint_settings,  uint_settings_size,
+            size_settings,  size_settings_size,
+            float_settings, float_settings_size,
+            array_settings, array_settings_size))
+      config_bind_table_apply(&config_load_bind_table, conf);
+   else
+      RARCH_ERR("[Config] Failed to read settings: out of memory.\n");
+
+   /* Special case for rewind_buffer_size - need to convert
+    * low values to what they were
+    * intended to be based on the default value in config.def.h
+    * If the value is less than 10000 then multiple by 1MB because if
+    * the retroarch.cfg
+    * file contains rewind_buffer_size = "100",
+    * then that ultimately gets interpreted as
+    * 100MB, so ensure the internal values represent that.*/
+   if (settings->sizes.rewind_buffer_size < 10000)
+      settings->sizes.rewind_buffer_size =
+         settings->sizes.rewind_buffer_size * 1024 * 1024;
 
 #ifdef HAVE_NETWORKGAMEPAD
    {
@@ -3983,40 +4230,6 @@ static bool config_load_file(global_t *global,
    }
 #endif
 
-   /* Integer settings */
-
-   for (i = 0; i < (unsigned)int_settings_size; i++)
-   {
-      int tmp = 0;
-      if (config_get_int(conf, int_settings[i].ident, &tmp))
-         *int_settings[i].ptr = tmp;
-   }
-
-   for (i = 0; i < (unsigned)uint_settings_size; i++)
-   {
-      int tmp = 0;
-      if (config_get_int(conf, uint_settings[i].ident, &tmp))
-         *uint_settings[i].ptr = tmp;
-   }
-
-   for (i = 0; i < (unsigned)size_settings_size; i++)
-   {
-      size_t tmp = 0;
-      if (config_get_size_t(conf, size_settings[i].ident, &tmp))
-         *size_settings[i].ptr = tmp;
-      /* Special case for rewind_buffer_size - need to convert
-       * low values to what they were
-       * intended to be based on the default value in config.def.h
-       * If the value is less than 10000 then multiple by 1MB because if
-       * the retroarch.cfg
-       * file contains rewind_buffer_size = "100",
-       * then that ultimately gets interpreted as
-       * 100MB, so ensure the internal values represent that.*/
-      if (string_is_equal(size_settings[i].ident, "rewind_buffer_size"))
-         if (*size_settings[i].ptr < 10000)
-            *size_settings[i].ptr  = *size_settings[i].ptr * 1024 * 1024;
-   }
-
    {
       char prefix[64];
       size_t _len    = strlcpy(prefix, "input_player", sizeof(prefix));
@@ -4064,22 +4277,6 @@ static bool config_load_file(global_t *global,
       settings->floats.video_msg_color_b = ((msg_color >>  0) & 0xff) / 255.0f;
    }
 
-   /* Float settings */
-   for (i = 0; i < (unsigned)float_settings_size; i++)
-   {
-      float tmp = 0.0f;
-      if (config_get_float(conf, float_settings[i].ident, &tmp))
-         *float_settings[i].ptr = tmp;
-   }
-
-   /* Array settings  */
-   for (i = 0; i < (unsigned)array_settings_size; i++)
-   {
-      if (array_settings[i].flags & CFG_BOOL_FLG_HANDLE)
-         config_get_array(conf, array_settings[i].ident,
-               array_settings[i].ptr, PATH_MAX_LENGTH);
-   }
-
    /* Path settings  */
    for (i = 0; i < (unsigned)path_settings_size; i++)
    {
@@ -4527,6 +4724,9 @@ static bool config_load_file(global_t *global,
 #endif
 
    frontend_driver_set_sustained_performance_mode(settings->bools.sustained_performance_mode);
+#ifdef HAVE_THREADS
+   config_apply_thread_roles(settings);
+#endif
    recording_driver_update_streaming_url();
 
    if (!(bool)RHMAP_HAS_STR(conf->entries_map, "user_language"))
@@ -6909,6 +7109,7 @@ void input_config_parse_joy_button(
 
 void retroarch_config_deinit(void)
 {
+   config_load_binds_free();
    if (config_st)
       free(config_st);
    config_st = NULL;
@@ -197,6 +197,7 @@ typedef struct settings
 
       unsigned fps_update_interval;
       unsigned memory_update_interval;
+      unsigned threaded_data_runloop_workers;
 
       unsigned input_block_timeout;
 
@@ -238,7 +239,12 @@ typedef struct settings
       unsigned netplay_ggpo_oop_percent;
       unsigned netplay_ggpo_send_interval;
       unsigned netplay_ggpo_max_input_bits;
+      unsigned netplay_ggpo_input_fec;
+      unsigned netplay_ggpo_drift_correction;
       unsigned netplay_ggpo_prediction_frames;
+      unsigned netplay_ggpo_keyframe_interval;
+      unsigned netplay_ggpo_checksum_interval;
+      unsigned netplay_ggpo_audio_splice_frames;
       unsigned netplay_share_digital;
       unsigned netplay_share_analog;
       unsigned bundle_assets_extract_version_current;
@@ -248,6 +254,7 @@ typedef struct settings
       unsigned libretro_log_level;
       unsigned rewind_granularity;
       unsigned rewind_buffer_size_step;
+      unsigned rewind_disk_buffer_size;
       unsigned autosave_interval;
       unsigned replay_checkpoint_interval;
       unsigned replay_max_keep;
@@ -368,6 +375,7 @@ typedef struct settings
 #endif
 
       unsigned run_ahead_frames;
+      unsigned input_predictor;
 
       unsigned midi_volume;
       unsigned streaming_mode;
@@ -387,6 +395,7 @@ typedef struct settings
       unsigned ai_service_source_lang;
 
       unsigned core_updater_auto_backup_history_size;
+      unsigned network_http_concurrent_downloads;
       unsigned video_black_frame_insertion;
       unsigned video_bfi_dark_frames;
       unsigned video_shader_subframes;
@@ -544,6 +553,8 @@ typedef struct settings
       char webdav_password[NAME_MAX_LENGTH];
 
       char crt_switch_timings[NAME_MAX_LENGTH];
+      char thread_affinity[NAME_MAX_LENGTH];
+      char thread_priority[NAME_MAX_LENGTH];
       char input_reserved_devices[MAX_USERS][NAME_MAX_LENGTH];
 
       char youtube_stream_key[PATH_MAX_LENGTH];
@@ -652,6 +663,7 @@ typedef struct settings
       bool video_vsync;
       bool video_adaptive_vsync;
       bool video_hard_sync;
+      bool video_kms_direct_scanout;
       bool video_waitable_swapchains;
       bool video_vfilter;
       bool video_smooth;
@@ -665,6 +677,7 @@ typedef struct settings
       bool video_shader_enable;
       bool video_shader_watch_files;
       bool video_shader_remember_last_dir;
+      bool video_shader_cache_enable;
       bool video_shader_preset_save_reference_enable;
       bool video_scan_subframes;
       bool video_threaded;
@@ -729,6 +742,7 @@ typedef struct settings
       bool input_remap_sort_by_controller_enable;
       bool input_autodetect_enable;
       bool input_sensors_enable;
+      bool input_joypad_thread;
       bool input_overlay_enable;
       bool input_overlay_enable_autopreferred;
       bool input_overlay_behind_menu;
@@ -958,6 +972,8 @@ typedef struct settings
       bool netplay_request_devices[MAX_USERS];
       bool netplay_ping_show;
       bool netplay_ggpo_stats_show;
+      bool netplay_ggpo_replay_crossfade;
+      bool netplay_ggpo_network_thread;
 
       /* Network */
       bool network_buildbot_auto_extract_archive;
@@ -982,6 +998,7 @@ typedef struct settings
       bool cheevos_verbose_enable;
       bool cheevos_auto_screenshot;
       bool cheevos_start_active;
+      bool cheevos_threaded;
       bool cheevos_unlock_sound_enable;
       bool cheevos_challenge_indicators;
       bool cheevos_appearance_padding_auto;
@@ -1017,6 +1034,7 @@ typedef struct settings
 
       /* Driver */
       bool driver_switch_enable;
+      bool content_switch_seamless;
 
 #ifdef HAVE_MIST
       /* Steam */
@@ -1040,12 +1058,14 @@ typedef struct settings
       bool playlist_entry_rename;
       bool rewind_enable;
       bool fastforward_frameskip;
+      bool fastforward_frame_batch;
       bool vrr_runloop_enable;
       bool menu_throttle_framerate;
       bool apply_cheats_after_toggle;
       bool apply_cheats_after_load;
       bool run_ahead_enabled;
       bool run_ahead_secondary_instance;
+      bool run_ahead_secondary_thread;
       bool run_ahead_hide_warnings;
       bool preemptive_frames_enable;
       bool pause_nonactive;
@@ -1067,6 +1087,7 @@ typedef struct settings
       bool core_option_category_enable;
       bool core_info_cache_enable;
       bool core_info_savestate_bypass;
+      bool content_patch_cache_enable;
 #ifndef HAVE_DYNAMIC
       bool always_reload_core_on_run_content;
 #endif
@@ -1133,6 +1154,7 @@ typedef struct settings
 
       bool log_to_file;
       bool log_to_file_timestamp;
+      bool frame_timeline_enable;
 
       bool scan_without_core_match;
       bool scan_serial_and_crc;
@@ -1143,6 +1165,7 @@ typedef struct settings
       bool gamemode_enable;
 #ifdef HAVE_BSV_MOVIE
       bool replay_checkpoint_deserialize;
+      bool replay_checkpoint_flush;
 #endif
 
 #ifdef _3DS
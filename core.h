@@ -38,6 +38,11 @@ bool core_set_poll_type(unsigned type);
 /* Runs the core for one frame. */
 void core_run(void);
 
+/* Polls input for the frame core_run() is about to run, so that the
+ * core's own poll callback does not poll again. For callers that
+ * read input between the start of core_run() and retro_run(). */
+void core_latch_input(void);
+
 void core_reset(void);
 
 size_t core_serialize_size(void);
@@ -51,6 +56,16 @@ bool core_serialize_special(retro_ctx_serialize_info_t *info);
 bool core_unserialize(retro_ctx_serialize_info_t *info);
 bool core_unserialize_special(retro_ctx_serialize_info_t *info);
 
+/* Dirty blocks reported through SET_SERIALIZE_DIRTY_INTERFACE.
+ * The block size is 0 when the core reports none. The generation
+ * changes with every serialize, unserialize and reset; a caller whose
+ * own last save or load left it where it is can trust the bitmap
+ * core_serialize_dirty() fills in right after its next save to be
+ * relative to that state. */
+size_t core_serialize_dirty_block_size(void);
+uint32_t core_serialize_generation(void);
+bool core_serialize_dirty(uint8_t *bitmap, size_t len);
+
 bool core_set_cheat(retro_ctx_cheat_info_t *info);
 
 bool core_reset_cheat(void);
@@ -19,11 +19,22 @@
 #include <string/stdstring.h>
 #include <file/config_file.h>
 #include <file/file_path.h>
+#include <file/file_write_atomic.h>
 #include <streams/file_stream.h>
-#include <streams/interface_stream.h>
-#include <formats/rjson.h>
 #include <lists/dir_list.h>
 #include <file/archive_file.h>
+#include <array/rbuf.h>
+#include <features/features_cpu.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -47,45 +58,90 @@
 /* Core Info Cache START */
 /*************************/
 
-#define CORE_INFO_CACHE_VERSION "1.2"
-#define CORE_INFO_CACHE_DEFAULT_CAPACITY 8
+/* The cache is read straight into memory (mapped where the platform
+ * allows): a header, one fixed size record per core, the firmware
+ * records, then a pool of NUL terminated strings. Records refer to
+ * strings by their offset into the pool, where offset 0 is NULL. */
+#define CORE_INFO_CACHE_MAGIC      "RACINFO"
+#define CORE_INFO_CACHE_VERSION    2
+/* Read back as anything else, the cache was written on a machine
+ * of the other byte order */
+#define CORE_INFO_CACHE_BYTE_ORDER 0x01020304
+
+enum core_info_cache_string
+{
+   CORE_INFO_CACHE_DISPLAY_NAME = 0,
+   CORE_INFO_CACHE_DISPLAY_VERSION,
+   CORE_INFO_CACHE_CORE_NAME,
+   CORE_INFO_CACHE_SYSTEM_MANUFACTURER,
+   CORE_INFO_CACHE_SYSTEMNAME,
+   CORE_INFO_CACHE_SYSTEM_ID,
+   CORE_INFO_CACHE_SUPPORTED_EXTENSIONS,
+   CORE_INFO_CACHE_AUTHORS,
+   CORE_INFO_CACHE_PERMISSIONS,
+   CORE_INFO_CACHE_LICENSES,
+   CORE_INFO_CACHE_CATEGORIES,
+   CORE_INFO_CACHE_DATABASES,
+   CORE_INFO_CACHE_NOTES,
+   CORE_INFO_CACHE_REQUIRED_HW_API,
+   CORE_INFO_CACHE_DESCRIPTION,
+   CORE_INFO_CACHE_CORE_FILE_ID,
+   CORE_INFO_CACHE_STRING_COUNT
+};
 
-/* TODO/FIXME: Apparently rzip compression is an issue on UWP */
-#if defined(HAVE_ZLIB) && !(defined(__WINRT__) || defined(WINAPI_FAMILY) && WINAPI_FAMILY == WINAPI_FAMILY_PHONE_APP)
-#define CORE_INFO_CACHE_COMPRESS
-#endif
+enum core_info_cache_flags
+{
+   CORE_INFO_CACHE_FLG_HAS_INFO                      = (1 << 0),
+   CORE_INFO_CACHE_FLG_SUPPORTS_NO_GAME              = (1 << 1),
+   CORE_INFO_CACHE_FLG_SINGLE_PURPOSE                = (1 << 2),
+   CORE_INFO_CACHE_FLG_DATABASE_MATCH_ARCHIVE_MEMBER = (1 << 3),
+   CORE_INFO_CACHE_FLG_IS_EXPERIMENTAL               = (1 << 4)
+};
+
+typedef struct
+{
+   char magic[8];
+   uint32_t version;
+   uint32_t byte_order;
+   uint32_t count;
+   uint32_t firmware_count;
+   uint32_t pool_size;
+} core_info_cache_header_t;
+
+typedef struct
+{
+   uint32_t strings[CORE_INFO_CACHE_STRING_COUNT];
+   uint32_t core_file_id_hash;
+   /* Index of the first of the core's firmware records */
+   uint32_t firmware;
+   uint32_t firmware_count;
+   uint32_t savestate_support_level;
+   uint32_t flags;
+} core_info_cache_record_t;
+
+typedef struct
+{
+   uint32_t path;
+   uint32_t desc;
+   uint32_t optional;
+} core_info_cache_firmware_t;
+
+typedef struct
+{
+   char *buf;
+   bool oom;
+} core_info_cache_pool_t;
 
 typedef struct
 {
    core_info_t *items;
    size_t length;
-   size_t capacity;
-   char *version;
    bool refresh;
 } core_info_cache_list_t;
 
-typedef struct
-{
-   core_info_t *core_info;
-   core_info_cache_list_t *core_info_cache_list;
-   char **current_string_val;
-   struct string_list **current_string_list_val;
-   uint32_t *current_entry_uint_val;
-   bool *current_entry_bool_val;
-   unsigned array_depth;
-   unsigned object_depth;
-   bool to_core_file_id;
-   bool to_firmware;
-} CCJSONContext;
-
 /* Forward declarations */
 static void core_info_free(core_info_t* info);
 static uint32_t core_info_hash_string(const char *str);
-#ifdef HAVE_CORE_INFO_CACHE
-static core_info_cache_list_t *core_info_cache_list_new(void);
-#endif
-static void core_info_cache_add(core_info_cache_list_t *list,
-      core_info_t *info, bool transfer);
 
 static core_info_state_t core_info_st = {
 #ifdef HAVE_COMPRESSION
@@ -96,412 +152,42 @@ static core_info_state_t core_info_st = {
    NULL
 };
 
-#ifdef HAVE_CORE_INFO_CACHE
-/* JSON Handlers START */
-
-static bool CCJSONObjectMemberHandler(void *context,
-      const char *pValue, size_t len)
-{
-   CCJSONContext *pCtx = (CCJSONContext *)context;
-
-   if (len)
-   {
-      switch (pCtx->array_depth)
-      {
-         case 0:
-            if (pCtx->object_depth == 1)
-            {
-               pCtx->current_string_val     = NULL;
-
-               if (string_is_equal(pValue, "version"))
-                  pCtx->current_string_val  = &pCtx->core_info_cache_list->version;
-            }
-            break;
-         case 1:
-            if (pCtx->object_depth == 2)
-            {
-               pCtx->current_string_val      = NULL;
-               pCtx->current_string_list_val = NULL;
-               pCtx->current_entry_uint_val  = NULL;
-               pCtx->current_entry_bool_val  = NULL;
-               pCtx->to_core_file_id         = false;
-               pCtx->to_firmware             = false;
-
-               switch (pValue[0])
-               {
-                  case 'a':
-                     if (string_is_equal(pValue, "authors"))
-                     {
-                        pCtx->current_string_val      = &pCtx->core_info->authors;
-                        pCtx->current_string_list_val = &pCtx->core_info->authors_list;
-                     }
-                     break;
-                  case 'c':
-                     if (string_is_equal(pValue, "categories"))
-                     {
-                        pCtx->current_string_val      = &pCtx->core_info->categories;
-                        pCtx->current_string_list_val = &pCtx->core_info->categories_list;
-                     }
-                     else if (string_is_equal(pValue, "core_name"))
-                        pCtx->current_string_val      = &pCtx->core_info->core_name;
-                     else if (string_is_equal(pValue, "core_file_id"))
-                        pCtx->to_core_file_id         = true;
-                     break;
-                  case 'd':
-                     if (string_is_equal(pValue, "display_name"))
-                        pCtx->current_string_val      = &pCtx->core_info->display_name;
-                     else if (string_is_equal(pValue, "display_version"))
-                        pCtx->current_string_val      = &pCtx->core_info->display_version;
-                     else if (string_is_equal(pValue, "databases"))
-                     {
-                        pCtx->current_string_val      = &pCtx->core_info->databases;
-                        pCtx->current_string_list_val = &pCtx->core_info->databases_list;
-                     }
-                     else if (string_is_equal(pValue, "description"))
-                        pCtx->current_string_val      = &pCtx->core_info->description;
-                     else if (string_is_equal(pValue, "database_match_archive_member"))
-                        pCtx->current_entry_bool_val  = &pCtx->core_info->database_match_archive_member;
-                     break;
-                  case 'f':
-                     if (string_is_equal(pValue, "firmware"))
-                        pCtx->to_firmware             = true;
-                     break;
-                  case 'h':
-                     if (string_is_equal(pValue, "has_info"))
-                        pCtx->current_entry_bool_val  = &pCtx->core_info->has_info;
-                     break;
-                  case 'l':
-                     if (string_is_equal(pValue, "licenses"))
-                     {
-                        pCtx->current_string_val      = &pCtx->core_info->licenses;
-                        pCtx->current_string_list_val = &pCtx->core_info->licenses_list;
-                     }
-                     break;
-                  case 'i':
-                     if (string_is_equal(pValue, "is_experimental"))
-                        pCtx->current_entry_bool_val  = &pCtx->core_info->is_experimental;
-                     break;
-                  case 'n':
-                     if (string_is_equal(pValue, "notes"))
-                     {
-                        pCtx->current_string_val      = &pCtx->core_info->notes;
-                        pCtx->current_string_list_val = &pCtx->core_info->note_list;
-                     }
-                     break;
-                  case 'p':
-                     if (string_is_equal(pValue, "permissions"))
-                     {
-                        pCtx->current_string_val      = &pCtx->core_info->permissions;
-                        pCtx->current_string_list_val = &pCtx->core_info->permissions_list;
-                     }
-                     break;
-                  case 'r':
-                     if (string_is_equal(pValue, "required_hw_api"))
-                     {
-                        pCtx->current_string_val      = &pCtx->core_info->required_hw_api;
-                        pCtx->current_string_list_val = &pCtx->core_info->required_hw_api_list;
-                     }
-                     break;
-                  case 's':
-                     if (string_is_equal(pValue, "system_manufacturer"))
-                        pCtx->current_string_val      = &pCtx->core_info->system_manufacturer;
-                     else if (string_is_equal(pValue, "systemname"))
-                        pCtx->current_string_val      = &pCtx->core_info->systemname;
-                     else if (string_is_equal(pValue, "system_id"))
-                        pCtx->current_string_val      = &pCtx->core_info->system_id;
-                     else if (string_is_equal(pValue, "supported_extensions"))
-                     {
-                        pCtx->current_string_val      = &pCtx->core_info->supported_extensions;
-                        pCtx->current_string_list_val = &pCtx->core_info->supported_extensions_list;
-                     }
-                     else if (string_is_equal(pValue, "supports_no_game"))
-                        pCtx->current_entry_bool_val  = &pCtx->core_info->supports_no_game;
-                     else if (string_is_equal(pValue, "single_purpose"))
-                        pCtx->current_entry_bool_val  = &pCtx->core_info->single_purpose;
-                     else if (string_is_equal(pValue, "savestate_support_level"))
-                        pCtx->current_entry_uint_val  = &pCtx->core_info->savestate_support_level;
-                     break;
-               }
-            }
-            else if (pCtx->object_depth == 3)
-            {
-               pCtx->current_string_val      = NULL;
-               pCtx->current_entry_uint_val  = NULL;
-
-               if (pCtx->to_core_file_id)
-               {
-                  if (string_is_equal(pValue, "str"))
-                     pCtx->current_string_val      = &pCtx->core_info->core_file_id.str;
-                  else if (string_is_equal(pValue, "hash"))
-                     pCtx->current_entry_uint_val  = &pCtx->core_info->core_file_id.hash;
-               }
-            }
-            break;
-         case 2:
-            if (pCtx->object_depth == 3)
-            {
-               pCtx->current_string_val            = NULL;
-               pCtx->current_entry_bool_val        = NULL;
-
-               if (pCtx->to_firmware && (pCtx->core_info->firmware_count > 0))
-               {
-                  size_t firmware_idx              = pCtx->core_info->firmware_count - 1;
-
-                  if (string_is_equal(pValue, "path"))
-                     pCtx->current_string_val      = &pCtx->core_info->firmware[firmware_idx].path;
-                  else if (string_is_equal(pValue, "desc"))
-                     pCtx->current_string_val      = &pCtx->core_info->firmware[firmware_idx].desc;
-                  else if (string_is_equal(pValue, "optional"))
-                     pCtx->current_entry_bool_val  = &pCtx->core_info->firmware[firmware_idx].optional;
-               }
-            }
-            break;
-      }
-
-   }
-
-   return true;
-}
-
-static bool CCJSONStringHandler(void *context,
-      const char *pValue, size_t len)
-{
-   CCJSONContext *pCtx = (CCJSONContext*)context;
-
-   if (     pCtx->current_string_val
-         && len
-         && !string_is_empty(pValue))
-   {
-      if (*pCtx->current_string_val)
-         free(*pCtx->current_string_val);
-      *pCtx->current_string_val = strdup(pValue);
-
-      if (pCtx->current_string_list_val)
-      {
-         if (*pCtx->current_string_list_val)
-            string_list_free(*pCtx->current_string_list_val);
-         *pCtx->current_string_list_val =
-            string_split(*pCtx->current_string_val, "|");
-      }
-   }
-
-   pCtx->current_string_val      = NULL;
-   pCtx->current_string_list_val = NULL;
-
-   return true;
-}
-
-static bool CCJSONNumberHandler(void *context,
-      const char *pValue, size_t len)
-{
-   CCJSONContext *pCtx              = (CCJSONContext*)context;
-
-   if (pCtx->current_entry_uint_val)
-      *pCtx->current_entry_uint_val = string_to_unsigned(pValue);
-
-   pCtx->current_entry_uint_val     = NULL;
-
-   return true;
-}
-
-static bool CCJSONBoolHandler(void *context, bool value)
-{
-   CCJSONContext *pCtx              = (CCJSONContext *)context;
-
-   if (pCtx->current_entry_bool_val)
-      *pCtx->current_entry_bool_val = value;
-
-   pCtx->current_entry_bool_val     = NULL;
-
-   return true;
-}
-
-static bool CCJSONStartObjectHandler(void *context)
-{
-   CCJSONContext *pCtx = (CCJSONContext*)context;
-
-   pCtx->object_depth++;
-
-   switch (pCtx->array_depth)
-   {
-      case 0:
-         if (pCtx->object_depth == 1)
-         {
-            if (pCtx->core_info_cache_list)
-               return false;
-            if (!(pCtx->core_info_cache_list = core_info_cache_list_new()))
-               return false;
-         }
-         break;
-      case 1:
-         if (pCtx->object_depth == 2)
-         {
-            if (pCtx->core_info)
-            {
-               core_info_free(pCtx->core_info);
-               free(pCtx->core_info);
-               pCtx->core_info = NULL;
-            }
-
-            if (!(pCtx->core_info = (core_info_t*)calloc(1, sizeof(core_info_t))))
-               return false;
-
-            /* Assume all cores have 'full' savestate support
-             * by default */
-            pCtx->core_info->savestate_support_level =
-               CORE_INFO_SAVESTATE_DETERMINISTIC;
-         }
-         break;
-      case 2:
-         if (pCtx->object_depth == 3 && pCtx->to_firmware)
-         {
-            size_t new_idx            = pCtx->core_info->firmware_count;
-            core_info_firmware_t *tmp = (core_info_firmware_t*)
-               realloc(pCtx->core_info->firmware,
-                     (pCtx->core_info->firmware_count + 1)
-                     * sizeof(core_info_firmware_t));
-
-            if (!tmp)
-               return false;
-
-            tmp[new_idx].path              = NULL;
-            tmp[new_idx].desc              = NULL;
-            tmp[new_idx].missing           = false;
-            tmp[new_idx].optional          = false;
-
-            pCtx->core_info->firmware      = tmp;
-            pCtx->core_info->firmware_count++;
-         }
-         break;
-   }
-
-
-   return true;
-}
-
-static bool CCJSONEndObjectHandler(void *context)
-{
-   CCJSONContext *pCtx = (CCJSONContext*)context;
-
-   if (pCtx->array_depth == 1)
-   {
-      switch (pCtx->object_depth)
-      {
-         case 2:
-            if (pCtx->core_info)
-            {
-               core_info_cache_add(
-                     pCtx->core_info_cache_list, pCtx->core_info, true);
-               free(pCtx->core_info);
-               pCtx->core_info = NULL;
-            }
-            break;
-         case 3:
-            pCtx->to_core_file_id = false;
-            break;
-         default:
-            break;
-      }
-   }
-
-   pCtx->object_depth--;
-
-   return true;
-}
-
-static bool CCJSONStartArrayHandler(void *context)
-{
-   CCJSONContext *pCtx = (CCJSONContext*)context;
-   pCtx->array_depth++;
-   return true;
-}
-
-static bool CCJSONEndArrayHandler(void *context)
-{
-   CCJSONContext *pCtx = (CCJSONContext*)context;
-
-   if ((pCtx->object_depth == 2) && (pCtx->array_depth == 2))
-      pCtx->to_firmware = false;
-
-   pCtx->array_depth--;
-
-   return true;
-}
-
-/* JSON Handlers END */
-#endif
-
-/* Note: 'dst' must be zero initialised, or memory
- * leaks will occur */
-static void core_info_copy(core_info_t *src, core_info_t *dst)
-{
-   dst->path                      = src->path                 ? strdup(src->path)                 : NULL;
-   dst->display_name              = src->display_name         ? strdup(src->display_name)         : NULL;
-   dst->display_version           = src->display_version      ? strdup(src->display_version)      : NULL;
-   dst->core_name                 = src->core_name            ? strdup(src->core_name)            : NULL;
-   dst->system_manufacturer       = src->system_manufacturer  ? strdup(src->system_manufacturer)  : NULL;
-   dst->systemname                = src->systemname           ? strdup(src->systemname)           : NULL;
-   dst->system_id                 = src->system_id            ? strdup(src->system_id)            : NULL;
-   dst->supported_extensions      = src->supported_extensions ? strdup(src->supported_extensions) : NULL;
-   dst->authors                   = src->authors              ? strdup(src->authors)              : NULL;
-   dst->permissions               = src->permissions          ? strdup(src->permissions)          : NULL;
-   dst->licenses                  = src->licenses             ? strdup(src->licenses)             : NULL;
-   dst->categories                = src->categories           ? strdup(src->categories)           : NULL;
-   dst->databases                 = src->databases            ? strdup(src->databases)            : NULL;
-   dst->notes                     = src->notes                ? strdup(src->notes)                : NULL;
-   dst->required_hw_api           = src->required_hw_api      ? strdup(src->required_hw_api)      : NULL;
-   dst->description               = src->description          ? strdup(src->description)          : NULL;
-
-   dst->categories_list           = src->categories_list           ? string_list_clone(src->categories_list)           : NULL;
-   dst->databases_list            = src->databases_list            ? string_list_clone(src->databases_list)            : NULL;
-   dst->note_list                 = src->note_list                 ? string_list_clone(src->note_list)                 : NULL;
-   dst->supported_extensions_list = src->supported_extensions_list ? string_list_clone(src->supported_extensions_list) : NULL;
-   dst->authors_list              = src->authors_list              ? string_list_clone(src->authors_list)              : NULL;
-   dst->permissions_list          = src->permissions_list          ? string_list_clone(src->permissions_list)          : NULL;
-   dst->licenses_list             = src->licenses_list             ? string_list_clone(src->licenses_list)             : NULL;
-   dst->required_hw_api_list      = src->required_hw_api_list      ? string_list_clone(src->required_hw_api_list)      : NULL;
-
-   if (src->firmware_count > 0)
-   {
-      dst->firmware = (core_info_firmware_t*)calloc(src->firmware_count,
-            sizeof(core_info_firmware_t));
-
-      if (dst->firmware)
-      {
-         size_t i;
-
-         dst->firmware_count = src->firmware_count;
-
-         for (i = 0; i < src->firmware_count; i++)
-         {
-            dst->firmware[i].path     = src->firmware[i].path ? strdup(src->firmware[i].path) : NULL;
-            dst->firmware[i].desc     = src->firmware[i].desc ? strdup(src->firmware[i].desc) : NULL;
-            dst->firmware[i].missing  = src->firmware[i].missing;
-            dst->firmware[i].optional = src->firmware[i].optional;
-         }
-      }
-      else
-         dst->firmware_count = 0;
-   }
-
-   dst->core_file_id.str              = src->core_file_id.str
-      ? strdup(src->core_file_id.str) : NULL;
-   dst->core_file_id.hash             = src->core_file_id.hash;
-
-   dst->savestate_support_level       = src->savestate_support_level;
-   dst->has_info                      = src->has_info;
-   dst->supports_no_game              = src->supports_no_game;
-   dst->single_purpose                = src->single_purpose;
-   dst->database_match_archive_member = src->database_match_archive_member;
-   dst->is_experimental               = src->is_experimental;
-   dst->is_locked                     = src->is_locked;
-   dst->is_standalone_exempt          = src->is_standalone_exempt;
-   dst->is_installed                  = src->is_installed;
-}
-
-/* Like core_info_copy, but transfers 'ownership'
- * of internal objects/data structures from 'src'
- * to 'dst' */
+/* The members behind each cached string, with the list
+ * split from it on '|' where the core info has one */
+static void core_info_cache_get_fields(core_info_t *info,
+      char **strings[CORE_INFO_CACHE_STRING_COUNT],
+      struct string_list **lists[CORE_INFO_CACHE_STRING_COUNT])
+{
+   memset(lists, 0, CORE_INFO_CACHE_STRING_COUNT * sizeof(*lists));
+
+   strings[CORE_INFO_CACHE_DISPLAY_NAME]         = &info->display_name;
+   strings[CORE_INFO_CACHE_DISPLAY_VERSION]      = &info->display_version;
+   strings[CORE_INFO_CACHE_CORE_NAME]            = &info->core_name;
+   strings[CORE_INFO_CACHE_SYSTEM_MANUFACTURER]  = &info->system_manufacturer;
+   strings[CORE_INFO_CACHE_SYSTEMNAME]           = &info->systemname;
+   strings[CORE_INFO_CACHE_SYSTEM_ID]            = &info->system_id;
+   strings[CORE_INFO_CACHE_SUPPORTED_EXTENSIONS] = &info->supported_extensions;
+   lists[CORE_INFO_CACHE_SUPPORTED_EXTENSIONS]   = &info->supported_extensions_list;
+   strings[CORE_INFO_CACHE_AUTHORS]              = &info->authors;
+   lists[CORE_INFO_CACHE_AUTHORS]                = &info->authors_list;
+   strings[CORE_INFO_CACHE_PERMISSIONS]          = &info->permissions;
+   lists[CORE_INFO_CACHE_PERMISSIONS]            = &info->permissions_list;
+   strings[CORE_INFO_CACHE_LICENSES]             = &info->licenses;
+   lists[CORE_INFO_CACHE_LICENSES]               = &info->licenses_list;
+   strings[CORE_INFO_CACHE_CATEGORIES]           = &info->categories;
+   lists[CORE_INFO_CACHE_CATEGORIES]             = &info->categories_list;
+   strings[CORE_INFO_CACHE_DATABASES]            = &info->databases;
+   lists[CORE_INFO_CACHE_DATABASES]              = &info->databases_list;
+   strings[CORE_INFO_CACHE_NOTES]                = &info->notes;
+   lists[CORE_INFO_CACHE_NOTES]                  = &info->note_list;
+   strings[CORE_INFO_CACHE_REQUIRED_HW_API]      = &info->required_hw_api;
+   lists[CORE_INFO_CACHE_REQUIRED_HW_API]        = &info->required_hw_api_list;
+   strings[CORE_INFO_CACHE_DESCRIPTION]          = &info->description;
+   strings[CORE_INFO_CACHE_CORE_FILE_ID]         = &info->core_file_id.str;
+}
+
+/* Transfers 'ownership' of internal objects/data
+ * structures from 'src' to 'dst' */
 static void core_info_transfer(core_info_t *src, core_info_t *dst)
 {
    dst->path                      = src->path;
@@ -614,10 +300,6 @@ static void core_info_cache_list_free(
       free(core_info_cache_list->items);
    }
    core_info_cache_list->items = NULL;
-
-   if (core_info_cache_list->version)
-      free(core_info_cache_list->version);
-   core_info_cache_list->version = NULL;
 }
 
 static core_info_t *core_info_cache_find(
@@ -650,81 +332,116 @@ static core_info_t *core_info_cache_find(
    return NULL;
 }
 
-static void core_info_cache_add(
-      core_info_cache_list_t *list, core_info_t *info,
-      bool transfer)
-{
-   core_info_t *info_cache = NULL;
-
-   if (   !list
-       || !info
-       || (info->core_file_id.hash == 0)
-       || string_is_empty(info->core_file_id.str))
-      return;
-
-   if (list->length >= list->capacity)
-   {
-      size_t prev_capacity   = list->capacity;
-      core_info_t *items_tmp = (core_info_t*)realloc(list->items,
-            (list->capacity << 1) * sizeof(core_info_t));
-
-      if (!items_tmp)
-         return;
-
-      list->capacity         = list->capacity << 1;
-      list->items            = items_tmp;
-
-      memset(&list->items[prev_capacity], 0,
-            (list->capacity - prev_capacity) * sizeof(core_info_t));
-   }
-
-   info_cache = (core_info_t*)&list->items[list->length];
-
-   if (transfer)
-      core_info_transfer(info, info_cache);
-   else
-      core_info_copy(info, info_cache);
-
-   list->length++;
-}
-
 #ifdef HAVE_CORE_INFO_CACHE
-static core_info_cache_list_t *core_info_cache_list_new(void)
+static core_info_cache_list_t *core_info_cache_list_new(size_t capacity)
 {
    core_info_cache_list_t *core_info_cache_list =
       (core_info_cache_list_t *)malloc(sizeof(*core_info_cache_list));
    if (!core_info_cache_list)
       return NULL;
 
-   core_info_cache_list->items    = (core_info_t *)
-      calloc(CORE_INFO_CACHE_DEFAULT_CAPACITY,
-            sizeof(core_info_t));
+   core_info_cache_list->items    = NULL;
    core_info_cache_list->length   = 0;
-   core_info_cache_list->capacity = 0;
-   core_info_cache_list->version  = NULL;
    core_info_cache_list->refresh  = false;
 
-   if (!core_info_cache_list->items)
+   if (capacity && !(core_info_cache_list->items = (core_info_t *)
+            calloc(capacity, sizeof(core_info_t))))
    {
-      core_info_cache_list_free(core_info_cache_list);
       free(core_info_cache_list);
-      core_info_cache_list = NULL;
       return NULL;
    }
 
-   core_info_cache_list->capacity = CORE_INFO_CACHE_DEFAULT_CAPACITY;
-   core_info_cache_list->refresh  = false;
-   core_info_cache_list->version  = NULL;
-
    return core_info_cache_list;
 }
 
+static char *core_info_cache_strdup(const char *pool, uint32_t pool_size,
+      uint32_t offset, bool *valid)
+{
+   if (!offset)
+      return NULL;
+   if (offset >= pool_size)
+   {
+      *valid = false;
+      return NULL;
+   }
+   return strdup(pool + offset);
+}
+
+/* Fills 'info' from its record; false if the record
+ * points outside the file */
+static bool core_info_cache_read_record(core_info_t *info,
+      const core_info_cache_header_t *header,
+      const core_info_cache_record_t *record,
+      const core_info_cache_firmware_t *firmware,
+      const char *pool)
+{
+   size_t i;
+   char **strings[CORE_INFO_CACHE_STRING_COUNT];
+   struct string_list **lists[CORE_INFO_CACHE_STRING_COUNT];
+   bool valid = true;
+
+   core_info_cache_get_fields(info, strings, lists);
+
+   for (i = 0; i < CORE_INFO_CACHE_STRING_COUNT; i++)
+   {
+      *strings[i] = core_info_cache_strdup(pool, header->pool_size,
+            record->strings[i], &valid);
+      if (lists[i] && *strings[i])
+         *lists[i] = string_split(*strings[i], "|");
+   }
+
+   info->core_file_id.hash            = record->core_file_id_hash;
+   info->savestate_support_level      = record->savestate_support_level;
+   info->has_info                     =
+      (record->flags & CORE_INFO_CACHE_FLG_HAS_INFO) != 0;
+   info->supports_no_game             =
+      (record->flags & CORE_INFO_CACHE_FLG_SUPPORTS_NO_GAME) != 0;
+   info->single_purpose               =
+      (record->flags & CORE_INFO_CACHE_FLG_SINGLE_PURPOSE) != 0;
+   info->database_match_archive_member =
+      (record->flags & CORE_INFO_CACHE_FLG_DATABASE_MATCH_ARCHIVE_MEMBER) != 0;
+   info->is_experimental              =
+      (record->flags & CORE_INFO_CACHE_FLG_IS_EXPERIMENTAL) != 0;
+
+   if (     record->firmware       > header->firmware_count
+         || record->firmware_count > header->firmware_count - record->firmware)
+      return false;
+
+   if (record->firmware_count)
+   {
+      if (!(info->firmware = (core_info_firmware_t*)calloc(
+                  record->firmware_count, sizeof(core_info_firmware_t))))
+         return false;
+
+      info->firmware_count = record->firmware_count;
+
+      for (i = 0; i < record->firmware_count; i++)
+      {
+         const core_info_cache_firmware_t *src =
+            &firmware[record->firmware + i];
+
+         info->firmware[i].path     = core_info_cache_strdup(pool,
+               header->pool_size, src->path, &valid);
+         info->firmware[i].desc     = core_info_cache_strdup(pool,
+               header->pool_size, src->desc, &valid);
+         info->firmware[i].optional = (src->optional != 0);
+      }
+   }
+
+   return valid && info->core_file_id.str;
+}
+
 static core_info_cache_list_t *core_info_cache_read(const char *info_dir)
 {
-   intfstream_t *file                           = NULL;
-   rjson_t *parser                              = NULL;
-   CCJSONContext context                        = {0};
+   uint32_t i;
+   const core_info_cache_header_t *header;
+   const core_info_cache_record_t *records;
+   const core_info_cache_firmware_t *firmware;
+   const char *pool;
    core_info_cache_list_t *core_info_cache_list = NULL;
+   void *data                                   = NULL;
+   size_t size                                  = 0;
+   bool mapped                                  = false;
    char file_path[PATH_MAX_LENGTH];
 
    /* Check whether a 'force refresh' file
@@ -738,7 +455,7 @@ static core_info_cache_list_t *core_info_cache_read(const char *info_dir)
             sizeof(file_path));
 
    if (path_is_valid(file_path))
-      return core_info_cache_list_new();
+      return core_info_cache_list_new(0);
 
    /* Open info cache file */
    if (string_is_empty(info_dir))
@@ -748,457 +465,248 @@ static core_info_cache_list_t *core_info_cache_read(const char *info_dir)
             FILE_PATH_CORE_INFO_CACHE,
             sizeof(file_path));
 
-#if defined(HAVE_ZLIB)
-   file = intfstream_open_rzip_file(file_path,
-         RETRO_VFS_FILE_ACCESS_READ);
-#else
-   file = intfstream_open_file(file_path,
-         RETRO_VFS_FILE_ACCESS_READ,
-         RETRO_VFS_FILE_ACCESS_HINT_NONE);
-#endif
-
-   if (!file)
-      return core_info_cache_list_new();
+#ifdef HAVE_MMAP
+   {
+      struct stat st;
+      int fd = open(file_path, O_RDONLY);
 
-   /* Parse info cache file */
-   if (!(parser = rjson_open_stream(file)))
+      if (fd >= 0)
+      {
+         if (     fstat(fd, &st) == 0
+               && st.st_size >= (off_t)sizeof(*header))
+         {
+            void *map = mmap(NULL, (size_t)st.st_size,
+                  PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED)
+            {
+               data   = map;
+               size   = (size_t)st.st_size;
+               mapped = true;
+            }
+         }
+         close(fd);
+      }
+   }
+   if (!mapped)
+#endif
    {
-      RARCH_ERR("[Core info] Failed to create JSON parser.\n");
+      int64_t _len = 0;
+      if (     !path_is_valid(file_path)
+            || !filestream_read_file(file_path, &data, &_len))
+         return core_info_cache_list_new(0);
+      size = (size_t)_len;
+   }
+
+   /* A cache in the old JSON format fails here too */
+   header = (const core_info_cache_header_t*)data;
+   if (     size < sizeof(*header)
+         || memcmp(header->magic, CORE_INFO_CACHE_MAGIC,
+               sizeof(CORE_INFO_CACHE_MAGIC)) != 0
+         || header->version    != CORE_INFO_CACHE_VERSION
+         || header->byte_order != CORE_INFO_CACHE_BYTE_ORDER
+         || header->count      > (size - sizeof(*header))
+            / sizeof(*records)
+         || header->firmware_count > (size - sizeof(*header)
+            - (size_t)header->count * sizeof(*records)) / sizeof(*firmware)
+         || header->pool_size != size - sizeof(*header)
+            - (size_t)header->count * sizeof(*records)
+            - (size_t)header->firmware_count * sizeof(*firmware)
+         || !header->pool_size)
+   {
+      RARCH_WARN("[Core info] Core info cache has invalid format"
+            " - forcing refresh (required v%u).\n",
+            (unsigned)CORE_INFO_CACHE_VERSION);
+      core_info_cache_list = core_info_cache_list_new(0);
       goto end;
    }
 
-   rjson_set_options(parser,
-           RJSON_OPTION_ALLOW_UTF8BOM
-         | RJSON_OPTION_ALLOW_COMMENTS
-         | RJSON_OPTION_ALLOW_UNESCAPED_CONTROL_CHARACTERS
-         | RJSON_OPTION_REPLACE_INVALID_ENCODING);
-
-   if (rjson_parse(parser, &context,
-         CCJSONObjectMemberHandler,
-         CCJSONStringHandler,
-         CCJSONNumberHandler,
-         CCJSONStartObjectHandler,
-         CCJSONEndObjectHandler,
-         CCJSONStartArrayHandler,
-         CCJSONEndArrayHandler,
-         CCJSONBoolHandler,
-         NULL) /* Unused null handler */
-         != RJSON_DONE)
-   {
-      RARCH_WARN("[Core info] Error parsing chunk:\n---snip---\n%.*s\n---snip---\n",
-            rjson_get_source_context_len(parser),
-            rjson_get_source_context_buf(parser));
-      RARCH_WARN("[Core info] Error: Invalid JSON at line %d, column %d - %s.\n",
-            (int)rjson_get_source_line(parser),
-            (int)rjson_get_source_column(parser),
-            (*rjson_get_error(parser)
-             ? rjson_get_error(parser)
-             : "format error"));
-
-      /* Info cache is corrupt - discard it */
-      core_info_cache_list_free(context.core_info_cache_list);
-      core_info_cache_list = core_info_cache_list_new();
-   }
-   else
-      core_info_cache_list = context.core_info_cache_list;
-
-   rjson_free(parser);
+   records  = (const core_info_cache_record_t*)(header + 1);
+   firmware = (const core_info_cache_firmware_t*)(records + header->count);
+   pool     = (const char*)(firmware + header->firmware_count);
 
-   /* Clean up leftovers in the event of
-    * a parsing error */
-   if (context.core_info)
+   if (pool[header->pool_size - 1] != '\0')
    {
-      core_info_free(context.core_info);
-      free(context.core_info);
+      core_info_cache_list = core_info_cache_list_new(0);
+      goto end;
    }
 
-   if (!core_info_cache_list)
+   if (!(core_info_cache_list = core_info_cache_list_new(header->count)))
       goto end;
 
-   /* If info cache file has the wrong version
-    * number, discard it */
-   if (    string_is_empty(core_info_cache_list->version)
-       || !string_is_equal(core_info_cache_list->version,
-            CORE_INFO_CACHE_VERSION))
+   for (i = 0; i < header->count; i++)
    {
-      RARCH_WARN("[Core info] Core info cache has invalid version"
-            " - forcing refresh (required v%s, found v%s).\n",
-            CORE_INFO_CACHE_VERSION,
-            core_info_cache_list->version);
+      core_info_t *info = &core_info_cache_list->items[i];
 
-      core_info_cache_list_free(context.core_info_cache_list);
-      core_info_cache_list = core_info_cache_list_new();
+      core_info_cache_list->length++;
+
+      if (!core_info_cache_read_record(info, header, &records[i],
+               firmware, pool))
+      {
+         /* Info cache is corrupt - discard it */
+         RARCH_WARN("[Core info] Core info cache is corrupt"
+               " - forcing refresh.\n");
+         core_info_cache_list_free(core_info_cache_list);
+         free(core_info_cache_list);
+         core_info_cache_list = core_info_cache_list_new(0);
+         break;
+      }
    }
 
 end:
-   intfstream_close(file);
-   free(file);
+#ifdef HAVE_MMAP
+   if (mapped)
+      munmap(data, size);
+   else
+#endif
+      free(data);
 
    return core_info_cache_list;
 }
 #endif
 
-static bool core_info_cache_write(core_info_cache_list_t *list, const char *info_dir)
+static uint32_t core_info_cache_add_string(core_info_cache_pool_t *pool,
+      const char *str)
 {
-   intfstream_t *file    = NULL;
-   rjsonwriter_t *writer = NULL;
-   bool success          = false;
-   char file_path[PATH_MAX_LENGTH];
-   size_t i, j;
-
-   if (!list)
-      return false;
-
-   /* Open info cache file */
-   if (string_is_empty(info_dir))
-      strlcpy(file_path, FILE_PATH_CORE_INFO_CACHE, sizeof(file_path));
-   else
-      fill_pathname_join_special(file_path, info_dir,
-            FILE_PATH_CORE_INFO_CACHE,
-            sizeof(file_path));
+   size_t _len;
+   size_t offset;
 
-#if defined(CORE_INFO_CACHE_COMPRESS)
-   file = intfstream_open_rzip_file(file_path, RETRO_VFS_FILE_ACCESS_WRITE);
-#else
-   file = intfstream_open_file(file_path,
-         RETRO_VFS_FILE_ACCESS_WRITE,
-         RETRO_VFS_FILE_ACCESS_HINT_NONE);
-#endif
+   if (string_is_empty(str))
+      return 0;
 
-   if (!file)
-   {
-      RARCH_ERR("[Core info] Failed to write core info cache file: \"%s\".\n", file_path);
-      return false;
-   }
+   _len   = strlen(str) + 1;
+   offset = RBUF_LEN(pool->buf);
 
-   /* Write info cache */
-   if (!(writer = rjsonwriter_open_stream(file)))
+   if (!RBUF_TRYFIT(pool->buf, offset + _len))
    {
-      RARCH_ERR("[Core info] Failed to create JSON writer.\n");
-      goto end;
+      pool->oom = true;
+      return 0;
    }
+   RBUF_RESIZE(pool->buf, offset + _len);
+   memcpy(pool->buf + offset, str, _len);
+   return (uint32_t)offset;
+}
 
-#if defined(CORE_INFO_CACHE_COMPRESS)
-   /* When compressing info cache, human readability
-    * is not a factor - can skip all indentation
-    * and new line characters */
-   rjsonwriter_set_options(writer, RJSONWRITER_OPTION_SKIP_WHITESPACE);
-#endif
+/* Writes every core in 'list' that has a file 'id' - which is
+ * every installed core, those taken from the cache included */
+static bool core_info_cache_write(core_info_list_t *list,
+      const char *info_dir)
+{
+   size_t i, j;
+   core_info_cache_header_t header;
+   core_info_cache_pool_t pool;
+   core_info_cache_record_t *records    = NULL;
+   core_info_cache_firmware_t *firmware = NULL;
+   size_t count                         = 0;
+   size_t firmware_count                = 0;
+   bool success                         = false;
+   char file_path[PATH_MAX_LENGTH];
+   struct file_write_block blocks[4];
 
-   rjsonwriter_raw(writer, "{", 1);
-   rjsonwriter_raw(writer, "\n", 1);
-   rjsonwriter_add_spaces(writer, 2);
-   rjsonwriter_add_string(writer, "version");
-   rjsonwriter_raw(writer, ":", 1);
-   rjsonwriter_raw(writer, " ", 1);
-   rjsonwriter_add_string(writer, CORE_INFO_CACHE_VERSION);
-   rjsonwriter_raw(writer, ",", 1);
-   rjsonwriter_raw(writer, "\n", 1);
-   rjsonwriter_add_spaces(writer, 2);
-   rjsonwriter_add_string(writer, "items");
-   rjsonwriter_raw(writer, ":", 1);
-   rjsonwriter_raw(writer, " ", 1);
-   rjsonwriter_raw(writer, "[", 1);
-   rjsonwriter_raw(writer, "\n", 1);
+   if (!list)
+      return false;
 
-   for (i = 0; i < list->length; i++)
+   for (i = 0; i < list->count; i++)
    {
-      core_info_t* info = &list->items[i];
-
-      if (!info || !info->is_installed)
-         continue;
-
-      if (i > 0)
+      if (list->list[i].core_file_id.str)
       {
-         rjsonwriter_raw(writer, ",", 1);
-         rjsonwriter_raw(writer, "\n", 1);
+         count++;
+         firmware_count += list->list[i].firmware_count;
       }
+   }
 
-      rjsonwriter_add_spaces(writer, 4);
-      rjsonwriter_raw(writer, "{", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "display_name");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->display_name);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "display_version");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->display_version);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "core_name");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->core_name);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "system_manufacturer");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->system_manufacturer);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "systemname");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->systemname);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "system_id");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->system_id);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "supported_extensions");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->supported_extensions);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "authors");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->authors);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "permissions");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->permissions);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "licenses");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->licenses);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "categories");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->categories);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "databases");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->databases);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "notes");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->notes);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "required_hw_api");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->required_hw_api);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "description");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->description);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      if (info->firmware_count > 0)
-      {
-         rjsonwriter_add_spaces(writer, 6);
-         rjsonwriter_add_string(writer, "firmware");
-         rjsonwriter_raw(writer, ":", 1);
-         rjsonwriter_raw(writer, " ", 1);
-         rjsonwriter_raw(writer, "[", 1);
-         rjsonwriter_raw(writer, "\n", 1);
-
-         for (j = 0; j < info->firmware_count; j++)
-         {
-            rjsonwriter_add_spaces(writer, 8);
-            rjsonwriter_raw(writer, "{", 1);
-            rjsonwriter_raw(writer, "\n", 1);
-            rjsonwriter_add_spaces(writer, 10);
-            rjsonwriter_add_string(writer, "path");
-            rjsonwriter_raw(writer, ":", 1);
-            rjsonwriter_raw(writer, " ", 1);
-            rjsonwriter_add_string(writer, info->firmware[j].path);
-            rjsonwriter_raw(writer, ",", 1);
-            rjsonwriter_raw(writer, "\n", 1);
-            rjsonwriter_add_spaces(writer, 10);
-            rjsonwriter_add_string(writer, "desc");
-            rjsonwriter_raw(writer, ":", 1);
-            rjsonwriter_raw(writer, " ", 1);
-            rjsonwriter_add_string(writer, info->firmware[j].desc);
-            rjsonwriter_raw(writer, ",", 1);
-            rjsonwriter_raw(writer, "\n", 1);
-            rjsonwriter_add_spaces(writer, 10);
-            rjsonwriter_add_string(writer, "optional");
-            rjsonwriter_raw(writer, ":", 1);
-            rjsonwriter_raw(writer, " ", 1);
-            {
-               bool value = info->firmware[j].optional;
-               rjsonwriter_raw(writer, (value ? "true" : "false"), (value ? 4 : 5));
-            }
-            rjsonwriter_raw(writer, "\n", 1);
-            rjsonwriter_add_spaces(writer, 8);
-            rjsonwriter_raw(writer, "}", 1);
+   pool.buf = NULL;
+   pool.oom = false;
+   /* Offset 0 stands for NULL */
+   if (     !RBUF_TRYFIT(pool.buf, 1)
+         || (count && !(records = (core_info_cache_record_t*)
+               calloc(count, sizeof(*records))))
+         || (firmware_count && !(firmware = (core_info_cache_firmware_t*)
+               calloc(firmware_count, sizeof(*firmware)))))
+      goto end;
+   RBUF_RESIZE(pool.buf, 1);
+   pool.buf[0]    = '\0';
 
-            if (j < info->firmware_count - 1)
-               rjsonwriter_raw(writer, ",", 1);
+   count          = 0;
+   firmware_count = 0;
 
-            rjsonwriter_raw(writer, "\n", 1);
-         }
+   for (i = 0; i < list->count; i++)
+   {
+      char **strings[CORE_INFO_CACHE_STRING_COUNT];
+      struct string_list **lists[CORE_INFO_CACHE_STRING_COUNT];
+      core_info_t *info                = &list->list[i];
+      core_info_cache_record_t *record = &records[count];
 
-         rjsonwriter_add_spaces(writer, 6);
-         rjsonwriter_raw(writer, "]", 1);
-         rjsonwriter_raw(writer, ",", 1);
-         rjsonwriter_raw(writer, "\n", 1);
-      }
+      if (!info->core_file_id.str)
+         continue;
 
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "core_file_id");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_raw(writer, "{", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-      rjsonwriter_add_spaces(writer, 8);
-      rjsonwriter_add_string(writer, "str");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->core_file_id.str);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-      rjsonwriter_add_spaces(writer, 8);
-      rjsonwriter_add_string(writer, "hash");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_rawf(writer, "%u", info->core_file_id.hash);
-      rjsonwriter_raw(writer, "\n", 1);
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_raw(writer, "}", 1);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "firmware_count");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_rawf(writer, "%u", info->firmware_count);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "savestate_support_level");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_rawf(writer, "%u", info->savestate_support_level);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "has_info");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
+      core_info_cache_get_fields(info, strings, lists);
+
+      for (j = 0; j < CORE_INFO_CACHE_STRING_COUNT; j++)
+         record->strings[j] = core_info_cache_add_string(&pool,
+               *strings[j]);
+
+      record->core_file_id_hash       = info->core_file_id.hash;
+      record->firmware                = (uint32_t)firmware_count;
+      record->firmware_count          = (uint32_t)info->firmware_count;
+      record->savestate_support_level = info->savestate_support_level;
+      if (info->has_info)
+         record->flags |= CORE_INFO_CACHE_FLG_HAS_INFO;
+      if (info->supports_no_game)
+         record->flags |= CORE_INFO_CACHE_FLG_SUPPORTS_NO_GAME;
+      if (info->single_purpose)
+         record->flags |= CORE_INFO_CACHE_FLG_SINGLE_PURPOSE;
+      if (info->database_match_archive_member)
+         record->flags |= CORE_INFO_CACHE_FLG_DATABASE_MATCH_ARCHIVE_MEMBER;
+      if (info->is_experimental)
+         record->flags |= CORE_INFO_CACHE_FLG_IS_EXPERIMENTAL;
+
+      for (j = 0; j < info->firmware_count; j++)
       {
-         bool value = info->has_info;
-         rjsonwriter_raw(writer, (value ? "true" : "false"), (value ? 4 : 5));
+         core_info_cache_firmware_t *dst = &firmware[firmware_count++];
+         dst->path     = core_info_cache_add_string(&pool,
+               info->firmware[j].path);
+         dst->desc     = core_info_cache_add_string(&pool,
+               info->firmware[j].desc);
+         dst->optional = info->firmware[j].optional ? 1 : 0;
       }
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
 
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "supports_no_game");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      {
-         bool value = info->supports_no_game;
-         rjsonwriter_raw(writer, (value ? "true" : "false"), (value ? 4 : 5));
-      }
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
+      count++;
+   }
 
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "single_purpose");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      {
-         bool value = info->single_purpose;
-         rjsonwriter_raw(writer, (value ? "true" : "false"), (value ? 4 : 5));
-      }
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
+   if (pool.oom || RBUF_LEN(pool.buf) > UINT32_MAX)
+      goto end;
 
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "database_match_archive_member");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      {
-         bool value = info->database_match_archive_member;
-         rjsonwriter_raw(writer, (value ? "true" : "false"), (value ? 4 : 5));
-      }
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, CORE_INFO_CACHE_MAGIC, sizeof(CORE_INFO_CACHE_MAGIC));
+   header.version        = CORE_INFO_CACHE_VERSION;
+   header.byte_order     = CORE_INFO_CACHE_BYTE_ORDER;
+   header.count          = (uint32_t)count;
+   header.firmware_count = (uint32_t)firmware_count;
+   header.pool_size      = (uint32_t)RBUF_LEN(pool.buf);
 
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "is_experimental");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      {
-         bool value = info->is_experimental;
-         rjsonwriter_raw(writer, (value ? "true" : "false"), (value ? 4 : 5));
-      }
-      rjsonwriter_raw(writer, "\n", 1);
+   /* Open info cache file */
+   if (string_is_empty(info_dir))
+      strlcpy(file_path, FILE_PATH_CORE_INFO_CACHE, sizeof(file_path));
+   else
+      fill_pathname_join_special(file_path, info_dir,
+            FILE_PATH_CORE_INFO_CACHE,
+            sizeof(file_path));
 
-      rjsonwriter_add_spaces(writer, 4);
-      rjsonwriter_raw(writer, "}", 1);
+   blocks[0].data = &header;
+   blocks[0].size = sizeof(header);
+   blocks[1].data = records;
+   blocks[1].size = (int64_t)(count * sizeof(*records));
+   blocks[2].data = firmware;
+   blocks[2].size = (int64_t)(firmware_count * sizeof(*firmware));
+   blocks[3].data = pool.buf;
+   blocks[3].size = (int64_t)RBUF_LEN(pool.buf);
+   if (!(success = file_write_atomic(file_path, blocks, ARRAY_SIZE(blocks))))
+   {
+      RARCH_ERR("[Core info] Failed to write core info cache file: \"%s\".\n", file_path);
+      goto end;
    }
 
-   rjsonwriter_raw(writer, "\n", 1);
-   rjsonwriter_add_spaces(writer, 2);
-   rjsonwriter_raw(writer, "]", 1);
-   rjsonwriter_raw(writer, "\n", 1);
-   rjsonwriter_raw(writer, "}", 1);
-   rjsonwriter_raw(writer, "\n", 1);
-   rjsonwriter_free(writer);
-
    RARCH_LOG("[Core info] Wrote to cache file: \"%s\".\n", file_path);
-   success = true;
 
    /* Remove 'force refresh' file, if required */
    if (string_is_empty(info_dir))
@@ -1213,10 +721,9 @@ static bool core_info_cache_write(core_info_cache_list_t *list, const char *info
       filestream_delete(file_path);
 
 end:
-   intfstream_close(file);
-   free(file);
-
-   list->refresh = false;
+   free(records);
+   free(firmware);
+   RBUF_FREE(pool.buf);
    return success;
 }
 
@@ -1682,6 +1189,96 @@ static config_file_t *core_info_get_config_file(
    return config_file_new_from_path_to_string(core_file_id);
 }
 
+#ifdef HAVE_THREADS
+/* Most cores loaded per worker before another is worth starting */
+#define CORE_INFO_LOAD_CORES_PER_WORKER 16
+#define CORE_INFO_LOAD_MAX_WORKERS      4
+
+typedef struct
+{
+   const char *info_dir;
+   char **info_files;
+   config_file_t **confs;
+   slock_t *lock;
+   size_t count;
+   size_t next;
+} core_info_load_pool_t;
+
+/* Reads .info files off the pool until none are left; reading one
+ * touches nothing but its own config_file_t */
+static void core_info_load_worker(void *data)
+{
+   core_info_load_pool_t *pool = (core_info_load_pool_t*)data;
+
+   for (;;)
+   {
+      size_t i;
+
+      slock_lock(pool->lock);
+      while (     (pool->next < pool->count)
+               && !pool->info_files[pool->next])
+         pool->next++;
+      i = pool->next++;
+      slock_unlock(pool->lock);
+
+      if (i >= pool->count)
+         break;
+
+      pool->confs[i] = core_info_get_config_file(
+            pool->info_files[i], pool->info_dir);
+   }
+}
+#endif
+
+/* Reads the .info file of each core with one in 'info_files',
+ * on a few workers when there are enough of them */
+static void core_info_load_config_files(const char *info_dir,
+      char **info_files, config_file_t **confs, size_t count,
+      size_t num_files)
+{
+   size_t i;
+#ifdef HAVE_THREADS
+   core_info_load_pool_t pool;
+   sthread_t *threads[CORE_INFO_LOAD_MAX_WORKERS];
+   unsigned num_threads = 0;
+   unsigned workers     = cpu_features_get_core_amount();
+
+   if (workers > CORE_INFO_LOAD_MAX_WORKERS)
+      workers = CORE_INFO_LOAD_MAX_WORKERS;
+   if (workers > num_files / CORE_INFO_LOAD_CORES_PER_WORKER)
+      workers = (unsigned)(num_files / CORE_INFO_LOAD_CORES_PER_WORKER);
+
+   if (workers > 1 && (pool.lock = slock_new()))
+   {
+      pool.info_dir   = info_dir;
+      pool.info_files = info_files;
+      pool.confs      = confs;
+      pool.count      = count;
+      pool.next       = 0;
+
+      /* This thread is one of the workers */
+      while (num_threads < workers - 1)
+      {
+         if (!(threads[num_threads] = sthread_create(
+                     core_info_load_worker, &pool)))
+            break;
+         num_threads++;
+      }
+
+      core_info_load_worker(&pool);
+
+      for (i = 0; i < num_threads; i++)
+         sthread_join(threads[i]);
+      slock_free(pool.lock);
+      return;
+   }
+#endif
+
+   for (i = 0; i < count; i++)
+      if (info_files[i])
+         confs[i] = core_info_get_config_file(info_files[i], info_dir);
+}
+
 static void core_info_parse_config_file(
       core_info_list_t *list, core_info_t *info,
       config_file_t *conf)
@@ -2007,7 +1604,12 @@ static core_info_list_t *core_info_list_new(const char *path,
    core_info_t *core_info                       = NULL;
    core_info_list_t *core_info_list             = NULL;
    core_info_cache_list_t *core_info_cache_list = NULL;
+   char **info_files                            = NULL;
+   config_file_t **confs                        = NULL;
+   size_t num_info_files                        = 0;
+   size_t num_cached                            = 0;
    const char *info_dir                         = libretro_info_dir;
+   retro_time_t start_time                      = cpu_features_get_time_usec();
    core_path_list_t *path_list                  = core_info_path_list_new(
          path, exts, dir_show_hidden_files);
    if (!path_list)
@@ -2038,10 +1640,30 @@ static core_info_list_t *core_info_list_new(const char *path,
    core_info_list->list  = core_info;
    core_info_list->count = path_list->core_list->size;
 
+   if (path_list->core_list->size > 0)
+   {
+      info_files = (char**)calloc(path_list->core_list->size,
+            sizeof(*info_files));
+      confs      = (config_file_t**)calloc(path_list->core_list->size,
+            sizeof(*confs));
+   }
+
+   if (path_list->core_list->size > 0 && (!info_files || !confs))
+   {
+      free(info_files);
+      free(confs);
+      core_info_list_free(core_info_list);
+      core_info_path_list_free(path_list);
+      free(core_info_list);
+      return NULL;
+   }
+
 #ifdef HAVE_CORE_INFO_CACHE
    /* Read core info cache, if enabled */
    if (enable_cache && !(core_info_cache_list = core_info_cache_read(info_dir)))
    {
+      free(info_files);
+      free(confs);
       core_info_list_free(core_info_list);
       core_info_path_list_free(path_list);
       free(core_info_list);
@@ -2054,7 +1676,6 @@ static core_info_list_t *core_info_list_new(const char *path,
    for (i = 0; i < path_list->core_list->size; i++)
    {
       char core_file_id[256];
-      config_file_t *conf         = NULL;
       core_info_t *info           = &core_info[i];
       core_file_path_t *core_file = &path_list->core_list->list[i];
       const char *base_path       = core_file->path;
@@ -2073,7 +1694,9 @@ static core_info_list_t *core_info_list_new(const char *path,
 
          if (info_cache)
          {
-            core_info_copy(info_cache, info);
+            /* The cache list is done with the entry once
+             * it is found, so it can be taken as it is */
+            core_info_transfer(info_cache, info);
 
             /* Core path is 'dynamic', and cannot
              * be cached (i.e. core directory may
@@ -2103,6 +1726,7 @@ static core_info_list_t *core_info_list_new(const char *path,
             if (info->has_info)
                core_info_list->info_count++;
 
+            num_cached++;
             continue;
          }
       }
@@ -2119,19 +1743,38 @@ static core_info_list_t *core_info_list_new(const char *path,
       info->core_file_id.hash = core_info_hash_string(core_file_id);
 
       strlcpy(core_file_id + _len, ".info", sizeof(core_file_id) - _len);
+      info_files[i] = strdup(core_file_id);
+      num_info_files++;
+   }
+
+   /* Reading the .info files of uncached cores is what
+    * takes the time; parsing their entries is cheap and
+    * updates the list, so stays on this thread */
+   if (num_info_files > 0)
+      core_info_load_config_files(info_dir, info_files, confs,
+            path_list->core_list->size, num_info_files);
+
+   for (i = 0; i < path_list->core_list->size; i++)
+   {
+      core_info_t *info         = &core_info[i];
+      const char *core_filename = path_list->core_list->list[i].filename;
+
+      if (!info_files[i])
+         continue;
 
       /* Parse core info file */
-      if ((conf = core_info_get_config_file(core_file_id, info_dir)))
+      if (confs[i])
       {
-         core_info_parse_config_file(core_info_list, info, conf);
-         config_file_free(conf);
+         core_info_parse_config_file(core_info_list, info, confs[i]);
+         config_file_free(confs[i]);
       }
-
       /* Start with 'full' savestate support when info is missing */
-      if (!conf)
+      else
          info->savestate_support_level =
                CORE_INFO_SAVESTATE_DETERMINISTIC;
 
+      free(info_files[i]);
+
       /* Get fallback display name, if required */
       if (!info->display_name)
          info->display_name = strdup(core_filename);
@@ -2146,15 +1789,14 @@ static core_info_list_t *core_info_list_new(const char *path,
 
       /* If info cache is enabled and we reach this
        * point, current core is uncached
-       * > Add it to the list, and trigger a cache
-       *   refresh */
+       * > Trigger a cache refresh */
       if (core_info_cache_list)
-      {
-         core_info_cache_add(core_info_cache_list, info, false);
          core_info_cache_list->refresh = true;
-      }
    }
 
+   free(info_files);
+   free(confs);
+
    core_info_list_resolve_all_extensions(core_info_list);
 
    /* If info cache is enabled
@@ -2170,13 +1812,17 @@ static core_info_list_t *core_info_list_new(const char *path,
 
       if (core_info_cache_list->refresh)
          *cache_supported = core_info_cache_write(
-               core_info_cache_list, info_dir);
+               core_info_list, info_dir);
 
       core_info_cache_list_free(core_info_cache_list);
       free(core_info_cache_list);
       core_info_cache_list = NULL;
    }
 
+   RARCH_LOG("[Core info] Loaded %u cores (%u from cache) in %.1f ms.\n",
+         (unsigned)core_info_list->count, (unsigned)num_cached,
+         (cpu_features_get_time_usec() - start_time) / 1000.0f);
+
    core_info_path_list_free(path_list);
    return core_info_list;
 }
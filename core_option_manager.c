@@ -598,6 +598,32 @@ static uint32_t core_option_manager_hash_string(const char *str)
    return (hash ? hash : 1);
 }
 
+/* Indexes the options by key hash, so that
+ * RETRO_ENVIRONMENT_GET_VARIABLE doesn't scan every
+ * option of cores that have hundreds. Duplicate keys
+ * keep the first option, as the scan did */
+static void core_option_manager_build_key_index(core_option_manager_t *opt)
+{
+   size_t i;
+   size_t capacity = 4;
+
+   /* Half full at most */
+   while (capacity < opt->size * 2)
+      capacity <<= 1;
+
+   if (!(opt->key_index = (size_t*)calloc(capacity, sizeof(size_t))))
+      return;
+   opt->key_index_mask = capacity - 1;
+
+   for (i = 0; i < opt->size; i++)
+   {
+      size_t slot = opt->opts[i].key_hash & opt->key_index_mask;
+      while (opt->key_index[slot])
+         slot = (slot + 1) & opt->key_index_mask;
+      opt->key_index[slot] = i + 1;
+   }
+}
+
 /* Sanitises a core option value label, handling the case
  * where an explicit label is not provided and performing
  * conversion of various true/false identifiers to
@@ -653,13 +679,82 @@ static const char *core_option_manager_parse_value_label(
    return label;
 }
 
+/* Sets the current value of each parsed option from
+ * 'conf', looking all of the keys up in one pass over
+ * the file. Options whose value is missing or unknown
+ * keep their default. */
+static bool core_option_manager_load_values(
+      core_option_manager_t *opt, config_file_t *conf)
+{
+   size_t i, j;
+   size_t count                 = 0;
+   bool success                 = false;
+   const char **values          = NULL;
+   struct config_bind *binds    = NULL;
+   config_bind_table_t table;
+
+   if (!conf)
+      return true;
+
+   if (   !(values = (const char**)calloc(opt->size, sizeof(*values)))
+       || !(binds  = (struct config_bind*)malloc(
+             opt->size * sizeof(*binds))))
+      goto end;
+
+   for (i = 0; i < opt->size; i++)
+   {
+      if (!opt->opts[i].key)
+         continue;
+      binds[count].key  = opt->opts[i].key;
+      binds[count].ptr  = (void*)&values[i];
+      binds[count].len  = 0;
+      binds[count].type = CONFIG_BIND_VALUE;
+      count++;
+   }
+
+   if (!config_bind_table_init(&table, binds, count))
+      goto end;
+   config_bind_table_apply(&table, conf);
+   config_bind_table_free(&table);
+
+   for (i = 0; i < opt->size; i++)
+   {
+      struct core_option *option = &opt->opts[i];
+      uint32_t entry_value_hash;
+
+      if (string_is_empty(values[i]))
+         continue;
+
+      entry_value_hash = core_option_manager_hash_string(values[i]);
+
+      for (j = 0; j < option->vals->size; j++)
+      {
+         const char *value   = option->vals->elems[j].data;
+         uint32_t value_hash = *((uint32_t*)option->vals->elems[j].userdata);
+
+         if (   (value_hash == entry_value_hash)
+             && string_is_equal(value, values[i]))
+         {
+            option->index = j;
+            break;
+         }
+      }
+   }
+
+   success = true;
+
+end:
+   free(binds);
+   free(values);
+   return success;
+}
+
 /* Parses a single legacy core options interface
  * variable, extracting all present core_option
  * information */
 static bool core_option_manager_parse_variable(
       core_option_manager_t *opt, size_t idx,
-      const struct retro_variable *var,
-      config_file_t *config_src)
+      const struct retro_variable *var)
 {
    size_t i;
    union string_list_elem_attr attr;
@@ -667,8 +762,6 @@ static bool core_option_manager_parse_variable(
    char *value                = NULL;
    char *desc_end             = NULL;
    struct core_option *option = (struct core_option*)&opt->opts[idx];
-   struct config_entry_list
-         *entry               = NULL;
 
    /* Record option index (required to facilitate
     * option map handling) */
@@ -739,30 +832,6 @@ static bool core_option_manager_parse_variable(
    option->default_index = 0;
    option->index         = 0;
 
-   if (config_src)
-      entry              = config_get_entry(config_src, option->key);
-   else
-      entry              = config_get_entry(opt->conf,  option->key);
-
-   /* Set current config value */
-   if (entry && !string_is_empty(entry->value))
-   {
-      uint32_t entry_value_hash = core_option_manager_hash_string(entry->value);
-
-      for (i = 0; i < option->vals->size; i++)
-      {
-         const char *value   = option->vals->elems[i].data;
-         uint32_t value_hash = *((uint32_t*)option->vals->elems[i].userdata);
-
-         if (   (value_hash == entry_value_hash)
-             && string_is_equal(value, entry->value))
-         {
-            option->index = i;
-            break;
-         }
-      }
-   }
-
    /* Legacy core option interface has no concept
     * of categories */
    option->desc_categorized = NULL;
@@ -818,6 +887,8 @@ core_option_manager_t *core_option_manager_new_vars(
    opt->opts                        = NULL;
    opt->size                        = 0;
    opt->option_map                  = nested_list_init();
+   opt->key_index                   = NULL;
+   opt->key_index_mask              = 0;
    opt->updated                     = false;
 
    if (!opt->option_map)
@@ -852,7 +923,7 @@ core_option_manager_t *core_option_manager_new_vars(
    /* Parse each variable */
    for (var = vars; var->key && var->value; _len++, var++)
    {
-      if (core_option_manager_parse_variable(opt, _len, var, config_src))
+      if (core_option_manager_parse_variable(opt, _len, var))
       {
          size_t __len = 0;
          /* If variable is read correctly, add it to
@@ -879,6 +950,13 @@ core_option_manager_t *core_option_manager_new_vars(
          goto error;
    }
 
+   core_option_manager_build_key_index(opt);
+
+   /* Set current config values */
+   if (!core_option_manager_load_values(opt,
+            config_src ? config_src : opt->conf))
+      goto error;
+
    if (config_src)
       config_file_free(config_src);
 
@@ -896,13 +974,10 @@ error:
  * information */
 static bool core_option_manager_parse_option(
       core_option_manager_t *opt, size_t idx,
-      const struct retro_core_option_v2_definition *option_def,
-      config_file_t *config_src)
+      const struct retro_core_option_v2_definition *option_def)
 {
    size_t i;
    union string_list_elem_attr attr;
-   struct config_entry_list
-      *entry                  = NULL;
    size_t num_vals            = 0;
    struct core_option *option = (struct core_option*)&opt->opts[idx];
    const char *key            = option_def->key;
@@ -1028,30 +1103,6 @@ static bool core_option_manager_parse_option(
       }
    }
 
-   if (config_src)
-      entry              = config_get_entry(config_src, option->key);
-   else
-      entry              = config_get_entry(opt->conf,  option->key);
-
-   /* Set current config value */
-   if (entry && !string_is_empty(entry->value))
-   {
-      uint32_t entry_value_hash = core_option_manager_hash_string(entry->value);
-
-      for (i = 0; i < option->vals->size; i++)
-      {
-         const char *value   = option->vals->elems[i].data;
-         uint32_t value_hash = *((uint32_t*)option->vals->elems[i].userdata);
-
-         if ((value_hash == entry_value_hash) &&
-             string_is_equal(value, entry->value))
-         {
-            option->index = i;
-            break;
-         }
-      }
-   }
-
    return true;
 }
 
@@ -1106,6 +1157,8 @@ core_option_manager_t *core_option_manager_new(
    opt->opts                         = NULL;
    opt->size                         = 0;
    opt->option_map                   = nested_list_init();
+   opt->key_index                    = NULL;
+   opt->key_index_mask               = 0;
    opt->updated                      = false;
 
    if (!opt->option_map)
@@ -1183,7 +1236,7 @@ core_option_manager_t *core_option_manager_new(
         option_def->key && option_def->desc && option_def->values[0].value;
         _len++, option_def++)
    {
-      if (core_option_manager_parse_option(opt, _len, option_def, config_src))
+      if (core_option_manager_parse_option(opt, _len, option_def))
       {
          /* If option is read correctly, add it to
           * the map */
@@ -1220,6 +1273,13 @@ core_option_manager_t *core_option_manager_new(
          goto error;
    }
 
+   core_option_manager_build_key_index(opt);
+
+   /* Set current config values */
+   if (!core_option_manager_load_values(opt,
+            config_src ? config_src : opt->conf))
+      goto error;
+
    if (config_src)
       config_file_free(config_src);
 
@@ -1301,6 +1361,7 @@ void core_option_manager_free(core_option_manager_t *opt)
 
    free(opt->cats);
    free(opt->opts);
+   free(opt->key_index);
    free(opt);
 }
 
@@ -1467,6 +1528,26 @@ bool core_option_manager_get_idx(core_option_manager_t *opt,
 
    key_hash = core_option_manager_hash_string(key);
 
+   if (opt->key_index)
+   {
+      size_t slot = key_hash & opt->key_index_mask;
+
+      for (; opt->key_index[slot]; slot = (slot + 1) & opt->key_index_mask)
+      {
+         struct core_option *option = &opt->opts[opt->key_index[slot] - 1];
+
+         if (   (key_hash == option->key_hash)
+             && !string_is_empty(option->key)
+             &&  string_is_equal(key, option->key))
+         {
+            *idx = opt->key_index[slot] - 1;
+            return true;
+         }
+      }
+
+      return false;
+   }
+
    for (i = 0; i < opt->size; i++)
    {
       struct core_option *option = &opt->opts[i];
@@ -71,9 +71,14 @@ struct core_option_manager
    struct core_category *cats;
    struct core_option *opts;
    nested_list_t *option_map;
+   /* Open-addressed table of option index + 1 (0 = empty),
+    * probed from key_hash; NULL if it couldn't be built,
+    * in which case lookups scan opts */
+   size_t *key_index;
 
    size_t cats_size;
    size_t size;
+   size_t key_index_mask;
 
    bool updated;
 };
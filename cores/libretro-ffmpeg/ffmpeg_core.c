@@ -67,6 +67,14 @@ extern "C" {
 
 #define HAVE_CH_LAYOUT (LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57, 28, 100))
 
+/* Desktop GL takes 4:2:0 frames as planes and converts them to RGB
+ * in a shader, so those skip swscale and the RGB copy. */
+#if defined(HAVE_OPENGL) && !defined(HAVE_OPENGLES)
+#define ENABLE_GL_YUV 1
+#else
+#define ENABLE_GL_YUV 0
+#endif
+
 static bool reset_triggered;
 static bool libretro_supports_bitmasks = false;
 
@@ -194,6 +202,18 @@ static GLint tex_loc;
 static GLint mix_loc;
 #endif
 
+#if ENABLE_GL_YUV
+static bool gl_yuv_conversion = true;
+static GLuint yuv_prog;
+static GLuint yuv_fbo;
+static GLuint yuv_tex[3];
+static GLint yuv_vertex_loc;
+static GLint yuv_tex_loc;
+static GLint yuv_nv12_loc;
+static GLint yuv_luma_loc;
+static GLint yuv_coeffs_loc;
+#endif
+
 static struct
 {
    double interpolate_fps;
@@ -323,6 +343,9 @@ void CORE_PREFIX(retro_set_environment)(retro_environment_t cb)
       { "ffmpeg_sw_decoder_threads", "Software decoder thread count (restart); auto|1|2|4|6|8|10|12|14|16" },
 #if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
       { "ffmpeg_temporal_interp", "Temporal Interpolation; disabled|enabled" },
+#if ENABLE_GL_YUV
+      { "ffmpeg_gpu_color_conversion", "GPU color conversion; enabled|disabled" },
+#endif
 #ifdef HAVE_GL_FFT
       { "ffmpeg_fft_resolution", "FFT Resolution; 1280x720|1920x1080|2560x1440|3840x2160|640x360|320x180" },
       { "ffmpeg_fft_multisample", "FFT Multisample; 1x|2x|4x" },
@@ -406,6 +429,14 @@ static void check_variables(bool firststart)
          temporal_interpolation = false;
    }
 
+#if ENABLE_GL_YUV
+   var.key   = "ffmpeg_gpu_color_conversion";
+   var.value = NULL;
+
+   if (CORE_PREFIX(environ_cb)(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      gl_yuv_conversion = !string_is_equal(var.value, "disabled");
+#endif
+
 #ifdef HAVE_GL_FFT
    fft_var.key = "ffmpeg_fft_resolution";
 
@@ -611,6 +642,118 @@ static void seek_frame(int seek_frames)
    slock_unlock(fifo_lock);
 }
 
+/* The YUV to RGB coefficients of the colorspace option, or of the
+ * frame when it is on auto: crv, cbu, cgu and cgv, scaled by 65536. */
+static const int *get_colorspace_coeffs(unsigned width, unsigned height,
+      enum AVColorSpace default_color)
+{
+   if (colorspace != AVCOL_SPC_UNSPECIFIED)
+      return sws_getCoefficients(colorspace);
+   if (default_color != AVCOL_SPC_UNSPECIFIED)
+      return sws_getCoefficients(default_color);
+   if (width >= 1280 || height > 576)
+      return sws_getCoefficients(AVCOL_SPC_BT709);
+   return sws_getCoefficients(AVCOL_SPC_BT470BG);
+}
+
+#if ENABLE_GL_YUV
+static void upload_yuv_plane(GLuint tex, GLenum format,
+      unsigned width, unsigned height, const uint8_t *data, int row_length)
+{
+   glBindTexture(GL_TEXTURE_2D, tex);
+   glPixelStorei(GL_UNPACK_ROW_LENGTH, row_length);
+   glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0,
+         format, GL_UNSIGNED_BYTE, data);
+}
+
+/* Uploads the planes of a 4:2:0 frame and converts them into the
+ * RGB texture of frames[1], which is then mixed as usual. */
+static void convert_yuv_frame(video_decoder_context_t *ctx)
+{
+   unsigned i;
+   GLfloat luma[2];
+   GLfloat coeffs[4];
+   const AVFrame *frame  = ctx->planes;
+   bool nv12             = frame->format == AV_PIX_FMT_NV12;
+   bool full_range       = frame->color_range == AVCOL_RANGE_JPEG
+      || frame->format == AV_PIX_FMT_YUVJ420P;
+   unsigned chroma_width = (media.width  + 1) / 2;
+   unsigned chroma_height = (media.height + 1) / 2;
+   const int *table      = get_colorspace_coeffs(media.width, media.height,
+         frame->colorspace);
+
+   if (!table)
+      table = sws_getCoefficients(SWS_CS_DEFAULT);
+
+   /* Same scaling as swscale: limited range stretches luma,
+    * full range narrows the chroma coefficients */
+   for (i = 0; i < 4; i++)
+      coeffs[i] = table[i] / 65536.0f * (full_range ? 224.0f / 255.0f : 1.0f);
+   luma[0] = full_range ? 0.0f : 16.0f  / 255.0f;
+   luma[1] = full_range ? 1.0f : 255.0f / 219.0f;
+
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+   upload_yuv_plane(yuv_tex[0], GL_LUMINANCE, media.width, media.height,
+         frame->data[0], frame->linesize[0]);
+   if (nv12)
+      upload_yuv_plane(yuv_tex[1], GL_LUMINANCE_ALPHA,
+            chroma_width, chroma_height, frame->data[1], frame->linesize[1] / 2);
+   else
+   {
+      upload_yuv_plane(yuv_tex[1], GL_LUMINANCE,
+            chroma_width, chroma_height, frame->data[1], frame->linesize[1]);
+      upload_yuv_plane(yuv_tex[2], GL_LUMINANCE,
+            chroma_width, chroma_height, frame->data[2], frame->linesize[2]);
+   }
+   glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+   glBindFramebuffer(GL_FRAMEBUFFER, yuv_fbo);
+   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+         GL_TEXTURE_2D, frames[1].tex, 0);
+   glViewport(0, 0, media.width, media.height);
+   glUseProgram(yuv_prog);
+
+   glUniform1f(yuv_nv12_loc, nv12 ? 1.0f : 0.0f);
+   glUniform2fv(yuv_luma_loc, 1, luma);
+   glUniform4fv(yuv_coeffs_loc, 1, coeffs);
+   for (i = 3; i-- > 0; )
+   {
+      glActiveTexture(GL_TEXTURE0 + i);
+      glBindTexture(GL_TEXTURE_2D, yuv_tex[i]);
+   }
+
+   glBindBuffer(GL_ARRAY_BUFFER, vbo);
+   glVertexAttribPointer(yuv_vertex_loc, 2, GL_FLOAT, GL_FALSE,
+         4 * sizeof(GLfloat), (const GLvoid*)(0 * sizeof(GLfloat)));
+   glVertexAttribPointer(yuv_tex_loc, 2, GL_FLOAT, GL_FALSE,
+         4 * sizeof(GLfloat), (const GLvoid*)(2 * sizeof(GLfloat)));
+   glEnableVertexAttribArray(yuv_vertex_loc);
+   glEnableVertexAttribArray(yuv_tex_loc);
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+   glDisableVertexAttribArray(yuv_vertex_loc);
+   glDisableVertexAttribArray(yuv_tex_loc);
+
+   glUseProgram(0);
+   for (i = 3; i-- > 0; )
+   {
+      glActiveTexture(GL_TEXTURE0 + i);
+      glBindTexture(GL_TEXTURE_2D, 0);
+   }
+   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+         GL_TEXTURE_2D, 0, 0);
+   glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+   av_frame_unref(ctx->source);
+#if ENABLE_HW_ACCEL
+   av_frame_unref(ctx->hw_source);
+#endif
+   ctx->planes = NULL;
+}
+#endif
+
 void CORE_PREFIX(retro_run)(void)
 {
    static bool last_left;
@@ -839,38 +982,45 @@ void CORE_PREFIX(retro_run)(void)
                video_buffer_get_finished_slot(video_buffer, &ctx);
                pts                          = ctx->pts;
 
+#if ENABLE_GL_YUV
+               if (ctx->planes)
+                  convert_yuv_frame(ctx);
+               else
+#endif
+               {
 #ifdef HAVE_OPENGLES
-               data                         = video_frame_temp_buffer;
+                  data                      = video_frame_temp_buffer;
 #else
-               glBindBuffer(GL_PIXEL_UNPACK_BUFFER, frames[1].pbo);
+                  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, frames[1].pbo);
 #ifdef __MACH__
-               data                         = (uint32_t*)glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+                  data                      = (uint32_t*)glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
 #else
-               data                         = (uint32_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
-                     0, media.width * media.height * sizeof(uint32_t), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+                  data                      = (uint32_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+                        0, media.width * media.height * sizeof(uint32_t), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
 #endif
 #endif
-               src                          = ctx->target->data[0];
-               stride                       = ctx->target->linesize[0];
-               width                        = media.width * sizeof(uint32_t);
-               for (y = 0; y < media.height; y++, src += stride, data += width/4)
-                  memcpy(data, src, width);
+                  src                       = ctx->target->data[0];
+                  stride                    = ctx->target->linesize[0];
+                  width                     = media.width * sizeof(uint32_t);
+                  for (y = 0; y < media.height; y++, src += stride, data += width/4)
+                     memcpy(data, src, width);
 
 #ifndef HAVE_OPENGLES
-               glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
 #endif
-               glBindTexture(GL_TEXTURE_2D, frames[1].tex);
+                  glBindTexture(GL_TEXTURE_2D, frames[1].tex);
 #if defined(HAVE_OPENGLES)
-               glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
-                     media.width, media.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, video_frame_temp_buffer);
+                  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
+                        media.width, media.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, video_frame_temp_buffer);
 #else
-               glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
-                     media.width, media.height, 0, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, NULL);
+                  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
+                        media.width, media.height, 0, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, NULL);
 #endif
-               glBindTexture(GL_TEXTURE_2D, 0);
+                  glBindTexture(GL_TEXTURE_2D, 0);
 #ifndef HAVE_OPENGLES
-               glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 #endif
+               }
                video_buffer_open_slot(video_buffer, ctx);
             }
 
@@ -1376,19 +1526,7 @@ static void set_colorspace(struct SwsContext *sws,
       unsigned width, unsigned height,
       enum AVColorSpace default_color, int in_range)
 {
-   const int *coeffs = NULL;
-
-   if (colorspace == AVCOL_SPC_UNSPECIFIED)
-   {
-      if (default_color != AVCOL_SPC_UNSPECIFIED)
-         coeffs = sws_getCoefficients(default_color);
-      else if (width >= 1280 || height > 576)
-         coeffs = sws_getCoefficients(AVCOL_SPC_BT709);
-      else
-         coeffs = sws_getCoefficients(AVCOL_SPC_BT470BG);
-   }
-   else
-      coeffs = sws_getCoefficients(colorspace);
+   const int *coeffs = get_colorspace_coeffs(width, height, default_color);
 
    if (coeffs)
    {
@@ -1460,6 +1598,34 @@ static void render_ass_img(AVFrame *conv_frame, ASS_Image *img)
 }
 #endif
 
+#if ENABLE_GL_YUV
+/* Whether the GL path can convert the frame itself. */
+static bool frame_is_gl_yuv(const video_decoder_context_t *ctx,
+      const AVFrame *frame)
+{
+   if (!use_gl || !gl_yuv_conversion)
+      return false;
+
+#ifdef HAVE_SSA
+   /* Subtitles are blended into the RGB frame */
+   if (ctx->ass_track_active)
+      return false;
+#endif
+
+   switch (frame->format)
+   {
+      case AV_PIX_FMT_NV12:
+      case AV_PIX_FMT_YUV420P:
+      case AV_PIX_FMT_YUVJ420P:
+         return true;
+      default:
+         break;
+   }
+
+   return false;
+}
+#endif
+
 static void sws_worker_thread(void *arg)
 {
    int ret = 0;
@@ -1473,6 +1639,26 @@ static void sws_worker_thread(void *arg)
 #endif
       tmp_frame = ctx->source;
 
+#if ENABLE_GL_YUV
+   /* Keep the planes for the main thread, which uploads and
+    * releases them */
+   if (frame_is_gl_yuv(ctx, tmp_frame))
+   {
+      ctx->planes = tmp_frame;
+      ctx->pts    = ctx->source->best_effort_timestamp;
+#if ENABLE_HW_ACCEL
+      /* The download leaves the color properties behind */
+      if (tmp_frame != ctx->source)
+      {
+         av_frame_copy_props(tmp_frame, ctx->source);
+         av_frame_unref(ctx->source);
+      }
+#endif
+      video_buffer_finish_slot(video_buffer, ctx);
+      return;
+   }
+#endif
+
    ctx->sws = sws_getCachedContext(ctx->sws,
          media.width, media.height, (enum AVPixelFormat)tmp_frame->format,
          media.width, media.height, AV_PIX_FMT_RGB32,
@@ -1551,6 +1737,7 @@ static void decode_video(AVCodecContext *ctx, AVPacket *pkt, size_t frame_size)
    while (!decode_thread_dead && video_buffer_has_open_slot(video_buffer))
    {
       video_buffer_get_open_slot(video_buffer, &decoder_ctx);
+      decoder_ctx->planes = NULL;
 
       ret = avcodec_receive_frame(ctx, decoder_ctx->source);
       if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
@@ -1968,6 +2155,9 @@ static void context_destroy(void)
 #else
 #include "gl_shaders/ffmpeg.glsl.frag.h"
 #endif
+#if ENABLE_GL_YUV
+#include "gl_shaders/ffmpeg_yuv.glsl.frag.h"
+#endif
 
 static void context_reset(void)
 {
@@ -2015,6 +2205,41 @@ static void context_reset(void)
 
    glUseProgram(0);
 
+#if ENABLE_GL_YUV
+   yuv_prog = glCreateProgram();
+   frag     = glCreateShader(GL_FRAGMENT_SHADER);
+
+   glShaderSource(frag, 1, &yuv_fragment_source, NULL);
+   glCompileShader(frag);
+   glAttachShader(yuv_prog, vert);
+   glAttachShader(yuv_prog, frag);
+   glLinkProgram(yuv_prog);
+
+   glUseProgram(yuv_prog);
+
+   glUniform1i(glGetUniformLocation(yuv_prog, "sY"), 0);
+   glUniform1i(glGetUniformLocation(yuv_prog, "sU"), 1);
+   glUniform1i(glGetUniformLocation(yuv_prog, "sV"), 2);
+   yuv_vertex_loc = glGetAttribLocation(yuv_prog, "aVertex");
+   yuv_tex_loc    = glGetAttribLocation(yuv_prog, "aTexCoord");
+   yuv_nv12_loc   = glGetUniformLocation(yuv_prog, "uNV12");
+   yuv_luma_loc   = glGetUniformLocation(yuv_prog, "uLuma");
+   yuv_coeffs_loc = glGetUniformLocation(yuv_prog, "uCoeffs");
+
+   glUseProgram(0);
+
+   glGenFramebuffers(1, &yuv_fbo);
+   glGenTextures(3, yuv_tex);
+   for (i = 0; i < 3; i++)
+   {
+      glBindTexture(GL_TEXTURE_2D, yuv_tex[i]);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+   }
+#endif
+
    for (i = 0; i < 2; i++)
    {
       glGenTextures(1, &frames[i].tex);
@@ -2024,6 +2249,11 @@ static void context_reset(void)
       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+#if ENABLE_GL_YUV
+      /* Storage for convert_yuv_frame() to render into */
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, media.width, media.height,
+            0, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, NULL);
+#endif
 
 #if !defined(HAVE_OPENGLES)
       glGenBuffers(1, &frames[i].pbo);
@@ -0,0 +1,19 @@
+#include "shaders_common.h"
+
+/* 4:2:0 to RGB. sU holds both chroma planes for NV12 (U in .r, V in .a),
+ * otherwise sU and sV hold one each. */
+static const char *yuv_fragment_source = GLSL(
+      varying vec2 vTex;
+      uniform sampler2D sY;
+      uniform sampler2D sU;
+      uniform sampler2D sV;
+      uniform float uNV12;
+      uniform vec2 uLuma;
+      uniform vec4 uCoeffs;
+
+      void main() {
+         float y = (texture2D(sY, vTex).r - uLuma.x) * uLuma.y;
+         vec2 c  = mix(vec2(texture2D(sU, vTex).r, texture2D(sV, vTex).r), texture2D(sU, vTex).ra, uNV12) - vec2(0.5);
+         gl_FragColor = vec4(y + uCoeffs.x * c.y, y - uCoeffs.z * c.x - uCoeffs.w * c.y, y + uCoeffs.y * c.x, 1.0);
+      }
+);
@@ -68,6 +68,7 @@ video_buffer_t *video_buffer_create(
    {
       b->buffer[i].index     = i;
       b->buffer[i].pts       = 0;
+      b->buffer[i].planes    = NULL;
       b->buffer[i].sws       = sws_alloc_context();
       b->buffer[i].source    = av_frame_alloc();
 #if ENABLE_HW_ACCEL
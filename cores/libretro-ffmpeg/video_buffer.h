@@ -53,6 +53,9 @@ struct video_decoder_context
    AVFrame *hw_source;
 #endif
    AVFrame *target;
+   /* Set instead of filling target when the frame is left in YUV
+    * for the GL path to convert; points at source or hw_source. */
+   AVFrame *planes;
 #ifdef HAVE_SSA
    ASS_Track *ass_track_active;
 #endif
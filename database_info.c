@@ -750,11 +750,59 @@ static int database_cursor_iterate(libretrodb_cursor_t *cur,
    return 0;
 }
 
+/* Opens @cur on the items that have one of @keys in field @key,
+ * looked up in the key index of @db */
+static int database_cursor_open_keys(libretrodb_t *db,
+      libretrodb_cursor_t *cur, libretrodb_query_t *q,
+      const libretrodb_key_index_t *idx, enum libretrodb_key key,
+      const uint32_t *keys, size_t count)
+{
+   size_t i;
+   int ret           = -1;
+   size_t total      = 0;
+   size_t cap        = count;
+   uint64_t *offsets = (uint64_t*)malloc(cap * sizeof(*offsets));
+
+   if (!offsets)
+      return -1;
+
+   for (i = 0; i < count; i++)
+   {
+      size_t found = libretrodb_key_index_find(idx, key, keys[i],
+            offsets + total, cap - total);
+
+      if (found > cap - total)
+      {
+         uint64_t *new_offsets;
+         cap        = total + found + count;
+         if (!(new_offsets = (uint64_t*)realloc(offsets,
+                     cap * sizeof(*offsets))))
+            goto end;
+         offsets    = new_offsets;
+         libretrodb_key_index_find(idx, key, keys[i],
+               offsets + total, cap - total);
+      }
+      total += found;
+   }
+
+   ret = libretrodb_cursor_open_offsets(db, cur, q, offsets, total);
+
+end:
+   free(offsets);
+   return ret;
+}
+
+/* With @count keys, only visits the items that have one of them in
+ * field @key when the database has a key index; the query still
+ * decides which of those match */
 static int database_cursor_open(libretrodb_t *db,
-      libretrodb_cursor_t *cur, const char *path, const char *query)
+      libretrodb_cursor_t *cur, const char *path, const char *query,
+      enum libretrodb_key key, const uint32_t *keys, size_t count)
 {
-   const char *err       = NULL;
-   libretrodb_query_t *q = NULL;
+   int ret                     = -1;
+   const char *err             = NULL;
+   libretrodb_query_t *q       = NULL;
+   libretrodb_key_index_t *idx = NULL;
 
    if ((libretrodb_open(path, db, false)) != 0)
       return -1;
@@ -763,7 +811,18 @@ static int database_cursor_open(libretrodb_t *db,
       q = (libretrodb_query_t*)libretrodb_query_compile(db, query,
       strlen(query), &err);
 
-   if (err || (libretrodb_cursor_open(db, cur, q)) != 0)
+   if (!err)
+   {
+      if (count && (idx = libretrodb_key_index_open(db)))
+      {
+         ret = database_cursor_open_keys(db, cur, q, idx, key, keys, count);
+         libretrodb_key_index_close(idx);
+      }
+      else
+         ret = libretrodb_cursor_open(db, cur, q);
+   }
+
+   if (ret != 0)
    {
       if (q)
          libretrodb_query_free(q);
@@ -863,8 +922,9 @@ void database_info_free(database_info_handle_t *db)
       string_list_free(db->list);
 }
 
-database_info_list_t *database_info_list_new(
-      const char *rdb_path, const char *query)
+static database_info_list_t *database_info_list_new_keys(
+      const char *rdb_path, const char *query,
+      enum libretrodb_key key, const uint32_t *keys, size_t count)
 {
    int ret                                  = 0;
    unsigned k                               = 0;
@@ -876,7 +936,8 @@ database_info_list_t *database_info_list_new(
    if (!db || !cur)
       goto end;
 
-   if ((database_cursor_open(db, cur, rdb_path, query) != 0))
+   if ((database_cursor_open(db, cur, rdb_path, query,
+               key, keys, count) != 0))
       goto end;
 
    database_info_list = (database_info_list_t*)
@@ -1015,6 +1076,28 @@ end:
    return database_info_list;
 }
 
+database_info_list_t *database_info_list_new(
+      const char *rdb_path, const char *query)
+{
+   return database_info_list_new_keys(rdb_path, query,
+         LIBRETRODB_KEY_CRC, NULL, 0);
+}
+
+database_info_list_t *database_info_list_new_crc(const char *rdb_path,
+      const char *query, const uint32_t *crcs, size_t count)
+{
+   return database_info_list_new_keys(rdb_path, query,
+         LIBRETRODB_KEY_CRC, crcs, count);
+}
+
+database_info_list_t *database_info_list_new_serial(const char *rdb_path,
+      const char *query, const char *serial)
+{
+   uint32_t key = libretrodb_key_hash(serial, strlen(serial));
+   return database_info_list_new_keys(rdb_path, query,
+         LIBRETRODB_KEY_SERIAL, &key, 1);
+}
+
 void database_info_list_free(database_info_list_t *database_info_list)
 {
    size_t i;
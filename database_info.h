@@ -142,6 +142,15 @@ typedef struct
 database_info_list_t *database_info_list_new(const char *rdb_path,
       const char *query);
 
+/* Like database_info_list_new(), but when the database has a key
+ * index only the entries with one of @crcs, or with @serial, are read
+ * and checked against @query. Without one the whole database is. */
+database_info_list_t *database_info_list_new_crc(const char *rdb_path,
+      const char *query, const uint32_t *crcs, size_t count);
+
+database_info_list_t *database_info_list_new_serial(const char *rdb_path,
+      const char *query, const char *serial);
+
 void database_info_list_free(database_info_list_t *list);
 
 database_info_handle_t *database_info_dir_init(const char *dir,
@@ -6,11 +6,17 @@ set(GGPO_LIB_INC_NOFILTER
 	"lib/ggpo/log.h"
 	"lib/ggpo/poll.h"
 	"lib/ggpo/ring_buffer.h"
+	"lib/ggpo/spsc_queue.h"
+	"lib/ggpo/state_codec.h"
+	"lib/ggpo/state_segments.h"
 	"lib/ggpo/sync.h"
+	"lib/ggpo/task_pool.h"
+	"lib/ggpo/thread_hook.h"
 	"lib/ggpo/timesync.h"
 	"lib/ggpo/types.h"
 	"lib/ggpo/platform_mac.h"
 	"lib/lz4/lz4.h"
+	"lib/lz4/lz4hc.h"
 )
 
 set(GGPO_LIB_SRC_NOFILTER
@@ -20,9 +26,14 @@ set(GGPO_LIB_SRC_NOFILTER
 	"lib/ggpo/log.cpp"
 	"lib/ggpo/main.cpp"
 	"lib/ggpo/poll.cpp"
+	"lib/ggpo/state_codec.cpp"
+	"lib/ggpo/state_segments.cpp"
 	"lib/ggpo/sync.cpp"
+	"lib/ggpo/task_pool.cpp"
+	"lib/ggpo/thread_hook.cpp"
 	"lib/ggpo/timesync.cpp"
 	"lib/lz4/lz4.c"
+	"lib/lz4/lz4hc.c"
 )
 
 if(UNIX AND NOT APPLE)
@@ -47,12 +58,26 @@ if(WIN32)
 endif()
 
 set(GGPO_LIB_INC_NETWORK
+	"lib/ggpo/network/input_codec.h"
+	"lib/ggpo/network/loopback.h"
+	"lib/ggpo/network/relay_broadcast.h"
+	"lib/ggpo/network/relay_transport.h"
+	"lib/ggpo/network/transport.h"
+	"lib/ggpo/network/transport_hub.h"
+	"lib/ggpo/network/tunnel_transport.h"
 	"lib/ggpo/network/udp.h"
 	"lib/ggpo/network/udp_msg.h"
 	"lib/ggpo/network/udp_proto.h"
 )
 
 set(GGPO_LIB_SRC_NETWORK
+	"lib/ggpo/network/input_codec.cpp"
+	"lib/ggpo/network/loopback.cpp"
+	"lib/ggpo/network/relay_broadcast.cpp"
+	"lib/ggpo/network/relay_transport.cpp"
+	"lib/ggpo/network/transport.cpp"
+	"lib/ggpo/network/transport_hub.cpp"
+	"lib/ggpo/network/tunnel_transport.cpp"
 	"lib/ggpo/network/udp.cpp"
 	"lib/ggpo/network/udp_proto.cpp"
 )
@@ -72,6 +97,7 @@ set(GGPO_LIB_SRC_BACKENDS
 
 set(GGPO_PUBLIC_INC
 	"include/ggponet.h"
+	"include/ggpo_predict.h"
 )
 
 source_group(" " FILES ${GGPO_LIB_INC_NOFILTER} ${GGPO_LIB_SRC_NOFILTER})
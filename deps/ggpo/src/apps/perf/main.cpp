@@ -6,33 +6,158 @@
  */
 
 #include "sync.h"
+#include "network/input_codec.h"
 
+#include <algorithm>
+#include <chrono>
 #include <climits>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <thread>
 #include <vector>
 
+/*
+ * The first PERF_STATE_HEADER bytes of a state hold the mutation rng, so a
+ * loaded state carries on exactly as the saved one would have and two
+ * peers fed the same inputs stay in sync.
+ */
+#define PERF_STATE_HEADER  4
+#define PERF_BANK_SIZE     8192
+
+/*
+ * --hint: each state tracks the pages it has written since it was last
+ * saved or loaded, as a core with dirty-page tracking would, and session
+ * saves pass them to ggpo_hint_state_changes.
+ */
+#define PERF_HINT_PAGE     4096
+
+/*
+ * --regions: the state is declared as work RAM for its first quarter and
+ * video RAM for the rest, as a core's memory map would describe it.
+ */
+#define PERF_WORK_RAM_SHARE 4
+
 struct PerfState {
    std::vector<byte> data;
-   uint32 rng;
+   std::vector<byte> dirty_pages;
+   bool              baseline;      /* saved or loaded since it was seeded */
 };
 
+/*
+ * How a frame dirties the state, after the kinds of RAM churn real cores
+ * show: a few scattered bytes, one bank rewritten (the work RAM of a sprite
+ * or sound engine), or everything (framebuffers kept in the state).
+ */
+enum PerfMutation {
+   PERF_MUTATE_SPARSE,
+   PERF_MUTATE_BANKED,
+   PERF_MUTATE_CHURN,
+   PERF_MUTATE_COUNT
+};
+
+static const char *mutation_names[PERF_MUTATE_COUNT] = { "sparse", "banked", "churn" };
+static const char *transport_names[] = { "udp", "loopback", "relay", "hub", "tunnel" };
+
+/* --transport=hub: each peer on a shared-socket hub of its own */
+static GGPOHub *g_hubs[2];
+
 static PerfState g_state;
+static PerfState *g_active = &g_state;
+static PerfMutation g_mutation = PERF_MUTATE_SPARSE;
+static bool g_hint;
 
-static void MutateState()
+static uint32 XorShift(uint32 x)
 {
-   uint32 x = g_state.rng;
-   if (g_state.data.empty()) {
+   x ^= x << 13;
+   x ^= x >> 17;
+   x ^= x << 5;
+   return x;
+}
+
+static void SeedState(PerfState &state, uint32 seed)
+{
+   memcpy(&state.data[0], &seed, PERF_STATE_HEADER);
+   state.dirty_pages.assign((state.data.size() + PERF_HINT_PAGE - 1) / PERF_HINT_PAGE, 0);
+   state.baseline = false;
+}
+
+static void MarkDirty(PerfState &state, size_t offset, size_t len)
+{
+   if (!g_hint || !len) {
       return;
    }
-   for (size_t i = 0; i < g_state.data.size(); i += 64) {
-      x ^= x << 13;
-      x ^= x >> 17;
-      x ^= x << 5;
-      g_state.data[i] = (byte)(x & 0xFF);
+   for (size_t page = offset / PERF_HINT_PAGE; page <= (offset + len - 1) / PERF_HINT_PAGE; page++) {
+      state.dirty_pages[page] = 1;
    }
-   g_state.rng = x;
+}
+
+static void ResetDirty(PerfState &state)
+{
+   if (g_hint) {
+      std::fill(state.dirty_pages.begin(), state.dirty_pages.end(), 0);
+      state.baseline = true;
+   }
+}
+
+static void MutateState(PerfState &state, uint32 seed)
+{
+   uint32 x;
+   if (state.data.size() <= PERF_STATE_HEADER) {
+      return;
+   }
+   byte *ram = &state.data[PERF_STATE_HEADER];
+   size_t size = state.data.size() - PERF_STATE_HEADER;
+
+   memcpy(&x, &state.data[0], PERF_STATE_HEADER);
+   x ^= seed;
+   if (!x) {
+      x = 0x12345678u;
+   }
+
+   switch (g_mutation) {
+   case PERF_MUTATE_SPARSE:
+      for (size_t i = 0; i < size; i += 64) {
+         x = XorShift(x);
+         ram[i] = (byte)(x & 0xFF);
+      }
+      MarkDirty(state, PERF_STATE_HEADER, size);
+      break;
+   case PERF_MUTATE_BANKED: {
+      size_t banks = (size + PERF_BANK_SIZE - 1) / PERF_BANK_SIZE;
+      x = XorShift(x);
+      size_t start = (x % banks) * PERF_BANK_SIZE;
+      size_t end = MIN(start + PERF_BANK_SIZE, size);
+      for (size_t i = start; i + 4 <= end; i += 4) {
+         x = XorShift(x);
+         memcpy(ram + i, &x, 4);
+      }
+      MarkDirty(state, PERF_STATE_HEADER + start, end - start);
+      break;
+   }
+   case PERF_MUTATE_CHURN:
+      for (size_t i = 0; i + 4 <= size; i += 4) {
+         x = XorShift(x);
+         memcpy(ram + i, &x, 4);
+      }
+      MarkDirty(state, PERF_STATE_HEADER, size);
+      break;
+   default:
+      break;
+   }
+
+   memcpy(&state.data[0], &x, PERF_STATE_HEADER);
+   MarkDirty(state, 0, PERF_STATE_HEADER);
+}
+
+static uint32 StateChecksum(const unsigned char *buffer, int len)
+{
+   uint32 sum = 0, word;
+   for (int i = 0; i + 4 <= len; i += 4) {
+      memcpy(&word, buffer + i, 4);
+      sum = (sum << 1 | sum >> 31) ^ word;
+   }
+   return sum;
 }
 
 static bool __cdecl BeginGame(const char *game)
@@ -44,14 +169,14 @@ static bool __cdecl BeginGame(const char *game)
 static bool __cdecl SaveGameState(unsigned char **buffer, int *len, int *checksum, int frame)
 {
    (void)frame;
-   if (g_state.data.empty()) {
+   if (g_active->data.empty()) {
       return false;
    }
-   if (g_state.data.size() > (size_t)INT_MAX) {
+   if (g_active->data.size() > (size_t)INT_MAX) {
       return false;
    }
 
-   int size = (int)g_state.data.size();
+   int size = (int)g_active->data.size();
    unsigned char *copy = NULL;
    if (buffer && *buffer && len && *len >= size) {
       copy = *buffer;
@@ -61,7 +186,7 @@ static bool __cdecl SaveGameState(unsigned char **buffer, int *len, int *checksu
    if (!copy) {
       return false;
    }
-   memcpy(copy, &g_state.data[0], size);
+   memcpy(copy, &g_active->data[0], size);
 
    *buffer = copy;
    *len = size;
@@ -73,15 +198,16 @@ static bool __cdecl SaveGameState(unsigned char **buffer, int *len, int *checksu
 
 static bool __cdecl LoadGameState(unsigned char *buffer, int len)
 {
-   if (!buffer || len <= 0 || g_state.data.empty()) {
+   if (!buffer || len <= 0 || g_active->data.empty()) {
       return false;
    }
 
    size_t size = (size_t)len;
-   if (size > g_state.data.size()) {
-      size = g_state.data.size();
+   if (size > g_active->data.size()) {
+      size = g_active->data.size();
    }
-   memcpy(&g_state.data[0], buffer, size);
+   memcpy(&g_active->data[0], buffer, size);
+   ResetDirty(*g_active);
    return true;
 }
 
@@ -101,7 +227,7 @@ static void __cdecl FreeBuffer(void *buffer)
 static bool __cdecl AdvanceFrame(int flags)
 {
    (void)flags;
-   MutateState();
+   MutateState(*g_active, 0);
    return true;
 }
 
@@ -116,6 +242,30 @@ struct PerfConfig {
    int frames;
    int loads;
    int lz4_accel;
+   int prediction_frames;
+   int keyframe_interval;
+   int codec_mode;
+   int raw_ceiling_kb;
+   int input_window;
+   int queue_lag;
+   int mutation;
+   bool hint;
+   bool regions;
+   int session_frames;
+   int rejoin_frame;
+   int spectate_frame;
+   int latency_ms;
+   int loss_percent;
+   int oop_percent;
+   int fec;
+   bool drop_originals;
+   int frame_delay;
+   int delay_step_frame;
+   int transport;
+   char relay_ip[32];
+   int relay_port;
+   int port;
+   const char *json_path;
    bool show_help;
 };
 
@@ -126,6 +276,32 @@ static void PrintUsage(const char *exe)
    printf("  --frames=NN     Number of saved frames (default 2000)\n");
    printf("  --loads=NN      Number of load operations (default 2000)\n");
    printf("  --lz4-accel=NN  LZ4 acceleration (default 2)\n");
+   printf("  --prediction=NN Prediction window (default %d)\n", MAX_PREDICTION_FRAMES);
+   printf("  --keyframe-interval=NN  Frames between keyframes (default %d)\n", GGPO_STATE_KEYFRAME_INTERVAL);
+   printf("  --codec=N       0 lz4, 1 lz4hc on idle, 2 zstd fast, 3 raw, 4 adaptive (default 0)\n");
+   printf("  --raw-ceiling-kb=NN  Keep frames raw while the ring fits in NN KB (default 0, off)\n");
+   printf("  --input-codecs=NN  Benchmark the input codecs instead, NN unacked frames per packet\n");
+   printf("  --input-queue=NN   Benchmark the input queue instead, remote input NN frames late\n");
+   printf("  --mutation=NAME State churn per frame: sparse, banked or churn (default sparse)\n");
+   printf("  --session=NN    Run two sessions over loopback for NN frames instead\n");
+   printf("  --hint          Session saves hint the pages each frame dirtied\n");
+   printf("  --regions       Declare work and video RAM regions, segmenting keyframes\n");
+   printf("  --rejoin=NN     Drop the second peer at frame NN and rejoin it (not with relay)\n");
+   printf("  --spectate=NN   Broadcast through --relay and start a relay spectator at frame NN (not with loopback or tunnel)\n");
+   printf("  --latency-ms=NN One-way send delay, jittered between 2/3 and all of it (default 0)\n");
+   printf("  --loss=NN       Percent of packets dropped (default 0)\n");
+   printf("  --oop=NN        Percent of packets sent out of order (default 0)\n");
+   printf("  --fec=N         Input copies: 0 off, 1-2 fixed, 3 adaptive (default 0)\n");
+   printf("  --drop-originals  Drop every original input packet so only the copies arrive;\n");
+   printf("                  implies --fec=1 and fails the run on any desync\n");
+   printf("  --frame-delay=NN  Local input delay in frames (default 0)\n");
+   printf("  --delay-step=NN Raise the first peer's frame delay by two at frame NN and drop it\n");
+   printf("                  back at twice NN; fails the run on any desync\n");
+   printf("  --transport=NAME  Session traffic over udp, in-process loopback, a relay, a hub or an\n");
+   printf("                  application-carried tunnel (default udp)\n");
+   printf("  --relay=IP:PORT The relay for --transport=relay (default 127.0.0.1:7001)\n");
+   printf("  --port=NN       First of the two loopback ports (default 7000)\n");
+   printf("  --json=PATH     Also write the results to PATH as JSON\n");
    printf("  -h, --help      Show this help\n");
 }
 
@@ -136,6 +312,30 @@ static PerfConfig ParseArgs(int argc, char **argv)
    config.frames = 2000;
    config.loads = 2000;
    config.lz4_accel = 2;
+   config.prediction_frames = MAX_PREDICTION_FRAMES;
+   config.keyframe_interval = GGPO_STATE_KEYFRAME_INTERVAL;
+   config.codec_mode = GGPO_STATE_CODEC_MODE_LZ4;
+   config.raw_ceiling_kb = 0;
+   config.input_window = 0;
+   config.queue_lag = 0;
+   config.mutation = PERF_MUTATE_SPARSE;
+   config.hint = false;
+   config.regions = false;
+   config.session_frames = 0;
+   config.rejoin_frame = 0;
+   config.spectate_frame = 0;
+   config.latency_ms = 0;
+   config.loss_percent = 0;
+   config.oop_percent = 0;
+   config.fec = 0;
+   config.drop_originals = false;
+   config.frame_delay = 0;
+   config.delay_step_frame = 0;
+   config.transport = 0;
+   strcpy_s(config.relay_ip, "127.0.0.1");
+   config.relay_port = 7001;
+   config.port = 7000;
+   config.json_path = NULL;
    config.show_help = false;
 
    for (int i = 1; i < argc; ++i) {
@@ -160,6 +360,111 @@ static PerfConfig ParseArgs(int argc, char **argv)
          config.lz4_accel = atoi(arg + 12);
          continue;
       }
+      if (!strncmp(arg, "--prediction=", 13)) {
+         config.prediction_frames = atoi(arg + 13);
+         continue;
+      }
+      if (!strncmp(arg, "--keyframe-interval=", 20)) {
+         config.keyframe_interval = atoi(arg + 20);
+         continue;
+      }
+      if (!strncmp(arg, "--codec=", 8)) {
+         config.codec_mode = atoi(arg + 8);
+         continue;
+      }
+      if (!strncmp(arg, "--raw-ceiling-kb=", 17)) {
+         config.raw_ceiling_kb = atoi(arg + 17);
+         continue;
+      }
+      if (!strncmp(arg, "--input-codecs=", 15)) {
+         config.input_window = atoi(arg + 15);
+         continue;
+      }
+      if (!strncmp(arg, "--input-queue=", 14)) {
+         config.queue_lag = atoi(arg + 14);
+         continue;
+      }
+      if (!strncmp(arg, "--mutation=", 11)) {
+         for (int m = 0; m < PERF_MUTATE_COUNT; m++) {
+            if (!strcmp(arg + 11, mutation_names[m])) {
+               config.mutation = m;
+            }
+         }
+         continue;
+      }
+      if (!strncmp(arg, "--session=", 10)) {
+         config.session_frames = atoi(arg + 10);
+         continue;
+      }
+      if (!strcmp(arg, "--hint")) {
+         config.hint = true;
+         continue;
+      }
+      if (!strcmp(arg, "--regions")) {
+         config.regions = true;
+         continue;
+      }
+      if (!strncmp(arg, "--rejoin=", 9)) {
+         config.rejoin_frame = atoi(arg + 9);
+         continue;
+      }
+      if (!strncmp(arg, "--spectate=", 11)) {
+         config.spectate_frame = atoi(arg + 11);
+         continue;
+      }
+      if (!strncmp(arg, "--latency-ms=", 13)) {
+         config.latency_ms = atoi(arg + 13);
+         continue;
+      }
+      if (!strncmp(arg, "--loss=", 7)) {
+         config.loss_percent = atoi(arg + 7);
+         continue;
+      }
+      if (!strncmp(arg, "--oop=", 6)) {
+         config.oop_percent = atoi(arg + 6);
+         continue;
+      }
+      if (!strncmp(arg, "--fec=", 6)) {
+         config.fec = atoi(arg + 6);
+         continue;
+      }
+      if (!strcmp(arg, "--drop-originals")) {
+         config.drop_originals = true;
+         continue;
+      }
+      if (!strncmp(arg, "--frame-delay=", 14)) {
+         config.frame_delay = atoi(arg + 14);
+         continue;
+      }
+      if (!strncmp(arg, "--delay-step=", 13)) {
+         config.delay_step_frame = atoi(arg + 13);
+         continue;
+      }
+      if (!strncmp(arg, "--transport=", 12)) {
+         for (int t = 0; t < ARRAY_SIZE(transport_names); t++) {
+            if (!strcmp(arg + 12, transport_names[t])) {
+               config.transport = t;
+            }
+         }
+         continue;
+      }
+      if (!strncmp(arg, "--relay=", 8)) {
+         const char *colon = strchr(arg + 8, ':');
+         if (colon && colon - (arg + 8) < (int)sizeof(config.relay_ip)) {
+            memcpy(config.relay_ip, arg + 8, colon - (arg + 8));
+            config.relay_ip[colon - (arg + 8)] = '\0';
+            config.relay_port = atoi(colon + 1);
+         }
+         continue;
+      }
+      if (!strncmp(arg, "--port=", 7)) {
+         config.port = atoi(arg + 7);
+         continue;
+      }
+      if (!strncmp(arg, "--json=", 7)) {
+         config.json_path = arg + 7;
+         continue;
+      }
    }
 
    if (config.state_kb <= 0) {
@@ -174,10 +479,33 @@ static PerfConfig ParseArgs(int argc, char **argv)
    if (config.lz4_accel <= 0) {
       config.lz4_accel = 2;
    }
+   config.latency_ms = MAX(config.latency_ms, 0);
+   config.loss_percent = MAX(0, MIN(config.loss_percent, 100));
+   config.oop_percent = MAX(0, MIN(config.oop_percent, 100));
+   config.fec = MAX(0, MIN(config.fec, 3));
+   if (config.drop_originals && !config.fec) {
+      config.fec = 1;
+   }
+   config.frame_delay = MAX(config.frame_delay, 0);
+   config.delay_step_frame = MAX(config.delay_step_frame, 0);
+   if (config.port <= 0 || config.port > 65534) {
+      config.port = 7000;
+   }
 
    return config;
 }
 
+static void MakeRegions(size_t state_size, GGPOStateRegion regions[2])
+{
+   int work = (int)(state_size / PERF_WORK_RAM_SHARE);
+   regions[0].offset = 0;
+   regions[0].length = work;
+   regions[0].kind = GGPO_STATE_REGION_WORK_RAM;
+   regions[1].offset = work;
+   regions[1].length = (int)state_size - work;
+   regions[1].kind = GGPO_STATE_REGION_VIDEO_RAM;
+}
+
 class PerfSync : public Sync {
 public:
    explicit PerfSync(UdpMsg::connect_status *connect_status) : Sync(connect_status) {}
@@ -198,7 +526,7 @@ public:
    {
       int index = _savedstate.head - 1;
       if (index < 0) {
-         index = ARRAY_SIZE(_savedstate.frames) - 1;
+         index = (int)_savedstate.frames.size() - 1;
       }
       const SavedFrame &frame = _savedstate.frames[index];
       if (uncompressed_size) {
@@ -213,6 +541,913 @@ public:
    }
 };
 
+/*
+ * Synthetic per-player input in the frontend's GGPO layout: word 0 holds
+ * the buttons, the following words pack two 16-bit axes each.  The mash
+ * device is the joypad with one more button pressed and released three
+ * or four frames at a time.
+ */
+enum PerfInputDevice {
+   PERF_INPUT_JOYPAD,
+   PERF_INPUT_ANALOG,
+   PERF_INPUT_MOUSE,
+   PERF_INPUT_MASH,
+   PERF_INPUT_COUNT
+};
+
+static uint32 NextRandom(uint32 *rng)
+{
+   *rng = *rng * 1664525u + 1013904223u;
+   return *rng >> 8;
+}
+
+static void StoreAxes(GameInput &input, int word, int x, int y)
+{
+   uint32 packed = (uint32)(uint16)x | ((uint32)(uint16)y << 16);
+   memcpy(input.bits + word * 4, &packed, 4);
+}
+
+static void MakeInput(PerfInputDevice device, int frame, uint32 *rng, GameInput &input)
+{
+   static uint32 buttons = 0;
+   static int stick_x = 0, stick_y = 0;
+   static int mash_left = 0;
+
+   if (frame == 0) {
+      buttons = 0;
+      stick_x = stick_y = 0;
+      mash_left = 0;
+   }
+   /* Buttons change on about one frame in eight. */
+   if (NextRandom(rng) % 8 == 0) {
+      buttons ^= 1u << (NextRandom(rng) % 12);
+   }
+   input.erase();
+   input.frame = frame;
+   memcpy(input.bits, &buttons, 4);
+
+   switch (device) {
+   case PERF_INPUT_JOYPAD:
+      input.size = 4;
+      break;
+   case PERF_INPUT_ANALOG:
+      /* Left stick walks around, right stick mostly rests with small noise. */
+      stick_x = MAX(-32767, MIN(32767, stick_x + (int)(NextRandom(rng) % 2049) - 1024));
+      stick_y = MAX(-32767, MIN(32767, stick_y + (int)(NextRandom(rng) % 2049) - 1024));
+      StoreAxes(input, 1, stick_x, stick_y);
+      StoreAxes(input, 2, (int)(NextRandom(rng) % 9) - 4, (int)(NextRandom(rng) % 9) - 4);
+      input.size = 12;
+      break;
+   case PERF_INPUT_MOUSE:
+      StoreAxes(input, 1, (int)(NextRandom(rng) % 41) - 20, (int)(NextRandom(rng) % 41) - 20);
+      input.size = 8;
+      break;
+   case PERF_INPUT_MASH:
+      if (--mash_left <= 0) {
+         buttons ^= 1u << 12;
+         mash_left = 3 + (int)(NextRandom(rng) % 2);
+      }
+      memcpy(input.bits, &buttons, 4);
+      input.size = 4;
+      break;
+   default:
+      break;
+   }
+}
+
+/*
+ * Codes the same input streams the way UdpProtocol does: each packet holds
+ * the last window frames against the frame before them.  Prints bits per
+ * packet and checks every packet decodes back to the input.
+ */
+static int RunInputCodecBench(int window)
+{
+   static const char *device_names[PERF_INPUT_COUNT] = { "joypad", "analog", "mouse", "mash" };
+   const int frames = 3600;
+   std::vector<GameInput> stream(frames + 1);
+
+   printf("GGPO Input Codec Harness\n");
+   printf("%d frames, %d unacked frames per packet\n", frames, window);
+
+   for (int d = 0; d < PERF_INPUT_COUNT; d++) {
+      uint32 rng = 0x2468aceu + (uint32)d;
+      stream[0].erase();
+      stream[0].frame = -1;
+      for (int f = 0; f < frames; f++) {
+         MakeInput((PerfInputDevice)d, f, &rng, stream[f + 1]);
+      }
+      stream[0].size = stream[1].size;
+
+      for (int c = 0; c < INPUT_CODEC_COUNT; c++) {
+         const InputCodec *codec = InputCodec::Get((InputCodecId)c);
+         unsigned long long total_bits = 0;
+         int max_bits = 0, errors = 0;
+         uint8 bits[MAX_COMPRESSED_BITS / 8];
+
+         uint32 start = Platform::GetCurrentTimeMS();
+         for (int f = 1; f <= frames; f++) {
+            int first = MAX(1, f - window + 1);
+            int offset = 0;
+            InputCodecState state;
+
+            state.reset();
+            for (int i = first; i <= f && offset < MAX_COMPRESSED_BITS - 512; i++) {
+               codec->EncodeFrame(state, bits, &offset, stream[i], stream[i - 1]);
+            }
+            total_bits += (unsigned long long)offset;
+            max_bits = MAX(max_bits, offset);
+
+            GameInput decoded = stream[first - 1];
+            int read = 0;
+            state.reset();
+            for (int i = first; i <= f && read < offset; i++) {
+               if (!codec->DecodeFrame(state, bits, &read, offset, decoded.size, &decoded) ||
+                   memcmp(decoded.bits, stream[i].bits, decoded.size)) {
+                  errors++;
+                  break;
+               }
+            }
+         }
+         int ms = (int)(Platform::GetCurrentTimeMS() - start);
+
+         printf("%-7s %-10s %6.1f bits/packet, max %4d, %d ms%s\n",
+                device_names[d], codec->Name(), (double)total_bits / frames, max_bits, ms,
+                errors ? "  DECODE MISMATCH" : "");
+      }
+   }
+   return 0;
+}
+
+/*
+ * Drives one remote player's InputQueue the way Sync does: the game asks
+ * for every frame as it runs, the remote input arrives lag frames later,
+ * and a misprediction rolls back and asks for every frame again from the
+ * first wrong one.  Prints the time per AddInput or GetInput call and
+ * checks every confirmed input comes back as it went in.
+ */
+static int RunInputQueueBench(int lag)
+{
+   static const char *device_names[PERF_INPUT_COUNT] = { "joypad", "analog", "mouse", "mash" };
+   static const char *model_names[GGPO_PREDICT_MODEL_COUNT] = { "repeat", "hold" };
+   const int frames = 3600;
+   const int passes = 50;
+   std::vector<GameInput> stream(frames);
+
+   if (lag >= INPUT_QUEUE_LENGTH / 2) {
+      printf("--input-queue must be below %d.\n", INPUT_QUEUE_LENGTH / 2);
+      return 1;
+   }
+
+   printf("GGPO Input Queue Harness\n");
+   printf("%d frames x %d passes, remote input %d frames late\n", frames, passes, lag);
+
+   for (int d = 0; d < PERF_INPUT_COUNT; d++) {
+      uint32 rng = 0x13579bdu + (uint32)d;
+      for (int f = 0; f < frames; f++) {
+         MakeInput((PerfInputDevice)d, f, &rng, stream[f]);
+      }
+      int size = stream[0].size;
+
+      for (int m = 0; m < GGPO_PREDICT_MODEL_COUNT; m++) {
+         InputQueue queue;
+         unsigned long long ops = 0;
+         int rollbacks = 0, errors = 0;
+         GameInput input;
+
+         uint64 start = Platform::GetCurrentTimeUS();
+         for (int pass = 0; pass < passes; pass++) {
+            queue.Init(0, size);
+            queue.SetPredictor((GGPOPredictModel)m, 4);
+            for (int f = 0; f < frames; f++) {
+               int first = f;
+               if (f >= lag) {
+                  GameInput remote = stream[f - lag];
+                  queue.AddInput(remote);
+                  ops++;
+                  if (queue.GetFirstIncorrectFrame() != GameInput::NullFrame) {
+                     first = queue.GetFirstIncorrectFrame();
+                     queue.ResetPrediction(first);
+                     rollbacks++;
+                  }
+                  if (f > lag) {
+                     queue.DiscardConfirmedFrames(f - lag - 1);
+                  }
+               }
+               for (int r = first; r <= f; r++) {
+                  if (queue.GetInput(r, &input) && memcmp(input.bits, stream[r].bits, size)) {
+                     errors++;
+                  }
+                  ops++;
+               }
+            }
+         }
+         uint64 us = Platform::GetCurrentTimeUS() - start;
+
+         printf("%-7s %-7s %6.1f ns/op, %5.1f%% mispredicted, %d rollbacks, %d ms%s\n",
+                device_names[d], model_names[m], (double)us * 1000.0 / (double)ops,
+                queue.GetPredictedFrames() ? 100.0 * queue.GetMispredictedFrames() / queue.GetPredictedFrames() : 0.0,
+                rollbacks / passes, (int)(us / 1000), errors ? "  INPUT MISMATCH" : "");
+      }
+   }
+   return 0;
+}
+
+/*
+ * Two peers in one process, talking over loopback.  Each has its own state
+ * and session; g_active and g_peer point at the one being driven so the
+ * callbacks, which carry no context, land on the right peer.
+ */
+#define PERF_SESSION_FRAME_US    16667
+#define PERF_SESSION_SYNC_MS     10000
+#define PERF_SESSION_STATS_EVERY 60
+#define PERF_REJOIN_OUTAGE_MS    1000
+#define PERF_REJOIN_WINDOW_MS    5000
+
+struct PerfPeer {
+   GGPOSession *ggpo;
+   GGPOPlayerHandle local_handle;
+   GGPOPlayerHandle remote_handle;
+   PerfState state;
+   uint32 input_rng;
+   uint32 buttons;
+   bool running;
+   bool disconnected;
+   int stall_frames;
+   int stalled;               /* frames skipped on GGPO_EVENTCODE_TIMESYNC */
+   int rejected;              /* frames ggpo_add_local_input turned away */
+   int desyncs;
+   bool rejoined;
+   int rejoin_frame;
+   int rejoin_ms;             /* GGPO_EVENTCODE_PEER_REJOINED resume_ms */
+   int rejoin_bytes;
+   long long work_us;         /* spent in GGPO and the callbacks this frame */
+   std::vector<int> frame_us;
+   long long kbps_sum;
+   long long ping_us_sum;
+   int stats_samples;
+};
+
+static PerfPeer g_peers[2];
+static PerfPeer *g_peer = NULL;
+
+/* The first peer's state checksum as last saved for each frame, or -1. */
+static std::vector<long long> g_saved_checksums;
+
+static void RecordChecksum(std::vector<long long> &checksums, int frame, uint32 checksum)
+{
+   if (frame < 0) {
+      return;
+   }
+   if ((size_t)frame >= checksums.size()) {
+      checksums.resize((size_t)frame + 1, -1);
+   }
+   checksums[frame] = checksum;
+}
+
+static void SelectPeer(PerfPeer *peer)
+{
+   g_peer = peer;
+   g_active = &peer->state;
+}
+
+static bool __cdecl SessionSaveGameState(unsigned char **buffer, int *len, int *checksum, int frame)
+{
+   if (!SaveGameState(buffer, len, checksum, frame)) {
+      return false;
+   }
+   if (g_hint) {
+      PerfState &state = g_peer->state;
+      std::vector<GGPOStateRange> ranges;
+      for (size_t page = 0; state.baseline && page < state.dirty_pages.size(); page++) {
+         if (!state.dirty_pages[page]) {
+            continue;
+         }
+         int offset = (int)(page * PERF_HINT_PAGE);
+         int length = (int)MIN((size_t)PERF_HINT_PAGE, state.data.size() - page * PERF_HINT_PAGE);
+         if (!ranges.empty() && ranges.back().offset + ranges.back().length == offset) {
+            ranges.back().length += length;
+         } else {
+            GGPOStateRange range = { offset, length };
+            ranges.push_back(range);
+         }
+      }
+      if (state.baseline) {
+         ggpo_hint_state_changes(g_peer->ggpo, ranges.empty() ? NULL : &ranges[0], (int)ranges.size());
+      }
+      ResetDirty(state);
+   }
+   uint32 sum = StateChecksum(*buffer, *len);
+   if (checksum) {
+      *checksum = (int)sum;
+   }
+   if (g_peer == &g_peers[0]) {
+      RecordChecksum(g_saved_checksums, frame, sum);
+   }
+   return true;
+}
+
+static void AdvanceSession(PerfPeer *peer, const int *inputs)
+{
+   MutateState(peer->state, (uint32)inputs[0] * 0x9e3779b1u ^ (uint32)inputs[1]);
+   ggpo_advance_frame(peer->ggpo);
+}
+
+static bool __cdecl SessionAdvanceFrame(int flags)
+{
+   int inputs[2] = { 0 };
+   int disconnect_flags;
+   (void)flags;
+
+   ggpo_synchronize_input(g_peer->ggpo, (void *)inputs, sizeof(inputs), &disconnect_flags);
+   AdvanceSession(g_peer, inputs);
+   return true;
+}
+
+static bool __cdecl SessionOnEvent(GGPOEvent *info)
+{
+   switch (info->code) {
+   case GGPO_EVENTCODE_RUNNING:
+      g_peer->running = true;
+      break;
+   case GGPO_EVENTCODE_DISCONNECTED_FROM_PEER:
+      g_peer->disconnected = true;
+      break;
+   case GGPO_EVENTCODE_TIMESYNC:
+      g_peer->stall_frames = info->u.timesync.frames_ahead;
+      break;
+   case GGPO_EVENTCODE_DESYNC:
+      g_peer->desyncs++;
+      break;
+   case GGPO_EVENTCODE_PEER_REJOINED:
+      g_peer->rejoined = true;
+      g_peer->rejoin_frame = info->u.rejoined.frame;
+      g_peer->rejoin_ms = info->u.rejoined.resume_ms;
+      g_peer->rejoin_bytes = info->u.rejoined.state_bytes;
+      break;
+   default:
+      break;
+   }
+   return true;
+}
+
+/*
+ * --spectate: a relay spectator that joins partway through and plays the
+ * broadcast back as fast as it arrives.  Each state it reaches is checked
+ * against the one the first peer saved for the same frame.
+ */
+#define PERF_SPECTATE_KEYFRAME_INTERVAL   120
+#define PERF_SPECTATE_FRAMES_PER_POLL     1000
+
+struct PerfSpectator {
+   GGPOSession *ggpo;
+   PerfState state;
+   int frame;                 /* the frame it plays next */
+   int join_frame;            /* the peers' frame when it joined */
+   int keyframe;              /* GGPO_EVENTCODE_KEYFRAME_LOADED frame, or -1 */
+   int keyframe_bytes;
+   int played;
+   uint64 join_us;
+   int catch_up_ms;           /* until it reached join_frame, or -1 */
+   std::vector<long long> checksums;
+};
+
+static PerfSpectator g_spectator;
+static char g_broadcast_session[32];
+
+static bool __cdecl SpectatorOnEvent(GGPOEvent *info)
+{
+   if (info->code == GGPO_EVENTCODE_KEYFRAME_LOADED) {
+      g_spectator.keyframe = info->u.keyframe_loaded.frame;
+      g_spectator.keyframe_bytes = info->u.keyframe_loaded.state_bytes;
+      g_spectator.frame = info->u.keyframe_loaded.frame;
+      RecordChecksum(g_spectator.checksums, g_spectator.frame,
+                     StateChecksum(&g_spectator.state.data[0], (int)g_spectator.state.data.size()));
+   }
+   return true;
+}
+
+static bool StartSpectator(const PerfConfig &cfg, size_t state_size, int frame)
+{
+   GGPOSessionCallbacks callbacks;
+   memset(&callbacks, 0, sizeof(callbacks));
+   callbacks.begin_game = BeginGame;
+   callbacks.save_game_state = SaveGameState;
+   callbacks.load_game_state = LoadGameState;
+   callbacks.log_game_state = LogGameState;
+   callbacks.free_buffer = FreeBuffer;
+   callbacks.advance_frame = AdvanceFrame;
+   callbacks.on_event = SpectatorOnEvent;
+
+   PerfSpectator *s = &g_spectator;
+   s->state.data.assign(state_size, 0);
+   SeedState(s->state, 0x12345678u);
+   s->frame = 0;
+   s->join_frame = frame;
+   s->keyframe = -1;
+   s->keyframe_bytes = 0;
+   s->played = 0;
+   s->join_us = Platform::GetCurrentTimeUS();
+   s->catch_up_ms = -1;
+
+   g_active = &s->state;
+   return GGPO_SUCCEEDED(ggpo_start_relay_spectating(&s->ggpo, &callbacks, "perf", 2, sizeof(int), 0,
+                                                     cfg.relay_ip, (unsigned short)cfg.relay_port,
+                                                     g_broadcast_session));
+}
+
+static void RunSpectator(void)
+{
+   PerfSpectator *s = &g_spectator;
+   if (!s->ggpo) {
+      return;
+   }
+   g_active = &s->state;
+   ggpo_idle(s->ggpo, 0);
+   for (int i = 0; i < PERF_SPECTATE_FRAMES_PER_POLL; i++) {
+      int inputs[2] = { 0 };
+      int disconnect_flags;
+      if (!GGPO_SUCCEEDED(ggpo_synchronize_input(s->ggpo, (void *)inputs, sizeof(inputs), &disconnect_flags))) {
+         break;
+      }
+      MutateState(s->state, (uint32)inputs[0] * 0x9e3779b1u ^ (uint32)inputs[1]);
+      ggpo_advance_frame(s->ggpo);
+      s->frame++;
+      s->played++;
+      RecordChecksum(s->checksums, s->frame, StateChecksum(&s->state.data[0], (int)s->state.data.size()));
+   }
+   if (s->catch_up_ms < 0 && s->frame >= s->join_frame) {
+      s->catch_up_ms = (int)((Platform::GetCurrentTimeUS() - s->join_us) / 1000);
+   }
+}
+
+static void SetConfigInt(const char *name, int value)
+{
+   char buf[16];
+   sprintf_s(buf, ARRAY_SIZE(buf), "%d", value);
+#ifdef _WIN32
+   _putenv_s(name, buf);
+#else
+   setenv(name, buf, 1);
+#endif
+}
+
+/*
+ * --transport=tunnel: hands what peer sent to the other one, as a stream
+ * carrying the datagrams would.  Dropped while the other one is gone.
+ */
+static void PumpTunnel(PerfPeer *peer)
+{
+   PerfPeer *other = &g_peers[peer == &g_peers[0] ? 1 : 0];
+   char buffer[GGPO_TUNNEL_MAX_PACKET];
+   int len;
+
+   for (;;) {
+      len = sizeof(buffer);
+      if (!GGPO_SUCCEEDED(ggpo_tunnel_read(peer->ggpo, buffer, &len)) || len == 0) {
+         break;
+      }
+      if (other->ggpo) {
+         ggpo_tunnel_write(other->ggpo, buffer, len);
+      }
+   }
+}
+
+static void IdleSession(PerfPeer *peer)
+{
+   uint64 start = Platform::GetCurrentTimeUS();
+   SelectPeer(peer);
+   ggpo_idle(peer->ggpo, 0);
+   PumpTunnel(peer);
+   peer->work_us += (long long)(Platform::GetCurrentTimeUS() - start);
+}
+
+static void RunSessionFrame(PerfPeer *peer, int frame)
+{
+   uint64 start = Platform::GetCurrentTimeUS();
+   SelectPeer(peer);
+
+   if (peer->stall_frames > 0) {
+      peer->stall_frames--;
+      peer->stalled++;
+   } else {
+      int inputs[2] = { 0 };
+      int disconnect_flags;
+      int input;
+
+      /* Buttons change on about one frame in eight, like MakeInput. */
+      if (NextRandom(&peer->input_rng) % 8 == 0) {
+         peer->buttons ^= 1u << (NextRandom(&peer->input_rng) % 12);
+      }
+      input = (int)peer->buttons;
+
+      GGPOErrorCode result = ggpo_add_local_input(peer->ggpo, peer->local_handle, &input, sizeof(input));
+      if (GGPO_SUCCEEDED(result)) {
+         result = ggpo_synchronize_input(peer->ggpo, (void *)inputs, sizeof(inputs), &disconnect_flags);
+         if (GGPO_SUCCEEDED(result)) {
+            AdvanceSession(peer, inputs);
+         }
+      } else {
+         peer->rejected++;
+      }
+   }
+
+   peer->work_us += (long long)(Platform::GetCurrentTimeUS() - start);
+   peer->frame_us.push_back((int)MIN(peer->work_us, (long long)INT_MAX));
+   peer->work_us = 0;
+
+   if (frame % PERF_SESSION_STATS_EVERY == PERF_SESSION_STATS_EVERY - 1) {
+      GGPONetworkStats stats;
+      if (GGPO_SUCCEEDED(ggpo_get_network_stats(peer->ggpo, peer->remote_handle, &stats))) {
+         peer->kbps_sum += stats.network.kbps_sent;
+         peer->ping_us_sum += stats.network.ping_us;
+         peer->stats_samples++;
+      }
+   }
+}
+
+static int Percentile(const std::vector<int> &sorted, int permille)
+{
+   if (sorted.empty()) {
+      return 0;
+   }
+   size_t index = (size_t)((sorted.size() - 1) * (size_t)permille / 1000);
+   return sorted[index];
+}
+
+/*
+ * Starts peer p's session and adds both players.  rejoin starts it as a
+ * restart of the session it had before.
+ */
+static bool StartPeer(const PerfConfig &cfg, int p, bool rejoin)
+{
+   GGPOSessionCallbacks callbacks;
+   memset(&callbacks, 0, sizeof(callbacks));
+   callbacks.begin_game = BeginGame;
+   callbacks.save_game_state = SessionSaveGameState;
+   callbacks.load_game_state = LoadGameState;
+   callbacks.log_game_state = LogGameState;
+   callbacks.free_buffer = FreeBuffer;
+   callbacks.advance_frame = SessionAdvanceFrame;
+   callbacks.on_event = SessionOnEvent;
+
+   PerfPeer *peer = &g_peers[p];
+   SelectPeer(peer);
+   GGPOErrorCode result;
+   if (cfg.transport == 2) {
+      result = ggpo_start_relay_session(&peer->ggpo, &callbacks, "perf", 2, sizeof(int),
+                                        (unsigned short)(cfg.port + p), cfg.relay_ip,
+                                        (unsigned short)cfg.relay_port, "ggposyncperf", p + 1);
+   } else if (cfg.transport == 3) {
+      result = ggpo_create_hub(&g_hubs[p], (unsigned short)(cfg.port + p));
+      if (GGPO_SUCCEEDED(result)) {
+         result = ggpo_start_hub_session(&peer->ggpo, g_hubs[p], &callbacks, "perf", 2, sizeof(int));
+      }
+   } else if (cfg.transport == 4) {
+      result = ggpo_start_tunnel_session(&peer->ggpo, &callbacks, "perf", 2, sizeof(int));
+   } else {
+      result = ggpo_start_session(&peer->ggpo, &callbacks, "perf", 2, sizeof(int),
+                                  (unsigned short)(cfg.port + p));
+   }
+   if (!GGPO_SUCCEEDED(result)) {
+      return false;
+   }
+   if (cfg.rejoin_frame > 0) {
+      ggpo_set_reconnect_window(peer->ggpo, PERF_REJOIN_WINDOW_MS);
+   }
+   if (rejoin && !GGPO_SUCCEEDED(ggpo_rejoin_session(peer->ggpo))) {
+      return false;
+   }
+   if (cfg.regions) {
+      GGPOStateRegion regions[2];
+      MakeRegions(peer->state.data.size(), regions);
+      ggpo_set_state_regions(peer->ggpo, regions, 2);
+   }
+
+   for (int i = 0; i < 2; i++) {
+      GGPOPlayer player;
+      GGPOPlayerHandle handle;
+
+      memset(&player, 0, sizeof(player));
+      player.size = sizeof(player);
+      player.player_num = i + 1;
+      if (i == p) {
+         player.type = GGPO_PLAYERTYPE_LOCAL;
+      } else {
+         player.type = GGPO_PLAYERTYPE_REMOTE;
+         if (cfg.transport == 2) {
+            strcpy_s(player.u.remote.ip_address, cfg.relay_ip);
+            player.u.remote.port = (unsigned short)cfg.relay_port;
+         } else {
+            strcpy_s(player.u.remote.ip_address, "127.0.0.1");
+            player.u.remote.port = (unsigned short)(cfg.port + i);
+         }
+      }
+      if (!GGPO_SUCCEEDED(ggpo_add_player(peer->ggpo, &player, &handle))) {
+         return false;
+      }
+      if (i == p) {
+         peer->local_handle = handle;
+         ggpo_set_frame_delay(peer->ggpo, handle, cfg.frame_delay);
+      } else {
+         peer->remote_handle = handle;
+      }
+   }
+   return true;
+}
+
+/*
+ * Idles both peers until each has seen done() or the sync timeout passes.
+ * A non-NULL frame keeps the first peer running frames meanwhile, as a
+ * game would while the other side is gone.
+ */
+static bool WaitForPeers(bool (*done)(PerfPeer *peer), int *frame)
+{
+   uint32 deadline = Platform::GetCurrentTimeMS() + PERF_SESSION_SYNC_MS;
+   uint64 next = Platform::GetCurrentTimeUS();
+   while (!done(&g_peers[0]) || !done(&g_peers[1])) {
+      if ((int)(Platform::GetCurrentTimeMS() - deadline) > 0 ||
+          g_peers[0].disconnected || g_peers[1].disconnected) {
+         return false;
+      }
+      if (frame && Platform::GetCurrentTimeUS() >= next) {
+         RunSessionFrame(&g_peers[0], (*frame)++);
+         next += PERF_SESSION_FRAME_US;
+      }
+      IdleSession(&g_peers[0]);
+      if (g_peers[1].ggpo) {
+         IdleSession(&g_peers[1]);
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+   }
+   g_peers[0].work_us = g_peers[1].work_us = 0;
+   return true;
+}
+
+static bool PeerRunning(PerfPeer *peer) { return peer->running; }
+static bool PeerRejoined(PerfPeer *peer) { return peer->running && peer->rejoined; }
+
+static uint32 g_outage_end;
+static bool OutageOver(PerfPeer *peer) { return (int)(Platform::GetCurrentTimeMS() - g_outage_end) >= 0; }
+
+static bool StartSessions(const PerfConfig &cfg, size_t state_size)
+{
+   /* UdpProtocol reads its test hooks when the sessions are created. */
+   SetConfigInt("ggpo.network.delay", cfg.latency_ms);
+   SetConfigInt("ggpo.network.drop_percent", cfg.loss_percent);
+   SetConfigInt("ggpo.oop.percent", cfg.oop_percent);
+   SetConfigInt("ggpo.network.fec", cfg.fec);
+   SetConfigInt("ggpo.network.drop_input_originals", cfg.drop_originals ? 1 : 0);
+   SetConfigInt("ggpo.sync.codec", cfg.codec_mode);
+   SetConfigInt("ggpo.sync.lz4_accel", cfg.lz4_accel);
+   SetConfigInt("ggpo.transport", cfg.transport == 1 ? 1 : 0);
+   SetConfigInt("ggpo.broadcast.keyframe_interval", PERF_SPECTATE_KEYFRAME_INTERVAL);
+   sprintf_s(g_broadcast_session, ARRAY_SIZE(g_broadcast_session), "ggposyncperf-%d", Platform::GetProcessID());
+
+   for (int p = 0; p < 2; p++) {
+      PerfPeer *peer = &g_peers[p];
+
+      peer->state.data.assign(state_size, 0);
+      SeedState(peer->state, 0x12345678u);
+      peer->input_rng = 0x1000u + (uint32)p;
+      peer->frame_us.reserve((size_t)cfg.session_frames);
+      if (!StartPeer(cfg, p, false)) {
+         return false;
+      }
+      if (p == 0 && cfg.spectate_frame > 0 &&
+          !GGPO_SUCCEEDED(ggpo_start_relay_broadcast(peer->ggpo, cfg.relay_ip,
+                                                     (unsigned short)cfg.relay_port,
+                                                     g_broadcast_session))) {
+         return false;
+      }
+   }
+   return WaitForPeers(PeerRunning, NULL);
+}
+
+/*
+ * Closes the second peer's session, keeps the first one going without it
+ * for PERF_REJOIN_OUTAGE_MS and then starts the second again as a rejoin,
+ * from a blank state.  Returns once both sides report the rejoin; frame
+ * counts the first peer's frames meanwhile.
+ */
+static bool RejoinSecondPeer(const PerfConfig &cfg, int *frame)
+{
+   PerfPeer *peer = &g_peers[1];
+
+   SelectPeer(peer);
+   ggpo_close_session(peer->ggpo);
+   peer->ggpo = NULL;
+   ggpo_destroy_hub(g_hubs[1]);
+   g_hubs[1] = NULL;
+
+   g_outage_end = Platform::GetCurrentTimeMS() + PERF_REJOIN_OUTAGE_MS;
+   WaitForPeers(OutageOver, frame);
+
+   memset(peer->state.data.data(), 0, peer->state.data.size());
+   peer->running = false;
+   peer->stall_frames = 0;
+   if (!StartPeer(cfg, 1, true)) {
+      return false;
+   }
+   return WaitForPeers(PeerRejoined, frame);
+}
+
+static void WritePeerJson(FILE *fp, PerfPeer *peer, const GGPORollbackStats &rb,
+                          const std::vector<int> &sorted, int frames)
+{
+   fprintf(fp, "    {\"frames\": %d, \"stalled\": %d, \"rejected\": %d, \"desyncs\": %d,\n",
+           frames, peer->stalled, peer->rejected, peer->desyncs);
+   if (peer->rejoined) {
+      fprintf(fp, "     \"rejoin_frame\": %d, \"rejoin_ms\": %d, \"rejoin_bytes\": %d,\n",
+              peer->rejoin_frame, peer->rejoin_ms, peer->rejoin_bytes);
+   }
+   fprintf(fp, "     \"rollbacks\": %d, \"frames_resimulated\": %d, \"depth_p99\": %d, \"depth_max\": %d,\n",
+           rb.rollbacks, rb.frames_resimulated, rb.depth_p99, rb.depth_max);
+   fprintf(fp, "     \"mispredicted_frames\": %d, \"predicted_frames\": %d,\n",
+           rb.mispredicted_frames, rb.predicted_frames);
+   fprintf(fp, "     \"rollback_us\": {\"avg\": %d, \"p99\": %d, \"max\": %d},\n",
+           rb.total.avg_us, rb.total.p99_us, rb.total.max_us);
+   fprintf(fp, "     \"resim_us\": {\"avg\": %d, \"p99\": %d, \"max\": %d},\n",
+           rb.resim.avg_us, rb.resim.p99_us, rb.resim.max_us);
+   fprintf(fp, "     \"frame_us\": {\"p50\": %d, \"p99\": %d, \"p999\": %d, \"max\": %d},\n",
+           Percentile(sorted, 500), Percentile(sorted, 990), Percentile(sorted, 999),
+           sorted.empty() ? 0 : sorted.back());
+   fprintf(fp, "     \"kbytes_per_sec_sent\": %lld, \"ping_us\": %lld}",
+           peer->stats_samples ? peer->kbps_sum / peer->stats_samples : 0,
+           peer->stats_samples ? peer->ping_us_sum / peer->stats_samples : 0);
+}
+
+/*
+ * Runs both peers at 60 frames a second for cfg.session_frames frames and
+ * reports, per peer, how often and how deep it rolled back, what the
+ * rollbacks and frames cost and what went over the wire.
+ */
+static int RunSessionBench(const PerfConfig &cfg, size_t state_size)
+{
+   if (!StartSessions(cfg, state_size)) {
+      printf("Could not start the loopback sessions on ports %d and %d.\n", cfg.port, cfg.port + 1);
+      return 1;
+   }
+
+   uint64 start = Platform::GetCurrentTimeUS();
+   int frames = 0;
+   for (; frames < cfg.session_frames; frames++) {
+      if (g_peers[0].disconnected || g_peers[1].disconnected) {
+         break;
+      }
+      if (cfg.rejoin_frame > 0 && frames == cfg.rejoin_frame && cfg.transport != 2) {
+         if (!RejoinSecondPeer(cfg, &frames)) {
+            printf("The second peer did not rejoin at frame %d.\n", cfg.rejoin_frame);
+            break;
+         }
+         start = Platform::GetCurrentTimeUS() - (uint64)frames * PERF_SESSION_FRAME_US;
+      }
+      uint64 next = start + (uint64)(frames + 1) * PERF_SESSION_FRAME_US;
+
+      if (cfg.spectate_frame > 0 && frames == cfg.spectate_frame && cfg.transport != 1 && cfg.transport != 4 &&
+          !StartSpectator(cfg, state_size, frames)) {
+         printf("Could not start the relay spectator at frame %d.\n", frames);
+      }
+
+      if (cfg.delay_step_frame > 0 && (frames == cfg.delay_step_frame || frames == 2 * cfg.delay_step_frame)) {
+         int delay = cfg.frame_delay + (frames == cfg.delay_step_frame ? 2 : 0);
+         ggpo_set_frame_delay(g_peers[0].ggpo, g_peers[0].local_handle, delay);
+      }
+
+      RunSessionFrame(&g_peers[0], frames);
+      RunSessionFrame(&g_peers[1], frames);
+      do {
+         IdleSession(&g_peers[0]);
+         IdleSession(&g_peers[1]);
+         RunSpectator();
+         if (Platform::GetCurrentTimeUS() + 1000 < next) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+         }
+      } while (Platform::GetCurrentTimeUS() < next);
+   }
+
+   FILE *json = NULL;
+   if (cfg.json_path && fopen_s(&json, cfg.json_path, "w") == 0 && json) {
+      fprintf(json, "{\n  \"mode\": \"session\",\n");
+      fprintf(json, "  \"config\": {\"state_kb\": %d, \"mutation\": \"%s\", \"frames\": %d, "
+              "\"latency_ms\": %d, \"loss_percent\": %d, \"oop_percent\": %d, \"frame_delay\": %d, "
+              "\"codec\": %d, \"transport\": \"%s\"},\n",
+              cfg.state_kb, mutation_names[g_mutation], cfg.session_frames, cfg.latency_ms,
+              cfg.loss_percent, cfg.oop_percent, cfg.frame_delay, cfg.codec_mode,
+              transport_names[cfg.transport]);
+      fprintf(json, "  \"peers\": [\n");
+   }
+
+   printf("GGPO Session Perf Harness\n");
+   printf("State: %d KB %s, frames: %d/%d, latency: %d ms, loss: %d%%, oop: %d%%, frame delay: %d, transport: %s\n",
+          cfg.state_kb, mutation_names[g_mutation], frames, cfg.session_frames, cfg.latency_ms,
+          cfg.loss_percent, cfg.oop_percent, cfg.frame_delay, transport_names[cfg.transport]);
+
+   PerfSpectator *s = &g_spectator;
+   int checked = 0, matched = 0;
+   if (s->ggpo) {
+      for (size_t f = 0; f < s->checksums.size() && f < g_saved_checksums.size(); f++) {
+         if (s->checksums[f] >= 0 && g_saved_checksums[f] >= 0) {
+            checked++;
+            matched += s->checksums[f] == g_saved_checksums[f];
+         }
+      }
+      if (s->keyframe >= 0) {
+         printf("Spectator joined at frame %d: keyframe at frame %d, %d KB, ",
+                s->join_frame, s->keyframe, (s->keyframe_bytes + 1023) / 1024);
+      } else {
+         printf("Spectator joined at frame %d: no keyframe, ", s->join_frame);
+      }
+      printf("caught up in %d ms, %d frames played, %d/%d states matched\n",
+             s->catch_up_ms, s->played, matched, checked);
+   }
+
+   if (g_peers[0].rejoined && g_peers[1].rejoined) {
+      printf("Rejoin at frame %d: %d KB of state, resumed %d ms after the peer dropped, "
+             "%d ms after it restarted\n",
+             g_peers[1].rejoin_frame, (g_peers[0].rejoin_bytes + 1023) / 1024,
+             g_peers[0].rejoin_ms, g_peers[1].rejoin_ms);
+   }
+
+   for (int p = 0; p < 2; p++) {
+      PerfPeer *peer = &g_peers[p];
+      GGPORollbackStats rb;
+      std::vector<int> sorted(peer->frame_us);
+
+      memset(&rb, 0, sizeof(rb));
+      ggpo_get_rollback_stats(peer->ggpo, &rb);
+      std::sort(sorted.begin(), sorted.end());
+
+      printf("Peer %d: %d rollbacks (%.1f per 100 frames), %d frames resimulated, depth p99 %d max %d\n",
+             p + 1, rb.rollbacks, frames ? rb.rollbacks * 100.0 / frames : 0.0,
+             rb.frames_resimulated, rb.depth_p99, rb.depth_max);
+      printf("  rollback %d/%d/%d us avg/p99/max, resim %d/%d us avg/p99\n",
+             rb.total.avg_us, rb.total.p99_us, rb.total.max_us, rb.resim.avg_us, rb.resim.p99_us);
+      printf("  frame %d/%d/%d/%d us p50/p99/p99.9/max, %d stalled, %d rejected, %d desyncs\n",
+             Percentile(sorted, 500), Percentile(sorted, 990), Percentile(sorted, 999),
+             sorted.empty() ? 0 : sorted.back(), peer->stalled, peer->rejected, peer->desyncs);
+      printf("  %lld KB/s sent, ping %.2f ms\n",
+             peer->stats_samples ? peer->kbps_sum / peer->stats_samples : 0,
+             peer->stats_samples ? peer->ping_us_sum / 1000.0 / peer->stats_samples : 0.0);
+      if (cfg.hint || cfg.regions) {
+         GGPOStateStats st;
+         memset(&st, 0, sizeof(st));
+         ggpo_get_state_stats(peer->ggpo, &st);
+         printf("  %d delta frames, %d keyframes, %d hinted, %d segmented on %d threads\n",
+                st.delta_frames, st.keyframes, st.hinted_frames, st.segmented_keyframes,
+                st.compress_threads);
+      }
+
+      if (json) {
+         WritePeerJson(json, peer, rb, sorted, frames);
+         fprintf(json, p ? "\n" : ",\n");
+      }
+   }
+
+   if (json) {
+      fprintf(json, "  ]");
+      if (s->ggpo) {
+         fprintf(json, ",\n  \"spectator\": {\"join_frame\": %d, \"keyframe\": %d, \"keyframe_bytes\": %d, "
+                 "\"catch_up_ms\": %d, \"frames_played\": %d, \"states_checked\": %d, "
+                 "\"states_matched\": %d}",
+                 s->join_frame, s->keyframe, s->keyframe_bytes, s->catch_up_ms, s->played,
+                 checked, matched);
+      }
+      fprintf(json, "\n}\n");
+      fclose(json);
+   }
+
+   if (s->ggpo) {
+      g_active = &s->state;
+      ggpo_close_session(s->ggpo);
+      s->ggpo = NULL;
+   }
+
+   for (int p = 0; p < 2; p++) {
+      SelectPeer(&g_peers[p]);
+      ggpo_close_session(g_peers[p].ggpo);
+   }
+   for (int p = 0; p < 2; p++) {
+      GGPOHubStats hub;
+      if (g_hubs[p] && GGPO_SUCCEEDED(ggpo_get_hub_stats(g_hubs[p], &hub))) {
+         printf("Hub %d: %u/%u packets in/out, %u unrouted, %u syscalls\n",
+                p + 1, hub.packets_received, hub.packets_sent, hub.unrouted, hub.syscalls);
+      }
+      ggpo_destroy_hub(g_hubs[p]);
+      g_hubs[p] = NULL;
+   }
+   if (cfg.drop_originals && (g_peers[0].desyncs || g_peers[1].desyncs)) {
+      printf("FAILED: %d/%d desyncs with only the input copies getting through.\n",
+             g_peers[0].desyncs, g_peers[1].desyncs);
+      return 1;
+   }
+   if (cfg.delay_step_frame > 0 && (g_peers[0].desyncs || g_peers[1].desyncs)) {
+      printf("FAILED: %d/%d desyncs across the frame delay changes.\n",
+             g_peers[0].desyncs, g_peers[1].desyncs);
+      return 1;
+   }
+   return 0;
+}
+
 int main(int argc, char **argv)
 {
    PerfConfig cfg = ParseArgs(argc, argv);
@@ -220,15 +1455,27 @@ int main(int argc, char **argv)
       PrintUsage(argv[0]);
       return 0;
    }
+   if (cfg.input_window > 0) {
+      return RunInputCodecBench(cfg.input_window);
+   }
+   if (cfg.queue_lag > 0) {
+      return RunInputQueueBench(cfg.queue_lag);
+   }
 
    size_t state_size = (size_t)cfg.state_kb * 1024u;
    if (state_size == 0 || state_size > (size_t)INT_MAX) {
       printf("Invalid state size.\n");
       return 1;
    }
+   g_mutation = (PerfMutation)cfg.mutation;
+   g_hint = cfg.hint;
+
+   if (cfg.session_frames > 0) {
+      return RunSessionBench(cfg, state_size);
+   }
 
    g_state.data.assign(state_size, 0);
-   g_state.rng = 0x12345678u;
+   SeedState(g_state, 0x12345678u);
 
    UdpMsg::connect_status connect_status[UDP_MSG_MAX_PLAYERS];
    memset(connect_status, 0, sizeof(connect_status));
@@ -247,12 +1494,20 @@ int main(int argc, char **argv)
    config.callbacks = callbacks;
    config.num_players = 2;
    config.input_size = 4;
-   config.num_prediction_frames = MAX_PREDICTION_FRAMES;
+   config.num_prediction_frames = cfg.prediction_frames;
+   config.keyframe_interval = cfg.keyframe_interval;
    config.lz4_accel = cfg.lz4_accel;
+   config.codec_mode = cfg.codec_mode;
+   config.raw_memory_ceiling_kb = cfg.raw_ceiling_kb;
    config.async_compress = 0;
 
    PerfSync sync(connect_status);
    sync.Init(config);
+   if (cfg.regions) {
+      GGPOStateRegion regions[2];
+      MakeRegions(state_size, regions);
+      sync.SetStateRegions(regions, 2);
+   }
 
    unsigned long long total_uncompressed = 0;
    unsigned long long total_compressed = 0;
@@ -260,7 +1515,7 @@ int main(int argc, char **argv)
 
    uint32 save_start = Platform::GetCurrentTimeMS();
    for (int i = 0; i < cfg.frames; ++i) {
-      MutateState();
+      MutateState(g_state, 0);
       sync.SetFrameCount(i);
       sync.SaveFrame();
       int uncompressed_size = 0;
@@ -279,8 +1534,7 @@ int main(int argc, char **argv)
    }
 
    int current_frame = cfg.frames - 1;
-   int ring_size = MAX_PREDICTION_FRAMES + 2;
-   int oldest_frame = current_frame - (ring_size - 1);
+   int oldest_frame = current_frame - sync.GetPredictionFrames();
    if (oldest_frame < 0) {
       oldest_frame = 0;
    }
@@ -312,8 +1566,9 @@ int main(int argc, char **argv)
    }
 
    printf("GGPO Sync Perf Harness\n");
-   printf("State: %d KB, frames: %d, loads: %d, lz4_accel: %d\n",
-          cfg.state_kb, cfg.frames, cfg.loads, cfg.lz4_accel);
+   printf("State: %d KB, frames: %d, loads: %d, lz4_accel: %d, prediction: %d, keyframe interval: %d\n",
+          cfg.state_kb, cfg.frames, cfg.loads, cfg.lz4_accel,
+          sync.GetPredictionFrames(), sync.GetKeyframeInterval());
    printf("Save: %d frames in %d ms (%.1f fps)\n", cfg.frames, save_ms, save_fps);
    if (load_span > 0) {
       printf("Load: %d loads in %d ms (%.1f fps)\n", cfg.loads, load_ms, load_fps);
@@ -326,5 +1581,47 @@ int main(int argc, char **argv)
           (unsigned long long)(total_uncompressed / (unsigned long long)cfg.frames),
           (unsigned long long)(total_compressed / (unsigned long long)cfg.frames));
 
+   static const char *codec_names[GGPO_STATE_CODEC_COUNT] = { "raw", "lz4", "lz4hc", "zstd" };
+   GGPOStateStats stats;
+   sync.GetStateStats(&stats);
+   for (int i = 0; i < GGPO_STATE_CODEC_COUNT; ++i) {
+      if (stats.codec_frames[i] > 0) {
+         printf("Codec %s: %d frames, avg %d%%, %d us/frame\n", codec_names[i],
+                stats.codec_frames[i], stats.codec_ratio_avg[i], stats.codec_us_avg[i]);
+      }
+   }
+   printf("Saved ring: %d KB, %d frames compressed over the raw ceiling\n",
+          stats.saved_state_kb, stats.ceiling_compressed_frames);
+   if (cfg.regions) {
+      printf("Segmented: %d keyframes on %d threads\n",
+             stats.segmented_keyframes, stats.compress_threads);
+   }
+
+   FILE *json = NULL;
+   if (cfg.json_path && fopen_s(&json, cfg.json_path, "w") == 0 && json) {
+      fprintf(json, "{\n  \"mode\": \"sync\",\n");
+      fprintf(json, "  \"config\": {\"state_kb\": %d, \"mutation\": \"%s\", \"frames\": %d, "
+              "\"loads\": %d, \"lz4_accel\": %d, \"prediction\": %d, \"keyframe_interval\": %d, "
+              "\"codec\": %d, \"raw_ceiling_kb\": %d},\n",
+              cfg.state_kb, mutation_names[g_mutation], cfg.frames, cfg.loads, cfg.lz4_accel,
+              sync.GetPredictionFrames(), sync.GetKeyframeInterval(), cfg.codec_mode, cfg.raw_ceiling_kb);
+      fprintf(json, "  \"save_fps\": %.1f, \"load_fps\": %.1f, \"compressed_frames\": %d,\n",
+              save_fps, load_fps, compressed_frames);
+      fprintf(json, "  \"avg_ratio_percent\": %.1f, \"saved_state_kb\": %d,\n",
+              avg_ratio * 100.0, stats.saved_state_kb);
+      fprintf(json, "  \"codecs\": {");
+      bool first = true;
+      for (int i = 0; i < GGPO_STATE_CODEC_COUNT; ++i) {
+         if (stats.codec_frames[i] > 0) {
+            fprintf(json, "%s\"%s\": {\"frames\": %d, \"ratio_percent\": %d, \"us\": %d}",
+                    first ? "" : ", ", codec_names[i], stats.codec_frames[i],
+                    stats.codec_ratio_avg[i], stats.codec_us_avg[i]);
+            first = false;
+         }
+      }
+      fprintf(json, "}\n}\n");
+      fclose(json);
+   }
+
    return 0;
 }
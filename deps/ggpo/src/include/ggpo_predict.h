@@ -0,0 +1,233 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#ifndef _GGPO_PREDICT_H_
+#define _GGPO_PREDICT_H_
+
+/*
+ * Input prediction models.  GGPO uses them to guess the remote players'
+ * input for frames it has not received yet, and the header has no other
+ * dependency so a frontend can guess its own speculative frames (run-ahead)
+ * the same way.
+ *
+ * A prediction is a pure function of a short history of confirmed inputs
+ * and how far past the newest one it reaches, so asking again for the
+ * same frame gives the same answer.  GGPO relies on that to check a guess
+ * when the real input arrives.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef GGPO_PREDICT_INLINE
+#  if defined(__cplusplus)
+#     define GGPO_PREDICT_INLINE inline
+#  elif defined(_MSC_VER) || defined(__GNUC__)
+#     define GGPO_PREDICT_INLINE __inline
+#  else
+#     define GGPO_PREDICT_INLINE
+#  endif
+#endif
+
+/* Confirmed frames the models look back over */
+#define GGPO_PREDICT_HISTORY 32
+
+typedef enum {
+   /* The newest input stays held: GGPO's original behaviour */
+   GGPO_PREDICT_REPEAT = 0,
+   /*
+    * Each button whose earlier presses (or releases) in the history lasted
+    * about the same number of frames flips once its current state has
+    * lasted that long.  Buttons without such a pattern, and buttons held
+    * or released longer than usual, stay put, so on irregular input this
+    * guesses what GGPO_PREDICT_REPEAT would.  Catches mashing and taps of
+    * a steady length.
+    */
+   GGPO_PREDICT_HOLD,
+   GGPO_PREDICT_MODEL_COUNT
+} GGPOPredictModel;
+
+/* Leading input bytes GGPO_PREDICT_HOLD can treat as button bits */
+#define GGPO_PREDICT_MAX_BUTTON_BYTES 16
+
+/*
+ * What a model worked out from one history: the button bits that flip,
+ * and how many frames past the newest input each one does.  Every other
+ * bit is held.  ggpo_predict_start fills it in once, so guessing many
+ * frames from the same history does not rescan it.
+ */
+typedef struct {
+   int flips;
+   unsigned char bit[GGPO_PREDICT_MAX_BUTTON_BYTES * 8];
+   unsigned char ahead[GGPO_PREDICT_MAX_BUTTON_BYTES * 8];
+} GGPOPredictRuns;
+
+/*
+ * ggpo_predict_button_runs --
+ *
+ * How many frames past the newest of count history entries of size
+ * bytes each, oldest first, one button bit flips under GGPO_PREDICT_HOLD,
+ * or 0 if it is held.
+ */
+static GGPO_PREDICT_INLINE int
+ggpo_predict_button_runs(const unsigned char *history, int count, int size,
+                         int bit)
+{
+   int byte = bit / 8;
+   int mask = 1 << (bit % 8);
+   int value = (history[(count - 1) * size + byte] & mask) != 0;
+   int run = 0, runs = 0, total = 0, length = 0;
+   int shortest = count, longest = 0;
+   int i;
+
+   /* Current run, then every earlier run of the same state that is
+    * bounded on both sides within the history. */
+   for (i = count - 1; i >= 0 && ((history[i * size + byte] & mask) != 0) == value; i--) {
+      run++;
+   }
+   for (; i >= 0; i--) {
+      if (((history[i * size + byte] & mask) != 0) == value) {
+         length++;
+      } else if (length) {
+         runs++;
+         total += length;
+         if (length < shortest) {
+            shortest = length;
+         }
+         if (length > longest) {
+            longest = length;
+         }
+         length = 0;
+      }
+   }
+
+   /*
+    * One run is no pattern, and runs of scattered lengths flip at a
+    * frame unrelated to their average, which mispredicts more often than
+    * holding does.
+    */
+   if (runs < 2 || longest - shortest > 1 + total / runs / 4 || run * runs > total) {
+      return 0;
+   }
+   return total / runs + 1 - run;
+}
+
+/*
+ * ggpo_predict_start --
+ *
+ * Works out how model predicts from count history entries of size bytes
+ * each, oldest first.  Under GGPO_PREDICT_HOLD only the first
+ * button_bytes bytes (at most GGPO_PREDICT_MAX_BUTTON_BYTES) are treated
+ * as button bits; the rest (axes, pointers) repeat the newest input.
+ */
+static GGPO_PREDICT_INLINE void
+ggpo_predict_start(GGPOPredictModel model, const unsigned char *history,
+                   int count, int size, int button_bytes,
+                   GGPOPredictRuns *runs)
+{
+   unsigned char once[GGPO_PREDICT_MAX_BUTTON_BYTES];
+   unsigned char twice[GGPO_PREDICT_MAX_BUTTON_BYTES];
+   unsigned char often[GGPO_PREDICT_MAX_BUTTON_BYTES];
+   int i, j;
+
+   runs->flips = 0;
+   if (model != GGPO_PREDICT_HOLD || count <= 0) {
+      return;
+   }
+   if (button_bytes > size) {
+      button_bytes = size;
+   }
+   if (button_bytes > GGPO_PREDICT_MAX_BUTTON_BYTES) {
+      button_bytes = GGPO_PREDICT_MAX_BUTTON_BYTES;
+   }
+
+   /*
+    * Two earlier runs of the current state take five changes, and most
+    * buttons change far less in a history, so count every bit's changes
+    * up to four at once, a counter bit per plane, and skip the rest.
+    */
+   for (j = 0; j < button_bytes; j++) {
+      once[j] = twice[j] = often[j] = 0;
+   }
+   for (i = 1; i < count; i++) {
+      for (j = 0; j < button_bytes; j++) {
+         unsigned char change = history[i * size + j] ^ history[(i - 1) * size + j];
+         unsigned char carry = once[j] & change;
+
+         once[j] ^= change;
+         often[j] |= twice[j] & carry;
+         twice[j] ^= carry;
+      }
+   }
+   for (i = 0; i < button_bytes * 8; i++) {
+      int ahead;
+
+      if (!(often[i / 8] & (1 << (i % 8)))) {
+         continue;
+      }
+      if ((ahead = ggpo_predict_button_runs(history, count, size, i)) != 0) {
+         runs->bit[runs->flips] = (unsigned char)i;
+         runs->ahead[runs->flips] = (unsigned char)ahead;
+         runs->flips++;
+      }
+   }
+}
+
+/*
+ * ggpo_predict_runs --
+ *
+ * Writes the prediction for frames_ahead (>= 1) frames past the newest of
+ * count history entries into out, size bytes, from what
+ * ggpo_predict_start worked out for the same history.  No history
+ * predicts zeros.
+ */
+static GGPO_PREDICT_INLINE void
+ggpo_predict_runs(const GGPOPredictRuns *runs, const unsigned char *history,
+                  int count, int size, int frames_ahead, unsigned char *out)
+{
+   int i;
+
+   if (count <= 0) {
+      for (i = 0; i < size; i++) {
+         out[i] = 0;
+      }
+      return;
+   }
+
+   for (i = 0; i < size; i++) {
+      out[i] = history[(count - 1) * size + i];
+   }
+   for (i = 0; i < runs->flips; i++) {
+      if (frames_ahead >= runs->ahead[i]) {
+         out[runs->bit[i] / 8] ^= (unsigned char)(1 << (runs->bit[i] % 8));
+      }
+   }
+}
+
+/*
+ * ggpo_predict --
+ *
+ * ggpo_predict_start and ggpo_predict_runs in one go, for a single guess
+ * from a history.
+ */
+static GGPO_PREDICT_INLINE void
+ggpo_predict(GGPOPredictModel model, const unsigned char *history,
+             int count, int size, int button_bytes, int frames_ahead,
+             unsigned char *out)
+{
+   GGPOPredictRuns runs;
+
+   ggpo_predict_start(model, history, count, size, button_bytes, &runs);
+   ggpo_predict_runs(&runs, history, count, size, frames_ahead, out);
+}
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
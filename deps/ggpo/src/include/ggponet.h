@@ -40,6 +40,8 @@ extern "C" {
 
 #define GGPO_SPECTATOR_INPUT_INTERVAL     4
 
+#define GGPO_CONTROL_MAX_SIZE            16
+
 typedef struct GGPOSession GGPOSession;
 
 typedef int GGPOPlayerHandle;
@@ -123,6 +125,12 @@ typedef enum {
 
 #define GGPO_INVALID_HANDLE      (-1)
 
+/*
+ * Set in the flags passed to advance_frames when the batch ends on the last
+ * frame of the rollback, i.e. the frame that will actually be presented.
+ */
+#define GGPO_ADVANCE_FRAMES_LAST (1 << 0)
+
 
 /*
  * The GGPOEventCode enumeration describes what type of event just happened.
@@ -149,6 +157,29 @@ typedef enum {
  * down to ensure fairness.  The u.timesync.frames_ahead parameter in
  * the GGPOEvent object indicates how many frames the client is.
  *
+ * GGPO_EVENTCODE_DESYNC - A peer's checksum for a confirmed frame differs
+ * from ours.  u.desync.last_match_frame is the newest frame that did
+ * match, or -1.  The states of both frames can be fetched with
+ * ggpo_get_checksum_state while GGPO still keeps them.
+ *
+ * GGPO_EVENTCODE_PEER_REJOINING - A peer that dropped out restarted within
+ * the reconnect window (see ggpo_set_reconnect_window) and is picking the
+ * match back up.  The session stalls until it has caught up.
+ *
+ * GGPO_EVENTCODE_PEER_REJOINED - The rejoin is done and the match carries
+ * on from u.rejoined.frame.  resume_ms is how long the peer was gone: from
+ * the last packet of its old session on the side that stayed, from
+ * ggpo_rejoin_session on the side that rejoined.  state_bytes is the size
+ * of the state sent over, compressed.
+ *
+ * GGPO_EVENTCODE_KEYFRAME_LOADED - A relay spectator loaded the relay's
+ * keyframe through load_game_state and plays the match from
+ * u.keyframe_loaded.frame instead of frame 0.  state_bytes is the size
+ * of the keyframe as fetched, compressed.
+ *
+ * GGPO_EVENTCODE_CONTROL - u.control.player sent u.control.size bytes
+ * with ggpo_send_control.
+ *
  */
 typedef enum {
    GGPO_EVENTCODE_CONNECTED_TO_PEER            = 1000,
@@ -159,6 +190,11 @@ typedef enum {
    GGPO_EVENTCODE_TIMESYNC                     = 1005,
    GGPO_EVENTCODE_CONNECTION_INTERRUPTED       = 1006,
    GGPO_EVENTCODE_CONNECTION_RESUMED           = 1007,
+   GGPO_EVENTCODE_DESYNC                       = 1008,
+   GGPO_EVENTCODE_PEER_REJOINING               = 1009,
+   GGPO_EVENTCODE_PEER_REJOINED                = 1010,
+   GGPO_EVENTCODE_KEYFRAME_LOADED              = 1011,
+   GGPO_EVENTCODE_CONTROL                      = 1012,
 } GGPOEventCode;
 
 /*
@@ -193,6 +229,31 @@ typedef struct {
       struct {
          GGPOPlayerHandle  player;
       } connection_resumed;
+      struct {
+         GGPOPlayerHandle  player;
+         int               frame;
+         int               local_checksum;
+         int               remote_checksum;
+         int               last_match_frame;
+      } desync;
+      struct {
+         GGPOPlayerHandle  player;
+      } rejoining;
+      struct {
+         GGPOPlayerHandle  player;
+         int               frame;
+         int               resume_ms;
+         int               state_bytes;
+      } rejoined;
+      struct {
+         int               frame;
+         int               state_bytes;
+      } keyframe_loaded;
+      struct {
+         GGPOPlayerHandle  player;
+         int               size;
+         unsigned char     data[GGPO_CONTROL_MAX_SIZE];
+      } control;
    } u;
 } GGPOEvent;
 
@@ -217,7 +278,13 @@ typedef struct {
    * If *buffer is non-null and *len is greater than zero, GGPO may be
    * providing a reuse buffer.  If the buffer is large enough, you can
    * serialize into it and set *buffer to the same pointer to avoid
-   * per-frame allocations.
+   * per-frame allocations.  On entry *len holds the capacity of that
+   * buffer; on return it must hold the number of bytes written.  If the
+   * state no longer fits, allocate a new buffer instead; GGPO will
+   * release the offered one.  See ggpo_set_state_buffer_capacity.
+   *
+   * Returning false discards the frame; any buffer left in *buffer is
+   * released by GGPO.
    */
    bool (__cdecl *save_game_state)(unsigned char **buffer, int *len, int *checksum, int frame);
 
@@ -259,8 +326,45 @@ typedef struct {
     * structure above for more information.
     */
    bool (__cdecl *on_event)(GGPOEvent *info);
+
+   /*
+    * advance_frames - Optional.  When set, rollbacks call this instead of
+    * advance_frame and hand over whole runs of frames at once.  inputs holds
+    * count frames of synchronized input back to back, size bytes each (the
+    * same layout ggpo_synchronize_input fills in), and disconnect_flags has
+    * one entry per frame.  Advance your game state by exactly count frames
+    * using those inputs; do not call ggpo_synchronize_input or
+    * ggpo_advance_frame from inside this callback.
+    *
+    * GGPO.net saves state only at the end of each run, so runs whose
+    * inputs are all confirmed are replayed without any save in between.
+    * flags may contain GGPO_ADVANCE_FRAMES_LAST.
+    */
+   bool (__cdecl *advance_frames)(const void *inputs, int size,
+                                  const int *disconnect_flags, int count, int flags);
+
+   /*
+    * checksum_game_state - Optional.  When set, GGPO.net takes a saved
+    * frame's checksum from this instead of save_game_state's *checksum, and
+    * with async compression calls it from the compression thread, after
+    * save_game_state has returned.  buffer is the state as saved; only read
+    * it, and do not call into GGPO.net.  Return 0 for no checksum.
+    */
+   int (__cdecl *checksum_game_state)(const unsigned char *buffer, int len, int frame);
 } GGPOSessionCallbacks;
 
+/*
+ * What a session's datagrams travel over.  UDP is a socket of the
+ * session's own or a hub's, and TUNNEL a link the application carries them
+ * over itself (ggpo_start_tunnel_session).
+ */
+typedef enum {
+   GGPO_TRANSPORT_UDP      = 0,
+   GGPO_TRANSPORT_LOOPBACK = 1,
+   GGPO_TRANSPORT_RELAY    = 2,
+   GGPO_TRANSPORT_TUNNEL   = 3,
+} GGPOTransportKind;
+
 /*
  * The GGPONetworkStats function contains some statistics about the current
  * session.
@@ -282,9 +386,38 @@ typedef struct {
  * packet transmission time + 2 the interval at which you call ggpo_idle
  * or ggpo_advance_frame.
  *
+ * network.ping_us - The same round trip time in microseconds.  Peers on
+ * an older wire version only report whole milliseconds.
+ *
  * network.kbps_sent - The estimated bandwidth used between the two
  * clients, in kilobits per second.
  *
+ * network.syscalls_per_frame_x100 - Socket send/receive syscalls per frame
+ * for the whole session (not just this player), times 100.
+ *
+ * network.batched_io - Non-zero when datagrams are moved with
+ * recvmmsg/sendmmsg rather than one recvfrom/sendto each.
+ *
+ * network.loss_percent - Packet loss on our stream to this peer, as
+ * last reported by the peer (0-100).
+ *
+ * network.fec_level - Redundant copies currently sent of each input
+ * packet (see ggpo.network.fec).
+ *
+ * network.fec_copies_sent - Total redundant input copies sent.
+ *
+ * network.fec_recovered - Remote frames that arrived first in a redundant
+ * copy because the original packet was lost or late.
+ *
+ * network.resent - Times pending input had to be resent after
+ * RUNNING_RETRY_INTERVAL without hearing from the peer.
+ *
+ * network.coalesced - Quality reports and replies sent inside an input
+ * packet rather than in a datagram of their own.
+ *
+ * network.transport - What carries the session's datagrams, one of
+ * GGPOTransportKind.
+ *
  * timesync.local_frames_behind - The number of frames GGPO.net calculates
  * that the local client is behind the remote client at this instant in
  * time.  For example, if at this instant the current game client is running
@@ -300,7 +433,17 @@ typedef struct GGPONetworkStats {
       int   send_queue_len;
       int   recv_queue_len;
       int   ping;
+      int   ping_us;
       int   kbps_sent;
+      int   syscalls_per_frame_x100;
+      int   batched_io;
+      int   loss_percent;
+      int   fec_level;
+      int   fec_copies_sent;
+      int   fec_recovered;
+      int   resent;
+      int   coalesced;
+      int   transport;
    } network;
    struct {
       int   local_frames_behind;
@@ -308,6 +451,35 @@ typedef struct GGPONetworkStats {
    } timesync;
 } GGPONetworkStats;
 
+/*
+ * Codecs Sync can store saved frames with.  Also indexes the per-codec
+ * arrays in GGPOStateStats.
+ */
+typedef enum {
+   GGPO_STATE_CODEC_RAW = 0,
+   GGPO_STATE_CODEC_LZ4 = 1,
+   GGPO_STATE_CODEC_LZ4HC = 2,
+   GGPO_STATE_CODEC_ZSTD = 3,
+   GGPO_STATE_CODEC_COUNT
+} GGPOStateCodec;
+
+/*
+ * How Sync picks a codec for each saved frame (ggpo.sync.codec).
+ *
+ * LZ4HC_IDLE uses LZ4HC when the compression worker has nothing else
+ * queued and plain LZ4 otherwise.  ZSTD_FAST uses zstd at a negative
+ * (fast) level and falls back to LZ4 when zstd is not compiled in.
+ * ADAPTIVE measures compress time against ggpo.sync.compress_budget_us and
+ * moves between raw, LZ4 and zstd.
+ */
+typedef enum {
+   GGPO_STATE_CODEC_MODE_LZ4 = 0,
+   GGPO_STATE_CODEC_MODE_LZ4HC_IDLE = 1,
+   GGPO_STATE_CODEC_MODE_ZSTD_FAST = 2,
+   GGPO_STATE_CODEC_MODE_RAW = 3,
+   GGPO_STATE_CODEC_MODE_ADAPTIVE = 4
+} GGPOStateCodecMode;
+
 typedef struct GGPOStateStats {
    int delta_frames;
    int keyframes;
@@ -319,8 +491,114 @@ typedef struct GGPOStateStats {
    int compress_pending_count;
    int compress_job_queue_max;
    int compress_result_queue_max;
+   int compress_wait_count;
+   int compress_wait_us_total;
+   int compress_wait_us_max;
+   int frame_cache_hits;
+   int frame_cache_misses;
+   int frame_cache_prepared;
+   int codec;                                   /* GGPOStateCodec used for the last frame */
+   int codec_frames[GGPO_STATE_CODEC_COUNT];
+   int codec_ratio_avg[GGPO_STATE_CODEC_COUNT];  /* output / input, percent */
+   int codec_us_avg[GGPO_STATE_CODEC_COUNT];     /* compress time per frame */
+   int saved_state_kb;                          /* memory held by the saved-frame ring */
+   int ceiling_compressed_frames;               /* frames compressed only to stay under the raw ceiling */
+   int replay_saves_skipped;                    /* rollback saves advance_frames made unnecessary */
+   int hinted_frames;                           /* delta searches limited to ggpo_hint_state_changes ranges */
+   int segmented_keyframes;                     /* keyframes compressed per ggpo_set_state_regions segment */
+   int compress_threads;                        /* workers in the shared compression pool */
 } GGPOStateStats;
 
+/* A byte range of a saved state; see ggpo_hint_state_changes. */
+typedef struct GGPOStateRange {
+   int offset;
+   int length;
+} GGPOStateRange;
+
+/* What a region of the saved state holds; see ggpo_set_state_regions. */
+typedef enum {
+   GGPO_STATE_REGION_OTHER = 0,
+   GGPO_STATE_REGION_WORK_RAM = 1,
+   GGPO_STATE_REGION_VIDEO_RAM = 2,
+   GGPO_STATE_REGION_SAVE_RAM = 3
+} GGPOStateRegionKind;
+
+typedef struct GGPOStateRegion {
+   int offset;
+   int length;
+   int kind;                                    /* GGPOStateRegionKind */
+} GGPOStateRegion;
+
+/*
+ * Rollback profile.  Depth is the number of frames resimulated; the last
+ * depth bucket collects everything at or beyond it.  Time bucket i counts
+ * rollbacks whose total wall time was below 2^(i+1) microseconds (bucket 0
+ * also takes anything under 1us, the last one everything slower).
+ * Percentiles are taken over the most recent GGPO_ROLLBACK_SAMPLE_WINDOW
+ * rollbacks; counters and histograms cover the whole session.
+ */
+#define GGPO_ROLLBACK_DEPTH_BUCKETS 33
+#define GGPO_ROLLBACK_TIME_BUCKETS  20
+#define GGPO_ROLLBACK_SAMPLE_WINDOW 512
+
+typedef struct GGPORollbackTimes {
+   int avg_us;
+   int p50_us;
+   int p95_us;
+   int p99_us;
+   int max_us;
+} GGPORollbackTimes;
+
+typedef struct GGPORollbackStats {
+   int rollbacks;
+   int frames_resimulated;
+   int depth_p50;
+   int depth_p95;
+   int depth_p99;
+   int depth_max;
+   int depth_histogram[GGPO_ROLLBACK_DEPTH_BUCKETS];
+   int time_histogram[GGPO_ROLLBACK_TIME_BUCKETS];
+   GGPORollbackTimes total;
+   GGPORollbackTimes load;                      /* load_game_state of the target frame */
+   GGPORollbackTimes resim;                     /* advance_frame(s) callbacks, less saves */
+   GGPORollbackTimes save;                      /* save_game_state of the replayed frames */
+   int predicted_frames;                        /* remote input frames run on a guess */
+   int mispredicted_frames;                     /* of those, guesses the real input did not match */
+} GGPORollbackStats;
+
+/*
+ * How the session corrects a frame advantage imbalance.  STALL is the
+ * original behaviour: GGPO_EVENTCODE_TIMESYNC asks the client ahead to
+ * wait whole frames.  SLEW sends no events; instead slew_permille in
+ * GGPOTimeSyncStats says how much slower to run, so the correction can be
+ * spread thinly over many frames.
+ */
+typedef enum {
+   GGPO_TIMESYNC_STALL = 0,
+   GGPO_TIMESYNC_SLEW  = 1,
+} GGPOTimeSyncMode;
+
+#define GGPO_TIMESYNC_HISTORY       64
+#define GGPO_TIMESYNC_MAX_SLEW      100   /* permille */
+
+/*
+ * Frame advantage error, in hundredths of a frame: half the gap between
+ * the remote's averaged frame advantage and ours, positive when we are
+ * ahead.  Sampled once per frame; error_history_x100 keeps one sample per
+ * 60 frames, oldest first.
+ */
+typedef struct GGPOTimeSyncStats {
+   int mode;                                    /* GGPOTimeSyncMode */
+   int error_x100;
+   int error_avg_x100;                          /* mean |error| over the session */
+   int error_max_x100;                          /* largest |error| over the session */
+   int slew_permille;                           /* slow down by this much; SLEW only */
+   int stall_events;                            /* GGPO_EVENTCODE_TIMESYNC events sent */
+   int stall_frames;                            /* frames those events asked for */
+   int history_len;
+   int error_history_x100[GGPO_TIMESYNC_HISTORY];
+} GGPOTimeSyncStats;
+
 /*
  * ggpo_start_session --
  *
@@ -343,6 +621,10 @@ typedef struct GGPOStateStats {
  * input_size - The size of the game inputs which will be passsed to ggpo_add_local_input.
  *
  * local_port - The port GGPO should bind to for UDP traffic.
+ *
+ * Setting ggpo.transport to 1 keeps the session's traffic inside the
+ * process: every remote address is taken as another session's local_port.
+ * Meant for benchmarks and tests driven with ggpo_idle.
  */
 GGPO_API GGPOErrorCode __cdecl ggpo_start_session(GGPOSession **session,
                                                   GGPOSessionCallbacks *cb,
@@ -389,9 +671,16 @@ GGPO_API GGPOErrorCode __cdecl ggpo_add_player(GGPOSession *session,
  * input_size - The size of the game inputs which will be passsed to ggpo_add_local_input.
  *
  * frames - The number of frames to run before verifying the prediction.  The
- * recommended value is 1.
+ * recommended value is 1, at most GGPO_SYNCTEST_MAX_FRAMES.
+ *
+ * A mismatch breaks into the debugger.  With ggpo.synctest.soak set it is
+ * raised as GGPO_EVENTCODE_DESYNC instead (local_checksum from the replay,
+ * remote_checksum from the first run) and the test goes on, so a frontend
+ * can qualify a core unattended.
  *
  */
+#define GGPO_SYNCTEST_MAX_FRAMES 31
+
 GGPO_API GGPOErrorCode __cdecl ggpo_start_synctest(GGPOSession **session,
                                                    GGPOSessionCallbacks *cb,
                                                    char *game,
@@ -433,6 +722,192 @@ GGPO_API GGPOErrorCode __cdecl ggpo_start_spectating(GGPOSession **session,
                                                      char *host_ip,
                                                      unsigned short host_port);
 
+/*
+ * ggpo_start_relay_session --
+ *
+ * Start a two player session whose traffic goes through a relay that tells
+ * matches apart by session id (see relay-server/README.md), rather than by
+ * the addresses that sent a HELLO.  No handshake with the relay is needed
+ * first, and one relay socket can carry any number of matches.  The
+ * parameters are as for ggpo_start_session, plus:
+ *
+ * relay_ip, relay_port - The relay.  Add the remote player with this
+ * address as well.
+ *
+ * session_id - The match, at most 64 bytes; both peers give the same one.
+ *
+ * slot - 1 or 2, different for each peer.
+ */
+GGPO_API GGPOErrorCode __cdecl ggpo_start_relay_session(GGPOSession **session,
+                                                        GGPOSessionCallbacks *cb,
+                                                        const char *game,
+                                                        int num_players,
+                                                        int input_size,
+                                                        unsigned short local_port,
+                                                        const char *relay_ip,
+                                                        unsigned short relay_port,
+                                                        const char *session_id,
+                                                        int slot);
+
+/*
+ * ggpo_start_tunnel_session --
+ *
+ * Start a two player session whose datagrams the application carries to
+ * the remote player itself, for a peer that can't be reached over UDP but
+ * can over some stream, such as a TCP tunnel.  The parameters are as for
+ * ggpo_start_session, less the local port.  Add the remote player with
+ * any address; the tunnel has only the one peer.
+ *
+ * Every datagram must reach the other side whole, with its length, as it
+ * was read; order and loss are handled as over UDP.  Drain what the
+ * session sends with ggpo_tunnel_read and pass on what arrives with
+ * ggpo_tunnel_write, both as often as the session is idled.  A datagram
+ * is at most GGPO_TUNNEL_MAX_PACKET bytes.
+ */
+#define GGPO_TUNNEL_MAX_PACKET   4096
+
+GGPO_API GGPOErrorCode __cdecl ggpo_start_tunnel_session(GGPOSession **session,
+                                                         GGPOSessionCallbacks *cb,
+                                                         const char *game,
+                                                         int num_players,
+                                                         int input_size);
+
+/*
+ * ggpo_tunnel_read --
+ *
+ * Takes the next datagram a tunnel session sent.  *len is the size of
+ * buffer on the way in and the datagram's length on the way out, 0 once
+ * there are none left.  May be called from any thread.
+ */
+GGPO_API GGPOErrorCode __cdecl ggpo_tunnel_read(GGPOSession *ggpo,
+                                                void *buffer,
+                                                int *len);
+
+/*
+ * ggpo_tunnel_write --
+ *
+ * Hands a tunnel session a datagram that came through the tunnel.  It is
+ * dropped, like one a full socket buffer has no room for, if the session
+ * is behind on taking them.  May be called from any thread.
+ */
+GGPO_API GGPOErrorCode __cdecl ggpo_tunnel_write(GGPOSession *ggpo,
+                                                 const void *data,
+                                                 int len);
+
+/*
+ * GGPOHub --
+ *
+ * One UDP socket shared by many sessions, for a process hosting many
+ * matches at once.  The hub reads the socket on a thread of its own and
+ * hands each datagram to the sessions that have sent to its source
+ * address (the peers and spectators they were given); anything else is
+ * dropped and counted in unrouted.  Each session is still driven by its
+ * own ggpo_idle and may run on a thread of its own.
+ */
+typedef struct GGPOHub GGPOHub;
+
+typedef struct GGPOHubStats {
+   int            sessions;
+   unsigned int   packets_received;
+   unsigned int   bytes_received;
+   unsigned int   packets_sent;
+   unsigned int   bytes_sent;
+   unsigned int   unrouted;
+   unsigned int   syscalls;
+} GGPOHubStats;
+
+/*
+ * ggpo_create_hub --
+ *
+ * Binds the shared socket to port and starts the hub's I/O thread.
+ */
+GGPO_API GGPOErrorCode __cdecl ggpo_create_hub(GGPOHub **hub,
+                                               unsigned short port);
+
+/*
+ * ggpo_destroy_hub --
+ *
+ * Stops the hub.  Close every session started on it first; while any
+ * remain this returns GGPO_ERRORCODE_INVALID_REQUEST.
+ */
+GGPO_API GGPOErrorCode __cdecl ggpo_destroy_hub(GGPOHub *hub);
+
+GGPO_API GGPOErrorCode __cdecl ggpo_get_hub_stats(GGPOHub *hub,
+                                                  GGPOHubStats *stats);
+
+/*
+ * ggpo_start_hub_session --
+ *
+ * As ggpo_start_session, with the session's traffic on hub's socket.
+ * Remote players and spectators must each be on an address no other
+ * session on the hub talks to.
+ */
+GGPO_API GGPOErrorCode __cdecl ggpo_start_hub_session(GGPOSession **session,
+                                                      GGPOHub *hub,
+                                                      GGPOSessionCallbacks *cb,
+                                                      const char *game,
+                                                      int num_players,
+                                                      int input_size);
+
+/*
+ * ggpo_start_hub_spectating --
+ *
+ * As ggpo_start_spectating, with the session's traffic on hub's socket.
+ */
+GGPO_API GGPOErrorCode __cdecl ggpo_start_hub_spectating(GGPOSession **session,
+                                                         GGPOHub *hub,
+                                                         GGPOSessionCallbacks *cb,
+                                                         const char *game,
+                                                         int num_players,
+                                                         int input_size,
+                                                         char *host_ip,
+                                                         unsigned short host_port);
+
+/*
+ * ggpo_start_relay_spectating --
+ *
+ * Start a spectator session fed by a relay instead of a player.  The relay
+ * keeps the whole match and the latest keyframe the host uploaded, so a
+ * spectator that joins late loads that (GGPO_EVENTCODE_KEYFRAME_LOADED)
+ * and is fed the frames after it as fast as it consumes them.  With
+ * ggpo.broadcast.from_start set, or no keyframe yet, it starts from
+ * frame 0.  The parameters are as for ggpo_start_spectating, plus:
+ *
+ * relay_ip, relay_port - The relay the host broadcasts through (see
+ * ggpo_start_relay_broadcast).
+ *
+ * session_id - The broadcast to join, at most 64 bytes.
+ *
+ * GGPO_EVENTCODE_DISCONNECTED_FROM_PEER is sent when the host ends the
+ * broadcast and every frame has been played, or the relay stops answering.
+ */
+GGPO_API GGPOErrorCode __cdecl ggpo_start_relay_spectating(GGPOSession **session,
+                                                           GGPOSessionCallbacks *cb,
+                                                           const char *game,
+                                                           int num_players,
+                                                           int input_size,
+                                                           unsigned short local_port,
+                                                           const char *relay_ip,
+                                                           unsigned short relay_port,
+                                                           const char *session_id);
+
+/*
+ * ggpo_start_relay_broadcast --
+ *
+ * Sends the confirmed input stream of a peer to peer session once to a
+ * relay, which fans it out to any number of spectators that joined with
+ * ggpo_start_relay_spectating.  Works alongside directly added spectators.
+ * Like them, it must be started before the game starts running.
+ *
+ * Every ggpo.broadcast.keyframe_interval confirmed frames the state is
+ * uploaded too, for late joiners to start from.  A tunnel session has no
+ * socket to reach the relay on and gets GGPO_ERRORCODE_UNSUPPORTED.
+ */
+GGPO_API GGPOErrorCode __cdecl ggpo_start_relay_broadcast(GGPOSession *ggpo,
+                                                          const char *relay_ip,
+                                                          unsigned short relay_port,
+                                                          const char *session_id);
+
 /*
  * ggpo_close_session --
  * Used to close a session.  You must call ggpo_close_session to
@@ -444,8 +919,10 @@ GGPO_API GGPOErrorCode __cdecl ggpo_close_session(GGPOSession *);
 /*
  * ggpo_set_frame_delay --
  *
- * Change the amount of frames ggpo will delay local input.  Must be called
- * before the first call to ggpo_synchronize_input.
+ * Change the amount of frames ggpo will delay local input.  It may change
+ * mid-match: going down drops the next frame of input, going up repeats the
+ * previous one for the frames in between, which are sent to the peers with
+ * it.  Either way make it on a frame whose input is the same as the last.
  */
 GGPO_API GGPOErrorCode __cdecl ggpo_set_frame_delay(GGPOSession *,
                                                     GGPOPlayerHandle player,
@@ -458,7 +935,9 @@ GGPO_API GGPOErrorCode __cdecl ggpo_set_frame_delay(GGPOSession *,
  * in ggpo_idle.
  *
  * timeout - The amount of time GGPO.net is allowed to spend in this function,
- * in milliseconds.
+ * in milliseconds.  Once its work is done, a running session blocks on the
+ * socket for up to this long and returns as soon as a packet arrives or an
+ * internal timer (retransmit, keep-alive, quality report) comes due.
  */
 GGPO_API GGPOErrorCode __cdecl ggpo_idle(GGPOSession *,
                                          int timeout);
@@ -541,6 +1020,125 @@ GGPO_API GGPOErrorCode __cdecl ggpo_get_network_stats(GGPOSession *,
 GGPO_API GGPOErrorCode __cdecl ggpo_get_state_stats(GGPOSession *ggpo,
                                                     GGPOStateStats *stats);
 
+/*
+ * ggpo_get_rollback_stats --
+ *
+ * Fetches the depth and per-phase timing profile of the rollbacks run so
+ * far in this session.  Returns GGPO_ERRORCODE_UNSUPPORTED for sessions
+ * that never roll back (spectators, synctest).
+ */
+GGPO_API GGPOErrorCode __cdecl ggpo_get_rollback_stats(GGPOSession *ggpo,
+                                                       GGPORollbackStats *stats);
+
+/*
+ * ggpo_set_timesync_mode --
+ *
+ * Chooses how frame advantage drift is corrected (see GGPOTimeSyncMode).
+ *
+ * max_slew_permille - In GGPO_TIMESYNC_SLEW, the largest slowdown GGPO
+ * will recommend, up to GGPO_TIMESYNC_MAX_SLEW.  0 picks the default of
+ * 20 (2%).  Ignored in GGPO_TIMESYNC_STALL.
+ */
+GGPO_API GGPOErrorCode __cdecl ggpo_set_timesync_mode(GGPOSession *ggpo,
+                                                      int mode,
+                                                      int max_slew_permille);
+
+/*
+ * ggpo_get_timesync_stats --
+ *
+ * Fetches the frame advantage error and, in GGPO_TIMESYNC_SLEW, the
+ * current recommended slowdown.  Returns GGPO_ERRORCODE_UNSUPPORTED for
+ * sessions without time sync (spectators, synctest).
+ */
+GGPO_API GGPOErrorCode __cdecl ggpo_get_timesync_stats(GGPOSession *ggpo,
+                                                       GGPOTimeSyncStats *stats);
+
+/*
+ * ggpo_get_checksum_state --
+ *
+ * Copies the saved state of a confirmed frame whose checksum was exchanged
+ * with the peers, so it can be inspected after GGPO_EVENTCODE_DESYNC.
+ * Only the last few such frames are kept, see ggpo.sync.checksum_frames.
+ *
+ * buffer - Receives the state.  May be NULL to only query its size.
+ *
+ * size - The capacity of buffer on entry, the state size on return.
+ */
+GGPO_API GGPOErrorCode __cdecl ggpo_get_checksum_state(GGPOSession *ggpo,
+                                                       int frame,
+                                                       void *buffer,
+                                                       int *size);
+
+/*
+ * ggpo_set_state_buffer_capacity --
+ *
+ * Declares the size of the buffers your save_game_state callback allocates.
+ * GGPO tracks every buffer it receives from save_game_state as being at
+ * least this large, and passes that capacity back in *len when offering
+ * the buffer for reuse.  This lets the callback serialize straight into
+ * a pooled buffer and only allocate when the state has grown.
+ *
+ * capacity - The allocation size in bytes.  0 treats each buffer as
+ * exactly as large as the state written into it.
+ */
+GGPO_API GGPOErrorCode __cdecl ggpo_set_state_buffer_capacity(GGPOSession *,
+                                                              int capacity);
+
+/*
+ * ggpo_hint_state_changes --
+ *
+ * Call from save_game_state, once the buffer is filled in, when you know
+ * which parts of the state can differ from the last one you saved or
+ * loaded, for instance from an emulator's dirty-page tracking.  If the
+ * save is delta coded against that state, only the ranges are compared;
+ * everything outside them must be identical.  The hint covers this save
+ * alone, and one that doesn't fit the state is ignored.
+ *
+ * ranges - Byte ranges of the state, in ascending order and not
+ * overlapping.  GGPO copies them.
+ *
+ * count - The number of ranges.  0 says nothing changed.
+ */
+GGPO_API GGPOErrorCode __cdecl ggpo_hint_state_changes(GGPOSession *,
+                                                       const GGPOStateRange *ranges,
+                                                       int count);
+
+/*
+ * ggpo_set_state_regions --
+ *
+ * Describes where the large memory regions of the core (work RAM, video
+ * RAM and so on) sit in the states save_game_state writes, for a state
+ * whose layout doesn't change.  Keyframes are then split at the region
+ * edges and the pieces compressed in parallel, video RAM with fast LZ4
+ * and the rest with the session's codec; delta frames are unaffected.
+ * Regions only steer compression, so a wrong one costs speed, not sync.
+ *
+ * regions - Byte ranges of the state with a GGPOStateRegionKind each.
+ * GGPO copies them; overlaps and ranges past the end of the state are
+ * trimmed and small regions folded into their neighbours.
+ *
+ * count - The number of regions.  0 goes back to whole-state compression.
+ */
+GGPO_API GGPOErrorCode __cdecl ggpo_set_state_regions(GGPOSession *,
+                                                      const GGPOStateRegion *regions,
+                                                      int count);
+
+/*
+ * ggpo_set_thread_hook --
+ *
+ * Sets a function GGPO calls on each of its own threads (the network,
+ * compression, task pool, hub and trace threads) as the thread starts,
+ * with started true, and again as it stops, with started false.  This is
+ * where an application pins those threads or changes their priority.
+ * Applies to every session and to threads started after the call.
+ *
+ * role - A short name for what the thread does, such as "ggpo_net".
+ * Pass NULL to remove the hook.
+ */
+typedef void (__cdecl *GGPOThreadHook)(const char *role, bool started);
+
+GGPO_API void __cdecl ggpo_set_thread_hook(GGPOThreadHook hook);
+
 /*
  * ggpo_set_disconnect_timeout --
  *
@@ -568,6 +1166,47 @@ GGPO_API GGPOErrorCode __cdecl ggpo_set_disconnect_timeout(GGPOSession *,
 GGPO_API GGPOErrorCode __cdecl ggpo_set_disconnect_notify_start(GGPOSession *,
                                                                 int timeout);
 
+/*
+ * ggpo_set_reconnect_window --
+ *
+ * Keeps a peer that has gone quiet for this much longer than the
+ * disconnect timeout, so it can restart and rejoin the match with
+ * ggpo_rejoin_session instead of ending it.  Only two player sessions can
+ * take a peer back, and it has to come back from the same address and port.
+ * ggpo.network.reconnect_window sets the default.
+ *
+ * window - Milliseconds past the disconnect timeout; 0 turns rejoins away.
+ */
+GGPO_API GGPOErrorCode __cdecl ggpo_set_reconnect_window(GGPOSession *,
+                                                         int window);
+
+/*
+ * ggpo_rejoin_session --
+ *
+ * Marks a freshly started session as rejoining a match it dropped out of.
+ * Call it after ggpo_start_session and before adding the players, set up
+ * as they were the first time.  Instead of starting at frame 0 the session
+ * loads the state the other peer sends over, then raises
+ * GGPO_EVENTCODE_PEER_REJOINED and GGPO_EVENTCODE_RUNNING.
+ */
+GGPO_API GGPOErrorCode __cdecl ggpo_rejoin_session(GGPOSession *);
+
+/*
+ * ggpo_send_control --
+ *
+ * Sends up to GGPO_CONTROL_MAX_SIZE bytes to a remote player, outside the
+ * input stream, for the application's own agreements between peers.  It
+ * arrives as GGPO_EVENTCODE_CONTROL once, resent until acked.  Messages
+ * sent before that one is acked follow it in order; only past a handful
+ * waiting does a new one replace the newest of them.  A peer built before
+ * control messages gets GGPO_ERRORCODE_UNSUPPORTED, as does a session
+ * that isn't running yet.
+ */
+GGPO_API GGPOErrorCode __cdecl ggpo_send_control(GGPOSession *,
+                                                 GGPOPlayerHandle player,
+                                                 const void *data,
+                                                 int size);
+
 /*
  * ggpo_log --
  *
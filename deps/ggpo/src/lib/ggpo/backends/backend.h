@@ -22,11 +22,24 @@ struct GGPOSession {
    virtual GGPOErrorCode DisconnectPlayer(GGPOPlayerHandle handle) { return GGPO_OK; }
    virtual GGPOErrorCode GetNetworkStats(GGPONetworkStats *stats, GGPOPlayerHandle handle) { return GGPO_OK; }
    virtual GGPOErrorCode GetStateStats(GGPOStateStats *stats) { return GGPO_ERRORCODE_UNSUPPORTED; }
+   virtual GGPOErrorCode GetRollbackStats(GGPORollbackStats *stats) { return GGPO_ERRORCODE_UNSUPPORTED; }
+   virtual GGPOErrorCode GetTimeSyncStats(GGPOTimeSyncStats *stats) { return GGPO_ERRORCODE_UNSUPPORTED; }
+   virtual GGPOErrorCode GetChecksumState(int frame, void *buffer, int *size) { return GGPO_ERRORCODE_UNSUPPORTED; }
    virtual GGPOErrorCode Logv(const char *fmt, va_list list) { ::Logv(fmt, list); return GGPO_OK; }
 
    virtual GGPOErrorCode SetFrameDelay(GGPOPlayerHandle player, int delay) { return GGPO_ERRORCODE_UNSUPPORTED; }
    virtual GGPOErrorCode SetDisconnectTimeout(int timeout) { return GGPO_ERRORCODE_UNSUPPORTED; }
    virtual GGPOErrorCode SetDisconnectNotifyStart(int timeout) { return GGPO_ERRORCODE_UNSUPPORTED; }
+   virtual GGPOErrorCode SetReconnectWindow(int window) { return GGPO_ERRORCODE_UNSUPPORTED; }
+   virtual GGPOErrorCode Rejoin(void) { return GGPO_ERRORCODE_UNSUPPORTED; }
+   virtual GGPOErrorCode SendControl(GGPOPlayerHandle player, const void *data, int size) { return GGPO_ERRORCODE_UNSUPPORTED; }
+   virtual GGPOErrorCode SetStateBufferCapacity(int capacity) { return GGPO_ERRORCODE_UNSUPPORTED; }
+   virtual GGPOErrorCode HintStateChanges(const GGPOStateRange *ranges, int count) { return GGPO_ERRORCODE_UNSUPPORTED; }
+   virtual GGPOErrorCode SetStateRegions(const GGPOStateRegion *regions, int count) { return GGPO_ERRORCODE_UNSUPPORTED; }
+   virtual GGPOErrorCode SetTimeSyncMode(int mode, int max_slew_permille) { return GGPO_ERRORCODE_UNSUPPORTED; }
+   virtual GGPOErrorCode StartRelayBroadcast(const char *relay_ip, uint16 relay_port, const char *session) { return GGPO_ERRORCODE_UNSUPPORTED; }
+   virtual GGPOErrorCode TunnelRead(void *buffer, int *len) { return GGPO_ERRORCODE_UNSUPPORTED; }
+   virtual GGPOErrorCode TunnelWrite(const void *data, int len) { return GGPO_ERRORCODE_UNSUPPORTED; }
 };
 
 typedef struct GGPOSession Quark, IQuarkBackend; /* XXX: nuke this */
@@ -6,14 +6,47 @@
  */
 
 #include "p2p.h"
+#include "state_codec.h"
+#include "thread_hook.h"
+
+#include <climits>
 
 static const int RECOMMENDATION_INTERVAL           = 240;
+static const int SYSCALL_STATS_INTERVAL            = 60;
 static const int DEFAULT_DISCONNECT_TIMEOUT        = 5000;
 static const int DEFAULT_DISCONNECT_NOTIFY_START   = 750;
+static const int NETWORK_THREAD_MAX_WAIT           = 5;
+static const int TIMESYNC_HISTORY_INTERVAL         = 60;
+static const int TIMESYNC_DEFAULT_SLEW             = 20;    /* permille */
+static const int TIMESYNC_SLEW_DEADBAND_X100       = 50;    /* ignore half a frame of error */
+static const int TIMESYNC_SLEW_PER_FRAME           = 10;    /* permille per frame of error */
+static const int BROADCAST_KEYFRAME_INTERVAL       = 600;
+
+/*
+ * A state to send: LZ4 compressed into encoded when that makes it smaller,
+ * else copied.  Returns the GGPOStateCodec encoded is in.
+ */
+static int
+EncodeState(const std::vector<byte> &payload, std::vector<byte> &encoded)
+{
+   const StateCodec *codec = StateCodec::Get(GGPO_STATE_CODEC_LZ4);
+   int size = 0;
+   if (codec) {
+      encoded.resize(codec->CompressBound((int)payload.size()));
+      size = codec->Compress(&payload[0], (int)payload.size(),
+                             &encoded[0], (int)encoded.size(), 1);
+   }
+   if (size > 0 && size < (int)payload.size()) {
+      encoded.resize(size);
+      return GGPO_STATE_CODEC_LZ4;
+   }
+   encoded = payload;
+   return GGPO_STATE_CODEC_RAW;
+}
 
 Peer2PeerBackend::Peer2PeerBackend(GGPOSessionCallbacks *cb,
                                    const char *gamename,
-                                   uint16 localport,
+                                   const Transport::Config &transport,
                                    int num_players,
                                    int input_size) :
     _num_players(num_players),
@@ -22,11 +55,37 @@ Peer2PeerBackend::Peer2PeerBackend(GGPOSessionCallbacks *cb,
     _disconnect_timeout(DEFAULT_DISCONNECT_TIMEOUT),
     _disconnect_notify_start(DEFAULT_DISCONNECT_NOTIFY_START),
     _num_spectators(0),
-    _next_spectator_frame(0)
+    _next_spectator_frame(0),
+    _net_shutdown(false),
+    _net_received(0)
 {
    _callbacks = *cb;
    _synchronizing = true;
    _next_recommended_sleep = 0;
+   _timesync_mode = GGPO_TIMESYNC_STALL;
+   _timesync_max_slew = TIMESYNC_DEFAULT_SLEW;
+   _timesync_frame = -1;
+   _timesync_error_sum = 0;
+   _timesync_samples = 0;
+   memset(&_timesync_stats, 0, sizeof(_timesync_stats));
+   _syscall_stats_frame = 0;
+   _syscall_stats_count = 0;
+   _syscalls_per_frame_x100 = 0;
+   _confirm_endpoints = 0;
+   for (size_t i = 0; i < ARRAY_SIZE(_queue_confirm); i++) {
+      _queue_confirm[i].min_confirmed = MAX_INT;
+      _queue_confirm[i].connected = true;
+   }
+   _spectator_encode_cache.reset();
+   _reconnect_window = MAX(Platform::GetConfigInt("ggpo.network.reconnect_window"), 0);
+   _broadcast_keyframe_interval = Platform::GetConfigInt("ggpo.broadcast.keyframe_interval");
+   if (_broadcast_keyframe_interval == 0) {
+      _broadcast_keyframe_interval = BROADCAST_KEYFRAME_INTERVAL;
+   }
+   _broadcast_keyframe = 0;
+   _rejoining = false;
+   memset(_rejoin, 0, sizeof(_rejoin));
+   _net_thread_enabled = Platform::GetConfigInt("ggpo.network.thread") > 0;
 
    /*
     * Initialize the synchronziation layer
@@ -37,15 +96,21 @@ Peer2PeerBackend::Peer2PeerBackend(GGPOSessionCallbacks *cb,
    config.callbacks = _callbacks;
    config.num_prediction_frames = Platform::GetConfigInt("ggpo.sync.prediction_frames");
    if (config.num_prediction_frames <= 0 ||
-         config.num_prediction_frames > MAX_PREDICTION_FRAMES)
+         config.num_prediction_frames > MAX_PREDICTION_FRAMES_MAX)
       config.num_prediction_frames = MAX_PREDICTION_FRAMES;
+   config.keyframe_interval = Platform::GetConfigInt("ggpo.sync.keyframe_interval");
+   if (config.keyframe_interval <= 0 ||
+         config.keyframe_interval > GGPO_STATE_KEYFRAME_INTERVAL_MAX)
+      config.keyframe_interval = GGPO_STATE_KEYFRAME_INTERVAL;
    config.async_compress = 1;
    _sync.Init(config);
 
    /*
-    * Initialize the UDP port
+    * Initialize the transport
     */
-   _udp.Init(localport, &_poll, this);
+   _transport = Transport::Create(transport, &_poll, this);
+   _transport_kind = transport.kind;
+   _tunnel = transport.kind == Transport::Tunnel ? (TunnelTransport *)_transport : NULL;
 
    _endpoints = new UdpProtocol[_num_players];
    memset(_local_connect_status, 0, sizeof(_local_connect_status));
@@ -61,7 +126,93 @@ Peer2PeerBackend::Peer2PeerBackend(GGPOSessionCallbacks *cb,
   
 Peer2PeerBackend::~Peer2PeerBackend()
 {
+   StopNetworkThread();
+   _broadcast.Stop();
    delete [] _endpoints;
+   delete _transport;
+}
+
+/*
+ * Takes _net_mutex when the I/O thread is running; an empty lock otherwise,
+ * so the single-threaded path pays nothing.  Recursive because event
+ * handlers may call back into the API.
+ */
+std::unique_lock<std::recursive_mutex>
+Peer2PeerBackend::LockNetwork(void)
+{
+   if (_net_thread.joinable()) {
+      return std::unique_lock<std::recursive_mutex>(_net_mutex);
+   }
+   return std::unique_lock<std::recursive_mutex>();
+}
+
+void
+Peer2PeerBackend::StartNetworkThread(void)
+{
+   if (_net_thread.joinable()) {
+      return;
+   }
+   _net_shutdown = false;
+   _net_thread = std::thread(&Peer2PeerBackend::NetworkThreadMain, this);
+   Log("started network thread.\n");
+}
+
+void
+Peer2PeerBackend::StopNetworkThread(void)
+{
+   if (!_net_thread.joinable()) {
+      return;
+   }
+   _net_shutdown = true;
+   _net_thread.join();
+}
+
+/*
+ * Receives, acks and resends independently of the frame rate.  The wait
+ * itself happens unlocked; only the pump that follows takes _net_mutex.
+ * Inputs that arrive sit in the endpoint event queues until the emulation
+ * thread's next DoPoll hands them to Sync.
+ */
+void
+Peer2PeerBackend::NetworkThreadMain(void)
+{
+   ThreadHookScope hook("ggpo_net");
+   while (!_net_shutdown) {
+      int wait;
+      {
+         std::lock_guard<std::recursive_mutex> lock(_net_mutex);
+         wait = _poll.GetWaitTime();
+      }
+      if (wait == INFINITE || wait > NETWORK_THREAD_MAX_WAIT) {
+         wait = NETWORK_THREAD_MAX_WAIT;
+      }
+      _poll.WaitForHandles(wait);
+
+      unsigned int received = _net_received;
+      {
+         std::lock_guard<std::recursive_mutex> lock(_net_mutex);
+         _transport->BeginBatch();
+         _poll.Pump(0);
+         _transport->EndBatch();
+      }
+      if (_net_received != received) {
+         std::lock_guard<std::mutex> lock(_net_wake_mutex);
+         _net_wake_cv.notify_all();
+      }
+   }
+}
+
+/*
+ * Threaded counterpart of the blocking pump at the end of DoPoll: sleep
+ * until the I/O thread has received something or timeout ms pass.
+ */
+void
+Peer2PeerBackend::WaitForNetwork(int timeout)
+{
+   unsigned int received = _net_received;
+   std::unique_lock<std::mutex> lock(_net_wake_mutex);
+   _net_wake_cv.wait_for(lock, std::chrono::milliseconds(timeout),
+                         [&] { return _net_received != received; });
 }
 
 void
@@ -74,10 +225,17 @@ Peer2PeerBackend::AddRemotePlayer(char *ip,
     */
    _synchronizing = true;
    
-   _endpoints[queue].Init(&_udp, _poll, queue, ip, port, _local_connect_status);
+   _endpoints[queue].Init(_transport, _poll, queue, ip, port, _local_connect_status);
    _endpoints[queue].SetDisconnectTimeout(_disconnect_timeout);
    _endpoints[queue].SetDisconnectNotifyStart(_disconnect_notify_start);
-   _endpoints[queue].Synchronize();
+   _endpoints[queue].SetSyncConfig(_sync.GetPredictionFrames(), _sync.GetKeyframeInterval());
+   _endpoints[queue].SetInputShape(_input_size, _num_players);
+   _endpoints[queue].SetReconnectWindow(_num_players == 2 ? _reconnect_window : 0);
+   if (_rejoining) {
+      _endpoints[queue].Rejoin();
+   } else {
+      _endpoints[queue].Synchronize();
+   }
 }
 
 GGPOErrorCode Peer2PeerBackend::AddSpectator(char *ip,
@@ -94,9 +252,11 @@ GGPOErrorCode Peer2PeerBackend::AddSpectator(char *ip,
    }
    int queue = _num_spectators++;
 
-   _spectators[queue].Init(&_udp, _poll, queue + 1000, ip, port, _local_connect_status);
+   _spectators[queue].Init(_transport, _poll, queue + 1000, ip, port, _local_connect_status);
    _spectators[queue].SetDisconnectTimeout(_disconnect_timeout);
    _spectators[queue].SetDisconnectNotifyStart(_disconnect_notify_start);
+   _spectators[queue].SetInputShape(_input_size * _num_players, _num_players);
+   _spectators[queue].SetEncodeCache(&_spectator_encode_cache);
    _spectators[queue].Synchronize();
 
    return GGPO_OK;
@@ -106,70 +266,121 @@ GGPOErrorCode
 Peer2PeerBackend::DoPoll(int timeout)
 {
    if (!_sync.InRollback()) {
-      _poll.Pump(0);
+      if (_net_thread_enabled) {
+         StartNetworkThread();
+      }
+      PollNetwork(0);
+
+      /*
+       * Spend the rest of the budget blocked on the socket, then go round
+       * again so whatever arrived is checked against the simulation.
+       */
+      if (!_synchronizing && timeout > 0) {
+         PollNetwork(timeout);
+      }
+   }
+   return GGPO_OK;
+}
+
+/*
+ * One pass of packet IO, event dispatch and simulation checks.  wait is how
+ * long to block for the next packet or endpoint timer first.
+ */
+void
+Peer2PeerBackend::PollNetwork(int wait)
+{
+   if (_net_thread.joinable() && wait > 0) {
+      WaitForNetwork(wait);
+   }
 
+   {
+      // everything the endpoints send during the poll leaves in one batch
+      std::unique_lock<std::recursive_mutex> lock = LockNetwork();
+      _transport->BeginBatch();
+      if (!_net_thread.joinable()) {
+         _poll.Pump(wait);
+      }
       PollUdpProtocolEvents();
+      _transport->EndBatch();
+   }
 
-      if (!_synchronizing) {
-         _sync.CheckSimulation(timeout);
+   if (!_synchronizing) {
+      _sync.CheckSimulation(0);
 
-         // notify all of our endpoints of their local frame number for their
-         // next connection quality report
-         int current_frame = _sync.GetFrameCount();
-         for (int i = 0; i < _num_players; i++) {
-            _endpoints[i].SetLocalFrameNumber(current_frame);
-         }
+      std::unique_lock<std::recursive_mutex> lock = LockNetwork();
+      _transport->BeginBatch();
+      PollRejoins();
 
-         int total_min_confirmed;
-         if (_num_players <= 2) {
-            total_min_confirmed = Poll2Players(current_frame);
-         } else {
-            total_min_confirmed = PollNPlayers(current_frame);
-         }
+      // notify all of our endpoints of their local frame number for their
+      // next connection quality report
+      int current_frame = _sync.GetFrameCount();
+      for (int i = 0; i < _num_players; i++) {
+         _endpoints[i].SetLocalFrameNumber(current_frame);
+      }
 
-         Log("last confirmed frame in p2p backend is %d.\n", total_min_confirmed);
-         if (total_min_confirmed >= 0) {
-            ASSERT(total_min_confirmed != INT_MAX);
-            if (_num_spectators > 0) {
-               while (_next_spectator_frame <= total_min_confirmed) {
-                  Log("pushing frame %d to spectators.\n", _next_spectator_frame);
-   
-                  GameInput input;
-                  input.frame = _next_spectator_frame;
-                  input.size = _input_size * _num_players;
-                  _sync.GetConfirmedInputs(input.bits, _input_size * _num_players, _next_spectator_frame);
-                  for (int i = 0; i < _num_spectators; i++) {
-                     _spectators[i].SendInput(input);
-                  }
-                  _next_spectator_frame++;
+      int total_min_confirmed;
+      if (_num_players <= 2) {
+         total_min_confirmed = Poll2Players(current_frame);
+      } else {
+         total_min_confirmed = PollNPlayers(current_frame);
+      }
+
+      LogVerbose("last confirmed frame in p2p backend is %d.\n", total_min_confirmed);
+      if (total_min_confirmed >= 0) {
+         ASSERT(total_min_confirmed != INT_MAX);
+         if (_num_spectators > 0 || _broadcast.IsActive()) {
+            while (_next_spectator_frame <= total_min_confirmed) {
+               LogVerbose("pushing frame %d to spectators.\n", _next_spectator_frame);
+
+               GameInput input;
+               input.frame = _next_spectator_frame;
+               input.size = _input_size * _num_players;
+               _sync.GetConfirmedInputs(input.bits, _input_size * _num_players, _next_spectator_frame);
+               for (int i = 0; i < _num_spectators; i++) {
+                  _spectators[i].SendInput(input);
                }
+               if (_broadcast.IsActive()) {
+                  _broadcast.SendFrame(input);
+               }
+               _next_spectator_frame++;
+            }
+            if (_broadcast.IsActive()) {
+               SendBroadcastKeyframe();
             }
-            Log("setting confirmed frame in sync to %d.\n", total_min_confirmed);
-            _sync.SetLastConfirmedFrame(total_min_confirmed);
          }
+         LogVerbose("setting confirmed frame in sync to %d.\n", total_min_confirmed);
+         LogTrace(TRACE_CONFIRMED_FRAME, total_min_confirmed);
+         _sync.SetLastConfirmedFrame(total_min_confirmed);
 
-         // send timesync notifications if now is the proper time
-         if (current_frame > _next_recommended_sleep) {
-            int interval = 0;
+         int checksum_frame, checksum;
+         if (_sync.GetLatestChecksum(&checksum_frame, &checksum)) {
             for (int i = 0; i < _num_players; i++) {
-               interval = MAX(interval, _endpoints[i].RecommendFrameDelay());
+               _endpoints[i].SetLocalChecksum(checksum_frame, (uint32)checksum);
             }
+         }
+      }
 
-            if (interval > 0) {
-               GGPOEvent info;
-               info.code = GGPO_EVENTCODE_TIMESYNC;
-               info.u.timesync.frames_ahead = interval;
-               _callbacks.on_event(&info);
-               _next_recommended_sleep = current_frame + RECOMMENDATION_INTERVAL;
-            }
+      UpdateTimeSync(current_frame);
+
+      // send timesync notifications if now is the proper time
+      if (_timesync_mode == GGPO_TIMESYNC_STALL && current_frame > _next_recommended_sleep) {
+         int interval = 0;
+         for (int i = 0; i < _num_players; i++) {
+            interval = MAX(interval, _endpoints[i].RecommendFrameDelay());
          }
-         // XXX: this is obviously a farce...
-         if (timeout) {
-            Sleep(1);
+
+         if (interval > 0) {
+            GGPOEvent info;
+            info.code = GGPO_EVENTCODE_TIMESYNC;
+            info.u.timesync.frames_ahead = interval;
+            _timesync_stats.stall_events++;
+            _timesync_stats.stall_frames += interval;
+            _callbacks.on_event(&info);
+            _next_recommended_sleep = current_frame + RECOMMENDATION_INTERVAL;
          }
       }
+      _transport->EndBatch();
    }
-   return GGPO_OK;
 }
 
 int Peer2PeerBackend::Poll2Players(int current_frame)
@@ -187,12 +398,12 @@ int Peer2PeerBackend::Poll2Players(int current_frame)
       if (!_local_connect_status[i].disconnected) {
          total_min_confirmed = MIN(_local_connect_status[i].last_frame, total_min_confirmed);
       }
-      Log("  local endp: connected = %d, last_received = %d, total_min_confirmed = %d.\n", !_local_connect_status[i].disconnected, _local_connect_status[i].last_frame, total_min_confirmed);
+      LogVerbose("  local endp: connected = %d, last_received = %d, total_min_confirmed = %d.\n", !_local_connect_status[i].disconnected, _local_connect_status[i].last_frame, total_min_confirmed);
       if (!queue_connected && !_local_connect_status[i].disconnected) {
          Log("disconnecting i %d by remote request.\n", i);
          DisconnectPlayerQueue(i, total_min_confirmed);
       }
-      Log("  total_min_confirmed = %d.\n", total_min_confirmed);
+      LogVerbose("  total_min_confirmed = %d.\n", total_min_confirmed);
    }
    return total_min_confirmed;
 }
@@ -200,32 +411,53 @@ int Peer2PeerBackend::Poll2Players(int current_frame)
 int Peer2PeerBackend::PollNPlayers(int current_frame)
 {
    int i, queue, last_received;
+   uint32 running = 0, changed = 0;
+
+   // Only queues some endpoint has new status for need the n*n scan; the
+   // rest keep their minimum from the last poll.  A change in which
+   // endpoints are running invalidates them all.
+   for (i = 0; i < _num_players; i++) {
+      changed |= _endpoints[i].TakePeerStatusChanges();
+      if (_endpoints[i].IsRunning()) {
+         running |= 1u << i;
+      }
+   }
+   if (running != _confirm_endpoints) {
+      changed = ~0u;
+      _confirm_endpoints = running;
+   }
 
    // discard confirmed frames as appropriate
    int total_min_confirmed = MAX_INT;
    for (queue = 0; queue < _num_players; queue++) {
-      bool queue_connected = true;
-      int queue_min_confirmed = MAX_INT;
-      Log("considering queue %d.\n", queue);
-      for (i = 0; i < _num_players; i++) {
-         // we're going to do a lot of logic here in consideration of endpoint i.
-         // keep accumulating the minimum confirmed point for all n*n packets and
-         // throw away the rest.
-         if (_endpoints[i].IsRunning()) {
-            bool connected = _endpoints[i].GetPeerConnectStatus(queue, &last_received);
-
-            queue_connected = queue_connected && connected;
-            queue_min_confirmed = MIN(last_received, queue_min_confirmed);
-            Log("  endpoint %d: connected = %d, last_received = %d, queue_min_confirmed = %d.\n", i, connected, last_received, queue_min_confirmed);
-         } else {
-            Log("  endpoint %d: ignoring... not running.\n", i);
+      if (changed & (1u << queue)) {
+         bool queue_connected = true;
+         int queue_min_confirmed = MAX_INT;
+         LogVerbose("considering queue %d.\n", queue);
+         for (i = 0; i < _num_players; i++) {
+            // keep accumulating the minimum confirmed point for all n*n packets and
+            // throw away the rest.
+            if (running & (1u << i)) {
+               bool connected = _endpoints[i].GetPeerConnectStatus(queue, &last_received);
+
+               queue_connected = queue_connected && connected;
+               queue_min_confirmed = MIN(last_received, queue_min_confirmed);
+               LogVerbose("  endpoint %d: connected = %d, last_received = %d, queue_min_confirmed = %d.\n", i, connected, last_received, queue_min_confirmed);
+            } else {
+               LogVerbose("  endpoint %d: ignoring... not running.\n", i);
+            }
          }
+         _queue_confirm[queue].min_confirmed = queue_min_confirmed;
+         _queue_confirm[queue].connected = queue_connected;
       }
+      bool queue_connected = _queue_confirm[queue].connected;
+      int queue_min_confirmed = _queue_confirm[queue].min_confirmed;
+
       // merge in our local status only if we're still connected!
       if (!_local_connect_status[queue].disconnected) {
          queue_min_confirmed = MIN(_local_connect_status[queue].last_frame, queue_min_confirmed);
       }
-      Log("  local endp: connected = %d, last_received = %d, queue_min_confirmed = %d.\n", !_local_connect_status[queue].disconnected, _local_connect_status[queue].last_frame, queue_min_confirmed);
+      LogVerbose("  local endp: connected = %d, last_received = %d, queue_min_confirmed = %d.\n", !_local_connect_status[queue].disconnected, _local_connect_status[queue].last_frame, queue_min_confirmed);
 
       if (queue_connected) {
          total_min_confirmed = MIN(queue_min_confirmed, total_min_confirmed);
@@ -238,7 +470,7 @@ int Peer2PeerBackend::PollNPlayers(int current_frame)
             DisconnectPlayerQueue(queue, queue_min_confirmed);
          }
       }
-      Log("  total_min_confirmed = %d.\n", total_min_confirmed);
+      LogVerbose("  total_min_confirmed = %d.\n", total_min_confirmed);
    }
    return total_min_confirmed;
 }
@@ -248,6 +480,8 @@ GGPOErrorCode
 Peer2PeerBackend::AddPlayer(GGPOPlayer *player,
                             GGPOPlayerHandle *handle)
 {
+   std::unique_lock<std::recursive_mutex> lock = LockNetwork();
+
    if (player->type == GGPO_PLAYERTYPE_SPECTATOR) {
       return AddSpectator(player->u.remote.ip_address, player->u.remote.port);
    }
@@ -270,7 +504,7 @@ Peer2PeerBackend::AddLocalInput(GGPOPlayerHandle player,
                                 int size)
 {
    int queue;
-   GameInput input;
+   GameInput input, padding;
    GGPOErrorCode result;
 
    if (_sync.InRollback()) {
@@ -288,24 +522,35 @@ Peer2PeerBackend::AddLocalInput(GGPOPlayerHandle player,
    input.init(-1, (char *)values, size);
 
    // Feed the input for the current frame into the synchronzation layer.
-   if (!_sync.AddLocalInput(queue, input)) {
+   if (!_sync.AddLocalInput(queue, input, &padding)) {
       return GGPO_ERRORCODE_PREDICTION_THRESHOLD;
    }
 
    if (input.frame != GameInput::NullFrame) { // xxx: <- comment why this is the case
+      // sent from this thread right away, not on the I/O thread's next pump
+      std::unique_lock<std::recursive_mutex> lock = LockNetwork();
+
       // Update the local connect status state to indicate that we've got a
       // confirmed local frame for this player.  this must come first so it
       // gets incorporated into the next packet we send.
 
-      Log("setting local connect status for local queue %d to %d", queue, input.frame);
+      LogVerbose("setting local connect status for local queue %d to %d", queue, input.frame);
       _local_connect_status[queue].last_frame = input.frame;
 
-      // Send the input to all the remote players.
+      // Send the input to all the remote players.  A raised frame delay
+      // padded the frames before it, which the peers number inputs through
+      // too, so those go first.
+      _transport->BeginBatch();
       for (int i = 0; i < _num_players; i++) {
          if (_endpoints[i].IsInitialized()) {
+            GameInput pad = padding;
+            for (; pad.frame != GameInput::NullFrame && pad.frame < input.frame; pad.frame++) {
+               _endpoints[i].SendInput(pad);
+            }
             _endpoints[i].SendInput(input);
          }
       }
+      _transport->EndBatch();
    }
 
    return GGPO_OK;
@@ -333,15 +578,35 @@ Peer2PeerBackend::SyncInput(void *values,
 GGPOErrorCode
 Peer2PeerBackend::IncrementFrame(void)
 {  
-   Log("End of frame (%d)...\n", _sync.GetFrameCount());
+   LogVerbose("End of frame (%d)...\n", _sync.GetFrameCount());
+   LogTrace(TRACE_END_OF_FRAME, _sync.GetFrameCount());
    _sync.IncrementFrame();
    DoPoll(0);
    PollSyncEvents();
+   UpdateSyscallStats();
 
    return GGPO_OK;
 }
 
 
+/*
+ * Socket syscalls per frame, averaged over SYSCALL_STATS_INTERVAL frames.
+ */
+void
+Peer2PeerBackend::UpdateSyscallStats(void)
+{
+   int frame = _sync.GetFrameCount();
+   if (frame - _syscall_stats_frame < SYSCALL_STATS_INTERVAL) {
+      return;
+   }
+   std::unique_lock<std::recursive_mutex> lock = LockNetwork();
+   unsigned int syscalls = _transport->GetSyscallCount();
+   _syscalls_per_frame_x100 = (int)((syscalls - _syscall_stats_count) * 100ULL /
+                                    (unsigned int)(frame - _syscall_stats_frame));
+   _syscall_stats_frame = frame;
+   _syscall_stats_count = syscalls;
+}
+
 void
 Peer2PeerBackend::PollSyncEvents(void)
 {
@@ -371,6 +636,9 @@ Peer2PeerBackend::PollUdpProtocolEvents(void)
 void
 Peer2PeerBackend::OnUdpProtocolPeerEvent(UdpProtocol::Event &evt, int queue)
 {
+   if (evt.type == UdpProtocol::Event::Synchronzied) {
+      NegotiateSyncConfig(queue);
+   }
    OnUdpProtocolEvent(evt, QueueToPlayerHandle(queue));
    switch (evt.type) {
       case UdpProtocol::Event::Input:
@@ -381,17 +649,260 @@ Peer2PeerBackend::OnUdpProtocolPeerEvent(UdpProtocol::Event &evt, int queue)
 
             _sync.AddRemoteInput(queue, evt.u.input.input);
             // Notify the other endpoints which frame we received from a peer
-            Log("setting remote connect status for queue %d to %d\n", queue, evt.u.input.input.frame);
+            LogVerbose("setting remote connect status for queue %d to %d\n", queue, evt.u.input.input.frame);
             _local_connect_status[queue].last_frame = evt.u.input.input.frame;
          }
          break;
 
+   case UdpProtocol::Event::Checksum:
+      CheckRemoteChecksum(queue, evt.u.checksum.frame, (int)evt.u.checksum.checksum);
+      break;
+
+   case UdpProtocol::Event::Rejoining:
+      _rejoin[queue].pending = true;
+      _rejoin[queue].sent = false;
+      _rejoin[queue].frame = _local_connect_status[queue].last_frame + 1;
+      Log("queue %d is rejoining at frame %d.\n", queue, _rejoin[queue].frame);
+      {
+         GGPOEvent info;
+         info.code = GGPO_EVENTCODE_PEER_REJOINING;
+         info.u.rejoining.player = QueueToPlayerHandle(queue);
+         _callbacks.on_event(&info);
+      }
+      break;
+
+   case UdpProtocol::Event::StateSent:
+      _rejoin[queue].pending = false;
+      {
+         GGPOEvent info;
+         info.code = GGPO_EVENTCODE_PEER_REJOINED;
+         info.u.rejoined.player = QueueToPlayerHandle(queue);
+         info.u.rejoined.frame = evt.u.state.frame;
+         info.u.rejoined.resume_ms = evt.u.state.resume_ms;
+         info.u.rejoined.state_bytes = evt.u.state.size;
+         _callbacks.on_event(&info);
+      }
+      break;
+
+   case UdpProtocol::Event::StateReceived:
+      LoadRejoinState(queue, evt.u.state.resume_ms);
+      break;
+
+   case UdpProtocol::Event::Control:
+      {
+         GGPOEvent info;
+         info.code = GGPO_EVENTCODE_CONTROL;
+         info.u.control.player = QueueToPlayerHandle(queue);
+         info.u.control.size = evt.u.control.length;
+         memcpy(info.u.control.data, evt.u.control.data, evt.u.control.length);
+         _callbacks.on_event(&info);
+      }
+      break;
+
    case UdpProtocol::Event::Disconnected:
       DisconnectPlayer(QueueToPlayerHandle(queue));
       break;
    }
 }
 
+/*
+ * Hands each rejoining peer its state once we have run up to the frame it
+ * picks up from and the inputs before it are final.  Until then the peer
+ * holds the confirmed frame back, which stalls us at the prediction
+ * barrier.
+ */
+void
+Peer2PeerBackend::PollRejoins(void)
+{
+   for (int i = 0; i < _num_players; i++) {
+      if (_rejoin[i].pending && !_rejoin[i].sent) {
+         _rejoin[i].sent = SendRejoinState(i);
+      }
+   }
+}
+
+/*
+ * The state goes out as one payload: every player's confirmed input for
+ * the frame before, then the state saved for the frame, LZ4 compressed
+ * when that makes it smaller.
+ */
+bool
+Peer2PeerBackend::SendRejoinState(int queue)
+{
+   int frame = _rejoin[queue].frame;
+   int inputs_size = _num_players * _input_size;
+   std::vector<byte> state;
+
+   if (_sync.GetFrameCount() < frame || !_sync.GetFrameState(frame, state)) {
+      return false;
+   }
+
+   std::vector<byte> payload(inputs_size);
+   if (frame > 0) {
+      _sync.GetConfirmedInputs(&payload[0], inputs_size, frame - 1);
+   }
+   payload.insert(payload.end(), state.begin(), state.end());
+
+   std::vector<byte> encoded;
+   int codec = EncodeState(payload, encoded);
+   _endpoints[queue].SendState(frame, codec, (int)payload.size(), &encoded[0], (int)encoded.size());
+   SendLocalInputs(queue, frame);
+   return true;
+}
+
+/*
+ * Uploads the state at the first frame not yet broadcast to the relay,
+ * every ggpo.broadcast.keyframe_interval frames (negative turns it off),
+ * once the last one is up.  Every input before that frame is final, so
+ * it is the state spectators reach playing the broadcast up to there.
+ */
+void
+Peer2PeerBackend::SendBroadcastKeyframe(void)
+{
+   int frame = _next_spectator_frame;
+   std::vector<byte> state;
+
+   if (_broadcast_keyframe_interval < 0 || _broadcast.IsSendingKeyframe() ||
+       frame < _broadcast_keyframe + _broadcast_keyframe_interval ||
+       _sync.GetFrameCount() < frame || !_sync.GetFrameState(frame, state)) {
+      return;
+   }
+
+   std::vector<byte> encoded;
+   int codec = EncodeState(state, encoded);
+   _broadcast.SendKeyframe(frame, codec, (int)state.size(), &encoded[0], (int)encoded.size());
+   _broadcast_keyframe = frame;
+   Log("uploading the broadcast keyframe for frame %d (%d bytes).\n", frame, (int)encoded.size());
+}
+
+/*
+ * The rejoining side: start over from the survivor's state and send the
+ * local input queued from there, which is just the frame delay padding.
+ */
+void
+Peer2PeerBackend::LoadRejoinState(int queue, int resume_ms)
+{
+   int frame, codec_id, raw_size;
+   int inputs_size = _num_players * _input_size;
+   std::vector<uint8> data;
+   std::vector<byte> payload;
+
+   if (!_rejoining || !_endpoints[queue].TakeReceivedState(&frame, &codec_id, &raw_size, data)) {
+      return;
+   }
+   if (codec_id == GGPO_STATE_CODEC_RAW) {
+      payload = data;
+   } else {
+      const StateCodec *codec = StateCodec::Get((GGPOStateCodec)codec_id);
+      if (codec && raw_size > 0 && raw_size <= UDP_STATE_MAX_SIZE) {
+         payload.resize(raw_size);
+         if (!codec->Decompress(&data[0], (int)data.size(), &payload[0], raw_size)) {
+            payload.clear();
+         }
+      }
+   }
+   if ((int)payload.size() <= inputs_size) {
+      Log("Could not decode the rejoin state for frame %d (codec %d, %d bytes).\n",
+          frame, codec_id, (int)data.size());
+      DisconnectPlayer(QueueToPlayerHandle(queue));
+      return;
+   }
+
+   _sync.StartAt(frame, &payload[inputs_size], (int)payload.size() - inputs_size, &payload[0]);
+   for (int i = 0; i < _num_players; i++) {
+      _local_connect_status[i].last_frame = frame - 1;
+   }
+   SendLocalInputs(queue, frame);
+   _next_spectator_frame = frame;
+   _rejoining = false;
+
+   GGPOEvent info;
+   info.code = GGPO_EVENTCODE_PEER_REJOINED;
+   info.u.rejoined.player = QueueToPlayerHandle(queue);
+   info.u.rejoined.frame = frame;
+   info.u.rejoined.resume_ms = resume_ms;
+   info.u.rejoined.state_bytes = (int)data.size();
+   _callbacks.on_event(&info);
+
+   CheckInitialSync();
+}
+
+/*
+ * Queues the local players' input from frame on for the endpoint whose
+ * input stream just started over.
+ */
+void
+Peer2PeerBackend::SendLocalInputs(int queue, int frame)
+{
+   for (int i = 0; i < _num_players; i++) {
+      if (_endpoints[i].IsInitialized()) {
+         continue;
+      }
+      int last = _sync.GetLastQueuedFrame(i);
+      _local_connect_status[i].last_frame = MAX(_local_connect_status[i].last_frame, last);
+      for (int f = frame; f <= last; f++) {
+         GameInput input;
+         if (_sync.GetQueuedInput(i, f, &input)) {
+            _endpoints[queue].SendInput(input);
+         }
+      }
+   }
+}
+
+/*
+ * A peer's checksum for a confirmed frame we kept too.  Frames we never
+ * took a checksum for, or have since dropped, are skipped.
+ */
+void
+Peer2PeerBackend::CheckRemoteChecksum(int queue, int frame, int checksum)
+{
+   int local_checksum, last_match_frame;
+   int result = _sync.CompareChecksum(frame, checksum, &local_checksum, &last_match_frame);
+
+   if (result <= 0) {
+      return;
+   }
+   Log("desync with queue %d at frame %d (%08x != %08x).\n",
+       queue, frame, local_checksum, checksum);
+
+   GGPOEvent info;
+   info.code = GGPO_EVENTCODE_DESYNC;
+   info.u.desync.player = QueueToPlayerHandle(queue);
+   info.u.desync.frame = frame;
+   info.u.desync.local_checksum = local_checksum;
+   info.u.desync.remote_checksum = checksum;
+   info.u.desync.last_match_frame = last_match_frame;
+   _callbacks.on_event(&info);
+}
+
+GGPOErrorCode
+Peer2PeerBackend::GetChecksumState(int frame, void *buffer, int *size)
+{
+   if (!_sync.GetChecksumState(frame, buffer, size)) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
+   return GGPO_OK;
+}
+
+
+/*
+ * Settle on the peer's prediction window and keyframe interval before the
+ * first frame runs.  Endpoints still synchronizing are handed the new values
+ * so every peer converges on the same ones.
+ */
+void
+Peer2PeerBackend::NegotiateSyncConfig(int queue)
+{
+   int prediction_frames, keyframe_interval;
+
+   _endpoints[queue].GetRemoteSyncConfig(&prediction_frames, &keyframe_interval);
+   if (!_sync.NegotiateConfig(prediction_frames, keyframe_interval)) {
+      return;
+   }
+   for (int i = 0; i < _num_players; i++) {
+      _endpoints[i].SetSyncConfig(_sync.GetPredictionFrames(), _sync.GetKeyframeInterval());
+   }
+}
 
 void
 Peer2PeerBackend::OnUdpProtocolSpectatorEvent(UdpProtocol::Event &evt, int queue)
@@ -470,6 +981,7 @@ Peer2PeerBackend::DisconnectPlayer(GGPOPlayerHandle player)
       return result;
    }
    
+   std::unique_lock<std::recursive_mutex> lock = LockNetwork();
    if (_local_connect_status[queue].disconnected) {
       return GGPO_ERRORCODE_PLAYER_DISCONNECTED;
    }
@@ -498,6 +1010,8 @@ Peer2PeerBackend::DisconnectPlayerQueue(int queue, int syncto)
    int framecount = _sync.GetFrameCount();
 
    _endpoints[queue].Disconnect();
+   _rejoin[queue].pending = false;
+   _rejoining = false;
 
    Log("Changing queue %d local connect status for last frame from %d to %d on disconnect request (current: %d).\n",
        queue, _local_connect_status[queue].last_frame, syncto, framecount);
@@ -530,12 +1044,39 @@ Peer2PeerBackend::GetNetworkStats(GGPONetworkStats *stats, GGPOPlayerHandle play
       return result;
    }
 
+   std::unique_lock<std::recursive_mutex> lock = LockNetwork();
    memset(stats, 0, sizeof *stats);
    _endpoints[queue].GetNetworkStats(stats);
+   stats->network.syscalls_per_frame_x100 = _syscalls_per_frame_x100;
+   stats->network.batched_io = _transport->IsBatching() ? 1 : 0;
+   stats->network.transport = (int)_transport_kind;
 
    return GGPO_OK;
 }
 
+/*
+ * The tunnel keeps its own queues under a lock of its own, so the
+ * application can pump it from any thread without _net_mutex.
+ */
+GGPOErrorCode
+Peer2PeerBackend::TunnelRead(void *buffer, int *len)
+{
+   if (!_tunnel) {
+      return GGPO_ERRORCODE_UNSUPPORTED;
+   }
+   return _tunnel->Read(buffer, len) ? GGPO_OK : GGPO_ERRORCODE_INVALID_REQUEST;
+}
+
+GGPOErrorCode
+Peer2PeerBackend::TunnelWrite(const void *data, int len)
+{
+   if (!_tunnel) {
+      return GGPO_ERRORCODE_UNSUPPORTED;
+   }
+   _tunnel->Write(data, len);
+   return GGPO_OK;
+}
+
 GGPOErrorCode
 Peer2PeerBackend::GetStateStats(GGPOStateStats *stats)
 {
@@ -543,6 +1084,126 @@ Peer2PeerBackend::GetStateStats(GGPOStateStats *stats)
    return GGPO_OK;
 }
 
+GGPOErrorCode
+Peer2PeerBackend::GetRollbackStats(GGPORollbackStats *stats)
+{
+   _sync.GetRollbackStats(stats);
+   return GGPO_OK;
+}
+
+GGPOErrorCode
+Peer2PeerBackend::GetTimeSyncStats(GGPOTimeSyncStats *stats)
+{
+   *stats = _timesync_stats;
+   stats->mode = _timesync_mode;
+   stats->error_avg_x100 = _timesync_samples ? (int)(_timesync_error_sum / _timesync_samples) : 0;
+   return GGPO_OK;
+}
+
+GGPOErrorCode
+Peer2PeerBackend::SetTimeSyncMode(int mode, int max_slew_permille)
+{
+   _timesync_mode = mode;
+   _timesync_max_slew = max_slew_permille ? max_slew_permille : TIMESYNC_DEFAULT_SLEW;
+   _timesync_stats.slew_permille = 0;
+   return GGPO_OK;
+}
+
+/*
+ * Sends the confirmed stream to a relay that fans it out, in addition to
+ * any directly attached spectators.  Like AddSpectator, only before the
+ * game starts, so the relay gets every frame from 0.
+ */
+GGPOErrorCode
+Peer2PeerBackend::StartRelayBroadcast(const char *relay_ip, uint16 relay_port, const char *session)
+{
+   std::unique_lock<std::recursive_mutex> lock = LockNetwork();
+
+   if (_tunnel) {
+      return GGPO_ERRORCODE_UNSUPPORTED;     /* there is no socket to reach the relay on */
+   }
+   if (!_synchronizing || _broadcast.IsActive()) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
+   if (!_broadcast.Init(_transport->Carrier(), _poll, RelayBroadcast::Host, relay_ip, relay_port,
+                        session, _input_size * _num_players)) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
+   return GGPO_OK;
+}
+
+/*
+ * Samples the worst frame advantage error across the remote players once a
+ * frame.  In GGPO_TIMESYNC_SLEW it also turns the error into a slowdown:
+ * nothing inside half a frame, then TIMESYNC_SLEW_PER_FRAME permille per
+ * frame of error up to the configured cap, so a 2 frame lead at the
+ * default 2% is paid back over about 100 frames.
+ */
+void
+Peer2PeerBackend::UpdateTimeSync(int current_frame)
+{
+   if (current_frame == _timesync_frame) {
+      return;
+   }
+   _timesync_frame = current_frame;
+
+   float worst = 0;
+   bool any = false;
+   for (int i = 0; i < _num_players; i++) {
+      if (_endpoints[i].IsInitialized()) {
+         float error = _endpoints[i].FrameAdvantageError();
+         if (!any || error > worst) {
+            worst = error;
+         }
+         any = true;
+      }
+   }
+   if (!any) {
+      return;
+   }
+
+   int error_x100 = (int)(worst * 100);
+   int abs_x100 = error_x100 < 0 ? -error_x100 : error_x100;
+   _timesync_stats.error_x100 = error_x100;
+   _timesync_stats.error_max_x100 = MAX(_timesync_stats.error_max_x100, abs_x100);
+   _timesync_error_sum += abs_x100;
+   _timesync_samples++;
+
+   if (_timesync_samples % TIMESYNC_HISTORY_INTERVAL == 1) {
+      if (_timesync_stats.history_len == GGPO_TIMESYNC_HISTORY) {
+         memmove(_timesync_stats.error_history_x100, _timesync_stats.error_history_x100 + 1,
+                 (GGPO_TIMESYNC_HISTORY - 1) * sizeof(int));
+         _timesync_stats.history_len--;
+      }
+      _timesync_stats.error_history_x100[_timesync_stats.history_len++] = error_x100;
+   }
+
+   if (_timesync_mode == GGPO_TIMESYNC_SLEW) {
+      int slew = (error_x100 - TIMESYNC_SLEW_DEADBAND_X100) * TIMESYNC_SLEW_PER_FRAME / 100;
+      _timesync_stats.slew_permille = MAX(MIN(slew, _timesync_max_slew), 0);
+   }
+}
+
+GGPOErrorCode
+Peer2PeerBackend::SetStateBufferCapacity(int capacity)
+{
+   _sync.SetStateBufferCapacity(capacity);
+   return GGPO_OK;
+}
+
+GGPOErrorCode
+Peer2PeerBackend::HintStateChanges(const GGPOStateRange *ranges, int count)
+{
+   return _sync.HintStateChanges(ranges, count) ? GGPO_OK : GGPO_ERRORCODE_INVALID_REQUEST;
+}
+
+GGPOErrorCode
+Peer2PeerBackend::SetStateRegions(const GGPOStateRegion *regions, int count)
+{
+   _sync.SetStateRegions(regions, count);
+   return GGPO_OK;
+}
+
 GGPOErrorCode
 Peer2PeerBackend::SetFrameDelay(GGPOPlayerHandle player, int delay) 
 { 
@@ -560,6 +1221,7 @@ Peer2PeerBackend::SetFrameDelay(GGPOPlayerHandle player, int delay)
 GGPOErrorCode
 Peer2PeerBackend::SetDisconnectTimeout(int timeout)
 {
+   std::unique_lock<std::recursive_mutex> lock = LockNetwork();
    _disconnect_timeout = timeout;
    for (int i = 0; i < _num_players; i++) {
       if (_endpoints[i].IsInitialized()) {
@@ -572,6 +1234,7 @@ Peer2PeerBackend::SetDisconnectTimeout(int timeout)
 GGPOErrorCode
 Peer2PeerBackend::SetDisconnectNotifyStart(int timeout)
 {
+   std::unique_lock<std::recursive_mutex> lock = LockNetwork();
    _disconnect_notify_start = timeout;
    for (int i = 0; i < _num_players; i++) {
       if (_endpoints[i].IsInitialized()) {
@@ -581,6 +1244,63 @@ Peer2PeerBackend::SetDisconnectNotifyStart(int timeout)
    return GGPO_OK;
 }
 
+GGPOErrorCode
+Peer2PeerBackend::SetReconnectWindow(int window)
+{
+   std::unique_lock<std::recursive_mutex> lock = LockNetwork();
+   _reconnect_window = MAX(window, 0);
+   for (int i = 0; i < _num_players; i++) {
+      if (_endpoints[i].IsInitialized()) {
+         _endpoints[i].SetReconnectWindow(_num_players == 2 ? _reconnect_window : 0);
+      }
+   }
+   return GGPO_OK;
+}
+
+/*
+ * Only before the players are added: the remote endpoint then rejoins
+ * instead of starting a new match.
+ */
+GGPOErrorCode
+Peer2PeerBackend::Rejoin(void)
+{
+   std::unique_lock<std::recursive_mutex> lock = LockNetwork();
+   if (_num_players != 2 || !_synchronizing) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
+   for (int i = 0; i < _num_players; i++) {
+      if (_endpoints[i].IsInitialized()) {
+         return GGPO_ERRORCODE_INVALID_REQUEST;
+      }
+   }
+   _rejoining = true;
+   return GGPO_OK;
+}
+
+GGPOErrorCode
+Peer2PeerBackend::SendControl(GGPOPlayerHandle player, const void *data, int size)
+{
+   int queue;
+   GGPOErrorCode result;
+
+   if (size < 0 || size > GGPO_CONTROL_MAX_SIZE || (size && !data)) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
+   result = PlayerHandleToQueue(player, &queue);
+   if (!GGPO_SUCCEEDED(result)) {
+      return result;
+   }
+
+   std::unique_lock<std::recursive_mutex> lock = LockNetwork();
+   if (!_endpoints[queue].IsInitialized()) {
+      return GGPO_ERRORCODE_INVALID_PLAYER_HANDLE;
+   }
+   if (_local_connect_status[queue].disconnected) {
+      return GGPO_ERRORCODE_PLAYER_DISCONNECTED;
+   }
+   return _endpoints[queue].SendControl(data, size) ? GGPO_OK : GGPO_ERRORCODE_UNSUPPORTED;
+}
+
 GGPOErrorCode
 Peer2PeerBackend::PlayerHandleToQueue(GGPOPlayerHandle player, int *queue)
 {
@@ -596,6 +1316,16 @@ Peer2PeerBackend::PlayerHandleToQueue(GGPOPlayerHandle player, int *queue)
 void
 Peer2PeerBackend::OnMsg(sockaddr_in &from, UdpMsg *msg, int len)
 {
+   _net_received++;
+   /*
+    * The relay may also be forwarding the peers' own traffic, so only
+    * packets that parse as broadcast are taken here.
+    */
+   RelayBroadcast::Packet packet;
+   if (_broadcast.HandlesPacket(from) &&
+       _broadcast.OnPacket((const uint8 *)msg, len, &packet)) {
+      return;
+   }
    for (int i = 0; i < _num_players; i++) {
       if (_endpoints[i].HandlesMsg(from, msg)) {
          _endpoints[i].OnMsg(msg, len);
@@ -615,7 +1345,7 @@ Peer2PeerBackend::CheckInitialSync()
 {
    int i;
 
-   if (_synchronizing) {
+   if (_synchronizing && !_rejoining) {
       // Check to see if everyone is now synchronized.  If so,
       // go ahead and tell the client that we're ok to accept input.
       for (i = 0; i < _num_players; i++) {
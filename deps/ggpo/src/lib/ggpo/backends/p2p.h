@@ -14,10 +14,18 @@
 #include "backend.h"
 #include "timesync.h"
 #include "network/udp_proto.h"
+#include "network/relay_broadcast.h"
+#include "network/tunnel_transport.h"
 
-class Peer2PeerBackend : public IQuarkBackend, IPollSink, Udp::Callbacks {
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+class Peer2PeerBackend : public IQuarkBackend, IPollSink, Transport::Callbacks {
 public:
-   Peer2PeerBackend(GGPOSessionCallbacks *cb, const char *gamename, uint16 localport, int num_players, int input_size);
+   Peer2PeerBackend(GGPOSessionCallbacks *cb, const char *gamename, const Transport::Config &transport, int num_players, int input_size);
    virtual ~Peer2PeerBackend();
 
 
@@ -30,9 +38,22 @@ public:
    virtual GGPOErrorCode DisconnectPlayer(GGPOPlayerHandle handle);
    virtual GGPOErrorCode GetNetworkStats(GGPONetworkStats *stats, GGPOPlayerHandle handle);
    virtual GGPOErrorCode GetStateStats(GGPOStateStats *stats);
+   virtual GGPOErrorCode GetRollbackStats(GGPORollbackStats *stats);
+   virtual GGPOErrorCode GetTimeSyncStats(GGPOTimeSyncStats *stats);
    virtual GGPOErrorCode SetFrameDelay(GGPOPlayerHandle player, int delay);
    virtual GGPOErrorCode SetDisconnectTimeout(int timeout);
    virtual GGPOErrorCode SetDisconnectNotifyStart(int timeout);
+   virtual GGPOErrorCode SetReconnectWindow(int window);
+   virtual GGPOErrorCode Rejoin(void);
+   virtual GGPOErrorCode SendControl(GGPOPlayerHandle player, const void *data, int size);
+   virtual GGPOErrorCode SetStateBufferCapacity(int capacity);
+   virtual GGPOErrorCode HintStateChanges(const GGPOStateRange *ranges, int count);
+   virtual GGPOErrorCode SetStateRegions(const GGPOStateRegion *regions, int count);
+   virtual GGPOErrorCode SetTimeSyncMode(int mode, int max_slew_permille);
+   virtual GGPOErrorCode StartRelayBroadcast(const char *relay_ip, uint16 relay_port, const char *session);
+   virtual GGPOErrorCode TunnelRead(void *buffer, int *len);
+   virtual GGPOErrorCode TunnelWrite(const void *data, int len);
+   virtual GGPOErrorCode GetChecksumState(int frame, void *buffer, int *size);
 
 public:
    virtual void OnMsg(sockaddr_in &from, UdpMsg *msg, int len);
@@ -43,12 +64,27 @@ protected:
    GGPOPlayerHandle QueueToSpectatorHandle(int queue) { return (GGPOPlayerHandle)(queue + 1000); } /* out of range of the player array, basically */
    void DisconnectPlayerQueue(int queue, int syncto);
    void PollSyncEvents(void);
+   void UpdateSyscallStats(void);
+   void UpdateTimeSync(int current_frame);
+   void PollNetwork(int wait);
+   void StartNetworkThread(void);
+   void StopNetworkThread(void);
+   void NetworkThreadMain(void);
+   void WaitForNetwork(int timeout);
+   std::unique_lock<std::recursive_mutex> LockNetwork(void);
    void PollUdpProtocolEvents(void);
    void CheckInitialSync(void);
    int Poll2Players(int current_frame);
    int PollNPlayers(int current_frame);
    void AddRemotePlayer(char *remoteip, uint16 reportport, int queue);
+   void NegotiateSyncConfig(int queue);
+   void CheckRemoteChecksum(int queue, int frame, int checksum);
    GGPOErrorCode AddSpectator(char *remoteip, uint16 reportport);
+   void PollRejoins(void);
+   bool SendRejoinState(int queue);
+   void LoadRejoinState(int queue, int resume_ms);
+   void SendLocalInputs(int queue, int frame);
+   void SendBroadcastKeyframe(void);
    virtual void OnSyncEvent(Sync::Event &e) { }
    virtual void OnUdpProtocolEvent(UdpProtocol::Event &e, GGPOPlayerHandle handle);
    virtual void OnUdpProtocolPeerEvent(UdpProtocol::Event &e, int queue);
@@ -58,21 +94,78 @@ protected:
    GGPOSessionCallbacks  _callbacks;
    Poll                  _poll;
    Sync                  _sync;
-   Udp                   _udp;
+   Transport             *_transport;
+   Transport::Kind       _transport_kind;
+   TunnelTransport       *_tunnel;           /* _transport, for a tunnel session */
    UdpProtocol           *_endpoints;
    UdpProtocol           _spectators[GGPO_MAX_SPECTATORS];
    int                   _num_spectators;
+   RelayBroadcast        _broadcast;         /* spectators fanned out by a relay */
+   int                   _broadcast_keyframe_interval;
+   int                   _broadcast_keyframe;   /* frame of the last keyframe uploaded */
    int                   _input_size;
 
    bool                  _synchronizing;
    int                   _num_players;
    int                   _next_recommended_sleep;
 
+   /*
+    * Frame advantage correction; see GGPOTimeSyncMode.  Sampled once per
+    * frame on the emulation thread.
+    */
+   int                   _timesync_mode;
+   int                   _timesync_max_slew;
+   int                   _timesync_frame;
+   long long             _timesync_error_sum;
+   int                   _timesync_samples;
+   GGPOTimeSyncStats     _timesync_stats;
+   int                   _syscall_stats_frame;
+   unsigned int          _syscall_stats_count;
+   int                   _syscalls_per_frame_x100;
+
    int                   _next_spectator_frame;
    int                   _disconnect_timeout;
    int                   _disconnect_notify_start;
+   int                   _reconnect_window;
+
+   /*
+    * Rejoins.  _rejoining is set on the restarted side until the state
+    * arrives; _rejoin is the surviving side's view of each peer taking a
+    * match back up from frame.
+    */
+   bool                  _rejoining;
+   struct {
+      bool                    pending;
+      bool                    sent;
+      int                     frame;
+   }                     _rejoin[UDP_MSG_MAX_PLAYERS];
 
    UdpMsg::connect_status _local_connect_status[UDP_MSG_MAX_PLAYERS];
+
+   /*
+    * PollNPlayers' per-queue view of what the running endpoints have
+    * confirmed, refreshed only for queues whose peer status changed.
+    */
+   struct {
+      int                     min_confirmed;
+      bool                    connected;
+   }                          _queue_confirm[UDP_MSG_MAX_PLAYERS];
+   uint32                     _confirm_endpoints;   /* running endpoints folded into _queue_confirm */
+
+   InputEncodeCache           _spectator_encode_cache;
+
+   /*
+    * Optional I/O thread (ggpo.network.thread).  While it runs, _poll, _transport,
+    * the endpoints and _local_connect_status belong to whoever holds
+    * _net_mutex; Sync stays on the emulation thread.
+    */
+   bool                       _net_thread_enabled;
+   std::thread                _net_thread;
+   std::recursive_mutex       _net_mutex;
+   std::atomic<bool>          _net_shutdown;
+   std::atomic<unsigned int>  _net_received;
+   std::mutex                 _net_wake_mutex;
+   std::condition_variable    _net_wake_cv;
 };
 
 #endif
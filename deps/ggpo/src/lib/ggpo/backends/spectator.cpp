@@ -6,17 +6,21 @@
  */
 
 #include "spectator.h"
+#include "state_codec.h"
 
 SpectatorBackend::SpectatorBackend(GGPOSessionCallbacks *cb,
                                    const char* gamename,
-                                   uint16 localport,
+                                   const Transport::Config &transport,
                                    int num_players,
                                    int input_size,
                                    char *hostip,
                                    u_short hostport) :
-   _num_players(num_players),
    _input_size(input_size),
-   _next_input_to_send(0)
+   _num_players(num_players),
+   _next_input_to_send(0),
+   _relay_mode(false),
+   _relay_end_frame(-1),
+   _relay_disconnected(false)
 {
    _callbacks = *cb;
    _synchronizing = true;
@@ -26,14 +30,15 @@ SpectatorBackend::SpectatorBackend(GGPOSessionCallbacks *cb,
    }
 
    /*
-    * Initialize the UDP port
+    * Initialize the transport
     */
-   _udp.Init(localport, &_poll, this);
+   _transport = Transport::Create(transport, &_poll, this);
 
    /*
     * Init the host endpoint
     */
-   _host.Init(&_udp, _poll, 0, hostip, hostport, NULL);
+   _host.Init(_transport, _poll, 0, hostip, hostport, NULL);
+   _host.SetInputShape(0, _num_players);
    _host.Synchronize();
 
    /*
@@ -42,15 +47,72 @@ SpectatorBackend::SpectatorBackend(GGPOSessionCallbacks *cb,
    _callbacks.begin_game(gamename);
 }
   
+SpectatorBackend::SpectatorBackend(GGPOSessionCallbacks *cb,
+                                   const char* gamename,
+                                   const Transport::Config &transport,
+                                   int num_players,
+                                   int input_size,
+                                   const char *relayip,
+                                   u_short relayport,
+                                   const char *session) :
+   _input_size(input_size),
+   _num_players(num_players),
+   _next_input_to_send(0),
+   _relay_mode(true),
+   _relay_end_frame(-1),
+   _relay_disconnected(false)
+{
+   _callbacks = *cb;
+   _synchronizing = true;
+
+   for (size_t i = 0; i < ARRAY_SIZE(_inputs); i++) {
+      _inputs[i].frame = -1;
+   }
+
+   /* The broadcast speaks its own protocol to the relay over a socket. */
+   Transport::Config config = transport;
+   config.kind = Transport::Socket;
+   _transport = Transport::Create(config, &_poll, this);
+
+   /*
+    * Join the relay's broadcast, from its keyframe unless
+    * ggpo.broadcast.from_start asks for the whole match.  A relay we can't
+    * reach shows up as a disconnect once RELAY_BCAST_TIMEOUT passes
+    * without a reply.
+    */
+   if (_relay.Init(_transport, _poll, RelayBroadcast::Spectator, relayip, relayport,
+                   session, _input_size * _num_players)) {
+      if (Platform::GetConfigInt("ggpo.broadcast.from_start") <= 0) {
+         _relay.RequestKeyframe();
+      }
+      UpdateRelayRequest(true);
+   } else {
+      Log("relay spectating: bad relay address %s:%d.\n", relayip, relayport);
+   }
+
+   _callbacks.begin_game(gamename);
+}
+
 SpectatorBackend::~SpectatorBackend()
 {
+   delete _transport;
 }
 
 GGPOErrorCode
 SpectatorBackend::DoPoll(int timeout)
 {
-   _poll.Pump(0);
+   _transport->BeginBatch();
+   _poll.Pump(timeout > 0 ? timeout : 0);
+   _transport->EndBatch();
 
+   if (_relay_mode) {
+      if (!_relay_disconnected &&
+          Platform::GetCurrentTimeMS() - _relay.LastRecvTime() > RELAY_BCAST_TIMEOUT) {
+         Log("relay spectating: relay silent for %d ms.\n", RELAY_BCAST_TIMEOUT);
+         RelayDisconnected();
+      }
+      return GGPO_OK;
+   }
    PollUdpProtocolEvents();
    return GGPO_OK;
 }
@@ -82,6 +144,10 @@ SpectatorBackend::SyncInput(void *values,
       *disconnect_flags = 0; // xxx: should get them from the host!
    }
    _next_input_to_send++;
+   if (_relay_mode) {
+      UpdateRelayRequest(false);
+      CheckRelayEnd();
+   }
 
    return GGPO_OK;
 }
@@ -89,7 +155,7 @@ SpectatorBackend::SyncInput(void *values,
 GGPOErrorCode
 SpectatorBackend::IncrementFrame(void)
 {  
-   Log("End of frame (%d)...\n", _next_input_to_send - 1);
+   LogVerbose("End of frame (%d)...\n", _next_input_to_send - 1);
    DoPoll(0);
    PollUdpProtocolEvents();
 
@@ -164,9 +230,151 @@ SpectatorBackend::OnUdpProtocolEvent(UdpProtocol::Event &evt)
    }
 }
  
+/*
+ * Tells the relay the first frame missing from the buffer and how many
+ * frames fit from there, so a late joiner is fed its catch-up at the rate
+ * it plays it back.
+ */
+void
+SpectatorBackend::UpdateRelayRequest(bool urgent)
+{
+   int next = _next_input_to_send;
+   while (next < _next_input_to_send + SPECTATOR_FRAME_BUFFER_SIZE &&
+          _inputs[next % SPECTATOR_FRAME_BUFFER_SIZE].frame == next) {
+      next++;
+   }
+   _relay.Request(next, _next_input_to_send + SPECTATOR_FRAME_BUFFER_SIZE - next, urgent);
+}
+
+void
+SpectatorBackend::OnRelayPacket(RelayBroadcast::Packet &packet)
+{
+   GGPOEvent info;
+
+   switch (packet.type) {
+   case RelayBroadcast::Packet::Frames:
+      {
+         int limit = _next_input_to_send + SPECTATOR_FRAME_BUFFER_SIZE;
+         bool gap = false;
+         for (int i = 0; i < packet.count; i++) {
+            int frame = packet.frame + i;
+            GameInput &input = _inputs[frame % SPECTATOR_FRAME_BUFFER_SIZE];
+            if (frame < _next_input_to_send || frame >= limit || input.frame == frame) {
+               continue;
+            }
+            if (frame > _next_input_to_send &&
+                _inputs[(frame - 1) % SPECTATOR_FRAME_BUFFER_SIZE].frame != frame - 1) {
+               gap = true;
+            }
+            input.init(frame, (char *)packet.data + i * packet.frame_size, packet.frame_size);
+         }
+         UpdateRelayRequest(gap);
+      }
+      if (_synchronizing && packet.count > 0) {
+         info.code = GGPO_EVENTCODE_CONNECTED_TO_PEER;
+         info.u.connected.player = 0;
+         _callbacks.on_event(&info);
+
+         info.code = GGPO_EVENTCODE_SYNCHRONIZED_WITH_PEER;
+         info.u.synchronized.player = 0;
+         _callbacks.on_event(&info);
+
+         info.code = GGPO_EVENTCODE_RUNNING;
+         _callbacks.on_event(&info);
+         _synchronizing = false;
+      }
+      break;
+
+   case RelayBroadcast::Packet::Keyframe:
+      LoadKeyframe(packet);
+      break;
+
+   case RelayBroadcast::Packet::End:
+      _relay_end_frame = packet.frame;
+      CheckRelayEnd();
+      break;
+
+   case RelayBroadcast::Packet::Gone:
+      Log("relay spectating: frame %d is gone, relay starts at %d.\n",
+          _next_input_to_send, packet.frame);
+      RelayDisconnected();
+      break;
+
+   default:
+      break;
+   }
+}
+
+/*
+ * Starts the match at the relay's keyframe, so only the frames from there
+ * on are played back.  One that can't be decoded is skipped and the
+ * broadcast is played from the start instead.
+ */
+void
+SpectatorBackend::LoadKeyframe(RelayBroadcast::Packet &packet)
+{
+   std::vector<byte> state;
+
+   if (packet.codec == GGPO_STATE_CODEC_RAW) {
+      state.assign(packet.data, packet.data + packet.size);
+   } else {
+      const StateCodec *codec = StateCodec::Get((GGPOStateCodec)packet.codec);
+      if (codec) {
+         state.resize(packet.raw_size);
+         if (!codec->Decompress(packet.data, packet.size, &state[0], packet.raw_size)) {
+            state.clear();
+         }
+      }
+   }
+   if (state.empty() || !_callbacks.load_game_state(&state[0], (int)state.size())) {
+      Log("relay spectating: could not load the keyframe for frame %d (codec %d, %d bytes).\n",
+          packet.frame, packet.codec, packet.size);
+      UpdateRelayRequest(true);
+      return;
+   }
+   _next_input_to_send = packet.frame;
+   UpdateRelayRequest(true);
+
+   GGPOEvent info;
+   info.code = GGPO_EVENTCODE_KEYFRAME_LOADED;
+   info.u.keyframe_loaded.frame = packet.frame;
+   info.u.keyframe_loaded.state_bytes = packet.size;
+   _callbacks.on_event(&info);
+}
+
+/* The match is over once everything the host sent has been played back. */
+void
+SpectatorBackend::CheckRelayEnd(void)
+{
+   if (_relay_end_frame >= 0 && _next_input_to_send >= _relay_end_frame) {
+      RelayDisconnected();
+   }
+}
+
+void
+SpectatorBackend::RelayDisconnected(void)
+{
+   if (_relay_disconnected) {
+      return;
+   }
+   _relay_disconnected = true;
+
+   GGPOEvent info;
+   info.code = GGPO_EVENTCODE_DISCONNECTED_FROM_PEER;
+   info.u.disconnected.player = 0;
+   _callbacks.on_event(&info);
+}
+
 void
 SpectatorBackend::OnMsg(sockaddr_in &from, UdpMsg *msg, int len)
 {
+   if (_relay_mode) {
+      RelayBroadcast::Packet packet;
+      if (_relay.HandlesPacket(from) && _relay.OnPacket((const uint8 *)msg, len, &packet)) {
+         OnRelayPacket(packet);
+      }
+      return;
+   }
    if (_host.HandlesMsg(from, msg)) {
       _host.OnMsg(msg, len);
    }
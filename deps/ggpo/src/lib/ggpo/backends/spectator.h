@@ -14,12 +14,14 @@
 #include "backend.h"
 #include "timesync.h"
 #include "network/udp_proto.h"
+#include "network/relay_broadcast.h"
 
 #define SPECTATOR_FRAME_BUFFER_SIZE    64
 
-class SpectatorBackend : public IQuarkBackend, IPollSink, Udp::Callbacks {
+class SpectatorBackend : public IQuarkBackend, IPollSink, Transport::Callbacks {
 public:
-   SpectatorBackend(GGPOSessionCallbacks *cb, const char *gamename, uint16 localport, int num_players, int input_size, char *hostip, u_short hostport);
+   SpectatorBackend(GGPOSessionCallbacks *cb, const char *gamename, const Transport::Config &transport, int num_players, int input_size, char *hostip, u_short hostport);
+   SpectatorBackend(GGPOSessionCallbacks *cb, const char *gamename, const Transport::Config &transport, int num_players, int input_size, const char *relayip, u_short relayport, const char *session);
    virtual ~SpectatorBackend();
 
 
@@ -43,17 +45,31 @@ protected:
    void CheckInitialSync(void);
 
    void OnUdpProtocolEvent(UdpProtocol::Event &e);
+   void OnRelayPacket(RelayBroadcast::Packet &packet);
+   void LoadKeyframe(RelayBroadcast::Packet &packet);
+   void UpdateRelayRequest(bool urgent);
+   void CheckRelayEnd(void);
+   void RelayDisconnected(void);
 
 protected:
    GGPOSessionCallbacks  _callbacks;
    Poll                  _poll;
-   Udp                   _udp;
+   Transport             *_transport;
    UdpProtocol           _host;
    bool                  _synchronizing;
    int                   _input_size;
    int                   _num_players;
    int                   _next_input_to_send;
    GameInput             _inputs[SPECTATOR_FRAME_BUFFER_SIZE];
+
+   /*
+    * Relay mode (ggpo_start_relay_spectating): inputs come from the relay's
+    * copy of the match instead of a UdpProtocol link to a player.
+    */
+   bool                  _relay_mode;
+   RelayBroadcast        _relay;
+   int                   _relay_end_frame;
+   bool                  _relay_disconnected;
 };
 
 #endif
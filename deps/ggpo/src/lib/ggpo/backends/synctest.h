@@ -24,6 +24,9 @@ public:
    virtual GGPOErrorCode SyncInput(void *values, int size, int *disconnect_flags);
    virtual GGPOErrorCode IncrementFrame(void);
    virtual GGPOErrorCode Logv(char *fmt, va_list list);
+   virtual GGPOErrorCode SetStateBufferCapacity(int capacity);
+   virtual GGPOErrorCode HintStateChanges(const GGPOStateRange *ranges, int count);
+   virtual GGPOErrorCode SetStateRegions(const GGPOStateRegion *regions, int count);
 
 protected:
    struct SavedInfo {
@@ -33,6 +36,7 @@ protected:
       int         cbuf;
       int         uncompressed_size;
       bool        compressed;
+      GGPOStateCodec codec;
       GameInput   input;
    };
 
@@ -40,6 +44,7 @@ protected:
    void BeginLog(int saving);
    void EndLog();
    void LogSaveStates(SavedInfo &info);
+   void ReportDesync(int frame, int checksum, int saved_checksum);
 
 protected:
    GGPOSessionCallbacks   _callbacks;
@@ -49,12 +54,14 @@ protected:
    int                    _last_verified;
    bool                   _rollingback;
    bool                   _running;
+   bool                   _soak;
+   int                    _last_match;
    FILE                   *_logfp;
    char                   _game[128];
 
    GameInput                  _current_input;
    GameInput                  _last_input;
-   RingBuffer<SavedInfo, 32>  _saved_frames;
+   RingBuffer<SavedInfo, GGPO_SYNCTEST_MAX_FRAMES + 1> _saved_frames;
 };
 
 #endif
@@ -23,10 +23,10 @@ BitVector_ClearBit(uint8 *vector, int *offset)
 }
 
 void
-BitVector_WriteNibblet(uint8 *vector, int nibble, int *offset)
+BitVector_WriteNibblet(uint8 *vector, int nibble, int *offset, int width)
 {
-   ASSERT(nibble < (1 << BITVECTOR_NIBBLE_SIZE));
-   for (int i = 0; i < BITVECTOR_NIBBLE_SIZE; i++) {
+   ASSERT(nibble < (1 << width));
+   for (int i = 0; i < width; i++) {
       if (nibble & (1 << i)) {
          BitVector_SetBit(vector, offset);
       } else {
@@ -44,10 +44,10 @@ BitVector_ReadBit(uint8 *vector, int *offset)
 }
 
 int
-BitVector_ReadNibblet(uint8 *vector, int *offset)
+BitVector_ReadNibblet(uint8 *vector, int *offset, int width)
 {
    int nibblet = 0;
-   for (int i = 0; i < BITVECTOR_NIBBLE_SIZE; i++) {
+   for (int i = 0; i < width; i++) {
       nibblet |= (BitVector_ReadBit(vector, offset) << i);
    }
    return nibblet;
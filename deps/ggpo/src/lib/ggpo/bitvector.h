@@ -12,8 +12,8 @@
 
 void BitVector_SetBit(uint8 *vector, int *offset);
 void BitVector_ClearBit(uint8 *vector, int *offset);
-void BitVector_WriteNibblet(uint8 *vector, int nibble, int *offset);
+void BitVector_WriteNibblet(uint8 *vector, int nibble, int *offset, int width = BITVECTOR_NIBBLE_SIZE);
 int BitVector_ReadBit(uint8 *vector, int *offset);
-int BitVector_ReadNibblet(uint8 *vector, int *offset);
+int BitVector_ReadNibblet(uint8 *vector, int *offset, int width = BITVECTOR_NIBBLE_SIZE);
 
 #endif // _BITVECTOR_H
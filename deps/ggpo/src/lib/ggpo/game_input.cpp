@@ -14,6 +14,7 @@ GameInput::init(int iframe, char *ibits, int isize, int offset)
 {
    ASSERT(isize);
    ASSERT(isize <= GAMEINPUT_MAX_BYTES);
+   ASSERT((offset + 1) * isize <= (int)sizeof(bits));
    frame = iframe;
    size = isize;
    memset(bits, 0, sizeof(bits));
@@ -29,9 +30,11 @@ GameInput::init(int iframe, char *ibits, int isize)
    ASSERT(isize <= GAMEINPUT_MAX_BYTES * GAMEINPUT_MAX_PLAYERS);
    frame = iframe;
    size = isize;
-   memset(bits, 0, sizeof(bits));
    if (ibits) {
       memcpy(bits, ibits, isize);
+      memset(bits + isize, 0, sizeof(bits) - isize);
+   } else {
+      memset(bits, 0, sizeof(bits));
    }
 }
 
@@ -61,7 +64,11 @@ void
 GameInput::log(char *prefix, bool show_frame) const
 {
 	char buf[1024];
-   size_t c = strlen(prefix);
+   size_t c;
+   if (!LogEnabled(GGPO_LOG_INFO)) {
+      return;
+   }
+   c = strlen(prefix);
 	strcpy_s(buf, prefix);
 	desc(buf + c, ARRAY_SIZE(buf) - c, show_frame);
    strncat_s(buf, ARRAY_SIZE(buf) - strlen(buf), "\n", 1);
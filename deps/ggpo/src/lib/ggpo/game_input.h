@@ -11,11 +11,12 @@
 #include <stdio.h>
 #include <memory.h>
 
-// GAMEINPUT_MAX_BYTES * GAMEINPUT_MAX_PLAYERS * 8 must be less than
-// 2^BITVECTOR_NIBBLE_SIZE (see bitvector.h)
+// Sized for the spectator stream, which carries every player's input in
+// one GameInput.  Only the first size bytes are meaningful; the rest stay
+// zero.  Matches GGPO_MAX_PLAYERS and UDP_MSG_MAX_PLAYERS.
 
 #define GAMEINPUT_MAX_BYTES      15
-#define GAMEINPUT_MAX_PLAYERS    2
+#define GAMEINPUT_MAX_PLAYERS    4
 
 struct GameInput {
    enum Constants {
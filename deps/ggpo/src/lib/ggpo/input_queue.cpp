@@ -8,7 +8,7 @@
 #include "types.h"
 #include "input_queue.h"
 
-#define PREVIOUS_FRAME(offset)   (((offset) == 0) ? (INPUT_QUEUE_LENGTH - 1) : ((offset) - 1))
+#define PREVIOUS_FRAME(offset)   (((offset) - 1) & INPUT_QUEUE_MASK)
 
 InputQueue::InputQueue(int input_size)
 {
@@ -22,6 +22,8 @@ InputQueue::~InputQueue()
 void
 InputQueue::Init(int id, int input_size)
 {
+   ASSERT(input_size > 0 && input_size <= GAMEINPUT_MAX_BYTES);
+
    _id = id;
    _head = 0;
    _tail = 0;
@@ -32,23 +34,50 @@ InputQueue::Init(int id, int input_size)
    _first_incorrect_frame = GameInput::NullFrame;
    _last_frame_requested = GameInput::NullFrame;
    _last_added_frame = GameInput::NullFrame;
+   _model = GGPO_PREDICT_REPEAT;
+   _button_bytes = 0;
+   _history_count = 0;
+   _history_frame = GameInput::NullFrame;
+   _runs.flips = 0;
+   _predicted_frames = 0;
+   _mispredicted_frames = 0;
+
+   _input_size = input_size;
 
    _prediction.init(GameInput::NullFrame, NULL, input_size);
 
-   /*
-    * This is safe because we know the GameInput is a proper structure (as in,
-    * no virtual methods, no contained classes, etc.).
-    */
-   memset(_inputs, 0, sizeof _inputs);
-   for (int i = 0; i < ARRAY_SIZE(_inputs); i++) {
-      _inputs[i].size = input_size;
-   }
+   memset(_frames, 0, sizeof _frames);
+   memset(_bits, 0, sizeof _bits);
+}
+
+/*
+ * Entries hold only the negotiated input size; the rest of a GameInput's
+ * bits stay zero, as its users expect.
+ */
+void
+InputQueue::GetEntry(int offset, GameInput *input)
+{
+   input->frame = _frames[offset];
+   input->size = _input_size;
+   memcpy(input->bits, EntryBits(offset), _input_size);
+   memset(input->bits + _input_size, 0, sizeof(input->bits) - _input_size);
+}
+
+/*
+ * button_bytes is how much of each input the model may treat as button
+ * bits; 0 means all of it.
+ */
+void
+InputQueue::SetPredictor(GGPOPredictModel model, int button_bytes)
+{
+   _model = (model >= 0 && model < GGPO_PREDICT_MODEL_COUNT) ? model : GGPO_PREDICT_REPEAT;
+   _button_bytes = button_bytes > 0 ? button_bytes : _prediction.size;
 }
 
 int
 InputQueue::GetLastConfirmedFrame()
 {
-   Log("returning last confirmed frame %d.\n", _last_added_frame);
+   LogVerbose("returning last confirmed frame %d.\n", _last_added_frame);
    return _last_added_frame;
 }
 
@@ -67,21 +96,21 @@ InputQueue::DiscardConfirmedFrames(int frame)
       frame = MIN(frame, _last_frame_requested);
    }
 
-   Log("discarding confirmed frames up to %d (last_added:%d length:%d [head:%d tail:%d]).\n", 
+   LogVerbose("discarding confirmed frames up to %d (last_added:%d length:%d [head:%d tail:%d]).\n", 
        frame, _last_added_frame, _length, _head, _tail);
    if (frame >= _last_added_frame) {
       _tail = _head;
    } else {
-      int offset = frame - _inputs[_tail].frame + 1;
+      int offset = frame - _frames[_tail] + 1;
       
-      Log("difference of %d frames.\n", offset);
+      LogVerbose("difference of %d frames.\n", offset);
       ASSERT(offset >= 0);
 
-      _tail = (_tail + offset) % INPUT_QUEUE_LENGTH;
+      _tail = (_tail + offset) & INPUT_QUEUE_MASK;
       _length -= offset;
    }
 
-   Log("after discarding, new tail is %d (frame:%d).\n", _tail, _inputs[_tail].frame);
+   LogVerbose("after discarding, new tail is %d (frame:%d).\n", _tail, _frames[_tail]);
    ASSERT(_length >= 0);
 }
 
@@ -105,18 +134,18 @@ bool
 InputQueue::GetConfirmedInput(int requested_frame, GameInput *input)
 {
    ASSERT(_first_incorrect_frame == GameInput::NullFrame || requested_frame < _first_incorrect_frame);
-   int offset = requested_frame % INPUT_QUEUE_LENGTH; 
-   if (_inputs[offset].frame != requested_frame) {
+   int offset = requested_frame & INPUT_QUEUE_MASK;
+   if (_frames[offset] != requested_frame) {
       return false;
    }
-   *input = _inputs[offset];
+   GetEntry(offset, input);
    return true;
 }
 
 bool
 InputQueue::GetInput(int requested_frame, GameInput *input)
 {
-   Log("requesting input frame %d.\n", requested_frame);
+   LogVerbose("requesting input frame %d.\n", requested_frame);
 
    /*
     * No one should ever try to grab any input when we have a prediction
@@ -131,20 +160,20 @@ InputQueue::GetInput(int requested_frame, GameInput *input)
     */
    _last_frame_requested = requested_frame;
 
-   ASSERT(requested_frame >= _inputs[_tail].frame);
+   ASSERT(requested_frame >= _frames[_tail]);
 
    if (_prediction.frame == GameInput::NullFrame) {
       /*
        * If the frame requested is in our range, fetch it out of the queue and
        * return it.
        */
-      int offset = requested_frame - _inputs[_tail].frame;
+      int offset = requested_frame - _frames[_tail];
 
       if (offset < _length) {
-         offset = (offset + _tail) % INPUT_QUEUE_LENGTH;
-         ASSERT(_inputs[offset].frame == requested_frame);
-         *input = _inputs[offset];
-         Log("returning confirmed frame number %d.\n", input->frame);
+         offset = (offset + _tail) & INPUT_QUEUE_MASK;
+         ASSERT(_frames[offset] == requested_frame);
+         GetEntry(offset, input);
+         LogVerbose("returning confirmed frame number %d.\n", input->frame);
          return true;
       }
 
@@ -154,17 +183,19 @@ InputQueue::GetInput(int requested_frame, GameInput *input)
        * same thing they did last time.
        */
       if (requested_frame == 0) {
-         Log("basing new prediction frame from nothing, you're client wants frame 0.\n");
+         LogVerbose("basing new prediction frame from nothing, you're client wants frame 0.\n");
          _prediction.erase();
       } else if (_last_added_frame == GameInput::NullFrame) {
-         Log("basing new prediction frame from nothing, since we have no frames yet.\n");
+         LogVerbose("basing new prediction frame from nothing, since we have no frames yet.\n");
          _prediction.erase();
       } else {
-         Log("basing new prediction frame from previously added frame (queue entry:%d, frame:%d).\n",
-              PREVIOUS_FRAME(_head), _inputs[PREVIOUS_FRAME(_head)].frame);
-         _prediction = _inputs[PREVIOUS_FRAME(_head)];
+         LogVerbose("basing new prediction frame from previously added frame (queue entry:%d, frame:%d).\n",
+              PREVIOUS_FRAME(_head), _frames[PREVIOUS_FRAME(_head)]);
+         _prediction.frame = _frames[PREVIOUS_FRAME(_head)];
+         memcpy(_prediction.bits, EntryBits(PREVIOUS_FRAME(_head)), _input_size);
       }
       _prediction.frame++;
+      StartPrediction();
    }
 
    ASSERT(_prediction.frame >= 0);
@@ -174,19 +205,25 @@ InputQueue::GetInput(int requested_frame, GameInput *input)
     * forward the prediction frame contents.  Be sure to return the
     * frame number requested by the client, though.
     */
-   *input = _prediction;
-   input->frame = requested_frame;
-   Log("returning prediction frame number %d (%d).\n", input->frame, _prediction.frame);
+   Predict(requested_frame, input);
+   LogVerbose("returning prediction frame number %d (%d).\n", input->frame, _prediction.frame);
 
    return false;
 }
 
+/*
+ * When the frame delay has been raised, the frames between the last input
+ * and this one are padded with a copy of the last.  If padding is set it
+ * gets that copy, framed at the first padded frame, so the caller can send
+ * those frames on too; its frame is GameInput::NullFrame when none was
+ * padded.
+ */
 void
-InputQueue::AddInput(GameInput &input)
+InputQueue::AddInput(GameInput &input, GameInput *padding)
 {
    int new_frame;
 
-   Log("adding input frame number %d to queue.\n", input.frame);
+   LogVerbose("adding input frame number %d to queue.\n", input.frame);
 
    /*
     * These next two lines simply verify that inputs are passed in 
@@ -200,9 +237,10 @@ InputQueue::AddInput(GameInput &input)
     * Move the queue head to the correct point in preparation to
     * input the frame into the queue.
     */
-   new_frame = AdvanceQueueHead(input.frame);
+   new_frame = AdvanceQueueHead(input.frame, padding);
    if (new_frame != GameInput::NullFrame) {
-      AddDelayedInputToQueue(input, new_frame);
+      ASSERT(input.size == _input_size);
+      AddDelayedInputToQueue(input.bits, new_frame);
    }
    
    /*
@@ -214,22 +252,20 @@ InputQueue::AddInput(GameInput &input)
 }
 
 void
-InputQueue::AddDelayedInputToQueue(GameInput &input, int frame_number)
+InputQueue::AddDelayedInputToQueue(const char *bits, int frame_number)
 {
-   Log("adding delayed input frame number %d to queue.\n", frame_number);
-
-   ASSERT(input.size == _prediction.size);
+   LogVerbose("adding delayed input frame number %d to queue.\n", frame_number);
 
    ASSERT(_last_added_frame == GameInput::NullFrame || frame_number == _last_added_frame + 1);
 
-   ASSERT(frame_number == 0 || _inputs[PREVIOUS_FRAME(_head)].frame == frame_number - 1);
+   ASSERT(frame_number == 0 || _frames[PREVIOUS_FRAME(_head)] == frame_number - 1);
 
    /*
     * Add the frame to the back of the queue
     */ 
-   _inputs[_head] = input;
-   _inputs[_head].frame = frame_number;
-   _head = (_head + 1) % INPUT_QUEUE_LENGTH;
+   _frames[_head] = frame_number;
+   memcpy(EntryBits(_head), bits, _input_size);
+   _head = (_head + 1) & INPUT_QUEUE_MASK;
    _length++;
    _first_frame = false;
 
@@ -244,7 +280,17 @@ InputQueue::AddDelayedInputToQueue(GameInput &input, int frame_number)
        * remember the first input which was incorrect so we can report it
        * in GetFirstIncorrectFrame()
        */
-      if (_first_incorrect_frame == GameInput::NullFrame && !_prediction.equal(input, true)) {
+      bool correct = PredictionMatches(frame_number, bits);
+
+      /* Only frames the game actually ran on the guess count toward the hit rate. */
+      if (_last_frame_requested != GameInput::NullFrame && frame_number <= _last_frame_requested) {
+         _predicted_frames++;
+         if (!correct) {
+            _mispredicted_frames++;
+         }
+      }
+
+      if (_first_incorrect_frame == GameInput::NullFrame && !correct) {
          Log("frame %d does not match prediction.  marking error.\n", frame_number);
          _first_incorrect_frame = frame_number;
       }
@@ -265,12 +311,109 @@ InputQueue::AddDelayedInputToQueue(GameInput &input, int frame_number)
    ASSERT(_length <= INPUT_QUEUE_LENGTH);
 }
 
+/*
+ * Snapshots the confirmed inputs leading up to the first predicted frame,
+ * so every guess until the prediction is dropped comes from the same
+ * history and can be checked against the real input later.
+ */
+void
+InputQueue::StartPrediction()
+{
+   _history_count = 0;
+   _history_frame = _prediction.frame - 1;
+   if (_model == GGPO_PREDICT_REPEAT || _last_added_frame == GameInput::NullFrame) {
+      return;
+   }
+
+   /*
+    * Discarded entries keep their frame numbers until overwritten, so walk
+    * back from the head for as long as the frames stay contiguous.
+    */
+   int offset = PREVIOUS_FRAME(_head);
+   int count = 0;
+   while (count < GGPO_PREDICT_HISTORY && _frames[offset] == _history_frame - count) {
+      count++;
+      offset = PREVIOUS_FRAME(offset);
+   }
+   /* The ring is packed, so the history is one run of it, two if it wraps. */
+   int oldest = (offset + 1) & INPUT_QUEUE_MASK;
+   int before_wrap = MIN(count, INPUT_QUEUE_LENGTH - oldest);
+   memcpy(_history, EntryBits(oldest), before_wrap * _input_size);
+   memcpy(_history + before_wrap * _input_size, EntryBits(0), (count - before_wrap) * _input_size);
+   _history_count = count;
+   ggpo_predict_start(_model, (const unsigned char *)_history, _history_count,
+                      _input_size, _button_bytes, &_runs);
+}
+
+void
+InputQueue::Predict(int frame, GameInput *input)
+{
+   *input = _prediction;
+   input->frame = frame;
+   if (_history_count > 0) {
+      ggpo_predict_runs(&_runs, (const unsigned char *)_history, _history_count,
+                        _prediction.size, frame - _history_frame,
+                        (unsigned char *)input->bits);
+   }
+}
+
+/*
+ * Checks an arriving input against what Predict gave the game for its
+ * frame without building the whole GameInput.
+ */
+bool
+InputQueue::PredictionMatches(int frame, const char *bits)
+{
+   if (_history_count == 0) {
+      return memcmp(_prediction.bits, bits, _input_size) == 0;
+   }
+   unsigned char guess[GAMEINPUT_MAX_BYTES];
+   ggpo_predict_runs(&_runs, (const unsigned char *)_history, _history_count,
+                     _input_size, frame - _history_frame, guess);
+   return memcmp(guess, bits, _input_size) == 0;
+}
+
+/*
+ * Empties the queue down to last, the final confirmed input before a
+ * rejoin, and carries on after it.  A frame delay is padded out with it right away, so the
+ * frames it covers can be sent before the first new input arrives.
+ */
+void
+InputQueue::StartAt(GameInput &last)
+{
+   ASSERT(last.frame >= 0 && last.size == _input_size);
+
+   Log("starting over after frame %d.\n", last.frame);
+   _tail = last.frame & INPUT_QUEUE_MASK;
+   _head = (_tail + 1) & INPUT_QUEUE_MASK;
+   _length = 1;
+   _first_frame = false;
+   _frames[_tail] = last.frame;
+   memcpy(EntryBits(_tail), last.bits, _input_size);
+   _last_added_frame = last.frame;
+   _last_user_added_frame = GameInput::NullFrame;
+   _prediction.frame = GameInput::NullFrame;
+   _first_incorrect_frame = GameInput::NullFrame;
+   _last_frame_requested = last.frame;    /* keeps DiscardConfirmedFrames behind the game */
+   _history_count = 0;
+   _history_frame = GameInput::NullFrame;
+   _runs.flips = 0;
+
+   for (int i = 0; i < _frame_delay; i++) {
+      AddDelayedInputToQueue(last.bits, last.frame + 1 + i);
+   }
+}
+
 int
-InputQueue::AdvanceQueueHead(int frame)
+InputQueue::AdvanceQueueHead(int frame, GameInput *padding)
 {
-   Log("advancing queue head to frame %d.\n", frame);
+   LogVerbose("advancing queue head to frame %d.\n", frame);
 
-   int expected_frame = _first_frame ? 0 : _inputs[PREVIOUS_FRAME(_head)].frame + 1;
+   if (padding) {
+      padding->frame = GameInput::NullFrame;
+   }
+
+   int expected_frame = _first_frame ? 0 : _frames[PREVIOUS_FRAME(_head)] + 1;
 
    frame += _frame_delay;
 
@@ -294,12 +437,14 @@ InputQueue::AdvanceQueueHead(int frame)
        */
       Log("Adding padding frame %d to account for change in frame delay.\n",
           expected_frame);
-      GameInput &last_frame = _inputs[PREVIOUS_FRAME(_head)];     
-      AddDelayedInputToQueue(last_frame, expected_frame);
+      if (padding && padding->frame == GameInput::NullFrame) {
+         padding->init(expected_frame, EntryBits(PREVIOUS_FRAME(_head)), _input_size);
+      }
+      AddDelayedInputToQueue(EntryBits(PREVIOUS_FRAME(_head)), expected_frame);
       expected_frame++;
    }
 
-   ASSERT(frame == 0 || frame == _inputs[PREVIOUS_FRAME(_head)].frame + 1);
+   ASSERT(frame == 0 || frame == _frames[PREVIOUS_FRAME(_head)] + 1);
    return frame;
 }
 
@@ -311,6 +456,9 @@ InputQueue::Log(const char *fmt, ...)
    size_t offset;
    va_list args;
 
+   if (!LogEnabled(GGPO_LOG_INFO)) {
+      return;
+   }
    offset = sprintf_s(buf, ARRAY_SIZE(buf), "input q%d | ", _id);
    va_start(args, fmt);
    vsnprintf(buf + offset, ARRAY_SIZE(buf) - offset - 1, fmt, args);
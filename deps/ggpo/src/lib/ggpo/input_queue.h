@@ -9,10 +9,14 @@
 #define _INPUT_QUEUE_H
 
 #include "game_input.h"
+#include "ggpo_predict.h"
 
 #define INPUT_QUEUE_LENGTH    128
+#define INPUT_QUEUE_MASK      (INPUT_QUEUE_LENGTH - 1)
 #define DEFAULT_INPUT_SIZE      4
 
+static_assert((INPUT_QUEUE_LENGTH & INPUT_QUEUE_MASK) == 0, "INPUT_QUEUE_LENGTH must be a power of two");
+
 class InputQueue {
 public:
    InputQueue(int input_size = DEFAULT_INPUT_SIZE);
@@ -25,15 +29,25 @@ public:
    int GetLength() { return _length; }
 
    void SetFrameDelay(int delay) { _frame_delay = delay; }
+   void SetPredictor(GGPOPredictModel model, int button_bytes);
+   int GetPredictedFrames() { return _predicted_frames; }
+   int GetMispredictedFrames() { return _mispredicted_frames; }
    void ResetPrediction(int frame);
    void DiscardConfirmedFrames(int frame);
    bool GetConfirmedInput(int frame, GameInput *input);
    bool GetInput(int frame, GameInput *input);
-   void AddInput(GameInput &input);
+   void AddInput(GameInput &input, GameInput *padding = NULL);
+   void StartAt(GameInput &last);
 
 protected:
-   int AdvanceQueueHead(int frame);
-   void AddDelayedInputToQueue(GameInput &input, int i);
+   int AdvanceQueueHead(int frame, GameInput *padding);
+   void AddDelayedInputToQueue(const char *bits, int i);
+   void StartPrediction();
+   void Predict(int frame, GameInput *input);
+   bool PredictionMatches(int frame, const char *bits);
+
+   char *EntryBits(int offset) { return _bits + offset * _input_size; }
+   void GetEntry(int offset, GameInput *input);
    void Log(const char *fmt, ...);
 
 protected:
@@ -50,8 +64,29 @@ protected:
 
    int                  _frame_delay;
 
-   GameInput            _inputs[INPUT_QUEUE_LENGTH];
+   /*
+    * The ring, packed: entry n's frame is _frames[n] and its input the
+    * _input_size bytes at EntryBits(n).
+    */
+   int                  _input_size;
+   int                  _frames[INPUT_QUEUE_LENGTH];
+   char                 _bits[INPUT_QUEUE_LENGTH * GAMEINPUT_MAX_BYTES];
    GameInput            _prediction;
+
+   /*
+    * Confirmed inputs the current prediction is based on, oldest first,
+    * ending at the frame before the first predicted one, and what the
+    * model made of them.
+    */
+   GGPOPredictModel     _model;
+   int                  _button_bytes;
+   int                  _history_count;
+   int                  _history_frame;
+   char                 _history[GGPO_PREDICT_HISTORY * GAMEINPUT_MAX_BYTES * GAMEINPUT_MAX_PLAYERS];
+   GGPOPredictRuns      _runs;
+
+   int                  _predicted_frames;
+   int                  _mispredicted_frames;
 };
 
 #endif
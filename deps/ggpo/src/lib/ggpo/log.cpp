@@ -6,8 +6,43 @@
  */
 
 #include "types.h"
+#include "thread_hook.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/* Power of two so the ring index can be masked. */
+#define TRACE_RING_SIZE       (1 << 14)
+/* How often the writer drains the ring. */
+#define TRACE_FLUSH_MS        50
+
+std::atomic<int> ggpo_log_level(GGPO_LOG_NONE);
+std::atomic<bool> ggpo_trace_enabled(false);
 
 static FILE *logfile = NULL;
+static bool log_timestamps = false;
+static bool log_flush = false;
+
+static std::mutex log_init_lock;
+static int log_sessions = 0;
+
+struct TraceSlot {
+   std::atomic<uint32> seq;
+   LogTraceRecord record;
+};
+
+static TraceSlot *trace_ring = NULL;
+static std::atomic<uint32> trace_head(0);
+static std::atomic<uint32> trace_tail(0);
+static std::atomic<uint32> trace_dropped(0);
+static std::atomic<unsigned int> trace_thread_ids(0);
+static FILE *tracefile = NULL;
+static std::thread trace_thread;
+static std::mutex trace_lock;
+static std::condition_variable trace_cv;
+static bool trace_shutdown = false;
 
 void LogFlush()
 {
@@ -16,11 +51,17 @@ void LogFlush()
    }
 }
 
-static char logbuf[4 * 1024 * 1024];
+void LogFlushOnLog(bool flush)
+{
+   log_flush = flush;
+}
 
 void Log(const char *fmt, ...)
 {
    va_list args;
+   if (!LogEnabled(GGPO_LOG_INFO)) {
+      return;
+   }
    va_start(args, fmt);
    Logv(fmt, args);
    va_end(args);
@@ -28,19 +69,23 @@ void Log(const char *fmt, ...)
 
 void Logv(const char *fmt, va_list args)
 {
-   if (!Platform::GetConfigBool("ggpo.log") || Platform::GetConfigBool("ggpo.log.ignore")) {
+   if (!LogEnabled(GGPO_LOG_INFO)) {
       return;
    }
    if (!logfile) {
-      sprintf_s(logbuf, ARRAY_SIZE(logbuf), "log-%d.log", Platform::GetProcessID());
-      fopen_s(&logfile, logbuf, "w");
+      char filename[64];
+      sprintf_s(filename, ARRAY_SIZE(filename), "log-%d.log", Platform::GetProcessID());
+      fopen_s(&logfile, filename, "w");
+      if (!logfile) {
+         return;
+      }
    }
    Logv(logfile, fmt, args);
 }
 
 void Logv(FILE *fp, const char *fmt, va_list args)
 {
-   if (Platform::GetConfigBool("ggpo.log.timestamps")) {
+   if (log_timestamps) {
       static int start = 0;
       int t = 0;
       if (!start) {
@@ -55,10 +100,174 @@ void Logv(FILE *fp, const char *fmt, va_list args)
    va_copy(args_copy, args);
    vfprintf(fp, fmt, args_copy);
    va_end(args_copy);
-   fflush(fp);
-   
-   va_copy(args_copy, args);
-   vsprintf_s(logbuf, ARRAY_SIZE(logbuf), fmt, args_copy);
-   va_end(args_copy);
+   if (log_flush) {
+      fflush(fp);
+   }
+}
+
+/*
+ * Writers claim a slot by advancing the tail only while the ring has
+ * room, then publish it by storing its sequence number.  The writer
+ * thread consumes slots in order up to the first unpublished one, so a
+ * slot is never overwritten before it has been written out.
+ */
+void LogTraceWrite(LogTraceEvent event, int frame, int a, int b, int c)
+{
+   static thread_local unsigned int thread_id = 0;
+   uint32 tail = trace_tail.load(std::memory_order_relaxed);
+   TraceSlot *slot;
+
+   do {
+      if (tail - trace_head.load(std::memory_order_acquire) >= TRACE_RING_SIZE) {
+         trace_dropped.fetch_add(1, std::memory_order_relaxed);
+         return;
+      }
+   } while (!trace_tail.compare_exchange_weak(tail, tail + 1,
+                                              std::memory_order_relaxed,
+                                              std::memory_order_relaxed));
+
+   if (!thread_id) {
+      thread_id = trace_thread_ids.fetch_add(1, std::memory_order_relaxed) + 1;
+   }
+
+   slot = &trace_ring[tail & (TRACE_RING_SIZE - 1)];
+   slot->record.time_ms = Platform::GetCurrentTimeMS();
+   slot->record.frame = frame;
+   slot->record.a = a;
+   slot->record.b = b;
+   slot->record.c = c;
+   slot->record.event = (uint16)event;
+   slot->record.thread = (uint16)thread_id;
+   slot->seq.store(tail + 1, std::memory_order_release);
+}
+
+static void
+TraceDrain()
+{
+   LogTraceRecord batch[256];
+   uint32 head = trace_head.load(std::memory_order_relaxed);
+
+   for (;;) {
+      int count = 0;
+      uint32 dropped = trace_dropped.exchange(0, std::memory_order_relaxed);
+
+      if (dropped) {
+         memset(&batch[0], 0, sizeof(batch[0]));
+         batch[0].time_ms = Platform::GetCurrentTimeMS();
+         batch[0].event = TRACE_DROPPED;
+         batch[0].a = (int32)dropped;
+         count++;
+      }
+
+      while (count < (int)ARRAY_SIZE(batch)) {
+         TraceSlot *slot = &trace_ring[head & (TRACE_RING_SIZE - 1)];
+         if (slot->seq.load(std::memory_order_acquire) != head + 1) {
+            break;
+         }
+         batch[count++] = slot->record;
+         head++;
+      }
+      trace_head.store(head, std::memory_order_release);
+
+      if (!count) {
+         break;
+      }
+      fwrite(batch, sizeof(batch[0]), count, tracefile);
+   }
+   fflush(tracefile);
+}
+
+static void
+TraceThreadMain()
+{
+   ThreadHookScope hook("ggpo_trace");
+   std::unique_lock<std::mutex> lock(trace_lock);
+   while (!trace_shutdown) {
+      trace_cv.wait_for(lock, std::chrono::milliseconds(TRACE_FLUSH_MS));
+      lock.unlock();
+      TraceDrain();
+      lock.lock();
+   }
 }
 
+static void
+TraceStart()
+{
+   char filename[64];
+   uint32 i;
+
+   sprintf_s(filename, ARRAY_SIZE(filename), "trace-%d.bin", Platform::GetProcessID());
+   fopen_s(&tracefile, filename, "wb");
+   if (!tracefile) {
+      Log("Could not open %s for tracing.\n", filename);
+      return;
+   }
+   fwrite("GGPOTRC1", 1, 8, tracefile);
+
+   trace_ring = new TraceSlot[TRACE_RING_SIZE];
+   for (i = 0; i < TRACE_RING_SIZE; i++) {
+      trace_ring[i].seq.store(0, std::memory_order_relaxed);
+   }
+   trace_head.store(0, std::memory_order_relaxed);
+   trace_tail.store(0, std::memory_order_relaxed);
+   trace_dropped.store(0, std::memory_order_relaxed);
+   trace_shutdown = false;
+   trace_thread = std::thread(TraceThreadMain);
+   ggpo_trace_enabled.store(true, std::memory_order_release);
+}
+
+/*
+ * Only called once every session is closed, so nothing is still
+ * writing by the time the ring is freed.
+ */
+static void
+TraceStop()
+{
+   ggpo_trace_enabled.store(false, std::memory_order_release);
+   {
+      std::lock_guard<std::mutex> lock(trace_lock);
+      trace_shutdown = true;
+   }
+   trace_cv.notify_one();
+   trace_thread.join();
+   TraceDrain();
+
+   fclose(tracefile);
+   tracefile = NULL;
+   delete [] trace_ring;
+   trace_ring = NULL;
+}
+
+void LogInit()
+{
+   std::lock_guard<std::mutex> lock(log_init_lock);
+   int level = Platform::GetConfigInt("ggpo.log");
+
+   if (!level && Platform::GetConfigBool("ggpo.log")) {
+      level = GGPO_LOG_INFO;
+   }
+   if (Platform::GetConfigBool("ggpo.log.ignore")) {
+      level = GGPO_LOG_NONE;
+   }
+   log_timestamps = Platform::GetConfigBool("ggpo.log.timestamps");
+   log_flush = Platform::GetConfigBool("ggpo.log.flush");
+   ggpo_log_level.store(MIN(MAX(level, GGPO_LOG_NONE), GGPO_LOG_VERBOSE),
+                        std::memory_order_relaxed);
+
+   if (!log_sessions++ && Platform::GetConfigBool("ggpo.trace")) {
+      TraceStart();
+   }
+}
+
+void LogShutdown()
+{
+   std::lock_guard<std::mutex> lock(log_init_lock);
+
+   if (!log_sessions || --log_sessions) {
+      return;
+   }
+   if (tracefile) {
+      TraceStop();
+   }
+   LogFlush();
+}
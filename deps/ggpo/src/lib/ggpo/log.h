@@ -8,10 +8,93 @@
 #ifndef _LOG_H
 #define _LOG_H
 
+#include <atomic>
+
+/*
+ * Log levels.  ggpo.log picks the level at runtime (1 or "true" for info,
+ * 2 for verbose); it is read once by LogInit when a session starts, so a
+ * disabled Log call costs one compare.  Verbose logs are the per-frame
+ * ones and are compiled out entirely, arguments included, unless the
+ * library is built with GGPO_LOG_MAX_LEVEL=2.
+ */
+#define GGPO_LOG_NONE      0
+#define GGPO_LOG_INFO      1
+#define GGPO_LOG_VERBOSE   2
+
+#ifndef GGPO_LOG_MAX_LEVEL
+#  define GGPO_LOG_MAX_LEVEL GGPO_LOG_INFO
+#endif
+
+extern std::atomic<int> ggpo_log_level;
+extern std::atomic<bool> ggpo_trace_enabled;
+
+#define LogEnabled(level) \
+   ((level) <= GGPO_LOG_MAX_LEVEL && \
+    (level) <= ggpo_log_level.load(std::memory_order_relaxed))
+
+/* Resolves to the class's own Log when used inside one. */
+#define LogVerbose(...)                                     \
+   do {                                                     \
+      if (LogEnabled(GGPO_LOG_VERBOSE)) {                   \
+         Log(__VA_ARGS__);                                  \
+      }                                                     \
+   } while (false)
+
 extern void Log(const char *fmt, ...);
 extern void Logv(const char *fmt, va_list list);
 extern void Logv(FILE *fp, const char *fmt, va_list args);
 extern void LogFlush();
 extern void LogFlushOnLog(bool flush);
 
+/*
+ * Reads the logging config and, with ggpo.trace set, starts the trace
+ * writer.  Called by every ggpo_start_* and balanced by LogShutdown in
+ * ggpo_close_session; the writer runs while any session is open.
+ */
+extern void LogInit();
+extern void LogShutdown();
+
+/*
+ * Binary event trace.  LogTrace claims a slot in a fixed ring without
+ * taking a lock, from any thread; a background thread appends the ring
+ * to trace-<pid>.bin.  Records are dropped, and counted, while the ring
+ * is full.
+ *
+ * The file is an 8 byte "GGPOTRC1" magic followed by LogTraceRecords in
+ * host byte order.  When records were dropped, a TRACE_DROPPED record
+ * carrying the count precedes the next ones written.
+ */
+enum LogTraceEvent {
+   TRACE_DROPPED = 0,         /* a = records lost */
+   TRACE_SAVE_FRAME,          /* a = size, b = compressed size, c = checksum */
+   TRACE_LOAD_FRAME,          /* a = size, b = checksum */
+   TRACE_ROLLBACK,            /* a = frames resimulated, b = load us, c = resim us */
+   TRACE_LOCAL_INPUT,         /* a = queue */
+   TRACE_REMOTE_INPUT,        /* a = queue */
+   TRACE_PREDICTION_ERROR,    /* a = queue, b = first incorrect frame */
+   TRACE_CONFIRMED_FRAME,     /* frame = last confirmed frame */
+   TRACE_END_OF_FRAME,
+   TRACE_EVENT_COUNT
+};
+
+struct LogTraceRecord {
+   uint32   time_ms;
+   int32    frame;
+   int32    a;
+   int32    b;
+   int32    c;
+   uint16   event;
+   uint16   thread;
+};
+
+extern void LogTraceWrite(LogTraceEvent event, int frame, int a, int b, int c);
+
+static inline void
+LogTrace(LogTraceEvent event, int frame, int a = 0, int b = 0, int c = 0)
+{
+   if (ggpo_trace_enabled.load(std::memory_order_acquire)) {
+      LogTraceWrite(event, frame, a, b, c);
+   }
+}
+
 #endif
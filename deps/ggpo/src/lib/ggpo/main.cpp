@@ -9,6 +9,9 @@
 #include "backends/p2p.h"
 #include "backends/synctest.h"
 #include "backends/spectator.h"
+#include "network/relay_transport.h"
+#include "network/transport_hub.h"
+#include "thread_hook.h"
 #include "ggponet.h"
 
 static void SeedRandOnce()
@@ -54,10 +57,175 @@ ggpo_start_session(GGPOSession **session,
                    int input_size,
                    unsigned short localport)
 {
+   Transport::Config transport;
+
+   SeedRandOnce();
+   LogInit();
+   Transport::DefaultConfig(&transport, localport);
+   *session= (GGPOSession *)new Peer2PeerBackend(cb,
+                                                 game,
+                                                 transport,
+                                                 num_players,
+                                                 input_size);
+   return GGPO_OK;
+}
+
+GGPOErrorCode
+ggpo_start_relay_session(GGPOSession **session,
+                         GGPOSessionCallbacks *cb,
+                         const char *game,
+                         int num_players,
+                         int input_size,
+                         unsigned short localport,
+                         const char *relay_ip,
+                         unsigned short relay_port,
+                         const char *session_id,
+                         int slot)
+{
+   Transport::Config transport;
+
+   if (!relay_ip || !session_id || num_players != 2 ||
+       strlen(session_id) == 0 || strlen(session_id) > RELAY_MUX_MAX_SESSION ||
+       (slot != 1 && slot != 2)) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
+   SeedRandOnce();
+   LogInit();
+   Transport::DefaultConfig(&transport, localport);
+   transport.kind = Transport::Relay;
+   transport.relay_ip = relay_ip;
+   transport.relay_port = relay_port;
+   transport.session = session_id;
+   transport.slot = slot;
+   *session= (GGPOSession *)new Peer2PeerBackend(cb,
+                                                 game,
+                                                 transport,
+                                                 num_players,
+                                                 input_size);
+   return GGPO_OK;
+}
+
+GGPOErrorCode
+ggpo_start_tunnel_session(GGPOSession **session,
+                          GGPOSessionCallbacks *cb,
+                          const char *game,
+                          int num_players,
+                          int input_size)
+{
+   Transport::Config transport;
+
+   if (num_players != 2) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
+   SeedRandOnce();
+   LogInit();
+   Transport::DefaultConfig(&transport, 0);
+   transport.kind = Transport::Tunnel;
+   *session= (GGPOSession *)new Peer2PeerBackend(cb,
+                                                 game,
+                                                 transport,
+                                                 num_players,
+                                                 input_size);
+   return GGPO_OK;
+}
+
+GGPOErrorCode
+ggpo_tunnel_read(GGPOSession *ggpo, void *buffer, int *len)
+{
+   if (!ggpo) {
+      return GGPO_ERRORCODE_INVALID_SESSION;
+   }
+   if (!buffer || !len || *len <= 0) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
+   return ggpo->TunnelRead(buffer, len);
+}
+
+GGPOErrorCode
+ggpo_tunnel_write(GGPOSession *ggpo, const void *data, int len)
+{
+   if (!ggpo) {
+      return GGPO_ERRORCODE_INVALID_SESSION;
+   }
+   if (!data || len <= 0 || len > GGPO_TUNNEL_MAX_PACKET) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
+   return ggpo->TunnelWrite(data, len);
+}
+
+GGPOErrorCode
+ggpo_create_hub(GGPOHub **hub, unsigned short port)
+{
+   TransportHub *h;
+
+   if (!hub) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
+   SeedRandOnce();
+   LogInit();
+   h = new TransportHub();
+   if (!h->Init(port)) {
+      delete h;
+      LogShutdown();
+      return GGPO_ERRORCODE_GENERAL_FAILURE;
+   }
+   *hub = (GGPOHub *)h;
+   return GGPO_OK;
+}
+
+GGPOErrorCode
+ggpo_destroy_hub(GGPOHub *hub)
+{
+   TransportHub *h = (TransportHub *)hub;
+
+   if (!h || h->GetChannelCount() > 0) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
+   delete h;
+   LogShutdown();
+   return GGPO_OK;
+}
+
+GGPOErrorCode
+ggpo_get_hub_stats(GGPOHub *hub, GGPOHubStats *stats)
+{
+   TransportHub::Stats s;
+
+   if (!hub || !stats) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
+   ((TransportHub *)hub)->GetStats(&s);
+   stats->sessions = s.sessions;
+   stats->packets_received = s.packets_received;
+   stats->bytes_received = s.bytes_received;
+   stats->packets_sent = s.packets_sent;
+   stats->bytes_sent = s.bytes_sent;
+   stats->unrouted = s.unrouted;
+   stats->syscalls = s.syscalls;
+   return GGPO_OK;
+}
+
+GGPOErrorCode
+ggpo_start_hub_session(GGPOSession **session,
+                       GGPOHub *hub,
+                       GGPOSessionCallbacks *cb,
+                       const char *game,
+                       int num_players,
+                       int input_size)
+{
+   Transport::Config transport;
+
+   if (!hub) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
    SeedRandOnce();
+   LogInit();
+   Transport::DefaultConfig(&transport, 0);
+   transport.kind = Transport::Socket;
+   transport.hub = (TransportHub *)hub;
    *session= (GGPOSession *)new Peer2PeerBackend(cb,
                                                  game,
-                                                 localport,
+                                                 transport,
                                                  num_players,
                                                  input_size);
    return GGPO_OK;
@@ -84,7 +252,11 @@ ggpo_start_synctest(GGPOSession **ggpo,
                     int input_size,
                     int frames)
 {
+   if (frames < 1 || frames > GGPO_SYNCTEST_MAX_FRAMES) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
    SeedRandOnce();
+   LogInit();
    *ggpo = (GGPOSession *)new SyncTestBackend(cb, game, frames, num_players);
    return GGPO_OK;
 }
@@ -180,6 +352,112 @@ ggpo_get_state_stats(GGPOSession *ggpo, GGPOStateStats *stats)
    return ggpo->GetStateStats(stats);
 }
 
+GGPOErrorCode
+ggpo_get_rollback_stats(GGPOSession *ggpo, GGPORollbackStats *stats)
+{
+   if (!ggpo) {
+      return GGPO_ERRORCODE_INVALID_SESSION;
+   }
+   if (!stats) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
+   return ggpo->GetRollbackStats(stats);
+}
+
+GGPOErrorCode
+ggpo_set_timesync_mode(GGPOSession *ggpo, int mode, int max_slew_permille)
+{
+   if (!ggpo) {
+      return GGPO_ERRORCODE_INVALID_SESSION;
+   }
+   if ((mode != GGPO_TIMESYNC_STALL && mode != GGPO_TIMESYNC_SLEW) ||
+       max_slew_permille < 0 || max_slew_permille > GGPO_TIMESYNC_MAX_SLEW) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
+   return ggpo->SetTimeSyncMode(mode, max_slew_permille);
+}
+
+GGPOErrorCode
+ggpo_get_timesync_stats(GGPOSession *ggpo, GGPOTimeSyncStats *stats)
+{
+   if (!ggpo) {
+      return GGPO_ERRORCODE_INVALID_SESSION;
+   }
+   if (!stats) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
+   return ggpo->GetTimeSyncStats(stats);
+}
+
+GGPOErrorCode
+ggpo_start_relay_broadcast(GGPOSession *ggpo,
+                           const char *relay_ip,
+                           unsigned short relay_port,
+                           const char *session_id)
+{
+   if (!ggpo) {
+      return GGPO_ERRORCODE_INVALID_SESSION;
+   }
+   if (!relay_ip || !session_id) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
+   return ggpo->StartRelayBroadcast(relay_ip, relay_port, session_id);
+}
+
+GGPOErrorCode
+ggpo_get_checksum_state(GGPOSession *ggpo, int frame, void *buffer, int *size)
+{
+   if (!ggpo) {
+      return GGPO_ERRORCODE_INVALID_SESSION;
+   }
+   if (!size || (buffer && *size <= 0)) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
+   return ggpo->GetChecksumState(frame, buffer, size);
+}
+
+GGPOErrorCode
+ggpo_set_state_buffer_capacity(GGPOSession *ggpo, int capacity)
+{
+   if (!ggpo) {
+      return GGPO_ERRORCODE_INVALID_SESSION;
+   }
+   if (capacity < 0) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
+   return ggpo->SetStateBufferCapacity(capacity);
+}
+
+GGPOErrorCode
+ggpo_hint_state_changes(GGPOSession *ggpo, const GGPOStateRange *ranges, int count)
+{
+   if (!ggpo) {
+      return GGPO_ERRORCODE_INVALID_SESSION;
+   }
+   if (count < 0 || (count > 0 && !ranges)) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
+   return ggpo->HintStateChanges(ranges, count);
+}
+
+void
+ggpo_set_thread_hook(GGPOThreadHook hook)
+{
+   ThreadHookScope::Set(hook);
+}
+
+GGPOErrorCode
+ggpo_set_state_regions(GGPOSession *ggpo, const GGPOStateRegion *regions, int count)
+{
+   if (!ggpo) {
+      return GGPO_ERRORCODE_INVALID_SESSION;
+   }
+   if (count < 0 || (count > 0 && !regions)) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
+   return ggpo->SetStateRegions(regions, count);
+}
+
 
 GGPOErrorCode
 ggpo_close_session(GGPOSession *ggpo)
@@ -188,6 +466,7 @@ ggpo_close_session(GGPOSession *ggpo)
       return GGPO_ERRORCODE_INVALID_SESSION;
    }
    delete ggpo;
+   LogShutdown();
    return GGPO_OK;
 }
 
@@ -209,6 +488,36 @@ ggpo_set_disconnect_notify_start(GGPOSession *ggpo, int timeout)
    return ggpo->SetDisconnectNotifyStart(timeout);
 }
 
+GGPOErrorCode
+ggpo_set_reconnect_window(GGPOSession *ggpo, int window)
+{
+   if (!ggpo) {
+      return GGPO_ERRORCODE_INVALID_SESSION;
+   }
+   return ggpo->SetReconnectWindow(window);
+}
+
+GGPOErrorCode
+ggpo_rejoin_session(GGPOSession *ggpo)
+{
+   if (!ggpo) {
+      return GGPO_ERRORCODE_INVALID_SESSION;
+   }
+   return ggpo->Rejoin();
+}
+
+GGPOErrorCode
+ggpo_send_control(GGPOSession *ggpo,
+                  GGPOPlayerHandle player,
+                  const void *data,
+                  int size)
+{
+   if (!ggpo) {
+      return GGPO_ERRORCODE_INVALID_SESSION;
+   }
+   return ggpo->SendControl(player, data, size);
+}
+
 GGPOErrorCode ggpo_start_spectating(GGPOSession **session,
                                     GGPOSessionCallbacks *cb,
                                     const char *game,
@@ -218,10 +527,14 @@ GGPOErrorCode ggpo_start_spectating(GGPOSession **session,
                                     char *host_ip,
                                     unsigned short host_port)
 {
+   Transport::Config transport;
+
    SeedRandOnce();
+   LogInit();
+   Transport::DefaultConfig(&transport, local_port);
    *session= (GGPOSession *)new SpectatorBackend(cb,
                                                  game,
-                                                 local_port,
+                                                 transport,
                                                  num_players,
                                                  input_size,
                                                  host_ip,
@@ -229,3 +542,63 @@ GGPOErrorCode ggpo_start_spectating(GGPOSession **session,
    return GGPO_OK;
 }
 
+GGPOErrorCode ggpo_start_hub_spectating(GGPOSession **session,
+                                        GGPOHub *hub,
+                                        GGPOSessionCallbacks *cb,
+                                        const char *game,
+                                        int num_players,
+                                        int input_size,
+                                        char *host_ip,
+                                        unsigned short host_port)
+{
+   Transport::Config transport;
+
+   if (!hub) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
+   SeedRandOnce();
+   LogInit();
+   Transport::DefaultConfig(&transport, 0);
+   transport.kind = Transport::Socket;
+   transport.hub = (TransportHub *)hub;
+   *session= (GGPOSession *)new SpectatorBackend(cb,
+                                                 game,
+                                                 transport,
+                                                 num_players,
+                                                 input_size,
+                                                 host_ip,
+                                                 host_port);
+   return GGPO_OK;
+}
+
+GGPOErrorCode ggpo_start_relay_spectating(GGPOSession **session,
+                                          GGPOSessionCallbacks *cb,
+                                          const char *game,
+                                          int num_players,
+                                          int input_size,
+                                          unsigned short local_port,
+                                          const char *relay_ip,
+                                          unsigned short relay_port,
+                                          const char *session_id)
+{
+   Transport::Config transport;
+
+   if (!relay_ip || !session_id ||
+       strlen(session_id) == 0 || strlen(session_id) > RELAY_BCAST_MAX_SESSION ||
+       num_players * input_size > GAMEINPUT_MAX_BYTES * GAMEINPUT_MAX_PLAYERS) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
+   SeedRandOnce();
+   LogInit();
+   Transport::DefaultConfig(&transport, local_port);
+   *session= (GGPOSession *)new SpectatorBackend(cb,
+                                                 game,
+                                                 transport,
+                                                 num_players,
+                                                 input_size,
+                                                 relay_ip,
+                                                 relay_port,
+                                                 session_id);
+   return GGPO_OK;
+}
+
@@ -0,0 +1,467 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#include "types.h"
+#include "input_codec.h"
+#include "bitvector.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static inline uint32 LoadLE32(const uint8 *ptr)
+{
+   return (uint32)ptr[0]
+      | ((uint32)ptr[1] << 8)
+      | ((uint32)ptr[2] << 16)
+      | ((uint32)ptr[3] << 24);
+}
+
+static inline int Popcount32(uint32 value)
+{
+#if defined(_MSC_VER)
+   return (int)__popcnt(value);
+#elif defined(__GNUC__) || defined(__clang__)
+   return __builtin_popcount(value);
+#else
+   int count = 0;
+   while (value) {
+      value &= (value - 1);
+      count++;
+   }
+   return count;
+#endif
+}
+
+static inline int Ctz32(uint32 value)
+{
+#if defined(_MSC_VER)
+   unsigned long index = 0;
+   _BitScanForward(&index, value);
+   return (int)index;
+#elif defined(__GNUC__) || defined(__clang__)
+   return __builtin_ctz(value);
+#else
+   int count = 0;
+   while ((value & 1) == 0) {
+      value >>= 1;
+      count++;
+   }
+   return count;
+#endif
+}
+
+/* Number of significant bits in value; 0 for 0. */
+static inline int BitLength(uint32 value)
+{
+   int length = 0;
+   while (value) {
+      value >>= 1;
+      length++;
+   }
+   return length;
+}
+
+static inline int GetBitValue(const uint8 *bits, int index)
+{
+   return (bits[index / 8] & (1 << (index % 8))) != 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/*
+ * The original GGPO encoding: for each bit that changed, a 1, the new value
+ * and the index of the bit, then a 0 to end the frame.  Indexes are
+ * BITVECTOR_NIBBLE_SIZE bits, or as many more as an input of more than 32
+ * bytes (a 4-player spectator stream) needs; smaller inputs code exactly
+ * as they always have.
+ */
+class BitVectorInputCodec : public InputCodec {
+public:
+   virtual InputCodecId Id() const { return INPUT_CODEC_BITVECTOR; }
+   virtual const char *Name() const { return "bitvector"; }
+
+   virtual int FrameBits(const InputCodecState &state,
+                         const GameInput &current, const GameInput &last) const {
+      return 1 + CountDiffBits(current, last) * (2 + IndexBits(current.size));
+   }
+
+   virtual void EncodeFrame(InputCodecState &state, uint8 *bits, int *offset,
+                            const GameInput &current, const GameInput &last) const {
+      EmitDiffBits(bits, offset, current, last);
+      BitVector_ClearBit(bits, offset);
+   }
+
+   virtual bool DecodeFrame(InputCodecState &state, uint8 *bits, int *offset, int num_bits,
+                            int size, GameInput *target) const {
+      for (;;) {
+         if (*offset >= num_bits) {
+            return false;
+         }
+         if (!BitVector_ReadBit(bits, offset)) {
+            return true;
+         }
+         if (*offset + 1 + IndexBits(size) > num_bits) {
+            return false;
+         }
+         int on = BitVector_ReadBit(bits, offset);
+         int button = BitVector_ReadNibblet(bits, offset, IndexBits(size));
+         if (button >= size * 8) {
+            return false;
+         }
+         if (target) {
+            if (on) {
+               target->set(button);
+            } else {
+               target->clear(button);
+            }
+         }
+      }
+   }
+
+protected:
+   static int IndexBits(int size) { return MAX(BITVECTOR_NIBBLE_SIZE, BitLength(size * 8 - 1)); }
+
+   static int CountDiffBits(const GameInput &current, const GameInput &last) {
+      const uint8 *cur = (const uint8 *)current.bits;
+      const uint8 *prev = (const uint8 *)last.bits;
+      int byte_len = current.size;
+      int full_words = byte_len / 4;
+      int count = 0;
+
+      for (int i = 0; i < full_words; ++i) {
+         uint32 diff = LoadLE32(cur + (i * 4)) ^ LoadLE32(prev + (i * 4));
+         if (diff) {
+            count += Popcount32(diff);
+         }
+      }
+
+      int tail = byte_len - (full_words * 4);
+      if (tail > 0) {
+         uint32 cur_tail = 0;
+         uint32 prev_tail = 0;
+         const uint8 *cur_ptr = cur + (full_words * 4);
+         const uint8 *prev_ptr = prev + (full_words * 4);
+         for (int i = 0; i < tail; ++i) {
+            cur_tail |= ((uint32)cur_ptr[i]) << (8 * i);
+            prev_tail |= ((uint32)prev_ptr[i]) << (8 * i);
+         }
+         uint32 diff = cur_tail ^ prev_tail;
+         if (diff) {
+            count += Popcount32(diff);
+         }
+      }
+
+      return count;
+   }
+
+   static void EmitChanges(uint8 *vector, int *offset, const uint8 *cur, uint32 diff, int bit_base,
+                           int index_bits) {
+      while (diff) {
+         int bit = Ctz32(diff);
+         int index = bit_base + bit;
+         BitVector_SetBit(vector, offset);
+         if (GetBitValue(cur, index)) {
+            BitVector_SetBit(vector, offset);
+         } else {
+            BitVector_ClearBit(vector, offset);
+         }
+         BitVector_WriteNibblet(vector, index, offset, index_bits);
+         diff &= (diff - 1);
+      }
+   }
+
+   static void EmitDiffBits(uint8 *vector, int *offset, const GameInput &current, const GameInput &last) {
+      const uint8 *cur = (const uint8 *)current.bits;
+      const uint8 *prev = (const uint8 *)last.bits;
+      int byte_len = current.size;
+      int full_words = byte_len / 4;
+      int bit_base = 0;
+      int index_bits = IndexBits(byte_len);
+
+      for (int i = 0; i < full_words; ++i) {
+         EmitChanges(vector, offset, cur, LoadLE32(cur + (i * 4)) ^ LoadLE32(prev + (i * 4)), bit_base,
+                     index_bits);
+         bit_base += 32;
+      }
+
+      int tail = byte_len - (full_words * 4);
+      if (tail > 0) {
+         uint32 cur_tail = 0;
+         uint32 prev_tail = 0;
+         const uint8 *cur_ptr = cur + (full_words * 4);
+         const uint8 *prev_ptr = prev + (full_words * 4);
+         for (int i = 0; i < tail; ++i) {
+            cur_tail |= ((uint32)cur_ptr[i]) << (8 * i);
+            prev_tail |= ((uint32)prev_ptr[i]) << (8 * i);
+         }
+         EmitChanges(vector, offset, cur, cur_tail ^ prev_tail, bit_base, index_bits);
+      }
+   }
+};
+
+/* ----------------------------------------------------------------------- */
+
+/*
+ * Splits the input into little-endian 16-bit fields (a trailing odd byte is
+ * an 8-bit field), which lines up with the frontend's layout of a button
+ * word followed by packed analog axes.  A frame is:
+ *
+ *   1 bit    any field changed
+ *   n bits   changed flag per field
+ *   per changed field, 1 mode bit and then either
+ *     xor:   gamma(count of flipped bits), then each bit index (4 or 3 bits)
+ *     delta: signed change, zigzagged, as Exp-Golomb with an order that
+ *            follows the field's recent magnitudes
+ *
+ * The encoder picks whichever mode is shorter, so button fields stay cheap
+ * while sticks and pointers cost a few bits per axis instead of one index
+ * per toggled bit.
+ */
+class FieldInputCodec : public InputCodec {
+public:
+   virtual InputCodecId Id() const { return INPUT_CODEC_FIELD; }
+   virtual const char *Name() const { return "field"; }
+
+   virtual int FrameBits(const InputCodecState &state,
+                         const GameInput &current, const GameInput &last) const {
+      int fields = FieldCount(current.size);
+      int total = 1;
+      bool changed = false;
+
+      for (int i = 0; i < fields; i++) {
+         uint32 cur = GetField(current, i), prev = GetField(last, i);
+         if (cur != prev) {
+            int width = FieldWidth(current.size, i);
+            changed = true;
+            total += 1 + MIN(XorBits(cur ^ prev, width),
+                             DeltaBits(ZigZag(cur, prev, width), Order(state, i)));
+         }
+      }
+      return changed ? total + fields : total;
+   }
+
+   virtual void EncodeFrame(InputCodecState &state, uint8 *bits, int *offset,
+                            const GameInput &current, const GameInput &last) const {
+      int fields = FieldCount(current.size);
+      uint32 diff_mask = 0;
+
+      for (int i = 0; i < fields; i++) {
+         if (GetField(current, i) != GetField(last, i)) {
+            diff_mask |= 1u << i;
+         }
+      }
+      if (!diff_mask) {
+         BitVector_ClearBit(bits, offset);
+         return;
+      }
+      BitVector_SetBit(bits, offset);
+      for (int i = 0; i < fields; i++) {
+         WriteBits(bits, offset, (diff_mask >> i) & 1, 1);
+      }
+      for (int i = 0; i < fields; i++) {
+         if (!(diff_mask & (1u << i))) {
+            continue;
+         }
+         uint32 cur = GetField(current, i), prev = GetField(last, i);
+         int width = FieldWidth(current.size, i);
+         uint32 zz = ZigZag(cur, prev, width);
+         int order = Order(state, i);
+
+         if (XorBits(cur ^ prev, width) <= DeltaBits(zz, order)) {
+            uint32 flipped = cur ^ prev;
+            BitVector_ClearBit(bits, offset);
+            WriteGamma(bits, offset, Popcount32(flipped));
+            while (flipped) {
+               WriteBits(bits, offset, Ctz32(flipped), IndexBits(width));
+               flipped &= flipped - 1;
+            }
+         } else {
+            BitVector_SetBit(bits, offset);
+            WriteExpGolomb(bits, offset, zz - 1, order);
+            Adapt(state, i, zz);
+         }
+      }
+   }
+
+   virtual bool DecodeFrame(InputCodecState &state, uint8 *bits, int *offset, int num_bits,
+                            int size, GameInput *target) const {
+      int fields = FieldCount(size);
+      uint32 diff_mask = 0, value;
+
+      if (*offset >= num_bits) {
+         return false;
+      }
+      if (!BitVector_ReadBit(bits, offset)) {
+         return true;
+      }
+      for (int i = 0; i < fields; i++) {
+         if (!ReadBits(bits, offset, num_bits, 1, &value)) {
+            return false;
+         }
+         diff_mask |= value << i;
+      }
+      if (!diff_mask) {
+         return false;
+      }
+      for (int i = 0; i < fields; i++) {
+         if (!(diff_mask & (1u << i))) {
+            continue;
+         }
+         int width = FieldWidth(size, i);
+         uint32 mode, field = target ? GetField(*target, i) : 0;
+
+         if (!ReadBits(bits, offset, num_bits, 1, &mode)) {
+            return false;
+         }
+         if (!mode) {
+            uint32 count;
+            if (!ReadGamma(bits, offset, num_bits, &count) || count > (uint32)width) {
+               return false;
+            }
+            for (uint32 j = 0; j < count; j++) {
+               if (!ReadBits(bits, offset, num_bits, IndexBits(width), &value) || (int)value >= width) {
+                  return false;
+               }
+               field ^= 1u << value;
+            }
+         } else {
+            if (!ReadExpGolomb(bits, offset, num_bits, Order(state, i), &value) ||
+                value >= (1u << width) - 1) {
+               return false;
+            }
+            uint32 zz = value + 1;
+            int delta = (int)(zz >> 1) ^ -(int)(zz & 1);
+            field = (uint32)((int)field + delta) & ((1u << width) - 1);
+            Adapt(state, i, zz);
+         }
+         if (target) {
+            SetField(*target, i, field);
+         }
+      }
+      return true;
+   }
+
+protected:
+   static int FieldCount(int size) { return MIN((size + 1) / 2, INPUT_CODEC_MAX_FIELDS); }
+   static int FieldWidth(int size, int i) { return (2 * i + 1 < size) ? 16 : 8; }
+   static int IndexBits(int width) { return width == 16 ? 4 : 3; }
+
+   static uint32 GetField(const GameInput &input, int i) {
+      const uint8 *p = (const uint8 *)input.bits + 2 * i;
+      return (2 * i + 1 < input.size) ? ((uint32)p[0] | ((uint32)p[1] << 8)) : p[0];
+   }
+
+   static void SetField(GameInput &input, int i, uint32 value) {
+      uint8 *p = (uint8 *)input.bits + 2 * i;
+      p[0] = (uint8)value;
+      if (2 * i + 1 < input.size) {
+         p[1] = (uint8)(value >> 8);
+      }
+   }
+
+   /* Signed change from prev to cur wrapped to the field width, zigzagged; never 0 here. */
+   static uint32 ZigZag(uint32 cur, uint32 prev, int width) {
+      int shift = 32 - width;
+      int delta = (int)((cur - prev) << shift) >> shift;
+      return ((uint32)delta << 1) ^ (uint32)(delta >> 31);
+   }
+
+   static int Order(const InputCodecState &state, int i) {
+      return MIN(MAX(BitLength(state.magnitude[i]) - 1, 0), 14);
+   }
+
+   static void Adapt(InputCodecState &state, int i, uint32 zz) {
+      state.magnitude[i] = (state.magnitude[i] * 3 + zz) / 4;
+   }
+
+   static int GammaBits(uint32 value) { return 2 * BitLength(value) - 1; }
+
+   static int XorBits(uint32 flipped, int width) {
+      int count = Popcount32(flipped);
+      return GammaBits(count) + count * IndexBits(width);
+   }
+
+   static int DeltaBits(uint32 zz, int order) {
+      return GammaBits(((zz - 1) >> order) + 1) + order;
+   }
+
+   static void WriteBits(uint8 *bits, int *offset, uint32 value, int count) {
+      for (int i = count - 1; i >= 0; i--) {
+         if (value & (1u << i)) {
+            BitVector_SetBit(bits, offset);
+         } else {
+            BitVector_ClearBit(bits, offset);
+         }
+      }
+   }
+
+   static void WriteGamma(uint8 *bits, int *offset, uint32 value) {
+      int length = BitLength(value);
+      WriteBits(bits, offset, 0, length - 1);
+      WriteBits(bits, offset, value, length);
+   }
+
+   static void WriteExpGolomb(uint8 *bits, int *offset, uint32 value, int order) {
+      WriteGamma(bits, offset, (value >> order) + 1);
+      WriteBits(bits, offset, value, order);
+   }
+
+   static bool ReadBits(uint8 *bits, int *offset, int num_bits, int count, uint32 *value) {
+      if (*offset + count > num_bits) {
+         return false;
+      }
+      *value = 0;
+      for (int i = 0; i < count; i++) {
+         *value = (*value << 1) | (uint32)BitVector_ReadBit(bits, offset);
+      }
+      return true;
+   }
+
+   static bool ReadGamma(uint8 *bits, int *offset, int num_bits, uint32 *value) {
+      int zeros = 0;
+      for (;;) {
+         if (*offset >= num_bits || zeros > 16) {
+            return false;
+         }
+         if (BitVector_ReadBit(bits, offset)) {
+            break;
+         }
+         zeros++;
+      }
+      uint32 rest;
+      if (!ReadBits(bits, offset, num_bits, zeros, &rest)) {
+         return false;
+      }
+      *value = (1u << zeros) | rest;
+      return true;
+   }
+
+   static bool ReadExpGolomb(uint8 *bits, int *offset, int num_bits, int order, uint32 *value) {
+      uint32 prefix, low;
+      if (!ReadGamma(bits, offset, num_bits, &prefix) || !ReadBits(bits, offset, num_bits, order, &low)) {
+         return false;
+      }
+      *value = ((prefix - 1) << order) | low;
+      return true;
+   }
+};
+
+/* ----------------------------------------------------------------------- */
+
+const InputCodec *
+InputCodec::Get(InputCodecId id)
+{
+   static const BitVectorInputCodec bitvector;
+   static const FieldInputCodec field;
+
+   switch (id) {
+   case INPUT_CODEC_BITVECTOR: return &bitvector;
+   case INPUT_CODEC_FIELD:     return &field;
+   default:                    return NULL;
+   }
+}
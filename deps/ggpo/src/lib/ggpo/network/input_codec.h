@@ -0,0 +1,63 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#ifndef _INPUT_CODEC_H
+#define _INPUT_CODEC_H
+
+#include "types.h"
+#include "game_input.h"
+
+enum InputCodecId {
+   INPUT_CODEC_BITVECTOR = 0,    /* one (on, bit index) pair per changed bit */
+   INPUT_CODEC_FIELD     = 1,    /* per 16-bit field xor mask or signed delta */
+   INPUT_CODEC_COUNT
+};
+
+#define INPUT_CODEC_MAX_FIELDS   ((GAMEINPUT_MAX_BYTES * GAMEINPUT_MAX_PLAYERS + 1) / 2)
+
+/*
+ * Adaptive state shared by the frames of one input packet.  Both ends reset
+ * it at the start of a packet and update it from the coded symbols only, so
+ * a receiver that skips frames it already has stays in step.
+ */
+struct InputCodecState {
+   uint32   magnitude[INPUT_CODEC_MAX_FIELDS];
+
+   void reset() { memset(magnitude, 0, sizeof(magnitude)); }
+};
+
+/*
+ * Encoders for the frames of an Input message.  Each frame is coded against
+ * the one before it and is self delimiting, so the packet is just the
+ * frames back to back.  Implementations are stateless; per packet state
+ * lives in InputCodecState.
+ */
+class InputCodec {
+public:
+   virtual ~InputCodec() { }
+
+   virtual InputCodecId Id() const = 0;
+   virtual const char *Name() const = 0;
+
+   /* Exactly what EncodeFrame would write for current after last. */
+   virtual int FrameBits(const InputCodecState &state,
+                         const GameInput &current, const GameInput &last) const = 0;
+   virtual void EncodeFrame(InputCodecState &state, uint8 *bits, int *offset,
+                            const GameInput &current, const GameInput &last) const = 0;
+
+   /*
+    * Reads one frame of size bytes.  target holds the previous frame and is
+    * moved to this one, or is NULL to only step over the frame.  Returns
+    * false if the frame runs past num_bits or is malformed.
+    */
+   virtual bool DecodeFrame(InputCodecState &state, uint8 *bits, int *offset, int num_bits,
+                            int size, GameInput *target) const = 0;
+
+   static const InputCodec *Get(InputCodecId id);
+};
+
+#endif
@@ -0,0 +1,141 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#include "types.h"
+#include "loopback.h"
+
+#include <map>
+
+QueuedTransport::QueuedTransport(const char *log_prefix) :
+   _log_prefix(log_prefix),
+   _callbacks(NULL),
+   _dropped(0)
+{
+}
+
+bool
+QueuedTransport::Deliver(const sockaddr_in &from, const char *buffer, int len)
+{
+   if (len <= 0 || len > MAX_UDP_PACKET_SIZE) {
+      return false;
+   }
+   std::lock_guard<std::mutex> lock(_queue_mutex);
+   if (_queue.size() >= LOOPBACK_QUEUE_MAX) {
+      _dropped++;
+      return false;
+   }
+   _queue.push_back(Datagram());
+   _queue.back().from = from;
+   _queue.back().data.assign((const uint8 *)buffer, (const uint8 *)buffer + len);
+   return true;
+}
+
+bool
+QueuedTransport::OnLoopPoll(void *cookie)
+{
+   int dropped;
+   {
+      std::lock_guard<std::mutex> lock(_queue_mutex);
+      _draining.swap(_queue);
+      dropped = _dropped;
+      _dropped = 0;
+   }
+   if (dropped) {
+      Log("queue full; dropped %d datagrams.\n", dropped);
+   }
+
+   for (size_t i = 0; i < _draining.size(); i++) {
+      Datagram &d = _draining[i];
+      _callbacks->OnMsg(d.from, (UdpMsg *)&d.data[0], (int)d.data.size());
+   }
+   _draining.clear();
+   return true;
+}
+
+int
+QueuedTransport::GetLoopWaitTime(void *cookie)
+{
+   std::lock_guard<std::mutex> lock(_queue_mutex);
+   return _queue.empty() ? INFINITE : 0;
+}
+
+void
+QueuedTransport::Log(const char *fmt, ...)
+{
+   char buf[1024];
+   size_t offset;
+   va_list args;
+
+   if (!LogEnabled(GGPO_LOG_INFO)) {
+      return;
+   }
+   strcpy_s(buf, _log_prefix);
+   offset = strlen(buf);
+   va_start(args, fmt);
+   vsnprintf(buf + offset, ARRAY_SIZE(buf) - offset - 1, fmt, args);
+   buf[ARRAY_SIZE(buf)-1] = '\0';
+   ::Log(buf);
+   va_end(args);
+}
+
+/*
+ * Bound endpoints by port.  Senders look their target up and queue under
+ * this lock, so an endpoint can't go away in between.
+ */
+static std::mutex                               loopback_mutex;
+static std::map<uint16, LoopbackTransport *>    loopback_ports;
+
+LoopbackTransport::LoopbackTransport() :
+   QueuedTransport("loopback | "),
+   _port(0)
+{
+}
+
+LoopbackTransport::~LoopbackTransport()
+{
+   std::lock_guard<std::mutex> lock(loopback_mutex);
+   std::map<uint16, LoopbackTransport *>::iterator i = loopback_ports.find(_port);
+   if (i != loopback_ports.end() && i->second == this) {
+      loopback_ports.erase(i);
+   }
+}
+
+void
+LoopbackTransport::Init(uint16 port, Poll *poll, Callbacks *callbacks)
+{
+   _callbacks = callbacks;
+   poll->RegisterLoop(this);
+
+   std::lock_guard<std::mutex> lock(loopback_mutex);
+   if (loopback_ports.count(port)) {
+      Log("port %d is taken.\n", port);
+      return;
+   }
+   _port = port;
+   loopback_ports[port] = this;
+   Log("bound to port %d.\n", port);
+}
+
+void
+LoopbackTransport::SendTo(char *buffer, int len, int flags, struct sockaddr *dst, int destlen)
+{
+   uint16 to = ntohs(((struct sockaddr_in *)dst)->sin_port);
+
+   std::lock_guard<std::mutex> lock(loopback_mutex);
+   std::map<uint16, LoopbackTransport *>::iterator i = loopback_ports.find(to);
+   if (_port == 0 || i == loopback_ports.end()) {
+      LogVerbose("nobody on port %d; dropped %d bytes.\n", to, len);
+      return;
+   }
+
+   sockaddr_in from;
+   memset(&from, 0, sizeof from);
+   from.sin_family = AF_INET;
+   from.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   from.sin_port = htons(_port);
+   i->second->Deliver(from, buffer, len);
+}
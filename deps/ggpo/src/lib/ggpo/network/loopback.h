@@ -0,0 +1,78 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#ifndef _LOOPBACK_H
+#define _LOOPBACK_H
+
+#include "transport.h"
+
+#include <mutex>
+#include <vector>
+
+/* Datagrams a queued endpoint holds before it drops them, like a full socket buffer. */
+#define LOOPBACK_QUEUE_MAX    1024
+
+/*
+ * A transport whose datagrams are handed to it by another thread or
+ * session rather than read from a socket.  Deliver queues them and the
+ * session's next poll passes them up.
+ *
+ * There is no handle to wait on, so a session pumped from the I/O thread
+ * (ggpo.network.thread) sees a datagram only once its other sinks wake
+ * it.  Drive these sessions with ggpo_idle.
+ */
+class QueuedTransport : public Transport
+{
+public:
+   QueuedTransport(const char *log_prefix);
+
+   /* Any thread.  False if the queue is full. */
+   bool Deliver(const sockaddr_in &from, const char *buffer, int len);
+
+   virtual bool OnLoopPoll(void *cookie);
+   virtual int GetLoopWaitTime(void *cookie);
+
+protected:
+   struct Datagram {
+      sockaddr_in          from;
+      std::vector<uint8>   data;
+   };
+
+   void Log(const char *fmt, ...);
+
+   const char              *_log_prefix;
+   Callbacks               *_callbacks;
+
+   std::mutex              _queue_mutex;
+   std::vector<Datagram>   _queue;
+   std::vector<Datagram>   _draining;
+   int                     _dropped;
+};
+
+/*
+ * The Loopback transport: sessions in one process, addressed by port.
+ * A datagram sent to any address with port N is queued for the loopback
+ * transport bound to N as coming from 127.0.0.1 and the sender's port.
+ * Nothing touches the kernel, so benchmarks and synctest runs measure
+ * GGPO alone; latency and loss still come from the ggpo.network.* test
+ * hooks.
+ */
+class LoopbackTransport : public QueuedTransport
+{
+public:
+   LoopbackTransport();
+   virtual ~LoopbackTransport();
+
+   void Init(uint16 port, Poll *poll, Callbacks *callbacks);
+
+   virtual void SendTo(char *buffer, int len, int flags, struct sockaddr *dst, int destlen);
+
+protected:
+   uint16                  _port;
+};
+
+#endif
@@ -0,0 +1,521 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#include "types.h"
+#include "relay_broadcast.h"
+
+static void
+PutLe16(uint8 *p, int v)
+{
+   p[0] = (uint8)(v & 0xff);
+   p[1] = (uint8)((v >> 8) & 0xff);
+}
+
+static void
+PutLe32(uint8 *p, uint32 v)
+{
+   p[0] = (uint8)(v & 0xff);
+   p[1] = (uint8)((v >> 8) & 0xff);
+   p[2] = (uint8)((v >> 16) & 0xff);
+   p[3] = (uint8)((v >> 24) & 0xff);
+}
+
+static int
+GetLe16(const uint8 *p)
+{
+   return p[0] | (p[1] << 8);
+}
+
+static uint32
+GetLe32(const uint8 *p)
+{
+   return (uint32)p[0] | ((uint32)p[1] << 8) | ((uint32)p[2] << 16) | ((uint32)p[3] << 24);
+}
+
+RelayBroadcast::RelayBroadcast() :
+   _transport(NULL),
+   _role(Host),
+   _session_len(0),
+   _frame_size(0),
+   _next_frame(0),
+   _last_send_time(0),
+   _last_recv_time(0),
+   _spectators(0),
+   _dropped(0),
+   _frames_sent(0),
+   _want_frame(0),
+   _want_window(0),
+   _key_frame(-1),
+   _key_codec(0),
+   _key_raw_size(0),
+   _key_acked(0),
+   _key_sent(0),
+   _key_send_time(0),
+   _key_done_frame(-1),
+   _key_done_bytes(0),
+   _key_wanted(false),
+   _key_asked(0),
+   _key_start_time(0)
+{
+   memset(&_relay_addr, 0, sizeof _relay_addr);
+   _session[0] = '\0';
+}
+
+RelayBroadcast::~RelayBroadcast()
+{
+   Stop();
+}
+
+void
+RelayBroadcast::Stop()
+{
+   if (_transport && _role == Host) {
+      SendBye();
+   }
+   _transport = NULL;
+}
+
+bool
+RelayBroadcast::Init(Transport *transport, Poll &poll, Role role, const char *ip, uint16 port,
+                     const char *session, int frame_size)
+{
+   int len = (int)strlen(session);
+   if (len == 0 || len > RELAY_BCAST_MAX_SESSION ||
+       frame_size <= 0 || frame_size > GAMEINPUT_MAX_BYTES * GAMEINPUT_MAX_PLAYERS) {
+      return false;
+   }
+
+   memset(&_relay_addr, 0, sizeof _relay_addr);
+   _relay_addr.sin_family = AF_INET;
+   _relay_addr.sin_port = htons(port);
+   if (inet_pton(AF_INET, ip, &_relay_addr.sin_addr.s_addr) != 1) {
+      return false;
+   }
+
+   memcpy(_session, session, len + 1);
+   _session_len = len;
+   _frame_size = frame_size;
+   _role = role;
+   _transport = transport;
+   _last_recv_time = Platform::GetCurrentTimeMS();
+   poll.RegisterLoop(this);
+
+   Log("relay broadcast: %s session '%s' via %s:%d.\n",
+       role == Host ? "hosting" : "watching", session, ip, port);
+
+   if (_role == Host) {
+      SendPending();
+   }
+   return true;
+}
+
+bool
+RelayBroadcast::HandlesPacket(sockaddr_in &from)
+{
+   return _transport &&
+          from.sin_port == _relay_addr.sin_port &&
+          from.sin_addr.s_addr == _relay_addr.sin_addr.s_addr;
+}
+
+void
+RelayBroadcast::GetStats(Stats *stats)
+{
+   stats->spectators = _spectators;
+   stats->pending = _pending.size();
+   stats->dropped = _dropped;
+   stats->frames_sent = _frames_sent;
+   stats->last_recv_ms = (int)(Platform::GetCurrentTimeMS() - _last_recv_time);
+   stats->keyframe = _key_done_frame;
+   stats->keyframe_bytes = _key_done_bytes;
+}
+
+int
+RelayBroadcast::WriteHeader(uint8 *buf, char type)
+{
+   memcpy(buf, RELAY_BCAST_MAGIC, RELAY_BCAST_MAGIC_LEN);
+   buf[RELAY_BCAST_MAGIC_LEN] = (uint8)type;
+   buf[RELAY_BCAST_MAGIC_LEN + 1] = (uint8)_session_len;
+   memcpy(buf + RELAY_BCAST_MAGIC_LEN + 2, _session, _session_len);
+   return RELAY_BCAST_MAGIC_LEN + 2 + _session_len;
+}
+
+void
+RelayBroadcast::Send(uint8 *buf, int len)
+{
+   _transport->SendTo((char *)buf, len, 0, (struct sockaddr *)&_relay_addr, sizeof _relay_addr);
+   _last_send_time = Platform::GetCurrentTimeMS();
+}
+
+void
+RelayBroadcast::SendFrame(GameInput &input)
+{
+   ASSERT(_role == Host);
+   ASSERT(input.size == _frame_size);
+
+   /*
+    * A relay that stops acking must not hold the match up.  Past the queue
+    * the oldest frames are dropped; spectators that need them will stall.
+    */
+   if (_pending.size() >= RELAY_BCAST_HOST_FRAMES - 1) {
+      if (_dropped++ == 0) {
+         Log("relay broadcast: queue full, dropping frame %d.\n", _pending.front().frame);
+      }
+      _pending.pop();
+   }
+   _pending.push(input);
+   _next_frame = input.frame + 1;
+   SendPending();
+}
+
+void
+RelayBroadcast::SendPending()
+{
+   uint8 buf[RELAY_BCAST_MAX_PACKET];
+   int offset = WriteHeader(buf, 'F');
+   int room = (RELAY_BCAST_MAX_PACKET - offset - 7) / _frame_size;
+   int count = MIN(MIN(room, 255), _pending.size());
+
+   PutLe32(buf + offset, (uint32)(count ? _pending.front().frame : _next_frame));
+   PutLe16(buf + offset + 4, _frame_size);
+   buf[offset + 6] = (uint8)count;
+   offset += 7;
+   for (int i = 0; i < count; i++) {
+      memcpy(buf + offset, _pending.item(i).bits, _frame_size);
+      offset += _frame_size;
+   }
+   _frames_sent += count;
+   Send(buf, offset);
+}
+
+void
+RelayBroadcast::SendBye()
+{
+   uint8 buf[RELAY_BCAST_MAX_PACKET];
+   int offset = WriteHeader(buf, 'B');
+   PutLe32(buf + offset, (uint32)_next_frame);
+   Send(buf, offset + 4);
+}
+
+void
+RelayBroadcast::SendKeyframe(int frame, int codec, int raw_size, const uint8 *data, int size)
+{
+   ASSERT(_role == Host);
+   if (size <= 0 || size > RELAY_BCAST_MAX_KEYFRAME) {
+      return;
+   }
+   _key.assign(data, data + size);
+   _key_frame = frame;
+   _key_codec = codec;
+   _key_raw_size = raw_size;
+   _key_acked = 0;
+   _key_sent = 0;
+   SendKeyChunks(false);
+}
+
+/*
+ * Sends the keyframe chunks that fit in the window past what the relay
+ * has acked.  resend starts over from there, for chunks that got lost.
+ */
+void
+RelayBroadcast::SendKeyChunks(bool resend)
+{
+   uint8 buf[RELAY_BCAST_MAX_PACKET];
+   int size = (int)_key.size();
+   int limit = MIN(size, _key_acked + RELAY_BCAST_KEY_WINDOW * RELAY_BCAST_KEY_CHUNK);
+
+   if (resend) {
+      _key_sent = _key_acked;
+   }
+   while (_key_sent < limit) {
+      int offset = WriteHeader(buf, 'K');
+      int len = MIN(RELAY_BCAST_KEY_CHUNK, size - _key_sent);
+
+      PutLe32(buf + offset, (uint32)_key_frame);
+      buf[offset + 4] = (uint8)_key_codec;
+      PutLe32(buf + offset + 5, (uint32)_key_raw_size);
+      PutLe32(buf + offset + 9, (uint32)size);
+      PutLe32(buf + offset + 13, (uint32)_key_sent);
+      memcpy(buf + offset + 17, &_key[_key_sent], len);
+      Send(buf, offset + 17 + len);
+      _key_sent += len;
+   }
+   _key_send_time = Platform::GetCurrentTimeMS();
+}
+
+void
+RelayBroadcast::Request(int from_frame, int window, bool urgent)
+{
+   ASSERT(_role == Spectator);
+   bool opened = _want_window == 0 && window > 0;
+
+   _want_frame = from_frame;
+   _want_window = window;
+   if (_key_wanted) {
+      return;
+   }
+   if (opened || (urgent &&
+       Platform::GetCurrentTimeMS() - _last_send_time >= RELAY_BCAST_JOIN_INTERVAL / 4)) {
+      SendJoin();
+   }
+}
+
+void
+RelayBroadcast::RequestKeyframe()
+{
+   ASSERT(_role == Spectator);
+   _key_wanted = true;
+   _key_frame = -1;
+   _key_acked = 0;
+   _key_start_time = Platform::GetCurrentTimeMS();
+   SendKeyRequest();
+}
+
+void
+RelayBroadcast::SendKeyRequest()
+{
+   uint8 buf[RELAY_BCAST_MAX_PACKET];
+   int offset = WriteHeader(buf, 'S');
+   PutLe32(buf + offset, (uint32)_key_frame);
+   PutLe32(buf + offset + 4, (uint32)_key_acked);
+   Send(buf, offset + 8);
+   _key_asked = _key_acked;
+}
+
+/* No keyframe after all: join at the frame asked for. */
+void
+RelayBroadcast::EndKeyRequest()
+{
+   _key_wanted = false;
+   std::vector<uint8>().swap(_key);
+   if (_want_window > 0) {
+      SendJoin();
+   }
+}
+
+void
+RelayBroadcast::SendRequest()
+{
+   if (_key_wanted) {
+      SendKeyRequest();
+   } else {
+      SendJoin();
+   }
+}
+
+void
+RelayBroadcast::SendJoin()
+{
+   uint8 buf[RELAY_BCAST_MAX_PACKET];
+   int offset = WriteHeader(buf, 'J');
+   PutLe32(buf + offset, (uint32)_want_frame);
+   PutLe16(buf + offset + 4, _want_window);
+   Send(buf, offset + 6);
+}
+
+bool
+RelayBroadcast::OnPacket(const uint8 *data, int len, Packet *packet)
+{
+   packet->type = Packet::None;
+   if (len < RELAY_BCAST_MAGIC_LEN + 2 || memcmp(data, RELAY_BCAST_MAGIC, RELAY_BCAST_MAGIC_LEN)) {
+      return false;
+   }
+   char type = (char)data[RELAY_BCAST_MAGIC_LEN];
+   int session_len = data[RELAY_BCAST_MAGIC_LEN + 1];
+   int offset = RELAY_BCAST_MAGIC_LEN + 2 + session_len;
+   if (len < offset || session_len != _session_len ||
+       memcmp(data + RELAY_BCAST_MAGIC_LEN + 2, _session, session_len)) {
+      return false;
+   }
+   data += offset;
+   len -= offset;
+
+   /* The keyframe handed over last time has been loaded by now. */
+   if (_role == Spectator && !_key_wanted && !_key.empty()) {
+      std::vector<uint8>().swap(_key);
+   }
+
+   switch (type) {
+   case 'A':
+      if (_role != Host || len < 6) {
+         return false;
+      }
+      {
+         int next = (int)GetLe32(data);
+         while (!_pending.empty() && _pending.front().frame < next) {
+            _pending.pop();
+         }
+         _spectators = GetLe16(data + 4);
+      }
+      break;
+
+   case 'F':
+      if (_role != Spectator || len < 7) {
+         return false;
+      }
+      packet->frame = (int)GetLe32(data);
+      packet->frame_size = GetLe16(data + 4);
+      packet->count = data[6];
+      packet->data = data + 7;
+      if (packet->frame_size != _frame_size || len < 7 + packet->count * _frame_size) {
+         return false;
+      }
+      packet->type = Packet::Frames;
+      break;
+
+   case 'k':
+      if (_role != Host || len < 8) {
+         return false;
+      }
+      {
+         int frame = (int)GetLe32(data);
+         int have = (int)GetLe32(data + 4);
+         if (frame == _key_frame && have > _key_acked && have <= (int)_key.size()) {
+            _key_acked = have;
+            if (_key_acked == (int)_key.size()) {
+               _key_done_frame = frame;
+               _key_done_bytes = _key_acked;
+               Log("relay broadcast: the relay has the keyframe for frame %d (%d bytes).\n",
+                   frame, _key_acked);
+            } else {
+               SendKeyChunks(false);
+            }
+         }
+      }
+      break;
+
+   case 'K':
+      if (_role != Spectator || !OnKeyChunk(data, len, packet)) {
+         return false;
+      }
+      break;
+
+   case 'E':
+   case 'G':
+      if (_role != Spectator || len < 4) {
+         return false;
+      }
+      packet->type = type == 'E' ? Packet::End : Packet::Gone;
+      packet->frame = (int)GetLe32(data);
+      break;
+
+   default:
+      return false;
+   }
+   _last_recv_time = Platform::GetCurrentTimeMS();
+   return true;
+}
+
+/*
+ * A chunk of the keyframe being fetched.  Chunks are taken in order; one
+ * past a gap asks again from the gap, once per request, and a whole
+ * window in asks for the next.  A chunk of a different keyframe means the
+ * relay got a newer one and the fetch starts over with that.
+ */
+bool
+RelayBroadcast::OnKeyChunk(const uint8 *data, int len, Packet *packet)
+{
+   if (!_key_wanted || len < 17) {
+      return false;
+   }
+   int frame = (int)GetLe32(data);
+   int codec = data[4];
+   int raw_size = (int)GetLe32(data + 5);
+   int size = (int)GetLe32(data + 9);
+   int offset = (int)GetLe32(data + 13);
+   int chunk = len - 17;
+
+   if (size == 0) {
+      Log("relay broadcast: the relay has no keyframe yet.\n");
+      EndKeyRequest();
+      return true;
+   }
+   if (frame < 0 || size < 0 || size > RELAY_BCAST_MAX_KEYFRAME ||
+       raw_size <= 0 || raw_size > RELAY_BCAST_MAX_KEYFRAME ||
+       offset < 0 || chunk > size - offset) {
+      return false;
+   }
+
+   if (frame != _key_frame || size != (int)_key.size()) {
+      _key_frame = frame;
+      _key_codec = codec;
+      _key_raw_size = raw_size;
+      _key.resize(size);
+      _key_acked = 0;
+      _key_asked = 0;
+   }
+   if (offset > _key_acked) {
+      if (_key_asked != _key_acked) {
+         SendKeyRequest();
+      }
+      return true;
+   }
+   if (offset < _key_acked) {
+      return true;
+   }
+
+   memcpy(&_key[offset], data + 17, chunk);
+   _key_acked += chunk;
+   if (_key_acked < size) {
+      if (_key_acked >= _key_asked + RELAY_BCAST_KEY_WINDOW * RELAY_BCAST_KEY_CHUNK) {
+         SendKeyRequest();
+      }
+      return true;
+   }
+
+   Log("relay broadcast: got the keyframe for frame %d (%d bytes).\n", frame, size);
+   _key_wanted = false;
+   _want_window = 0;          /* so the join from the keyframe goes out right away */
+   packet->type = Packet::Keyframe;
+   packet->frame = frame;
+   packet->codec = _key_codec;
+   packet->raw_size = _key_raw_size;
+   packet->size = size;
+   packet->data = &_key[0];
+   return true;
+}
+
+bool
+RelayBroadcast::OnLoopPoll(void *cookie)
+{
+   if (!_transport) {
+      return true;
+   }
+   unsigned int now = Platform::GetCurrentTimeMS();
+   if (_role == Host) {
+      int interval = _pending.empty() ? RELAY_BCAST_KEEPALIVE_INTERVAL : RELAY_BCAST_RESEND_INTERVAL;
+      if (now - _last_send_time >= (unsigned int)interval) {
+         SendPending();
+      }
+      if (IsSendingKeyframe() && now - _key_send_time >= RELAY_BCAST_RESEND_INTERVAL) {
+         SendKeyChunks(true);
+      }
+   } else if (_key_wanted && _key_frame < 0 && now - _key_start_time >= RELAY_BCAST_KEY_WAIT) {
+      Log("relay broadcast: no answer about a keyframe in %d ms.\n", RELAY_BCAST_KEY_WAIT);
+      EndKeyRequest();
+   } else if (now - _last_send_time >= RELAY_BCAST_JOIN_INTERVAL) {
+      SendRequest();
+   }
+   return true;
+}
+
+int
+RelayBroadcast::GetLoopWaitTime(void *cookie)
+{
+   if (!_transport) {
+      return INFINITE;
+   }
+   int interval = RELAY_BCAST_JOIN_INTERVAL;
+   if (_role == Host) {
+      interval = _pending.empty() ? RELAY_BCAST_KEEPALIVE_INTERVAL : RELAY_BCAST_RESEND_INTERVAL;
+   }
+   unsigned int now = Platform::GetCurrentTimeMS();
+   int wait = MAX(interval - (int)(now - _last_send_time), 0);
+   if (_role == Host && IsSendingKeyframe()) {
+      wait = MIN(wait, MAX(RELAY_BCAST_RESEND_INTERVAL - (int)(now - _key_send_time), 0));
+   }
+   return wait;
+}
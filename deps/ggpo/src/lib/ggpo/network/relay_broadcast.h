@@ -0,0 +1,185 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#ifndef _RELAY_BROADCAST_H_
+#define _RELAY_BROADCAST_H_
+
+#include "poll.h"
+#include "transport.h"
+#include "game_input.h"
+#include "ring_buffer.h"
+
+#include <vector>
+
+/*
+ * Spectator broadcast through a relay (relay-server/README.md).  The host
+ * sends each confirmed frame once to the relay, which keeps the match and
+ * fans it out to any number of spectators.  Packets are the magic, a type
+ * byte, a length prefixed session id and then, little endian:
+ *
+ *   'F' frames     u32 first_frame, u16 frame_size, u8 count, the frames
+ *   'A' ack        u32 next_frame the relay has everything below, u16 spectators
+ *   'J' join       u32 from_frame, u16 window (frames the spectator can take)
+ *   'B' bye        host is done; the relay passes it on as 'E' u32 end_frame
+ *   'G' gone       u32 first frame the relay still has
+ *   'K' keyframe   u32 frame, u8 codec, u32 raw_size, u32 size, u32 offset,
+ *                  then up to RELAY_BCAST_KEY_CHUNK bytes of the state
+ *   'k' key ack    u32 frame, u32 bytes of it the relay has in order
+ *   'S' snapshot   u32 frame, u32 offset of the keyframe a spectator wants
+ *
+ * The host resends whatever the relay has not acked; a spectator repeats
+ * its join as keepalive and to ask again for frames it missed.
+ *
+ * Every so often the host also uploads the state at the first frame it
+ * has not yet broadcast, its keyframe.  A joining spectator asks before
+ * its first join; the relay answers with its latest keyframe, or with a
+ * 'K' of size 0 if it has none, so the spectator loads the state and only
+ * plays the frames from there.
+ */
+#define RELAY_BCAST_MAGIC              "RABCAST1"
+#define RELAY_BCAST_MAGIC_LEN          8
+#define RELAY_BCAST_MAX_SESSION        64
+#define RELAY_BCAST_MAX_PACKET         1200
+#define RELAY_BCAST_HOST_FRAMES        1024     /* frames the host keeps unacked */
+#define RELAY_BCAST_RESEND_INTERVAL    100
+#define RELAY_BCAST_JOIN_INTERVAL      100
+#define RELAY_BCAST_KEEPALIVE_INTERVAL 1000
+#define RELAY_BCAST_TIMEOUT            5000
+#define RELAY_BCAST_KEY_CHUNK          1024
+#define RELAY_BCAST_KEY_WINDOW         16       /* keyframe chunks in flight */
+#define RELAY_BCAST_KEY_WAIT           1000     /* spectator: a relay that never answers has none */
+#define RELAY_BCAST_MAX_KEYFRAME       (64 * 1024 * 1024)
+
+class RelayBroadcast : public IPollSink
+{
+public:
+   enum Role {
+      Host,
+      Spectator,
+   };
+
+   struct Packet {
+      enum Type {
+         None,
+         Frames,
+         End,
+         Gone,
+         Keyframe,
+      };
+      Type           type;
+      int            frame;         /* first frame, end frame, oldest kept or keyframe */
+      int            count;
+      int            frame_size;
+      const uint8    *data;
+      int            codec;         /* Keyframe: GGPOStateCodec, size bytes of data */
+      int            raw_size;
+      int            size;
+   };
+
+   struct Stats {
+      int            spectators;    /* as last reported by the relay */
+      int            pending;       /* host: frames not yet acked */
+      int            dropped;       /* host: frames lost to a full queue */
+      int            frames_sent;
+      int            last_recv_ms;
+      int            keyframe;      /* host: last keyframe the relay has, or -1 */
+      int            keyframe_bytes;
+   };
+
+public:
+   RelayBroadcast();
+   virtual ~RelayBroadcast();
+
+   bool Init(Transport *transport, Poll &poll, Role role, const char *ip, uint16 port,
+             const char *session, int frame_size);
+   bool IsActive() { return _transport != NULL; }
+   /* Says bye as the host and lets go of the transport. */
+   void Stop();
+   bool HandlesPacket(sockaddr_in &from);
+   unsigned int LastRecvTime() { return _last_recv_time; }
+   void GetStats(Stats *stats);
+
+   /* Host: queue a confirmed frame and send it with whatever is unacked. */
+   void SendFrame(GameInput &input);
+   void SendBye();
+
+   /*
+    * Host: upload a keyframe, replacing any still on its way.  data is
+    * the state at frame in codec, raw_size bytes once decoded.
+    */
+   void SendKeyframe(int frame, int codec, int raw_size, const uint8 *data, int size);
+   bool IsSendingKeyframe() { return _key_acked < (int)_key.size(); }
+
+   /*
+    * Spectator: the next frame wanted and how many it can hold from there.
+    * urgent asks right away (a gap showed up) instead of at the next join.
+    */
+   void Request(int from_frame, int window, bool urgent);
+
+   /*
+    * Spectator: fetch the relay's keyframe before joining.  OnPacket hands
+    * it over as a Keyframe packet once it is all in; if there is none the
+    * spectator joins at the frame it asked for, as without.
+    */
+   void RequestKeyframe();
+
+   /* Parses one packet from the relay; acks are handled internally. */
+   bool OnPacket(const uint8 *data, int len, Packet *packet);
+
+   virtual bool OnLoopPoll(void *cookie);
+   virtual int GetLoopWaitTime(void *cookie);
+
+protected:
+   int WriteHeader(uint8 *buf, char type);
+   void SendPending();
+   void SendJoin();
+   void SendRequest();
+   void SendKeyChunks(bool resend);
+   void SendKeyRequest();
+   bool OnKeyChunk(const uint8 *data, int len, Packet *packet);
+   void EndKeyRequest();
+   void Send(uint8 *buf, int len);
+
+protected:
+   Transport      *_transport;
+   sockaddr_in    _relay_addr;
+   Role           _role;
+   char           _session[RELAY_BCAST_MAX_SESSION + 1];
+   int            _session_len;
+   int            _frame_size;
+
+   RingBuffer<GameInput, RELAY_BCAST_HOST_FRAMES> _pending;
+   int            _next_frame;
+   unsigned int   _last_send_time;
+   unsigned int   _last_recv_time;
+   int            _spectators;
+   int            _dropped;
+   int            _frames_sent;
+
+   int            _want_frame;
+   int            _want_window;
+
+   /*
+    * The keyframe: on the host the one being uploaded, on a spectator the
+    * one being fetched.  _key_acked is how much of it the other side has
+    * in order, _key_sent (host) how far the send window got.
+    */
+   std::vector<uint8> _key;
+   int            _key_frame;
+   int            _key_codec;
+   int            _key_raw_size;
+   int            _key_acked;
+   int            _key_sent;
+   unsigned int   _key_send_time;
+   int            _key_done_frame;  /* host: what the relay has */
+   int            _key_done_bytes;
+   bool           _key_wanted;
+   int            _key_asked;
+   unsigned int   _key_start_time;
+};
+
+#endif
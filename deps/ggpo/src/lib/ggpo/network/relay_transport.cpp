@@ -0,0 +1,116 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#include "types.h"
+#include "relay_transport.h"
+
+RelayTransport::RelayTransport() :
+   _callbacks(NULL),
+   _header_len(0),
+   _slot(0)
+{
+   memset(&_relay_addr, 0, sizeof _relay_addr);
+}
+
+/*
+ * Returns false for a bad relay address or session; the socket is bound
+ * all the same and whatever is sent is dropped, so the session runs into
+ * its disconnect timeout like one whose peer never answers.
+ */
+bool
+RelayTransport::Init(const Config &config, Poll *poll, Transport::Callbacks *callbacks)
+{
+   _callbacks = callbacks;
+   _udp.Init(config.port, poll, this);
+
+   int len = config.session ? (int)strlen(config.session) : 0;
+   if (len == 0 || len > RELAY_MUX_MAX_SESSION ||
+       (config.slot != 1 && config.slot != 2)) {
+      Log("bad session or slot %d.\n", config.slot);
+      return false;
+   }
+   _relay_addr.sin_family = AF_INET;
+   _relay_addr.sin_port = htons(config.relay_port);
+   if (!config.relay_ip ||
+       inet_pton(AF_INET, config.relay_ip, &_relay_addr.sin_addr.s_addr) != 1) {
+      Log("bad relay address %s.\n", config.relay_ip ? config.relay_ip : "(null)");
+      return false;
+   }
+
+   memcpy(_header, RELAY_MUX_MAGIC, RELAY_MUX_MAGIC_LEN);
+   _header[RELAY_MUX_MAGIC_LEN] = (uint8)config.slot;
+   _header[RELAY_MUX_MAGIC_LEN + 1] = (uint8)len;
+   memcpy(_header + RELAY_MUX_MAGIC_LEN + 2, config.session, len);
+   _header_len = RELAY_MUX_MAGIC_LEN + 2 + len;
+   _slot = config.slot;
+
+   Log("session '%s' slot %d via %s:%d.\n", config.session, _slot,
+       config.relay_ip, config.relay_port);
+   return true;
+}
+
+void
+RelayTransport::SendTo(char *buffer, int len, int flags, struct sockaddr *dst, int destlen)
+{
+   uint8 buf[MAX_UDP_PACKET_SIZE];
+
+   if (_header_len == 0) {
+      return;
+   }
+   if (_header_len + len > MAX_UDP_PACKET_SIZE) {
+      Log("dropped %d byte packet: too large to tag.\n", len);
+      return;
+   }
+   memcpy(buf, _header, _header_len);
+   memcpy(buf + _header_len, buffer, len);
+   _udp.SendTo((char *)buf, _header_len + len, flags,
+               (struct sockaddr *)&_relay_addr, sizeof _relay_addr);
+}
+
+void
+RelayTransport::OnMsg(sockaddr_in &from, UdpMsg *msg, int len)
+{
+   const uint8 *data = (const uint8 *)msg;
+
+   if (_header_len > 0 &&
+       len >= RELAY_MUX_MAGIC_LEN + 2 &&
+       !memcmp(data, RELAY_MUX_MAGIC, RELAY_MUX_MAGIC_LEN)) {
+      /* Ours if it names our session and comes from the other slot. */
+      if (len < _header_len ||
+          data[RELAY_MUX_MAGIC_LEN] == _slot ||
+          memcmp(data + RELAY_MUX_MAGIC_LEN + 1, _header + RELAY_MUX_MAGIC_LEN + 1,
+                 _header_len - RELAY_MUX_MAGIC_LEN - 1)) {
+         LogVerbose("dropped packet for another session or slot.\n");
+         return;
+      }
+      /* Move the GGPO packet to the start of the buffer, where it is aligned. */
+      len -= _header_len;
+      memmove(msg, data + _header_len, len);
+      _callbacks->OnMsg(_relay_addr, msg, len);
+      return;
+   }
+   _callbacks->OnMsg(from, msg, len);
+}
+
+void
+RelayTransport::Log(const char *fmt, ...)
+{
+   char buf[1024];
+   size_t offset;
+   va_list args;
+
+   if (!LogEnabled(GGPO_LOG_INFO)) {
+      return;
+   }
+   strcpy_s(buf, "relay | ");
+   offset = strlen(buf);
+   va_start(args, fmt);
+   vsnprintf(buf + offset, ARRAY_SIZE(buf) - offset - 1, fmt, args);
+   buf[ARRAY_SIZE(buf)-1] = '\0';
+   ::Log(buf);
+   va_end(args);
+}
@@ -0,0 +1,57 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#ifndef _RELAY_TRANSPORT_H
+#define _RELAY_TRANSPORT_H
+
+#include "udp.h"
+
+/*
+ * The Relay transport (relay-server/README.md): every datagram goes to the
+ * relay, tagged with the match it belongs to, so the relay can tell
+ * matches apart by the tag instead of by address.  One relay socket then
+ * carries any number of matches, a peer needs no separate HELLO and a
+ * peer whose address changes keeps its place.  The tag is the magic, the
+ * sender's slot, a length prefixed session id, then the GGPO packet.
+ *
+ * The relay forwards the tagged packet to the other slot as it is.  What
+ * comes back is handed up as coming from the relay, so the remote player
+ * is added with the relay's address.  Anything else from the socket, such
+ * as a relay broadcast, is passed up untouched.
+ */
+#define RELAY_MUX_MAGIC          "RAMUXGG1"
+#define RELAY_MUX_MAGIC_LEN      8
+#define RELAY_MUX_MAX_SESSION    64
+
+class RelayTransport : public Transport, Transport::Callbacks
+{
+public:
+   RelayTransport();
+
+   bool Init(const Config &config, Poll *poll, Transport::Callbacks *callbacks);
+
+   virtual void SendTo(char *buffer, int len, int flags, struct sockaddr *dst, int destlen);
+   virtual void BeginBatch() { _udp.BeginBatch(); }
+   virtual void EndBatch() { _udp.EndBatch(); }
+   virtual bool IsBatching() const { return _udp.IsBatching(); }
+   virtual unsigned int GetSyscallCount() const { return _udp.GetSyscallCount(); }
+   virtual Transport *Carrier() { return &_udp; }
+
+   virtual void OnMsg(sockaddr_in &from, UdpMsg *msg, int len);
+
+protected:
+   void Log(const char *fmt, ...);
+
+   Udp            _udp;
+   Transport::Callbacks *_callbacks;
+   sockaddr_in    _relay_addr;
+   uint8          _header[RELAY_MUX_MAGIC_LEN + 2 + RELAY_MUX_MAX_SESSION];
+   int            _header_len;
+   int            _slot;
+};
+
+#endif
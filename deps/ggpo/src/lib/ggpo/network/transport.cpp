@@ -0,0 +1,52 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#include "types.h"
+#include "transport.h"
+#include "udp.h"
+#include "loopback.h"
+#include "relay_transport.h"
+#include "tunnel_transport.h"
+#include "transport_hub.h"
+
+void
+Transport::DefaultConfig(Config *config, uint16 port)
+{
+   memset(config, 0, sizeof *config);
+   config->kind = Platform::GetConfigInt("ggpo.transport") == 1 ? Loopback : Socket;
+   config->port = port;
+}
+
+Transport *
+Transport::Create(const Config &config, Poll *poll, Callbacks *callbacks)
+{
+   switch (config.kind) {
+   case Loopback: {
+      LoopbackTransport *loopback = new LoopbackTransport();
+      loopback->Init(config.port, poll, callbacks);
+      return loopback;
+   }
+   case Relay: {
+      RelayTransport *relay = new RelayTransport();
+      relay->Init(config, poll, callbacks);
+      return relay;
+   }
+   case Tunnel: {
+      TunnelTransport *tunnel = new TunnelTransport();
+      tunnel->Init(poll, callbacks);
+      return tunnel;
+   }
+   default: {
+      if (config.hub) {
+         return config.hub->CreateChannel(poll, callbacks);
+      }
+      Udp *udp = new Udp();
+      udp->Init(config.port, poll, callbacks);
+      return udp;
+   }
+   }
+}
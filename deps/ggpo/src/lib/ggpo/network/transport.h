@@ -0,0 +1,85 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#ifndef _TRANSPORT_H
+#define _TRANSPORT_H
+
+#include "poll.h"
+#include "udp_msg.h"
+
+static const int MAX_UDP_PACKET_SIZE = 4096;
+
+class TransportHub;
+
+/*
+ * What UdpProtocol sends its datagrams through.  Peers are still named by
+ * sockaddr_in; a transport that doesn't use sockets maps those onto
+ * whatever it uses instead.  Received datagrams are handed to the
+ * Callbacks from a poll sink the transport registers in Init.
+ *
+ * ggpo.transport picks the kind for sessions that don't ask for one:
+ * 0 UDP sockets, 1 in-process loopback.  Relays are chosen through
+ * ggpo_start_relay_session, which has the session id to give them, a
+ * shared socket through ggpo_start_hub_session and a link the application
+ * carries itself through ggpo_start_tunnel_session.
+ *
+ * The kinds are numbered as GGPOTransportKind.
+ */
+class Transport : public IPollSink
+{
+public:
+   enum Kind {
+      Socket,
+      Loopback,
+      Relay,
+      Tunnel,
+   };
+
+   struct Config {
+      Kind           kind;
+      uint16         port;          /* local port; the loopback address */
+      const char     *relay_ip;     /* Relay only */
+      uint16         relay_port;
+      const char     *session;
+      int            slot;          /* 1 or 2 */
+      TransportHub   *hub;          /* Socket only; share its socket */
+   };
+
+   struct Callbacks {
+      virtual ~Callbacks() { }
+      virtual void OnMsg(sockaddr_in &from, UdpMsg *msg, int len) = 0;
+   };
+
+   /* Fills in a Config for a session started without one. */
+   static void DefaultConfig(Config *config, uint16 port);
+   static Transport *Create(const Config &config, Poll *poll, Callbacks *callbacks);
+
+public:
+   virtual ~Transport() { }
+
+   virtual void SendTo(char *buffer, int len, int flags, struct sockaddr *dst, int destlen) = 0;
+
+   /*
+    * Sends between BeginBatch and the matching EndBatch may be held back
+    * and flushed together.  Scopes nest; only the outermost EndBatch
+    * flushes.
+    */
+   virtual void BeginBatch() { }
+   virtual void EndBatch() { }
+
+   virtual bool IsBatching() const { return false; }
+   virtual unsigned int GetSyscallCount() const { return 0; }
+
+   /*
+    * The transport that puts datagrams on the wire as given.  Traffic
+    * with a protocol of its own, like the relay broadcast, goes through
+    * this one so a wrapping transport leaves it alone.
+    */
+   virtual Transport *Carrier() { return this; }
+};
+
+#endif
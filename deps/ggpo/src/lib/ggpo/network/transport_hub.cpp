@@ -0,0 +1,225 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#include "types.h"
+#include "transport_hub.h"
+#include "thread_hook.h"
+
+#include <algorithm>
+
+TransportHub::TransportHub() :
+   _shutdown(false)
+{
+   memset(&_stats, 0, sizeof _stats);
+}
+
+TransportHub::~TransportHub()
+{
+   if (_thread.joinable()) {
+      _shutdown = true;
+      _thread.join();
+   }
+}
+
+bool
+TransportHub::Init(uint16 port)
+{
+   _udp.Init(port, &_poll, this);
+   if (!_udp.IsBound()) {
+      Log("could not bind port %d.\n", port);
+      return false;
+   }
+   _thread = std::thread(&TransportHub::IoThreadMain, this);
+   Log("hosting on port %d.\n", port);
+   return true;
+}
+
+HubTransport *
+TransportHub::CreateChannel(Poll *poll, Transport::Callbacks *callbacks)
+{
+   HubTransport *channel = new HubTransport(this);
+   channel->_callbacks = callbacks;
+   poll->RegisterLoop(channel);
+   Attach(channel);
+   return channel;
+}
+
+int
+TransportHub::GetChannelCount()
+{
+   std::lock_guard<std::mutex> lock(_mutex);
+   return (int)_channels.size();
+}
+
+void
+TransportHub::GetStats(Stats *stats)
+{
+   std::lock_guard<std::mutex> lock(_mutex);
+   *stats = _stats;
+   stats->sessions = (int)_channels.size();
+   stats->syscalls = _udp.GetSyscallCount();
+}
+
+void
+TransportHub::Attach(HubTransport *channel)
+{
+   std::lock_guard<std::mutex> lock(_mutex);
+   _channels.push_back(channel);
+}
+
+void
+TransportHub::Detach(HubTransport *channel)
+{
+   std::lock_guard<std::mutex> lock(_mutex);
+   for (size_t i = 0; i < channel->_claims.size(); i++) {
+      std::map<uint64, std::vector<HubTransport *> >::iterator r = _routes.find(channel->_claims[i]);
+      if (r == _routes.end()) {
+         continue;
+      }
+      r->second.erase(std::remove(r->second.begin(), r->second.end(), channel), r->second.end());
+      if (r->second.empty()) {
+         _routes.erase(r);
+      }
+   }
+   _channels.erase(std::remove(_channels.begin(), _channels.end(), channel), _channels.end());
+}
+
+/* Called with _mutex held. */
+void
+TransportHub::Send(HubTransport *channel, char *buffer, int len, int flags, struct sockaddr_in &dst)
+{
+   uint64 key = AddressKey(dst);
+   if (std::find(channel->_claims.begin(), channel->_claims.end(), key) == channel->_claims.end()) {
+      channel->_claims.push_back(key);
+      _routes[key].push_back(channel);
+   }
+   _stats.packets_sent++;
+   _stats.bytes_sent += len;
+   _udp.SendTo(buffer, len, flags, (struct sockaddr *)&dst, sizeof dst);
+}
+
+/* Called from the I/O thread with _mutex held. */
+void
+TransportHub::OnMsg(sockaddr_in &from, UdpMsg *msg, int len)
+{
+   std::map<uint64, std::vector<HubTransport *> >::iterator r = _routes.find(AddressKey(from));
+
+   _stats.packets_received++;
+   _stats.bytes_received += len;
+   if (r == _routes.end()) {
+      _stats.unrouted++;
+      return;
+   }
+   for (size_t i = 0; i < r->second.size(); i++) {
+      r->second[i]->Deliver(from, (const char *)msg, len);
+   }
+}
+
+/*
+ * Same shape as the p2p network thread: wait for the socket unlocked,
+ * then read and route under the lock the sessions send with.
+ */
+void
+TransportHub::IoThreadMain()
+{
+   ThreadHookScope hook("ggpo_hub");
+   while (!_shutdown) {
+      _poll.WaitForHandles(TRANSPORT_HUB_MAX_WAIT);
+
+      std::lock_guard<std::mutex> lock(_mutex);
+      _poll.Pump(0);
+   }
+}
+
+uint64
+TransportHub::AddressKey(const sockaddr_in &addr)
+{
+   return ((uint64)ntohl(addr.sin_addr.s_addr) << 16) | ntohs(addr.sin_port);
+}
+
+void
+TransportHub::Log(const char *fmt, ...)
+{
+   char buf[1024];
+   size_t offset;
+   va_list args;
+
+   if (!LogEnabled(GGPO_LOG_INFO)) {
+      return;
+   }
+   strcpy_s(buf, "hub | ");
+   offset = strlen(buf);
+   va_start(args, fmt);
+   vsnprintf(buf + offset, ARRAY_SIZE(buf) - offset - 1, fmt, args);
+   buf[ARRAY_SIZE(buf)-1] = '\0';
+   ::Log(buf);
+   va_end(args);
+}
+
+HubTransport::HubTransport(TransportHub *hub) :
+   QueuedTransport("hub channel | "),
+   _hub(hub),
+   _batch_depth(0)
+{
+}
+
+HubTransport::~HubTransport()
+{
+   _hub->Detach(this);
+}
+
+void
+HubTransport::SendTo(char *buffer, int len, int flags, struct sockaddr *dst, int destlen)
+{
+   if (len <= 0 || len > MAX_UDP_PACKET_SIZE) {
+      return;
+   }
+   if (_batch_depth > 0) {
+      _pending.push_back(Datagram());
+      _pending.back().from = *(struct sockaddr_in *)dst;  /* the destination, here */
+      _pending.back().data.assign((const uint8 *)buffer, (const uint8 *)buffer + len);
+      return;
+   }
+   std::lock_guard<std::mutex> lock(_hub->_mutex);
+   _hub->Send(this, buffer, len, flags, *(struct sockaddr_in *)dst);
+}
+
+void
+HubTransport::BeginBatch()
+{
+   _batch_depth++;
+}
+
+void
+HubTransport::EndBatch()
+{
+   if (_batch_depth == 0 || --_batch_depth > 0 || _pending.empty()) {
+      return;
+   }
+   {
+      std::lock_guard<std::mutex> lock(_hub->_mutex);
+      _hub->_udp.BeginBatch();
+      for (size_t i = 0; i < _pending.size(); i++) {
+         Datagram &d = _pending[i];
+         _hub->Send(this, (char *)&d.data[0], (int)d.data.size(), 0, d.from);
+      }
+      _hub->_udp.EndBatch();
+   }
+   _pending.clear();
+}
+
+bool
+HubTransport::IsBatching() const
+{
+   return _hub->_udp.IsBatching();
+}
+
+unsigned int
+HubTransport::GetSyscallCount() const
+{
+   return _hub->_udp.GetSyscallCount();
+}
@@ -0,0 +1,117 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#ifndef _TRANSPORT_HUB_H
+#define _TRANSPORT_HUB_H
+
+#include "udp.h"
+#include "loopback.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Longest the hub's I/O thread sleeps before checking for shutdown. */
+#define TRANSPORT_HUB_MAX_WAIT      100
+
+class HubTransport;
+
+/*
+ * One UDP socket shared by any number of sessions in the process, for
+ * hosting many matches at once.  A thread of the hub's own reads the
+ * socket and hands each datagram to the sessions that have sent to its
+ * source address; every GGPO peer sends to the addresses it was given
+ * from the start, so each session claims its peers before they can be
+ * heard from.  Datagrams nobody claims are counted and dropped.
+ *
+ * Each session keeps its own poll and state and is driven from whatever
+ * thread calls its ggpo_idle, so matches run in parallel on as many
+ * workers as the host gives them.  Only the socket is shared.
+ */
+class TransportHub : public Transport::Callbacks
+{
+public:
+   struct Stats {
+      int            sessions;
+      unsigned int   packets_received;
+      unsigned int   bytes_received;
+      unsigned int   packets_sent;
+      unsigned int   bytes_sent;
+      unsigned int   unrouted;
+      unsigned int   syscalls;
+   };
+
+public:
+   TransportHub();
+   virtual ~TransportHub();
+
+   /* Binds the socket and starts the I/O thread.  False if the bind fails. */
+   bool Init(uint16 port);
+
+   HubTransport *CreateChannel(Poll *poll, Transport::Callbacks *callbacks);
+   int GetChannelCount();
+   void GetStats(Stats *stats);
+
+   virtual void OnMsg(sockaddr_in &from, UdpMsg *msg, int len);
+
+protected:
+   friend class HubTransport;
+
+   void Attach(HubTransport *channel);
+   void Detach(HubTransport *channel);
+   void Send(HubTransport *channel, char *buffer, int len, int flags, struct sockaddr_in &dst);
+   void IoThreadMain();
+   void Log(const char *fmt, ...);
+
+   static uint64 AddressKey(const sockaddr_in &addr);
+
+   Poll                    _poll;
+   Udp                     _udp;
+   std::thread             _thread;
+   std::atomic<bool>       _shutdown;
+
+   /* Guards the socket and everything below. */
+   std::mutex              _mutex;
+   std::vector<HubTransport *>                        _channels;
+   std::map<uint64, std::vector<HubTransport *> >     _routes;
+   Stats                   _stats;
+};
+
+/*
+ * A session's side of a TransportHub.  The hub queues what it routes here
+ * and the session's poll collects it.  Sends inside a batch are held and
+ * go to the socket together, so a session takes the hub lock once per
+ * poll rather than once per datagram.
+ */
+class HubTransport : public QueuedTransport
+{
+public:
+   HubTransport(TransportHub *hub);
+   virtual ~HubTransport();
+
+   virtual void SendTo(char *buffer, int len, int flags, struct sockaddr *dst, int destlen);
+
+   virtual void BeginBatch();
+   virtual void EndBatch();
+   virtual bool IsBatching() const;
+   virtual unsigned int GetSyscallCount() const;
+
+protected:
+   friend class TransportHub;
+
+   TransportHub            *_hub;
+
+   /* Addresses this session has sent to; the hub routes them here. */
+   std::vector<uint64>     _claims;
+
+   int                     _batch_depth;
+   std::vector<Datagram>   _pending;
+};
+
+#endif
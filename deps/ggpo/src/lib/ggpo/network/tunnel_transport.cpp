@@ -0,0 +1,81 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#include "types.h"
+#include "tunnel_transport.h"
+
+TunnelTransport::TunnelTransport() :
+   QueuedTransport("tunnel | "),
+   _outbox_dropped(0),
+   _has_peer(false)
+{
+   memset(&_peer, 0, sizeof _peer);
+}
+
+void
+TunnelTransport::Init(Poll *poll, Transport::Callbacks *callbacks)
+{
+   _callbacks = callbacks;
+   poll->RegisterLoop(this);
+}
+
+void
+TunnelTransport::SendTo(char *buffer, int len, int flags, struct sockaddr *dst, int destlen)
+{
+   if (len <= 0 || len > MAX_UDP_PACKET_SIZE) {
+      return;
+   }
+   std::lock_guard<std::mutex> lock(_queue_mutex);
+   _peer = *(struct sockaddr_in *)dst;
+   _has_peer = true;
+   if (_outbox.size() >= LOOPBACK_QUEUE_MAX) {
+      _outbox_dropped++;
+      return;
+   }
+   _outbox.push_back(Datagram());
+   _outbox.back().from = _peer;
+   _outbox.back().data.assign((const uint8 *)buffer, (const uint8 *)buffer + len);
+}
+
+bool
+TunnelTransport::Read(void *buffer, int *len)
+{
+   int dropped = 0;
+   bool ok = true;
+   {
+      std::lock_guard<std::mutex> lock(_queue_mutex);
+      if (_outbox.empty()) {
+         *len = 0;
+      } else if ((int)_outbox.front().data.size() > *len) {
+         ok = false;
+      } else {
+         *len = (int)_outbox.front().data.size();
+         memcpy(buffer, &_outbox.front().data[0], *len);
+         _outbox.pop_front();
+      }
+      dropped = _outbox_dropped;
+      _outbox_dropped = 0;
+   }
+   if (dropped) {
+      Log("outbox full; dropped %d datagrams.\n", dropped);
+   }
+   return ok;
+}
+
+bool
+TunnelTransport::Write(const void *data, int len)
+{
+   sockaddr_in from;
+   {
+      std::lock_guard<std::mutex> lock(_queue_mutex);
+      if (!_has_peer) {
+         return false;
+      }
+      from = _peer;
+   }
+   return Deliver(from, (const char *)data, len);
+}
@@ -0,0 +1,48 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#ifndef _TUNNEL_TRANSPORT_H
+#define _TUNNEL_TRANSPORT_H
+
+#include "loopback.h"
+
+#include <deque>
+
+/*
+ * The Tunnel transport (ggpo_start_tunnel_session): datagrams the
+ * application carries to the one remote peer itself, over a link that
+ * isn't UDP such as a TCP tunnel.  Sends are queued for ggpo_tunnel_read
+ * and whatever ggpo_tunnel_write hands in is queued for the next poll, as
+ * coming from the address the session sends to.  Until it has sent
+ * anything there is nobody to hand it up for, and it's dropped; the sync
+ * handshake resends.
+ *
+ * Both queues are bounded like a socket buffer and drop what doesn't
+ * fit, so a link that backs up loses datagrams instead of delaying the
+ * ones after them.
+ */
+class TunnelTransport : public QueuedTransport
+{
+public:
+   TunnelTransport();
+
+   void Init(Poll *poll, Transport::Callbacks *callbacks);
+
+   /* Any thread.  *len is the room in buffer, then the datagram's length or 0. */
+   bool Read(void *buffer, int *len);
+   bool Write(const void *data, int len);
+
+   virtual void SendTo(char *buffer, int len, int flags, struct sockaddr *dst, int destlen);
+
+protected:
+   std::deque<Datagram>    _outbox;
+   int                     _outbox_dropped;
+   sockaddr_in             _peer;               /* under _queue_mutex */
+   bool                    _has_peer;
+};
+
+#endif
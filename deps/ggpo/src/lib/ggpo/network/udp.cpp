@@ -5,6 +5,11 @@
  * in the LICENSE file.
  */
 
+/* recvmmsg/sendmmsg are GNU extensions in glibc. */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include "types.h"
 #include "udp.h"
 
@@ -14,6 +19,12 @@
 #include <unistd.h>
 #endif
 
+#if defined(__linux__) && !defined(GGPO_NO_MMSG)
+#define GGPO_UDP_MMSG 1
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
 SOCKET
 CreateSocket(uint16 bind_port, int retries)
 {
@@ -57,6 +68,13 @@ CreateSocket(uint16 bind_port, int retries)
 
 Udp::Udp() :
    _socket(INVALID_SOCKET),
+#ifdef _WIN32
+   _event(WSA_INVALID_EVENT),
+#endif
+   _syscalls(0),
+   _batch_size(0),
+   _batch_depth(0),
+   _send_count(0),
    _callbacks(NULL)
 {
 }
@@ -67,6 +85,12 @@ Udp::~Udp(void)
       closesocket(_socket);
       _socket = INVALID_SOCKET;
    }
+#ifdef _WIN32
+   if (_event != WSA_INVALID_EVENT) {
+      WSACloseEvent(_event);
+      _event = WSA_INVALID_EVENT;
+   }
+#endif
 }
 
 void
@@ -79,14 +103,129 @@ Udp::Init(uint16 port, Poll *poll, Callbacks *callbacks)
 
    Log("binding udp socket to port %d.\n", port);
    _socket = CreateSocket(port, 0);
+
+   /*
+    * Let Poll block on the socket.  The data itself is still read from
+    * OnLoopPoll, which runs after every wait.
+    */
+   if (_socket != INVALID_SOCKET) {
+#ifdef _WIN32
+      _event = WSACreateEvent();
+      if (_event != WSA_INVALID_EVENT &&
+          WSAEventSelect(_socket, _event, FD_READ) != SOCKET_ERROR) {
+         _poll->RegisterHandle(this, _event);
+      }
+#else
+      _poll->RegisterHandle(this, _socket);
+#endif
+   }
+
+#ifdef GGPO_UDP_MMSG
+   _batch_size = Platform::GetConfigInt("ggpo.udp.batch");
+   if (_batch_size == 0) {
+      _batch_size = UDP_IO_BATCH_SIZE;
+   }
+   _batch_size = MIN(MAX(_batch_size, 0), UDP_IO_BATCH_MAX);
+#endif
+   if (_batch_size > 0) {
+      _send_buf.resize(_batch_size * MAX_UDP_PACKET_SIZE);
+      _send_len.resize(_batch_size);
+      _send_addr.resize(_batch_size);
+      _recv_buf.resize(_batch_size * MAX_UDP_PACKET_SIZE);
+      _recv_addr.resize(_batch_size);
+   }
+   Log("udp batched io %s (batch %d).\n", _batch_size > 0 ? "on" : "off", _batch_size);
 }
 
 void
 Udp::SendTo(char *buffer, int len, int flags, struct sockaddr *dst, int destlen)
+{
+   if (_batch_depth <= 0 || _batch_size <= 0 || flags != 0 ||
+       len > MAX_UDP_PACKET_SIZE || destlen != sizeof(sockaddr_in)) {
+      SendNow(buffer, len, flags, dst, destlen);
+      return;
+   }
+   memcpy(&_send_buf[_send_count * MAX_UDP_PACKET_SIZE], buffer, len);
+   _send_len[_send_count] = len;
+   _send_addr[_send_count] = *(sockaddr_in *)dst;
+   if (++_send_count == _batch_size) {
+      Flush();
+   }
+}
+
+void
+Udp::BeginBatch()
+{
+   _batch_depth++;
+}
+
+void
+Udp::EndBatch()
+{
+   ASSERT(_batch_depth > 0);
+   if (--_batch_depth == 0) {
+      Flush();
+   }
+}
+
+void
+Udp::Flush()
+{
+   int count = _send_count;
+   int sent = 0;
+
+   _send_count = 0;
+   if (count == 0) {
+      return;
+   }
+#ifdef GGPO_UDP_MMSG
+   struct mmsghdr msgs[UDP_IO_BATCH_MAX];
+   struct iovec iov[UDP_IO_BATCH_MAX];
+
+   memset(msgs, 0, sizeof(msgs[0]) * count);
+   for (int i = 0; i < count; i++) {
+      iov[i].iov_base = &_send_buf[i * MAX_UDP_PACKET_SIZE];
+      iov[i].iov_len = _send_len[i];
+      msgs[i].msg_hdr.msg_name = &_send_addr[i];
+      msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+      msgs[i].msg_hdr.msg_iov = &iov[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+   }
+   while (sent < count) {
+      int res = sendmmsg(_socket, msgs + sent, count - sent, 0);
+      _syscalls++;
+      if (res <= 0) {
+         int err = errno;
+         if (err == ENOSYS || err == EINVAL) {
+            Log("sendmmsg unavailable (errno %d); using sendto.\n", err);
+            _batch_size = 0;
+         } else if (err != EWOULDBLOCK && err != EAGAIN) {
+            Log("unknown error in sendmmsg (error: %d  errno: %d).\n", res, err);
+            ASSERT(FALSE && "Unknown error in sendmmsg");
+         }
+         break;
+      }
+      sent += res;
+   }
+   LogVerbose("sent %d of %d packets in one batch.\n", sent, count);
+   if (_batch_size > 0) {
+      return;
+   }
+#endif
+   /* Fallback, and whatever a failed sendmmsg left behind. */
+   for (int i = sent; i < count; i++) {
+      SendNow((char *)&_send_buf[i * MAX_UDP_PACKET_SIZE], _send_len[i], 0,
+              (struct sockaddr *)&_send_addr[i], sizeof(sockaddr_in));
+   }
+}
+
+void
+Udp::SendNow(char *buffer, int len, int flags, struct sockaddr *dst, int destlen)
 {
    struct sockaddr_in *to = (struct sockaddr_in *)dst;
 
    int res = sendto(_socket, buffer, len, flags, dst, destlen);
+   _syscalls++;
    if (res == SOCKET_ERROR) {
 #ifdef _WIN32
       int err = WSAGetLastError();
@@ -97,19 +236,95 @@ Udp::SendTo(char *buffer, int len, int flags, struct sockaddr *dst, int destlen)
       ASSERT(FALSE && "Unknown error in sendto");
    }
    char dst_ip[1024];
-   Log("sent packet length %d to %s:%d (ret:%d).\n", len, inet_ntop(AF_INET, (void *)&to->sin_addr, dst_ip, ARRAY_SIZE(dst_ip)), ntohs(to->sin_port), res);
+   LogVerbose("sent packet length %d to %s:%d (ret:%d).\n", len, inet_ntop(AF_INET, (void *)&to->sin_addr, dst_ip, ARRAY_SIZE(dst_ip)), ntohs(to->sin_port), res);
+}
+
+bool
+Udp::OnHandlePoll(void *cookie)
+{
+#ifdef _WIN32
+   // FD_READ is re-signalled by the next recv if data remains.
+   WSAResetEvent(_event);
+#endif
+   return true;
 }
 
 bool
 Udp::OnLoopPoll(void *cookie)
+{
+   /* Replies sent from OnMsg go out together once the socket is drained. */
+   BeginBatch();
+   if (_batch_size <= 0 || !ReceiveBatch()) {
+      ReceiveEach();
+   }
+   EndBatch();
+   return true;
+}
+
+/*
+ * Drains the socket with recvmmsg.  Returns false if the call is not
+ * supported, leaving the socket for ReceiveEach.
+ */
+bool
+Udp::ReceiveBatch()
+{
+#ifdef GGPO_UDP_MMSG
+   struct mmsghdr msgs[UDP_IO_BATCH_MAX];
+   struct iovec iov[UDP_IO_BATCH_MAX];
+   int count = _batch_size;
+
+   for (;;) {
+      memset(msgs, 0, sizeof(msgs[0]) * count);
+      for (int i = 0; i < count; i++) {
+         iov[i].iov_base = &_recv_buf[i * MAX_UDP_PACKET_SIZE];
+         iov[i].iov_len = MAX_UDP_PACKET_SIZE;
+         msgs[i].msg_hdr.msg_name = &_recv_addr[i];
+         msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+         msgs[i].msg_hdr.msg_iov = &iov[i];
+         msgs[i].msg_hdr.msg_iovlen = 1;
+      }
+      int res = recvmmsg(_socket, msgs, count, 0, NULL);
+      _syscalls++;
+      if (res < 0) {
+         int error = errno;
+         if (error == ENOSYS || error == EINVAL) {
+            Log("recvmmsg unavailable (errno %d); using recvfrom.\n", error);
+            _batch_size = 0;
+            return false;
+         }
+         if (error != EWOULDBLOCK && error != EAGAIN) {
+            Log("recvmmsg errno returned %d (%x).\n", error, error);
+         }
+         return true;
+      }
+      for (int i = 0; i < res; i++) {
+         int len = (int)msgs[i].msg_len;
+         if (len > 0) {
+            UdpMsg *msg = (UdpMsg *)&_recv_buf[i * MAX_UDP_PACKET_SIZE];
+            _callbacks->OnMsg(_recv_addr[i], msg, len);
+         }
+      }
+      LogVerbose("recvmmsg returned %d packets.\n", res);
+      if (res < count) {
+         return true;
+      }
+   }
+#else
+   return false;
+#endif
+}
+
+void
+Udp::ReceiveEach()
 {
    uint8          recv_buf[MAX_UDP_PACKET_SIZE];
    sockaddr_in    recv_addr;
-   int            recv_addr_len;
+   socklen_t      recv_addr_len;
 
    for (;;) {
       recv_addr_len = sizeof(recv_addr);
       int len = recvfrom(_socket, (char *)recv_buf, MAX_UDP_PACKET_SIZE, 0, (struct sockaddr *)&recv_addr, &recv_addr_len);
+      _syscalls++;
 
       // TODO: handle len == 0... indicates a disconnect.
 
@@ -128,12 +343,11 @@ Udp::OnLoopPoll(void *cookie)
          break;
       } else if (len > 0) {
          char src_ip[1024];
-         Log("recvfrom returned (len:%d  from:%s:%d).\n", len, inet_ntop(AF_INET, (void*)&recv_addr.sin_addr, src_ip, ARRAY_SIZE(src_ip)), ntohs(recv_addr.sin_port) );
+         LogVerbose("recvfrom returned (len:%d  from:%s:%d).\n", len, inet_ntop(AF_INET, (void*)&recv_addr.sin_addr, src_ip, ARRAY_SIZE(src_ip)), ntohs(recv_addr.sin_port) );
          UdpMsg *msg = (UdpMsg *)recv_buf;
          _callbacks->OnMsg(recv_addr, msg, len);
       } 
    }
-   return true;
 }
 
 
@@ -144,6 +358,9 @@ Udp::Log(const char *fmt, ...)
    size_t offset;
    va_list args;
 
+   if (!LogEnabled(GGPO_LOG_INFO)) {
+      return;
+   }
    strcpy_s(buf, "udp | ");
    offset = strlen(buf);
    va_start(args, fmt);
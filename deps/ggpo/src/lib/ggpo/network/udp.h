@@ -10,14 +10,23 @@
 
 #include "poll.h"
 #include "udp_msg.h"
+#include "transport.h"
 #include "ggponet.h"
 #include "ring_buffer.h"
 
+#include <vector>
+
 #define MAX_UDP_ENDPOINTS     16
 
-static const int MAX_UDP_PACKET_SIZE = 4096;
+/*
+ * Datagrams moved per recvmmsg/sendmmsg call where the platform has them
+ * (Linux).  Override with ggpo.udp.batch; negative disables batching.
+ */
+#define UDP_IO_BATCH_SIZE     16
+#define UDP_IO_BATCH_MAX      64
 
-class Udp : public IPollSink
+/* The Socket transport: one non-blocking UDP socket. */
+class Udp : public Transport
 {
 public:
    struct Stats {
@@ -26,12 +35,6 @@ public:
       float    kbps_sent;
    };
 
-   struct Callbacks {
-      virtual ~Callbacks() { }
-      virtual void OnMsg(sockaddr_in &from, UdpMsg *msg, int len) = 0;
-   };
-
-
 protected:
    void Log(const char *fmt, ...);
 
@@ -40,16 +43,48 @@ public:
 
    void Init(uint16 port, Poll *p, Callbacks *callbacks);
    
-   void SendTo(char *buffer, int len, int flags, struct sockaddr *dst, int destlen);
+   virtual void SendTo(char *buffer, int len, int flags, struct sockaddr *dst, int destlen);
+
+   /*
+    * Sends made between BeginBatch and the matching EndBatch are queued and
+    * flushed together (one sendmmsg per UDP_IO_BATCH_SIZE datagrams).
+    */
+   virtual void BeginBatch();
+   virtual void EndBatch();
+   void Flush();
+
+   bool IsBound() const { return _socket != INVALID_SOCKET; }
+
+   virtual bool IsBatching() const { return _batch_size > 0; }
+   virtual unsigned int GetSyscallCount() const { return _syscalls; }
 
    virtual bool OnLoopPoll(void *cookie);
+   virtual bool OnHandlePoll(void *cookie);
 
 public:
    ~Udp(void);
 
 protected:
+   void SendNow(char *buffer, int len, int flags, struct sockaddr *dst, int destlen);
+   bool ReceiveBatch();
+   void ReceiveEach();
+
    // Network transmission information
    SOCKET         _socket;
+#ifdef _WIN32
+   WSAEVENT       _event;     // signalled by FD_READ so Poll can wait on it
+#endif
+   unsigned int   _syscalls;
+
+   // batched io; slots are MAX_UDP_PACKET_SIZE bytes each
+   int            _batch_size;
+   int            _batch_depth;
+   int            _send_count;
+   std::vector<uint8>         _send_buf;
+   std::vector<int>           _send_len;
+   std::vector<sockaddr_in>   _send_addr;
+   std::vector<uint8>         _recv_buf;
+   std::vector<sockaddr_in>   _recv_addr;
 
    // state management
    Callbacks      *_callbacks;
@@ -11,6 +11,46 @@
 #define MAX_COMPRESSED_BITS       4096
 #define UDP_MSG_MAX_PLAYERS          4
 
+/*
+ * Wire version 2 adds InputCompact, version 3 its field input codec,
+ * version 4 quality reports carried on it, version 5 confirmed-frame
+ * checksums in quality reports, version 6 microsecond ping timestamps,
+ * version 7 mid-match rejoins (sync_request.flags, StateChunk, StateAck)
+ * and version 8 application control messages (Control, ControlAck).
+ * Peers state their version, input size
+ * and player count in the sync handshake; a version 1 peer sends the
+ * shorter sync messages and keeps getting plain Input.
+ */
+#define UDP_WIRE_VERSION             8    /* 8: control messages */
+
+/* sync_request flags */
+#define UDP_SYNC_REJOIN              0x01  /* a restarted peer picking up a running match */
+
+/* Bytes of the rejoin state in each StateChunk. */
+#define UDP_STATE_CHUNK_SIZE         1024
+
+/* Largest Control payload, see ggpo_send_control. */
+#define UDP_CONTROL_MAX_SIZE         16
+
+/* InputCompact flags */
+#define UDP_COMPACT_DISCONNECT       0x01
+#define UDP_COMPACT_HAS_INPUT        0x02  /* start_frame, num_bits and bits present */
+#define UDP_COMPACT_STATUS_FRAMES    0x04  /* connect status last_frames present */
+#define UDP_COMPACT_COPY             0x08  /* redundant resend, like InputCopy */
+#define UDP_COMPACT_FIELD_CODEC      0x10  /* bits use INPUT_CODEC_FIELD, see input_codec.h */
+#define UDP_COMPACT_QUALITY_REPORT   0x20  /* a QualityReport follows the bits */
+#define UDP_COMPACT_QUALITY_REPLY    0x40  /* a QualityReply follows that */
+#define UDP_COMPACT_QUALITY_CHECKSUM 0x80  /* then a confirmed-frame checksum */
+
+#define UDP_COMPACT_REPORT_SIZE      6     /* frame_advantage, loss_percent, ping */
+#define UDP_COMPACT_REPLY_SIZE       4     /* pong */
+#define UDP_COMPACT_CHECKSUM_SIZE    8     /* checksum_frame, checksum */
+
+/* varints for ack, start, num_bits and one last_frame per player, bits, then quality */
+#define UDP_COMPACT_MAX_DATA         (5 * (3 + UDP_MSG_MAX_PLAYERS) + 1 + MAX_COMPRESSED_BITS / 8 + \
+                                      UDP_COMPACT_REPORT_SIZE + UDP_COMPACT_REPLY_SIZE + \
+                                      UDP_COMPACT_CHECKSUM_SIZE)
+
 #pragma pack(push, 1)
 
 struct UdpMsg
@@ -24,6 +64,12 @@ struct UdpMsg
       QualityReply  = 5,
       KeepAlive     = 6,
       InputAck      = 7,
+      InputCopy     = 8,    /* redundant resend of an Input, same sequence number */
+      InputCompact  = 9,    /* wire version 2 Input, see UDP_COMPACT_* */
+      StateChunk    = 10,   /* wire version 7, the state a rejoining peer resumes from */
+      StateAck      = 11,
+      Control       = 12,   /* wire version 8, application data sent until acked */
+      ControlAck    = 13,
    };
 
    struct connect_status {
@@ -41,15 +87,29 @@ struct UdpMsg
          uint32      random_request;  /* please reply back with this random data */
          uint16      remote_magic;
          uint8       remote_endpoint;
+         uint8       prediction_frames;  /* sender's prediction window, 0 = no preference */
+         uint8       keyframe_interval;  /* sender's keyframe interval, 0 = no preference */
+         uint8       wire_version;       /* missing from version 1 peers */
+         uint8       input_size;         /* bytes per GameInput the sender sends, 0 = varies */
+         uint8       num_players;
+         uint8       flags;              /* UDP_SYNC_*, wire version 7 */
       } sync_request;
       
       struct {
          uint32      random_reply;    /* OK, here's your random data back */
+         uint8       prediction_frames;
+         uint8       keyframe_interval;
+         uint8       wire_version;
+         uint8       input_size;
+         uint8       num_players;
       } sync_reply;
       
       struct {
          int8        frame_advantage; /* what's the other guy's frame advantage? */
-         uint32      ping;
+         uint32      ping;            /* sender's clock, ms or us (wire version 6) */
+         uint8       loss_percent;    /* of our packets since the last report */
+         int32       checksum_frame;  /* wire version 5; -1 when none is due */
+         uint32      checksum;        /* of the state saved at checksum_frame */
       } quality_report;
       
       struct {
@@ -69,10 +129,63 @@ struct UdpMsg
          uint8             bits[MAX_COMPRESSED_BITS]; /* must be last */
       } input;
 
+      /*
+       * Same content as input, byte packed.  data holds, in order:
+       *   varint   ack_frame + 1
+       *   zigzag   start_frame - ack_frame       (UDP_COMPACT_HAS_INPUT)
+       *   varint   num_bits                      (UDP_COMPACT_HAS_INPUT)
+       *   uint8    player count << 4 | disconnected mask
+       *   zigzag   last_frame - ack_frame each   (UDP_COMPACT_STATUS_FRAMES)
+       *   bits                                   (UDP_COMPACT_HAS_INPUT)
+       *   int8, uint8, uint32 quality_report     (UDP_COMPACT_QUALITY_REPORT)
+       *   uint32 quality_reply.pong              (UDP_COMPACT_QUALITY_REPLY)
+       *   uint32 checksum_frame, uint32 checksum (UDP_COMPACT_QUALITY_CHECKSUM)
+       * input_size comes from the sync handshake.  The uint32s are little
+       * endian.
+       */
+      struct {
+         uint8             flags;
+         uint8             data[UDP_COMPACT_MAX_DATA]; /* must be last */
+      } input_compact;
+
       struct {
          int               ack_frame:31;
       } input_ack;
 
+      /*
+       * The rejoin state is sent in order, UDP_STATE_CHUNK_SIZE bytes at a
+       * time; the receiver acks how much of it it has.  codec and raw_size
+       * describe the whole of it, see Peer2PeerBackend::SendRejoinState.
+       */
+      struct {
+         int32             frame;
+         uint32            size;
+         uint32            raw_size;
+         uint32            offset;
+         uint16            length;
+         uint8             codec;
+         uint8             data[UDP_STATE_CHUNK_SIZE]; /* must be last */
+      } state_chunk;
+
+      struct {
+         int32             frame;
+         uint32            offset;          /* bytes received so far */
+      } state_ack;
+
+      /*
+       * ids count up from 1 per sender; a resend keeps its id and the
+       * receiver acks every copy but passes each id on once.
+       */
+      struct {
+         uint32            id;
+         uint8             length;
+         uint8             data[UDP_CONTROL_MAX_SIZE]; /* must be last */
+      } control;
+
+      struct {
+         uint32            id;
+      } control_ack;
+
    } u;
 
 public:
@@ -89,17 +202,127 @@ public:
       case QualityReport: return sizeof(u.quality_report);
       case QualityReply:  return sizeof(u.quality_reply);
       case InputAck:      return sizeof(u.input_ack);
+      case StateAck:      return sizeof(u.state_ack);
+      case ControlAck:    return sizeof(u.control_ack);
+      case Control:
+         return (int)((char *)&u.control.data - (char *)&u.control) + u.control.length;
+      case StateChunk:
+         return (int)((char *)&u.state_chunk.data - (char *)&u.state_chunk) + u.state_chunk.length;
       case KeepAlive:     return 0;
       case Input:
+      case InputCopy:
          size = (int)((char *)&u.input.bits - (char *)&u.input);
          size += (u.input.num_bits + 7) / 8;
          return size;
+      case InputCompact:
+         size = CompactInputSize();
+         ASSERT(size > 0);
+         return size;
       }
       ASSERT(false);
       return 0;
    }
 
    UdpMsg(MsgType t) { hdr.type = (uint8)t; }
+
+   bool IsInput() {
+      return hdr.type == Input || hdr.type == InputCopy || hdr.type == InputCompact;
+   }
+
+   bool IsInputCopy() {
+      return hdr.type == InputCopy ||
+             (hdr.type == InputCompact && (u.input_compact.flags & UDP_COMPACT_COPY));
+   }
+
+   /*
+    * Walks an InputCompact payload of at most len bytes.  Returns its size,
+    * or -1 if it runs past len.
+    */
+   int CompactInputSize(int len = (int)sizeof(u.input_compact)) {
+      const uint8 *start = (const uint8 *)&u.input_compact;
+      const uint8 *end = start + len;
+      const uint8 *p = u.input_compact.data;
+      uint32 value, num_bits = 0;
+      int count;
+
+      if (len < 1 || !(p = GetVarint(p, end, &value))) {
+         return -1;
+      }
+      if (u.input_compact.flags & UDP_COMPACT_HAS_INPUT) {
+         if (!(p = GetVarint(p, end, &value)) || !(p = GetVarint(p, end, &num_bits))) {
+            return -1;
+         }
+      }
+      if (p >= end) {
+         return -1;
+      }
+      count = *p++ >> 4;
+      if (u.input_compact.flags & UDP_COMPACT_STATUS_FRAMES) {
+         for (int i = 0; i < count; i++) {
+            if (!(p = GetVarint(p, end, &value))) {
+               return -1;
+            }
+         }
+      }
+      if (num_bits >= MAX_COMPRESSED_BITS || (int)(end - p) < (int)((num_bits + 7) / 8)) {
+         return -1;
+      }
+      p += (num_bits + 7) / 8;
+      if (u.input_compact.flags & UDP_COMPACT_QUALITY_REPORT) {
+         p += UDP_COMPACT_REPORT_SIZE;
+      }
+      if (u.input_compact.flags & UDP_COMPACT_QUALITY_REPLY) {
+         p += UDP_COMPACT_REPLY_SIZE;
+      }
+      if (u.input_compact.flags & UDP_COMPACT_QUALITY_CHECKSUM) {
+         p += UDP_COMPACT_CHECKSUM_SIZE;
+      }
+      if (p > end) {
+         return -1;
+      }
+      return (int)(p - start);
+   }
+
+   /* LEB128: 7 bits per byte, low group first, high bit set on all but the last. */
+   static uint8 *PutVarint(uint8 *p, uint32 value) {
+      while (value >= 0x80) {
+         *p++ = (uint8)(value | 0x80);
+         value >>= 7;
+      }
+      *p++ = (uint8)value;
+      return p;
+   }
+
+   static const uint8 *GetVarint(const uint8 *p, const uint8 *end, uint32 *value) {
+      uint32 result = 0;
+      for (int shift = 0; shift < 35; shift += 7) {
+         if (p >= end) {
+            return NULL;
+         }
+         uint8 b = *p++;
+         result |= (uint32)(b & 0x7f) << shift;
+         if (!(b & 0x80)) {
+            *value = result;
+            return p;
+         }
+      }
+      return NULL;
+   }
+
+   static uint8 *PutUint32(uint8 *p, uint32 value) {
+      for (int i = 0; i < 4; i++) {
+         *p++ = (uint8)(value >> (8 * i));
+      }
+      return p;
+   }
+
+   static const uint8 *GetUint32(const uint8 *p, uint32 *value) {
+      *value = (uint32)p[0] | ((uint32)p[1] << 8) | ((uint32)p[2] << 16) | ((uint32)p[3] << 24);
+      return p + 4;
+   }
+
+   static uint32 ZigZag(int value) { return ((uint32)value << 1) ^ (uint32)(value >> 31); }
+   static int UnZigZag(uint32 value) { return (int)(value >> 1) ^ -(int)(value & 1); }
 };
 
 #pragma pack(pop)
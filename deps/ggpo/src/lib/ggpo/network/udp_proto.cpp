@@ -7,11 +7,7 @@
 
 #include "types.h"
 #include "udp_proto.h"
-#include "bitvector.h"
-
-#if defined(_MSC_VER)
-#include <intrin.h>
-#endif
+#include "input_codec.h"
 
 static const int UDP_HEADER_SIZE = 28;     /* Size of IP + UDP headers */
 static const int NUM_SYNC_PACKETS = 5;
@@ -23,7 +19,6 @@ static const int QUALITY_REPORT_INTERVAL = 1000;
 static const int NETWORK_STATS_INTERVAL  = 1000;
 static const int UDP_SHUTDOWN_TIMER = 5000;
 static const int MAX_SEQ_DISTANCE = (1 << 15);
-static const int INPUT_BITS_PER_CHANGE = 2 + BITVECTOR_NIBBLE_SIZE;
 
 static bool SockAddrEqual(const sockaddr_in &a, const sockaddr_in &b)
 {
@@ -34,167 +29,67 @@ static bool SockAddrEqual(const sockaddr_in &a, const sockaddr_in &b)
 #endif
 }
 
-static inline uint32 LoadLE32(const uint8 *ptr)
-{
-   return (uint32)ptr[0]
-      | ((uint32)ptr[1] << 8)
-      | ((uint32)ptr[2] << 16)
-      | ((uint32)ptr[3] << 24);
-}
-
-static inline int Popcount32(uint32 value)
-{
-#if defined(_MSC_VER)
-   return (int)__popcnt(value);
-#elif defined(__GNUC__) || defined(__clang__)
-   return __builtin_popcount(value);
-#else
-   int count = 0;
-   while (value) {
-      value &= (value - 1);
-      count++;
-   }
-   return count;
-#endif
-}
-
-static inline int Ctz32(uint32 value)
-{
-#if defined(_MSC_VER)
-   unsigned long index = 0;
-   _BitScanForward(&index, value);
-   return (int)index;
-#elif defined(__GNUC__) || defined(__clang__)
-   return __builtin_ctz(value);
-#else
-   int count = 0;
-   while ((value & 1) == 0) {
-      value >>= 1;
-      count++;
-   }
-   return count;
-#endif
-}
-
-static inline int GetBitValue(const uint8 *bits, int index)
-{
-   return (bits[index / 8] & (1 << (index % 8))) != 0;
-}
-
-static int CountDiffBits(const GameInput &current, const GameInput &last)
-{
-   const uint8 *cur = (const uint8 *)current.bits;
-   const uint8 *prev = (const uint8 *)last.bits;
-   int byte_len = current.size;
-   int count = 0;
-   int full_words = byte_len / 4;
-
-   for (int i = 0; i < full_words; ++i) {
-      uint32 diff = LoadLE32(cur + (i * 4)) ^ LoadLE32(prev + (i * 4));
-      if (diff) {
-         count += Popcount32(diff);
-      }
-   }
-
-   int tail = byte_len - (full_words * 4);
-   if (tail > 0) {
-      uint32 cur_tail = 0;
-      uint32 prev_tail = 0;
-      const uint8 *cur_ptr = cur + (full_words * 4);
-      const uint8 *prev_ptr = prev + (full_words * 4);
-      for (int i = 0; i < tail; ++i) {
-         cur_tail |= ((uint32)cur_ptr[i]) << (8 * i);
-         prev_tail |= ((uint32)prev_ptr[i]) << (8 * i);
-      }
-      uint32 diff = cur_tail ^ prev_tail;
-      if (diff) {
-         count += Popcount32(diff);
-      }
-   }
-
-   return count;
-}
-
-static void EmitDiffBits(uint8 *vector, int *offset, const GameInput &current, const GameInput &last)
-{
-   const uint8 *cur = (const uint8 *)current.bits;
-   const uint8 *prev = (const uint8 *)last.bits;
-   int byte_len = current.size;
-   int full_words = byte_len / 4;
-   int bit_base = 0;
-
-   for (int i = 0; i < full_words; ++i) {
-      uint32 diff = LoadLE32(cur + (i * 4)) ^ LoadLE32(prev + (i * 4));
-      while (diff) {
-         int bit = Ctz32(diff);
-         int index = bit_base + bit;
-         BitVector_SetBit(vector, offset);
-         if (GetBitValue(cur, index)) {
-            BitVector_SetBit(vector, offset);
-         } else {
-            BitVector_ClearBit(vector, offset);
-         }
-         BitVector_WriteNibblet(vector, index, offset);
-         diff &= (diff - 1);
-      }
-      bit_base += 32;
-   }
-
-   int tail = byte_len - (full_words * 4);
-   if (tail > 0) {
-      uint32 cur_tail = 0;
-      uint32 prev_tail = 0;
-      const uint8 *cur_ptr = cur + (full_words * 4);
-      const uint8 *prev_ptr = prev + (full_words * 4);
-      for (int i = 0; i < tail; ++i) {
-         cur_tail |= ((uint32)cur_ptr[i]) << (8 * i);
-         prev_tail |= ((uint32)prev_ptr[i]) << (8 * i);
-      }
-      uint32 diff = cur_tail ^ prev_tail;
-      while (diff) {
-         int bit = Ctz32(diff);
-         int index = bit_base + bit;
-         BitVector_SetBit(vector, offset);
-         if (GetBitValue(cur, index)) {
-            BitVector_SetBit(vector, offset);
-         } else {
-            BitVector_ClearBit(vector, offset);
-         }
-         BitVector_WriteNibblet(vector, index, offset);
-         diff &= (diff - 1);
-      }
-   }
-}
-
-static int EstimateInputBits(const GameInput &current, const GameInput &last)
-{
-   int bits = 1; // frame terminator
-   int changed_bits = CountDiffBits(current, last);
-   if (changed_bits) {
-      bits += changed_bits * INPUT_BITS_PER_CHANGE;
-   }
-   return bits;
-}
-
 UdpProtocol::UdpProtocol() :
-   _local_frame_advantage(0),
-   _remote_frame_advantage(0),
-   _queue(-1),
+   _transport(NULL),
    _magic_number(0),
+   _queue(-1),
    _remote_magic_number(0),
+   _connected(false),
+   _round_trip_us(0),
    _packets_sent(0),
    _bytes_sent(0),
    _stats_start_time(0),
+   _peer_status_changed(0),
+   _local_frame_advantage(0),
+   _remote_frame_advantage(0),
+   _encode_cache(NULL),
    _last_send_time(0),
    _shutdown_timeout(0),
+   _disconnect_event_sent(false),
    _disconnect_timeout(0),
    _disconnect_notify_start(0),
    _disconnect_notify_sent(false),
-   _disconnect_event_sent(false),
-   _connected(false),
    _next_send_seq(0),
    _next_recv_seq(0),
-   _udp(NULL)
+   _fec_mode(0),
+   _fec_level(0),
+   _fec_copies_sent(0),
+   _fec_recovered(0),
+   _input_resent(0),
+   _recv_packets(0),
+   _recv_lost(0),
+   _remote_loss_percent(0),
+   _compact_input(true),
+   _input_codec_mode(INPUT_CODEC_COUNT),
+   _local_input_size(0),
+   _local_num_players(0),
+   _remote_wire_version(1),
+   _remote_input_size(0),
+   _remote_num_players(0),
+   _status_unsent_packets(UDP_COMPACT_STATUS_REFRESH),
+   _coalesce(true),
+   _quality_report_due(0),
+   _quality_reply_pending(false),
+   _quality_reply_pong(0),
+   _quality_reply_recv_time(0),
+   _quality_reply_recv_us(0),
+   _last_input_send_time(0),
+   _input_deferred(false),
+   _coalesced(0),
+   _checksum_frame(-1),
+   _checksum(0),
+   _remote_checksum_frame(-1),
+   _sync_prediction_frames(0),
+   _sync_keyframe_interval(0),
+   _remote_prediction_frames(0),
+   _remote_keyframe_interval(0),
+   _reconnect_window(0),
+   _rejoin_outage_start(0),
+   _control_id(0),
+   _control_head(0),
+   _control_count(0),
+   _control_send_time(0),
+   _remote_control_id(0)
 {
    _last_sent_input.init(-1, NULL, 1);
    _last_received_input.init(-1, NULL, 1);
@@ -207,6 +102,10 @@ UdpProtocol::UdpProtocol() :
    }
    memset(&_peer_addr, 0, sizeof _peer_addr);
    _oo_packet.msg = NULL;
+   _fec_copy.msg = NULL;
+   _fec_copy.send_time = 0;
+   _fec_copy.remaining = 0;
+   memset(_last_sent_status, 0, sizeof(_last_sent_status));
 
    _send_latency = Platform::GetConfigInt("ggpo.network.delay");
    _send_interval = Platform::GetConfigInt("ggpo.network.send_interval");
@@ -214,26 +113,44 @@ UdpProtocol::UdpProtocol() :
       _send_interval = 0;
    }
    _oop_percent = Platform::GetConfigInt("ggpo.oop.percent");
+   _drop_percent = Platform::GetConfigInt("ggpo.network.drop_percent");
+   _drop_input_originals = Platform::GetConfigInt("ggpo.network.drop_input_originals") > 0;
+   _strict_sync_config = Platform::GetConfigInt("ggpo.sync.strict_config") != 0;
    _max_input_bits = Platform::GetConfigInt("ggpo.network.max_input_bits");
    if (_max_input_bits <= 0 || _max_input_bits > (MAX_COMPRESSED_BITS - 1)) {
       _max_input_bits = MAX_COMPRESSED_BITS - 1;
    }
+   _fec_mode = Platform::GetConfigInt("ggpo.network.fec");
+   if (_fec_mode < 0 || _fec_mode > UDP_FEC_ADAPTIVE) {
+      _fec_mode = 0;
+   }
+   UpdateFecLevel();
+   _compact_input = Platform::GetConfigInt("ggpo.network.compact_input") >= 0;
+   _coalesce = Platform::GetConfigInt("ggpo.network.coalesce") >= 0;
+   /* ggpo.network.input_codec: 0 auto, 1 bitvector, 2 field; negative is bitvector. */
+   int input_codec = Platform::GetConfigInt("ggpo.network.input_codec");
+   if (input_codec < 0 || input_codec == 1) {
+      _input_codec_mode = INPUT_CODEC_BITVECTOR;
+   } else if (input_codec == 2) {
+      _input_codec_mode = INPUT_CODEC_FIELD;
+   }
 }
 
 UdpProtocol::~UdpProtocol()
 {
    ClearSendQueue();
+   delete _fec_copy.msg;
 }
 
 void
-UdpProtocol::Init(Udp *udp,
+UdpProtocol::Init(Transport *transport,
                   Poll &poll,
                   int queue,
                   char *ip,
                   u_short port,
                   UdpMsg::connect_status *status)
 {  
-   _udp = udp;
+   _transport = transport;
    _queue = queue;
    _local_connect_status = status;
 
@@ -250,7 +167,7 @@ UdpProtocol::Init(Udp *udp,
 void
 UdpProtocol::SendInput(GameInput &input)
 {
-   if (_udp) {
+   if (_transport) {
       if (_current_state == Running) {
          /*
           * Check to see if this is a good time to adjust for the rift...
@@ -274,45 +191,49 @@ UdpProtocol::SendInput(GameInput &input)
 void
 UdpProtocol::SendPendingOutput()
 {
-   if (_send_interval > 0 && _last_send_time) {
-      unsigned int now = Platform::GetCurrentTimeMS();
-      if (now - _last_send_time < (unsigned int)_send_interval) {
-         return;
-      }
+   /* The rejoining peer can't use input until it has the state. */
+   if (_state_send.active) {
+      return;
+   }
+   unsigned int now = Platform::GetCurrentTimeMS();
+   if (_send_interval > 0 && _last_input_send_time &&
+       now - _last_input_send_time < (unsigned int)_send_interval) {
+      _input_deferred = true;
+      return;
    }
+   _input_deferred = false;
+   _last_input_send_time = now;
 
    UdpMsg *msg = new UdpMsg(UdpMsg::Input);
-   int j, offset = 0;
-   uint8 *bits;
-   GameInput last;
+   int offset = 0;
+   InputCodecId codec = INPUT_CODEC_BITVECTOR;
+   bool compact = UseCompactInput(_pending_output.size() ? _pending_output.front().size : 0);
 
    if (_pending_output.size()) {
-      last = _last_acked_input;
-      bits = msg->u.input.bits;
+      int frames = 0;
 
       msg->u.input.start_frame = _pending_output.front().frame;
       msg->u.input.input_size = (uint8)_pending_output.front().size;
 
-      ASSERT(last.frame == -1 || last.frame + 1 == msg->u.input.start_frame);
-      int max_bits = _max_input_bits;
-      int first_bits = EstimateInputBits(_pending_output.front(), last);
-      if (first_bits > max_bits) {
-         max_bits = first_bits;
+      ASSERT(_last_acked_input.frame == -1 || _last_acked_input.frame + 1 == (int)msg->u.input.start_frame);
+      if (!compact || _remote_wire_version < 3 || _input_codec_mode != INPUT_CODEC_FIELD) {
+         offset = EncodePendingInput(InputCodec::Get(INPUT_CODEC_BITVECTOR), msg->u.input.bits, &frames);
       }
-      if (max_bits > (MAX_COMPRESSED_BITS - 1)) {
-         max_bits = MAX_COMPRESSED_BITS - 1;
-      }
-
-      for (j = 0; j < _pending_output.size(); j++) {
-         GameInput &current = _pending_output.item(j);
-         int required_bits = EstimateInputBits(current, last);
-         if (offset + required_bits > max_bits) {
-            break;
+      if (compact && _remote_wire_version >= 3 && _input_codec_mode != INPUT_CODEC_BITVECTOR) {
+         /* Auto keeps whichever codec fits more frames, then fewer bits. */
+         uint8 field_bits[MAX_COMPRESSED_BITS / 8];
+         int field_frames;
+         int field_offset = EncodePendingInput(InputCodec::Get(INPUT_CODEC_FIELD), field_bits, &field_frames);
+         if (_input_codec_mode == INPUT_CODEC_FIELD || field_frames > frames ||
+             (field_frames == frames && field_offset < offset)) {
+            memcpy(msg->u.input.bits, field_bits, (field_offset + 7) / 8);
+            offset = field_offset;
+            frames = field_frames;
+            codec = INPUT_CODEC_FIELD;
          }
-         ASSERT((GAMEINPUT_MAX_BYTES * GAMEINPUT_MAX_PLAYERS * 8) < (1 << BITVECTOR_NIBBLE_SIZE));
-         EmitDiffBits(bits, &offset, current, last);
-         BitVector_ClearBit(msg->u.input.bits, &offset);
-         last = _last_sent_input = current;
+      }
+      if (frames) {
+         _last_sent_input = _pending_output.item(frames - 1);
       }
    } else {
       msg->u.input.start_frame = 0;
@@ -330,9 +251,287 @@ UdpProtocol::SendPendingOutput()
 
    ASSERT(offset < MAX_COMPRESSED_BITS);
 
+   if (compact) {
+      UdpMsg *packed = PackCompactInput(msg, codec);
+      delete msg;
+      msg = packed;
+   }
+   QueueInputCopies(msg, offset > 0);
    SendMsg(msg);
 }
 
+/*
+ * Codes pending output from the frame after the last acked one into bits,
+ * stopping at ggpo.network.max_input_bits (the first frame always goes in
+ * if it fits the packet at all).  Returns the bit count; frames gets the
+ * number of frames coded.
+ */
+int
+UdpProtocol::EncodePendingInput(const InputCodec *codec, uint8 *bits, int *frames)
+{
+   InputCodecState state;
+   GameInput last = _last_acked_input;
+   int offset = 0, j;
+   InputEncodeCache::Entry *cached = _encode_cache ? &_encode_cache->entries[codec->Id()] : NULL;
+
+   if (cached && cached->count == _pending_output.size() &&
+       cached->acked_frame == _last_acked_input.frame &&
+       cached->first_frame == _pending_output.front().frame) {
+      memcpy(bits, cached->bits, (cached->num_bits + 7) / 8);
+      _encode_cache->hits++;
+      *frames = cached->frames;
+      return cached->num_bits;
+   }
+
+   state.reset();
+   int max_bits = MAX(_max_input_bits, codec->FrameBits(state, _pending_output.front(), last));
+   if (max_bits > (MAX_COMPRESSED_BITS - 1)) {
+      max_bits = MAX_COMPRESSED_BITS - 1;
+   }
+
+   for (j = 0; j < _pending_output.size(); j++) {
+      GameInput &current = _pending_output.item(j);
+      if (offset + codec->FrameBits(state, current, last) > max_bits) {
+         break;
+      }
+      codec->EncodeFrame(state, bits, &offset, current, last);
+      last = current;
+   }
+   *frames = j;
+   if (cached) {
+      cached->acked_frame = _last_acked_input.frame;
+      cached->first_frame = _pending_output.front().frame;
+      cached->count = _pending_output.size();
+      cached->frames = j;
+      cached->num_bits = offset;
+      memcpy(cached->bits, bits, (offset + 7) / 8);
+      _encode_cache->misses++;
+   }
+   return offset;
+}
+
+bool
+UdpProtocol::UseCompactInput(int input_size)
+{
+   return _compact_input &&
+          _remote_wire_version >= 2 &&
+          _local_num_players == _remote_num_players &&
+          (input_size == 0 || input_size == _local_input_size);
+}
+
+UdpMsg *
+UdpProtocol::PackCompactInput(UdpMsg *msg, InputCodecId codec)
+{
+   UdpMsg *compact = new UdpMsg(UdpMsg::InputCompact);
+   uint8 *p = compact->u.input_compact.data;
+   uint8 flags = 0;
+   int ack = msg->u.input.ack_frame;
+   int count = _local_connect_status ? MIN(_local_num_players, UDP_MSG_MAX_PLAYERS) : 0;
+   UdpMsg::connect_status *status = msg->u.input.peer_connect_status;
+   uint8 mask = 0;
+
+   p = UdpMsg::PutVarint(p, (uint32)(ack + 1));
+   if (msg->u.input.num_bits) {
+      flags |= UDP_COMPACT_HAS_INPUT;
+      p = UdpMsg::PutVarint(p, UdpMsg::ZigZag((int)msg->u.input.start_frame - ack));
+      p = UdpMsg::PutVarint(p, msg->u.input.num_bits);
+   }
+   for (int i = 0; i < count; i++) {
+      if (status[i].disconnected) {
+         mask |= (uint8)(1 << i);
+      }
+   }
+   *p++ = (uint8)((count << 4) | mask);
+   if (count && (++_status_unsent_packets >= UDP_COMPACT_STATUS_REFRESH ||
+                 memcmp(_last_sent_status, status, count * sizeof(UdpMsg::connect_status)))) {
+      flags |= UDP_COMPACT_STATUS_FRAMES;
+      for (int i = 0; i < count; i++) {
+         p = UdpMsg::PutVarint(p, UdpMsg::ZigZag(status[i].last_frame - ack));
+      }
+      memcpy(_last_sent_status, status, count * sizeof(UdpMsg::connect_status));
+      _status_unsent_packets = 0;
+   }
+   if (msg->u.input.disconnect_requested) {
+      flags |= UDP_COMPACT_DISCONNECT;
+   }
+   memcpy(p, msg->u.input.bits, (msg->u.input.num_bits + 7) / 8);
+   p += (msg->u.input.num_bits + 7) / 8;
+   if (codec == INPUT_CODEC_FIELD) {
+      flags |= UDP_COMPACT_FIELD_CODEC;
+   }
+   if (CanCoalesce()) {
+      uint64 now_us = Platform::GetCurrentTimeUS();
+      if (_quality_report_due) {
+         flags |= UDP_COMPACT_QUALITY_REPORT;
+         *p++ = (uint8)_local_frame_advantage;
+         *p++ = (uint8)(_recv_packets ? MIN(_recv_lost * 100 / _recv_packets, 100) : 0);
+         p = UdpMsg::PutUint32(p, PingTime(now_us));
+         _recv_packets = _recv_lost = 0;
+         _quality_report_due = 0;
+         _coalesced++;
+      }
+      if (_quality_reply_pending) {
+         flags |= UDP_COMPACT_QUALITY_REPLY;
+         p = UdpMsg::PutUint32(p, QualityReplyPong(now_us));
+         _quality_reply_pending = false;
+         _coalesced++;
+      }
+      if ((flags & UDP_COMPACT_QUALITY_REPORT) && _remote_wire_version >= 5 && _checksum_frame >= 0) {
+         flags |= UDP_COMPACT_QUALITY_CHECKSUM;
+         p = UdpMsg::PutUint32(p, (uint32)_checksum_frame);
+         p = UdpMsg::PutUint32(p, _checksum);
+      }
+   }
+   compact->u.input_compact.flags = flags;
+   return compact;
+}
+
+/*
+ * Called just before SendMsg(msg), which may free it: keep a copy to resend
+ * a few ms later under the same sequence number, so the receiver treats
+ * whichever arrives second as a duplicate.  Spacing the copies out helps
+ * against the bursty loss typical of wifi.
+ */
+void
+UdpProtocol::QueueInputCopies(UdpMsg *msg, bool has_input)
+{
+   delete _fec_copy.msg;
+   _fec_copy.msg = NULL;
+   _fec_copy.remaining = 0;
+
+   if (_fec_level <= 0 || _current_state != Running || !has_input) {
+      return;
+   }
+   _fec_copy.msg = new UdpMsg(*msg);
+   if (msg->hdr.type == UdpMsg::InputCompact) {
+      /* The quality blocks trail the packet, so dropping the flags drops them. */
+      _fec_copy.msg->u.input_compact.flags &= ~(UDP_COMPACT_QUALITY_REPORT | UDP_COMPACT_QUALITY_REPLY |
+                                                UDP_COMPACT_QUALITY_CHECKSUM);
+      _fec_copy.msg->u.input_compact.flags |= UDP_COMPACT_COPY;
+   } else if (_remote_wire_version >= 2) {
+      _fec_copy.msg->hdr.type = UdpMsg::InputCopy;
+   }
+   /* Older peers have no InputCopy and take the copy as a duplicate Input. */
+   _fec_copy.msg->hdr.magic = _magic_number;
+   _fec_copy.msg->hdr.sequence_number = _next_send_seq;
+   _fec_copy.send_time = Platform::GetCurrentTimeMS() + UDP_FEC_COPY_SPACING;
+   _fec_copy.remaining = _fec_level;
+}
+
+void
+UdpProtocol::SendInputCopies(unsigned int now)
+{
+   if (!_fec_copy.msg || (int)(now - _fec_copy.send_time) < 0) {
+      return;
+   }
+   /* Leave room in the send queue for real traffic under emulated latency. */
+   if (_send_queue.size() < 48) {
+      UdpMsg *copy = new UdpMsg(*_fec_copy.msg);
+      LogMsg("send", copy);
+      _packets_sent++;
+      _bytes_sent += copy->PacketSize();
+      _fec_copies_sent++;
+      _send_queue.push(QueueEntry(now, _peer_addr, copy));
+   }
+   if (--_fec_copy.remaining > 0) {
+      _fec_copy.send_time = now + UDP_FEC_COPY_SPACING;
+   } else {
+      delete _fec_copy.msg;
+      _fec_copy.msg = NULL;
+   }
+}
+
+/*
+ * Loss of the remote's original packets, from gaps in their sequence
+ * numbers.  A copy that arrives before its original still counts the
+ * original as lost, so the estimate does not drop once FEC starts to work.
+ */
+void
+UdpProtocol::TrackReceiveLoss(uint16 seq)
+{
+   uint16 skipped = (uint16)((int)seq - (int)_next_recv_seq);
+   if (skipped == 0) {
+      return;
+   }
+   _recv_packets += skipped;
+   _recv_lost += skipped - 1;
+}
+
+void
+UdpProtocol::UpdateFecLevel(void)
+{
+   if (_fec_mode != UDP_FEC_ADAPTIVE) {
+      _fec_level = MIN(_fec_mode, UDP_FEC_MAX_COPIES);
+   } else if (_remote_loss_percent >= UDP_FEC_LOSS_HIGH) {
+      _fec_level = 2;
+   } else if (_remote_loss_percent >= UDP_FEC_LOSS_LOW) {
+      _fec_level = 1;
+   } else {
+      _fec_level = 0;
+   }
+}
+
+/*
+ * Quality traffic can ride on input packets once the peer speaks wire
+ * version 4 and we are sending it compact input.
+ */
+bool
+UdpProtocol::CanCoalesce(void)
+{
+   return _coalesce && _current_state == Running &&
+          _remote_wire_version >= 4 && UseCompactInput(0);
+}
+
+void
+UdpProtocol::SendQualityReport(void)
+{
+   UdpMsg *msg = new UdpMsg(UdpMsg::QualityReport);
+   msg->u.quality_report.ping = PingTime(Platform::GetCurrentTimeUS());
+   msg->u.quality_report.frame_advantage = (uint8)_local_frame_advantage;
+   msg->u.quality_report.loss_percent = (uint8)(_recv_packets ? MIN(_recv_lost * 100 / _recv_packets, 100) : 0);
+   msg->u.quality_report.checksum_frame = _checksum_frame;
+   msg->u.quality_report.checksum = _checksum;
+   _recv_packets = _recv_lost = 0;
+   _quality_report_due = 0;
+   SendMsg(msg);
+}
+
+void
+UdpProtocol::SendQualityReply(void)
+{
+   UdpMsg *reply = new UdpMsg(UdpMsg::QualityReply);
+   reply->u.quality_reply.pong = QualityReplyPong(Platform::GetCurrentTimeUS());
+   _quality_reply_pending = false;
+   SendMsg(reply);
+}
+
+/*
+ * Ping timestamps are only ever compared against the clock of the side
+ * that sent them, so their unit just has to be one both sides agree on:
+ * microseconds (modulo 2^32) with wire version 6 peers, milliseconds
+ * before that.
+ */
+uint32
+UdpProtocol::PingTime(uint64 now_us)
+{
+   return (uint32)(_remote_wire_version >= 6 ? now_us : now_us / 1000);
+}
+
+/* Moving pong forward by the time we held it keeps the ping honest. */
+uint32
+UdpProtocol::QualityReplyPong(uint64 now_us)
+{
+   return _quality_reply_pong + (PingTime(now_us) - PingTime(_quality_reply_recv_us));
+}
+
+void
+UdpProtocol::HandleQualityReply(uint32 pong)
+{
+   int elapsed = (int)(PingTime(Platform::GetCurrentTimeUS()) - pong);
+
+   _round_trip_us = _remote_wire_version >= 6 ? elapsed : elapsed * 1000;
+}
+
 void
 UdpProtocol::SendInputAck()
 {
@@ -356,7 +555,7 @@ UdpProtocol::GetEvent(UdpProtocol::Event &e)
 bool
 UdpProtocol::OnLoopPoll(void *cookie)
 {
-   if (!_udp) {
+   if (!_transport) {
       return true;
    }
 
@@ -375,19 +574,45 @@ UdpProtocol::OnLoopPoll(void *cookie)
 
    case Running:
       // xxx: rig all this up with a timer wrapper
+      if (_input_deferred && now - _last_input_send_time >= (unsigned int)_send_interval) {
+         SendPendingOutput();
+      }
       if (!_state.running.last_input_packet_recv_time || _state.running.last_input_packet_recv_time + RUNNING_RETRY_INTERVAL < now) {
          Log("Haven't exchanged packets in a while (last received:%d  last sent:%d).  Resending.\n", _last_received_input.frame, _last_sent_input.frame);
+         _status_unsent_packets = UDP_COMPACT_STATUS_REFRESH;
          SendPendingOutput();
+         _input_resent++;
          _state.running.last_input_packet_recv_time = now;
       }
+      SendInputCopies(now);
+
+      if (_state_send.active && now - _state_send.last_time > UDP_STATE_RESEND_INTERVAL) {
+         Log("No state ack for %d ms; resending from %d.\n", UDP_STATE_RESEND_INTERVAL, _state_send.acked);
+         _state_send.sent = _state_send.acked;
+         _state_send.last_time = now;
+         SendStateChunks();
+      }
+      if (_state_recv.active && now - _state_recv.last_time > UDP_STATE_RESEND_INTERVAL) {
+         SendStateAck();
+      }
+      if (_control_count && now - _control_send_time > UDP_CONTROL_RESEND_INTERVAL) {
+         SendControlMsg();
+      }
 
       if (!_state.running.last_quality_report_time || _state.running.last_quality_report_time + QUALITY_REPORT_INTERVAL < now) {
-         UdpMsg *msg = new UdpMsg(UdpMsg::QualityReport);
-         msg->u.quality_report.ping = Platform::GetCurrentTimeMS();
-         msg->u.quality_report.frame_advantage = (uint8)_local_frame_advantage;
-         SendMsg(msg);
+         if (CanCoalesce()) {
+            _quality_report_due = now;
+         } else {
+            SendQualityReport();
+         }
          _state.running.last_quality_report_time = now;
       }
+      if (_quality_report_due && now - _quality_report_due >= UDP_COALESCE_WAIT) {
+         SendQualityReport();
+      }
+      if (_quality_reply_pending && now - _quality_reply_recv_time >= UDP_COALESCE_WAIT) {
+         SendQualityReply();
+      }
 
       if (!_state.running.last_network_stats_interval || _state.running.last_network_stats_interval + NETWORK_STATS_INTERVAL < now) {
          UpdateNetworkStats();
@@ -395,7 +620,7 @@ UdpProtocol::OnLoopPoll(void *cookie)
       }
 
       if (_last_send_time && _last_send_time + KEEP_ALIVE_INTERVAL < now) {
-         Log("Sending keep alive packet\n");
+         LogVerbose("Sending keep alive packet\n");
          SendMsg(new UdpMsg(UdpMsg::KeepAlive));
       }
 
@@ -403,14 +628,14 @@ UdpProtocol::OnLoopPoll(void *cookie)
          !_disconnect_notify_sent && (_last_recv_time + _disconnect_notify_start < now)) {
          Log("Endpoint has stopped receiving packets for %d ms.  Sending notification.\n", _disconnect_notify_start);
          Event e(Event::NetworkInterrupted);
-         e.u.network_interrupted.disconnect_timeout = _disconnect_timeout - _disconnect_notify_start;
+         e.u.network_interrupted.disconnect_timeout = _disconnect_timeout + _reconnect_window - _disconnect_notify_start;
          QueueEvent(e);
          _disconnect_notify_sent = true;
       }
 
-      if (_disconnect_timeout && (_last_recv_time + _disconnect_timeout < now)) {
+      if (_disconnect_timeout && (_last_recv_time + _disconnect_timeout + _reconnect_window < now)) {
          if (!_disconnect_event_sent) {
-            Log("Endpoint has stopped receiving packets for %d ms.  Disconnecting.\n", _disconnect_timeout);
+            Log("Endpoint has stopped receiving packets for %d ms.  Disconnecting.\n", _disconnect_timeout + _reconnect_window);
             QueueEvent(Event(Event::Disconnected));
             _disconnect_event_sent = true;
          }
@@ -420,7 +645,7 @@ UdpProtocol::OnLoopPoll(void *cookie)
    case Disconnected:
       if (_shutdown_timeout < now) {
          Log("Shutting down udp connection.\n");
-         _udp = NULL;
+         _transport = NULL;
          _shutdown_timeout = 0;
       }
 
@@ -430,11 +655,98 @@ UdpProtocol::OnLoopPoll(void *cookie)
    return true;
 }
 
+/*
+ * Time until OnLoopPoll next has something to do.  Its checks are strict
+ * (last + interval < now), hence the +1 on each deadline.
+ */
+int
+UdpProtocol::GetLoopWaitTime(void *cookie)
+{
+   if (!_transport) {
+      return INFINITE;
+   }
+
+   unsigned int now = Platform::GetCurrentTimeMS();
+   int wait = INFINITE;
+
+#define UDP_PROTO_DEADLINE(due) \
+   do { \
+      int left = MAX((int)((due) - now), 0); \
+      wait = (wait == INFINITE) ? left : MIN(wait, left); \
+   } while (0)
+
+   if (_send_latency && !_send_queue.empty()) {
+      UDP_PROTO_DEADLINE(now + 1);
+   }
+   if (_oo_packet.msg) {
+      UDP_PROTO_DEADLINE(_oo_packet.send_time + 1);
+   }
+   switch (_current_state) {
+   case Syncing:
+      if (_last_send_time) {
+         UDP_PROTO_DEADLINE(_last_send_time + 1 + ((_state.sync.roundtrips_remaining == NUM_SYNC_PACKETS) ?
+                                                   SYNC_FIRST_RETRY_INTERVAL : SYNC_RETRY_INTERVAL));
+      }
+      break;
+
+   case Running:
+      UDP_PROTO_DEADLINE(_state.running.last_input_packet_recv_time ?
+                         _state.running.last_input_packet_recv_time + RUNNING_RETRY_INTERVAL + 1 : now);
+      UDP_PROTO_DEADLINE(_state.running.last_quality_report_time ?
+                         _state.running.last_quality_report_time + QUALITY_REPORT_INTERVAL + 1 : now);
+      UDP_PROTO_DEADLINE(_state.running.last_network_stats_interval ?
+                         _state.running.last_network_stats_interval + NETWORK_STATS_INTERVAL + 1 : now);
+      if (_last_send_time) {
+         UDP_PROTO_DEADLINE(_last_send_time + KEEP_ALIVE_INTERVAL + 1);
+      }
+      if (_input_deferred) {
+         UDP_PROTO_DEADLINE(_last_input_send_time + _send_interval);
+      }
+      if (_quality_report_due) {
+         UDP_PROTO_DEADLINE(_quality_report_due + UDP_COALESCE_WAIT);
+      }
+      if (_quality_reply_pending) {
+         UDP_PROTO_DEADLINE(_quality_reply_recv_time + UDP_COALESCE_WAIT);
+      }
+      if (_fec_copy.msg) {
+         UDP_PROTO_DEADLINE(_fec_copy.send_time);
+      }
+      if (_state_send.active) {
+         UDP_PROTO_DEADLINE(_state_send.last_time + UDP_STATE_RESEND_INTERVAL + 1);
+      }
+      if (_state_recv.active) {
+         UDP_PROTO_DEADLINE(_state_recv.last_time + UDP_STATE_RESEND_INTERVAL + 1);
+      }
+      if (_control_count) {
+         UDP_PROTO_DEADLINE(_control_send_time + UDP_CONTROL_RESEND_INTERVAL + 1);
+      }
+      if (_disconnect_timeout && _disconnect_notify_start && !_disconnect_notify_sent) {
+         UDP_PROTO_DEADLINE(_last_recv_time + _disconnect_notify_start + 1);
+      }
+      if (_disconnect_timeout && !_disconnect_event_sent) {
+         UDP_PROTO_DEADLINE(_last_recv_time + _disconnect_timeout + _reconnect_window + 1);
+      }
+      break;
+
+   case Disconnected:
+      UDP_PROTO_DEADLINE(_shutdown_timeout + 1);
+      break;
+
+   default:
+      break;
+   }
+#undef UDP_PROTO_DEADLINE
+   return wait;
+}
+
 void
 UdpProtocol::Disconnect()
 {
    _current_state = Disconnected;
    _shutdown_timeout = Platform::GetCurrentTimeMS() + UDP_SHUTDOWN_TIMER;
+   _state_send = StateTransfer();
+   _state_recv = StateTransfer();
+   _control_count = 0;
 }
 
 void
@@ -443,6 +755,12 @@ UdpProtocol::SendSyncRequest()
    _state.sync.random = rand() & 0xFFFF;
    UdpMsg *msg = new UdpMsg(UdpMsg::SyncRequest);
    msg->u.sync_request.random_request = _state.sync.random;
+   msg->u.sync_request.prediction_frames = (uint8)_sync_prediction_frames;
+   msg->u.sync_request.keyframe_interval = (uint8)_sync_keyframe_interval;
+   msg->u.sync_request.wire_version = UDP_WIRE_VERSION;
+   msg->u.sync_request.input_size = (uint8)_local_input_size;
+   msg->u.sync_request.num_players = (uint8)_local_num_players;
+   msg->u.sync_request.flags = _state_recv.active ? UDP_SYNC_REJOIN : 0;
    SendMsg(msg);
 }
 
@@ -466,7 +784,7 @@ bool
 UdpProtocol::HandlesMsg(sockaddr_in &from,
                         UdpMsg *msg)
 {
-   if (!_udp) {
+   if (!_transport) {
       return false;
    }
    return SockAddrEqual(_peer_addr, from) &&
@@ -487,6 +805,12 @@ UdpProtocol::OnMsg(UdpMsg *msg, int len)
       &UdpProtocol::OnQualityReply,        /* QualityReply */
       &UdpProtocol::OnKeepAlive,           /* KeepAlive */
       &UdpProtocol::OnInputAck,            /* InputAck */
+      &UdpProtocol::OnInput,               /* InputCopy */
+      &UdpProtocol::OnInputCompact,        /* InputCompact */
+      &UdpProtocol::OnStateChunk,          /* StateChunk */
+      &UdpProtocol::OnStateAck,            /* StateAck */
+      &UdpProtocol::OnControl,             /* Control */
+      &UdpProtocol::OnControlAck,          /* ControlAck */
    };
 
    // filter out messages that don't match what we expect
@@ -505,6 +829,12 @@ UdpProtocol::OnMsg(UdpMsg *msg, int len)
          Log("dropping out of order packet (seq: %d, last seq:%d)\n", seq, _next_recv_seq);
          return;
       }
+      if (_current_state == Running) {
+         TrackReceiveLoss(seq);
+         if (skipped && msg->IsInputCopy()) {
+            _recv_lost++;
+         }
+      }
    }
 
    _next_recv_seq = seq;
@@ -531,6 +861,10 @@ UdpProtocol::UpdateNetworkStats(void)
    if (_stats_start_time == 0) {
       _stats_start_time = now;
    }
+   /* The first call only starts the clock; there is no rate to give yet. */
+   if (now == _stats_start_time || !_bytes_sent) {
+      return;
+   }
 
    int total_bytes_sent = _bytes_sent + (UDP_HEADER_SIZE * _packets_sent);
    float seconds = (float)((now - _stats_start_time) / 1000.0);
@@ -541,7 +875,7 @@ UdpProtocol::UpdateNetworkStats(void)
 
    Log("Network Stats -- Bandwidth: %.2f KBps   Packets Sent: %5d (%.2f pps)   "
        "KB Sent: %.2f    UDP Overhead: %.2f %%.\n",
-       _kbps_sent, 
+       Bps / 1024, 
        _packets_sent,
        (float)_packets_sent * 1000 / (now - _stats_start_time),
        total_bytes_sent / 1024.0,
@@ -559,13 +893,26 @@ UdpProtocol::QueueEvent(const UdpProtocol::Event &evt)
 void
 UdpProtocol::Synchronize()
 {
-   if (_udp) {
+   if (_transport) {
       _current_state = Syncing;
       _state.sync.roundtrips_remaining = NUM_SYNC_PACKETS;
       SendSyncRequest();
    }
 }
 
+/*
+ * Synchronize as a restarted peer: the survivor keeps the match where it
+ * stalled and sends the state to resume from once we are through.
+ */
+void
+UdpProtocol::Rejoin()
+{
+   _state_recv = StateTransfer();
+   _state_recv.active = true;
+   _state_recv.start_time = Platform::GetCurrentTimeMS();
+   Synchronize();
+}
+
 bool
 UdpProtocol::GetPeerConnectStatus(int id, int *frame)
 {
@@ -580,6 +927,9 @@ UdpProtocol::Log(const char *fmt, ...)
    size_t offset;
    va_list args;
 
+   if (!LogEnabled(GGPO_LOG_INFO)) {
+      return;
+   }
    sprintf_s(buf, ARRAY_SIZE(buf), "udpproto%d | ", _queue);
    offset = strlen(buf);
    va_start(args, fmt);
@@ -594,27 +944,44 @@ UdpProtocol::LogMsg(const char *prefix, UdpMsg *msg)
 {
    switch (msg->hdr.type) {
    case UdpMsg::SyncRequest:
-      Log("%s sync-request (%d).\n", prefix,
+      LogVerbose("%s sync-request (%d).\n", prefix,
           msg->u.sync_request.random_request);
       break;
    case UdpMsg::SyncReply:
-      Log("%s sync-reply (%d).\n", prefix,
+      LogVerbose("%s sync-reply (%d).\n", prefix,
           msg->u.sync_reply.random_reply);
       break;
    case UdpMsg::QualityReport:
-      Log("%s quality report.\n", prefix);
+      LogVerbose("%s quality report.\n", prefix);
       break;
    case UdpMsg::QualityReply:
-      Log("%s quality reply.\n", prefix);
+      LogVerbose("%s quality reply.\n", prefix);
       break;
    case UdpMsg::KeepAlive:
-      Log("%s keep alive.\n", prefix);
+      LogVerbose("%s keep alive.\n", prefix);
       break;
    case UdpMsg::Input:
-      Log("%s game-compressed-input %d (+ %d bits).\n", prefix, msg->u.input.start_frame, msg->u.input.num_bits);
+   case UdpMsg::InputCopy:
+      LogVerbose("%s game-compressed-input %d (+ %d bits).\n", prefix, msg->u.input.start_frame, msg->u.input.num_bits);
+      break;
+   case UdpMsg::InputCompact:
+      LogVerbose("%s compact-input (flags %x, %d bytes).\n", prefix, msg->u.input_compact.flags, msg->PayloadSize());
       break;
    case UdpMsg::InputAck:
-      Log("%s input ack.\n", prefix);
+      LogVerbose("%s input ack.\n", prefix);
+      break;
+   case UdpMsg::StateChunk:
+      LogVerbose("%s state chunk %d (%u+%d of %u).\n", prefix, msg->u.state_chunk.frame,
+          msg->u.state_chunk.offset, msg->u.state_chunk.length, msg->u.state_chunk.size);
+      break;
+   case UdpMsg::StateAck:
+      LogVerbose("%s state ack %d (%u).\n", prefix, msg->u.state_ack.frame, msg->u.state_ack.offset);
+      break;
+   case UdpMsg::Control:
+      LogVerbose("%s control %u (%d bytes).\n", prefix, msg->u.control.id, msg->u.control.length);
+      break;
+   case UdpMsg::ControlAck:
+      LogVerbose("%s control ack %u.\n", prefix, msg->u.control_ack.id);
       break;
    default:
       ASSERT(FALSE && "Unknown UdpMsg type.");
@@ -626,7 +993,7 @@ UdpProtocol::LogEvent(const char *prefix, const UdpProtocol::Event &evt)
 {
    switch (evt.type) {
    case UdpProtocol::Event::Synchronzied:
-      Log("%s (event: Synchronzied).\n", prefix);
+      LogVerbose("%s (event: Synchronzied).\n", prefix);
       break;
    }
 }
@@ -641,13 +1008,28 @@ UdpProtocol::OnInvalid(UdpMsg *msg, int len)
 bool
 UdpProtocol::OnSyncRequest(UdpMsg *msg, int len)
 {
-   if (_remote_magic_number != 0 && msg->hdr.magic != _remote_magic_number) {
+   if (_remote_magic_number != 0 && msg->hdr.magic != _remote_magic_number &&
+       !AcceptRejoin(msg, len)) {
       Log("Ignoring sync request from unknown endpoint (%d != %d).\n", 
            msg->hdr.magic, _remote_magic_number);
       return false;
    }
+   if (len > (int)((char *)&msg->u.sync_request.keyframe_interval - (char *)msg)) {
+      _remote_prediction_frames = msg->u.sync_request.prediction_frames;
+      _remote_keyframe_interval = msg->u.sync_request.keyframe_interval;
+   }
+   if (len > (int)((char *)&msg->u.sync_request.num_players - (char *)msg)) {
+      ReadSyncShape(msg->u.sync_request.wire_version,
+                    msg->u.sync_request.input_size,
+                    msg->u.sync_request.num_players);
+   }
    UdpMsg *reply = new UdpMsg(UdpMsg::SyncReply);
    reply->u.sync_reply.random_reply = msg->u.sync_request.random_request;
+   reply->u.sync_reply.prediction_frames = (uint8)_sync_prediction_frames;
+   reply->u.sync_reply.keyframe_interval = (uint8)_sync_keyframe_interval;
+   reply->u.sync_reply.wire_version = UDP_WIRE_VERSION;
+   reply->u.sync_reply.input_size = (uint8)_local_input_size;
+   reply->u.sync_reply.num_players = (uint8)_local_num_players;
    SendMsg(reply);
    return true;
 }
@@ -666,18 +1048,42 @@ UdpProtocol::OnSyncReply(UdpMsg *msg, int len)
       return false;
    }
 
+   if (len > (int)((char *)&msg->u.sync_reply.keyframe_interval - (char *)msg)) {
+      _remote_prediction_frames = msg->u.sync_reply.prediction_frames;
+      _remote_keyframe_interval = msg->u.sync_reply.keyframe_interval;
+   }
+   if (len >= (int)(sizeof(msg->hdr) + sizeof(msg->u.sync_reply))) {
+      ReadSyncShape(msg->u.sync_reply.wire_version,
+                    msg->u.sync_reply.input_size,
+                    msg->u.sync_reply.num_players);
+   }
+   if (!AcceptSyncConfig(_remote_prediction_frames, _remote_keyframe_interval)) {
+      Log("Rejecting peer: prediction window %d / keyframe interval %d does not match ours (%d / %d).\n",
+          _remote_prediction_frames, _remote_keyframe_interval,
+          _sync_prediction_frames, _sync_keyframe_interval);
+      if (!_disconnect_event_sent) {
+         QueueEvent(Event(Event::Disconnected));
+         _disconnect_event_sent = true;
+      }
+      return true;
+   }
+
    if (!_connected) {
       QueueEvent(Event(Event::Connected));
       _connected = true;
    }
 
-   Log("Checking sync state (%d round trips remaining).\n", _state.sync.roundtrips_remaining);
+   LogVerbose("Checking sync state (%d round trips remaining).\n", _state.sync.roundtrips_remaining);
    if (--_state.sync.roundtrips_remaining == 0) {
       Log("Synchronized!\n");
       QueueEvent(UdpProtocol::Event(UdpProtocol::Event::Synchronzied));
       _current_state = Running;
       _last_received_input.frame = -1;
       _remote_magic_number = msg->hdr.magic;
+      if (_state_recv.active) {
+         // tells the survivor we can take the state now
+         SendStateAck();
+      }
    } else {
       UdpProtocol::Event evt(UdpProtocol::Event::Synchronizing);
       evt.u.synchronizing.total = NUM_SYNC_PACKETS;
@@ -690,7 +1096,21 @@ UdpProtocol::OnSyncReply(UdpMsg *msg, int len)
 
 bool
 UdpProtocol::OnInput(UdpMsg *msg, int len)
+{
+   return ReceiveInput(msg, INPUT_CODEC_BITVECTOR);
+}
+
+bool
+UdpProtocol::ReceiveInput(UdpMsg *msg, InputCodecId codec_id)
 {
+   /*
+    * Rejoining, the survivor's input follows the state we don't have yet.
+    * It is resent until acked, so dropping it here loses nothing.
+    */
+   if (_state_recv.active) {
+      return true;
+   }
+
    /*
     * If a disconnect is requested, go ahead and disconnect now.
     */
@@ -709,6 +1129,10 @@ UdpProtocol::OnInput(UdpMsg *msg, int len)
       UdpMsg::connect_status* remote_status = msg->u.input.peer_connect_status;
       for (int i = 0; i < ARRAY_SIZE(_peer_connect_status); i++) {
          ASSERT(remote_status[i].last_frame >= _peer_connect_status[i].last_frame);
+         if ((remote_status[i].disconnected && !_peer_connect_status[i].disconnected) ||
+             remote_status[i].last_frame > _peer_connect_status[i].last_frame) {
+            _peer_status_changed |= 1u << i;
+         }
          _peer_connect_status[i].disconnected = _peer_connect_status[i].disconnected || remote_status[i].disconnected;
          _peer_connect_status[i].last_frame = MAX(_peer_connect_status[i].last_frame, remote_status[i].last_frame);
       }
@@ -723,7 +1147,10 @@ UdpProtocol::OnInput(UdpMsg *msg, int len)
       uint8 *bits = (uint8 *)msg->u.input.bits;
       int numBits = msg->u.input.num_bits;
       int currentFrame = msg->u.input.start_frame;
+      const InputCodec *codec = InputCodec::Get(codec_id);
+      InputCodecState state;
 
+      state.reset();
       _last_received_input.size = msg->u.input.input_size;
       if (_last_received_input.frame < 0) {
          _last_received_input.frame = msg->u.input.start_frame - 1;
@@ -736,18 +1163,15 @@ UdpProtocol::OnInput(UdpMsg *msg, int len)
          ASSERT(currentFrame <= (_last_received_input.frame + 1));
          bool useInputs = currentFrame == _last_received_input.frame + 1;
 
-         while (BitVector_ReadBit(bits, &offset)) {
-            int on = BitVector_ReadBit(bits, &offset);
-            int button = BitVector_ReadNibblet(bits, &offset);
-            if (useInputs) {
-               if (on) {
-                  _last_received_input.set(button);
-               } else {
-                  _last_received_input.clear(button);
-               }
-            }
+         GameInput next = _last_received_input;
+         if (!codec->DecodeFrame(state, bits, &offset, numBits, msg->u.input.input_size,
+                                 useInputs ? &next : NULL)) {
+            Log("Dropping rest of %s input packet, frame %d is malformed.\n", codec->Name(), currentFrame);
+            break;
+         }
+         if (useInputs) {
+            _last_received_input = next;
          }
-         ASSERT(offset <= numBits);
 
          /*
           * Now if we want to use these inputs, go ahead and send them to
@@ -757,7 +1181,6 @@ UdpProtocol::OnInput(UdpMsg *msg, int len)
             /*
              * Move forward 1 frame in the stream.
              */
-            char desc[1024];
             ASSERT(currentFrame == _last_received_input.frame + 1);
             _last_received_input.frame = currentFrame;
 
@@ -767,11 +1190,16 @@ UdpProtocol::OnInput(UdpMsg *msg, int len)
             UdpProtocol::Event evt(UdpProtocol::Event::Input);
             evt.u.input.input = _last_received_input;
 
-            _last_received_input.desc(desc, ARRAY_SIZE(desc));
-
             _state.running.last_input_packet_recv_time = Platform::GetCurrentTimeMS();
+            if (msg->IsInputCopy()) {
+               _fec_recovered++;
+            }
 
-            Log("Sending frame %d to emu queue %d (%s).\n", _last_received_input.frame, _queue, desc);
+            if (LogEnabled(GGPO_LOG_VERBOSE)) {
+               char desc[1024];
+               _last_received_input.desc(desc, ARRAY_SIZE(desc));
+               Log("Sending frame %d to emu queue %d (%s).\n", _last_received_input.frame, _queue, desc);
+            }
             QueueEvent(evt);
 
          } else {
@@ -798,6 +1226,108 @@ UdpProtocol::OnInput(UdpMsg *msg, int len)
 }
 
 
+/*
+ * Expands an InputCompact into the plain Input layout and hands it to
+ * OnInput, so both formats share one receive path.  Connect status
+ * last_frames left out of the packet keep the values we already have.
+ */
+bool
+UdpProtocol::OnInputCompact(UdpMsg *msg, int len)
+{
+   int payload = len - (int)sizeof(msg->hdr);
+   if (msg->CompactInputSize(payload) < 0) {
+      Log("dropping malformed compact input (%d bytes)\n", payload);
+      return false;
+   }
+
+   uint8 flags = msg->u.input_compact.flags;
+   const uint8 *p = msg->u.input_compact.data;
+   uint32 value = 0;
+   int count, mask;
+
+   if ((flags & UDP_COMPACT_HAS_INPUT) && !_remote_input_size) {
+      Log("dropping compact input: peer never stated its input size\n");
+      return false;
+   }
+
+   UdpMsg plain(msg->IsInputCopy() ? UdpMsg::InputCopy : UdpMsg::Input);
+   plain.hdr.magic = msg->hdr.magic;
+   plain.hdr.sequence_number = msg->hdr.sequence_number;
+
+   /*
+    * CompactInputSize already bounds checked every field, but a short
+    * read still drops the message rather than decoding garbage.
+    */
+   const uint8 *end = (const uint8 *)msg + len;
+   if (!(p = UdpMsg::GetVarint(p, end, &value))) {
+      Log("dropping truncated compact input (%d bytes)\n", payload);
+      return false;
+   }
+   int ack = (int)value - 1;
+   plain.u.input.ack_frame = ack;
+   plain.u.input.start_frame = 0;
+   plain.u.input.num_bits = 0;
+   plain.u.input.input_size = 0;
+   if (flags & UDP_COMPACT_HAS_INPUT) {
+      if (!(p = UdpMsg::GetVarint(p, end, &value))) {
+         Log("dropping truncated compact input (%d bytes)\n", payload);
+         return false;
+      }
+      plain.u.input.start_frame = ack + UdpMsg::UnZigZag(value);
+      if (!(p = UdpMsg::GetVarint(p, end, &value))) {
+         Log("dropping truncated compact input (%d bytes)\n", payload);
+         return false;
+      }
+      plain.u.input.num_bits = (uint16)value;
+      plain.u.input.input_size = (uint8)_remote_input_size;
+   }
+   if (p >= end) {
+      Log("dropping truncated compact input (%d bytes)\n", payload);
+      return false;
+   }
+   count = *p >> 4;
+   mask = *p++ & 0xf;
+   if (count > UDP_MSG_MAX_PLAYERS) {
+      Log("dropping compact input with %d players\n", count);
+      return false;
+   }
+   memcpy(plain.u.input.peer_connect_status, _peer_connect_status, sizeof(_peer_connect_status));
+   for (int i = 0; i < count; i++) {
+      if (mask & (1 << i)) {
+         plain.u.input.peer_connect_status[i].disconnected = 1;
+      }
+      if (flags & UDP_COMPACT_STATUS_FRAMES) {
+         if (!(p = UdpMsg::GetVarint(p, end, &value))) {
+            Log("dropping truncated compact input (%d bytes)\n", payload);
+            return false;
+         }
+         plain.u.input.peer_connect_status[i].last_frame = MAX(ack + UdpMsg::UnZigZag(value),
+                                                              _peer_connect_status[i].last_frame);
+      }
+   }
+   plain.u.input.disconnect_requested = (flags & UDP_COMPACT_DISCONNECT) ? 1 : 0;
+   memcpy(plain.u.input.bits, p, (plain.u.input.num_bits + 7) / 8);
+   p += (plain.u.input.num_bits + 7) / 8;
+   if (flags & UDP_COMPACT_QUALITY_REPORT) {
+      int frame_advantage = (int8)p[0];
+      int loss_percent = p[1];
+      p = UdpMsg::GetUint32(p + 2, &value);
+      HandleQualityReport(frame_advantage, loss_percent, value);
+   }
+   if (flags & UDP_COMPACT_QUALITY_REPLY) {
+      p = UdpMsg::GetUint32(p, &value);
+      HandleQualityReply(value);
+   }
+   if (flags & UDP_COMPACT_QUALITY_CHECKSUM) {
+      uint32 checksum;
+      p = UdpMsg::GetUint32(p, &value);
+      p = UdpMsg::GetUint32(p, &checksum);
+      HandleChecksum((int)value, checksum);
+   }
+
+   return ReceiveInput(&plain, (flags & UDP_COMPACT_FIELD_CODEC) ? INPUT_CODEC_FIELD : INPUT_CODEC_BITVECTOR);
+}
+
 bool
 UdpProtocol::OnInputAck(UdpMsg *msg, int len)
 {
@@ -814,20 +1344,63 @@ UdpProtocol::OnInputAck(UdpMsg *msg, int len)
 
 bool
 UdpProtocol::OnQualityReport(UdpMsg *msg, int len)
+{
+   HandleQualityReport(msg->u.quality_report.frame_advantage,
+                       msg->u.quality_report.loss_percent,
+                       msg->u.quality_report.ping);
+   /* Older peers send the report without the checksum fields. */
+   if (_remote_wire_version >= 5 && len >= (int)sizeof(msg->hdr) + (int)sizeof(msg->u.quality_report)) {
+      HandleChecksum(msg->u.quality_report.checksum_frame, msg->u.quality_report.checksum);
+   }
+   return true;
+}
+
+void
+UdpProtocol::HandleChecksum(int frame, uint32 checksum)
+{
+   if (frame < 0 || frame == _remote_checksum_frame) {
+      return;
+   }
+   _remote_checksum_frame = frame;
+
+   Event evt(Event::Checksum);
+   evt.u.checksum.frame = frame;
+   evt.u.checksum.checksum = checksum;
+   QueueEvent(evt);
+}
+
+/*
+ * frame must be confirmed: every peer has run it with the same inputs, so
+ * the checksums can be compared as they are.
+ */
+void
+UdpProtocol::SetLocalChecksum(int frame, uint32 checksum)
+{
+   _checksum_frame = frame;
+   _checksum = checksum;
+}
+
+void
+UdpProtocol::HandleQualityReport(int frame_advantage, int loss_percent, uint32 ping)
 {
    // send a reply so the other side can compute the round trip transmit time.
-   UdpMsg *reply = new UdpMsg(UdpMsg::QualityReply);
-   reply->u.quality_reply.pong = msg->u.quality_report.ping;
-   SendMsg(reply);
+   _quality_reply_pong = ping;
+   _quality_reply_recv_us = Platform::GetCurrentTimeUS();
+   _quality_reply_recv_time = (unsigned int)(_quality_reply_recv_us / 1000);
+   _quality_reply_pending = true;
+   if (!CanCoalesce()) {
+      SendQualityReply();
+   }
 
-   _remote_frame_advantage = msg->u.quality_report.frame_advantage;
-   return true;
+   _remote_frame_advantage = frame_advantage;
+   _remote_loss_percent = loss_percent;
+   UpdateFecLevel();
 }
 
 bool
 UdpProtocol::OnQualityReply(UdpMsg *msg, int len)
 {
-   _round_trip_time = Platform::GetCurrentTimeMS() - msg->u.quality_reply.pong;
+   HandleQualityReply(msg->u.quality_reply.pong);
    return true;
 }
 
@@ -837,12 +1410,251 @@ UdpProtocol::OnKeepAlive(UdpMsg *msg, int len)
    return true;
 }
 
+/*
+ * window ms past the disconnect timeout during which a restarted peer may
+ * still rejoin; 0 disconnects at the timeout and turns rejoins away.
+ */
+void
+UdpProtocol::SetReconnectWindow(int window)
+{
+   _reconnect_window = MAX(window, 0);
+}
+
+/*
+ * A sync request under a new magic is the peer restarting.  It is only
+ * taken back while it has gone quiet and the window is open; at any other
+ * time it is someone else on the peer's address.
+ */
+bool
+UdpProtocol::AcceptRejoin(UdpMsg *msg, int len)
+{
+   if (!_reconnect_window || _current_state != Running || !_disconnect_notify_sent ||
+       len < (int)(sizeof(msg->hdr) + sizeof(msg->u.sync_request)) ||
+       msg->u.sync_request.wire_version < 7 ||
+       !(msg->u.sync_request.flags & UDP_SYNC_REJOIN)) {
+      return false;
+   }
+   Log("Peer restarted (magic %d -> %d).  Taking it back.\n", _remote_magic_number, msg->hdr.magic);
+   _remote_magic_number = msg->hdr.magic;
+   _rejoin_outage_start = _last_recv_time;
+
+   // the new instance reports its connect status from scratch
+   for (size_t i = 0; i < ARRAY_SIZE(_peer_connect_status); i++) {
+      _peer_connect_status[i].disconnected = 0;
+      _peer_connect_status[i].last_frame = -1;
+   }
+   _peer_status_changed = (1u << UDP_MSG_MAX_PLAYERS) - 1;
+   _state_send = StateTransfer();
+   _remote_control_id = 0;    // its ids start over too
+
+   QueueEvent(Event(Event::Rejoining));
+   return true;
+}
+
+/*
+ * Both directions start over as at the beginning of a session: the new
+ * instance has acked nothing and codes its input against nothing.
+ */
+void
+UdpProtocol::ResetInputStream(void)
+{
+   while (!_pending_output.empty()) {
+      _pending_output.pop();
+   }
+   _last_sent_input.init(-1, NULL, 1);
+   _last_received_input.init(-1, NULL, 1);
+   _last_acked_input.init(-1, NULL, 1);
+   delete _fec_copy.msg;
+   _fec_copy.msg = NULL;
+   _fec_copy.remaining = 0;
+   memset(_last_sent_status, 0, sizeof(_last_sent_status));
+   _status_unsent_packets = UDP_COMPACT_STATUS_REFRESH;
+   _remote_checksum_frame = -1;
+}
+
+/*
+ * Hands a rejoined peer the state to resume from at frame.  Input queued
+ * from here on is held back until it has all of it.
+ */
+void
+UdpProtocol::SendState(int frame, int codec, int raw_size, const uint8 *data, int size)
+{
+   ResetInputStream();
+
+   _state_send = StateTransfer();
+   _state_send.data.assign(data, data + size);
+   _state_send.frame = frame;
+   _state_send.codec = codec;
+   _state_send.raw_size = raw_size;
+   _state_send.size = size;
+   _state_send.start_time = _state_send.last_time = Platform::GetCurrentTimeMS();
+   _state_send.active = true;
+   Log("Sending the state for frame %d (%d bytes, %d raw).\n", frame, size, raw_size);
+   SendStateChunks();
+}
+
+void
+UdpProtocol::SendStateChunks(void)
+{
+   /* Leave room in the send queue for real traffic under emulated latency. */
+   while (_state_send.sent < _state_send.size &&
+          _state_send.sent - _state_send.acked < UDP_STATE_WINDOW * UDP_STATE_CHUNK_SIZE &&
+          _send_queue.size() < 48) {
+      UdpMsg *msg = new UdpMsg(UdpMsg::StateChunk);
+      int length = MIN(_state_send.size - _state_send.sent, UDP_STATE_CHUNK_SIZE);
+
+      msg->u.state_chunk.frame = _state_send.frame;
+      msg->u.state_chunk.size = (uint32)_state_send.size;
+      msg->u.state_chunk.raw_size = (uint32)_state_send.raw_size;
+      msg->u.state_chunk.offset = (uint32)_state_send.sent;
+      msg->u.state_chunk.length = (uint16)length;
+      msg->u.state_chunk.codec = (uint8)_state_send.codec;
+      memcpy(msg->u.state_chunk.data, &_state_send.data[_state_send.sent], length);
+      _state_send.sent += length;
+      SendMsg(msg);
+   }
+}
+
+void
+UdpProtocol::SendStateAck(void)
+{
+   UdpMsg *msg = new UdpMsg(UdpMsg::StateAck);
+   msg->u.state_ack.frame = _state_recv.frame;
+   msg->u.state_ack.offset = (uint32)_state_recv.acked;
+   _state_recv.last_time = Platform::GetCurrentTimeMS();
+   SendMsg(msg);
+}
+
+bool
+UdpProtocol::OnStateChunk(UdpMsg *msg, int len)
+{
+   int header = (int)sizeof(msg->hdr) + (int)((char *)&msg->u.state_chunk.data - (char *)&msg->u.state_chunk);
+   int length = msg->u.state_chunk.length;
+   uint32 size = msg->u.state_chunk.size;
+   uint32 offset = msg->u.state_chunk.offset;
+
+   if (len < header || length > UDP_STATE_CHUNK_SIZE || len < header + length ||
+       size > UDP_STATE_MAX_SIZE || offset > size || size - offset < (uint32)length) {
+      Log("dropping malformed state chunk (%d bytes)\n", len);
+      return false;
+   }
+   if (!_state_recv.active) {
+      // our last ack went missing; say again that we have it all
+      if (_state_recv.frame == msg->u.state_chunk.frame && _state_recv.acked == _state_recv.size) {
+         SendStateAck();
+      }
+      return true;
+   }
+
+   if (offset == 0 && _state_recv.frame != msg->u.state_chunk.frame) {
+      _state_recv.frame = msg->u.state_chunk.frame;
+      _state_recv.codec = msg->u.state_chunk.codec;
+      _state_recv.raw_size = (int)msg->u.state_chunk.raw_size;
+      _state_recv.size = (int)size;
+      _state_recv.acked = 0;
+      _state_recv.data.clear();
+      _state_recv.data.reserve(size);
+   }
+   if (_state_recv.frame == msg->u.state_chunk.frame && (int)offset == _state_recv.acked) {
+      _state_recv.data.insert(_state_recv.data.end(), msg->u.state_chunk.data, msg->u.state_chunk.data + length);
+      _state_recv.acked += length;
+   }
+   SendStateAck();
+
+   if (_state_recv.frame >= 0 && _state_recv.acked == _state_recv.size) {
+      Log("Received the state for frame %d (%d bytes).\n", _state_recv.frame, _state_recv.size);
+      _state_recv.active = false;
+
+      Event evt(Event::StateReceived);
+      evt.u.state.frame = _state_recv.frame;
+      evt.u.state.size = _state_recv.size;
+      evt.u.state.resume_ms = (int)(Platform::GetCurrentTimeMS() - _state_recv.start_time);
+      QueueEvent(evt);
+   }
+   return true;
+}
+
+bool
+UdpProtocol::OnStateAck(UdpMsg *msg, int len)
+{
+   if (!_state_send.active) {
+      return true;
+   }
+   if (msg->u.state_ack.frame != _state_send.frame) {
+      // the peer has only just synchronized; whatever we sent before that was dropped
+      if (!_state_send.acked) {
+         _state_send.sent = 0;
+         SendStateChunks();
+      }
+      return true;
+   }
+
+   int offset = (int)MIN(msg->u.state_ack.offset, (uint32)_state_send.size);
+   if (offset > _state_send.acked) {
+      _state_send.acked = offset;
+      _state_send.dup_acks = 0;
+      _state_send.last_time = Platform::GetCurrentTimeMS();
+   } else if (offset == _state_send.acked && _state_send.sent > offset &&
+              ++_state_send.dup_acks >= UDP_STATE_DUP_ACKS) {
+      /*
+       * The peer keeps getting chunks past a gap.  Go back to the gap now
+       * rather than on the resend timer, and let the acks for the rest of
+       * the window already out go by.
+       */
+      _state_send.sent = offset;
+      _state_send.dup_acks = -UDP_STATE_WINDOW;
+   }
+   if (_state_send.acked < _state_send.size) {
+      _state_send.sent = MAX(_state_send.sent, _state_send.acked);
+      SendStateChunks();
+      return true;
+   }
+
+   unsigned int now = Platform::GetCurrentTimeMS();
+   Log("State for frame %d delivered in %d ms.\n", _state_send.frame, (int)(now - _state_send.start_time));
+
+   Event evt(Event::StateSent);
+   evt.u.state.frame = _state_send.frame;
+   evt.u.state.size = _state_send.size;
+   evt.u.state.resume_ms = (int)(now - _rejoin_outage_start);
+   QueueEvent(evt);
+
+   _state_send = StateTransfer();
+   SendPendingOutput();
+   return true;
+}
+
+/*
+ * The state from the survivor, once it has all arrived.  Only returns it
+ * once.
+ */
+bool
+UdpProtocol::TakeReceivedState(int *frame, int *codec, int *raw_size, std::vector<uint8> &data)
+{
+   if (_state_recv.active || _state_recv.data.empty()) {
+      return false;
+   }
+   *frame = _state_recv.frame;
+   *codec = _state_recv.codec;
+   *raw_size = _state_recv.raw_size;
+   data.swap(_state_recv.data);
+   _state_recv.data.clear();
+   return true;
+}
+
 void
 UdpProtocol::GetNetworkStats(struct GGPONetworkStats *s)
 {
-   s->network.ping = _round_trip_time;
+   s->network.ping = _round_trip_us / 1000;
+   s->network.ping_us = _round_trip_us;
    s->network.send_queue_len = _pending_output.size();
    s->network.kbps_sent = _kbps_sent;
+   s->network.loss_percent = _remote_loss_percent;
+   s->network.fec_level = _fec_level;
+   s->network.fec_copies_sent = _fec_copies_sent;
+   s->network.fec_recovered = _fec_recovered;
+   s->network.resent = _input_resent;
+   s->network.coalesced = _coalesced;
    s->timesync.remote_frames_behind = _remote_frame_advantage;
    s->timesync.local_frames_behind = _local_frame_advantage;
 }
@@ -855,7 +1667,7 @@ UdpProtocol::SetLocalFrameNumber(int localFrame)
     * last frame they gave us plus some delta for the one-way packet
     * trip time.
     */
-   int remoteFrame = _last_received_input.frame + (_round_trip_time * 60 / 1000);
+   int remoteFrame = _last_received_input.frame + (int)((long long)_round_trip_us * 60 / 1000000);
 
    /*
     * Our frame advantage is how many frames *behind* the other guy
@@ -886,9 +1698,70 @@ UdpProtocol::SetDisconnectNotifyStart(int timeout)
    _disconnect_notify_start = timeout;
 }
 
+void
+UdpProtocol::SetSyncConfig(int prediction_frames, int keyframe_interval)
+{
+   _sync_prediction_frames = prediction_frames;
+   _sync_keyframe_interval = keyframe_interval;
+}
+
+/*
+ * input_size is what this endpoint sends per GameInput; it does not fit the
+ * handshake above 255 bytes, which leaves such sessions on plain Input.
+ */
+void
+UdpProtocol::SetInputShape(int input_size, int num_players)
+{
+   _local_input_size = (input_size > 0 && input_size <= 0xff) ? input_size : 0;
+   _local_num_players = num_players;
+}
+
+void
+UdpProtocol::ReadSyncShape(uint8 wire_version, uint8 input_size, uint8 num_players)
+{
+   if (_remote_wire_version != wire_version) {
+      Log("peer speaks wire version %d (input size %d, %d players).\n",
+          wire_version, input_size, num_players);
+   }
+   _remote_wire_version = wire_version;
+   _remote_input_size = input_size;
+   _remote_num_players = num_players;
+   if (wire_version >= 2 && num_players != _local_num_players) {
+      Log("peer has %d players, we have %d; keeping plain input.\n", num_players, _local_num_players);
+   }
+}
+
+void
+UdpProtocol::GetRemoteSyncConfig(int *prediction_frames, int *keyframe_interval)
+{
+   *prediction_frames = _remote_prediction_frames;
+   *keyframe_interval = _remote_keyframe_interval;
+}
+
+/*
+ * By default mismatched values are settled by the backend (both sides adopt
+ * the smaller one).  With ggpo.sync.strict_config set, a peer that states
+ * different values is rejected instead.
+ */
+bool
+UdpProtocol::AcceptSyncConfig(int prediction_frames, int keyframe_interval)
+{
+   if (!_strict_sync_config) {
+      return true;
+   }
+   if (prediction_frames && _sync_prediction_frames && prediction_frames != _sync_prediction_frames) {
+      return false;
+   }
+   if (keyframe_interval && _sync_keyframe_interval && keyframe_interval != _sync_keyframe_interval) {
+      return false;
+   }
+   return true;
+}
+
 void
 UdpProtocol::PumpSendQueue()
 {
+   _transport->BeginBatch();
    while (!_send_queue.empty()) {
       QueueEntry &entry = _send_queue.front();
 
@@ -900,7 +1773,11 @@ UdpProtocol::PumpSendQueue()
             break;
          }
       }
-      if (_oop_percent && !_oo_packet.msg && ((rand() % 100) < _oop_percent)) {
+      if ((_drop_percent > 0 && (rand() % 100) < _drop_percent) ||
+          (_drop_input_originals && entry.msg->IsInput() && !entry.msg->IsInputCopy())) {
+         Log("dropping packet for testing (seq: %d)\n", entry.msg->hdr.sequence_number);
+         delete entry.msg;
+      } else if (_oop_percent && !_oo_packet.msg && ((rand() % 100) < _oop_percent)) {
          int delay = rand() % (_send_latency * 10 + 1000);
          Log("creating rogue oop (seq: %d  delay: %d)\n", entry.msg->hdr.sequence_number, delay);
          _oo_packet.send_time = Platform::GetCurrentTimeMS() + delay;
@@ -909,7 +1786,7 @@ UdpProtocol::PumpSendQueue()
       } else {
          ASSERT(entry.dest_addr.sin_addr.s_addr);
 
-         _udp->SendTo((char *)entry.msg, entry.msg->PacketSize(), 0,
+         _transport->SendTo((char *)entry.msg, entry.msg->PacketSize(), 0,
                       (struct sockaddr *)&entry.dest_addr, sizeof entry.dest_addr);
 
          delete entry.msg;
@@ -918,12 +1795,13 @@ UdpProtocol::PumpSendQueue()
    }
    if (_oo_packet.msg && _oo_packet.send_time < Platform::GetCurrentTimeMS()) {
       Log("sending rogue oop!");
-      _udp->SendTo((char *)_oo_packet.msg, _oo_packet.msg->PacketSize(), 0,
+      _transport->SendTo((char *)_oo_packet.msg, _oo_packet.msg->PacketSize(), 0,
                      (struct sockaddr *)&_oo_packet.dest_addr, sizeof _oo_packet.dest_addr);
 
       delete _oo_packet.msg;
       _oo_packet.msg = NULL;
    }
+   _transport->EndBatch();
 }
 
 void
@@ -934,3 +1812,86 @@ UdpProtocol::ClearSendQueue()
       _send_queue.pop();
    }
 }
+
+/*
+ * Sends length bytes to the peer until it acks them, after the ones sent
+ * before.  With UDP_CONTROL_QUEUE_SIZE already waiting, the newest of them
+ * is replaced.  false if the peer predates control messages or the session
+ * isn't running.
+ */
+bool
+UdpProtocol::SendControl(const void *data, int length)
+{
+   if (!_transport || _current_state != Running || _remote_wire_version < 8 ||
+       length < 0 || length > UDP_CONTROL_MAX_SIZE) {
+      return false;
+   }
+   int slot;
+   if (_control_count == UDP_CONTROL_QUEUE_SIZE) {
+      slot = (_control_head + _control_count - 1) % UDP_CONTROL_QUEUE_SIZE;
+   } else {
+      slot = (_control_head + _control_count) % UDP_CONTROL_QUEUE_SIZE;
+      _control_count++;
+   }
+   _control_queue[slot].length = length;
+   memcpy(_control_queue[slot].data, data, length);
+   if (_control_count == 1) {
+      _control_id++;
+      SendControlMsg();
+   }
+   return true;
+}
+
+void
+UdpProtocol::SendControlMsg(void)
+{
+   UdpMsg *msg = new UdpMsg(UdpMsg::Control);
+   const ControlMsg &control = _control_queue[_control_head];
+   msg->u.control.id = _control_id;
+   msg->u.control.length = (uint8)control.length;
+   memcpy(msg->u.control.data, control.data, control.length);
+   _control_send_time = Platform::GetCurrentTimeMS();
+   SendMsg(msg);
+}
+
+bool
+UdpProtocol::OnControl(UdpMsg *msg, int len)
+{
+   int header = (int)sizeof(msg->hdr) + (int)((char *)&msg->u.control.data - (char *)&msg->u.control);
+   int length = msg->u.control.length;
+
+   if (len < header || length > UDP_CONTROL_MAX_SIZE || len < header + length) {
+      Log("dropping malformed control message (%d bytes)\n", len);
+      return false;
+   }
+
+   UdpMsg *ack = new UdpMsg(UdpMsg::ControlAck);
+   ack->u.control_ack.id = msg->u.control.id;
+   SendMsg(ack);
+
+   // a resend whose ack went missing, or one overtaken by a newer message
+   if ((int32)(msg->u.control.id - _remote_control_id) <= 0) {
+      return true;
+   }
+   _remote_control_id = msg->u.control.id;
+
+   Event evt(Event::Control);
+   evt.u.control.length = length;
+   memcpy(evt.u.control.data, msg->u.control.data, length);
+   QueueEvent(evt);
+   return true;
+}
+
+bool
+UdpProtocol::OnControlAck(UdpMsg *msg, int len)
+{
+   if (_control_count && msg->u.control_ack.id == _control_id) {
+      _control_head = (_control_head + 1) % UDP_CONTROL_QUEUE_SIZE;
+      _control_count--;
+      if (_control_count) {
+         _control_id++;
+         SendControlMsg();
+      }
+   }
+   return true;
+}
@@ -11,11 +11,76 @@
 #include "poll.h"
 #include "udp.h"
 #include "udp_msg.h"
+#include "input_codec.h"
 #include "game_input.h"
 #include "timesync.h"
 #include "ggponet.h"
 #include "ring_buffer.h"
 
+#include <vector>
+
+/*
+ * ggpo.network.fec: 0 off, 1..UDP_FEC_MAX_COPIES a fixed number of copies of
+ * each input packet, UDP_FEC_ADAPTIVE scales the copies with the loss the
+ * peer reports.  ggpo.network.drop_input_originals (tests only) drops every
+ * original input packet so that only the copies arrive.
+ */
+#define UDP_FEC_MAX_COPIES    2
+#define UDP_FEC_ADAPTIVE      3
+#define UDP_FEC_COPY_SPACING  4
+#define UDP_FEC_LOSS_LOW      1     /* percent; adaptive sends one copy */
+#define UDP_FEC_LOSS_HIGH     10    /* percent; adaptive sends two */
+
+#define UDP_COMPACT_STATUS_REFRESH  8
+
+/*
+ * ms a quality report or reply waits for an input packet to carry it before
+ * going out on its own (ggpo.network.coalesce, negative disables).
+ */
+#define UDP_COALESCE_WAIT     20
+
+/*
+ * Rejoin state transfer: StateChunks in flight at once, repeated acks that
+ * resend from the gap, ms without an ack before resending from the last
+ * one, and the largest state accepted.
+ */
+#define UDP_STATE_WINDOW            16
+#define UDP_STATE_DUP_ACKS          3
+#define UDP_STATE_RESEND_INTERVAL   100
+#define UDP_STATE_MAX_SIZE          (64 * 1024 * 1024)
+
+/* ms without a ControlAck before the pending Control goes out again */
+#define UDP_CONTROL_RESEND_INTERVAL 100
+/* Control messages waiting to go out, the one in flight included */
+#define UDP_CONTROL_QUEUE_SIZE      8
+static_assert(GGPO_CONTROL_MAX_SIZE <= UDP_CONTROL_MAX_SIZE, "a ggpo_send_control payload must fit a Control message");
+
+/*
+ * Coded input shared by endpoints sent the same stream (the host's
+ * spectators).  All of them code the same confirmed frames against the same
+ * acked frame, so the first to code a window leaves the bits here, one entry
+ * per codec, and the others copy them.
+ */
+struct InputEncodeCache {
+   struct Entry {
+      int      acked_frame;
+      int      first_frame;
+      int      count;         /* pending frames when it was coded */
+      int      frames;        /* of those, how many fit */
+      int      num_bits;
+      uint8    bits[MAX_COMPRESSED_BITS / 8];
+   }           entries[INPUT_CODEC_COUNT];
+   int         hits;
+   int         misses;
+
+   void reset() {
+      for (int i = 0; i < INPUT_CODEC_COUNT; i++) {
+         entries[i].count = 0;
+      }
+      hits = misses = 0;
+   }
+};
+
 class UdpProtocol : public IPollSink
 {
 public:
@@ -37,6 +102,11 @@ public:
          Disconnected,
          NetworkInterrupted,
          NetworkResumed,
+         Checksum,
+         Rejoining,        /* the peer restarted and is picking the match back up */
+         StateSent,        /* it has all of the state given to SendState */
+         StateReceived,    /* TakeReceivedState has the state to resume from */
+         Control,          /* application data from SendControl on the other side */
       };
 
       Type      type;
@@ -51,23 +121,40 @@ public:
          struct {
             int         disconnect_timeout;
          } network_interrupted;
+         struct {
+            int         frame;
+            uint32      checksum;
+         } checksum;
+         struct {
+            int         frame;
+            int         size;
+            int         resume_ms;
+         } state;
+         struct {
+            int         length;
+            uint8       data[UDP_CONTROL_MAX_SIZE];
+         } control;
       } u;
 
-      UdpProtocol::Event(Type t = Unknown) : type(t) { }
+      Event(Type t = Unknown) : type(t) { }
    };
 
 public:
    virtual bool OnLoopPoll(void *cookie);
+   virtual int GetLoopWaitTime(void *cookie);
 
 public:
    UdpProtocol();
    virtual ~UdpProtocol();
 
-   void Init(Udp *udp, Poll &p, int queue, char *ip, u_short port, UdpMsg::connect_status *status);
+   void Init(Transport *transport, Poll &p, int queue, char *ip, u_short port, UdpMsg::connect_status *status);
 
    void Synchronize();
+   void Rejoin();
    bool GetPeerConnectStatus(int id, int *frame);
-   bool IsInitialized() { return _udp != NULL; }
+   uint32 TakePeerStatusChanges() { uint32 changed = _peer_status_changed; _peer_status_changed = 0; return changed; }
+   void SetEncodeCache(InputEncodeCache *cache) { _encode_cache = cache; }
+   bool IsInitialized() { return _transport != NULL; }
    bool IsSynchronized() { return _current_state == Running; }
    bool IsRunning() { return _current_state == Running; }
    void SendInput(GameInput &input);
@@ -81,9 +168,18 @@ public:
    void GGPONetworkStats(Stats *stats);
    void SetLocalFrameNumber(int num);
    int RecommendFrameDelay();
+   float FrameAdvantageError() { return _timesync.advantage_error(); }
 
    void SetDisconnectTimeout(int timeout);
    void SetDisconnectNotifyStart(int timeout);
+   void SetSyncConfig(int prediction_frames, int keyframe_interval);
+   void SetInputShape(int input_size, int num_players);
+   void GetRemoteSyncConfig(int *prediction_frames, int *keyframe_interval);
+   void SetLocalChecksum(int frame, uint32 checksum);
+   void SetReconnectWindow(int window);
+   void SendState(int frame, int codec, int raw_size, const uint8 *data, int size);
+   bool TakeReceivedState(int *frame, int *codec, int *raw_size, std::vector<uint8> &data);
+   bool SendControl(const void *data, int length);
 
 protected:
    enum State {
@@ -109,6 +205,12 @@ protected:
    void LogMsg(const char *prefix, UdpMsg *msg);
    void LogEvent(const char *prefix, const UdpProtocol::Event &evt);
    void SendSyncRequest();
+   bool AcceptRejoin(UdpMsg *msg, int len);
+   void ResetInputStream(void);
+   void SendStateChunks(void);
+   void SendStateAck(void);
+   void SendControlMsg(void);
+   bool AcceptSyncConfig(int prediction_frames, int keyframe_interval);
    void SendMsg(UdpMsg *msg);
    void PumpSendQueue();
    void DispatchMsg(uint8 *buffer, int len);
@@ -117,16 +219,38 @@ protected:
    bool OnSyncRequest(UdpMsg *msg, int len);
    bool OnSyncReply(UdpMsg *msg, int len);
    bool OnInput(UdpMsg *msg, int len);
+   bool ReceiveInput(UdpMsg *msg, InputCodecId codec);
+   int EncodePendingInput(const InputCodec *codec, uint8 *bits, int *frames);
+   bool OnInputCompact(UdpMsg *msg, int len);
+   bool UseCompactInput(int input_size);
+   UdpMsg *PackCompactInput(UdpMsg *msg, InputCodecId codec);
+   void ReadSyncShape(uint8 wire_version, uint8 input_size, uint8 num_players);
+   void QueueInputCopies(UdpMsg *msg, bool has_input);
+   void SendInputCopies(unsigned int now);
+   void TrackReceiveLoss(uint16 seq);
+   void UpdateFecLevel(void);
+   bool CanCoalesce(void);
+   void SendQualityReport(void);
+   void SendQualityReply(void);
+   uint32 PingTime(uint64 now_us);
+   uint32 QualityReplyPong(uint64 now_us);
+   void HandleQualityReply(uint32 pong);
+   void HandleQualityReport(int frame_advantage, int loss_percent, uint32 ping);
+   void HandleChecksum(int frame, uint32 checksum);
    bool OnInputAck(UdpMsg *msg, int len);
    bool OnQualityReport(UdpMsg *msg, int len);
    bool OnQualityReply(UdpMsg *msg, int len);
    bool OnKeepAlive(UdpMsg *msg, int len);
+   bool OnStateChunk(UdpMsg *msg, int len);
+   bool OnStateAck(UdpMsg *msg, int len);
+   bool OnControl(UdpMsg *msg, int len);
+   bool OnControlAck(UdpMsg *msg, int len);
 
 protected:
    /*
     * Network transmission information
     */
-   Udp            *_udp;
+   Transport      *_transport;
    sockaddr_in    _peer_addr; 
    uint16         _magic_number;
    int            _queue;
@@ -135,6 +259,8 @@ protected:
    int            _send_latency;
    int            _send_interval;
    int            _oop_percent;
+   int            _drop_percent;
+   bool           _drop_input_originals;   /* test hook: only FEC copies get through */
    int            _max_input_bits;
    struct {
       int         send_time;
@@ -146,7 +272,7 @@ protected:
    /*
     * Stats
     */
-   int            _round_trip_time;
+   int            _round_trip_us;
    int            _packets_sent;
    int            _bytes_sent;
    int            _kbps_sent;
@@ -157,6 +283,7 @@ protected:
     */
    UdpMsg::connect_status *_local_connect_status;
    UdpMsg::connect_status _peer_connect_status[UDP_MSG_MAX_PLAYERS];
+   uint32                 _peer_status_changed;      /* bit per queue since TakePeerStatusChanges */
 
    State          _current_state;
    union {
@@ -181,6 +308,7 @@ protected:
     * Packet loss...
     */
    RingBuffer<GameInput, 64>  _pending_output;
+   InputEncodeCache           *_encode_cache;
    GameInput                  _last_received_input;
    GameInput                  _last_sent_input;
    GameInput                  _last_acked_input;
@@ -195,6 +323,122 @@ protected:
    uint16                     _next_send_seq;
    uint16                     _next_recv_seq;
 
+   /*
+    * Redundant input (ggpo.network.fec).  The latest Input message is
+    * resent as InputCopy _fec_level times, UDP_FEC_COPY_SPACING ms apart,
+    * unless a newer Input supersedes it first; a peer older than wire
+    * version 2 gets it as a plain Input.  Each Input already carries
+    * every unacked frame, so one surviving copy recovers the loss.
+    */
+   int                        _fec_mode;
+   int                        _fec_level;
+   struct {
+      UdpMsg      *msg;
+      unsigned int send_time;
+      int          remaining;
+   }                          _fec_copy;
+   int                        _fec_copies_sent;
+   int                        _fec_recovered;
+   int                        _input_resent;
+   int                        _recv_packets;    /* since the last quality report */
+   int                        _recv_lost;
+   int                        _remote_loss_percent;
+
+   /*
+    * Compact input (wire version 2).  _local_input_size/_local_num_players
+    * are what we advertise; the _remote_* values come from the peer's sync
+    * messages.  Connect status last_frames are only sent when they change,
+    * or every UDP_COMPACT_STATUS_REFRESH packets so a lost update heals.
+    */
+   bool                       _compact_input;
+   int                        _input_codec_mode;    /* an InputCodecId, or INPUT_CODEC_COUNT for auto */
+   int                        _local_input_size;
+   int                        _local_num_players;
+   int                        _remote_wire_version;
+   int                        _remote_input_size;
+   int                        _remote_num_players;
+   UdpMsg::connect_status     _last_sent_status[UDP_MSG_MAX_PLAYERS];
+   int                        _status_unsent_packets;
+
+   /*
+    * Send scheduling.  Quality reports and replies ride on the next compact
+    * input packet and only go out on their own after UDP_COALESCE_WAIT ms
+    * without one; keepalives only go out after KEEP_ALIVE_INTERVAL of
+    * silence.  Input held back by ggpo.network.send_interval is flushed
+    * from OnLoopPoll once the interval is up.
+    */
+   bool                       _coalesce;
+   unsigned int               _quality_report_due;      /* 0 when none is waiting */
+   bool                       _quality_reply_pending;
+   uint32                     _quality_reply_pong;
+   unsigned int               _quality_reply_recv_time;
+   uint64                     _quality_reply_recv_us;
+   unsigned int               _last_input_send_time;
+   bool                       _input_deferred;
+   int                        _coalesced;
+
+   /*
+    * Confirmed-frame checksums, wire version 5.  Ours goes out with every
+    * quality report; the peer's is raised as an Event::Checksum once per
+    * frame it names.
+    */
+   int                        _checksum_frame;
+   uint32                     _checksum;
+   int                        _remote_checksum_frame;
+
+   /*
+    * Sync::Config values exchanged during the handshake.  Zero means no
+    * preference (spectators, or peers that predate the exchange).
+    */
+   int                        _sync_prediction_frames;
+   int                        _sync_keyframe_interval;
+   int                        _remote_prediction_frames;
+   int                        _remote_keyframe_interval;
+   bool                       _strict_sync_config;
+
+   /*
+    * Mid-match rejoin, wire version 7.  A restarted peer flags its sync
+    * requests UDP_SYNC_REJOIN; while it is overdue and _reconnect_window
+    * keeps the disconnect off, we take it back under its new magic.  The
+    * state it resumes from then goes across as StateChunks, in order,
+    * resent from the last ack.  Input waits until it has all of it.
+    */
+   struct StateTransfer {
+      std::vector<uint8>   data;
+      int                  frame;
+      int                  codec;
+      int                  raw_size;
+      int                  size;
+      int                  sent;
+      int                  acked;
+      int                  dup_acks;      /* repeats of acked; negative after a rewind */
+      unsigned int         last_time;     /* of the last progress or resend */
+      unsigned int         start_time;
+      bool                 active;
+      StateTransfer() : frame(-1), codec(0), raw_size(0), size(0), sent(0), acked(0),
+         dup_acks(0), last_time(0), start_time(0), active(false) { }
+   };
+   int                        _reconnect_window;
+   unsigned int               _rejoin_outage_start;
+   StateTransfer              _state_send;
+   StateTransfer              _state_recv;      /* active while we are the one rejoining */
+
+   /*
+    * Control messages, wire version 8.  One is in flight at a time, resent
+    * every UDP_CONTROL_RESEND_INTERVAL ms until acked; the ones sent after
+    * it wait in order behind it.  _control_id is the one in flight's.
+    */
+   struct ControlMsg {
+      int                     length;
+      uint8                   data[UDP_CONTROL_MAX_SIZE];
+   };
+   uint32                     _control_id;
+   ControlMsg                 _control_queue[UDP_CONTROL_QUEUE_SIZE];
+   int                        _control_head;
+   int                        _control_count;
+   unsigned int               _control_send_time;
+   uint32                     _remote_control_id;   /* newest passed on */
+
    /*
     * Rift synchronization.
     */
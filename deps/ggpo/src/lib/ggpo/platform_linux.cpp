@@ -10,12 +10,12 @@
 #include <strings.h>
 #include <time.h>
 
-uint32 Platform::GetCurrentTimeMS()
+uint64 Platform::GetCurrentTimeUS()
 {
    struct timespec current;
    clock_gettime(CLOCK_MONOTONIC, &current);
 
-   return (uint32)((current.tv_sec * 1000) + (current.tv_nsec / 1000000));
+   return ((uint64)current.tv_sec * 1000000) + (uint64)(current.tv_nsec / 1000);
 }
 
 int Platform::GetConfigInt(const char* name)
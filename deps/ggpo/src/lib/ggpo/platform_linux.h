@@ -41,7 +41,8 @@ public:  // types
 public:  // functions
    static ProcessID GetProcessID() { return getpid(); }
    static void AssertFailed(char *msg) { fprintf(stderr, "%s\n", msg); }
-   static uint32 GetCurrentTimeMS();
+   static uint64 GetCurrentTimeUS();
+   static uint32 GetCurrentTimeMS() { return (uint32)(GetCurrentTimeUS() / 1000); }
    static int GetConfigInt(const char* name);
    static bool GetConfigBool(const char* name);
 };
@@ -11,7 +11,7 @@
 #include <stdint.h>
 #include <strings.h>
 
-uint32 Platform::GetCurrentTimeMS()
+uint64 Platform::GetCurrentTimeUS()
 {
    static mach_timebase_info_data_t timebase = { 0, 0 };
    uint64_t now = mach_absolute_time();
@@ -21,7 +21,7 @@ uint32 Platform::GetCurrentTimeMS()
    }
 
    uint64_t nanos = now * timebase.numer / timebase.denom;
-   return (uint32)(nanos / 1000000);
+   return nanos / 1000;
 }
 
 int Platform::GetConfigInt(const char* name)
@@ -7,6 +7,22 @@
 
 #include "platform_windows.h"
 
+uint64
+Platform::GetCurrentTimeUS()
+{
+   static LARGE_INTEGER frequency = { 0 };
+   LARGE_INTEGER now;
+
+   if (!frequency.QuadPart) {
+      QueryPerformanceFrequency(&frequency);
+   }
+   QueryPerformanceCounter(&now);
+
+   /* Split so that counter * 1000000 cannot overflow. */
+   return (uint64)(now.QuadPart / frequency.QuadPart) * 1000000 +
+          (uint64)(now.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+}
+
 int
 Platform::GetConfigInt(const char* name)
 {
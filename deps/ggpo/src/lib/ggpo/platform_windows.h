@@ -21,7 +21,8 @@ public:  // types
 public:  // functions
    static ProcessID GetProcessID() { return GetCurrentProcessId(); }
    static void AssertFailed(char *msg) { MessageBoxA(NULL, msg, "GGPO Assertion Failed", MB_OK | MB_ICONEXCLAMATION); }
-   static uint32 GetCurrentTimeMS() { return timeGetTime(); }
+   static uint64 GetCurrentTimeUS();
+   static uint32 GetCurrentTimeMS() { return (uint32)(GetCurrentTimeUS() / 1000); }
    static int GetConfigInt(const char* name);
    static bool GetConfigBool(const char* name);
 };
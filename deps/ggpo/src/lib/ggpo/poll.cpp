@@ -9,7 +9,7 @@
 #include "poll.h"
 
 #ifndef _WIN32
-#include <poll.h>
+#include <sys/poll.h>
 #endif
 
 Poll::Poll(void) :
@@ -62,7 +62,7 @@ Poll::Run()
 bool
 Poll::Pump(int timeout)
 {
-   int i, res;
+   int i;
    bool finished = false;
 
    if (_start_time == 0) {
@@ -74,6 +74,38 @@ Poll::Pump(int timeout)
       timeout = MIN(timeout, maxwait);
    }
 
+   finished = !WaitForHandles(timeout);
+
+   for (i = 0; i < _msg_sinks.size(); i++) {
+      PollSinkCb &cb = _msg_sinks[i];
+      finished = !cb.sink->OnMsgPoll(cb.cookie) || finished;
+   }
+
+   for (i = 0; i < _periodic_sinks.size(); i++) {
+      PollPeriodicSinkCb &cb = _periodic_sinks[i];
+      if (cb.interval + cb.last_fired <= elapsed) {
+         cb.last_fired = (elapsed / cb.interval) * cb.interval;
+         finished = !cb.sink->OnPeriodicPoll(cb.cookie, cb.last_fired) || finished;
+      }
+   }
+
+   for (i = 0; i < _loop_sinks.size(); i++) {
+      PollSinkCb &cb = _loop_sinks[i];
+      finished = !cb.sink->OnLoopPoll(cb.cookie) || finished;
+   }
+   return finished;
+}
+
+/*
+ * Blocks until a handle is readable or timeout ms pass, without running
+ * the other sinks.  Returns false if a handle sink asked to stop.
+ */
+bool
+Poll::WaitForHandles(int timeout)
+{
+   int i, res;
+   bool finished = false;
+
 #ifdef _WIN32
    res = WaitForMultipleObjects(_handle_count, _handles, false, timeout);
    if (res >= WAIT_OBJECT_0 && res < WAIT_OBJECT_0 + _handle_count) {
@@ -81,7 +113,11 @@ Poll::Pump(int timeout)
       finished = !_handle_sinks[i].sink->OnHandlePoll(_handle_sinks[i].cookie) || finished;
    }
 #else
-   if (_handle_count > 0) {
+   /*
+    * A zero timeout skips the readiness check: the only handle sink is the
+    * Udp socket, whose loop sink drains it regardless.
+    */
+   if (_handle_count > 0 && timeout != 0) {
       struct pollfd fds[MAX_POLLABLE_HANDLES];
       for (i = 0; i < _handle_count; i++) {
          fds[i].fd = _handles[i];
@@ -100,24 +136,16 @@ Poll::Pump(int timeout)
       poll(NULL, 0, timeout);
    }
 #endif
-   for (i = 0; i < _msg_sinks.size(); i++) {
-      PollSinkCb &cb = _msg_sinks[i];
-      finished = !cb.sink->OnMsgPoll(cb.cookie) || finished;
-   }
-
-   for (i = 0; i < _periodic_sinks.size(); i++) {
-      PollPeriodicSinkCb &cb = _periodic_sinks[i];
-      if (cb.interval + cb.last_fired <= elapsed) {
-         cb.last_fired = (elapsed / cb.interval) * cb.interval;
-         finished = !cb.sink->OnPeriodicPoll(cb.cookie, cb.last_fired) || finished;
-      }
-   }
+   return !finished;
+}
 
-   for (i = 0; i < _loop_sinks.size(); i++) {
-      PollSinkCb &cb = _loop_sinks[i];
-      finished = !cb.sink->OnLoopPoll(cb.cookie) || finished;
+int
+Poll::GetWaitTime()
+{
+   if (_start_time == 0) {
+      _start_time = Platform::GetCurrentTimeMS();
    }
-   return finished;
+   return ComputeWaitTime(Platform::GetCurrentTimeMS() - _start_time);
 }
 
 int
@@ -135,5 +163,12 @@ Poll::ComputeWaitTime(int elapsed)
          }         
       }
    }
+   for (int i = 0; i < _loop_sinks.size(); i++) {
+      PollSinkCb &cb = _loop_sinks[i];
+      int timeout = cb.sink->GetLoopWaitTime(cb.cookie);
+      if (timeout != INFINITE && (waitTime == INFINITE || timeout < waitTime)) {
+         waitTime = MAX(timeout, 0);
+      }
+   }
    return waitTime;
 }
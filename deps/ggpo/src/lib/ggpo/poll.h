@@ -20,6 +20,8 @@ public:
    virtual bool OnMsgPoll(void *) { return true; }
    virtual bool OnPeriodicPoll(void *, int ) { return true; }
    virtual bool OnLoopPoll(void *) { return true; }
+   /* ms until the loop sink next has timed work to do, or INFINITE. */
+   virtual int GetLoopWaitTime(void *) { return INFINITE; }
 };
 
 class Poll {
@@ -31,8 +33,17 @@ public:
    void RegisterLoop(IPollSink *sink, void *cookie = NULL);
 
    void Run();
+
+   /*
+    * Blocks until a registered handle is readable, the next sink deadline
+    * passes or timeout ms elapse, whichever is first, then runs the sinks.
+    */
    bool Pump(int timeout);
 
+   /* The two halves of Pump's wait, for a caller that waits unlocked. */
+   bool WaitForHandles(int timeout);
+   int GetWaitTime();
+
 protected:
    int ComputeWaitTime(int elapsed);
 
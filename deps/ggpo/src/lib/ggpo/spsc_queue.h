@@ -0,0 +1,93 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#ifndef _SPSC_QUEUE_H
+#define _SPSC_QUEUE_H
+
+#include <types.h>
+
+#include <atomic>
+#include <vector>
+
+/*
+ * Bounded single-producer/single-consumer queue.  push() may only be called
+ * from one thread and pop() from one (other) thread; neither takes a lock.
+ * Storage is allocated once in Init so the hot path never allocates.
+ *
+ * _head and _tail count modulo twice the capacity so full and empty can be
+ * told apart without a shared size field.
+ */
+template<class T> class SpscQueue
+{
+public:
+   SpscQueue() :
+      _head(0),
+      _tail(0),
+      _capacity(0) {
+   }
+
+   /* Not thread safe; call while neither side is running. */
+   void Init(int capacity) {
+      _elements.clear();
+      _elements.resize(capacity > 0 ? capacity : 1);
+      _capacity = (unsigned int)_elements.size();
+      _head.store(0, std::memory_order_relaxed);
+      _tail.store(0, std::memory_order_relaxed);
+   }
+
+   bool push(const T &t) {
+      unsigned int tail = _tail.load(std::memory_order_relaxed);
+      if (Distance(_head.load(std::memory_order_acquire), tail) >= _capacity) {
+         return false;
+      }
+      _elements[tail % _capacity] = t;
+      _tail.store(Next(tail), std::memory_order_seq_cst);
+      return true;
+   }
+
+   bool pop(T &t) {
+      unsigned int head = _head.load(std::memory_order_relaxed);
+      if (head == _tail.load(std::memory_order_seq_cst)) {
+         return false;
+      }
+      t = _elements[head % _capacity];
+      _head.store(Next(head), std::memory_order_release);
+      return true;
+   }
+
+   /* Approximate when called from a third thread. */
+   int size() const {
+      return (int)Distance(_head.load(std::memory_order_acquire), _tail.load(std::memory_order_acquire));
+   }
+
+   bool empty() const {
+      return size() == 0;
+   }
+
+   int capacity() const {
+      return (int)_capacity;
+   }
+
+protected:
+   unsigned int Next(unsigned int index) const {
+      return (index + 1) % (_capacity * 2);
+   }
+
+   unsigned int Distance(unsigned int head, unsigned int tail) const {
+      if (!_capacity) {
+         return 0;
+      }
+      return (tail + _capacity * 2 - head) % (_capacity * 2);
+   }
+
+   std::vector<T>             _elements;
+   std::atomic<unsigned int>  _head;
+   std::atomic<unsigned int>  _tail;
+   unsigned int               _capacity;
+};
+
+#endif
@@ -0,0 +1,141 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#include "state_codec.h"
+
+#include "lz4.h"
+#include "lz4hc.h"
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+class Lz4Codec : public StateCodec {
+public:
+   virtual GGPOStateCodec Id() const { return GGPO_STATE_CODEC_LZ4; }
+   virtual const char *Name() const { return "lz4"; }
+
+   virtual int CompressBound(int input_size) const {
+      return LZ4_compressBound(input_size);
+   }
+
+   virtual int Compress(const byte *input, int input_size,
+                        byte *output, int output_capacity, int level) const {
+      return LZ4_compress_fast((const char *)input, (char *)output,
+                               input_size, output_capacity, MAX(level, 1));
+   }
+
+   virtual bool Decompress(const byte *input, int input_size,
+                           byte *output, int output_size) const {
+      return LZ4_decompress_safe((const char *)input, (char *)output,
+                                 input_size, output_size) == output_size;
+   }
+};
+
+/*
+ * Same stream format as LZ4, so frames decode through the LZ4 path; only
+ * the compressor is slower and tighter.
+ */
+class Lz4HcCodec : public Lz4Codec {
+public:
+   virtual GGPOStateCodec Id() const { return GGPO_STATE_CODEC_LZ4HC; }
+   virtual const char *Name() const { return "lz4hc"; }
+
+   virtual int Compress(const byte *input, int input_size,
+                        byte *output, int output_capacity, int level) const {
+      return LZ4_compress_HC((const char *)input, (char *)output,
+                             input_size, output_capacity, level);
+   }
+};
+
+#ifdef HAVE_ZSTD
+/*
+ * One context per thread so the worker and the emulation thread never share
+ * one, and neither allocates a context per frame.
+ */
+struct ZstdContexts {
+   ZSTD_CCtx *cctx;
+   ZSTD_DCtx *dctx;
+   ZstdContexts() : cctx(NULL), dctx(NULL) { }
+   ~ZstdContexts() {
+      if (cctx) {
+         ZSTD_freeCCtx(cctx);
+      }
+      if (dctx) {
+         ZSTD_freeDCtx(dctx);
+      }
+   }
+};
+
+static thread_local ZstdContexts g_zstd;
+
+class ZstdCodec : public StateCodec {
+public:
+   virtual GGPOStateCodec Id() const { return GGPO_STATE_CODEC_ZSTD; }
+   virtual const char *Name() const { return "zstd"; }
+
+   virtual int CompressBound(int input_size) const {
+      return (int)ZSTD_compressBound((size_t)input_size);
+   }
+
+   virtual int Compress(const byte *input, int input_size,
+                        byte *output, int output_capacity, int level) const {
+      if (!g_zstd.cctx) {
+         g_zstd.cctx = ZSTD_createCCtx();
+         if (!g_zstd.cctx) {
+            return 0;
+         }
+      }
+      size_t size = ZSTD_compressCCtx(g_zstd.cctx, output, (size_t)output_capacity,
+                                      input, (size_t)input_size, level);
+      if (ZSTD_isError(size)) {
+         return 0;
+      }
+      return (int)size;
+   }
+
+   virtual bool Decompress(const byte *input, int input_size,
+                           byte *output, int output_size) const {
+      if (!g_zstd.dctx) {
+         g_zstd.dctx = ZSTD_createDCtx();
+         if (!g_zstd.dctx) {
+            return false;
+         }
+      }
+      size_t size = ZSTD_decompressDCtx(g_zstd.dctx, output, (size_t)output_size,
+                                        input, (size_t)input_size);
+      return !ZSTD_isError(size) && size == (size_t)output_size;
+   }
+};
+#endif
+
+static const Lz4Codec   g_lz4;
+static const Lz4HcCodec g_lz4hc;
+#ifdef HAVE_ZSTD
+static const ZstdCodec  g_zstd_codec;
+#endif
+
+} // namespace
+
+const StateCodec *
+StateCodec::Get(GGPOStateCodec id)
+{
+   switch (id) {
+   case GGPO_STATE_CODEC_LZ4:
+      return &g_lz4;
+   case GGPO_STATE_CODEC_LZ4HC:
+      return &g_lz4hc;
+#ifdef HAVE_ZSTD
+   case GGPO_STATE_CODEC_ZSTD:
+      return &g_zstd_codec;
+#endif
+   default:
+      return NULL;
+   }
+}
@@ -0,0 +1,43 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#ifndef _STATE_CODEC_H
+#define _STATE_CODEC_H
+
+#include "types.h"
+#include "ggponet.h"
+
+/*
+ * Compressors for saved frames.  Implementations are stateless from the
+ * caller's point of view and may be used from the emulation thread and the
+ * compression worker at the same time.
+ */
+class StateCodec {
+public:
+   virtual ~StateCodec() { }
+
+   virtual GGPOStateCodec Id() const = 0;
+   virtual const char *Name() const = 0;
+   virtual int CompressBound(int input_size) const = 0;
+
+   /*
+    * Returns the compressed size, or <= 0 if the input did not fit.  level
+    * is codec specific (LZ4 acceleration, LZ4HC or zstd level).
+    */
+   virtual int Compress(const byte *input, int input_size,
+                        byte *output, int output_capacity, int level) const = 0;
+   virtual bool Decompress(const byte *input, int input_size,
+                           byte *output, int output_size) const = 0;
+
+   /*
+    * NULL if the codec is not compiled in (zstd without HAVE_ZSTD) or for
+    * GGPO_STATE_CODEC_RAW, which stores frames as they are.
+    */
+   static const StateCodec *Get(GGPOStateCodec id);
+};
+
+#endif
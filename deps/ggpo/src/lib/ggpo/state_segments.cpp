@@ -0,0 +1,283 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#include "state_segments.h"
+#include "state_codec.h"
+#include "task_pool.h"
+
+#include <limits.h>
+#include <algorithm>
+
+namespace {
+
+/* count, then length, packed size and codec per segment */
+const int SEGMENT_HEADER_SIZE = 3 * (int)sizeof(int);
+
+int HeaderSize(int count)
+{
+   return (int)sizeof(int) + count * SEGMENT_HEADER_SIZE;
+}
+
+int ReadInt(const byte *p)
+{
+   int value;
+   memcpy(&value, p, sizeof value);
+   return value;
+}
+
+void WriteInt(byte *p, int value)
+{
+   memcpy(p, &value, sizeof value);
+}
+
+bool RegionBefore(const GGPOStateRegion &a, const GGPOStateRegion &b)
+{
+   return a.offset < b.offset;
+}
+
+/* Appends [offset, offset + length), cut in pieces of at most GGPO_STATE_SEGMENT_MAX. */
+void AddSegments(std::vector<StateSegment> &segments, int offset, int length, int kind)
+{
+   int pieces = (length + GGPO_STATE_SEGMENT_MAX - 1) / GGPO_STATE_SEGMENT_MAX;
+   for (int i = 0; i < pieces; i++) {
+      StateSegment segment;
+      segment.offset = offset + (int)((long long)length * i / pieces);
+      segment.length = offset + (int)((long long)length * (i + 1) / pieces) - segment.offset;
+      segment.kind = kind;
+      segments.push_back(segment);
+   }
+}
+
+int SegmentBound(const StateSegment &segment, GGPOStateCodec codec, int level)
+{
+   int segment_level;
+   const StateCodec *encoder = StateCodec::Get(SegmentedState::SegmentCodec(segment.kind, codec, level, &segment_level));
+   int bound = encoder ? encoder->CompressBound(segment.length) : 0;
+   /* A segment that doesn't shrink is stored as it is */
+   return MAX(bound, segment.length);
+}
+
+struct CompressContext {
+   const std::vector<StateSegment> *segments;
+   GGPOStateCodec    codec;
+   int               level;
+   const byte        *input;
+   byte              *data;
+   std::vector<int>  start;
+   std::vector<int>  packed;
+   std::vector<int>  codecs;
+};
+
+void CompressSegment(void *context, int index)
+{
+   CompressContext *c = (CompressContext *)context;
+   const StateSegment &segment = (*c->segments)[index];
+   const byte *input = c->input + segment.offset;
+   byte *output = c->data + c->start[index];
+   int level;
+   GGPOStateCodec codec = SegmentedState::SegmentCodec(segment.kind, c->codec, c->level, &level);
+   const StateCodec *encoder = StateCodec::Get(codec);
+   int bound = encoder ? encoder->CompressBound(segment.length) : 0;
+   int packed = encoder ? encoder->Compress(input, segment.length, output, bound, level) : 0;
+
+   if (packed <= 0 || packed >= segment.length) {
+      memcpy(output, input, segment.length);
+      packed = segment.length;
+      codec = GGPO_STATE_CODEC_RAW;
+   }
+   c->packed[index] = packed;
+   c->codecs[index] = codec;
+}
+
+struct DecompressContext {
+   const byte        *input;
+   byte              *output;
+   std::vector<int>  offset;        /* in output */
+   std::vector<int>  start;         /* in input */
+   std::vector<int>  length;
+   std::vector<int>  packed;
+   std::vector<int>  codecs;
+   std::vector<char> ok;
+};
+
+void DecompressSegment(void *context, int index)
+{
+   DecompressContext *c = (DecompressContext *)context;
+   const byte *input = c->input + c->start[index];
+   byte *output = c->output + c->offset[index];
+
+   if (c->codecs[index] == GGPO_STATE_CODEC_RAW) {
+      c->ok[index] = c->packed[index] == c->length[index];
+      if (c->ok[index]) {
+         memcpy(output, input, c->length[index]);
+      }
+      return;
+   }
+   const StateCodec *decoder = StateCodec::Get((GGPOStateCodec)c->codecs[index]);
+   c->ok[index] = decoder && decoder->Decompress(input, c->packed[index], output, c->length[index]);
+}
+
+}
+
+void
+SegmentedState::Plan(const std::vector<GGPOStateRegion> &regions, int size,
+                     std::vector<StateSegment> &segments)
+{
+   std::vector<GGPOStateRegion> sorted(regions);
+   std::stable_sort(sorted.begin(), sorted.end(), RegionBefore);
+
+   segments.clear();
+   int cursor = 0;
+   for (size_t i = 0; i < sorted.size(); i++) {
+      int begin = MAX(sorted[i].offset, cursor);
+      int end = (int)MIN((long long)sorted[i].offset + sorted[i].length, (long long)size);
+      if (end - begin < GGPO_STATE_SEGMENT_MIN) {
+         continue;
+      }
+      int other = begin - cursor;
+      if (other >= GGPO_STATE_SEGMENT_MIN) {
+         AddSegments(segments, cursor, other, GGPO_STATE_REGION_OTHER);
+      } else {
+         /* Too short to stand alone; the region takes it */
+         begin = cursor;
+      }
+      AddSegments(segments, begin, end - begin, sorted[i].kind);
+      cursor = end;
+   }
+   if (segments.empty()) {
+      return;
+   }
+
+   int tail = size - cursor;
+   if (tail >= GGPO_STATE_SEGMENT_MIN) {
+      AddSegments(segments, cursor, tail, GGPO_STATE_REGION_OTHER);
+   } else if (tail > 0) {
+      segments.back().length += tail;
+   }
+   if (segments.size() < 2) {
+      segments.clear();
+   }
+}
+
+GGPOStateCodec
+SegmentedState::SegmentCodec(int kind, GGPOStateCodec codec, int level, int *segment_level)
+{
+   /*
+    * Video RAM is large and mostly changes wholesale, so it gets the cheap
+    * codec; work RAM and the rest compress as the session asked.
+    */
+   if (kind == GGPO_STATE_REGION_VIDEO_RAM && codec != GGPO_STATE_CODEC_RAW) {
+      *segment_level = GGPO_STATE_VIDEO_LZ4_ACCEL;
+      return GGPO_STATE_CODEC_LZ4;
+   }
+   *segment_level = level;
+   return codec;
+}
+
+int
+SegmentedState::CompressBound(const std::vector<StateSegment> &segments, GGPOStateCodec codec)
+{
+   long long bound = HeaderSize((int)segments.size());
+   for (size_t i = 0; i < segments.size(); i++) {
+      bound += SegmentBound(segments[i], codec, 0);
+   }
+   return bound > INT_MAX ? 0 : (int)bound;
+}
+
+int
+SegmentedState::Compress(const std::vector<StateSegment> &segments, GGPOStateCodec codec, int level,
+                         const byte *input, int input_size, byte *output, int output_capacity)
+{
+   int count = (int)segments.size();
+   if (!count || segments.back().offset + segments.back().length != input_size) {
+      return 0;
+   }
+
+   CompressContext c;
+   c.segments = &segments;
+   c.codec = codec;
+   c.level = level;
+   c.input = input;
+   c.data = output + HeaderSize(count);
+   c.start.resize(count);
+   c.packed.resize(count);
+   c.codecs.resize(count);
+
+   int capacity = output_capacity - HeaderSize(count);
+   int start = 0;
+   for (int i = 0; i < count; i++) {
+      c.start[i] = start;
+      start += SegmentBound(segments[i], codec, level);
+      if (start > capacity) {
+         return 0;
+      }
+   }
+
+   TaskPool::Shared()->Run(CompressSegment, &c, count);
+
+   /* Close the gaps the bounds left between the packed segments */
+   byte *write = c.data;
+   WriteInt(output, count);
+   for (int i = 0; i < count; i++) {
+      byte *header = output + sizeof(int) + i * SEGMENT_HEADER_SIZE;
+      WriteInt(header, segments[i].length);
+      WriteInt(header + sizeof(int), c.packed[i]);
+      WriteInt(header + 2 * sizeof(int), c.codecs[i]);
+      if (write != c.data + c.start[i]) {
+         memmove(write, c.data + c.start[i], c.packed[i]);
+      }
+      write += c.packed[i];
+   }
+   return (int)(write - output);
+}
+
+bool
+SegmentedState::Decompress(const byte *input, int input_size, byte *output, int output_size)
+{
+   if (input_size < (int)sizeof(int)) {
+      return false;
+   }
+   int count = ReadInt(input);
+   if (count <= 0 || count > (input_size - (int)sizeof(int)) / SEGMENT_HEADER_SIZE) {
+      return false;
+   }
+
+   DecompressContext c;
+   c.input = input;
+   c.output = output;
+   c.offset.resize(count);
+   c.start.resize(count);
+   c.length.resize(count);
+   c.packed.resize(count);
+   c.codecs.resize(count);
+   c.ok.assign(count, 0);
+
+   long long offset = 0, start = HeaderSize(count);
+   for (int i = 0; i < count; i++) {
+      const byte *header = input + sizeof(int) + i * SEGMENT_HEADER_SIZE;
+      c.length[i] = ReadInt(header);
+      c.packed[i] = ReadInt(header + sizeof(int));
+      c.codecs[i] = ReadInt(header + 2 * sizeof(int));
+      if (c.length[i] <= 0 || c.packed[i] <= 0 ||
+          c.codecs[i] < 0 || c.codecs[i] >= GGPO_STATE_CODEC_COUNT) {
+         return false;
+      }
+      c.offset[i] = (int)offset;
+      c.start[i] = (int)start;
+      offset += c.length[i];
+      start += c.packed[i];
+      if (offset > output_size || start > input_size) {
+         return false;
+      }
+   }
+   if (offset != output_size || start != input_size) {
+      return false;
+   }
+
+   TaskPool::Shared()->Run(DecompressSegment, &c, count);
+   return std::find(c.ok.begin(), c.ok.end(), 0) == c.ok.end();
+}
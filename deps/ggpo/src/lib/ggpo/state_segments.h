@@ -0,0 +1,60 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#ifndef _STATE_SEGMENTS_H
+#define _STATE_SEGMENTS_H
+
+#include "types.h"
+#include "ggponet.h"
+
+#include <vector>
+
+/*
+ * Regions shorter than GGPO_STATE_SEGMENT_MIN are folded into their
+ * neighbours, and segments longer than GGPO_STATE_SEGMENT_MAX are cut into
+ * even pieces so a single large region still spreads over the workers.
+ */
+#define GGPO_STATE_SEGMENT_MIN      (64 * 1024)
+#define GGPO_STATE_SEGMENT_MAX      (1024 * 1024)
+/* LZ4 acceleration for video RAM segments. */
+#define GGPO_STATE_VIDEO_LZ4_ACCEL  8
+
+struct StateSegment {
+   int      offset;
+   int      length;
+   int      kind;          /* GGPOStateRegionKind */
+};
+
+/*
+ * A keyframe cut into segments along ggpo_set_state_regions, each one
+ * compressed on its own and all of them on the shared TaskPool.  The
+ * result is a count, a header per segment (its length, packed size and
+ * GGPOStateCodec) and the packed segments back to back.  Segments that
+ * don't shrink are stored raw.  Like StateCodec, these may run on any
+ * thread.
+ */
+class SegmentedState {
+public:
+   /*
+    * The segments for a state of size bytes, in order and covering all of
+    * it.  Empty when the regions wouldn't split it in two or more.
+    */
+   static void Plan(const std::vector<GGPOStateRegion> &regions, int size,
+                    std::vector<StateSegment> &segments);
+
+   /* The codec and level a segment of the given kind is compressed with. */
+   static GGPOStateCodec SegmentCodec(int kind, GGPOStateCodec codec, int level, int *segment_level);
+
+   static int CompressBound(const std::vector<StateSegment> &segments, GGPOStateCodec codec);
+
+   /* Returns the packed size, or <= 0 if output was too small. */
+   static int Compress(const std::vector<StateSegment> &segments, GGPOStateCodec codec, int level,
+                       const byte *input, int input_size, byte *output, int output_capacity);
+   static bool Decompress(const byte *input, int input_size, byte *output, int output_size);
+};
+
+#endif
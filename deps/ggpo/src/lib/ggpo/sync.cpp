@@ -6,11 +6,16 @@
  */
 
 #include "sync.h"
+#include "task_pool.h"
+#include "thread_hook.h"
 
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 
-#include "lz4.h"
+#include <algorithm>
+#include <chrono>
+
 
 #if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
 #  define GGPO_SIMD_X86 1
@@ -36,6 +41,7 @@ namespace {
 typedef void (*XorInPlaceFn)(byte *dst, const byte *src, size_t len);
 typedef void (*XorBuffersFn)(byte *dst, const byte *lhs, const byte *rhs, size_t len);
 typedef void (*MemcpyFn)(byte *dst, const byte *src, size_t len);
+typedef bool (*BlockEqualFn)(const byte *lhs, const byte *rhs, size_t len);
 
 static void XorBufferInPlaceScalar(byte *dst, const byte *src, size_t len)
 {
@@ -59,6 +65,11 @@ static void FastMemcpyScalar(byte *dst, const byte *src, size_t len)
    memcpy(dst, src, len);
 }
 
+static bool BlockEqualScalar(const byte *lhs, const byte *rhs, size_t len)
+{
+   return memcmp(lhs, rhs, len) == 0;
+}
+
 #if defined(GGPO_SIMD_X86)
 static void Cpuid(int cpu_info[4], int leaf, int subleaf)
 {
@@ -145,6 +156,22 @@ static void FastMemcpySse2(byte *dst, const byte *src, size_t len)
    }
    memcpy(dst, src, len);
 }
+
+static bool BlockEqualSse2(const byte *lhs, const byte *rhs, size_t len)
+{
+   size_t i = 0;
+   size_t limit = len & ~(size_t)15;
+   __m128i diff = _mm_setzero_si128();
+   for (; i < limit; i += 16) {
+      __m128i a = _mm_loadu_si128((const __m128i *)(lhs + i));
+      __m128i b = _mm_loadu_si128((const __m128i *)(rhs + i));
+      diff = _mm_or_si128(diff, _mm_xor_si128(a, b));
+   }
+   if (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xFFFF) {
+      return false;
+   }
+   return i == len || memcmp(lhs + i, rhs + i, len - i) == 0;
+}
 #endif
 
 #if defined(GGPO_SIMD_AVX2)
@@ -215,11 +242,30 @@ static void FastMemcpyAvx2(byte *dst, const byte *src, size_t len)
    }
    memcpy(dst, src, len);
 }
+
+static bool BlockEqualAvx2(const byte *lhs, const byte *rhs, size_t len)
+{
+   size_t i = 0;
+   size_t limit = len & ~(size_t)31;
+   __m256i diff = _mm256_setzero_si256();
+   for (; i < limit; i += 32) {
+      __m256i a = _mm256_loadu_si256((const __m256i *)(lhs + i));
+      __m256i b = _mm256_loadu_si256((const __m256i *)(rhs + i));
+      diff = _mm256_or_si256(diff, _mm256_xor_si256(a, b));
+   }
+   bool equal = _mm256_testz_si256(diff, diff) != 0;
+   _mm256_zeroupper();
+   if (!equal) {
+      return false;
+   }
+   return i == len || memcmp(lhs + i, rhs + i, len - i) == 0;
+}
 #endif
 
 static XorInPlaceFn g_xor_in_place = XorBufferInPlaceScalar;
 static XorBuffersFn g_xor_buffers = XorBuffersScalar;
 static MemcpyFn g_fast_memcpy = FastMemcpyScalar;
+static BlockEqualFn g_block_equal = BlockEqualScalar;
 static std::once_flag g_simd_once;
 
 static void InitSimdDispatch()
@@ -228,11 +274,13 @@ static void InitSimdDispatch()
       g_xor_in_place = XorBufferInPlaceScalar;
       g_xor_buffers = XorBuffersScalar;
       g_fast_memcpy = FastMemcpyScalar;
+      g_block_equal = BlockEqualScalar;
 #if defined(GGPO_SIMD_SSE2)
       if (CpuHasSse2()) {
          g_xor_in_place = XorBufferInPlaceSse2;
          g_xor_buffers = XorBuffersSse2;
          g_fast_memcpy = FastMemcpySse2;
+         g_block_equal = BlockEqualSse2;
       }
 #endif
 #if defined(GGPO_SIMD_AVX2)
@@ -240,6 +288,7 @@ static void InitSimdDispatch()
          g_xor_in_place = XorBufferInPlaceAvx2;
          g_xor_buffers = XorBuffersAvx2;
          g_fast_memcpy = FastMemcpyAvx2;
+         g_block_equal = BlockEqualAvx2;
       }
 #endif
    });
@@ -263,6 +312,25 @@ static inline void FastMemcpy(byte *dst, const byte *src, size_t len)
    g_fast_memcpy(dst, src, len);
 }
 
+static inline bool BlockEqual(const byte *lhs, const byte *rhs, size_t len)
+{
+   InitSimdDispatch();
+   return g_block_equal(lhs, rhs, len);
+}
+
+/*
+ * Sparse delta records store only the GGPO_STATE_DELTA_BLOCK_SIZE blocks
+ * that changed since the previous frame:
+ *
+ *    DeltaRecordHeader  header
+ *    Sync::DeltaRun     runs[header.run_count]
+ *    byte               data[]   (new ^ previous, run after run)
+ */
+struct DeltaRecordHeader {
+   int32 state_size;
+   int32 run_count;
+};
+
 } // namespace
 
 Sync::Sync(UdpMsg::connect_status *connect_status) :
@@ -271,16 +339,49 @@ Sync::Sync(UdpMsg::connect_status *connect_status) :
    _framecount = 0;
    _last_confirmed_frame = -1;
    _max_prediction_frames = 0;
+   _keyframe_interval = GGPO_STATE_KEYFRAME_INTERVAL;
    _lz4_accel = 1;
+   _zstd_level = GGPO_STATE_ZSTD_LEVEL;
+   _codec_mode = GGPO_STATE_CODEC_MODE_LZ4;
+   _compress_budget_us = GGPO_STATE_COMPRESS_BUDGET_US;
+   _raw_memory_ceiling = 0;
+   _ceiling_compressed_frames = 0;
+   _adaptive_codec = GGPO_STATE_CODEC_LZ4;
+   _adaptive_frames = 0;
+   _last_codec = GGPO_STATE_CODEC_RAW;
    _async_compress = false;
    _compress_shutdown = false;
+   _compress_worker_parked = false;
+   _compress_waiter_parked = false;
+   _compress_in_flight = 0;
    _compress_jobs_max = 0;
    _compress_results_max = 0;
+   _compress_wait_count = 0;
+   _compress_wait_us_total = 0;
+   _compress_wait_us_max = 0;
    _state_buffer_size_hint = 0;
+   _state_buffer_capacity = 0;
    _last_state_size = 0;
    _last_state_frame = -1;
    _last_state_valid = false;
-   memset(&_savedstate, 0, sizeof(_savedstate));
+   _frame_cache_clock = 0;
+   _frame_cache_hits = 0;
+   _frame_cache_misses = 0;
+   _frame_cache_prepared = 0;
+   _rollback_depth_avg = 0;
+   _replay_saves_skipped = 0;
+   _state_hint_set = false;
+   _saving = false;
+   _hinted_frames = 0;
+   _segment_plan_size = 0;
+   _segmented_keyframes = 0;
+   _savedstate.head = 0;
+   _checksum_next = 0;
+   _checksum_frames = GGPO_CHECKSUM_FRAMES;
+   _checksum_recorded_frame = -1;
+   _checksum_latest = -1;
+   _checksum_match_frame = -1;
+   ResetRollbackStats();
 }
 
 Sync::~Sync()
@@ -290,19 +391,25 @@ Sync::~Sync()
     * Delete frames manually here rather than in a destructor of the SavedFrame
     * structure so we can efficently copy frames via weak references.
     */
-   for (int i = 0; i < ARRAY_SIZE(_savedstate.frames); i++) {
+   for (size_t i = 0; i < _savedstate.frames.size(); i++) {
       FreeSavedFrameBuffer(_savedstate.frames[i]);
    }
    ClearStateBufferPool();
+   ClearFrameCache();
+   ClearChecksums();
    FreeScratchBuffer(_last_state);
    FreeScratchBuffer(_delta_buffer);
    FreeScratchBuffer(_decompress_buffer);
+   FreeScratchBuffer(_replay_inputs);
 }
 
 void
 Sync::Init(Sync::Config &config)
 {
    StopCompressionThread();
+   for (size_t i = 0; i < _savedstate.frames.size(); i++) {
+      FreeSavedFrameBuffer(_savedstate.frames[i]);
+   }
    ClearStateBufferPool();
    _config = config;
    _callbacks = config.callbacks;
@@ -315,8 +422,49 @@ Sync::Init(Sync::Config &config)
    ResetScratchBuffer(_delta_buffer);
    ResetScratchBuffer(_decompress_buffer);
    _delta_stats = DeltaStats();
+   _segment_plan.reset();
+   _segment_plan_size = 0;
+   _segmented_keyframes = 0;
 
    _max_prediction_frames = config.num_prediction_frames;
+   if (_max_prediction_frames <= 0 || _max_prediction_frames > MAX_PREDICTION_FRAMES_MAX) {
+      _max_prediction_frames = MAX_PREDICTION_FRAMES;
+   }
+   _keyframe_interval = config.keyframe_interval;
+   if (_keyframe_interval <= 0 || _keyframe_interval > GGPO_STATE_KEYFRAME_INTERVAL_MAX) {
+      _keyframe_interval = GGPO_STATE_KEYFRAME_INTERVAL;
+   }
+   _config.num_prediction_frames = _max_prediction_frames;
+   _config.keyframe_interval = _keyframe_interval;
+
+   /*
+    * A rollback can reach back _max_prediction_frames, and reconstructing
+    * that frame may walk a delta chain as far back as the previous keyframe,
+    * so the ring has to hold both plus the frame being saved.
+    */
+   _savedstate.frames.clear();
+   _savedstate.frames.resize(_max_prediction_frames + _keyframe_interval + 1);
+   _savedstate.head = 0;
+
+   int cache_size = Platform::GetConfigInt("ggpo.sync.frame_cache");
+   if (cache_size == 0) {
+      cache_size = GGPO_STATE_FRAME_CACHE_SIZE;
+   }
+   ClearFrameCache();
+   _frame_cache.resize(MAX(cache_size, 0));
+
+   _checksum_frames = Platform::GetConfigInt("ggpo.sync.checksum_frames");
+   if (_checksum_frames <= 0) {
+      _checksum_frames = GGPO_CHECKSUM_FRAMES;
+   }
+   ClearChecksums();
+   _checksums.resize(GGPO_CHECKSUM_HISTORY);
+   _frame_cache_hits = 0;
+   _frame_cache_misses = 0;
+   _frame_cache_prepared = 0;
+   _rollback_depth_avg = 0;
+   ResetRollbackStats();
+
    _lz4_accel = config.lz4_accel;
    if (_lz4_accel <= 0) {
       _lz4_accel = Platform::GetConfigInt("ggpo.sync.lz4_accel");
@@ -325,6 +473,40 @@ Sync::Init(Sync::Config &config)
       }
    }
 
+   _codec_mode = config.codec_mode;
+   if (_codec_mode <= 0) {
+      _codec_mode = Platform::GetConfigInt("ggpo.sync.codec");
+   }
+   if (_codec_mode < GGPO_STATE_CODEC_MODE_LZ4 || _codec_mode > GGPO_STATE_CODEC_MODE_ADAPTIVE) {
+      _codec_mode = GGPO_STATE_CODEC_MODE_LZ4;
+   }
+   if (_codec_mode == GGPO_STATE_CODEC_MODE_ZSTD_FAST && !StateCodec::Get(GGPO_STATE_CODEC_ZSTD)) {
+      Log("zstd state codec not available, using lz4.\n");
+   }
+   _zstd_level = config.zstd_level;
+   if (!_zstd_level) {
+      _zstd_level = Platform::GetConfigInt("ggpo.sync.zstd_level");
+      if (!_zstd_level) {
+         _zstd_level = GGPO_STATE_ZSTD_LEVEL;
+      }
+   }
+   _compress_budget_us = Platform::GetConfigInt("ggpo.sync.compress_budget_us");
+   if (_compress_budget_us <= 0) {
+      _compress_budget_us = GGPO_STATE_COMPRESS_BUDGET_US;
+   }
+   int ceiling_kb = config.raw_memory_ceiling_kb;
+   if (ceiling_kb <= 0) {
+      ceiling_kb = Platform::GetConfigInt("ggpo.sync.raw_ceiling_kb");
+   }
+   _raw_memory_ceiling = ceiling_kb > 0 ? (unsigned long long)ceiling_kb * 1024ULL : 0;
+   _ceiling_compressed_frames = 0;
+   _adaptive_codec = GGPO_STATE_CODEC_LZ4;
+   _adaptive_frames = 0;
+   _last_codec = GGPO_STATE_CODEC_RAW;
+   for (int i = 0; i < GGPO_STATE_CODEC_COUNT; i++) {
+      _codec_stats[i] = CodecStats();
+   }
+
    _async_compress = config.async_compress != 0;
    if (_async_compress) {
       StartCompressionThread();
@@ -340,9 +522,17 @@ Sync::StartCompressionThread()
       return;
    }
 
+   /*
+    * One slot per saved frame is enough: QueueCompression never has more
+    * jobs in flight than that, so neither side can ever find its queue full.
+    */
+   int capacity = (int)_savedstate.frames.size();
+   _compress_jobs.Init(capacity);
+   _compress_results.Init(capacity);
+   _compress_in_flight = 0;
    _compress_shutdown = false;
-   _compress_jobs.clear();
-   _compress_results.clear();
+   _compress_worker_parked = false;
+   _compress_waiter_parked = false;
    _compress_jobs_max = 0;
    _compress_results_max = 0;
 
@@ -352,140 +542,167 @@ Sync::StartCompressionThread()
 void
 Sync::StopCompressionThread()
 {
-   if (!_compress_thread.joinable()) {
-      _async_compress = false;
-      _compress_shutdown = false;
-      _compress_jobs.clear();
-      _compress_results.clear();
-      _compress_jobs_max = 0;
-      _compress_results_max = 0;
-      return;
+   if (_compress_thread.joinable()) {
+      {
+         std::unique_lock<std::mutex> lock(_compress_mutex);
+         _compress_shutdown = true;
+      }
+      _compress_cv.notify_all();
+      _compress_done_cv.notify_all();
+      _compress_thread.join();
    }
 
-   {
-      std::unique_lock<std::mutex> lock(_compress_mutex);
-      _compress_shutdown = true;
+   /*
+    * The worker is gone, so both queues can be drained from here.
+    */
+   CompressJob job;
+   while (_compress_jobs.pop(job)) {
+      if (job.state) {
+         job.state->compress_pending = false;
+      }
    }
-   _compress_cv.notify_all();
-   _compress_done_cv.notify_all();
-   _compress_thread.join();
-
-   {
-      std::unique_lock<std::mutex> lock(_compress_mutex);
-      for (size_t i = 0; i < _compress_jobs.size(); ++i) {
-         if (_compress_jobs[i].state) {
-            _compress_jobs[i].state->compress_pending = false;
-         }
+   CompressResult result;
+   while (_compress_results.pop(result)) {
+      if (result.compressed_buf) {
+         free(result.compressed_buf);
       }
-      _compress_jobs.clear();
-
-      for (size_t i = 0; i < _compress_results.size(); ++i) {
-         if (_compress_results[i].compressed_buf) {
-            free(_compress_results[i].compressed_buf);
-         }
-         if (_compress_results[i].state) {
-            _compress_results[i].state->compress_pending = false;
-         }
+      if (result.delta_record) {
+         free(result.delta_record);
+      }
+      if (result.state) {
+         result.state->compress_pending = false;
       }
-      _compress_results.clear();
-      _compress_shutdown = false;
-      _compress_jobs_max = 0;
-      _compress_results_max = 0;
    }
-
+   /* Dropped jobs never reached _last_state */
+   UpdateLastState(NULL, 0, -1);
+   _compress_in_flight = 0;
+   _compress_shutdown = false;
+   _compress_jobs_max = 0;
+   _compress_results_max = 0;
    _async_compress = false;
 }
 
 void
 Sync::CompressionThreadMain()
 {
+   ThreadHookScope hook("ggpo_compress");
    for (;;) {
       CompressJob job;
-      {
+      if (!_compress_jobs.pop(job)) {
+         if (_compress_shutdown) {
+            return;
+         }
+         /*
+          * Announce that we are parking before the final emptiness check;
+          * QueueCompression publishes its job before checking the flag, so
+          * one of the two always sees the other.
+          */
          std::unique_lock<std::mutex> lock(_compress_mutex);
+         _compress_worker_parked = true;
          _compress_cv.wait(lock, [this] {
             return _compress_shutdown || !_compress_jobs.empty();
          });
-         if (_compress_shutdown && _compress_jobs.empty()) {
-            return;
-         }
-         job = _compress_jobs.front();
-         _compress_jobs.pop_front();
+         _compress_worker_parked = false;
+         continue;
       }
 
-      int max_compressed = LZ4_compressBound(job.input_size);
-      char *compressed_buf = NULL;
-      int compressed_size = 0;
-      if (max_compressed > 0) {
-         compressed_buf = (char *)malloc(max_compressed);
+      CompressResult result;
+      result.state = job.state;
+      result.input = job.input;
+      result.input_size = job.input_size;
+      result.frame = job.frame;
+      result.codec = job.codec;
+      result.compressed_buf = NULL;
+      result.compressed_size = 0;
+      result.compress_us = 0;
+      result.delta_record = NULL;
+      result.delta_record_size = 0;
+      result.has_checksum = job.checksum;
+      result.checksum = job.checksum
+         ? _callbacks.checksum_game_state(job.input, job.input_size, job.frame)
+         : 0;
+
+      /*
+       * Also brings _last_state up to date by copying only the dirty blocks,
+       * or all of it when the frame stays a keyframe.
+       */
+      if (job.delta) {
+         result.delta_record = BuildDeltaRecord(job.input, job.input_size, job.hint,
+                                                _compress_delta_runs, &result.delta_record_size);
       }
-      if (compressed_buf) {
-         compressed_size = LZ4_compress_fast((const char *)job.input,
-                                             compressed_buf,
-                                             job.input_size,
-                                             max_compressed,
-                                             job.lz4_accel);
+      if (!result.delta_record) {
+         EnsureScratchBufferSize(_last_state, job.input_size);
+         FastMemcpy(_last_state.data, job.input, (size_t)job.input_size);
       }
 
-      {
+      /* Delta records follow no region layout; they stay one stream */
+      const byte *payload = result.delta_record ? result.delta_record : job.input;
+      int payload_size = result.delta_record ? result.delta_record_size : job.input_size;
+      const std::vector<StateSegment> *segments = result.delta_record ? NULL : job.segments.get();
+      result.segmented = segments != NULL;
+      if (job.codec != GGPO_STATE_CODEC_RAW) {
+         CompressWith(job.codec, job.level, segments, payload, payload_size,
+                      &result.compressed_buf, &result.compressed_size, &result.compress_us);
+      }
+      job.segments.reset();
+      bool pushed = _compress_results.push(result);
+      ASSERT(pushed);
+
+      if (_compress_waiter_parked) {
          std::unique_lock<std::mutex> lock(_compress_mutex);
-         if (_compress_shutdown) {
-            if (compressed_buf) {
-               free(compressed_buf);
-            }
-            if (job.state) {
-               job.state->compress_pending = false;
-            }
-         } else {
-            CompressResult result;
-            result.state = job.state;
-            result.input = job.input;
-            result.input_size = job.input_size;
-            result.frame = job.frame;
-            result.compressed_buf = compressed_buf;
-            result.compressed_size = compressed_size;
-            _compress_results.push_back(result);
-            if ((int)_compress_results.size() > _compress_results_max) {
-               _compress_results_max = (int)_compress_results.size();
-            }
-         }
+         _compress_done_cv.notify_all();
       }
-      _compress_done_cv.notify_all();
    }
 }
 
+/*
+ * Hands a frame just saved to the worker, which also diffs it against the
+ * previous one when delta is set.  The state's change hint goes with it.
+ */
 bool
-Sync::QueueCompression(SavedFrame *state, const byte *input, int input_size)
+Sync::QueueCompression(SavedFrame *state, GGPOStateCodec codec, const SegmentPlan &segments,
+                       bool delta)
 {
-   if (!_async_compress || !state || !input || input_size <= 0) {
+   if (!_async_compress || !state || !state->buf || state->payload_size <= 0) {
       return false;
    }
    if (!_compress_thread.joinable()) {
       return false;
    }
-
-   std::unique_lock<std::mutex> lock(_compress_mutex);
-   if (_compress_shutdown || state->compress_pending) {
-      return false;
-   }
-   size_t max_queue = ARRAY_SIZE(_savedstate.frames);
-   if (_compress_jobs.size() + _compress_results.size() >= max_queue) {
+   if (state->compress_pending || _compress_in_flight >= _compress_jobs.capacity()) {
       return false;
    }
+
    CompressJob job;
    job.state = state;
-   job.input = input;
-   job.input_size = input_size;
+   job.input = state->buf;
+   job.input_size = state->payload_size;
    job.frame = state->frame;
-   job.lz4_accel = _lz4_accel;
-   _compress_jobs.push_back(job);
-   if ((int)_compress_jobs.size() > _compress_jobs_max) {
-      _compress_jobs_max = (int)_compress_jobs.size();
+   job.codec = codec;
+   job.level = CodecLevel(codec);
+   job.segments = segments;
+   job.hint = NULL;
+   job.delta = delta;
+   job.checksum = _callbacks.checksum_game_state != NULL;
+   if (delta && _state_hint_set && StateHintFits(_state_hint, state->payload_size)) {
+      state->hint.assign(_state_hint.begin(), _state_hint.end());
+      job.hint = &state->hint;
+      _hinted_frames++;
+   }
+   if (!_compress_jobs.push(job)) {
+      return false;
    }
+   _compress_in_flight++;
    state->compress_pending = true;
-   lock.unlock();
+   int queued = _compress_jobs.size();
+   if (queued > _compress_jobs_max) {
+      _compress_jobs_max = queued;
+   }
 
-   _compress_cv.notify_one();
+   if (_compress_worker_parked) {
+      std::unique_lock<std::mutex> lock(_compress_mutex);
+      _compress_cv.notify_one();
+   }
    return true;
 }
 
@@ -496,16 +713,14 @@ Sync::ProcessCompressionResults()
       return;
    }
 
-   for (;;) {
-      CompressResult result;
-      {
-         std::unique_lock<std::mutex> lock(_compress_mutex);
-         if (_compress_results.empty()) {
-            return;
-         }
-         result = _compress_results.front();
-         _compress_results.pop_front();
-      }
+   int ready = _compress_results.size();
+   if (ready > _compress_results_max) {
+      _compress_results_max = ready;
+   }
+
+   CompressResult result;
+   while (_compress_results.pop(result)) {
+      _compress_in_flight--;
       ApplyCompressionResult(result);
    }
 }
@@ -517,6 +732,9 @@ Sync::ApplyCompressionResult(const CompressResult &result)
       if (result.compressed_buf) {
          free(result.compressed_buf);
       }
+      if (result.delta_record) {
+         free(result.delta_record);
+      }
       return;
    }
 
@@ -524,34 +742,55 @@ Sync::ApplyCompressionResult(const CompressResult &result)
    if (state->compress_pending) {
       state->compress_pending = false;
    }
+   int payload_size = result.delta_record ? result.delta_record_size : result.input_size;
+   RecordCodecResult(result.codec, payload_size,
+                     result.compressed_size > 0 ? result.compressed_size : payload_size,
+                     result.compress_us);
 
-   if (!result.compressed_buf || result.compressed_size <= 0) {
+   if (state->frame != result.frame || state->buf != result.input ||
+       state->compressed || state->delta) {
       if (result.compressed_buf) {
          free(result.compressed_buf);
       }
+      if (result.delta_record) {
+         free(result.delta_record);
+      }
       return;
    }
 
-   if (state->frame != result.frame || state->buf != result.input || state->compressed) {
-      free(result.compressed_buf);
-      return;
+   if (result.has_checksum) {
+      state->checksum = result.checksum;
    }
-
-   if (result.compressed_size >= state->uncompressed_size) {
-      free(result.compressed_buf);
-      return;
+   if (result.delta_record) {
+      RecycleStateBuffer(state->buf, state->buf_capacity);
+      state->buf = result.delta_record;
+      state->cbuf = result.delta_record_size;
+      state->payload_size = result.delta_record_size;
+      state->buf_capacity = result.delta_record_size;
+      state->delta = true;
    }
 
-   byte *old_buf = state->buf;
-   if (state->compressed || state->delta) {
-      free(old_buf);
-   } else {
-      RecycleStateBuffer(old_buf, state->buf_capacity);
+   if (result.compressed_buf && result.compressed_size > 0 &&
+       result.compressed_size < state->payload_size) {
+      byte *old_buf = state->buf;
+      if (state->delta) {
+         free(old_buf);
+      } else {
+         RecycleStateBuffer(old_buf, state->buf_capacity);
+      }
+      state->buf = (byte *)result.compressed_buf;
+      state->cbuf = result.compressed_size;
+      state->buf_capacity = result.compressed_size;
+      state->compressed = true;
+      state->segmented = result.segmented;
+      state->codec = result.codec;
+      if (result.segmented) {
+         _segmented_keyframes++;
+      }
+   } else if (result.compressed_buf) {
+      free(result.compressed_buf);
    }
-   state->buf = (byte *)result.compressed_buf;
-   state->cbuf = result.compressed_size;
-   state->buf_capacity = result.compressed_size;
-   state->compressed = true;
+   RecordDeltaStats(*state);
 }
 
 void
@@ -561,36 +800,65 @@ Sync::WaitForCompression(SavedFrame &state)
       return;
    }
 
+   ProcessCompressionResults();
+   if (!state.compress_pending) {
+      return;
+   }
+
+   /*
+    * Only reached when the frame we need is still being compressed, e.g.
+    * a rollback to the frame saved just before.  Count and time these.
+    */
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
    for (;;) {
-      ProcessCompressionResults();
-      if (!state.compress_pending) {
-         break;
+      {
+         std::unique_lock<std::mutex> lock(_compress_mutex);
+         _compress_waiter_parked = true;
+         _compress_done_cv.wait(lock, [this] {
+            return !_compress_results.empty() || _compress_shutdown;
+         });
+         _compress_waiter_parked = false;
       }
-      std::unique_lock<std::mutex> lock(_compress_mutex);
-      _compress_done_cv.wait(lock, [this] {
-         return !_compress_results.empty() || _compress_shutdown;
-      });
       if (_compress_shutdown) {
          state.compress_pending = false;
          break;
       }
+      ProcessCompressionResults();
+      if (!state.compress_pending) {
+         break;
+      }
+   }
+
+   long long waited = (long long)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+   _compress_wait_count++;
+   _compress_wait_us_total += (unsigned long long)waited;
+   if (waited > _compress_wait_us_max) {
+      _compress_wait_us_max = (int)MIN(waited, (long long)INT_MAX);
    }
 }
 
 void
-Sync::CompressSync(SavedFrame &state, const byte *input, int input_size)
+Sync::CompressSync(SavedFrame &state, const byte *input, int input_size, GGPOStateCodec codec,
+                   const SegmentPlan &segments)
 {
-   int max_compressed = LZ4_compressBound(input_size);
-   char *compressed_buf = (char *)malloc(max_compressed);
+   if (codec == GGPO_STATE_CODEC_RAW) {
+      RecordCodecResult(codec, input_size, input_size, 0);
+      return;
+   }
+
+   char *compressed_buf = NULL;
+   int compressed_size = 0;
+   int compress_us = 0;
+   CompressWith(codec, CodecLevel(codec), segments.get(), input, input_size,
+                &compressed_buf, &compressed_size, &compress_us);
+   RecordCodecResult(codec, input_size,
+                     compressed_size > 0 ? compressed_size : input_size,
+                     compress_us);
    if (!compressed_buf) {
       return;
    }
 
-   int compressed_size = LZ4_compress_fast((const char *)input,
-                                           compressed_buf,
-                                           input_size,
-                                           max_compressed,
-                                           _lz4_accel);
    if (compressed_size > 0 && compressed_size < input_size) {
       byte *old_buf = state.buf;
       if (state.compressed || state.delta) {
@@ -602,11 +870,200 @@ Sync::CompressSync(SavedFrame &state, const byte *input, int input_size)
       state.cbuf = compressed_size;
       state.buf_capacity = compressed_size;
       state.compressed = true;
+      state.segmented = segments != NULL;
+      state.codec = codec;
+      if (state.segmented) {
+         _segmented_keyframes++;
+      }
    } else {
       free(compressed_buf);
    }
 }
 
+/*
+ * Runs on either thread.  *output is malloc'd and owned by the caller, even
+ * when the codec could not shrink the input.  With segments, the input is
+ * compressed as SegmentedState.
+ */
+bool
+Sync::CompressWith(GGPOStateCodec codec, int level, const std::vector<StateSegment> *segments,
+                   const byte *input, int input_size,
+                   char **output, int *output_size, int *compress_us)
+{
+   *output = NULL;
+   *output_size = 0;
+   *compress_us = 0;
+
+   const StateCodec *encoder = StateCodec::Get(codec);
+   if (!encoder || !input || input_size <= 0) {
+      return false;
+   }
+   int bound = segments ? SegmentedState::CompressBound(*segments, codec)
+                        : encoder->CompressBound(input_size);
+   if (bound <= 0) {
+      return false;
+   }
+   *output = (char *)malloc(bound);
+   if (!*output) {
+      return false;
+   }
+
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+   if (segments) {
+      *output_size = SegmentedState::Compress(*segments, codec, level, input, input_size, (byte *)*output, bound);
+   } else {
+      *output_size = encoder->Compress(input, input_size, (byte *)*output, bound, level);
+   }
+   long long elapsed = (long long)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+   *compress_us = (int)MIN(elapsed, (long long)INT_MAX);
+   return *output_size > 0;
+}
+
+int
+Sync::CodecLevel(GGPOStateCodec codec)
+{
+   switch (codec) {
+   case GGPO_STATE_CODEC_LZ4:
+      return _lz4_accel;
+   case GGPO_STATE_CODEC_LZ4HC:
+      return GGPO_STATE_LZ4HC_LEVEL;
+   case GGPO_STATE_CODEC_ZSTD:
+      return _zstd_level;
+   default:
+      return 0;
+   }
+}
+
+GGPOStateCodec
+Sync::SelectCodec()
+{
+   switch (_codec_mode) {
+   case GGPO_STATE_CODEC_MODE_LZ4HC_IDLE:
+      /*
+       * HC costs several times what LZ4 does, so only hand it to the worker
+       * when nothing else is in flight and it cannot delay a rollback.
+       */
+      if (_async_compress && _compress_thread.joinable() && _compress_in_flight == 0) {
+         return GGPO_STATE_CODEC_LZ4HC;
+      }
+      return GGPO_STATE_CODEC_LZ4;
+   case GGPO_STATE_CODEC_MODE_ZSTD_FAST:
+      if (StateCodec::Get(GGPO_STATE_CODEC_ZSTD)) {
+         return GGPO_STATE_CODEC_ZSTD;
+      }
+      return GGPO_STATE_CODEC_LZ4;
+   case GGPO_STATE_CODEC_MODE_RAW:
+      return GGPO_STATE_CODEC_RAW;
+   case GGPO_STATE_CODEC_MODE_ADAPTIVE:
+      return _adaptive_codec;
+   default:
+      return GGPO_STATE_CODEC_LZ4;
+   }
+}
+
+/*
+ * Memory-over-CPU mode: while the whole ring fits under the ceiling,
+ * frames stay raw and rollbacks load them with a plain copy.  The
+ * configured codec only takes over once the ring would outgrow it.
+ */
+GGPOStateCodec
+Sync::ApplyMemoryCeiling(GGPOStateCodec codec)
+{
+   if (!_raw_memory_ceiling) {
+      return codec;
+   }
+   if (SavedStateBytes() <= _raw_memory_ceiling) {
+      return GGPO_STATE_CODEC_RAW;
+   }
+   _ceiling_compressed_frames++;
+   if (codec == GGPO_STATE_CODEC_RAW) {
+      return GGPO_STATE_CODEC_LZ4;
+   }
+   return codec;
+}
+
+unsigned long long
+Sync::SavedStateBytes()
+{
+   unsigned long long total = 0;
+   for (size_t i = 0; i < _savedstate.frames.size(); i++) {
+      if (_savedstate.frames[i].buf) {
+         total += (unsigned long long)_savedstate.frames[i].buf_capacity;
+      }
+   }
+   return total;
+}
+
+void
+Sync::RecordCodecResult(GGPOStateCodec codec, int input_size, int output_size, int compress_us)
+{
+   if (codec < 0 || codec >= GGPO_STATE_CODEC_COUNT || input_size <= 0) {
+      return;
+   }
+
+   CodecStats &stats = _codec_stats[codec];
+   int ratio = (int)MIN(((unsigned long long)output_size * 100ULL) / (unsigned long long)input_size, 100ULL);
+   if (!stats.frames) {
+      stats.us_avg = compress_us;
+      stats.ratio_avg = ratio;
+   } else {
+      stats.us_avg = (stats.us_avg * 7 + compress_us) / 8;
+      stats.ratio_avg = (stats.ratio_avg * 7 + ratio) / 8;
+   }
+   stats.frames++;
+   stats.input_bytes += (unsigned long long)input_size;
+   stats.output_bytes += (unsigned long long)output_size;
+   stats.us_total += (unsigned long long)compress_us;
+
+   if (_codec_mode == GGPO_STATE_CODEC_MODE_ADAPTIVE && codec == _adaptive_codec) {
+      UpdateAdaptiveCodec();
+   }
+}
+
+/*
+ * Walks the raw -> lz4 -> zstd ladder.  Steps down as soon as the current
+ * codec blows the budget or stops paying for itself, and only steps up
+ * after GGPO_STATE_ADAPTIVE_PROBE_FRAMES frames comfortably under budget.
+ * A codec that was stepped away from is retried eight times less often.
+ */
+void
+Sync::UpdateAdaptiveCodec()
+{
+   static const GGPOStateCodec ladder[] = {
+      GGPO_STATE_CODEC_RAW,
+      GGPO_STATE_CODEC_LZ4,
+      GGPO_STATE_CODEC_ZSTD,
+   };
+   int steps = StateCodec::Get(GGPO_STATE_CODEC_ZSTD) ? 3 : 2;
+   int step = 0;
+   while (step < steps - 1 && ladder[step] != _adaptive_codec) {
+      step++;
+   }
+
+   _adaptive_frames++;
+   if (_adaptive_frames < 8) {
+      return;
+   }
+
+   const CodecStats &current = _codec_stats[_adaptive_codec];
+   if (step > 0 && (current.us_avg > _compress_budget_us || current.ratio_avg > 90)) {
+      _adaptive_codec = ladder[step - 1];
+      _adaptive_frames = 0;
+      return;
+   }
+
+   if (step < steps - 1 && _adaptive_frames >= GGPO_STATE_ADAPTIVE_PROBE_FRAMES &&
+       current.us_avg * 2 < _compress_budget_us) {
+      const CodecStats &next = _codec_stats[ladder[step + 1]];
+      bool failed = next.frames && (next.us_avg > _compress_budget_us || next.ratio_avg > 90);
+      if (!failed || _adaptive_frames >= GGPO_STATE_ADAPTIVE_PROBE_FRAMES * 8) {
+         _adaptive_codec = ladder[step + 1];
+         _adaptive_frames = 0;
+      }
+   }
+}
+
 byte *
 Sync::AcquireStateBuffer(int *capacity)
 {
@@ -655,7 +1112,7 @@ Sync::RecycleStateBuffer(byte *buffer, int capacity)
       return;
    }
 
-   int max_pool = ARRAY_SIZE(_savedstate.frames);
+   int max_pool = (int)_savedstate.frames.size();
    if ((int)_state_buffer_pool.size() >= max_pool) {
       _callbacks.free_buffer(buffer);
       return;
@@ -667,6 +1124,39 @@ Sync::RecycleStateBuffer(byte *buffer, int capacity)
    _state_buffer_pool.push_back(entry);
 }
 
+void
+Sync::SetStateBufferCapacity(int capacity)
+{
+   _state_buffer_capacity = MAX(capacity, 0);
+}
+
+/*
+ * Adopt the smaller of our and a peer's prediction window and keyframe
+ * interval so both sides agree.  Only ever shrinks, so the ring allocated in
+ * Init still covers the new window.  Zero means the peer has no preference.
+ */
+bool
+Sync::NegotiateConfig(int num_prediction_frames, int keyframe_interval)
+{
+   bool changed = false;
+
+   if (num_prediction_frames > 0 && num_prediction_frames < _max_prediction_frames) {
+      Log("Reducing prediction window from %d to %d to match peer.\n",
+          _max_prediction_frames, num_prediction_frames);
+      _max_prediction_frames = num_prediction_frames;
+      _config.num_prediction_frames = num_prediction_frames;
+      changed = true;
+   }
+   if (keyframe_interval > 0 && keyframe_interval < _keyframe_interval) {
+      Log("Reducing keyframe interval from %d to %d to match peer.\n",
+          _keyframe_interval, keyframe_interval);
+      _keyframe_interval = keyframe_interval;
+      _config.keyframe_interval = keyframe_interval;
+      changed = true;
+   }
+   return changed;
+}
+
 void
 Sync::ClearStateBufferPool()
 {
@@ -720,63 +1210,274 @@ Sync::EnsureScratchBufferSize(ScratchBuffer &buffer, int size)
 bool
 Sync::DecodeSavedFrameRaw(const SavedFrame &state, byte *buffer, int buffer_size)
 {
-   if (!state.buf || state.uncompressed_size <= 0 || !buffer || buffer_size < state.uncompressed_size) {
+   if (!state.buf || state.payload_size <= 0 || !buffer || buffer_size < state.payload_size) {
       return false;
    }
 
+   if (state.segmented) {
+      return SegmentedState::Decompress(state.buf, state.cbuf, buffer, state.payload_size);
+   }
    if (state.compressed) {
-      int decoded = LZ4_decompress_safe((const char *)state.buf,
-                                        (char *)buffer,
-                                        state.cbuf,
-                                        state.uncompressed_size);
-      return decoded == state.uncompressed_size;
+      const StateCodec *decoder = StateCodec::Get(state.codec);
+      return decoder && decoder->Decompress(state.buf, state.cbuf, buffer, state.payload_size);
    }
 
-   FastMemcpy(buffer, state.buf, (size_t)state.uncompressed_size);
+   FastMemcpy(buffer, state.buf, (size_t)state.payload_size);
    return true;
 }
 
 bool
 Sync::DecodeSavedFrameInternal(const SavedFrame &state, ScratchBuffer &buffer)
 {
-   if (!state.buf || state.uncompressed_size <= 0) {
+   if (!state.buf || state.payload_size <= 0) {
       return false;
    }
-   EnsureScratchBufferSize(buffer, state.uncompressed_size);
+   EnsureScratchBufferSize(buffer, state.payload_size);
    return DecodeSavedFrameRaw(state, buffer.data, buffer.size);
 }
 
 bool
-Sync::ReconstructFrameInternal(int frame, ScratchBuffer &buffer)
+Sync::HintStateChanges(const GGPOStateRange *ranges, int count)
 {
-   int base_frame = frame;
-   bool found_base = false;
-   int state_index = FindSavedFrameIndex(frame);
-   SavedFrame *state = NULL;
-
-   if (state_index < 0) {
+   if (!_saving) {
       return false;
    }
+   _state_hint.assign(ranges, ranges + count);
+   _state_hint_set = true;
+   return true;
+}
 
-   state = _savedstate.frames + state_index;
+void
+Sync::SetStateRegions(const GGPOStateRegion *regions, int count)
+{
+   _state_regions.assign(regions, regions + count);
+   _segment_plan.reset();
+   _segment_plan_size = 0;
+}
 
-   if (!state->delta) {
-      return DecodeSavedFrameInternal(*state, buffer);
+/*
+ * The segments keyframes of this size are cut into, or NULL if they are
+ * compressed whole.  Replanned only when the size or the regions change.
+ */
+Sync::SegmentPlan
+Sync::GetSegmentPlan(int size)
+{
+   if (_state_regions.empty()) {
+      return SegmentPlan();
+   }
+   if (_segment_plan_size != size) {
+      std::vector<StateSegment> *segments = new std::vector<StateSegment>();
+      SegmentedState::Plan(_state_regions, size, *segments);
+      if (segments->empty()) {
+         delete segments;
+         _segment_plan.reset();
+      } else {
+         _segment_plan.reset(segments);
+         Log("keyframes of %d bytes split in %d segments.\n", size, (int)segments->size());
+      }
+      _segment_plan_size = size;
    }
+   return _segment_plan;
+}
 
-   while (base_frame >= 0) {
-      int base_index = FindSavedFrameIndex(base_frame);
-      SavedFrame *base_state = NULL;
+bool
+Sync::StateHintFits(const std::vector<GGPOStateRange> &hint, int size)
+{
+   int end = 0;
 
-      if (base_index < 0) {
+   for (size_t i = 0; i < hint.size(); i++) {
+      const GGPOStateRange &range = hint[i];
+      if (range.offset < end || range.length <= 0 || range.length > size - range.offset) {
+         Log("ignoring state hint: range %d+%d does not fit a %d byte state.\n",
+             range.offset, range.length, size);
          return false;
       }
+      end = range.offset + range.length;
+   }
+   return true;
+}
 
-      base_state = _savedstate.frames + base_index;
-      if (!base_state->delta) {
-         if (!DecodeSavedFrameInternal(*base_state, buffer)) {
-            return false;
-         }
+/*
+ * Adds the changed blocks from the one at begin, which must start a block,
+ * through the one holding byte end - 1 to runs.
+ */
+void
+Sync::FindDeltaRuns(const byte *state, int begin, int end, int size,
+                    std::vector<DeltaRun> &runs, int *data_size)
+{
+   byte *prev = _last_state.data;
+
+   for (int offset = begin; offset < end; offset += GGPO_STATE_DELTA_BLOCK_SIZE) {
+      int len = MIN(GGPO_STATE_DELTA_BLOCK_SIZE, size - offset);
+      if (BlockEqual(state + offset, prev + offset, (size_t)len)) {
+         continue;
+      }
+      *data_size += len;
+      if (!runs.empty()) {
+         DeltaRun &last = runs.back();
+         if (last.offset + last.length == offset) {
+            last.length += len;
+            continue;
+         }
+      }
+      DeltaRun run;
+      run.offset = offset;
+      run.length = len;
+      runs.push_back(run);
+   }
+}
+
+/*
+ * Runs on whichever thread owns _last_state; see CompressJob.
+ */
+byte *
+Sync::BuildDeltaRecord(const byte *state, int size, const std::vector<GGPOStateRange> *hint,
+                       std::vector<DeltaRun> &runs, int *record_size)
+{
+   byte *prev = _last_state.data;
+   int data_size = 0;
+
+   /*
+    * Find the dirty blocks first so the record can be allocated at its
+    * exact size and only the changed bytes are touched a second time.
+    * With a hint from the save, only the blocks its ranges touch.
+    */
+   runs.clear();
+   if (hint) {
+      int next = 0;
+      for (size_t i = 0; i < hint->size(); i++) {
+         const GGPOStateRange &range = (*hint)[i];
+         int begin = MAX(next, range.offset - range.offset % GGPO_STATE_DELTA_BLOCK_SIZE);
+         int end = range.offset + range.length;
+         FindDeltaRuns(state, begin, end, size, runs, &data_size);
+         next = MAX(next, end + GGPO_STATE_DELTA_BLOCK_SIZE - 1 - (end - 1) % GGPO_STATE_DELTA_BLOCK_SIZE);
+      }
+   } else {
+      FindDeltaRuns(state, 0, size, size, runs, &data_size);
+   }
+
+   int runs_size = (int)(runs.size() * sizeof(DeltaRun));
+   int total = (int)sizeof(DeltaRecordHeader) + runs_size + data_size;
+   if (total >= size / 2) {
+      /*
+       * Most of the state changed, a keyframe is cheaper to store and
+       * costs nothing to reconstruct.
+       */
+      return NULL;
+   }
+
+   byte *record = (byte *)malloc(total);
+   ASSERT(record);
+
+   DeltaRecordHeader header;
+   header.state_size = size;
+   header.run_count = (int32)runs.size();
+   memcpy(record, &header, sizeof(header));
+   if (runs_size > 0) {
+      memcpy(record + sizeof(header), &runs[0], runs_size);
+   }
+
+   byte *out = record + sizeof(header) + runs_size;
+   for (size_t i = 0; i < runs.size(); i++) {
+      const DeltaRun &run = runs[i];
+      XorBuffers(out, state + run.offset, prev + run.offset, (size_t)run.length);
+      FastMemcpy(prev + run.offset, state + run.offset, (size_t)run.length);
+      out += run.length;
+   }
+
+   *record_size = total;
+   return record;
+}
+
+bool
+Sync::ApplyDeltaRecord(const byte *record, int record_size, byte *buffer, int buffer_size)
+{
+   DeltaRecordHeader header;
+
+   if (!record || record_size < (int)sizeof(header)) {
+      return false;
+   }
+   memcpy(&header, record, sizeof(header));
+   if (header.state_size != buffer_size || header.run_count < 0) {
+      return false;
+   }
+
+   const byte *runs = record + sizeof(header);
+   const byte *data = runs + header.run_count * sizeof(DeltaRun);
+   const byte *end = record + record_size;
+   if (data > end) {
+      return false;
+   }
+
+   for (int i = 0; i < header.run_count; i++) {
+      DeltaRun run;
+      memcpy(&run, runs + i * sizeof(DeltaRun), sizeof(run));
+      if (run.offset < 0 || run.length <= 0 ||
+          run.offset + run.length > buffer_size ||
+          run.length > end - data) {
+         return false;
+      }
+      XorBufferInPlace(buffer + run.offset, data, (size_t)run.length);
+      data += run.length;
+   }
+   return true;
+}
+
+bool
+Sync::ApplySavedDelta(const SavedFrame &state, byte *buffer, int buffer_size)
+{
+   if (!state.compressed) {
+      return ApplyDeltaRecord(state.buf, state.payload_size, buffer, buffer_size);
+   }
+   if (!DecodeSavedFrameInternal(state, _delta_buffer)) {
+      return false;
+   }
+   return ApplyDeltaRecord(_delta_buffer.data, _delta_buffer.size, buffer, buffer_size);
+}
+
+bool
+Sync::ReconstructFrameInternal(int frame, ScratchBuffer &buffer)
+{
+   int base_frame = frame;
+   bool found_base = false;
+   int state_index = FindSavedFrameIndex(frame);
+   SavedFrame *state = NULL;
+
+   if (state_index < 0) {
+      return false;
+   }
+
+   state = &_savedstate.frames[state_index];
+
+   if (!state->delta) {
+      return DecodeSavedFrameInternal(*state, buffer);
+   }
+
+   while (base_frame >= 0) {
+      int base_index;
+      SavedFrame *base_state = NULL;
+
+      /*
+       * A cached frame is as good as a keyframe and usually much closer.
+       */
+      CachedFrame *cached = FindCachedFrame(base_frame);
+      if (cached && cached->data.size == state->uncompressed_size) {
+         EnsureScratchBufferSize(buffer, cached->data.size);
+         FastMemcpy(buffer.data, cached->data.data, (size_t)cached->data.size);
+         found_base = true;
+         break;
+      }
+
+      base_index = FindSavedFrameIndex(base_frame);
+      if (base_index < 0) {
+         return false;
+      }
+
+      base_state = &_savedstate.frames[base_index];
+      if (!base_state->delta) {
+         if (!DecodeSavedFrameInternal(*base_state, buffer)) {
+            return false;
+         }
          found_base = true;
          break;
       }
@@ -795,7 +1496,7 @@ Sync::ReconstructFrameInternal(int frame, ScratchBuffer &buffer)
          return false;
       }
 
-      delta_state = _savedstate.frames + delta_index;
+      delta_state = &_savedstate.frames[delta_index];
       if (!delta_state->delta) {
          if (!DecodeSavedFrameInternal(*delta_state, buffer)) {
             return false;
@@ -803,20 +1504,123 @@ Sync::ReconstructFrameInternal(int frame, ScratchBuffer &buffer)
          continue;
       }
 
-      EnsureScratchBufferSize(_delta_buffer, delta_state->uncompressed_size);
-
-      if (!DecodeSavedFrameInternal(*delta_state, _delta_buffer)) {
+      if (!ApplySavedDelta(*delta_state, buffer.data, buffer.size)) {
          return false;
       }
+   }
+
+   return true;
+}
+
+Sync::CachedFrame *
+Sync::FindCachedFrame(int frame)
+{
+   for (size_t i = 0; i < _frame_cache.size(); i++) {
+      CachedFrame &entry = _frame_cache[i];
+      if (entry.frame == frame && frame >= 0) {
+         entry.last_used = ++_frame_cache_clock;
+         return &entry;
+      }
+   }
+   return NULL;
+}
 
-      if (buffer.size < delta_state->uncompressed_size) {
-         return false;
+/*
+ * Takes ownership of buffer's contents by swapping it with the evicted
+ * entry, so caching a freshly reconstructed frame costs no copy.
+ */
+void
+Sync::StoreCachedFrame(int frame, ScratchBuffer &buffer)
+{
+   CachedFrame *slot = NULL;
+
+   if (_frame_cache.empty() || frame < 0 || buffer.size <= 0) {
+      return;
+   }
+   for (size_t i = 0; i < _frame_cache.size(); i++) {
+      CachedFrame &entry = _frame_cache[i];
+      if (entry.frame == frame) {
+         slot = &entry;
+         break;
+      }
+      if (!slot || (slot->frame >= 0 && (entry.frame < 0 || entry.last_used < slot->last_used))) {
+         slot = &entry;
       }
+   }
 
-      XorBufferInPlace(buffer.data, _delta_buffer.data, (size_t)delta_state->uncompressed_size);
+   ScratchBuffer evicted = slot->data;
+   slot->data = buffer;
+   slot->frame = frame;
+   slot->last_used = ++_frame_cache_clock;
+   buffer = evicted;
+}
+
+void
+Sync::InvalidateCachedFrames(int first_frame)
+{
+   for (size_t i = 0; i < _frame_cache.size(); i++) {
+      if (_frame_cache[i].frame >= first_frame) {
+         _frame_cache[i].frame = -1;
+      }
    }
+}
 
-   return true;
+void
+Sync::ClearFrameCache()
+{
+   for (size_t i = 0; i < _frame_cache.size(); i++) {
+      FreeScratchBuffer(_frame_cache[i].data);
+   }
+   _frame_cache.clear();
+}
+
+bool
+Sync::CompressorIdle()
+{
+   if (!_async_compress) {
+      return true;
+   }
+   return _compress_jobs.empty();
+}
+
+/*
+ * Called from the idle poll when no rollback is needed.  Decodes the frame
+ * the next rollback is most likely to land on, so LoadFrame only has to
+ * copy it out.  Skipped while the compressor still has work queued so the
+ * two do not compete for the same idle time.
+ */
+void
+Sync::PrepareRollbackTarget()
+{
+   if (_frame_cache.empty() || _rollback_depth_avg <= 0 || _rollingback) {
+      return;
+   }
+   if (!CompressorIdle()) {
+      return;
+   }
+
+   int depth = (_rollback_depth_avg + 8) / 16;
+   int target = _framecount + 1 - depth;
+   target = MAX(target, _framecount - _max_prediction_frames);
+   target = MAX(target, _last_confirmed_frame);
+   target = MIN(target, _framecount - 1);
+   if (target < 0 || FindCachedFrame(target)) {
+      return;
+   }
+
+   int index = FindSavedFrameIndex(target);
+   if (index < 0) {
+      return;
+   }
+   const SavedFrame &state = _savedstate.frames[index];
+   if (!state.buf || (!state.delta && !state.compressed)) {
+      return;
+   }
+   if (!ReconstructFrameInternal(target, _decompress_buffer)) {
+      return;
+   }
+   StoreCachedFrame(target, _decompress_buffer);
+   _frame_cache_prepared++;
 }
 
 void
@@ -828,10 +1632,182 @@ Sync::SetLastConfirmedFrame(int frame)
          _input_queues[i].DiscardConfirmedFrames(frame - 1);
       }
    }
+   RecordChecksums(frame);
+}
+
+/*
+ * Every frame up to confirmed_frame has been run with the final inputs, so
+ * the checksums saved for those frames are the ones every peer should have.
+ * Only frames the caller took a checksum for are kept.
+ */
+void
+Sync::RecordChecksums(int confirmed_frame)
+{
+   int first;
+
+   /* The current frame is the newest one with a saved state. */
+   confirmed_frame = MIN(confirmed_frame, _framecount);
+   first = MAX(_checksum_recorded_frame + 1,
+               confirmed_frame - (int)_savedstate.frames.size() + 1);
+
+   if (_checksums.empty() || confirmed_frame <= _checksum_recorded_frame) {
+      return;
+   }
+   first = ((MAX(first, 0) + _checksum_frames - 1) / _checksum_frames) * _checksum_frames;
+   _checksum_recorded_frame = confirmed_frame;
+
+   for (int frame = first; frame <= confirmed_frame; frame += _checksum_frames) {
+      int index = FindSavedFrameIndex(frame);
+      if (index < 0) {
+         continue;
+      }
+      /* The worker may not have got to its checksum yet */
+      WaitForCompression(_savedstate.frames[index]);
+      if (!_savedstate.frames[index].checksum) {
+         continue;
+      }
+
+      ChecksumSample &sample = _checksums[_checksum_next];
+      if (!ReconstructFrameInternal(frame, sample.state)) {
+         continue;
+      }
+      sample.frame = frame;
+      sample.checksum = _savedstate.frames[index].checksum;
+      _checksum_latest = _checksum_next;
+      _checksum_next = (_checksum_next + 1) % (int)_checksums.size();
+   }
+}
+
+Sync::ChecksumSample *
+Sync::FindChecksum(int frame)
+{
+   for (size_t i = 0; i < _checksums.size(); i++) {
+      if (_checksums[i].frame == frame) {
+         return &_checksums[i];
+      }
+   }
+   return NULL;
+}
+
+void
+Sync::ClearChecksums()
+{
+   for (size_t i = 0; i < _checksums.size(); i++) {
+      FreeScratchBuffer(_checksums[i].state);
+   }
+   _checksums.clear();
+   _checksum_next = 0;
+   _checksum_recorded_frame = -1;
+   _checksum_latest = -1;
+   _checksum_match_frame = -1;
+}
+
+bool
+Sync::GetLatestChecksum(int *frame, int *checksum)
+{
+   if (_checksum_latest < 0) {
+      return false;
+   }
+   *frame = _checksums[_checksum_latest].frame;
+   *checksum = _checksums[_checksum_latest].checksum;
+   return true;
+}
+
+/*
+ * Returns 1 if the peer's checksum for frame differs from ours, 0 if it
+ * matches and -1 if we kept no checksum for that frame.
+ */
+int
+Sync::CompareChecksum(int frame, int checksum, int *local_checksum, int *last_match_frame)
+{
+   ChecksumSample *sample = FindChecksum(frame);
+
+   if (!sample) {
+      return -1;
+   }
+   *local_checksum = sample->checksum;
+   *last_match_frame = _checksum_match_frame;
+   if (sample->checksum != checksum) {
+      return 1;
+   }
+   _checksum_match_frame = MAX(_checksum_match_frame, frame);
+   return 0;
+}
+
+/*
+ * Copies the kept state for frame.  *size is the capacity of buffer on
+ * entry and the state size on return; a NULL buffer only asks the size.
+ */
+bool
+Sync::GetChecksumState(int frame, void *buffer, int *size)
+{
+   ChecksumSample *sample = FindChecksum(frame);
+
+   if (!sample || sample->state.size <= 0) {
+      return false;
+   }
+   if (buffer && *size < sample->state.size) {
+      *size = sample->state.size;
+      return false;
+   }
+   if (buffer) {
+      memcpy(buffer, sample->state.data, (size_t)sample->state.size);
+   }
+   *size = sample->state.size;
+   return true;
+}
+
+/*
+ * A decoded copy of the state saved for frame, which must still be in the
+ * ring.
+ */
+bool
+Sync::GetFrameState(int frame, std::vector<byte> &state)
+{
+   ProcessCompressionResults();
+
+   int index = FindSavedFrameIndex(frame);
+   if (index < 0 || !_savedstate.frames[index].buf) {
+      return false;
+   }
+   int size = _savedstate.frames[index].uncompressed_size;
+   if (!ReconstructFrameInternal(frame, _decompress_buffer) || _decompress_buffer.size < size) {
+      return false;
+   }
+   state.assign(_decompress_buffer.data, _decompress_buffer.data + size);
+   return true;
+}
+
+/*
+ * Loads state as frame and picks the queues up after inputs, every
+ * player's confirmed input for frame - 1.  Frame 0 needs no inputs; the
+ * queues are still empty then.
+ */
+void
+Sync::StartAt(int frame, const byte *state, int size, const byte *inputs)
+{
+   Log("Starting at frame %d (%d bytes of state).\n", frame, size);
+   ProcessCompressionResults();
+   _callbacks.load_game_state((unsigned char *)state, size);
+   UpdateLastState(NULL, 0, -1);
+   InvalidateCachedFrames(0);
+
+   _framecount = frame;
+   if (frame == 0) {
+      return;
+   }
+   _last_confirmed_frame = frame - 1;
+   _checksum_recorded_frame = frame - 1;
+   for (int i = 0; i < _config.num_players; i++) {
+      GameInput last;
+      last.init(frame - 1, (char *)inputs + i * _config.input_size, _config.input_size);
+      _input_queues[i].StartAt(last);
+   }
+   SaveCurrentFrame();
 }
 
 bool
-Sync::AddLocalInput(int queue, GameInput &input)
+Sync::AddLocalInput(int queue, GameInput &input, GameInput *padding)
 {
    int frames_behind = _framecount - _last_confirmed_frame; 
    if (_framecount >= _max_prediction_frames && frames_behind >= _max_prediction_frames) {
@@ -843,9 +1819,10 @@ Sync::AddLocalInput(int queue, GameInput &input)
       SaveCurrentFrame();
    }
 
-   Log("Sending undelayed local frame %d to queue %d.\n", _framecount, queue);
+   LogVerbose("Sending undelayed local frame %d to queue %d.\n", _framecount, queue);
+   LogTrace(TRACE_LOCAL_INPUT, _framecount, queue);
    input.frame = _framecount;
-   _input_queues[queue].AddInput(input);
+   _input_queues[queue].AddInput(input, padding);
 
    return true;
 }
@@ -853,6 +1830,7 @@ Sync::AddLocalInput(int queue, GameInput &input)
 void
 Sync::AddRemoteInput(int queue, GameInput &input)
 {
+   LogTrace(TRACE_REMOTE_INPUT, input.frame, queue);
    _input_queues[queue].AddInput(input);
 }
 
@@ -906,13 +1884,28 @@ Sync::CheckSimulation(int timeout)
    int seek_to;
    if (!CheckSimulationConsistency(&seek_to)) {
       AdjustSimulation(seek_to);
+   } else {
+      PrepareRollbackTarget();
    }
 }
 
+static inline long long
+ElapsedUs(std::chrono::steady_clock::time_point start)
+{
+   return (long long)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
 void
 Sync::IncrementFrame(void)
 {
    _framecount++;
+   if (_rollingback) {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      SaveCurrentFrame();
+      _rollback_save_us += ElapsedUs(start);
+      return;
+   }
    SaveCurrentFrame();
 }
 
@@ -924,11 +1917,15 @@ Sync::AdjustSimulation(int seek_to)
 
    Log("Catching up\n");
    _rollingback = true;
+   _rollback_save_us = 0;
 
    /*
     * Flush our input queue and load the last frame.
     */
-   if (!LoadFrame(seek_to) || _framecount != seek_to) {
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+   bool loaded = LoadFrame(seek_to);
+   long long load_us = ElapsedUs(start);
+   if (!loaded || _framecount != seek_to) {
       Log("Failed to load frame %d for rollback (have %d). Clearing prediction errors.\n",
           seek_to, _framecount);
       ResetPrediction(seek_to);
@@ -941,24 +1938,168 @@ Sync::AdjustSimulation(int seek_to)
     * the master).
     */
    ResetPrediction(_framecount);
-   for (int i = 0; i < count; i++) {
-      _callbacks.advance_frame(0);
+   if (_callbacks.advance_frames) {
+      ReplayFrames(count);
+   } else {
+      for (int i = 0; i < count; i++) {
+         _callbacks.advance_frame(0);
+      }
    }
    ASSERT(_framecount == framecount);
 
    _rollingback = false;
 
-   Log("---\n");   
+   long long total_us = ElapsedUs(start);
+   long long resim_us = MAX(total_us - load_us - _rollback_save_us, 0LL);
+   RecordRollback(count,
+                  (int)MIN(load_us, (long long)INT_MAX),
+                  (int)MIN(resim_us, (long long)INT_MAX),
+                  (int)MIN(_rollback_save_us, (long long)INT_MAX));
+   LogTrace(TRACE_ROLLBACK, seek_to, count,
+            (int)MIN(load_us, (long long)INT_MAX),
+            (int)MIN(resim_us, (long long)INT_MAX));
+
+   LogVerbose("---\n");   
+}
+
+void
+Sync::ResetRollbackStats()
+{
+   _rollback_samples.clear();
+   _rollback_sample_next = 0;
+   _rollback_count = 0;
+   _rollback_frames = 0;
+   _rollback_depth_max = 0;
+   _rollback_save_us = 0;
+   memset(_rollback_depth_histogram, 0, sizeof(_rollback_depth_histogram));
+   memset(_rollback_time_histogram, 0, sizeof(_rollback_time_histogram));
+   memset(_rollback_us_total, 0, sizeof(_rollback_us_total));
+   memset(_rollback_us_max, 0, sizeof(_rollback_us_max));
+}
+
+void
+Sync::RecordRollback(int depth, int load_us, int resim_us, int save_us)
+{
+   RollbackSample sample = { depth, load_us, resim_us, save_us };
+   int phase_us[4] = { 0, load_us, resim_us, save_us };
+   phase_us[0] = (int)MIN((long long)load_us + resim_us + save_us, (long long)INT_MAX);
+
+   _rollback_count++;
+   _rollback_frames += depth;
+   _rollback_depth_max = MAX(_rollback_depth_max, depth);
+   _rollback_depth_histogram[MIN(MAX(depth, 0), GGPO_ROLLBACK_DEPTH_BUCKETS - 1)]++;
+
+   int bucket = 0;
+   while (bucket < GGPO_ROLLBACK_TIME_BUCKETS - 1 && (phase_us[0] >> (bucket + 1)) > 0) {
+      bucket++;
+   }
+   _rollback_time_histogram[bucket]++;
+
+   for (int i = 0; i < 4; i++) {
+      _rollback_us_total[i] += (unsigned long long)phase_us[i];
+      _rollback_us_max[i] = MAX(_rollback_us_max[i], phase_us[i]);
+   }
+
+   if ((int)_rollback_samples.size() < GGPO_ROLLBACK_SAMPLE_WINDOW) {
+      _rollback_samples.push_back(sample);
+   } else {
+      _rollback_samples[_rollback_sample_next] = sample;
+   }
+   _rollback_sample_next = (_rollback_sample_next + 1) % GGPO_ROLLBACK_SAMPLE_WINDOW;
+}
+
+/*
+ * Batched form of the advance_frame loop above.  Inputs for every replayed
+ * frame are gathered up front (no new input can arrive mid-rollback), then
+ * handed to advance_frames in runs.  A saved state is only worth keeping if
+ * a later rollback could land on it, which needs a predicted input at its
+ * frame; states whose frame is still covered by confirmed input from every
+ * queue are skipped and folded into the next run.
+ */
+void
+Sync::ReplayFrames(int count)
+{
+   int first = _framecount;
+   int size = _config.num_players * _config.input_size;
+
+   EnsureScratchBufferSize(_replay_inputs, count * size);
+   _replay_disconnect_flags.resize(count);
+   for (int i = 0; i < count; i++) {
+      _framecount = first + i;
+      _replay_disconnect_flags[i] = SynchronizeInputs(_replay_inputs.data + i * size, size);
+   }
+   _framecount = first;
+
+   int confirmed = GetConfirmedInputFrame();
+   int done = 0;
+   while (done < count) {
+      int run = 1;
+      while (done + run < count && first + done + run <= confirmed) {
+         run++;
+      }
+      int flags = (done + run == count) ? GGPO_ADVANCE_FRAMES_LAST : 0;
+      if (!_callbacks.advance_frames(_replay_inputs.data + done * size, size,
+                                     &_replay_disconnect_flags[done], run, flags)) {
+         Log("advance_frames failed replaying frames %d-%d.\n", first + done, first + done + run - 1);
+      }
+      for (int i = 1; i < run; i++) {
+         _framecount++;
+         SkipCurrentFrame();
+      }
+      IncrementFrame();
+      done += run;
+   }
+}
+
+/*
+ * Newest frame for which every player's input is known for certain.
+ */
+int
+Sync::GetConfirmedInputFrame()
+{
+   int confirmed = INT_MAX;
+   for (int i = 0; i < _config.num_players; i++) {
+      if (_local_connect_status[i].disconnected) {
+         continue;
+      }
+      confirmed = MIN(confirmed, _input_queues[i].GetLastConfirmedFrame());
+   }
+   return confirmed == INT_MAX ? GameInput::NullFrame : confirmed;
+}
+
+/*
+ * Stands in for SaveCurrentFrame on a replayed frame nothing can roll back
+ * to.  The ring slot still advances, but is emptied so the stale state from
+ * before the rollback cannot be found; the next save becomes a keyframe.
+ */
+void
+Sync::SkipCurrentFrame()
+{
+   ProcessCompressionResults();
+   InvalidateCachedFrames(_framecount);
+
+   SavedFrame *state = &_savedstate.frames[_savedstate.head];
+   FreeSavedFrameBuffer(*state);
+   state->frame = -1;
+   state->checksum = 0;
+   _replay_saves_skipped++;
+   _savedstate.head = (_savedstate.head + 1) % (int)_savedstate.frames.size();
 }
 
+/*
+ * While the worker runs, _last_state is its own and only ever follows the
+ * queued saves: any other state just makes the next save a keyframe.
+ */
 void
 Sync::UpdateLastState(const byte *state, int size, int frame)
 {
-   if (!state || size <= 0) {
+   if (!state || size <= 0 || _compress_thread.joinable()) {
       _last_state_valid = false;
       _last_state_size = 0;
       _last_state_frame = -1;
-      ResetScratchBuffer(_last_state);
+      if (!_compress_thread.joinable()) {
+         ResetScratchBuffer(_last_state);
+      }
       return;
    }
 
@@ -972,13 +2113,11 @@ Sync::UpdateLastState(const byte *state, int size, int frame)
 bool
 Sync::DecodeSavedFrame(const SavedFrame &state, std::vector<byte> &buffer)
 {
-   if (!state.buf || state.uncompressed_size <= 0) {
+   if (!state.buf || state.payload_size <= 0) {
       return false;
    }
 
-   if (buffer.size() < (size_t)state.uncompressed_size) {
-      buffer.resize(state.uncompressed_size);
-   }
+   buffer.resize(state.payload_size);
 
    return DecodeSavedFrameRaw(state, &buffer[0], (int)buffer.size());
 }
@@ -995,7 +2134,7 @@ Sync::ReconstructFrame(int frame, std::vector<byte> &buffer)
       return false;
    }
 
-   state = _savedstate.frames + state_index;
+   state = &_savedstate.frames[state_index];
 
    if (!state->delta) {
       return DecodeSavedFrame(*state, buffer);
@@ -1009,7 +2148,7 @@ Sync::ReconstructFrame(int frame, std::vector<byte> &buffer)
          return false;
       }
 
-      base_state = _savedstate.frames + base_index;
+      base_state = &_savedstate.frames[base_index];
       if (!base_state->delta) {
          if (!DecodeSavedFrame(*base_state, buffer)) {
             return false;
@@ -1032,7 +2171,7 @@ Sync::ReconstructFrame(int frame, std::vector<byte> &buffer)
          return false;
       }
 
-      delta_state = _savedstate.frames + delta_index;
+      delta_state = &_savedstate.frames[delta_index];
       if (!delta_state->delta) {
          if (!DecodeSavedFrame(*delta_state, buffer)) {
             return false;
@@ -1040,17 +2179,9 @@ Sync::ReconstructFrame(int frame, std::vector<byte> &buffer)
          continue;
       }
 
-      EnsureScratchBufferSize(_delta_buffer, delta_state->uncompressed_size);
-
-      if (!DecodeSavedFrameInternal(*delta_state, _delta_buffer)) {
-         return false;
-      }
-
-      if ((int)buffer.size() < delta_state->uncompressed_size) {
+      if (buffer.empty() || !ApplySavedDelta(*delta_state, &buffer[0], (int)buffer.size())) {
          return false;
       }
-
-      XorBufferInPlace(&buffer[0], _delta_buffer.data, (size_t)delta_state->uncompressed_size);
    }
 
    return true;
@@ -1061,7 +2192,7 @@ Sync::LoadFrame(int frame)
 {
    // find the frame in question
    if (frame == _framecount) {
-      Log("Skipping NOP.\n");
+      LogVerbose("Skipping NOP.\n");
       return true;
    }
 
@@ -1070,39 +2201,43 @@ Sync::LoadFrame(int frame)
    if (_savedstate.head < 0) {
       return false;
    }
-   SavedFrame *state = _savedstate.frames + _savedstate.head;
+   SavedFrame *state = &_savedstate.frames[_savedstate.head];
 
-   Log("=== Loading frame info %d (size: %d  checksum: %08x).\n",
+   LogVerbose("=== Loading frame info %d (size: %d  checksum: %08x).\n",
        state->frame, state->uncompressed_size, state->checksum);
+   LogTrace(TRACE_LOAD_FRAME, state->frame, state->uncompressed_size, state->checksum);
 
    if (!state->buf || !state->cbuf) {
       Log("Cannot load frame %d: missing state buffer.\n", frame);
       return false;
    }
-   if (state->delta) {
+   CachedFrame *cached = FindCachedFrame(frame);
+   if (cached && cached->data.size == state->uncompressed_size) {
+      _frame_cache_hits++;
+      _callbacks.load_game_state(cached->data.data, cached->data.size);
+      UpdateLastState(cached->data.data, cached->data.size, state->frame);
+   } else if (state->delta) {
+      _frame_cache_misses++;
       if (!ReconstructFrameInternal(frame, _decompress_buffer)) {
          Log("Failed to reconstruct frame %d.\n", frame);
          return false;
       }
       _callbacks.load_game_state(_decompress_buffer.data, state->uncompressed_size);
       UpdateLastState(_decompress_buffer.data, state->uncompressed_size, state->frame);
+      StoreCachedFrame(frame, _decompress_buffer);
    } else if (state->compressed) {
+      _frame_cache_misses++;
       if (state->uncompressed_size <= 0) {
          Log("Invalid compressed size for frame %d.\n", frame);
          return false;
       }
-      EnsureScratchBufferSize(_decompress_buffer, state->uncompressed_size);
-      byte *decompressed = _decompress_buffer.data;
-      int decoded = LZ4_decompress_safe((const char *)state->buf,
-                                       (char *)decompressed,
-                                       state->cbuf,
-                                       state->uncompressed_size);
-      if (decoded != state->uncompressed_size) {
+      if (!DecodeSavedFrameInternal(*state, _decompress_buffer)) {
          Log("Failed to decompress frame %d.\n", frame);
          return false;
       }
-      _callbacks.load_game_state(decompressed, state->uncompressed_size);
-      UpdateLastState(decompressed, state->uncompressed_size, state->frame);
+      _callbacks.load_game_state(_decompress_buffer.data, state->uncompressed_size);
+      UpdateLastState(_decompress_buffer.data, state->uncompressed_size, state->frame);
+      StoreCachedFrame(frame, _decompress_buffer);
    } else {
       _callbacks.load_game_state(state->buf, state->cbuf);
       UpdateLastState(state->buf, state->cbuf, state->frame);
@@ -1111,7 +2246,7 @@ Sync::LoadFrame(int frame)
    // Reset framecount and the head of the state ring-buffer to point in
    // advance of the current frame (as if we had just finished executing it).
    _framecount = state->frame;
-   _savedstate.head = (_savedstate.head + 1) % ARRAY_SIZE(_savedstate.frames);
+   _savedstate.head = (_savedstate.head + 1) % (int)_savedstate.frames.size();
    return true;
 }
 
@@ -1123,8 +2258,9 @@ Sync::SaveCurrentFrame()
     * Write everything into the head, then advance the head pointer.
     */
    ProcessCompressionResults();
+   InvalidateCachedFrames(_framecount);
 
-   SavedFrame *state = _savedstate.frames + _savedstate.head;
+   SavedFrame *state = &_savedstate.frames[_savedstate.head];
    if (state->buf) {
       FreeSavedFrameBuffer(*state);
    }
@@ -1134,20 +2270,54 @@ Sync::SaveCurrentFrame()
    state->buf = reuse_buffer;
    state->cbuf = reuse_capacity;
    state->buf_capacity = reuse_capacity;
-   _callbacks.save_game_state(&state->buf, &state->cbuf, &state->checksum, state->frame);
+   _state_hint_set = false;
+   _saving = true;
+   bool saved = _callbacks.save_game_state(&state->buf, &state->cbuf, &state->checksum, state->frame);
+   _saving = false;
    if (reuse_buffer && state->buf != reuse_buffer) {
       RecycleStateBuffer(reuse_buffer, reuse_capacity);
    }
+   if (!saved || !state->buf || state->cbuf <= 0) {
+      /*
+       * Drop the frame entirely.  The next save becomes a keyframe since
+       * there is no valid predecessor to delta against.
+       */
+      Log("save_game_state failed for frame %d.\n", state->frame);
+      if (state->buf == reuse_buffer) {
+         RecycleStateBuffer(reuse_buffer, reuse_capacity);
+      } else if (state->buf && _callbacks.free_buffer) {
+         _callbacks.free_buffer(state->buf);
+      }
+      state->buf = NULL;
+      state->cbuf = 0;
+      state->uncompressed_size = 0;
+      state->payload_size = 0;
+      state->buf_capacity = 0;
+      state->compressed = false;
+      state->segmented = false;
+      state->delta = false;
+      state->compress_pending = false;
+      UpdateLastState(NULL, 0, -1);
+      _savedstate.head = (_savedstate.head + 1) % (int)_savedstate.frames.size();
+      return;
+   }
    if (state->buf == reuse_buffer) {
       if (state->cbuf > reuse_capacity) {
          Log("save_game_state used %d bytes but only %d were available.\n", state->cbuf, reuse_capacity);
       }
       state->buf_capacity = reuse_capacity;
    } else {
-      state->buf_capacity = state->cbuf;
+      /*
+       * Freshly allocated by the callback.  If it declared its allocation
+       * size, remember that so the buffer can be offered back at full size.
+       */
+      state->buf_capacity = MAX(state->cbuf, _state_buffer_capacity);
    }
    state->uncompressed_size = state->cbuf;
+   state->payload_size = state->cbuf;
    state->compressed = false;
+   state->segmented = false;
+   state->codec = GGPO_STATE_CODEC_RAW;
    state->delta = false;
    state->compress_pending = false;
    if (state->uncompressed_size > _state_buffer_size_hint) {
@@ -1157,55 +2327,115 @@ Sync::SaveCurrentFrame()
    bool can_delta = _last_state_valid
       && _last_state_size == state->uncompressed_size
       && _last_state_frame == (state->frame - 1);
-   bool keyframe = (state->frame % GGPO_STATE_KEYFRAME_INTERVAL) == 0;
+   bool keyframe = (state->frame % _keyframe_interval) == 0;
    bool use_delta = can_delta && !keyframe;
 
-   byte *delta_buf = NULL;
-   if (use_delta) {
-      delta_buf = (byte *)malloc(state->uncompressed_size);
-      ASSERT(delta_buf);
-      XorBuffers(delta_buf, state->buf, _last_state.data, (size_t)state->uncompressed_size);
+   GGPOStateCodec codec = ApplyMemoryCeiling(SelectCodec());
+   _last_codec = codec;
+   SegmentPlan segments;
+   if (codec != GGPO_STATE_CODEC_RAW) {
+      segments = GetSegmentPlan(state->payload_size);
    }
 
-   UpdateLastState(state->buf, state->uncompressed_size, state->frame);
-
-   if (use_delta) {
-      state->delta = true;
-      RecycleStateBuffer(state->buf, state->buf_capacity);
-      state->buf = delta_buf;
-      state->cbuf = state->uncompressed_size;
-      state->buf_capacity = state->uncompressed_size;
-      state->compressed = false;
+   /*
+    * With the worker running, the frame is handed over as serialized: the
+    * worker checksums it, diffs it against the previous one and compresses
+    * it, while the next frame is serialized into another buffer.
+    */
+   bool queued = false;
+   if (_compress_thread.joinable()) {
+      queued = QueueCompression(state, codec, segments, use_delta);
+      if (queued) {
+         _last_state_size = state->uncompressed_size;
+         _last_state_frame = state->frame;
+         _last_state_valid = true;
+      } else {
+         use_delta = false;
+         UpdateLastState(NULL, 0, -1);
+      }
    }
 
-   const byte *compress_input = state->buf;
-   if (!QueueCompression(state, compress_input, state->uncompressed_size)) {
-      CompressSync(*state, compress_input, state->uncompressed_size);
-   }
+   if (!queued) {
+      if (_callbacks.checksum_game_state) {
+         state->checksum = _callbacks.checksum_game_state(state->buf, state->uncompressed_size, state->frame);
+      }
 
-   if (state->delta) {
-      int ratio = 0;
-      if (state->uncompressed_size > 0) {
-         ratio = (int)(((unsigned long long)state->cbuf * 100ULL) /
-                       (unsigned long long)state->uncompressed_size);
-         if (ratio > 100) {
-            ratio = 100;
+      byte *delta_record = NULL;
+      int delta_record_size = 0;
+      if (use_delta) {
+         const std::vector<GGPOStateRange> *hint = NULL;
+         if (_state_hint_set && StateHintFits(_state_hint, state->uncompressed_size)) {
+            hint = &_state_hint;
+            _hinted_frames++;
          }
+         /*
+          * Also brings _last_state up to date by copying only the dirty blocks.
+          */
+         delta_record = BuildDeltaRecord(state->buf, state->uncompressed_size, hint,
+                                         _delta_runs, &delta_record_size);
+         use_delta = delta_record != NULL;
       }
-      _delta_stats.delta_ratio_last = ratio;
-      if (ratio > _delta_stats.delta_ratio_max) {
-         _delta_stats.delta_ratio_max = ratio;
+
+      if (use_delta) {
+         _last_state_frame = state->frame;
+         state->delta = true;
+         RecycleStateBuffer(state->buf, state->buf_capacity);
+         state->buf = delta_record;
+         state->cbuf = delta_record_size;
+         state->payload_size = delta_record_size;
+         state->buf_capacity = delta_record_size;
+         state->compressed = false;
+         state->segmented = false;
+         /* Delta records follow no region layout; they stay one stream */
+         segments.reset();
+      } else {
+         UpdateLastState(state->buf, state->uncompressed_size, state->frame);
       }
-      _delta_stats.delta_bytes_sum += (unsigned long long)state->cbuf;
-      _delta_stats.delta_raw_bytes_sum += (unsigned long long)state->uncompressed_size;
-      _delta_stats.delta_frames++;
-   } else {
-      _delta_stats.keyframes++;
+
+      if (codec == GGPO_STATE_CODEC_RAW) {
+         RecordCodecResult(codec, state->payload_size, state->payload_size, 0);
+      } else {
+         /*
+          * Never run HC inline on the emulation thread.
+          */
+         if (codec == GGPO_STATE_CODEC_LZ4HC) {
+            codec = GGPO_STATE_CODEC_LZ4;
+            _last_codec = codec;
+         }
+         CompressSync(*state, state->buf, state->payload_size, codec, segments);
+      }
+      RecordDeltaStats(*state);
    }
 
-   Log("=== Saved frame info %d (size: %d  compressed: %d  checksum: %08x).\n",
+   LogVerbose("=== Saved frame info %d (size: %d  compressed: %d  checksum: %08x).\n",
        state->frame, state->uncompressed_size, state->cbuf, state->checksum);
-   _savedstate.head = (_savedstate.head + 1) % ARRAY_SIZE(_savedstate.frames);
+   LogTrace(TRACE_SAVE_FRAME, state->frame, state->uncompressed_size, state->cbuf, state->checksum);
+   _savedstate.head = (_savedstate.head + 1) % (int)_savedstate.frames.size();
+}
+
+void
+Sync::RecordDeltaStats(const SavedFrame &state)
+{
+   if (!state.delta) {
+      _delta_stats.keyframes++;
+      return;
+   }
+
+   int ratio = 0;
+   if (state.uncompressed_size > 0) {
+      ratio = (int)(((unsigned long long)state.cbuf * 100ULL) /
+                    (unsigned long long)state.uncompressed_size);
+      if (ratio > 100) {
+         ratio = 100;
+      }
+   }
+   _delta_stats.delta_ratio_last = ratio;
+   if (ratio > _delta_stats.delta_ratio_max) {
+      _delta_stats.delta_ratio_max = ratio;
+   }
+   _delta_stats.delta_bytes_sum += (unsigned long long)state.cbuf;
+   _delta_stats.delta_raw_bytes_sum += (unsigned long long)state.uncompressed_size;
+   _delta_stats.delta_frames++;
 }
 
 Sync::SavedFrame&
@@ -1213,7 +2443,7 @@ Sync::GetLastSavedFrame()
 {
    int i = _savedstate.head - 1;
    if (i < 0) {
-      i = ARRAY_SIZE(_savedstate.frames) - 1;
+      i = (int)_savedstate.frames.size() - 1;
    }
    return _savedstate.frames[i];
 }
@@ -1235,8 +2465,11 @@ Sync::FreeSavedFrameBuffer(SavedFrame &state)
    state.buf = NULL;
    state.cbuf = 0;
    state.uncompressed_size = 0;
+   state.payload_size = 0;
    state.buf_capacity = 0;
    state.compressed = false;
+   state.segmented = false;
+   state.codec = GGPO_STATE_CODEC_RAW;
    state.delta = false;
    state.compress_pending = false;
 }
@@ -1245,7 +2478,7 @@ Sync::FreeSavedFrameBuffer(SavedFrame &state)
 int
 Sync::FindSavedFrameIndex(int frame)
 {
-   int i, count = ARRAY_SIZE(_savedstate.frames);
+   int i, count = (int)_savedstate.frames.size();
    for (i = 0; i < count; i++) {
       if (_savedstate.frames[i].frame == frame) {
          break;
@@ -1265,8 +2498,12 @@ Sync::CreateQueues(Config &config)
    _input_queues.clear();
    _input_queues.resize(_config.num_players);
 
+   GGPOPredictModel model = (GGPOPredictModel)Platform::GetConfigInt("ggpo.input.predictor");
+   int button_bytes = Platform::GetConfigInt("ggpo.input.predict_bytes");
+
    for (int i = 0; i < _config.num_players; i++) {
       _input_queues[i].Init(i, _config.input_size);
+      _input_queues[i].SetPredictor(model, button_bytes);
    }
    return true;
 }
@@ -1277,7 +2514,10 @@ Sync::CheckSimulationConsistency(int *seekTo)
    int first_incorrect = GameInput::NullFrame;
    for (int i = 0; i < _config.num_players; i++) {
       int incorrect = _input_queues[i].GetFirstIncorrectFrame();
-      Log("considering incorrect frame %d reported by queue %d.\n", incorrect, i);
+      LogVerbose("considering incorrect frame %d reported by queue %d.\n", incorrect, i);
+      if (incorrect != GameInput::NullFrame) {
+         LogTrace(TRACE_PREDICTION_ERROR, _framecount, i, incorrect);
+      }
 
       if (incorrect != GameInput::NullFrame && (first_incorrect == GameInput::NullFrame || incorrect < first_incorrect)) {
          first_incorrect = incorrect;
@@ -1285,9 +2525,21 @@ Sync::CheckSimulationConsistency(int *seekTo)
    }
 
    if (first_incorrect == GameInput::NullFrame) {
-      Log("prediction ok.  proceeding.\n");
+      LogVerbose("prediction ok.  proceeding.\n");
       return true;
    }
+
+   /*
+    * Track how far back rollbacks land (in 1/16 frames) so the idle poll
+    * can have the likely target decoded before it is needed.
+    */
+   int depth = MAX(_framecount - first_incorrect, 0) * 16;
+   if (_rollback_depth_avg == 0) {
+      _rollback_depth_avg = depth;
+   } else {
+      _rollback_depth_avg += (depth - _rollback_depth_avg) / 4;
+   }
+
    *seekTo = first_incorrect;
    return false;
 }
@@ -1319,6 +2571,71 @@ Sync::GetEvent(Event &e)
    return false;
 }
 
+/*
+ * Nearest-rank percentile of an already sorted window.
+ */
+static int
+Percentile(const std::vector<int> &sorted, int pct)
+{
+   if (sorted.empty()) {
+      return 0;
+   }
+   size_t rank = (sorted.size() * pct + 99) / 100;
+   return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+void
+Sync::GetRollbackStats(GGPORollbackStats *stats)
+{
+   if (!stats) {
+      return;
+   }
+
+   memset(stats, 0, sizeof(*stats));
+   stats->rollbacks = _rollback_count;
+   stats->frames_resimulated = (int)MIN(_rollback_frames, (long long)INT_MAX);
+   stats->depth_max = _rollback_depth_max;
+   memcpy(stats->depth_histogram, _rollback_depth_histogram, sizeof(stats->depth_histogram));
+   memcpy(stats->time_histogram, _rollback_time_histogram, sizeof(stats->time_histogram));
+   for (size_t i = 0; i < _input_queues.size(); i++) {
+      stats->predicted_frames += _input_queues[i].GetPredictedFrames();
+      stats->mispredicted_frames += _input_queues[i].GetMispredictedFrames();
+   }
+   if (_rollback_samples.empty()) {
+      return;
+   }
+
+   /* Sorting a copy on query keeps AdjustSimulation at O(1). */
+   std::vector<int> values(_rollback_samples.size());
+   for (size_t i = 0; i < _rollback_samples.size(); i++) {
+      values[i] = _rollback_samples[i].depth;
+   }
+   std::sort(values.begin(), values.end());
+   stats->depth_p50 = Percentile(values, 50);
+   stats->depth_p95 = Percentile(values, 95);
+   stats->depth_p99 = Percentile(values, 99);
+
+   GGPORollbackTimes *times[4] = { &stats->total, &stats->load, &stats->resim, &stats->save };
+   for (int phase = 0; phase < 4; phase++) {
+      for (size_t i = 0; i < _rollback_samples.size(); i++) {
+         const RollbackSample &sample = _rollback_samples[i];
+         switch (phase) {
+         case 0: values[i] = (int)MIN((long long)sample.load_us + sample.resim_us + sample.save_us, (long long)INT_MAX); break;
+         case 1: values[i] = sample.load_us; break;
+         case 2: values[i] = sample.resim_us; break;
+         default: values[i] = sample.save_us; break;
+         }
+      }
+      std::sort(values.begin(), values.end());
+      times[phase]->avg_us = (int)MIN(_rollback_us_total[phase] / (unsigned long long)_rollback_count,
+                                      (unsigned long long)INT_MAX);
+      times[phase]->p50_us = Percentile(values, 50);
+      times[phase]->p95_us = Percentile(values, 95);
+      times[phase]->p99_us = Percentile(values, 99);
+      times[phase]->max_us = _rollback_us_max[phase];
+   }
+}
+
 void
 Sync::GetStateStats(GGPOStateStats *stats)
 {
@@ -1343,19 +2660,41 @@ Sync::GetStateStats(GGPOStateStats *stats)
    }
    stats->delta_ratio_avg = avg_ratio;
 
-   {
-      std::unique_lock<std::mutex> lock(_compress_mutex);
-      stats->compress_job_queue_len = (int)_compress_jobs.size();
-      stats->compress_result_queue_len = (int)_compress_results.size();
-      stats->compress_job_queue_max = _compress_jobs_max;
-      stats->compress_result_queue_max = _compress_results_max;
-   }
+   stats->compress_job_queue_len = _compress_jobs.size();
+   stats->compress_result_queue_len = _compress_results.size();
+   stats->compress_job_queue_max = _compress_jobs_max;
+   stats->compress_result_queue_max = _compress_results_max;
+   stats->compress_wait_count = _compress_wait_count;
+   stats->compress_wait_us_total = (int)MIN(_compress_wait_us_total, (unsigned long long)INT_MAX);
+   stats->compress_wait_us_max = _compress_wait_us_max;
 
    int pending = 0;
-   for (int i = 0; i < ARRAY_SIZE(_savedstate.frames); ++i) {
+   for (size_t i = 0; i < _savedstate.frames.size(); ++i) {
       if (_savedstate.frames[i].compress_pending) {
          pending++;
       }
    }
    stats->compress_pending_count = pending;
+   stats->frame_cache_hits = _frame_cache_hits;
+   stats->frame_cache_misses = _frame_cache_misses;
+   stats->frame_cache_prepared = _frame_cache_prepared;
+
+   stats->codec = _last_codec;
+   stats->saved_state_kb = (int)MIN(SavedStateBytes() / 1024ULL, (unsigned long long)INT_MAX);
+   stats->ceiling_compressed_frames = _ceiling_compressed_frames;
+   stats->replay_saves_skipped = _replay_saves_skipped;
+   stats->hinted_frames = _hinted_frames;
+   stats->segmented_keyframes = _segmented_keyframes;
+   /* Don't start the pool just to report on it */
+   stats->compress_threads = _state_regions.empty() ? 0 : TaskPool::Shared()->GetWorkerCount();
+   for (int i = 0; i < GGPO_STATE_CODEC_COUNT; i++) {
+      const CodecStats &codec = _codec_stats[i];
+      stats->codec_frames[i] = codec.frames;
+      if (codec.input_bytes > 0) {
+         stats->codec_ratio_avg[i] = (int)MIN((codec.output_bytes * 100ULL) / codec.input_bytes, 100ULL);
+      }
+      if (codec.frames > 0) {
+         stats->codec_us_avg[i] = (int)MIN(codec.us_total / (unsigned long long)codec.frames, (unsigned long long)INT_MAX);
+      }
+   }
 }
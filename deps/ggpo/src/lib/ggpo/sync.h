@@ -13,16 +13,41 @@
 #include "game_input.h"
 #include "input_queue.h"
 #include "ring_buffer.h"
+#include "spsc_queue.h"
+#include "state_codec.h"
+#include "state_segments.h"
 #include "network/udp_msg.h"
 
+#include <atomic>
 #include <condition_variable>
-#include <deque>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <vector>
 
+/*
+ * Defaults for Sync::Config.  Both are runtime-configurable up to the
+ * corresponding *_MAX value; the saved-state ring is sized from whatever the
+ * session was configured with.
+ */
 #define MAX_PREDICTION_FRAMES    8
+#define MAX_PREDICTION_FRAMES_MAX 32
 #define GGPO_STATE_KEYFRAME_INTERVAL 4
+#define GGPO_STATE_KEYFRAME_INTERVAL_MAX 16
+#define GGPO_STATE_DELTA_BLOCK_SIZE 256
+#define GGPO_STATE_FRAME_CACHE_SIZE 2
+#define GGPO_STATE_LZ4HC_LEVEL 4
+#define GGPO_STATE_ZSTD_LEVEL (-1)
+#define GGPO_STATE_COMPRESS_BUDGET_US 2000
+#define GGPO_STATE_ADAPTIVE_PROBE_FRAMES 60
+
+/*
+ * Confirmed frames whose checksum is exchanged with the peers, and how many
+ * of them (with their states) are kept to compare against and to dump.
+ * ggpo.sync.checksum_frames overrides the interval.
+ */
+#define GGPO_CHECKSUM_FRAMES 60
+#define GGPO_CHECKSUM_HISTORY 4
 
 class SyncTestBackend;
 
@@ -31,10 +56,14 @@ public:
    struct Config {
       GGPOSessionCallbacks    callbacks;
       int                     num_prediction_frames;
+      int                     keyframe_interval;
       int                     num_players;
       int                     input_size;
       int                     lz4_accel;
       int                     async_compress;
+      int                     codec_mode;        /* GGPOStateCodecMode */
+      int                     zstd_level;
+      int                     raw_memory_ceiling_kb;
    };
    struct Event {
       enum {
@@ -55,7 +84,7 @@ public:
 
    void SetLastConfirmedFrame(int frame);
    void SetFrameDelay(int queue, int delay);
-   bool AddLocalInput(int queue, GameInput &input);
+   bool AddLocalInput(int queue, GameInput &input, GameInput *padding = NULL);
    void AddRemoteInput(int queue, GameInput &input);
    int GetConfirmedInputs(void *values, int size, int frame);
    int SynchronizeInputs(void *values, int size);
@@ -64,27 +93,64 @@ public:
    void AdjustSimulation(int seek_to);
    void IncrementFrame(void);
 
+   bool NegotiateConfig(int num_prediction_frames, int keyframe_interval);
+   int GetPredictionFrames() { return _max_prediction_frames; }
+   int GetKeyframeInterval() { return _keyframe_interval; }
+
    int GetFrameCount() { return _framecount; }
    bool InRollback() { return _rollingback; }
 
    bool GetEvent(Event &e);
+   bool GetLatestChecksum(int *frame, int *checksum);
+   int CompareChecksum(int frame, int checksum, int *local_checksum, int *last_match_frame);
+   bool GetChecksumState(int frame, void *buffer, int *size);
+
+   /*
+    * Rejoins.  The survivor hands over a saved frame and the input queued
+    * from it on; the rejoiner starts from that frame as if it had just run
+    * up to it.
+    */
+   bool GetFrameState(int frame, std::vector<byte> &state);
+   void StartAt(int frame, const byte *state, int size, const byte *inputs);
+   bool GetQueuedInput(int queue, int frame, GameInput *input) { return _input_queues[queue].GetConfirmedInput(frame, input); }
+   int GetLastQueuedFrame(int queue) { return _input_queues[queue].GetLastConfirmedFrame(); }
    void GetStateStats(GGPOStateStats *stats);
+   void GetRollbackStats(GGPORollbackStats *stats);
+   void SetStateBufferCapacity(int capacity);
+   /* Only from inside save_game_state; false otherwise. */
+   bool HintStateChanges(const GGPOStateRange *ranges, int count);
+   void SetStateRegions(const GGPOStateRegion *regions, int count);
 
 protected:
    friend SyncTestBackend;
 
+   /*
+    * uncompressed_size is the size of the full game state.  payload_size is
+    * the decoded size of buf: the state itself for keyframes, or the sparse
+    * delta record (see BuildDeltaRecord) for delta frames.  A segmented
+    * frame is compressed as SegmentedState, codec being the session's.
+    *
+    * While compress_pending, buf is still the state as serialized: the
+    * worker reads it to build the delta and the checksum, and the frame
+    * loads from it directly.  hint is the save's change hint for that job.
+    */
    struct SavedFrame {
       byte    *buf;
       int      cbuf;
       int      uncompressed_size;
+      int      payload_size;
       int      buf_capacity;
       int      frame;
       int      checksum;
       bool     compressed;
       bool     delta;
       bool     compress_pending;
-      SavedFrame() : buf(NULL), cbuf(0), uncompressed_size(0), buf_capacity(0), frame(-1), checksum(0),
-         compressed(false), delta(false), compress_pending(false) { }
+      bool     segmented;
+      GGPOStateCodec codec;
+      std::vector<GGPOStateRange> hint;
+      SavedFrame() : buf(NULL), cbuf(0), uncompressed_size(0), payload_size(0), buf_capacity(0), frame(-1),
+         checksum(0), compressed(false), delta(false), compress_pending(false), segmented(false),
+         codec(GGPO_STATE_CODEC_RAW) { }
    };
    struct ScratchBuffer {
       byte    *data;
@@ -92,8 +158,34 @@ protected:
       int      capacity;
       ScratchBuffer() : data(NULL), size(0), capacity(0) { }
    };
+   /* A confirmed frame's checksum with a decoded copy of its state. */
+   struct ChecksumSample {
+      ScratchBuffer state;
+      int      frame;
+      int      checksum;
+      ChecksumSample() : frame(-1), checksum(0) { }
+   };
+   struct DeltaRun {
+      int      offset;
+      int      length;
+   };
+   /*
+    * A fully decoded copy of a saved frame, so loading it is a single copy
+    * and reconstructing a later delta frame can start from here instead of
+    * the keyframe.  Valid until the frame is saved again.
+    */
+   struct CachedFrame {
+      ScratchBuffer data;
+      int           frame;
+      unsigned int  last_used;
+      CachedFrame() : frame(-1), last_used(0) { }
+   };
+   /*
+    * frames is sized once in Init and never resized afterwards; compression
+    * jobs hold pointers into it.
+    */
    struct SavedState {
-      SavedFrame frames[MAX_PREDICTION_FRAMES + 2];
+      std::vector<SavedFrame> frames;
       int head;
    };
 
@@ -125,15 +217,31 @@ protected:
 
    bool CreateQueues(Config &config);
    bool CheckSimulationConsistency(int *seekTo);
+   void ReplayFrames(int count);
+   int GetConfirmedInputFrame();
+   void SkipCurrentFrame();
    void ResetPrediction(int frameNumber);
 
 private:
+   /* Shared with the jobs using it, so SetStateRegions can replace it. */
+   typedef std::shared_ptr<const std::vector<StateSegment> > SegmentPlan;
+
+   /*
+    * input is the frame as serialized.  The worker diffs it against
+    * _last_state when delta is set, brings _last_state up to it either way
+    * and then compresses whichever it keeps.
+    */
    struct CompressJob {
       SavedFrame  *state;
       const byte  *input;
       int          input_size;
       int          frame;
-      int          lz4_accel;
+      GGPOStateCodec codec;
+      int          level;
+      SegmentPlan  segments;       /* NULL to compress as one stream */
+      const std::vector<GGPOStateRange> *hint;   /* NULL without one */
+      bool         delta;
+      bool         checksum;
    };
 
    struct CompressResult {
@@ -141,18 +249,55 @@ private:
       const byte  *input;
       int          input_size;
       int          frame;
+      GGPOStateCodec codec;
+      bool         segmented;
       char        *compressed_buf;
       int          compressed_size;
+      int          compress_us;
+      byte        *delta_record;   /* NULL if the frame stays a keyframe */
+      int          delta_record_size;
+      int          checksum;
+      bool         has_checksum;
+   };
+
+   /* One rollback, as recorded by AdjustSimulation. */
+   struct RollbackSample {
+      int depth;
+      int load_us;
+      int resim_us;
+      int save_us;
+   };
+
+   struct CodecStats {
+      unsigned long long input_bytes;
+      unsigned long long output_bytes;
+      unsigned long long us_total;
+      int frames;
+      int us_avg;       /* moving average, drives the adaptive mode */
+      int ratio_avg;    /* moving average, percent */
+      CodecStats() : input_bytes(0), output_bytes(0), us_total(0), frames(0), us_avg(0), ratio_avg(0) { }
    };
 
    void StartCompressionThread();
    void StopCompressionThread();
    void CompressionThreadMain();
-   bool QueueCompression(SavedFrame *state, const byte *input, int input_size);
+   bool QueueCompression(SavedFrame *state, GGPOStateCodec codec, const SegmentPlan &segments,
+                         bool delta);
    void ProcessCompressionResults();
    void ApplyCompressionResult(const CompressResult &result);
    void WaitForCompression(SavedFrame &state);
-   void CompressSync(SavedFrame &state, const byte *input, int input_size);
+   void CompressSync(SavedFrame &state, const byte *input, int input_size, GGPOStateCodec codec,
+                     const SegmentPlan &segments);
+   static bool CompressWith(GGPOStateCodec codec, int level, const std::vector<StateSegment> *segments,
+                            const byte *input, int input_size,
+                            char **output, int *output_size, int *compress_us);
+   SegmentPlan GetSegmentPlan(int size);
+   int CodecLevel(GGPOStateCodec codec);
+   GGPOStateCodec SelectCodec();
+   GGPOStateCodec ApplyMemoryCeiling(GGPOStateCodec codec);
+   unsigned long long SavedStateBytes();
+   void RecordCodecResult(GGPOStateCodec codec, int input_size, int output_size, int compress_us);
+   void UpdateAdaptiveCodec();
    byte *AcquireStateBuffer(int *capacity);
    void RecycleStateBuffer(byte *buffer, int capacity);
    void ClearStateBufferPool();
@@ -162,23 +307,57 @@ private:
    bool DecodeSavedFrameInternal(const SavedFrame &state, ScratchBuffer &buffer);
    bool DecodeSavedFrameRaw(const SavedFrame &state, byte *buffer, int buffer_size);
    bool ReconstructFrameInternal(int frame, ScratchBuffer &buffer);
+   byte *BuildDeltaRecord(const byte *state, int size, const std::vector<GGPOStateRange> *hint,
+                          std::vector<DeltaRun> &runs, int *record_size);
+   void FindDeltaRuns(const byte *state, int begin, int end, int size,
+                      std::vector<DeltaRun> &runs, int *data_size);
+   void RecordDeltaStats(const SavedFrame &state);
+   static bool StateHintFits(const std::vector<GGPOStateRange> &hint, int size);
+   bool ApplyDeltaRecord(const byte *record, int record_size, byte *buffer, int buffer_size);
+   bool ApplySavedDelta(const SavedFrame &state, byte *buffer, int buffer_size);
+   CachedFrame *FindCachedFrame(int frame);
+   void StoreCachedFrame(int frame, ScratchBuffer &buffer);
+   void InvalidateCachedFrames(int first_frame);
+   void ClearFrameCache();
+   bool CompressorIdle();
+   void PrepareRollbackTarget();
+   void RecordRollback(int depth, int load_us, int resim_us, int save_us);
+   void ResetRollbackStats();
+   void RecordChecksums(int confirmed_frame);
+   ChecksumSample *FindChecksum(int frame);
+   void ClearChecksums();
 
+   /*
+    * The emulation thread pushes jobs and pops results; the worker does the
+    * opposite.  _compress_mutex and the condition variables are only
+    * touched to park or wake a side that found its queue empty.  While the
+    * worker runs it also owns _last_state's contents; the emulation thread
+    * keeps _last_state_size, _frame and _valid as of the last queued job.
+    */
    bool _async_compress;
    std::thread _compress_thread;
    std::mutex _compress_mutex;
    std::condition_variable _compress_cv;
    std::condition_variable _compress_done_cv;
-   bool _compress_shutdown;
-   std::deque<CompressJob> _compress_jobs;
-   std::deque<CompressResult> _compress_results;
+   std::atomic<bool> _compress_shutdown;
+   std::atomic<bool> _compress_worker_parked;
+   std::atomic<bool> _compress_waiter_parked;
+   SpscQueue<CompressJob> _compress_jobs;
+   SpscQueue<CompressResult> _compress_results;
+   std::vector<DeltaRun> _compress_delta_runs;
+   int _compress_in_flight;
    int _compress_jobs_max;
    int _compress_results_max;
+   int _compress_wait_count;
+   unsigned long long _compress_wait_us_total;
+   int _compress_wait_us_max;
    struct StateBuffer {
       byte *buffer;
       int capacity;
    };
    std::vector<StateBuffer> _state_buffer_pool;
    int _state_buffer_size_hint;
+   int _state_buffer_capacity;
 
 protected:
    GGPOSessionCallbacks _callbacks;
@@ -189,17 +368,61 @@ protected:
    int            _last_confirmed_frame;
    int            _framecount;
    int            _max_prediction_frames;
+   int            _keyframe_interval;
 
    int            _lz4_accel;
+   int            _zstd_level;
+   int            _codec_mode;
+   int            _compress_budget_us;
+   unsigned long long _raw_memory_ceiling;
+   int            _ceiling_compressed_frames;
+   GGPOStateCodec _adaptive_codec;
+   int            _adaptive_frames;
+   GGPOStateCodec _last_codec;
+   CodecStats     _codec_stats[GGPO_STATE_CODEC_COUNT];
 
    std::vector<InputQueue> _input_queues;
    ScratchBuffer           _decompress_buffer;
    ScratchBuffer           _delta_buffer;
+   ScratchBuffer           _replay_inputs;
+   std::vector<int>        _replay_disconnect_flags;
+   int                     _replay_saves_skipped;
+   std::vector<DeltaRun>   _delta_runs;
+   std::vector<GGPOStateRange> _state_hint;       /* from the save in progress */
+   std::vector<GGPOStateRegion> _state_regions;
+   SegmentPlan             _segment_plan;          /* for states of _segment_plan_size bytes */
+   int                     _segment_plan_size;
+   int                     _segmented_keyframes;
+   bool                    _state_hint_set;
+   bool                    _saving;
+   int                     _hinted_frames;
+   std::vector<CachedFrame> _frame_cache;
+   unsigned int            _frame_cache_clock;
+   int                     _frame_cache_hits;
+   int                     _frame_cache_misses;
+   int                     _frame_cache_prepared;
+   int                     _rollback_depth_avg;
+   std::vector<RollbackSample> _rollback_samples;  /* ring, GGPO_ROLLBACK_SAMPLE_WINDOW */
+   int                     _rollback_sample_next;
+   int                     _rollback_count;
+   long long               _rollback_frames;
+   int                     _rollback_depth_max;
+   int                     _rollback_depth_histogram[GGPO_ROLLBACK_DEPTH_BUCKETS];
+   int                     _rollback_time_histogram[GGPO_ROLLBACK_TIME_BUCKETS];
+   unsigned long long      _rollback_us_total[4];  /* total, load, resim, save */
+   int                     _rollback_us_max[4];
+   long long               _rollback_save_us;      /* saves inside the current rollback */
    ScratchBuffer           _last_state;
    int                     _last_state_size;
    int                     _last_state_frame;
    bool                    _last_state_valid;
    DeltaStats              _delta_stats;
+   std::vector<ChecksumSample> _checksums;        /* ring, GGPO_CHECKSUM_HISTORY */
+   int                     _checksum_next;
+   int                     _checksum_frames;
+   int                     _checksum_recorded_frame;
+   int                     _checksum_latest;       /* index of the newest sample, -1 if none */
+   int                     _checksum_match_frame;
 
    RingBuffer<Event, 32> _event_queue;
    UdpMsg::connect_status *_local_connect_status;
@@ -0,0 +1,119 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#include "types.h"
+#include "task_pool.h"
+#include "thread_hook.h"
+
+#include <algorithm>
+
+TaskPool *
+TaskPool::Shared()
+{
+   /*
+    * Never deleted: sessions can be closed from static destructors, and the
+    * workers only ever sleep between batches.
+    */
+   static TaskPool *pool = NULL;
+   static std::once_flag once;
+   std::call_once(once, [] {
+      int workers = Platform::GetConfigInt("ggpo.sync.compress_threads");
+      if (workers == 0) {
+         int cores = (int)std::thread::hardware_concurrency();
+         workers = MIN(MAX(cores - 1, 0), GGPO_TASK_POOL_MAX_WORKERS);
+      }
+      pool = new TaskPool(MAX(workers, 0));
+   });
+   return pool;
+}
+
+TaskPool::TaskPool(int workers)
+{
+   for (int i = 0; i < workers; i++) {
+      _workers.push_back(std::thread(&TaskPool::WorkerMain, this));
+   }
+   Log("task pool started with %d workers.\n", workers);
+}
+
+void
+TaskPool::Run(Task task, void *context, int count)
+{
+   if (count <= 0) {
+      return;
+   }
+   if (count == 1 || _workers.empty()) {
+      for (int i = 0; i < count; i++) {
+         task(context, i);
+      }
+      return;
+   }
+
+   Batch batch;
+   batch.task = task;
+   batch.context = context;
+   batch.count = count;
+   batch.next = 0;
+   batch.users = 0;
+   {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _batches.push_back(&batch);
+   }
+   _work_cv.notify_all();
+
+   RunItems(&batch);
+
+   /*
+    * Every piece has been claimed once RunItems returns; wait for the
+    * workers still finishing theirs before the batch goes out of scope.
+    */
+   std::unique_lock<std::mutex> lock(_mutex);
+   Retire(&batch);
+   _done_cv.wait(lock, [&batch] { return batch.users == 0; });
+}
+
+void
+TaskPool::RunItems(Batch *batch)
+{
+   for (;;) {
+      int index = batch->next.fetch_add(1);
+      if (index >= batch->count) {
+         return;
+      }
+      batch->task(batch->context, index);
+   }
+}
+
+/* With _mutex held.  No worker picks the batch up after this. */
+void
+TaskPool::Retire(Batch *batch)
+{
+   std::deque<Batch *>::iterator i = std::find(_batches.begin(), _batches.end(), batch);
+   if (i != _batches.end()) {
+      _batches.erase(i);
+   }
+}
+
+void
+TaskPool::WorkerMain()
+{
+   ThreadHookScope hook("ggpo_pool");
+   std::unique_lock<std::mutex> lock(_mutex);
+   for (;;) {
+      _work_cv.wait(lock, [this] { return !_batches.empty(); });
+
+      Batch *batch = _batches.front();
+      batch->users++;
+      lock.unlock();
+      RunItems(batch);
+      lock.lock();
+
+      Retire(batch);
+      if (--batch->users == 0) {
+         _done_cv.notify_all();
+      }
+   }
+}
@@ -0,0 +1,69 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#ifndef _TASK_POOL_H
+#define _TASK_POOL_H
+
+#include "types.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Default cap on the workers of the shared pool. */
+#define GGPO_TASK_POOL_MAX_WORKERS 4
+
+/*
+ * A few worker threads shared by every session in the process, for work
+ * that splits into independent pieces (segmented state compression).
+ *
+ * Run hands out the pieces of one batch to the workers and to the calling
+ * thread, and returns once all of them are done.  Any thread may call it,
+ * several at once; a caller always works on its own batch, so a batch
+ * finishes even while the workers are busy with someone else's.
+ *
+ * ggpo.sync.compress_threads sets the number of workers: unset or 0 picks
+ * one less than the number of cores, up to GGPO_TASK_POOL_MAX_WORKERS, and
+ * a negative value runs every batch on the caller alone.
+ */
+class TaskPool
+{
+public:
+   typedef void (*Task)(void *context, int index);
+
+   /* Created on first use and kept for the life of the process. */
+   static TaskPool *Shared();
+
+   void Run(Task task, void *context, int count);
+   int GetWorkerCount() const { return (int)_workers.size(); }
+
+protected:
+   struct Batch {
+      Task              task;
+      void              *context;
+      int               count;
+      std::atomic<int>  next;
+      int               users;      /* workers inside RunItems, under _mutex */
+   };
+
+   TaskPool(int workers);
+
+   void WorkerMain();
+   static void RunItems(Batch *batch);
+   void Retire(Batch *batch);
+
+   std::vector<std::thread>   _workers;
+   std::mutex                 _mutex;
+   std::condition_variable    _work_cv;
+   std::condition_variable    _done_cv;
+   std::deque<Batch *>        _batches;
+};
+
+#endif
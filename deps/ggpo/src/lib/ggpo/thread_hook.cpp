@@ -0,0 +1,36 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#include "types.h"
+#include "thread_hook.h"
+
+#include <atomic>
+
+static std::atomic<GGPOThreadHook> thread_hook(NULL);
+
+ThreadHookScope::ThreadHookScope(const char *role) :
+   _role(role),
+   _hook(thread_hook.load())
+{
+   if (_hook) {
+      _hook(_role, true);
+   }
+}
+
+ThreadHookScope::~ThreadHookScope()
+{
+   /* The same hook that heard of the start, even if it was changed since */
+   if (_hook) {
+      _hook(_role, false);
+   }
+}
+
+void
+ThreadHookScope::Set(GGPOThreadHook hook)
+{
+   thread_hook.store(hook);
+}
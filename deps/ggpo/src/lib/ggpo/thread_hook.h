@@ -0,0 +1,29 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#ifndef _THREAD_HOOK_H
+#define _THREAD_HOOK_H
+
+#include "ggponet.h"
+
+/*
+ * Placed at the top of each thread GGPO starts, so the application's
+ * GGPOThreadHook hears of the thread for as long as it runs.
+ */
+class ThreadHookScope {
+public:
+   explicit ThreadHookScope(const char *role);
+   ~ThreadHookScope();
+
+   static void Set(GGPOThreadHook hook);
+
+private:
+   const char     *_role;
+   GGPOThreadHook _hook;
+};
+
+#endif
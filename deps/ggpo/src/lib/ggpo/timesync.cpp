@@ -27,8 +27,13 @@ TimeSync::advance_frame(GameInput &input, int advantage, int radvantage)
    _remote[input.frame % ARRAY_SIZE(_remote)] = radvantage;
 }
 
-int
-TimeSync::recommend_frame_wait_duration(bool require_idle_input)
+/*
+ * Half the gap between the averaged remote and local frame advantages, in
+ * frames.  Positive means we are the one ahead and should slow down; both
+ * sides splitting the difference meet in the middle.
+ */
+float
+TimeSync::advantage_error()
 {
    // Average our local and remote frame advantages
    int i, sum = 0;
@@ -44,22 +49,31 @@ TimeSync::recommend_frame_wait_duration(bool require_idle_input)
    }
    radvantage = sum / (float)ARRAY_SIZE(_remote);
 
+   return (radvantage - advantage) / 2;
+}
+
+int
+TimeSync::recommend_frame_wait_duration(bool require_idle_input)
+{
+   int i;
+   float error = advantage_error();
+
    static int count = 0;
    count++;
 
    // See if someone should take action.  The person furthest ahead
    // needs to slow down so the other user can catch up.
    // Only do this if both clients agree on who's ahead!!
-   if (advantage >= radvantage) {
+   if (error <= 0) {
       return 0;
    }
 
    // Both clients agree that we're the one ahead.  Split
    // the difference between the two to figure out how long to
    // sleep for.
-   int sleep_frames = (int)(((radvantage - advantage) / 2) + 0.5);
+   int sleep_frames = (int)(error + 0.5);
 
-   Log("iteration %d:  sleep frames is %d\n", count, sleep_frames);
+   LogVerbose("iteration %d:  sleep frames is %d\n", count, sleep_frames);
 
    // Some things just aren't worth correcting for.  Make sure
    // the difference is relevant before proceeding.
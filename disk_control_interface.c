@@ -29,6 +29,7 @@
 #include "msg_hash.h"
 
 #include "disk_control_interface.h"
+#include "tasks/tasks_internal.h"
 
 #ifdef HAVE_GFX_WIDGETS
 #include "gfx/gfx_widgets.h"
@@ -42,6 +43,37 @@
 /* Configuration */
 /*****************/
 
+/**
+ * disk_control_preload_next:
+ *
+ * Reads the start of the image after the current
+ * one in the background, so that swapping to it
+ * next doesn't wait on the disk
+ **/
+static void disk_control_preload_next(
+      disk_control_interface_t *disk_control)
+{
+   unsigned num_images;
+   unsigned next_index;
+   char next_image_path[PATH_MAX_LENGTH];
+
+   if (   !disk_control->cb.get_num_images
+       || !disk_control->cb.get_image_index
+       || !disk_control->cb.get_image_path)
+      return;
+
+   num_images = disk_control->cb.get_num_images();
+   next_index = disk_control->cb.get_image_index() + 1;
+
+   if (next_index >= num_images || num_images == UINT_MAX)
+      return;
+
+   next_image_path[0] = '\0';
+   if (disk_control->cb.get_image_path(
+         next_index, next_image_path, sizeof(next_image_path)))
+      task_push_disc_preload(next_image_path);
+}
+
 /**
  * disk_control_reset_callback:
  *
@@ -458,6 +490,9 @@ bool disk_control_set_index(
                MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_ERROR);
    }
 
+   if (!err)
+      disk_control_preload_next(disk_control);
+
    /* If operation was successful, update disk
     * index record (if enabled) */
    if (!err && disk_control->record_enabled)
@@ -769,6 +804,8 @@ bool disk_control_verify_initial_index(
    if (!disk_control)
       return false;
 
+   disk_control_preload_next(disk_control);
+
    /* If index record is disabled, can return immediately */
    if (!disk_control->record_enabled && enabled)
       return false;
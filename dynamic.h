@@ -33,12 +33,19 @@ enum retro_core_flags
    RETRO_CORE_FLAG_GAME_LOADED               = (1 << 2),
    RETRO_CORE_FLAG_INPUT_POLLED              = (1 << 3),
    RETRO_CORE_FLAG_HAS_SET_SUBSYSTEMS        = (1 << 4),
-   RETRO_CORE_FLAG_HAS_SET_INPUT_DESCRIPTORS = (1 << 5)
+   RETRO_CORE_FLAG_HAS_SET_INPUT_DESCRIPTORS = (1 << 5),
+   /* Netplay held this iteration's frame; retro_run was not called */
+   RETRO_CORE_FLAG_FRAME_HELD                = (1 << 6)
 };
 
 struct retro_core_t
 {
    uint64_t serialization_quirks_v;
+   /* From SET_SERIALIZE_DIRTY_INTERFACE; get_dirty is NULL without one */
+   struct retro_serialize_dirty_interface serialize_dirty;
+   /* Bumped by everything that moves the core's dirty baseline:
+    * each serialize, unserialize and reset */
+   uint32_t serialize_generation;
    void (*retro_init)(void);
    void (*retro_deinit)(void);
    unsigned (*retro_api_version)(void);
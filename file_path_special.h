@@ -48,6 +48,8 @@ RETRO_BEGIN_DECLS
 #define FILE_PATH_STATE_EXTENSION ".state"
 #define FILE_PATH_LPL_EXTENSION ".lpl"
 #define FILE_PATH_LPL_EXTENSION_NO_DOT "lpl"
+#define FILE_PATH_LPL_CACHE_EXTENSION ".bin"
+#define FILE_PATH_LPL_JOURNAL_EXTENSION ".jnl"
 #define FILE_PATH_PNG_EXTENSION ".png"
 #define FILE_PATH_MP3_EXTENSION ".mp3"
 #define FILE_PATH_FLAC_EXTENSION ".flac"
@@ -85,6 +87,7 @@ RETRO_BEGIN_DECLS
 #define FILE_PATH_CHEATS_ZIP "cheats.zip"
 #define FILE_PATH_ASSETS_ZIP "assets.zip"
 #define FILE_PATH_AUTOCONFIG_ZIP "autoconfig.zip"
+#define FILE_PATH_SHADER_CACHE_DIR "shader_cache"
 #define FILE_PATH_CONTENT_FAVORITES "content_favorites.lpl"
 #define FILE_PATH_CONTENT_HISTORY "content_history.lpl"
 #define FILE_PATH_CONTENT_IMAGE_HISTORY "content_image_history.lpl"
@@ -112,6 +115,8 @@ RETRO_BEGIN_DECLS
 #endif
 #define FILE_PATH_CORE_INFO_CACHE "core_info.cache"
 #define FILE_PATH_CORE_INFO_CACHE_REFRESH "core_info.refresh"
+#define FILE_PATH_EXPLORE_CACHE "explore.cache"
+#define FILE_PATH_CONTENT_SCAN_CACHE "content_scan.cache"
 
 #ifdef HAVE_LAKKA
  #ifdef HAVE_LAKKA_SERVER
@@ -0,0 +1,231 @@
+/**
+ *  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ *  more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with RetroArch. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <features/features_cpu.h>
+#include <streams/file_stream.h>
+
+#include "frame_timeline.h"
+
+/* Weight of the newest frame in the moving averages */
+#define FRAME_TIMELINE_AVERAGE_WEIGHT (1.0f / 32.0f)
+/* Frames the maximum frame interval is taken over */
+#define FRAME_TIMELINE_MAX_WINDOW     60
+
+struct frame_timeline_event
+{
+   retro_time_t start;
+   uint32_t usec;
+   uint32_t frame;
+   uint8_t stage;
+};
+
+typedef struct frame_timeline
+{
+   struct frame_timeline_event *events;
+   size_t head;
+   size_t count;
+   retro_time_t last_frame_time;
+   uint32_t frame;
+   uint32_t frame_usec[FRAME_TIMELINE_STAGE_COUNT];
+   uint32_t window_frames;
+   float window_max_ms;
+   /* Moving average of the squared deviation from interval_ms */
+   float interval_var;
+   struct frame_timeline_stats stats;
+} frame_timeline_t;
+
+static frame_timeline_t frame_timeline_st;
+
+static const char *frame_timeline_stage_names[FRAME_TIMELINE_STAGE_COUNT] = {
+   "Input Poll",
+   "Core Run",
+   "Video Frame",
+   "Driver Frame"
+};
+
+void frame_timeline_set_enabled(bool enable)
+{
+   frame_timeline_t *timeline = &frame_timeline_st;
+
+   if (enable == (timeline->events != NULL))
+      return;
+
+   free(timeline->events);
+   memset(timeline, 0, sizeof(*timeline));
+
+   if (enable)
+      timeline->events = (struct frame_timeline_event*)
+         malloc(FRAME_TIMELINE_EVENTS * sizeof(*timeline->events));
+}
+
+bool frame_timeline_is_enabled(void)
+{
+   return frame_timeline_st.events != NULL;
+}
+
+retro_time_t frame_timeline_begin(void)
+{
+   if (!frame_timeline_st.events)
+      return 0;
+   return cpu_features_get_time_usec();
+}
+
+void frame_timeline_end(enum frame_timeline_stage stage,
+      retro_time_t start)
+{
+   frame_timeline_t *timeline = &frame_timeline_st;
+   struct frame_timeline_event *event;
+   uint32_t usec;
+
+   /* Recording may have started in the middle of the stage */
+   if (!timeline->events || !start)
+      return;
+
+   usec                          = (uint32_t)
+      (cpu_features_get_time_usec() - start);
+   timeline->frame_usec[stage]  += usec;
+
+   event                         = &timeline->events[timeline->head];
+   event->start                  = start;
+   event->usec                   = usec;
+   event->frame                  = timeline->frame;
+   event->stage                  = (uint8_t)stage;
+
+   timeline->head                = (timeline->head + 1)
+      % FRAME_TIMELINE_EVENTS;
+   if (timeline->count < FRAME_TIMELINE_EVENTS)
+      timeline->count++;
+}
+
+void frame_timeline_next_frame(void)
+{
+   unsigned i;
+   retro_time_t now;
+   frame_timeline_t *timeline = &frame_timeline_st;
+   float weight               = FRAME_TIMELINE_AVERAGE_WEIGHT;
+
+   if (!timeline->events)
+      return;
+
+   /* Start the averages from the first frame rather than 0 */
+   if (!timeline->frame)
+      weight = 1.0f;
+
+   for (i = 0; i < FRAME_TIMELINE_STAGE_COUNT; i++)
+   {
+      timeline->stats.stage_ms[i]  += weight *
+         (timeline->frame_usec[i] / 1000.0f - timeline->stats.stage_ms[i]);
+      timeline->frame_usec[i]       = 0;
+   }
+
+   now = cpu_features_get_time_usec();
+   if (timeline->last_frame_time)
+   {
+      float interval_ms = (now - timeline->last_frame_time) / 1000.0f;
+
+      if (timeline->frame == 1)
+         timeline->stats.interval_ms  = interval_ms;
+      else
+      {
+         float deviation              = interval_ms
+            - timeline->stats.interval_ms;
+         timeline->stats.interval_ms += FRAME_TIMELINE_AVERAGE_WEIGHT
+            * deviation;
+         timeline->interval_var      += FRAME_TIMELINE_AVERAGE_WEIGHT
+            * (deviation * deviation - timeline->interval_var);
+         timeline->stats.interval_sd_ms = sqrtf(timeline->interval_var);
+      }
+
+      if (interval_ms > timeline->window_max_ms)
+         timeline->window_max_ms = interval_ms;
+      if (++timeline->window_frames >= FRAME_TIMELINE_MAX_WINDOW)
+      {
+         timeline->stats.max_interval_ms = timeline->window_max_ms;
+         timeline->window_max_ms         = 0.0f;
+         timeline->window_frames         = 0;
+      }
+   }
+   timeline->last_frame_time = now;
+   timeline->frame++;
+}
+
+void frame_timeline_get_stats(struct frame_timeline_stats *stats)
+{
+   *stats = frame_timeline_st.stats;
+}
+
+void frame_timeline_add_display_latency(float ms)
+{
+   struct frame_timeline_stats *stats = &frame_timeline_st.stats;
+
+   if (!frame_timeline_st.events)
+      return;
+
+   if (stats->display_latency_ms <= 0.0f)
+      stats->display_latency_ms  = ms;
+   else
+      stats->display_latency_ms += FRAME_TIMELINE_AVERAGE_WEIGHT
+         * (ms - stats->display_latency_ms);
+}
+
+bool frame_timeline_write_trace(const char *path)
+{
+   size_t i, first;
+   retro_time_t base;
+   frame_timeline_t *timeline = &frame_timeline_st;
+   RFILE *file;
+
+   if (!timeline->events || !timeline->count)
+      return false;
+
+   if (!(file = filestream_open(path, RETRO_VFS_FILE_ACCESS_WRITE,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      return false;
+
+   first = (timeline->head + FRAME_TIMELINE_EVENTS - timeline->count)
+      % FRAME_TIMELINE_EVENTS;
+   base  = timeline->events[first].start;
+
+   filestream_printf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+   /* Name the tracks; doubles as the separator for the events */
+   for (i = 0; i < FRAME_TIMELINE_STAGE_COUNT; i++)
+      filestream_printf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\","
+            "\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+            i ? ",\n" : "", (unsigned)i + 1, frame_timeline_stage_names[i]);
+
+   for (i = 0; i < timeline->count; i++)
+   {
+      const struct frame_timeline_event *event =
+         &timeline->events[(first + i) % FRAME_TIMELINE_EVENTS];
+
+      filestream_printf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,"
+            "\"tid\":%u,\"ts\":%u,\"dur\":%u,\"args\":{\"frame\":%u}}",
+            frame_timeline_stage_names[event->stage],
+            (unsigned)event->stage + 1,
+            (unsigned)(event->start - base),
+            (unsigned)event->usec,
+            (unsigned)event->frame);
+   }
+
+   filestream_printf(file, "\n]}\n");
+   return filestream_close(file) == 0;
+}
@@ -0,0 +1,95 @@
+/**
+ *  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ *  more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with RetroArch. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef __RARCH_FRAME_TIMELINE_H
+#define __RARCH_FRAME_TIMELINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <libretro.h>
+
+/* Timed stages of the main thread, recorded once per occurrence;
+ * a stage that runs several times in a frame (run-ahead) adds up */
+enum frame_timeline_stage
+{
+   FRAME_TIMELINE_INPUT_POLL = 0,
+   FRAME_TIMELINE_CORE_RUN,
+   /* video_driver_frame(), from the core's frame to the driver
+    * returning */
+   FRAME_TIMELINE_VIDEO_FRAME,
+   /* The driver's frame(): shader passes, then the present,
+    * including any wait for vsync */
+   FRAME_TIMELINE_DRIVER_FRAME,
+   FRAME_TIMELINE_STAGE_COUNT
+};
+
+/* Events kept for the trace, a few seconds' worth */
+#define FRAME_TIMELINE_EVENTS 8192
+
+RETRO_BEGIN_DECLS
+
+struct frame_timeline_stats
+{
+   /* Moving averages, in ms per frame */
+   float stage_ms[FRAME_TIMELINE_STAGE_COUNT];
+   float interval_ms;
+   /* Standard deviation of the frame interval: how evenly frames
+    * are paced around the average */
+   float interval_sd_ms;
+   float max_interval_ms;
+   /* From the present to the frame reaching the display, as far as
+    * the video driver can tell; 0 when it can't */
+   float display_latency_ms;
+};
+
+/* Starts or stops recording. Stopping drops what was recorded. */
+void frame_timeline_set_enabled(bool enable);
+
+bool frame_timeline_is_enabled(void);
+
+/* The start time to hand to frame_timeline_end(), or 0 when not
+ * recording */
+retro_time_t frame_timeline_begin(void);
+
+void frame_timeline_end(enum frame_timeline_stage stage,
+      retro_time_t start);
+
+/* Closes the frame; call once the frame has been presented */
+void frame_timeline_next_frame(void);
+
+void frame_timeline_get_stats(struct frame_timeline_stats *stats);
+
+/* For video drivers that learn when a presented frame was shown */
+void frame_timeline_add_display_latency(float ms);
+
+/**
+ * frame_timeline_write_trace:
+ * @path                 : file to write
+ *
+ * Writes the recorded events as a Chrome trace (the JSON format
+ * chrome://tracing and Perfetto load), one track per stage.
+ *
+ * Returns: false if nothing was recorded or the file could not be
+ * written.
+ **/
+bool frame_timeline_write_trace(const char *path);
+
+RETRO_END_DECLS
+
+#endif
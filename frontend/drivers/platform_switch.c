@@ -28,6 +28,7 @@
 #ifdef HAVE_LIBNX
 #include <switch.h>
 #include "../../switch_performance_profiles.h"
+#include "../../clock_governor.h"
 #include "../../configuration.h"
 #include <unistd.h>
 #include <malloc.h>
@@ -84,6 +85,7 @@ char *SWITCH_CPU_PROFILES[] = {
     "Powersaving Mode 1",
     "Powersaving Mode 2",
     "Powersaving Mode 3",
+    "Automatic",
     NULL
 };
 char *SWITCH_CPU_SPEEDS[] = {
@@ -94,6 +96,7 @@ char *SWITCH_CPU_SPEEDS[] = {
     "918 MHz",
     "816 MHz",
     "714 MHz",
+    "714-1785 MHz",
     NULL
 };
 unsigned SWITCH_CPU_SPEEDS_VALUES[] = {
@@ -104,6 +107,7 @@ unsigned SWITCH_CPU_SPEEDS_VALUES[] = {
     918000000,
     816000000,
     714000000,
+    0, /* Automatic */
     0
 };
 
@@ -115,27 +119,37 @@ static AppletHookCookie applet_hook_cookie;
 extern bool nxlink_connected;
 #endif
 
+static void libnx_set_cpu_clock(unsigned rate)
+{
+   if (hosversionBefore(8, 0, 0))
+      pcvSetClockRate(PcvModule_CpuBus, rate);
+   else
+   {
+      ClkrstSession session = {0};
+      clkrstOpenSession(&session, PcvModuleId_CpuBus, 3);
+      clkrstSetClockRate(&session, rate);
+      clkrstCloseSession(&session);
+   }
+}
+
+static void libnx_apply_governed_clock(unsigned level)
+{
+   libnx_set_cpu_clock(SWITCH_CPU_SPEEDS_VALUES[level]);
+}
+
 void libnx_apply_overclock(void)
 {
-   const size_t profiles_count = sizeof(SWITCH_CPU_PROFILES)
-      / sizeof(SWITCH_CPU_PROFILES[1]) - 1;
    settings_t *settings        = config_get_ptr();
    unsigned libnx_overclock    = settings->uints.libnx_overclock;
 
-   if (libnx_overclock >= 0 && libnx_overclock <= profiles_count)
+   if (libnx_overclock == SWITCH_AUTO_CPU_PROFILE)
+      clock_governor_init(SWITCH_CPU_SPEEDS_VALUES,
+            SWITCH_AUTO_CPU_PROFILE, SWITCH_DEFAULT_CPU_PROFILE,
+            libnx_apply_governed_clock);
+   else if (libnx_overclock < SWITCH_AUTO_CPU_PROFILE)
    {
-      if (hosversionBefore(8, 0, 0))
-      {
-         pcvSetClockRate(PcvModule_CpuBus, SWITCH_CPU_SPEEDS_VALUES[
-               libnx_overclock]);
-      }
-      else
-      {
-         ClkrstSession session = {0};
-         clkrstOpenSession(&session, PcvModuleId_CpuBus, 3);
-         clkrstSetClockRate(&session, SWITCH_CPU_SPEEDS_VALUES[libnx_overclock]);
-         clkrstCloseSession(&session);
-      }
+      clock_governor_deinit();
+      libnx_set_cpu_clock(SWITCH_CPU_SPEEDS_VALUES[libnx_overclock]);
    }
 }
 
@@ -157,17 +171,8 @@ static void on_applet_hook(AppletHookType hook, void *param)
 
          if (!platform_switch_has_focus)
          {
-            if (hosversionBefore(8, 0, 0))
-            {
-               pcvSetClockRate(PcvModule_CpuBus, 1020000000);
-            }
-            else
-            {
-               ClkrstSession session = {0};
-               clkrstOpenSession(&session, PcvModuleId_CpuBus, 3);
-               clkrstSetClockRate(&session, 1020000000);
-               clkrstCloseSession(&session);
-            }
+            clock_governor_deinit();
+            libnx_set_cpu_clock(1020000000);
          }
          else
             libnx_apply_overclock();
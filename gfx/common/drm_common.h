@@ -60,6 +60,31 @@ bool drm_get_connector(int fd, unsigned monitor_index);
 
 float drm_get_refresh_rate(void *data);
 
+/**
+ * gfx_ctx_drm_scanout_frame:
+ * @data                 : KMS context data
+ * @frame                : software frame, or NULL to show the last one again
+ * @rgb32                : XRGB8888 if true, RGB565 otherwise
+ * @x, @y                : top left of the rectangle on screen
+ * @out_width, @out_height : size the display controller scales it to
+ * @smooth               : bilinear instead of nearest scaling, where
+ *                         the plane lets us choose
+ *
+ * Shows @frame on an overlay plane of the KMS context's CRTC through
+ * an atomic commit, with the primary plane black underneath, instead
+ * of composing it with the GPU.
+ *
+ * Returns false if the plane can't show it, in which case the caller
+ * composes the frame itself.
+ **/
+bool gfx_ctx_drm_scanout_frame(void *data, const void *frame,
+      unsigned width, unsigned height, unsigned pitch, bool rgb32,
+      int x, int y, unsigned out_width, unsigned out_height, bool smooth);
+
+/* Takes the frame back off the overlay plane; the next swap shows
+ * the GPU's again. */
+void gfx_ctx_drm_scanout_stop(void *data);
+
 static INLINE bool drm_wait_flip(int timeout)
 {
    g_drm_fds.revents = 0;
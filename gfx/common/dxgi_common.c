@@ -25,6 +25,7 @@
 #include "dxgi_common.h"
 #include "../../configuration.h"
 #include "../../verbosity.h"
+#include "../../frame_timeline.h"
 #include "../../ui/ui_companion_driver.h"
 #include "../../retroarch.h"
 #include "../frontend/frontend_driver.h"
@@ -758,3 +759,55 @@ void dxgi_set_hdr_metadata(
    }
 }
 #endif
+
+void dxgi_present_stats_update(dxgi_present_stats_t *stats,
+      DXGISwapChain handle)
+{
+   LARGE_INTEGER now;
+   DXGI_FRAME_STATISTICS frame_stats;
+   UINT present_count = 0;
+   unsigned slot;
+
+   if (!handle || !frame_timeline_is_enabled())
+      return;
+
+   if (!stats->qpc_frequency)
+   {
+      LARGE_INTEGER frequency;
+      QueryPerformanceFrequency(&frequency);
+      stats->qpc_frequency = frequency.QuadPart;
+   }
+   QueryPerformanceCounter(&now);
+
+#ifdef __cplusplus
+   if (FAILED(handle->GetLastPresentCount(&present_count)))
+#else
+   if (FAILED(handle->lpVtbl->GetLastPresentCount(handle, &present_count)))
+#endif
+      return;
+
+   slot                       = present_count % DXGI_PRESENT_HISTORY;
+   stats->present_qpc[slot]   = now.QuadPart;
+   stats->present_count[slot] = present_count;
+
+   /* Fails until the first frame is shown, and while the window is
+    * occluded or not flip model */
+#ifdef __cplusplus
+   if (FAILED(handle->GetFrameStatistics(&frame_stats)))
+#else
+   if (FAILED(handle->lpVtbl->GetFrameStatistics(handle, &frame_stats)))
+#endif
+      return;
+
+   slot = frame_stats.PresentCount % DXGI_PRESENT_HISTORY;
+   if (     stats->present_count[slot] != frame_stats.PresentCount
+         || !stats->present_qpc[slot]
+         || frame_stats.SyncQPCTime.QuadPart < stats->present_qpc[slot]
+         || !stats->qpc_frequency)
+      return;
+
+   frame_timeline_add_display_latency((float)(
+            (double)(frame_stats.SyncQPCTime.QuadPart
+               - stats->present_qpc[slot])
+            * 1000.0 / (double)stats->qpc_frequency));
+}
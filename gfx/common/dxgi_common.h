@@ -433,6 +433,16 @@ typedef struct
    float w;
 } float4_t;
 
+/* Presents whose queue time is kept, to match frame statistics to */
+#define DXGI_PRESENT_HISTORY 16
+
+typedef struct dxgi_present_stats
+{
+   LONGLONG present_qpc[DXGI_PRESENT_HISTORY];
+   UINT present_count[DXGI_PRESENT_HISTORY];
+   LONGLONG qpc_frequency;
+} dxgi_present_stats_t;
+
 RETRO_BEGIN_DECLS
 
 DXGI_FORMAT* dxgi_get_format_fallback_list(DXGI_FORMAT format);
@@ -469,6 +479,11 @@ void dxgi_set_hdr_metadata(
 
 DXGI_FORMAT glslang_format_to_dxgi(glslang_format fmt);
 
+/* Call after each Present. Reports to the frame timeline how long the
+ * last frame DXGI says reached the display took from its Present. */
+void dxgi_present_stats_update(dxgi_present_stats_t *stats,
+      DXGISwapChain handle);
+
 RETRO_END_DECLS
 
 #endif
@@ -186,7 +186,9 @@ enum gl2_flags
    GL2_FLAG_MENU_TEXTURE_ENABLE    = (1 << 19),
    GL2_FLAG_MENU_TEXTURE_FULLSCREEN= (1 << 20),
    GL2_FLAG_NONE                   = (1 << 21),
-   GL2_FLAG_FRAME_DUPE_LOCK        = (1 << 22)
+   GL2_FLAG_FRAME_DUPE_LOCK        = (1 << 22),
+   /* Frames go straight to a KMS plane; the texture is stale */
+   GL2_FLAG_KMS_SCANOUT            = (1 << 23)
 };
 
 struct gl2
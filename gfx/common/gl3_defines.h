@@ -35,6 +35,7 @@ RETRO_BEGIN_DECLS
 #define GL_CORE_NUM_PBOS 4
 #define GL_CORE_NUM_VBOS 256
 #define GL_CORE_NUM_FENCES 8
+#define GL_CORE_NUM_UPLOAD_PBOS 3
 
 enum gl3_flags
 {
@@ -51,7 +52,9 @@ enum gl3_flags
    GL3_FLAG_QUITTING               = (1 << 10),
    GL3_FLAG_SHOULD_RESIZE          = (1 << 11),
    GL3_FLAG_KEEP_ASPECT            = (1 << 12),
-   GL3_FLAG_FRAME_DUPE_LOCK        = (1 << 13)
+   GL3_FLAG_FRAME_DUPE_LOCK        = (1 << 13),
+   /* Upload buffers are mapped once, with ARB_buffer_storage */
+   GL3_FLAG_PERSISTENT_UPLOAD      = (1 << 14)
 };
 
 RETRO_END_DECLS
@@ -56,6 +56,7 @@ static dylib_t                       vulkan_library;
 static VkInstance                    cached_instance_vk;
 static VkDevice                      cached_device_vk;
 static retro_vulkan_destroy_device_t cached_destroy_device_vk;
+static uint32_t                      cached_transfer_queue_index_vk = VK_QUEUE_FAMILY_IGNORED;
 
 #if 0
 #define WSI_HARDENING_TEST
@@ -578,7 +579,7 @@ static bool vulkan_context_init_device(gfx_ctx_vulkan_data_t *vk)
    unsigned i;
    const char *enabled_device_extensions[8];
    VkDeviceCreateInfo device_info;
-   VkDeviceQueueCreateInfo queue_info;
+   VkDeviceQueueCreateInfo queue_info[2];
    static const float one                  = 1.0f;
    bool found_queue                        = false;
    video_driver_state_t *video_st          = video_state_get_ptr();
@@ -591,12 +592,18 @@ static bool vulkan_context_init_device(gfx_ctx_vulkan_data_t *vk)
                                     *iface = (struct retro_hw_render_context_negotiation_interface_vulkan*)
                                     video_st->hw_render_context_negotiation;
 
-   queue_info.sType                        = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-   queue_info.pNext                        = NULL;
-   queue_info.flags                        = 0;
-   queue_info.queueFamilyIndex             = 0;
-   queue_info.queueCount                   = 0;
-   queue_info.pQueuePriorities             = NULL;
+   for (i = 0; i < ARRAY_SIZE(queue_info); i++)
+   {
+      queue_info[i].sType                  = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+      queue_info[i].pNext                  = NULL;
+      queue_info[i].flags                  = 0;
+      queue_info[i].queueFamilyIndex       = 0;
+      queue_info[i].queueCount             = 0;
+      queue_info[i].pQueuePriorities       = NULL;
+   }
+
+   vk->context.transfer_queue              = VK_NULL_HANDLE;
+   vk->context.transfer_queue_index        = VK_QUEUE_FAMILY_IGNORED;
 
    device_info.sType                       = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
    device_info.pNext                       = NULL;
@@ -782,6 +789,20 @@ static bool vulkan_context_init_device(gfx_ctx_vulkan_data_t *vk)
          }
       }
 
+      /* A transfer-only family is usually a DMA engine, which can
+       * copy core frames while the graphics queue is busy */
+      for (i = 0; found_queue && i < queue_count; i++)
+      {
+         VkQueueFlags flags = queue_properties[i].queueFlags;
+         if (      (flags & VK_QUEUE_TRANSFER_BIT)
+               && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))
+               &&  queue_properties[i].queueCount > 0)
+         {
+            vk->context.transfer_queue_index = i;
+            break;
+         }
+      }
+
       free(queue_properties);
 
       if (!found_queue)
@@ -800,12 +821,16 @@ static bool vulkan_context_init_device(gfx_ctx_vulkan_data_t *vk)
           return false;
       }
 
-      queue_info.queueFamilyIndex         = vk->context.graphics_queue_index;
-      queue_info.queueCount               = 1;
-      queue_info.pQueuePriorities         = &one;
+      queue_info[0].queueFamilyIndex      = vk->context.graphics_queue_index;
+      queue_info[0].queueCount            = 1;
+      queue_info[0].pQueuePriorities      = &one;
+      queue_info[1].queueFamilyIndex      = vk->context.transfer_queue_index;
+      queue_info[1].queueCount            = 1;
+      queue_info[1].pQueuePriorities      = &one;
 
-      device_info.queueCreateInfoCount    = 1;
-      device_info.pQueueCreateInfos       = &queue_info;
+      device_info.queueCreateInfoCount    =
+         (vk->context.transfer_queue_index != VK_QUEUE_FAMILY_IGNORED) ? 2 : 1;
+      device_info.pQueueCreateInfos       = queue_info;
       device_info.enabledExtensionCount   = enabled_device_extension_count;
       device_info.ppEnabledExtensionNames = enabled_device_extensions;
       device_info.pEnabledFeatures        = &features;
@@ -814,6 +839,8 @@ static bool vulkan_context_init_device(gfx_ctx_vulkan_data_t *vk)
       {
          vk->context.device = cached_device_vk;
          cached_device_vk   = NULL;
+         /* It was created with this transfer queue, or none */
+         vk->context.transfer_queue_index = cached_transfer_queue_index_vk;
 
          video_st->flags   |= VIDEO_FLAG_CACHE_CONTEXT_ACK;
          RARCH_LOG("[Vulkan] Using cached Vulkan context.\n");
@@ -838,6 +865,14 @@ static bool vulkan_context_init_device(gfx_ctx_vulkan_data_t *vk)
             vk->context.graphics_queue_index, 0, &vk->context.queue);
    }
 
+   if (vk->context.transfer_queue_index != VK_QUEUE_FAMILY_IGNORED)
+   {
+      vkGetDeviceQueue(vk->context.device,
+            vk->context.transfer_queue_index, 0, &vk->context.transfer_queue);
+      RARCH_LOG("[Vulkan] Uploading core frames on transfer queue family %u.\n",
+            vk->context.transfer_queue_index);
+   }
+
 #ifdef HAVE_THREADS
    vk->context.queue_lock = slock_new();
    if (!vk->context.queue_lock)
@@ -2611,6 +2646,7 @@ void vulkan_context_destroy(gfx_ctx_vulkan_data_t *vk,
       cached_device_vk         = vk->context.device;
       cached_instance_vk       = vk->context.instance;
       cached_destroy_device_vk = vk->context.destroy_device;
+      cached_transfer_queue_index_vk = vk->context.transfer_queue_index;
    }
    else
    {
@@ -330,6 +330,9 @@ typedef struct vulkan_context
    VkPhysicalDevice gpu;
    VkDevice device;
    VkQueue queue;
+   /* Queue of a transfer-only family for core frame uploads,
+    * VK_NULL_HANDLE to upload on the graphics queue */
+   VkQueue transfer_queue;
 
    VkPhysicalDeviceProperties gpu_properties;
    VkPhysicalDeviceMemoryProperties memory_properties;
@@ -351,6 +354,7 @@ typedef struct vulkan_context
    VkDebugUtilsMessengerEXT debug_callback;
 #endif
    uint32_t graphics_queue_index;
+   uint32_t transfer_queue_index;
    uint32_t num_swapchain_images;
    uint32_t current_swapchain_index;
    uint32_t current_frame_index;
@@ -59,6 +59,7 @@
 #include "../../configuration.h"
 #include "../../retroarch.h"
 #include "../../performance_counters.h"
+#include "../../record/record_driver.h"
 #include "../../menu/menu_driver.h"
 #ifdef HAVE_REWIND
 #include "../../state_manager.h"
@@ -84,6 +85,9 @@ const GUID DECLSPEC_SELECTANY libretro_IID_IDXGIFactory5 = { 0x7632e1f5,0xee65,0
 #endif
 
 #define D3D11_MAX_GPU_COUNT 16
+/* Back buffer copies in flight for streamed readback; a copy is read
+ * this many frames minus one after it was made */
+#define D3D11_READBACK_FRAMES 4
 
 enum d3d11_state_flags
 {
@@ -104,7 +108,8 @@ enum d3d11_state_flags
    D3D11_ST_FLAG_OVERLAYS_FULLSCREEN = (1 << 14),
    D3D11_ST_FLAG_MENU_ENABLE         = (1 << 15),
    D3D11_ST_FLAG_MENU_FULLSCREEN     = (1 << 16),
-   D3D11_ST_FLAG_FRAME_DUPE_LOCK     = (1 << 17)
+   D3D11_ST_FLAG_FRAME_DUPE_LOCK     = (1 << 17),
+   D3D11_ST_FLAG_READBACK_STREAMED   = (1 << 18)
 };
 
 enum d3d11_feature_level_hint
@@ -304,6 +309,7 @@ typedef struct
 {
    unsigned              cur_mon_id;
    HANDLE                frameLatencyWaitableObject;
+   dxgi_present_stats_t  present_stats;
    DXGISwapChain         swapChain;
    D3D11Device           device;
    D3D_FEATURE_LEVEL     supportedFeatureLevel;
@@ -410,6 +416,14 @@ typedef struct
       float                      core_aspect_rot;
    } pass[GFX_MAX_SHADERS];
 
+   /* Only used for GPU recording */
+   struct
+   {
+      D3D11Texture2D staging[D3D11_READBACK_FRAMES];
+      unsigned       index;
+      bool           valid[D3D11_READBACK_FRAMES];
+   } readback;
+
    struct video_shader* shader_preset;
    struct string_list *gpu_list;
    IDXGIAdapter1 *current_adapter;
@@ -2038,6 +2052,9 @@ static void d3d11_gfx_free(void* data)
    Release(d3d11->frame.ubo);
    Release(d3d11->frame.vbo);
 
+   for (i = 0; i < D3D11_READBACK_FRAMES; i++)
+      Release(d3d11->readback.staging[i]);
+
    d3d11_release_texture(&d3d11->menu.texture);
    Release(d3d11->menu.vbo);
 
@@ -2919,6 +2936,18 @@ static void *d3d11_gfx_init(const video_info_t* video,
       d3d11_gfx_set_shader(d3d11, type, shader_preset);
    }
 
+   /* Only bother with streamed readback if we're doing GPU recording.
+    * Check recording_st->enable and not
+    * driver.recording_data, because recording is
+    * not initialized yet.
+    */
+   if (     settings->bools.video_gpu_record
+         && recording_state_get_ptr()->enable)
+   {
+      d3d11->flags |= D3D11_ST_FLAG_READBACK_STREAMED;
+      RARCH_LOG("[D3D11] Async staging readback enabled.\n");
+   }
+
    if (video_driver_get_hw_context()->context_type  == RETRO_HW_CONTEXT_D3D11)
    {
       d3d11->flags                     |= D3D11_ST_FLAG_HW_IFACE_ENABLE;
@@ -3134,6 +3163,68 @@ static INLINE void d3d11_wait_for_vblank(d3d11_video_t* d3d11)
    Release(pOutput);
 }
 
+/* Queues a copy of the back buffer into the next staging texture of
+ * the readback ring, to be mapped once the GPU is long done with it */
+static void d3d11_readback_copy(d3d11_video_t *d3d11)
+{
+   D3D11_TEXTURE2D_DESC desc;
+   D3D11Texture2D back_buffer = NULL;
+   unsigned index             = d3d11->readback.index;
+   D3D11Texture2D *staging    = &d3d11->readback.staging[index];
+
+#ifdef HAVE_DXGI_HDR
+   if (d3d11->flags & D3D11_ST_FLAG_HDR_ENABLE)
+      return;
+#endif
+
+   d3d11->swapChain->lpVtbl->GetBuffer(d3d11->swapChain, 0,
+         uuidof(ID3D11Texture2D), (void**)&back_buffer);
+   if (!back_buffer)
+      return;
+
+   back_buffer->lpVtbl->GetDesc(back_buffer, &desc);
+
+   if (*staging)
+   {
+      D3D11_TEXTURE2D_DESC staging_desc;
+      (*staging)->lpVtbl->GetDesc(*staging, &staging_desc);
+
+      /* The swapchain was resized, the older copies are stale too */
+      if (     (staging_desc.Width  != desc.Width)
+            || (staging_desc.Height != desc.Height)
+            || (staging_desc.Format != desc.Format))
+      {
+         unsigned i;
+         for (i = 0; i < D3D11_READBACK_FRAMES; i++)
+         {
+            Release(d3d11->readback.staging[i]);
+            d3d11->readback.staging[i] = NULL;
+            d3d11->readback.valid[i]   = false;
+         }
+      }
+   }
+
+   if (!*staging)
+   {
+      desc.Usage          = D3D11_USAGE_STAGING;
+      desc.BindFlags      = 0;
+      desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+      desc.MiscFlags      = 0;
+      d3d11->device->lpVtbl->CreateTexture2D(d3d11->device,
+            &desc, NULL, staging);
+   }
+
+   if (*staging)
+   {
+      d3d11->context->lpVtbl->CopyResource(d3d11->context,
+            (D3D11Resource)*staging, (D3D11Resource)back_buffer);
+      d3d11->readback.valid[index] = true;
+   }
+
+   Release(back_buffer);
+   d3d11->readback.index = (index + 1) % D3D11_READBACK_FRAMES;
+}
+
 static bool d3d11_gfx_frame(
       void*               data,
       const void*         frame,
@@ -3175,7 +3266,10 @@ static bool d3d11_gfx_frame(
    bool use_back_buffer           = back_buffer_format != d3d11->chain_formats[d3d11->chain_bit_depth];
 #endif
 
-   if (d3d11->flags & D3D11_ST_FLAG_WAITABLE_SWAPCHAINS)
+   /* The outer frame waits once it has presented, see the end;
+    * the frames it repeats still have to here */
+   if (     (d3d11->flags & D3D11_ST_FLAG_WAITABLE_SWAPCHAINS)
+         && (d3d11->flags & D3D11_ST_FLAG_FRAME_DUPE_LOCK))
       WaitForSingleObjectEx(
             d3d11->frameLatencyWaitableObject,
             1000,
@@ -3837,6 +3931,11 @@ static bool d3d11_gfx_frame(
    }
 #endif
 
+   /* Don't readback if we're in menu mode. */
+   if (     (d3d11->flags & D3D11_ST_FLAG_READBACK_STREAMED)
+         && !(d3d11->flags & D3D11_ST_FLAG_MENU_ENABLE))
+      d3d11_readback_copy(d3d11);
+
    if (vsync && d3d11->wait_for_vblank < 0)
    {
       d3d11->context->lpVtbl->Flush(d3d11->context);
@@ -3851,6 +3950,8 @@ static bool d3d11_gfx_frame(
    if (vsync && d3d11->wait_for_vblank > 0)
       d3d11_wait_for_vblank(d3d11);
 
+   dxgi_present_stats_update(&d3d11->present_stats, d3d11->swapChain);
+
    if (
            black_frame_insertion
         && !(d3d11->flags & D3D11_ST_FLAG_MENU_ENABLE)
@@ -3930,6 +4031,17 @@ static bool d3d11_gfx_frame(
 
    Release(rtv);
 
+   /* Wait for the swap chain here, before the next input poll, rather
+    * than at the start of the next frame, after the core has already
+    * read its input: the frame then shows input as fresh as the
+    * frame latency allows */
+   if (     (d3d11->flags & D3D11_ST_FLAG_WAITABLE_SWAPCHAINS)
+         && !(d3d11->flags & D3D11_ST_FLAG_FRAME_DUPE_LOCK))
+      WaitForSingleObjectEx(
+            d3d11->frameLatencyWaitableObject,
+            1000,
+            true);
+
    return true;
 }
 
@@ -3996,6 +4108,44 @@ static void d3d11_gfx_viewport_info(void* data, struct video_viewport* vp)
    *vp = d3d11->vp;
 }
 
+/* Converts the viewport of a mapped back buffer copy to bottom-up
+ * BGR24 */
+static bool d3d11_readback_convert(d3d11_video_t *d3d11,
+      uint8_t *buffer, const D3D11_MAPPED_SUBRESOURCE *map,
+      DXGI_FORMAT format)
+{
+   uint32_t y;
+   uint32_t x;
+   uint8_t *bufferRow;
+   const uint8_t *BackBufferData = (const uint8_t*)map->pData;
+   unsigned vp_y                 = (d3d11->vp.y > 0) ? d3d11->vp.y : 0;
+   unsigned vp_width             = (d3d11->vp.width  > d3d11->vp.full_width)  ? d3d11->vp.full_width  : d3d11->vp.width;
+   unsigned vp_height            = (d3d11->vp.height > d3d11->vp.full_height) ? d3d11->vp.full_height : d3d11->vp.height;
+
+   /* Assuming format is DXGI_FORMAT_R8G8B8A8_UNORM */
+   if (format != DXGI_FORMAT_R8G8B8A8_UNORM)
+   {
+      RARCH_ERR("[D3D11] Unexpected swapchain format.\n");
+      return false;
+   }
+
+   BackBufferData += map->RowPitch * vp_y;
+
+   for (y = 0; y < vp_height; y++, BackBufferData += map->RowPitch)
+   {
+      bufferRow = buffer + 3 * (vp_height - y - 1) * vp_width;
+
+      for (x = 0; x < vp_width; x++)
+      {
+         bufferRow[3 * x + 2] = BackBufferData[4 * (x + d3d11->vp.x) + 0];
+         bufferRow[3 * x + 1] = BackBufferData[4 * (x + d3d11->vp.x) + 1];
+         bufferRow[3 * x + 0] = BackBufferData[4 * (x + d3d11->vp.x) + 2];
+      }
+   }
+
+   return true;
+}
+
 static bool d3d11_gfx_read_viewport(void* data, uint8_t* buffer, bool is_idle)
 {
    d3d11_video_t* d3d11 = (d3d11_video_t*)data;
@@ -4006,10 +4156,6 @@ static bool d3d11_gfx_read_viewport(void* data, uint8_t* buffer, bool is_idle)
    ID3D11Resource* BackBufferResource = NULL;
    D3D11_TEXTURE2D_DESC StagingDesc;
    D3D11_MAPPED_SUBRESOURCE Map;
-   const uint8_t* BackBufferData;
-   uint8_t* bufferRow;
-   uint32_t y;
-   uint32_t x;
    bool ret;
 
    if (!d3d11)
@@ -4024,6 +4170,30 @@ static bool d3d11_gfx_read_viewport(void* data, uint8_t* buffer, bool is_idle)
    }
 #endif
 
+   if (d3d11->flags & D3D11_ST_FLAG_READBACK_STREAMED)
+   {
+      /* The oldest copy in the ring, which the next frame overwrites */
+      unsigned index          = d3d11->readback.index;
+      D3D11Texture2D staging  = d3d11->readback.staging[index];
+
+      /* Don't readback if we're in menu mode.
+       * Also, the ring needs a few frames to fill up. */
+      if (!d3d11->readback.valid[index])
+         return false;
+
+      d3d11->readback.valid[index] = false;
+      staging->lpVtbl->GetDesc(staging, &StagingDesc);
+
+      if (FAILED(d3d11->context->lpVtbl->Map(d3d11->context,
+                  (D3D11Resource)staging, 0, D3D11_MAP_READ, 0, &Map)))
+         return false;
+
+      ret = d3d11_readback_convert(d3d11, buffer, &Map, StagingDesc.Format);
+      d3d11->context->lpVtbl->Unmap(d3d11->context,
+            (D3D11Resource)staging, 0);
+      return ret;
+   }
+
    /* Get the back buffer. */
    m_SwapChain = d3d11->swapChain;
 #ifdef __cplusplus
@@ -4062,35 +4232,7 @@ static bool d3d11_gfx_read_viewport(void* data, uint8_t* buffer, bool is_idle)
 
    /* Create the image. */
    d3d11->context->lpVtbl->Map(d3d11->context, BackBufferStaging, 0, D3D11_MAP_READ, 0, &Map);
-   BackBufferData = (const uint8_t*)Map.pData;
-
-   /* Assuming format is DXGI_FORMAT_R8G8B8A8_UNORM */
-   if (StagingDesc.Format == DXGI_FORMAT_R8G8B8A8_UNORM)
-   {
-      unsigned vp_y      = (d3d11->vp.y > 0) ? d3d11->vp.y : 0;
-      unsigned vp_width  = (d3d11->vp.width  > d3d11->vp.full_width)  ? d3d11->vp.full_width  : d3d11->vp.width;
-      unsigned vp_height = (d3d11->vp.height > d3d11->vp.full_height) ? d3d11->vp.full_height : d3d11->vp.height;
-
-      BackBufferData += Map.RowPitch * vp_y;
-
-      for (y = 0; y < vp_height; y++, BackBufferData += Map.RowPitch)
-      {
-         bufferRow = buffer + 3 * (vp_height - y - 1) * vp_width;
-
-         for (x = 0; x < vp_width; x++)
-         {
-            bufferRow[3 * x + 2] = BackBufferData[4 * (x + d3d11->vp.x) + 0];
-            bufferRow[3 * x + 1] = BackBufferData[4 * (x + d3d11->vp.x) + 1];
-            bufferRow[3 * x + 0] = BackBufferData[4 * (x + d3d11->vp.x) + 2];
-         }
-      }
-      ret = true;
-   }
-   else
-   {
-      RARCH_ERR("[D3D11] Unexpected swapchain format.\n");
-      ret = false;
-   }
+   ret = d3d11_readback_convert(d3d11, buffer, &Map, StagingDesc.Format);
 
    d3d11->context->lpVtbl->Unmap(d3d11->context, BackBufferStaging, 0);
 
@@ -298,6 +298,7 @@ typedef struct
    struct
    {
       HANDLE                      frameLatencyWaitableObject;
+      dxgi_present_stats_t        present_stats;
       DXGISwapChain               handle;
       D3D12Resource               renderTargets[2];
 #ifdef HAVE_DXGI_HDR
@@ -3754,7 +3755,10 @@ static bool d3d12_gfx_frame(
 #endif
    D3D12GraphicsCommandList cmd   = d3d12->queue.cmd;
 
-   if (d3d12->flags & D3D12_ST_FLAG_WAITABLE_SWAPCHAINS)
+   /* The outer frame waits once it has presented, see the end;
+    * the frames it repeats still have to here */
+   if (     (d3d12->flags & D3D12_ST_FLAG_WAITABLE_SWAPCHAINS)
+         && (d3d12->flags & D3D12_ST_FLAG_FRAME_DUPE_LOCK))
       WaitForSingleObjectEx(
             d3d12->chain.frameLatencyWaitableObject,
             1000,
@@ -4529,6 +4533,9 @@ static bool d3d12_gfx_frame(
    if (vsync && d3d12->wait_for_vblank > 0)
       d3d12_wait_for_vblank(d3d12);
 
+   dxgi_present_stats_update(&d3d12->chain.present_stats,
+         d3d12->chain.handle);
+
    if (
            black_frame_insertion
         && !(d3d12->flags & D3D12_ST_FLAG_MENU_ENABLE)
@@ -4604,6 +4611,17 @@ static bool d3d12_gfx_frame(
       d3d12->flags &= ~D3D12_ST_FLAG_FRAME_DUPE_LOCK;
    }
 
+   /* Wait for the swap chain here, before the next input poll, rather
+    * than at the start of the next frame, after the core has already
+    * read its input: the frame then shows input as fresh as the
+    * frame latency allows */
+   if (     (d3d12->flags & D3D12_ST_FLAG_WAITABLE_SWAPCHAINS)
+         && !(d3d12->flags & D3D12_ST_FLAG_FRAME_DUPE_LOCK))
+      WaitForSingleObjectEx(
+            d3d12->chain.frameLatencyWaitableObject,
+            1000,
+            true);
+
    return true;
 }
 
@@ -41,6 +41,7 @@
 
 #include <encodings/utf.h>
 #include <compat/strl.h>
+#include <features/features_cpu.h>
 #include <gfx/scaler/scaler.h>
 #include <gfx/math/matrix_4x4.h>
 #include <formats/image.h>
@@ -88,6 +89,10 @@
 #include "../gfx_widgets.h"
 #endif
 
+#ifdef HAVE_KMS
+#include "../common/drm_common.h"
+#endif
+
 #ifndef GL_UNSIGNED_INT_8_8_8_8_REV
 #define GL_UNSIGNED_INT_8_8_8_8_REV       0x8367
 #endif
@@ -99,6 +104,7 @@
    coords[7] = yamt
 
 #define MAX_FENCES 4
+#define GL2_UPLOAD_PBOS 3
 
 #if !defined(HAVE_PSGL)
 
@@ -108,6 +114,12 @@
 
 #endif
 
+/* Desktop GL uploads software frames through a ring of persistently
+ * mapped unpack buffers where ARB_buffer_storage is there */
+#if !defined(HAVE_OPENGLES) && !defined(HAVE_PSGL)
+#define HAVE_GL_UPLOAD_PBO
+#endif
+
 #define GL_RASTER_FONT_EMIT(c, vx, vy) \
    font_vertex[     2 * (6 * i + c) + 0] = (x + (delta_x + off_x + vx * width) * scale) * inv_win_width; \
    font_vertex[     2 * (6 * i + c) + 1] = (y + (delta_y - off_y - vy * height) * scale) * inv_win_height; \
@@ -186,7 +198,8 @@ enum gl2_renderchain_flags
    GL2_CHAIN_FLAG_EGL_IMAGES           = (1 << 0),
    GL2_CHAIN_FLAG_HAS_FP_FBO           = (1 << 1),
    GL2_CHAIN_FLAG_HAS_SRGB_FBO         = (1 << 2),
-   GL2_CHAIN_FLAG_HW_RENDER_DEPTH_INIT = (1 << 3)
+   GL2_CHAIN_FLAG_HW_RENDER_DEPTH_INIT = (1 << 3),
+   GL2_CHAIN_FLAG_UPLOAD_PBO           = (1 << 4)
 };
 
 typedef struct video_shader_ctx_scale
@@ -214,6 +227,13 @@ typedef struct gl2_renderchain_data
 #ifdef HAVE_GL_SYNC
    GLsync fences[MAX_FENCES];
 #endif
+#ifdef HAVE_GL_UPLOAD_PBO
+   GLuint upload_pbo[GL2_UPLOAD_PBOS];
+   GLsync upload_fence[GL2_UPLOAD_PBOS];
+   uint8_t *upload_mapped[GL2_UPLOAD_PBOS];
+   size_t upload_size;
+   unsigned upload_index;
+#endif
 
    GLuint vao;
    GLuint fbo[GFX_MAX_SHADERS];
@@ -2206,6 +2226,111 @@ error:
    glDisable(GL_DITHER)
 #endif
 
+#ifdef HAVE_GL_UPLOAD_PBO
+static void gl2_renderchain_deinit_upload_pbos(gl2_renderchain_data_t *chain)
+{
+   unsigned i;
+   for (i = 0; i < GL2_UPLOAD_PBOS; i++)
+   {
+      if (chain->upload_fence[i])
+         glDeleteSync(chain->upload_fence[i]);
+      chain->upload_fence[i]  = NULL;
+      chain->upload_mapped[i] = NULL;
+   }
+   /* Deleting a buffer unmaps it */
+   if (chain->upload_pbo[0])
+      glDeleteBuffers(GL2_UPLOAD_PBOS, chain->upload_pbo);
+   memset(chain->upload_pbo, 0, sizeof(chain->upload_pbo));
+   chain->upload_size = 0;
+}
+
+/* Grows the upload buffers to @size bytes each, mapped for their
+ * lifetime. On failure, frames go back to client memory uploads. */
+static bool gl2_renderchain_init_upload_pbos(gl2_renderchain_data_t *chain,
+      size_t size)
+{
+   unsigned i;
+   GLbitfield access = GL_MAP_WRITE_BIT
+      | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+   if (size <= chain->upload_size)
+      return true;
+
+   gl2_renderchain_deinit_upload_pbos(chain);
+   glGenBuffers(GL2_UPLOAD_PBOS, chain->upload_pbo);
+
+   for (i = 0; i < GL2_UPLOAD_PBOS; i++)
+   {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, chain->upload_pbo[i]);
+      glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, access);
+      if (!(chain->upload_mapped[i] = (uint8_t*)glMapBufferRange(
+                  GL_PIXEL_UNPACK_BUFFER, 0, size, access)))
+      {
+         RARCH_WARN("[GL] Cannot map upload buffers persistently.\n");
+         glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+         gl2_renderchain_deinit_upload_pbos(chain);
+         chain->flags &= ~GL2_CHAIN_FLAG_UPLOAD_PBO;
+         return false;
+      }
+   }
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+   chain->upload_size = size;
+   return true;
+}
+
+/* Writes the frame into the next upload buffer, converted to 32-bit
+ * on the way if it has to be, and uploads the bound texture from it */
+static bool gl2_renderchain_upload_frame_pbo(gl2_t *gl,
+      gl2_renderchain_data_t *chain,
+      const void *frame, unsigned width, unsigned height, unsigned pitch)
+{
+   unsigned slot;
+   uint8_t *dst;
+   bool convert = (gl->base_size == 2)
+      && !(gl->flags & GL2_FLAG_HAVE_ES2_COMPAT);
+   size_t row   = (size_t)width * (convert ? 4 : gl->base_size);
+
+   if (     !(chain->flags & GL2_CHAIN_FLAG_UPLOAD_PBO)
+         || !gl2_renderchain_init_upload_pbos(chain, row * height))
+      return false;
+
+   slot = (chain->upload_index + 1) % GL2_UPLOAD_PBOS;
+   if (chain->upload_fence[slot])
+   {
+      glClientWaitSync(chain->upload_fence[slot],
+            GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+      glDeleteSync(chain->upload_fence[slot]);
+      chain->upload_fence[slot] = NULL;
+   }
+   dst = chain->upload_mapped[slot];
+
+   if (convert)
+      video_frame_convert_rgb16_to_rgb32(&gl->scaler,
+            dst, frame, width, height, pitch);
+   else if (pitch == row)
+      memcpy(dst, frame, row * height);
+   else
+   {
+      unsigned h;
+      const uint8_t *src = (const uint8_t*)frame;
+      for (h = 0; h < height; h++, src += pitch, dst += row)
+         memcpy(dst, src, row);
+   }
+
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, chain->upload_pbo[slot]);
+   glPixelStorei(GL_UNPACK_ALIGNMENT, gl2_get_alignment((unsigned)row));
+   glTexSubImage2D(GL_TEXTURE_2D,
+         0, 0, 0, width, height, gl->texture_type,
+         gl->texture_fmt, NULL);
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+   chain->upload_fence[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+   chain->upload_index       = slot;
+   return true;
+}
+#endif
+
 static void gl2_renderchain_copy_frame(
       gl2_t *gl,
       gl2_renderchain_data_t *chain,
@@ -2308,6 +2433,18 @@ static void gl2_renderchain_copy_frame(
 #else
    {
       const GLvoid *data_buf = frame;
+#ifdef HAVE_GL_UPLOAD_PBO
+      video_driver_state_t *video_st = video_state_get_ptr();
+
+      if (gl2_renderchain_upload_frame_pbo(gl, chain,
+               frame, width, height, pitch))
+      {
+         video_st->frame_upload_queue = "PBO (persistent)";
+         return;
+      }
+      video_st->frame_upload_queue    = "None (client memory)";
+#endif
+
       glPixelStorei(GL_UNPACK_ALIGNMENT, gl2_get_alignment(pitch));
 
       if (gl->base_size == 2 && (!(gl->flags & GL2_FLAG_HAVE_ES2_COMPAT)))
@@ -2470,6 +2607,17 @@ static void gl2_renderchain_resolve_extensions(gl2_t *gl,
       chain->flags |=  GL2_CHAIN_FLAG_EGL_IMAGES;
    else
       chain->flags &= ~GL2_CHAIN_FLAG_EGL_IMAGES;
+
+#ifdef HAVE_GL_UPLOAD_PBO
+   if (     (gl->flags & GL2_FLAG_HAVE_SYNC)
+         && gl_check_capability(GL_CAPS_BUFFER_STORAGE))
+   {
+      chain->flags |=  GL2_CHAIN_FLAG_UPLOAD_PBO;
+      RARCH_LOG("[GL] Uploading frames through persistently mapped buffers.\n");
+   }
+   else
+      chain->flags &= ~GL2_CHAIN_FLAG_UPLOAD_PBO;
+#endif
 }
 
 static void gl_load_texture_data(
@@ -3335,6 +3483,109 @@ static void gl2_pbo_async_readback(gl2_t *gl)
    gl2_renderchain_unbind_pbo();
 }
 
+#ifdef HAVE_KMS
+/* Why the frame can't go straight to a KMS plane, NULL if it can */
+static const char *gl2_scanout_blocker(gl2_t *gl, const char *msg,
+      video_frame_info_t *video_info)
+{
+   if (gl->flags & GL2_FLAG_HW_RENDER_FBO_INIT)
+      return "hardware rendering";
+   if (     (gl->flags & GL2_FLAG_FBO_INITED)
+         || !string_is_empty(video_shader_get_current_shader_preset()))
+      return "shader";
+   if (gl->flags & GL2_FLAG_MENU_TEXTURE_ENABLE)
+      return "menu";
+   if (gl->flags & GL2_FLAG_OVERLAY_ENABLE)
+      return "overlay";
+   if (gl->rotation)
+      return "rotation";
+   if (video_info->black_frame_insertion)
+      return "black frame insertion";
+   if (     gl->readback_buffer_screenshot
+         || (gl->flags & GL2_FLAG_PBO_READBACK_ENABLE))
+      return "readback";
+   if (     !string_is_empty(msg)
+         || video_info->fps_show
+         || video_info->framecount_show
+         || video_info->memory_show)
+      return "on-screen text";
+#ifdef HAVE_GFX_WIDGETS
+   if (video_info->widgets_active && !gfx_widgets_idle())
+      return "notification";
+#endif
+   /* Last, so that the overlay shows what else is in the way */
+   if (video_info->statistics_show)
+      return "statistics overlay";
+   return NULL;
+}
+
+/* Hands a software frame to the KMS context's overlay plane when
+ * nothing else is drawn, leaving the scaling to the display
+ * controller. Returns false if the frame is to be composed; on the
+ * way back, a dupe is swapped for the cached frame, since the
+ * texture stopped following the core while it was on the plane. */
+static bool gl2_scanout_frame(gl2_t *gl, const void **frame,
+      unsigned *frame_width, unsigned *frame_height, unsigned *pitch,
+      const char *msg, video_frame_info_t *video_info)
+{
+   const char *blocker            = NULL;
+   settings_t *settings           = config_get_ptr();
+   video_driver_state_t *video_st = video_state_get_ptr();
+
+   if (     gl->ctx_driver == &gfx_ctx_drm
+         && settings->bools.video_kms_direct_scanout
+         && !(blocker = gl2_scanout_blocker(gl, msg, video_info)))
+   {
+      if (gl->flags & GL2_FLAG_SHOULD_RESIZE)
+      {
+         if (gl->ctx_driver->set_resize)
+            gl->ctx_driver->set_resize(gl->ctx_data,
+                  gl->video_width, gl->video_height);
+         gl->flags &= ~GL2_FLAG_SHOULD_RESIZE;
+         gl2_set_viewport(gl, gl->video_width, gl->video_height,
+               false, true);
+      }
+
+      /* GL's viewport counts from the bottom, the CRTC's from the top */
+      if (gfx_ctx_drm_scanout_frame(gl->ctx_data, *frame,
+               *frame_width, *frame_height, *pitch, gl->base_size == 4,
+               gl->vp.x,
+               (int)gl->video_height - gl->vp.y - (int)gl->vp.height,
+               gl->vp.width, gl->vp.height,
+               settings->bools.video_smooth))
+      {
+         if (!(gl->flags & GL2_FLAG_KMS_SCANOUT))
+            RARCH_LOG("[KMS] Direct scanout on.\n");
+         gl->flags                |= GL2_FLAG_KMS_SCANOUT;
+         video_st->scanout_blocker = "";
+         return true;
+      }
+      blocker = "display controller";
+   }
+
+   if (gl->flags & GL2_FLAG_KMS_SCANOUT)
+   {
+      RARCH_LOG("[KMS] Direct scanout off (%s).\n",
+            blocker ? blocker : "disabled");
+      gfx_ctx_drm_scanout_stop(gl->ctx_data);
+      gl->flags &= ~GL2_FLAG_KMS_SCANOUT;
+
+      if (     !*frame
+            && video_st->frame_cache_data
+            && video_st->frame_cache_data != RETRO_HW_FRAME_BUFFER_VALID)
+      {
+         *frame        = video_st->frame_cache_data;
+         *frame_width  = video_st->frame_cache_width;
+         *frame_height = video_st->frame_cache_height;
+         *pitch        = (unsigned)video_st->frame_cache_pitch;
+      }
+   }
+
+   video_st->scanout_blocker = blocker;
+   return false;
+}
+#endif
+
 static bool gl2_frame(void *data, const void *frame,
       unsigned frame_width, unsigned frame_height,
       uint64_t frame_count,
@@ -3368,6 +3619,12 @@ static bool gl2_frame(void *data, const void *frame,
    if (!gl)
       return false;
 
+#ifdef HAVE_KMS
+   if (gl2_scanout_frame(gl, &frame, &frame_width, &frame_height,
+            &pitch, msg, video_info))
+      return true;
+#endif
+
    if (gl->flags & GL2_FLAG_SHARED_CONTEXT_USE)
       gl->ctx_driver->bind_hw_render(gl->ctx_data, false);
 
@@ -3470,8 +3727,11 @@ static bool gl2_frame(void *data, const void *frame,
       {
          gl2_update_input_size(gl, frame_width, frame_height, pitch, true);
 
+         retro_time_t start = cpu_features_get_time_usec();
          gl2_renderchain_copy_frame(gl, chain, use_rgba,
                frame, frame_width, frame_height, pitch);
+         video_state_get_ptr()->frame_upload_time =
+            cpu_features_get_time_usec() - start;
       }
 
       /* No point regenerating mipmaps
@@ -3738,6 +3998,13 @@ static void gl2_free(void *data)
       gl2_renderchain_fence_free(gl,
             (gl2_renderchain_data_t*)
             gl->renderchain_data);
+#ifdef HAVE_GL_UPLOAD_PBO
+   if (gl->renderchain_data)
+      gl2_renderchain_deinit_upload_pbos(
+            (gl2_renderchain_data_t*)gl->renderchain_data);
+#endif
+   video_state_get_ptr()->frame_upload_queue = NULL;
+   video_state_get_ptr()->scanout_blocker    = NULL;
 
    font_driver_free_osd();
 
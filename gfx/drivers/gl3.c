@@ -30,6 +30,7 @@
 #include "../common/gl3_defines.h"
 
 #include <encodings/utf.h>
+#include <features/features_cpu.h>
 #include <gfx/gl_capabilities.h>
 #include <gfx/video_frame.h>
 #include <glsym/glsym.h>
@@ -98,6 +99,11 @@ typedef struct gl3
    GLuint vao;
    GLuint menu_texture;
    GLuint pbo_readback[GL_CORE_NUM_PBOS];
+   /* Ring of unpack buffers software frames are uploaded from */
+   GLuint upload_pbo[GL_CORE_NUM_UPLOAD_PBOS];
+   GLsync upload_fence[GL_CORE_NUM_UPLOAD_PBOS];
+   uint8_t *upload_mapped[GL_CORE_NUM_UPLOAD_PBOS];
+   size_t upload_size;
 
    /* Render chain for non-Slang shaders only. */
    struct
@@ -164,6 +170,7 @@ typedef struct gl3
    unsigned scratch_vbo_index;
    unsigned fence_count;
    unsigned pbo_readback_index;
+   unsigned upload_index;
    unsigned hw_render_max_width;
    unsigned hw_render_max_height;
    GLuint scratch_vbos[GL_CORE_NUM_VBOS];
@@ -1340,6 +1347,75 @@ static void gl3_deinit_fences(gl3_t *gl)
    memset(gl->fences, 0, sizeof(gl->fences));
 }
 
+static void gl3_deinit_upload_pbos(gl3_t *gl)
+{
+   unsigned i;
+   for (i = 0; i < GL_CORE_NUM_UPLOAD_PBOS; i++)
+   {
+      if (gl->upload_fence[i])
+         glDeleteSync(gl->upload_fence[i]);
+      gl->upload_fence[i]  = NULL;
+      gl->upload_mapped[i] = NULL;
+   }
+   /* Deleting a buffer unmaps it */
+   if (gl->upload_pbo[0])
+      glDeleteBuffers(GL_CORE_NUM_UPLOAD_PBOS, gl->upload_pbo);
+   memset(gl->upload_pbo, 0, sizeof(gl->upload_pbo));
+   gl->upload_size = 0;
+}
+
+/* Grows the upload buffers to @size bytes each. With persistent
+ * mapping they stay mapped for their lifetime; if mapping fails,
+ * they fall back to a map per upload. */
+static bool gl3_init_upload_pbos(gl3_t *gl, size_t size)
+{
+   unsigned i;
+
+   if (size <= gl->upload_size)
+      return true;
+
+   gl3_deinit_upload_pbos(gl);
+   glGenBuffers(GL_CORE_NUM_UPLOAD_PBOS, gl->upload_pbo);
+
+   for (i = 0; i < GL_CORE_NUM_UPLOAD_PBOS; i++)
+   {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, gl->upload_pbo[i]);
+#ifndef HAVE_OPENGLES
+      if (gl->flags & GL3_FLAG_PERSISTENT_UPLOAD)
+      {
+         GLbitfield access = GL_MAP_WRITE_BIT
+            | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+         glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, access);
+         if (!(gl->upload_mapped[i] = (uint8_t*)glMapBufferRange(
+                     GL_PIXEL_UNPACK_BUFFER, 0, size, access)))
+         {
+            RARCH_WARN("[GLCore] Cannot map upload buffers persistently.\n");
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            gl->flags &= ~GL3_FLAG_PERSISTENT_UPLOAD;
+            gl3_deinit_upload_pbos(gl);
+            return gl3_init_upload_pbos(gl, size);
+         }
+      }
+      else
+#endif
+         glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+   }
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+   gl->upload_size = size;
+   return true;
+}
+
+/* Waits for the GPU to be done reading upload buffer @i */
+static void gl3_wait_upload_pbo(gl3_t *gl, unsigned i)
+{
+   if (!gl->upload_fence[i])
+      return;
+   glClientWaitSync(gl->upload_fence[i], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+   glDeleteSync(gl->upload_fence[i]);
+   gl->upload_fence[i] = NULL;
+}
+
 static bool gl3_init_pbo_readback(gl3_t *gl)
 {
    int i;
@@ -1698,6 +1774,7 @@ static void gl3_destroy_resources(gl3_t *gl)
    gl3_free_scratch_vbos(gl);
 #endif
    gl3_deinit_fences(gl);
+   gl3_deinit_upload_pbos(gl);
    gl3_deinit_pbo_readback(gl);
    gl3_deinit_hw_render(gl);
 }
@@ -2983,6 +3060,14 @@ static void *gl3_init(const video_info_t *video,
    else
       gl->flags &= ~GL3_FLAG_PBO_READBACK_ENABLE;
 
+   if (gl_check_capability(GL_CAPS_BUFFER_STORAGE))
+   {
+      gl->flags |=  GL3_FLAG_PERSISTENT_UPLOAD;
+      RARCH_LOG("[GLCore] Uploading frames through persistently mapped buffers.\n");
+   }
+   else
+      gl->flags &= ~GL3_FLAG_PERSISTENT_UPLOAD;
+
    if (!gl_check_error(&err_string))
    {
       RARCH_ERR("[GLCore] %s\n", err_string);
@@ -3201,6 +3286,7 @@ static void gl3_free(void *data)
       gl->ctx_driver->bind_hw_render(gl->ctx_data, false);
    font_driver_free_osd();
    gl3_destroy_resources(gl);
+   video_state_get_ptr()->frame_upload_queue = NULL;
    if (gl->ctx_driver && gl->ctx_driver->destroy)
       gl->ctx_driver->destroy(gl->ctx_data);
    video_context_driver_free();
@@ -3431,10 +3517,89 @@ error:
    return false;
 }
 
+/* Uploads the bound texture from @frame through the next unpack
+ * buffer, so the copy to the GPU doesn't stall the CPU. A frame the
+ * core rendered into an upload buffer, see
+ * gl3_get_current_sw_framebuffer(), is uploaded as it is. */
+static bool gl3_upload_frame_pbo(gl3_t *gl, const void *frame,
+      unsigned width, unsigned height, unsigned pitch)
+{
+   unsigned i;
+   unsigned bpp  = gl->video_info.rgb32 ? 4 : 2;
+   size_t row    = (size_t)width * bpp;
+   unsigned slot = GL_CORE_NUM_UPLOAD_PBOS;
+
+   for (i = 0; i < GL_CORE_NUM_UPLOAD_PBOS; i++)
+   {
+      if (     gl->upload_mapped[i]
+            && frame == gl->upload_mapped[i]
+            && (size_t)pitch * height <= gl->upload_size)
+      {
+         slot = i;
+         glBindBuffer(GL_PIXEL_UNPACK_BUFFER, gl->upload_pbo[slot]);
+         break;
+      }
+   }
+
+   if (slot == GL_CORE_NUM_UPLOAD_PBOS)
+   {
+      uint8_t *dst;
+      const uint8_t *src = (const uint8_t*)frame;
+
+      if (!gl3_init_upload_pbos(gl, row * height))
+         return false;
+
+      slot = (gl->upload_index + 1) % GL_CORE_NUM_UPLOAD_PBOS;
+      gl3_wait_upload_pbo(gl, slot);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, gl->upload_pbo[slot]);
+
+      /* Unsynchronized is safe, the fence was waited on */
+      if (     !(dst = gl->upload_mapped[slot])
+            && !(dst = (uint8_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+                  0, row * height, GL_MAP_WRITE_BIT
+                  | GL_MAP_INVALIDATE_BUFFER_BIT
+                  | GL_MAP_UNSYNCHRONIZED_BIT)))
+      {
+         glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+         return false;
+      }
+
+      if (pitch == row)
+         memcpy(dst, src, row * height);
+      else
+         for (i = 0; i < height; i++, src += pitch, dst += row)
+            memcpy(dst, src, row);
+
+      if (!gl->upload_mapped[slot])
+         glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      pitch = (unsigned)row;
+   }
+
+   glPixelStorei(GL_UNPACK_ROW_LENGTH, pitch / bpp);
+   glPixelStorei(GL_UNPACK_ALIGNMENT, bpp);
+   if (gl->video_info.rgb32)
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
+                      width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+   else
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
+                      width, height, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, NULL);
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+   if (gl->upload_fence[slot])
+      glDeleteSync(gl->upload_fence[slot]);
+   gl->upload_fence[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+   gl->upload_index       = slot;
+   return true;
+}
+
 static void gl3_update_cpu_texture(gl3_t *gl,
       struct gl3_streamed_texture *streamed,
       const void *frame, unsigned width, unsigned height, unsigned pitch)
 {
+   video_driver_state_t *video_st = video_state_get_ptr();
+   unsigned frame_width           = width;
+   unsigned frame_height          = height;
+
    if (gl->chain.active)
    {
       /* The input texture is expected to be square with a power of 2 size when not using Slang */
@@ -3467,6 +3632,14 @@ static void gl3_update_cpu_texture(gl3_t *gl,
    else
       glBindTexture(GL_TEXTURE_2D, streamed->tex);
 
+   if (gl3_upload_frame_pbo(gl, frame, frame_width, frame_height, pitch))
+   {
+      video_st->frame_upload_queue = (gl->flags & GL3_FLAG_PERSISTENT_UPLOAD)
+         ? "PBO (persistent)" : "PBO";
+      return;
+   }
+
+   video_st->frame_upload_queue    = "None (client memory)";
    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
    if (gl->video_info.rgb32)
    {
@@ -3816,8 +3989,13 @@ static bool gl3_frame(void *data, const void *frame,
          streamed->height   = frame_height;
       }
       else
+      {
+         retro_time_t start = cpu_features_get_time_usec();
          gl3_update_cpu_texture(gl, streamed, frame,
                frame_width, frame_height, pitch);
+         video_state_get_ptr()->frame_upload_time =
+            cpu_features_get_time_usec() - start;
+      }
    }
 
    if (gl->flags & GL3_FLAG_SHOULD_RESIZE)
@@ -4546,6 +4724,39 @@ static retro_proc_address_t gl3_get_proc_address(
    return NULL;
 }
 
+/* Lends the core the next persistently mapped upload buffer to
+ * render into, which saves copying the frame into it. The mapping is
+ * write-combined, so cores that read back their frame get none. */
+static bool gl3_get_current_sw_framebuffer(void *data,
+      struct retro_framebuffer *framebuffer)
+{
+   unsigned slot, bpp;
+   gl3_t *gl = (gl3_t*)data;
+
+   if (     !gl
+         || !(gl->flags & GL3_FLAG_PERSISTENT_UPLOAD)
+         ||  (gl->flags & GL3_FLAG_HW_RENDER_ENABLE)
+         ||  (framebuffer->access_flags & RETRO_MEMORY_ACCESS_READ)
+         || video_state_get_ptr()->pix_fmt == RETRO_PIXEL_FORMAT_0RGB1555)
+      return false;
+
+   bpp = gl->video_info.rgb32 ? 4 : 2;
+   if (     !gl3_init_upload_pbos(gl,
+            (size_t)framebuffer->width * framebuffer->height * bpp)
+         || !(gl->flags & GL3_FLAG_PERSISTENT_UPLOAD))
+      return false;
+
+   slot = (gl->upload_index + 1) % GL_CORE_NUM_UPLOAD_PBOS;
+   gl3_wait_upload_pbo(gl, slot);
+
+   framebuffer->data         = gl->upload_mapped[slot];
+   framebuffer->pitch        = framebuffer->width * bpp;
+   framebuffer->format       = gl->video_info.rgb32
+      ? RETRO_PIXEL_FORMAT_XRGB8888 : RETRO_PIXEL_FORMAT_RGB565;
+   framebuffer->memory_flags = 0;
+   return true;
+}
+
 static const video_poke_interface_t gl3_poke_interface = {
    gl3_get_flags,
    gl3_load_texture,
@@ -4566,7 +4777,7 @@ static const video_poke_interface_t gl3_poke_interface = {
    gl3_show_mouse,
    NULL, /* grab_mouse_toggle */
    gl3_get_current_shader,
-   NULL, /* get_current_software_framebuffer */
+   gl3_get_current_sw_framebuffer,
    NULL, /* get_hw_render_interface */
    NULL, /* set_hdr_max_nits */
    NULL, /* set_hdr_paper_white_nits */
@@ -27,9 +27,15 @@
 #include <retro_inline.h>
 #include <retro_miscellaneous.h>
 #include <retro_math.h>
+#include <file/file_path.h>
+#include <features/features_cpu.h>
+#include <streams/file_stream.h>
 #include <string/stdstring.h>
 #include <libretro.h>
 
+#define XXH_INLINE_ALL
+#include <xxHash/xxhash.h>
+
 #ifdef HAVE_CONFIG_H
 #include "../../config.h"
 #endif
@@ -47,6 +53,7 @@
 #include "../common/vulkan_common.h"
 
 #include "../../configuration.h"
+#include "../../file_path_special.h"
 #ifdef HAVE_REWIND
 #include "../../state_manager.h"
 #endif
@@ -176,6 +183,8 @@ typedef struct vk
    unsigned rotation;
    unsigned num_swapchain_images;
    unsigned last_valid_index;
+   /* Of the last software frame uploaded, to tell a repeat */
+   uint64_t frame_hash;
 
    video_info_t video;
 
@@ -209,6 +218,16 @@ typedef struct vk
       unsigned count;
    } overlay;
 
+   /* Core frame copies on the context's transfer queue, per frame
+    * index. The pool is VK_NULL_HANDLE when there is no such queue. */
+   struct
+   {
+      VkCommandPool pool;
+      VkCommandBuffer cmd[VULKAN_MAX_SWAPCHAIN_IMAGES];
+      VkSemaphore semaphore[VULKAN_MAX_SWAPCHAIN_IMAGES];
+      bool pending[VULKAN_MAX_SWAPCHAIN_IMAGES];
+   } transfer;
+
    struct
    {
       VkPipeline alpha_blend;
@@ -285,6 +304,20 @@ typedef struct vk
       math_matrix_4x4 mvp;
       VkRect2D scissor;    /* int32_t alignment */
    } tracker;
+#ifdef HAVE_THREADS
+   /* A preset loading in the background while the current
+    * chain keeps rendering; vulkan_frame() swaps it in */
+   struct
+   {
+      sthread_t *thread;
+      slock_t *lock;
+      vulkan_filter_chain_preset_t *preset;
+      char path[PATH_MAX_LENGTH];
+      /* Asked for while another was loading */
+      char next_path[PATH_MAX_LENGTH];
+      bool done;
+   } shader_load;
+#endif
    uint32_t flags;
 } vk_t;
 
@@ -1092,6 +1125,96 @@ static struct vk_texture vulkan_create_texture(vk_t *vk,
 /* Dynamic texture type should be set to : VULKAN_TEXTURE_DYNAMIC
  * Staging texture type should be set to : VULKAN_TEXTURE_STAGING
  */
+/* Leaves dynamic in TRANSFER_DST_OPTIMAL, for the caller to move on. */
+static void vulkan_record_staging_copy(VkCommandBuffer cmd,
+      struct vk_texture *dynamic, struct vk_texture *staging)
+{
+   VkBufferImageCopy region;
+
+   VULKAN_IMAGE_LAYOUT_TRANSITION(
+         cmd,
+         dynamic->image,
+         VK_IMAGE_LAYOUT_UNDEFINED,
+         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+         0,
+         VK_ACCESS_TRANSFER_WRITE_BIT,
+         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+         VK_PIPELINE_STAGE_TRANSFER_BIT);
+   region.bufferOffset                    = 0;
+   region.bufferRowLength                 = 0;
+   region.bufferImageHeight               = 0;
+   region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+   region.imageSubresource.mipLevel       = 0;
+   region.imageSubresource.baseArrayLayer = 0;
+   region.imageSubresource.layerCount     = 1;
+   region.imageOffset.x                   = 0;
+   region.imageOffset.y                   = 0;
+   region.imageOffset.z                   = 0;
+   region.imageExtent.width               = dynamic->width;
+   region.imageExtent.height              = dynamic->height;
+   region.imageExtent.depth               = 1;
+   vkCmdCopyBufferToImage(
+         cmd,
+         staging->buffer,
+         dynamic->image,
+         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+         1,
+         &region);
+}
+
+/* Records the copy of a core frame on the transfer queue and hands
+ * the texture over to the graphics queue. The copy is submitted
+ * together with the frame, which waits on it before its fragment
+ * shaders run, so the DMA engine does the copy instead of the
+ * graphics queue. */
+static void vulkan_transfer_staging_to_dynamic(vk_t *vk, unsigned index,
+      struct vk_texture *dynamic, struct vk_texture *staging)
+{
+   VkCommandBufferBeginInfo begin_info;
+   VkCommandBuffer cmd         = vk->transfer.cmd[index];
+   uint32_t transfer_family    = vk->context->transfer_queue_index;
+   uint32_t graphics_family    = vk->context->graphics_queue_index;
+
+   begin_info.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+   begin_info.pNext            = NULL;
+   begin_info.flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+   begin_info.pInheritanceInfo = NULL;
+
+   vkResetCommandBuffer(cmd, 0);
+   vkBeginCommandBuffer(cmd, &begin_info);
+   vulkan_record_staging_copy(cmd, dynamic, staging);
+   /* Release; the old contents are never kept, so the next copy
+    * needs no acquire on this side. */
+   VULKAN_IMAGE_LAYOUT_TRANSITION_LEVELS(
+         cmd,
+         dynamic->image,
+         VK_REMAINING_MIP_LEVELS,
+         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+         VK_ACCESS_TRANSFER_WRITE_BIT,
+         0,
+         VK_PIPELINE_STAGE_TRANSFER_BIT,
+         VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+         transfer_family, graphics_family);
+   vkEndCommandBuffer(cmd);
+
+   /* Acquire, after the semaphore wait of the frame's submit. */
+   VULKAN_IMAGE_LAYOUT_TRANSITION_LEVELS(
+         vk->cmd,
+         dynamic->image,
+         VK_REMAINING_MIP_LEVELS,
+         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+         0,
+         VK_ACCESS_SHADER_READ_BIT,
+         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+         transfer_family, graphics_family);
+
+   dynamic->layout             = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+   vk->transfer.pending[index] = true;
+}
+
 static void vulkan_copy_staging_to_dynamic(vk_t *vk, VkCommandBuffer cmd,
       struct vk_texture *dynamic, struct vk_texture *staging)
 {
@@ -1180,37 +1303,7 @@ static void vulkan_copy_staging_to_dynamic(vk_t *vk, VkCommandBuffer cmd,
    }
    else
    {
-      VkBufferImageCopy region;
-
-      VULKAN_IMAGE_LAYOUT_TRANSITION(
-            cmd,
-            dynamic->image,
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            0,
-            VK_ACCESS_TRANSFER_WRITE_BIT,
-            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-            VK_PIPELINE_STAGE_TRANSFER_BIT);
-      region.bufferOffset                    = 0;
-      region.bufferRowLength                 = 0;
-      region.bufferImageHeight               = 0;
-      region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-      region.imageSubresource.mipLevel       = 0;
-      region.imageSubresource.baseArrayLayer = 0;
-      region.imageSubresource.layerCount     = 1;
-      region.imageOffset.x                   = 0;
-      region.imageOffset.y                   = 0;
-      region.imageOffset.z                   = 0;
-      region.imageExtent.width               = dynamic->width;
-      region.imageExtent.height              = dynamic->height;
-      region.imageExtent.depth               = 1;
-      vkCmdCopyBufferToImage(
-            cmd,
-            staging->buffer,
-            dynamic->image,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            1,
-            &region);
+      vulkan_record_staging_copy(cmd, dynamic, staging);
       VULKAN_IMAGE_LAYOUT_TRANSITION(
             cmd,
             dynamic->image,
@@ -3119,33 +3212,50 @@ static bool vulkan_init_default_filter_chain(vk_t *vk)
    return true;
 }
 
-static bool vulkan_init_filter_chain_preset(vk_t *vk, const char *shader_path)
+static void vulkan_get_filter_chain_create_info(vk_t *vk,
+      struct vulkan_filter_chain_create_info *info)
+{
+   info->device                = vk->context->device;
+   info->gpu                   = vk->context->gpu;
+   info->memory_properties     = &vk->context->memory_properties;
+   info->pipeline_cache        = vk->pipelines.cache;
+   info->queue                 = vk->context->queue;
+   info->command_pool          = vk->swapchain[vk->context->current_frame_index].cmd_pool;
+   info->num_passes            = 0;
+   info->original_format       = VK_REMAP_TO_TEXFMT(vk->tex_fmt);
+   info->max_input_size.width  = vk->tex_w;
+   info->max_input_size.height = vk->tex_h;
+   info->swapchain.vp          = vk->vk_vp;
+   info->swapchain.format      = vk->context->swapchain_format;
+   info->swapchain.render_pass = vk->render_pass;
+   info->swapchain.num_indices = vk->context->num_swapchain_images;
+}
+
+/* Builds the chain from @preset if there is one, else loads
+ * @shader_path first */
+static bool vulkan_init_filter_chain_preset(vk_t *vk, const char *shader_path,
+      vulkan_filter_chain_preset_t *preset)
 {
    struct vulkan_filter_chain_create_info info;
+   enum glslang_filter_chain_filter filter;
 
    if (!vk->context)
+   {
+      vulkan_filter_chain_preset_free(preset);
       return false;
+   }
 
-   info.device                = vk->context->device;
-   info.gpu                   = vk->context->gpu;
-   info.memory_properties     = &vk->context->memory_properties;
-   info.pipeline_cache        = vk->pipelines.cache;
-   info.queue                 = vk->context->queue;
-   info.command_pool          = vk->swapchain[vk->context->current_frame_index].cmd_pool;
-   info.num_passes            = 0;
-   info.original_format       = VK_REMAP_TO_TEXFMT(vk->tex_fmt);
-   info.max_input_size.width  = vk->tex_w;
-   info.max_input_size.height = vk->tex_h;
-   info.swapchain.vp          = vk->vk_vp;
-   info.swapchain.format      = vk->context->swapchain_format;
-   info.swapchain.render_pass = vk->render_pass;
-   info.swapchain.num_indices = vk->context->num_swapchain_images;
+   vulkan_get_filter_chain_create_info(vk, &info);
+   filter                     = vk->video.smooth
+      ? GLSLANG_FILTER_CHAIN_LINEAR
+      : GLSLANG_FILTER_CHAIN_NEAREST;
 
-   vk->filter_chain           = vulkan_filter_chain_create_from_preset(
-         &info, shader_path,
-         vk->video.smooth
-         ? GLSLANG_FILTER_CHAIN_LINEAR
-         : GLSLANG_FILTER_CHAIN_NEAREST);
+   if (preset)
+      vk->filter_chain        = vulkan_filter_chain_create_from_loaded_preset(
+            &info, preset, filter);
+   else
+      vk->filter_chain        = vulkan_filter_chain_create_from_preset(
+            &info, shader_path, filter);
 
    if (!vk->filter_chain)
    {
@@ -3210,28 +3320,119 @@ static bool vulkan_init_filter_chain(vk_t *vk)
       return vulkan_init_default_filter_chain(vk);
    }
 
-   if (!shader_path || !vulkan_init_filter_chain_preset(vk, shader_path))
+   if (!shader_path || !vulkan_init_filter_chain_preset(vk, shader_path, NULL))
       vulkan_init_default_filter_chain(vk);
 
    return true;
 }
 
+static bool vulkan_get_pipeline_cache_path(char *s, size_t len)
+{
+   char dir[PATH_MAX_LENGTH];
+   settings_t *settings = config_get_ptr();
+
+   if (     !settings->bools.video_shader_cache_enable
+         || string_is_empty(settings->paths.directory_cache))
+      return false;
+
+   fill_pathname_join_special(dir, settings->paths.directory_cache,
+         FILE_PATH_SHADER_CACHE_DIR, sizeof(dir));
+   fill_pathname_join_special(s, dir, "vulkan_pipeline.bin", len);
+   return true;
+}
+
+/* The driver rejects data of another device or driver version in
+ * principle, but not all of them do it gracefully, so the header
+ * (VkPipelineCacheHeaderVersionOne) is checked here first */
+static bool vulkan_pipeline_cache_is_valid(vk_t *vk,
+      const uint8_t *data, int64_t len)
+{
+   uint32_t header[4];
+   const VkPhysicalDeviceProperties *props = &vk->context->gpu_properties;
+
+   if (len < (int64_t)(sizeof(header) + VK_UUID_SIZE))
+      return false;
+
+   memcpy(header, data, sizeof(header));
+   return    header[0] >= sizeof(header) + VK_UUID_SIZE
+          && header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+          && header[2] == props->vendorID
+          && header[3] == props->deviceID
+          && !memcmp(data + sizeof(header), props->pipelineCacheUUID,
+                VK_UUID_SIZE);
+}
+
+static void vulkan_save_pipeline_cache(vk_t *vk)
+{
+   char path[PATH_MAX_LENGTH];
+   char dir[PATH_MAX_LENGTH];
+   size_t len = 0;
+   void *data = NULL;
+
+   if (     !vulkan_get_pipeline_cache_path(path, sizeof(path))
+         || vkGetPipelineCacheData(vk->context->device,
+               vk->pipelines.cache, &len, NULL) != VK_SUCCESS
+         || !len
+         || !(data = malloc(len)))
+      return;
+
+   if (vkGetPipelineCacheData(vk->context->device,
+            vk->pipelines.cache, &len, data) == VK_SUCCESS)
+   {
+      fill_pathname_basedir(dir, path, sizeof(dir));
+      if (!path_is_directory(dir))
+         path_mkdir(dir);
+      if (!filestream_write_file(path, data, (int64_t)len))
+         RARCH_WARN("[Vulkan] Failed to write pipeline cache: \"%s\".\n",
+               path);
+   }
+
+   free(data);
+}
+
 static void vulkan_init_static_resources(vk_t *vk)
 {
    int i;
+   char cache_path[PATH_MAX_LENGTH];
    uint32_t blank[4 * 4];
    VkCommandPoolCreateInfo pool_info;
    VkPipelineCacheCreateInfo cache;
+   void *cache_data           = NULL;
+   int64_t cache_len          = 0;
 
-   /* Create the pipeline cache. */
+   /* Create the pipeline cache, from the one saved last time
+    * if it was made by this device and driver */
    cache.sType                = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
    cache.pNext                = NULL;
    cache.flags                = 0;
    cache.initialDataSize      = 0;
    cache.pInitialData         = NULL;
 
-   vkCreatePipelineCache(vk->context->device,
-         &cache, NULL, &vk->pipelines.cache);
+   if (     vulkan_get_pipeline_cache_path(cache_path, sizeof(cache_path))
+         && path_is_valid(cache_path)
+         && filestream_read_file(cache_path, &cache_data, &cache_len))
+   {
+      if (vulkan_pipeline_cache_is_valid(vk,
+               (const uint8_t*)cache_data, cache_len))
+      {
+         cache.initialDataSize = (size_t)cache_len;
+         cache.pInitialData    = cache_data;
+      }
+      else
+         RARCH_LOG("[Vulkan] Ignoring stale pipeline cache.\n");
+   }
+
+   if (vkCreatePipelineCache(vk->context->device,
+            &cache, NULL, &vk->pipelines.cache) != VK_SUCCESS
+         && cache.pInitialData)
+   {
+      cache.initialDataSize   = 0;
+      cache.pInitialData      = NULL;
+      vkCreatePipelineCache(vk->context->device,
+            &cache, NULL, &vk->pipelines.cache);
+   }
+
+   free(cache_data);
 
    pool_info.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
    pool_info.pNext            = NULL;
@@ -3241,6 +3442,34 @@ static void vulkan_init_static_resources(vk_t *vk)
    vkCreateCommandPool(vk->context->device,
          &pool_info, NULL, &vk->staging_pool);
 
+   if (vk->context->transfer_queue != VK_NULL_HANDLE)
+   {
+      VkCommandBufferAllocateInfo info;
+      VkSemaphoreCreateInfo sem_info;
+
+      pool_info.queueFamilyIndex = vk->context->transfer_queue_index;
+      vkCreateCommandPool(vk->context->device,
+            &pool_info, NULL, &vk->transfer.pool);
+
+      info.sType                 = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+      info.pNext                 = NULL;
+      info.commandPool           = vk->transfer.pool;
+      info.level                 = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+      info.commandBufferCount    = VULKAN_MAX_SWAPCHAIN_IMAGES;
+      vkAllocateCommandBuffers(vk->context->device,
+            &info, vk->transfer.cmd);
+
+      sem_info.sType             = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+      sem_info.pNext             = NULL;
+      sem_info.flags             = 0;
+      for (i = 0; i < VULKAN_MAX_SWAPCHAIN_IMAGES; i++)
+      {
+         vkCreateSemaphore(vk->context->device, &sem_info,
+               NULL, &vk->transfer.semaphore[i]);
+         vk->transfer.pending[i] = false;
+      }
+   }
+
    for (i = 0; i < 4 * 4; i++)
       blank[i] = -1u;
 
@@ -3252,6 +3481,7 @@ static void vulkan_init_static_resources(vk_t *vk)
 static void vulkan_deinit_static_resources(vk_t *vk)
 {
    int i;
+   vulkan_save_pipeline_cache(vk);
    vkDestroyPipelineCache(vk->context->device,
          vk->pipelines.cache, NULL);
    vulkan_destroy_texture(
@@ -3260,6 +3490,15 @@ static void vulkan_deinit_static_resources(vk_t *vk)
 
    vkDestroyCommandPool(vk->context->device,
          vk->staging_pool, NULL);
+   if (vk->transfer.pool != VK_NULL_HANDLE)
+   {
+      for (i = 0; i < VULKAN_MAX_SWAPCHAIN_IMAGES; i++)
+         vkDestroySemaphore(vk->context->device,
+               vk->transfer.semaphore[i], NULL);
+      vkDestroyCommandPool(vk->context->device,
+            vk->transfer.pool, NULL);
+      vk->transfer.pool = VK_NULL_HANDLE;
+   }
    free(vk->hw.cmd);
    free(vk->hw.wait_dst_stages);
    free(vk->hw.semaphores);
@@ -3296,12 +3535,120 @@ static void vulkan_destroy_hdr_buffer(VkDevice device, struct vk_image *img)
 }
 #endif
 
+#ifdef HAVE_THREADS
+static void vulkan_shader_load_thread(void *data)
+{
+   vk_t *vk                             = (vk_t*)data;
+   vulkan_filter_chain_preset_t *preset =
+      vulkan_filter_chain_preset_load(vk->shader_load.path);
+
+   slock_lock(vk->shader_load.lock);
+   vk->shader_load.preset               = preset;
+   vk->shader_load.done                 = true;
+   slock_unlock(vk->shader_load.lock);
+}
+
+static bool vulkan_shader_load_start(vk_t *vk, const char *path)
+{
+   if (path != vk->shader_load.path)
+      strlcpy(vk->shader_load.path, path, sizeof(vk->shader_load.path));
+   vk->shader_load.preset = NULL;
+   vk->shader_load.done   = false;
+
+   if (     !vk->shader_load.lock
+         && !(vk->shader_load.lock = slock_new()))
+      return false;
+   return (vk->shader_load.thread = sthread_create(
+            vulkan_shader_load_thread, vk)) != NULL;
+}
+
+/* Waits for the load in flight and hands over what it loaded */
+static vulkan_filter_chain_preset_t *vulkan_shader_load_join(vk_t *vk)
+{
+   sthread_join(vk->shader_load.thread);
+   vk->shader_load.thread = NULL;
+   return vk->shader_load.preset;
+}
+
+static void vulkan_shader_load_cancel(vk_t *vk)
+{
+   if (vk->shader_load.thread)
+      vulkan_filter_chain_preset_free(vulkan_shader_load_join(vk));
+   vk->shader_load.next_path[0] = '\0';
+}
+
+/* Swaps in a preset that finished loading. Called at the start
+ * of a frame, so the old chain is done with the one before. */
+static void vulkan_shader_load_poll(vk_t *vk)
+{
+   bool done;
+   vulkan_filter_chain_preset_t *preset;
+   vulkan_filter_chain_t *old_chain;
+
+   if (!vk->shader_load.thread)
+      return;
+
+   slock_lock(vk->shader_load.lock);
+   done = vk->shader_load.done;
+   slock_unlock(vk->shader_load.lock);
+   if (!done)
+      return;
+
+   preset = vulkan_shader_load_join(vk);
+
+   /* Superseded while it loaded */
+   if (*vk->shader_load.next_path)
+   {
+      vulkan_filter_chain_preset_free(preset);
+      strlcpy(vk->shader_load.path, vk->shader_load.next_path,
+            sizeof(vk->shader_load.path));
+      vk->shader_load.next_path[0] = '\0';
+      if (vulkan_shader_load_start(vk, vk->shader_load.path))
+         return;
+      preset = vulkan_filter_chain_preset_load(vk->shader_load.path);
+   }
+
+   old_chain        = vk->filter_chain;
+   vk->filter_chain = NULL;
+
+   if (!preset)
+      RARCH_ERR("[Vulkan] Failed to load preset: \"%s\".\n",
+            vk->shader_load.path);
+
+   if (     preset
+         && vulkan_init_filter_chain_preset(vk,
+            vk->shader_load.path, preset))
+   {
+      if (old_chain)
+         vulkan_filter_chain_inherit_history(vk->filter_chain, old_chain);
+   }
+   else
+   {
+      RARCH_ERR("[Vulkan] Failed to create filter chain: \"%s\". Falling back to stock.\n",
+            vk->shader_load.path);
+      vulkan_init_default_filter_chain(vk);
+   }
+
+   if (old_chain)
+      vulkan_filter_chain_free(old_chain);
+}
+#endif
+
 static void vulkan_free(void *data)
 {
    vk_t *vk = (vk_t*)data;
    if (!vk)
       return;
 
+   video_state_get_ptr()->frame_upload_queue = NULL;
+   video_state_get_ptr()->shader_passes      = 0;
+
+#ifdef HAVE_THREADS
+   vulkan_shader_load_cancel(vk);
+   if (vk->shader_load.lock)
+      slock_free(vk->shader_load.lock);
+#endif
+
    if (vk->context && vk->context->device)
    {
 #ifdef HAVE_THREADS
@@ -3952,6 +4299,28 @@ static bool vulkan_set_shader(void *data,
    if (!vk)
       return false;
 
+#ifdef HAVE_THREADS
+   /* Load the preset in the background while the current chain,
+    * preset or stock, keeps rendering. Not while watching shader
+    * files: loading re-registers the watch, which the main thread
+    * polls. */
+   if (     !string_is_empty(path)
+         && type == RARCH_SHADER_SLANG
+         && !config_get_ptr()->bools.video_shader_watch_files)
+   {
+      if (vk->shader_load.thread)
+      {
+         strlcpy(vk->shader_load.next_path, path,
+               sizeof(vk->shader_load.next_path));
+         return true;
+      }
+      if (vulkan_shader_load_start(vk, path))
+         return true;
+   }
+
+   vulkan_shader_load_cancel(vk);
+#endif
+
    if (vk->filter_chain)
       vulkan_filter_chain_free((vulkan_filter_chain_t*)vk->filter_chain);
    vk->filter_chain = NULL;
@@ -3968,7 +4337,7 @@ static bool vulkan_set_shader(void *data,
       return true;
    }
 
-   if (!vulkan_init_filter_chain_preset(vk, path))
+   if (!vulkan_init_filter_chain_preset(vk, path, NULL))
    {
       RARCH_ERR("[Vulkan] Failed to create filter chain: \"%s\". Falling back to stock.\n", path);
       vulkan_init_default_filter_chain(vk);
@@ -4126,11 +4495,17 @@ static void vulkan_readback(vk_t *vk, struct vk_image *readback_image)
    region.imageExtent.depth               = 1;
 
    staging  = &vk->readback.staging[vk->context->current_frame_index];
-   *staging = vulkan_create_texture(vk,
-         staging->memory != VK_NULL_HANDLE ? staging : NULL,
-         vk->vp.width, vk->vp.height,
-         VK_FORMAT_B8G8R8A8_UNORM, /* Formats don't matter for readback since it's a raw copy. */
-         NULL, NULL, VULKAN_TEXTURE_READBACK);
+
+   /* Keep the buffer, and its mapping, for as long as the
+    * viewport size holds. */
+   if (     (staging->memory == VK_NULL_HANDLE)
+         || (staging->width  != vk->vp.width)
+         || (staging->height != vk->vp.height))
+      *staging = vulkan_create_texture(vk,
+            staging->memory != VK_NULL_HANDLE ? staging : NULL,
+            vk->vp.width, vk->vp.height,
+            VK_FORMAT_B8G8R8A8_UNORM, /* Formats don't matter for readback since it's a raw copy. */
+            NULL, NULL, VULKAN_TEXTURE_READBACK);
 
    vkCmdCopyImageToBuffer(vk->cmd, readback_image->image,
          VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
@@ -4555,6 +4930,28 @@ static void vulkan_run_hdr_pipeline(VkPipeline pipeline, VkRenderPass render_pas
    vkCmdEndRenderPass(vk->cmd);
 }
 
+/* Hard GPU Sync: waits for the frame 'hard_sync_frames' before
+ * the one just submitted, so the CPU gets at most that many frames
+ * ahead of the GPU. Core and filter chain work of that many frames
+ * still overlaps. Without it, the limit is the number of swapchain
+ * images. */
+static void vulkan_fence_iterate(vk_t *vk, unsigned frame_index,
+      unsigned hard_sync_frames)
+{
+   unsigned index;
+   unsigned num_images = vk->context->num_swapchain_images;
+
+   if (hard_sync_frames >= num_images)
+      return;
+
+   index = (frame_index + num_images - hard_sync_frames) % num_images;
+
+   if (     vk->context->swapchain_fences[index] != VK_NULL_HANDLE
+         && vk->context->swapchain_fences_signalled[index])
+      vkWaitForFences(vk->context->device, 1,
+            &vk->context->swapchain_fences[index], true, UINT64_MAX);
+}
+
 static bool vulkan_frame(void *data, const void *frame,
       unsigned frame_width, unsigned frame_height,
       uint64_t frame_count,
@@ -4566,6 +4963,8 @@ static bool vulkan_frame(void *data, const void *frame,
    VkRenderPassBeginInfo rp_info;
    VkCommandBufferBeginInfo begin_info;
    VkSemaphore signal_semaphores[2];
+   VkSemaphore wait_semaphores[2];
+   VkPipelineStageFlags wait_stages[2];
    vk_t *vk                                      = (vk_t*)data;
    vulkan_filter_chain_t *filter_chain           = NULL;
    bool waits_for_semaphores                     = false;
@@ -4579,6 +4978,8 @@ static bool vulkan_frame(void *data, const void *frame,
    bool input_driver_nonblock_state              = video_info->input_driver_nonblock_state;
    bool runloop_is_slowmotion                    = video_info->runloop_is_slowmotion;
    bool runloop_is_paused                        = video_info->runloop_is_paused;
+   bool hard_sync                                = video_info->hard_sync;
+   unsigned hard_sync_frames                     = video_info->hard_sync_frames;
    unsigned video_width                          = video_info->width;
    unsigned video_height                         = video_info->height;
    struct font_params *osd_params                = (struct font_params*)
@@ -4595,6 +4996,11 @@ static bool vulkan_frame(void *data, const void *frame,
       vk->context->current_swapchain_index;
    bool overlay_behind_menu                      = video_info->overlay_behind_menu;
    bool use_main_buffer                          = true;
+   bool frame_changed;
+
+#ifdef HAVE_THREADS
+   vulkan_shader_load_poll(vk);
+#endif
 
    /* Fast toggle shader filter chain logic */
    filter_chain = vk->filter_chain;
@@ -4680,6 +5086,12 @@ static bool vulkan_frame(void *data, const void *frame,
             vk->hw.src_queue_family, vk->context->graphics_queue_index);
    }
 
+   vk->transfer.pending[frame_index] = false;
+
+   /* A dupe leaves the input as it was. A hardware frame is
+    * taken to be new. */
+   frame_changed = (frame != NULL);
+
    /* Upload texture */
    if (frame && (!(vk->flags & VK_FLAG_HW_ENABLE)))
    {
@@ -4687,6 +5099,8 @@ static bool vulkan_frame(void *data, const void *frame,
       uint8_t *dst        = NULL;
       const uint8_t *src  = (const uint8_t*)frame;
       unsigned bpp        = vk->video.rgb32 ? 4 : 2;
+      retro_time_t start  = cpu_features_get_time_usec();
+      video_driver_state_t *video_st = video_state_get_ptr();
 
       if (     chain->texture.width  != frame_width
             || chain->texture.height != frame_height)
@@ -4710,6 +5124,22 @@ static bool vulkan_frame(void *data, const void *frame,
                   NULL, NULL, VULKAN_TEXTURE_DYNAMIC);
       }
 
+      /* Hashed only when some pass could be spared for it, and
+       * not out of the mapped texture, which may be uncached */
+      if (     frame != chain->texture.mapped
+            && vulkan_filter_chain_get_num_static_passes(
+               (vulkan_filter_chain_t*)filter_chain))
+      {
+         uint64_t hash = frame_width | ((uint64_t)frame_height << 32);
+         for (y = 0; y < frame_height; y++)
+            hash = XXH3_64bits_withSeed(src + (ptrdiff_t)y * pitch,
+                  frame_width * bpp, hash);
+         frame_changed  = (hash != vk->frame_hash);
+         vk->frame_hash = hash;
+      }
+      else
+         vk->frame_hash = 0;
+
       if (frame != chain->texture.mapped)
       {
          dst = (uint8_t*)chain->texture.mapped;
@@ -4729,8 +5159,23 @@ static bool vulkan_frame(void *data, const void *frame,
       {
          struct vk_texture *dynamic = &chain->texture_optimal;
          struct vk_texture *staging = &chain->texture;
-         vulkan_copy_staging_to_dynamic(vk, vk->cmd, dynamic, staging);
+         /* The RGB565 remap is a compute pass, graphics queue only */
+         if (     (vk->transfer.pool != VK_NULL_HANDLE)
+               && (dynamic->format == staging->format))
+         {
+            vulkan_transfer_staging_to_dynamic(vk, frame_index,
+                  dynamic, staging);
+            video_st->frame_upload_queue = "Transfer";
+         }
+         else
+         {
+            vulkan_copy_staging_to_dynamic(vk, vk->cmd, dynamic, staging);
+            video_st->frame_upload_queue = "Graphics";
+         }
       }
+      else
+         video_st->frame_upload_queue    = "None (streamed)";
+      video_st->frame_upload_time        = cpu_features_get_time_usec() - start;
 
       vk->last_valid_index = frame_index;
    }
@@ -4874,9 +5319,20 @@ static bool vulkan_frame(void *data, const void *frame,
 
    vulkan_set_viewport(vk, width, height, false, true);
 
+   vulkan_filter_chain_set_input_changed(
+         (vulkan_filter_chain_t*)filter_chain, frame_changed);
    vulkan_filter_chain_build_offscreen_passes(
          (vulkan_filter_chain_t*)filter_chain,
          vk->cmd, &vk->vk_vp);
+   {
+      video_driver_state_t *video_st = video_state_get_ptr();
+      struct video_shader *preset    = vulkan_filter_chain_get_preset(
+            (vulkan_filter_chain_t*)filter_chain);
+      video_st->shader_passes        = (preset && preset->passes > 1)
+         ? preset->passes - 1 : 0;
+      video_st->shader_passes_reused = vulkan_filter_chain_get_num_reused_passes(
+            (vulkan_filter_chain_t*)filter_chain);
+   }
 
 #if defined(HAVE_MENU)
    /* Upload menu texture. */
@@ -5162,25 +5618,29 @@ static bool vulkan_frame(void *data, const void *frame,
          submit_info.waitSemaphoreCount++;
       }
    }
-   else if ((vk->context->flags & VK_CTX_FLAG_HAS_ACQUIRED_SWAPCHAIN)
-         && (vk->context->swapchain_acquire_semaphore != VK_NULL_HANDLE))
-   {
-      static const VkPipelineStageFlags wait_stage        =
-         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-
-      vk->context->swapchain_wait_semaphores[frame_index] =
-         vk->context->swapchain_acquire_semaphore;
-      vk->context->swapchain_acquire_semaphore            = VK_NULL_HANDLE;
-
-      submit_info.waitSemaphoreCount = 1;
-      submit_info.pWaitSemaphores    = &vk->context->swapchain_wait_semaphores[frame_index];
-      submit_info.pWaitDstStageMask  = &wait_stage;
-   }
    else
    {
       submit_info.waitSemaphoreCount = 0;
-      submit_info.pWaitSemaphores    = NULL;
-      submit_info.pWaitDstStageMask  = NULL;
+
+      if (     (vk->context->flags & VK_CTX_FLAG_HAS_ACQUIRED_SWAPCHAIN)
+            && (vk->context->swapchain_acquire_semaphore != VK_NULL_HANDLE))
+      {
+         vk->context->swapchain_wait_semaphores[frame_index] =
+            vk->context->swapchain_acquire_semaphore;
+         vk->context->swapchain_acquire_semaphore            = VK_NULL_HANDLE;
+
+         wait_semaphores[submit_info.waitSemaphoreCount]     = vk->context->swapchain_wait_semaphores[frame_index];
+         wait_stages[submit_info.waitSemaphoreCount++]       = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+      }
+
+      if (vk->transfer.pending[frame_index])
+      {
+         wait_semaphores[submit_info.waitSemaphoreCount]     = vk->transfer.semaphore[frame_index];
+         wait_stages[submit_info.waitSemaphoreCount++]       = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+      }
+
+      submit_info.pWaitSemaphores    = submit_info.waitSemaphoreCount ? wait_semaphores : NULL;
+      submit_info.pWaitDstStageMask  = submit_info.waitSemaphoreCount ? wait_stages     : NULL;
    }
 
    submit_info.signalSemaphoreCount  = 0;
@@ -5197,6 +5657,24 @@ static bool vulkan_frame(void *data, const void *frame,
    }
    submit_info.pSignalSemaphores = submit_info.signalSemaphoreCount ? signal_semaphores : NULL;
 
+   /* The copy goes first, so the frame has something to wait on */
+   if (vk->transfer.pending[frame_index])
+   {
+      VkSubmitInfo transfer_info;
+      transfer_info.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+      transfer_info.pNext                = NULL;
+      transfer_info.waitSemaphoreCount   = 0;
+      transfer_info.pWaitSemaphores      = NULL;
+      transfer_info.pWaitDstStageMask    = NULL;
+      transfer_info.commandBufferCount   = 1;
+      transfer_info.pCommandBuffers      = &vk->transfer.cmd[frame_index];
+      transfer_info.signalSemaphoreCount = 1;
+      transfer_info.pSignalSemaphores    = &vk->transfer.semaphore[frame_index];
+      vkQueueSubmit(vk->context->transfer_queue, 1,
+            &transfer_info, VK_NULL_HANDLE);
+      vk->transfer.pending[frame_index]  = false;
+   }
+
 #ifdef HAVE_THREADS
    slock_lock(vk->context->queue_lock);
 #endif
@@ -5210,6 +5688,10 @@ static bool vulkan_frame(void *data, const void *frame,
    if (vk->ctx_driver->swap_buffers)
       vk->ctx_driver->swap_buffers(vk->ctx_data);
 
+   if (    hard_sync
+       && !input_driver_nonblock_state)
+      vulkan_fence_iterate(vk, frame_index, hard_sync_frames);
+
    if (!(vk->context->flags & VK_CTX_FLAG_SWAP_INTERVAL_EMULATION_LOCK))
    {
       if (vk->ctx_driver->update_window_title)
@@ -5682,6 +6164,7 @@ static uint32_t vulkan_get_flags(void *data)
    uint32_t flags = 0;
 
    BIT32_SET(flags, GFX_CTX_FLAGS_CUSTOMIZABLE_SWAPCHAIN_IMAGES);
+   BIT32_SET(flags, GFX_CTX_FLAGS_HARD_SYNC);
    BIT32_SET(flags, GFX_CTX_FLAGS_BLACK_FRAME_INSERTION);
    BIT32_SET(flags, GFX_CTX_FLAGS_MENU_FRAME_FILTERING);
    BIT32_SET(flags, GFX_CTX_FLAGS_SCREENSHOTS_SUPPORTED);
@@ -5821,8 +6304,13 @@ static bool vulkan_read_viewport(void *data, uint8_t *buffer, bool is_idle)
             return false;
 
          buffer += 3 * (vk->vp.height - 1) * vk->vp.width;
-         vkMapMemory(vk->context->device, staging->memory,
-               staging->offset, staging->size, 0, (void**)&src);
+
+         /* Mapped once and left mapped, like the synchronous path */
+         if (!staging->mapped)
+         {
+            VK_MAP_PERSISTENT_TEXTURE(vk->context->device, staging);
+         }
+         src = (const uint8_t*)staging->mapped;
 
          if (     (staging->flags & VK_TEX_FLAG_NEED_MANUAL_CACHE_MANAGEMENT)
                && (staging->memory != VK_NULL_HANDLE))
@@ -5831,8 +6319,6 @@ static bool vulkan_read_viewport(void *data, uint8_t *buffer, bool is_idle)
          ctx->in_stride  =  (int)staging->stride;
          ctx->out_stride = -(int)vk->vp.width * 3;
          scaler_ctx_scale_direct(ctx, buffer, src);
-
-         vkUnmapMemory(vk->context->device, staging->memory);
       }
    }
    else
@@ -29,12 +29,15 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <sys/mman.h>
 
 #include <libdrm/drm.h>
+#include <libdrm/drm_fourcc.h>
 #include <gbm.h>
 
 #include <lists/dir_list.h>
 #include <string/stdstring.h>
+#include <retro_miscellaneous.h>
 
 #ifdef HAVE_CONFIG_H
 #include "../../config.h"
@@ -63,11 +66,87 @@
 #define EGL_PLATFORM_GBM_KHR 0x31D7
 #endif
 
+/* One being written, one queued and one on screen */
+#define DRM_SCANOUT_BUFFERS 3
+
+enum drm_scanout_prop
+{
+   DRM_SCANOUT_PROP_FB_ID = 0,
+   DRM_SCANOUT_PROP_CRTC_ID,
+   DRM_SCANOUT_PROP_SRC_X,
+   DRM_SCANOUT_PROP_SRC_Y,
+   DRM_SCANOUT_PROP_SRC_W,
+   DRM_SCANOUT_PROP_SRC_H,
+   DRM_SCANOUT_PROP_CRTC_X,
+   DRM_SCANOUT_PROP_CRTC_Y,
+   DRM_SCANOUT_PROP_CRTC_W,
+   DRM_SCANOUT_PROP_CRTC_H,
+   /* Optional, only newer kernels have it */
+   DRM_SCANOUT_PROP_SCALING_FILTER,
+   DRM_SCANOUT_PROP_LAST
+};
+
+static const char *drm_scanout_prop_names[DRM_SCANOUT_PROP_LAST] = {
+   "FB_ID",
+   "CRTC_ID",
+   "SRC_X",
+   "SRC_Y",
+   "SRC_W",
+   "SRC_H",
+   "CRTC_X",
+   "CRTC_Y",
+   "CRTC_W",
+   "CRTC_H",
+   "SCALING_FILTER"
+};
+
+typedef struct drm_scanout_fb
+{
+   uint8_t *map;
+   size_t size;
+   uint32_t handle;
+   uint32_t fb_id;
+   unsigned pitch;
+} drm_scanout_fb_t;
+
+/* Software frames shown on an overlay plane by atomic commits,
+ * with the primary plane held on a black buffer underneath */
+typedef struct drm_scanout
+{
+   drm_scanout_fb_t fbs[DRM_SCANOUT_BUFFERS];
+   drm_scanout_fb_t black;
+   uint32_t props[DRM_SCANOUT_PROP_LAST];
+   uint32_t plane_id;
+   uint32_t primary_id;
+   uint32_t primary_fb_prop;
+   uint32_t format;
+   unsigned width;
+   unsigned height;
+   unsigned black_width;
+   unsigned black_height;
+   /* Buffer last committed, and where it went */
+   unsigned index;
+   int x;
+   int y;
+   unsigned out_width;
+   unsigned out_height;
+   bool smooth;
+   /* Plane setup done, or given up on */
+   bool inited;
+   bool unsupported;
+   /* Frame on the plane; geometry passed a TEST_ONLY commit */
+   bool active;
+   bool tested;
+   bool rgb565;
+   bool waiting_for_flip;
+} drm_scanout_t;
+
 typedef struct gfx_ctx_drm_data
 {
 #ifdef HAVE_EGL
    egl_ctx_data_t egl;
 #endif
+   drm_scanout_t scanout;
    struct gbm_bo *bo;
    struct gbm_bo *next_bo;
    struct gbm_surface *gbm_surface;
@@ -603,6 +682,426 @@ static void gfx_ctx_drm_swap_buffers(void *data)
    gfx_ctx_drm_wait_flip(drm, true);
 }
 
+static void drm_scanout_fb_free(drm_scanout_fb_t *fb)
+{
+   struct drm_mode_destroy_dumb destroy_dumb = {0};
+
+   if (fb->map)
+      munmap(fb->map, fb->size);
+   if (fb->fb_id)
+      drmModeRmFB(g_drm_fd, fb->fb_id);
+   if (fb->handle)
+   {
+      destroy_dumb.handle = fb->handle;
+      drmIoctl(g_drm_fd, DRM_IOCTL_MODE_DESTROY_DUMB, &destroy_dumb);
+   }
+
+   memset(fb, 0, sizeof(*fb));
+}
+
+/* Dumb buffers come zeroed, which is black in either format */
+static bool drm_scanout_fb_create(drm_scanout_fb_t *fb,
+      unsigned width, unsigned height, uint32_t format)
+{
+   uint32_t handles[4]                     = {0};
+   uint32_t pitches[4]                     = {0};
+   uint32_t offsets[4]                     = {0};
+   struct drm_mode_create_dumb create_dumb = {0};
+   struct drm_mode_map_dumb map_dumb       = {0};
+   void *map;
+
+   create_dumb.width  = width;
+   create_dumb.height = height;
+   create_dumb.bpp    = (format == DRM_FORMAT_RGB565) ? 16 : 32;
+   if (drmIoctl(g_drm_fd, DRM_IOCTL_MODE_CREATE_DUMB, &create_dumb) < 0)
+      return false;
+
+   fb->handle = create_dumb.handle;
+   fb->pitch  = create_dumb.pitch;
+   handles[0] = create_dumb.handle;
+   pitches[0] = create_dumb.pitch;
+
+   if (drmModeAddFB2(g_drm_fd, width, height, format,
+            handles, pitches, offsets, &fb->fb_id, 0) < 0)
+      goto error;
+
+   map_dumb.handle = create_dumb.handle;
+   if (drmIoctl(g_drm_fd, DRM_IOCTL_MODE_MAP_DUMB, &map_dumb) < 0)
+      goto error;
+
+   if ((map = mmap(NULL, create_dumb.size, PROT_READ | PROT_WRITE,
+               MAP_SHARED, g_drm_fd, map_dumb.offset)) == MAP_FAILED)
+      goto error;
+
+   fb->map  = (uint8_t*)map;
+   fb->size = create_dumb.size;
+   return true;
+
+error:
+   drm_scanout_fb_free(fb);
+   return false;
+}
+
+/* Finds an overlay plane free to put on our CRTC, and the primary
+ * plane under it */
+static bool drm_scanout_init(drm_scanout_t *scanout)
+{
+   unsigned i, j, k;
+   int crtc_index          = -1;
+   drmModeRes *res         = NULL;
+   drmModePlaneRes *planes = NULL;
+
+   scanout->inited         = true;
+
+   /* Without atomic commits the plane can't be moved and flipped
+    * in one step */
+   if (     drmSetClientCap(g_drm_fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1)
+         || drmSetClientCap(g_drm_fd, DRM_CLIENT_CAP_ATOMIC, 1))
+   {
+      RARCH_WARN("[KMS] No atomic modesetting, direct scanout unavailable.\n");
+      goto error;
+   }
+
+   if (!(res = drmModeGetResources(g_drm_fd)))
+      goto error;
+   for (i = 0; i < (unsigned)res->count_crtcs; i++)
+   {
+      if (res->crtcs[i] == g_crtc_id)
+      {
+         crtc_index = i;
+         break;
+      }
+   }
+   drmModeFreeResources(res);
+
+   if (crtc_index < 0 || !(planes = drmModeGetPlaneResources(g_drm_fd)))
+      goto error;
+
+   for (i = 0; i < planes->count_planes; i++)
+   {
+      uint32_t props[DRM_SCANOUT_PROP_LAST];
+      drmModeObjectProperties *obj_props;
+      uint64_t type       = DRM_PLANE_TYPE_CURSOR;
+      uint64_t crtc       = 0;
+      bool xrgb8888       = false;
+      bool rgb565         = false;
+      drmModePlane *plane = drmModeGetPlane(g_drm_fd, planes->planes[i]);
+
+      if (!plane)
+         continue;
+
+      if (     !(plane->possible_crtcs & (1 << crtc_index))
+            || !(obj_props = drmModeObjectGetProperties(g_drm_fd,
+                  plane->plane_id, DRM_MODE_OBJECT_PLANE)))
+      {
+         drmModeFreePlane(plane);
+         continue;
+      }
+
+      memset(props, 0, sizeof(props));
+      for (j = 0; j < obj_props->count_props; j++)
+      {
+         drmModePropertyRes *prop = drmModeGetProperty(g_drm_fd,
+               obj_props->props[j]);
+         if (!prop)
+            continue;
+         if (string_is_equal(prop->name, "type"))
+            type = obj_props->prop_values[j];
+         else if (string_is_equal(prop->name, "CRTC_ID"))
+            crtc = obj_props->prop_values[j];
+         for (k = 0; k < DRM_SCANOUT_PROP_LAST; k++)
+            if (string_is_equal(prop->name, drm_scanout_prop_names[k]))
+               props[k] = prop->prop_id;
+         drmModeFreeProperty(prop);
+      }
+      drmModeFreeObjectProperties(obj_props);
+
+      for (j = 0; j < plane->count_formats; j++)
+      {
+         if (plane->formats[j] == DRM_FORMAT_XRGB8888)
+            xrgb8888 = true;
+         else if (plane->formats[j] == DRM_FORMAT_RGB565)
+            rgb565   = true;
+      }
+
+      if (type == DRM_PLANE_TYPE_PRIMARY)
+      {
+         if (crtc == g_crtc_id && props[DRM_SCANOUT_PROP_FB_ID])
+         {
+            scanout->primary_id      = plane->plane_id;
+            scanout->primary_fb_prop = props[DRM_SCANOUT_PROP_FB_ID];
+         }
+      }
+      /* Not showing anything for another CRTC */
+      else if (   type == DRM_PLANE_TYPE_OVERLAY
+               && !crtc
+               && xrgb8888
+               && !scanout->plane_id)
+      {
+         for (k = 0; k < DRM_SCANOUT_PROP_SCALING_FILTER; k++)
+            if (!props[k])
+               break;
+         if (k == DRM_SCANOUT_PROP_SCALING_FILTER)
+         {
+            scanout->plane_id = plane->plane_id;
+            scanout->rgb565   = rgb565;
+            memcpy(scanout->props, props, sizeof(props));
+         }
+      }
+
+      drmModeFreePlane(plane);
+   }
+   drmModeFreePlaneResources(planes);
+
+   if (!scanout->plane_id || !scanout->primary_id)
+   {
+      RARCH_WARN("[KMS] No free overlay plane on CRTC %u, direct scanout unavailable.\n",
+            g_crtc_id);
+      goto error;
+   }
+
+   RARCH_LOG("[KMS] Direct scanout through plane %u%s.\n",
+         scanout->plane_id,
+         scanout->props[DRM_SCANOUT_PROP_SCALING_FILTER]
+         ? ", with scaling filter" : "");
+   return true;
+
+error:
+   scanout->unsupported = true;
+   return false;
+}
+
+/* Puts @fb_id on the overlay plane at the current geometry, with the
+ * primary plane on black; 0 takes the plane off the CRTC */
+static int drm_scanout_commit(drm_scanout_t *scanout,
+      uint32_t fb_id, uint32_t flags)
+{
+   int ret;
+   uint32_t plane          = scanout->plane_id;
+   const uint32_t *props   = scanout->props;
+   drmModeAtomicReqPtr req = drmModeAtomicAlloc();
+
+   if (!req)
+      return -1;
+
+   drmModeAtomicAddProperty(req, plane,
+         props[DRM_SCANOUT_PROP_FB_ID],   fb_id);
+   drmModeAtomicAddProperty(req, plane,
+         props[DRM_SCANOUT_PROP_CRTC_ID], fb_id ? g_crtc_id : 0);
+
+   if (fb_id)
+   {
+      /* Source rectangle is 16.16 fixed point */
+      drmModeAtomicAddProperty(req, plane,
+            props[DRM_SCANOUT_PROP_SRC_X],  0);
+      drmModeAtomicAddProperty(req, plane,
+            props[DRM_SCANOUT_PROP_SRC_Y],  0);
+      drmModeAtomicAddProperty(req, plane,
+            props[DRM_SCANOUT_PROP_SRC_W],  (uint64_t)scanout->width  << 16);
+      drmModeAtomicAddProperty(req, plane,
+            props[DRM_SCANOUT_PROP_SRC_H],  (uint64_t)scanout->height << 16);
+      drmModeAtomicAddProperty(req, plane,
+            props[DRM_SCANOUT_PROP_CRTC_X], (uint64_t)(int64_t)scanout->x);
+      drmModeAtomicAddProperty(req, plane,
+            props[DRM_SCANOUT_PROP_CRTC_Y], (uint64_t)(int64_t)scanout->y);
+      drmModeAtomicAddProperty(req, plane,
+            props[DRM_SCANOUT_PROP_CRTC_W], scanout->out_width);
+      drmModeAtomicAddProperty(req, plane,
+            props[DRM_SCANOUT_PROP_CRTC_H], scanout->out_height);
+      /* "Default" or "Nearest Neighbor" */
+      if (props[DRM_SCANOUT_PROP_SCALING_FILTER])
+         drmModeAtomicAddProperty(req, plane,
+               props[DRM_SCANOUT_PROP_SCALING_FILTER],
+               scanout->smooth ? 0 : 1);
+      drmModeAtomicAddProperty(req, scanout->primary_id,
+            scanout->primary_fb_prop, scanout->black.fb_id);
+   }
+
+   ret = drmModeAtomicCommit(g_drm_fd, req, flags,
+         &scanout->waiting_for_flip);
+   drmModeAtomicFree(req);
+   return ret;
+}
+
+static bool drm_scanout_wait_flip(drm_scanout_t *scanout, bool block)
+{
+   while (scanout->waiting_for_flip)
+   {
+      if (!drm_wait_flip(block ? -1 : 0))
+         break;
+   }
+
+   return scanout->waiting_for_flip;
+}
+
+static void drm_scanout_off(drm_scanout_t *scanout)
+{
+   if (!scanout->active)
+      return;
+
+   drm_scanout_wait_flip(scanout, true);
+   if (drm_scanout_commit(scanout, 0, 0) != 0)
+      RARCH_ERR("[KMS] Failed to take the frame off the overlay plane.\n");
+
+   scanout->active = false;
+   scanout->tested = false;
+}
+
+static void drm_scanout_free(drm_scanout_t *scanout)
+{
+   unsigned i;
+
+   drm_scanout_off(scanout);
+
+   for (i = 0; i < DRM_SCANOUT_BUFFERS; i++)
+      drm_scanout_fb_free(&scanout->fbs[i]);
+   drm_scanout_fb_free(&scanout->black);
+
+   memset(scanout, 0, sizeof(*scanout));
+}
+
+bool gfx_ctx_drm_scanout_frame(void *data, const void *frame,
+      unsigned width, unsigned height, unsigned pitch, bool rgb32,
+      int x, int y, unsigned out_width, unsigned out_height, bool smooth)
+{
+   unsigned i, index;
+   gfx_ctx_drm_data_t *drm       = (gfx_ctx_drm_data_t*)data;
+   drm_scanout_t *scanout        = &drm->scanout;
+   uint32_t format               = rgb32
+      ? DRM_FORMAT_XRGB8888 : DRM_FORMAT_RGB565;
+   unsigned max_swapchain_images =
+      config_get_ptr()->uints.video_max_swapchain_images;
+
+   if (!scanout->inited)
+      drm_scanout_init(scanout);
+   if (scanout->unsupported || (!rgb32 && !scanout->rgb565))
+      return false;
+
+   if (     scanout->black_width  != drm->fb_width
+         || scanout->black_height != drm->fb_height)
+   {
+      drm_scanout_off(scanout);
+      drm_scanout_fb_free(&scanout->black);
+      scanout->black_width  = 0;
+      scanout->black_height = 0;
+      if (!drm_scanout_fb_create(&scanout->black,
+               drm->fb_width, drm->fb_height, DRM_FORMAT_XRGB8888))
+         return false;
+      scanout->black_width  = drm->fb_width;
+      scanout->black_height = drm->fb_height;
+   }
+
+   /* A dupe shows the last frame again, which keeps the pace */
+   if (!frame)
+   {
+      if (!scanout->active)
+         return false;
+      index = scanout->index;
+   }
+   else
+   {
+      size_t row;
+      uint8_t *dst;
+      const uint8_t *src = (const uint8_t*)frame;
+
+      /* Removing a framebuffer takes it off the screen as well */
+      if (     width  != scanout->width
+            || height != scanout->height
+            || format != scanout->format)
+      {
+         drm_scanout_off(scanout);
+         for (i = 0; i < DRM_SCANOUT_BUFFERS; i++)
+            drm_scanout_fb_free(&scanout->fbs[i]);
+         scanout->width  = 0;
+         scanout->height = 0;
+
+         for (i = 0; i < DRM_SCANOUT_BUFFERS; i++)
+         {
+            if (!drm_scanout_fb_create(&scanout->fbs[i],
+                     width, height, format))
+            {
+               RARCH_ERR("[KMS] Failed to create %ux%u scanout buffers.\n",
+                     width, height);
+               for (i = 0; i < DRM_SCANOUT_BUFFERS; i++)
+                  drm_scanout_fb_free(&scanout->fbs[i]);
+               return false;
+            }
+         }
+
+         scanout->width  = width;
+         scanout->height = height;
+         scanout->format = format;
+         scanout->index  = 0;
+      }
+
+      /* Neither the buffer queued nor the one on screen */
+      index = (scanout->index + 1) % DRM_SCANOUT_BUFFERS;
+      dst   = scanout->fbs[index].map;
+      row   = MIN((size_t)width * (rgb32 ? 4 : 2),
+            (size_t)scanout->fbs[index].pitch);
+      for (i = 0; i < height; i++)
+      {
+         memcpy(dst, src, row);
+         dst += scanout->fbs[index].pitch;
+         src += pitch;
+      }
+   }
+
+   if (     !scanout->tested
+         || x          != scanout->x
+         || y          != scanout->y
+         || out_width  != scanout->out_width
+         || out_height != scanout->out_height
+         || smooth     != scanout->smooth)
+   {
+      scanout->x          = x;
+      scanout->y          = y;
+      scanout->out_width  = out_width;
+      scanout->out_height = out_height;
+      scanout->smooth     = smooth;
+      /* The plane may not scale that far, or go partly off screen */
+      scanout->tested     = drm_scanout_commit(scanout,
+            scanout->fbs[index].fb_id, DRM_MODE_ATOMIC_TEST_ONLY) == 0;
+      if (!scanout->tested)
+         return false;
+   }
+
+   /* The last GL frame has to reach the screen before the primary
+    * plane is switched to black */
+   if (drm->waiting_for_flip)
+      gfx_ctx_drm_wait_flip(drm, true);
+
+   /* Still waiting without vsync: drop the frame, as
+    * swap_buffers does */
+   if (drm_scanout_wait_flip(scanout, drm->interval != 0))
+      return true;
+
+   if (drm_scanout_commit(scanout, scanout->fbs[index].fb_id,
+            DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT) != 0)
+   {
+      scanout->tested = false;
+      return false;
+   }
+
+   scanout->waiting_for_flip = true;
+   scanout->active           = true;
+   scanout->index            = index;
+
+   /* Triple-buffered page flips */
+   if (max_swapchain_images < 3 && drm->interval)
+      drm_scanout_wait_flip(scanout, true);
+
+   return true;
+}
+
+void gfx_ctx_drm_scanout_stop(void *data)
+{
+   gfx_ctx_drm_data_t *drm = (gfx_ctx_drm_data_t*)data;
+
+   if (drm)
+      drm_scanout_off(&drm->scanout);
+}
+
 static void gfx_ctx_drm_get_video_size(void *data,
       unsigned *width, unsigned *height)
 {
@@ -665,6 +1164,7 @@ static void gfx_ctx_drm_destroy_resources(gfx_ctx_drm_data_t *drm)
 
    /* Make sure we acknowledge all page-flips. */
    gfx_ctx_drm_wait_flip(drm, true);
+   drm_scanout_free(&drm->scanout);
 
 #ifdef HAVE_EGL
    egl_destroy(&drm->egl);
@@ -48,6 +48,13 @@
 #define FT_ATLAS_ROWS 16
 #define FT_ATLAS_COLS 16
 #define FT_ATLAS_SIZE (FT_ATLAS_ROWS * FT_ATLAS_COLS)
+/* Fonts with more glyphs than this (CJK) get twice
+ * the rows and columns, so that a page of text does
+ * not keep evicting and rasterizing glyphs... */
+#define FT_ATLAS_LARGE_FONT_GLYPHS (FT_ATLAS_SIZE * 4)
+/* ...as long as the atlas stays within this width
+ * and height */
+#define FT_ATLAS_MAX_DIM 2048
 /* Padding is required between each glyph in
  * the atlas to prevent texture bleed when
  * drawing with linear filtering enabled */
@@ -56,9 +63,12 @@
 typedef struct freetype_atlas_slot
 {
    struct freetype_atlas_slot* next;   /* ptr alignment */
+   /* Neighbours in the list of slots, most recently
+    * used first */
+   struct freetype_atlas_slot* lru_prev;
+   struct freetype_atlas_slot* lru_next;
    struct font_glyph glyph;            /* unsigned alignment */
    unsigned charcode;
-   unsigned last_used;
 }freetype_atlas_slot_t;
 
 typedef struct freetype_renderer
@@ -66,12 +76,13 @@ typedef struct freetype_renderer
    FT_Library lib;                                   /* ptr alignment   */
    FT_Face face;                                     /* ptr alignment   */
    struct font_atlas atlas;                          /* ptr alignment   */
-   freetype_atlas_slot_t atlas_slots[FT_ATLAS_SIZE]; /* ptr alignment   */
+   freetype_atlas_slot_t* atlas_slots;               /* ptr alignment   */
+   freetype_atlas_slot_t* lru_head;                  /* ptr alignment   */
+   freetype_atlas_slot_t* lru_tail;                  /* ptr alignment   */
    freetype_atlas_slot_t* uc_map[0x100];             /* ptr alignment   */
    void *file_data;                                  /* ptr alignment   */
    unsigned max_glyph_width;
    unsigned max_glyph_height;
-   unsigned usage_counter;
    struct font_line_metrics line_metrics;            /* float alignment */
 } ft_font_renderer_t;
 
@@ -90,6 +101,7 @@ static void font_renderer_ft_free(void *data)
       return;
 
    free(handle->atlas.buffer);
+   free(handle->atlas_slots);
 
    if (handle->face)
       FT_Done_Face(handle->face);
@@ -101,29 +113,45 @@ static void font_renderer_ft_free(void *data)
    free(handle);
 }
 
-static freetype_atlas_slot_t* font_renderer_get_slot(ft_font_renderer_t *handle)
+/* Moves 'atlas_slot' to the front of the LRU list */
+static void font_renderer_touch_slot(ft_font_renderer_t *handle,
+      freetype_atlas_slot_t *atlas_slot)
 {
-   int i, map_id;
-   unsigned oldest = 0;
+   if (handle->lru_head == atlas_slot)
+      return;
 
-   for (i = 1; i < FT_ATLAS_SIZE; i++)
-      if ((handle->usage_counter - handle->atlas_slots[i].last_used) >
-         (handle->usage_counter - handle->atlas_slots[oldest].last_used))
-         oldest = i;
+   /* Unlink... */
+   atlas_slot->lru_prev->lru_next = atlas_slot->lru_next;
+   if (atlas_slot->lru_next)
+      atlas_slot->lru_next->lru_prev = atlas_slot->lru_prev;
+   else
+      handle->lru_tail = atlas_slot->lru_prev;
+
+   /* ...and put back in front */
+   atlas_slot->lru_prev     = NULL;
+   atlas_slot->lru_next     = handle->lru_head;
+   handle->lru_head->lru_prev = atlas_slot;
+   handle->lru_head         = atlas_slot;
+}
+
+static freetype_atlas_slot_t* font_renderer_get_slot(ft_font_renderer_t *handle)
+{
+   int map_id;
+   freetype_atlas_slot_t *oldest = handle->lru_tail;
 
    /* remove from map */
-   map_id = handle->atlas_slots[oldest].charcode & 0xFF;
-   if (handle->uc_map[map_id] == &handle->atlas_slots[oldest])
-      handle->uc_map[map_id] = handle->atlas_slots[oldest].next;
+   map_id = oldest->charcode & 0xFF;
+   if (handle->uc_map[map_id] == oldest)
+      handle->uc_map[map_id] = oldest->next;
    else if (handle->uc_map[map_id])
    {
       freetype_atlas_slot_t* ptr = handle->uc_map[map_id];
-      while (ptr->next && ptr->next != &handle->atlas_slots[oldest])
+      while (ptr->next && ptr->next != oldest)
          ptr = ptr->next;
-      ptr->next = handle->atlas_slots[oldest].next;
+      ptr->next = oldest->next;
    }
 
-   return &handle->atlas_slots[oldest];
+   return oldest;
 }
 
 static const struct font_glyph *font_renderer_ft_get_glyph(
@@ -145,7 +173,7 @@ static const struct font_glyph *font_renderer_ft_get_glyph(
    {
       if (atlas_slot->charcode == charcode)
       {
-         atlas_slot->last_used = handle->usage_counter++;
+         font_renderer_touch_slot(handle, atlas_slot);
          return &atlas_slot->glyph;
       }
       atlas_slot = atlas_slot->next;
@@ -207,13 +235,14 @@ static const struct font_glyph *font_renderer_ft_get_glyph(
    }
 
    handle->atlas.dirty = true;
-   atlas_slot->last_used = handle->usage_counter++;
+   font_renderer_touch_slot(handle, atlas_slot);
    return &atlas_slot->glyph;
 }
 
 static bool font_renderer_create_atlas(ft_font_renderer_t *handle, float font_size)
 {
    unsigned i, x, y;
+   uint8_t *atlas_buffer;
    freetype_atlas_slot_t* slot = NULL;
 
    unsigned max_width          = round((handle->face->bbox.xMax - handle->face->bbox.xMin)
@@ -221,12 +250,27 @@ static bool font_renderer_create_atlas(ft_font_renderer_t *handle, float font_si
    unsigned max_height         = round((handle->face->bbox.yMax - handle->face->bbox.yMin)
          * font_size / handle->face->units_per_EM);
 
-   unsigned atlas_width        = (max_width  + FT_ATLAS_PADDING) * FT_ATLAS_COLS;
-   unsigned atlas_height       = (max_height + FT_ATLAS_PADDING) * FT_ATLAS_ROWS;
+   unsigned atlas_cols         = FT_ATLAS_COLS;
+   unsigned atlas_rows         = FT_ATLAS_ROWS;
+   unsigned atlas_width;
+   unsigned atlas_height;
+
+   if (     (handle->face->num_glyphs > FT_ATLAS_LARGE_FONT_GLYPHS)
+         && ((max_width  + FT_ATLAS_PADDING) * atlas_cols * 2 <= FT_ATLAS_MAX_DIM)
+         && ((max_height + FT_ATLAS_PADDING) * atlas_rows * 2 <= FT_ATLAS_MAX_DIM))
+   {
+      atlas_cols *= 2;
+      atlas_rows *= 2;
+   }
+
+   atlas_width                 = (max_width  + FT_ATLAS_PADDING) * atlas_cols;
+   atlas_height                = (max_height + FT_ATLAS_PADDING) * atlas_rows;
 
-   uint8_t *atlas_buffer       = (uint8_t*)calloc(atlas_width * atlas_height, 1);
+   if (!(handle->atlas_slots = (freetype_atlas_slot_t*)calloc(
+               atlas_cols * atlas_rows, sizeof(*handle->atlas_slots))))
+      return false;
 
-   if (!atlas_buffer)
+   if (!(atlas_buffer = (uint8_t*)calloc(atlas_width * atlas_height, 1)))
       return false;
 
    handle->max_glyph_width     = max_width;
@@ -236,12 +280,19 @@ static bool font_renderer_create_atlas(ft_font_renderer_t *handle, float font_si
    handle->atlas.height        = atlas_height;
    slot                        = handle->atlas_slots;
 
-   for (y = 0; y < FT_ATLAS_ROWS; y++)
+   for (y = 0; y < atlas_rows; y++)
    {
-      for (x = 0; x < FT_ATLAS_COLS; x++)
+      for (x = 0; x < atlas_cols; x++)
       {
          slot->glyph.atlas_offset_x = x * (max_width  + FT_ATLAS_PADDING);
          slot->glyph.atlas_offset_y = y * (max_height + FT_ATLAS_PADDING);
+         /* All slots start out unused, in order */
+         slot->lru_prev             = handle->lru_tail;
+         if (handle->lru_tail)
+            handle->lru_tail->lru_next = slot;
+         else
+            handle->lru_head        = slot;
+         handle->lru_tail           = slot;
          slot++;
       }
    }
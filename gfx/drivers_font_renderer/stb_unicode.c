@@ -41,6 +41,13 @@
 #define STB_UNICODE_ATLAS_ROWS 16
 #define STB_UNICODE_ATLAS_COLS 16
 #define STB_UNICODE_ATLAS_SIZE (STB_UNICODE_ATLAS_ROWS * STB_UNICODE_ATLAS_COLS)
+/* Fonts with more glyphs than this (CJK) get twice
+ * the rows and columns, so that a page of text does
+ * not keep evicting and rasterizing glyphs... */
+#define STB_UNICODE_ATLAS_LARGE_FONT_GLYPHS (STB_UNICODE_ATLAS_SIZE * 4)
+/* ...as long as the atlas stays within this width
+ * and height */
+#define STB_UNICODE_ATLAS_MAX_DIM 2048
 /* Padding is required between each glyph in
  * the atlas to prevent texture bleed when
  * drawing with linear filtering enabled */
@@ -49,9 +56,12 @@
 typedef struct stb_unicode_atlas_slot
 {
    struct stb_unicode_atlas_slot* next;
+   /* Neighbours in the list of slots, most recently
+    * used first */
+   struct stb_unicode_atlas_slot* lru_prev;
+   struct stb_unicode_atlas_slot* lru_next;
    struct font_glyph glyph;      /* unsigned alignment */
    unsigned charcode;
-   unsigned last_used;
 } stb_unicode_atlas_slot_t;
 
 typedef struct
@@ -59,11 +69,12 @@ typedef struct
    uint8_t *font_data;
    struct font_atlas atlas;               /* ptr alignment */
    stb_unicode_atlas_slot_t* uc_map[0x100];
-   stb_unicode_atlas_slot_t atlas_slots[STB_UNICODE_ATLAS_SIZE];
+   stb_unicode_atlas_slot_t* atlas_slots;
+   stb_unicode_atlas_slot_t* lru_head;
+   stb_unicode_atlas_slot_t* lru_tail;
    stbtt_fontinfo info;                   /* ptr alignment */
    int max_glyph_width;
    int max_glyph_height;
-   unsigned usage_counter;
    float scale_factor;
    struct font_line_metrics line_metrics; /* float alignment */
 } stb_unicode_font_renderer_t;
@@ -79,33 +90,51 @@ static void font_renderer_stb_unicode_free(void *data)
    stb_unicode_font_renderer_t *self = (stb_unicode_font_renderer_t*)data;
 
    free(self->atlas.buffer);
+   free(self->atlas_slots);
    free(self->font_data);
    free(self);
 }
 
-static stb_unicode_atlas_slot_t* font_renderer_stb_unicode_get_slot(stb_unicode_font_renderer_t *handle)
+/* Moves 'atlas_slot' to the front of the LRU list */
+static void font_renderer_stb_unicode_touch_slot(
+      stb_unicode_font_renderer_t *handle,
+      stb_unicode_atlas_slot_t *atlas_slot)
 {
-   int i, map_id;
-   unsigned oldest = 0;
+   if (handle->lru_head == atlas_slot)
+      return;
+
+   /* Unlink... */
+   atlas_slot->lru_prev->lru_next = atlas_slot->lru_next;
+   if (atlas_slot->lru_next)
+      atlas_slot->lru_next->lru_prev = atlas_slot->lru_prev;
+   else
+      handle->lru_tail = atlas_slot->lru_prev;
 
-   for (i = 1; i < STB_UNICODE_ATLAS_SIZE; i++)
-      if ((handle->usage_counter - handle->atlas_slots[i].last_used) >
-         (handle->usage_counter - handle->atlas_slots[oldest].last_used))
-         oldest = i;
+   /* ...and put back in front */
+   atlas_slot->lru_prev       = NULL;
+   atlas_slot->lru_next       = handle->lru_head;
+   handle->lru_head->lru_prev = atlas_slot;
+   handle->lru_head           = atlas_slot;
+}
+
+static stb_unicode_atlas_slot_t* font_renderer_stb_unicode_get_slot(stb_unicode_font_renderer_t *handle)
+{
+   int map_id;
+   stb_unicode_atlas_slot_t *oldest = handle->lru_tail;
 
    /* remove from map */
-   map_id = handle->atlas_slots[oldest].charcode & 0xFF;
-   if (handle->uc_map[map_id] == &handle->atlas_slots[oldest])
-      handle->uc_map[map_id] = handle->atlas_slots[oldest].next;
+   map_id = oldest->charcode & 0xFF;
+   if (handle->uc_map[map_id] == oldest)
+      handle->uc_map[map_id] = oldest->next;
    else if (handle->uc_map[map_id])
    {
       stb_unicode_atlas_slot_t* ptr = handle->uc_map[map_id];
-      while (ptr->next && ptr->next != &handle->atlas_slots[oldest])
+      while (ptr->next && ptr->next != oldest)
          ptr = ptr->next;
-      ptr->next = handle->atlas_slots[oldest].next;
+      ptr->next = oldest->next;
    }
 
-   return &handle->atlas_slots[oldest];
+   return oldest;
 }
 
 static const struct font_glyph *font_renderer_stb_unicode_get_glyph(
@@ -133,7 +162,7 @@ static const struct font_glyph *font_renderer_stb_unicode_get_glyph(
    {
       if (atlas_slot->charcode == charcode)
       {
-         atlas_slot->last_used = self->usage_counter++;
+         font_renderer_stb_unicode_touch_slot(self, atlas_slot);
          return &atlas_slot->glyph;
       }
       atlas_slot = atlas_slot->next;
@@ -189,7 +218,7 @@ static const struct font_glyph *font_renderer_stb_unicode_get_glyph(
          : ceil((double)glyph_draw_offset_y));
 
    self->atlas.dirty                = true;
-   atlas_slot->last_used            = self->usage_counter++;
+   font_renderer_stb_unicode_touch_slot(self, atlas_slot);
    return &atlas_slot->glyph;
 }
 
@@ -199,12 +228,26 @@ static bool font_renderer_stb_unicode_create_atlas(
    unsigned i, x, y;
    stb_unicode_atlas_slot_t* slot = NULL;
    int max_glyph_size             = (font_size < 0) ? -font_size : font_size;
+   unsigned atlas_cols            = STB_UNICODE_ATLAS_COLS;
+   unsigned atlas_rows            = STB_UNICODE_ATLAS_ROWS;
 
    self->max_glyph_width          = max_glyph_size;
    self->max_glyph_height         = max_glyph_size;
 
-   self->atlas.width              = (self->max_glyph_width  + STB_UNICODE_ATLAS_PADDING) * STB_UNICODE_ATLAS_COLS;
-   self->atlas.height             = (self->max_glyph_height + STB_UNICODE_ATLAS_PADDING) * STB_UNICODE_ATLAS_ROWS;
+   if (     (self->info.numGlyphs > STB_UNICODE_ATLAS_LARGE_FONT_GLYPHS)
+         && ((self->max_glyph_width  + STB_UNICODE_ATLAS_PADDING) * atlas_cols * 2 <= STB_UNICODE_ATLAS_MAX_DIM)
+         && ((self->max_glyph_height + STB_UNICODE_ATLAS_PADDING) * atlas_rows * 2 <= STB_UNICODE_ATLAS_MAX_DIM))
+   {
+      atlas_cols *= 2;
+      atlas_rows *= 2;
+   }
+
+   self->atlas.width              = (self->max_glyph_width  + STB_UNICODE_ATLAS_PADDING) * atlas_cols;
+   self->atlas.height             = (self->max_glyph_height + STB_UNICODE_ATLAS_PADDING) * atlas_rows;
+
+   if (!(self->atlas_slots = (stb_unicode_atlas_slot_t*)calloc(
+               atlas_cols * atlas_rows, sizeof(*self->atlas_slots))))
+      return false;
 
    self->atlas.buffer             = (uint8_t*)calloc(
       self->atlas.width * self->atlas.height, sizeof(uint8_t));
@@ -214,12 +257,19 @@ static bool font_renderer_stb_unicode_create_atlas(
 
    slot = self->atlas_slots;
 
-   for (y = 0; y < STB_UNICODE_ATLAS_ROWS; y++)
+   for (y = 0; y < atlas_rows; y++)
    {
-      for (x = 0; x < STB_UNICODE_ATLAS_COLS; x++)
+      for (x = 0; x < atlas_cols; x++)
       {
          slot->glyph.atlas_offset_x = x * (self->max_glyph_width  + STB_UNICODE_ATLAS_PADDING);
          slot->glyph.atlas_offset_y = y * (self->max_glyph_height + STB_UNICODE_ATLAS_PADDING);
+         /* All slots start out unused, in order */
+         slot->lru_prev             = self->lru_tail;
+         if (self->lru_tail)
+            self->lru_tail->lru_next = slot;
+         else
+            self->lru_head          = slot;
+         self->lru_tail             = slot;
          slot++;
       }
    }
@@ -43,27 +43,31 @@ struct SlangProcess
       TBuiltInResource Resources;
 };
 
-/* We don't use glslang from multiple threads, but to be sure.
- * Initializing TLS and freeing it for glslang works around
+/* Initializing TLS and freeing it for glslang works around
  * a really bizarre issue where the TLS key is suddenly
  * corrupted *somehow*.
+ *
+ * glslang's own setup is not thread safe (it even re-creates
+ * its global mutex), so it is only run for the first holder and
+ * torn down with the last. Compiles in between may run on any
+ * number of threads.
  */
 static std::mutex glslang_global_lock;
+static unsigned glslang_process_holders;
 
-struct SlangProcessHolder
+glslang::ProcessHolder::ProcessHolder()
 {
-   SlangProcessHolder()
-   {
-      glslang_global_lock.lock();
+   std::lock_guard<std::mutex> lock(glslang_global_lock);
+   if (glslang_process_holders++ == 0)
       glslang::InitializeProcess();
-   }
+}
 
-   ~SlangProcessHolder()
-   {
+glslang::ProcessHolder::~ProcessHolder()
+{
+   std::lock_guard<std::mutex> lock(glslang_global_lock);
+   if (--glslang_process_holders == 0)
       glslang::FinalizeProcess();
-      glslang_global_lock.unlock();
-   }
-};
+}
 
 SlangProcess::SlangProcess()
 {
@@ -392,7 +396,7 @@ bool glslang::compile_spirv(const std::string &source, Stage stage,
 {
 	std::string msg;
    static SlangProcess process;
-   SlangProcessHolder process_holder;
+   glslang::ProcessHolder process_holder;
    TProgram program;
    EShLanguage language;
 
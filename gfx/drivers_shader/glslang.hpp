@@ -17,6 +17,16 @@ namespace glslang
         StageCompute
     };
 
+    /* Keeps glslang initialized while alive. Hold one around
+     * compiles that run on several threads at once, so that none
+     * of them tears the process state down under the others. */
+    struct ProcessHolder
+    {
+        ProcessHolder();
+        ~ProcessHolder();
+    };
+
+    /* Safe to call from several threads at once */
     bool compile_spirv(const std::string &source, Stage stage, std::vector<uint32_t> *spirv);
 }
 
@@ -19,8 +19,11 @@
 #include <algorithm>
 
 #include <retro_miscellaneous.h>
+#include <encodings/crc32.h>
+#include <features/features_cpu.h>
 #include <file/file_path.h>
 #include <file/config_file.h>
+#include <file/file_write_atomic.h>
 #include <streams/file_stream.h>
 #include <string/stdstring.h>
 
@@ -28,13 +31,24 @@
 #include "../../config.h"
 #endif
 
+#ifdef HAVE_THREADS
+#include <rthreads/tpool.h>
+#endif
+
 #include "glslang_util.h"
 #include "glslang_util_cxx.h"
 #if defined(HAVE_GLSLANG)
 #include "glslang.hpp"
 #endif
+#include "../../configuration.h"
+#include "../../file_path_special.h"
 #include "../../verbosity.h"
 
+/* Bump whenever the compiler or its options change the
+ * SPIR-V it emits for the same source */
+#define SLANG_CACHE_VERSION 1
+#define SLANG_CACHE_MAGIC   0x56505352 /* "RSPV" */
+
 static std::string build_stage_source(
       const struct string_list *lines, const char *stage)
 {
@@ -210,6 +224,90 @@ bool glslang_parse_meta(const struct string_list *lines, glslang_meta *meta)
    return true;
 }
 
+#if defined(HAVE_GLSLANG)
+/* The cache file of a pass is named after the hashes of its two
+ * stages, includes resolved, so any change to them misses */
+static bool glslang_cache_get_path(char *s, size_t len,
+      const std::string &vertex, const std::string &fragment)
+{
+   char dir[PATH_MAX_LENGTH];
+   char name[32];
+   settings_t *settings = config_get_ptr();
+
+   if (     !settings->bools.video_shader_cache_enable
+         || string_is_empty(settings->paths.directory_cache))
+      return false;
+
+   fill_pathname_join_special(dir, settings->paths.directory_cache,
+         FILE_PATH_SHADER_CACHE_DIR, sizeof(dir));
+   snprintf(name, sizeof(name), "%08x%08x.spv",
+         (unsigned)encoding_crc32(SLANG_CACHE_VERSION,
+            (const uint8_t*)vertex.data(), vertex.size()),
+         (unsigned)encoding_crc32(SLANG_CACHE_VERSION,
+            (const uint8_t*)fragment.data(), fragment.size()));
+   fill_pathname_join_special(s, dir, name, len);
+   return true;
+}
+
+/* File layout: magic, version, vertex and fragment word counts,
+ * then the words of both stages, all native endian */
+static bool glslang_cache_load(const char *path, glslang_output *output)
+{
+   void *buf      = NULL;
+   int64_t len    = 0;
+   bool ret       = false;
+   const uint32_t *words;
+
+   if (     !path_is_valid(path)
+         || !filestream_read_file(path, &buf, &len))
+      return false;
+
+   words = (const uint32_t*)buf;
+   if (     len >= (int64_t)(4 * sizeof(uint32_t))
+         && words[0] == SLANG_CACHE_MAGIC
+         && words[1] == SLANG_CACHE_VERSION
+         && words[2] && words[3]
+         && (uint64_t)len == (4 + (uint64_t)words[2] + words[3])
+            * sizeof(uint32_t))
+   {
+      output->vertex.assign(words + 4, words + 4 + words[2]);
+      output->fragment.assign(words + 4 + words[2],
+            words + 4 + words[2] + words[3]);
+      ret = true;
+   }
+
+   free(buf);
+   return ret;
+}
+
+static void glslang_cache_store(const char *path,
+      const glslang_output *output)
+{
+   char dir[PATH_MAX_LENGTH];
+   struct file_write_block block;
+   std::vector<uint32_t> words;
+
+   words.reserve(4 + output->vertex.size() + output->fragment.size());
+   words.push_back(SLANG_CACHE_MAGIC);
+   words.push_back(SLANG_CACHE_VERSION);
+   words.push_back((uint32_t)output->vertex.size());
+   words.push_back((uint32_t)output->fragment.size());
+   words.insert(words.end(), output->vertex.begin(), output->vertex.end());
+   words.insert(words.end(), output->fragment.begin(),
+         output->fragment.end());
+
+   fill_pathname_basedir(dir, path, sizeof(dir));
+   if (!path_is_directory(dir))
+      path_mkdir(dir);
+
+   /* Another instance may be reading it */
+   block.data = words.data();
+   block.size = (int64_t)(words.size() * sizeof(uint32_t));
+   if (!file_write_atomic(path, &block, 1))
+      RARCH_WARN("[Slang] Failed to write shader cache: \"%s\".\n", path);
+}
+#endif
+
 bool glslang_compile_shader(const char *shader_path, glslang_output *output)
 {
 #if defined(HAVE_GLSLANG)
@@ -218,26 +316,46 @@ bool glslang_compile_shader(const char *shader_path, glslang_output *output)
    if (!string_list_initialize(&lines))
       return false;
 
-   RARCH_LOG("[Slang] Compiling shader: \"%s\".\n", shader_path);
-
    if (!glslang_read_shader_file(shader_path, &lines, true, false))
       goto error;
    output->meta = glslang_meta{};
    if (!glslang_parse_meta(&lines, &output->meta))
       goto error;
 
-   if (!glslang::compile_spirv(build_stage_source(&lines, "vertex"),
-            glslang::StageVertex, &output->vertex))
    {
-      RARCH_ERR("[Slang] Failed to compile vertex shader stage.\n");
-      goto error;
-   }
+      char cache_path[PATH_MAX_LENGTH];
+      std::string vertex   = build_stage_source(&lines, "vertex");
+      std::string fragment = build_stage_source(&lines, "fragment");
+      bool cache           = glslang_cache_get_path(cache_path,
+            sizeof(cache_path), vertex, fragment);
 
-   if (!glslang::compile_spirv(build_stage_source(&lines, "fragment"),
-            glslang::StageFragment, &output->fragment))
-   {
-      RARCH_ERR("[Slang] Failed to compile fragment shader stage.\n");
-      goto error;
+      if (cache && glslang_cache_load(cache_path, output))
+      {
+         RARCH_LOG("[Slang] Loaded cached shader: \"%s\".\n", shader_path);
+         string_list_deinitialize(&lines);
+         return true;
+      }
+
+      RARCH_LOG("[Slang] Compiling shader: \"%s\".\n", shader_path);
+
+      if (!glslang::compile_spirv(vertex,
+               glslang::StageVertex, &output->vertex))
+      {
+         RARCH_ERR("[Slang] Failed to compile vertex shader stage of \"%s\".\n",
+               shader_path);
+         goto error;
+      }
+
+      if (!glslang::compile_spirv(fragment,
+               glslang::StageFragment, &output->fragment))
+      {
+         RARCH_ERR("[Slang] Failed to compile fragment shader stage of \"%s\".\n",
+               shader_path);
+         goto error;
+      }
+
+      if (cache)
+         glslang_cache_store(cache_path, output);
    }
 
    string_list_deinitialize(&lines);
@@ -250,3 +368,64 @@ error:
 
    return false;
 }
+
+#if defined(HAVE_GLSLANG) && defined(HAVE_THREADS)
+struct glslang_compile_job
+{
+   const char *shader_path;
+   glslang_output *output;
+   bool ok;
+};
+
+static void glslang_compile_job_run(void *data)
+{
+   struct glslang_compile_job *job = (struct glslang_compile_job*)data;
+   job->ok = glslang_compile_shader(job->shader_path, job->output);
+}
+#endif
+
+unsigned glslang_compile_shaders(const char *const *shader_paths,
+      glslang_output *outputs, unsigned count)
+{
+   unsigned i;
+#if defined(HAVE_GLSLANG) && defined(HAVE_THREADS)
+   unsigned threads = cpu_features_get_core_amount();
+   tpool_t *pool    = NULL;
+
+   if (threads > count)
+      threads = count;
+
+   if (threads > 1 && (pool = tpool_create(threads - 1)))
+   {
+      std::vector<glslang_compile_job> jobs(count);
+      glslang::ProcessHolder process_holder;
+
+      for (i = 0; i < count; i++)
+      {
+         jobs[i].shader_path = shader_paths[i];
+         jobs[i].output      = &outputs[i];
+         jobs[i].ok          = false;
+      }
+
+      /* The calling thread takes the first pass, and any
+       * the pool could not take */
+      for (i = 1; i < count; i++)
+         if (!tpool_add_work(pool, glslang_compile_job_run, &jobs[i]))
+            glslang_compile_job_run(&jobs[i]);
+      glslang_compile_job_run(&jobs[0]);
+
+      tpool_wait(pool);
+      tpool_destroy(pool);
+
+      for (i = 0; i < count; i++)
+         if (!jobs[i].ok)
+            break;
+      return i;
+   }
+#endif
+
+   for (i = 0; i < count; i++)
+      if (!glslang_compile_shader(shader_paths[i], &outputs[i]))
+         break;
+   return i;
+}
@@ -55,6 +55,21 @@ struct glslang_output
 
 bool glslang_compile_shader(const char *shader_path, glslang_output *output);
 
+/**
+ * glslang_compile_shaders:
+ * @shader_paths         : the source of each pass
+ * @outputs              : one output per pass
+ * @count                : number of passes
+ *
+ * Compiles the passes of a preset like glslang_compile_shader(),
+ * on as many threads as there are cores.
+ *
+ * Returns: the number of passes before the first that failed,
+ * @count if all of them compiled.
+ **/
+unsigned glslang_compile_shaders(const char *const *shader_paths,
+      glslang_output *outputs, unsigned count);
+
 /* Helpers for internal use. */
 bool glslang_parse_meta(const struct string_list *lines, glslang_meta *meta);
 
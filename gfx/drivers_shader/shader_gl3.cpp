@@ -2492,7 +2492,9 @@ gl3_filter_chain_t *gl3_filter_chain_create_default(
 gl3_filter_chain_t *gl3_filter_chain_create_from_preset(
       const char *path, glslang_filter_chain_filter filter)
 {
-   unsigned i;
+   unsigned i, compiled;
+   std::vector<const char*> shader_paths;
+   std::vector<glslang_output> outputs;
    std::unique_ptr<video_shader> shader{ new video_shader() };
    if (!shader)
       return nullptr;
@@ -2513,9 +2515,17 @@ gl3_filter_chain_t *gl3_filter_chain_create_from_preset(
 
    shader->num_parameters = 0;
 
+   /* Compile all passes up front, side by side; the rest
+    * of the chain is set up in order */
+   for (i = 0; i < shader->passes; i++)
+      shader_paths.push_back(shader->pass[i].source.path);
+   outputs.resize(shader->passes);
+   compiled = glslang_compile_shaders(shader_paths.data(),
+         outputs.data(), shader->passes);
+
    for (i = 0; i < shader->passes; i++)
    {
-      glslang_output output;
+      glslang_output &output             = outputs[i];
       struct gl3_filter_chain_pass_info pass_info;
       const video_shader_pass *pass      = &shader->pass[i];
       const video_shader_pass *next_pass =
@@ -2531,7 +2541,7 @@ gl3_filter_chain_t *gl3_filter_chain_create_from_preset(
       pass_info.address       = GLSLANG_FILTER_CHAIN_ADDRESS_REPEAT;
       pass_info.max_levels    = 0;
 
-      if (!glslang_compile_shader(pass->source.path, &output))
+      if (i >= compiled)
       {
          RARCH_ERR("[GLCore] Failed to compile shader: \"%s\".\n",
                pass->source.path);
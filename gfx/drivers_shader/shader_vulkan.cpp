@@ -148,6 +148,7 @@ class Framebuffer
       VkRenderPass get_render_pass() const { return render_pass; }
 
       unsigned get_levels() const { return levels; }
+      unsigned get_max_levels() const { return max_levels; }
 
    private:
       Size2D size;
@@ -222,7 +223,9 @@ class Pass
       void operator=(Pass&&) = delete;
 
       const Framebuffer &get_framebuffer() const { return *framebuffer; }
+      void share_framebuffer(const Pass &other) { framebuffer = other.framebuffer; }
       Framebuffer *get_feedback_framebuffer() { return fb_feedback.get(); }
+      void swap_feedback_framebuffer(Pass &other) { swap(fb_feedback, other.fb_feedback); }
 
       Size2D set_pass_info(
             const Size2D &max_original,
@@ -277,6 +280,7 @@ class Pass
       void set_common_resources(CommonResources *c) { this->common = c; }
       const slang_reflection &get_reflection() const { return reflection; }
       void set_pass_number(unsigned pass) { pass_number = pass; }
+      bool is_time_dependent() const;
 
       void add_parameter(unsigned parameter_index, const std::string &id);
 
@@ -311,8 +315,10 @@ class Pass
 
       std::vector<uint32_t> vertex_shader;
       std::vector<uint32_t> fragment_shader;
-      std::unique_ptr<Framebuffer> framebuffer;
-      std::unique_ptr<Framebuffer> fb_feedback;
+      /* Shared with earlier passes whose output is dead by the
+       * time this one renders, see vulkan_filter_chain::init_aliasing() */
+      std::shared_ptr<Framebuffer> framebuffer;
+      std::shared_ptr<Framebuffer> fb_feedback;
       VkRenderPass swapchain_render_pass;
 
       void clear_vk();
@@ -436,6 +442,12 @@ struct vulkan_filter_chain
       bool emits_hdr10() const;
       void set_hdr10();
 
+      void inherit_history(vulkan_filter_chain &old);
+
+      void set_input_changed(bool changed) { input_changed = changed; }
+      unsigned get_num_static_passes() const { return num_static_passes; }
+      unsigned get_num_reused_passes() const { return num_reused_passes; }
+
    private:
       VkDevice device;
       VkPhysicalDevice gpu;
@@ -454,9 +466,24 @@ struct vulkan_filter_chain
       unsigned current_sync_index;
 
       std::vector<std::unique_ptr<Framebuffer>> original_history;
+      /* Taken over from a previous chain, so not cleared */
+      std::vector<const Framebuffer*> inherited;
       bool require_clear        = false;
       bool emits_hdr_colorspace = false;
 
+      /* Leading offscreen passes whose output only depends on the
+       * input and the state in static_key */
+      unsigned num_static_passes = 0;
+      unsigned num_reused_passes = 0;
+      bool input_changed         = true;
+      std::vector<uint32_t> static_key;
+      std::vector<uint32_t> last_static_key;
+      int32_t frame_direction    = 1;
+      uint32_t rotation          = 0;
+      float core_aspect          = 0.0f;
+      float core_aspect_rot      = 0.0f;
+      float original_fps         = 0.0f;
+
       void flush();
 
       void set_num_passes(unsigned passes);
@@ -468,6 +495,9 @@ struct vulkan_filter_chain
       bool init_history();
       bool init_feedback();
       bool init_alias();
+      void init_aliasing();
+      void init_static_passes();
+      bool update_static_key(const VkViewport &vp);
       void update_history(DeferredDisposer &disposer, VkCommandBuffer cmd);
       void clear_history_and_feedback(VkCommandBuffer cmd);
       void update_feedback_info();
@@ -955,6 +985,13 @@ void vulkan_filter_chain::build_offscreen_passes(VkCommandBuffer cmd,
 {
    unsigned i;
    Texture source;
+   unsigned skip = 0;
+
+   /* Key first: a cleared chain has nothing to reuse */
+   if (update_static_key(vp) && !input_changed && !require_clear)
+      skip = num_static_passes;
+   num_reused_passes = skip;
+   input_changed     = true;
 
    /* First frame, make sure our history and feedback textures
     * are in a clean state. */
@@ -979,8 +1016,10 @@ void vulkan_filter_chain::build_offscreen_passes(VkCommandBuffer cmd,
 
    for (i = 0; i < passes.size() - 1; i++)
    {
-      passes[i]->build_commands(disposer, cmd,
-            original, source, vp, nullptr);
+      /* Still holds what it rendered last frame */
+      if (i >= skip)
+         passes[i]->build_commands(disposer, cmd,
+               original, source, vp, nullptr);
 
       const Framebuffer &fb   = passes[i]->get_framebuffer();
 
@@ -1376,21 +1415,267 @@ bool vulkan_filter_chain::init()
       return false;
    if (!init_feedback())
       return false;
+   init_aliasing();
+   init_static_passes();
    common.pass_outputs.resize(passes.size());
    return true;
 }
 
+static unsigned vulkan_format_texel_size(VkFormat format)
+{
+   switch (format)
+   {
+      case VK_FORMAT_R8_UNORM:
+      case VK_FORMAT_R8_SINT:
+      case VK_FORMAT_R8_UINT:
+         return 1;
+      case VK_FORMAT_R8G8_UNORM:
+      case VK_FORMAT_R8G8_SINT:
+      case VK_FORMAT_R8G8_UINT:
+      case VK_FORMAT_R16_UINT:
+      case VK_FORMAT_R16_SINT:
+      case VK_FORMAT_R16_SFLOAT:
+         return 2;
+      case VK_FORMAT_R16G16B16A16_UINT:
+      case VK_FORMAT_R16G16B16A16_SINT:
+      case VK_FORMAT_R16G16B16A16_SFLOAT:
+      case VK_FORMAT_R32G32_UINT:
+      case VK_FORMAT_R32G32_SINT:
+      case VK_FORMAT_R32G32_SFLOAT:
+         return 8;
+      case VK_FORMAT_R32G32B32A32_UINT:
+      case VK_FORMAT_R32G32B32A32_SINT:
+      case VK_FORMAT_R32G32B32A32_SFLOAT:
+         return 16;
+      default:
+         break;
+   }
+   return 4;
+}
+
+/* How a pass's output size derives from the frame: the base
+ * (original, viewport or absolute) and every scale applied on the
+ * way, so that equal descriptions always give equal sizes. */
+static void vulkan_pass_size_desc(std::vector<float> &desc,
+      const std::vector<float> &source_desc,
+      enum glslang_filter_chain_scale type, float scale)
+{
+   desc.clear();
+   if (type == GLSLANG_FILTER_CHAIN_SCALE_SOURCE)
+      desc = source_desc;
+   else
+      desc.push_back(float(type));
+   desc.push_back(scale);
+}
+
+/* Offscreen passes whose output nothing reads any more by the time
+ * another renders can render into the same framebuffer, provided
+ * both have the same format, mip levels and size. Passes with
+ * feedback keep their own, as it is read again next frame. */
+void vulkan_filter_chain::init_aliasing()
+{
+   unsigned i, j;
+   unsigned saved             = 0;
+   size_t saved_bytes         = 0;
+   size_t num_offscreen       = passes.size() - 1;
+   std::vector<unsigned> last_use(num_offscreen);
+   /* Per physical framebuffer: the pass that made it and the last
+    * pass to read the output of any pass rendering into it */
+   std::vector<unsigned> slot_owner;
+   std::vector<unsigned> slot_last_use;
+   std::vector<std::vector<float>> desc_x(num_offscreen + 1);
+   std::vector<std::vector<float>> desc_y(num_offscreen + 1);
+
+   /* The original is the source of the first pass */
+   desc_x[0].push_back(float(GLSLANG_FILTER_CHAIN_SCALE_ORIGINAL));
+   desc_y[0].push_back(float(GLSLANG_FILTER_CHAIN_SCALE_ORIGINAL));
+
+   for (i = 0; i < num_offscreen; i++)
+   {
+      vulkan_pass_size_desc(desc_x[i + 1], desc_x[i],
+            pass_info[i].scale_type_x, pass_info[i].scale_x);
+      vulkan_pass_size_desc(desc_y[i + 1], desc_y[i],
+            pass_info[i].scale_type_y, pass_info[i].scale_y);
+
+      /* The next pass reads it as Source */
+      last_use[i] = i + 1;
+      for (j = i + 2; j < passes.size(); j++)
+      {
+         auto &outputs = passes[j]->get_reflection().semantic_textures[
+            SLANG_TEXTURE_SEMANTIC_PASS_OUTPUT];
+         if (i < outputs.size() && outputs[i].texture)
+            last_use[i] = j;
+      }
+   }
+
+   for (i = 0; i < num_offscreen; i++)
+   {
+      const Framebuffer &fb = passes[i]->get_framebuffer();
+
+      if (!passes[i]->get_feedback_framebuffer())
+      {
+         for (j = 0; j < slot_owner.size(); j++)
+         {
+            unsigned owner             = slot_owner[j];
+            const Framebuffer &slot_fb = passes[owner]->get_framebuffer();
+
+            if (     slot_last_use[j] < i
+                  && !passes[owner]->get_feedback_framebuffer()
+                  && slot_fb.get_format()     == fb.get_format()
+                  && slot_fb.get_max_levels() == fb.get_max_levels()
+                  && desc_x[owner + 1]        == desc_x[i + 1]
+                  && desc_y[owner + 1]        == desc_y[i + 1])
+               break;
+         }
+
+         if (j < slot_owner.size())
+         {
+            saved++;
+            saved_bytes += size_t(fb.get_size().width)
+               * fb.get_size().height
+               * vulkan_format_texel_size(fb.get_format());
+            passes[i]->share_framebuffer(*passes[slot_owner[j]]);
+            slot_last_use[j] = last_use[i];
+            continue;
+         }
+      }
+
+      slot_owner.push_back(i);
+      slot_last_use.push_back(last_use[i]);
+   }
+
+   if (saved)
+      RARCH_LOG("[Vulkan] Sharing framebuffers between passes: %u fewer,"
+            " about %.1f MiB less at the maximum input size.\n",
+            saved, saved_bytes / (1024.0 * 1024.0));
+}
+
 void vulkan_filter_chain::clear_history_and_feedback(VkCommandBuffer cmd)
 {
    unsigned i;
    for (i = 0; i < original_history.size(); i++)
-      vulkan_framebuffer_clear(original_history[i]->get_image(), cmd);
+      if (std::find(inherited.begin(), inherited.end(),
+               original_history[i].get()) == inherited.end())
+         vulkan_framebuffer_clear(original_history[i]->get_image(), cmd);
    for (i = 0; i < passes.size(); i++)
    {
       Framebuffer *fb = passes[i]->get_feedback_framebuffer();
-      if (fb)
+      if (fb && std::find(inherited.begin(), inherited.end(), fb)
+            == inherited.end())
          vulkan_framebuffer_clear(fb->get_image(), cmd);
    }
+   inherited.clear();
+}
+
+void vulkan_filter_chain::inherit_history(vulkan_filter_chain &old)
+{
+   unsigned i;
+
+   /* Sizes follow the input and the viewport on the first frame,
+    * only the format and levels have to match. Both chains keep
+    * their history most recent first, so the frames line up. */
+   for (i = 0; i < original_history.size()
+         && i < old.original_history.size(); i++)
+   {
+      if (     original_history[i]->get_format()
+            != old.original_history[i]->get_format()
+            || original_history[i]->get_max_levels()
+            != old.original_history[i]->get_max_levels())
+         break;
+      swap(original_history[i], old.original_history[i]);
+      inherited.push_back(original_history[i].get());
+   }
+
+   for (i = 0; i < passes.size() && i < old.passes.size(); i++)
+   {
+      Framebuffer *fb     = passes[i]->get_feedback_framebuffer();
+      Framebuffer *old_fb = old.passes[i]->get_feedback_framebuffer();
+
+      if (     !fb || !old_fb
+            || fb->get_format() != old_fb->get_format()
+            || fb->get_max_levels() != old_fb->get_max_levels())
+         continue;
+      passes[i]->swap_feedback_framebuffer(*old.passes[i]);
+      inherited.push_back(passes[i]->get_feedback_framebuffer());
+   }
+
+   if (!inherited.empty())
+      RARCH_LOG("[Vulkan] Kept %u history and feedback framebuffers"
+            " from the previous chain.\n", unsigned(inherited.size()));
+}
+
+/* The offscreen passes from the first that can't sit a frame out,
+ * because it animates, reads history or feedback, or renders into a
+ * framebuffer another pass overwrites, are all re-run every frame. */
+void vulkan_filter_chain::init_static_passes()
+{
+   unsigned i, j;
+   size_t num_offscreen = passes.size() - 1;
+
+   num_static_passes    = 0;
+   num_reused_passes    = 0;
+   static_key.clear();
+   last_static_key.clear();
+
+   for (i = 0; i < num_offscreen; i++)
+   {
+      const Framebuffer *fb = &passes[i]->get_framebuffer();
+
+      if (     passes[i]->is_time_dependent()
+            || passes[i]->get_feedback_framebuffer())
+         break;
+
+      for (j = 0; j < num_offscreen; j++)
+         if (j != i && &passes[j]->get_framebuffer() == fb)
+            break;
+      if (j < num_offscreen)
+         break;
+
+      num_static_passes = i + 1;
+   }
+
+   if (num_static_passes)
+      RARCH_LOG("[Vulkan] %u of %u offscreen passes can be reused on unchanged frames.\n",
+            num_static_passes, (unsigned)num_offscreen);
+}
+
+static void vulkan_static_key_push(std::vector<uint32_t> &key, float value)
+{
+   uint32_t bits;
+   memcpy(&bits, &value, sizeof(bits));
+   key.push_back(bits);
+}
+
+/* Whatever besides the input a static pass sees. Returns true
+ * if it is the same as last frame. */
+bool vulkan_filter_chain::update_static_key(const VkViewport &vp)
+{
+   unsigned i;
+   const video_shader *shader = common.shader_preset.get();
+
+   if (!num_static_passes)
+      return false;
+
+   static_key.clear();
+   static_key.push_back(input_texture.width);
+   static_key.push_back(input_texture.height);
+   static_key.push_back(uint32_t(input_texture.format));
+   static_key.push_back(uint32_t(input_texture.image != VK_NULL_HANDLE));
+   vulkan_static_key_push(static_key, vp.width);
+   vulkan_static_key_push(static_key, vp.height);
+   static_key.push_back(uint32_t(frame_direction));
+   static_key.push_back(rotation);
+   vulkan_static_key_push(static_key, core_aspect);
+   vulkan_static_key_push(static_key, core_aspect_rot);
+   vulkan_static_key_push(static_key, original_fps);
+   if (shader)
+      for (i = 0; i < shader->num_parameters; i++)
+         vulkan_static_key_push(static_key, shader->parameters[i].current);
+
+   if (static_key == last_static_key)
+      return true;
+   swap(static_key, last_static_key);
+   return false;
 }
 
 void vulkan_filter_chain::set_input_texture(
@@ -1444,6 +1729,7 @@ void vulkan_filter_chain::set_simulate_scanline(bool simulate_scanline)
 void vulkan_filter_chain::set_frame_direction(int32_t direction)
 {
    unsigned i;
+   frame_direction = direction;
    for (i = 0; i < passes.size(); i++)
       passes[i]->set_frame_direction(direction);
 }
@@ -1458,6 +1744,7 @@ void vulkan_filter_chain::set_frame_time_delta(uint32_t time_delta)
 void vulkan_filter_chain::set_original_fps(float fps)
 {
    unsigned i;
+   original_fps = fps;
    for (i = 0; i < passes.size(); i++)
       passes[i]->set_original_fps(fps);
 }
@@ -1465,6 +1752,7 @@ void vulkan_filter_chain::set_original_fps(float fps)
 void vulkan_filter_chain::set_rotation(uint32_t rot)
 {
    unsigned i;
+   rotation = rot;
    for (i = 0; i < passes.size(); i++)
       passes[i]->set_rotation(rot);
 }
@@ -1473,6 +1761,7 @@ void vulkan_filter_chain::set_rotation(uint32_t rot)
 void vulkan_filter_chain::set_core_aspect(float coreaspect)
 {
    unsigned i;
+   core_aspect = coreaspect;
    for (i = 0; i < passes.size(); i++)
       passes[i]->set_core_aspect(coreaspect);
 }
@@ -1480,6 +1769,7 @@ void vulkan_filter_chain::set_core_aspect(float coreaspect)
 void vulkan_filter_chain::set_core_aspect_rot(float coreaspectrot)
 {
    unsigned i;
+   core_aspect_rot = coreaspectrot;
    for (i = 0; i < passes.size(); i++)
       passes[i]->set_core_aspect_rot(coreaspectrot);
 }
@@ -2144,6 +2434,35 @@ void Pass::allocate_buffers()
    }
 }
 
+/* Renders something else each frame even from the same input */
+bool Pass::is_time_dependent() const
+{
+   unsigned i;
+   static const slang_semantic semantics[] = {
+      SLANG_SEMANTIC_FRAME_COUNT,
+      SLANG_SEMANTIC_FRAME_TIME_DELTA,
+      SLANG_SEMANTIC_TOTAL_SUBFRAMES,
+      SLANG_SEMANTIC_CURRENT_SUBFRAME,
+   };
+   static const slang_texture_semantic textures[] = {
+      SLANG_TEXTURE_SEMANTIC_ORIGINAL_HISTORY,
+      SLANG_TEXTURE_SEMANTIC_PASS_FEEDBACK,
+   };
+
+   for (i = 0; i < ARRAY_SIZE(semantics); i++)
+      if (     reflection.semantics[semantics[i]].uniform
+            || reflection.semantics[semantics[i]].push_constant)
+         return true;
+
+   for (i = 0; i < ARRAY_SIZE(textures); i++)
+      for (const slang_texture_semantic_meta &meta :
+            reflection.semantic_textures[textures[i]])
+         if (meta.texture)
+            return true;
+
+   return false;
+}
+
 void Pass::end_frame()
 {
    if (fb_feedback)
@@ -2155,7 +2474,7 @@ bool Pass::init_feedback()
    if (final_pass)
       return false;
 
-   fb_feedback = std::unique_ptr<Framebuffer>(
+   fb_feedback = std::shared_ptr<Framebuffer>(
          new Framebuffer(device, memory_properties,
             current_framebuffer_size,
             pass_info.rt_format, pass_info.max_levels));
@@ -2172,7 +2491,7 @@ bool Pass::build()
    fb_feedback.reset();
 
    if (!final_pass)
-      framebuffer = std::unique_ptr<Framebuffer>(
+      framebuffer = std::shared_ptr<Framebuffer>(
             new Framebuffer(device, memory_properties,
                current_framebuffer_size,
                pass_info.rt_format, pass_info.max_levels));
@@ -2867,18 +3186,65 @@ vulkan_filter_chain_t *vulkan_filter_chain_create_default(
    return chain.release();
 }
 
+struct vulkan_filter_chain_preset
+{
+   std::unique_ptr<video_shader> shader;
+   std::vector<glslang_output> outputs;
+   /* Passes before the first that failed to compile */
+   unsigned compiled;
+};
+
+vulkan_filter_chain_preset_t *vulkan_filter_chain_preset_load(
+      const char *path)
+{
+   unsigned i;
+   std::vector<const char*> shader_paths;
+   std::unique_ptr<vulkan_filter_chain_preset> preset{
+      new vulkan_filter_chain_preset() };
+
+   preset->shader.reset(new video_shader());
+   if (!video_shader_load_preset_into_shader(path, preset->shader.get()))
+      return nullptr;
+
+   /* Compile all passes up front, side by side; the rest
+    * of the chain is set up in order */
+   for (i = 0; i < preset->shader->passes; i++)
+      shader_paths.push_back(preset->shader->pass[i].source.path);
+   preset->outputs.resize(preset->shader->passes);
+   preset->compiled = glslang_compile_shaders(shader_paths.data(),
+         preset->outputs.data(), preset->shader->passes);
+
+   return preset.release();
+}
+
+void vulkan_filter_chain_preset_free(vulkan_filter_chain_preset_t *preset)
+{
+   delete preset;
+}
+
 vulkan_filter_chain_t *vulkan_filter_chain_create_from_preset(
       const struct vulkan_filter_chain_create_info *info,
       const char *path, glslang_filter_chain_filter filter)
 {
-   unsigned i;
-   std::unique_ptr<video_shader> shader{ new video_shader() };
+   vulkan_filter_chain_preset_t *preset =
+      vulkan_filter_chain_preset_load(path);
 
-   if (!shader)
+   if (!preset)
       return nullptr;
+   return vulkan_filter_chain_create_from_loaded_preset(info,
+         preset, filter);
+}
 
-    if (!video_shader_load_preset_into_shader(path, shader.get()))
-        return nullptr;
+vulkan_filter_chain_t *vulkan_filter_chain_create_from_loaded_preset(
+      const struct vulkan_filter_chain_create_info *info,
+      vulkan_filter_chain_preset_t *loaded,
+      glslang_filter_chain_filter filter)
+{
+   unsigned i;
+   std::unique_ptr<vulkan_filter_chain_preset> preset{ loaded };
+   std::unique_ptr<video_shader> shader{ std::move(preset->shader) };
+   std::vector<glslang_output> &outputs = preset->outputs;
+   unsigned compiled                    = preset->compiled;
 
    bool last_pass_is_fbo = shader->pass[shader->passes - 1].fbo.flags &
       FBO_SCALE_FLAG_VALID;
@@ -2896,7 +3262,7 @@ vulkan_filter_chain_t *vulkan_filter_chain_create_from_preset(
 
    for (i = 0; i < shader->passes; i++)
    {
-      glslang_output output;
+      glslang_output &output             = outputs[i];
       struct vulkan_filter_chain_pass_info pass_info;
       const video_shader_pass *pass      = &shader->pass[i];
       const video_shader_pass *next_pass =
@@ -2912,7 +3278,7 @@ vulkan_filter_chain_t *vulkan_filter_chain_create_from_preset(
       pass_info.address       = GLSLANG_FILTER_CHAIN_ADDRESS_REPEAT;
       pass_info.max_levels    = 0;
 
-      if (!glslang_compile_shader(pass->source.path, &output))
+      if (i >= compiled)
       {
          RARCH_ERR("[Vulkan] Failed to compile shader: \"%s\".\n",
                pass->source.path);
@@ -3147,6 +3513,12 @@ struct video_shader *vulkan_filter_chain_get_preset(
    return chain->get_shader_preset();
 }
 
+void vulkan_filter_chain_inherit_history(vulkan_filter_chain_t *chain,
+      vulkan_filter_chain_t *old)
+{
+   chain->inherit_history(*old);
+}
+
 void vulkan_filter_chain_free(
       vulkan_filter_chain_t *chain)
 {
@@ -3313,6 +3685,24 @@ void vulkan_filter_chain_end_frame(
    chain->end_frame(cmd);
 }
 
+void vulkan_filter_chain_set_input_changed(
+      vulkan_filter_chain_t *chain, bool changed)
+{
+   chain->set_input_changed(changed);
+}
+
+unsigned vulkan_filter_chain_get_num_static_passes(
+      vulkan_filter_chain_t *chain)
+{
+   return chain->get_num_static_passes();
+}
+
+unsigned vulkan_filter_chain_get_num_reused_passes(
+      vulkan_filter_chain_t *chain)
+{
+   return chain->get_num_reused_passes();
+}
+
 bool vulkan_filter_chain_emits_hdr10(vulkan_filter_chain_t *chain)
 {
    return chain->emits_hdr10();
@@ -32,6 +32,7 @@
 RETRO_BEGIN_DECLS
 
 typedef struct vulkan_filter_chain vulkan_filter_chain_t;
+typedef struct vulkan_filter_chain_preset vulkan_filter_chain_preset_t;
 
 struct vulkan_filter_chain_texture
 {
@@ -158,6 +159,18 @@ void vulkan_filter_chain_build_viewport_pass(vulkan_filter_chain_t *chain,
 void vulkan_filter_chain_end_frame(vulkan_filter_chain_t *chain,
       VkCommandBuffer cmd);
 
+/* Unless told otherwise before each build_offscreen_passes, the
+ * input is taken to have changed. If it hasn't, and no other state
+ * the leading static passes see has either, those keep last frame's
+ * output instead of rendering again. */
+void vulkan_filter_chain_set_input_changed(vulkan_filter_chain_t *chain,
+      bool changed);
+unsigned vulkan_filter_chain_get_num_static_passes(
+      vulkan_filter_chain_t *chain);
+/* Of the last build_offscreen_passes */
+unsigned vulkan_filter_chain_get_num_reused_passes(
+      vulkan_filter_chain_t *chain);
+
 vulkan_filter_chain_t *vulkan_filter_chain_create_default(
       const struct vulkan_filter_chain_create_info *info,
       enum glslang_filter_chain_filter filter);
@@ -166,6 +179,33 @@ vulkan_filter_chain_t *vulkan_filter_chain_create_from_preset(
       const struct vulkan_filter_chain_create_info *info,
       const char *path, enum glslang_filter_chain_filter filter);
 
+/**
+ * vulkan_filter_chain_preset_load:
+ * @path                 : the preset
+ *
+ * Loads a preset and compiles its passes, all the work of
+ * vulkan_filter_chain_create_from_preset() that does not touch
+ * the device, so it may run on any thread.
+ *
+ * Returns: the preset, or NULL if it could not be loaded.
+ **/
+vulkan_filter_chain_preset_t *vulkan_filter_chain_preset_load(
+      const char *path);
+
+void vulkan_filter_chain_preset_free(vulkan_filter_chain_preset_t *preset);
+
+/* Builds a chain from a loaded preset and frees the preset */
+vulkan_filter_chain_t *vulkan_filter_chain_create_from_loaded_preset(
+      const struct vulkan_filter_chain_create_info *info,
+      vulkan_filter_chain_preset_t *preset,
+      enum glslang_filter_chain_filter filter);
+
+/* Hands over the frame history and feedback framebuffers of @old
+ * whose format @chain can use, so that a chain replacing another
+ * does not start from blank frames. Call before @chain renders. */
+void vulkan_filter_chain_inherit_history(vulkan_filter_chain_t *chain,
+      vulkan_filter_chain_t *old);
+
 struct video_shader *vulkan_filter_chain_get_preset(
       vulkan_filter_chain_t *chain);
 
@@ -15,6 +15,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #ifdef HAVE_CONFIG_H
@@ -27,6 +28,24 @@
 /* TODO/FIXME - global */
 static void *video_font_driver = NULL;
 
+/* Menus and widgets measure the same labels every
+ * frame; the widths of short strings are cached,
+ * direct mapped by a hash of the string */
+#define FONT_WIDTH_CACHE_SIZE    256
+#define FONT_WIDTH_CACHE_MAX_LEN 64
+
+typedef struct
+{
+   const font_data_t *font;
+   float scale;
+   int width;
+   uint32_t hash;
+   unsigned len;
+   char msg[FONT_WIDTH_CACHE_MAX_LEN];
+} font_width_cache_entry_t;
+
+static font_width_cache_entry_t font_width_cache[FONT_WIDTH_CACHE_SIZE];
+
 int font_renderer_create_default(
       const font_renderer_driver_t **drv,
       void **handle, const char *font_path, unsigned font_size)
@@ -809,12 +828,41 @@ void font_flush(
 int font_driver_get_message_width(void *font_data,
       const char *msg, size_t len, float scale)
 {
+   size_t i;
+   uint32_t hash;
+   font_width_cache_entry_t *entry;
    font_data_t *font = (font_data_t*)(font_data ? font_data : video_font_driver);
    if (len == 0 && msg)
       len = strlen(msg);
-   if (font && font->renderer && font->renderer->get_message_width)
+   if (!font || !font->renderer || !font->renderer->get_message_width)
+      return -1;
+
+   /* The OSD font (font_data == NULL) is also measured
+    * on the video thread, so only explicitly passed fonts,
+    * which belong to the menu and widgets, are cached */
+   if (!font_data || !msg || len > FONT_WIDTH_CACHE_MAX_LEN)
       return font->renderer->get_message_width(font->renderer_data, msg, len, scale);
-   return -1;
+
+   hash  = 5381;
+   for (i = 0; i < len; i++)
+      hash = (hash << 5) + hash + (uint8_t)msg[i];
+   entry = &font_width_cache[(hash ^ (hash >> 16)) & (FONT_WIDTH_CACHE_SIZE - 1)];
+
+   if (     (entry->font  == font)
+         && (entry->hash  == hash)
+         && (entry->len   == len)
+         && (entry->scale == scale)
+         && !memcmp(entry->msg, msg, len))
+      return entry->width;
+
+   entry->font  = font;
+   entry->scale = scale;
+   entry->hash  = hash;
+   entry->len   = (unsigned)len;
+   entry->width = font->renderer->get_message_width(
+         font->renderer_data, msg, len, scale);
+   memcpy(entry->msg, msg, len);
+   return entry->width;
 }
 
 int font_driver_get_line_height(font_data_t *font, float scale)
@@ -875,6 +923,7 @@ void font_driver_free(font_data_t *font)
 {
    if (font)
    {
+      unsigned i;
       bool is_threaded        = false;
 #ifdef HAVE_THREADS
       bool *is_threaded_tmp   = video_driver_get_threaded();
@@ -884,6 +933,11 @@ void font_driver_free(font_data_t *font)
       if (font->renderer && font->renderer->free)
          font->renderer->free(font->renderer_data, is_threaded);
 
+      /* A new font may get the same address */
+      for (i = 0; i < FONT_WIDTH_CACHE_SIZE; i++)
+         if (font_width_cache[i].font == font)
+            font_width_cache[i].font = NULL;
+
       font->renderer      = NULL;
       font->renderer_data = NULL;
 
@@ -26,6 +26,7 @@
 #include <array/rbuf.h>
 
 #include "gfx_animation.h"
+#include "video_driver.h"
 #include "../performance_counters.h"
 
 #define TICKER_SLOW_SPEED  1666666
@@ -1363,6 +1364,7 @@ bool gfx_animation_ticker_smooth(gfx_animation_ctx_ticker_smooth_t *ticker)
    bool success                 = false;
    bool is_active               = false;
    gfx_animation_t *p_anim      = &anim_st;
+   memarena_t *scratch          = video_driver_frame_scratch();
 
    /* Sanity check */
    if (    string_is_empty(ticker->src_str)
@@ -1385,7 +1387,8 @@ bool gfx_animation_ticker_smooth(gfx_animation_ctx_ticker_smooth_t *ticker)
 
    if (src_str_len > ARRAY_SIZE(small_src_char_widths))
    {
-      if (!(src_char_widths = (unsigned*)calloc(src_str_len, sizeof(unsigned))))
+      if (!(src_char_widths = (unsigned*)memarena_alloc(scratch,
+                  src_str_len * sizeof(unsigned))))
          goto end;
    }
 
@@ -1482,7 +1485,8 @@ bool gfx_animation_ticker_smooth(gfx_animation_ctx_ticker_smooth_t *ticker)
    if ((spacer_len = utf8len(ticker->spacer)) < 1)
       goto end;
 
-   if (!(spacer_char_widths = (unsigned*)calloc(spacer_len,  sizeof(unsigned))))
+   if (!(spacer_char_widths = (unsigned*)memarena_alloc(scratch,
+               spacer_len * sizeof(unsigned))))
       goto end;
 
    str_ptr = ticker->spacer;
@@ -1564,13 +1568,13 @@ end:
 
    if (src_char_widths != small_src_char_widths && src_char_widths)
    {
-      free(src_char_widths);
+      memarena_release(scratch, src_char_widths);
       src_char_widths = NULL;
    }
 
    if (spacer_char_widths)
    {
-      free(spacer_char_widths);
+      memarena_release(scratch, spacer_char_widths);
       spacer_char_widths = NULL;
    }
 
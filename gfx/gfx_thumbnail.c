@@ -27,26 +27,84 @@
 #include <features/features_cpu.h>
 #include <file/file_path.h>
 #include <string/stdstring.h>
+#include <lrc_hash.h>
 
 #include "gfx_display.h"
 #include "gfx_animation.h"
 
 #include "gfx_thumbnail.h"
+#include "gfx_thumbnail_pack.h"
 
 #include "../tasks/tasks_internal.h"
 
 #define DEFAULT_GFX_THUMBNAIL_STREAM_DELAY  16.66667f * 3
 #define DEFAULT_GFX_THUMBNAIL_FADE_DURATION 166.66667f
 
+/* RAM kept for decoded thumbnails, so that an entry
+ * scrolling back on screen is uploaded again without
+ * loading the file again */
+#define GFX_THUMBNAIL_CACHE_SIZE          (32 * 1024 * 1024)
+/* Decoded thumbnails waiting for a texture upload */
+#define GFX_THUMBNAIL_UPLOAD_QUEUE_SIZE   32
+/* Time in us spent on uploads per frame, after the first */
+#define GFX_THUMBNAIL_UPLOAD_BUDGET       4000
+/* Entries past the selection decoded ahead of time,
+ * in the direction it last moved */
+#define GFX_THUMBNAIL_PREFETCH_ENTRIES    2
+
 /* Utility structure, sent as userdata when pushing
  * an image load */
 typedef struct
 {
    uint64_t list_id;
+   /* NULL for a prefetch */
    gfx_thumbnail_t *thumbnail;
+   char *path;
+   unsigned upscale_threshold;
+   bool supports_rgba;
 } gfx_thumbnail_tag_t;
 
+typedef struct gfx_thumbnail_cache_entry
+{
+   /* Next least recently used */
+   struct gfx_thumbnail_cache_entry *next;
+   char *path;
+   /* No pixels while the image is being loaded */
+   struct texture_image image;
+   size_t size;
+   uint32_t hash;
+   unsigned upscale_threshold;
+   /* Queued uploads; the entry is kept until they are done */
+   unsigned pins;
+   bool supports_rgba;
+} gfx_thumbnail_cache_entry_t;
+
+typedef struct
+{
+   uint64_t list_id;
+   gfx_thumbnail_t *thumbnail;
+   gfx_thumbnail_cache_entry_t *entry;
+} gfx_thumbnail_upload_t;
+
+typedef struct
+{
+   /* Most recently used first */
+   gfx_thumbnail_cache_entry_t *entries;
+   gfx_thumbnail_path_data_t *prefetch_path_data;
+   playlist_t *prefetch_playlist;
+   /* Thumbnail pack of the playlist last requested from,
+    * NULL if it has none */
+   gfx_thumbnail_pack_t *pack;
+   size_t size;
+   size_t prefetch_idx;
+   gfx_thumbnail_upload_t uploads[GFX_THUMBNAIL_UPLOAD_QUEUE_SIZE];
+   unsigned upload_head;
+   unsigned upload_count;
+   char pack_playlist[PATH_MAX_LENGTH];
+} gfx_thumbnail_cache_t;
+
 static gfx_thumbnail_state_t gfx_thumb_st = {0}; /* uint64_t alignment */
+static gfx_thumbnail_cache_t gfx_thumb_cache;
 
 gfx_thumbnail_state_t *gfx_thumb_get_ptr(void)
 {
@@ -138,6 +196,194 @@ static void gfx_thumbnail_init_fade(
    }
 }
 
+/* Decoded image cache */
+
+static gfx_thumbnail_cache_entry_t *gfx_thumbnail_cache_find(
+      const char *path, uint32_t hash,
+      unsigned upscale_threshold, bool supports_rgba,
+      gfx_thumbnail_cache_entry_t ***link)
+{
+   gfx_thumbnail_cache_entry_t **next = &gfx_thumb_cache.entries;
+
+   for (; *next; next = &(*next)->next)
+   {
+      gfx_thumbnail_cache_entry_t *entry = *next;
+      if (     (entry->hash == hash)
+            && (entry->upscale_threshold == upscale_threshold)
+            && (entry->supports_rgba == supports_rgba)
+            && string_is_equal(entry->path, path))
+      {
+         if (link)
+            *link = next;
+         return entry;
+      }
+   }
+
+   return NULL;
+}
+
+/* Finds the entry for an image, or adds one that waits
+ * for it to load, and marks it most recently used */
+static gfx_thumbnail_cache_entry_t *gfx_thumbnail_cache_get(
+      const char *path, unsigned upscale_threshold, bool supports_rgba,
+      bool *added)
+{
+   gfx_thumbnail_cache_entry_t **link = NULL;
+   uint32_t hash                      = djb2_calculate(path);
+   gfx_thumbnail_cache_entry_t *entry = gfx_thumbnail_cache_find(
+         path, hash, upscale_threshold, supports_rgba, &link);
+
+   *added = false;
+
+   if (entry)
+      *link = entry->next;
+   else
+   {
+      if (!(entry = (gfx_thumbnail_cache_entry_t*)
+               calloc(1, sizeof(*entry))))
+         return NULL;
+      if (!(entry->path = strdup(path)))
+      {
+         free(entry);
+         return NULL;
+      }
+      entry->hash              = hash;
+      entry->upscale_threshold = upscale_threshold;
+      entry->supports_rgba     = supports_rgba;
+      *added                   = true;
+   }
+
+   entry->next             = gfx_thumb_cache.entries;
+   gfx_thumb_cache.entries = entry;
+   return entry;
+}
+
+static void gfx_thumbnail_cache_free_entry(gfx_thumbnail_cache_entry_t *entry)
+{
+   gfx_thumb_cache.size -= entry->size;
+   image_texture_free(&entry->image);
+   free(entry->path);
+   free(entry);
+}
+
+static void gfx_thumbnail_cache_remove(gfx_thumbnail_cache_entry_t *entry)
+{
+   gfx_thumbnail_cache_entry_t **next = &gfx_thumb_cache.entries;
+
+   for (; *next; next = &(*next)->next)
+   {
+      if (*next == entry)
+      {
+         *next = entry->next;
+         gfx_thumbnail_cache_free_entry(entry);
+         return;
+      }
+   }
+}
+
+/* Drops the least recently used images until the
+ * cache is within budget */
+static void gfx_thumbnail_cache_trim(void)
+{
+   while (gfx_thumb_cache.size > GFX_THUMBNAIL_CACHE_SIZE)
+   {
+      gfx_thumbnail_cache_entry_t **next   = NULL;
+      gfx_thumbnail_cache_entry_t **victim = NULL;
+
+      for (next = &gfx_thumb_cache.entries; *next; next = &(*next)->next)
+         if (!(*next)->pins && (*next)->image.pixels)
+            victim = next;
+
+      if (!victim)
+         break;
+
+      {
+         gfx_thumbnail_cache_entry_t *entry = *victim;
+         *victim = entry->next;
+         gfx_thumbnail_cache_free_entry(entry);
+      }
+   }
+}
+
+/* Uploads a decoded image as the texture of 'thumbnail',
+ * which must be waiting for it */
+static void gfx_thumbnail_upload(gfx_thumbnail_t *thumbnail,
+      struct texture_image *img)
+{
+   /* Sanity check: if thumbnail already has a texture,
+    * we're in some kind of weird error state - in this
+    * case, the best course of action is to just reset
+    * the thumbnail... */
+   if (thumbnail->texture)
+      gfx_thumbnail_reset(thumbnail);
+
+   /* Set thumbnail 'missing' status by default
+    * (saves a number of checks later) */
+   thumbnail->status = GFX_THUMBNAIL_STATUS_MISSING;
+
+   /* Check we have a valid image, and upload
+    * texture to GPU */
+   if (     img
+         && (img->width  >= 1)
+         && (img->height >= 1)
+         && video_driver_texture_load(
+            img, TEXTURE_FILTER_MIPMAP_LINEAR,
+            &thumbnail->texture))
+   {
+      /* Cache dimensions */
+      thumbnail->width  = img->width;
+      thumbnail->height = img->height;
+
+      /* Update thumbnail status */
+      thumbnail->status = GFX_THUMBNAIL_STATUS_AVAILABLE;
+   }
+
+   /* Trigger 'fade in' animation, if required */
+   gfx_thumbnail_init_fade(&gfx_thumb_st, thumbnail);
+
+   /* The thumbnail shows even without a fade */
+   disp_get_ptr()->flags |= GFX_DISP_FLAG_FB_DIRTY;
+}
+
+/* Uploads the oldest queued thumbnail */
+static void gfx_thumbnail_upload_next(void)
+{
+   gfx_thumbnail_cache_t *cache   = &gfx_thumb_cache;
+   gfx_thumbnail_upload_t *upload = &cache->uploads[cache->upload_head];
+
+   cache->upload_head  = (cache->upload_head + 1)
+      % GFX_THUMBNAIL_UPLOAD_QUEUE_SIZE;
+   cache->upload_count--;
+   upload->entry->pins--;
+
+   /* Skip thumbnails of a previous list, and those
+    * reset since */
+   if (     (upload->list_id == gfx_thumb_st.list_id)
+         && (upload->thumbnail->status == GFX_THUMBNAIL_STATUS_PENDING))
+      gfx_thumbnail_upload(upload->thumbnail, &upload->entry->image);
+}
+
+/* Queues the upload of a cached image, making room
+ * if the queue is full */
+static void gfx_thumbnail_queue_upload(gfx_thumbnail_t *thumbnail,
+      gfx_thumbnail_cache_entry_t *entry)
+{
+   gfx_thumbnail_cache_t *cache = &gfx_thumb_cache;
+   gfx_thumbnail_upload_t *upload;
+
+   if (cache->upload_count >= GFX_THUMBNAIL_UPLOAD_QUEUE_SIZE)
+      gfx_thumbnail_upload_next();
+
+   upload            = &cache->uploads[
+      (cache->upload_head + cache->upload_count)
+      % GFX_THUMBNAIL_UPLOAD_QUEUE_SIZE];
+   upload->list_id   = gfx_thumb_st.list_id;
+   upload->thumbnail = thumbnail;
+   upload->entry     = entry;
+   entry->pins++;
+   cache->upload_count++;
+}
+
 /* Used to process thumbnail data following completion
  * of image load task */
 static void gfx_thumbnail_handle_upload(
@@ -146,53 +392,51 @@ static void gfx_thumbnail_handle_upload(
    gfx_thumbnail_state_t *p_gfx_thumb = &gfx_thumb_st;
    struct texture_image *img          = (struct texture_image*)task_data;
    gfx_thumbnail_tag_t *thumbnail_tag = (gfx_thumbnail_tag_t*)user_data;
-   bool fade_enabled                  = false;
+   gfx_thumbnail_cache_entry_t *entry = NULL;
+   bool valid                         = img
+      && img->pixels && (img->width >= 1) && (img->height >= 1);
 
    /* Sanity check */
    if (!thumbnail_tag)
       goto end;
 
+   /* Keep the image whichever list it was loaded for,
+    * or drop the entry that waited for it */
+   entry = gfx_thumbnail_cache_find(thumbnail_tag->path,
+         djb2_calculate(thumbnail_tag->path),
+         thumbnail_tag->upscale_threshold,
+         thumbnail_tag->supports_rgba, NULL);
+   if (entry && !entry->image.pixels)
+   {
+      if (valid)
+      {
+         entry->image          = *img;
+         entry->size           = img->width * img->height
+            * sizeof(uint32_t);
+         gfx_thumb_cache.size += entry->size;
+         img->pixels           = NULL;
+      }
+      else
+      {
+         gfx_thumbnail_cache_remove(entry);
+         entry = NULL;
+      }
+   }
+
    /* Ensure that we are operating on the correct
     * thumbnail... */
-   if (thumbnail_tag->list_id != p_gfx_thumb->list_id)
+   if (     !thumbnail_tag->thumbnail
+         || (thumbnail_tag->list_id != p_gfx_thumb->list_id))
       goto end;
 
    /* Only process image if we are waiting for it */
    if (thumbnail_tag->thumbnail->status != GFX_THUMBNAIL_STATUS_PENDING)
       goto end;
 
-   /* Sanity check: if thumbnail already has a texture,
-    * we're in some kind of weird error state - in this
-    * case, the best course of action is to just reset
-    * the thumbnail... */
-   if (thumbnail_tag->thumbnail->texture)
-      gfx_thumbnail_reset(thumbnail_tag->thumbnail);
-
-   /* Set thumbnail 'missing' status by default
-    * (saves a number of checks later) */
-   thumbnail_tag->thumbnail->status = GFX_THUMBNAIL_STATUS_MISSING;
-
-   /* If we reach this stage, thumbnail 'fade in'
-    * animations should be applied (based on current
-    * thumbnail status and global configuration) */
-   fade_enabled = true;
-
-   /* Check we have a valid image */
-   if (!img || (img->width < 1) || (img->height < 1))
-      goto end;
-
-   /* Upload texture to GPU */
-   if (!video_driver_texture_load(
-            img, TEXTURE_FILTER_MIPMAP_LINEAR,
-            &thumbnail_tag->thumbnail->texture))
-      goto end;
-
-   /* Cache dimensions */
-   thumbnail_tag->thumbnail->width  = img->width;
-   thumbnail_tag->thumbnail->height = img->height;
-
-   /* Update thumbnail status */
-   thumbnail_tag->thumbnail->status = GFX_THUMBNAIL_STATUS_AVAILABLE;
+   if (entry && entry->image.pixels)
+      gfx_thumbnail_queue_upload(thumbnail_tag->thumbnail, entry);
+   else
+      gfx_thumbnail_upload(thumbnail_tag->thumbnail, valid ? img : NULL);
 
 end:
    /* Clean up */
@@ -204,13 +448,153 @@ end:
 
    if (thumbnail_tag)
    {
-      /* Trigger 'fade in' animation, if required */
-      if (fade_enabled)
-         gfx_thumbnail_init_fade(p_gfx_thumb,
-               thumbnail_tag->thumbnail);
+      free(thumbnail_tag->path);
+      free(thumbnail_tag);
+   }
+
+   gfx_thumbnail_cache_trim();
+}
+
+/* Starts loading the image at 'path' into the cache and,
+ * unless it is NULL, sets it as the texture of 'thumbnail'.
+ * Returns true if the image is being loaded or is queued
+ * for upload. */
+static bool gfx_thumbnail_load(const char *path,
+      gfx_thumbnail_t *thumbnail, unsigned upscale_threshold)
+{
+   bool added                         = false;
+   bool supports_rgba                 = video_driver_supports_rgba();
+   gfx_thumbnail_tag_t *thumbnail_tag = NULL;
+   gfx_thumbnail_cache_entry_t *entry = gfx_thumbnail_cache_get(
+         path, upscale_threshold, supports_rgba, &added);
+
+   if (entry && entry->image.pixels)
+   {
+      if (thumbnail)
+         gfx_thumbnail_queue_upload(thumbnail, entry);
+      return true;
+   }
 
+   /* Already on its way */
+   if (entry && !added && !thumbnail)
+      return true;
+
+   if (!(thumbnail_tag = (gfx_thumbnail_tag_t*)
+            malloc(sizeof(gfx_thumbnail_tag_t))))
+      goto error;
+
+   /* Configure user data */
+   thumbnail_tag->thumbnail         = thumbnail;
+   thumbnail_tag->list_id           = gfx_thumb_st.list_id;
+   thumbnail_tag->upscale_threshold = upscale_threshold;
+   thumbnail_tag->supports_rgba     = supports_rgba;
+   if (!(thumbnail_tag->path = strdup(path)))
+      goto error;
+
+   /* Would like to cancel any existing image load tasks
+    * here, but can't see how to do it... */
+   if (task_push_image_load(
+            path, supports_rgba, upscale_threshold,
+            gfx_thumbnail_handle_upload, thumbnail_tag))
+      return true;
+
+error:
+   if (thumbnail_tag)
+   {
+      free(thumbnail_tag->path);
       free(thumbnail_tag);
    }
+   if (added)
+      gfx_thumbnail_cache_remove(entry);
+   return false;
+}
+
+/* Sets the texture of 'thumbnail' from the thumbnail pack
+ * of 'playlist', if it has one with the image.
+ * Returns true if the image is queued for upload. */
+static bool gfx_thumbnail_load_packed(
+      gfx_thumbnail_path_data_t *path_data,
+      enum gfx_thumbnail_id thumbnail_id,
+      playlist_t *playlist, size_t idx,
+      gfx_thumbnail_t *thumbnail)
+{
+   char cache_path[PATH_MAX_LENGTH];
+   struct texture_image img;
+   uint32_t key;
+   bool added                         = false;
+   bool supports_rgba                 = video_driver_supports_rgba();
+   gfx_thumbnail_cache_t *cache       = &gfx_thumb_cache;
+   const struct playlist_entry *entry = NULL;
+   gfx_thumbnail_cache_entry_t *cached = NULL;
+   const char *playlist_path          = NULL;
+   unsigned type                      = gfx_thumbnail_get_type_index(
+         path_data, thumbnail_id);
+
+   if (!playlist || !type)
+      return false;
+
+   playlist_path = playlist_get_conf_path(playlist);
+   if (string_is_empty(playlist_path))
+      return false;
+
+   /* Open the playlist's pack, or note that it has none,
+    * once per playlist */
+   if (!string_is_equal(cache->pack_playlist, playlist_path))
+   {
+      char pack_path[PATH_MAX_LENGTH];
+
+      gfx_thumbnail_pack_close(cache->pack);
+      strlcpy(cache->pack_playlist, playlist_path,
+            sizeof(cache->pack_playlist));
+      gfx_thumbnail_pack_get_path(playlist_path,
+            pack_path, sizeof(pack_path));
+      cache->pack = gfx_thumbnail_pack_open(pack_path);
+   }
+
+   if (!cache->pack)
+      return false;
+
+   playlist_get_index(playlist, idx, &entry);
+   if (!entry)
+      return false;
+
+   key = gfx_thumbnail_pack_entry_key(entry);
+   snprintf(cache_path, sizeof(cache_path), "%s#%u#%u#%08x",
+         playlist_path, (unsigned)idx, type, (unsigned)key);
+
+   if (!(cached = gfx_thumbnail_cache_get(cache_path, 0,
+               supports_rgba, &added)))
+      return false;
+
+   if (!cached->image.pixels)
+   {
+      /* Packed thumbnails are small and ready to use, so
+       * they are read here rather than on a task */
+      if (!gfx_thumbnail_pack_read(cache->pack, idx, type, key,
+               supports_rgba, &img))
+      {
+         if (added)
+            gfx_thumbnail_cache_remove(cached);
+         return false;
+      }
+
+      cached->image = img;
+      cached->size  = img.width * img.height * sizeof(uint32_t);
+      cache->size  += cached->size;
+   }
+
+   gfx_thumbnail_queue_upload(thumbnail, cached);
+   gfx_thumbnail_cache_trim();
+   return true;
+}
+
+/* Makes the next request open the current playlist's
+ * thumbnail pack again */
+void gfx_thumbnail_pack_reset(void)
+{
+   gfx_thumbnail_pack_close(gfx_thumb_cache.pack);
+   gfx_thumb_cache.pack             = NULL;
+   gfx_thumb_cache.pack_playlist[0] = '\0';
 }
 
 /* Core interface */
@@ -269,6 +653,114 @@ static bool gfx_thumbnail_get_path(
 }
 
 
+/* Uploads the thumbnails queued since the last call,
+ * as many as fit in the time budget
+ * > Must be called once per frame, from the main thread */
+void gfx_thumbnail_process_uploads(void)
+{
+   gfx_thumbnail_cache_t *cache = &gfx_thumb_cache;
+   retro_time_t start;
+
+   if (!cache->upload_count)
+      return;
+
+   start = cpu_features_get_time_usec();
+
+   do
+   {
+      gfx_thumbnail_upload_next();
+   } while (cache->upload_count
+         && (cpu_features_get_time_usec() - start
+            < GFX_THUMBNAIL_UPLOAD_BUDGET));
+
+   gfx_thumbnail_cache_trim();
+}
+
+/* Decodes the thumbnails of the entries following 'idx'
+ * in the direction the selection moved since the last
+ * call, so that they are cached when reached
+ * > 'path_data' is the caller's, with the system set */
+void gfx_thumbnail_prefetch(
+      gfx_thumbnail_path_data_t *path_data,
+      playlist_t *playlist, size_t idx,
+      unsigned gfx_thumbnail_upscale_threshold)
+{
+   unsigned i;
+   size_t list_size;
+   bool forward;
+   gfx_thumbnail_cache_t *cache = &gfx_thumb_cache;
+
+   if (!path_data || !playlist)
+      return;
+
+   if (     (cache->prefetch_playlist != playlist)
+         || (cache->prefetch_idx == idx))
+   {
+      cache->prefetch_playlist = playlist;
+      cache->prefetch_idx      = idx;
+      return;
+   }
+
+   forward             = idx > cache->prefetch_idx;
+   cache->prefetch_idx = idx;
+   list_size           = playlist_size(playlist);
+
+   if (!cache->prefetch_path_data && !(cache->prefetch_path_data =
+            (gfx_thumbnail_path_data_t*)malloc(sizeof(*path_data))))
+      return;
+
+   /* Work on a copy; the caller's still describes
+    * the selection */
+   memcpy(cache->prefetch_path_data, path_data, sizeof(*path_data));
+
+   for (i = 1; i <= GFX_THUMBNAIL_PREFETCH_ENTRIES; i++)
+   {
+      unsigned j;
+      size_t entry_idx = forward ? idx + i : idx - i;
+
+      if (forward ? (entry_idx >= list_size) : (i > idx))
+         break;
+
+      if (!gfx_thumbnail_set_content_playlist(
+               cache->prefetch_path_data, playlist, entry_idx))
+         continue;
+
+      for (j = GFX_THUMBNAIL_RIGHT; j <= GFX_THUMBNAIL_LEFT; j++)
+      {
+         const char *thumbnail_path         = NULL;
+         enum gfx_thumbnail_id thumbnail_id = (enum gfx_thumbnail_id)j;
+
+         if (     gfx_thumbnail_is_enabled(cache->prefetch_path_data,
+                     thumbnail_id)
+               && gfx_thumbnail_update_path(cache->prefetch_path_data,
+                     thumbnail_id)
+               && gfx_thumbnail_get_path(cache->prefetch_path_data,
+                     thumbnail_id, &thumbnail_path)
+               && path_is_valid(thumbnail_path))
+            gfx_thumbnail_load(thumbnail_path, NULL,
+                  gfx_thumbnail_upscale_threshold);
+      }
+   }
+}
+
+/* Drops every cached image and queued upload
+ * > Textures already uploaded are left alone */
+void gfx_thumbnail_cache_free(void)
+{
+   gfx_thumbnail_cache_t *cache = &gfx_thumb_cache;
+
+   while (cache->entries)
+   {
+      gfx_thumbnail_cache_entry_t *entry = cache->entries;
+      cache->entries                     = entry->next;
+      gfx_thumbnail_cache_free_entry(entry);
+   }
+
+   gfx_thumbnail_pack_close(cache->pack);
+   free(cache->prefetch_path_data);
+   memset(cache, 0, sizeof(*cache));
+}
+
 /* Requests loading of the specified thumbnail
  * - If operation fails, 'thumbnail->status' will be set to
  *   GFX_THUMBNAIL_STATUS_MISSING
@@ -303,7 +795,11 @@ void gfx_thumbnail_request(
    /* Update/extract thumbnail path */
    if (gfx_thumbnail_is_enabled(path_data, thumbnail_id))
    {
-      if (gfx_thumbnail_update_path(path_data, thumbnail_id))
+      /* A thumbnail pack saves looking for the image file */
+      if (gfx_thumbnail_load_packed(path_data, thumbnail_id,
+               playlist, idx, thumbnail))
+         thumbnail->status = GFX_THUMBNAIL_STATUS_PENDING;
+      else if (gfx_thumbnail_update_path(path_data, thumbnail_id))
       {
          const char *thumbnail_path = NULL;
          if (gfx_thumbnail_get_path(path_data, thumbnail_id, &thumbnail_path))
@@ -311,22 +807,8 @@ void gfx_thumbnail_request(
             /* Load thumbnail, if required */
             if (path_is_valid(thumbnail_path))
             {
-               gfx_thumbnail_tag_t *thumbnail_tag =
-                  (gfx_thumbnail_tag_t*)malloc(sizeof(gfx_thumbnail_tag_t));
-
-               if (!thumbnail_tag)
-                  goto end;
-
-               /* Configure user data */
-               thumbnail_tag->thumbnail = thumbnail;
-               thumbnail_tag->list_id   = p_gfx_thumb->list_id;
-
-               /* Would like to cancel any existing image load tasks
-                * here, but can't see how to do it... */
-               if (task_push_image_load(
-                        thumbnail_path, video_driver_supports_rgba(),
-                        gfx_thumbnail_upscale_threshold,
-                        gfx_thumbnail_handle_upload, thumbnail_tag))
+               if (gfx_thumbnail_load(thumbnail_path, thumbnail,
+                        gfx_thumbnail_upscale_threshold))
                   thumbnail->status = GFX_THUMBNAIL_STATUS_PENDING;
             }
 #ifdef HAVE_NETWORKING
@@ -402,9 +884,6 @@ void gfx_thumbnail_request_file(
       const char *file_path, gfx_thumbnail_t *thumbnail,
       unsigned gfx_thumbnail_upscale_threshold)
 {
-   gfx_thumbnail_state_t *p_gfx_thumb = &gfx_thumb_st;
-   gfx_thumbnail_tag_t *thumbnail_tag = NULL;
-
    if (!thumbnail)
       return;
 
@@ -419,19 +898,8 @@ void gfx_thumbnail_request_file(
       return;
 
    /* Load thumbnail */
-   if (!(thumbnail_tag = (gfx_thumbnail_tag_t*)malloc(sizeof(gfx_thumbnail_tag_t))))
-      return;
-
-   /* Configure user data */
-   thumbnail_tag->thumbnail = thumbnail;
-   thumbnail_tag->list_id   = p_gfx_thumb->list_id;
-
-   /* Would like to cancel any existing image load tasks
-    * here, but can't see how to do it... */
-   if (task_push_image_load(
-         file_path, video_driver_supports_rgba(),
-         gfx_thumbnail_upscale_threshold,
-         gfx_thumbnail_handle_upload, thumbnail_tag))
+   if (gfx_thumbnail_load(file_path, thumbnail,
+            gfx_thumbnail_upscale_threshold))
       thumbnail->status = GFX_THUMBNAIL_STATUS_PENDING;
 }
 
@@ -161,6 +161,31 @@ void gfx_thumbnail_set_fade_missing(bool fade_missing);
  *    heap-use-after-free errors *will* occur */
 void gfx_thumbnail_cancel_pending_requests(void);
 
+/* Uploads the thumbnails loaded since the last call,
+ * as many as fit in a few ms
+ * > Decoded images are kept in a cache bounded by a
+ *   memory budget, so thumbnails requested again are
+ *   uploaded without loading them again
+ * > Must be called once per frame, from the main thread */
+void gfx_thumbnail_process_uploads(void);
+
+/* Loads the thumbnails of the playlist entries past
+ * 'idx', in the direction the selection moved since the
+ * last call, into the cache
+ * > Leaves 'path_data' alone
+ * NOTE: Must be called *after* gfx_thumbnail_set_system() */
+void gfx_thumbnail_prefetch(
+      gfx_thumbnail_path_data_t *path_data,
+      playlist_t *playlist, size_t idx,
+      unsigned gfx_thumbnail_upscale_threshold);
+
+/* Frees the cache of decoded thumbnails */
+void gfx_thumbnail_cache_free(void);
+
+/* Closes the thumbnail pack in use, so that a rebuilt
+ * one is opened by the next request */
+void gfx_thumbnail_pack_reset(void);
+
 /* Requests loading of the specified thumbnail
  * - If operation fails, 'thumbnail->status' will be set to
  *   MUI_THUMBNAIL_STATUS_MISSING
@@ -0,0 +1,486 @@
+/* Copyright  (C) 2010-2019 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (gfx_thumbnail_pack.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <retro_endianness.h>
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+#include <lrc_hash.h>
+#ifdef HAVE_ZLIB
+#include <streams/trans_stream.h>
+#endif
+
+#include "gfx_thumbnail_pack.h"
+
+#define GFX_THUMBNAIL_PACK_VERSION     1
+#define GFX_THUMBNAIL_PACK_HEADER_SIZE 12
+/* offset (low, high), stored length, size, key */
+#define GFX_THUMBNAIL_PACK_RECORD_SIZE 20
+#define GFX_THUMBNAIL_PACK_PIXELS_SIZE (GFX_THUMBNAIL_PACK_MAX_SIZE \
+      * GFX_THUMBNAIL_PACK_MAX_SIZE * sizeof(uint32_t))
+
+struct gfx_thumbnail_pack
+{
+   RFILE *file;
+   /* Index as read from the file */
+   uint32_t *index;
+   size_t entries;
+};
+
+struct gfx_thumbnail_pack_writer
+{
+   RFILE *file;
+   uint32_t *index;
+   /* Scaled down thumbnail */
+   uint32_t *pixels;
+   /* Deflated thumbnail */
+   uint8_t *packed;
+   char *path;
+   char *tmp_path;
+   size_t entries;
+   uint64_t offset;
+};
+
+static const uint8_t gfx_thumbnail_pack_magic[4] = { 'R', 'A', 'T', 'P' };
+
+static void gfx_thumbnail_pack_swap(uint32_t *data, size_t len)
+{
+#ifdef MSB_FIRST
+   size_t i;
+   for (i = 0; i < len; i++)
+      data[i] = SWAP32(data[i]);
+#endif
+}
+
+size_t gfx_thumbnail_pack_get_path(const char *playlist_path,
+      char *s, size_t len)
+{
+   size_t _len = strlcpy(s, playlist_path, len);
+   path_remove_extension(s);
+   _len        = strlen(s);
+   return _len + strlcpy(s + _len, ".thpk", len - _len);
+}
+
+uint32_t gfx_thumbnail_pack_entry_key(const struct playlist_entry *entry)
+{
+   uint32_t key = djb2_calculate(entry->path  ? entry->path  : "");
+   return (key * 33) ^ djb2_calculate(entry->label ? entry->label : "");
+}
+
+gfx_thumbnail_pack_t *gfx_thumbnail_pack_open(const char *path)
+{
+   uint32_t header[GFX_THUMBNAIL_PACK_HEADER_SIZE / 4];
+   size_t index_size;
+   gfx_thumbnail_pack_t *pack = NULL;
+   RFILE *file                = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return NULL;
+
+   if (filestream_read(file, header, sizeof(header)) != sizeof(header))
+      goto error;
+   if (     memcmp(header, gfx_thumbnail_pack_magic, 4)
+         || (retro_le_to_cpu32(header[1]) != GFX_THUMBNAIL_PACK_VERSION))
+      goto error;
+
+   if (!(pack = (gfx_thumbnail_pack_t*)calloc(1, sizeof(*pack))))
+      goto error;
+
+   pack->file    = file;
+   pack->entries = retro_le_to_cpu32(header[2]);
+   index_size    = pack->entries * GFX_THUMBNAIL_PACK_TYPES
+      * GFX_THUMBNAIL_PACK_RECORD_SIZE;
+
+   if (     !pack->entries
+         || !(pack->index = (uint32_t*)malloc(index_size))
+         || (filestream_read(file, pack->index, index_size)
+            != (int64_t)index_size))
+      goto error;
+
+   gfx_thumbnail_pack_swap(pack->index, index_size / 4);
+   return pack;
+
+error:
+   if (pack)
+   {
+      free(pack->index);
+      free(pack);
+   }
+   filestream_close(file);
+   return NULL;
+}
+
+void gfx_thumbnail_pack_close(gfx_thumbnail_pack_t *pack)
+{
+   if (!pack)
+      return;
+   filestream_close(pack->file);
+   free(pack->index);
+   free(pack);
+}
+
+/* Reads 'len' bytes of pixels stored in 'stored_len'
+ * bytes, deflated unless the two are equal */
+static bool gfx_thumbnail_pack_read_pixels(RFILE *file,
+      uint32_t *pixels, size_t len, size_t stored_len)
+{
+   bool ret = true;
+#ifdef HAVE_ZLIB
+   uint8_t *packed;
+   void *stream;
+   uint32_t rd, wn;
+   const struct trans_stream_backend *backend;
+#endif
+
+   if (stored_len == len)
+      return filestream_read(file, pixels, len) == (int64_t)len;
+
+#ifdef HAVE_ZLIB
+   if (!(packed = (uint8_t*)malloc(stored_len)))
+      return false;
+
+   backend = trans_stream_get_zlib_inflate_backend();
+   stream  = backend->stream_new();
+   ret     = stream
+      && (filestream_read(file, packed, stored_len) == (int64_t)stored_len);
+
+   if (ret)
+   {
+      backend->set_in(stream, packed, (uint32_t)stored_len);
+      backend->set_out(stream, (uint8_t*)pixels, (uint32_t)len);
+      ret = backend->trans(stream, true, &rd, &wn, NULL) && (wn == len);
+   }
+
+   if (stream)
+      backend->stream_free(stream);
+   free(packed);
+#else
+   ret = false;
+#endif
+
+   return ret;
+}
+
+bool gfx_thumbnail_pack_read(gfx_thumbnail_pack_t *pack,
+      size_t idx, unsigned type, uint32_t key,
+      bool supports_rgba, struct texture_image *img)
+{
+   size_t i, len;
+   int64_t offset;
+   unsigned width, height;
+   const uint32_t *record;
+
+   if (     !pack
+         || (idx >= pack->entries)
+         || (type < 1) || (type > GFX_THUMBNAIL_PACK_TYPES))
+      return false;
+
+   record = pack->index + (idx * GFX_THUMBNAIL_PACK_TYPES + type - 1)
+      * (GFX_THUMBNAIL_PACK_RECORD_SIZE / 4);
+   offset = (int64_t)(((uint64_t)record[1] << 32) | record[0]);
+   width  = record[3] >> 16;
+   height = record[3] & 0xffff;
+
+   if (!offset || (record[4] != key) || !width || !height)
+      return false;
+
+   len = (size_t)width * height;
+   if (!(img->pixels = (uint32_t*)malloc(len * sizeof(uint32_t))))
+      return false;
+
+   if (     (filestream_seek(pack->file, offset,
+               RETRO_VFS_SEEK_POSITION_START) != 0)
+         || !gfx_thumbnail_pack_read_pixels(pack->file, img->pixels,
+               len * sizeof(uint32_t), record[2]))
+   {
+      free(img->pixels);
+      img->pixels = NULL;
+      return false;
+   }
+
+   gfx_thumbnail_pack_swap(img->pixels, len);
+
+   /* ARGB to ABGR */
+   if (supports_rgba)
+      for (i = 0; i < len; i++)
+      {
+         uint32_t col   = img->pixels[i];
+         img->pixels[i] = (col & 0xff00ff00)
+            | ((col & 0xff) << 16) | ((col >> 16) & 0xff);
+      }
+
+   img->width         = width;
+   img->height        = height;
+   img->supports_rgba = supports_rgba;
+   return true;
+}
+
+gfx_thumbnail_pack_writer_t *gfx_thumbnail_pack_writer_new(
+      const char *path, size_t entries)
+{
+   size_t _len;
+   char tmp_path[PATH_MAX_LENGTH];
+   uint32_t header[GFX_THUMBNAIL_PACK_HEADER_SIZE / 4];
+   size_t index_size                   = entries * GFX_THUMBNAIL_PACK_TYPES
+      * GFX_THUMBNAIL_PACK_RECORD_SIZE;
+   gfx_thumbnail_pack_writer_t *writer = NULL;
+
+   if (string_is_empty(path) || !entries)
+      return NULL;
+
+   if (!(writer = (gfx_thumbnail_pack_writer_t*)calloc(1, sizeof(*writer))))
+      return NULL;
+
+   _len = strlcpy(tmp_path, path, sizeof(tmp_path));
+   strlcpy(tmp_path + _len, ".tmp", sizeof(tmp_path) - _len);
+
+   writer->entries  = entries;
+   writer->offset   = GFX_THUMBNAIL_PACK_HEADER_SIZE + index_size;
+   writer->path     = strdup(path);
+   writer->tmp_path = strdup(tmp_path);
+   writer->index    = (uint32_t*)calloc(1, index_size);
+   writer->pixels   = (uint32_t*)malloc(GFX_THUMBNAIL_PACK_PIXELS_SIZE);
+   writer->packed   = (uint8_t*)malloc(GFX_THUMBNAIL_PACK_PIXELS_SIZE);
+
+   if (     !writer->path || !writer->tmp_path || !writer->index
+         || !writer->pixels || !writer->packed)
+      goto error;
+
+   if (!(writer->file = filestream_open(tmp_path,
+               RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      goto error;
+
+   /* The index is written over this once complete */
+   memcpy(header, gfx_thumbnail_pack_magic, 4);
+   header[1] = retro_cpu_to_le32(GFX_THUMBNAIL_PACK_VERSION);
+   header[2] = retro_cpu_to_le32((uint32_t)entries);
+   if (     (filestream_write(writer->file, header, sizeof(header))
+            != sizeof(header))
+         || (filestream_write(writer->file, writer->index, index_size)
+            != (int64_t)index_size))
+      goto error;
+
+   return writer;
+
+error:
+   gfx_thumbnail_pack_writer_free(writer);
+   return NULL;
+}
+
+/* Scales 'img' down to fit GFX_THUMBNAIL_PACK_MAX_SIZE,
+ * averaging the source pixels under each output pixel */
+static void gfx_thumbnail_pack_downscale(uint32_t *out,
+      unsigned out_width, unsigned out_height,
+      const struct texture_image *img)
+{
+   unsigned x, y;
+
+   for (y = 0; y < out_height; y++)
+   {
+      unsigned y0 = (unsigned)((uint64_t)y       * img->height / out_height);
+      unsigned y1 = (unsigned)((uint64_t)(y + 1) * img->height / out_height);
+
+      for (x = 0; x < out_width; x++)
+      {
+         unsigned sx, sy;
+         uint32_t sum[4] = {0};
+         unsigned x0     = (unsigned)((uint64_t)x       * img->width / out_width);
+         unsigned x1     = (unsigned)((uint64_t)(x + 1) * img->width / out_width);
+         unsigned count  = (x1 - x0) * (y1 - y0);
+
+         for (sy = y0; sy < y1; sy++)
+         {
+            const uint32_t *row = img->pixels + (size_t)sy * img->width;
+            for (sx = x0; sx < x1; sx++)
+            {
+               uint32_t col = row[sx];
+               sum[0]      += (col >> 24);
+               sum[1]      += (col >> 16) & 0xff;
+               sum[2]      += (col >>  8) & 0xff;
+               sum[3]      +=  col        & 0xff;
+            }
+         }
+
+         out[(size_t)y * out_width + x] =
+                 ((sum[0] / count) << 24)
+               | ((sum[1] / count) << 16)
+               | ((sum[2] / count) <<  8)
+               |  (sum[3] / count);
+      }
+   }
+}
+
+bool gfx_thumbnail_pack_writer_add(gfx_thumbnail_pack_writer_t *writer,
+      size_t idx, unsigned type, uint32_t key,
+      const struct texture_image *img)
+{
+   uint32_t *record;
+   size_t len, stored_len;
+   unsigned width, height;
+   const uint32_t *pixels;
+   const void *stored;
+
+   if (     !writer
+         || (idx >= writer->entries)
+         || (type < 1) || (type > GFX_THUMBNAIL_PACK_TYPES)
+         || !img || !img->pixels || !img->width || !img->height)
+      return false;
+
+   width  = img->width;
+   height = img->height;
+   pixels = img->pixels;
+
+   if (     (width  > GFX_THUMBNAIL_PACK_MAX_SIZE)
+         || (height > GFX_THUMBNAIL_PACK_MAX_SIZE))
+   {
+      if (width >= height)
+      {
+         height = (unsigned)((uint64_t)height
+               * GFX_THUMBNAIL_PACK_MAX_SIZE / width);
+         width  = GFX_THUMBNAIL_PACK_MAX_SIZE;
+      }
+      else
+      {
+         width  = (unsigned)((uint64_t)width
+               * GFX_THUMBNAIL_PACK_MAX_SIZE / height);
+         height = GFX_THUMBNAIL_PACK_MAX_SIZE;
+      }
+      if (!width)
+         width  = 1;
+      if (!height)
+         height = 1;
+
+      gfx_thumbnail_pack_downscale(writer->pixels, width, height, img);
+      pixels = writer->pixels;
+   }
+
+   len        = (size_t)width * height * sizeof(uint32_t);
+   stored     = pixels;
+   stored_len = len;
+
+#ifdef MSB_FIRST
+   if (pixels != writer->pixels)
+   {
+      memcpy(writer->pixels, pixels, len);
+      pixels = writer->pixels;
+   }
+   gfx_thumbnail_pack_swap(writer->pixels, len / 4);
+   stored = pixels;
+#endif
+
+#ifdef HAVE_ZLIB
+   {
+      uint32_t rd, wn;
+      enum trans_stream_error err                = TRANS_STREAM_ERROR_NONE;
+      const struct trans_stream_backend *backend =
+         trans_stream_get_zlib_deflate_backend();
+      void *stream                               = backend->stream_new();
+
+      /* Kept as is if deflate doesn't make it smaller */
+      if (stream)
+      {
+         backend->define(stream, "level", 6);
+         backend->set_in(stream, (const uint8_t*)pixels, (uint32_t)len);
+         backend->set_out(stream, writer->packed,
+               (uint32_t)(len - 1));
+         if (     backend->trans(stream, true, &rd, &wn, &err)
+               && (err == TRANS_STREAM_ERROR_NONE)
+               && (rd == len))
+         {
+            stored     = writer->packed;
+            stored_len = wn;
+         }
+         backend->stream_free(stream);
+      }
+   }
+#endif
+
+   if (filestream_write(writer->file, stored, stored_len)
+         != (int64_t)stored_len)
+      return false;
+
+   record          = writer->index + (idx * GFX_THUMBNAIL_PACK_TYPES + type - 1)
+      * (GFX_THUMBNAIL_PACK_RECORD_SIZE / 4);
+   record[0]       = retro_cpu_to_le32((uint32_t)writer->offset);
+   record[1]       = retro_cpu_to_le32((uint32_t)(writer->offset >> 32));
+   record[2]       = retro_cpu_to_le32((uint32_t)stored_len);
+   record[3]       = retro_cpu_to_le32((width << 16) | height);
+   record[4]       = retro_cpu_to_le32(key);
+   writer->offset += stored_len;
+   return true;
+}
+
+bool gfx_thumbnail_pack_writer_finish(gfx_thumbnail_pack_writer_t *writer)
+{
+   bool ret;
+   size_t index_size;
+
+   if (!writer || !writer->file)
+      return false;
+
+   index_size = writer->entries * GFX_THUMBNAIL_PACK_TYPES
+      * GFX_THUMBNAIL_PACK_RECORD_SIZE;
+   ret        =
+         (filestream_seek(writer->file, GFX_THUMBNAIL_PACK_HEADER_SIZE,
+               RETRO_VFS_SEEK_POSITION_START) == 0)
+      && (filestream_write(writer->file, writer->index, index_size)
+               == (int64_t)index_size);
+
+   ret          = (filestream_close(writer->file) == 0) && ret;
+   writer->file = NULL;
+
+   if (ret)
+   {
+      /* Rename doesn't replace existing files everywhere */
+      if (path_is_valid(writer->path))
+         filestream_delete(writer->path);
+      ret = filestream_rename(writer->tmp_path, writer->path) == 0;
+   }
+
+   if (!ret)
+      filestream_delete(writer->tmp_path);
+
+   return ret;
+}
+
+void gfx_thumbnail_pack_writer_free(gfx_thumbnail_pack_writer_t *writer)
+{
+   if (!writer)
+      return;
+
+   if (writer->file)
+   {
+      filestream_close(writer->file);
+      filestream_delete(writer->tmp_path);
+   }
+
+   free(writer->index);
+   free(writer->pixels);
+   free(writer->packed);
+   free(writer->path);
+   free(writer->tmp_path);
+   free(writer);
+}
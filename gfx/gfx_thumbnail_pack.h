@@ -0,0 +1,119 @@
+/* Copyright  (C) 2010-2019 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (gfx_thumbnail_pack.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __GFX_THUMBNAIL_PACK_H
+#define __GFX_THUMBNAIL_PACK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <retro_common_api.h>
+#include <boolean.h>
+#include <retro_miscellaneous.h>
+#include <formats/image.h>
+
+#include "../playlist.h"
+
+RETRO_BEGIN_DECLS
+
+/* A thumbnail pack holds the thumbnails of every entry of
+ * a playlist, decoded and scaled down ahead of time, so
+ * that the menu can read one record instead of probing
+ * for image files and decoding them. It lives next to the
+ * playlist, and is built by task_push_thumbnail_pack().
+ *
+ * Layout (all values 32 bit little endian):
+ * > Header: "RATP", version, entry count
+ * > Index: for each entry, for each thumbnail type
+ *   (Named_Snaps, Named_Titles, Named_Boxarts, Named_Logos):
+ *   64 bit offset of the pixels (0 if there is no
+ *   thumbnail), their stored length, width << 16 | height,
+ *   entry key
+ * > Pixels: ARGB8888, as image_texture_load() decodes
+ *   them without RGBA support; deflated, unless that
+ *   didn't make them smaller
+ *
+ * A record is only used if its key matches the playlist
+ * entry it is read for, so a pack that is out of date
+ * falls back to the image files rather than showing the
+ * wrong thumbnail. */
+
+/* Thumbnail types as numbered by the thumbnail settings
+ * (1: Named_Snaps ... 4: Named_Logos) */
+#define GFX_THUMBNAIL_PACK_TYPES    4
+/* Largest width or height of a packed thumbnail */
+#define GFX_THUMBNAIL_PACK_MAX_SIZE 256
+
+typedef struct gfx_thumbnail_pack gfx_thumbnail_pack_t;
+typedef struct gfx_thumbnail_pack_writer gfx_thumbnail_pack_writer_t;
+
+/* Fills 's' with the path of the pack of the playlist
+ * at 'playlist_path' */
+size_t gfx_thumbnail_pack_get_path(const char *playlist_path,
+      char *s, size_t len);
+
+/* Identifies a playlist entry by its content path
+ * and label */
+uint32_t gfx_thumbnail_pack_entry_key(const struct playlist_entry *entry);
+
+/* Returns NULL if there is no valid pack at 'path' */
+gfx_thumbnail_pack_t *gfx_thumbnail_pack_open(const char *path);
+
+void gfx_thumbnail_pack_close(gfx_thumbnail_pack_t *pack);
+
+/**
+ * gfx_thumbnail_pack_read:
+ * @type                 : 1 to GFX_THUMBNAIL_PACK_TYPES
+ * @key                  : gfx_thumbnail_pack_entry_key() of the
+ *                         playlist entry at 'idx'
+ * @img                  : filled with the thumbnail, to be freed
+ *                         with image_texture_free()
+ *
+ * Returns: false if the pack has no thumbnail of 'type' for
+ * the entry.
+ **/
+bool gfx_thumbnail_pack_read(gfx_thumbnail_pack_t *pack,
+      size_t idx, unsigned type, uint32_t key,
+      bool supports_rgba, struct texture_image *img);
+
+/* Starts writing a pack of 'entries' entries to 'path'
+ * > Written to a temporary file, which replaces 'path'
+ *   when gfx_thumbnail_pack_writer_finish() succeeds */
+gfx_thumbnail_pack_writer_t *gfx_thumbnail_pack_writer_new(
+      const char *path, size_t entries);
+
+/* Adds the thumbnail of 'type' for the entry at 'idx',
+ * scaled down to GFX_THUMBNAIL_PACK_MAX_SIZE
+ * > 'img' must be ARGB8888 */
+bool gfx_thumbnail_pack_writer_add(gfx_thumbnail_pack_writer_t *writer,
+      size_t idx, unsigned type, uint32_t key,
+      const struct texture_image *img);
+
+bool gfx_thumbnail_pack_writer_finish(gfx_thumbnail_pack_writer_t *writer);
+
+/* Frees the writer, dropping the pack if it is not
+ * finished */
+void gfx_thumbnail_pack_writer_free(gfx_thumbnail_pack_writer_t *writer);
+
+RETRO_END_DECLS
+
+#endif
@@ -35,10 +35,11 @@
 
 #include "gfx_thumbnail_path.h"
 
-/* Returns currently set thumbnail 'type' (Named_Snaps,
- * Named_Titles, Named_Boxarts, Named_Logos) for specified thumbnail
- * identifier (right, left) */
-static const char *gfx_thumbnail_get_type(
+/* Returns currently set thumbnail 'type' index
+ * (0: off, 1: Named_Snaps, 2: Named_Titles,
+ * 3: Named_Boxarts, 4: Named_Logos) for specified
+ * thumbnail identifier (right, left) */
+static unsigned gfx_thumbnail_get_type_idx(
       unsigned gfx_thumbnails,
       unsigned left_thumbnails,
       unsigned icon_thumbnails,
@@ -47,51 +48,69 @@ static const char *gfx_thumbnail_get_type(
 {
    if (path_data)
    {
-      unsigned type                 = 0;
       switch (thumbnail_id)
       {
          case GFX_THUMBNAIL_RIGHT:
             if (path_data->playlist_right_mode != PLAYLIST_THUMBNAIL_MODE_DEFAULT)
-               type = (unsigned)path_data->playlist_right_mode - 1;
-            else
-               type = gfx_thumbnails;
-            break;
+               return (unsigned)path_data->playlist_right_mode - 1;
+            return gfx_thumbnails;
          case GFX_THUMBNAIL_LEFT:
             if (path_data->playlist_left_mode != PLAYLIST_THUMBNAIL_MODE_DEFAULT)
-               type = (unsigned)path_data->playlist_left_mode - 1;
-            else
-               type = left_thumbnails;
-            break;
+               return (unsigned)path_data->playlist_left_mode - 1;
+            return left_thumbnails;
          case GFX_THUMBNAIL_ICON:
             if (path_data->playlist_icon_mode != PLAYLIST_THUMBNAIL_MODE_DEFAULT)
-               type = (unsigned)path_data->playlist_icon_mode - 1;
-            else
-               type = icon_thumbnails;
-            break;
-         default:
-            goto end;
-      }
-
-      switch (type)
-      {
-         case 1:
-            return "Named_Snaps";
-         case 2:
-            return "Named_Titles";
-         case 3:
-            return "Named_Boxarts";
-         case 4:
-            return "Named_Logos";
-         case 0:
+               return (unsigned)path_data->playlist_icon_mode - 1;
+            return icon_thumbnails;
          default:
             break;
       }
    }
 
-end:
+   return 0;
+}
+
+/* Returns currently set thumbnail 'type' (Named_Snaps,
+ * Named_Titles, Named_Boxarts, Named_Logos) for specified thumbnail
+ * identifier (right, left) */
+static const char *gfx_thumbnail_get_type(
+      unsigned gfx_thumbnails,
+      unsigned left_thumbnails,
+      unsigned icon_thumbnails,
+      gfx_thumbnail_path_data_t *path_data,
+      enum gfx_thumbnail_id thumbnail_id)
+{
+   switch (gfx_thumbnail_get_type_idx(gfx_thumbnails,
+            left_thumbnails, icon_thumbnails, path_data, thumbnail_id))
+   {
+      case 1:
+         return "Named_Snaps";
+      case 2:
+         return "Named_Titles";
+      case 3:
+         return "Named_Boxarts";
+      case 4:
+         return "Named_Logos";
+      case 0:
+      default:
+         break;
+   }
+
    return msg_hash_to_str(MENU_ENUM_LABEL_VALUE_OFF);
 }
 
+unsigned gfx_thumbnail_get_type_index(
+      gfx_thumbnail_path_data_t *path_data,
+      enum gfx_thumbnail_id thumbnail_id)
+{
+   settings_t *settings = config_get_ptr();
+   return gfx_thumbnail_get_type_idx(
+         settings->uints.gfx_thumbnails,
+         settings->uints.menu_left_thumbnails,
+         settings->uints.menu_icon_thumbnails,
+         path_data, thumbnail_id);
+}
+
 /* Fills content_img field of path_data using existing
  * content_label field (for internal use only) */
 void gfx_thumbnail_fill_content_img(char *s, size_t len, const char *src, bool shorten)
@@ -139,6 +139,13 @@ bool gfx_thumbnail_update_path(gfx_thumbnail_path_data_t *path_data, enum gfx_th
 
 /* Getters */
 
+/* Fetches the thumbnail 'type' currently set for the
+ * specified thumbnail identifier (right, left, icon):
+ * 0 if disabled, else 1 to 4 for Named_Snaps,
+ * Named_Titles, Named_Boxarts, Named_Logos */
+unsigned gfx_thumbnail_get_type_index(gfx_thumbnail_path_data_t *path_data,
+      enum gfx_thumbnail_id thumbnail_id);
+
 /* Fetches current content directory.
  * Returns true if content directory is valid. */
 size_t gfx_thumbnail_get_content_dir(gfx_thumbnail_path_data_t *path_data, char *s, size_t len);
@@ -2237,3 +2237,19 @@ bool gfx_widgets_ready(void)
    return false;
 #endif
 }
+
+/* Nothing to draw: no message up, and no animation or timer
+ * running, which the other widgets show themselves with */
+bool gfx_widgets_idle(void)
+{
+   dispgfx_widget_t *p_dispwidget = &dispwidget_st;
+
+   if (     p_dispwidget->current_msgs_size
+         || ANIM_IS_ACTIVE(anim_get_ptr()))
+      return false;
+#ifdef HAVE_TRANSLATE
+   if (p_dispwidget->ai_service_overlay_state > 0)
+      return false;
+#endif
+   return true;
+}
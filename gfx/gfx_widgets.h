@@ -420,6 +420,8 @@ void gfx_widgets_frame(void *data);
 
 bool gfx_widgets_ready(void);
 
+bool gfx_widgets_idle(void);
+
 dispgfx_widget_t *dispwidget_get_ptr(void);
 
 extern const gfx_widget_t gfx_widget_screenshot;
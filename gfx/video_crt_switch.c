@@ -24,6 +24,10 @@
 #include <math.h>
 
 #include <retro_common_api.h>
+#include <features/features_cpu.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 #include "video_crt_switch.h"
 #include "video_display_server.h"
 #include "../core_info.h"
@@ -57,6 +61,50 @@ static char _vShift[12];
 static void crt_rpi_switch(videocrt_switch_t *p_switch,int width, int height, float hz, int xoffset, int native_width);
 #endif
 
+#if !defined(HAVE_VIDEOCORE)
+/* Modes SR has already computed and registered this session. Going
+ * back to one (a game's menus, then its FMVs, then its menus again)
+ * skips the modeline calculation and the mode creation on the
+ * display server. Cleared whenever the switchres.ini settings are
+ * reloaded. */
+#define CRT_MODE_CACHE_SIZE 32
+
+typedef struct crt_cached_mode
+{
+   sr_mode srm;
+   double hz;
+   int width;
+   int height;
+   int flags;
+   int center_adjust;
+   int porch_adjust;
+   int vert_adjust;
+} crt_cached_mode_t;
+
+static crt_cached_mode_t crt_mode_cache[CRT_MODE_CACHE_SIZE];
+static unsigned crt_mode_cache_count = 0;
+static unsigned crt_mode_cache_next  = 0; /* Replaced next once full */
+
+#ifdef HAVE_THREADS
+/* Applies modes off the video thread, where the display server takes
+ * them from any thread (not KMS, whose mode goes through the video
+ * context). Any other SR call waits for the worker to be idle first. */
+typedef struct crt_mode_worker
+{
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   int pending_id;            /* -1 for none */
+   int pending_width;
+   int pending_height;
+   bool busy;
+   bool quit;
+} crt_mode_worker_t;
+
+static crt_mode_worker_t *crt_mode_worker = NULL;
+#endif
+#endif
+
 static bool crt_check_for_changes(videocrt_switch_t *p_switch)
 {
    if (   (p_switch->ra_core_height != p_switch->ra_tmp_height)
@@ -157,6 +205,193 @@ static void crt_switch_set_aspect(
 }
 
 #if !defined(HAVE_VIDEOCORE)
+static void crt_mode_cache_clear(void)
+{
+   crt_mode_cache_count = 0;
+   crt_mode_cache_next  = 0;
+}
+
+static crt_cached_mode_t *crt_mode_cache_find(videocrt_switch_t *p_switch,
+      int width, int height, double hz, int flags)
+{
+   unsigned i;
+   for (i = 0; i < crt_mode_cache_count; i++)
+   {
+      crt_cached_mode_t *mode = &crt_mode_cache[i];
+      if (     mode->width         == width
+            && mode->height        == height
+            && mode->hz            == hz
+            && mode->flags         == flags
+            && mode->center_adjust == p_switch->center_adjust
+            && mode->porch_adjust  == p_switch->porch_adjust
+            && mode->vert_adjust   == p_switch->vert_adjust)
+         return mode;
+   }
+   return NULL;
+}
+
+/* sr_add_mode, served from the cache when it can be */
+static int crt_add_mode(videocrt_switch_t *p_switch,
+      int width, int height, double hz, int flags, sr_mode *srm)
+{
+   crt_cached_mode_t *mode;
+   int key_flags = flags & ~SR_MODE_DONT_FLUSH;
+
+   if ((mode = crt_mode_cache_find(p_switch, width, height, hz, key_flags)))
+   {
+      *srm = mode->srm;
+      return 1;
+   }
+
+   if (!sr_add_mode(width, height, hz, flags, srm))
+      return 0;
+
+   if (crt_mode_cache_count < CRT_MODE_CACHE_SIZE)
+      mode = &crt_mode_cache[crt_mode_cache_count++];
+   else
+   {
+      mode                = &crt_mode_cache[crt_mode_cache_next];
+      crt_mode_cache_next = (crt_mode_cache_next + 1) % CRT_MODE_CACHE_SIZE;
+   }
+   mode->srm           = *srm;
+   mode->hz            = hz;
+   mode->width         = width;
+   mode->height        = height;
+   mode->flags         = key_flags;
+   mode->center_adjust = p_switch->center_adjust;
+   mode->porch_adjust  = p_switch->porch_adjust;
+   mode->vert_adjust   = p_switch->vert_adjust;
+   return 1;
+}
+
+/* Registers the modes of the core's base and maximum geometry in one
+ * flush, so that the first switch to either one finds it ready */
+static void crt_preload_core_modes(videocrt_switch_t *p_switch,
+      double hz, int flags)
+{
+   struct retro_game_geometry *geom = &video_state_get_ptr()->av_info.geometry;
+   sr_mode mode;
+   int added = 0;
+
+   if (geom->base_width && geom->base_height)
+      added += crt_add_mode(p_switch, geom->base_width, geom->base_height,
+            hz, flags | SR_MODE_DONT_FLUSH, &mode);
+   if (     geom->max_width && geom->max_height
+         && (  geom->max_width  != geom->base_width
+            || geom->max_height != geom->base_height))
+      added += crt_add_mode(p_switch, geom->max_width, geom->max_height,
+            hz, flags | SR_MODE_DONT_FLUSH, &mode);
+
+   if (added)
+   {
+      sr_flush();
+      RARCH_LOG("[CRT] Registered %d mode(s) for the core at %f Hz.\n",
+            added, hz);
+   }
+}
+
+#ifdef HAVE_THREADS
+static void crt_mode_worker_main(void *data)
+{
+   crt_mode_worker_t *worker = (crt_mode_worker_t*)data;
+
+   slock_lock(worker->lock);
+   for (;;)
+   {
+      int id, width, height;
+      retro_time_t start;
+
+      while (!worker->quit && worker->pending_id < 0)
+         scond_wait(worker->cond, worker->lock);
+      if (worker->quit)
+         break;
+
+      id                 = worker->pending_id;
+      width              = worker->pending_width;
+      height             = worker->pending_height;
+      worker->pending_id = -1;
+      worker->busy       = true;
+      slock_unlock(worker->lock);
+
+      start              = cpu_features_get_time_usec();
+      if (sr_set_mode(id))
+         RARCH_LOG("[CRT] Switched to %dx%d in %.1f ms.\n", width, height,
+               (cpu_features_get_time_usec() - start) / 1000.0f);
+      else
+         RARCH_ERR("[CRT] SR failed to switch mode.\n");
+
+      slock_lock(worker->lock);
+      worker->busy       = false;
+      scond_broadcast(worker->cond);
+   }
+   slock_unlock(worker->lock);
+}
+
+static void crt_mode_worker_wait_idle(void)
+{
+   crt_mode_worker_t *worker = crt_mode_worker;
+
+   if (!worker)
+      return;
+   slock_lock(worker->lock);
+   while (worker->busy || worker->pending_id >= 0)
+      scond_wait(worker->cond, worker->lock);
+   slock_unlock(worker->lock);
+}
+
+static void crt_mode_worker_free(void)
+{
+   crt_mode_worker_t *worker = crt_mode_worker;
+
+   if (!worker)
+      return;
+   if (worker->thread)
+   {
+      slock_lock(worker->lock);
+      worker->quit = true;
+      scond_broadcast(worker->cond);
+      slock_unlock(worker->lock);
+      sthread_join(worker->thread);
+   }
+   scond_free(worker->cond);
+   slock_free(worker->lock);
+   free(worker);
+   crt_mode_worker = NULL;
+}
+
+/* Hands the mode to the worker, or returns false to apply it here */
+static bool crt_mode_worker_set_mode(const sr_mode *srm)
+{
+   crt_mode_worker_t *worker = crt_mode_worker;
+
+   if (!worker)
+   {
+      if (!(worker = (crt_mode_worker_t*)calloc(1, sizeof(*worker))))
+         return false;
+      worker->pending_id = -1;
+      worker->lock       = slock_new();
+      worker->cond       = scond_new();
+      crt_mode_worker    = worker;
+      if (     !worker->lock
+            || !worker->cond
+            || !(worker->thread = sthread_create(crt_mode_worker_main,
+                  worker)))
+      {
+         crt_mode_worker_free();
+         return false;
+      }
+   }
+
+   slock_lock(worker->lock);
+   worker->pending_id     = srm->id;
+   worker->pending_width  = srm->width;
+   worker->pending_height = srm->height;
+   scond_broadcast(worker->cond);
+   slock_unlock(worker->lock);
+   return true;
+}
+#endif
+
 static bool crt_sr2_init(videocrt_switch_t *p_switch,
       int monitor_index, unsigned int crt_mode, unsigned int super_width)
 {
@@ -301,6 +536,10 @@ static void switch_res_crt(
    int w                   = native_width;
    int h                   = height;
 
+#ifdef HAVE_THREADS
+   crt_mode_worker_wait_idle();
+#endif
+
    /* Check if SR2 is loaded, if not, load it */
    if (crt_sr2_init(p_switch, monitor_index, crt_mode, super_width))
    {
@@ -345,6 +584,12 @@ static void switch_res_crt(
          RARCH_LOG("[CRT] Current running core: %s.\n", core_name);
          crt_adjust_sr_ini(p_switch);
          p_switch->hh_core = false;
+
+         sr_set_option(SR_OPT_H_SIZE, hSize);
+         sr_set_option(SR_OPT_H_SHIFT, hShift);
+         sr_set_option(SR_OPT_V_SHIFT, vShift);
+         if (!p_switch->khr_ctx)
+            crt_preload_core_modes(p_switch, rr, flags);
       }
 
       #if defined(_WIN32)
@@ -362,7 +607,7 @@ static void switch_res_crt(
             RARCH_LOG("[CRT] SR temporary mode for windows geometry adjustment (640x400).\n");
          }
 
-         ret = sr_add_mode(tempw, temph, rr, flags, &srm);
+         ret = crt_add_mode(p_switch, tempw, temph, rr, flags, &srm);
 
          if (!ret)
             RARCH_ERR("[CRT] SR failed to add temporary mode for windows geometry adjustment.\n");
@@ -380,22 +625,13 @@ static void switch_res_crt(
       sr_set_option(SR_OPT_V_SHIFT, vShift);
 
       RARCH_DBG("[CRT] %dx%d rotation: %d rotated: %d core rotation:%d\n", w, h, p_switch->rotated, flags & SR_MODE_ROTATED, retroarch_get_rotation());
-      ret = sr_add_mode(w, h, rr, flags, &srm);
+      ret = crt_add_mode(p_switch, w, h, rr, flags, &srm);
       if (!ret)
          RARCH_ERR("[CRT] SR failed to add mode.\n");
-      if (p_switch->kms_ctx)
-      {
-         get_modeline_for_kms(p_switch, &srm);
-         video_driver_set_video_mode(srm.width, srm.height, true);
-      }
-      else if (p_switch->khr_ctx)
-         RARCH_WARN("[CRT] Vulkan -> Can't modeswitch for now.\n");
-      else
-         ret = sr_set_mode(srm.id);
-      if (!p_switch->kms_ctx && !ret)
-         RARCH_ERR("[CRT] SR failed to switch mode.\n");
       p_switch->sr_core_hz = (float)srm.vfreq;
 
+      /* Before the switch, which may already be running on the
+       * worker by the time this would read the SR state */
       crt_switch_set_aspect(p_switch,
             p_switch->rotated ? h : w,
             p_switch->rotated ? w : h,
@@ -403,6 +639,22 @@ static void switch_res_crt(
             (float)srm.x_scale,
             (float)srm.y_scale,
             srm.is_stretched);
+
+      if (p_switch->kms_ctx)
+      {
+         get_modeline_for_kms(p_switch, &srm);
+         video_driver_set_video_mode(srm.width, srm.height, true);
+      }
+      else if (p_switch->khr_ctx)
+         RARCH_WARN("[CRT] Vulkan -> Can't modeswitch for now.\n");
+      else if (ret)
+      {
+#ifdef HAVE_THREADS
+         if (!crt_mode_worker_set_mode(&srm))
+#endif
+         if (!sr_set_mode(srm.id))
+            RARCH_ERR("[CRT] SR failed to switch mode.\n");
+      }
    }
    else
    {
@@ -420,6 +672,12 @@ static void switch_res_crt(
 
 void crt_destroy_modes(videocrt_switch_t *p_switch)
 {
+#if !defined(HAVE_VIDEOCORE)
+#ifdef HAVE_THREADS
+   crt_mode_worker_free();
+#endif
+   crt_mode_cache_clear();
+#endif
    if (p_switch->sr2_active)
    {
       p_switch->sr2_active = false;
@@ -491,6 +749,9 @@ void crt_switch_res_core(
             int corrected_height = 240;
             switch_res_crt(p_switch, corrected_width, corrected_height,
                   crt_mode, corrected_width, monitor_index-1, super_width);
+#ifdef HAVE_THREADS
+            crt_mode_worker_wait_idle();
+#endif
             crt_switch_set_aspect(p_switch, native_width, height, native_width,
                   height ,(float)1,(float)1, false);
             video_driver_set_size(native_width , height);
@@ -551,6 +812,10 @@ void crt_adjust_sr_ini(videocrt_switch_t *p_switch)
 
    if (p_switch->sr2_active)
    {
+#if !defined(HAVE_VIDEOCORE)
+      /* The modes were computed with the settings being replaced */
+      crt_mode_cache_clear();
+#endif
       /* First we reload the base switchres.ini file
          to undo any overrides that might have been
          loaded for another core */
@@ -65,6 +65,13 @@
 #include "../list_special.h"
 #include "../retroarch.h"
 #include "../verbosity.h"
+#include "../frame_timeline.h"
+#include "../clock_governor.h"
+#include "../latency_test.h"
+
+#ifdef HAVE_GAME_AI
+#include "../ai/game_ai.h"
+#endif
 
 #define TIME_TO_FPS(last_time, new_time, frames) ((1000000.0f * (frames)) / ((new_time) - (last_time)))
 
@@ -484,6 +491,22 @@ video_driver_state_t *video_state_get_ptr(void)
    return &video_driver_st;
 }
 
+memarena_t *video_driver_frame_scratch(void)
+{
+   video_driver_state_t *video_st = &video_driver_st;
+#ifdef HAVE_THREADS
+   if (VIDEO_DRIVER_IS_THREADED_INTERNAL(video_st))
+   {
+      memarena_t *scratch = video_thread_frame_scratch(video_st->data, false);
+      if (scratch)
+         return scratch;
+   }
+   if (video_st->frame_scratch_thread != sthread_get_current_thread_id())
+      return NULL;
+#endif
+   return video_st->frame_scratch;
+}
+
 #ifdef HAVE_THREADS
 void *video_thread_get_ptr(video_driver_state_t *video_st)
 {
@@ -1660,6 +1683,8 @@ void video_driver_free_internal(void)
 #ifdef HAVE_VIDEO_FILTER
    video_driver_filter_free();
 #endif
+   memarena_free(video_st->frame_scratch);
+   video_st->frame_scratch = NULL;
 #if defined(HAVE_CG) || defined(HAVE_GLSL) || defined(HAVE_SLANG) || defined(HAVE_HLSL)
    video_shader_dir_free_shader(
          (struct rarch_dir_shader_list*)&video_st->dir_shader_list,
@@ -3423,37 +3448,11 @@ const char* video_driver_get_gpu_api_version_string(void)
    return video_st->gpu_api_version_string;
 }
 
-bool video_driver_init_internal(bool *video_is_threaded, bool verbosity_enabled)
+/* The core-dependent aspect ratio values */
+static void video_driver_init_core_aspect(settings_t *settings,
+      struct retro_game_geometry *geom)
 {
-   video_info_t video;
-   unsigned max_dim, scale, width, height;
-   video_viewport_t *custom_vp            = NULL;
-   input_driver_t *tmp                    = NULL;
-   static uint16_t dummy_pixels[32]       = {0};
-   runloop_state_t *runloop_st            = runloop_state_get_ptr();
-   settings_t       *settings             = config_get_ptr();
-   input_driver_state_t *input_st         = input_state_get_ptr();
    video_driver_state_t *video_st         = &video_driver_st;
-   struct retro_game_geometry *geom       = &video_st->av_info.geometry;
-   const enum retro_pixel_format
-      video_driver_pix_fmt                = video_st->pix_fmt;
-#ifdef HAVE_VIDEO_FILTER
-   const char *path_softfilter_plugin     = settings->paths.path_softfilter_plugin;
-
-   /* Init video filter only when game is running */
-   if ((     runloop_st->current_core.flags & RETRO_CORE_FLAG_GAME_LOADED)
-         && !string_is_empty(path_softfilter_plugin))
-      video_driver_init_filter(video_driver_pix_fmt, settings);
-#endif
-
-   max_dim   = MAX(geom->max_width, geom->max_height);
-   scale     = next_pow2(max_dim) / RARCH_SCALE_BASE;
-   scale     = MAX(scale, 1);
-
-#ifdef HAVE_VIDEO_FILTER
-   if (video_st->state_filter)
-      scale  = video_st->state_scale;
-#endif
 
    strlcpy(aspectratio_lut[ASPECT_RATIO_CONFIG].name,
          msg_hash_to_str(MENU_ENUM_LABEL_VALUE_VIDEO_ASPECT_RATIO_CONFIG),
@@ -3476,14 +3475,13 @@ bool video_driver_init_internal(bool *video_is_threaded, bool verbosity_enabled)
          settings->bools.video_aspect_ratio_auto);
 
    /* Update CUSTOM viewport. */
-   custom_vp = &settings->video_vp_custom;
 
    if (settings->uints.video_aspect_ratio_idx == ASPECT_RATIO_CUSTOM)
    {
       float default_aspect = aspectratio_lut[ASPECT_RATIO_CORE].value;
       aspectratio_lut[ASPECT_RATIO_CUSTOM].value =
-         (custom_vp->width && custom_vp->height) ?
-         (float)custom_vp->width / custom_vp->height : default_aspect;
+         (settings->video_vp_custom.width && settings->video_vp_custom.height) ?
+         (float)settings->video_vp_custom.width / settings->video_vp_custom.height : default_aspect;
    }
 
    {
@@ -3493,6 +3491,136 @@ bool video_driver_init_internal(bool *video_is_threaded, bool verbosity_enabled)
          new_aspect_idx       = settings->uints.video_aspect_ratio_idx = 0;
       video_st->aspect_ratio  = aspectratio_lut[new_aspect_idx].value;
    }
+}
+
+/* The multiple of RARCH_SCALE_BASE the driver's input texture is sized for */
+static unsigned video_driver_input_scale(video_driver_state_t *video_st,
+      const struct retro_game_geometry *geom)
+{
+   unsigned max_dim   = MAX(geom->max_width, geom->max_height);
+   unsigned scale     = next_pow2(max_dim) / RARCH_SCALE_BASE;
+   scale              = MAX(scale, 1);
+
+#ifdef HAVE_VIDEO_FILTER
+   if (video_st->state_filter)
+      scale           = video_st->state_scale;
+#endif
+   return scale;
+}
+
+bool video_driver_keep_alive(void)
+{
+   video_driver_state_t *video_st         = &video_driver_st;
+   struct retro_game_geometry *geom       = &video_st->av_info.geometry;
+
+   if (     !video_st->data
+         ||  video_st->hw_render.context_type != RETRO_HW_CONTEXT_NONE
+         ||  VIDEO_DRIVER_IS_THREADED_INTERNAL(video_st))
+      return false;
+#ifdef HAVE_VIDEO_FILTER
+   if (video_st->state_filter)
+      return false;
+#endif
+
+   video_st->kept_pix_fmt     = video_st->pix_fmt;
+   video_st->kept_scale       = video_driver_input_scale(video_st, geom);
+   video_st->kept_base_width  = geom->base_width;
+   video_st->kept_base_height = geom->base_height;
+   video_st->flags           |= VIDEO_FLAG_KEPT_ALIVE;
+   return true;
+}
+
+bool video_driver_reuse_kept(settings_t *settings)
+{
+   struct retro_hw_render_callback hwr;
+   const struct retro_hw_render_context_negotiation_interface *iface;
+   runloop_state_t *runloop_st            = runloop_state_get_ptr();
+   input_driver_state_t *input_st         = input_state_get_ptr();
+   video_driver_state_t *video_st         = &video_driver_st;
+   struct retro_game_geometry *geom       = &video_st->av_info.geometry;
+   bool fullscreen                        = settings->bools.video_fullscreen
+         || (video_st->flags & VIDEO_FLAG_FORCE_FULLSCREEN);
+   bool compatible                        =
+             video_st->data
+         &&  video_st->hw_render.context_type == RETRO_HW_CONTEXT_NONE
+         && (runloop_st->current_core.flags & RETRO_CORE_FLAG_GAME_LOADED)
+         &&  video_st->pix_fmt == video_st->kept_pix_fmt
+         &&  video_driver_input_scale(video_st, geom) == video_st->kept_scale
+         && (fullscreen
+               || (   geom->base_width  == video_st->kept_base_width
+                   && geom->base_height == video_st->kept_base_height));
+
+#ifdef HAVE_VIDEO_FILTER
+   if (!string_is_empty(settings->paths.path_softfilter_plugin))
+      compatible = false;
+#endif
+
+   video_st->flags &= ~VIDEO_FLAG_KEPT_ALIVE;
+
+   if (compatible)
+   {
+      RARCH_LOG("[Video] Reusing the video driver of the last core.\n");
+      video_driver_init_core_aspect(settings, geom);
+      video_st->frame_count      = 0;
+      video_st->frame_drop_count = 0;
+      video_driver_set_rotation(retroarch_get_rotation() % 4);
+#ifdef HAVE_OVERLAY
+      input_overlay_unload();
+      input_overlay_init();
+#endif
+#if defined(HAVE_CG) || defined(HAVE_GLSL) || defined(HAVE_SLANG) || defined(HAVE_HLSL)
+      {
+         /* The new core may come with a preset of its own */
+         const char *preset          = video_shader_get_current_shader_preset();
+         enum rarch_shader_type type = video_shader_parse_type(preset);
+         video_shader_apply_shader(settings, type, preset, false);
+      }
+#endif
+      return true;
+   }
+
+   /* The hardware context, if any, is the new core's; free the
+    * kept drivers without it */
+   hwr   = video_st->hw_render;
+   iface = video_st->hw_render_context_negotiation;
+   memset(&video_st->hw_render, 0, sizeof(video_st->hw_render));
+   video_driver_free_internal();
+   VIDEO_DRIVER_LOCK_FREE(video_st);
+   video_st->hw_render                     = hwr;
+   video_st->hw_render_context_negotiation = iface;
+   video_st->data                          = NULL;
+   input_st->current_data                  = NULL;
+   RARCH_LOG("[Video] The new core can't reuse the video driver; reinitializing.\n");
+   return false;
+}
+
+bool video_driver_init_internal(bool *video_is_threaded, bool verbosity_enabled)
+{
+   video_info_t video;
+   unsigned scale, width, height;
+   video_viewport_t *custom_vp            = NULL;
+   input_driver_t *tmp                    = NULL;
+   static uint16_t dummy_pixels[32]       = {0};
+   runloop_state_t *runloop_st            = runloop_state_get_ptr();
+   settings_t       *settings             = config_get_ptr();
+   input_driver_state_t *input_st         = input_state_get_ptr();
+   video_driver_state_t *video_st         = &video_driver_st;
+   struct retro_game_geometry *geom       = &video_st->av_info.geometry;
+   const enum retro_pixel_format
+      video_driver_pix_fmt                = video_st->pix_fmt;
+#ifdef HAVE_VIDEO_FILTER
+   const char *path_softfilter_plugin     = settings->paths.path_softfilter_plugin;
+
+   /* Init video filter only when game is running */
+   if ((     runloop_st->current_core.flags & RETRO_CORE_FLAG_GAME_LOADED)
+         && !string_is_empty(path_softfilter_plugin))
+      video_driver_init_filter(video_driver_pix_fmt, settings);
+#endif
+
+   scale     = video_driver_input_scale(video_st, geom);
+
+   video_driver_init_core_aspect(settings, geom);
+   custom_vp = &settings->video_vp_custom;
 
    if (     settings->bools.video_fullscreen
          || (video_st->flags & VIDEO_FLAG_FORCE_FULLSCREEN))
@@ -3814,6 +3942,7 @@ void video_driver_frame(const void *data, unsigned width,
    static bool last_frame_duped   = true;
    bool render_frame              = true;
    retro_time_t new_time;
+   retro_time_t timeline_start;
    video_frame_info_t video_info;
    size_t _len                    = 0;
    video_driver_state_t *video_st = &video_driver_st;
@@ -3836,6 +3965,7 @@ void video_driver_frame(const void *data, unsigned width,
       return;
 
    new_time                      = cpu_features_get_time_usec();
+   timeline_start                = frame_timeline_is_enabled() ? new_time : 0;
    runloop_st->core_run_time     = new_time - runloop_st->core_run_time;
 
    if (     runloop_st->flags & RUNLOOP_FLAG_PAUSED
@@ -3848,6 +3978,9 @@ void video_driver_frame(const void *data, unsigned width,
    video_st->frame_cache_height  = height;
    video_st->frame_cache_pitch   = pitch;
 
+   latency_test_frame(data, width, height, pitch,
+         (video_driver_pix_fmt == RETRO_PIXEL_FORMAT_XRGB8888) ? 4 : 2);
+
    if (
             video_st->scaler_ptr
          && data
@@ -3865,6 +3998,10 @@ void video_driver_frame(const void *data, unsigned width,
 
    video_driver_build_info(&video_info);
 
+   frame_timeline_set_enabled(video_info.statistics_show
+         || config_get_ptr()->bools.frame_timeline_enable
+         || clock_governor_is_active());
+
 #ifdef HAVE_MENU
    menu_is_alive = (video_info.menu_st_flags & MENU_ST_FLAG_ALIVE) ? true : false;
 #endif
@@ -4158,14 +4295,37 @@ void video_driver_frame(const void *data, unsigned width,
       unsigned output_width                             = 0;
       unsigned output_height                            = 0;
       unsigned output_pitch                             = 0;
+      void *output                                      = video_st->state_buffer;
 
       rarch_softfilter_get_output_size(video_st->state_filter,
             &output_width, &output_height, width, height);
 
       output_pitch = (output_width) * video_st->state_out_bpp;
 
+      /* Filter straight into the slot the threaded driver
+       * takes the next frame from, which saves it a copy */
+      if (     VIDEO_DRIVER_IS_THREADED_INTERNAL(video_st)
+            && video_st->poke
+            && video_st->poke->get_current_software_framebuffer)
+      {
+         struct retro_framebuffer fb;
+
+         fb.width        = output_width;
+         fb.height       = output_height;
+         fb.access_flags = RETRO_MEMORY_ACCESS_WRITE;
+
+         if (     video_st->poke->get_current_software_framebuffer(
+                     video_st->data, &fb)
+               && (fb.format == rarch_softfilter_get_output_format(
+                     video_st->state_filter)))
+         {
+            output       = fb.data;
+            output_pitch = (unsigned)fb.pitch;
+         }
+      }
+
       rarch_softfilter_process(video_st->state_filter,
-            video_st->state_buffer, output_pitch,
+            output, output_pitch,
             data, width, height, pitch);
 
       if (     video_info.post_filter_record
@@ -4173,11 +4333,11 @@ void video_driver_frame(const void *data, unsigned width,
             && recording_st->driver
             && recording_st->driver->push_video)
          recording_dump_frame(
-               video_st->state_buffer,
+               output,
                output_width, output_height, output_pitch,
                runloop_idle);
 
-      data   = video_st->state_buffer;
+      data   = output;
       width  = output_width;
       height = output_height;
       pitch  = output_pitch;
@@ -4270,6 +4430,8 @@ void video_driver_frame(const void *data, unsigned width,
       audio_stats.std_deviation_percentage   = 0.0f;
       audio_stats.close_to_underrun          = 0.0f;
       audio_stats.close_to_blocking          = 0.0f;
+      audio_stats.underruns                  = 0;
+      audio_stats.overruns                   = 0;
 
       video_monitor_fps_statistics(NULL, &stddev, NULL);
 
@@ -4312,7 +4474,9 @@ void video_driver_frame(const void *data, unsigned width,
                " Saturation: %6.2f %%\n"
                " Deviation:  %6.2f %%\n"
                " Underrun:   %6.2f %%\n"
+               " - Empty:    %6u\n"
                " Blocking:   %6.2f %%\n"
+               " - Full:     %6u\n"
                " Samples:  %8d\n"
                ,
                video_st->frame_cache_width,
@@ -4343,10 +4507,56 @@ void video_driver_frame(const void *data, unsigned width,
                audio_stats.average_buffer_saturation,
                audio_stats.std_deviation_percentage,
                audio_stats.close_to_underrun,
+               audio_stats.underruns,
                audio_stats.close_to_blocking,
+               audio_stats.overruns,
                audio_stats.samples
                );
 
+#ifdef HAVE_DSP_FILTER
+         {
+            unsigned i;
+            float load;
+            const char *ident;
+            retro_dsp_filter_t *dsp = audio_state_get_ptr()->dsp;
+
+            /* TODO/FIXME - localize */
+            for (i = 0; retro_dsp_filter_get_load(dsp, i, &ident, &load); i++)
+               __len += snprintf(video_info.stat_text + __len,
+                     sizeof(video_info.stat_text) - __len,
+                     " DSP CPU:    %6.2f %% (%s)\n", load, ident);
+         }
+#endif
+
+         {
+            unsigned allocs, heap_allocs;
+            size_t used;
+            memarena_get_stats(video_st->frame_scratch,
+                  &allocs, &heap_allocs, &used);
+#ifdef HAVE_THREADS
+            if (VIDEO_DRIVER_IS_THREADED_INTERNAL(video_st))
+            {
+               unsigned thread_allocs, thread_heap_allocs;
+               size_t thread_used;
+               memarena_get_stats(
+                     video_thread_frame_scratch(video_st->data, true),
+                     &thread_allocs, &thread_heap_allocs, &thread_used);
+               allocs      += thread_allocs;
+               heap_allocs += thread_heap_allocs;
+               used        += thread_used;
+            }
+#endif
+            /* TODO/FIXME - localize */
+            if (allocs)
+               __len += snprintf(video_info.stat_text + __len,
+                     sizeof(video_info.stat_text) - __len,
+                     "FRAME SCRATCH\n"
+                     " Allocations: %5u\n"
+                     " - Heap:      %5u\n"
+                     " Size:       %6u KB\n",
+                     allocs, heap_allocs, (unsigned)((used + 1023) / 1024));
+         }
+
          /* TODO/FIXME - localize */
          if (     (video_st->frame_delay_target > 0)
                || (video_info.runahead)
@@ -4383,6 +4593,166 @@ void video_driver_frame(const void *data, unsigned width,
                   " Run-Ahead:   %2u frames\n"
                   " - Preemptive Frames\n",
                   video_info.runahead_frames);
+
+         /* TODO/FIXME - localize */
+         if (runloop_st->fastforward_batch.frames)
+            __len += snprintf(video_info.stat_text + __len, sizeof(video_info.stat_text) - __len,
+                  "FAST-FORWARD\n"
+                  " Speed:       %5.2fx\n"
+                  " Batch:       %2u frames\n",
+                  runloop_st->fastforward_batch.speed,
+                  runloop_st->fastforward_batch.frames);
+
+         /* TODO/FIXME - localize */
+         if (video_st->frame_upload_queue)
+            __len += snprintf(video_info.stat_text + __len, sizeof(video_info.stat_text) - __len,
+                  "UPLOAD\n"
+                  " Core Frame:  %5.2f ms\n"
+                  " - Queue:     %s\n",
+                  video_st->frame_upload_time / 1000.0f,
+                  video_st->frame_upload_queue);
+
+         /* TODO/FIXME - localize */
+         if (video_st->shader_passes)
+            __len += snprintf(video_info.stat_text + __len, sizeof(video_info.stat_text) - __len,
+                  "SHADER\n"
+                  " Passes:      %2u\n"
+                  " - Reused:    %2u\n",
+                  video_st->shader_passes,
+                  video_st->shader_passes_reused);
+
+         /* TODO/FIXME - localize */
+         if (video_st->scanout_blocker)
+         {
+            if (*video_st->scanout_blocker)
+               __len += snprintf(video_info.stat_text + __len, sizeof(video_info.stat_text) - __len,
+                     "PRESENT\n"
+                     " Path:        GPU composition\n"
+                     " - Reason:    %s\n",
+                     video_st->scanout_blocker);
+            else
+               __len += snprintf(video_info.stat_text + __len, sizeof(video_info.stat_text) - __len,
+                     "PRESENT\n"
+                     " Path:        Direct scanout\n");
+         }
+
+         if (frame_timeline_is_enabled())
+         {
+            struct frame_timeline_stats timeline;
+            frame_timeline_get_stats(&timeline);
+            /* TODO/FIXME - localize */
+            __len += snprintf(video_info.stat_text + __len, sizeof(video_info.stat_text) - __len,
+                  "FRAME TIMELINE\n"
+                  " Input Poll:  %5.2f ms\n"
+                  " Core Run:    %5.2f ms\n"
+                  " Video Frame: %5.2f ms\n"
+                  " - Driver:    %5.2f ms\n"
+                  " Interval:    %5.2f ms avg, %5.2f ms max\n"
+                  " Jitter:      %5.2f ms\n",
+                  timeline.stage_ms[FRAME_TIMELINE_INPUT_POLL],
+                  timeline.stage_ms[FRAME_TIMELINE_CORE_RUN],
+                  timeline.stage_ms[FRAME_TIMELINE_VIDEO_FRAME],
+                  timeline.stage_ms[FRAME_TIMELINE_DRIVER_FRAME],
+                  timeline.interval_ms,
+                  timeline.max_interval_ms,
+                  timeline.interval_sd_ms);
+            if (timeline.display_latency_ms > 0.0f)
+               __len += snprintf(video_info.stat_text + __len, sizeof(video_info.stat_text) - __len,
+                     " Display:     %5.2f ms after present\n",
+                     timeline.display_latency_ms);
+         }
+
+#ifdef HAVE_GAME_AI
+         {
+            struct game_ai_stats ai_stats;
+
+            /* TODO/FIXME - localize */
+            if (game_ai_get_stats(&ai_stats) && ai_stats.jobs)
+               __len += snprintf(video_info.stat_text + __len, sizeof(video_info.stat_text) - __len,
+                     "GAME AI\n"
+                     " Inference:   %5.2f ms avg, %5.2f ms max%s\n"
+                     " Latency:     %2u frames, %5.2f avg\n"
+                     " Skipped:     %5u of %u\n",
+                     ai_stats.think_ms,
+                     ai_stats.max_think_ms,
+                     ai_stats.threaded ? "" : " (inline)",
+                     ai_stats.latency_frames,
+                     ai_stats.avg_latency_frames,
+                     ai_stats.skipped,
+                     ai_stats.jobs + ai_stats.skipped);
+         }
+#endif
+
+         {
+            struct record_stats rec_stats;
+            recording_state_t *record_st = recording_state_get_ptr();
+
+            /* TODO/FIXME - localize */
+            if (     record_st->data
+                  && record_st->driver
+                  && record_st->driver->get_stats
+                  && record_st->driver->get_stats(record_st->data, &rec_stats))
+               __len += snprintf(video_info.stat_text + __len, sizeof(video_info.stat_text) - __len,
+                     "RECORDING\n"
+                     " Queue:       %2u / %2u, %2u max\n"
+                     " Dropped:     %5u\n"
+                     " Duplicated:  %5u\n"
+                     " Audio Lost:  %5u frames\n",
+                     rec_stats.video_queued,
+                     rec_stats.video_capacity,
+                     rec_stats.video_max_queued,
+                     rec_stats.video_dropped,
+                     rec_stats.video_duplicated,
+                     rec_stats.audio_dropped);
+         }
+
+#ifdef HAVE_BSV_MOVIE
+         {
+            bsv_movie_t *movie = input_state_get_ptr()->bsv_movie_state_handle;
+
+            /* TODO/FIXME - localize */
+            if (movie && (movie->writer
+#ifdef HAVE_STATESTREAM
+                     || movie->store.stats.inserts
+#endif
+                     ))
+               __len += strlcpy(video_info.stat_text + __len, "REPLAY\n",
+                     sizeof(video_info.stat_text) - __len);
+
+#ifdef HAVE_STATESTREAM
+            if (movie && movie->store.stats.inserts)
+            {
+               struct state_store_stats *stats = &movie->store.stats;
+               __len += snprintf(video_info.stat_text + __len, sizeof(video_info.stat_text) - __len,
+                     " Checkpoints: %u\n"
+                     " Encode:      %5.2f ms avg, %5.2f ms max\n"
+                     " Blocks:      %u reused of %u\n"
+                     " Written:     %u KB of %u KB\n",
+                     stats->inserts,
+                     stats->usec / (stats->inserts * 1000.0f),
+                     stats->max_usec / 1000.0f,
+                     stats->reused_blocks,
+                     stats->blocks,
+                     (unsigned)(movie->checkpoint_bytes / 1024),
+                     (unsigned)(stats->bytes / 1024));
+            }
+#endif
+
+            if (movie && movie->writer)
+            {
+               struct bsv_movie_write_stats *stats = &movie->write_stats;
+               __len += snprintf(video_info.stat_text + __len, sizeof(video_info.stat_text) - __len,
+                     " Queued:      %u KB, %u KB max\n"
+                     " Disk Write:  %5.2f ms avg, %5.2f ms max\n"
+                     " - Stalls:    %u\n",
+                     stats->queued / 1024,
+                     stats->max_queued / 1024,
+                     stats->writes ? stats->usec / (stats->writes * 1000.0f) : 0.0f,
+                     stats->max_usec / 1000.0f,
+                     stats->stalls);
+            }
+         }
+#endif
       }
    }
 
@@ -4390,6 +4760,7 @@ void video_driver_frame(const void *data, unsigned width,
          && video_st->current_video
          && video_st->current_video->frame)
    {
+      retro_time_t driver_start   = frame_timeline_begin();
       video_info.current_subframe = 0;
       if (video_st->current_video->frame(
                video_st->data, data, width, height,
@@ -4406,6 +4777,18 @@ void video_driver_frame(const void *data, unsigned width,
          video_st->flags |=  VIDEO_FLAG_ACTIVE;
       else
          video_st->flags &= ~VIDEO_FLAG_ACTIVE;
+      frame_timeline_end(FRAME_TIMELINE_DRIVER_FRAME, driver_start);
+   }
+   latency_test_presented();
+
+   /* Nothing drawn on this thread holds on to its scratch past here */
+   memarena_reset(video_st->frame_scratch);
+   if (!video_st->frame_scratch)
+   {
+      video_st->frame_scratch        = memarena_new(VIDEO_FRAME_SCRATCH_SIZE);
+#ifdef HAVE_THREADS
+      video_st->frame_scratch_thread = sthread_get_current_thread_id();
+#endif
    }
 
    video_st->frame_count++;
@@ -4480,6 +4863,9 @@ void video_driver_frame(const void *data, unsigned width,
    else if (!video_info.crt_switch_resolution)
 #endif
       video_st->flags          &= ~VIDEO_FLAG_CRT_SWITCHING_ACTIVE;
+
+   frame_timeline_end(FRAME_TIMELINE_VIDEO_FRAME, timeline_start);
+   frame_timeline_next_frame();
 }
 
 static void video_driver_reinit_context(settings_t *settings, int flags)
@@ -31,6 +31,7 @@
 #include <rthreads/rthreads.h>
 #endif
 
+#include <memarena.h>
 #include <gfx/scaler/pixconv.h>
 #include <gfx/scaler/scaler.h>
 
@@ -83,6 +84,9 @@
 
 #define MAX_VARIABLES 64
 
+/* Starting size of a frame scratch arena; it grows to what frames use */
+#define VIDEO_FRAME_SCRATCH_SIZE (64 * 1024)
+
 #ifdef HAVE_THREADS
 #define VIDEO_DRIVER_IS_THREADED_INTERNAL(video_st) ((!video_driver_is_hw_context() && (((video_st->threaded)) ? true : false)))
 
@@ -166,7 +170,10 @@ enum video_driver_state_flags
    VIDEO_FLAG_IS_SWITCHING_DISPLAY_MODE           = (1 << 14),
    VIDEO_FLAG_SHADER_PRESETS_NEED_RELOAD          = (1 << 15),
    VIDEO_FLAG_CLI_SHADER_DISABLE                  = (1 << 16),
-   VIDEO_FLAG_RUNAHEAD_IS_ACTIVE                  = (1 << 17)
+   VIDEO_FLAG_RUNAHEAD_IS_ACTIVE                  = (1 << 17),
+   /* The driver was left running while one core was unloaded,
+    * for the next one to reuse; see video_driver_keep_alive. */
+   VIDEO_FLAG_KEPT_ALIVE                          = (1 << 18)
 };
 
 struct LinkInfo
@@ -466,7 +473,7 @@ typedef struct video_frame_info
 
    uint16_t frame_time_target;
 
-   char stat_text[1024];
+   char stat_text[2048];
 
    bool widgets_active;
    bool notifications_hidden;
@@ -799,6 +806,17 @@ typedef struct
    retro_time_t frame_time_samples[MEASURE_FRAME_TIME_SAMPLES_COUNT];
    uint64_t frame_time_count;
    uint64_t frame_count;
+   /* CPU time the driver spent on the last core frame upload, and
+    * the queue the copy to the GPU ran on; NULL if it reports none */
+   retro_time_t frame_upload_time;
+   const char *frame_upload_queue;
+   /* Offscreen shader passes on the last frame, and how many of
+    * them kept last frame's output; 0 passes if it reports none */
+   unsigned shader_passes;
+   unsigned shader_passes_reused;
+   /* With KMS direct scanout on, why the last frame was composed by
+    * the GPU, or "" if it went straight to a plane; NULL if off */
+   const char *scanout_blocker;
    uint8_t *record_gpu_buffer;
 #ifdef HAVE_VIDEO_FILTER
    rarch_softfilter_t *state_filter;
@@ -863,7 +881,13 @@ typedef struct
    float aspect_ratio;
    float video_refresh_rate_original;
 
+   /* What the driver was set up for when it was kept alive */
+   unsigned kept_scale;
+   unsigned kept_base_width;
+   unsigned kept_base_height;
+
    enum retro_pixel_format pix_fmt;
+   enum retro_pixel_format kept_pix_fmt;
    enum rarch_display_type display_type;
    enum rotation initial_screen_orientation;
    enum rotation current_screen_orientation;
@@ -886,6 +910,13 @@ typedef struct
    char title_buf[64];
    char cached_driver_id[32];
 
+   /* Scratch for the frame drawn on the main thread; the video
+    * thread has its own, see video_driver_frame_scratch */
+   memarena_t *frame_scratch;
+#ifdef HAVE_THREADS
+   uintptr_t frame_scratch_thread;
+#endif
+
    uint16_t frame_drop_count;
    uint16_t frame_time_reserve;
    uint8_t frame_delay_target;
@@ -1142,6 +1173,18 @@ bool video_driver_texture_unload(uintptr_t *id);
 
 void video_driver_build_info(video_frame_info_t *video_info);
 
+/**
+ * video_driver_frame_scratch:
+ *
+ * Scratch memory for the frame being drawn on the calling thread, given
+ * back once the frame is done. Menu and widget drawing code takes its
+ * short-lived buffers from here instead of the heap.
+ *
+ * Returns: the arena, or NULL on threads that draw no frames; the
+ * memarena functions then fall back to malloc and free.
+ **/
+memarena_t *video_driver_frame_scratch(void);
+
 void video_driver_reinit(int flags);
 
 size_t video_driver_get_window_title(char *s, size_t len);
@@ -1317,6 +1360,31 @@ void video_driver_set_viewport_square_pixel(struct retro_game_geometry *geom);
 
 bool video_driver_init_internal(bool *video_is_threaded, bool verbosity_enabled);
 
+/**
+ * video_driver_keep_alive:
+ *
+ * Leaves the video and input drivers running across the next
+ * driver_uninit, so that the core loaded after it can draw into
+ * them without recreating the window. Only software rendered
+ * cores on an unthreaded driver without a software filter qualify.
+ *
+ * Returns: true if the drivers will be kept.
+ **/
+bool video_driver_keep_alive(void);
+
+/**
+ * video_driver_reuse_kept:
+ *
+ * Called by drivers_init instead of video_driver_init_internal
+ * while the drivers are kept alive. Reuses them when the new
+ * core draws in the same pixel format and input scale (and, in
+ * a window, at the same base size); otherwise frees them for a
+ * regular init.
+ *
+ * Returns: true if the kept drivers were reused.
+ **/
+bool video_driver_reuse_kept(settings_t *settings);
+
 /**
  * video_driver_frame:
  * @data                 : pointer to data of the video frame.
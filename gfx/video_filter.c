@@ -36,6 +36,10 @@
 #include "video_filter.h"
 #include "video_filters/softfilter.h"
 
+#ifdef HAVE_THREADS
+#include <rthreads/tpool.h>
+#endif
+
 struct rarch_soft_plug
 {
 #ifdef HAVE_DYLIB
@@ -61,48 +65,26 @@ struct rarch_softfilter
    unsigned threads;
 
 #ifdef HAVE_THREADS
-   struct filter_thread_data *thread_data;
+   /* Runs every packet but the first, which the
+    * calling thread takes */
+   tpool_t *pool;
+   struct filter_job *jobs;
 #endif
 };
 
 #ifdef HAVE_THREADS
-#include <rthreads/rthreads.h>
-
-struct filter_thread_data
+struct filter_job
 {
-   sthread_t *thread;
    const struct softfilter_work_packet *packet;
-   scond_t *cond;
-   slock_t *lock;
    void *userdata;
-   bool die;
-   bool done;
 };
 
-static void filter_thread_loop(void *data)
+static void filter_job_run(void *data)
 {
-   struct filter_thread_data *thr = (struct filter_thread_data*)data;
+   struct filter_job *job = (struct filter_job*)data;
 
-   for (;;)
-   {
-      bool die;
-      slock_lock(thr->lock);
-      while (thr->done && !thr->die)
-         scond_wait(thr->cond, thr->lock);
-      die = thr->die;
-      slock_unlock(thr->lock);
-
-      if (die)
-         break;
-
-      if (thr->packet && thr->packet->work)
-         thr->packet->work(thr->userdata, thr->packet->thread_data);
-
-      slock_lock(thr->lock);
-      thr->done = true;
-      scond_signal(thr->cond);
-      slock_unlock(thr->lock);
-   }
+   if (job->packet->work)
+      job->packet->work(job->userdata, job->packet->thread_data);
 }
 #endif
 
@@ -237,26 +219,18 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
    if (filt->threads > 1)
    {
       unsigned i;
-      if (!(filt->thread_data = (struct filter_thread_data*)
-         calloc(threads, sizeof(*filt->thread_data))))
+      if (!(filt->jobs = (struct filter_job*)
+         calloc(threads, sizeof(*filt->jobs))))
          return false;
 
       for (i = 0; i < threads; i++)
       {
-         filt->thread_data[i].userdata = filt->impl_data;
-         filt->thread_data[i].done     = true;
-
-         filt->thread_data[i].lock     = slock_new();
-         if (!filt->thread_data[i].lock)
-            return false;
-         filt->thread_data[i].cond     = scond_new();
-         if (!filt->thread_data[i].cond)
-            return false;
-         filt->thread_data[i].thread   = sthread_create(
-               filter_thread_loop, &filt->thread_data[i]);
-         if (!filt->thread_data[i].thread)
-            return false;
+         filt->jobs[i].packet   = &filt->packets[i];
+         filt->jobs[i].userdata = filt->impl_data;
       }
+
+      if (!(filt->pool = tpool_create(threads - 1)))
+         return false;
    }
 #endif
 
@@ -497,22 +471,9 @@ void rarch_softfilter_free(rarch_softfilter_t *filt)
 #endif
 
 #ifdef HAVE_THREADS
-   if (filt->threads > 1)
-   {
-      for (i = 0; i < filt->threads; i++)
-      {
-         if (!filt->thread_data[i].thread)
-            continue;
-         slock_lock(filt->thread_data[i].lock);
-         filt->thread_data[i].die = true;
-         scond_signal(filt->thread_data[i].cond);
-         slock_unlock(filt->thread_data[i].lock);
-         sthread_join(filt->thread_data[i].thread);
-         slock_free(filt->thread_data[i].lock);
-         scond_free(filt->thread_data[i].cond);
-      }
-      free(filt->thread_data);
-   }
+   if (filt->pool)
+      tpool_destroy(filt->pool);
+   free(filt->jobs);
 #endif
 
    if (filt->conf)
@@ -558,26 +519,13 @@ void rarch_softfilter_process(rarch_softfilter_t *filt,
             output, output_stride, input, width, height, input_stride);
 
 #ifdef HAVE_THREADS
-   if (filt->threads > 1)
+   if (filt->pool)
    {
-      /* Fire off workers */
-      for (i = 0; i < filt->threads; i++)
-      {
-         filt->thread_data[i].packet = &filt->packets[i];
-         slock_lock(filt->thread_data[i].lock);
-         filt->thread_data[i].done = false;
-         scond_signal(filt->thread_data[i].cond);
-         slock_unlock(filt->thread_data[i].lock);
-      }
-
-      /* Wait for workers */
-      for (i = 0; i < filt->threads; i++)
-      {
-         slock_lock(filt->thread_data[i].lock);
-         while (!filt->thread_data[i].done)
-            scond_wait(filt->thread_data[i].cond, filt->thread_data[i].lock);
-         slock_unlock(filt->thread_data[i].lock);
-      }
+      for (i = 1; i < filt->threads; i++)
+         if (!tpool_add_work(filt->pool, filter_job_run, &filt->jobs[i]))
+            filter_job_run(&filt->jobs[i]);
+      filter_job_run(&filt->jobs[0]);
+      tpool_wait(filt->pool);
       return;
    }
 #endif
@@ -17,6 +17,7 @@
 /* Compile: gcc -o normal2x.so -shared normal2x.c -std=c99 -O3 -Wall -pedantic -fPIC */
 
 #include "softfilter.h"
+#include "softfilter_simd.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -44,6 +45,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   bool vector;
 };
 
 static unsigned normal2x_generic_input_fmts(void)
@@ -79,6 +81,7 @@ static void *normal2x_generic_create(const struct softfilter_config *config,
     * so force single threaded operation... */
    filt->threads = 1;
    filt->in_fmt  = in_fmt;
+   filt->vector  = SOFTFILTER_SIMD_ROWS_USABLE(simd);
    return filt;
 }
 
@@ -101,34 +104,22 @@ static void normal2x_generic_destroy(void *data)
 
 static void normal2x_work_cb_xrgb8888(void *data, void *thread_data)
 {
+   struct filter_data *filt           = (struct filter_data*)data;
    struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
    const uint32_t *input              = (const uint32_t*)thr->in_data;
    uint32_t *output                   = (uint32_t*)thr->out_data;
-   uint32_t in_stride                 = (uint32_t)(thr->in_pitch >> 2);
-   uint32_t out_stride                = (uint32_t)(thr->out_pitch >> 2);
-   uint32_t x, y;
+   size_t in_stride                   = thr->in_pitch >> 2;
+   size_t out_stride                  = thr->out_pitch >> 2;
+   unsigned y;
 
    for (y = 0; y < thr->height; ++y)
    {
-      uint32_t *out_ptr = output;
-      for (x = 0; x < thr->width; ++x)
-      {
-         uint32_t row_color[2];
-         uint32_t *out_line_ptr = out_ptr;
-         uint32_t color         = *(input + x);
-
-         row_color[0]           = color;
-         row_color[1]           = color;
-
-         /* Row 1 */
-         memcpy(out_line_ptr, row_color, sizeof(row_color));
-         out_line_ptr          += out_stride;
-
-         /* Row 2 */
-         memcpy(out_line_ptr, row_color, sizeof(row_color));
-
-         out_ptr += 2;
-      }
+      /* Row 1 */
+      softfilter_double_row_xrgb8888(output, input, thr->width,
+            filt->vector);
+      /* Row 2 */
+      memcpy(output + out_stride, output,
+            (thr->width << 1) * sizeof(*output));
 
       input  += in_stride;
       output += out_stride << 1;
@@ -137,37 +128,25 @@ static void normal2x_work_cb_xrgb8888(void *data, void *thread_data)
 
 static void normal2x_work_cb_rgb565(void *data, void *thread_data)
 {
+   struct filter_data *filt           = (struct filter_data*)data;
    struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
    const uint16_t *input              = (const uint16_t*)thr->in_data;
    uint16_t *output                   = (uint16_t*)thr->out_data;
-   uint16_t in_stride                 = (uint16_t)(thr->in_pitch >> 1);
-   uint16_t out_stride                = (uint16_t)(thr->out_pitch >> 1);
-   uint16_t x, y;
+   size_t in_stride                   = thr->in_pitch >> 1;
+   size_t out_stride                  = thr->out_pitch >> 1;
+   unsigned y;
 
    for (y = 0; y < thr->height; ++y)
    {
-      uint16_t *out_ptr = output;
-      for (x = 0; x < thr->width; ++x)
-      {
-         uint16_t row_color[2];
-         uint16_t *out_line_ptr = out_ptr;
-         uint16_t color         = *(input + x);
+      /* Row 1 */
+      softfilter_double_row_rgb565(output, input, thr->width,
+            filt->vector);
+      /* Row 2 */
+      memcpy(output + out_stride, output,
+            (thr->width << 1) * sizeof(*output));
 
-         row_color[0]           = color;
-         row_color[1]           = color;
-
-         /* Row 1 */
-         memcpy(out_line_ptr, row_color, sizeof(row_color));
-         out_line_ptr          += out_stride;
-
-         /* Row 2 */
-         memcpy(out_line_ptr, row_color, sizeof(row_color));
-
-         out_ptr               += 2;
-      }
-
-      input                    += in_stride;
-      output                   += out_stride << 1;
+      input  += in_stride;
+      output += out_stride << 1;
    }
 }
 
@@ -17,6 +17,7 @@
 /* Compile: gcc -o scanline2x.so -shared scanline2x.c -std=c99 -O3 -Wall -pedantic -fPIC */
 
 #include "softfilter.h"
+#include "softfilter_simd.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -44,6 +45,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   bool vector;
 };
 
 static unsigned scanline2x_generic_input_fmts(void)
@@ -79,6 +81,7 @@ static void *scanline2x_generic_create(const struct softfilter_config *config,
     * so force single threaded operation... */
    filt->threads = 1;
    filt->in_fmt  = in_fmt;
+   filt->vector  = SOFTFILTER_SIMD_ROWS_USABLE(simd);
    return filt;
 }
 
@@ -101,42 +104,19 @@ static void scanline2x_generic_destroy(void *data)
 
 static void scanline2x_work_cb_xrgb8888(void *data, void *thread_data)
 {
+   struct filter_data *filt           = (struct filter_data*)data;
    struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
    const uint32_t *input              = (const uint32_t*)thr->in_data;
    uint32_t *output                   = (uint32_t*)thr->out_data;
-   uint32_t in_stride                 = (uint32_t)(thr->in_pitch >> 2);
-   uint32_t out_stride                = (uint32_t)(thr->out_pitch >> 2);
-   uint32_t x, y;
+   size_t in_stride                   = thr->in_pitch >> 2;
+   size_t out_stride                  = thr->out_pitch >> 2;
+   unsigned y;
 
    for (y = 0; y < thr->height; ++y)
    {
-      uint32_t *out_ptr = output;
-      for (x = 0; x < thr->width; ++x)
-      {
-         uint32_t *out_line_ptr  = out_ptr;
-         uint32_t color          = *(input + x);
-
-         /* Scanline colour is color * 0.75
-          * > First pass: 50:50 mix of color:0 */
-         uint32_t scanline_color = (color + (color & 0x1010101)) >> 1;
-         /* > Second pass: 50:50 mix of color:(color:0)
-          *   => Gives ((1 + 0.5) / 2) = 0.75 */
-         scanline_color = (color + scanline_color + ((color ^ scanline_color) & 0x1010101)) >> 1;
-
-         /* c.f "Mixing Packed RGB Pixels Efficiently"
-          * http://blargg.8bitalley.com/info/rgb_mixing.html */
-
-         /* Row 1: Colour */
-         *out_line_ptr       = color;
-         *(out_line_ptr + 1) = color;
-         out_line_ptr       += out_stride;
-
-         /* Row 2: Scanline */
-         *out_line_ptr       = scanline_color;
-         *(out_line_ptr + 1) = scanline_color;
-
-         out_ptr += 2;
-      }
+      /* Row 1: Colour, Row 2: Scanline */
+      softfilter_scanline_rows_xrgb8888(output, out_stride, input,
+            thr->width, filt->vector);
 
       input  += in_stride;
       output += out_stride << 1;
@@ -145,42 +125,19 @@ static void scanline2x_work_cb_xrgb8888(void *data, void *thread_data)
 
 static void scanline2x_work_cb_rgb565(void *data, void *thread_data)
 {
+   struct filter_data *filt           = (struct filter_data*)data;
    struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
    const uint16_t *input              = (const uint16_t*)thr->in_data;
    uint16_t *output                   = (uint16_t*)thr->out_data;
-   uint16_t in_stride                 = (uint16_t)(thr->in_pitch >> 1);
-   uint16_t out_stride                = (uint16_t)(thr->out_pitch >> 1);
-   uint16_t x, y;
+   size_t in_stride                   = thr->in_pitch >> 1;
+   size_t out_stride                  = thr->out_pitch >> 1;
+   unsigned y;
 
    for (y = 0; y < thr->height; ++y)
    {
-      uint16_t *out_ptr = output;
-      for (x = 0; x < thr->width; ++x)
-      {
-         uint16_t *out_line_ptr  = out_ptr;
-         uint16_t color          = *(input + x);
-
-         /* Scanline colour is color * 0.75
-          * > First pass: 50:50 mix of color:0 */
-         uint16_t scanline_color = (color + (color & 0x821)) >> 1;
-         /* > Second pass: 50:50 mix of color:(color:0)
-          *   => Gives ((1 + 0.5) / 2) = 0.75 */
-         scanline_color = (color + scanline_color + ((color ^ scanline_color) & 0x821)) >> 1;
-
-         /* c.f "Mixing Packed RGB Pixels Efficiently"
-          * http://blargg.8bitalley.com/info/rgb_mixing.html */
-
-         /* Row 1: Colour */
-         *out_line_ptr       = color;
-         *(out_line_ptr + 1) = color;
-         out_line_ptr       += out_stride;
-
-         /* Row 2: Scanline */
-         *out_line_ptr       = scanline_color;
-         *(out_line_ptr + 1) = scanline_color;
-
-         out_ptr += 2;
-      }
+      /* Row 1: Colour, Row 2: Scanline */
+      softfilter_scanline_rows_rgb565(output, out_stride, input,
+            thr->width, filt->vector);
 
       input  += in_stride;
       output += out_stride << 1;
@@ -0,0 +1,292 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Row kernels shared by the 2x softfilters. Each has an SSE2 or NEON
+ * body where the build targets one, taken when the 'vector' argument
+ * says the CPU has it, and a scalar loop for the rest of the row.
+ * Both give the same output bit for bit. */
+
+#ifndef __SOFTFILTER_SIMD_H
+#define __SOFTFILTER_SIMD_H
+
+#include <stdint.h>
+
+#include <boolean.h>
+#include <retro_inline.h>
+
+#include "softfilter.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SOFTFILTER_SIMD_ROWS SOFTFILTER_SIMD_SSE2
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON) || defined(HAVE_NEON)
+#include <arm_neon.h>
+#define SOFTFILTER_SIMD_ROWS SOFTFILTER_SIMD_NEON
+#else
+#define SOFTFILTER_SIMD_ROWS 0
+#endif
+
+/* Whether the row kernels can take their vector body on a CPU with
+ * the features in 'simd' */
+#define SOFTFILTER_SIMD_ROWS_USABLE(simd) \
+   (SOFTFILTER_SIMD_ROWS && ((simd) & SOFTFILTER_SIMD_ROWS))
+
+/* Scanline colour is color * 0.75
+ * > First pass: 50:50 mix of color:0
+ * > Second pass: 50:50 mix of color:(color:0)
+ *   => Gives ((1 + 0.5) / 2) = 0.75
+ * c.f "Mixing Packed RGB Pixels Efficiently"
+ * http://blargg.8bitalley.com/info/rgb_mixing.html */
+static INLINE uint32_t softfilter_scanline_xrgb8888(uint32_t color)
+{
+   uint32_t scanline_color = (color + (color & 0x1010101)) >> 1;
+   return (color + scanline_color
+         + ((color ^ scanline_color) & 0x1010101)) >> 1;
+}
+
+static INLINE uint16_t softfilter_scanline_rgb565(uint16_t color)
+{
+   uint16_t scanline_color = (color + (color & 0x821)) >> 1;
+   return (color + scanline_color
+         + ((color ^ scanline_color) & 0x821)) >> 1;
+}
+
+/* out[2x] = out[2x + 1] = in[x], for 'width' input pixels */
+static INLINE void softfilter_double_row_xrgb8888(uint32_t *out,
+      const uint32_t *in, unsigned width, bool vector)
+{
+   unsigned x = 0;
+
+#if defined(__SSE2__)
+   if (vector)
+   {
+      for (; x + 4 <= width; x += 4)
+      {
+         __m128i color = _mm_loadu_si128((const __m128i*)(in + x));
+         _mm_storeu_si128((__m128i*)(out + 2 * x),
+               _mm_unpacklo_epi32(color, color));
+         _mm_storeu_si128((__m128i*)(out + 2 * x + 4),
+               _mm_unpackhi_epi32(color, color));
+      }
+   }
+#elif SOFTFILTER_SIMD_ROWS
+   if (vector)
+   {
+      for (; x + 4 <= width; x += 4)
+      {
+         uint32x4x2_t pair;
+         pair.val[0] = pair.val[1] = vld1q_u32(in + x);
+         /* Interleaving a vector with itself doubles each pixel */
+         vst2q_u32(out + 2 * x, pair);
+      }
+   }
+#endif
+
+   for (; x < width; x++)
+   {
+      out[2 * x]     = in[x];
+      out[2 * x + 1] = in[x];
+   }
+}
+
+static INLINE void softfilter_double_row_rgb565(uint16_t *out,
+      const uint16_t *in, unsigned width, bool vector)
+{
+   unsigned x = 0;
+
+#if defined(__SSE2__)
+   if (vector)
+   {
+      for (; x + 8 <= width; x += 8)
+      {
+         __m128i color = _mm_loadu_si128((const __m128i*)(in + x));
+         _mm_storeu_si128((__m128i*)(out + 2 * x),
+               _mm_unpacklo_epi16(color, color));
+         _mm_storeu_si128((__m128i*)(out + 2 * x + 8),
+               _mm_unpackhi_epi16(color, color));
+      }
+   }
+#elif SOFTFILTER_SIMD_ROWS
+   if (vector)
+   {
+      for (; x + 8 <= width; x += 8)
+      {
+         uint16x8x2_t pair;
+         pair.val[0] = pair.val[1] = vld1q_u16(in + x);
+         vst2q_u16(out + 2 * x, pair);
+      }
+   }
+#endif
+
+   for (; x < width; x++)
+   {
+      out[2 * x]     = in[x];
+      out[2 * x + 1] = in[x];
+   }
+}
+
+/* Doubles the row into 'out' like softfilter_double_row_*(), and
+ * into the row 'out_stride' pixels below darkened by
+ * softfilter_scanline_*() */
+static INLINE void softfilter_scanline_rows_xrgb8888(uint32_t *out,
+      size_t out_stride, const uint32_t *in, unsigned width, bool vector)
+{
+   unsigned x = 0;
+
+#if defined(__SSE2__)
+   if (vector)
+   {
+      const __m128i low = _mm_set1_epi32(0x1010101);
+      for (; x + 4 <= width; x += 4)
+      {
+         __m128i color    = _mm_loadu_si128((const __m128i*)(in + x));
+         __m128i scanline = _mm_srli_epi32(_mm_add_epi32(color,
+                  _mm_and_si128(color, low)), 1);
+         scanline         = _mm_srli_epi32(_mm_add_epi32(
+                  _mm_add_epi32(color, scanline),
+                  _mm_and_si128(_mm_xor_si128(color, scanline), low)), 1);
+         _mm_storeu_si128((__m128i*)(out + 2 * x),
+               _mm_unpacklo_epi32(color, color));
+         _mm_storeu_si128((__m128i*)(out + 2 * x + 4),
+               _mm_unpackhi_epi32(color, color));
+         _mm_storeu_si128((__m128i*)(out + out_stride + 2 * x),
+               _mm_unpacklo_epi32(scanline, scanline));
+         _mm_storeu_si128((__m128i*)(out + out_stride + 2 * x + 4),
+               _mm_unpackhi_epi32(scanline, scanline));
+      }
+   }
+#elif SOFTFILTER_SIMD_ROWS
+   if (vector)
+   {
+      const uint32x4_t low = vdupq_n_u32(0x1010101);
+      for (; x + 4 <= width; x += 4)
+      {
+         uint32x4x2_t pair;
+         uint32x4_t color    = vld1q_u32(in + x);
+         uint32x4_t scanline = vshrq_n_u32(vaddq_u32(color,
+                  vandq_u32(color, low)), 1);
+         scanline            = vshrq_n_u32(vaddq_u32(
+                  vaddq_u32(color, scanline),
+                  vandq_u32(veorq_u32(color, scanline), low)), 1);
+         pair.val[0] = pair.val[1] = color;
+         vst2q_u32(out + 2 * x, pair);
+         pair.val[0] = pair.val[1] = scanline;
+         vst2q_u32(out + out_stride + 2 * x, pair);
+      }
+   }
+#endif
+
+   for (; x < width; x++)
+   {
+      uint32_t color                  = in[x];
+      uint32_t scanline_color         = softfilter_scanline_xrgb8888(color);
+      out[2 * x]                      = color;
+      out[2 * x + 1]                  = color;
+      out[out_stride + 2 * x]         = scanline_color;
+      out[out_stride + 2 * x + 1]     = scanline_color;
+   }
+}
+
+static INLINE void softfilter_scanline_rows_rgb565(uint16_t *out,
+      size_t out_stride, const uint16_t *in, unsigned width, bool vector)
+{
+   unsigned x = 0;
+
+   /* The scalar sums carry past 16 bits, so the vector bodies
+    * widen to 32 bits before adding */
+#if defined(__SSE2__)
+   if (vector)
+   {
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i low  = _mm_set1_epi32(0x821);
+      for (; x + 8 <= width; x += 8)
+      {
+         __m128i halves[2];
+         unsigned i;
+         __m128i color = _mm_loadu_si128((const __m128i*)(in + x));
+
+         _mm_storeu_si128((__m128i*)(out + 2 * x),
+               _mm_unpacklo_epi16(color, color));
+         _mm_storeu_si128((__m128i*)(out + 2 * x + 8),
+               _mm_unpackhi_epi16(color, color));
+
+         halves[0]     = _mm_unpacklo_epi16(color, zero);
+         halves[1]     = _mm_unpackhi_epi16(color, zero);
+
+         for (i = 0; i < 2; i++)
+         {
+            __m128i scanline = _mm_srli_epi32(_mm_add_epi32(halves[i],
+                     _mm_and_si128(halves[i], low)), 1);
+            scanline         = _mm_srli_epi32(_mm_add_epi32(
+                     _mm_add_epi32(halves[i], scanline),
+                     _mm_and_si128(_mm_xor_si128(halves[i], scanline),
+                        low)), 1);
+            /* Keep the low 16 bits, sign extended so that the
+             * saturating pack leaves them alone */
+            halves[i]        = _mm_srai_epi32(
+                  _mm_slli_epi32(scanline, 16), 16);
+         }
+
+         color = _mm_packs_epi32(halves[0], halves[1]);
+         _mm_storeu_si128((__m128i*)(out + out_stride + 2 * x),
+               _mm_unpacklo_epi16(color, color));
+         _mm_storeu_si128((__m128i*)(out + out_stride + 2 * x + 8),
+               _mm_unpackhi_epi16(color, color));
+      }
+   }
+#elif SOFTFILTER_SIMD_ROWS
+   if (vector)
+   {
+      const uint32x4_t low = vdupq_n_u32(0x821);
+      for (; x + 8 <= width; x += 8)
+      {
+         uint32x4_t halves[2];
+         uint16x8x2_t pair;
+         unsigned i;
+         uint16x8_t color = vld1q_u16(in + x);
+
+         pair.val[0]      = pair.val[1] = color;
+         vst2q_u16(out + 2 * x, pair);
+
+         halves[0]        = vmovl_u16(vget_low_u16(color));
+         halves[1]        = vmovl_u16(vget_high_u16(color));
+
+         for (i = 0; i < 2; i++)
+         {
+            uint32x4_t scanline = vshrq_n_u32(vaddq_u32(halves[i],
+                     vandq_u32(halves[i], low)), 1);
+            halves[i]           = vshrq_n_u32(vaddq_u32(
+                     vaddq_u32(halves[i], scanline),
+                     vandq_u32(veorq_u32(halves[i], scanline), low)), 1);
+         }
+
+         pair.val[0] = pair.val[1] = vcombine_u16(
+               vmovn_u32(halves[0]), vmovn_u32(halves[1]));
+         vst2q_u16(out + out_stride + 2 * x, pair);
+      }
+   }
+#endif
+
+   for (; x < width; x++)
+   {
+      uint16_t color                  = in[x];
+      uint16_t scanline_color         = softfilter_scanline_rgb565(color);
+      out[2 * x]                      = color;
+      out[2 * x + 1]                  = color;
+      out[out_stride + 2 * x]         = scanline_color;
+      out[out_stride + 2 * x + 1]     = scanline_color;
+   }
+}
+
+#endif
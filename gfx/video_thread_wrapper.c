@@ -420,13 +420,26 @@ static void video_thread_loop(void *data)
    bool updated;
    thread_video_t *thr = (thread_video_t*)data;
 
+   sthread_role_register("video");
+   thr->scratch = memarena_new(VIDEO_FRAME_SCRATCH_SIZE);
+
    for (;;)
    {
       slock_lock(thr->lock);
       while (thr->send_cmd == CMD_VIDEO_NONE && !thr->frame.updated)
          scond_wait(thr->cond_thread, thr->lock);
 
-      updated = thr->frame.updated;
+      /* Take the newest frame, leaving the slot it
+       * replaces for the emulation thread to fill */
+      if ((updated = thr->frame.updated))
+      {
+         unsigned render    = thr->frame.render;
+         thr->frame.render  = thr->frame.ready;
+         thr->frame.ready   = render;
+         thr->frame.updated = false;
+         thr->frame.busy    = true;
+         scond_signal(thr->cond_cmd);
+      }
 
       /* To avoid race condition where send_cmd is updated
        * right after the switch is checked. */
@@ -435,7 +448,7 @@ static void video_thread_loop(void *data)
       slock_unlock(thr->lock);
 
       if (video_thread_handle_packet(thr, &pkt))
-         return;
+         break;
 
       if (updated)
       {
@@ -461,16 +474,23 @@ static void video_thread_loop(void *data)
             {
                video_frame_info_t video_info;
                bool               ret;
+               thread_frame_slot_t *slot =
+                  &thr->frame.slots[thr->frame.render];
 
                /* TODO/FIXME - not thread-safe - should get
                 * rid of this */
                video_driver_build_info(&video_info);
 
+               /* Duplicate frames go through as NULL, as they
+                * do without the thread, so the driver reuses
+                * what it uploaded last */
                ret = thr->driver->frame(thr->driver_data,
-                  thr->frame.buffer, thr->frame.width, thr->frame.height,
-                  thr->frame.count, thr->frame.pitch,
-                  *thr->frame.msg ? thr->frame.msg : NULL,
+                  slot->dupe ? NULL : slot->buffer,
+                  slot->width, slot->height,
+                  slot->count, slot->pitch,
+                  *slot->msg ? slot->msg : NULL,
                   &video_info);
+               memarena_reset(thr->scratch);
 
                slock_unlock(thr->frame.lock);
 
@@ -498,11 +518,15 @@ static void video_thread_loop(void *data)
          thr->focus         = focus;
          thr->has_windowed  = has_windowed;
          thr->vp            = vp;
-         thr->frame.updated = false;
+         thr->frame.busy    = false;
          scond_signal(thr->cond_cmd);
          slock_unlock(thr->lock);
       }
    }
+
+   memarena_free(thr->scratch);
+   thr->scratch = NULL;
+   sthread_role_unregister();
 }
 
 static bool video_thread_alive(void *data)
@@ -602,6 +626,8 @@ static bool video_thread_frame(void *data, const void *frame_,
 
    slock_lock(thr->lock);
 
+   /* Pace to the display while the video thread has not
+    * taken the last frame yet */
    if (!thr->nonblock)
    {
       retro_time_t target_frame_time =
@@ -622,49 +648,80 @@ static bool video_thread_frame(void *data, const void *frame_,
       }
    }
 
-   /* Drop frame if updated flag is still set, as thread is
-    * still working on last frame. */
-   if (!thr->frame.updated)
+   /* A duplicate behind a frame that was not taken yet
+    * would only hide it */
+   if (!frame_ && thr->frame.updated)
+   {
+      thr->dupe_count++;
+      slock_unlock(thr->lock);
+      thr->last_time = cpu_features_get_time_usec();
+      return true;
+   }
+
+   slock_unlock(thr->lock);
+
+   /* 'write' belongs to this thread alone, so it is filled
+    * without holding the lock */
    {
-      const uint8_t *src   = (const uint8_t*)frame_;
-      uint8_t       *dst   = thr->frame.buffer;
-      unsigned copy_stride = width *
+      thread_frame_slot_t *slot = &thr->frame.slots[thr->frame.write];
+      unsigned copy_stride      = width *
          (thr->info.rgb32 ? sizeof(uint32_t) : sizeof(uint16_t));
 
-      if (src)
+      slot->dupe = !frame_;
+
+      if (frame_ == slot->buffer)
+         /* Rendered straight into the slot, see
+          * thread_get_current_software_framebuffer() */
+         copy_stride = pitch;
+      else if (frame_)
       {
-         int i; /* TODO/FIXME - increment counter never meaningfully used */
-         for (i = 0; i < (int)height; i++, src += pitch, dst += copy_stride)
+         unsigned i;
+         const uint8_t *src = (const uint8_t*)frame_;
+         uint8_t       *dst = slot->buffer;
+
+         for (i = 0; i < height; i++, src += pitch, dst += copy_stride)
             memcpy(dst, src, copy_stride);
       }
+      else
+         thr->dupe_count++;
 
-      thr->frame.updated = true;
-      thr->frame.width   = width;
-      thr->frame.height  = height;
-      thr->frame.count   = frame_count;
-      thr->frame.pitch   = copy_stride;
+      slot->width  = width;
+      slot->height = height;
+      slot->count  = frame_count;
+      slot->pitch  = copy_stride;
 
       if (msg)
-         strlcpy(thr->frame.msg, msg, sizeof(thr->frame.msg));
+         strlcpy(slot->msg, msg, sizeof(slot->msg));
       else
-         *thr->frame.msg = '\0';
+         *slot->msg = '\0';
+   }
 
-      scond_signal(thr->cond_thread);
+   slock_lock(thr->lock);
 
-#ifdef HAVE_MENU
-      if (thr->texture.enable)
-      {
-         do
-         {
-            scond_wait(thr->cond_cmd, thr->lock);
-         } while (thr->frame.updated);
-      }
-#endif
-      thr->hit_count++;
+   {
+      unsigned ready     = thr->frame.ready;
+      thr->frame.ready   = thr->frame.write;
+      thr->frame.write   = ready;
    }
-   else
+
+   /* The video thread is more than a frame behind:
+    * the frame it did not take is dropped */
+   if (thr->frame.updated && !thr->frame.slots[thr->frame.write].dupe)
       thr->miss_count++;
 
+   thr->frame.updated  = true;
+   thr->hit_count++;
+
+   scond_signal(thr->cond_thread);
+
+#ifdef HAVE_MENU
+   if (thr->texture.enable)
+   {
+      while (thr->frame.updated || thr->frame.busy)
+         scond_wait(thr->cond_cmd, thr->lock);
+   }
+#endif
+
    slock_unlock(thr->lock);
 
    thr->last_time = cpu_features_get_time_usec();
@@ -700,20 +757,30 @@ static bool video_thread_init(thread_video_t *thr,
       return false;
 
    {
+      unsigned i;
       size_t max_size        = info.input_scale * RARCH_SCALE_BASE;
       max_size              *= max_size;
       max_size              *= info.rgb32 ?
          sizeof(uint32_t) : sizeof(uint16_t);
 
+      for (i = 0; i < VIDEO_THREAD_FRAME_SLOTS; i++)
+      {
+         thread_frame_slot_t *slot = &thr->frame.slots[i];
 #ifdef _3DS
-      thr->frame.buffer      = linearMemAlign(max_size, 0x80);
+         slot->buffer        = linearMemAlign(max_size, 0x80);
 #else
-      thr->frame.buffer      = (uint8_t*)malloc(max_size);
+         slot->buffer        = (uint8_t*)malloc(max_size);
 #endif
-      if (!thr->frame.buffer)
-         return false;
+         if (!slot->buffer)
+            return false;
+
+         memset(slot->buffer, 0x80, max_size);
+      }
 
-      memset(thr->frame.buffer, 0x80, max_size);
+      thr->frame.slot_size   = max_size;
+      thr->frame.write       = 0;
+      thr->frame.ready       = 1;
+      thr->frame.render      = 2;
    }
 
    thr->input                = input;
@@ -845,11 +912,15 @@ static void video_thread_free(void *data)
       }
 
       free(thr->texture.frame);
+      {
+         unsigned i;
+         for (i = 0; i < VIDEO_THREAD_FRAME_SLOTS; i++)
 #ifdef _3DS
-      linearFree(thr->frame.buffer);
+            linearFree(thr->frame.slots[i].buffer);
 #else
-      free(thr->frame.buffer);
+            free(thr->frame.slots[i].buffer);
 #endif
+      }
       free(thr->alpha_mod);
 
       slock_free(thr->frame.lock);
@@ -859,8 +930,9 @@ static void video_thread_free(void *data)
       scond_free(thr->cond_thread);
 
       RARCH_LOG(
-         "Threaded video stats: Frames pushed: %u, Frames dropped: %u.\n",
-         thr->hit_count, thr->miss_count);
+         "Threaded video stats: Frames pushed: %u, Frames dropped: %u, "
+         "Frames duplicated: %u.\n",
+         thr->hit_count, thr->miss_count, thr->dupe_count);
 
       free(thr);
    }
@@ -1243,6 +1315,35 @@ static void thread_apply_state_changes(void *data)
    }
 }
 
+/* Lends the core the slot the next frame goes into, so that
+ * video_thread_frame() has nothing to copy. Cores that read
+ * back their last frame are not given one, since the slot
+ * holds a frame from further back. */
+static bool thread_get_current_software_framebuffer(void *data,
+      struct retro_framebuffer *framebuffer)
+{
+   thread_video_t *thr = (thread_video_t*)data;
+   unsigned bpp;
+
+   if (     !thr
+         || thr->frame.within_thread
+         || (framebuffer->access_flags & RETRO_MEMORY_ACCESS_READ)
+         || video_state_get_ptr()->pix_fmt == RETRO_PIXEL_FORMAT_0RGB1555)
+      return false;
+
+   bpp = thr->info.rgb32 ? sizeof(uint32_t) : sizeof(uint16_t);
+   if ((size_t)framebuffer->width * framebuffer->height * bpp
+         > thr->frame.slot_size)
+      return false;
+
+   framebuffer->data         = thr->frame.slots[thr->frame.write].buffer;
+   framebuffer->pitch        = framebuffer->width * bpp;
+   framebuffer->format       = thr->info.rgb32
+      ? RETRO_PIXEL_FORMAT_XRGB8888 : RETRO_PIXEL_FORMAT_RGB565;
+   framebuffer->memory_flags = RETRO_MEMORY_TYPE_CACHED;
+   return true;
+}
+
 /* This is read-only state which should not
  * have any kind of race condition. */
 static struct video_shader *thread_get_current_shader(void *data)
@@ -1285,7 +1386,7 @@ static const video_poke_interface_t thread_poke = {
    thread_show_mouse,
    thread_grab_mouse_toggle,
    thread_get_current_shader,
-   NULL, /* get_current_software_framebuffer */
+   thread_get_current_software_framebuffer,
    NULL, /* get_hw_render_interface */
    thread_set_hdr_max_nits,
    thread_set_hdr_paper_white_nits,
@@ -1452,3 +1553,15 @@ unsigned video_thread_texture_handle(void *data, custom_command_method_t func)
 
    return pkt.data.custom_command.return_value;
 }
+
+memarena_t *video_thread_frame_scratch(void *data, bool any_thread)
+{
+   thread_video_t *thr = (thread_video_t*)data;
+
+   if (!thr || !thr->thread)
+      return NULL;
+   if (    !any_thread
+         && sthread_get_thread_id(thr->thread) != sthread_get_current_thread_id())
+      return NULL;
+   return thr->scratch;
+}
@@ -23,6 +23,7 @@
 #include <retro_common_api.h>
 #include <rthreads/rthreads.h>
 #include <retro_miscellaneous.h>
+#include <memarena.h>
 
 #include "font_driver.h"
 
@@ -166,6 +167,21 @@ typedef struct thread_packet
    enum thread_cmd type;
 } thread_packet_t;
 
+/* Frames in flight between the emulation thread and the
+ * video thread */
+#define VIDEO_THREAD_FRAME_SLOTS 3
+
+typedef struct thread_frame_slot
+{
+   uint64_t count;
+   uint8_t *buffer;
+   unsigned width;
+   unsigned height;
+   unsigned pitch;
+   char msg[NAME_MAX_LENGTH];
+   bool dupe;  /* Core sent no new pixels for this frame */
+} thread_frame_slot_t;
+
 typedef struct thread_video
 {
    retro_time_t last_time;
@@ -205,6 +221,7 @@ typedef struct thread_video
 
    unsigned hit_count;
    unsigned miss_count;
+   unsigned dupe_count;
    unsigned alpha_mods;
 
    struct video_viewport vp;
@@ -218,16 +235,23 @@ typedef struct thread_video
 
    bool alpha_update;
 
+   /* Frame scratch of the video thread, reset after every frame */
+   memarena_t *scratch;
+
+   /* Triple buffer: the emulation thread fills 'write' and
+    * publishes it by swapping it with 'ready', the video thread
+    * takes it by swapping 'ready' with 'render'. Only the swaps
+    * happen under 'lock', never the copies or the rendering. */
    struct
    {
-      uint64_t count;
+      thread_frame_slot_t slots[VIDEO_THREAD_FRAME_SLOTS];
       slock_t *lock;
-      uint8_t *buffer;
-      unsigned width;
-      unsigned height;
-      unsigned pitch;
-      char msg[NAME_MAX_LENGTH];
-      bool updated;
+      size_t slot_size;
+      unsigned write;
+      unsigned ready;
+      unsigned render;
+      bool updated;  /* 'ready' holds a frame not taken yet */
+      bool busy;     /* 'render' is being drawn */
       bool within_thread;
    } frame;
 
@@ -273,6 +297,16 @@ bool video_thread_font_init(
 unsigned video_thread_texture_handle(void *data,
       custom_command_method_t func);
 
+/**
+ * video_thread_frame_scratch:
+ * @data                : Threaded video driver data.
+ * @any_thread          : Return it whichever thread asks.
+ *
+ * Returns: the video thread's frame scratch; NULL when not called
+ * from the video thread, unless @any_thread is set.
+ **/
+memarena_t *video_thread_frame_scratch(void *data, bool any_thread);
+
 RETRO_END_DECLS
 
 #endif
@@ -92,6 +92,7 @@ COMPATIBILITY
 #include "../libretro-common/compat/compat_strldup.c"
 #include "../libretro-common/compat/fopen_utf8.c"
 #include "../libretro-common/memmap/memalign.c"
+#include "../libretro-common/memmap/memarena.c"
 
 /*============================================================
 CONSOLE EXTENSIONS
@@ -610,7 +611,11 @@ INPUT
 #include "../input/input_driver.c"
 #ifdef HAVE_BSV_MOVIE
 #include "../input/bsv/bsvmovie.c"
+#include "../input/bsv/replay_export.c"
+#endif
+#if defined(HAVE_BSV_MOVIE) || defined(HAVE_REWIND)
 #include "../input/bsv/uint32s_index.c"
+#include "../state_store.c"
 #endif
 #include "../input/input_keymaps.c"
 #include "../tasks/task_autodetect.c"
@@ -796,6 +801,7 @@ INPUT (HID)
 FIFO BUFFER
 ============================================================ */
 #include "../libretro-common/queues/fifo_queue.c"
+#include "../libretro-common/queues/spsc_ring.c"
 
 /*============================================================
 AUDIO RESAMPLER
@@ -913,6 +919,10 @@ AUDIO
 #include "../audio/drivers/opensl.c"
 #endif
 
+#ifdef HAVE_AAUDIO
+#include "../audio/drivers/aaudio.c"
+#endif
+
 #ifdef HAVE_PIPEWIRE
 #include "../audio/drivers/pipewire.c"
 #include "../audio/common/pipewire.c"
@@ -968,6 +978,7 @@ DRIVERS
 #include "../gfx/gfx_animation.c"
 #include "../gfx/gfx_display.c"
 #include "../gfx/gfx_thumbnail_path.c"
+#include "../gfx/gfx_thumbnail_pack.c"
 #include "../gfx/gfx_thumbnail.c"
 #ifdef HAVE_AUDIOMIXER
 #include "../libretro-common/audio/audio_mixer.c"
@@ -1061,6 +1072,7 @@ FILE
 ============================================================ */
 #include "../libretro-common/file/file_path.c"
 #include "../libretro-common/file/file_path_io.c"
+#include "../libretro-common/file/file_write_atomic.c"
 #include "../file_path_special.c"
 #include "../libretro-common/lists/dir_list.c"
 #include "../libretro-common/lists/string_list.c"
@@ -1195,6 +1207,9 @@ RETROARCH
 ============================================================ */
 #include "../retroarch.c"
 #include "../runloop.c"
+#include "../frame_timeline.c"
+#include "../clock_governor.c"
+#include "../latency_test.c"
 #ifdef HAVE_RUNAHEAD
 #include "../runahead.c"
 #endif
@@ -1235,6 +1250,7 @@ RECORDING
 ============================================================ */
 #include "../record/record_driver.c"
 #include "../record/drivers/record_wav.c"
+#include "../record/drivers/record_shm.c"
 #ifdef HAVE_FFMPEG
 #include "../record/drivers/record_ffmpeg.c"
 #endif
@@ -1249,8 +1265,10 @@ THREAD
 #endif
 
 #include "../libretro-common/rthreads/rthreads.c"
+#include "../libretro-common/rthreads/tpool.c"
 #include "../gfx/video_thread_wrapper.c"
 #include "../audio/audio_thread_wrapper.c"
+#include "../input/input_joypad_thread.c"
 #endif
 
 /* needed for playlists, netplay lobbies and achievements */
@@ -1272,6 +1290,9 @@ NETPLAY
 #include "../tasks/task_http.c"
 #include "../tasks/task_netplay_lan_scan.c"
 #include "../tasks/task_netplay_nat_traversal.c"
+#include "../tasks/task_netplay_ggpo_resolve.c"
+#include "../tasks/task_netplay_ggpo_desync_dump.c"
+#include "../tasks/task_netplay_rooms.c"
 #ifdef HAVE_BLUETOOTH
 #include "../tasks/task_bluetooth.c"
 #endif
@@ -1310,6 +1331,10 @@ DATA RUNLOOP
 #include "../tasks/task_image.c"
 #include "../tasks/task_file_transfer.c"
 #include "../tasks/task_playlist_manager.c"
+#ifdef HAVE_MENU
+#include "../tasks/task_thumbnail_pack.c"
+#endif
+#include "../tasks/task_content_preload.c"
 #include "../tasks/task_core_backup.c"
 #ifdef HAVE_TRANSLATE
 #include "../tasks/task_translation.c"
@@ -1468,6 +1493,7 @@ DEPENDENCIES
 #endif
 
 #include "../libretro-common/streams/chd_stream.c"
+#include "../tasks/task_chd_verify.c"
 #endif
 #endif
 
@@ -1693,7 +1719,6 @@ FFMPEG
 #ifdef HAVE_FFMPEG
 #include "../cores/libretro-ffmpeg/packet_buffer.c"
 #include "../cores/libretro-ffmpeg/video_buffer.c"
-#include "../libretro-common/rthreads/tpool.c"
 #endif
 
 /*============================================================
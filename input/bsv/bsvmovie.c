@@ -20,16 +20,23 @@
 #include <stdint.h>
 #include "../input_driver.h"
 #include "../../retroarch.h"
+#include "../../command.h"
 #include "../../state_manager.h"
 #include "../../tasks/task_content.h"
 #include "../../libretro-db/rmsgpack.h"
 #include "../../libretro-db/rmsgpack_dom.h"
 #include "../../verbosity.h"
 #ifdef HAVE_STATESTREAM
-#include "uint32s_index.h"
+#include "../../state_store.h"
 #endif
 #include <libretro.h>
 #include <streams/interface_stream.h>
+#include <streams/file_stream.h>
+#include <features/features_cpu.h>
+#include <array/rbuf.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 #ifdef HAVE_CHEEVOS
 #include "../../cheevos/cheevos.h"
 #endif
@@ -74,10 +81,354 @@ int64_t bsv_movie_write_deduped_state(bsv_movie_t *movie, uint8_t *state, size_t
 bool bsv_movie_read_deduped_state(bsv_movie_t *movie, uint8_t *encoded, size_t encoded_size);
 #endif
 
+#ifdef HAVE_THREADS
+/* Each of the two buffers; the frame only waits on the disk when both
+ * are full */
+#define BSV_MOVIE_WRITER_BUFFER_SIZE (1 << 20)
+
+struct bsv_movie_writer
+{
+   intfstream_t *file;
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   uint8_t *buffers[2];
+   struct bsv_movie_write_stats stats;
+   /* Where the file will be once everything queued is written */
+   int64_t pos;
+   /* Bytes in the buffer being filled, and in the one being written */
+   size_t fill;
+   size_t pending;
+   unsigned front;
+   bool pos_valid;
+   /* The writer thread has the other buffer */
+   bool busy;
+   bool flush;
+   bool failed;
+   bool quit;
+};
+
+static void bsv_movie_writer_thread(void *data)
+{
+   struct bsv_movie_writer *writer = (struct bsv_movie_writer*)data;
+
+   slock_lock(writer->lock);
+   for (;;)
+   {
+      retro_time_t start;
+      uint32_t usec;
+      bool ok;
+      size_t len;
+      uint8_t *buf;
+
+      while (!writer->busy && !writer->quit)
+         scond_wait(writer->cond, writer->lock);
+      if (!writer->busy)
+         break;
+      buf = writer->buffers[writer->front ^ 1];
+      len = writer->pending;
+      slock_unlock(writer->lock);
+
+      start = cpu_features_get_time_usec();
+      ok    = intfstream_write(writer->file, buf, len) == (int64_t)len;
+      /* Frames written over an earlier timeline end it */
+      intfstream_truncate(writer->file, intfstream_tell(writer->file));
+      if (writer->flush)
+         intfstream_flush(writer->file);
+      usec  = (uint32_t)(cpu_features_get_time_usec() - start);
+
+      slock_lock(writer->lock);
+      writer->stats.writes++;
+      writer->stats.usec   += usec;
+      if (usec > writer->stats.max_usec)
+         writer->stats.max_usec = usec;
+      writer->stats.queued -= (uint32_t)len;
+      if (!ok)
+         writer->failed     = true;
+      writer->pending       = 0;
+      writer->busy          = false;
+      scond_signal(writer->cond);
+   }
+   slock_unlock(writer->lock);
+}
+
+/* Hands the buffer being filled to the writer thread, first waiting for
+ * it to finish the other one */
+static void bsv_movie_writer_submit(bsv_movie_t *movie, bool flush)
+{
+   struct bsv_movie_writer *writer = movie->writer;
+
+   slock_lock(writer->lock);
+   if (writer->busy)
+   {
+      writer->stats.stalls++;
+      while (writer->busy)
+         scond_wait(writer->cond, writer->lock);
+   }
+   writer->pending = writer->fill;
+   writer->flush   = flush;
+   writer->busy    = true;
+   writer->front  ^= 1;
+   writer->fill    = 0;
+   scond_signal(writer->cond);
+   movie->write_stats = writer->stats;
+   slock_unlock(writer->lock);
+}
+
+static int64_t bsv_movie_writer_write(bsv_movie_t *movie,
+      const void *data, size_t len)
+{
+   struct bsv_movie_writer *writer = movie->writer;
+   const uint8_t *src              = (const uint8_t*)data;
+   size_t left                     = len;
+
+   if (writer->failed)
+      return -1;
+   /* Nothing is queued, so the file is ours to ask */
+   if (!writer->pos_valid)
+   {
+      writer->pos       = intfstream_tell(writer->file);
+      writer->pos_valid = true;
+   }
+
+   while (left)
+   {
+      size_t chunk = MIN(left, BSV_MOVIE_WRITER_BUFFER_SIZE - writer->fill);
+      memcpy(writer->buffers[writer->front] + writer->fill, src, chunk);
+      writer->fill += chunk;
+      src          += chunk;
+      left         -= chunk;
+      slock_lock(writer->lock);
+      writer->stats.queued += (uint32_t)chunk;
+      if (writer->stats.queued > writer->stats.max_queued)
+         writer->stats.max_queued = writer->stats.queued;
+      slock_unlock(writer->lock);
+      if (writer->fill == BSV_MOVIE_WRITER_BUFFER_SIZE)
+         bsv_movie_writer_submit(movie, false);
+   }
+
+   writer->pos += len;
+   return (int64_t)len;
+}
+
+bool bsv_movie_writer_start(bsv_movie_t *movie)
+{
+   struct bsv_movie_writer *writer;
+
+   if (movie->writer)
+      return true;
+   if (!(writer = (struct bsv_movie_writer*)calloc(1, sizeof(*writer))))
+      return false;
+
+   writer->file = movie->file;
+   if (     !(writer->buffers[0] = (uint8_t*)malloc(BSV_MOVIE_WRITER_BUFFER_SIZE))
+         || !(writer->buffers[1] = (uint8_t*)malloc(BSV_MOVIE_WRITER_BUFFER_SIZE))
+         || !(writer->lock       = slock_new())
+         || !(writer->cond       = scond_new())
+         || !(writer->thread     = sthread_create(bsv_movie_writer_thread,
+               writer)))
+   {
+      RARCH_WARN("[Replay] Could not start the replay writer thread, "
+            "writing in place.\n");
+      slock_free(writer->lock);
+      scond_free(writer->cond);
+      free(writer->buffers[0]);
+      free(writer->buffers[1]);
+      free(writer);
+      return false;
+   }
+
+   movie->writer = writer;
+   return true;
+}
+
+void bsv_movie_writer_stop(bsv_movie_t *movie)
+{
+   struct bsv_movie_writer *writer = movie->writer;
+
+   if (!writer)
+      return;
+   bsv_movie_sync(movie);
+
+   slock_lock(writer->lock);
+   writer->quit = true;
+   scond_signal(writer->cond);
+   slock_unlock(writer->lock);
+   sthread_join(writer->thread);
+
+   slock_free(writer->lock);
+   scond_free(writer->cond);
+   free(writer->buffers[0]);
+   free(writer->buffers[1]);
+   free(writer);
+   movie->writer = NULL;
+}
+
+void bsv_movie_sync(bsv_movie_t *movie)
+{
+   struct bsv_movie_writer *writer = movie->writer;
+
+   if (!writer)
+      return;
+   if (writer->fill)
+      bsv_movie_writer_submit(movie, false);
+
+   slock_lock(writer->lock);
+   while (writer->busy)
+      scond_wait(writer->cond, writer->lock);
+   movie->write_stats = writer->stats;
+   slock_unlock(writer->lock);
+   writer->pos_valid = false;
+}
+#else
+bool bsv_movie_writer_start(bsv_movie_t *movie) { return false; }
+void bsv_movie_writer_stop(bsv_movie_t *movie) { }
+void bsv_movie_sync(bsv_movie_t *movie) { }
+#endif
+
+/* Appends to a recording, through the writer if it has one */
+static int64_t bsv_movie_write(bsv_movie_t *movie, const void *data,
+      size_t len)
+{
+#ifdef HAVE_THREADS
+   if (movie->writer)
+      return bsv_movie_writer_write(movie, data, len);
+#endif
+   return intfstream_write(movie->file, data, len);
+}
+
+/* Where the next write of a recording lands */
+static int64_t bsv_movie_tell(bsv_movie_t *movie)
+{
+#ifdef HAVE_THREADS
+   if (movie->writer && movie->writer->pos_valid)
+      return movie->writer->pos;
+#endif
+   return intfstream_tell(movie->file);
+}
+
+/* Ends the frame's writes; a checkpoint also goes to the writer thread
+ * straight away, flushed to the file if asked for */
+static void bsv_movie_end_frame_writes(bsv_movie_t *movie, bool checkpoint)
+{
+#ifdef HAVE_THREADS
+   if (movie->writer)
+   {
+      if (checkpoint)
+         bsv_movie_writer_submit(movie,
+               config_get_ptr()->bools.replay_checkpoint_flush);
+      return;
+   }
+#endif
+   /* To support seeking forwards during a paused replay, we would
+      need to *not* truncate here if we are in the "just paused,
+      running a frame to get the updated image, then will pause
+      again" state. */
+   intfstream_truncate(movie->file, intfstream_tell(movie->file));
+   if (checkpoint && config_get_ptr()->bools.replay_checkpoint_flush)
+      intfstream_flush(movie->file);
+}
+
+void bsv_movie_index_free(struct bsv_movie_index *index)
+{
+   RBUF_FREE(index->chunks);
+   RBUF_FREE(index->checkpoints);
+   index->frames = 0;
+}
+
+/* Notes where record 'frame' starts. Records come in order; an index
+ * missing the ones before is left alone. */
+static void bsv_movie_index_add(struct bsv_movie_index *index,
+      uint64_t frame, int64_t pos, bool checkpoint)
+{
+   if (frame != index->frames)
+      return;
+   if (frame % BSV_MOVIE_INDEX_CHUNK == 0)
+      RBUF_PUSH(index->chunks, pos);
+   if (checkpoint)
+   {
+      struct bsv_movie_index_entry entry;
+      entry.frame = frame;
+      entry.pos   = pos;
+      RBUF_PUSH(index->checkpoints, entry);
+   }
+   index->frames++;
+}
+
+/* Forgets the records from 'frames' on */
+static void bsv_movie_index_truncate(struct bsv_movie_index *index,
+      uint64_t frames)
+{
+   size_t count = RBUF_LEN(index->checkpoints);
+   if (frames >= index->frames)
+      return;
+   RBUF_RESIZE(index->chunks,
+         (frames + BSV_MOVIE_INDEX_CHUNK - 1) / BSV_MOVIE_INDEX_CHUNK);
+   while (count && index->checkpoints[count - 1].frame >= frames)
+      count--;
+   RBUF_RESIZE(index->checkpoints, count);
+   index->frames = frames;
+}
+
+/* Moves a playback towards 'pos' without reading the frames in between.
+ * Only the checkpoints on the way are read, since a statestream
+ * checkpoint can only be decoded after the ones before it. */
+static void bsv_movie_index_seek(bsv_movie_t *movie, int64_t pos)
+{
+   struct bsv_movie_index *index = &movie->index;
+   int64_t cur                   = intfstream_tell(movie->file);
+   size_t  count                 = RBUF_LEN(index->checkpoints);
+   size_t  lo                    = 0;
+   size_t  hi                    = RBUF_LEN(index->chunks);
+   size_t  i;
+   int64_t target;
+
+   /* Last chunk starting at or before 'pos' */
+   while (lo < hi)
+   {
+      size_t mid = lo + (hi - lo) / 2;
+      if (index->chunks[mid] <= pos)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+   if (!lo || index->chunks[lo - 1] <= cur)
+      return;
+   target = index->chunks[lo - 1];
+
+   /* First checkpoint at or after the current frame */
+   for (i = 0, hi = count; i < hi; )
+   {
+      size_t mid = i + (hi - i) / 2;
+      if (index->checkpoints[mid].pos < cur)
+         i = mid + 1;
+      else
+         hi = mid;
+   }
+   for (; i < count && index->checkpoints[i].pos < target; i++)
+   {
+      intfstream_seek(movie->file, index->checkpoints[i].pos, SEEK_SET);
+      movie->frame_counter = index->checkpoints[i].frame - 1;
+      if (!bsv_movie_read_next_events(movie, REPLAY_CPBEHAVIOR_UPDATE, false))
+      {
+         /* Leave it to the frame by frame scan */
+         intfstream_seek(movie->file, index->checkpoints[i].pos, SEEK_SET);
+         return;
+      }
+   }
+
+   intfstream_seek(movie->file, target, SEEK_SET);
+   movie->frame_counter   = (uint64_t)(lo - 1) * BSV_MOVIE_INDEX_CHUNK - 1;
+   movie->frame_pos[movie->frame_counter & movie->frame_mask] = target;
+   movie->frame_pos_floor = movie->frame_counter;
+}
+
 static void bsv_movie_scan_to(bsv_movie_t *movie, int64_t pos)
 {
    if (!movie || movie->version == 0)
      return; /* Old movies don't store enough information to fixup the frame counters. */
+   if (movie->index_ready && movie->playback)
+      bsv_movie_index_seek(movie, pos);
    while (intfstream_tell(movie->file) < pos
          && bsv_movie_read_next_events(movie, REPLAY_CPBEHAVIOR_UPDATE, false))
    {
@@ -95,9 +446,14 @@ static bool bsv_movie_seek_to_pos_impl(bsv_movie_t *movie, int64_t pos)
    int64_t movie_pos;
    if (!movie || movie->version == 0)
       return false;
+   bsv_movie_sync(movie);
    movie_pos = intfstream_tell(movie->file);
    if (pos == movie_pos)
       return true;
+   /* Recording goes on from wherever this lands; the index is built
+    * again from the file when the recording is closed */
+   if (!movie->playback)
+      movie->index_ready = false;
    /* assume file is at a frame boundary and frame is at a checkpoint boundary. */
    if (pos < movie_pos)
       /* TODO: this could be made more efficient with backrefs if we
@@ -113,59 +469,70 @@ static bool bsv_movie_seek_to_pos_impl(bsv_movie_t *movie, int64_t pos)
    return bsv_movie_read_next_events(movie, REPLAY_CPBEHAVIOR_DESERIALIZE, false);
 }
 
-static bool bsv_movie_peek_frame_info(bsv_movie_t *movie, uint8_t *token, uint64_t *len)
+/* Reads what the frame at the position of 'file' holds and how long it
+ * is, without moving. 'payload' gets the size of its checkpoint data,
+ * which ends the frame. */
+static bool bsv_movie_peek_stream(intfstream_t *file, uint32_t version,
+      uint8_t *token, uint64_t *len, uint64_t *payload)
 {
    uint8_t keycount;
    uint16_t event_count;
    uint8_t tok;
    int64_t pos;
+   uint64_t state_size = 0;
    bool ret = false;
-   if (!movie || movie->version == 0)
+   if (version == 0)
       return false;
-   pos = intfstream_tell(movie->file);
-   if (movie->version > 1 &&
-         intfstream_seek(movie->file, sizeof(uint32_t), SEEK_CUR) < 0)
+   pos = intfstream_tell(file);
+   if (version > 1 &&
+         intfstream_seek(file, sizeof(uint32_t), SEEK_CUR) < 0)
       goto end;
-   if (intfstream_read(movie->file, &keycount, 1) != 1)
+   if (intfstream_read(file, &keycount, 1) != 1)
       goto end;
-   if (intfstream_seek(movie->file, sizeof(bsv_key_data_t)*keycount, SEEK_CUR) < 0)
+   if (intfstream_seek(file, sizeof(bsv_key_data_t)*keycount, SEEK_CUR) < 0)
       goto end;
-   if (intfstream_read(movie->file, &event_count, 2) != 2)
+   if (intfstream_read(file, &event_count, 2) != 2)
       goto end;
    event_count = swap_if_big16(event_count);
-   if (intfstream_seek(movie->file, sizeof(bsv_input_data_t)*event_count, SEEK_CUR) < 0)
+   if (intfstream_seek(file, sizeof(bsv_input_data_t)*event_count, SEEK_CUR) < 0)
       goto end;
-   if (intfstream_read(movie->file, &tok, 1) != 1)
+   if (intfstream_read(file, &tok, 1) != 1)
       goto end;
    if (len)
    {
       if (tok == REPLAY_TOKEN_CHECKPOINT_FRAME)
       {
          uint64_t state_length;
-         if (intfstream_read(movie->file, &(state_length), sizeof(uint64_t)) != sizeof(uint64_t))
+         if (intfstream_read(file, &(state_length), sizeof(uint64_t)) != sizeof(uint64_t))
             goto end;
          state_length = swap_if_big64(state_length);
-         if (intfstream_seek(movie->file, state_length, SEEK_CUR) < 0)
+         if (intfstream_seek(file, state_length, SEEK_CUR) < 0)
             goto end;
+         state_size = state_length;
       }
       else if (tok == REPLAY_TOKEN_CHECKPOINT2_FRAME)
       {
          uint32_t state_length;
          /* Skip compression, encoding, uncompressed unencoded size, uncompressed encoded size */
-         if (intfstream_seek(movie->file, 2+2*sizeof(uint32_t), SEEK_CUR) < 0)
+         if (intfstream_seek(file, 2+2*sizeof(uint32_t), SEEK_CUR) < 0)
             goto end;
          /* Read compressed encoded size */
-         if (intfstream_read(movie->file, &(state_length), sizeof(uint32_t)) != sizeof(uint32_t))
+         if (intfstream_read(file, &(state_length), sizeof(uint32_t)) != sizeof(uint32_t))
             goto end;
+         state_length = swap_if_big32(state_length);
          /* Seek past the state data */
-         if (intfstream_seek(movie->file, state_length, SEEK_CUR) < 0)
+         if (intfstream_seek(file, state_length, SEEK_CUR) < 0)
             goto end;
+         state_size = state_length;
       }
       /* We are already at the end of the frame */
       else if (tok == REPLAY_TOKEN_REGULAR_FRAME) { }
+      /* The frames are over */
+      else if (tok == REPLAY_TOKEN_INDEX)
+         goto end;
       else
       {
-         RARCH_LOG("[Replay] Unrecognized frame token type %c\n", token);
+         RARCH_LOG("[Replay] Unrecognized frame token type %c\n", tok);
          goto end;
       }
    }
@@ -176,13 +543,237 @@ static bool bsv_movie_peek_frame_info(bsv_movie_t *movie, uint8_t *token, uint64
       if (token)
          *token = tok;
       if (len)
-         *len = intfstream_tell(movie->file) - pos;
+         *len = intfstream_tell(file) - pos;
+      if (payload)
+         *payload = state_size;
    }
-   if (intfstream_seek(movie->file, pos, SEEK_SET) < 0)
+   if (intfstream_seek(file, pos, SEEK_SET) < 0)
       return false;
    return ret;
 }
 
+static bool bsv_movie_peek_frame_info(bsv_movie_t *movie, uint8_t *token, uint64_t *len)
+{
+   if (!movie)
+      return false;
+   if (movie->index_pos && intfstream_tell(movie->file) >= movie->index_pos)
+      return false;
+   return bsv_movie_peek_stream(movie->file, movie->version, token, len, NULL);
+}
+
+int bsv_movie_index_scan(struct bsv_movie_index *index, intfstream_t *file,
+      uint32_t version, int64_t *pos, unsigned budget)
+{
+   uint8_t tok;
+   uint64_t len;
+   if (intfstream_seek(file, *pos, SEEK_SET) < 0)
+      return 1;
+   while (budget--)
+   {
+      if (!bsv_movie_peek_stream(file, version, &tok, &len, NULL))
+         return 1;
+      bsv_movie_index_add(index, index->frames, *pos,
+               tok == REPLAY_TOKEN_CHECKPOINT_FRAME
+            || tok == REPLAY_TOKEN_CHECKPOINT2_FRAME);
+      *pos += len;
+      if (intfstream_seek(file, *pos, SEEK_SET) < 0)
+         return 1;
+   }
+   return 0;
+}
+
+static bool bsv_movie_write_u32(intfstream_t *file, uint32_t val)
+{
+   val = swap_if_big32(val);
+   return intfstream_write(file, &val, sizeof(val)) == sizeof(val);
+}
+
+static bool bsv_movie_write_u64(intfstream_t *file, uint64_t val)
+{
+   val = swap_if_big64(val);
+   return intfstream_write(file, &val, sizeof(val)) == sizeof(val);
+}
+
+/* The index follows the frames as a frame of its own, with no actions
+ * and an INDEX token, so older readers stop at it:
+     uint32 magic, version, chunk, chunk count, checkpoint count, 0
+     uint64 frames
+     uint64 start of every chunk'th frame
+     uint64 frame, uint64 start of every checkpoint
+     uint64 start of the index frame, uint32 magic
+ */
+bool bsv_movie_index_save(bsv_movie_t *movie)
+{
+   struct bsv_movie_index *index = &movie->index;
+   uint8_t index_frame[4]        = {0, 0, 0, REPLAY_TOKEN_INDEX};
+   int64_t start                 = intfstream_tell(movie->file);
+   int64_t last                  = movie->frame_pos[
+      (MAX(movie->frame_counter + 1, 2) - 2) & movie->frame_mask];
+   size_t i;
+
+   if (movie->version < 2)
+      return false;
+   if (!movie->index_ready)
+   {
+      bsv_movie_index_free(index);
+      start = movie->min_file_pos;
+      bsv_movie_index_scan(index, movie->file, movie->version, &start,
+            UINT_MAX);
+      movie->index_ready = true;
+      intfstream_seek(movie->file, start, SEEK_SET);
+   }
+   if (start < last)
+      last = start;
+
+   if (     !bsv_movie_write_u32(movie->file, (uint32_t)(start - last))
+         || intfstream_write(movie->file, index_frame, sizeof(index_frame))
+            != sizeof(index_frame)
+         || !bsv_movie_write_u32(movie->file, REPLAY_INDEX_MAGIC)
+         || !bsv_movie_write_u32(movie->file, REPLAY_INDEX_VERSION)
+         || !bsv_movie_write_u32(movie->file, BSV_MOVIE_INDEX_CHUNK)
+         || !bsv_movie_write_u32(movie->file, (uint32_t)RBUF_LEN(index->chunks))
+         || !bsv_movie_write_u32(movie->file, (uint32_t)RBUF_LEN(index->checkpoints))
+         || !bsv_movie_write_u32(movie->file, 0)
+         || !bsv_movie_write_u64(movie->file, index->frames))
+      goto error;
+   for (i = 0; i < RBUF_LEN(index->chunks); i++)
+      if (!bsv_movie_write_u64(movie->file, index->chunks[i]))
+         goto error;
+   for (i = 0; i < RBUF_LEN(index->checkpoints); i++)
+      if (     !bsv_movie_write_u64(movie->file, index->checkpoints[i].frame)
+            || !bsv_movie_write_u64(movie->file, index->checkpoints[i].pos))
+         goto error;
+   if (     !bsv_movie_write_u64(movie->file, start)
+         || !bsv_movie_write_u32(movie->file, REPLAY_INDEX_MAGIC))
+      goto error;
+   intfstream_truncate(movie->file, intfstream_tell(movie->file));
+   return true;
+
+error:
+   RARCH_WARN("[Replay] Could not write the replay index\n");
+   intfstream_truncate(movie->file, start);
+   return false;
+}
+
+static bool bsv_movie_read_u32(intfstream_t *file, uint32_t *val)
+{
+   if (intfstream_read(file, val, sizeof(*val)) != sizeof(*val))
+      return false;
+   *val = swap_if_big32(*val);
+   return true;
+}
+
+static bool bsv_movie_read_u64(intfstream_t *file, uint64_t *val)
+{
+   if (intfstream_read(file, val, sizeof(*val)) != sizeof(*val))
+      return false;
+   *val = swap_if_big64(*val);
+   return true;
+}
+
+bool bsv_movie_index_load(bsv_movie_t *movie)
+{
+   struct bsv_movie_index *index = &movie->index;
+   int64_t resume                = intfstream_tell(movie->file);
+   int64_t size                  = intfstream_get_size(movie->file);
+   uint32_t header[6];
+   uint8_t index_frame[8];
+   uint64_t start, frames, val;
+   size_t i;
+   bool ret                      = false;
+
+   if (movie->version < 2 || size < (int64_t)movie->min_file_pos + 12)
+      return false;
+   if (     intfstream_seek(movie->file, size - 12, SEEK_SET) < 0
+         || !bsv_movie_read_u64(movie->file, &start)
+         || !bsv_movie_read_u32(movie->file, &header[0])
+         || header[0] != REPLAY_INDEX_MAGIC
+         || start < movie->min_file_pos
+         || start > (uint64_t)size - 12
+         || intfstream_seek(movie->file, start, SEEK_SET) < 0
+         || intfstream_read(movie->file, index_frame, sizeof(index_frame))
+            != sizeof(index_frame)
+         || index_frame[7] != REPLAY_TOKEN_INDEX)
+      goto end;
+   for (i = 0; i < ARRAY_SIZE(header); i++)
+      if (!bsv_movie_read_u32(movie->file, &header[i]))
+         goto end;
+   if (     !bsv_movie_read_u64(movie->file, &frames)
+         || header[0] != REPLAY_INDEX_MAGIC
+         || header[1] != REPLAY_INDEX_VERSION
+         || header[2] != BSV_MOVIE_INDEX_CHUNK
+         || header[3] != (frames + BSV_MOVIE_INDEX_CHUNK - 1) / BSV_MOVIE_INDEX_CHUNK
+         || header[4] > frames
+         || start + 8 + 24 + 8 + (uint64_t)header[3] * 8
+            + (uint64_t)header[4] * 16 + 12 != (uint64_t)size)
+      goto end;
+
+   bsv_movie_index_free(index);
+   for (i = 0; i < header[3]; i++)
+   {
+      if (!bsv_movie_read_u64(movie->file, &val) || (int64_t)val >= (int64_t)start)
+         goto end;
+      RBUF_PUSH(index->chunks, (int64_t)val);
+   }
+   for (i = 0; i < header[4]; i++)
+   {
+      struct bsv_movie_index_entry entry;
+      if (     !bsv_movie_read_u64(movie->file, &entry.frame)
+            || !bsv_movie_read_u64(movie->file, &val)
+            || entry.frame >= frames
+            || (int64_t)val >= (int64_t)start)
+         goto end;
+      entry.pos = (int64_t)val;
+      RBUF_PUSH(index->checkpoints, entry);
+   }
+   index->frames      = frames;
+   movie->index_pos   = start;
+   movie->index_ready = true;
+   ret                = true;
+
+end:
+   if (!ret)
+      bsv_movie_index_free(index);
+   intfstream_seek(movie->file, resume, SEEK_SET);
+   return ret;
+}
+
+/* frame_pos[j] is where record j+1 starts, once it is played back. Fills
+ * the entries an indexed seek jumped over, from the chunk of 'frame' up
+ * to the first entry that is filled in. */
+static void bsv_movie_frame_pos_fill(bsv_movie_t *movie, uint64_t frame)
+{
+   struct bsv_movie_index *index = &movie->index;
+   uint64_t end                  = movie->frame_pos_floor;
+   uint64_t chunk                = (frame + 1) / BSV_MOVIE_INDEX_CHUNK;
+   uint64_t record               = chunk * BSV_MOVIE_INDEX_CHUNK;
+   int64_t resume, pos;
+
+   if (     frame >= end
+         || !movie->index_ready
+         || chunk >= RBUF_LEN(index->chunks))
+      return;
+   resume = intfstream_tell(movie->file);
+   pos    = index->chunks[chunk];
+   for (;;)
+   {
+      uint64_t len;
+      /* frame_pos[0] stays at the start, and the ring keeps as much */
+      if (record >= 2 && record - 1 + movie->frame_mask >= end)
+         movie->frame_pos[(record - 1) & movie->frame_mask] = pos;
+      if (record >= end)
+         break;
+      if (     intfstream_seek(movie->file, pos, SEEK_SET) < 0
+            || !bsv_movie_peek_stream(movie->file, movie->version,
+               NULL, &len, NULL))
+         break;
+      pos += len;
+      record++;
+   }
+   movie->frame_pos_floor = chunk ? chunk * BSV_MOVIE_INDEX_CHUNK - 1 : 0;
+   intfstream_seek(movie->file, resume, SEEK_SET);
+}
+
 static bool bsv_movie_skip_to_next_checkpoint_impl(bsv_movie_t *movie)
 {
    uint8_t tok = REPLAY_TOKEN_INVALID;
@@ -190,7 +781,24 @@ static bool bsv_movie_skip_to_next_checkpoint_impl(bsv_movie_t *movie)
    int64_t cp_pos, initial_pos;
    if (!movie || movie->version == 0)
       return false;
+   bsv_movie_sync(movie);
    initial_pos = intfstream_tell(movie->file);
+   if (movie->index_ready)
+   {
+      struct bsv_movie_index *index = &movie->index;
+      size_t lo = 0, hi = RBUF_LEN(index->checkpoints);
+      while (lo < hi)
+      {
+         size_t mid = lo + (hi - lo) / 2;
+         if (index->checkpoints[mid].pos < initial_pos)
+            lo = mid + 1;
+         else
+            hi = mid;
+      }
+      if (lo == RBUF_LEN(index->checkpoints))
+         return false;
+      return bsv_movie_seek_to_pos_impl(movie, index->checkpoints[lo].pos);
+   }
    /* scan forward until peek shows a checkpoint or checkpoint2 */
    while (bsv_movie_peek_frame_info(movie, &tok, &frame_len)
          && (     tok != REPLAY_TOKEN_INVALID
@@ -220,6 +828,34 @@ static bool movie_find_checkpoint_before(bsv_movie_t *movie, int64_t frame,
    int64_t maybe_last_frame = -1, maybe_last_pos = -1;
    if (!movie || movie->version == 0)
       return false;
+   if (movie->index_ready)
+   {
+      /* Same choice as the scan below: the last checkpoint before the
+         target, or the one before that if the last is too close */
+      struct bsv_movie_index *index = &movie->index;
+      size_t lo = 0, hi = RBUF_LEN(index->checkpoints);
+      while (lo < hi)
+      {
+         size_t mid = lo + (hi - lo) / 2;
+         if ((int64_t)index->checkpoints[mid].frame < target_frame)
+            lo = mid + 1;
+         else
+            hi = mid;
+      }
+      if (lo && !paused && target_frame
+            - (int64_t)index->checkpoints[lo - 1].frame < prev_skip_min_distance)
+         lo--;
+      if (lo)
+      {
+         cp_pos   = index->checkpoints[lo - 1].pos;
+         cp_frame = (int64_t)index->checkpoints[lo - 1].frame;
+      }
+      if (cp_pos_out)
+         *cp_pos_out = cp_pos;
+      if (cp_frame_out)
+         *cp_frame_out = cp_frame;
+      return cp_frame;
+   }
    initial_pos = intfstream_tell(movie->file);
    /* Find the right checkpoint to jump to.
       In the future, backrefs could be used to make this faster */
@@ -263,6 +899,7 @@ static bool bsv_movie_skip_to_prev_checkpoint_impl(bsv_movie_t *movie)
    int64_t cp_pos;
    if (!movie || movie->version == 0)
       return false;
+   bsv_movie_sync(movie);
    if (!movie_find_checkpoint_before(movie, movie->frame_counter, false, &cp_pos, NULL))
       return false;
    return bsv_movie_seek_to_pos_impl(movie, cp_pos);
@@ -276,11 +913,13 @@ bool bsv_movie_reset_playback(bsv_movie_t *handle)
    if (!handle)
       return false;
    vsn = handle->version;
+   bsv_movie_sync(handle);
    intfstream_rewind(handle->file);
    if (intfstream_read(handle->file, header, REPLAY_HEADER_LEN_BYTES) < REPLAY_HEADER_LEN_BYTES)
       return false;
-   handle->frame_counter  = 0;
-   handle->cur_save_valid = false;
+   handle->frame_counter   = 0;
+   handle->frame_pos_floor = 0;
+   handle->cur_save_valid  = false;
 
    state_size = swap_if_big32(header[REPLAY_HEADER_STATE_SIZE_INDEX]);
    if (state_size && vsn <= 1)
@@ -321,12 +960,13 @@ bool bsv_movie_reset_playback(bsv_movie_t *handle)
       handle->commit_interval  = commit_settings >> 24;
       handle->commit_threshold = (commit_settings >> 16) & 0x000000FF;
       handle->checkpoint_compression = (commit_settings >> 8) & 0x000000FF;
-      if (handle->superblocks)
-         uint32s_index_free(handle->superblocks);
-      handle->superblocks = uint32s_index_new(superblock_size,handle->commit_interval,handle->commit_threshold);
-      if (handle->blocks)
-         uint32s_index_free(handle->blocks);
-      handle->blocks = uint32s_index_new(block_size/4,handle->commit_interval,handle->commit_threshold);
+      state_store_deinit(&handle->store);
+      if (!state_store_init(&handle->store, block_size, superblock_size,
+               handle->commit_interval, handle->commit_threshold))
+         return false;
+      /* Leave a core for the emulation thread */
+      state_store_set_threads(&handle->store,
+            cpu_features_get_core_amount() - 1);
 #endif
       if (     intfstream_read(handle->file, &(compression), sizeof(uint8_t)) != sizeof(uint8_t)
             || intfstream_read(handle->file, &(encoding), sizeof(uint8_t)) != sizeof(uint8_t))
@@ -345,20 +985,23 @@ bool bsv_movie_reset_recording(bsv_movie_t *handle)
    uint8_t encoding      = REPLAY_CHECKPOINT2_ENCODING_STATESTREAM;
    /* If recording, we simply reset
     * the starting point. Nice and easy. */
-   if (handle->superblocks)
-      uint32s_index_clear(handle->superblocks);
-   if (handle->blocks)
-      uint32s_index_clear(handle->blocks);
+   if (handle->store.superblocks)
+      uint32s_index_clear(handle->store.superblocks);
+   if (handle->store.blocks)
+      uint32s_index_clear(handle->store.blocks);
 #else
    uint8_t encoding       = REPLAY_CHECKPOINT2_ENCODING_RAW;
 #endif
    handle->cur_save_valid = false;
+   bsv_movie_index_truncate(&handle->index, 0);
 
+   bsv_movie_sync(handle);
    intfstream_seek(handle->file, REPLAY_HEADER_LEN_BYTES, SEEK_SET);
    intfstream_write(handle->file, &compression, 1);
    intfstream_write(handle->file, &encoding, 1);
    handle->frame_counter = 0;
    state_size = 2 + bsv_movie_write_checkpoint(handle, compression, encoding);
+   bsv_movie_sync(handle);
    handle->min_file_pos = intfstream_tell(handle->file);
    /* Have to write initial state size header too */
    state_size_ = swap_if_big32(state_size);
@@ -402,6 +1045,7 @@ void bsv_movie_frame_rewind(void)
    if (!handle)
       return;
 
+   bsv_movie_sync(handle);
    handle->did_rewind     = true;
    handle->cur_save_valid = false;
    if (((handle->frame_counter & handle->frame_mask) <= 1)
@@ -413,13 +1057,16 @@ void bsv_movie_frame_rewind(void)
       intfstream_seek(handle->file, (int)handle->min_file_pos, SEEK_SET);
       /* clear incremental checkpoint table data.  We do this both on recording and playback for simplicity. */
 #ifdef HAVE_STATESTREAM
-      if (handle->superblocks)
-         uint32s_index_remove_after(handle->superblocks, 0);
-      if (handle->blocks)
-         uint32s_index_remove_after(handle->blocks, 0);
+      if (handle->store.superblocks)
+         uint32s_index_remove_after(handle->store.superblocks, 0);
+      if (handle->store.blocks)
+         uint32s_index_remove_after(handle->store.blocks, 0);
 #endif
       if (recording)
+      {
          intfstream_truncate(handle->file, (int)handle->min_file_pos);
+         bsv_movie_index_truncate(&handle->index, 0);
+      }
       else
          bsv_movie_read_next_events(handle, REPLAY_CPBEHAVIOR_DESERIALIZE, true);
    }
@@ -437,14 +1084,19 @@ void bsv_movie_frame_rewind(void)
       else
          handle->frame_counter = 0;
 #ifdef HAVE_STATESTREAM
-      if (handle->superblocks)
-         uint32s_index_remove_after(handle->superblocks, handle->frame_counter);
-      if (handle->blocks)
-         uint32s_index_remove_after(handle->blocks, handle->frame_counter);
+      if (handle->store.superblocks)
+         uint32s_index_remove_after(handle->store.superblocks, handle->frame_counter);
+      if (handle->store.blocks)
+         uint32s_index_remove_after(handle->store.blocks, handle->frame_counter);
 #endif
+      if (!recording)
+         bsv_movie_frame_pos_fill(handle, handle->frame_counter);
       intfstream_seek(handle->file, (int)handle->frame_pos[handle->frame_counter & handle->frame_mask], SEEK_SET);
       if (recording)
+      {
          intfstream_truncate(handle->file, intfstream_tell(handle->file));
+         bsv_movie_index_truncate(&handle->index, handle->frame_counter);
+      }
       else
          bsv_movie_read_next_events(handle, REPLAY_CPBEHAVIOR_DESERIALIZE, true);
    }
@@ -756,27 +1408,27 @@ int64_t bsv_movie_write_checkpoint(bsv_movie_t *handle, uint8_t compression, uin
    }
    /* uncompressed, unencoded size */
    size_ = swap_if_big32((uint32_t)serial_info.size);
-   if (intfstream_write(handle->file, &size_, sizeof(uint32_t)) < (int64_t)sizeof(uint32_t))
+   if (bsv_movie_write(handle, &size_, sizeof(uint32_t)) < (int64_t)sizeof(uint32_t))
    {
       ret = -1;
       goto exit;
    }
    /* uncompressed, encoded size */
    size_ = swap_if_big32(encoded_size);
-   if (intfstream_write(handle->file, &size_, sizeof(uint32_t)) < (int64_t)sizeof(uint32_t))
+   if (bsv_movie_write(handle, &size_, sizeof(uint32_t)) < (int64_t)sizeof(uint32_t))
    {
       ret = -1;
       goto exit;
    }
    /* compressed, encoded size */
    size_ = swap_if_big32(compressed_encoded_size);
-   if (intfstream_write(handle->file, &size_, sizeof(uint32_t)) < (int64_t)sizeof(uint32_t))
+   if (bsv_movie_write(handle, &size_, sizeof(uint32_t)) < (int64_t)sizeof(uint32_t))
    {
       ret = -1;
       goto exit;
    }
    /* data */
-   if (intfstream_write(handle->file, compressed_encoded_data, compressed_encoded_size) < compressed_encoded_size)
+   if (bsv_movie_write(handle, compressed_encoded_data, compressed_encoded_size) < compressed_encoded_size)
    {
       ret = -1;
       goto exit;
@@ -815,6 +1467,14 @@ bool bsv_movie_read_next_events(bsv_movie_t *handle,
          return false;
       }
    }
+   /* The index is where the frames end */
+   if (handle->index_pos && intfstream_tell(handle->file) >= handle->index_pos)
+   {
+      RARCH_LOG("[Replay] EOF at index\n");
+      if (end_movie)
+         input_st->bsv_movie_state.flags |= BSV_FLAG_MOVIE_END;
+      return false;
+   }
    /* Skip over backref */
    if (handle->version > 1)
       intfstream_seek(handle->file, sizeof(uint32_t), SEEK_CUR);
@@ -943,6 +1603,122 @@ bool bsv_movie_read_next_events(bsv_movie_t *handle,
    return true;
 }
 
+/* Ends a replay export segment: @boundary is what came of comparing
+ * the state against the closing checkpoint. The report tells the
+ * export which frames this instance played, and it quits. */
+static void bsv_movie_range_finish(input_driver_state_t *input_st,
+      bsv_movie_t *handle, const char *boundary)
+{
+   char report[128];
+   struct bsv_state *state = &input_st->bsv_movie_state;
+   size_t _len             = snprintf(report, sizeof(report),
+         "first %" PRIu64 "\nlast %" PRIu64 "\nframes %" PRIu64
+         "\nboundary %s\n",
+         state->range_start_frame,
+         handle ? handle->frame_counter : state->range_start_frame,
+         state->range_frames, boundary);
+
+   if (!filestream_write_file(state->range_report, report, (int64_t)_len))
+      RARCH_ERR("[Replay] Could not write \"%s\".\n", state->range_report);
+   RARCH_LOG("[Replay] Segment done after %" PRIu64 " frames, boundary %s.\n",
+         state->range_frames, boundary);
+   *state->range_report = '\0';
+   command_event(CMD_EVENT_QUIT, NULL);
+}
+
+/* Compares the state the segment ends in with the checkpoint the
+ * next segment starts from, which the last read left in cur_save */
+static const char *bsv_movie_range_compare(bsv_movie_t *handle)
+{
+   retro_ctx_serialize_info_t serial_info;
+   const char *ret = "mismatch";
+
+   if (!handle->checkpoint_ready || !handle->cur_save)
+      return "unchecked";
+   serial_info.size = core_serialize_size();
+   if (     serial_info.size != handle->cur_save_size
+         || !(serial_info.data = malloc(serial_info.size)))
+      return ret;
+   if (     core_serialize(&serial_info)
+         && !memcmp(serial_info.data, handle->cur_save, serial_info.size))
+      ret = "match";
+   free(serial_info.data);
+   return ret;
+}
+
+/* Finds the checkpoint at the start of @frame's record */
+static bool bsv_movie_range_checkpoint(bsv_movie_t *handle, int64_t frame,
+      int64_t *pos)
+{
+   int64_t cp_frame = -1;
+   movie_find_checkpoint_before(handle, frame + 1, true, pos, &cp_frame);
+   if (cp_frame == frame && *pos >= 0)
+      return true;
+   RARCH_ERR("[Replay] No checkpoint at frame %" PRId64 ".\n", frame);
+   return false;
+}
+
+/* Puts a replay export segment where it starts: past both the record
+ * of its first checkpoint and the checkpoint itself, so the first
+ * frame the core runs is the frame after, from the state the replay
+ * has for it. */
+static void bsv_movie_range_start(input_driver_state_t *input_st,
+      bsv_movie_t *handle)
+{
+   int64_t pos;
+   struct bsv_state *state = &input_st->bsv_movie_state;
+
+   state->range_last_pos   = -1;
+   state->range_frames     = 0;
+   if (     state->range_last > 0
+         && !bsv_movie_range_checkpoint(handle, state->range_last,
+            &state->range_last_pos))
+   {
+      bsv_movie_range_finish(input_st, NULL, "error");
+      return;
+   }
+   if (state->range_first > 0)
+   {
+      if (     !bsv_movie_range_checkpoint(handle, state->range_first, &pos)
+            || !bsv_movie_seek_to_pos_impl(handle, pos))
+      {
+         bsv_movie_range_finish(input_st, NULL, "error");
+         return;
+      }
+      /* What bsv_movie_next_frame does at the end of that frame */
+      handle->frame_counter += 1;
+      bsv_movie_read_next_events(handle, REPLAY_CPBEHAVIOR_UPDATE, true);
+      handle->frame_pos[handle->frame_counter & handle->frame_mask] =
+         intfstream_tell(handle->file);
+   }
+   state->range_start_frame = handle->frame_counter;
+   RARCH_LOG("[Replay] Playing segment from frame %" PRIu64 ".\n",
+         state->range_start_frame);
+}
+
+/* Called at the end of every frame of a segment, before the next
+ * frame is read. Returns true once the segment is over. */
+static bool bsv_movie_range_step(input_driver_state_t *input_st,
+      bsv_movie_t *handle, replay_checkpoint_behavior *behavior)
+{
+   struct bsv_state *state = &input_st->bsv_movie_state;
+   int64_t pos             = intfstream_tell(handle->file);
+
+   state->range_frames++;
+   if (state->range_last_pos < 0)
+      return false;
+   /* The closing checkpoint is kept to compare against, not loaded */
+   if (pos == state->range_last_pos)
+      *behavior = REPLAY_CPBEHAVIOR_DESERIALIZE;
+   else if (pos > state->range_last_pos)
+   {
+      bsv_movie_range_finish(input_st, handle,
+            bsv_movie_range_compare(handle));
+      return true;
+   }
+   return false;
+}
+
 void bsv_movie_dequeue_next(input_driver_state_t *input_st)
 {
    if (input_st->bsv_movie_state_next_handle)
@@ -951,6 +1727,9 @@ void bsv_movie_dequeue_next(input_driver_state_t *input_st)
          bsv_movie_deinit(input_st);
       input_st->bsv_movie_state_handle = input_st->bsv_movie_state_next_handle;
       input_st->bsv_movie_state_next_handle = NULL;
+      if (     *input_st->bsv_movie_state.range_report
+            && input_st->bsv_movie_state_handle->playback)
+         bsv_movie_range_start(input_st, input_st->bsv_movie_state_handle);
    }
 }
 
@@ -958,10 +1737,12 @@ void bsv_movie_scan_from_start(bsv_movie_t *movie, int32_t len)
 {
    if (!movie || movie->version == 0)
      return; /* Old movies don't store enough information to fixup the frame counters. */
+   bsv_movie_sync(movie);
    intfstream_seek(movie->file, movie->min_file_pos, SEEK_SET);
-   movie->frame_counter  = 0;
-   movie->frame_pos[0]   = intfstream_tell(movie->file);
-   movie->cur_save_valid = false;
+   movie->frame_counter   = 0;
+   movie->frame_pos[0]    = intfstream_tell(movie->file);
+   movie->frame_pos_floor = 0;
+   movie->cur_save_valid  = false;
    bsv_movie_scan_to(movie, len);
 }
 
@@ -993,21 +1774,25 @@ void bsv_movie_next_frame(input_driver_state_t *input_st)
       int i;
       uint16_t evt_count     = swap_if_big16(handle->input_event_count);
       size_t last_pos        = handle->frame_pos[(MAX(handle->frame_counter,2)-2) & handle->frame_mask];
-      size_t cur_pos         = intfstream_tell(handle->file);
+      size_t cur_pos         = bsv_movie_tell(handle);
       uint32_t back_distance = swap_if_big32((uint32_t)(cur_pos-last_pos));
+      uint64_t record        = handle->frame_counter - 1;
+      /* Anything recorded after this frame before a rewind is gone */
+      if (handle->index_ready)
+         bsv_movie_index_truncate(&handle->index, record);
       /* write backref */
-      intfstream_write(handle->file, &back_distance, sizeof(uint32_t));
+      bsv_movie_write(handle, &back_distance, sizeof(uint32_t));
       /* write key events, frame is over */
-      intfstream_write(handle->file, &(handle->key_event_count), 1);
+      bsv_movie_write(handle, &(handle->key_event_count), 1);
       for (i = 0; i < handle->key_event_count; i++)
-         intfstream_write(handle->file, &(handle->key_events[i]),
+         bsv_movie_write(handle, &(handle->key_events[i]),
                sizeof(bsv_key_data_t));
       /* Zero out key events when playing back or recording */
       handle->key_event_count = 0;
       /* write input events, frame is over */
-      intfstream_write(handle->file, &evt_count, 2);
+      bsv_movie_write(handle, &evt_count, 2);
       for (i = 0; i < handle->input_event_count; i++)
-         intfstream_write(handle->file, &(handle->input_events[i]),
+         bsv_movie_write(handle, &(handle->input_events[i]),
                sizeof(bsv_input_data_t));
       /* Zero out input events when playing back or recording */
       handle->input_event_count = 0;
@@ -1027,35 +1812,47 @@ void bsv_movie_next_frame(input_driver_state_t *input_st)
 #endif
          input_st->bsv_movie_state.flags &= ~BSV_FLAG_MOVIE_FORCE_CHECKPOINT;
          /* "next frame is a checkpoint" */
-         intfstream_write(handle->file, (uint8_t *)(&frame_tok), sizeof(uint8_t));
+         bsv_movie_write(handle, (uint8_t *)(&frame_tok), sizeof(uint8_t));
          /* compression and encoding schemes */
-         intfstream_write(handle->file, (uint8_t *)(&compression), sizeof(uint8_t));
-         intfstream_write(handle->file, (uint8_t *)(&encoding), sizeof(uint8_t));
+         bsv_movie_write(handle, (uint8_t *)(&compression), sizeof(uint8_t));
+         bsv_movie_write(handle, (uint8_t *)(&encoding), sizeof(uint8_t));
          if (bsv_movie_write_checkpoint(handle, compression, encoding) < 0)
          {
             RARCH_ERR("[Replay] failed to write checkpoint, exiting record\n");
             input_st->bsv_movie_state.flags |= BSV_FLAG_MOVIE_END;
          }
+         if (handle->index_ready)
+            bsv_movie_index_add(&handle->index, record, cur_pos, true);
+         bsv_movie_end_frame_writes(handle, true);
       }
       else
       {
          uint8_t frame_tok = REPLAY_TOKEN_REGULAR_FRAME;
          /* write "next frame is not a checkpoint" */
-         intfstream_write(handle->file, (uint8_t *)(&frame_tok), sizeof(uint8_t));
+         bsv_movie_write(handle, (uint8_t *)(&frame_tok), sizeof(uint8_t));
+         if (handle->index_ready)
+            bsv_movie_index_add(&handle->index, record, cur_pos, false);
+         bsv_movie_end_frame_writes(handle, false);
       }
-      /* To support seeking forwards during a paused replay, we would
-         need to *not* truncate here if we are in the "just paused,
-         running a frame to get the updated image, then will pause
-         again" state. */
-      intfstream_truncate(handle->file, intfstream_tell(handle->file));
    }
    else /* either playback or seeking while recording */
    {
-      bsv_movie_read_next_events(handle, checkpoint_deserialize ? REPLAY_CPBEHAVIOR_DESERIALIZE : REPLAY_CPBEHAVIOR_UPDATE, true);
+      replay_checkpoint_behavior behavior = checkpoint_deserialize
+         ? REPLAY_CPBEHAVIOR_DESERIALIZE : REPLAY_CPBEHAVIOR_UPDATE;
+      bsv_movie_sync(handle);
+      if (     *input_st->bsv_movie_state.range_report
+            && handle->playback
+            && bsv_movie_range_step(input_st, handle, &behavior))
+         return;
+      bsv_movie_read_next_events(handle, behavior, true);
       /* clear seeking flag since we did read one frame */
       input_st->bsv_movie_state.flags &= ~BSV_FLAG_MOVIE_SEEKING;
+      /* The last segment ends with the replay */
+      if (     *input_st->bsv_movie_state.range_report
+            && (input_st->bsv_movie_state.flags & BSV_FLAG_MOVIE_END))
+         bsv_movie_range_finish(input_st, handle, "end");
    }
-   handle->frame_pos[handle->frame_counter & handle->frame_mask] = intfstream_tell(handle->file);
+   handle->frame_pos[handle->frame_counter & handle->frame_mask] = bsv_movie_tell(handle);
 
    if (input_st->bsv_movie_state.flags & BSV_FLAG_MOVIE_SEEK_TO_FRAME)
    {
@@ -1114,7 +1911,7 @@ size_t replay_get_serialize_size(void)
 {
    input_driver_state_t *input_st = input_state_get_ptr();
    if (input_st->bsv_movie_state.flags & (BSV_FLAG_MOVIE_RECORDING | BSV_FLAG_MOVIE_PLAYBACK))
-      return sizeof(int32_t)+intfstream_tell(input_st->bsv_movie_state_handle->file);
+      return sizeof(int32_t)+bsv_movie_tell(input_st->bsv_movie_state_handle);
    return 0;
 }
 
@@ -1125,10 +1922,13 @@ bool replay_get_serialized_data(void* buffer)
 
    if (input_st->bsv_movie_state.flags & (BSV_FLAG_MOVIE_RECORDING | BSV_FLAG_MOVIE_PLAYBACK))
    {
-      int32_t file_end        = (uint32_t)intfstream_tell(handle->file);
+      int32_t file_end;
       int64_t read_amt        = 0;
-      int32_t file_end_       = swap_if_big32(file_end);
+      int32_t file_end_;
       uint8_t *buf;
+      bsv_movie_sync(handle);
+      file_end                = (uint32_t)intfstream_tell(handle->file);
+      file_end_               = swap_if_big32(file_end);
       ((uint32_t *)buffer)[0] = file_end_;
       buf                     = ((uint8_t *)buffer) + sizeof(uint32_t);
       intfstream_rewind(handle->file);
@@ -1149,7 +1949,7 @@ bool replay_get_serialized_data(void* buffer)
 bool replay_check_same_timeline(bsv_movie_t *movie,
       uint8_t *other_movie, int64_t other_len)
 {
-   int64_t check_limit = MIN(other_len, intfstream_tell(movie->file));
+   int64_t check_limit;
    intfstream_t *check_stream = intfstream_open_memory(other_movie,
          RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE,
          other_len);
@@ -1161,7 +1961,10 @@ bool replay_check_same_timeline(bsv_movie_t *movie,
             512 * sizeof(bsv_input_data_t)));
    uint8_t *buf1     = (uint8_t*)calloc(check_cap,1);
    uint8_t *buf2     = (uint8_t*)calloc(check_cap,1);
-   size_t movie_pos  = intfstream_tell(movie->file);
+   size_t movie_pos;
+   bsv_movie_sync(movie);
+   movie_pos         = intfstream_tell(movie->file);
+   check_limit       = MIN(other_len, (int64_t)movie_pos);
    intfstream_rewind(movie->file);
    intfstream_read(movie->file, buf1, REPLAY_HEADER_LEN_BYTES);
    intfstream_read(check_stream, buf2, REPLAY_HEADER_LEN_BYTES);
@@ -1334,6 +2137,7 @@ bool replay_set_serialized_data(void *buf)
 
    if (!handle)
       return false;
+   bsv_movie_sync(handle);
    handle->cur_save_valid = false;
    if (!buffer)
    {
@@ -1370,6 +2174,10 @@ bool replay_set_serialized_data(void *buf)
          int32_t loaded_len    = swap_if_big32(((int32_t *)buffer)[0]);
          int64_t handle_idx    = intfstream_tell(handle->file);
          bool same_timeline    = replay_check_same_timeline(handle, (uint8_t *)header, loaded_len);
+         /* Whatever the recording goes on from, closing it indexes the
+            file again */
+         if (recording)
+            handle->index_ready = false;
          /* If the state is part of this replay, go back to that state
             and fast forward/rewind the replay.
 
@@ -1406,10 +2214,10 @@ bool replay_set_serialized_data(void *buf)
                RARCH_WARN("[Replay] %s.\n", _msg);
             }
 #ifdef HAVE_STATESTREAM
-            if (handle->superblocks)
-               uint32s_index_remove_after(handle->superblocks, 0);
-            if (handle->blocks)
-               uint32s_index_remove_after(handle->blocks, 0);
+            if (handle->store.superblocks)
+               uint32s_index_remove_after(handle->store.superblocks, 0);
+            if (handle->store.blocks)
+               uint32s_index_remove_after(handle->store.blocks, 0);
 #endif
             intfstream_rewind(handle->file);
             intfstream_write(handle->file, header, loaded_len);
@@ -1423,10 +2231,10 @@ bool replay_set_serialized_data(void *buf)
          else
          {
 #ifdef HAVE_STATESTREAM
-            if (handle->superblocks)
-               uint32s_index_remove_after(handle->superblocks, 0);
-            if (handle->blocks)
-               uint32s_index_remove_after(handle->blocks, 0);
+            if (handle->store.superblocks)
+               uint32s_index_remove_after(handle->store.superblocks, 0);
+            if (handle->store.blocks)
+               uint32s_index_remove_after(handle->store.blocks, 0);
 #endif
             intfstream_seek(handle->file, loaded_len, SEEK_SET);
             /* TODO: in the future, don't clear indices above and only
@@ -1504,29 +2312,39 @@ int16_t bsv_movie_read_state(input_driver_state_t *input_st,
 }
 
 #ifdef HAVE_STATESTREAM
+static void bsv_movie_write_new_block(void *userdata, uint32_t index,
+      const uint32_t *block, size_t len)
+{
+   intfstream_t *out_stream = (intfstream_t*)userdata;
+   /* write "here is a new block" and new block to file */
+   rmsgpack_write_int(out_stream, BSV_IFRAME_NEW_BLOCK_TOKEN);
+   rmsgpack_write_int(out_stream, index);
+   /* Cast is fine, a single block can't be super big */
+   rmsgpack_write_bin(out_stream, block, (uint32_t)len);
+}
+
+static void bsv_movie_write_new_superblock(void *userdata, uint32_t index,
+      const uint32_t *blocks, size_t count)
+{
+   size_t i;
+   intfstream_t *out_stream = (intfstream_t*)userdata;
+   /* write "here is a new superblock" and new superblock to file */
+   rmsgpack_write_int(out_stream, BSV_IFRAME_NEW_SUPERBLOCK_TOKEN);
+   rmsgpack_write_int(out_stream, index);
+   /* Cast is fine, a single superblock can't be billions of blocks long */
+   rmsgpack_write_array_header(out_stream, (uint32_t)count);
+   for (i = 0; i < count; i++)
+      rmsgpack_write_int(out_stream, blocks[i]);
+}
+
 int64_t bsv_movie_write_deduped_state(bsv_movie_t *movie, uint8_t *state,
       size_t state_size, uint8_t *output, size_t output_capacity)
 {
    uint32_t i;
    int64_t encoded_size;
-   size_t superblock, block;
-   static uint32_t skipped_blocks     = 0;
-   static uint32_t memcmps            = 0, hashes = 0;
-   static uint32_t reused_blocks      = 0;
-   static uint32_t reused_superblocks = 0;
-   static uint32_t total_blocks       = 0;
-   static uint32_t total_superblocks  = 0;
-   static uint32_t total_checkpoints  = 0;
-   static uint32_t total_kbs_input    = 0;
-   static uint32_t total_kbs_written  = 0;
-   static retro_perf_tick_t total_encode_micros = 0;
-   retro_perf_tick_t start     = cpu_features_get_time_usec();
-   size_t block_byte_size      = movie->blocks->object_size*4;
-   size_t superblock_size      = movie->superblocks->object_size;
-   size_t superblock_byte_size = superblock_size*block_byte_size;
-   size_t superblock_count     = state_size / superblock_byte_size + (state_size % superblock_byte_size != 0);
-   uint32_t *superblock_buf    = (uint32_t*)calloc(superblock_size, sizeof(uint32_t));
-   uint8_t *padded_block       = NULL;
+   struct state_store_listener listener;
+   struct state_store_stats *stats = &movie->store.stats;
+   size_t superblock_count     = state_store_seq_len(&movie->store, state_size);
    intfstream_t *out_stream    = intfstream_open_writable_memory(output,
          RETRO_VFS_FILE_ACCESS_READ_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE,
          output_capacity);
@@ -1540,106 +2358,28 @@ int64_t bsv_movie_write_deduped_state(bsv_movie_t *movie, uint8_t *state,
    if (!movie->superblock_seq)
    {
       movie->cur_save_valid = false;
+      can_compare_saves     = false;
       movie->superblock_seq = (uint32_t*)calloc(superblock_count, sizeof(uint32_t));
    }
    rmsgpack_write_int(out_stream, BSV_IFRAME_START_TOKEN);
    rmsgpack_write_int(out_stream, movie->frame_counter);
-   for (superblock = 0; superblock < superblock_count; superblock++)
-   {
-      uint32s_insert_result_t found_block;
-      total_superblocks++;
-      for (block = 0; block < superblock_size; block++)
-      {
-         size_t block_start = superblock*superblock_byte_size+block*block_byte_size;
-         size_t block_end = MIN(block_start + block_byte_size, state_size);
-         if (block_start > state_size)
-         {
-            /* pad superblocks with zero blocks */
-            found_block.index  = 0;
-            found_block.is_new = false;
-         }
-         else if (   can_compare_saves
-                  && (++memcmps)
-                  && memcmp(movie->last_save + block_start,
-                         state + block_start,
-                         block_end-block_start) == 0)
-         {
-            skipped_blocks++;
-            found_block.index = uint32s_index_get(movie->superblocks,
-                  movie->superblock_seq[superblock])[block];
-            found_block.is_new = false;
-            /* bump usage count */
-            uint32s_index_bump_count(movie->blocks, found_block.index);
-         }
-         else if (block_start + block_byte_size > state_size)
-         {
-            if (!padded_block)
-               padded_block = (uint8_t*)calloc(block_byte_size, sizeof(uint8_t));
-            else
-               memset(padded_block + (state_size-block_start),
-                     0, block_byte_size-(state_size-block_start));
-            memcpy(padded_block, state+block_start, state_size - block_start);
-            found_block = uint32s_index_insert(movie->blocks,
-                  (uint32_t*)padded_block,
-                  movie->frame_counter);
-            hashes++;
-         }
-         else
-         {
-            hashes++;
-            found_block = uint32s_index_insert(movie->blocks,
-                  (uint32_t*)(state+block_start),
-                  movie->frame_counter);
-         }
-         total_blocks++;
-
-         if (found_block.is_new)
-         {
-            /* write "here is a new block" and new block to file */
-            rmsgpack_write_int(out_stream, BSV_IFRAME_NEW_BLOCK_TOKEN);
-            rmsgpack_write_int(out_stream, found_block.index);
-            /* Cast is fine, a single block can't be super big */
-            rmsgpack_write_bin(out_stream, state+block_start, (uint32_t)block_byte_size);
-         }
-         else
-            reused_blocks++;
-         superblock_buf[block] = found_block.index;
-      }
-      found_block = uint32s_index_insert(movie->superblocks, superblock_buf, movie->frame_counter);
-      if (found_block.is_new)
-      {
-         /* write "here is a new superblock" and new superblock to file */
-         rmsgpack_write_int(out_stream, BSV_IFRAME_NEW_SUPERBLOCK_TOKEN);
-         rmsgpack_write_int(out_stream, found_block.index);
-         /* Cast is fine, a single superblock can't be billions of blocks long */
-         rmsgpack_write_array_header(out_stream, (uint32_t)superblock_size);
-         for (i = 0; i < superblock_size; i++)
-            rmsgpack_write_int(out_stream, superblock_buf[i]);
-      }
-      else
-         reused_superblocks++;
-      movie->superblock_seq[superblock] = found_block.index;
-   }
-   uint32s_index_commit(movie->blocks);
-   /* Superblocks are small enough that there's no real benefit to garbage collecting them */
-   /* uint32s_index_commit(movie->superblocks); */
+   listener.new_block      = bsv_movie_write_new_block;
+   listener.new_superblock = bsv_movie_write_new_superblock;
+   listener.userdata       = out_stream;
+   state_store_insert(&movie->store, state, state_size,
+         can_compare_saves ? movie->last_save : NULL, movie->superblock_seq,
+         movie->superblock_seq, movie->frame_counter, &listener);
    /* write "here is the superblock seq" and superblock seq to file */
    rmsgpack_write_int(out_stream, BSV_IFRAME_SUPERBLOCK_SEQ_TOKEN);
    /* Cast is fine, we won't have billions of superblocks */
    rmsgpack_write_array_header(out_stream, (uint32_t)superblock_count);
    for (i = 0; i < superblock_count; i++)
        rmsgpack_write_int(out_stream, movie->superblock_seq[i]);
-   free(superblock_buf);
-   if (padded_block)
-     free(padded_block);
-   movie->cur_save_valid = true;
-   total_checkpoints++;
-   total_encode_micros += cpu_features_get_time_usec() - start;
-   total_kbs_input     += state_size / 1024;
-   encoded_size         = intfstream_tell(out_stream);
-   total_kbs_written   += encoded_size / 1024;
-   RARCH_DBG("[STATESTREAM] Encode stats at checkpoint %d: %d blocks (%d reused, %d skipped [%d checks], %d distinct [%d hashes])\n", total_checkpoints, total_blocks, reused_blocks, skipped_blocks, memcmps, uint32s_index_count(movie->blocks), hashes);
-   RARCH_DBG("[STATESTREAM] %d superblocks (%d reused, %d distinct); unencoded size (KB) %d, encoded size (KB) %d; net time (secs) %f\n", total_superblocks, reused_superblocks, uint32s_index_count(movie->superblocks), total_kbs_input, total_kbs_written, ((float)total_encode_micros) / (float)1000000.0);
+   movie->cur_save_valid    = true;
+   encoded_size             = intfstream_tell(out_stream);
+   movie->checkpoint_bytes += encoded_size;
+   RARCH_DBG("[STATESTREAM] Encode stats at checkpoint %d: %d blocks (%d reused, %d skipped [%d checks], %d distinct [%d hashes])\n", stats->inserts, stats->blocks, stats->reused_blocks, stats->skipped_blocks, stats->memcmps, uint32s_index_count(movie->store.blocks), stats->hashes);
+   RARCH_DBG("[STATESTREAM] %d superblocks (%d reused, %d distinct); unencoded size (KB) %d, encoded size (KB) %d; net time (secs) %f\n", stats->superblocks, stats->reused_superblocks, uint32s_index_count(movie->store.superblocks), (unsigned)(stats->bytes / 1024), (unsigned)(movie->checkpoint_bytes / 1024), ((float)stats->usec) / (float)1000000.0);
    intfstream_close(out_stream);
    return encoded_size;
 }
@@ -1648,14 +2388,12 @@ bool bsv_movie_read_deduped_state(bsv_movie_t *movie, uint8_t *encoded, size_t e
 {
    size_t i;
    struct rmsgpack_dom_value item;
-   static retro_perf_tick_t total_decode_micros = 0;
-   static retro_perf_tick_t total_decode_count  = 0;
    retro_perf_tick_t start = cpu_features_get_time_usec();
    bool ret                = false;
    size_t state_size       = movie->cur_save_size;
    struct rmsgpack_dom_reader_state *reader_state = rmsgpack_dom_reader_state_new();
-   size_t block_byte_size      = movie->blocks->object_size*4;
-   size_t superblock_byte_size = movie->superblocks->object_size*block_byte_size;
+   size_t block_byte_size      = movie->store.blocks->object_size*4;
+   size_t superblock_byte_size = movie->store.superblocks->object_size*block_byte_size;
    intfstream_t *read_mem      = intfstream_open_memory(encoded,
          RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE, encoded_size);
    if (state_size > movie->last_save_size && movie->superblock_seq)
@@ -1667,7 +2405,7 @@ bool bsv_movie_read_deduped_state(bsv_movie_t *movie, uint8_t *encoded, size_t e
       RARCH_ERR("[STATESTREAM] movie has no current serialized save\n");
       goto exit;
    }
-   total_decode_count++;
+   movie->decodes++;
    rmsgpack_dom_read_with(read_mem, &item, reader_state);
    if (item.type != RDT_INT && item.type != RDT_UINT)
    {
@@ -1720,7 +2458,7 @@ bool bsv_movie_read_deduped_state(bsv_movie_t *movie, uint8_t *encoded, size_t e
                rmsgpack_dom_value_free(&item);
                goto exit;
             }
-            if (!uint32s_index_insert_exact(movie->blocks, index,
+            if (!uint32s_index_insert_exact(movie->store.blocks, index,
                      (uint32_t *)item.val.binary.buff, movie->frame_counter))
             {
                RARCH_ERR("[STATESTREAM] couldn't insert new block at right index %d\n", index);
@@ -1748,12 +2486,12 @@ bool bsv_movie_read_deduped_state(bsv_movie_t *movie, uint8_t *encoded, size_t e
                RARCH_ERR("[STATESTREAM] new superblock contents type is wrong\n");
                goto exit;
             }
-            if (item.val.array.len != movie->superblocks->object_size)
+            if (item.val.array.len != movie->store.superblocks->object_size)
             {
                RARCH_ERR("[STATESTREAM] new superblock contents length is wrong\n");
                goto exit;
             }
-            len        = movie->superblocks->object_size;
+            len        = movie->store.superblocks->object_size;
             superblock = (uint32_t*)calloc(len, sizeof(uint32_t));
 
             for (i = 0; i < len; i++)
@@ -1763,7 +2501,7 @@ bool bsv_movie_read_deduped_state(bsv_movie_t *movie, uint8_t *encoded, size_t e
                /* Superblock indices are 32-bit */
                superblock[i] = (uint32_t)inner_item.val.uint_;
             }
-            if (!uint32s_index_insert_exact(movie->superblocks, index, superblock, movie->frame_counter))
+            if (!uint32s_index_insert_exact(movie->store.superblocks, index, superblock, movie->frame_counter))
             {
                RARCH_ERR("[STATESTREAM] new superblock couldn't be inserted at right index\n");
                rmsgpack_dom_value_free(&item);
@@ -1794,17 +2532,17 @@ bool bsv_movie_read_deduped_state(bsv_movie_t *movie, uint8_t *encoded, size_t e
                /* if this superblock is the same as last time, no need to scan the blocks. */
                if (movie->cur_save_valid && movie->cur_save && superblock_idx == movie->superblock_seq[i])
                {
-                  superblock = uint32s_index_get(movie->superblocks, movie->superblock_seq[i]);
-                  uint32s_index_bump_count(movie->superblocks, movie->superblock_seq[i]);
+                  superblock = uint32s_index_get(movie->store.superblocks, movie->superblock_seq[i]);
+                  uint32s_index_bump_count(movie->store.superblocks, movie->superblock_seq[i]);
                   /* We do need to increment all the involved block counts though */
-                  for (j = 0; j < movie->superblocks->object_size; j++)
-                     uint32s_index_bump_count(movie->blocks, superblock[j]);
+                  for (j = 0; j < movie->store.superblocks->object_size; j++)
+                     uint32s_index_bump_count(movie->store.blocks, superblock[j]);
                   continue;
                }
                movie->superblock_seq[i] = superblock_idx;
-               superblock = uint32s_index_get(movie->superblocks, superblock_idx);
-               uint32s_index_bump_count(movie->superblocks, superblock_idx);
-               for (j = 0; j < movie->superblocks->object_size; j++)
+               superblock = uint32s_index_get(movie->store.superblocks, superblock_idx);
+               uint32s_index_bump_count(movie->store.superblocks, superblock_idx);
+               for (j = 0; j < movie->store.superblocks->object_size; j++)
                {
                   uint8_t *block;
                   uint32_t block_idx = superblock[j];
@@ -1813,8 +2551,8 @@ bool bsv_movie_read_deduped_state(bsv_movie_t *movie, uint8_t *encoded, size_t e
                   /* This (==) can only happen in the last superblock, if it was padded with extra blocks. */
                   if (block_end <= block_start)
                      break;
-                  block = (uint8_t *)uint32s_index_get(movie->blocks, block_idx);
-                  uint32s_index_bump_count(movie->blocks, block_idx);
+                  block = (uint8_t *)uint32s_index_get(movie->store.blocks, block_idx);
+                  uint32s_index_bump_count(movie->store.blocks, block_idx);
                   memcpy(movie->cur_save+block_start, (uint8_t*)block, block_end-block_start);
                }
             }
@@ -1827,9 +2565,9 @@ bool bsv_movie_read_deduped_state(bsv_movie_t *movie, uint8_t *encoded, size_t e
       }
    }
 exit:
-   uint32s_index_commit(movie->blocks);
+   uint32s_index_commit(movie->store.blocks);
    /* Superblocks are small enough that there's no real benefit to garbage collecting them */
-   /* uint32s_index_commit(movie->superblocks); */
+   /* uint32s_index_commit(movie->store.superblocks); */
    rmsgpack_dom_reader_state_free(reader_state);
    intfstream_close(read_mem);
    if (!ret)
@@ -1837,8 +2575,8 @@ exit:
       RARCH_ERR("[STATESTREAM] made it to end without superblock seq\n");
       return false;
    }
-   total_decode_micros += cpu_features_get_time_usec() - start;
-   RARCH_DBG("[STATESTREAM] Total statestream decodes %d ; net time (secs): %f\n", total_decode_count, (double)total_decode_micros / (1000000.0));
+   movie->decode_usec += cpu_features_get_time_usec() - start;
+   RARCH_DBG("[STATESTREAM] Total statestream decodes %d ; net time (secs): %f\n", movie->decodes, (double)movie->decode_usec / (1000000.0));
    return ret;
 }
 #endif
@@ -1859,6 +2597,7 @@ bool movie_seek_to_frame(input_driver_state_t *input_st, int64_t frame)
    if (rcheevos_hardcore_active())
       return false;
 #endif
+   bsv_movie_sync(input_st->bsv_movie_state_handle);
    if (!movie_find_checkpoint_before(input_st->bsv_movie_state_handle, frame, true,
                &input_st->bsv_movie_state.seek_target_pos,
                &input_st->bsv_movie_state.seek_target_frame))
@@ -41,6 +41,10 @@
 #define REPLAY_FORMAT_VERSION            2
 #define REPLAY_MAGIC                     0x42535632
 
+/* "BSVI", opening the index and ending the file */
+#define REPLAY_INDEX_MAGIC               0x42535649
+#define REPLAY_INDEX_VERSION             1
+
 RETRO_BEGIN_DECLS
 
 void bsv_movie_poll(input_driver_state_t *input_st);
@@ -58,6 +62,35 @@ bool bsv_movie_load_checkpoint(bsv_movie_t *movie,
 int64_t bsv_movie_write_checkpoint(bsv_movie_t *movie,
       uint8_t compression, uint8_t encoding);
 
+/* Moves the writes of a recording onto a background thread from here
+ * on; does nothing without thread support */
+bool bsv_movie_writer_start(bsv_movie_t *movie);
+void bsv_movie_writer_stop(bsv_movie_t *movie);
+
+/* Waits until everything queued is in the file, so it can be read,
+ * seeked or truncated directly */
+void bsv_movie_sync(bsv_movie_t *movie);
+
+void bsv_movie_index_free(struct bsv_movie_index *index);
+
+/* Appends the index to a recording being closed */
+bool bsv_movie_index_save(bsv_movie_t *movie);
+/* Reads the index at the end of a replay to be played back, if any */
+bool bsv_movie_index_load(bsv_movie_t *movie);
+
+/**
+ * bsv_movie_index_scan:
+ * @pos                  : start of the next frame to index, which is
+ *                         moved past the frames indexed
+ * @budget               : frames to index at most
+ *
+ * Indexes the frames of a replay of @version in @file, which need not be
+ * the stream of a movie. Returns 1 once the frames end, 0 if there are
+ * more to do.
+ **/
+int bsv_movie_index_scan(struct bsv_movie_index *index, intfstream_t *file,
+      uint32_t version, int64_t *pos, unsigned budget);
+
 RETRO_END_DECLS
 
 #endif /* __BSV_MOVIE__H */
@@ -0,0 +1,491 @@
+/**
+ *  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ *  more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with RetroArch. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <compat/strl.h>
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+#include <streams/interface_stream.h>
+#include <string/stdstring.h>
+#include <features/features_cpu.h>
+#include <retro_endianness.h>
+#include <retro_miscellaneous.h>
+#include <array/rbuf.h>
+
+#include "replay_export.h"
+
+#ifdef HAVE_REPLAY_EXPORT
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "bsvmovie.h"
+#include "../../verbosity.h"
+
+#ifdef HAVE_FFMPEG
+#include "../../record/drivers/record_ffmpeg.h"
+#endif
+
+/* Frames indexed per call, between checks for the end */
+#define REPLAY_EXPORT_INDEX_FRAMES 4096
+
+typedef struct replay_export_segment
+{
+#ifdef _WIN32
+   HANDLE process;
+#else
+   pid_t process;
+#endif
+   /* Checkpoint frames it plays after and up to; 0 for the start and
+    * the end of the replay */
+   int64_t first;
+   int64_t last;
+   /* As reported */
+   uint64_t first_frame;
+   uint64_t last_frame;
+   uint64_t frames;
+   char boundary[16];
+   bool started;
+   char path[PATH_MAX_LENGTH];
+   char report[PATH_MAX_LENGTH];
+} replay_export_segment_t;
+
+static bool replay_export_index(const char *path,
+      struct bsv_movie_index *index)
+{
+   int64_t pos;
+   int64_t read;
+   uint32_t version;
+   uint32_t header[REPLAY_HEADER_LEN] = {0};
+   intfstream_t *file = intfstream_open_file(path,
+         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+   {
+      RARCH_ERR("[Export] Could not open replay \"%s\".\n", path);
+      return false;
+   }
+
+   read    = intfstream_read(file, header, sizeof(header));
+   version = swap_if_big32(header[REPLAY_HEADER_VERSION_INDEX]);
+   if (     read < REPLAY_HEADER_V0V1_LEN_BYTES
+         || swap_if_big32(header[REPLAY_HEADER_MAGIC_INDEX]) != REPLAY_MAGIC
+         || version == 0
+         || version > REPLAY_FORMAT_VERSION)
+   {
+      RARCH_ERR("[Export] \"%s\" is not a replay with checkpoints.\n", path);
+      intfstream_close(file);
+      free(file);
+      return false;
+   }
+
+   pos = (version < 2 ? REPLAY_HEADER_V0V1_LEN_BYTES : REPLAY_HEADER_LEN_BYTES)
+      + swap_if_big32(header[REPLAY_HEADER_STATE_SIZE_INDEX]);
+   while (!bsv_movie_index_scan(index, file, version, &pos,
+            REPLAY_EXPORT_INDEX_FRAMES)) { }
+
+   intfstream_close(file);
+   free(file);
+   return true;
+}
+
+/* Cuts the replay at the checkpoints closest after equal shares of its
+ * frames. Returns the number of segments, whose first frames are put
+ * in @starts. */
+static unsigned replay_export_plan(const struct bsv_movie_index *index,
+      unsigned jobs, int64_t *starts)
+{
+   unsigned i;
+   size_t c           = 0;
+   size_t count       = RBUF_LEN(index->checkpoints);
+   unsigned segments  = 1;
+
+   starts[0]          = 0;
+   for (i = 1; i < jobs; i++)
+   {
+      uint64_t target = index->frames * i / jobs;
+      while (     c < count
+               && (     index->checkpoints[c].frame < target
+                     || (int64_t)index->checkpoints[c].frame
+                        <= starts[segments - 1]))
+         c++;
+      /* The last segment needs a frame of its own */
+      if (c == count || index->checkpoints[c].frame + 1 >= index->frames)
+         break;
+      starts[segments++] = (int64_t)index->checkpoints[c].frame;
+   }
+   return segments;
+}
+
+/* A copy of @argv to play @seg with: its own recording and range in
+ * place of the export's */
+static char **replay_export_args(int argc, char *argv[],
+      char *record_arg, char *range_arg)
+{
+   int i;
+   int n        = 0;
+   char **args  = (char**)calloc(argc + 3, sizeof(*args));
+
+   if (!args)
+      return NULL;
+
+   args[n++]    = argv[0];
+   args[n++]    = record_arg;
+   args[n++]    = range_arg;
+   for (i = 1; i < argc; i++)
+   {
+      const char *arg = argv[i];
+      if (     string_is_equal(arg, "--replay-export")
+            || string_is_equal(arg, "--record")
+            || string_is_equal(arg, "-r"))
+      {
+         i++;
+         continue;
+      }
+      if (     string_starts_with(arg, "--replay-export=")
+            || string_starts_with(arg, "--record="))
+         continue;
+      args[n++] = argv[i];
+   }
+   return args;
+}
+
+#ifdef _WIN32
+/* Appends @arg to @cmd the way the C runtime splits it again */
+static size_t replay_export_quote(char *cmd, size_t len, size_t size,
+      const char *arg)
+{
+   size_t slashes = 0;
+
+   if (len + 1 < size)
+      cmd[len++] = '"';
+   for (; *arg && len + 2 < size; arg++)
+   {
+      if (*arg == '\\')
+         slashes++;
+      else
+      {
+         /* Backslashes only escape before a quote */
+         if (*arg == '"')
+         {
+            for (slashes++; slashes && len + 1 < size; slashes--)
+               cmd[len++] = '\\';
+         }
+         slashes = 0;
+      }
+      cmd[len++] = *arg;
+   }
+   for (; slashes && len + 1 < size; slashes--)
+      cmd[len++] = '\\';
+   if (len + 2 < size)
+   {
+      cmd[len++] = '"';
+      cmd[len++] = ' ';
+   }
+   cmd[len] = '\0';
+   return len;
+}
+
+static bool replay_export_spawn(replay_export_segment_t *seg, char **args)
+{
+   STARTUPINFOA si;
+   PROCESS_INFORMATION pi;
+   char path[PATH_MAX_LENGTH];
+   size_t len  = 0;
+   size_t size = 32768;
+   char *cmd   = (char*)malloc(size);
+
+   if (!cmd)
+      return false;
+   *cmd = '\0';
+   for (; *args; args++)
+      len = replay_export_quote(cmd, len, size, *args);
+
+   memset(&si, 0, sizeof(si));
+   memset(&pi, 0, sizeof(pi));
+   si.cb = sizeof(si);
+   GetModuleFileNameA(NULL, path, sizeof(path));
+   if (!CreateProcessA(path, cmd, NULL, NULL, FALSE, 0, NULL, NULL,
+            &si, &pi))
+   {
+      free(cmd);
+      return false;
+   }
+   CloseHandle(pi.hThread);
+   seg->process = pi.hProcess;
+   free(cmd);
+   return true;
+}
+
+static void replay_export_wait(replay_export_segment_t *seg)
+{
+   WaitForSingleObject(seg->process, INFINITE);
+   CloseHandle(seg->process);
+}
+#else
+static bool replay_export_spawn(replay_export_segment_t *seg, char **args)
+{
+   pid_t pid;
+
+   fflush(stdout);
+   fflush(stderr);
+   if ((pid = fork()) < 0)
+      return false;
+   if (!pid)
+   {
+      execvp(args[0], args);
+      _exit(127);
+   }
+   seg->process = pid;
+   return true;
+}
+
+static void replay_export_wait(replay_export_segment_t *seg)
+{
+   int status;
+   while (waitpid(seg->process, &status, 0) < 0 && errno == EINTR) { }
+}
+#endif
+
+static uint64_t replay_export_field(const char *report, const char *key)
+{
+   const char *value = strstr(report, key);
+   return value ? strtoull(value + strlen(key), NULL, 10) : 0;
+}
+
+static bool replay_export_read_report(replay_export_segment_t *seg)
+{
+   void *buf     = NULL;
+   int64_t len   = 0;
+   const char *boundary;
+
+   if (!filestream_read_file(seg->report, &buf, &len) || !buf)
+      return false;
+   seg->first_frame = replay_export_field((const char*)buf, "first ");
+   seg->last_frame  = replay_export_field((const char*)buf, "last ");
+   seg->frames      = replay_export_field((const char*)buf, "frames ");
+   if ((boundary = strstr((const char*)buf, "boundary ")))
+   {
+      size_t i;
+      boundary += STRLEN_CONST("boundary ");
+      for (i = 0; i + 1 < sizeof(seg->boundary)
+            && boundary[i] && boundary[i] != '\n'; i++)
+         seg->boundary[i] = boundary[i];
+      seg->boundary[i] = '\0';
+   }
+   free(buf);
+   return true;
+}
+
+/* Each segment must have played every frame from where the one before
+ * stopped, and ended where the next began */
+static bool replay_export_verify(replay_export_segment_t *segs,
+      unsigned count)
+{
+   unsigned i;
+   bool ret = true;
+
+   for (i = 0; i < count; i++)
+   {
+      replay_export_segment_t *seg = &segs[i];
+      if (!replay_export_read_report(seg))
+      {
+         RARCH_ERR("[Export] Segment %u did not finish.\n", i);
+         ret = false;
+         continue;
+      }
+      if (     string_is_equal(seg->boundary, "error")
+            || seg->frames != seg->last_frame - seg->first_frame
+            || (i && seg->first_frame != segs[i - 1].last_frame))
+      {
+         RARCH_ERR("[Export] Segment %u played frames %" PRIu64 " to %"
+               PRIu64 " (%" PRIu64 " frames), which does not join up.\n",
+               i, seg->first_frame, seg->last_frame, seg->frames);
+         ret = false;
+      }
+      else if (i + 1 < count && !string_is_equal(seg->boundary, "match"))
+         RARCH_WARN("[Export] Segment %u ends in a state other than the "
+               "checkpoint at frame %" PRId64 " (%s); the core may not "
+               "replay deterministically.\n", i, seg->last, seg->boundary);
+      else
+         RARCH_LOG("[Export] Segment %u: frames %" PRIu64 " to %" PRIu64
+               ", %s.\n", i, seg->first_frame, seg->last_frame,
+               seg->boundary);
+   }
+   return ret;
+}
+
+/* Without a muxer at hand, a list for ffmpeg's concat demuxer */
+static bool replay_export_write_list(replay_export_segment_t *segs,
+      unsigned count, const char *record_path)
+{
+   unsigned i;
+   char list[PATH_MAX_LENGTH];
+   size_t size = STRLEN_CONST("ffconcat version 1.0\n")
+      + count * (PATH_MAX_LENGTH + 16);
+   char *buf   = (char*)malloc(size);
+   size_t len;
+
+   if (!buf)
+      return false;
+   len = strlcpy(buf, "ffconcat version 1.0\n", size);
+   for (i = 0; i < count; i++)
+      len += snprintf(buf + len, size - len, "file '%s'\n",
+            path_basename(segs[i].path));
+   snprintf(list, sizeof(list), "%s.ffconcat", record_path);
+   if (!filestream_write_file(list, buf, (int64_t)len))
+   {
+      free(buf);
+      return false;
+   }
+   free(buf);
+   RARCH_LOG("[Export] Parts kept; join them with "
+         "\"ffmpeg -f concat -safe 0 -i %s -c copy %s\".\n",
+         list, record_path);
+   return true;
+}
+
+static bool replay_export_join(replay_export_segment_t *segs,
+      unsigned count, const char *record_path)
+{
+   unsigned i;
+#ifdef HAVE_FFMPEG
+   const char *parts[REPLAY_EXPORT_MAX_JOBS];
+   for (i = 0; i < count; i++)
+      parts[i] = segs[i].path;
+   if (ffmpeg_concat_files(record_path, parts, count))
+   {
+      for (i = 0; i < count; i++)
+         filestream_delete(segs[i].path);
+      return true;
+   }
+   RARCH_WARN("[Export] Could not join the parts into \"%s\".\n",
+         record_path);
+#endif
+   return replay_export_write_list(segs, count, record_path);
+}
+
+bool replay_export_run(int argc, char *argv[], const char *replay_path,
+      const char *record_path, unsigned jobs)
+{
+   unsigned i, count;
+   char base[PATH_MAX_LENGTH];
+   int64_t starts[REPLAY_EXPORT_MAX_JOBS];
+   struct bsv_movie_index index;
+   replay_export_segment_t *segs;
+   const char *ext  = path_get_extension(record_path);
+   retro_time_t start = cpu_features_get_time_usec();
+   bool ret         = false;
+
+   if (string_is_empty(replay_path) || string_is_empty(record_path))
+   {
+      RARCH_ERR("[Export] --replay-export needs --play-replay and --record.\n");
+      return false;
+   }
+   if (!jobs)
+      jobs = cpu_features_get_core_amount();
+   jobs = MAX(1, MIN(jobs, REPLAY_EXPORT_MAX_JOBS));
+
+   memset(&index, 0, sizeof(index));
+   if (!replay_export_index(replay_path, &index))
+      return false;
+   count = replay_export_plan(&index, jobs, starts);
+   RARCH_LOG("[Export] %u frames, %u checkpoints: %u segments.\n",
+         (unsigned)index.frames, (unsigned)RBUF_LEN(index.checkpoints),
+         count);
+
+   if (!(segs = (replay_export_segment_t*)calloc(count, sizeof(*segs))))
+   {
+      bsv_movie_index_free(&index);
+      return false;
+   }
+
+   strlcpy(base, record_path, sizeof(base));
+   path_remove_extension(base);
+   for (i = 0; i < count; i++)
+   {
+      char **args;
+      char record_arg[PATH_MAX_LENGTH + 16];
+      char range_arg[64];
+      replay_export_segment_t *seg = &segs[i];
+
+      seg->first = starts[i];
+      seg->last  = i + 1 < count ? starts[i + 1] : 0;
+      if (     (size_t)snprintf(seg->path, sizeof(seg->path),
+                  "%s.part%02u.%s", base, i,
+                  string_is_empty(ext) ? "mkv" : ext)
+               >= sizeof(seg->path)
+            || (size_t)snprintf(seg->report, sizeof(seg->report),
+                  "%s.range", seg->path) >= sizeof(seg->report))
+      {
+         /* A cut-off name could be some other file */
+         seg->report[0] = '\0';
+         RARCH_ERR("[Export] Segment %u file name is too long.\n", i);
+         break;
+      }
+      filestream_delete(seg->report);
+
+      snprintf(record_arg, sizeof(record_arg), "--record=%s", seg->path);
+      snprintf(range_arg, sizeof(range_arg), "--replay-range=%" PRId64
+            "-%" PRId64, seg->first, seg->last);
+      if (!(args = replay_export_args(argc, argv, record_arg, range_arg)))
+         break;
+      seg->started = replay_export_spawn(seg, args);
+      free(args);
+      if (!seg->started)
+      {
+         RARCH_ERR("[Export] Could not start segment %u.\n", i);
+         break;
+      }
+   }
+
+   for (i = 0; i < count; i++)
+      if (segs[i].started)
+         replay_export_wait(&segs[i]);
+
+   if (replay_export_verify(segs, count))
+   {
+      double secs = (cpu_features_get_time_usec() - start) / 1000000.0;
+      RARCH_LOG("[Export] Played %u frames in %.1f s (%.1f fps).\n",
+            (unsigned)index.frames, secs,
+            secs > 0.0 ? index.frames / secs : 0.0);
+      ret = replay_export_join(segs, count, record_path);
+   }
+
+   for (i = 0; i < count; i++)
+      filestream_delete(segs[i].report);
+   free(segs);
+   bsv_movie_index_free(&index);
+   return ret;
+}
+
+#else
+bool replay_export_run(int argc, char *argv[], const char *replay_path,
+      const char *record_path, unsigned jobs)
+{
+   return false;
+}
+#endif
@@ -0,0 +1,58 @@
+/**
+ *  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ *  more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with RetroArch. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef __REPLAY_EXPORT__H
+#define __REPLAY_EXPORT__H
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+/* Needs to start copies of this program and wait for them */
+#if (defined(_WIN32) && !defined(_XBOX) && !defined(__WINRT__)) \
+      || (defined(__linux__) && !defined(ANDROID)) \
+      || (defined(__APPLE__) && !defined(IOS)) || defined(__FreeBSD__)
+#define HAVE_REPLAY_EXPORT
+#endif
+
+/* Most copies of the program an export runs at once */
+#define REPLAY_EXPORT_MAX_JOBS 64
+
+RETRO_BEGIN_DECLS
+
+/**
+ * replay_export_run:
+ * @argc, @argv          : the command line, which each segment is
+ *                         played with as well
+ * @replay_path          : replay to export
+ * @record_path          : video file to record it to
+ * @jobs                 : segments to play at once, 0 for one per core
+ *
+ * Splits the replay at checkpoints and plays the segments in as many
+ * copies of this program at once, each recording its own part with
+ * --replay-range. Each reports the frames it played and whether its
+ * state at the end matched the checkpoint the next one starts from;
+ * the parts are then joined into @record_path.
+ *
+ * Returns true if every segment played and the parts were joined, or
+ * left with a list to join them with.
+ **/
+bool replay_export_run(int argc, char *argv[], const char *replay_path,
+      const char *record_path, unsigned jobs);
+
+RETRO_END_DECLS
+
+#endif /* __REPLAY_EXPORT__H */
@@ -26,7 +26,8 @@
 #include <xxHash/xxhash.h>
 
 #define HASHMAP_CAP 65536
-#define uint32s_hash_bytes(bytes, len) XXH32(bytes,len,0)
+/* XXH3 runs on the vector units wherever the build targets them */
+#define uint32s_hash_bytes(bytes, len) ((uint32_t)XXH3_64bits(bytes,len))
 
 uint32s_index_t *uint32s_index_new(size_t object_size,
       uint8_t commit_interval, uint8_t commit_threshold)
@@ -119,14 +120,25 @@ bool uint32s_bucket_remove(struct uint32s_bucket *bucket, uint32_t idx)
    return false;
 }
 
+uint32_t uint32s_index_hash(const uint32s_index_t *index, const uint32_t *object)
+{
+   return uint32s_hash_bytes((const uint8_t *)object,
+         index->object_size * sizeof(uint32_t));
+}
+
 uint32s_insert_result_t uint32s_index_insert(uint32s_index_t *index, uint32_t *object, uint64_t frame)
+{
+   return uint32s_index_insert_hashed(index, object,
+         uint32s_index_hash(index, object), frame);
+}
+
+uint32s_insert_result_t uint32s_index_insert_hashed(uint32s_index_t *index, uint32_t *object, uint32_t hash, uint64_t frame)
 {
    uint32_t idx;
    uint32_t *copy;
    struct uint32s_bucket *bucket;
    uint32s_insert_result_t result;
    size_t size_bytes      = index->object_size * sizeof(uint32_t);
-   uint32_t hash          = uint32s_hash_bytes((uint8_t *)object, size_bytes);
    uint32_t additions_len = RBUF_LEN(index->additions);
    result.index  = 0;
    result.is_new = false;
@@ -257,6 +269,26 @@ void uint32s_index_bump_count(uint32s_index_t *index, uint32_t which)
    index->counts[which]++;
 }
 
+void uint32s_index_release(uint32s_index_t *index, uint32_t which)
+{
+   struct uint32s_bucket *bucket;
+   /* never remove 0s pattern */
+   if (which == 0 || which >= RBUF_LEN(index->counts) || !index->objects[which])
+      return;
+   if (--index->counts[which])
+      return;
+   free(index->objects[which]);
+   index->objects[which] = NULL;
+   bucket = RHMAP_PTR(index->index, index->hashes[which]);
+   uint32s_bucket_remove(bucket, which);
+   if (bucket->len == 0)
+   {
+      uint32s_bucket_free(bucket);
+      if (!RHMAP_DEL(index->index, index->hashes[which]))
+         RARCH_ERR("[STATESTREAM] Trying to remove absent hash %x\n",index->hashes[which]);
+   }
+}
+
 uint32_t *uint32s_index_get(uint32s_index_t *index, uint32_t which)
 {
    if (which >= RBUF_LEN(index->objects))
@@ -69,12 +69,19 @@ RETRO_BEGIN_DECLS
 uint32s_index_t *uint32s_index_new(size_t object_size, uint8_t commit_interval, uint8_t commit_threshold);
 /* Does not take ownership of object */
 uint32s_insert_result_t uint32s_index_insert(uint32s_index_t *index, uint32_t *object, uint64_t frame);
+/* Same, with the uint32s_index_hash of object worked out beforehand; that
+ * part alone is safe to run on other threads */
+uint32_t uint32s_index_hash(const uint32s_index_t *index, const uint32_t *object);
+uint32s_insert_result_t uint32s_index_insert_hashed(uint32s_index_t *index, uint32_t *object, uint32_t hash, uint64_t frame);
 /* Does take ownership, requires idx is the exact next index and object not in index */
 bool uint32s_index_insert_exact(uint32s_index_t *index, uint32_t idx, uint32_t *object, uint64_t frame);
 /* Does not grant ownership of return value */
 uint32_t *uint32s_index_get(uint32s_index_t *index, uint32_t which);
 /* Just bump the count, don't try to get the results back */
 void uint32s_index_bump_count(uint32s_index_t *index, uint32_t which);
+/* Drop the count again, freeing the object once nothing uses it; for
+ * indices without a commit interval, whose counts are references */
+void uint32s_index_release(uint32s_index_t *index, uint32_t which);
 /* Call once the superblocks and blocks are all identified; transient blocks that have not been used this frame will be dropped. */
 void uint32s_index_commit(uint32s_index_t *index);
 void uint32s_index_free(uint32s_index_t *index);
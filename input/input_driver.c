@@ -61,6 +61,11 @@
 #include "../list_special.h"
 #include "../paths.h"
 #include "../performance_counters.h"
+#include "../frame_timeline.h"
+#include "../latency_test.h"
+#ifdef HAVE_THREADS
+#include "input_joypad_thread.h"
+#endif
 #include "../retroarch.h"
 #include "../tasks/tasks_internal.h"
 #include "../verbosity.h"
@@ -2478,6 +2483,17 @@ static bool input_overlay_coords_inside_hitbox(const struct overlay_desc *desc,
    return false;
 }
 
+/* Grid cell of an overlay coordinate; hitboxes and touches past
+ * the edges fall into the border cells */
+static unsigned input_overlay_grid_cell(float v)
+{
+   if (v <= 0.0f)
+      return 0;
+   if (v >= 1.0f)
+      return OVERLAY_GRID_SIZE - 1;
+   return (unsigned)(v * OVERLAY_GRID_SIZE);
+}
+
 /**
  * input_overlay_poll:
  * @out                   : Polled output data.
@@ -2500,8 +2516,9 @@ static bool input_overlay_poll(
       int touch_idx, int old_touch_idx,
       int16_t norm_x, int16_t norm_y, float touch_scale)
 {
-   size_t i, j;
+   size_t i, j, k, first, last;
    struct overlay_desc *descs = ol->active->descs;
+   const unsigned *grid_descs = ol->active->grid_descs;
    unsigned int highest_prio  = 0;
    bool any_hitbox_pressed    = false;
    bool use_range_mod;
@@ -2519,12 +2536,29 @@ static bool input_overlay_poll(
    x *= touch_scale;
    y *= touch_scale;
 
-   for (i = 0; i < ol->active->size; i++)
+   /* Only the descs listed in the touch's grid cell can be hit */
+   if (grid_descs)
+   {
+      unsigned cell = input_overlay_grid_cell(y) * OVERLAY_GRID_SIZE
+                    + input_overlay_grid_cell(x);
+      first         = ol->active->grid_start[cell];
+      last          = ol->active->grid_start[cell + 1];
+   }
+   else
+   {
+      first         = 0;
+      last          = ol->active->size;
+   }
+
+   for (k = first; k < last; k++)
    {
       float x_dist, y_dist;
       unsigned int base         = 0;
       unsigned int desc_prio    = 0;
-      struct overlay_desc *desc = &descs[i];
+      struct overlay_desc *desc;
+
+      i    = grid_descs ? grid_descs[k] : k;
+      desc = &descs[i];
 
       /* Use range_mod if this touch pointer contributed
        * to desc's touch_mask in the previous poll */
@@ -2679,6 +2713,81 @@ static void input_overlay_desc_init_hitbox(struct overlay_desc *desc)
    desc->range_y_mod    = desc->range_y_hitbox * desc->range_mod;
 }
 
+/**
+ * input_overlay_build_grid:
+ * @ol                    : Overlay handle.
+ *
+ * Sorts the descriptors into the grid cells their hitboxes reach,
+ * taking the larger of the plain and range_mod hitboxes, so that
+ * input_overlay_poll() only tests the descriptors of the touch's
+ * cell. Leaves the grid unset (every desc tested) on failure.
+ **/
+static void input_overlay_build_grid(struct overlay *ol)
+{
+   size_t i;
+   unsigned c, x, y;
+   unsigned fill[OVERLAY_GRID_CELLS];
+
+   free(ol->grid_descs);
+   ol->grid_descs = NULL;
+   memset(ol->grid_start, 0, sizeof(ol->grid_start));
+   memset(fill, 0, sizeof(fill));
+
+   /* Count, then place, the descs of each cell */
+   for (c = 0; c < 2; c++)
+   {
+      if (c == 1)
+      {
+         unsigned total = 0;
+         unsigned cell;
+
+         for (cell = 0; cell < OVERLAY_GRID_CELLS; cell++)
+         {
+            unsigned count        = fill[cell];
+            ol->grid_start[cell]  = total;
+            fill[cell]            = total;
+            total                += count;
+         }
+         ol->grid_start[OVERLAY_GRID_CELLS] = total;
+
+         if (!(ol->grid_descs = (unsigned*)malloc(
+                     (total ? total : 1) * sizeof(unsigned))))
+         {
+            memset(ol->grid_start, 0, sizeof(ol->grid_start));
+            return;
+         }
+      }
+
+      for (i = 0; i < ol->size; i++)
+      {
+         const struct overlay_desc *desc = &ol->descs[i];
+         /* Slack for the rounding of the hitbox test */
+         float range_x                   = MAX(desc->range_x_hitbox,
+               desc->range_x_mod) + 0.0001f;
+         float range_y                   = MAX(desc->range_y_hitbox,
+               desc->range_y_mod) + 0.0001f;
+         unsigned cx0, cx1, cy0, cy1;
+
+         if (desc->hitbox == OVERLAY_HITBOX_NONE)
+            continue;
+
+         cx0 = input_overlay_grid_cell(desc->x_hitbox - range_x);
+         cx1 = input_overlay_grid_cell(desc->x_hitbox + range_x);
+         cy0 = input_overlay_grid_cell(desc->y_hitbox - range_y);
+         cy1 = input_overlay_grid_cell(desc->y_hitbox + range_y);
+
+         for (y = cy0; y <= cy1; y++)
+            for (x = cx0; x <= cx1; x++)
+            {
+               unsigned cell = y * OVERLAY_GRID_SIZE + x;
+               if (c == 1)
+                  ol->grid_descs[fill[cell]] = (unsigned)i;
+               fill[cell]++;
+            }
+      }
+   }
+}
+
 /**
  * input_overlay_scale:
  * @ol                    : Overlay handle.
@@ -2737,6 +2846,8 @@ static void input_overlay_scale(struct overlay *ol,
 
       input_overlay_desc_init_hitbox(desc);
    }
+
+   input_overlay_build_grid(ol);
 }
 
 static void input_overlay_parse_layout(
@@ -3024,6 +3135,8 @@ void input_overlay_free_overlay(struct overlay *overlay)
    if (overlay->descs)
       free(overlay->descs);
    overlay->descs       = NULL;
+   free(overlay->grid_descs);
+   overlay->grid_descs  = NULL;
    image_texture_free(&overlay->image);
 }
 
@@ -6027,6 +6140,7 @@ void input_driver_poll(void)
    settings_t *settings           = config_get_ptr();
    const input_device_driver_t
       *joypad                     = input_st->primary_joypad;
+   retro_time_t timeline_start    = frame_timeline_begin();
 #ifdef HAVE_MFI
    const input_device_driver_t
       *sec_joypad                 = input_st->secondary_joypad;
@@ -6038,6 +6152,27 @@ void input_driver_poll(void)
    float input_axis_threshold     = settings->floats.input_axis_threshold;
    uint8_t max_users              = (uint8_t)settings->uints.input_max_users;
 
+   latency_test_poll();
+
+   /* States resolved since the last poll are stale now */
+   memset(input_st->state_cache.joypad_valid, 0,
+         sizeof(input_st->state_cache.joypad_valid));
+   memset(input_st->state_cache.analog_valid, 0,
+         sizeof(input_st->state_cache.analog_valid));
+
+#ifdef HAVE_THREADS
+   /* Follows the setting from one poll to the next */
+   if (     joypad
+         && (settings->bools.input_joypad_thread
+            != input_joypad_thread_is_wrapper(joypad)))
+   {
+      input_st->primary_joypad = settings->bools.input_joypad_thread
+         ? input_joypad_thread_wrap(joypad)
+         : input_joypad_thread_unwrap(joypad);
+      joypad                   = input_st->primary_joypad;
+   }
+#endif
+
    if (joypad && joypad->poll)
       joypad->poll();
    if (sec_joypad && sec_joypad->poll)
@@ -6092,6 +6227,7 @@ void input_driver_poll(void)
    {
       for (i = 0; i < max_users; i++)
          input_st->turbo_btns.frame_enable[i] = 0;
+      frame_timeline_end(FRAME_TIMELINE_INPUT_POLL, timeline_start);
       return;
    }
 
@@ -6454,7 +6590,10 @@ void input_driver_poll(void)
 #else
             if (input_st->remote->net_fd[user] < 0)
 #endif
+            {
+               frame_timeline_end(FRAME_TIMELINE_INPUT_POLL, timeline_start);
                return;
+            }
 
             FD_ZERO(&fds);
             FD_SET(input_st->remote->net_fd[user], &fds);
@@ -6483,6 +6622,77 @@ void input_driver_poll(void)
    if (BSV_MOVIE_IS_PLAYBACK_ON())
       bsv_movie_poll(input_st);
 #endif
+   frame_timeline_end(FRAME_TIMELINE_INPUT_POLL, timeline_start);
+}
+
+/* Cores ask for the same buttons several times a frame, and again
+ * on every run-ahead pass, while each ask walks the port's remaps,
+ * turbo and every bound device. The first ask after a poll resolves
+ * the slot; the rest read it back. Turbo only changes state on the
+ * first ask of a frame, so reading back gives what asking again
+ * would have. */
+static int16_t input_state_cached(
+      input_driver_state_t *input_st,
+      settings_t *settings,
+      unsigned port, unsigned device,
+      unsigned idx, unsigned id)
+{
+   int16_t *slot;
+   uint32_t *valid;
+   unsigned bit;
+   input_state_cache_t *cache = &input_st->state_cache;
+   uint64_t frame_count       = video_state_get_ptr()->frame_count;
+
+   if (port >= MAX_USERS)
+      return input_state_internal(input_st, settings,
+            port, device, idx, id);
+
+   if (device == RETRO_DEVICE_JOYPAD)
+   {
+      if (id == RETRO_DEVICE_ID_JOYPAD_MASK)
+         bit = INPUT_STATE_CACHE_JOYPAD_IDS - 1;
+      else if (id <= RETRO_DEVICE_ID_JOYPAD_R3)
+         bit = id;
+      else
+         return input_state_internal(input_st, settings,
+               port, device, idx, id);
+      valid = &cache->joypad_valid[port];
+      slot  = &cache->joypad[port][bit];
+   }
+   else if (device == RETRO_DEVICE_ANALOG)
+   {
+      if (     idx == RETRO_DEVICE_INDEX_ANALOG_BUTTON
+            && id  <= RETRO_DEVICE_ID_JOYPAD_R3)
+         bit = 4 + id;
+      else if (idx <= RETRO_DEVICE_INDEX_ANALOG_RIGHT
+            && id  <= RETRO_DEVICE_ID_ANALOG_Y)
+         bit = idx * 2 + id;
+      else
+         return input_state_internal(input_st, settings,
+               port, device, idx, id);
+      valid = &cache->analog_valid[port];
+      slot  = &cache->analog[port][bit];
+   }
+   else
+      return input_state_internal(input_st, settings,
+            port, device, idx, id);
+
+   /* A core that skips its poll still gets a fresh state per frame */
+   if (cache->frame_count != frame_count)
+   {
+      memset(cache->joypad_valid, 0, sizeof(cache->joypad_valid));
+      memset(cache->analog_valid, 0, sizeof(cache->analog_valid));
+      cache->frame_count = frame_count;
+   }
+
+   if (!(*valid & (1 << bit)))
+   {
+      *slot   = input_state_internal(input_st, settings,
+            port, device, idx, id);
+      *valid |= (1 << bit);
+   }
+
+   return *slot;
 }
 
 int16_t input_driver_state_wrapper(unsigned port, unsigned device,
@@ -6498,7 +6708,7 @@ int16_t input_driver_state_wrapper(unsigned port, unsigned device,
 #endif
 
    /* Read input state */
-   result = input_state_internal(input_st, settings, port, device, idx, id);
+   result = input_state_cached(input_st, settings, port, device, idx, id);
 
    /* Register any analog stick input requests for
     * this 'virtual' (core) port */
@@ -6521,6 +6731,9 @@ int16_t input_driver_state_wrapper(unsigned port, unsigned device,
             result);
 #endif
 
+   if (port == 0 && latency_test_is_running())
+      result |= latency_test_input_state(device, idx, id);
+
 #ifdef HAVE_GAME_AI
    if (settings->bools.game_ai_override_p1 && port == 0)
       result |= game_ai_input(port, device, idx, id, result);
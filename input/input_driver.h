@@ -57,7 +57,7 @@
 #endif
 
 #ifdef HAVE_BSV_MOVIE
-#include "bsv/uint32s_index.h"
+#include "../state_store.h"
 #endif
 
 #if defined(ANDROID)
@@ -121,11 +121,15 @@
                compressed, encoeded, size; and the compressed, encoded data.
                If either the encoding or the compression codec are not supported,
                the checkpoint will be skipped.
+  INDEX: not a frame; ends the frames of a finished recording. The (empty)
+         actions are followed by the index of the replay, see
+         bsv_movie_index_save.
  */
 #define REPLAY_TOKEN_INVALID          '\0'
 #define REPLAY_TOKEN_REGULAR_FRAME     'f'
 #define REPLAY_TOKEN_CHECKPOINT_FRAME  'c'
 #define REPLAY_TOKEN_CHECKPOINT2_FRAME 'C'
+#define REPLAY_TOKEN_INDEX             'I'
 
 /* Which compression codec to use. */
 #define REPLAY_CHECKPOINT2_COMPRESSION_NONE 0
@@ -219,6 +223,16 @@ struct bsv_state
    char movie_start_path[PATH_MAX_LENGTH];
    /* Target frame/position to seek to next iteration. */
    int64_t seek_target_frame, seek_target_pos;
+   /* A segment of a replay export (--replay-range): played from after
+    * the checkpoint frame range_first, or the start if 0, until the end
+    * of checkpoint frame range_last, or the end if 0. Set while the
+    * report path is. */
+   int64_t range_first, range_last;
+   /* Start of checkpoint frame range_last in the file, or -1 */
+   int64_t range_last_pos;
+   uint64_t range_start_frame;
+   uint64_t range_frames;
+   char range_report[PATH_MAX_LENGTH];
 };
 
 /* These data are always little-endian. */
@@ -244,9 +258,56 @@ struct bsv_input_data
 };
 typedef struct bsv_input_data bsv_input_data_t;
 
+/* Frames between two chunk offsets of a replay index */
+#define BSV_MOVIE_INDEX_CHUNK 64
+
+struct bsv_movie_index_entry
+{
+   uint64_t frame;
+   int64_t pos;
+};
+
+/* Where the frames of a replay start, so seeking need not scan */
+struct bsv_movie_index
+{
+   /* Start of every BSV_MOVIE_INDEX_CHUNK'th frame (rbuf) */
+   int64_t *chunks;
+   /* Frames followed by a checkpoint, in file order (rbuf) */
+   struct bsv_movie_index_entry *checkpoints;
+   /* Frames covered, from the first */
+   uint64_t frames;
+};
+
+/* Kept by the background writer of a recording replay */
+struct bsv_movie_write_stats
+{
+   uint64_t usec;
+   uint32_t writes;
+   uint32_t max_usec;
+   /* Times the frame waited for the writer to take a full buffer */
+   uint32_t stalls;
+   /* Bytes waiting to be written, now and at most */
+   uint32_t queued;
+   uint32_t max_queued;
+};
+
 struct bsv_movie
 {
    intfstream_t *file;
+   /* Writes a recording in the background, or NULL to write in place;
+    * see bsv_movie_sync before using 'file' directly */
+   struct bsv_movie_writer *writer;
+   struct bsv_movie_write_stats write_stats;
+
+   /* Covers every frame once 'index_ready'; recordings keep it as they
+    * go, playback loads it from the file or builds it in a task */
+   struct bsv_movie_index index;
+   /* Start of the index at the end of the file played back, or 0 */
+   int64_t index_pos;
+   /* frame_pos entries below this are not filled in yet, after a seek
+    * jumped over them */
+   uint64_t frame_pos_floor;
+   bool index_ready;
    int64_t identifier;
    uint32_t version;
    size_t min_file_pos;
@@ -271,10 +332,14 @@ struct bsv_movie
 
 #ifdef HAVE_STATESTREAM
    /* Block index and superblock index for incremental checkpoints */
-   uint32s_index_t *superblocks;
-   uint32s_index_t *blocks;
+   state_store_t store;
    uint32_t *superblock_seq;
    uint8_t commit_interval, commit_threshold;
+   /* Encoder and decoder totals for this movie; the store keeps the
+    * rest */
+   uint64_t checkpoint_bytes;
+   uint64_t decode_usec;
+   uint32_t decodes;
 #endif
 
    uint8_t checkpoint_compression, checkpoint_encoding;
@@ -627,6 +692,7 @@ typedef struct
 
    input_mapper_t mapper;          /* uint32_t alignment */
    input_remap_cache_t remapping_cache;
+   input_state_cache_t state_cache;            /* uint64_t alignment */
    input_device_info_t input_device_info[MAX_INPUT_DEVICES]; /* unsigned alignment */
    input_mouse_info_t input_mouse_info[MAX_INPUT_DEVICES];
    unsigned osk_last_codepoint;
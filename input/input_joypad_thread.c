@@ -0,0 +1,556 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <retro_miscellaneous.h>
+#include <retro_timers.h>
+#include <rthreads/rthreads.h>
+#include <queues/task_queue.h>
+#include <features/features_cpu.h>
+#include <string/stdstring.h>
+
+#include "input_joypad_thread.h"
+#include "input_driver.h"
+
+#include "../verbosity.h"
+
+#define JOYPAD_THREAD_BUTTONS     64
+#define JOYPAD_THREAD_HATS        4
+#define JOYPAD_THREAD_AXES        32
+/* Time between two polls of the driver */
+#define JOYPAD_THREAD_INTERVAL_MS 1
+
+/* Slot of 'latest' that holds a sample the reader has not taken */
+#define JOYPAD_THREAD_SLOT_MASK   3
+#define JOYPAD_THREAD_FRESH       4
+
+#if defined(__clang__) || (defined(__GNUC__) \
+         && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+#define JOYPAD_THREAD_ATOMICS
+#endif
+
+struct joypad_thread_pad
+{
+   uint64_t buttons;
+   int16_t axis_pos[JOYPAD_THREAD_AXES];
+   int16_t axis_neg[JOYPAD_THREAD_AXES];
+   /* Up, down, left, right, four bits per hat */
+   uint16_t hats;
+   bool connected;
+};
+
+struct joypad_thread_sample
+{
+   struct joypad_thread_pad pads[MAX_USERS];
+   /* When each pad last changed, and a count of its changes */
+   retro_time_t changed[MAX_USERS];
+   uint32_t serial[MAX_USERS];
+};
+
+typedef struct joypad_thread
+{
+   /* Triple buffer: the thread fills 'back' while the reader reads
+    * 'front', and the two trade through 'latest' */
+   struct joypad_thread_sample slots[3];
+   /* The newest sample, kept whole by the thread */
+   struct joypad_thread_sample last;
+   const input_device_driver_t *joypad;
+   /* Refused by input_joypad_thread_wrap(), not asked again */
+   const input_device_driver_t *refused;
+   sthread_t *thread;
+   /* Held around every call into the wrapped driver */
+   slock_t *lock;
+#ifndef JOYPAD_THREAD_ATOMICS
+   slock_t *swap_lock;
+#endif
+   retro_time_t start_time;
+   /* Change to pick-up delays, for the log on unwrap */
+   retro_time_t delay_usec;
+   uint32_t read_serial[MAX_USERS];
+   unsigned changes_read;
+   unsigned polls;
+   unsigned latest;
+   unsigned back;
+   unsigned front;
+   bool stop;
+} joypad_thread_t;
+
+static joypad_thread_t joypad_thread_st;
+static input_device_driver_t joypad_thread_driver;
+
+static void joypad_thread_sample_pad(const input_device_driver_t *joypad,
+      unsigned port, struct joypad_thread_pad *pad)
+{
+   unsigned i;
+
+   memset(pad, 0, sizeof(*pad));
+
+   if (!joypad->query_pad || !joypad->query_pad(port))
+      return;
+
+   pad->connected = true;
+
+   for (i = 0; i < JOYPAD_THREAD_BUTTONS; i++)
+      if (joypad->button(port, (uint16_t)i))
+         pad->buttons |= (uint64_t)1 << i;
+
+   for (i = 0; i < JOYPAD_THREAD_HATS; i++)
+   {
+      if (joypad->button(port, (uint16_t)HAT_MAP(i, HAT_UP_MASK)))
+         pad->hats |= 1 << (i * 4);
+      if (joypad->button(port, (uint16_t)HAT_MAP(i, HAT_DOWN_MASK)))
+         pad->hats |= 1 << (i * 4 + 1);
+      if (joypad->button(port, (uint16_t)HAT_MAP(i, HAT_LEFT_MASK)))
+         pad->hats |= 1 << (i * 4 + 2);
+      if (joypad->button(port, (uint16_t)HAT_MAP(i, HAT_RIGHT_MASK)))
+         pad->hats |= 1 << (i * 4 + 3);
+   }
+
+   if (joypad->axis)
+   {
+      for (i = 0; i < JOYPAD_THREAD_AXES; i++)
+      {
+         pad->axis_pos[i] = joypad->axis(port, AXIS_POS(i));
+         pad->axis_neg[i] = joypad->axis(port, AXIS_NEG(i));
+      }
+   }
+}
+
+/* Polls the driver and folds the pads into 'last'.
+ * Returns true if any pad changed. Call with 'lock' held. */
+static bool joypad_thread_sample(joypad_thread_t *th)
+{
+   unsigned port;
+   struct joypad_thread_pad pad;
+   bool changed     = false;
+   retro_time_t now;
+
+   th->joypad->poll();
+   th->polls++;
+   now = cpu_features_get_time_usec();
+
+   for (port = 0; port < MAX_USERS; port++)
+   {
+      joypad_thread_sample_pad(th->joypad, port, &pad);
+      if (!memcmp(&pad, &th->last.pads[port], sizeof(pad)))
+         continue;
+      memcpy(&th->last.pads[port], &pad, sizeof(pad));
+      th->last.changed[port] = now;
+      th->last.serial[port]++;
+      changed                = true;
+   }
+
+   return changed;
+}
+
+static void joypad_thread_publish(joypad_thread_t *th)
+{
+   unsigned prev;
+
+   memcpy(&th->slots[th->back], &th->last, sizeof(th->last));
+#ifdef JOYPAD_THREAD_ATOMICS
+   prev     = __atomic_exchange_n(&th->latest,
+         th->back | JOYPAD_THREAD_FRESH, __ATOMIC_ACQ_REL);
+#else
+   slock_lock(th->swap_lock);
+   prev       = th->latest;
+   th->latest = th->back | JOYPAD_THREAD_FRESH;
+   slock_unlock(th->swap_lock);
+#endif
+   th->back = prev & JOYPAD_THREAD_SLOT_MASK;
+}
+
+/* Takes the newest published sample as 'front'.
+ * Returns false if there was none since the last call. */
+static bool joypad_thread_take(joypad_thread_t *th)
+{
+   unsigned prev;
+
+#ifdef JOYPAD_THREAD_ATOMICS
+   if (!(__atomic_load_n(&th->latest, __ATOMIC_RELAXED)
+            & JOYPAD_THREAD_FRESH))
+      return false;
+   prev = __atomic_exchange_n(&th->latest, th->front, __ATOMIC_ACQ_REL);
+#else
+   slock_lock(th->swap_lock);
+   prev = th->latest;
+   if (prev & JOYPAD_THREAD_FRESH)
+      th->latest = th->front;
+   slock_unlock(th->swap_lock);
+   if (!(prev & JOYPAD_THREAD_FRESH))
+      return false;
+#endif
+   th->front = prev & JOYPAD_THREAD_SLOT_MASK;
+   return true;
+}
+
+static void joypad_thread_loop(void *data)
+{
+   joypad_thread_t *th = (joypad_thread_t*)data;
+
+   sthread_role_register("input");
+
+   for (;;)
+   {
+      bool changed;
+
+      slock_lock(th->lock);
+      if (th->stop)
+      {
+         slock_unlock(th->lock);
+         break;
+      }
+      changed = joypad_thread_sample(th);
+      slock_unlock(th->lock);
+
+      if (changed)
+         joypad_thread_publish(th);
+
+      retro_sleep(JOYPAD_THREAD_INTERVAL_MS);
+   }
+
+   sthread_role_unregister();
+}
+
+static const struct joypad_thread_pad *joypad_thread_pad(unsigned port)
+{
+   joypad_thread_t *th = &joypad_thread_st;
+   if (port >= MAX_USERS)
+      return NULL;
+   return &th->slots[th->front].pads[port];
+}
+
+static void *joypad_thread_init(void *data)
+{
+   /* The wrapper is only made from an initialised driver */
+   return NULL;
+}
+
+static bool joypad_thread_query_pad(unsigned port)
+{
+   const struct joypad_thread_pad *pad = joypad_thread_pad(port);
+   return pad && pad->connected;
+}
+
+static void joypad_thread_destroy(void)
+{
+   const input_device_driver_t *joypad =
+      input_joypad_thread_unwrap(&joypad_thread_driver);
+   if (joypad && joypad != &joypad_thread_driver && joypad->destroy)
+      joypad->destroy();
+}
+
+static int32_t joypad_thread_button(unsigned port, uint16_t joykey)
+{
+   unsigned hat_dir;
+   const struct joypad_thread_pad *pad = joypad_thread_pad(port);
+
+   if (!pad)
+      return 0;
+
+   if ((hat_dir = GET_HAT_DIR(joykey)))
+   {
+      unsigned h = GET_HAT(joykey);
+      if (h >= JOYPAD_THREAD_HATS)
+         return 0;
+      switch (hat_dir)
+      {
+         case HAT_UP_MASK:
+            return (pad->hats >> (h * 4)) & 1;
+         case HAT_DOWN_MASK:
+            return (pad->hats >> (h * 4 + 1)) & 1;
+         case HAT_LEFT_MASK:
+            return (pad->hats >> (h * 4 + 2)) & 1;
+         case HAT_RIGHT_MASK:
+            return (pad->hats >> (h * 4 + 3)) & 1;
+         default:
+            break;
+      }
+      return 0;
+   }
+
+   return (joykey < JOYPAD_THREAD_BUTTONS)
+      && (pad->buttons & ((uint64_t)1 << joykey));
+}
+
+static int16_t joypad_thread_axis(unsigned port, uint32_t joyaxis)
+{
+   const struct joypad_thread_pad *pad = joypad_thread_pad(port);
+
+   if (!pad)
+      return 0;
+   if (AXIS_NEG_GET(joyaxis) < JOYPAD_THREAD_AXES)
+      return pad->axis_neg[AXIS_NEG_GET(joyaxis)];
+   if (AXIS_POS_GET(joyaxis) < JOYPAD_THREAD_AXES)
+      return pad->axis_pos[AXIS_POS_GET(joyaxis)];
+   return 0;
+}
+
+static int16_t joypad_thread_state(
+      rarch_joypad_info_t *joypad_info,
+      const struct retro_keybind *binds,
+      unsigned port)
+{
+   int i;
+   int16_t ret      = 0;
+   uint16_t port_idx = joypad_info->joy_idx;
+
+   if (port_idx >= MAX_USERS)
+      return 0;
+
+   for (i = 0; i < RARCH_FIRST_CUSTOM_BIND; i++)
+   {
+      /* Auto-binds are per joypad, not per user. */
+      const uint64_t joykey  = (binds[i].joykey != NO_BTN)
+         ? binds[i].joykey  : joypad_info->auto_binds[i].joykey;
+      const uint32_t joyaxis = (binds[i].joyaxis != AXIS_NONE)
+         ? binds[i].joyaxis : joypad_info->auto_binds[i].joyaxis;
+      if (
+            (uint16_t)joykey != NO_BTN
+            && joypad_thread_button(port_idx, (uint16_t)joykey)
+         )
+         ret |= (1 << i);
+      else if (joyaxis != AXIS_NONE &&
+            ((float)abs(joypad_thread_axis(port_idx, joyaxis))
+             / 0x8000) > joypad_info->axis_threshold)
+         ret |= (1 << i);
+   }
+
+   return ret;
+}
+
+static void joypad_thread_get_buttons(unsigned port, input_bits_t *state)
+{
+   const struct joypad_thread_pad *pad = joypad_thread_pad(port);
+
+   if (pad)
+   {
+      BITS_COPY64_PTR(state, pad->buttons);
+   }
+   else
+      BIT256_CLEAR_ALL_PTR(state);
+}
+
+static void joypad_thread_poll(void)
+{
+   unsigned port;
+   retro_time_t now;
+   const struct joypad_thread_sample *sample;
+   joypad_thread_t *th = &joypad_thread_st;
+
+   if (!joypad_thread_take(th))
+      return;
+
+   now    = cpu_features_get_time_usec();
+   sample = &th->slots[th->front];
+
+   for (port = 0; port < MAX_USERS; port++)
+   {
+      if (sample->serial[port] == th->read_serial[port])
+         continue;
+      th->read_serial[port] = sample->serial[port];
+      th->delay_usec       += now - sample->changed[port];
+      th->changes_read++;
+   }
+}
+
+static bool joypad_thread_set_rumble(unsigned port,
+      enum retro_rumble_effect effect, uint16_t strength)
+{
+   bool ret            = false;
+   joypad_thread_t *th = &joypad_thread_st;
+
+   slock_lock(th->lock);
+   if (th->joypad->set_rumble)
+      ret = th->joypad->set_rumble(port, effect, strength);
+   slock_unlock(th->lock);
+   return ret;
+}
+
+static bool joypad_thread_set_rumble_gain(unsigned port, unsigned gain)
+{
+   bool ret            = false;
+   joypad_thread_t *th = &joypad_thread_st;
+
+   slock_lock(th->lock);
+   if (th->joypad->set_rumble_gain)
+      ret = th->joypad->set_rumble_gain(port, gain);
+   slock_unlock(th->lock);
+   return ret;
+}
+
+static bool joypad_thread_set_sensor_state(unsigned port,
+      enum retro_sensor_action action, unsigned rate)
+{
+   bool ret            = false;
+   joypad_thread_t *th = &joypad_thread_st;
+
+   slock_lock(th->lock);
+   if (th->joypad->set_sensor_state)
+      ret = th->joypad->set_sensor_state(port, action, rate);
+   slock_unlock(th->lock);
+   return ret;
+}
+
+static bool joypad_thread_get_sensor_input(unsigned port,
+      unsigned id, float *value)
+{
+   bool ret            = false;
+   joypad_thread_t *th = &joypad_thread_st;
+
+   slock_lock(th->lock);
+   if (th->joypad->get_sensor_input)
+      ret = th->joypad->get_sensor_input(port, id, value);
+   slock_unlock(th->lock);
+   return ret;
+}
+
+static const char *joypad_thread_name(unsigned port)
+{
+   const char *ret     = NULL;
+   joypad_thread_t *th = &joypad_thread_st;
+
+   slock_lock(th->lock);
+   if (th->joypad->name)
+      ret = th->joypad->name(port);
+   slock_unlock(th->lock);
+   return ret;
+}
+
+const input_device_driver_t *input_joypad_thread_wrap(
+      const input_device_driver_t *joypad)
+{
+   unsigned i;
+   joypad_thread_t *th = &joypad_thread_st;
+
+   if (     !joypad
+         || joypad == &joypad_thread_driver
+         || joypad == th->refused
+         || th->joypad)
+      return joypad;
+
+   /* Hotplug pushes autoconfig tasks from the polling thread */
+   if (     !(  string_is_equal(joypad->ident, "udev")
+             || string_is_equal(joypad->ident, "linuxraw")
+             || string_is_equal(joypad->ident, "xinput"))
+         || !joypad->poll
+         || !joypad->button
+         || !task_queue_is_threaded())
+   {
+      RARCH_WARN("[Input] Joypad driver \"%s\" cannot be polled on a thread.\n",
+            joypad->ident);
+      th->refused = joypad;
+      return joypad;
+   }
+
+   memset(th, 0, sizeof(*th));
+   th->joypad = joypad;
+   th->front  = 0;
+   th->latest = 1;
+   th->back   = 2;
+
+   if (!(th->lock = slock_new()))
+      goto error;
+#ifndef JOYPAD_THREAD_ATOMICS
+   if (!(th->swap_lock = slock_new()))
+      goto error;
+#endif
+
+   /* Start every slot from a real sample */
+   joypad_thread_sample(th);
+   for (i = 0; i < 3; i++)
+      memcpy(&th->slots[i], &th->last, sizeof(th->last));
+   memcpy(th->read_serial, th->last.serial, sizeof(th->read_serial));
+
+   joypad_thread_driver.init             = joypad_thread_init;
+   joypad_thread_driver.query_pad        = joypad_thread_query_pad;
+   joypad_thread_driver.destroy          = joypad_thread_destroy;
+   joypad_thread_driver.button           = joypad_thread_button;
+   joypad_thread_driver.state            = joypad_thread_state;
+   joypad_thread_driver.get_buttons      = joypad_thread_get_buttons;
+   joypad_thread_driver.axis             = joypad_thread_axis;
+   joypad_thread_driver.poll             = joypad_thread_poll;
+   joypad_thread_driver.set_rumble       = joypad_thread_set_rumble;
+   joypad_thread_driver.set_rumble_gain  = joypad->set_rumble_gain
+      ? joypad_thread_set_rumble_gain : NULL;
+   joypad_thread_driver.set_sensor_state = joypad_thread_set_sensor_state;
+   joypad_thread_driver.get_sensor_input = joypad_thread_get_sensor_input;
+   joypad_thread_driver.name             = joypad_thread_name;
+   joypad_thread_driver.ident            = joypad->ident;
+
+   th->start_time = cpu_features_get_time_usec();
+   if (!(th->thread = sthread_create_with_priority(
+               joypad_thread_loop, th, 85)))
+      goto error;
+
+   RARCH_LOG("[Input] Polling joypad driver \"%s\" on a thread.\n",
+         joypad->ident);
+   return &joypad_thread_driver;
+
+error:
+   RARCH_ERR("[Input] Failed to start the joypad polling thread.\n");
+   if (th->lock)
+      slock_free(th->lock);
+#ifndef JOYPAD_THREAD_ATOMICS
+   if (th->swap_lock)
+      slock_free(th->swap_lock);
+#endif
+   memset(th, 0, sizeof(*th));
+   th->refused = joypad;
+   return joypad;
+}
+
+const input_device_driver_t *input_joypad_thread_unwrap(
+      const input_device_driver_t *joypad)
+{
+   retro_time_t elapsed;
+   joypad_thread_t *th = &joypad_thread_st;
+
+   if (joypad != &joypad_thread_driver || !th->joypad)
+      return joypad;
+
+   slock_lock(th->lock);
+   th->stop = true;
+   slock_unlock(th->lock);
+   sthread_join(th->thread);
+
+   elapsed = cpu_features_get_time_usec() - th->start_time;
+   if (elapsed > 0 && th->changes_read)
+      RARCH_LOG("[Input] Joypad thread: %.0f polls/s, changes read"
+            " %.2f ms after they were polled on average.\n",
+            th->polls * 1000000.0 / elapsed,
+            th->delay_usec / (th->changes_read * 1000.0));
+
+   slock_free(th->lock);
+#ifndef JOYPAD_THREAD_ATOMICS
+   slock_free(th->swap_lock);
+#endif
+   joypad = th->joypad;
+   memset(th, 0, sizeof(*th));
+   return joypad;
+}
+
+bool input_joypad_thread_is_wrapper(const input_device_driver_t *joypad)
+{
+   return joypad && joypad == &joypad_thread_driver;
+}
+
+void input_joypad_thread_refresh(void)
+{
+   if (joypad_thread_st.joypad)
+      joypad_thread_poll();
+}
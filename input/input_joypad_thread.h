@@ -0,0 +1,62 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __INPUT_JOYPAD_THREAD_H
+#define __INPUT_JOYPAD_THREAD_H
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <libretro.h>
+
+#include "input_defines.h"
+#include "input_types.h"
+
+RETRO_BEGIN_DECLS
+
+/* Wraps a joypad driver so that a thread polls it every millisecond.
+ * The thread samples every connected pad after each poll and, when
+ * one changed, stamps the change and publishes the sample. The
+ * wrapper's poll() picks up the newest sample without a lock, and its
+ * button(), axis() and state() read that sample, so one frame sees one
+ * consistent state however late the frame polls. */
+
+/**
+ * input_joypad_thread_wrap:
+ * @joypad               : an initialised joypad driver
+ *
+ * Starts the polling thread for @joypad. Only drivers that read the
+ * devices themselves (udev, linuxraw, xinput) can be polled off the
+ * main thread; for any other driver, or if the thread cannot start,
+ * @joypad is returned as it is.
+ *
+ * Returns: the driver to use in place of @joypad.
+ **/
+const input_device_driver_t *input_joypad_thread_wrap(
+      const input_device_driver_t *joypad);
+
+/* Stops the thread and hands back the wrapped driver without
+ * destroying it. Returns @joypad if it is not the wrapper. */
+const input_device_driver_t *input_joypad_thread_unwrap(
+      const input_device_driver_t *joypad);
+
+bool input_joypad_thread_is_wrapper(const input_device_driver_t *joypad);
+
+/* Picks up the thread's newest sample between polls, so that a reader
+ * ahead of core_run sees the freshest state. Does nothing while no
+ * driver is wrapped. */
+void input_joypad_thread_refresh(void);
+
+RETRO_END_DECLS
+
+#endif
@@ -35,6 +35,9 @@
 #define CUSTOM_BINDS_U32_COUNT ((RARCH_CUSTOM_BIND_LIST_END - 1) / 32 + 1)
 
 #define OVERLAY_MAX_TOUCH 16
+/* Cells per side of the grid that overlay hitboxes are sorted into */
+#define OVERLAY_GRID_SIZE 8
+#define OVERLAY_GRID_CELLS (OVERLAY_GRID_SIZE * OVERLAY_GRID_SIZE)
 #define OVERLAY_LIGHTGUN_TRIG_MAX_DELAY 15
 
 RETRO_BEGIN_DECLS
@@ -257,6 +260,11 @@ struct overlay
 {
    struct overlay_desc *descs;
    struct texture_image *load_images;
+   /* Indexes of the descs whose hitbox reaches into each grid cell,
+    * in desc order; cell c lists grid_descs[grid_start[c]] up to
+    * grid_descs[grid_start[c + 1]]. NULL until the overlay is scaled. */
+   unsigned *grid_descs;
+   unsigned grid_start[OVERLAY_GRID_CELLS + 1];
 
    struct texture_image image;
 
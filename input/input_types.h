@@ -125,6 +125,23 @@ typedef struct
    bool turbo_allow_dpad;
 } input_remap_cache_t;
 
+/* Slots of input_state_cache_t: the JOYPAD ids, then the mask */
+#define INPUT_STATE_CACHE_JOYPAD_IDS (RETRO_DEVICE_ID_JOYPAD_R3 + 2)
+/* Left X/Y, right X/Y, then one per analog button */
+#define INPUT_STATE_CACHE_ANALOG_IDS (4 + RETRO_DEVICE_ID_JOYPAD_R3 + 1)
+
+/* JOYPAD and ANALOG states as the core sees them, remaps and turbo
+ * applied, kept from their first query until the next poll or frame.
+ * A bit in *_valid marks a slot already resolved. */
+typedef struct
+{
+   uint64_t frame_count;
+   uint32_t joypad_valid[MAX_USERS];
+   uint32_t analog_valid[MAX_USERS];
+   int16_t joypad[MAX_USERS][INPUT_STATE_CACHE_JOYPAD_IDS];
+   int16_t analog[MAX_USERS][INPUT_STATE_CACHE_ANALOG_IDS];
+} input_state_cache_t;
+
 typedef struct input_game_focus_state
 {
    bool enabled;
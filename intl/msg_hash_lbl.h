@@ -406,6 +406,10 @@ MSG_HASH(
    MENU_ENUM_LABEL_REPLAY_CHECKPOINT_DESERIALIZE,
    "replay_checkpoint_deserialize"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_REPLAY_CHECKPOINT_FLUSH,
+   "replay_checkpoint_flush"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_AUTO_OVERRIDES_ENABLE,
    "auto_overrides_enable"
@@ -632,6 +636,10 @@ MSG_HASH(
    MENU_ENUM_LABEL_CHEEVOS_START_ACTIVE,
    "cheevos_start_active"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_CHEEVOS_THREADED,
+   "cheevos_threaded"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_CHEEVOS_CHALLENGE_INDICATORS,
    "cheevos_challenge_indicators"
@@ -868,6 +876,10 @@ MSG_HASH(
    MENU_ENUM_LABEL_CORE_UPDATER_AUTO_BACKUP_HISTORY_SIZE,
    "core_updater_auto_backup_history_size"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_NETWORK_HTTP_CONCURRENT_DOWNLOADS,
+   "network_http_concurrent_downloads"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_CORE_UPDATER_BUILDBOT_URL,
    "core_updater_buildbot_url"
@@ -1608,6 +1620,10 @@ MSG_HASH(
    MENU_ENUM_LABEL_CORE_INFO_CACHE_ENABLE,
    "core_info_cache_enable"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_CONTENT_PATCH_CACHE_ENABLE,
+   "content_patch_cache_enable"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_CORE_INFO_SAVESTATE_BYPASS,
    "core_info_savestate_bypass"
@@ -1638,6 +1654,10 @@ MSG_HASH(
    MENU_ENUM_LABEL_FASTFORWARD_FRAMESKIP,
    "fastforward_frameskip"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_FASTFORWARD_FRAME_BATCH,
+   "fastforward_frame_batch"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_FILE_BROWSER_CORE,
    "file_browser_core"
@@ -1730,10 +1750,38 @@ MSG_HASH(
    MENU_ENUM_LABEL_NETPLAY_GGPO_MAX_INPUT_BITS,
    "netplay_ggpo_max_input_bits"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_NETPLAY_GGPO_INPUT_FEC,
+   "netplay_ggpo_input_fec"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_NETPLAY_GGPO_DRIFT_CORRECTION,
+   "netplay_ggpo_drift_correction"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_NETPLAY_GGPO_PREDICTION_FRAMES,
    "netplay_ggpo_prediction_frames"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_NETPLAY_GGPO_KEYFRAME_INTERVAL,
+   "netplay_ggpo_keyframe_interval"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_NETPLAY_GGPO_CHECKSUM_INTERVAL,
+   "netplay_ggpo_checksum_interval"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_NETPLAY_GGPO_REPLAY_CROSSFADE,
+   "netplay_ggpo_replay_crossfade"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_NETPLAY_GGPO_AUDIO_SPLICE_FRAMES,
+   "netplay_ggpo_audio_splice_frames"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_NETPLAY_GGPO_NETWORK_THREAD,
+   "netplay_ggpo_network_thread"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_NETPLAY_GGPO_NETWORK_DELAY,
    "netplay_ggpo_network_delay"
@@ -2194,6 +2242,10 @@ MSG_HASH(
    MENU_ENUM_LABEL_INPUT_POLL_TYPE_BEHAVIOR,
    "input_poll_type_behavior"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_INPUT_JOYPAD_THREAD,
+   "input_joypad_thread"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_INPUT_PREFER_FRONT_TOUCH,
    "input_prefer_front_touch"
@@ -2950,6 +3002,10 @@ MSG_HASH(
    MENU_ENUM_LABEL_PERFCNT_ENABLE,
    "perfcnt_enable"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_FRAME_TIMELINE_ENABLE,
+   "frame_timeline_enable"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_PLAYLISTS_TAB,
    "playlists_tab"
@@ -3030,6 +3086,10 @@ MSG_HASH(
    MENU_ENUM_LABEL_PLAYLIST_MANAGER_CLEAN_PLAYLIST,
    "playlist_manager_clean_playlist"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_PLAYLIST_MANAGER_BUILD_THUMBNAIL_PACK,
+   "playlist_manager_build_thumbnail_pack"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_PLAYLIST_MANAGER_REFRESH_PLAYLIST,
    "playlist_manager_refresh_playlist"
@@ -3496,6 +3556,10 @@ MSG_HASH(
    MENU_ENUM_LABEL_REWIND_BUFFER_SIZE_STEP,
    "rewind_buffer_size_step"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_REWIND_DISK_BUFFER_SIZE,
+   "rewind_disk_buffer_size"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_REWIND_SETTINGS,
    "rewind_settings"
@@ -3854,6 +3918,18 @@ MSG_HASH(
    MENU_ENUM_LABEL_RUN_AHEAD_HIDE_WARNINGS,
    "run_ahead_hide_warnings"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_RUN_AHEAD_SECONDARY_THREAD,
+   "run_ahead_secondary_thread"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_INPUT_PREDICTOR,
+   "input_predictor"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_LATENCY_TEST,
+   "latency_test"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_RUN_AHEAD_FRAMES,
    "run_ahead_frames"
@@ -3983,6 +4059,10 @@ MSG_HASH(
    MENU_ENUM_LABEL_THREADED_DATA_RUNLOOP_ENABLE,
    "threaded_data_runloop_enable"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_THREADED_DATA_RUNLOOP_WORKERS,
+   "threaded_data_runloop_workers"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_THUMBNAILS,
    "thumbnails"
@@ -4504,6 +4584,10 @@ MSG_HASH(
    MENU_ENUM_LABEL_VIDEO_HARD_SYNC_FRAMES,
    "video_hard_sync_frames"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VIDEO_KMS_DIRECT_SCANOUT,
+   "video_kms_direct_scanout"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_VIDEO_MAX_SWAPCHAIN_IMAGES,
    "video_max_swapchain_images"
@@ -4642,6 +4726,10 @@ MSG_HASH(
    MENU_ENUM_LABEL_VIDEO_SHADER_REMEMBER_LAST_DIR,
    "video_shader_remember_last_dir"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VIDEO_SHADER_CACHE_ENABLE,
+   "video_shader_cache_enable"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_SHADER_APPLY_CHANGES,
    "shader_apply_changes"
@@ -6570,6 +6658,10 @@ MSG_HASH(
    MENU_ENUM_LABEL_DRIVER_SWITCH_ENABLE,
    "driver_switch_enable"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_CONTENT_SWITCH_SEAMLESS,
+   "content_switch_seamless"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_AI_SERVICE_PAUSE,
    "ai_service_pause"
@@ -2849,6 +2849,14 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_VIDEO_HARD_SYNC_FRAMES,
    "Set how many frames the CPU can run ahead of the GPU when using 'Hard GPU Sync'."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_VIDEO_KMS_DIRECT_SCANOUT,
+   "KMS Direct Scanout"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_VIDEO_KMS_DIRECT_SCANOUT,
+   "Show software-rendered frames directly on a display plane, scaled by the display controller, while no shader, overlay, menu or message is drawn. Saves a GPU pass and a frame of queueing."
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_HELP_VIDEO_HARD_SYNC_FRAMES,
    "Sets how many frames CPU can run ahead of GPU when using 'GPU Hard Sync'. Maximum is 3.\n 0: Sync to GPU immediately.\n 1: Sync to previous frame.\n 2: Etc ..."
@@ -3371,6 +3379,14 @@ MSG_HASH(
    MENU_ENUM_LABEL_HELP_INPUT_POLL_TYPE_BEHAVIOR,
    "Influences how input polling is done inside RetroArch.\nEarly - Input polling is performed before the frame is processed.\nNormal - Input polling is performed when polling is requested.\nLate - Input polling is performed on first input state request per frame.\nSetting it to 'Early' or 'Late' can result in less latency, depending on your configuration. Will be ignored when using netplay."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_INPUT_JOYPAD_THREAD,
+   "Threaded Joypad Polling"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_INPUT_JOYPAD_THREAD,
+   "Poll controllers every millisecond on a dedicated thread, so each frame reads the latest state instead of one polled a frame earlier. Supported by the 'udev', 'linuxraw' and 'xinput' joypad drivers."
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_VALUE_INPUT_REMAP_BINDS_ENABLE,
    "Remap Controls for This Core"
@@ -4634,6 +4650,38 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_RUN_AHEAD_HIDE_WARNINGS,
    "Hide the warning message that appears when using Run-Ahead and the core does not support save states."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_RUN_AHEAD_SECONDARY_THREAD,
+   "Threaded Second Instance"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_RUN_AHEAD_SECONDARY_THREAD,
+   "While input is held, run the second instance on its own thread alongside the main core. Only software-rendered cores are supported."
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_INPUT_PREDICTOR,
+   "Input Prediction"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_INPUT_PREDICTOR,
+   "How Run-Ahead and netplay rollback guess input for frames not yet played. 'Button Hold' expects buttons to be held or released for as long as they usually are, which suits mashing and steady taps."
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_INPUT_PREDICTOR_REPEAT,
+   "Repeat Last"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_INPUT_PREDICTOR_HOLD,
+   "Button Hold"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_LATENCY_TEST,
+   "Measure Input Latency"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_LATENCY_TEST,
+   "Once the menu is closed, press RetroPad A on port 1 repeatedly and time how long each press takes to show on screen with the current settings. Needs content that holds a still screen and reacts at once, such as the net-retropad core."
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_VALUE_PREEMPT_FRAMES,
    "Number of Preemptive Frames"
@@ -4661,6 +4709,14 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_DRIVER_SWITCH_ENABLE,
    "Allow cores to switch to a different video driver than the one currently loaded."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_CONTENT_SWITCH_SEAMLESS,
+   "Seamless Content Switching"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_CONTENT_SWITCH_SEAMLESS,
+   "Read the core and content of the highlighted playlist entry ahead of time, and keep the video and audio drivers running when the next core draws the same way as the last. Cores with hardware rendering always restart the drivers."
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_VALUE_DUMMY_ON_CORE_SHUTDOWN,
    "Load Dummy on Core Shutdown"
@@ -4705,6 +4761,14 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_CORE_INFO_CACHE_ENABLE,
    "Maintain a persistent local cache of installed core information. Greatly reduces loading times on platforms with slow disk access."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_CONTENT_PATCH_CACHE_ENABLE,
+   "Cache Soft-Patched Content"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_CONTENT_PATCH_CACHE_ENABLE,
+   "Keep content patched with IPS, BPS, UPS or xdelta files in the cache directory. Later loads with the same content and patches skip patching."
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_VALUE_CORE_INFO_SAVESTATE_BYPASS,
    "Bypass Core Info Save States Features"
@@ -4929,6 +4993,14 @@ MSG_HASH(
    MENU_ENUM_LABEL_HELP_REPLAY_CHECKPOINT_DESERIALIZE,
    "Whether to deserialize checkpoints stored in replays during regular playback. Should be set to true for most cores, but some may exhibit janky behavior when deserializing content."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_REPLAY_CHECKPOINT_FLUSH,
+   "Flush Replay at Checkpoints"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_REPLAY_CHECKPOINT_FLUSH,
+   "Flush the replay file being recorded every time a checkpoint is written. Replays are written in the background; this bounds how much a crash can lose, at the cost of more disk activity."
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_VALUE_SAVESTATE_AUTO_INDEX,
    "Increment Save State Index Automatically"
@@ -5128,6 +5200,14 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_PERFCNT_ENABLE,
    "Performance counters for RetroArch and cores. Counter data can help determine system bottlenecks and fine-tune performance."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_FRAME_TIMELINE_ENABLE,
+   "Frame Timeline"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_FRAME_TIMELINE_ENABLE,
+   "Record how long input polling, the core and the video driver take each frame, and add the averages to the statistics. When content is closed, the last few seconds are written to 'frame_timeline.json' in the log directory, a trace chrome://tracing and Perfetto can open."
+   )
 
 /* Settings > File Browser */
 
@@ -5218,6 +5298,14 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_FASTFORWARD_FRAMESKIP,
    "Skip frames according to fast-forward rate. This conserves power and allows the use of third party frame limiting."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_FASTFORWARD_FRAME_BATCH,
+   "Fast-Forward Frame Batching"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_FASTFORWARD_FRAME_BATCH,
+   "Run the core several times per display refresh when fast-forwarding, without presenting or mixing the frames in between. Reaches higher speeds on slow devices. Not used with netplay, run-ahead or replays."
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_VALUE_SLOWMOTION_RATIO,
    "Slow-Motion Rate"
@@ -5269,6 +5357,14 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_REWIND_BUFFER_SIZE_STEP,
    "Each time the rewind buffer size value is increased or decreased, it will change by this amount."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_REWIND_DISK_BUFFER_SIZE,
+   "Rewind Disk Buffer Size (MB)"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_REWIND_DISK_BUFFER_SIZE,
+   "The amount of disk space (in MB) in the cache directory to keep older rewind history in once the rewind buffer is full. 0 disables it."
+   )
 
 /* Settings > Frame Throttle > Frame Time Counter */
 
@@ -6374,6 +6470,14 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_THREADED_DATA_RUNLOOP_ENABLE,
    "Perform tasks on a separate thread."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_THREADED_DATA_RUNLOOP_WORKERS,
+   "Task Workers"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_THREADED_DATA_RUNLOOP_WORKERS,
+   "Threads running scans, downloads and other long tasks side by side. Savestates and image loads keep a thread of their own. 0 uses two fewer than the CPU has cores. Takes effect after a restart."
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_VALUE_MENU_SCREENSAVER_TIMEOUT,
    "Menu Screensaver Timeout"
@@ -7450,6 +7554,14 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_CHEEVOS_START_ACTIVE,
    "Start the session with all achievements active (even the ones previously unlocked)."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_CHEEVOS_THREADED,
+   "Threaded Achievement Processing"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_CHEEVOS_THREADED,
+   "Test achievements on a separate thread against a copy of the game's memory, while the next frame runs. Unlocks and trackers show one frame later. Games with large memory are still tested on the main thread."
+   )
 
 /* Settings > Achievements > Appearance */
 
@@ -7763,6 +7875,22 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_NETPLAY_GGPO_MAX_INPUT_BITS,
    "Cap packed input bits per packet (0 uses default)."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_NETPLAY_GGPO_INPUT_FEC,
+   "GGPO Input Redundancy"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_NETPLAY_GGPO_INPUT_FEC,
+   "Resend each GGPO input packet 1 or 2 extra times a few ms apart to ride out packet loss. 3 picks the count from the loss the peer reports."
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_NETPLAY_GGPO_DRIFT_CORRECTION,
+   "GGPO Drift Correction"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_NETPLAY_GGPO_DRIFT_CORRECTION,
+   "Percent the player who is ahead runs slower to let the other catch up, spread out over many frames. 0 uses the original whole-frame stalls, which show as a hitch."
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_VALUE_NETPLAY_GGPO_PREDICTION_FRAMES,
    "GGPO Prediction Frames"
@@ -7771,6 +7899,46 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_NETPLAY_GGPO_PREDICTION_FRAMES,
    "Override prediction window (0 uses default)."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_NETPLAY_GGPO_KEYFRAME_INTERVAL,
+   "GGPO Keyframe Interval"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_NETPLAY_GGPO_KEYFRAME_INTERVAL,
+   "Frames between full saved states; 1 stores every frame in full (0 uses default)."
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_NETPLAY_GGPO_CHECKSUM_INTERVAL,
+   "GGPO Checksum Interval"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_NETPLAY_GGPO_CHECKSUM_INTERVAL,
+   "Frames between saved state checksums; 1 checks every frame (0 disables)."
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_NETPLAY_GGPO_REPLAY_CROSSFADE,
+   "GGPO Rollback Audio Crossfade"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_NETPLAY_GGPO_REPLAY_CROSSFADE,
+   "Fade the first samples after a rollback in from the last sample played, instead of jumping straight to the corrected audio."
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_NETPLAY_GGPO_AUDIO_SPLICE_FRAMES,
+   "GGPO Rollback Audio Splice (Frames)"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_NETPLAY_GGPO_AUDIO_SPLICE_FRAMES,
+   "Hold back this many frames of audio so that a rollback can replace them with the corrected audio, crossfaded in. Adds as many frames of audio latency (0 disables)."
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_NETPLAY_GGPO_NETWORK_THREAD,
+   "GGPO Network Thread"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_NETPLAY_GGPO_NETWORK_THREAD,
+   "Receive, acknowledge and resend GGPO packets on a dedicated thread so slow frames do not delay network traffic. Takes effect on the next session."
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_VALUE_NETPLAY_GGPO_NETWORK_DELAY,
    "GGPO Network Delay (ms)"
@@ -7949,7 +8117,7 @@ MSG_HASH(
    )
 MSG_HASH(
    MENU_ENUM_LABEL_HELP_NETPLAY_INPUT_LATENCY_FRAMES_RANGE,
-   "The range of frames of input latency that may be used by netplay to hide network latency.\nIf set, netplay will adjust the number of frames of input latency dynamically to balance CPU time, input latency and network latency. This reduces jitter and makes netplay less CPU-intensive, but at the price of unpredictable input lag."
+   "The range of frames of input latency that may be used by netplay to hide network latency.\nIf set, netplay will adjust the number of frames of input latency dynamically to balance CPU time, input latency and network latency. This reduces jitter and makes netplay less CPU-intensive, but at the price of unpredictable input lag.\nIn GGPO sessions both players agree on each change, a frame at a time, as ping, jitter and rollbacks call for it."
    )
 MSG_HASH(
    MENU_ENUM_LABEL_VALUE_NETPLAY_NAT_TRAVERSAL,
@@ -8066,6 +8234,14 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_CORE_UPDATER_AUTO_BACKUP_HISTORY_SIZE,
    "Specify how many automatically generated backups to keep for each installed core. When this limit is reached, creating a new backup via an online update will delete the oldest backup. Manual core backups are unaffected by this setting."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_NETWORK_HTTP_CONCURRENT_DOWNLOADS,
+   "Concurrent Downloads"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_NETWORK_HTTP_CONCURRENT_DOWNLOADS,
+   "Number of downloads that can make progress at the same time. Requires the threaded data runloop."
+   )
 
 /* Settings > Playlists */
 
@@ -8360,6 +8536,14 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_PLAYLIST_MANAGER_CLEAN_PLAYLIST,
    "Validate core associations and remove invalid and duplicate entries."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_PLAYLIST_MANAGER_BUILD_THUMBNAIL_PACK,
+   "Build Thumbnail Pack"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_PLAYLIST_MANAGER_BUILD_THUMBNAIL_PACK,
+   "Store the thumbnails of every entry, scaled down and decoded, in one file next to the playlist. Scrolling through large playlists then reads one file instead of searching for images. Build again after adding thumbnails."
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_VALUE_PLAYLIST_MANAGER_REFRESH_PLAYLIST,
    "Refresh Playlist"
@@ -10259,6 +10443,14 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_VIDEO_SHADER_REMEMBER_LAST_DIR,
    "Open File Browser at the last used directory when loading shader presets and passes."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_VIDEO_SHADER_CACHE_ENABLE,
+   "Cache Compiled Shaders"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_VIDEO_SHADER_CACHE_ENABLE,
+   "Keep compiled slang shaders and the Vulkan pipeline cache in the cache directory, so that presets load faster the next time."
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_VALUE_VIDEO_SHADER_PRESET,
    "Load Preset"
@@ -14475,6 +14667,14 @@ MSG_HASH(
    MSG_NETPLAY_PLATFORM_DEPENDENT,
    "This core does not support netplay between different platforms"
    )
+MSG_HASH(
+   MSG_NETPLAY_GGPO_DESYNC,
+   "Netplay peers desynchronized at frame %d."
+   )
+MSG_HASH(
+   MSG_NETPLAY_GGPO_INPUT_LAYOUT_MISMATCH,
+   "Netplay peers pack their input differently. Both need the same core with the same options."
+   )
 MSG_HASH(
    MSG_NETPLAY_ENTER_PASSWORD,
    "Enter netplay server password:"
@@ -14620,6 +14820,18 @@ MSG_HASH(
    MSG_CORE_INSTALL_FAILED,
    "Failed to install core: "
    )
+MSG_HASH(
+   MSG_CHD_VERIFYING,
+   "Verifying CHD: "
+   )
+MSG_HASH(
+   MSG_CHD_VERIFIED,
+   "CHD verified: "
+   )
+MSG_HASH(
+   MSG_CHD_VERIFY_FAILED,
+   "CHD verification failed: "
+   )
 MSG_HASH(
    MSG_SCANNING_CORES,
    "Scanning cores..."
@@ -14664,6 +14876,14 @@ MSG_HASH(
    MSG_PLAYLIST_MANAGER_PLAYLIST_CLEANED,
    "Playlist cleaned: "
    )
+MSG_HASH(
+   MSG_PLAYLIST_MANAGER_BUILDING_THUMBNAIL_PACK,
+   "Building thumbnail pack: "
+   )
+MSG_HASH(
+   MSG_PLAYLIST_MANAGER_THUMBNAIL_PACK_BUILT,
+   "Thumbnail pack built: "
+   )
 MSG_HASH(
    MSG_PLAYLIST_MANAGER_REFRESH_MISSING_CONFIG,
    "Refresh failed - playlist contains no valid scan record: "
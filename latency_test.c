@@ -0,0 +1,233 @@
+/**
+ *  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ *  more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with RetroArch. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <libretro.h>
+#include <encodings/crc32.h>
+#include <features/features_cpu.h>
+
+#include "latency_test.h"
+#include "runloop.h"
+#include "verbosity.h"
+
+/* Core frames to wait for the screen to settle before giving up */
+#define LATENCY_TEST_SETTLE_TIMEOUT 600
+/* Unanswered presses in a row before giving up */
+#define LATENCY_TEST_MAX_TIMEOUTS   3
+
+enum latency_test_state
+{
+   LATENCY_TEST_IDLE = 0,
+   /* Released, waiting for the screen to hold still */
+   LATENCY_TEST_SETTLE,
+   /* Pressed, waiting for the screen to change */
+   LATENCY_TEST_PRESSED
+};
+
+typedef struct latency_test
+{
+   retro_time_t press_time;
+   uint32_t sample_usec[LATENCY_TEST_SAMPLES];
+   uint32_t sample_frames[LATENCY_TEST_SAMPLES];
+   uint32_t last_hash;
+   unsigned samples;
+   /* Core frames since the state was entered */
+   unsigned frames;
+   unsigned still_frames;
+   unsigned timeouts;
+   enum latency_test_state state;
+   /* The core ran since the last presented frame */
+   bool polled;
+   bool changed;
+   bool have_hash;
+} latency_test_t;
+
+static latency_test_t latency_test_st;
+
+static void latency_test_finish(const char *msg)
+{
+   /* TODO/FIXME - localize */
+   RARCH_LOG("[Latency] %s\n", msg);
+   runloop_msg_queue_push(msg, strlen(msg), 1, 300, true, NULL,
+         MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+   latency_test_st.state = LATENCY_TEST_IDLE;
+}
+
+static void latency_test_report(latency_test_t *test)
+{
+   char msg[256];
+   unsigned i, j;
+   uint32_t sorted[LATENCY_TEST_SAMPLES];
+   uint64_t total_usec   = 0;
+   uint32_t total_frames = 0;
+
+   for (i = 0; i < test->samples; i++)
+   {
+      uint32_t usec = test->sample_usec[i];
+      for (j = i; j > 0 && sorted[j - 1] > usec; j--)
+         sorted[j] = sorted[j - 1];
+      sorted[j]     = usec;
+      total_usec   += usec;
+      total_frames += test->sample_frames[i];
+      RARCH_DBG("[Latency] Sample %u: %.2f ms, %u frames.\n",
+            i + 1, usec / 1000.0f, (unsigned)test->sample_frames[i]);
+   }
+
+   /* TODO/FIXME - localize */
+   snprintf(msg, sizeof(msg),
+         "Input to present: %.1f ms median, %.1f ms min, %.1f ms max, "
+         "%.1f ms avg (%.1f frames) over %u presses.",
+         sorted[test->samples / 2] / 1000.0f,
+         sorted[0] / 1000.0f,
+         sorted[test->samples - 1] / 1000.0f,
+         total_usec / (test->samples * 1000.0f),
+         (float)total_frames / test->samples,
+         test->samples);
+   latency_test_finish(msg);
+}
+
+static void latency_test_settle(latency_test_t *test)
+{
+   test->state        = LATENCY_TEST_SETTLE;
+   test->frames       = 0;
+   test->still_frames = 0;
+}
+
+void latency_test_start(void)
+{
+   latency_test_t *test = &latency_test_st;
+
+   memset(test, 0, sizeof(*test));
+   latency_test_settle(test);
+   RARCH_LOG("[Latency] Test started.\n");
+}
+
+void latency_test_stop(void)
+{
+   latency_test_st.state = LATENCY_TEST_IDLE;
+}
+
+bool latency_test_is_running(void)
+{
+   return latency_test_st.state != LATENCY_TEST_IDLE;
+}
+
+void latency_test_poll(void)
+{
+   latency_test_t *test = &latency_test_st;
+
+   if (test->state == LATENCY_TEST_IDLE)
+      return;
+
+   test->polled = true;
+
+   if (     (test->state == LATENCY_TEST_SETTLE)
+         && (test->still_frames >= LATENCY_TEST_SETTLE_FRAMES))
+   {
+      test->state      = LATENCY_TEST_PRESSED;
+      test->frames     = 0;
+      test->press_time = cpu_features_get_time_usec();
+   }
+}
+
+int16_t latency_test_input_state(unsigned device, unsigned idx,
+      unsigned id)
+{
+   if (     (latency_test_st.state != LATENCY_TEST_PRESSED)
+         || ((device & RETRO_DEVICE_MASK) != RETRO_DEVICE_JOYPAD))
+      return 0;
+
+   if (id == RETRO_DEVICE_ID_JOYPAD_MASK)
+      return 1 << RETRO_DEVICE_ID_JOYPAD_A;
+   return (id == RETRO_DEVICE_ID_JOYPAD_A) ? 1 : 0;
+}
+
+void latency_test_frame(const void *data, unsigned width,
+      unsigned height, size_t pitch, unsigned bpp)
+{
+   unsigned y;
+   uint32_t hash        = 0;
+   latency_test_t *test = &latency_test_st;
+
+   if (test->state == LATENCY_TEST_IDLE || !test->polled)
+      return;
+
+   test->changed = false;
+
+   if (data == RETRO_HW_FRAME_BUFFER_VALID)
+   {
+      /* TODO/FIXME - localize */
+      latency_test_finish("Latency test needs a core"
+            " that renders in software.");
+      return;
+   }
+
+   /* A dupe shows the same frame again */
+   if (!data)
+      return;
+
+   for (y = 0; y < height; y++)
+      hash = encoding_crc32(hash, (const uint8_t*)data + y * pitch,
+            width * bpp);
+
+   test->changed   = test->have_hash && (hash != test->last_hash);
+   test->last_hash = hash;
+   test->have_hash = true;
+}
+
+void latency_test_presented(void)
+{
+   latency_test_t *test = &latency_test_st;
+
+   if (test->state == LATENCY_TEST_IDLE || !test->polled)
+      return;
+
+   test->polled = false;
+   test->frames++;
+
+   if (test->state == LATENCY_TEST_SETTLE)
+   {
+      test->still_frames = test->changed ? 0 : test->still_frames + 1;
+      /* TODO/FIXME - localize */
+      if (     (test->still_frames < LATENCY_TEST_SETTLE_FRAMES)
+            && (test->frames >= LATENCY_TEST_SETTLE_TIMEOUT))
+         latency_test_finish("Latency test needs content"
+               " that holds a still screen, such as the net-retropad core.");
+   }
+   else if (test->changed)
+   {
+      test->sample_usec[test->samples]   = (uint32_t)
+         (cpu_features_get_time_usec() - test->press_time);
+      test->sample_frames[test->samples] = test->frames;
+      test->timeouts                     = 0;
+      if (++test->samples >= LATENCY_TEST_SAMPLES)
+         latency_test_report(test);
+      else
+         latency_test_settle(test);
+   }
+   else if (test->frames >= LATENCY_TEST_TIMEOUT_FRAMES)
+   {
+      /* TODO/FIXME - localize */
+      if (++test->timeouts >= LATENCY_TEST_MAX_TIMEOUTS)
+         latency_test_finish("Latency test got no response"
+               " to RetroPad A.");
+      else
+         latency_test_settle(test);
+   }
+}
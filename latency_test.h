@@ -0,0 +1,77 @@
+/**
+ *  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ *  more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with RetroArch. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef __RARCH_LATENCY_TEST_H
+#define __RARCH_LATENCY_TEST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <boolean.h>
+#include <retro_common_api.h>
+
+/* Presses measured per test */
+#define LATENCY_TEST_SAMPLES        20
+/* Core frames the screen has to hold still before the next press */
+#define LATENCY_TEST_SETTLE_FRAMES  8
+/* Core frames a press may go unanswered */
+#define LATENCY_TEST_TIMEOUT_FRAMES 60
+
+RETRO_BEGIN_DECLS
+
+/*
+ * Input-to-present self test. The frontend presses RetroPad A on port 0
+ * once the core's screen holds still, and times how long it takes until
+ * a presented frame differs; then releases and waits for the screen to
+ * settle again. The press starts at the input poll, the response ends
+ * when the video driver's frame() returns, which with vsync and Hard GPU
+ * Sync is close to the present.
+ *
+ * Needs content that draws a static screen and reacts to the button at
+ * once, such as the net-retropad core, and software rendered frames.
+ */
+
+/* Starts a test; it runs while the core does */
+void latency_test_start(void);
+
+void latency_test_stop(void);
+
+bool latency_test_is_running(void);
+
+/* Call from the input poll of every core frame */
+void latency_test_poll(void);
+
+/* What the test adds to the input state of port 0 */
+int16_t latency_test_input_state(unsigned device, unsigned idx,
+      unsigned id);
+
+/**
+ * latency_test_frame:
+ * @data                 : the core's frame, NULL for a dupe or
+ *                         RETRO_HW_FRAME_BUFFER_VALID
+ * @bpp                  : bytes per pixel
+ *
+ * Looks at the core's frame before it goes to the video driver.
+ **/
+void latency_test_frame(const void *data, unsigned width,
+      unsigned height, size_t pitch, unsigned bpp);
+
+/* Call once the video driver's frame() has returned */
+void latency_test_presented(void);
+
+RETRO_END_DECLS
+
+#endif
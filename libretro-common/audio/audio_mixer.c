@@ -31,6 +31,7 @@
 #include <formats/rwav.h>
 #endif
 #include <memalign.h>
+#include <queues/spsc_ring.h>
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -74,6 +75,12 @@
 
 #define AUDIO_MIXER_MAX_VOICES      8
 #define AUDIO_MIXER_TEMP_BUFFER 8192
+/* Decoded blocks a streaming voice keeps ahead of the mixer */
+#define AUDIO_MIXER_STREAM_BLOCKS   4
+/* Samples the mixer takes from a stream's ring at a time */
+#define AUDIO_MIXER_MIX_BLOCK     512
+/* How often the decoder looks for room while a stream plays */
+#define AUDIO_MIXER_DECODE_USEC 10000
 
 struct audio_mixer_sound
 {
@@ -192,19 +199,51 @@ struct audio_mixer_voice
    } types;
    audio_mixer_sound_t *sound;
    audio_mixer_stop_cb_t stop_cb;
+   /* Streaming voices: PCM decoded, resampled and converted to float
+    * ahead of time. The decoder fills it holding 'lock', the mixer
+    * drains it without. */
+   spsc_ring_t ring;
+   /* Most samples one decoded block can add to 'ring' */
+   unsigned block_samples;
+   /* Loops decoded, and loops the mixer has reported */
+   volatile unsigned repeats;
+   unsigned repeats_reported;
    unsigned type;
    float    volume;
    bool     repeat;
+   /* The decoder has reached the end of the stream */
+   bool     eos;
 #ifdef HAVE_THREADS
    slock_t *lock;
 #endif
 };
 
+#ifdef HAVE_THREADS
+struct audio_mixer_decoder
+{
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   bool quit;
+   /* A voice started since the decoder last looked */
+   bool pending;
+};
+#endif
+
 /* TODO/FIXME - static globals */
 static struct audio_mixer_voice s_voices[AUDIO_MIXER_MAX_VOICES] = {0};
 static unsigned s_rate = 0;
+#ifdef HAVE_THREADS
+static struct audio_mixer_decoder s_decoder = {0};
+#endif
 
 static void audio_mixer_release(audio_mixer_voice_t* voice);
+static void audio_mixer_stream_fill(audio_mixer_voice_t* voice, bool once);
+#ifdef HAVE_THREADS
+static void audio_mixer_decoder_start(void);
+static void audio_mixer_decoder_stop(void);
+static void audio_mixer_decoder_wake(void);
+#endif
 
 #ifdef HAVE_RWAV
 static bool wav_to_float(const rwav_t* wav, float** pcm, size_t len)
@@ -336,12 +375,20 @@ void audio_mixer_init(unsigned rate)
          voice->lock = slock_new();
 #endif
    }
+
+#ifdef HAVE_THREADS
+   audio_mixer_decoder_start();
+#endif
 }
 
 void audio_mixer_done(void)
 {
    unsigned i;
 
+#ifdef HAVE_THREADS
+   audio_mixer_decoder_stop();
+#endif
+
    for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
    {
       audio_mixer_voice_t *voice = &s_voices[i];
@@ -600,6 +647,7 @@ static bool audio_mixer_play_ogg(
    voice->types.ogg.resampler_data = resampler_data;
    voice->types.ogg.buffer         = (float*)ogg_buffer;
    voice->types.ogg.buf_samples    = samples;
+   voice->block_samples            = samples + 16;
    voice->types.ogg.ratio          = ratio;
    voice->types.ogg.stream         = stb_vorbis;
    voice->types.ogg.position       = 0;
@@ -681,6 +729,7 @@ static bool audio_mixer_play_mod(
 
    voice->types.mod.buffer         = (int*)mod_buffer;
    voice->types.mod.buf_samples    = buf_samples;
+   voice->block_samples            = buf_samples;
    voice->types.mod.stream         = replay;
    voice->types.mod.position       = 0;
    voice->types.mod.samples        = 0; /* samples; */
@@ -754,6 +803,7 @@ static bool audio_mixer_play_flac(
    voice->types.flac.resampler_data = resampler_data;
    voice->types.flac.buffer         = (float*)flac_buffer;
    voice->types.flac.buf_samples    = samples;
+   voice->block_samples             = samples + 16;
    voice->types.flac.ratio          = ratio;
    voice->types.flac.stream         = dr_flac;
    voice->types.flac.position       = 0;
@@ -829,6 +879,7 @@ static bool audio_mixer_play_mp3(
    voice->types.mp3.resampler_data = resampler_data;
    voice->types.mp3.buffer         = (float*)mp3_buffer;
    voice->types.mp3.buf_samples    = samples;
+   voice->block_samples            = samples + 16;
    voice->types.mp3.ratio          = ratio;
    voice->types.mp3.position       = 0;
    voice->types.mp3.samples        = 0;
@@ -916,13 +967,25 @@ audio_mixer_voice_t* audio_mixer_play(audio_mixer_sound_t* sound,
       break;
    }
 
+   /* Decode the first block here so that the stream starts with the
+    * next mix; the decoder keeps it ahead from there */
+   if (res && voice->block_samples)
+      res = spsc_ring_initialize(&voice->ring, AUDIO_MIXER_STREAM_BLOCKS
+            * voice->block_samples * sizeof(float));
+
    if (res)
    {
       voice->repeat   = repeat;
       voice->volume   = volume;
       voice->sound    = sound;
       voice->stop_cb  = stop_cb;
+      if (voice->block_samples)
+         audio_mixer_stream_fill(voice, true);
       AUDIO_MIXER_UNLOCK(voice);
+#ifdef HAVE_THREADS
+      if (voice->block_samples)
+         audio_mixer_decoder_wake();
+#endif
    }
    else
    {
@@ -969,8 +1032,13 @@ static void audio_mixer_release(audio_mixer_voice_t* voice)
          break;
    }
 
+   spsc_ring_deinitialize(&voice->ring);
    memset(&voice->types, 0, sizeof(voice->types));
-   voice->type = AUDIO_MIXER_TYPE_NONE;
+   voice->block_samples    = 0;
+   voice->repeats          = 0;
+   voice->repeats_reported = 0;
+   voice->eos              = false;
+   voice->type             = AUDIO_MIXER_TYPE_NONE;
 }
 
 void audio_mixer_stop(audio_mixer_voice_t* voice)
@@ -1026,7 +1094,9 @@ again:
       if (voice->stop_cb)
          voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
 
+      AUDIO_MIXER_LOCK(voice);
       audio_mixer_release(voice);
+      AUDIO_MIXER_UNLOCK(voice);
    }
    else
    {
@@ -1037,293 +1107,357 @@ again:
    }
 }
 
-#ifdef HAVE_STB_VORBIS
-static void audio_mixer_mix_ogg(float* buffer, size_t num_frames,
-      audio_mixer_voice_t* voice,
-      float volume)
+/* Resamples 'temp_samples' samples of 'temp_buffer' into 'out' if the
+ * stream needs it, and queues the result on the voice's ring */
+static void audio_mixer_stream_write(audio_mixer_voice_t* voice,
+      const retro_resampler_t *resampler, void *resampler_data,
+      float ratio, const float *temp_buffer, unsigned temp_samples,
+      float *out)
 {
-   int i;
-   float* temp_buffer = NULL;
-   unsigned buf_free                = (unsigned)(num_frames * 2);
-   unsigned temp_samples            = 0;
-   float* pcm                       = NULL;
+   if (resampler)
+   {
+      struct resampler_data info;
+      info.data_in       = temp_buffer;
+      info.data_out      = out;
+      info.input_frames  = temp_samples / 2;
+      info.output_frames = 0;
+      info.ratio         = ratio;
+
+      resampler->process(resampler_data, &info);
+      spsc_ring_write(&voice->ring, out,
+            info.output_frames * 2 * sizeof(float));
+   }
+   else
+      spsc_ring_write(&voice->ring, temp_buffer,
+            temp_samples * sizeof(float));
+}
 
-   if (!voice->types.ogg.stream)
-      return;
+#ifdef HAVE_STB_VORBIS
+static bool audio_mixer_decode_ogg(audio_mixer_voice_t* voice,
+      float *temp_buffer)
+{
+   unsigned temp_samples = stb_vorbis_get_samples_float_interleaved(
+         voice->types.ogg.stream, 2, temp_buffer,
+         AUDIO_MIXER_TEMP_BUFFER) * 2;
 
-   if (voice->types.ogg.position == voice->types.ogg.samples)
+   if (temp_samples == 0 && voice->repeat)
    {
-again:
-      if (temp_buffer == NULL)
-         temp_buffer = (float*)malloc(AUDIO_MIXER_TEMP_BUFFER * sizeof(float));
-
+      stb_vorbis_seek_start(voice->types.ogg.stream);
+      voice->repeats++;
       temp_samples = stb_vorbis_get_samples_float_interleaved(
             voice->types.ogg.stream, 2, temp_buffer,
             AUDIO_MIXER_TEMP_BUFFER) * 2;
+   }
 
-      if (temp_samples == 0)
-      {
-         if (voice->repeat)
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
+   if (temp_samples == 0)
+      return false;
 
-            stb_vorbis_seek_start(voice->types.ogg.stream);
-            goto again;
-         }
+   audio_mixer_stream_write(voice, voice->types.ogg.resampler,
+         voice->types.ogg.resampler_data, voice->types.ogg.ratio,
+         temp_buffer, temp_samples, voice->types.ogg.buffer);
+   return true;
+}
+#endif
 
-         if (voice->stop_cb)
-            voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
+#ifdef HAVE_IBXM
+static bool audio_mixer_decode_mod(audio_mixer_voice_t* voice,
+      float *temp_buffer)
+{
+   unsigned i, j;
+   const int *pcm        = voice->types.mod.buffer;
+   unsigned temp_samples = replay_get_audio(
+         voice->types.mod.stream, voice->types.mod.buffer, 0) * 2;
 
-         audio_mixer_release(voice);
-         goto cleanup;
-      }
+   if (temp_samples == 0 && voice->repeat)
+   {
+      replay_seek(voice->types.mod.stream, 0);
+      voice->repeats++;
+      temp_samples = replay_get_audio(
+            voice->types.mod.stream, voice->types.mod.buffer, 0) * 2;
+   }
+
+   if (temp_samples == 0)
+      return false;
+
+   for (i = 0; i < temp_samples; i += j)
+   {
+      unsigned count = temp_samples - i;
+
+      if (count > AUDIO_MIXER_TEMP_BUFFER)
+         count = AUDIO_MIXER_TEMP_BUFFER;
 
-      if (voice->types.ogg.resampler)
+      for (j = 0; j < count; j++)
       {
-         struct resampler_data info;
-         info.data_in = temp_buffer;
-         info.data_out = voice->types.ogg.buffer;
-         info.input_frames = temp_samples / 2;
-         info.output_frames = 0;
-         info.ratio = voice->types.ogg.ratio;
-
-         voice->types.ogg.resampler->process(
-               voice->types.ogg.resampler_data, &info);
+         float samplef  = ((float)(*pcm++) + 32768.0f) / 65535.0f;
+         temp_buffer[j] = samplef * 2.0f - 1.0f;
       }
-      else
-         memcpy(voice->types.ogg.buffer, temp_buffer,
-               temp_samples * sizeof(float));
 
-      voice->types.ogg.position = 0;
-      voice->types.ogg.samples  = voice->types.ogg.buf_samples;
+      spsc_ring_write(&voice->ring, temp_buffer, count * sizeof(float));
    }
+   return true;
+}
+#endif
 
-   pcm = voice->types.ogg.buffer + voice->types.ogg.position;
+#ifdef HAVE_DR_FLAC
+static bool audio_mixer_decode_flac(audio_mixer_voice_t* voice,
+      float *temp_buffer)
+{
+   unsigned temp_samples = (unsigned)drflac_read_pcm_frames_f32(
+         voice->types.flac.stream, AUDIO_MIXER_TEMP_BUFFER / 2,
+         temp_buffer) * 2;
 
-   if (voice->types.ogg.samples < buf_free)
+   if (temp_samples == 0 && voice->repeat)
    {
-      for (i = voice->types.ogg.samples; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
-
-      buf_free -= voice->types.ogg.samples;
-      goto again;
+      drflac_seek_to_pcm_frame(voice->types.flac.stream, 0);
+      voice->repeats++;
+      temp_samples = (unsigned)drflac_read_pcm_frames_f32(
+            voice->types.flac.stream, AUDIO_MIXER_TEMP_BUFFER / 2,
+            temp_buffer) * 2;
    }
 
-   for (i = buf_free; i != 0; --i )
-      *buffer++ += *pcm++ * volume;
-
-   voice->types.ogg.position += buf_free;
-   voice->types.ogg.samples  -= buf_free;
+   if (temp_samples == 0)
+      return false;
 
-cleanup:
-   if (temp_buffer != NULL)
-      free(temp_buffer);
+   audio_mixer_stream_write(voice, voice->types.flac.resampler,
+         voice->types.flac.resampler_data, voice->types.flac.ratio,
+         temp_buffer, temp_samples, voice->types.flac.buffer);
+   return true;
 }
 #endif
 
-#ifdef HAVE_IBXM
-static void audio_mixer_mix_mod(float* buffer, size_t num_frames,
-      audio_mixer_voice_t* voice,
-      float volume)
+#ifdef HAVE_DR_MP3
+static bool audio_mixer_decode_mp3(audio_mixer_voice_t* voice,
+      float *temp_buffer)
 {
-   int i;
-   float samplef                    = 0.0f;
-   unsigned temp_samples            = 0;
-   unsigned buf_free                = (unsigned)(num_frames * 2);
-   int* pcm                         = NULL;
+   unsigned temp_samples = (unsigned)drmp3_read_f32(
+         &voice->types.mp3.stream,
+         AUDIO_MIXER_TEMP_BUFFER / 2, temp_buffer) * 2;
 
-   if (voice->types.mod.samples == 0)
+   if (temp_samples == 0 && voice->repeat)
    {
-again:
-      temp_samples = replay_get_audio(
-            voice->types.mod.stream, voice->types.mod.buffer, 0 ) * 2;
-
-      if (temp_samples == 0)
-      {
-         if (voice->repeat)
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
-
-            replay_seek( voice->types.mod.stream, 0);
-            goto again;
-         }
+      drmp3_seek_to_frame(&voice->types.mp3.stream, 0);
+      voice->repeats++;
+      temp_samples = (unsigned)drmp3_read_f32(
+            &voice->types.mp3.stream,
+            AUDIO_MIXER_TEMP_BUFFER / 2, temp_buffer) * 2;
+   }
 
-         if (voice->stop_cb)
-            voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
+   if (temp_samples == 0)
+      return false;
 
-         audio_mixer_release(voice);
-         return;
-      }
+   audio_mixer_stream_write(voice, voice->types.mp3.resampler,
+         voice->types.mp3.resampler_data, voice->types.mp3.ratio,
+         temp_buffer, temp_samples, voice->types.mp3.buffer);
+   return true;
+}
+#endif
 
-      voice->types.mod.position = 0;
-      voice->types.mod.samples  = temp_samples;
-   }
-   pcm = voice->types.mod.buffer + voice->types.mod.position;
+/* Decodes blocks of a streaming voice while its ring has room for
+ * one, or just one block if 'once'. Need to hold lock for voice. */
+static void audio_mixer_stream_fill(audio_mixer_voice_t* voice, bool once)
+{
+   float temp_buffer[AUDIO_MIXER_TEMP_BUFFER];
 
-   if (voice->types.mod.samples < buf_free)
+   while (  !voice->eos
+         && spsc_ring_write_avail(&voice->ring)
+            >= voice->block_samples * sizeof(float))
    {
-      for (i = voice->types.mod.samples; i != 0; i--)
+      bool more = false;
+
+      switch (voice->type)
       {
-         samplef     = ((float)(*pcm++) + 32768.0f) / 65535.0f;
-         samplef     = samplef * 2.0f - 1.0f;
-         *buffer++  += samplef * volume;
+         case AUDIO_MIXER_TYPE_OGG:
+#ifdef HAVE_STB_VORBIS
+            more = audio_mixer_decode_ogg(voice, temp_buffer);
+#endif
+            break;
+         case AUDIO_MIXER_TYPE_MOD:
+#ifdef HAVE_IBXM
+            more = audio_mixer_decode_mod(voice, temp_buffer);
+#endif
+            break;
+         case AUDIO_MIXER_TYPE_FLAC:
+#ifdef HAVE_DR_FLAC
+            more = audio_mixer_decode_flac(voice, temp_buffer);
+#endif
+            break;
+         case AUDIO_MIXER_TYPE_MP3:
+#ifdef HAVE_DR_MP3
+            more = audio_mixer_decode_mp3(voice, temp_buffer);
+#endif
+            break;
+         default:
+            break;
       }
 
-      buf_free -= voice->types.mod.samples;
-      goto again;
-   }
-
-   for (i = buf_free; i != 0; --i )
-   {
-      samplef     = ((float)(*pcm++) + 32768.0f) / 65535.0f;
-      samplef     = samplef * 2.0f - 1.0f;
-      *buffer++  += samplef * volume;
+      if (!more)
+         voice->eos = true;
+      if (once)
+         break;
    }
-
-   voice->types.mod.position += buf_free;
-   voice->types.mod.samples  -= buf_free;
 }
-#endif
 
-#ifdef HAVE_DR_FLAC
-static void audio_mixer_mix_flac(float* buffer, size_t num_frames,
+/* Mixes what the decoder has queued for a streaming voice; the voice
+ * finishes once the decoder is through and the ring has run dry */
+static void audio_mixer_mix_stream(float* buffer, size_t num_frames,
       audio_mixer_voice_t* voice,
       float volume)
 {
-   int i;
-   struct resampler_data info;
-   float temp_buffer[AUDIO_MIXER_TEMP_BUFFER] = { 0 };
-   unsigned buf_free                = (unsigned)(num_frames * 2);
-   unsigned temp_samples            = 0;
-   float *pcm                       = NULL;
+   float pcm[AUDIO_MIXER_MIX_BLOCK];
+   size_t samples = num_frames * 2;
 
-   if (voice->types.flac.position == voice->types.flac.samples)
+#ifdef HAVE_THREADS
+   if (!s_decoder.thread)
+#endif
    {
-again:
-      temp_samples = (unsigned)drflac_read_pcm_frames_f32( voice->types.flac.stream, AUDIO_MIXER_TEMP_BUFFER, temp_buffer);
-      if (temp_samples == 0)
-      {
-         if (voice->repeat)
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
+      AUDIO_MIXER_LOCK(voice);
+      audio_mixer_stream_fill(voice, false);
+      AUDIO_MIXER_UNLOCK(voice);
+   }
 
-            drflac_seek_to_pcm_frame(voice->types.flac.stream,0);
-            goto again;
-         }
+   /* Loops are counted as they are decoded, a little ahead of
+    * being heard */
+   while (voice->repeats_reported != voice->repeats)
+   {
+      voice->repeats_reported++;
+      if (voice->stop_cb)
+         voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
+   }
 
-         if (voice->stop_cb)
-            voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
+   while (samples)
+   {
+      size_t i;
+      size_t count = (samples < AUDIO_MIXER_MIX_BLOCK)
+         ? samples : AUDIO_MIXER_MIX_BLOCK;
 
-         audio_mixer_release(voice);
-         return;
-      }
+      if (!(count = spsc_ring_read(&voice->ring, pcm,
+                  count * sizeof(float)) / sizeof(float)))
+         break;
 
-      info.data_in              = temp_buffer;
-      info.data_out             = voice->types.flac.buffer;
-      info.input_frames         = temp_samples / 2;
-      info.output_frames        = 0;
-      info.ratio                = voice->types.flac.ratio;
+      for (i = 0; i < count; i++)
+         buffer[i] += pcm[i] * volume;
 
-      if (voice->types.flac.resampler)
-         voice->types.flac.resampler->process(
-               voice->types.flac.resampler_data, &info);
-      else
-         memcpy(voice->types.flac.buffer, temp_buffer, temp_samples * sizeof(float));
-      voice->types.flac.position = 0;
-      voice->types.flac.samples  = voice->types.flac.buf_samples;
+      buffer  += count;
+      samples -= count;
    }
 
-   pcm = voice->types.flac.buffer + voice->types.flac.position;
-
-   if (voice->types.flac.samples < buf_free)
+   if (samples)
    {
-      for (i = voice->types.flac.samples; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
+      bool finished;
 
-      buf_free -= voice->types.flac.samples;
-      goto again;
-   }
+      AUDIO_MIXER_LOCK(voice);
+      finished = voice->eos && !spsc_ring_read_avail(&voice->ring);
+      AUDIO_MIXER_UNLOCK(voice);
 
-   for (i = buf_free; i != 0; --i )
-      *buffer++ += *pcm++ * volume;
+      if (finished)
+      {
+         if (voice->stop_cb)
+            voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
 
-   voice->types.flac.position += buf_free;
-   voice->types.flac.samples  -= buf_free;
+         AUDIO_MIXER_LOCK(voice);
+         audio_mixer_release(voice);
+         AUDIO_MIXER_UNLOCK(voice);
+      }
+   }
 }
-#endif
 
-#ifdef HAVE_DR_MP3
-static void audio_mixer_mix_mp3(float* buffer, size_t num_frames,
-      audio_mixer_voice_t* voice,
-      float volume)
+#ifdef HAVE_THREADS
+/* Keeps the rings of the streaming voices topped up, off the thread
+ * that mixes */
+static void audio_mixer_decoder_loop(void *data)
 {
-   int i;
-   struct resampler_data info;
-   float temp_buffer[AUDIO_MIXER_TEMP_BUFFER] = { 0 };
-   unsigned buf_free                = (unsigned)(num_frames * 2);
-   unsigned temp_samples            = 0;
-   float* pcm                       = NULL;
+   slock_lock(s_decoder.lock);
 
-   if (voice->types.mp3.position == voice->types.mp3.samples)
+   while (!s_decoder.quit)
    {
-again:
-      temp_samples = (unsigned)drmp3_read_f32(
-            &voice->types.mp3.stream,
-            AUDIO_MIXER_TEMP_BUFFER / 2, temp_buffer) * 2;
+      unsigned i;
+      bool active        = false;
 
-      if (temp_samples == 0)
-      {
-         if (voice->repeat)
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
+      s_decoder.pending  = false;
+      slock_unlock(s_decoder.lock);
 
-            drmp3_seek_to_frame(&voice->types.mp3.stream,0);
-            goto again;
-         }
+      for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
+      {
+         audio_mixer_voice_t *voice = &s_voices[i];
 
-         if (voice->stop_cb)
-            voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
+         if (!voice->block_samples)
+            continue;
 
-         audio_mixer_release(voice);
-         return;
+         AUDIO_MIXER_LOCK(voice);
+         if (voice->block_samples)
+         {
+            audio_mixer_stream_fill(voice, false);
+            if (!voice->eos)
+               active = true;
+         }
+         AUDIO_MIXER_UNLOCK(voice);
       }
 
-      info.data_in              = temp_buffer;
-      info.data_out             = voice->types.mp3.buffer;
-      info.input_frames         = temp_samples / 2;
-      info.output_frames        = 0;
-      info.ratio                = voice->types.mp3.ratio;
+      slock_lock(s_decoder.lock);
+
+      if (s_decoder.quit || s_decoder.pending)
+         continue;
 
-      if (voice->types.mp3.resampler)
-         voice->types.mp3.resampler->process(
-               voice->types.mp3.resampler_data, &info);
+      if (active)
+         scond_wait_timeout(s_decoder.cond, s_decoder.lock,
+               AUDIO_MIXER_DECODE_USEC);
       else
-         memcpy(voice->types.mp3.buffer, temp_buffer,
-               temp_samples * sizeof(float));
-      voice->types.mp3.position = 0;
-      voice->types.mp3.samples  = voice->types.mp3.buf_samples;
+         scond_wait(s_decoder.cond, s_decoder.lock);
    }
 
-   pcm = voice->types.mp3.buffer + voice->types.mp3.position;
+   slock_unlock(s_decoder.lock);
+}
 
-   if (voice->types.mp3.samples < buf_free)
-   {
-      for (i = voice->types.mp3.samples; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
+static void audio_mixer_decoder_start(void)
+{
+   if (s_decoder.thread)
+      return;
+
+   s_decoder.quit    = false;
+   s_decoder.pending = false;
 
-      buf_free -= voice->types.mp3.samples;
-      goto again;
+   if (     !(s_decoder.lock = slock_new())
+         || !(s_decoder.cond = scond_new())
+         || !(s_decoder.thread = sthread_create(
+               audio_mixer_decoder_loop, NULL)))
+   {
+      /* The mixer decodes for itself then */
+      if (s_decoder.cond)
+         scond_free(s_decoder.cond);
+      if (s_decoder.lock)
+         slock_free(s_decoder.lock);
+      s_decoder.cond = NULL;
+      s_decoder.lock = NULL;
    }
+}
 
-   for (i = buf_free; i != 0; --i )
-      *buffer++ += *pcm++ * volume;
+static void audio_mixer_decoder_stop(void)
+{
+   if (!s_decoder.thread)
+      return;
 
-   voice->types.mp3.position += buf_free;
-   voice->types.mp3.samples  -= buf_free;
+   slock_lock(s_decoder.lock);
+   s_decoder.quit = true;
+   scond_signal(s_decoder.cond);
+   slock_unlock(s_decoder.lock);
+
+   sthread_join(s_decoder.thread);
+   scond_free(s_decoder.cond);
+   slock_free(s_decoder.lock);
+   s_decoder.thread = NULL;
+   s_decoder.cond   = NULL;
+   s_decoder.lock   = NULL;
+}
+
+static void audio_mixer_decoder_wake(void)
+{
+   if (!s_decoder.thread)
+      return;
+
+   slock_lock(s_decoder.lock);
+   s_decoder.pending = true;
+   scond_signal(s_decoder.cond);
+   slock_unlock(s_decoder.lock);
 }
 #endif
 
@@ -1335,13 +1469,12 @@ void audio_mixer_mix(float* buffer, size_t num_frames,
    float* sample              = NULL;
    audio_mixer_voice_t* voice = s_voices;
 
+   /* Voices are started, stopped and mixed on the same thread; the
+    * decoder only touches streams holding their lock, so the mix
+    * itself takes none */
    for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++, voice++)
    {
-      float volume;
-
-      AUDIO_MIXER_LOCK(voice);
-
-      volume = (override) ? volume_override : voice->volume;
+      float volume = (override) ? volume_override : voice->volume;
 
       switch (voice->type)
       {
@@ -1349,30 +1482,15 @@ void audio_mixer_mix(float* buffer, size_t num_frames,
             audio_mixer_mix_wav(buffer, num_frames, voice, volume);
             break;
          case AUDIO_MIXER_TYPE_OGG:
-#ifdef HAVE_STB_VORBIS
-            audio_mixer_mix_ogg(buffer, num_frames, voice, volume);
-#endif
-            break;
          case AUDIO_MIXER_TYPE_MOD:
-#ifdef HAVE_IBXM
-            audio_mixer_mix_mod(buffer, num_frames, voice, volume);
-#endif
-            break;
          case AUDIO_MIXER_TYPE_FLAC:
-#ifdef HAVE_DR_FLAC
-            audio_mixer_mix_flac(buffer, num_frames, voice, volume);
-#endif
-            break;
-            case AUDIO_MIXER_TYPE_MP3:
-#ifdef HAVE_DR_MP3
-            audio_mixer_mix_mp3(buffer, num_frames, voice, volume);
-#endif
+         case AUDIO_MIXER_TYPE_MP3:
+            if (voice->block_samples)
+               audio_mixer_mix_stream(buffer, num_frames, voice, volume);
             break;
          case AUDIO_MIXER_TYPE_NONE:
             break;
       }
-
-      AUDIO_MIXER_UNLOCK(voice);
    }
 
    for (j = 0, sample = buffer; j < num_frames * 2; j++, sample++)
@@ -21,6 +21,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <retro_miscellaneous.h>
 
@@ -44,10 +45,18 @@ struct retro_dsp_plug
    const struct dspfilter_implementation *impl;
 };
 
+/* Frames taken through the whole chain at a time, so that a block
+ * stays in cache from the first filter to the last */
+#define DSP_FILTER_BLOCK_FRAMES 256
+
 struct retro_dsp_instance
 {
    const struct dspfilter_implementation *impl;
    void *impl_data;
+   /* Time spent in the filter since 'load' was last worked out */
+   retro_time_t usec;
+   /* Share of real time the filter takes, in percent */
+   float load;
 };
 
 struct retro_dsp_filter
@@ -59,6 +68,14 @@ struct retro_dsp_filter
 
    struct retro_dsp_instance *instances;
    unsigned num_instances;
+
+   /* The chain's output once a filter has not worked in place */
+   float *output;
+   size_t output_size;
+
+   float sample_rate;
+   /* Frames processed since the loads were last worked out */
+   unsigned load_frames;
 };
 
 static const struct dspfilter_implementation *find_implementation(
@@ -255,7 +272,8 @@ retro_dsp_filter_t *retro_dsp_filter_new(
    if (!(conf = config_file_new_from_path_to_string(filter_config)))
       goto error;
 
-   dsp->conf = conf;
+   dsp->conf        = conf;
+   dsp->sample_rate = sample_rate;
 
    if (string_data)
       plugs = (struct string_list*)string_data;
@@ -306,27 +324,116 @@ void retro_dsp_filter_free(retro_dsp_filter_t *dsp)
    if (dsp->conf)
       config_file_free(dsp->conf);
 
+   free(dsp->output);
    free(dsp);
 }
 
+static bool retro_dsp_filter_reserve(retro_dsp_filter_t *dsp, size_t frames)
+{
+   float *output;
+   size_t size = dsp->output_size ? dsp->output_size : 1024;
+
+   if (frames <= dsp->output_size)
+      return true;
+
+   while (size < frames)
+      size *= 2;
+
+   if (!(output = (float*)realloc(dsp->output, size * 2 * sizeof(float))))
+      return false;
+
+   dsp->output      = output;
+   dsp->output_size = size;
+   return true;
+}
+
 void retro_dsp_filter_process(retro_dsp_filter_t *dsp,
       struct retro_dsp_data *data)
 {
    unsigned i;
-   struct dspfilter_output output = {0};
-   struct dspfilter_input input   = {0};
+   unsigned offset    = 0;
+   unsigned frames    = 0;
+   bool in_place      = true;
+   retro_time_t start = cpu_features_get_time_usec();
 
-   output.samples = data->input;
-   output.frames  = data->input_frames;
+   while (offset < data->input_frames)
+   {
+      struct dspfilter_output output = {0};
+      struct dspfilter_input input   = {0};
+      float *block                   = data->input + offset * 2;
+      unsigned block_frames          = data->input_frames - offset;
 
-   for (i = 0; i < dsp->num_instances; i++)
+      if (block_frames > DSP_FILTER_BLOCK_FRAMES)
+         block_frames = DSP_FILTER_BLOCK_FRAMES;
+
+      output.samples = block;
+      output.frames  = block_frames;
+
+      for (i = 0; i < dsp->num_instances; i++)
+      {
+         retro_time_t now;
+
+         input.samples = output.samples;
+         input.frames  = output.frames;
+         dsp->instances[i].impl->process(
+               dsp->instances[i].impl_data, &output, &input);
+
+         now                     = cpu_features_get_time_usec();
+         dsp->instances[i].usec += now - start;
+         start                   = now;
+      }
+
+      offset += block_frames;
+
+      /* While every block comes out where it went in, the output
+       * is the input buffer; from the first that does not, gather
+       * the blocks in our own */
+      if (     in_place
+            && (output.samples == block)
+            && (output.frames  == block_frames))
+      {
+         frames += block_frames;
+         continue;
+      }
+
+      if (!retro_dsp_filter_reserve(dsp, frames + output.frames))
+         break;
+
+      if (in_place)
+      {
+         memcpy(dsp->output, data->input, frames * 2 * sizeof(float));
+         in_place = false;
+      }
+
+      memcpy(dsp->output + frames * 2, output.samples,
+            output.frames * 2 * sizeof(float));
+      frames += output.frames;
+   }
+
+   data->output        = in_place ? data->input : dsp->output;
+   data->output_frames = frames;
+
+   /* Work the loads out over half a second of audio */
+   dsp->load_frames   += data->input_frames;
+   if (dsp->load_frames >= dsp->sample_rate / 2)
    {
-      input.samples = output.samples;
-      input.frames  = output.frames;
-      dsp->instances[i].impl->process(
-            dsp->instances[i].impl_data, &output, &input);
+      for (i = 0; i < dsp->num_instances; i++)
+      {
+         dsp->instances[i].load = dsp->instances[i].usec
+            * dsp->sample_rate / (dsp->load_frames * 10000.0f);
+         dsp->instances[i].usec = 0;
+      }
+      dsp->load_frames = 0;
    }
+}
 
-   data->output        = output.samples;
-   data->output_frames = output.frames;
+bool retro_dsp_filter_get_load(retro_dsp_filter_t *dsp, unsigned index,
+      const char **ident, float *load)
+{
+   if (!dsp || index >= dsp->num_instances)
+      return false;
+
+   *ident = dsp->instances[index].impl->ident;
+   *load  = dsp->instances[index].load;
+   return true;
 }
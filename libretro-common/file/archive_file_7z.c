@@ -264,14 +264,26 @@ static int64_t sevenzip_file_read(
             }
             else
             {
-               /*We could either use the 7Zip allocated buffer,
-                * or create our own and use it.
-                * We would however need to realloc anyways, because RetroArch
-                * expects a \0 at the end, therefore we allocate new,
-                * copy and free the old one. */
-               *buf = malloc((size_t)(outsize + 1));
-               ((char*)(*buf))[outsize] = '\0';
-               memcpy(*buf, output + offset, outsize);
+               /* Hand the 7Zip allocated buffer over rather than
+                * copying out of it: move the file to its start
+                * (it may sit inside a solid block) and resize it
+                * to hold the \0 RetroArch expects at the end.
+                * Shrinking, or growing by a byte, rarely moves
+                * the buffer. */
+               uint8_t *data;
+
+               if (offset)
+                  memmove(output, output + offset, (size_t)outsize);
+
+               if (!(data = (uint8_t*)realloc(output, (size_t)(outsize + 1))))
+               {
+                  res = SZ_ERROR_MEM;
+                  break;
+               }
+
+               data[outsize] = '\0';
+               *buf          = data;
+               output        = NULL;
             }
             break;
          }
@@ -40,6 +40,7 @@
 #endif
 
 #define _READ_CHUNK_SIZE   (128*1024)   /* Read 128KiB compressed chunks */
+#define _WRITE_CHUNK_SIZE  (256*1024)   /* Write 256KiB uncompressed chunks */
 
 enum file_archive_compression_mode
 {
@@ -95,19 +96,14 @@ static void zip_context_free_stream(
    }
 }
 
-static bool zlib_stream_decompress_data_to_file_init(
-      void *context, file_archive_file_handle_t *handle,
-      const uint8_t *cdata, unsigned cmode, uint32_t csize, uint32_t size)
+/* Gets the offset of the data of the entry whose
+ * local directory header is at 'cdata' */
+static bool zip_file_get_data_offset(struct file_archive_transfer *state,
+      const uint8_t *cdata, int64_t *offset)
 {
-   int64_t offsetData;
    uint8_t *local_header;
    uint32_t offsetNL, offsetEL;
    uint8_t local_header_buf[4];
-   zip_context_t *zip_context = (zip_context_t *)context;
-   struct file_archive_transfer *state = zip_context->state;
-
-   /* free previous data and stream if left unfinished */
-   zip_context_free_stream(zip_context, false);
 
    /* seek past most of the local directory header */
 #ifdef HAVE_MMAP
@@ -118,16 +114,29 @@ static bool zlib_stream_decompress_data_to_file_init(
    {
       filestream_seek(state->archive_file, (int64_t)(size_t)cdata + 26, RETRO_VFS_SEEK_POSITION_START);
       if (filestream_read(state->archive_file, local_header_buf, 4) != 4)
-      {
-         zip_context_free_stream(zip_context, false);
          return false;
-      }
       local_header = local_header_buf;
    }
 
    offsetNL = read_le(local_header,     2); /* file name length */
    offsetEL = read_le(local_header + 2, 2); /* extra field length */
-   offsetData = (int64_t)(size_t)cdata + 26 + 4 + offsetNL + offsetEL;
+   *offset  = (int64_t)(size_t)cdata + 26 + 4 + offsetNL + offsetEL;
+   return true;
+}
+
+static bool zlib_stream_decompress_data_to_file_init(
+      void *context, file_archive_file_handle_t *handle,
+      const uint8_t *cdata, unsigned cmode, uint32_t csize, uint32_t size)
+{
+   int64_t offsetData;
+   zip_context_t *zip_context = (zip_context_t *)context;
+   struct file_archive_transfer *state = zip_context->state;
+
+   /* free previous data and stream if left unfinished */
+   zip_context_free_stream(zip_context, false);
+
+   if (!zip_file_get_data_offset(state, cdata, &offsetData))
+      return false;
 
    zip_context->fdoffset              = offsetData;
    zip_context->usize                 = size;
@@ -207,9 +216,10 @@ static int zlib_stream_decompress_data_to_file_iterate(
 #ifdef HAVE_MMAP
       if (state->archive_mmap_data)
       {
-         /* Decompress from the mapped file */
+         /* Decompress from the mapped file, all
+          * that is left of it in one go */
          dptr = state->archive_mmap_data + (size_t)zip_context->fdoffset + zip_context->boffset;
-         rd   = to_read;
+         rd   = zip_context->csize - zip_context->boffset;
       }
       else
 #endif
@@ -279,6 +289,115 @@ static bool zip_file_decompressed_handle(
    return true;
 }
 
+/* Inflates (or copies) an entry into the file at 'path'
+ * a chunk at a time, rather than extracting all of it
+ * into memory first */
+static bool zip_file_decompress_to_file(
+      struct file_archive_transfer *state,
+      const uint8_t *cdata, unsigned cmode, uint32_t csize,
+      uint32_t size, const char *path)
+{
+   z_stream zstream;
+   int64_t offset;
+   RFILE *file          = NULL;
+   uint8_t *inbuf       = NULL;
+   uint8_t *outbuf      = NULL;
+   uint32_t boffset     = 0;
+   uint64_t written     = 0;
+   bool zstream_inited  = false;
+   bool ret             = false;
+   int zret             = Z_OK;
+
+   if (     (cmode != ZIP_MODE_STORED)
+         && (cmode != ZIP_MODE_DEFLATED))
+      return false;
+
+   if (!zip_file_get_data_offset(state, cdata, &offset))
+      return false;
+
+   if (!(file = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      return false;
+
+#ifdef HAVE_MMAP
+   if (!state->archive_mmap_data)
+#endif
+      if (!(inbuf = (uint8_t*)malloc(_READ_CHUNK_SIZE)))
+         goto end;
+
+   if (cmode == ZIP_MODE_DEFLATED)
+   {
+      if (!(outbuf = (uint8_t*)malloc(_WRITE_CHUNK_SIZE)))
+         goto end;
+
+      memset(&zstream, 0, sizeof(zstream));
+      if (inflateInit2(&zstream, -MAX_WBITS) != Z_OK)
+         goto end;
+      zstream_inited = true;
+   }
+
+   while (boffset < csize && zret != Z_STREAM_END)
+   {
+      uint8_t *dptr;
+      int64_t rd = MIN(csize - boffset, _READ_CHUNK_SIZE);
+
+#ifdef HAVE_MMAP
+      if (state->archive_mmap_data)
+         dptr = state->archive_mmap_data + (size_t)offset + boffset;
+      else
+#endif
+      {
+         filestream_seek(state->archive_file, offset + boffset,
+               RETRO_VFS_SEEK_POSITION_START);
+         if ((rd = filestream_read(state->archive_file, inbuf, rd)) <= 0)
+            goto end;
+         dptr = inbuf;
+      }
+
+      boffset += (uint32_t)rd;
+
+      if (cmode == ZIP_MODE_STORED)
+      {
+         if (filestream_write(file, dptr, rd) != rd)
+            goto end;
+         written += rd;
+         continue;
+      }
+
+      zstream.next_in  = dptr;
+      zstream.avail_in = (uInt)rd;
+
+      /* Drain the output until inflate stops filling it */
+      do
+      {
+         int64_t have;
+
+         zstream.next_out  = outbuf;
+         zstream.avail_out = _WRITE_CHUNK_SIZE;
+
+         if ((zret = inflate(&zstream, Z_NO_FLUSH)) < 0 && zret != Z_BUF_ERROR)
+            goto end;
+
+         have = _WRITE_CHUNK_SIZE - zstream.avail_out;
+         if (have > 0 && filestream_write(file, outbuf, have) != have)
+            goto end;
+         written += have;
+      } while (zstream.avail_out == 0 && zret != Z_STREAM_END);
+   }
+
+   ret = (written == size);
+
+end:
+   if (zstream_inited)
+      inflateEnd(&zstream);
+   if (filestream_close(file) != 0)
+      ret = false;
+   free(inbuf);
+   free(outbuf);
+   return ret;
+}
+
 typedef struct
 {
    char *opt_file;
@@ -311,37 +430,30 @@ static int zip_file_decompressed(
    {
       file_archive_file_handle_t handle = {0};
 
-      if (zip_file_decompressed_handle(userdata->transfer,
-               &handle, cdata, cmode, csize, size, crc32))
+      if (decomp_state->opt_file != 0)
       {
-         if (decomp_state->opt_file != 0)
-         {
-            /* Called in case core has need_fullpath enabled. */
-            bool success = filestream_write_file(decomp_state->opt_file, handle.data, size);
-
-            /* Note: Do not free handle.data here - this
-             * will be done when stream is deinitialised */
-            handle.data = NULL;
+         /* Called in case core has need_fullpath enabled.
+          * Goes straight to the file, a chunk at a time. */
+         decomp_state->size = 0;
 
-            decomp_state->size = 0;
-
-            if (!success)
-               return -1;
-         }
-         else
-         {
-            /* Called in case core has need_fullpath disabled.
-             * Will move decompressed content directly into
-             * RetroArch's ROM buffer. */
-            zip_context_t *zip_context = (zip_context_t *)userdata->transfer->context;
-
-            decomp_state->size = 0;
-            *decomp_state->buf             = handle.data;
-            decomp_state->size             = size;
-            /* We keep the data, prevent its deallocation during free */
-            zip_context->decompressed_data = NULL;
-            handle.data = NULL;
-         }
+         if (!zip_file_decompress_to_file(userdata->transfer,
+                  cdata, cmode, csize, size, decomp_state->opt_file))
+            return -1;
+      }
+      else if (zip_file_decompressed_handle(userdata->transfer,
+               &handle, cdata, cmode, csize, size, crc32))
+      {
+         /* Called in case core has need_fullpath disabled.
+          * Will move decompressed content directly into
+          * RetroArch's ROM buffer. */
+         zip_context_t *zip_context = (zip_context_t *)userdata->transfer->context;
+
+         decomp_state->size = 0;
+         *decomp_state->buf             = handle.data;
+         decomp_state->size             = size;
+         /* We keep the data, prevent its deallocation during free */
+         zip_context->decompressed_data = NULL;
+         handle.data = NULL;
       }
 
       decomp_state->found = true;
@@ -980,6 +980,74 @@ struct config_entry_list *config_get_entry(
    return RHMAP_GET_STR(conf->entries_map, key);
 }
 
+/* Value parsers shared by the config_get_*() functions
+ * and the bind tables */
+
+static bool config_value_get_int(const char *value, int *in)
+{
+   int val;
+   errno = 0;
+   val   = (int)strtol(value, NULL, 0);
+   if (errno != 0)
+      return false;
+   *in   = val;
+   return true;
+}
+
+static bool config_value_get_uint(const char *value, unsigned *in)
+{
+   unsigned val;
+   errno = 0;
+   val   = (unsigned)strtoul(value, NULL, 0);
+   if (errno != 0)
+      return false;
+   *in   = val;
+   return true;
+}
+
+static bool config_value_get_size_t(const char *value, size_t *in)
+{
+   size_t val = 0;
+   if (sscanf(value, "%" PRI_SIZET, &val) != 1)
+      return false;
+   *in = val;
+   return true;
+}
+
+static bool config_value_get_path(const char *value, char *s, size_t len)
+{
+#if defined(RARCH_CONSOLE) || !defined(RARCH_INTERNAL)
+   return strlcpy(s, value, len) < len;
+#else
+   fill_pathname_expand_special(s, value, len);
+   return true;
+#endif
+}
+
+static bool config_value_get_bool(const char *value, bool *in)
+{
+   if      (
+         (
+            value[0] == '1'
+         && value[1] == '\0'
+         )
+         || string_is_equal(value, "true")
+         )
+      *in = true;
+   else if (
+         (
+            value[0] == '0'
+         && value[1] == '\0'
+         )
+         || string_is_equal(value, "false")
+         )
+      *in = false;
+   else
+      return false;
+
+   return true;
+}
+
 /**
  * config_get_double:
  *
@@ -1020,38 +1088,13 @@ bool config_get_float(config_file_t *conf, const char *key, float *in)
 bool config_get_int(config_file_t *conf, const char *key, int *in)
 {
    const struct config_entry_list *entry = config_get_entry(conf, key);
-   errno = 0;
-
-   if (entry)
-   {
-      int val = (int)strtol(entry->value, NULL, 0);
-
-      if (errno == 0)
-      {
-         *in = val;
-         return true;
-      }
-   }
-
-   return false;
+   return entry && config_value_get_int(entry->value, in);
 }
 
 bool config_get_size_t(config_file_t *conf, const char *key, size_t *in)
 {
    const struct config_entry_list *entry = config_get_entry(conf, key);
-   errno = 0;
-
-   if (entry)
-   {
-      size_t val = 0;
-      if (sscanf(entry->value, "%" PRI_SIZET, &val) == 1)
-      {
-         *in = val;
-         return true;
-      }
-   }
-
-   return false;
+   return entry && config_value_get_size_t(entry->value, in);
 }
 
 #if defined(__STDC_VERSION__) && __STDC_VERSION__>=199901L
@@ -1077,20 +1120,7 @@ bool config_get_uint64(config_file_t *conf, const char *key, uint64_t *in)
 bool config_get_uint(config_file_t *conf, const char *key, unsigned *in)
 {
    const struct config_entry_list *entry = config_get_entry(conf, key);
-   errno = 0;
-
-   if (entry)
-   {
-      unsigned val = (unsigned)strtoul(entry->value, NULL, 0);
-
-      if (errno == 0)
-      {
-         *in = val;
-         return true;
-      }
-   }
-
-   return false;
+   return entry && config_value_get_uint(entry->value, in);
 }
 
 bool config_get_hex(config_file_t *conf, const char *key, unsigned *in)
@@ -1180,17 +1210,8 @@ bool config_get_array(config_file_t *conf, const char *key,
 bool config_get_path(config_file_t *conf, const char *key,
       char *s, size_t len)
 {
-#if defined(RARCH_CONSOLE) || !defined(RARCH_INTERNAL)
-   return config_get_array(conf, key, s, len);
-#else
    const struct config_entry_list *entry = config_get_entry(conf, key);
-   if (entry)
-   {
-      fill_pathname_expand_special(s, entry->value, len);
-      return true;
-   }
-   return false;
-#endif
+   return entry && config_value_get_path(entry->value, s, len);
 }
 
 /**
@@ -1205,32 +1226,137 @@ bool config_get_path(config_file_t *conf, const char *key,
 bool config_get_bool(config_file_t *conf, const char *key, bool *in)
 {
    const struct config_entry_list *entry = config_get_entry(conf, key);
+   return entry && config_value_get_bool(entry->value, in);
+}
 
-   if (!entry)
-      return false;
+bool config_bind_table_init(config_bind_table_t *table,
+      const struct config_bind *binds, size_t count)
+{
+   size_t i;
+   size_t *map = NULL;
 
-   if      (
-         (
-            entry->value[0] == '1'
-         && entry->value[1] == '\0'
-         )
-         || string_is_equal(entry->value, "true")
-         )
-      *in = true;
-   else if (
-         (
-            entry->value[0] == '0'
-         && entry->value[1] == '\0'
-         )
-         || string_is_equal(entry->value, "false")
-         )
-      *in = false;
-   else
+   table->binds  = binds;
+   table->hashes = NULL;
+   table->map    = NULL;
+   table->count  = 0;
+
+   if (!count)
+      return true;
+
+   if (     !(table->hashes = (uint32_t*)malloc(count * sizeof(uint32_t)))
+         || !RHMAP_TRYFIT(map, count))
+   {
+      free(table->hashes);
+      table->hashes = NULL;
+      RHMAP_FREE(map);
       return false;
+   }
 
+   for (i = 0; i < count; i++)
+   {
+      uint32_t hash = rhmap_hash_string(binds[i].key);
+
+      if (RHMAP_HAS_FULL(map, hash, binds[i].key))
+         table->hashes[i] = 0;
+      else
+      {
+         table->hashes[i] = hash;
+         RHMAP_SET_FULL(map, hash, binds[i].key, i + 1);
+      }
+   }
+
+   table->map   = map;
+   table->count = count;
    return true;
 }
 
+void config_bind_table_free(config_bind_table_t *table)
+{
+   free(table->hashes);
+   RHMAP_FREE(table->map);
+   table->hashes = NULL;
+   table->count  = 0;
+}
+
+static bool config_bind_set(const struct config_bind *bind,
+      const char *value)
+{
+   switch (bind->type)
+   {
+      case CONFIG_BIND_BOOL:
+         return config_value_get_bool(value, (bool*)bind->ptr);
+      case CONFIG_BIND_INT:
+         return config_value_get_int(value, (int*)bind->ptr);
+      case CONFIG_BIND_UINT:
+         return config_value_get_uint(value, (unsigned*)bind->ptr);
+      case CONFIG_BIND_SIZE:
+         return config_value_get_size_t(value, (size_t*)bind->ptr);
+      case CONFIG_BIND_FLOAT:
+         /* strtof() is C99/POSIX. Just use the more portable kind. */
+         *(float*)bind->ptr = (float)strtod(value, NULL);
+         return true;
+      case CONFIG_BIND_ARRAY:
+         return strlcpy((char*)bind->ptr, value, bind->len) < bind->len;
+      case CONFIG_BIND_PATH:
+         return config_value_get_path(value, (char*)bind->ptr, bind->len);
+      case CONFIG_BIND_VALUE:
+         *(const char**)bind->ptr = value;
+         return true;
+   }
+
+   return false;
+}
+
+size_t config_bind_table_apply(const config_bind_table_t *table,
+      config_file_t *conf)
+{
+   size_t i, cap;
+   size_t set                          = 0;
+   size_t *map                         = table->map;
+   struct config_entry_list **entries  = conf->entries_map;
+
+   if (!table->count || !entries)
+      return 0;
+
+   /* An override or remap file holds a few keys out of the
+    * hundreds in the table - look each of them up in the
+    * table instead */
+   if (RHMAP_LEN(entries) < table->count)
+   {
+      for (i = 0, cap = RHMAP_CAP(entries); i != cap; i++)
+      {
+         size_t idx;
+         uint32_t hash                   = RHMAP_KEY(entries, i);
+         struct config_entry_list *entry = entries[i];
+
+         if (!hash || !entry || !entry->value)
+            continue;
+         if (!(idx = RHMAP_GET_FULL(map, hash, RHMAP_KEY_STR(entries, i))))
+            continue;
+         if (config_bind_set(&table->binds[idx - 1], entry->value))
+            set++;
+      }
+      return set;
+   }
+
+   for (i = 0; i < table->count; i++)
+   {
+      struct config_entry_list *entry;
+
+      if (!table->hashes[i])
+         continue;
+      /* A lookup can grow the map, so goes through 'conf' */
+      entry = RHMAP_GET_FULL(conf->entries_map, table->hashes[i],
+            table->binds[i].key);
+      if (     entry
+            && entry->value
+            && config_bind_set(&table->binds[i], entry->value))
+         set++;
+   }
+
+   return set;
+}
+
 void config_set_string(config_file_t *conf, const char *key, const char *val)
 {
    struct config_entry_list *last  = NULL;
@@ -38,6 +38,7 @@
 
 #ifdef _WIN32
 #include <direct.h>
+#include <encodings/utf.h>
 #else
 #include <unistd.h> /* stat() is defined here */
 #endif
@@ -98,6 +99,38 @@ int32_t path_get_size(const char *path)
    return -1;
 }
 
+bool path_get_size_and_mtime(const char *path, int64_t *size,
+      int64_t *mtime)
+{
+#if defined(VITA) || defined(__PSL1GHT__) || defined(__PS3__)
+   return false;
+#else
+#if defined(_WIN32) && !defined(LEGACY_WIN32)
+   struct _stat64 stat_buf;
+   wchar_t *path_wide = utf8_to_utf16_string_alloc(path);
+   int ret            = path_wide ? _wstat64(path_wide, &stat_buf) : -1;
+
+   free(path_wide);
+#elif defined(_WIN32)
+   struct _stat stat_buf;
+   char *path_local   = utf8_to_local_string_alloc(path);
+   int ret            = path_local ? _stat(path_local, &stat_buf) : -1;
+
+   free(path_local);
+#else
+   struct stat stat_buf;
+   int ret            = stat(path, &stat_buf);
+#endif
+
+   if (ret != 0)
+      return false;
+
+   *size  = (int64_t)stat_buf.st_size;
+   *mtime = (int64_t)stat_buf.st_mtime;
+   return true;
+#endif
+}
+
 /**
  * path_mkdir:
  * @dir                : directory
@@ -0,0 +1,131 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (file_write_atomic.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__) || defined(__HAIKU__)
+/* rename() replaces the target in one step here */
+#include <unistd.h>
+#define FILE_WRITE_ATOMIC_POSIX
+#endif
+
+#include <boolean.h>
+#include <retro_miscellaneous.h>
+#include <file/file_write_atomic.h>
+
+/* Numbers the calls, so two at once never share a temporary name */
+#if defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) \
+         || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1)))
+#define FILE_WRITE_ATOMIC_NEXT(n) __sync_fetch_and_add(&(n), 1)
+#elif defined(_WIN32) && !defined(_XBOX)
+#define FILE_WRITE_ATOMIC_NEXT(n) ((unsigned long)InterlockedIncrement(&(n)))
+#else
+/* Single core targets */
+#define FILE_WRITE_ATOMIC_NEXT(n) ((n)++)
+#endif
+
+#if defined(_WIN32) && !defined(_XBOX) && !defined(__clang__) && !defined(__GNUC__)
+static volatile LONG file_write_atomic_calls = 0;
+#else
+static unsigned long file_write_atomic_calls = 0;
+#endif
+
+static unsigned long file_write_atomic_pid(void)
+{
+#if defined(_WIN32) && !defined(_XBOX)
+   return (unsigned long)GetCurrentProcessId();
+#elif defined(FILE_WRITE_ATOMIC_POSIX)
+   return (unsigned long)getpid();
+#else
+   /* One process at a time here */
+   return 0;
+#endif
+}
+
+bool file_write_atomic_cb(const char *path,
+      file_write_atomic_cb_t write, void *userdata)
+{
+   char tmp_path[PATH_MAX_LENGTH];
+   RFILE *file = NULL;
+   bool ok     = false;
+
+   /* A cut-off name could be some other file, so it is never opened */
+   if ((size_t)snprintf(tmp_path, sizeof(tmp_path), "%s.%lx-%lx.tmp",
+            path, file_write_atomic_pid(),
+            (unsigned long)FILE_WRITE_ATOMIC_NEXT(file_write_atomic_calls))
+         >= sizeof(tmp_path))
+      return false;
+   if (!(file = filestream_open(tmp_path, RETRO_VFS_FILE_ACCESS_WRITE,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      return false;
+
+   ok = write(file, userdata);
+   if (filestream_close(file) != 0)
+      ok = false;
+
+#ifdef FILE_WRITE_ATOMIC_POSIX
+   if (ok && filestream_rename(tmp_path, path) != 0)
+      ok = false;
+#else
+   /* Renaming over an existing file fails here, so the old one
+    * goes first when it is in the way */
+   if (     ok
+         && filestream_rename(tmp_path, path) != 0
+         && (     filestream_delete(path) != 0
+               || filestream_rename(tmp_path, path) != 0))
+      ok = false;
+#endif
+   if (!ok)
+      filestream_delete(tmp_path);
+   return ok;
+}
+
+struct file_write_atomic_blocks
+{
+   const struct file_write_block *blocks;
+   size_t count;
+};
+
+static bool file_write_atomic_blocks_cb(RFILE *file, void *userdata)
+{
+   size_t i;
+   const struct file_write_atomic_blocks *list =
+      (const struct file_write_atomic_blocks*)userdata;
+
+   for (i = 0; i < list->count; i++)
+      if (filestream_write(file, list->blocks[i].data, list->blocks[i].size)
+            != list->blocks[i].size)
+         return false;
+   return true;
+}
+
+bool file_write_atomic(const char *path,
+      const struct file_write_block *blocks, size_t count)
+{
+   struct file_write_atomic_blocks list;
+   list.blocks = blocks;
+   list.count  = count;
+   return file_write_atomic_cb(path, file_write_atomic_blocks_cb, &list);
+}
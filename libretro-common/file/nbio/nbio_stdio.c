@@ -29,6 +29,10 @@
 #include <file/nbio.h>
 #include <encodings/utf.h>
 
+#if !defined(_WIN32) && !defined(__PSL1GHT__) && !defined(__PS3__) && !defined(VITA) && !defined(_3DS) && !defined(GEKKO) && !defined(WIIU) && !defined(__SWITCH__)
+#include <fcntl.h>
+#endif
+
 /* Assume W-functions do not work below Win2K and Xbox platforms */
 #if defined(_WIN32_WINNT) && _WIN32_WINNT < 0x0500 || defined(_XBOX)
 
@@ -131,6 +135,15 @@ static void *nbio_stdio_open(const char * filename, unsigned mode)
       default:
          fseek_wrap(handle->f, 0, SEEK_END);
          len = ftell_wrap(handle->f);
+#if defined(POSIX_FADV_WILLNEED)
+         /* Reads come in chunks over several iterations; let the
+          * kernel fetch the rest of the file in the meantime */
+         if (len > 0)
+         {
+            posix_fadvise(fileno(f), 0, (off_t)len, POSIX_FADV_SEQUENTIAL);
+            posix_fadvise(fileno(f), 0, (off_t)len, POSIX_FADV_WILLNEED);
+         }
+#endif
          break;
    }
 
@@ -199,6 +199,7 @@ static bool image_texture_load_internal(
       unsigned g_shift, unsigned b_shift)
 {
    int ret;
+   bool abgr    = false;
    void *img    = image_transfer_new(type);
 
    if (!img)
@@ -206,6 +207,10 @@ static bool image_texture_load_internal(
 
    image_transfer_set_buffer_ptr(img, type, (uint8_t*)ptr, len);
 
+   /* The RGBA case, which the decoder may write directly */
+   if (a_shift == 24 && r_shift == 0 && g_shift == 8 && b_shift == 16)
+      abgr = image_transfer_set_output_abgr(img, type);
+
    if (!image_transfer_start(img, type))
    {
       image_transfer_free(img, type);
@@ -233,8 +238,9 @@ static bool image_texture_load_internal(
       return false;
    }
 
-   image_texture_color_convert(r_shift, g_shift, b_shift,
-         a_shift, out_img);
+   if (!abgr)
+      image_texture_color_convert(r_shift, g_shift, b_shift,
+            a_shift, out_img);
 
 #ifdef GEKKO
    if (!image_texture_internal_gx_convert_texture32(out_img))
@@ -175,6 +175,27 @@ bool image_transfer_is_valid(
    return false;
 }
 
+bool image_transfer_set_output_abgr(void *data, enum image_type_enum type)
+{
+   switch (type)
+   {
+      case IMAGE_TYPE_PNG:
+#ifdef HAVE_RPNG
+         rpng_set_output_abgr((rpng_t*)data, true);
+         return true;
+#else
+         break;
+#endif
+      case IMAGE_TYPE_JPEG:
+      case IMAGE_TYPE_TGA:
+      case IMAGE_TYPE_BMP:
+      case IMAGE_TYPE_NONE:
+         break;
+   }
+
+   return false;
+}
+
 void image_transfer_set_buffer_ptr(
       void *data,
       enum image_type_enum type,
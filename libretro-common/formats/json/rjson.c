@@ -29,10 +29,20 @@
 #include <stdlib.h> /* malloc, realloc, atof, atoi */
 
 #include <formats/rjson.h>
+#include <compat/intrinsics.h>
 #include <compat/posix_string.h>
 #include <streams/interface_stream.h>
 #include <streams/file_stream.h>
 
+#if defined(__SSE2__) || (defined(_MSC_VER) && (defined(_M_X64) \
+      || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)))
+#include <emmintrin.h>
+#define _rJSON_SIMD_SSE2
+#elif defined(__aarch64__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define _rJSON_SIMD_NEON
+#endif
+
 struct _rjson_stack { enum rjson_type type; size_t count; };
 
 struct rjson
@@ -182,6 +192,90 @@ static INLINE _rjson_char_t _rjson_char_get(rjson_t *json)
         ? *json->input_p++ : _rJSON_EOF);
 }
 
+/* Skips 16 byte blocks of plain string characters, stopping at the
+ * block that holds the next '"', '\\' or control character (or when
+ * less than a block is left) for the byte loop to handle. Sets 0x80
+ * in the UTF-8 mask if any skipped byte is non-ASCII. */
+static INLINE const unsigned char *_rjson_scan_string(
+      const unsigned char *p, const unsigned char *end,
+      unsigned char *utf8mask)
+{
+#if defined(_rJSON_SIMD_SSE2)
+   const __m128i quote     = _mm_set1_epi8('"');
+   const __m128i backslash = _mm_set1_epi8('\\');
+   const __m128i control   = _mm_set1_epi8(0x1F);
+   while (end - p >= 16)
+   {
+      __m128i v    = _mm_loadu_si128((const __m128i*)p);
+      __m128i stop = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, quote),
+               _mm_cmpeq_epi8(v, backslash)),
+            _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+      int bits     = _mm_movemask_epi8(stop);
+      int high     = _mm_movemask_epi8(v);
+      if (bits)
+      {
+         int n = compat_ctz((unsigned)bits);
+         if (high & ((1 << n) - 1))
+            *utf8mask |= 0x80;
+         return p + n;
+      }
+      if (high)
+         *utf8mask |= 0x80;
+      p += 16;
+   }
+#elif defined(_rJSON_SIMD_NEON)
+   const uint8x16_t quote     = vdupq_n_u8('"');
+   const uint8x16_t backslash = vdupq_n_u8('\\');
+   const uint8x16_t control   = vdupq_n_u8(0x20);
+   while (end - p >= 16)
+   {
+      uint8x16_t v    = vld1q_u8(p);
+      uint8x16_t stop = vorrq_u8(
+            vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, backslash)),
+            vcltq_u8(v, control));
+      if (vmaxvq_u8(stop))
+         break;
+      *utf8mask |= (vmaxvq_u8(v) & 0x80);
+      p += 16;
+   }
+#endif
+   return p;
+}
+
+/* Skips spaces and tabs, 16 bytes at a time where possible. Newlines
+ * are left to the caller, which counts them. */
+static INLINE const unsigned char *_rjson_skip_blanks(
+      const unsigned char *p, const unsigned char *end)
+{
+#if defined(_rJSON_SIMD_SSE2)
+   const __m128i space = _mm_set1_epi8(' ');
+   const __m128i tab   = _mm_set1_epi8('\t');
+   while (end - p >= 16)
+   {
+      __m128i v = _mm_loadu_si128((const __m128i*)p);
+      int bits  = _mm_movemask_epi8(_mm_or_si128(
+               _mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab))) ^ 0xFFFF;
+      if (bits)
+         return p + compat_ctz((unsigned)bits);
+      p += 16;
+   }
+#elif defined(_rJSON_SIMD_NEON)
+   const uint8x16_t space = vdupq_n_u8(' ');
+   const uint8x16_t tab   = vdupq_n_u8('\t');
+   while (end - p >= 16)
+   {
+      uint8x16_t v = vld1q_u8(p);
+      if (vminvq_u8(vorrq_u8(vceqq_u8(v, space), vceqq_u8(v, tab))) == 0)
+         break;
+      p += 16;
+   }
+#endif
+   while (p != end && (*p == ' ' || *p == '\t'))
+      p++;
+   return p;
+}
+
 static unsigned int _rjson_get_unicode_cp(rjson_t *json)
 {
    unsigned int cp = 0, shift = 16;
@@ -406,7 +500,12 @@ static enum rjson_type _rjson_read_string(rjson_t *json)
    {
       if (_rJSON_LIKELY(p != end))
       {
-         unsigned char c = *p;
+         unsigned char c;
+#if defined(_rJSON_SIMD_SSE2) || defined(_rJSON_SIMD_NEON)
+         if (end - p >= 16 && (p = _rjson_scan_string(p, end, &utf8mask)) == end)
+            continue;
+#endif
+         c = *p;
          if (_rJSON_LIKELY(c != '"' && c != '\\' && c >= 0x20))
          {
             /* handle most common case first, it's faster */
@@ -752,7 +851,11 @@ enum rjson_type rjson_next(rjson_t *json)
                /* Actual JSON token, process below */
             }
             else if (_rJSON_LIKELY(tok == _rJSON_TOK_WHITESPACE))
+            {
+               /* Indentation comes in runs */
+               p = _rjson_skip_blanks(p, end);
                continue;
+            }
             else if (tok == _rJSON_TOK_NEWLINE)
             {
                json->source_line++;
@@ -31,7 +31,12 @@
 #include <malloc.h>
 #endif
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include <boolean.h>
+#include <retro_endianness.h>
 #include <formats/image.h>
 #include <formats/rpng.h>
 #include <streams/trans_stream.h>
@@ -39,6 +44,10 @@
 
 #include "rpng_internal.h"
 
+/* Least output inflated at a time when rows are inflated
+ * as they are needed */
+#define RPNG_INFLATE_CHUNK_SIZE (64 * 1024)
+
 enum png_ihdr_color_type
 {
    PNG_IHDR_COLOR_GRAY       = 0,
@@ -86,7 +95,9 @@ enum rpng_process_flags
 {
    RPNG_PROCESS_FLAG_INFLATE_INITIALIZED    = (1 << 0),
    RPNG_PROCESS_FLAG_ADAM7_PASS_INITIALIZED = (1 << 1),
-   RPNG_PROCESS_FLAG_PASS_INITIALIZED       = (1 << 2)
+   RPNG_PROCESS_FLAG_PASS_INITIALIZED       = (1 << 2),
+   /* Rows are inflated as they are unfiltered, not all up front */
+   RPNG_PROCESS_FLAG_INFLATE_BY_ROW         = (1 << 3)
 };
 
 struct rpng_process
@@ -98,6 +109,7 @@ struct rpng_process
    uint8_t *prev_scanline;
    uint8_t *decoded_scanline;
    uint8_t *inflate_buf;
+   uint8_t *inflate_buf_start;
    size_t restore_buf_size;
    size_t adam7_restore_buf_size;
    size_t data_restore_buf_size;
@@ -113,6 +125,8 @@ struct rpng_process
    unsigned pass_width;
    unsigned pass_height;
    unsigned pass_pos;
+   unsigned r_shift;
+   unsigned b_shift;
    uint8_t flags;
 };
 
@@ -122,7 +136,8 @@ enum rpng_flags
    RPNG_FLAG_HAS_IDAT = (1 << 1),
    RPNG_FLAG_HAS_IEND = (1 << 2),
    RPNG_FLAG_HAS_PLTE = (1 << 3),
-   RPNG_FLAG_HAS_TRNS = (1 << 4)
+   RPNG_FLAG_HAS_TRNS = (1 << 4),
+   RPNG_FLAG_ABGR     = (1 << 5)
 };
 
 struct rpng
@@ -231,7 +246,8 @@ static bool rpng_process_ihdr(struct png_ihdr *ihdr)
 #endif
 
 static void rpng_reverse_filter_copy_line_rgb(uint32_t *data,
-      const uint8_t *decoded, unsigned width, unsigned bpp)
+      const uint8_t *decoded, unsigned width, unsigned bpp,
+      unsigned r_shift, unsigned b_shift)
 {
    int i;
 
@@ -247,18 +263,46 @@ static void rpng_reverse_filter_copy_line_rgb(uint32_t *data,
       decoded += bpp;
       b        = *decoded;
       decoded += bpp;
-      data[i]  = (0xffu << 24) | (r << 16) | (g << 8) | (b << 0);
+      data[i]  = (0xffu << 24) | (r << r_shift) | (g << 8) | (b << b_shift);
    }
 }
 
 static void rpng_reverse_filter_copy_line_rgba(uint32_t *data,
-      const uint8_t *decoded, unsigned width, unsigned bpp)
+      const uint8_t *decoded, unsigned width, unsigned bpp,
+      unsigned r_shift, unsigned b_shift)
 {
-   int i;
+   int i = 0;
 
    bpp /= 8;
 
-   for (i = 0; i < (int)width; i++)
+   if (bpp == 1)
+   {
+#if defined(LSB_FIRST)
+      /* RGBA bytes are ABGR words already */
+      if (r_shift == 0)
+      {
+         memcpy(data, decoded, width * sizeof(uint32_t));
+         return;
+      }
+#endif
+#if defined(__SSE2__)
+      if (r_shift == 16)
+      {
+         const __m128i mask_ag = _mm_set1_epi32((int)0xff00ff00);
+         const __m128i mask_b  = _mm_set1_epi32(0x000000ff);
+         for (; i + 4 <= (int)width; i += 4, decoded += 16)
+         {
+            __m128i v = _mm_loadu_si128((const __m128i*)decoded);
+            __m128i r = _mm_slli_epi32(_mm_and_si128(v, mask_b), 16);
+            __m128i b = _mm_and_si128(_mm_srli_epi32(v, 16), mask_b);
+            _mm_storeu_si128((__m128i*)(data + i), _mm_or_si128(
+                     _mm_and_si128(v, mask_ag), _mm_or_si128(r, b)));
+         }
+      }
+#endif
+   }
+
+   for (; i < (int)width; i++)
    {
       uint32_t r, g, b, a;
       r        = *decoded;
@@ -269,7 +313,7 @@ static void rpng_reverse_filter_copy_line_rgba(uint32_t *data,
       decoded += bpp;
       a        = *decoded;
       decoded += bpp;
-      data[i]  = (a << 24) | (r << 16) | (g << 8) | (b << 0);
+      data[i]  = (a << 24) | (r << r_shift) | (g << 8) | (b << b_shift);
    }
 }
 
@@ -420,6 +464,179 @@ static void rpng_reverse_filter_copy_line_plt(uint32_t *data,
    }
 }
 
+#if defined(__SSE2__)
+/* Pixels move as 4 bytes, so a 3 byte one also carries the first
+ * byte of the next; its store is overwritten by the next pixel's.
+ * Only a row's last pixel is copied exactly. */
+static INLINE __m128i rpng_load_pixel(const uint8_t *p, unsigned len)
+{
+   uint32_t v = 0;
+   memcpy(&v, p, len);
+   return _mm_cvtsi32_si128((int)v);
+}
+
+static INLINE void rpng_store_pixel(uint8_t *p, __m128i v, unsigned len)
+{
+   uint32_t t = (uint32_t)_mm_cvtsi128_si32(v);
+   memcpy(p, &t, len);
+}
+
+static INLINE __m128i rpng_avg_pixel(__m128i a, __m128i b, __m128i x)
+{
+   /* _mm_avg_epu8 rounds up, PNG rounds down */
+   return _mm_add_epi8(x, _mm_sub_epi8(_mm_avg_epu8(a, b),
+            _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1))));
+}
+
+/* @a: left, @c: up left, both widened to 16 bit lanes so the
+ * predictor distances don't wrap; @b: up, @x: filtered */
+static INLINE __m128i rpng_paeth_pixel(__m128i *a, __m128i *c,
+      __m128i b, __m128i x)
+{
+   __m128i pa, pb, pc, smallest, nearest, d;
+   const __m128i zero = _mm_setzero_si128();
+
+   b        = _mm_unpacklo_epi8(b, zero);
+   pa       = _mm_sub_epi16(b, *c);
+   pb       = _mm_sub_epi16(*a, *c);
+   pc       = _mm_add_epi16(pa, pb);
+   pa       = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+   pb       = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+   pc       = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+   smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+
+   /* a if pa is smallest, else b if pb is, else c */
+   nearest  = _mm_cmpeq_epi16(smallest, pb);
+   nearest  = _mm_or_si128(_mm_and_si128(nearest, b),
+         _mm_andnot_si128(nearest, *c));
+   pa       = _mm_cmpeq_epi16(smallest, pa);
+   nearest  = _mm_or_si128(_mm_and_si128(pa, *a),
+         _mm_andnot_si128(pa, nearest));
+
+   d        = _mm_add_epi8(x, _mm_packus_epi16(nearest, nearest));
+   *c       = b;
+   *a       = _mm_unpacklo_epi8(d, zero);
+   return d;
+}
+
+static void rpng_unfilter_sub_sse2(uint8_t *out, const uint8_t *in,
+      unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   __m128i a = _mm_setzero_si128();
+   for (i = 0; i + 4 <= pitch; i += bpp)
+   {
+      a = _mm_add_epi8(a, rpng_load_pixel(in + i, 4));
+      rpng_store_pixel(out + i, a, 4);
+   }
+   if (i < pitch)
+      rpng_store_pixel(out + i,
+            _mm_add_epi8(a, rpng_load_pixel(in + i, bpp)), bpp);
+}
+
+static void rpng_unfilter_avg_sse2(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   __m128i a = _mm_setzero_si128();
+   for (i = 0; i + 4 <= pitch; i += bpp)
+   {
+      a = rpng_avg_pixel(a, rpng_load_pixel(prev + i, 4),
+            rpng_load_pixel(in + i, 4));
+      rpng_store_pixel(out + i, a, 4);
+   }
+   if (i < pitch)
+      rpng_store_pixel(out + i, rpng_avg_pixel(a,
+               rpng_load_pixel(prev + i, bpp),
+               rpng_load_pixel(in + i, bpp)), bpp);
+}
+
+static void rpng_unfilter_paeth_sse2(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   __m128i a = _mm_setzero_si128();
+   __m128i c = _mm_setzero_si128();
+   for (i = 0; i + 4 <= pitch; i += bpp)
+      rpng_store_pixel(out + i, rpng_paeth_pixel(&a, &c,
+               rpng_load_pixel(prev + i, 4),
+               rpng_load_pixel(in + i, 4)), 4);
+   if (i < pitch)
+      rpng_store_pixel(out + i, rpng_paeth_pixel(&a, &c,
+               rpng_load_pixel(prev + i, bpp),
+               rpng_load_pixel(in + i, bpp)), bpp);
+}
+#endif
+
+/* The unfilter kernels read the filtered row from @in and write the
+ * restored one to @out, against the restored row above in @prev.
+ * 3 and 4 byte pixels (8 bit RGB and RGBA) go a pixel at a time
+ * through SSE2 where it's there; a row of them depends on itself
+ * byte by byte otherwise. */
+static void rpng_unfilter_sub(uint8_t *out, const uint8_t *in,
+      unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+#if defined(__SSE2__)
+   if (bpp == 3 || bpp == 4)
+   {
+      rpng_unfilter_sub_sse2(out, in, pitch, bpp);
+      return;
+   }
+#endif
+   memcpy(out, in, bpp);
+   for (i = bpp; i < pitch; i++)
+      out[i] = in[i] + out[i - bpp];
+}
+
+static void rpng_unfilter_up(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch)
+{
+   unsigned i = 0;
+#if defined(__SSE2__)
+   for (; i + 16 <= pitch; i += 16)
+      _mm_storeu_si128((__m128i*)(out + i), _mm_add_epi8(
+               _mm_loadu_si128((const __m128i*)(in + i)),
+               _mm_loadu_si128((const __m128i*)(prev + i))));
+#endif
+   for (; i < pitch; i++)
+      out[i] = in[i] + prev[i];
+}
+
+static void rpng_unfilter_avg(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+#if defined(__SSE2__)
+   if (bpp == 3 || bpp == 4)
+   {
+      rpng_unfilter_avg_sse2(out, in, prev, pitch, bpp);
+      return;
+   }
+#endif
+   for (i = 0; i < bpp; i++)
+      out[i] = in[i] + (prev[i] >> 1);
+   for (i = bpp; i < pitch; i++)
+      out[i] = in[i] + ((out[i - bpp] + prev[i]) >> 1);
+}
+
+static void rpng_unfilter_paeth(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+#if defined(__SSE2__)
+   if (bpp == 3 || bpp == 4)
+   {
+      rpng_unfilter_paeth_sse2(out, in, prev, pitch, bpp);
+      return;
+   }
+#endif
+   for (i = 0; i < bpp; i++)
+      out[i] = in[i] + prev[i];
+   for (i = bpp; i < pitch; i++)
+      out[i] = in[i] + paeth(out[i - bpp], prev[i], prev[i - bpp]);
+}
+
 static void rpng_pass_geom(const struct png_ihdr *ihdr,
       unsigned width, unsigned height,
       unsigned *bpp_out, unsigned *pitch_out, size_t *pass_size)
@@ -541,7 +758,8 @@ static int rpng_reverse_filter_init(const struct png_ihdr *ihdr,
 
    rpng_pass_geom(ihdr, ihdr->width, ihdr->height, &pngp->bpp, &pngp->pitch, &pass_size);
 
-   if (pngp->total_out < pass_size)
+   if (     pngp->total_out < pass_size
+         && !(pngp->flags & RPNG_PROCESS_FLAG_INFLATE_BY_ROW))
       return -1;
 
    pngp->restore_buf_size      = 0;
@@ -566,7 +784,7 @@ static int rpng_reverse_filter_copy_line(uint32_t *data,
       const struct png_ihdr *ihdr,
       struct rpng_process *pngp, unsigned filter)
 {
-   unsigned i;
+   uint8_t *swap;
 
    switch (filter)
    {
@@ -574,35 +792,20 @@ static int rpng_reverse_filter_copy_line(uint32_t *data,
          memcpy(pngp->decoded_scanline, pngp->inflate_buf, pngp->pitch);
          break;
       case PNG_FILTER_SUB:
-         memcpy(pngp->decoded_scanline, pngp->inflate_buf, pngp->pitch);
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] += pngp->decoded_scanline[i - pngp->bpp];
+         rpng_unfilter_sub(pngp->decoded_scanline, pngp->inflate_buf,
+               pngp->pitch, pngp->bpp);
          break;
       case PNG_FILTER_UP:
-         memcpy(pngp->decoded_scanline, pngp->inflate_buf, pngp->pitch);
-         for (i = 0; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] += pngp->prev_scanline[i];
+         rpng_unfilter_up(pngp->decoded_scanline, pngp->inflate_buf,
+               pngp->prev_scanline, pngp->pitch);
          break;
       case PNG_FILTER_AVERAGE:
-         memcpy(pngp->decoded_scanline, pngp->inflate_buf, pngp->pitch);
-         for (i = 0; i < pngp->bpp; i++)
-         {
-            uint8_t avg = pngp->prev_scanline[i] >> 1;
-            pngp->decoded_scanline[i] += avg;
-         }
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-         {
-            uint8_t avg = (pngp->decoded_scanline[i - pngp->bpp] + pngp->prev_scanline[i]) >> 1;
-            pngp->decoded_scanline[i] += avg;
-         }
+         rpng_unfilter_avg(pngp->decoded_scanline, pngp->inflate_buf,
+               pngp->prev_scanline, pngp->pitch, pngp->bpp);
          break;
       case PNG_FILTER_PAETH:
-         memcpy(pngp->decoded_scanline, pngp->inflate_buf, pngp->pitch);
-         for (i = 0; i < pngp->bpp; i++)
-            pngp->decoded_scanline[i] += pngp->prev_scanline[i];
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] += paeth(pngp->decoded_scanline[i - pngp->bpp],
-                  pngp->prev_scanline[i], pngp->prev_scanline[i - pngp->bpp]);
+         rpng_unfilter_paeth(pngp->decoded_scanline, pngp->inflate_buf,
+               pngp->prev_scanline, pngp->pitch, pngp->bpp);
          break;
       default:
          return IMAGE_PROCESS_ERROR_END;
@@ -614,7 +817,8 @@ static int rpng_reverse_filter_copy_line(uint32_t *data,
          rpng_reverse_filter_copy_line_bw(data, pngp->decoded_scanline, ihdr->width, ihdr->depth);
          break;
       case PNG_IHDR_COLOR_RGB:
-         rpng_reverse_filter_copy_line_rgb(data, pngp->decoded_scanline, ihdr->width, ihdr->depth);
+         rpng_reverse_filter_copy_line_rgb(data, pngp->decoded_scanline, ihdr->width, ihdr->depth,
+               pngp->r_shift, pngp->b_shift);
          break;
       case PNG_IHDR_COLOR_PLT:
          rpng_reverse_filter_copy_line_plt(
@@ -626,15 +830,59 @@ static int rpng_reverse_filter_copy_line(uint32_t *data,
                ihdr->depth);
          break;
       case PNG_IHDR_COLOR_RGBA:
-         rpng_reverse_filter_copy_line_rgba(data, pngp->decoded_scanline, ihdr->width, ihdr->depth);
+         rpng_reverse_filter_copy_line_rgba(data, pngp->decoded_scanline, ihdr->width, ihdr->depth,
+               pngp->r_shift, pngp->b_shift);
          break;
    }
 
-   memcpy(pngp->prev_scanline, pngp->decoded_scanline, pngp->pitch);
+   /* This row is the one above the next */
+   swap                   = pngp->prev_scanline;
+   pngp->prev_scanline    = pngp->decoded_scanline;
+   pngp->decoded_scanline = swap;
 
    return IMAGE_PROCESS_NEXT;
 }
 
+/* Inflates until there are @len bytes of output, so each row is
+ * unfiltered while it is still in the cache. */
+static bool rpng_inflate_until(struct rpng_process *pngp, size_t len)
+{
+   while (pngp->total_out < len)
+   {
+      uint32_t rd, wn;
+      enum trans_stream_error err;
+      size_t out_len = len - pngp->total_out;
+
+      if (!pngp->stream || !pngp->avail_in || len > pngp->inflate_buf_size)
+         return false;
+
+      if (out_len < RPNG_INFLATE_CHUNK_SIZE)
+         out_len = RPNG_INFLATE_CHUNK_SIZE;
+      if (out_len > pngp->inflate_buf_size - pngp->total_out)
+         out_len = pngp->inflate_buf_size - pngp->total_out;
+
+      pngp->stream_backend->set_out(pngp->stream,
+            pngp->inflate_buf_start + pngp->total_out, (uint32_t)out_len);
+      if (     !pngp->stream_backend->trans(pngp->stream, false, &rd, &wn, &err)
+            && err != TRANS_STREAM_ERROR_BUFFER_FULL)
+         return false;
+
+      pngp->avail_in  -= rd;
+      pngp->avail_out -= wn;
+      pngp->total_out += wn;
+
+      /* End of the zlib stream */
+      if (err == TRANS_STREAM_ERROR_NONE)
+      {
+         pngp->stream_backend->stream_free(pngp->stream);
+         pngp->stream = NULL;
+      }
+      else if (!rd && !wn)
+         return false;
+   }
+   return true;
+}
+
 static int rpng_reverse_filter_regular_iterate(
       uint32_t **data, const struct png_ihdr *ihdr,
       struct rpng_process *pngp)
@@ -642,7 +890,21 @@ static int rpng_reverse_filter_regular_iterate(
    int ret = IMAGE_PROCESS_END;
    if (pngp->h < ihdr->height)
    {
-      unsigned filter         = *pngp->inflate_buf++;
+      unsigned filter;
+      if (     (pngp->flags & RPNG_PROCESS_FLAG_INFLATE_BY_ROW)
+            && !rpng_inflate_until(pngp,
+                  pngp->restore_buf_size + 1 + pngp->pitch))
+      {
+         /* Truncated or corrupt; the image is given up whole,
+          * as it was when all of it was inflated first */
+         rpng_reverse_filter_deinit(pngp);
+         pngp->inflate_buf          -= pngp->restore_buf_size;
+         free(*data - pngp->data_restore_buf_size);
+         *data                       = NULL;
+         pngp->data_restore_buf_size = 0;
+         return IMAGE_PROCESS_ERROR;
+      }
+      filter                  = *pngp->inflate_buf++;
       pngp->restore_buf_size += 1;
       ret                     = rpng_reverse_filter_copy_line(*data,
             ihdr, pngp, filter);
@@ -759,6 +1021,15 @@ static int rpng_load_image_argb_process_inflate_init(
    bool to_continue        = (process->avail_in > 0
          && process->avail_out > 0);
 
+   /* Adam7 passes are unfiltered one after the other, each
+    * needing all of its rows, so only a plain image can be
+    * inflated a row at a time */
+   if (rpng->ihdr.interlace == 0)
+   {
+      process->flags |= RPNG_PROCESS_FLAG_INFLATE_BY_ROW;
+      goto alloc;
+   }
+
    if (!to_continue)
       goto end;
 
@@ -778,6 +1049,7 @@ end:
    process->stream_backend->stream_free(process->stream);
    process->stream = NULL;
 
+alloc:
 #ifdef GEKKO
    /* we often use these in textures, make sure they're 32-byte aligned */
    *data = (uint32_t*)memalign(32, rpng->ihdr.width *
@@ -793,6 +1065,17 @@ end:
    process->restore_buf_size       = 0;
    process->palette                = rpng->palette;
 
+   if (rpng->flags & RPNG_FLAG_ABGR)
+   {
+      unsigned i;
+      for (i = 0; i < ARRAY_SIZE(rpng->palette); i++)
+      {
+         uint32_t col     = rpng->palette[i];
+         rpng->palette[i] = (col & 0xff00ff00) | ((col & 0xff) << 16)
+            | ((col >> 16) & 0xff);
+      }
+   }
+
    if (rpng->ihdr.interlace != 1)
       if (rpng_reverse_filter_init(&rpng->ihdr, process) == -1)
          goto false_end;
@@ -829,6 +1112,9 @@ static struct rpng_process *rpng_process_init(rpng_t *rpng)
    process->prev_scanline          = NULL;
    process->decoded_scanline       = NULL;
    process->inflate_buf            = NULL;
+   process->inflate_buf_start      = NULL;
+   process->r_shift                = (rpng->flags & RPNG_FLAG_ABGR) ? 0  : 16;
+   process->b_shift                = (rpng->flags & RPNG_FLAG_ABGR) ? 16 : 0;
 
    process->ihdr.width             = 0;
    process->ihdr.height            = 0;
@@ -874,8 +1160,9 @@ static struct rpng_process *rpng_process_init(rpng_t *rpng)
    if (!inflate_buf)
       goto error;
 
-   process->inflate_buf = inflate_buf;
-   process->avail_in    = rpng->idat_buf.size;
+   process->inflate_buf       = inflate_buf;
+   process->inflate_buf_start = inflate_buf;
+   process->avail_in          = rpng->idat_buf.size;
    process->avail_out   = process->inflate_buf_size;
 
    process->stream_backend->set_in(
@@ -1230,6 +1517,16 @@ bool rpng_is_valid(rpng_t *rpng)
 RPNG_FLAG_HAS_IEND)) > 0));
 }
 
+void rpng_set_output_abgr(rpng_t *rpng, bool abgr)
+{
+   if (!rpng)
+      return;
+   if (abgr)
+      rpng->flags |=  RPNG_FLAG_ABGR;
+   else
+      rpng->flags &= ~RPNG_FLAG_ABGR;
+}
+
 bool rpng_set_buf_ptr(rpng_t *rpng, void *data, size_t len)
 {
    if (!rpng || (len < 1))
@@ -31,6 +31,18 @@
 
 #include "rpng_internal.h"
 
+#ifdef HAVE_THREADS
+#include <rthreads/tpool.h>
+#include <features/features_cpu.h>
+#endif
+
+/* Bands an image is split into to encode in parallel, and
+ * the fewest rows worth a band of their own
+ * > Bands are deflated separately and joined with sync
+ *   flushes, which compresses slightly worse */
+#define RPNG_MAX_BANDS     8
+#define RPNG_BAND_MIN_ROWS 64
+
 #undef GOTO_END_ERROR
 #define GOTO_END_ERROR() do { \
    fprintf(stderr, "[RPNG] Error in line %d.\n", __LINE__); \
@@ -202,67 +214,121 @@ static unsigned filter_paeth(uint8_t *target,
    return count_sad(target, width);
 }
 
-bool rpng_save_image_stream(const uint8_t *data, intfstream_t* intf_s,
-      unsigned width, unsigned height, signed pitch, unsigned bpp)
+/* One horizontal band of the image, filtered and deflated
+ * on its own so that bands can be encoded in parallel */
+struct rpng_band
 {
-   unsigned h;
-   struct png_ihdr ihdr = {0};
-   bool ret = true;
-   const struct trans_stream_backend *stream_backend = NULL;
-   size_t encode_buf_size  = 0;
-   uint8_t *encode_buf     = NULL;
-   uint8_t *deflate_buf    = NULL;
-   uint8_t *rgba_line      = NULL;
-   uint8_t *up_filtered    = NULL;
-   uint8_t *sub_filtered   = NULL;
-   uint8_t *avg_filtered   = NULL;
-   uint8_t *paeth_filtered = NULL;
-   uint8_t *prev_encoded   = NULL;
-   uint8_t *encode_target  = NULL;
-   void *stream            = NULL;
-   uint32_t total_in       = 0;
-   uint32_t total_out      = 0;
+   const struct trans_stream_backend *backend;
+   /* First row of the band, and the row above it
+    * (NULL for the top band) */
+   const uint8_t *data;
+   const uint8_t *prev_data;
+   uint8_t *encoded;
+   uint8_t *out;
+   size_t encoded_size;
+   size_t out_size;
+   uint32_t written;
+   uint32_t adler;
+   signed pitch;
+   unsigned width;
+   unsigned rows;
+   unsigned bpp;
+   /* Raw deflate ending in a sync flush (or the final
+    * block for the last band), joined into one zlib
+    * stream by the caller. Otherwise the band is the
+    * whole image and becomes a complete zlib stream. */
+   bool raw;
+   bool last;
+   bool ok;
+};
+
+#define RPNG_ADLER_BASE 65521
+
+static uint32_t png_adler32(uint32_t adler, const uint8_t *data, size_t len)
+{
+   uint32_t a = adler & 0xffff;
+   uint32_t b = adler >> 16;
 
-   if (!intf_s)
-      GOTO_END_ERROR();
+   while (len)
+   {
+      /* Largest run that can't overflow 32 bits */
+      size_t run = len < 5552 ? len : 5552;
+      len       -= run;
+      while (run--)
+      {
+         a += *data++;
+         b += a;
+      }
+      a %= RPNG_ADLER_BASE;
+      b %= RPNG_ADLER_BASE;
+   }
 
-   stream_backend = trans_stream_get_zlib_deflate_backend();
+   return a | (b << 16);
+}
 
-   if (intfstream_write(intf_s, png_magic, sizeof(png_magic)) != sizeof(png_magic))
-      GOTO_END_ERROR();
+/* Adler-32 of two pieces of data, given that of each and the
+ * length of the second (as zlib's adler32_combine) */
+static uint32_t png_adler32_combine(uint32_t adler1, uint32_t adler2,
+      size_t len2)
+{
+   uint32_t rem  = (uint32_t)(len2 % RPNG_ADLER_BASE);
+   uint32_t sum1 = adler1 & 0xffff;
+   uint32_t sum2 = (rem * sum1) % RPNG_ADLER_BASE;
+
+   sum1 += (adler2 & 0xffff) + RPNG_ADLER_BASE - 1;
+   sum2 += (adler1 >> 16) + (adler2 >> 16) + RPNG_ADLER_BASE - rem;
+   if (sum1 >= RPNG_ADLER_BASE)
+      sum1 -= RPNG_ADLER_BASE;
+   if (sum1 >= RPNG_ADLER_BASE)
+      sum1 -= RPNG_ADLER_BASE;
+   if (sum2 >= (RPNG_ADLER_BASE << 1))
+      sum2 -= (RPNG_ADLER_BASE << 1);
+   if (sum2 >= RPNG_ADLER_BASE)
+      sum2 -= RPNG_ADLER_BASE;
+
+   return sum1 | (sum2 << 16);
+}
 
-   ihdr.width = width;
-   ihdr.height = height;
-   ihdr.depth = 8;
-   ihdr.color_type = bpp == sizeof(uint32_t) ? 6 : 2; /* RGBA or RGB */
-   if (!png_write_ihdr_string(intf_s, &ihdr))
-      GOTO_END_ERROR();
+static void rpng_encode_band(void *data)
+{
+   unsigned h;
+   struct rpng_band *band  = (struct rpng_band*)data;
+   const uint8_t *line     = band->data;
+   unsigned width          = band->width;
+   unsigned bpp            = band->bpp;
+   uint8_t *encode_target  = band->encoded;
+   uint8_t *prev_encoded   = (uint8_t*)calloc(1, width * bpp);
+   uint8_t *rgba_line      = (uint8_t*)malloc(width * bpp);
+   uint8_t *up_filtered    = (uint8_t*)malloc(width * bpp);
+   uint8_t *sub_filtered   = (uint8_t*)malloc(width * bpp);
+   uint8_t *avg_filtered   = (uint8_t*)malloc(width * bpp);
+   uint8_t *paeth_filtered = (uint8_t*)malloc(width * bpp);
+   void *stream            = NULL;
+   uint32_t total_in       = 0;
 
-   encode_buf_size = (width * bpp + 1) * height;
-   encode_buf      = (uint8_t*)malloc(encode_buf_size);
-   if (!encode_buf)
-      GOTO_END_ERROR();
+   band->ok                = false;
 
-   prev_encoded = (uint8_t*)calloc(1, width * bpp);
-   if (!prev_encoded)
-      GOTO_END_ERROR();
+   if (     !prev_encoded || !rgba_line || !up_filtered
+         || !sub_filtered || !avg_filtered || !paeth_filtered)
+      goto end;
 
-   rgba_line      = (uint8_t*)malloc(width * bpp);
-   up_filtered    = (uint8_t*)malloc(width * bpp);
-   sub_filtered   = (uint8_t*)malloc(width * bpp);
-   avg_filtered   = (uint8_t*)malloc(width * bpp);
-   paeth_filtered = (uint8_t*)malloc(width * bpp);
-   if (!rgba_line || !up_filtered || !sub_filtered || !avg_filtered || !paeth_filtered)
-      GOTO_END_ERROR();
+   /* Filters look at the row above, which belongs to the
+    * band before */
+   if (band->prev_data)
+   {
+      if (bpp == sizeof(uint32_t))
+         copy_argb_line(prev_encoded, (const uint32_t*)band->prev_data, width);
+      else
+         copy_bgr24_line(prev_encoded, band->prev_data, width);
+   }
 
-   encode_target = encode_buf;
-   for (h = 0; h < height;
-         h++, encode_target += width * bpp, data += pitch)
+   for (h = 0; h < band->rows;
+         h++, encode_target += width * bpp, line += band->pitch)
    {
       if (bpp == sizeof(uint32_t))
-         copy_argb_line(rgba_line, (const uint32_t*)data, width);
+         copy_argb_line(rgba_line, (const uint32_t*)line, width);
       else
-         copy_bgr24_line(rgba_line, data, width);
+         copy_bgr24_line(rgba_line, line, width);
 
       /* Try every filtering method, and choose the method
        * which has most entries as zero.
@@ -315,52 +381,187 @@ bool rpng_save_image_stream(const uint8_t *data, intfstream_t* intf_s,
       }
    }
 
-   deflate_buf = (uint8_t*)malloc(encode_buf_size * 2); /* Just to be sure. */
-   if (!deflate_buf)
-      GOTO_END_ERROR();
-
-   stream = stream_backend->stream_new();
-
-   if (!stream)
-      GOTO_END_ERROR();
+   if (!(stream = band->backend->stream_new()))
+      goto end;
 
-   stream_backend->set_in(
-         stream,
-         encode_buf,
-         (unsigned)encode_buf_size);
-   stream_backend->set_out(
-         stream,
-         deflate_buf + 8,
-         (unsigned)(encode_buf_size * 2));
+   if (band->raw)
+   {
+      band->adler = png_adler32(1, band->encoded, band->encoded_size);
+      band->backend->define(stream, "window_bits", (uint32_t)-15);
+      if (!band->last)
+         band->backend->define(stream, "sync_flush", 1);
+   }
 
-   if (!stream_backend->trans(stream, true, &total_in, &total_out, NULL))
-      GOTO_END_ERROR();
+   band->backend->set_in(stream, band->encoded,
+         (uint32_t)band->encoded_size);
+   band->backend->set_out(stream, band->out,
+         (uint32_t)band->out_size);
 
-   memcpy(deflate_buf + 4, "IDAT", 4);
-   dword_write_be(deflate_buf + 0,        ((uint32_t)total_out));
-   if (!png_write_idat_string(intf_s, deflate_buf, ((size_t)total_out + 8)))
-      GOTO_END_ERROR();
+   band->ok = band->backend->trans(stream, true,
+         &total_in, &band->written, NULL)
+      && (total_in == band->encoded_size);
 
-   if (!png_write_iend_string(intf_s))
-      GOTO_END_ERROR();
 end:
-   free(encode_buf);
-   free(deflate_buf);
-   free(rgba_line);
+   if (stream)
+      band->backend->stream_free(stream);
    free(prev_encoded);
+   free(rgba_line);
    free(up_filtered);
    free(sub_filtered);
    free(avg_filtered);
    free(paeth_filtered);
+}
+
+/* Number of bands to encode an image of 'height' rows in
+ * > One per core, if there are cores to spare and
+ *   enough rows to go round */
+static unsigned rpng_get_bands(unsigned height)
+{
+#ifdef HAVE_THREADS
+   unsigned bands = cpu_features_get_core_amount();
+   if (bands > RPNG_MAX_BANDS)
+      bands = RPNG_MAX_BANDS;
+   if (bands > height / RPNG_BAND_MIN_ROWS)
+      bands = height / RPNG_BAND_MIN_ROWS;
+   if (bands > 1)
+      return bands;
+#endif
+   return 1;
+}
+
+bool rpng_save_image_stream(const uint8_t *data, intfstream_t* intf_s,
+      unsigned width, unsigned height, signed pitch, unsigned bpp)
+{
+   unsigned i;
+   struct png_ihdr ihdr = {0};
+   struct rpng_band bands[RPNG_MAX_BANDS];
+   bool ret = true;
+   const struct trans_stream_backend *stream_backend = NULL;
+   size_t encode_buf_size  = 0;
+   size_t line_size        = width * bpp + 1;
+   uint8_t *encode_buf     = NULL;
+   uint8_t *deflate_buf    = NULL;
+   unsigned num_bands      = rpng_get_bands(height);
+   unsigned row            = 0;
+   uint32_t adler          = 1;
+#ifdef HAVE_THREADS
+   tpool_t *pool           = NULL;
+#endif
+
+   if (!intf_s)
+      GOTO_END_ERROR();
+
+   stream_backend = trans_stream_get_zlib_deflate_backend();
+
+   if (intfstream_write(intf_s, png_magic, sizeof(png_magic)) != sizeof(png_magic))
+      GOTO_END_ERROR();
+
+   ihdr.width = width;
+   ihdr.height = height;
+   ihdr.depth = 8;
+   ihdr.color_type = bpp == sizeof(uint32_t) ? 6 : 2; /* RGBA or RGB */
+   if (!png_write_ihdr_string(intf_s, &ihdr))
+      GOTO_END_ERROR();
+
+   encode_buf_size = line_size * height;
+   encode_buf      = (uint8_t*)malloc(encode_buf_size);
+   if (!encode_buf)
+      GOTO_END_ERROR();
+
+   /* Each band's output starts with room for an IDAT chunk
+    * header plus the zlib header, and ends with room for the
+    * Adler-32 trailer */
+   deflate_buf = (uint8_t*)malloc(encode_buf_size * 2 /* Just to be sure. */
+         + num_bands * (8 + 2 + 4));
+   if (!deflate_buf)
+      GOTO_END_ERROR();
 
-   if (stream_backend)
+   for (i = 0; i < num_bands; i++)
    {
-      if (stream)
+      struct rpng_band *band = &bands[i];
+      unsigned rows          = height / num_bands
+         + (i < height % num_bands ? 1 : 0);
+
+      band->backend      = stream_backend;
+      band->data         = data + (ptrdiff_t)pitch * row;
+      band->prev_data    = row ? band->data - pitch : NULL;
+      band->encoded      = encode_buf + line_size * row;
+      band->encoded_size = line_size * rows;
+      band->out          = deflate_buf + 2 * line_size * row
+         + i * (8 + 2 + 4) + 8 + 2;
+      band->out_size     = 2 * band->encoded_size;
+      band->written      = 0;
+      band->adler        = 1;
+      band->pitch        = pitch;
+      band->width        = width;
+      band->rows         = rows;
+      band->bpp          = bpp;
+      band->raw          = num_bands > 1;
+      band->last         = i == num_bands - 1;
+      band->ok           = false;
+      row               += rows;
+   }
+
+#ifdef HAVE_THREADS
+   if (num_bands > 1 && (pool = tpool_create(num_bands - 1)))
+   {
+      /* This thread takes the first band itself */
+      for (i = 1; i < num_bands; i++)
+         if (!tpool_add_work(pool, rpng_encode_band, &bands[i]))
+            rpng_encode_band(&bands[i]);
+      rpng_encode_band(&bands[0]);
+      tpool_wait(pool);
+      tpool_destroy(pool);
+   }
+   else
+#endif
+      for (i = 0; i < num_bands; i++)
+         rpng_encode_band(&bands[i]);
+
+   for (i = 0; i < num_bands; i++)
+   {
+      struct rpng_band *band = &bands[i];
+      uint8_t *chunk         = band->out;
+      size_t chunk_len       = band->written;
+
+      if (!band->ok)
+         GOTO_END_ERROR();
+
+      if (band->raw)
       {
-         if (stream_backend->stream_free)
-            stream_backend->stream_free(stream);
+         adler = png_adler32_combine(adler, band->adler,
+               band->encoded_size);
+
+         /* zlib header for the default window and the
+          * best compression level */
+         if (i == 0)
+         {
+            chunk     -= 2;
+            chunk[0]   = 0x78;
+            chunk[1]   = 0xda;
+            chunk_len += 2;
+         }
+
+         if (band->last)
+         {
+            dword_write_be(chunk + chunk_len, adler);
+            chunk_len += 4;
+         }
       }
+
+      /* An IDAT chunk per band; decoders join them */
+      chunk -= 8;
+      memcpy(chunk + 4, "IDAT", 4);
+      dword_write_be(chunk + 0, (uint32_t)chunk_len);
+      if (!png_write_idat_string(intf_s, chunk, chunk_len + 8))
+         GOTO_END_ERROR();
    }
+
+   if (!png_write_iend_string(intf_s))
+      GOTO_END_ERROR();
+end:
+   free(encode_buf);
+   free(deflate_buf);
    return ret;
 }
 
@@ -57,6 +57,10 @@ void conv_rgb565_0rgb1555(void *output_, const void *input_,
    int max_width           = width - 7;
    const __m128i hi_mask   = _mm_set1_epi16(0x7fe0);
    const __m128i lo_mask   = _mm_set1_epi16(0x1f);
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON))
+   int max_width           = width - 7;
+   const uint16x8_t hi_mask = vdupq_n_u16(0x7fe0);
+   const uint16x8_t lo_mask = vdupq_n_u16(0x1f);
 #endif
 
    for (h = 0; h < height;
@@ -67,10 +71,18 @@ void conv_rgb565_0rgb1555(void *output_, const void *input_,
       for (; w < max_width; w += 8)
       {
          const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
-         __m128i hi = _mm_and_si128(_mm_slli_epi16(in, 1), hi_mask);
+         __m128i hi = _mm_and_si128(_mm_srli_epi16(in, 1), hi_mask);
          __m128i lo = _mm_and_si128(in, lo_mask);
          _mm_storeu_si128((__m128i*)(output + w), _mm_or_si128(hi, lo));
       }
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON))
+      for (; w < max_width; w += 8)
+      {
+         uint16x8_t in = vld1q_u16(input + w);
+         uint16x8_t hi = vandq_u16(vshrq_n_u16(in, 1), hi_mask);
+         uint16x8_t lo = vandq_u16(in, lo_mask);
+         vst1q_u16(output + w, vorrq_u16(hi, lo));
+      }
 #endif
 
       for (; w < width; w++)
@@ -98,6 +110,11 @@ void conv_0rgb1555_rgb565(void *output_, const void *input_,
          (int16_t)((0x1f << 11) | (0x1f << 6)));
    const __m128i lo_mask   = _mm_set1_epi16(0x1f);
    const __m128i glow_mask = _mm_set1_epi16(1 << 5);
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON))
+   int max_width            = width - 7;
+   const uint16x8_t hi_mask   = vdupq_n_u16((0x1f << 11) | (0x1f << 6));
+   const uint16x8_t lo_mask   = vdupq_n_u16(0x1f);
+   const uint16x8_t glow_mask = vdupq_n_u16(1 << 5);
 #endif
 
    for (h = 0; h < height;
@@ -114,6 +131,15 @@ void conv_0rgb1555_rgb565(void *output_, const void *input_,
          _mm_storeu_si128((__m128i*)(output + w),
                _mm_or_si128(rg, _mm_or_si128(b, glow)));
       }
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON))
+      for (; w < max_width; w += 8)
+      {
+         uint16x8_t in   = vld1q_u16(input + w);
+         uint16x8_t rg   = vandq_u16(vshlq_n_u16(in, 1), hi_mask);
+         uint16x8_t b    = vandq_u16(in, lo_mask);
+         uint16x8_t glow = vandq_u16(vshrq_n_u16(in, 4), glow_mask);
+         vst1q_u16(output + w, vorrq_u16(rg, vorrq_u16(b, glow)));
+      }
 #endif
 
       for (; w < width; w++)
@@ -402,24 +428,62 @@ void conv_argb8888_rgba4444(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
-   int h, w;
+   int h;
    const uint32_t *input = (const uint32_t*)input_;
    uint16_t *output      = (uint16_t*)output_;
 
+#if defined(__SSE2__)
+   const __m128i r_mask  = _mm_set1_epi32(0xf000);
+   const __m128i g_mask  = _mm_set1_epi32(0x0f00);
+   const __m128i b_mask  = _mm_set1_epi32(0x00f0);
+   int max_width         = width - 7;
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON))
+   int max_width         = width - 7;
+#endif
+
    for (h = 0; h < height;
-         h++, output += out_stride >> 2, input += in_stride >> 1)
+         h++, output += out_stride >> 1, input += in_stride >> 2)
    {
-      for (w = 0; w < width; w++)
+      int w = 0;
+#if defined(__SSE2__)
+      for (; w < max_width; w += 8)
+      {
+         __m128i res[2];
+         int i;
+
+         for (i = 0; i < 2; i++)
+         {
+            const __m128i in = _mm_loadu_si128(
+                  (const __m128i*)(input + w + i * 4));
+            __m128i r = _mm_and_si128(_mm_srli_epi32(in,  8), r_mask);
+            __m128i g = _mm_and_si128(_mm_srli_epi32(in,  4), g_mask);
+            __m128i b = _mm_and_si128(in, b_mask);
+            __m128i a = _mm_srli_epi32(in, 28);
+            /* Sign extend, so the pack below doesn't saturate */
+            res[i]    = _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, a));
+            res[i]    = _mm_srai_epi32(_mm_slli_epi32(res[i], 16), 16);
+         }
+
+         _mm_storeu_si128((__m128i*)(output + w),
+               _mm_packs_epi32(res[0], res[1]));
+      }
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON))
+      for (; w < max_width; w += 8)
+      {
+         uint8x8x4_t in = vld4_u8((const uint8_t*)(input + w));
+         uint8x8_t   rg = vsri_n_u8(in.val[2], in.val[1], 4);
+         uint8x8_t   ba = vsri_n_u8(in.val[0], in.val[3], 4);
+         vst1q_u16(output + w, vorrq_u16(vshll_n_u8(rg, 8), vmovl_u8(ba)));
+      }
+#endif
+
+      for (; w < width; w++)
       {
          uint32_t col = input[w];
-         uint32_t r   = (col >> 16) & 0xf;
-         uint32_t g   = (col >>  8) & 0xf;
-         uint32_t b   = (col) & 0xf;
-         uint32_t a   = (col >>  24) & 0xf;
-         r            = (r >> 4) | r;
-         g            = (g >> 4) | g;
-         b            = (b >> 4) | b;
-         a            = (a >> 4) | a;
+         uint32_t r   = (col >> 20) & 0xf;
+         uint32_t g   = (col >> 12) & 0xf;
+         uint32_t b   = (col >>  4) & 0xf;
+         uint32_t a   = (col >> 28) & 0xf;
 
          output[w]    = (r << 12) | (g << 8) | (b << 4) | a;
       }
@@ -502,14 +566,48 @@ void conv_rgba4444_rgb565(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
-   int h, w;
+   int h;
    const uint16_t *input = (const uint16_t*)input_;
    uint16_t *output      = (uint16_t*)output_;
 
+#if defined(__SSE2__)
+   const __m128i r_mask  = _mm_set1_epi16((int16_t)0xf000);
+   const __m128i g_mask  = _mm_set1_epi16(0x0780);
+   const __m128i b_mask  = _mm_set1_epi16(0x001e);
+   int max_width         = width - 7;
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON))
+   const uint16x8_t r_mask = vdupq_n_u16(0xf000);
+   const uint16x8_t g_mask = vdupq_n_u16(0x0780);
+   const uint16x8_t b_mask = vdupq_n_u16(0x001e);
+   int max_width           = width - 7;
+#endif
+
    for (h = 0; h < height;
          h++, output += out_stride >> 1, input += in_stride >> 1)
    {
-      for (w = 0; w < width; w++)
+      int w = 0;
+#if defined(__SSE2__)
+      for (; w < max_width; w += 8)
+      {
+         const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
+         __m128i r = _mm_and_si128(in, r_mask);
+         __m128i g = _mm_and_si128(_mm_srli_epi16(in, 1), g_mask);
+         __m128i b = _mm_and_si128(_mm_srli_epi16(in, 3), b_mask);
+         _mm_storeu_si128((__m128i*)(output + w),
+               _mm_or_si128(r, _mm_or_si128(g, b)));
+      }
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON))
+      for (; w < max_width; w += 8)
+      {
+         uint16x8_t in = vld1q_u16(input + w);
+         uint16x8_t r  = vandq_u16(in, r_mask);
+         uint16x8_t g  = vandq_u16(vshrq_n_u16(in, 1), g_mask);
+         uint16x8_t b  = vandq_u16(vshrq_n_u16(in, 3), b_mask);
+         vst1q_u16(output + w, vorrq_u16(r, vorrq_u16(g, b)));
+      }
+#endif
+
+      for (; w < width; w++)
       {
          uint32_t col = input[w];
          uint32_t r   = (col >> 12) & 0xf;
@@ -743,15 +841,32 @@ void conv_bgr24_argb8888(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
-   int h, w;
+   int h;
    const uint8_t *input = (const uint8_t*)input_;
    uint32_t *output     = (uint32_t*)output_;
+#if (defined(__ARM_NEON__) || defined(__ARM_NEON))
+   int max_width        = width - 15;
+#endif
 
    for (h = 0; h < height;
          h++, output += out_stride >> 2, input += in_stride)
    {
       const uint8_t *inp = input;
-      for (w = 0; w < width; w++)
+      int              w = 0;
+#if (defined(__ARM_NEON__) || defined(__ARM_NEON))
+      for (; w < max_width; w += 16, inp += 48)
+      {
+         uint8x16x3_t in = vld3q_u8(inp);
+         uint8x16x4_t res;
+         res.val[0]      = in.val[0];
+         res.val[1]      = in.val[1];
+         res.val[2]      = in.val[2];
+         res.val[3]      = vdupq_n_u8(0xffu);
+         vst4q_u8((uint8_t*)(output + w), res);
+      }
+#endif
+
+      for (; w < width; w++)
       {
          uint32_t b = *inp++;
          uint32_t g = *inp++;
@@ -765,14 +880,32 @@ void conv_bgr24_rgb565(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
-   int h, w;
+   int h;
    const uint8_t *input = (const uint8_t*)input_;
    uint16_t *output     = (uint16_t*)output_;
+#if (defined(__ARM_NEON__) || defined(__ARM_NEON))
+   const uint16x8_t r_mask = vdupq_n_u16(0xf800);
+   const uint16x8_t g_mask = vdupq_n_u16(0x07e0);
+   int max_width           = width - 7;
+#endif
+
    for (h = 0; h < height;
-         h++, output += out_stride, input += in_stride)
+         h++, output += out_stride >> 1, input += in_stride)
    {
       const uint8_t *inp = input;
-      for (w = 0; w < width; w++)
+      int              w = 0;
+#if (defined(__ARM_NEON__) || defined(__ARM_NEON))
+      for (; w < max_width; w += 8, inp += 24)
+      {
+         uint8x8x3_t in = vld3_u8(inp);
+         uint16x8_t  r  = vandq_u16(vshll_n_u8(in.val[2], 8), r_mask);
+         uint16x8_t  g  = vandq_u16(vshll_n_u8(in.val[1], 3), g_mask);
+         uint16x8_t  b  = vmovl_u8(vshr_n_u8(in.val[0], 3));
+         vst1q_u16(output + w, vorrq_u16(r, vorrq_u16(g, b)));
+      }
+#endif
+
+      for (; w < width; w++)
       {
          uint16_t b = *inp++;
          uint16_t g = *inp++;
@@ -787,14 +920,56 @@ void conv_argb8888_0rgb1555(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
-   int h, w;
+   int h;
    const uint32_t *input = (const uint32_t*)input_;
    uint16_t *output      = (uint16_t*)output_;
 
+#if defined(__SSE2__)
+   const __m128i r_mask  = _mm_set1_epi32(0x1f << 10);
+   const __m128i g_mask  = _mm_set1_epi32(0x1f <<  5);
+   const __m128i b_mask  = _mm_set1_epi32(0x1f);
+   int max_width         = width - 7;
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON))
+   int max_width         = width - 7;
+#endif
+
    for (h = 0; h < height;
          h++, output += out_stride >> 1, input += in_stride >> 2)
    {
-      for (w = 0; w < width; w++)
+      int w = 0;
+#if defined(__SSE2__)
+      for (; w < max_width; w += 8)
+      {
+         __m128i res[2];
+         int i;
+
+         for (i = 0; i < 2; i++)
+         {
+            const __m128i in = _mm_loadu_si128(
+                  (const __m128i*)(input + w + i * 4));
+            __m128i r = _mm_and_si128(_mm_srli_epi32(in,  9), r_mask);
+            __m128i g = _mm_and_si128(_mm_srli_epi32(in,  6), g_mask);
+            __m128i b = _mm_and_si128(_mm_srli_epi32(in,  3), b_mask);
+            res[i]    = _mm_or_si128(r, _mm_or_si128(g, b));
+         }
+
+         /* 15 bits, so the signed pack is exact */
+         _mm_storeu_si128((__m128i*)(output + w),
+               _mm_packs_epi32(res[0], res[1]));
+      }
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON))
+      for (; w < max_width; w += 8)
+      {
+         uint8x8x4_t in = vld4_u8((const uint8_t*)(input + w));
+         uint16x8_t  r  = vmovl_u8(vshr_n_u8(in.val[2], 3));
+         uint16x8_t  g  = vshll_n_u8(vshr_n_u8(in.val[1], 3), 5);
+         uint16x8_t  b  = vmovl_u8(vshr_n_u8(in.val[0], 3));
+         vst1q_u16(output + w,
+               vorrq_u16(vshlq_n_u16(r, 10), vorrq_u16(g, b)));
+      }
+#endif
+
+      for (; w < width; w++)
       {
          uint32_t col = input[w];
          uint16_t r   = (col >> 19) & 0x1f;
@@ -805,6 +980,70 @@ void conv_argb8888_0rgb1555(void *output_, const void *input_,
    }
 }
 
+void conv_argb8888_rgb565(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+
+#if defined(__SSE2__)
+   const __m128i r_mask  = _mm_set1_epi32(0x1f << 11);
+   const __m128i g_mask  = _mm_set1_epi32(0x3f <<  5);
+   const __m128i b_mask  = _mm_set1_epi32(0x1f);
+   int max_width         = width - 7;
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON))
+   int max_width         = width - 7;
+#endif
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 2)
+   {
+      int w = 0;
+#if defined(__SSE2__)
+      for (; w < max_width; w += 8)
+      {
+         __m128i res[2];
+         int i;
+
+         for (i = 0; i < 2; i++)
+         {
+            const __m128i in = _mm_loadu_si128(
+                  (const __m128i*)(input + w + i * 4));
+            __m128i r = _mm_and_si128(_mm_srli_epi32(in,  8), r_mask);
+            __m128i g = _mm_and_si128(_mm_srli_epi32(in,  5), g_mask);
+            __m128i b = _mm_and_si128(_mm_srli_epi32(in,  3), b_mask);
+            /* Sign extend, so the pack below doesn't saturate */
+            res[i]    = _mm_or_si128(r, _mm_or_si128(g, b));
+            res[i]    = _mm_srai_epi32(_mm_slli_epi32(res[i], 16), 16);
+         }
+
+         _mm_storeu_si128((__m128i*)(output + w),
+               _mm_packs_epi32(res[0], res[1]));
+      }
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON))
+      for (; w < max_width; w += 8)
+      {
+         uint8x8x4_t in = vld4_u8((const uint8_t*)(input + w));
+         uint16x8_t  rg = vshll_n_u8(in.val[2], 8);
+         rg             = vsriq_n_u16(rg, vshll_n_u8(in.val[1], 8), 5);
+         rg             = vsriq_n_u16(rg, vshll_n_u8(in.val[0], 8), 11);
+         vst1q_u16(output + w, rg);
+      }
+#endif
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         uint16_t r   = (col >> 19) & 0x1f;
+         uint16_t g   = (col >> 10) & 0x3f;
+         uint16_t b   = (col >>  3) & 0x1f;
+         output[w]    = (r << 11) | (g << 5) | (b << 0);
+      }
+   }
+}
+
 void conv_argb8888_bgr24(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
@@ -813,7 +1052,7 @@ void conv_argb8888_bgr24(void *output_, const void *input_,
    const uint32_t *input = (const uint32_t*)input_;
    uint8_t *output       = (uint8_t*)output_;
 
-#if defined(__SSE2__)
+#if defined(__SSE2__) || (defined(__ARM_NEON__) || defined(__ARM_NEON))
    int max_width = width - 15;
 #endif
 
@@ -831,6 +1070,16 @@ void conv_argb8888_bgr24(void *output_, const void *input_,
          __m128i l3 = _mm_loadu_si128((const __m128i*)(input + w + 12));
          store_bgr24_sse2(out, l0, l1, l2, l3);
       }
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON))
+      for (; w < max_width; w += 16, out += 48)
+      {
+         uint8x16x4_t in = vld4q_u8((const uint8_t*)(input + w));
+         uint8x16x3_t res;
+         res.val[0]      = in.val[0];
+         res.val[1]      = in.val[1];
+         res.val[2]      = in.val[2];
+         vst3q_u8(out, res);
+      }
 #endif
 
       for (; w < width; w++)
@@ -866,7 +1115,7 @@ void conv_abgr8888_bgr24(void *output_, const void *input_,
    const uint32_t *input = (const uint32_t*)input_;
    uint8_t *output       = (uint8_t*)output_;
 
-#if defined(__SSE2__)
+#if defined(__SSE2__) || (defined(__ARM_NEON__) || defined(__ARM_NEON))
    int max_width = width - 15;
 #endif
 
@@ -888,6 +1137,16 @@ void conv_abgr8888_bgr24(void *output_, const void *input_,
          d = conv_shuffle_rb_epi32(d);
          store_bgr24_sse2(out, a, b, c, d);
       }
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON))
+      for (; w < max_width; w += 16, out += 48)
+      {
+         uint8x16x4_t in = vld4q_u8((const uint8_t*)(input + w));
+         uint8x16x3_t res;
+         res.val[0]      = in.val[2];
+         res.val[1]      = in.val[1];
+         res.val[2]      = in.val[0];
+         vst3q_u8(out, res);
+      }
 #endif
 
       for (; w < width; w++)
@@ -904,14 +1163,45 @@ void conv_argb8888_abgr8888(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
-   int h, w;
-   const uint32_t *input = (const uint32_t*)input_;
-   uint32_t *output      = (uint32_t*)output_;
+   int h;
+   const uint32_t *input  = (const uint32_t*)input_;
+   uint32_t *output       = (uint32_t*)output_;
+
+#if defined(__SSE2__)
+   const __m128i b_mask   = _mm_set1_epi32(0x000000ff);
+   const __m128i r_mask   = _mm_set1_epi32(0x00ff0000);
+   const __m128i ag_mask  = _mm_set1_epi32(0xff00ff00);
+   int max_width          = width - 3;
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON))
+   int max_width          = width - 15;
+#endif
 
    for (h = 0; h < height;
          h++, output += out_stride >> 2, input += in_stride >> 2)
    {
-      for (w = 0; w < width; w++)
+      int w = 0;
+#if defined(__SSE2__)
+      for (; w < max_width; w += 4)
+      {
+         const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
+         __m128i sl = _mm_and_si128(_mm_slli_epi32(in, 16), r_mask);
+         __m128i sr = _mm_and_si128(_mm_srli_epi32(in, 16), b_mask);
+         __m128i ag = _mm_and_si128(in, ag_mask);
+         _mm_storeu_si128((__m128i*)(output + w),
+               _mm_or_si128(ag, _mm_or_si128(sl, sr)));
+      }
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON))
+      for (; w < max_width; w += 16)
+      {
+         uint8x16x4_t in = vld4q_u8((const uint8_t*)(input + w));
+         uint8x16_t   r  = in.val[2];
+         in.val[2]       = in.val[0];
+         in.val[0]       = r;
+         vst4q_u8((uint8_t*)(output + w), in);
+      }
+#endif
+
+      for (; w < width; w++)
       {
          uint32_t col = input[w];
          output[w]    = ((col << 16) & 0xff0000) |
@@ -143,6 +143,7 @@ bool scaler_ctx_gen_filter(struct scaler_ctx *ctx)
                      break;
                   case SCALER_FMT_RGB565:
                      ctx->direct_pixconv = conv_bgr24_rgb565;
+                     break;
                   default:
                      break;
                }
@@ -162,6 +163,9 @@ bool scaler_ctx_gen_filter(struct scaler_ctx *ctx)
                   case SCALER_FMT_RGBA4444:
                      ctx->direct_pixconv = conv_argb8888_rgba4444;
                      break;
+                  case SCALER_FMT_RGB565:
+                     ctx->direct_pixconv = conv_argb8888_rgb565;
+                     break;
                   default:
                      break;
                }
@@ -250,6 +254,10 @@ bool scaler_ctx_gen_filter(struct scaler_ctx *ctx)
             ctx->out_pixconv = conv_argb8888_0rgb1555;
             break;
 
+         case SCALER_FMT_RGB565:
+            ctx->out_pixconv = conv_argb8888_rgb565;
+            break;
+
          case SCALER_FMT_BGR24:
             ctx->out_pixconv = conv_argb8888_bgr24;
             break;
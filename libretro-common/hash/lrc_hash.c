@@ -307,21 +307,6 @@ uint32_t crc32_calculate(const uint8_t *data, size_t len)
 /* Define the circular shift macro */
 #define SHA1CircularShift(bits,word) ((((word) << (bits)) & 0xFFFFFFFF) | ((word) >> (32-(bits))))
 
-struct sha1_context
-{
-   unsigned Message_Digest[5]; /* Message Digest (output)          */
-
-   unsigned Length_Low;        /* Message length in bits           */
-   unsigned Length_High;       /* Message length in bits           */
-
-   unsigned char Message_Block[64]; /* 512-bit message blocks      */
-   int Message_Block_Index;    /* Index into message block array   */
-
-   int Computed;               /* Is the digest computed?          */
-   int Corrupted;              /* Is the message digest corruped?  */
-};
-
-
 static void SHA1Reset(struct sha1_context *context)
 {
    if (!context)
@@ -509,15 +494,27 @@ static void SHA1Input(struct sha1_context *context,
       return;
    }
 
-   while (len-- && !context->Corrupted)
+   /* Fill the message block a block at a time rather than a byte
+    * at a time */
+   while (len && !context->Corrupted)
    {
-      context->Message_Block[context->Message_Block_Index++] =
-         (*message_array & 0xFF);
+      unsigned chunk = 64 - context->Message_Block_Index;
+      unsigned bits;
+
+      if (chunk > len)
+         chunk = len;
+
+      memcpy(context->Message_Block + context->Message_Block_Index,
+            message_array, chunk);
+      context->Message_Block_Index += chunk;
+      message_array                += chunk;
+      len                          -= chunk;
 
-      context->Length_Low += 8;
+      bits                 = chunk << 3;
+      context->Length_Low += bits;
       /* Force it to 32 bits */
       context->Length_Low &= 0xFFFFFFFF;
-      if (context->Length_Low == 0)
+      if (context->Length_Low < bits)
       {
          context->Length_High++;
          /* Force it to 32 bits */
@@ -528,8 +525,6 @@ static void SHA1Input(struct sha1_context *context,
 
       if (context->Message_Block_Index == 64)
          SHA1ProcessMessageBlock(context);
-
-      message_array++;
    }
 }
 
@@ -548,6 +543,31 @@ void SHA1Digest(const uint8_t* data, size_t len, uint8_t digest[20])
 #endif
 }
 
+void sha1_init(struct sha1_context *context)
+{
+   SHA1Reset(context);
+}
+
+void sha1_update(struct sha1_context *context,
+      const void *data, size_t len)
+{
+   const unsigned char *bytes = (const unsigned char*)data;
+
+   /* SHA1Input takes at most an unsigned worth at a time */
+   while (len > 0)
+   {
+      unsigned chunk = len > 0x40000000 ? 0x40000000 : (unsigned)len;
+      SHA1Input(context, bytes, chunk);
+      bytes += chunk;
+      len   -= chunk;
+   }
+}
+
+int sha1_final(struct sha1_context *context, uint8_t digest[20])
+{
+   return SHA1Result(context, digest);
+}
+
 int sha1_calculate(const char *path, char *result)
 {
    struct sha1_context sha;
@@ -58,6 +58,9 @@ typedef void (*audio_mixer_stop_cb_t)(audio_mixer_sound_t* sound, unsigned reaso
 #define AUDIO_MIXER_SOUND_STOPPED  1
 #define AUDIO_MIXER_SOUND_REPEATED 2
 
+/* Streaming voices (OGG, MOD, FLAC, MP3) are decoded ahead of the mix,
+ * on a thread of their own when built with threads. Voices must still
+ * be played, stopped and mixed from one thread. */
 void audio_mixer_init(unsigned rate);
 
 void audio_mixer_done(void);
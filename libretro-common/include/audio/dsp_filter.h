@@ -24,6 +24,7 @@
 #define __LIBRETRO_SDK_AUDIO_DSP_FILTER_H
 
 #include <retro_common_api.h>
+#include <boolean.h>
 
 RETRO_BEGIN_DECLS
 
@@ -47,9 +48,24 @@ struct retro_dsp_data
    unsigned output_frames;
 };
 
+/* Runs the input through the chain in blocks of a few hundred frames. */
 void retro_dsp_filter_process(retro_dsp_filter_t *dsp,
       struct retro_dsp_data *data);
 
+/**
+ * retro_dsp_filter_get_load:
+ * @dsp                  : the filter chain
+ * @index                : position of the filter in the chain
+ * @ident                : set to the filter's name
+ * @load                 : set to the share of real time the filter
+ *                         took over the last half second of audio,
+ *                         in percent
+ *
+ * Returns: false if the chain has no filter at @index.
+ **/
+bool retro_dsp_filter_get_load(retro_dsp_filter_t *dsp, unsigned index,
+      const char **ident, float *load);
+
 RETRO_END_DECLS
 
 #endif
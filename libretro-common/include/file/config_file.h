@@ -294,6 +294,71 @@ bool config_get_path(config_file_t *conf, const char *entry, char *s, size_t len
  **/
 bool config_get_bool(config_file_t *conf, const char *entry, bool *in);
 
+enum config_bind_type
+{
+   CONFIG_BIND_BOOL = 0,
+   CONFIG_BIND_INT,
+   CONFIG_BIND_UINT,
+   CONFIG_BIND_SIZE,
+   CONFIG_BIND_FLOAT,
+   /* Copied into the char buffer of 'len' bytes at 'ptr' */
+   CONFIG_BIND_ARRAY,
+   /* As CONFIG_BIND_ARRAY, through config_get_path() */
+   CONFIG_BIND_PATH,
+   /* The entry's own value, as a 'const char *'; valid
+    * for as long as the config file is */
+   CONFIG_BIND_VALUE
+};
+
+/* A key read into the variable of its type at 'ptr' */
+struct config_bind
+{
+   const char *key;
+   void *ptr;
+   size_t len;
+   enum config_bind_type type;
+};
+
+/* Binds with their keys hashed, so that a table built once
+ * can be applied to any number of config files */
+typedef struct config_bind_table
+{
+   const struct config_bind *binds;
+   /* 0 for a key bound earlier in the table */
+   uint32_t *hashes;
+   /* RHMAP of key to bind index + 1 */
+   size_t *map;
+   size_t count;
+} config_bind_table_t;
+
+/**
+ * config_bind_table_init:
+ *
+ * Indexes the @count binds at @binds, which must outlive
+ * the table. A key that is bound twice only sets its first
+ * bind.
+ *
+ * @return false when out of memory.
+ **/
+bool config_bind_table_init(config_bind_table_t *table,
+      const struct config_bind *binds, size_t count);
+
+void config_bind_table_free(config_bind_table_t *table);
+
+/**
+ * config_bind_table_apply:
+ *
+ * Sets every bound variable whose key is in @conf, as the
+ * config_get_*() of its type would, in one pass over
+ * whichever of the file and the table is the smaller.
+ * A variable keeps its value when the key is missing or
+ * its value does not parse.
+ *
+ * @return the number of variables set.
+ **/
+size_t config_bind_table_apply(const config_bind_table_t *table,
+      config_file_t *conf);
+
 /* Setters. Similar to the getters.
  * Will not write to entry if the entry was obtained from an #include. */
 size_t config_set_double(config_file_t *conf, const char *entry, double value);
@@ -683,6 +683,21 @@ bool path_is_valid(const char *path);
 
 int32_t path_get_size(const char *path);
 
+/**
+ * path_get_size_and_mtime:
+ * @path               : path
+ * @size               : size of the file, in bytes
+ * @mtime              : time of the last modification, in seconds
+ *
+ * Queries the OS directly rather than the VFS interface, so that
+ * sizes past 2 GB come through.
+ *
+ * @return true on success, false if the path could not be queried
+ * or the platform has no modification times.
+ **/
+bool path_get_size_and_mtime(const char *path, int64_t *size,
+      int64_t *mtime);
+
 bool is_path_accessible_using_standard_io(const char *path);
 
 RETRO_END_DECLS
@@ -0,0 +1,76 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (file_write_atomic.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_FILE_WRITE_ATOMIC_H
+#define __LIBRETRO_SDK_FILE_WRITE_ATOMIC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <retro_common_api.h>
+
+#include <boolean.h>
+#include <streams/file_stream.h>
+
+RETRO_BEGIN_DECLS
+
+struct file_write_block
+{
+   const void *data;
+   int64_t size;
+};
+
+/* Writes the file's contents to @file; false fails the write */
+typedef bool (*file_write_atomic_cb_t)(RFILE *file, void *userdata);
+
+/**
+ * file_write_atomic_cb:
+ * @path               : file to write
+ * @write              : writes the contents
+ * @userdata           : passed to @write
+ *
+ * Has @write fill a file of its own next to @path and moves it into
+ * place, so that a reader never sees half a file.  The temporary name
+ * is unique to the process and the call, so writers of the same path
+ * at once, in this process or another, don't trip over each other; the
+ * last to finish wins.
+ *
+ * @return true on success.  On failure, including a temporary name too
+ * long to fit, @path is left as it was.
+ **/
+bool file_write_atomic_cb(const char *path,
+      file_write_atomic_cb_t write, void *userdata);
+
+/**
+ * file_write_atomic:
+ * @path               : file to write
+ * @blocks             : data to write, one block after the other
+ * @count              : number of @blocks
+ *
+ * file_write_atomic_cb() for contents already in memory.
+ **/
+bool file_write_atomic(const char *path,
+      const struct file_write_block *blocks, size_t count);
+
+RETRO_END_DECLS
+
+#endif
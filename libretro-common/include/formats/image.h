@@ -99,6 +99,11 @@ bool image_transfer_iterate(void *data, enum image_type_enum type);
 
 bool image_transfer_is_valid(void *data, enum image_type_enum type);
 
+/* Asks the decoder for ABGR pixels (R in the low byte) straight
+ * away. Returns false if it only decodes to ARGB, in which case
+ * the caller converts afterwards. */
+bool image_transfer_set_output_abgr(void *data, enum image_type_enum type);
+
 RETRO_END_DECLS
 
 #endif
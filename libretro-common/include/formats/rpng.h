@@ -40,6 +40,10 @@ bool rpng_is_valid(rpng_t *rpng);
 
 bool rpng_set_buf_ptr(rpng_t *rpng, void *data, size_t len);
 
+/* Decode to ABGR words (R in the low byte) instead of ARGB, for
+ * drivers that take RGBA textures. Set before rpng_process_image. */
+void rpng_set_output_abgr(rpng_t *rpng, bool abgr);
+
 rpng_t *rpng_alloc(void);
 
 void rpng_free(rpng_t *rpng);
@@ -2587,6 +2587,26 @@ enum retro_mod
 */
 #define RETRO_ENVIRONMENT_GET_TARGET_SAMPLE_RATE (81 | RETRO_ENVIRONMENT_EXPERIMENTAL)
 
+/**
+ * Registers a callback that reports which parts of a serialized state
+ * differ from the state before it.
+ *
+ * Frontends that keep many states (rollback netplay, rewind, run-ahead)
+ * store most of them as deltas against the previous one, and otherwise
+ * have to compare every byte to find what changed.
+ * A core that knows which of its memory it has written since the last
+ * \c retro_serialize can tell the frontend instead,
+ * so the cost of a save follows what the game actually touched.
+ *
+ * Should be set in either \c retro_init or \c retro_load_game, but not both.
+ * @param[in] data <tt>const struct retro_serialize_dirty_interface *</tt>.
+ * Pointer to the interface. The frontend copies it.
+ * @return \c true if the frontend will call the interface.
+ * @see retro_serialize_dirty_interface
+ * @see retro_serialize
+ */
+#define RETRO_ENVIRONMENT_SET_SERIALIZE_DIRTY_INTERFACE (82 | RETRO_ENVIRONMENT_EXPERIMENTAL)
+
 /**@}*/
 
 /**
@@ -3476,6 +3496,67 @@ struct retro_hw_render_context_negotiation_interface
  */
 #define RETRO_SERIALIZATION_QUIRK_PLATFORM_DEPENDENT (1 << 6)
 
+/**
+ * Serialized state is always the same size, and each part of it stays
+ * at the same offset from one serialize to the next.
+ *
+ * The frontend may then line its own blocks up around the state so that
+ * successive states can be delta coded block by block.
+ * Must not be set together with \c RETRO_SERIALIZATION_QUIRK_CORE_VARIABLE_SIZE.
+ */
+#define RETRO_SERIALIZATION_QUIRK_STABLE_LAYOUT (1 << 7)
+
+/** @} */
+
+/** @defgroup SET_SERIALIZE_DIRTY_INTERFACE Serialization Dirty Blocks
+ * @{
+ */
+
+#define RETRO_SERIALIZE_DIRTY_INTERFACE_VERSION 1
+
+/**
+ * Reports the blocks of the state most recently written by \c retro_serialize
+ * that may differ from the core's \em baseline:
+ * the state it serialized or unserialized before that.
+ *
+ * Bit \c n of \c bitmap (bit <tt>n % 8</tt> of byte <tt>n / 8</tt>)
+ * covers bytes <tt>[n * block_size, (n + 1) * block_size)</tt> of the state.
+ * A clear bit promises those bytes are identical to the same bytes of the baseline;
+ * a set bit only says they may have changed, so cores may be conservative.
+ * Bits past the end of the state are ignored.
+ *
+ * Every successful \c retro_serialize and \c retro_unserialize makes the
+ * state it wrote or read the new baseline, whether or not the frontend asks.
+ * The frontend only calls this directly after a \c retro_serialize,
+ * before running or resetting the core.
+ *
+ * @param bitmap The bitmap to fill in. The frontend clears it first.
+ * @param size Size of \c bitmap in bytes, enough for every block of the state.
+ * @return \c true if the bitmap is valid.
+ * \c false if the core cannot tell, for instance because nothing was
+ * serialized or unserialized since the game was loaded or reset,
+ * or the state size has changed; the frontend then treats every block as changed.
+ */
+typedef bool (RETRO_CALLCONV *retro_serialize_get_dirty_t)(uint8_t *bitmap, size_t size);
+
+/**
+ * @see RETRO_ENVIRONMENT_SET_SERIALIZE_DIRTY_INTERFACE
+ */
+struct retro_serialize_dirty_interface
+{
+   /** Set to \c RETRO_SERIALIZE_DIRTY_INTERFACE_VERSION. */
+   unsigned interface_version;
+
+   /**
+    * Bytes of serialized state per bitmap bit.
+    * Must be a power of two; page-sized blocks (4096) suit cores that
+    * track writes with page protection, smaller blocks give tighter deltas.
+    */
+   size_t block_size;
+
+   retro_serialize_get_dirty_t get_dirty;
+};
+
 /** @} */
 
 /** @defgroup SET_MEMORY_MAPS Memory Descriptors
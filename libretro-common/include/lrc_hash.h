@@ -63,6 +63,36 @@ void SHA1Digest(const uint8_t* data, size_t len, uint8_t digest[20]);
 
 int sha1_calculate(const char *path, char *result);
 
+struct sha1_context
+{
+   unsigned Message_Digest[5]; /* Message Digest (output)          */
+
+   unsigned Length_Low;        /* Message length in bits           */
+   unsigned Length_High;       /* Message length in bits           */
+
+   unsigned char Message_Block[64]; /* 512-bit message blocks      */
+   int Message_Block_Index;    /* Index into message block array   */
+
+   int Computed;               /* Is the digest computed?          */
+   int Corrupted;              /* Is the message digest corruped?  */
+};
+
+/**
+ * sha1_init:
+ * @context           : Context to reset.
+ *
+ * Starts an incremental SHA1, for data that does not fit
+ * in memory at once. Feed it with sha1_update(), then
+ * read the digest with sha1_final().
+ **/
+void sha1_init(struct sha1_context *context);
+
+void sha1_update(struct sha1_context *context,
+      const void *data, size_t len);
+
+/* Returns 0 if the message was too long to hash */
+int sha1_final(struct sha1_context *context, uint8_t digest[20]);
+
 uint32_t djb2_calculate(const char *str);
 
 #ifdef __APPLE__
@@ -35,6 +35,35 @@ void *memalign_alloc_aligned(size_t len);
 
 void memalign_free(void *ptr);
 
+enum memalign_backing
+{
+   /* Plain heap memory */
+   MEMALIGN_BACKING_HEAP = 0,
+   /* Its own mapping, in regular pages */
+   MEMALIGN_BACKING_PAGES,
+   /* Its own mapping, which the kernel was asked to back with
+    * transparent huge pages */
+   MEMALIGN_BACKING_HUGE_HINT,
+   /* Large pages or superpages, granted outright */
+   MEMALIGN_BACKING_LARGE_PAGES
+};
+
+/* For big buffers that live long and are copied whole every frame,
+ * such as save states: 64-byte aligned, and in 2 MB pages where the
+ * system allows it, so the copies miss the TLB less. Falls back to
+ * regular pages, then to the heap. Free with memalign_free_large. */
+void *memalign_alloc_large(size_t len);
+
+/* Like realloc; the contents up to the smaller size are kept. */
+void *memalign_realloc_large(void *ptr, size_t len);
+
+void memalign_free_large(void *ptr);
+
+/* Which memory @ptr, from memalign_alloc_large, ended up in. */
+enum memalign_backing memalign_large_backing(const void *ptr);
+
+const char *memalign_backing_name(enum memalign_backing backing);
+
 RETRO_END_DECLS
 
 #endif
@@ -0,0 +1,88 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (memarena.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIBRETRO_MEMARENA_H
+#define _LIBRETRO_MEMARENA_H
+
+#include <stddef.h>
+
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/**
+ * A bump allocator for short-lived buffers.
+ *
+ * Allocations are carved out of one block and all given back at once by
+ * memarena_reset. When a cycle needs more than the block holds, extra
+ * blocks come from the heap, and the next reset replaces them all with
+ * one block large enough for that cycle, so a steady workload settles
+ * into no heap traffic at all.
+ *
+ * Every function accepts a NULL arena and falls back to malloc and free,
+ * so callers that may or may not have an arena can use one code path.
+ * An arena is not thread-safe.
+ */
+typedef struct memarena memarena_t;
+
+/**
+ * Creates an arena whose first block holds \c size bytes.
+ *
+ * @return The new arena, or NULL if there was an error.
+ */
+memarena_t *memarena_new(size_t size);
+
+/**
+ * Frees an arena and every block it holds.
+ */
+void memarena_free(memarena_t *arena);
+
+/**
+ * Allocates \c len bytes, aligned for any type, valid until the next
+ * memarena_reset. With a NULL arena, this is malloc.
+ */
+void *memarena_alloc(memarena_t *arena, size_t len);
+
+/**
+ * Gives back a buffer from memarena_alloc. The space only comes back at
+ * the next reset; with a NULL arena, this is free.
+ */
+void memarena_release(memarena_t *arena, void *ptr);
+
+/**
+ * Gives back everything allocated since the last reset.
+ */
+void memarena_reset(memarena_t *arena);
+
+/**
+ * Reads back the cycle that the last memarena_reset ended.
+ *
+ * @param allocs Set to the number of allocations.
+ * @param heap_allocs Set to how many of those needed a new heap block.
+ * @param used Set to the bytes handed out.
+ */
+void memarena_get_stats(const memarena_t *arena, unsigned *allocs,
+      unsigned *heap_allocs, size_t *used);
+
+RETRO_END_DECLS
+
+#endif
@@ -125,6 +125,16 @@ uint8_t* net_http_data(struct http_t *state, size_t* len, bool accept_error);
  **/
 void net_http_delete(struct http_t *state);
 
+/**
+ * net_http_global_init:
+ *
+ * Creates the locks around the DNS cache, the connection pool and
+ * the TLS caches.  Call it once from the main thread before any
+ * transfer runs on another one; until then transfers must all run
+ * on the same thread.
+ **/
+void net_http_global_init(void);
+
 /**
  * net_http_urlencode:
  *
@@ -29,6 +29,10 @@
 
 RETRO_BEGIN_DECLS
 
+/* Creates the lock around the CA bundle and the session cache; call
+ * once from the main thread before connecting from another */
+void ssl_socket_global_init(void);
+
 void* ssl_socket_init(int fd, const char *domain);
 
 int ssl_socket_connect(void *state_data, void *data, bool timeout_enable, bool nonblock);
@@ -0,0 +1,85 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (spsc_ring.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_SPSC_RING_H
+#define __LIBRETRO_SDK_SPSC_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <retro_common_api.h>
+#include <boolean.h>
+
+RETRO_BEGIN_DECLS
+
+/**
+ * A bounded byte ring for one producer thread and one consumer thread,
+ * such as the emulation thread and an audio callback.
+ *
+ * Unlike \c fifo_buffer_t it needs no lock: the producer only moves
+ * \c end and the consumer only moves \c first, and each publishes its
+ * move with a memory barrier after touching the data.
+ * Everything other than the read and write calls below
+ * must be done while neither side is running.
+ */
+typedef struct spsc_ring
+{
+   uint8_t *buffer;
+   size_t size;
+   volatile size_t first;
+   volatile size_t end;
+} spsc_ring_t;
+
+/**
+ * Allocates \c len bytes of queue space for \c ring.
+ * Must be released with \c spsc_ring_deinitialize.
+ *
+ * @return \c false if \c ring is \c NULL or there was an error.
+ */
+bool spsc_ring_initialize(spsc_ring_t *ring, size_t len);
+
+/** Frees the queue space of \c ring, but not \c ring itself. */
+void spsc_ring_deinitialize(spsc_ring_t *ring);
+
+/** The number of bytes \c ring holds; safe from either side. */
+size_t spsc_ring_read_avail(const spsc_ring_t *ring);
+
+/** The number of bytes \c ring can take; safe from either side. */
+size_t spsc_ring_write_avail(const spsc_ring_t *ring);
+
+/**
+ * Queues up to \c len bytes from \c data; producer only.
+ *
+ * @return The number of bytes queued, less than \c len if \c ring filled up.
+ */
+size_t spsc_ring_write(spsc_ring_t *ring, const void *data, size_t len);
+
+/**
+ * Dequeues up to \c len bytes into \c data; consumer only.
+ *
+ * @return The number of bytes dequeued, less than \c len if \c ring ran dry.
+ */
+size_t spsc_ring_read(spsc_ring_t *ring, void *data, size_t len);
+
+RETRO_END_DECLS
+
+#endif
@@ -34,6 +34,9 @@
 
 RETRO_BEGIN_DECLS
 
+/** Most workers \c task_queue_set_workers takes. */
+#define TASK_QUEUE_MAX_WORKERS 16
+
 enum task_type
 {
    /** A regular task. The vast majority of tasks will use this type. */
@@ -46,6 +49,31 @@ enum task_type
    TASK_TYPE_BLOCKING
 };
 
+/**
+ * Which workers of the threaded task queue pick up a task, and in what order.
+ * Ignored when the queue is not threaded.
+ */
+enum task_priority
+{
+   /** The default for tasks made by \c task_init. */
+   TASK_PRIORITY_NORMAL = 0,
+
+   /**
+    * Short tasks the user is waiting on (savestates, image loads, netplay).
+    * They run on a worker of their own in the order they were pushed,
+    * so they are never held up by long tasks of the other classes.
+    */
+   TASK_PRIORITY_LATENCY,
+
+   /**
+    * Long tasks nobody waits on (scans, downloads).
+    * Only run when no normal task is ready to run.
+    */
+   TASK_PRIORITY_BACKGROUND,
+
+   TASK_PRIORITY_COUNT
+};
+
 enum task_style
 {
    TASK_STYLE_NONE,
@@ -250,6 +278,26 @@ struct retro_task
     */
    retro_task_t *next;
 
+   /**
+    * @private Pointer to the next task ready to run
+    * in the threaded queue's lane for this task's \c priority.
+    * Do not touch this; it is managed by the task system.
+    */
+   retro_task_t *ready_next;
+
+   /**
+    * @private Pointer to the next task whose progress
+    * the threaded queue has yet to show.
+    * Do not touch this; it is managed by the task system.
+    */
+   retro_task_t *report_next;
+
+   /**
+    * @private When the threaded queue last queued this task's progress.
+    * Do not touch this; it is managed by the task system.
+    */
+   retro_time_t reported;
+
    /**
     * Indicates the current progress of the task.
     *
@@ -275,6 +323,27 @@ struct retro_task
    enum task_type type;
    enum task_style style;
 
+   /**
+    * Which workers run this task in threaded mode.
+    * Set by the caller; \c task_init sets \c TASK_PRIORITY_NORMAL.
+    */
+   enum task_priority priority;
+
+   /**
+    * How many workers may run tasks with this task's \c handler
+    * at the same time in threaded mode; 0 and 1 both mean one.
+    * Only raise it for handlers that keep no state of their own
+    * outside \c state.
+    * Set by the caller; \c task_init sets 0.
+    */
+   uint8_t concurrency;
+
+   /**
+    * @private Progress reporting state of the threaded queue.
+    * Do not touch this; it is managed by the task system.
+    */
+   uint8_t report;
+
    uint8_t flags;
 };
 
@@ -541,6 +610,18 @@ void task_queue_set_threaded(void);
  */
 void task_queue_unset_threaded(void);
 
+/**
+ * Sets how many workers the threaded task queue runs tasks of
+ * \c TASK_PRIORITY_NORMAL and \c TASK_PRIORITY_BACKGROUND on.
+ * One more worker is kept for \c TASK_PRIORITY_LATENCY.
+ *
+ * Takes effect the next time the queue is made threaded.
+ *
+ * @param workers The number of workers,
+ * or 0 for two fewer than the CPU has cores, at least one.
+ */
+void task_queue_set_workers(unsigned workers);
+
 /**
  * Returns whether the task queue is running in threaded mode.
  *
@@ -655,11 +736,14 @@ void task_queue_deinit(void);
  * Must be called before any other task_queue_* function,
  * and must only be called from the main thread.
  *
- * @param threaded \c true if tasks should run on a separate thread,
+ * @param threaded \c true if tasks should run on worker threads,
  * \c false if they should remain on the calling thread.
- * All tasks run in sequence on a single thread.
- * If you want to scale a task to multiple threads,
+ * In threaded mode tasks with different handlers may run at the same time,
+ * one per worker; tasks sharing a handler still run one after the other,
+ * as do all tasks of \c TASK_PRIORITY_LATENCY.
+ * If you want to scale a single task to multiple threads,
  * you must do so within the task itself.
+ * @see task_queue_set_workers
  * @param msg_push The task system will call this function to output messages.
  * If \c NULL, no messages will be output.
  * @note Calling this function while the task system is already initialized
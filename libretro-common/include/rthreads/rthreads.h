@@ -303,6 +303,104 @@ uintptr_t sthread_get_thread_id(sthread_t *thread);
  */
 uintptr_t sthread_get_current_thread_id(void);
 
+/** Scheduling classes for \c sthread_set_priority_class. */
+enum sthread_priority_class
+{
+   /** Leave the thread as the operating system made it. */
+   STHREAD_PRIORITY_CLASS_DEFAULT = 0,
+   /** Below normal, for work nobody waits on. */
+   STHREAD_PRIORITY_CLASS_BACKGROUND,
+   /** Above normal, for threads that produce frames. */
+   STHREAD_PRIORITY_CLASS_HIGH,
+   /** As close to real-time as the system allows, for audio and the like. */
+   STHREAD_PRIORITY_CLASS_REALTIME
+};
+
+/**
+ * Restricts the calling thread to the given CPUs.
+ *
+ * @param cpu_mask Bit \c n set for CPU \c n to be allowed.
+ * @return \c true if the mask was applied;
+ * \c false if it wasn't or the platform doesn't support it.
+ */
+bool sthread_set_affinity(uint64_t cpu_mask);
+
+/**
+ * Moves the calling thread into a scheduling class.
+ *
+ * Uses MMCSS on Windows, \c SCHED_FIFO or the thread's nice value on Linux,
+ * and QoS classes on Apple platforms. Raising a thread's priority may need
+ * privileges the process doesn't have; the nearest allowed step is taken.
+ *
+ * @param priority The class to move to.
+ * @return \c true if the thread's scheduling was changed.
+ */
+bool sthread_set_priority_class(enum sthread_priority_class priority);
+
+/**
+ * @return The CPU time the calling thread has used, in microseconds,
+ * or -1 if the platform can't tell.
+ */
+int64_t sthread_get_cpu_time_usec(void);
+
+/**
+ * Thread roles.
+ *
+ * A role is a name such as "video" or "audio" that threads doing that job
+ * register under when they start. The application configures each role's
+ * CPUs and scheduling class once, and every thread registering under it
+ * afterwards gets them. The CPU time of a role's threads, living and gone,
+ * can be read back while the program runs.
+ *
+ * All calls are thread-safe once \c sthread_role_init has returned, and do
+ * nothing before then.
+ */
+
+/**
+ * Sets up the role registry. Call once, before any other thread registers;
+ * further calls do nothing.
+ *
+ * @return \c false if there was an error.
+ */
+bool sthread_role_init(void);
+
+/**
+ * Sets the CPUs and scheduling class of threads registering as \c role
+ * from now on.
+ *
+ * @param role Name of the role.
+ * @param cpu_mask As for \c sthread_set_affinity; 0 leaves affinity alone.
+ * @param priority As for \c sthread_set_priority_class.
+ */
+void sthread_role_configure(const char *role, uint64_t cpu_mask,
+      enum sthread_priority_class priority);
+
+/**
+ * Registers the calling thread as \c role and applies that role's
+ * configuration to it. A thread registering again changes its role.
+ *
+ * @return \c false if the registry is full or not initialised.
+ */
+bool sthread_role_register(const char *role);
+
+/**
+ * Removes the calling thread from the registry. Threads that registered
+ * should call this before they exit; their CPU time stays with the role.
+ */
+void sthread_role_unregister(void);
+
+/**
+ * Reads back a role's CPU time.
+ *
+ * @param index Index of the role, from 0; roles are kept in the order
+ * they were first configured or registered.
+ * @param role Set to the role's name, valid until the program exits.
+ * @param usec Set to the CPU time of the role's threads, in microseconds.
+ * @return \c false if there is no role at \c index.
+ */
+bool sthread_role_get_cpu_time(unsigned index, const char **role,
+      int64_t *usec);
+
 RETRO_END_DECLS
 
 #endif
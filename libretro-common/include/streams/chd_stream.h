@@ -63,6 +63,11 @@ uint32_t chdstream_get_frame_size(chdstream_t* stream);
 
 uint32_t chdstream_get_first_track_sector(chdstream_t* stream);
 
+/* Hunk loads served from the stream's hunk cache (filled by earlier
+ * reads or decoded ahead of sequential reads), and decoded on demand */
+void chdstream_get_cache_stats(chdstream_t *stream,
+      uint32_t *hits, uint32_t *misses);
+
 RETRO_END_DECLS
 
 #endif
@@ -211,6 +211,29 @@ int filestream_close(RFILE *stream);
  */
 int64_t filestream_read_file(const char *path, void **buf, int64_t *len);
 
+/**
+ * Maps the contents of a file into memory, read-only, instead of
+ * reading them. Pages are only read in once they are touched.
+ *
+ * @param path[in] Path to the file to map.
+ * @param buf[out] Set to the start of the mapping.
+ * Must be released with \c filestream_unmap_file, not \c free.
+ * @param len[out] Set to the size of the mapping in bytes.
+ * @return \c true if the file was mapped, \c false if it could not be,
+ * e.g. because the platform or the active VFS interface cannot map files
+ * or the file is empty. The caller should then read it instead.
+ * @see filestream_read_file
+ */
+bool filestream_map_file(const char *path, void **buf, int64_t *len);
+
+/**
+ * Releases a mapping made by \c filestream_map_file.
+ *
+ * @param buf The mapping.
+ * @param len Its size in bytes.
+ */
+void filestream_unmap_file(void *buf, int64_t len);
+
 /**
  * Reads a line of text from the given file,
  * up to a given length.
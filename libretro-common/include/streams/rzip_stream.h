@@ -67,11 +67,28 @@ RETRO_BEGIN_DECLS
  * <size of next compressed chunk> : repeated until end of file
  * <next compressed chunk>         :
  * 
+ * Each chunk is compressed on its own, so up to one
+ * chunk per core is compressed/decompressed at once
+ * when threads are available.
+ * 
+ * File format version 2 is identical, except that each
+ * chunk is a raw LZ4 block rather than zlib data. It is
+ * only written on request (see rzipstream_set_codec()).
+ * 
  */
 
 /* Prevent direct access to rzipstream_t members */
 typedef struct rzipstream rzipstream_t;
 
+/* Compression applied to each chunk */
+enum rzip_codec
+{
+   RZIP_CODEC_ZLIB = 0,
+   /* Faster, but larger files - and only
+    * readable by RZIP version 2 readers */
+   RZIP_CODEC_LZ4
+};
+
 /* File Open */
 
 /* Opens a new or existing RZIP file
@@ -84,6 +101,11 @@ typedef struct rzipstream rzipstream_t;
  * is invalid or an IO error occurs */
 rzipstream_t* rzipstream_open(const char *path, unsigned mode);
 
+/* Switches a stream opened for writing to 'codec'
+ * > Only possible before any data is written
+ * Returns false if 'codec' is not available */
+bool rzipstream_set_codec(rzipstream_t *stream, enum rzip_codec codec);
+
 /* File Read */
 
 /* Reads (a maximum of) 'len' bytes from an RZIP file.
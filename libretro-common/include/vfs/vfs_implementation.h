@@ -57,6 +57,13 @@ int retro_vfs_file_rename_impl(const char *old_path, const char *new_path);
 
 const char *retro_vfs_file_get_path_impl(libretro_vfs_implementation_file *stream);
 
+/* Maps the whole file at 'path' into memory, read-only, and
+ * sets 'size'. The mapping stays valid after the file is
+ * closed. Returns NULL where files cannot be mapped. */
+void *retro_vfs_file_map_impl(const char *path, uint64_t *size);
+
+int retro_vfs_file_unmap_impl(void *data, uint64_t size);
+
 int retro_vfs_stat_impl(const char *path, int32_t *size);
 
 int retro_vfs_mkdir_impl(const char *dir);
@@ -21,6 +21,7 @@
  */
 
 #include <stdlib.h>
+#include <stdint.h>
 
 #if defined(_WIN32) && defined(_XBOX)
 #include <xtl.h>
@@ -88,6 +89,29 @@ static int qstrcmp_dir_noext(const void *a_, const void *b_)
    return qstrcmp_plain_noext(a, b);
 }
 
+/* An element with the first bytes of its name folded to lower
+ * case and packed big-endian, so that most comparisons are one
+ * integer compare without touching the string */
+struct dir_list_sort_key
+{
+   uint64_t prefix;
+   struct string_list_elem elem;
+   int type;
+};
+
+static int qstrcmp_key(const void *a_, const void *b_)
+{
+   const struct dir_list_sort_key *a = (const struct dir_list_sort_key*)a_;
+   const struct dir_list_sort_key *b = (const struct dir_list_sort_key*)b_;
+
+   /* Sort directories before files, if wanted */
+   if (a->type != b->type)
+      return b->type - a->type;
+   if (a->prefix != b->prefix)
+      return (a->prefix < b->prefix) ? -1 : 1;
+   return strcasecmp(a->elem.data, b->elem.data);
+}
+
 /**
  * dir_list_sort:
  * @list      : pointer to the directory listing.
@@ -97,9 +121,47 @@ static int qstrcmp_dir_noext(const void *a_, const void *b_)
  **/
 void dir_list_sort(struct string_list *list, bool dir_first)
 {
-   if (list)
+   size_t i;
+   struct dir_list_sort_key *keys = NULL;
+
+   if (!list || list->size < 2)
+      return;
+
+   if (!(keys = (struct dir_list_sort_key*)
+            malloc(list->size * sizeof(*keys))))
+   {
       qsort(list->elems, list->size, sizeof(struct string_list_elem),
             dir_first ? qstrcmp_dir : qstrcmp_plain);
+      return;
+   }
+
+   for (i = 0; i < list->size; i++)
+   {
+      unsigned j;
+      const char *data = list->elems[i].data;
+      uint64_t prefix  = 0;
+
+      /* Same folding as strcasecmp() in the C locale; a shorter
+       * name is padded with zeros and so sorts first */
+      for (j = 0; j < 8 && data[j]; j++)
+      {
+         unsigned char c = (unsigned char)data[j];
+         if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+         prefix |= (uint64_t)c << (56 - 8 * j);
+      }
+
+      keys[i].prefix = prefix;
+      keys[i].elem   = list->elems[i];
+      keys[i].type   = dir_first ? list->elems[i].attr.i : 0;
+   }
+
+   qsort(keys, list->size, sizeof(*keys), qstrcmp_key);
+
+   for (i = 0; i < list->size; i++)
+      list->elems[i] = keys[i].elem;
+
+   free(keys);
 }
 
 /**
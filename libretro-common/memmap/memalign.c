@@ -22,9 +22,39 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <memalign.h>
 
+#if defined(_WIN32) && !defined(_XBOX) && !defined(__WINRT__)
+#include <windows.h>
+#define MEMALIGN_LARGE_WIN32
+#elif defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)
+#include <sys/mman.h>
+#if defined(__APPLE__)
+#include <mach/vm_statistics.h>
+#endif
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#define MEMALIGN_LARGE_MMAP
+#endif
+
+/* What a huge page is on the systems that have them */
+#define MEMALIGN_LARGE_PAGE_SIZE (2 * 1024 * 1024)
+/* Under this, a mapping of its own gains nothing */
+#define MEMALIGN_LARGE_MIN_SIZE  (MEMALIGN_LARGE_PAGE_SIZE / 2)
+/* The header in front of the data; also its alignment */
+#define MEMALIGN_LARGE_HEADER    64
+
+typedef struct memalign_large
+{
+   void *base;
+   size_t map_len;
+   size_t len;
+   enum memalign_backing backing;
+} memalign_large_t;
+
 void *memalign_alloc(size_t boundary, size_t len)
 {
    void **place   = NULL;
@@ -59,3 +89,179 @@ void *memalign_alloc_aligned(size_t len)
    return memalign_alloc(32, len);
 #endif
 }
+
+static size_t memalign_round_up(size_t len, size_t boundary)
+{
+   return (len + boundary - 1) & ~(boundary - 1);
+}
+
+static void *memalign_map_large(size_t len, size_t *map_len,
+      enum memalign_backing *backing)
+{
+#if defined(MEMALIGN_LARGE_WIN32)
+   typedef SIZE_T (WINAPI *large_page_min_t)(void);
+   void *base;
+   HMODULE kernel32    = GetModuleHandleA("kernel32.dll");
+   large_page_min_t lp = kernel32
+      ? (large_page_min_t)GetProcAddress(kernel32, "GetLargePageMinimum")
+      : NULL;
+   size_t large        = lp ? (size_t)lp() : 0;
+
+#ifdef MEM_LARGE_PAGES
+   /* Only with the "Lock pages in memory" privilege */
+   if (large && !(large & (large - 1)))
+   {
+      *map_len = memalign_round_up(len, large);
+      if ((base = VirtualAlloc(NULL, *map_len,
+                  MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+                  PAGE_READWRITE)))
+      {
+         *backing = MEMALIGN_BACKING_LARGE_PAGES;
+         return base;
+      }
+   }
+#endif
+
+   *map_len = len;
+   if ((base = VirtualAlloc(NULL, *map_len, MEM_RESERVE | MEM_COMMIT,
+               PAGE_READWRITE)))
+      *backing = MEMALIGN_BACKING_PAGES;
+   return base;
+#elif defined(MEMALIGN_LARGE_MMAP)
+   uint8_t *raw;
+   uintptr_t aligned;
+   size_t head, tail;
+
+   *map_len = memalign_round_up(len, MEMALIGN_LARGE_PAGE_SIZE);
+
+#if defined(__APPLE__) && defined(VM_FLAGS_SUPERPAGE_SIZE_2MB)
+   raw = (uint8_t*)mmap(NULL, *map_len, PROT_READ | PROT_WRITE,
+         MAP_PRIVATE | MAP_ANONYMOUS, VM_FLAGS_SUPERPAGE_SIZE_2MB, 0);
+   if (raw != (uint8_t*)MAP_FAILED)
+   {
+      *backing = MEMALIGN_BACKING_LARGE_PAGES;
+      return raw;
+   }
+#endif
+
+   /* Map a page more than needed and trim it to a 2 MB boundary,
+    * so every page of it can be a huge one */
+   raw = (uint8_t*)mmap(NULL, *map_len + MEMALIGN_LARGE_PAGE_SIZE,
+         PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (raw == (uint8_t*)MAP_FAILED)
+      return NULL;
+
+   aligned = memalign_round_up((uintptr_t)raw, MEMALIGN_LARGE_PAGE_SIZE);
+   head    = aligned - (uintptr_t)raw;
+   tail    = MEMALIGN_LARGE_PAGE_SIZE - head;
+   if (head)
+      munmap(raw, head);
+   if (tail)
+      munmap((uint8_t*)aligned + *map_len, tail);
+
+   *backing = MEMALIGN_BACKING_PAGES;
+#ifdef MADV_HUGEPAGE
+   if (!madvise((void*)aligned, *map_len, MADV_HUGEPAGE))
+      *backing = MEMALIGN_BACKING_HUGE_HINT;
+#endif
+   return (void*)aligned;
+#else
+   return NULL;
+#endif
+}
+
+static void memalign_unmap_large(memalign_large_t *large)
+{
+#if defined(MEMALIGN_LARGE_WIN32)
+   VirtualFree(large->base, 0, MEM_RELEASE);
+#elif defined(MEMALIGN_LARGE_MMAP)
+   munmap(large->base, large->map_len);
+#endif
+}
+
+void *memalign_alloc_large(size_t len)
+{
+   memalign_large_t header;
+   uint8_t *base       = NULL;
+   size_t total        = len + MEMALIGN_LARGE_HEADER;
+
+   if (total < len)
+      return NULL;
+
+   header.map_len      = 0;
+   header.len          = len;
+   header.backing      = MEMALIGN_BACKING_HEAP;
+
+   if (total >= MEMALIGN_LARGE_MIN_SIZE)
+      base = (uint8_t*)memalign_map_large(total,
+            &header.map_len, &header.backing);
+
+   if (!base)
+   {
+      header.backing   = MEMALIGN_BACKING_HEAP;
+      if (!(base = (uint8_t*)memalign_alloc(MEMALIGN_LARGE_HEADER, total)))
+         return NULL;
+   }
+
+   header.base         = base;
+   memcpy(base, &header, sizeof(header));
+   return base + MEMALIGN_LARGE_HEADER;
+}
+
+void memalign_free_large(void *ptr)
+{
+   memalign_large_t header;
+   if (!ptr)
+      return;
+
+   memcpy(&header, (uint8_t*)ptr - MEMALIGN_LARGE_HEADER, sizeof(header));
+   if (header.backing == MEMALIGN_BACKING_HEAP)
+      memalign_free(header.base);
+   else
+      memalign_unmap_large(&header);
+}
+
+void *memalign_realloc_large(void *ptr, size_t len)
+{
+   memalign_large_t header;
+   void *resized;
+
+   if (!ptr)
+      return memalign_alloc_large(len);
+
+   memcpy(&header, (uint8_t*)ptr - MEMALIGN_LARGE_HEADER, sizeof(header));
+   if (!(resized = memalign_alloc_large(len)))
+      return NULL;
+
+   memcpy(resized, ptr, header.len < len ? header.len : len);
+   memalign_free_large(ptr);
+   return resized;
+}
+
+enum memalign_backing memalign_large_backing(const void *ptr)
+{
+   memalign_large_t header;
+   if (!ptr)
+      return MEMALIGN_BACKING_HEAP;
+
+   memcpy(&header, (const uint8_t*)ptr - MEMALIGN_LARGE_HEADER,
+         sizeof(header));
+   return header.backing;
+}
+
+const char *memalign_backing_name(enum memalign_backing backing)
+{
+   switch (backing)
+   {
+      case MEMALIGN_BACKING_PAGES:
+         return "regular pages";
+      case MEMALIGN_BACKING_HUGE_HINT:
+         return "transparent huge pages";
+      case MEMALIGN_BACKING_LARGE_PAGES:
+         return "large pages";
+      case MEMALIGN_BACKING_HEAP:
+      default:
+         break;
+   }
+   return "heap";
+}
@@ -0,0 +1,162 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (memarena.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <retro_miscellaneous.h>
+
+#include <memarena.h>
+
+#define MEMARENA_ALIGN 16
+#define MEMARENA_ROUND(x) (((x) + MEMARENA_ALIGN - 1) & ~(size_t)(MEMARENA_ALIGN - 1))
+
+struct memarena_block
+{
+   struct memarena_block *next;
+   size_t size;
+   size_t used;
+};
+
+#define MEMARENA_HEADER_SIZE MEMARENA_ROUND(sizeof(struct memarena_block))
+
+struct memarena
+{
+   struct memarena_block *block; /* Newest first */
+   size_t size;
+   size_t used;
+   size_t last_used;
+   unsigned allocs;
+   unsigned heap_allocs;
+   unsigned last_allocs;
+   unsigned last_heap_allocs;
+};
+
+static struct memarena_block *memarena_block_new(size_t size)
+{
+   struct memarena_block *block = (struct memarena_block*)
+      malloc(MEMARENA_HEADER_SIZE + size);
+   if (!block)
+      return NULL;
+   block->next = NULL;
+   block->size = size;
+   block->used = 0;
+   return block;
+}
+
+static void memarena_free_blocks(memarena_t *arena)
+{
+   while (arena->block)
+   {
+      struct memarena_block *next = arena->block->next;
+      free(arena->block);
+      arena->block = next;
+   }
+}
+
+memarena_t *memarena_new(size_t size)
+{
+   memarena_t *arena = (memarena_t*)calloc(1, sizeof(*arena));
+   if (!arena)
+      return NULL;
+   arena->size = MEMARENA_ROUND(MAX(size, MEMARENA_ALIGN));
+   if (!(arena->block = memarena_block_new(arena->size)))
+   {
+      free(arena);
+      return NULL;
+   }
+   return arena;
+}
+
+void memarena_free(memarena_t *arena)
+{
+   if (!arena)
+      return;
+   memarena_free_blocks(arena);
+   free(arena);
+}
+
+void *memarena_alloc(memarena_t *arena, size_t len)
+{
+   uint8_t *ptr;
+   struct memarena_block *block;
+
+   if (!arena)
+      return malloc(len);
+
+   len   = MEMARENA_ROUND(MAX(len, 1));
+   block = arena->block;
+   if (!block || block->size - block->used < len)
+   {
+      if (!(block = memarena_block_new(MAX(arena->size, len))))
+         return NULL;
+      block->next  = arena->block;
+      arena->block = block;
+      arena->heap_allocs++;
+   }
+
+   ptr          = (uint8_t*)block + MEMARENA_HEADER_SIZE + block->used;
+   block->used += len;
+   arena->used += len;
+   arena->allocs++;
+   return ptr;
+}
+
+void memarena_release(memarena_t *arena, void *ptr)
+{
+   if (!arena)
+      free(ptr);
+}
+
+void memarena_reset(memarena_t *arena)
+{
+   if (!arena)
+      return;
+
+   arena->last_used        = arena->used;
+   arena->last_allocs      = arena->allocs;
+   arena->last_heap_allocs = arena->heap_allocs;
+   arena->used             = 0;
+   arena->allocs           = 0;
+   arena->heap_allocs      = 0;
+
+   /* Outgrown: one block that fits the whole cycle replaces the chain */
+   if (!arena->block || arena->block->next)
+   {
+      arena->size  = MAX(arena->size, arena->last_used);
+      memarena_free_blocks(arena);
+      arena->block = memarena_block_new(arena->size);
+   }
+   else
+      arena->block->used = 0;
+}
+
+void memarena_get_stats(const memarena_t *arena, unsigned *allocs,
+      unsigned *heap_allocs, size_t *used)
+{
+   if (allocs)
+      *allocs      = arena ? arena->last_allocs      : 0;
+   if (heap_allocs)
+      *heap_allocs = arena ? arena->last_heap_allocs : 0;
+   if (used)
+      *used        = arena ? arena->last_used        : 0;
+}
@@ -160,6 +160,19 @@ static slock_t *dns_cache_lock = NULL;
 #define UNLOCK_DNS_CACHE()
 #endif
 
+void net_http_global_init(void)
+{
+#ifdef HAVE_THREADS
+   if (!dns_cache_lock)
+      dns_cache_lock = slock_new();
+   if (!conn_pool_lock)
+      conn_pool_lock = slock_new();
+#endif
+#ifdef HAVE_SSL
+   ssl_socket_global_init();
+#endif
+}
+
 /**
  * net_http_urlencode:
  *
@@ -902,16 +915,7 @@ static bool net_http_new_socket(struct http_t *state)
    struct addrinfo *addr = NULL;
    struct dns_cache_entry *entry;
 
-#ifdef HAVE_THREADS
-   if (!dns_cache_lock)
-      dns_cache_lock = slock_new();
    LOCK_DNS_CACHE();
-
-   /* need some place to create this, I guess */
-   if (!conn_pool_lock)
-      conn_pool_lock = slock_new();
-#endif
-
    entry = net_http_dns_cache_find(state->request.domain, state->request.port);
    if (entry)
    {
@@ -25,15 +25,31 @@
 #include <encodings/base64.h>
 #include <streams/file_stream.h>
 #include <string/stdstring.h>
+#include <compat/strl.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "../../deps/bearssl-0.6/inc/bearssl.h"
 
+/* Hosts whose last session is kept for resumption */
+#define SSL_SESSION_CACHE_SIZE 8
+
 struct ssl_state
 {
    int fd;
    br_ssl_client_context sc;
    br_x509_minimal_context xc;
    uint8_t iobuf[BR_SSL_BUFSIZE_BIDI];
+   char domain[256];
+};
+
+struct ssl_session_entry
+{
+   br_ssl_session_parameters params;
+   char domain[256];
+   bool valid;
 };
 
 /* TODO/FIXME - static global variables */
@@ -43,6 +59,19 @@ static size_t TAs_NUM = 0;
 static uint8_t* current_vdn;
 static size_t current_vdn_size;
 
+/* Each host's last session is resumed rather than paying for a
+ * full handshake on every request */
+static struct ssl_session_entry ssl_sessions[SSL_SESSION_CACHE_SIZE];
+static unsigned ssl_session_next = 0;
+#ifdef HAVE_THREADS
+static slock_t *ssl_cache_lock = NULL;
+#define LOCK_SSL_CACHE() slock_lock(ssl_cache_lock)
+#define UNLOCK_SSL_CACHE() slock_unlock(ssl_cache_lock)
+#else
+#define LOCK_SSL_CACHE()
+#define UNLOCK_SSL_CACHE()
+#endif
+
 static uint8_t* blobdup(const void * src, size_t len)
 {
    uint8_t *ret = (uint8_t*)malloc(len);
@@ -148,21 +177,59 @@ static void append_certs_pem_x509(char * certs_pem)
    }
 }
 
-/* TODO: not thread safe, rthreads doesn't provide any
- * statically allocatable mutex/etc */
+void ssl_socket_global_init(void)
+{
+#ifdef HAVE_THREADS
+   if (!ssl_cache_lock)
+      ssl_cache_lock = slock_new();
+#endif
+}
+
 static void initialize(void)
 {
    void* certs_pem;
-   if (TAs_NUM)
-      return;
-   /* filestream_read_file appends a NUL */
-   filestream_read_file("/etc/ssl/certs/ca-certificates.crt", &certs_pem, NULL);
-   append_certs_pem_x509((char*)certs_pem);
-   free(certs_pem);
+   LOCK_SSL_CACHE();
+   if (!TAs_NUM)
+   {
+      /* filestream_read_file appends a NUL */
+      filestream_read_file("/etc/ssl/certs/ca-certificates.crt",
+            &certs_pem, NULL);
+      append_certs_pem_x509((char*)certs_pem);
+      free(certs_pem);
+   }
+   UNLOCK_SSL_CACHE();
+}
+
+static struct ssl_session_entry *ssl_session_find(const char *domain)
+{
+   unsigned i;
+   for (i = 0; i < SSL_SESSION_CACHE_SIZE; i++)
+      if (     ssl_sessions[i].valid
+            && string_is_equal(ssl_sessions[i].domain, domain))
+         return &ssl_sessions[i];
+   return NULL;
+}
+
+static void ssl_session_save(struct ssl_state *state)
+{
+   struct ssl_session_entry *entry;
+
+   LOCK_SSL_CACHE();
+   if (!(entry = ssl_session_find(state->domain)))
+   {
+      entry             = &ssl_sessions[ssl_session_next];
+      ssl_session_next  = (ssl_session_next + 1) % SSL_SESSION_CACHE_SIZE;
+      strlcpy(entry->domain, state->domain, sizeof(entry->domain));
+   }
+   br_ssl_engine_get_session_parameters(&state->sc.eng, &entry->params);
+   entry->valid = true;
+   UNLOCK_SSL_CACHE();
 }
 
 void* ssl_socket_init(int fd, const char *domain)
 {
+   struct ssl_session_entry *entry;
+   bool resume             = false;
    struct ssl_state *state = (struct ssl_state*)calloc(1, sizeof(*state));
 
    initialize();
@@ -170,7 +237,18 @@ void* ssl_socket_init(int fd, const char *domain)
    br_ssl_client_init_full(&state->sc, &state->xc, TAs, TAs_NUM);
    br_ssl_engine_set_buffer(&state->sc.eng,
          state->iobuf, sizeof(state->iobuf), true);
-   br_ssl_client_reset(&state->sc, domain, false);
+   strlcpy(state->domain, domain, sizeof(state->domain));
+
+   /* Offer the host's cached session, if any, for the handshake */
+   LOCK_SSL_CACHE();
+   if ((entry = ssl_session_find(domain)))
+   {
+      br_ssl_engine_set_session_parameters(&state->sc.eng, &entry->params);
+      resume = true;
+   }
+   UNLOCK_SSL_CACHE();
+
+   br_ssl_client_reset(&state->sc, domain, resume);
 
    state->fd = fd;
    return state;
@@ -243,7 +321,10 @@ int ssl_socket_connect(void *state_data,
 
       bearstate = br_ssl_engine_current_state(&state->sc.eng);
       if (bearstate & BR_SSL_SENDAPP)
+      {
+         ssl_session_save(state);
          break; /* handshake done */
+      }
       if (bearstate & BR_SSL_CLOSED)
          return -1; /* failed */
    }
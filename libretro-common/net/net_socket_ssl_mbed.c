@@ -24,6 +24,12 @@
 #include <net/net_compat.h>
 #include <net/net_socket.h>
 #include <net/net_socket_ssl.h>
+#include <compat/strl.h>
+#include <string/stdstring.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #ifdef _3DS
 #include <3ds/types.h>
@@ -60,6 +66,9 @@
 
 #define DEBUG_LEVEL 0
 
+/* Hosts whose last session is kept for resumption */
+#define SSL_SESSION_CACHE_SIZE 8
+
 struct ssl_state
 {
    mbedtls_net_context net_ctx;
@@ -67,12 +76,34 @@ struct ssl_state
    mbedtls_entropy_context entropy;
    mbedtls_ctr_drbg_context ctr_drbg;
    mbedtls_ssl_config conf;
-#if defined(MBEDTLS_X509_CRT_PARSE_C)
-   mbedtls_x509_crt ca;
-#endif
   const char *domain;
 };
 
+struct ssl_session_entry
+{
+   mbedtls_ssl_session session;
+   char domain[256];
+   bool valid;
+};
+
+/* The CA bundle is parsed once and shared by every connection,
+ * and each host's last session is resumed rather than paying for
+ * a full handshake on every request. */
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+static mbedtls_x509_crt ssl_ca;
+static bool ssl_ca_parsed = false;
+#endif
+static struct ssl_session_entry ssl_sessions[SSL_SESSION_CACHE_SIZE];
+static unsigned ssl_session_next = 0;
+#ifdef HAVE_THREADS
+static slock_t *ssl_cache_lock = NULL;
+#define LOCK_SSL_CACHE() slock_lock(ssl_cache_lock)
+#define UNLOCK_SSL_CACHE() slock_unlock(ssl_cache_lock)
+#else
+#define LOCK_SSL_CACHE()
+#define UNLOCK_SSL_CACHE()
+#endif
+
 static void ssl_debug(void *ctx, int level,
       const char *file, int line,
       const char *str)
@@ -90,6 +121,53 @@ int ctr_entropy_func(void *data, unsigned char *s, size_t len)
 }
 #endif
 
+static struct ssl_session_entry *ssl_session_find(const char *domain)
+{
+   unsigned i;
+   for (i = 0; i < SSL_SESSION_CACHE_SIZE; i++)
+      if (     ssl_sessions[i].valid
+            && string_is_equal(ssl_sessions[i].domain, domain))
+         return &ssl_sessions[i];
+   return NULL;
+}
+
+/* Offers the host's cached session, if any, for the handshake */
+static void ssl_session_resume(struct ssl_state *state)
+{
+   struct ssl_session_entry *entry;
+
+   LOCK_SSL_CACHE();
+   if ((entry = ssl_session_find(state->domain)))
+      mbedtls_ssl_set_session(&state->ctx, &entry->session);
+   UNLOCK_SSL_CACHE();
+}
+
+static void ssl_session_save(struct ssl_state *state)
+{
+   struct ssl_session_entry *entry;
+
+   LOCK_SSL_CACHE();
+   if (!(entry = ssl_session_find(state->domain)))
+   {
+      entry             = &ssl_sessions[ssl_session_next];
+      ssl_session_next  = (ssl_session_next + 1) % SSL_SESSION_CACHE_SIZE;
+      strlcpy(entry->domain, state->domain, sizeof(entry->domain));
+   }
+   mbedtls_ssl_session_free(&entry->session);
+   mbedtls_ssl_session_init(&entry->session);
+   entry->valid = (mbedtls_ssl_get_session(&state->ctx,
+            &entry->session) == 0);
+   UNLOCK_SSL_CACHE();
+}
+
+void ssl_socket_global_init(void)
+{
+#ifdef HAVE_THREADS
+   if (!ssl_cache_lock)
+      ssl_cache_lock = slock_new();
+#endif
+}
+
 void* ssl_socket_init(int fd, const char *domain)
 {
    static const char *pers = "libretro";
@@ -104,9 +182,6 @@ void* ssl_socket_init(int fd, const char *domain)
    mbedtls_net_init(&state->net_ctx);
    mbedtls_ssl_init(&state->ctx);
    mbedtls_ssl_config_init(&state->conf);
-#if defined(MBEDTLS_X509_CRT_PARSE_C)
-   mbedtls_x509_crt_init(&state->ca);
-#endif
    mbedtls_ctr_drbg_init(&state->ctr_drbg);
    mbedtls_entropy_init(&state->entropy);
 
@@ -122,8 +197,20 @@ void* ssl_socket_init(int fd, const char *domain)
       goto error;
 
 #if defined(MBEDTLS_X509_CRT_PARSE_C)
-   if (mbedtls_x509_crt_parse(&state->ca, (const unsigned char*)cacert_pem, sizeof(cacert_pem) / sizeof(cacert_pem[0])) < 0)
-      goto error;
+   LOCK_SSL_CACHE();
+   if (!ssl_ca_parsed)
+   {
+      mbedtls_x509_crt_init(&ssl_ca);
+      if (mbedtls_x509_crt_parse(&ssl_ca, (const unsigned char*)cacert_pem,
+               sizeof(cacert_pem) / sizeof(cacert_pem[0])) < 0)
+      {
+         mbedtls_x509_crt_free(&ssl_ca);
+         UNLOCK_SSL_CACHE();
+         goto error;
+      }
+      ssl_ca_parsed = true;
+   }
+   UNLOCK_SSL_CACHE();
 #endif
 
    return state;
@@ -161,7 +248,9 @@ int ssl_socket_connect(void *state_data,
       return -1;
 
    mbedtls_ssl_conf_authmode(&state->conf, MBEDTLS_SSL_VERIFY_OPTIONAL);
-   mbedtls_ssl_conf_ca_chain(&state->conf, &state->ca, NULL);
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+   mbedtls_ssl_conf_ca_chain(&state->conf, &ssl_ca, NULL);
+#endif
    mbedtls_ssl_conf_rng(&state->conf, mbedtls_ctr_drbg_random, &state->ctr_drbg);
    mbedtls_ssl_conf_dbg(&state->conf, ssl_debug, stderr);
 
@@ -175,12 +264,16 @@ int ssl_socket_connect(void *state_data,
 
    mbedtls_ssl_set_bio(&state->ctx, &state->net_ctx, mbedtls_net_send, mbedtls_net_recv, NULL);
 
+   ssl_session_resume(state);
+
    while ((ret = mbedtls_ssl_handshake(&state->ctx)) != 0)
    {
       if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE)
          return -1;
    }
 
+   ssl_session_save(state);
+
    if ((flags = mbedtls_ssl_get_verify_result(&state->ctx)) != 0)
    {
       char vrfy_buf[512];
@@ -349,9 +442,6 @@ void ssl_socket_free(void *state_data)
    mbedtls_ssl_config_free(&state->conf);
    mbedtls_ctr_drbg_free(&state->ctr_drbg);
    mbedtls_entropy_free(&state->entropy);
-#if defined(MBEDTLS_X509_CRT_PARSE_C)
-   mbedtls_x509_crt_free(&state->ca);
-#endif
 
    free(state);
 }
@@ -0,0 +1,136 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (spsc_ring.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER) && !defined(_XBOX)
+#include <windows.h>
+#endif
+
+#include <queues/spsc_ring.h>
+
+/* Orders the data accesses before a position is published against
+ * the other side reading it */
+#if defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) \
+         || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+#define SPSC_RING_BARRIER() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#elif defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+#define SPSC_RING_BARRIER() __sync_synchronize()
+#elif defined(_MSC_VER) && !defined(_XBOX)
+#define SPSC_RING_BARRIER() MemoryBarrier()
+#else
+/* Single core targets */
+#define SPSC_RING_BARRIER() ((void)0)
+#endif
+
+bool spsc_ring_initialize(spsc_ring_t *ring, size_t len)
+{
+   if (!ring)
+      return false;
+
+   /* One byte stays free to tell a full ring from an empty one */
+   if (!(ring->buffer = (uint8_t*)calloc(1, len + 1)))
+      return false;
+
+   ring->size  = len + 1;
+   ring->first = 0;
+   ring->end   = 0;
+   return true;
+}
+
+void spsc_ring_deinitialize(spsc_ring_t *ring)
+{
+   if (!ring)
+      return;
+
+   free(ring->buffer);
+   ring->buffer = NULL;
+   ring->size   = 0;
+   ring->first  = 0;
+   ring->end    = 0;
+}
+
+size_t spsc_ring_read_avail(const spsc_ring_t *ring)
+{
+   size_t first = ring->first;
+   size_t end   = ring->end;
+   return (end >= first) ? end - first : ring->size - first + end;
+}
+
+size_t spsc_ring_write_avail(const spsc_ring_t *ring)
+{
+   return ring->size - 1 - spsc_ring_read_avail(ring);
+}
+
+size_t spsc_ring_write(spsc_ring_t *ring, const void *data, size_t len)
+{
+   size_t first_write;
+   size_t end   = ring->end;
+   size_t avail = spsc_ring_write_avail(ring);
+
+   if (len > avail)
+      len       = avail;
+   if (!len)
+      return 0;
+
+   /* Don't let the data writes move ahead of the read of 'first' */
+   SPSC_RING_BARRIER();
+
+   first_write  = ring->size - end;
+   if (first_write > len)
+      first_write = len;
+
+   memcpy(ring->buffer + end, data, first_write);
+   memcpy(ring->buffer, (const uint8_t*)data + first_write,
+         len - first_write);
+
+   SPSC_RING_BARRIER();
+   ring->end    = (end + len) % ring->size;
+   return len;
+}
+
+size_t spsc_ring_read(spsc_ring_t *ring, void *data, size_t len)
+{
+   size_t first_read;
+   size_t first = ring->first;
+   size_t avail = spsc_ring_read_avail(ring);
+
+   if (len > avail)
+      len       = avail;
+   if (!len)
+      return 0;
+
+   /* Don't read the data before the producer's 'end' that covers it */
+   SPSC_RING_BARRIER();
+
+   first_read   = ring->size - first;
+   if (first_read > len)
+      first_read = len;
+
+   memcpy(data, ring->buffer + first, first_read);
+   memcpy((uint8_t*)data + first_read, ring->buffer, len - first_read);
+
+   SPSC_RING_BARRIER();
+   ring->first  = (first + len) % ring->size;
+   return len;
+}
@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
 
 #include <queues/task_queue.h>
 
@@ -35,13 +36,46 @@
 #ifdef HAVE_THREADS
 #include <rthreads/rthreads.h>
 #endif
-#if defined(EMSCRIPTEN) || defined(_3DS)
+#if defined(_3DS)
 #include <retro_timers.h>
 #endif
+#if defined(EMSCRIPTEN) && defined(HAVE_THREADS)
+#include <emscripten/threading.h>
+#endif
 #ifdef HAVE_GCD
 #include <dispatch/dispatch.h>
 #endif
 
+/* With the atomic builtins, the workers hand finished tasks and
+ * progress to the main thread without locks, and progress, flags,
+ * error and data are read and written without locks. Elsewhere the
+ * same goes through 'finished_lock' and 'property_lock'. */
+#if defined(HAVE_THREADS) && (defined(__clang__) || (defined(__GNUC__) \
+         && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))))
+#define TASK_QUEUE_ATOMICS
+#define TASK_LOAD(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define TASK_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+#define TASK_LOAD(p)     (*(p))
+#define TASK_STORE(p, v) (*(p) = (v))
+#endif
+
+#if defined(HAVE_THREADS) && !defined(TASK_QUEUE_ATOMICS)
+#define TASK_PROPERTY_LOCK()   slock_lock(property_lock)
+#define TASK_PROPERTY_UNLOCK() slock_unlock(property_lock)
+#else
+#define TASK_PROPERTY_LOCK()
+#define TASK_PROPERTY_UNLOCK()
+#endif
+
+/* task->report: a setter changed what the task shows, and the task
+ * is on 'tasks_changed' */
+#define TASK_REPORT_CHANGED  (1 << 0)
+#define TASK_REPORT_QUEUED   (1 << 1)
+/* Longest a running task goes without its progress being shown again,
+ * within the 60 frames its message lasts */
+#define TASK_REPORT_INTERVAL 500000
+
 typedef struct
 {
    retro_task_t *front;
@@ -69,6 +103,7 @@ static task_queue_t tasks_finished          = {NULL, NULL};
 
 static struct retro_task_impl *impl_current = NULL;
 static bool task_threaded_enable            = false;
+static unsigned task_workers_wanted         = 0;
 
 #ifdef HAVE_THREADS
 static uintptr_t main_thread_id             = 0;
@@ -77,9 +112,28 @@ static slock_t *finished_lock               = NULL;
 static slock_t *property_lock               = NULL;
 static slock_t *queue_lock                  = NULL;
 static scond_t *worker_cond                 = NULL;
-static sthread_t *worker_thread             = NULL;
 static bool worker_continue                 = true;
 /* use running_lock when touching it */
+
+/* Worker 0 only runs TASK_PRIORITY_LATENCY tasks, the others the rest */
+static sthread_t *worker_threads[TASK_QUEUE_MAX_WORKERS + 1];
+/* The handler each worker is running, so that tasks sharing
+ * a handler never run at the same time */
+static retro_task_handler_t worker_handlers[TASK_QUEUE_MAX_WORKERS + 1];
+static unsigned worker_count                = 0;
+/* Tasks ready to run, by priority, linked by 'ready_next' */
+static task_queue_t tasks_ready[TASK_PRIORITY_COUNT];
+/* Tasks whose 'when' is yet to come, as a binary min-heap on 'when' */
+static retro_task_t **tasks_timed           = NULL;
+static size_t tasks_timed_count             = 0;
+static size_t tasks_timed_size              = 0;
+/* use running_lock when touching these */
+
+/* Finished tasks, pushed by the workers and taken all at once by the
+ * main thread: a stack linked by 'next', newest first */
+static retro_task_t *tasks_done             = NULL;
+/* Running tasks with progress to show, linked by 'report_next' */
+static retro_task_t *tasks_changed          = NULL;
 #endif
 
 #ifdef HAVE_GCD
@@ -105,6 +159,9 @@ static void task_queue_msg_push(retro_task_t *task,
 
 static void task_queue_push_progress(retro_task_t *task)
 {
+   uint8_t flags;
+   int8_t progress;
+
 #ifdef HAVE_THREADS
    /* msg_push callback interacts directly with the task properties (particularly title).
     * make sure another thread doesn't modify them while rendering
@@ -112,11 +169,14 @@ static void task_queue_push_progress(retro_task_t *task)
    slock_lock(property_lock);
 #endif
 
-   if (task->title && (!((task->flags & RETRO_TASK_FLG_MUTE) > 0)))
+   flags    = TASK_LOAD(&task->flags);
+   progress = TASK_LOAD(&task->progress);
+
+   if (task->title && (!((flags & RETRO_TASK_FLG_MUTE) > 0)))
    {
-      if ((task->flags & RETRO_TASK_FLG_FINISHED) > 0)
+      if ((flags & RETRO_TASK_FLG_FINISHED) > 0)
       {
-         if (task->error)
+         if (TASK_LOAD(&task->error))
             task_queue_msg_push(task, 1, 60, true, "%s: %s",
                "Task failed", task->title);
          else
@@ -124,9 +184,9 @@ static void task_queue_push_progress(retro_task_t *task)
       }
       else
       {
-         if (task->progress >= 0 && task->progress <= 100)
+         if (progress >= 0 && progress <= 100)
             task_queue_msg_push(task, 1, 60, true, "%i%%: %s",
-                  task->progress, task->title);
+                  progress, task->title);
          else
             task_queue_msg_push(task, 1, 60, false, "%s...", task->title);
       }
@@ -385,13 +445,291 @@ static void task_queue_remove(task_queue_t *queue, retro_task_t *task)
    }
 }
 
+/* Pushes onto one of the stacks the workers hand tasks to the main
+ * thread on; any thread */
+static void task_queue_stack_push(retro_task_t **stack,
+      retro_task_t *task, retro_task_t **link)
+{
+#ifdef TASK_QUEUE_ATOMICS
+   retro_task_t *head = __atomic_load_n(stack, __ATOMIC_RELAXED);
+   do
+   {
+      *link = head;
+   } while (!__atomic_compare_exchange_n(stack, &head, task, true,
+            __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+#else
+   slock_lock(finished_lock);
+   *link  = *stack;
+   *stack = task;
+   slock_unlock(finished_lock);
+#endif
+}
+
+/* Takes the whole stack, newest first; main thread only. There is
+ * no popping of single tasks, so the stack has no ABA problem. */
+static retro_task_t *task_queue_stack_take(retro_task_t **stack)
+{
+#ifdef TASK_QUEUE_ATOMICS
+   return __atomic_exchange_n(stack, NULL, __ATOMIC_ACQUIRE);
+#else
+   retro_task_t *head;
+   slock_lock(finished_lock);
+   head   = *stack;
+   *stack = NULL;
+   slock_unlock(finished_lock);
+   return head;
+#endif
+}
+
+static retro_task_t *task_queue_stack_peek(retro_task_t **stack)
+{
+#ifdef TASK_QUEUE_ATOMICS
+   return __atomic_load_n(stack, __ATOMIC_ACQUIRE);
+#else
+   retro_task_t *head;
+   slock_lock(finished_lock);
+   head   = *stack;
+   slock_unlock(finished_lock);
+   return head;
+#endif
+}
+
+/* Called by the worker after a slice of a task that is not finished:
+ * queues the task's progress to be shown if it changed, or
+ * if it was last shown too long ago */
+static void task_queue_report(retro_task_t *task)
+{
+   uint8_t report;
+   retro_time_t now = cpu_features_get_time_usec();
+
+   TASK_PROPERTY_LOCK();
+   report = TASK_LOAD(&task->report);
+   if (      (report & TASK_REPORT_QUEUED)
+         || (!(report & TASK_REPORT_CHANGED)
+            && (now - task->reported < TASK_REPORT_INTERVAL)))
+   {
+      TASK_PROPERTY_UNLOCK();
+      return;
+   }
+   /* Only the worker sets QUEUED, only the main thread clears it */
+   TASK_STORE(&task->report, (uint8_t)TASK_REPORT_QUEUED);
+   TASK_PROPERTY_UNLOCK();
+
+   task->reported = now;
+   task_queue_stack_push(&tasks_changed, task, &task->report_next);
+}
+
+/* Moves the tasks the workers finished to 'tasks_finished', oldest
+ * first; main thread only */
+static void task_queue_collect_done(retro_task_t *done)
+{
+   retro_task_t *queue = NULL;
+
+   while (done)
+   {
+      retro_task_t *next = done->next;
+      done->next         = queue;
+      queue              = done;
+      done               = next;
+   }
+
+   while (queue)
+   {
+      retro_task_t *next = queue->next;
+      task_queue_put(&tasks_finished, queue);
+      queue              = next;
+   }
+}
+
+/* Shows the progress of the tasks on 'tasks_changed', or just takes
+ * them off when 'show' is false; main thread only */
+static void task_queue_gather_changed(bool show)
+{
+   retro_task_t *task = task_queue_stack_take(&tasks_changed);
+
+   while (task)
+   {
+      /* Once QUEUED is cleared the worker may push the task again */
+      retro_task_t *next = task->report_next;
+
+      if (show)
+         task_queue_push_progress(task);
+
+#ifdef TASK_QUEUE_ATOMICS
+      __atomic_fetch_and(&task->report, (uint8_t)~TASK_REPORT_QUEUED,
+            __ATOMIC_RELEASE);
+#else
+      slock_lock(property_lock);
+      task->report &= ~TASK_REPORT_QUEUED;
+      slock_unlock(property_lock);
+#endif
+      task = next;
+   }
+}
+
+/* 'running_lock' must be held for the duration of the functions
+ * up to retro_task_threaded_push_running */
+static bool task_queue_timed_push(retro_task_t *task)
+{
+   size_t i;
+
+   if (tasks_timed_count == tasks_timed_size)
+   {
+      size_t size          = tasks_timed_size ? tasks_timed_size * 2 : 16;
+      retro_task_t **timed = (retro_task_t**)realloc(tasks_timed,
+            size * sizeof(*timed));
+
+      if (!timed)
+         return false;
+
+      tasks_timed          = timed;
+      tasks_timed_size     = size;
+   }
+
+   /* Sift up from the new leaf */
+   for (i = tasks_timed_count++; i > 0; )
+   {
+      size_t parent = (i - 1) / 2;
+      if (tasks_timed[parent]->when <= task->when)
+         break;
+      tasks_timed[i] = tasks_timed[parent];
+      i              = parent;
+   }
+
+   tasks_timed[i] = task;
+   return true;
+}
+
+static retro_task_t *task_queue_timed_pop(void)
+{
+   size_t i           = 0;
+   size_t child;
+   retro_task_t *top  = tasks_timed[0];
+   retro_task_t *last = tasks_timed[--tasks_timed_count];
+
+   /* Sift the last leaf down from the root */
+   while ((child = 2 * i + 1) < tasks_timed_count)
+   {
+      if (     (child + 1 < tasks_timed_count)
+            && (tasks_timed[child + 1]->when < tasks_timed[child]->when))
+         child++;
+      if (last->when <= tasks_timed[child]->when)
+         break;
+      tasks_timed[i] = tasks_timed[child];
+      i              = child;
+   }
+
+   tasks_timed[i] = last;
+   return top;
+}
+
+static void task_queue_ready_put(retro_task_t *task)
+{
+   task_queue_t *lane = &tasks_ready[task->priority];
+
+   task->ready_next   = NULL;
+   if (lane->back)
+      lane->back->ready_next = task;
+   else
+      lane->front            = task;
+   lane->back         = task;
+}
+
+/* Takes the first ready task the worker may run: worker 0 only
+ * takes latency tasks, the others normal ones before background
+ * ones. Tasks whose handler already runs on as many workers as the
+ * task's concurrency allows are skipped. */
+static retro_task_t *task_queue_ready_get(unsigned worker)
+{
+   static const enum task_priority lanes[] = {
+      TASK_PRIORITY_LATENCY,
+      TASK_PRIORITY_NORMAL,
+      TASK_PRIORITY_BACKGROUND
+   };
+   unsigned i;
+   unsigned first = worker ? 1 : 0;
+   unsigned last  = worker ? TASK_PRIORITY_COUNT : 1;
+
+   for (i = first; i < last; i++)
+   {
+      task_queue_t *lane = &tasks_ready[lanes[i]];
+      retro_task_t *prev = NULL;
+      retro_task_t *task = NULL;
+
+      for (task = lane->front; task; prev = task, task = task->ready_next)
+      {
+         unsigned j;
+         unsigned running = 0;
+         unsigned allowed = task->concurrency ? task->concurrency : 1;
+
+         for (j = 0; j < worker_count; j++)
+            if (worker_handlers[j] == task->handler)
+               running++;
+
+         if (running >= allowed)
+            continue;
+
+         if (prev)
+            prev->ready_next = task->ready_next;
+         else
+            lane->front      = task->ready_next;
+         if (lane->back == task)
+            lane->back       = prev;
+         task->ready_next    = NULL;
+         return task;
+      }
+   }
+
+   return NULL;
+}
+
+/* Moves the timed tasks that are due to their lanes.
+ * Returns how long until the next one is due, or 0 if none is left. */
+static retro_time_t task_queue_timed_release(void)
+{
+   retro_time_t now = cpu_features_get_time_usec();
+   bool released    = false;
+
+   while (tasks_timed_count)
+   {
+      /* allow half a millisecond for context switching */
+      retro_time_t delay = tasks_timed[0]->when - now - 500;
+      if (delay > 0)
+      {
+         if (released)
+            scond_broadcast(worker_cond);
+         return delay;
+      }
+      task_queue_ready_put(task_queue_timed_pop());
+      released = true;
+   }
+
+   /* Some of them may be for another worker */
+   if (released)
+      scond_broadcast(worker_cond);
+   return 0;
+}
+
+/* Puts a task that is not running on its lane,
+ * or on the timer heap if it is not due yet */
+static void task_queue_schedule(retro_task_t *task)
+{
+   if (     !task->when
+         || task->when - 500 <= cpu_features_get_time_usec()
+         || !task_queue_timed_push(task))
+      task_queue_ready_put(task);
+
+   /* Also wakes workers that wait for a later timer than this one */
+   scond_broadcast(worker_cond);
+}
+
 static void retro_task_threaded_push_running(retro_task_t *task)
 {
    slock_lock(running_lock);
    slock_lock(queue_lock);
    task_queue_put(&tasks_running, task);
-   scond_signal(worker_cond);
    slock_unlock(queue_lock);
+   task_queue_schedule(task);
    slock_unlock(running_lock);
 }
 
@@ -405,7 +743,7 @@ static void retro_task_threaded_cancel(void *task)
    {
       if (t == task)
       {
-        t->flags |= RETRO_TASK_FLG_CANCELLED;
+        task_set_flags(t, RETRO_TASK_FLG_CANCELLED, true);
         break;
       }
    }
@@ -413,18 +751,16 @@ static void retro_task_threaded_cancel(void *task)
    slock_unlock(running_lock);
 }
 
+/* Takes no locks unless a task finished or has progress to show */
 static void retro_task_threaded_gather(void)
 {
-   retro_task_t *task = NULL;
+   /* Taken first: a task's progress is queued before it finishes,
+    * so it cannot be left on 'tasks_changed' once freed */
+   retro_task_t *done = task_queue_stack_take(&tasks_done);
 
-   slock_lock(running_lock);
-   for (task = tasks_running.front; task; task = task->next)
-      task_queue_push_progress(task);
-   slock_unlock(running_lock);
-
-   slock_lock(finished_lock);
+   task_queue_gather_changed(true);
+   task_queue_collect_done(done);
    retro_task_internal_gather();
-   slock_unlock(finished_lock);
 }
 
 static void retro_task_threaded_wait(retro_task_condition_fn_t cond, void* data)
@@ -441,9 +777,8 @@ static void retro_task_threaded_wait(retro_task_condition_fn_t cond, void* data)
 
       if (!wait)
       {
-         slock_lock(finished_lock);
-         wait = (tasks_finished.front && !tasks_finished.front->when);
-         slock_unlock(finished_lock);
+         retro_task_t *done = task_queue_stack_peek(&tasks_done);
+         wait = (done && !done->when);
       }
    } while (wait && (!cond || cond(data)));
 }
@@ -454,7 +789,7 @@ static void retro_task_threaded_reset(void)
 
    slock_lock(running_lock);
    for (task = tasks_running.front; task; task = task->next)
-      task->flags |= RETRO_TASK_FLG_CANCELLED;
+      task_set_flags(task, RETRO_TASK_FLG_CANCELLED, true);
    slock_unlock(running_lock);
 }
 
@@ -490,91 +825,91 @@ static void retro_task_threaded_retrieve(task_retriever_data_t *data)
 
 static void threaded_worker(void *userdata)
 {
-   for (;;)
+   unsigned worker = (unsigned)(uintptr_t)userdata;
+
+   sthread_role_register("tasks");
+   slock_lock(running_lock);
+
+   while (worker_continue)
    {
       retro_task_t *task  = NULL;
       bool       finished = false;
+      retro_time_t delay  = task_queue_timed_release();
 
-      slock_lock(running_lock);
-
-      if (!worker_continue)
-      {
-         slock_unlock(running_lock);
-         break; /* should we keep running until all tasks finished? */
-      }
-
-      /* Get first task to run */
-      if (!(task = tasks_running.front))
-      {
-         scond_wait(worker_cond, running_lock);
-         slock_unlock(running_lock);
-         continue;
-      }
-
-      if (task->when)
+      if (!(task = task_queue_ready_get(worker)))
       {
-         retro_time_t now   = cpu_features_get_time_usec();
-         retro_time_t delay = task->when - now - 500; /* allow half a millisecond for context switching */
-         if (delay > 0)
-         {
+         if (delay)
             scond_wait_timeout(worker_cond, running_lock, delay);
-            slock_unlock(running_lock);
-            continue;
-         }
+         else
+            scond_wait(worker_cond, running_lock);
+         continue;
       }
 
+      worker_handlers[worker] = task->handler;
       slock_unlock(running_lock);
+
       task->handler(task);
-#if defined(EMSCRIPTEN) || defined(_3DS)
-      /* Workaround emscripten pthread bug where not parking the
-         thread will prevent other important stuff from
-         happening. Maybe due to lack of signals implementation in
-         emscripten's pthreads?  */
+#if defined(EMSCRIPTEN)
+      /* A worker that never waits doesn't run the calls other threads
+       * proxy to it (file system, fetch); run them here instead of
+       * sleeping a millisecond after every step. */
+      emscripten_current_thread_process_queued_calls();
+#elif defined(_3DS)
+      /* Park the thread, so the others get to run */
       retro_sleep(1);
 #endif
 
-      slock_lock(property_lock);
-      finished = ((task->flags & RETRO_TASK_FLG_FINISHED) > 0) ? true : false;
-      slock_unlock(property_lock);
+      finished = ((task_get_flags(task) & RETRO_TASK_FLG_FINISHED) > 0)
+         ? true : false;
+
+      if (!finished)
+         task_queue_report(task);
+
+      slock_lock(running_lock);
+      worker_handlers[worker] = NULL;
+
+      /* Keep the running queue sorted by 'when', the waits look
+       * at its front. */
+      slock_lock(queue_lock);
+      task_queue_remove(&tasks_running, task);
+      if (!finished)
+         task_queue_put(&tasks_running, task);
+      slock_unlock(queue_lock);
 
-      /* Update queue */
       if (!finished)
       {
-         /* Move the task to the back of the queue */
-         /* mimics retro_task_threaded_push_running,
-          * but also includes a task_queue_remove */
-         slock_lock(running_lock);
-         slock_lock(queue_lock);
-
-         /* do nothing if only item in queue */
-         if (task->next)
-         {
-            task_queue_remove(&tasks_running, task);
-            task_queue_put(&tasks_running, task);
-            scond_signal(worker_cond);
-         }
-         slock_unlock(queue_lock);
-         slock_unlock(running_lock);
+         /* Back of its lane, or onto the timer heap */
+         task_queue_schedule(task);
+         continue;
       }
-      else
-      {
-         /* Remove task from running queue */
-         slock_lock(running_lock);
-         slock_lock(queue_lock);
-         task_queue_remove(&tasks_running, task);
-         slock_unlock(queue_lock);
-         slock_unlock(running_lock);
 
-         /* Add task to finished queue */
-         slock_lock(finished_lock);
-         task_queue_put(&tasks_finished, task);
-         slock_unlock(finished_lock);
-      }
+      /* Another worker may be waiting for the handler to be free */
+      scond_broadcast(worker_cond);
+      slock_unlock(running_lock);
+
+      task_queue_stack_push(&tasks_done, task, &task->next);
+
+      slock_lock(running_lock);
    }
+
+   slock_unlock(running_lock);
+   sthread_role_unregister();
 }
 
 static void retro_task_threaded_init(void)
 {
+   unsigned i;
+   retro_task_t *task = NULL;
+   unsigned workers   = task_workers_wanted;
+
+   if (!workers)
+   {
+      unsigned cores  = cpu_features_get_core_amount();
+      workers         = (cores > 3) ? cores - 2 : 1;
+   }
+   if (workers > TASK_QUEUE_MAX_WORKERS)
+      workers         = TASK_QUEUE_MAX_WORKERS;
+
    running_lock    = slock_new();
    finished_lock   = slock_new();
    property_lock   = slock_new();
@@ -583,19 +918,37 @@ static void retro_task_threaded_init(void)
 
    slock_lock(running_lock);
    worker_continue = true;
+   /* One more for the latency lane */
+   worker_count    = workers + 1;
+   /* Tasks carried over from the previous queue */
+   for (task = tasks_running.front; task; task = task->next)
+      task_queue_schedule(task);
    slock_unlock(running_lock);
 
-   worker_thread   = sthread_create(threaded_worker, NULL);
+   for (i = 0; i < worker_count; i++)
+      worker_threads[i] = sthread_create(threaded_worker,
+            (void*)(uintptr_t)i);
 }
 
 static void retro_task_threaded_deinit(void)
 {
+   unsigned i;
+
    slock_lock(running_lock);
    worker_continue = false;
-   scond_signal(worker_cond);
+   scond_broadcast(worker_cond);
    slock_unlock(running_lock);
 
-   sthread_join(worker_thread);
+   for (i = 0; i < worker_count; i++)
+   {
+      sthread_join(worker_threads[i]);
+      worker_threads[i]  = NULL;
+      worker_handlers[i] = NULL;
+   }
+
+   /* Left for whichever queue comes next to gather */
+   task_queue_collect_done(task_queue_stack_take(&tasks_done));
+   task_queue_gather_changed(false);
 
    scond_free(worker_cond);
    slock_free(running_lock);
@@ -603,12 +956,19 @@ static void retro_task_threaded_deinit(void)
    slock_free(property_lock);
    slock_free(queue_lock);
 
-   worker_thread   = NULL;
-   worker_cond     = NULL;
-   running_lock    = NULL;
-   finished_lock   = NULL;
-   property_lock   = NULL;
-   queue_lock      = NULL;
+   /* The tasks stay on the running queue */
+   memset(tasks_ready, 0, sizeof(tasks_ready));
+   free(tasks_timed);
+
+   tasks_timed       = NULL;
+   tasks_timed_count = 0;
+   tasks_timed_size  = 0;
+   worker_count      = 0;
+   worker_cond       = NULL;
+   running_lock      = NULL;
+   finished_lock     = NULL;
+   property_lock     = NULL;
+   queue_lock        = NULL;
 }
 
 static struct retro_task_impl impl_threaded = {
@@ -659,13 +1019,15 @@ static void gcd_worker(retro_task_t *task)
 
    task->handler(task);
 
-   slock_lock(property_lock);
-   finished = ((task->flags & RETRO_TASK_FLG_FINISHED) > 0) ? true : false;
-   slock_unlock(property_lock);
+   finished = ((task_get_flags(task) & RETRO_TASK_FLG_FINISHED) > 0)
+      ? true : false;
 
    if (!finished)
+   {
+      task_queue_report(task);
       dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0),
                      ^{ gcd_worker(task); });
+   }
    else
    {
       /* Remove task from running queue */
@@ -678,10 +1040,7 @@ static void gcd_worker(retro_task_t *task)
       slock_unlock(queue_lock);
       slock_unlock(running_lock);
 
-      /* Add task to finished queue */
-      slock_lock(finished_lock);
-      task_queue_put(&tasks_finished, task);
-      slock_unlock(finished_lock);
+      task_queue_stack_push(&tasks_done, task, &task->next);
    }
 }
 
@@ -714,12 +1073,9 @@ static void retro_task_gcd_wait(retro_task_condition_fn_t cond, void* data)
       slock_unlock(running_lock);
 
       if (!wait)
-      {
-         slock_lock(finished_lock);
-         for (task = tasks_finished.front; !wait && task; task = task->next)
+         for (task = task_queue_stack_peek(&tasks_done); !wait && task;
+               task = task->next)
             wait |= !task->when;
-         slock_unlock(finished_lock);
-      }
    } while (wait && (!cond || cond(data)));
 }
 
@@ -752,6 +1108,9 @@ static void retro_task_gcd_deinit(void)
       scond_wait(worker_cond, running_lock);
    slock_unlock(running_lock);
 
+   task_queue_collect_done(task_queue_stack_take(&tasks_done));
+   task_queue_gather_changed(false);
+
    scond_free(worker_cond);
    slock_free(running_lock);
    slock_free(finished_lock);
@@ -822,6 +1181,11 @@ void task_queue_unset_threaded(void)
    task_threaded_enable = false;
 }
 
+void task_queue_set_workers(unsigned workers)
+{
+   task_workers_wanted = workers;
+}
+
 bool task_queue_is_threaded(void)
 {
    return task_threaded_enable;
@@ -943,34 +1307,45 @@ bool task_is_on_main_thread(void)
 #endif
 }
 
-void task_set_error(retro_task_t *task, char *err)
+/* Any thread; with the property lock held where there are no atomics */
+static void task_set_changed(retro_task_t *task)
 {
-#ifdef HAVE_THREADS
-   slock_lock(property_lock);
-#endif
-   task->error = err;
-#ifdef HAVE_THREADS
-   slock_unlock(property_lock);
+#ifdef TASK_QUEUE_ATOMICS
+   __atomic_fetch_or(&task->report, (uint8_t)TASK_REPORT_CHANGED,
+         __ATOMIC_RELAXED);
+#else
+   task->report |= TASK_REPORT_CHANGED;
 #endif
 }
 
+void task_set_error(retro_task_t *task, char *err)
+{
+   TASK_PROPERTY_LOCK();
+   TASK_STORE(&task->error, err);
+   task_set_changed(task);
+   TASK_PROPERTY_UNLOCK();
+}
+
 void task_set_progress(retro_task_t *task, int8_t progress)
 {
-#ifdef HAVE_THREADS
-   slock_lock(property_lock);
-#endif
-   task->progress = progress;
-#ifdef HAVE_THREADS
-   slock_unlock(property_lock);
-#endif
+   TASK_PROPERTY_LOCK();
+   if (TASK_LOAD(&task->progress) != progress)
+   {
+      TASK_STORE(&task->progress, progress);
+      task_set_changed(task);
+   }
+   TASK_PROPERTY_UNLOCK();
 }
 
+/* The title keeps the lock whatever the compiler: freeing it must
+ * not race the main thread copying it into a message */
 void task_set_title(retro_task_t *task, char *title)
 {
 #ifdef HAVE_THREADS
    slock_lock(property_lock);
 #endif
    task->title = title;
+   task_set_changed(task);
 #ifdef HAVE_THREADS
    slock_unlock(property_lock);
 #endif
@@ -978,11 +1353,11 @@ void task_set_title(retro_task_t *task, char *title)
 
 void task_set_data(retro_task_t *task, void *data)
 {
-#ifdef HAVE_THREADS
+#if defined(HAVE_THREADS) && !defined(TASK_QUEUE_ATOMICS)
    slock_lock(running_lock);
 #endif
-   task->task_data = data;
-#ifdef HAVE_THREADS
+   TASK_STORE(&task->task_data, data);
+#if defined(HAVE_THREADS) && !defined(TASK_QUEUE_ATOMICS)
    slock_unlock(running_lock);
 #endif
 }
@@ -1004,11 +1379,11 @@ void* task_get_data(retro_task_t *task)
 {
    void *data = NULL;
 
-#ifdef HAVE_THREADS
+#if defined(HAVE_THREADS) && !defined(TASK_QUEUE_ATOMICS)
    slock_lock(running_lock);
 #endif
-   data = task->task_data;
-#ifdef HAVE_THREADS
+   data = TASK_LOAD(&task->task_data);
+#if defined(HAVE_THREADS) && !defined(TASK_QUEUE_ATOMICS)
    slock_unlock(running_lock);
 #endif
 
@@ -1017,41 +1392,38 @@ void* task_get_data(retro_task_t *task)
 
 void task_set_flags(retro_task_t *task, uint8_t flags, bool set)
 {
-#ifdef HAVE_THREADS
-   slock_lock(property_lock);
-#endif
+#ifdef TASK_QUEUE_ATOMICS
+   if (set)
+      __atomic_fetch_or(&task->flags, flags, __ATOMIC_ACQ_REL);
+   else
+      __atomic_fetch_and(&task->flags, (uint8_t)~flags, __ATOMIC_ACQ_REL);
+   task_set_changed(task);
+#else
+   TASK_PROPERTY_LOCK();
    if (set)
       task->flags |=  (flags);
    else
       task->flags &= ~(flags);
-#ifdef HAVE_THREADS
-   slock_unlock(property_lock);
+   task_set_changed(task);
+   TASK_PROPERTY_UNLOCK();
 #endif
 }
 
 uint8_t task_get_flags(retro_task_t *task)
 {
    uint8_t _flags = 0;
-#ifdef HAVE_THREADS
-   slock_lock(property_lock);
-#endif
-   _flags = task->flags;
-#ifdef HAVE_THREADS
-   slock_unlock(property_lock);
-#endif
+   TASK_PROPERTY_LOCK();
+   _flags = TASK_LOAD(&task->flags);
+   TASK_PROPERTY_UNLOCK();
    return _flags;
 }
 
 char* task_get_error(retro_task_t *task)
 {
    char *s = NULL;
-#ifdef HAVE_THREADS
-   slock_lock(property_lock);
-#endif
-   s = task->error;
-#ifdef HAVE_THREADS
-   slock_unlock(property_lock);
-#endif
+   TASK_PROPERTY_LOCK();
+   s = TASK_LOAD(&task->error);
+   TASK_PROPERTY_UNLOCK();
    return s;
 }
 
@@ -1059,13 +1431,9 @@ int8_t task_get_progress(retro_task_t *task)
 {
    int8_t progress = 0;
 
-#ifdef HAVE_THREADS
-   slock_lock(property_lock);
-#endif
-   progress = task->progress;
-#ifdef HAVE_THREADS
-   slock_unlock(property_lock);
-#endif
+   TASK_PROPERTY_LOCK();
+   progress = TASK_LOAD(&task->progress);
+   TASK_PROPERTY_UNLOCK();
 
    return progress;
 }
@@ -1110,7 +1478,13 @@ retro_task_t *task_init(void)
    task->ident             = task_count++;
    task->frontend_userdata = NULL;
    task->next              = NULL;
+   task->ready_next        = NULL;
+   task->report_next       = NULL;
    task->when              = 0;
+   task->reported          = 0;
+   task->priority          = TASK_PRIORITY_NORMAL;
+   task->concurrency       = 0;
+   task->report            = 0;
 
    return task;
 }
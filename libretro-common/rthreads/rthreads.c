@@ -71,6 +71,17 @@
 #include <mach/mach.h>
 #endif
 
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+/* Not declared under _POSIX_C_SOURCE; affinity and thread IDs need it */
+extern long syscall(long number, ...);
+#endif
+
+#if defined(USE_WIN32_THREADS) && !defined(_XBOX) && !defined(__WINRT__)
+#define HAVE_WIN32_THREAD_SCHED
+#endif
+
 struct thread_data
 {
    void (*func)(void*);
@@ -809,3 +820,401 @@ uintptr_t sthread_get_current_thread_id(void)
    return (uintptr_t)pthread_self();
 #endif
 }
+
+#if defined(__linux__)
+typedef long sthread_cpu_t;
+#elif defined(__MACH__)
+typedef mach_port_t sthread_cpu_t;
+#elif defined(HAVE_WIN32_THREAD_SCHED)
+typedef HANDLE sthread_cpu_t;
+#else
+typedef int sthread_cpu_t;
+#endif
+
+/* What CPU times of other threads are read through */
+static bool sthread_cpu_open(sthread_cpu_t *cpu)
+{
+#if defined(__linux__)
+   *cpu = syscall(SYS_gettid);
+   return *cpu > 0;
+#elif defined(__MACH__)
+   *cpu = pthread_mach_thread_np(pthread_self());
+   return true;
+#elif defined(HAVE_WIN32_THREAD_SCHED)
+   /* GetCurrentThread is only a pseudo handle */
+   return DuplicateHandle(GetCurrentProcess(), GetCurrentThread(),
+         GetCurrentProcess(), cpu, THREAD_QUERY_INFORMATION, FALSE, 0) != 0;
+#else
+   return false;
+#endif
+}
+
+static void sthread_cpu_close(sthread_cpu_t cpu)
+{
+#if defined(HAVE_WIN32_THREAD_SCHED)
+   CloseHandle(cpu);
+#endif
+}
+
+static int64_t sthread_cpu_time(sthread_cpu_t cpu)
+{
+#if defined(__linux__)
+   /* The kernel's per-thread CPU clock, as pthread_getcpuclockid makes it */
+   struct timespec ts;
+   clockid_t clock = (clockid_t)((~(unsigned long)cpu) << 3) | 6;
+   if (clock_gettime(clock, &ts) != 0)
+      return -1;
+   return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#elif defined(__MACH__)
+   thread_basic_info_data_t info;
+   mach_msg_type_number_t count = THREAD_BASIC_INFO_COUNT;
+   if (thread_info(cpu, THREAD_BASIC_INFO, (thread_info_t)&info,
+            &count) != KERN_SUCCESS)
+      return -1;
+   return   (int64_t)(info.user_time.seconds + info.system_time.seconds)
+          * 1000000
+          + info.user_time.microseconds + info.system_time.microseconds;
+#elif defined(HAVE_WIN32_THREAD_SCHED)
+   FILETIME creation, exited, kernel, user;
+   if (!GetThreadTimes(cpu, &creation, &exited, &kernel, &user))
+      return -1;
+   /* In 100 ns units */
+   return (int64_t)((((uint64_t)kernel.dwHighDateTime << 32)
+            | kernel.dwLowDateTime)
+         + (((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime))
+      / 10;
+#else
+   return -1;
+#endif
+}
+
+bool sthread_set_affinity(uint64_t cpu_mask)
+{
+#if defined(__linux__)
+   unsigned i;
+   unsigned long words[64 / (8 * sizeof(unsigned long))];
+
+   memset(words, 0, sizeof(words));
+   for (i = 0; i < 64; i++)
+      if (cpu_mask & ((uint64_t)1 << i))
+         words[i / (8 * sizeof(unsigned long))] |=
+            1UL << (i % (8 * sizeof(unsigned long)));
+
+   return cpu_mask
+      && syscall(SYS_sched_setaffinity, 0, sizeof(words), words) == 0;
+#elif defined(HAVE_WIN32_THREAD_SCHED)
+   return cpu_mask
+      && SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)cpu_mask) != 0;
+#else
+   /* Apple platforms only take affinity hints, and no others are known */
+   return false;
+#endif
+}
+
+bool sthread_set_priority_class(enum sthread_priority_class priority)
+{
+#if defined(__linux__)
+   int nice_value;
+   long tid = syscall(SYS_gettid);
+
+   switch (priority)
+   {
+      case STHREAD_PRIORITY_CLASS_REALTIME:
+         {
+            struct sched_param sp;
+            memset(&sp, 0, sizeof(sp));
+            sp.sched_priority = sched_get_priority_min(SCHED_FIFO) + 9;
+            if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) == 0)
+               return true;
+         }
+         /* Without the privilege, a lower nice value */
+         nice_value = -10;
+         break;
+      case STHREAD_PRIORITY_CLASS_HIGH:
+         nice_value = -5;
+         break;
+      case STHREAD_PRIORITY_CLASS_BACKGROUND:
+         nice_value = 10;
+         break;
+      case STHREAD_PRIORITY_CLASS_DEFAULT:
+      default:
+         return false;
+   }
+
+   /* On Linux, a thread ID names just that thread */
+   if (nice_value > 0)
+      return setpriority(PRIO_PROCESS, (id_t)tid, nice_value) == 0;
+   /* The highest step RLIMIT_NICE allows */
+   for (; nice_value < 0; nice_value++)
+      if (setpriority(PRIO_PROCESS, (id_t)tid, nice_value) == 0)
+         return true;
+   return false;
+#elif defined(__MACH__) && defined(QOS_MIN_RELATIVE_PRIORITY)
+   qos_class_t qos;
+
+   switch (priority)
+   {
+      case STHREAD_PRIORITY_CLASS_REALTIME:
+      case STHREAD_PRIORITY_CLASS_HIGH:
+         qos = QOS_CLASS_USER_INTERACTIVE;
+         break;
+      case STHREAD_PRIORITY_CLASS_BACKGROUND:
+         qos = QOS_CLASS_UTILITY;
+         break;
+      case STHREAD_PRIORITY_CLASS_DEFAULT:
+      default:
+         return false;
+   }
+
+   return pthread_set_qos_class_self_np(qos, 0) == 0;
+#elif defined(HAVE_WIN32_THREAD_SCHED)
+   int win_priority;
+   const char *mmcss_task = NULL;
+
+   switch (priority)
+   {
+      case STHREAD_PRIORITY_CLASS_REALTIME:
+         mmcss_task   = "Pro Audio";
+         win_priority = THREAD_PRIORITY_TIME_CRITICAL;
+         break;
+      case STHREAD_PRIORITY_CLASS_HIGH:
+         mmcss_task   = "Games";
+         win_priority = THREAD_PRIORITY_ABOVE_NORMAL;
+         break;
+      case STHREAD_PRIORITY_CLASS_BACKGROUND:
+         win_priority = THREAD_PRIORITY_BELOW_NORMAL;
+         break;
+      case STHREAD_PRIORITY_CLASS_DEFAULT:
+      default:
+         return false;
+   }
+
+   /* MMCSS (Vista and up) boosts the thread while it's busy,
+    * without starving the rest of the system */
+   if (mmcss_task)
+   {
+      typedef HANDLE (WINAPI *av_set_mm_thread_characteristics_t)(
+            LPCSTR task, LPDWORD index);
+      static av_set_mm_thread_characteristics_t av_set = NULL;
+      static bool av_loaded                            = false;
+      DWORD task_index                                 = 0;
+
+      if (!av_loaded)
+      {
+         HMODULE avrt = LoadLibraryA("avrt.dll");
+         if (avrt)
+            av_set = (av_set_mm_thread_characteristics_t)GetProcAddress(
+                  avrt, "AvSetMmThreadCharacteristicsA");
+         av_loaded = true;
+      }
+
+      if (av_set && av_set(mmcss_task, &task_index))
+         return true;
+   }
+
+   return SetThreadPriority(GetCurrentThread(), win_priority) != 0;
+#else
+   return false;
+#endif
+}
+
+int64_t sthread_get_cpu_time_usec(void)
+{
+   int64_t usec;
+   sthread_cpu_t cpu;
+
+   if (!sthread_cpu_open(&cpu))
+      return -1;
+   usec = sthread_cpu_time(cpu);
+   sthread_cpu_close(cpu);
+   return usec;
+}
+
+#define STHREAD_ROLES_MAX        16
+#define STHREAD_ROLE_THREADS_MAX 64
+#define STHREAD_ROLE_NAME_LEN    24
+
+struct sthread_role
+{
+   /* CPU time of the role's threads that have unregistered */
+   int64_t retired_usec;
+   uint64_t cpu_mask;
+   enum sthread_priority_class priority;
+   char name[STHREAD_ROLE_NAME_LEN];
+};
+
+struct sthread_role_thread
+{
+   uintptr_t id;
+   sthread_cpu_t cpu;
+   int role;
+   bool cpu_valid;
+};
+
+static slock_t *sthread_role_lock = NULL;
+static struct sthread_role sthread_roles[STHREAD_ROLES_MAX];
+static struct sthread_role_thread sthread_role_threads[STHREAD_ROLE_THREADS_MAX];
+static unsigned sthread_role_count = 0;
+
+/* Must hold sthread_role_lock */
+static int sthread_role_find(const char *role)
+{
+   unsigned i;
+
+   for (i = 0; i < sthread_role_count; i++)
+      if (!strncmp(sthread_roles[i].name, role, STHREAD_ROLE_NAME_LEN - 1))
+         return (int)i;
+
+   if (sthread_role_count >= STHREAD_ROLES_MAX)
+      return -1;
+
+   memset(&sthread_roles[i], 0, sizeof(sthread_roles[i]));
+   strncpy(sthread_roles[i].name, role, STHREAD_ROLE_NAME_LEN - 1);
+   return (int)sthread_role_count++;
+}
+
+/* Must hold sthread_role_lock */
+static struct sthread_role_thread *sthread_role_find_thread(uintptr_t id)
+{
+   unsigned i;
+
+   for (i = 0; i < STHREAD_ROLE_THREADS_MAX; i++)
+      if (sthread_role_threads[i].role >= 0
+            && sthread_role_threads[i].id == id)
+         return &sthread_role_threads[i];
+
+   return NULL;
+}
+
+bool sthread_role_init(void)
+{
+   unsigned i;
+
+   if (sthread_role_lock)
+      return true;
+
+   for (i = 0; i < STHREAD_ROLE_THREADS_MAX; i++)
+      sthread_role_threads[i].role = -1;
+
+   /* Kept until exit; threads may unregister as late as that */
+   return (sthread_role_lock = slock_new()) != NULL;
+}
+
+void sthread_role_configure(const char *role, uint64_t cpu_mask,
+      enum sthread_priority_class priority)
+{
+   int index;
+
+   if (!sthread_role_lock || !role)
+      return;
+
+   slock_lock(sthread_role_lock);
+   if ((index = sthread_role_find(role)) >= 0)
+   {
+      sthread_roles[index].cpu_mask = cpu_mask;
+      sthread_roles[index].priority = priority;
+   }
+   slock_unlock(sthread_role_lock);
+}
+
+bool sthread_role_register(const char *role)
+{
+   int index;
+   uint64_t cpu_mask;
+   enum sthread_priority_class priority;
+   struct sthread_role_thread *thread;
+   uintptr_t id = sthread_get_current_thread_id();
+
+   if (!sthread_role_lock || !role)
+      return false;
+
+   slock_lock(sthread_role_lock);
+   index  = sthread_role_find(role);
+   thread = sthread_role_find_thread(id);
+   if (index >= 0 && !thread)
+   {
+      unsigned i;
+      for (i = 0; i < STHREAD_ROLE_THREADS_MAX && !thread; i++)
+         if (sthread_role_threads[i].role < 0)
+            thread = &sthread_role_threads[i];
+      if (thread)
+      {
+         thread->id        = id;
+         thread->cpu_valid = sthread_cpu_open(&thread->cpu);
+      }
+   }
+   if (index < 0 || !thread)
+   {
+      slock_unlock(sthread_role_lock);
+      return false;
+   }
+   thread->role = index;
+   cpu_mask     = sthread_roles[index].cpu_mask;
+   priority     = sthread_roles[index].priority;
+   slock_unlock(sthread_role_lock);
+
+   if (cpu_mask)
+      sthread_set_affinity(cpu_mask);
+   if (priority != STHREAD_PRIORITY_CLASS_DEFAULT)
+      sthread_set_priority_class(priority);
+   return true;
+}
+
+void sthread_role_unregister(void)
+{
+   struct sthread_role_thread *thread;
+
+   if (!sthread_role_lock)
+      return;
+
+   slock_lock(sthread_role_lock);
+   if ((thread = sthread_role_find_thread(sthread_get_current_thread_id())))
+   {
+      if (thread->cpu_valid)
+      {
+         int64_t usec = sthread_cpu_time(thread->cpu);
+         if (usec > 0)
+            sthread_roles[thread->role].retired_usec += usec;
+         sthread_cpu_close(thread->cpu);
+      }
+      thread->role      = -1;
+      thread->cpu_valid = false;
+   }
+   slock_unlock(sthread_role_lock);
+}
+
+bool sthread_role_get_cpu_time(unsigned index, const char **role,
+      int64_t *usec)
+{
+   unsigned i;
+   int64_t total;
+
+   if (!sthread_role_lock)
+      return false;
+
+   slock_lock(sthread_role_lock);
+   if (index >= sthread_role_count)
+   {
+      slock_unlock(sthread_role_lock);
+      return false;
+   }
+
+   total = sthread_roles[index].retired_usec;
+   for (i = 0; i < STHREAD_ROLE_THREADS_MAX; i++)
+   {
+      if (     sthread_role_threads[i].role == (int)index
+            && sthread_role_threads[i].cpu_valid)
+      {
+         int64_t thread_usec = sthread_cpu_time(sthread_role_threads[i].cpu);
+         if (thread_usec > 0)
+            total += thread_usec;
+      }
+   }
+
+   if (role)
+      *role = sthread_roles[index].name;
+   if (usec)
+      *usec = total;
+   slock_unlock(sthread_role_lock);
+   return true;
+}
@@ -31,14 +31,50 @@
 #include <libchdr/chd.h>
 #include <string/stdstring.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #define SECTOR_RAW_SIZE 2352
 #define SECTOR_SIZE 2048
 #define SUBCODE_SIZE 96
 #define TRACK_PAD 4
 
+/* Decoded hunks kept per stream */
+#define CHDSTREAM_CACHE_HUNKS 4
+
+#ifdef HAVE_THREADS
+#define CHDSTREAM_LOCK(stream) slock_lock((stream)->lock)
+#define CHDSTREAM_UNLOCK(stream) slock_unlock((stream)->lock)
+#else
+#define CHDSTREAM_LOCK(stream)
+#define CHDSTREAM_UNLOCK(stream)
+#endif
+
+struct chdstream_hunk
+{
+   uint8_t *mem;
+   /* Last use, for eviction */
+   uint32_t used;
+   /* Hunk number held, or -1 */
+   int32_t hunknum;
+};
+
 struct chdstream
 {
    chd_file *chd;
+   struct chdstream_hunk cache[CHDSTREAM_CACHE_HUNKS];
+#ifdef HAVE_THREADS
+   /* Decodes the hunk after a sequential read ahead of time.
+    * The lock covers chd and the cache slots; the slot holding
+    * hunkmem is never replaced by the thread. */
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   /* Hunk the thread should decode next, or -1 */
+   int32_t prefetch;
+   bool quit;
+#endif
    /* Loaded hunk */
    uint8_t *hunkmem;
    /* Byte offset where track data starts (after pregap) */
@@ -57,6 +93,10 @@ struct chdstream
    uint32_t frames_per_hunk;
    /* First frame of track in chd */
    uint32_t track_frame;
+   /* Hunk loads served from the cache, and decoded on demand */
+   uint32_t hits;
+   uint32_t misses;
+   uint32_t use_clock;
    /* Should we swap bytes? */
    bool swab;
 };
@@ -217,8 +257,8 @@ chdstream_find_track(chd_file *fd, int32_t track, metadata_t *meta)
 chdstream_t *chdstream_open(const char *path, int32_t track)
 {
    metadata_t meta;
+   unsigned i;
    uint32_t pregap         = 0;
-   uint8_t *hunkmem        = NULL;
    const chd_header *hd    = NULL;
    chdstream_t *stream     = NULL;
    chd_file *chd           = NULL;
@@ -230,7 +270,7 @@ chdstream_t *chdstream_open(const char *path, int32_t track)
    if (!chdstream_find_track(chd, track, &meta))
       goto error;
 
-   stream                  = (chdstream_t*)malloc(sizeof(*stream));
+   stream                  = (chdstream_t*)calloc(1, sizeof(*stream));
    if (!stream)
       goto error;
 
@@ -247,11 +287,18 @@ chdstream_t *chdstream_open(const char *path, int32_t track)
    stream->hunknum         = -1;
 
    hd                      = chd_get_header(chd);
-   hunkmem                 = (uint8_t*)malloc(hd->hunkbytes);
-   if (!hunkmem)
-      goto error;
+   for (i = 0; i < CHDSTREAM_CACHE_HUNKS; i++)
+   {
+      stream->cache[i].hunknum = -1;
+      if (!(stream->cache[i].mem = (uint8_t*)malloc(hd->hunkbytes)))
+         goto error;
+   }
 
-   stream->hunkmem         = hunkmem;
+#ifdef HAVE_THREADS
+   stream->prefetch        = -1;
+   if (!(stream->lock = slock_new()))
+      goto error;
+#endif
 
    if (string_is_equal(meta.type, "MODE1_RAW"))
       stream->frame_size   = SECTOR_RAW_SIZE;
@@ -296,38 +343,165 @@ error:
 
 void chdstream_close(chdstream_t *stream)
 {
+   unsigned i;
+
    if (!stream)
       return;
 
-   if (stream->hunkmem)
-      free(stream->hunkmem);
+#ifdef HAVE_THREADS
+   if (stream->thread)
+   {
+      slock_lock(stream->lock);
+      stream->quit = true;
+      scond_signal(stream->cond);
+      slock_unlock(stream->lock);
+      sthread_join(stream->thread);
+   }
+   if (stream->cond)
+      scond_free(stream->cond);
+   if (stream->lock)
+      slock_free(stream->lock);
+#endif
+
+   for (i = 0; i < CHDSTREAM_CACHE_HUNKS; i++)
+      if (stream->cache[i].mem)
+         free(stream->cache[i].mem);
    if (stream->chd)
       chd_close(stream->chd);
    free(stream);
 }
 
+static int chdstream_find_hunk(chdstream_t *stream, int32_t hunknum)
+{
+   int i;
+   for (i = 0; i < CHDSTREAM_CACHE_HUNKS; i++)
+      if (stream->cache[i].hunknum == hunknum)
+         return i;
+   return -1;
+}
+
+/* Decodes a hunk into the least recently used slot other than
+ * the one being read from. Call with the lock held.
+ * Returns the slot, or -1 on error. */
+static int chdstream_decode_hunk(chdstream_t *stream, uint32_t hunknum)
+{
+   int i;
+   int slot = -1;
+
+   for (i = 0; i < CHDSTREAM_CACHE_HUNKS; i++)
+   {
+      if (stream->cache[i].mem == stream->hunkmem)
+         continue;
+      if (slot < 0 || stream->cache[i].used < stream->cache[slot].used)
+         slot = i;
+   }
+
+   stream->cache[slot].hunknum = -1;
+
+   if (chd_read(stream->chd, hunknum, stream->cache[slot].mem)
+         != CHDERR_NONE)
+      return -1;
+
+   if (stream->swab)
+   {
+      uint32_t j;
+      uint32_t count  = chd_get_header(stream->chd)->hunkbytes / 2;
+      uint16_t *array = (uint16_t*)stream->cache[slot].mem;
+      for (j = 0; j < count; ++j)
+         array[j] = SWAP16(array[j]);
+   }
+
+   stream->cache[slot].hunknum = hunknum;
+   stream->cache[slot].used    = stream->use_clock;
+   return slot;
+}
+
+#ifdef HAVE_THREADS
+static void chdstream_prefetch_thread(void *data)
+{
+   chdstream_t *stream = (chdstream_t*)data;
+
+   slock_lock(stream->lock);
+   while (!stream->quit)
+   {
+      int32_t hunknum = stream->prefetch;
+
+      if (hunknum < 0)
+      {
+         scond_wait(stream->cond, stream->lock);
+         continue;
+      }
+
+      stream->prefetch = -1;
+      if (chdstream_find_hunk(stream, hunknum) < 0)
+         chdstream_decode_hunk(stream, hunknum);
+   }
+   slock_unlock(stream->lock);
+}
+
+/* Has the thread decode the next hunk, starting it on the first
+ * sequential read. Call with the lock held. */
+static void chdstream_prefetch(chdstream_t *stream, uint32_t hunknum)
+{
+   if (hunknum >= chd_get_header(stream->chd)->totalhunks)
+      return;
+   if (chdstream_find_hunk(stream, hunknum) >= 0)
+      return;
+
+   if (!stream->thread)
+   {
+      if (!stream->cond && !(stream->cond = scond_new()))
+         return;
+      if (!(stream->thread = sthread_create(
+                  chdstream_prefetch_thread, stream)))
+         return;
+   }
+
+   stream->prefetch = hunknum;
+   scond_signal(stream->cond);
+}
+#endif
+
 static bool
 chdstream_load_hunk(chdstream_t *stream, uint32_t hunknum)
 {
-   uint16_t *array;
+   int slot;
+#ifdef HAVE_THREADS
+   bool sequential;
+#endif
 
    if ((int)hunknum == stream->hunknum)
       return true;
 
-   if (chd_read(stream->chd, hunknum, stream->hunkmem) != CHDERR_NONE)
-      return false;
+#ifdef HAVE_THREADS
+   sequential = (stream->hunknum >= 0)
+      && (hunknum == (uint32_t)stream->hunknum + 1);
+#endif
 
-   if (stream->swab)
+   CHDSTREAM_LOCK(stream);
+   stream->use_clock++;
+
+   if ((slot = chdstream_find_hunk(stream, hunknum)) >= 0)
+      stream->hits++;
+   else
+   {
+      stream->misses++;
+      slot = chdstream_decode_hunk(stream, hunknum);
+   }
+
+   if (slot >= 0)
    {
-      uint32_t i;
-      uint32_t count = chd_get_header(stream->chd)->hunkbytes / 2;
-      array          = (uint16_t*)stream->hunkmem;
-      for (i = 0; i < count; ++i)
-         array[i] = SWAP16(array[i]);
+      stream->cache[slot].used = stream->use_clock;
+      stream->hunkmem          = stream->cache[slot].mem;
+      stream->hunknum          = hunknum;
+#ifdef HAVE_THREADS
+      if (sequential)
+         chdstream_prefetch(stream, hunknum + 1);
+#endif
    }
+   CHDSTREAM_UNLOCK(stream);
 
-   stream->hunknum = hunknum;
-   return true;
+   return slot >= 0;
 }
 
 ssize_t chdstream_read(chdstream_t *stream, void *data, size_t bytes)
@@ -463,6 +637,15 @@ uint32_t chdstream_get_frame_size(chdstream_t *stream)
    return stream->frame_size;
 }
 
+void chdstream_get_cache_stats(chdstream_t *stream,
+      uint32_t *hits, uint32_t *misses)
+{
+   CHDSTREAM_LOCK(stream);
+   *hits   = stream->hits;
+   *misses = stream->misses;
+   CHDSTREAM_UNLOCK(stream);
+}
+
 uint32_t chdstream_get_first_track_sector(chdstream_t* stream)
 {
    uint32_t i;
@@ -640,6 +640,36 @@ error:
    return 0;
 }
 
+bool filestream_map_file(const char *path, void **buf, int64_t *len)
+{
+   uint64_t size = 0;
+   void *data    = NULL;
+
+   /* A VFS interface other than our own has no way
+    * to map files */
+   if (!filestream_open_cb)
+      data = retro_vfs_file_map_impl(path, &size);
+
+   if (!data || (int64_t)size < 0)
+   {
+      if (data)
+         retro_vfs_file_unmap_impl(data, size);
+      *buf = NULL;
+      *len = -1;
+      return false;
+   }
+
+   *buf = data;
+   *len = (int64_t)size;
+   return true;
+}
+
+void filestream_unmap_file(void *buf, int64_t len)
+{
+   if (buf)
+      retro_vfs_file_unmap_impl(buf, (uint64_t)len);
+}
+
 bool filestream_write_file(const char *path, const void *data, int64_t size)
 {
    int64_t ret   = 0;
@@ -662,17 +662,24 @@ bool intfstream_get_crc(intfstream_internal_t *intf, uint32_t *crc)
 {
    int64_t data_read    = 0;
    uint32_t accumulator = 0;
-   uint8_t buffer[4096];
+   /* Large enough that the read calls don't dominate the CRC */
+   const size_t buf_size = 64 * 1024;
+   uint8_t *buffer      = NULL;
 
    if (!intf || !crc)
       return false;
 
+   if (!(buffer = (uint8_t*)malloc(buf_size)))
+      return false;
+
    /* Ensure we start at the beginning of the file */
    intfstream_rewind(intf);
 
-   while ((data_read = intfstream_read(intf, buffer, sizeof(buffer))) > 0)
+   while ((data_read = intfstream_read(intf, buffer, buf_size)) > 0)
       accumulator = encoding_crc32(accumulator, buffer, (size_t)data_read);
 
+   free(buffer);
+
    if (data_read < 0)
       return false;
 
@@ -20,6 +20,9 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <string.h>
+
+#include <retro_miscellaneous.h>
 #include <string/stdstring.h>
 #include <file/file_path.h>
 
@@ -28,9 +31,18 @@
 
 #include <streams/rzip_stream.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/tpool.h>
+#include <features/features_cpu.h>
+#endif
+
 /* Current RZIP file format version */
 #define RZIP_VERSION 1
 
+/* Same layout, but each chunk is an LZ4 block
+ * instead of a zlib stream */
+#define RZIP_VERSION_LZ4 2
+
 /* Compression level
  * > zlib default of 6 provides the best
  *   balance between file size and
@@ -44,6 +56,32 @@
 #define RZIP_HEADER_SIZE 20
 #define RZIP_CHUNK_HEADER_SIZE 4
 
+/* Maximum number of chunks compressed or
+ * decompressed at once
+ * > Every chunk is a complete zlib stream (or
+ *   LZ4 block) of its own, so a batch can be
+ *   spread over worker threads and still give
+ *   the same file as doing it one at a time */
+#ifdef HAVE_THREADS
+#define RZIP_BATCH_CHUNKS 8
+#else
+#define RZIP_BATCH_CHUNKS 1
+#endif
+
+/* One chunk of a batch */
+struct rzip_chunk_job
+{
+   const struct trans_stream_backend *backend;
+   void *stream;
+   const uint8_t *in;
+   uint8_t *out;
+   uint32_t in_size;
+   uint32_t out_size;
+   uint32_t read;
+   uint32_t written;
+   bool ok;
+};
+
 /* Holds all metadata for an RZIP file stream */
 struct rzipstream
 {
@@ -64,6 +102,18 @@ struct rzipstream
    uint32_t out_buf_ptr;
    uint32_t out_buf_occupancy;
    uint32_t chunk_size;
+   /* batch_chunks: Number of chunks the buffers
+    * hold; in_buf and out_buf are split into
+    * this many equal slots */
+   uint32_t batch_chunks;
+   /* Transform streams of batch slots 1 and up,
+    * created on first use (slot 0 uses the
+    * deflate/inflate stream above) */
+   void *job_streams[RZIP_BATCH_CHUNKS];
+#ifdef HAVE_THREADS
+   tpool_t *pool;
+#endif
+   enum rzip_codec codec;
    bool is_compressed;
    bool is_writing;
 };
@@ -105,7 +155,8 @@ static bool rzipstream_read_file_header(rzipstream_t *stream)
        || (header_bytes[3] !=           73)  /* I */
        || (header_bytes[4] !=           80)  /* P */
        || (header_bytes[5] !=          118)  /* v */
-       || (header_bytes[6] != RZIP_VERSION)  /* file format version number */
+       || (   (header_bytes[6] != RZIP_VERSION)  /* file format version number */
+           && (header_bytes[6] != RZIP_VERSION_LZ4))
        || (header_bytes[7] !=           35)) /* # */
    {
       /* Reset file to start */
@@ -136,6 +187,11 @@ static bool rzipstream_read_file_header(rzipstream_t *stream)
                    | (uint64_t)header_bytes[12]) == 0)
       return false;
 
+   /* Note: An LZ4 file is refused later on if
+    * LZ4 support is not built in */
+   stream->codec = (header_bytes[6] == RZIP_VERSION_LZ4) ?
+         RZIP_CODEC_LZ4 : RZIP_CODEC_ZLIB;
+
    stream->is_compressed = true;
    return true;
 }
@@ -162,7 +218,8 @@ static bool rzipstream_write_file_header(rzipstream_t *stream)
    header_bytes[3]    =        73;    /* I */
    header_bytes[4]    =        80;    /* P */
    header_bytes[5]    =       118;    /* v */
-   header_bytes[6]    = RZIP_VERSION; /* file format version number */
+   header_bytes[6]    = (stream->codec == RZIP_CODEC_LZ4) ?
+         RZIP_VERSION_LZ4 : RZIP_VERSION; /* file format version number */
    header_bytes[7]    =        35;    /* # */
 
    /* > Uncompressed chunk size - next 4 bytes */
@@ -191,6 +248,55 @@ static bool rzipstream_write_file_header(rzipstream_t *stream)
 
 /* Stream Initialisation/De-initialisation */
 
+/* Returns the transform backend that compresses
+ * (or decompresses) chunks for 'codec', or NULL
+ * if it is not available */
+static const struct trans_stream_backend *rzipstream_get_backend(
+      enum rzip_codec codec, bool is_writing)
+{
+   if (codec == RZIP_CODEC_LZ4)
+      return is_writing ?
+            trans_stream_get_lz4_compress_backend() :
+            trans_stream_get_lz4_decompress_backend();
+   return is_writing ?
+         trans_stream_get_zlib_deflate_backend() :
+         trans_stream_get_zlib_inflate_backend();
+}
+
+/* Creates a transform stream for 'backend', set up
+ * for the stream's codec */
+static void *rzipstream_new_transform(rzipstream_t *stream,
+      const struct trans_stream_backend *backend)
+{
+   void *trans = backend->stream_new();
+
+   /* Set compression level */
+   if (     trans
+         && stream->is_writing
+         && (stream->codec == RZIP_CODEC_ZLIB)
+         && !backend->define(trans, "level", RZIP_COMPRESSION_LEVEL))
+   {
+      backend->stream_free(trans);
+      return NULL;
+   }
+
+   return trans;
+}
+
+/* Returns the number of chunks to handle at once
+ * > One per core, if there are cores to spare */
+static uint32_t rzipstream_get_batch_chunks(void)
+{
+#ifdef HAVE_THREADS
+   unsigned cores = cpu_features_get_core_amount();
+   if (cores > RZIP_BATCH_CHUNKS)
+      cores = RZIP_BATCH_CHUNKS;
+   if (cores > 1)
+      return cores;
+#endif
+   return 1;
+}
+
 /* Initialises all members of an rzipstream_t struct,
  * reading config from existing file header if available */
 static bool rzipstream_init_stream(
@@ -216,6 +322,8 @@ static bool rzipstream_init_stream(
    stream->out_buf_size      = 0;
    stream->out_buf_ptr       = 0;
    stream->out_buf_occupancy = 0;
+   stream->batch_chunks      = 1;
+   stream->codec             = RZIP_CODEC_ZLIB;
 
    /* Check whether this is a read or write stream */
    stream->is_writing = is_writing;
@@ -256,20 +364,19 @@ static bool rzipstream_init_stream(
    if (stream->is_writing)
    {
       /* Compression */
-      if (!(stream->deflate_backend = trans_stream_get_zlib_deflate_backend()))
-         return false;
-
-      if (!(stream->deflate_stream = stream->deflate_backend->stream_new()))
+      if (!(stream->deflate_backend = rzipstream_get_backend(
+            stream->codec, true)))
          return false;
 
-      /* Set compression level */
-      if (!stream->deflate_backend->define(
-            stream->deflate_stream, "level", RZIP_COMPRESSION_LEVEL))
+      if (!(stream->deflate_stream = rzipstream_new_transform(
+            stream, stream->deflate_backend)))
          return false;
 
       /* Buffers
        * > Input: uncompressed
-       * > Output: compressed */
+       * > Output: compressed
+       * (Sizes are per chunk here, and multiplied
+       * by the batch size below) */
       stream->in_buf_size  = stream->chunk_size;
       stream->out_buf_size = stream->chunk_size * 2;
       /* > Account for minimum zlib overhead
@@ -283,16 +390,22 @@ static bool rzipstream_init_stream(
       if (   (stream->in_buf_size  == 0)
           || (stream->out_buf_size == 0))
          return false;
+
+      /* Size of the written file is not known
+       * yet: always batch */
+      stream->batch_chunks = rzipstream_get_batch_chunks();
    }
    /* When reading, don't need an inflate transform
     * stream (or buffers) if source file is uncompressed */
    else if (stream->is_compressed)
    {
       /* Decompression */
-      if (!(stream->inflate_backend = trans_stream_get_zlib_inflate_backend()))
+      if (!(stream->inflate_backend = rzipstream_get_backend(
+            stream->codec, false)))
          return false;
 
-      if (!(stream->inflate_stream = stream->inflate_backend->stream_new()))
+      if (!(stream->inflate_stream = rzipstream_new_transform(
+            stream, stream->inflate_backend)))
          return false;
 
       /* Buffers
@@ -312,8 +425,23 @@ static bool rzipstream_init_stream(
       if (   (stream->in_buf_size  == 0)
           || (stream->out_buf_size == 0))
          return false;
+
+      /* Files of a single chunk gain nothing
+       * from batching */
+      if (stream->size > stream->chunk_size)
+         stream->batch_chunks = rzipstream_get_batch_chunks();
    }
 
+   /* Guard against overflowing the 32 bit
+    * buffer sizes with huge chunk sizes */
+   if (   (stream->batch_chunks > 1)
+       && (MAX(stream->in_buf_size, stream->out_buf_size) >
+            0xFFFFFFFF / stream->batch_chunks))
+      stream->batch_chunks = 1;
+
+   stream->in_buf_size  *= stream->batch_chunks;
+   stream->out_buf_size *= stream->batch_chunks;
+
    /* Allocate buffers */
    if (stream->in_buf_size > 0)
    {
@@ -334,12 +462,32 @@ static bool rzipstream_init_stream(
  * > Also closes associated file, if currently open */
 static int rzipstream_free_stream(rzipstream_t *stream)
 {
+   unsigned i;
    int ret = 0;
 
    if (!stream)
       return -1;
 
    /* Free transform streams */
+   for (i = 0; i < RZIP_BATCH_CHUNKS; i++)
+   {
+      if (stream->job_streams[i])
+      {
+         const struct trans_stream_backend *backend =
+            stream->is_writing ?
+                  stream->deflate_backend : stream->inflate_backend;
+         if (backend)
+            backend->stream_free(stream->job_streams[i]);
+      }
+      stream->job_streams[i] = NULL;
+   }
+
+#ifdef HAVE_THREADS
+   if (stream->pool)
+      tpool_destroy(stream->pool);
+   stream->pool = NULL;
+#endif
+
    if (stream->deflate_stream && stream->deflate_backend)
       stream->deflate_backend->stream_free(stream->deflate_stream);
 
@@ -419,6 +567,12 @@ rzipstream_t* rzipstream_open(const char *path, unsigned mode)
    stream->out_buf_size    = 0;
    stream->out_buf_ptr     = 0;
    stream->out_buf_occupancy = 0;
+   stream->batch_chunks    = 1;
+   stream->codec           = RZIP_CODEC_ZLIB;
+   memset(stream->job_streams, 0, sizeof(stream->job_streams));
+#ifdef HAVE_THREADS
+   stream->pool            = NULL;
+#endif
 
    /* Initialise stream */
    if (!rzipstream_init_stream(
@@ -432,92 +586,257 @@ rzipstream_t* rzipstream_open(const char *path, unsigned mode)
    return stream;
 }
 
-/* File Read */
+/* Chunk Batches */
 
-/* Reads and decompresses the next chunk of data
- * in the RZIP file */
-static bool rzipstream_read_chunk(rzipstream_t *stream)
+/* Returns the transform stream of batch slot 'slot',
+ * creating it if required */
+static void *rzipstream_get_job_stream(rzipstream_t *stream,
+      unsigned slot)
+{
+   const struct trans_stream_backend *backend = stream->is_writing ?
+         stream->deflate_backend : stream->inflate_backend;
+
+   if (slot == 0)
+      return stream->is_writing ?
+            stream->deflate_stream : stream->inflate_stream;
+
+   if (!stream->job_streams[slot - 1])
+      stream->job_streams[slot - 1] = rzipstream_new_transform(
+            stream, backend);
+
+   return stream->job_streams[slot - 1];
+}
+
+/* Sets up batch slot 'slot' to transform 'in_size'
+ * bytes from 'in' into its share of the output buffer */
+static bool rzipstream_init_job(rzipstream_t *stream,
+      struct rzip_chunk_job *job, unsigned slot,
+      const uint8_t *in, uint32_t in_size)
+{
+   uint32_t out_size = stream->out_buf_size / stream->batch_chunks;
+
+   if (!(job->stream = rzipstream_get_job_stream(stream, slot)))
+      return false;
+
+   job->backend  = stream->is_writing ?
+         stream->deflate_backend : stream->inflate_backend;
+   job->in       = in;
+   job->in_size  = in_size;
+   job->out      = stream->out_buf + slot * out_size;
+   job->out_size = out_size;
+   job->read     = 0;
+   job->written  = 0;
+   job->ok       = false;
+   return true;
+}
+
+static void rzipstream_run_job(void *data)
+{
+   struct rzip_chunk_job *job = (struct rzip_chunk_job*)data;
+
+   job->backend->set_in(job->stream, job->in, job->in_size);
+   job->backend->set_out(job->stream, job->out, job->out_size);
+
+   /* Note: We have to set 'flush == true' here, otherwise we
+    * can't guarantee that the entire chunk will be written
+    * to the output buffer - this is inefficient, but not
+    * much we can do... */
+   job->ok = job->backend->trans(job->stream, true,
+         &job->read, &job->written, NULL);
+
+   /* Error checking */
+   if (   (job->read != job->in_size)
+       || (job->written == 0)
+       || (job->written > job->out_size))
+      job->ok = false;
+}
+
+/* Transforms the chunks of a batch, on worker
+ * threads if there is more than one */
+static void rzipstream_run_jobs(rzipstream_t *stream,
+      struct rzip_chunk_job *jobs, unsigned count)
 {
    unsigned i;
-   uint8_t chunk_header_bytes[RZIP_CHUNK_HEADER_SIZE];
-   uint32_t compressed_chunk_size;
-   uint32_t inflate_read;
-   uint32_t inflate_written;
 
-   if (!stream || !stream->inflate_backend || !stream->inflate_stream)
+#ifdef HAVE_THREADS
+   if ((count > 1) && !stream->pool)
+      stream->pool = tpool_create(stream->batch_chunks);
+
+   if ((count > 1) && stream->pool)
+   {
+      for (i = 0; i < count; i++)
+         if (!tpool_add_work(stream->pool, rzipstream_run_job, &jobs[i]))
+            rzipstream_run_job(&jobs[i]);
+      tpool_wait(stream->pool);
+      return;
+   }
+#endif
+
+   for (i = 0; i < count; i++)
+      rzipstream_run_job(&jobs[i]);
+}
+
+/* Switches a stream opened for writing to 'codec'
+ * > Only possible before any data is written
+ * Returns false if 'codec' is not available */
+bool rzipstream_set_codec(rzipstream_t *stream, enum rzip_codec codec)
+{
+   unsigned i;
+   const struct trans_stream_backend *backend;
+   void *trans;
+
+   if (!stream || !stream->is_writing || (stream->size > 0))
       return false;
 
-   for (i = 0; i < RZIP_CHUNK_HEADER_SIZE; i++)
-      chunk_header_bytes[i] = 0;
+   if (codec == stream->codec)
+      return true;
 
-   /* Attempt to read chunk header bytes */
-   if (filestream_read(
-         stream->file, chunk_header_bytes, sizeof(chunk_header_bytes)) !=
-         RZIP_CHUNK_HEADER_SIZE)
+   if (!(backend = rzipstream_get_backend(codec, true)))
       return false;
 
-   /* Get size of next compressed chunk */
-   compressed_chunk_size = ( (uint32_t)chunk_header_bytes[3]  << 24)
-                           | ((uint32_t)chunk_header_bytes[2] << 16)
-                           | ((uint32_t)chunk_header_bytes[1] <<  8)
-                           | (uint32_t)chunk_header_bytes[0];
-   if (compressed_chunk_size == 0)
+   stream->codec = codec;
+   if (!(trans = rzipstream_new_transform(stream, backend)))
+   {
+      stream->codec = (codec == RZIP_CODEC_ZLIB) ?
+            RZIP_CODEC_LZ4 : RZIP_CODEC_ZLIB;
       return false;
+   }
 
-   /* Resize input buffer, if required */
-   if (compressed_chunk_size > stream->in_buf_size)
+   /* Drop the streams of the old codec */
+   for (i = 0; i < RZIP_BATCH_CHUNKS; i++)
    {
-      free(stream->in_buf);
-      stream->in_buf      = NULL;
+      if (stream->job_streams[i])
+         stream->deflate_backend->stream_free(stream->job_streams[i]);
+      stream->job_streams[i] = NULL;
+   }
+   stream->deflate_backend->stream_free(stream->deflate_stream);
 
-      stream->in_buf_size = compressed_chunk_size;
-      stream->in_buf      = (uint8_t *)calloc(stream->in_buf_size, 1);
-      if (!stream->in_buf)
-         return false;
+   stream->deflate_backend = backend;
+   stream->deflate_stream  = trans;
 
-      /* Note: Uncompressed data size is fixed, and read
-       * from the file header - we therefore don't attempt
-       * to resize the output buffer (if it's too small, then
-       * that's an error condition) */
-   }
+   /* Mark the file with its new format version */
+   return rzipstream_write_file_header(stream);
+}
+
+/* File Read */
 
-   /* Read compressed chunk from file */
-   if (filestream_read(
-         stream->file, stream->in_buf, compressed_chunk_size) !=
-         compressed_chunk_size)
+/* Reads and decompresses the next chunk(s) of data
+ * in the RZIP file
+ * > Decompressed data is packed into the output
+ *   buffer, starting at stream->virtual_ptr */
+static bool rzipstream_read_chunk(rzipstream_t *stream)
+{
+   unsigned i;
+   struct rzip_chunk_job jobs[RZIP_BATCH_CHUNKS];
+   uint32_t offsets[RZIP_BATCH_CHUNKS];
+   uint8_t chunk_header_bytes[RZIP_CHUNK_HEADER_SIZE];
+   uint64_t remaining;
+   uint32_t in_buf_used = 0;
+   unsigned count       = 0;
+
+   if (!stream || !stream->inflate_backend || !stream->inflate_stream)
       return false;
 
-   /* Decompress chunk data */
-   stream->inflate_backend->set_in(
-         stream->inflate_stream,
-         stream->in_buf, compressed_chunk_size);
+   /* Get number of chunks to read: as many as the
+    * batch holds, but not past the end of the data */
+   remaining = (stream->virtual_ptr < stream->size) ?
+         stream->size - stream->virtual_ptr : 0;
+
+   for (;;)
+   {
+      uint32_t compressed_chunk_size;
+      int64_t chunk_pos = filestream_tell(stream->file);
+
+      for (i = 0; i < RZIP_CHUNK_HEADER_SIZE; i++)
+         chunk_header_bytes[i] = 0;
+
+      /* Attempt to read chunk header bytes */
+      if (filestream_read(
+            stream->file, chunk_header_bytes, sizeof(chunk_header_bytes)) !=
+            RZIP_CHUNK_HEADER_SIZE)
+         goto bad_chunk;
+
+      /* Get size of next compressed chunk */
+      compressed_chunk_size = ( (uint32_t)chunk_header_bytes[3]  << 24)
+                              | ((uint32_t)chunk_header_bytes[2] << 16)
+                              | ((uint32_t)chunk_header_bytes[1] <<  8)
+                              | (uint32_t)chunk_header_bytes[0];
+      if (compressed_chunk_size == 0)
+         goto bad_chunk;
+
+      /* Resize input buffer, if required
+       * > Chunks already read must be kept */
+      if (compressed_chunk_size > stream->in_buf_size - in_buf_used)
+      {
+         uint8_t *in_buf;
+         uint32_t in_buf_size = in_buf_used + compressed_chunk_size;
 
-   stream->inflate_backend->set_out(
-         stream->inflate_stream,
-         stream->out_buf, stream->out_buf_size);
+         if (in_buf_size < in_buf_used)
+            goto bad_chunk;
+         if (!(in_buf = (uint8_t*)realloc(stream->in_buf, in_buf_size)))
+            goto bad_chunk;
 
-   /* Note: We have to set 'flush == true' here, otherwise we
-    * can't guarantee that the entire chunk will be written
-    * to the output buffer - this is inefficient, but not
-    * much we can do... */
-   if (!stream->inflate_backend->trans(
-         stream->inflate_stream, true,
-         &inflate_read, &inflate_written, NULL))
-      return false;
+         stream->in_buf      = in_buf;
+         stream->in_buf_size = in_buf_size;
 
-   /* Error checking */
-   if (inflate_read != compressed_chunk_size)
-      return false;
+         /* Note: Uncompressed data size is fixed, and read
+          * from the file header - we therefore don't attempt
+          * to resize the output buffer (if it's too small, then
+          * that's an error condition) */
+      }
 
-   if (   (inflate_written == 0)
-       || (inflate_written > stream->out_buf_size))
-      return false;
+      /* Read compressed chunk from file */
+      if (filestream_read(
+            stream->file, stream->in_buf + in_buf_used,
+            compressed_chunk_size) != compressed_chunk_size)
+         goto bad_chunk;
+
+      offsets[count]        = in_buf_used;
+      jobs[count].in_size   = compressed_chunk_size;
+      in_buf_used          += compressed_chunk_size;
+
+      if (   (++count >= stream->batch_chunks)
+          || (remaining <= (uint64_t)count * stream->chunk_size))
+         break;
+      continue;
 
-   /* Record current output buffer occupancy
-    * and reset pointer */
-   stream->out_buf_occupancy = inflate_written;
+bad_chunk:
+      /* An error after the first chunk of a batch is
+       * reported once the reader gets to it: go back
+       * to the start of the failed chunk */
+      if (count == 0)
+         return false;
+      filestream_seek(stream->file, chunk_pos, SEEK_SET);
+      break;
+   }
+
+   /* Decompress chunk data */
+   for (i = 0; i < count; i++)
+      if (!rzipstream_init_job(stream, &jobs[i], i,
+            stream->in_buf + offsets[i], jobs[i].in_size))
+         return false;
+
+   rzipstream_run_jobs(stream, jobs, count);
+
+   /* Pack decompressed chunks together, and record
+    * current output buffer occupancy and reset pointer
+    * > Chunks are normally exactly stream->chunk_size
+    *   bytes (apart from the last one), but don't
+    *   rely on it */
+   stream->out_buf_occupancy = 0;
    stream->out_buf_ptr       = 0;
 
+   for (i = 0; i < count; i++)
+   {
+      if (!jobs[i].ok)
+         return false;
+
+      if (jobs[i].out != stream->out_buf + stream->out_buf_occupancy)
+         memmove(stream->out_buf + stream->out_buf_occupancy,
+               jobs[i].out, jobs[i].written);
+      stream->out_buf_occupancy += jobs[i].written;
+   }
+
    return true;
 }
 
@@ -720,61 +1039,54 @@ error:
 /* File Write */
 
 /* Compresses currently cached data and writes it
- * as the next RZIP file chunk */
+ * as the next RZIP file chunk(s) */
 static bool rzipstream_write_chunk(rzipstream_t *stream)
 {
    unsigned i;
+   struct rzip_chunk_job jobs[RZIP_BATCH_CHUNKS];
    uint8_t chunk_header_bytes[RZIP_CHUNK_HEADER_SIZE];
-   uint32_t deflate_read;
-   uint32_t deflate_written;
+   uint32_t pos;
+   unsigned count = 0;
 
    if (!stream || !stream->deflate_backend || !stream->deflate_stream)
       return false;
 
-   for (i = 0; i < RZIP_CHUNK_HEADER_SIZE; i++)
-      chunk_header_bytes[i] = 0;
-
-   /* Compress data currently held in input buffer */
-   stream->deflate_backend->set_in(
-         stream->deflate_stream,
-         stream->in_buf, stream->in_buf_ptr);
+   /* Compress data currently held in input buffer,
+    * one chunk per batch slot */
+   for (pos = 0; pos < stream->in_buf_ptr; pos += stream->chunk_size)
+   {
+      if (!rzipstream_init_job(stream, &jobs[count], count,
+            stream->in_buf + pos,
+            MIN(stream->chunk_size, stream->in_buf_ptr - pos)))
+         return false;
+      count++;
+   }
 
-   stream->deflate_backend->set_out(
-         stream->deflate_stream,
-         stream->out_buf, stream->out_buf_size);
+   rzipstream_run_jobs(stream, jobs, count);
 
-   /* Note: We have to set 'flush == true' here, otherwise we
-    * can't guarantee that the entire chunk will be written
-    * to the output buffer - this is inefficient, but not
-    * much we can do... */
-   if (!stream->deflate_backend->trans(
-         stream->deflate_stream, true,
-         &deflate_read, &deflate_written, NULL))
-      return false;
-
-   /* Error checking */
-   if (deflate_read != stream->in_buf_ptr)
-      return false;
+   for (i = 0; i < count; i++)
+   {
+      uint32_t deflate_written = jobs[i].written;
 
-   if (   (deflate_written == 0)
-       || (deflate_written > stream->out_buf_size))
-      return false;
+      if (!jobs[i].ok)
+         return false;
 
-   /* Write compressed chunk size to file */
-   chunk_header_bytes[3] = (deflate_written >> 24) & 0xFF;
-   chunk_header_bytes[2] = (deflate_written >> 16) & 0xFF;
-   chunk_header_bytes[1] = (deflate_written >>  8) & 0xFF;
-   chunk_header_bytes[0] =  deflate_written        & 0xFF;
+      /* Write compressed chunk size to file */
+      chunk_header_bytes[3] = (deflate_written >> 24) & 0xFF;
+      chunk_header_bytes[2] = (deflate_written >> 16) & 0xFF;
+      chunk_header_bytes[1] = (deflate_written >>  8) & 0xFF;
+      chunk_header_bytes[0] =  deflate_written        & 0xFF;
 
-   if (filestream_write(
-         stream->file, chunk_header_bytes, sizeof(chunk_header_bytes)) !=
-         RZIP_CHUNK_HEADER_SIZE)
-      return false;
+      if (filestream_write(
+            stream->file, chunk_header_bytes, sizeof(chunk_header_bytes)) !=
+            RZIP_CHUNK_HEADER_SIZE)
+         return false;
 
-   /* Write compressed data to file */
-   if (filestream_write(
-         stream->file, stream->out_buf, deflate_written) != deflate_written)
-      return false;
+      /* Write compressed data to file */
+      if (filestream_write(
+            stream->file, jobs[i].out, deflate_written) != deflate_written)
+         return false;
+   }
 
    /* Reset input buffer pointer */
    stream->in_buf_ptr = 0;
@@ -954,9 +1266,11 @@ void rzipstream_rewind(rzipstream_t *stream)
    else
    {
       /* Check whether first file chunk is currently
-       * buffered in memory */
-      if ((stream->virtual_ptr < stream->chunk_size) &&
-          (stream->out_buf_ptr < stream->out_buf_occupancy))
+       * buffered in memory
+       * > The buffer holds the data from
+       *   (virtual_ptr - out_buf_ptr) onwards */
+      if ((stream->virtual_ptr == stream->out_buf_ptr) &&
+          (stream->out_buf_occupancy > 0))
       {
          /* It is: No file access is therefore required
           * > Just reset pointers */
@@ -973,13 +1287,15 @@ void rzipstream_rewind(rzipstream_t *stream)
          if (filestream_error(stream->file))
             return;
 
+         /* Reset pointers
+          * > Before reading, so that the right
+          *   number of chunks is read */
+         stream->virtual_ptr = 0;
+         stream->out_buf_ptr = 0;
+
          /* Read chunk */
          if (!rzipstream_read_chunk(stream))
             return;
-
-         /* Reset pointers */
-         stream->virtual_ptr = 0;
-         stream->out_buf_ptr = 0;
       }
    }
 }
@@ -32,6 +32,9 @@ struct zlib_trans_stream
    z_stream z;
    int window_bits;
    int level;
+   /* What trans() flushes with; "sync_flush" leaves the
+    * stream open so that another can carry on from it */
+   int flush;
    bool inited;
 };
 
@@ -44,6 +47,7 @@ static void *zlib_deflate_stream_new(void)
    ret->inited      = false;
    ret->level       = 9;
    ret->window_bits = 15;
+   ret->flush       = Z_FINISH;
 
    ret->z.next_in   = NULL;
    ret->z.avail_in  = 0;
@@ -125,6 +129,8 @@ static bool zlib_deflate_define(void *data, const char *prop, uint32_t val)
       z->level = (int) val;
    else if (string_is_equal(prop, "window_bits"))
       z->window_bits = (int) val;
+   else if (string_is_equal(prop, "sync_flush"))
+      z->flush = val ? Z_SYNC_FLUSH : Z_FINISH;
    else
       return false;
 
@@ -209,7 +215,7 @@ static bool zlib_deflate_trans(
 
    pre_avail_in  = z->avail_in;
    pre_avail_out = z->avail_out;
-   zret          = deflate(z, flush ? Z_FINISH : Z_NO_FLUSH);
+   zret          = deflate(z, flush ? zt->flush : Z_NO_FLUSH);
 
    if (zret == Z_OK)
    {
@@ -977,6 +977,45 @@ const char *retro_vfs_file_get_path_impl(
    return stream->orig_path;
 }
 
+void *retro_vfs_file_map_impl(const char *path, uint64_t *size)
+{
+#ifdef HAVE_MMAP
+   void *data = NULL;
+   libretro_vfs_implementation_file *stream = retro_vfs_file_open_impl(
+         path, RETRO_VFS_FILE_ACCESS_READ,
+         RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS);
+
+   if (!stream)
+      return NULL;
+
+   /* Take over the mapping the stream made, if any:
+    * it outlives the file descriptor */
+   if (     (stream->hints & RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS)
+         && stream->mapped
+         && (stream->mapsize > 0))
+   {
+      data            = stream->mapped;
+      *size           = stream->mapsize;
+      stream->mapped  = NULL;
+      stream->hints  &= ~RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS;
+   }
+
+   retro_vfs_file_close_impl(stream);
+   return data;
+#else
+   return NULL;
+#endif
+}
+
+int retro_vfs_file_unmap_impl(void *data, uint64_t size)
+{
+#ifdef HAVE_MMAP
+   if (data)
+      return munmap(data, (size_t)size);
+#endif
+   return -1;
+}
+
 int retro_vfs_stat_impl(const char *path, int32_t *size)
 {
    int ret                   = RETRO_VFS_STAT_IS_VALID;
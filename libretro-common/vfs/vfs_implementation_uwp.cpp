@@ -606,6 +606,16 @@ const char *retro_vfs_file_get_path_impl(libretro_vfs_implementation_file *strea
    return stream->orig_path;
 }
 
+void *retro_vfs_file_map_impl(const char *path, uint64_t *size)
+{
+   return NULL;
+}
+
+int retro_vfs_file_unmap_impl(void *data, uint64_t size)
+{
+   return -1;
+}
+
 int retro_vfs_stat_impl(const char *path, int32_t *size)
 {
    wchar_t *path_wide;
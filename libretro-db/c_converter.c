@@ -33,6 +33,8 @@
 #include <retro_assert.h>
 #include <string/stdstring.h>
 #include <streams/file_stream.h>
+#include <features/features_cpu.h>
+#include <rthreads/rthreads.h>
 
 #include "libretrodb.h"
 
@@ -666,28 +668,25 @@ static void dat_converter_value_provider_free(void)
    }
 }
 
-static int dat_converter_value_provider(
-      dat_converter_list_item_t** current_item, struct rmsgpack_dom_value* out)
+static int dat_converter_value_convert(
+      dat_converter_list_item_t* item, struct rmsgpack_dom_value* out)
 {
    int i;
    struct rmsgpack_dom_pair* current = NULL;
+   dat_converter_list_t* list        = NULL;
 
-   out->type          = RDT_MAP;
-   out->val.map.len   = 0;
-   out->val.map.items = calloc((sizeof(rdb_mappings) / sizeof(*rdb_mappings)),
-         sizeof(struct rmsgpack_dom_pair));
-
-   (*current_item)--;
-
-   retro_assert((*current_item)->map.type == DAT_CONVERTER_LIST_MAP);
-
-   dat_converter_list_t* list = (*current_item)->map.value.list;
+   retro_assert(item->map.type == DAT_CONVERTER_LIST_MAP);
 
-   if (!list)
+   if (!(list = item->map.value.list))
       return 1;
 
    retro_assert(list->type == DAT_CONVERTER_MAP_LIST);
 
+   out->type          = RDT_MAP;
+   out->val.map.len   = 0;
+   out->val.map.items = calloc((sizeof(rdb_mappings) / sizeof(*rdb_mappings)),
+         sizeof(struct rmsgpack_dom_pair));
+
    current = out->val.map.items;
 
    for (i = 0; i < (sizeof(rdb_mappings) / sizeof(*rdb_mappings)); i++)
@@ -765,19 +764,241 @@ static int dat_converter_value_provider(
    return 0;
 }
 
+/* Items converted ahead of time, handed out in the order the serial
+ * converter wrote them, so the output is the same with any number of
+ * threads */
+typedef struct
+{
+   struct rmsgpack_dom_value* values;
+   int next;
+} dat_converter_values_t;
+
+static int dat_converter_value_provider(
+      dat_converter_values_t* values, struct rmsgpack_dom_value* out)
+{
+   /* The first item is the parser's placeholder */
+   if (values->next <= 1)
+      return 1;
+
+   values->next--;
+   *out = values->values[values->next];
+   values->values[values->next].type = RDT_NULL;
+   return 0;
+}
+
+typedef struct
+{
+   slock_t* lock;
+   void (*func)(void* ctx, int index);
+   void* ctx;
+   int next;
+   int count;
+} dat_converter_jobs_t;
+
+static void dat_converter_jobs_worker(void* data)
+{
+   dat_converter_jobs_t* jobs = (dat_converter_jobs_t*)data;
+
+   for (;;)
+   {
+      int index;
+
+      slock_lock(jobs->lock);
+      index = jobs->next++;
+      slock_unlock(jobs->lock);
+
+      if (index >= jobs->count)
+         break;
+      jobs->func(jobs->ctx, index);
+   }
+}
+
+/* Runs func(ctx, 0) to func(ctx, count - 1) on up to @threads threads */
+static void dat_converter_run_jobs(void (*func)(void* ctx, int index),
+      void* ctx, int count, int threads)
+{
+   int i;
+   dat_converter_jobs_t jobs;
+   sthread_t** workers = NULL;
+
+   jobs.lock  = NULL;
+   jobs.func  = func;
+   jobs.ctx   = ctx;
+   jobs.next  = 0;
+   jobs.count = count;
+
+   if (threads > count)
+      threads = count;
+
+   if (     threads > 1
+         && (jobs.lock = slock_new())
+         && (workers = (sthread_t**)calloc(threads - 1, sizeof(*workers))))
+   {
+      for (i = 0; i < threads - 1; i++)
+         workers[i] = sthread_create(dat_converter_jobs_worker, &jobs);
+      dat_converter_jobs_worker(&jobs);
+      for (i = 0; i < threads - 1; i++)
+         if (workers[i])
+            sthread_join(workers[i]);
+      free(workers);
+      slock_free(jobs.lock);
+      return;
+   }
+
+   if (jobs.lock)
+      slock_free(jobs.lock);
+   for (i = 0; i < count; i++)
+      func(ctx, i);
+}
+
+typedef struct
+{
+   const char* path;
+   char* buffer;
+   dat_converter_list_t* parsed;
+} dat_converter_file_t;
+
+typedef struct
+{
+   dat_converter_file_t* files;
+   dat_converter_match_key_t* match_key;
+} dat_converter_parse_t;
+
+static void dat_converter_parse_file(void* ctx, int index)
+{
+   size_t dat_file_size;
+   dat_converter_list_t* dat_lexer_list = NULL;
+   dat_converter_parse_t* parse         = (dat_converter_parse_t*)ctx;
+   dat_converter_file_t* file           = &parse->files[index];
+   FILE* dat_file                       = fopen(file->path, "r");
+
+   if (!dat_file)
+   {
+      printf("  could not open dat file '%s': %s\n",
+            file->path, strerror(errno));
+      dat_converter_exit(1);
+   }
+
+   fseek(dat_file, 0, SEEK_END);
+   dat_file_size = ftell(dat_file);
+   fseek(dat_file, 0, SEEK_SET);
+   file->buffer = (char*)malloc(dat_file_size + 1);
+   /* Text mode may read less than the size, with CRLF */
+   dat_file_size = fread(file->buffer, 1, dat_file_size, dat_file);
+   fclose(dat_file);
+   file->buffer[dat_file_size] = '\0';
+
+   dat_lexer_list = dat_converter_lexer(file->buffer, file->path);
+   file->parsed   = dat_converter_parser(NULL, dat_lexer_list,
+         parse->match_key);
+
+   dat_converter_list_free(dat_lexer_list);
+}
+
+/* Appends the entries of @src to @dst, as parsing them after the
+ * ones already in @dst would have, and frees @src */
+static void dat_converter_merge(dat_converter_list_t* dst,
+      dat_converter_list_t* src)
+{
+   int i;
+
+   /* Skips the placeholder */
+   for (i = 1; i < src->count; i++)
+      dat_converter_list_append(dst, &src->values[i].map);
+
+   /* The entries now belong to @dst */
+   src->count = 0;
+   dat_converter_list_free(src);
+}
+
+/* Items per serialization job */
+#define DAT_CONVERTER_CONVERT_BATCH 256
+
+typedef struct
+{
+   dat_converter_list_item_t* items;
+   struct rmsgpack_dom_value* values;
+   int count;
+} dat_converter_convert_t;
+
+static void dat_converter_convert_batch(void* ctx, int index)
+{
+   int i;
+   dat_converter_convert_t* convert = (dat_converter_convert_t*)ctx;
+   int end                          = (index + 1) * DAT_CONVERTER_CONVERT_BATCH;
+
+   if (end > convert->count)
+      end = convert->count;
+
+   for (i = index * DAT_CONVERTER_CONVERT_BATCH; i < end; i++)
+      if (dat_converter_value_convert(&convert->items[i],
+               &convert->values[i]) != 0)
+         convert->values[i].type = RDT_NULL;
+}
+
+/* Builds "<rdb>.idx" the way the frontend would on first use */
+static void dat_converter_write_key_index(const char* rdb_path)
+{
+   libretrodb_key_index_t* idx = NULL;
+   libretrodb_t* db            = libretrodb_new();
+
+   if (!db)
+      return;
+
+   if (libretrodb_open(rdb_path, db, false) == 0)
+   {
+      if ((idx = libretrodb_key_index_open(db)))
+         libretrodb_key_index_close(idx);
+      else
+         printf("  could not write key index for '%s'\n", rdb_path);
+      libretrodb_close(db);
+   }
+   libretrodb_free(db);
+}
+
 int main(int argc, char** argv)
 {
+   int i;
    const char* rdb_path;
+   dat_converter_parse_t parse;
+   dat_converter_convert_t convert;
+   dat_converter_values_t values;
+   dat_converter_file_t* files          = NULL;
+   dat_converter_list_t* dat_parser_list = NULL;
    dat_converter_match_key_t* match_key = NULL;
    intfstream_t* rdb_file;
+   int dat_count;
+   const char* program                  = *argv;
+   int threads                          = cpu_features_get_core_amount();
+   bool key_index                       = false;
+
+   argc--;
+   argv++;
+
+   while (argc && (*argv)[0] == '-' && (*argv)[1])
+   {
+      if (string_is_equal(*argv, "-j") && argc > 1)
+      {
+         threads = atoi(argv[1]);
+         argc--;
+         argv++;
+      }
+      else if (string_is_equal(*argv, "-i"))
+         key_index = true;
+      else
+         break;
+      argc--;
+      argv++;
+   }
 
-   if (argc < 2)
+   if (argc < 1)
    {
-      printf("usage:\n%s <db file> [args ...]\n", *argv);
+      printf("usage:\n%s [-j threads] [-i] <db file> [args ...]\n"
+            "  -j: threads to parse and convert with, one per core by default\n"
+            "  -i: also write the key index, <db file>.idx\n",
+            program);
       dat_converter_exit(1);
    }
-   argc--;
-   argv++;
 
    rdb_path  = *argv;
    argc--;
@@ -790,43 +1011,36 @@ int main(int argc, char** argv)
       argv++;
    }
 
-   int dat_count                         = argc;
-   char** dat_buffers                    = (char**)
-      malloc(dat_count * sizeof(*dat_buffers));
-   char** dat_buffer                     = dat_buffers;
-   dat_converter_list_t* dat_parser_list = NULL;
+   if (threads < 1)
+      threads = 1;
 
-   while (argc)
+   if (!(dat_count = argc))
    {
-      size_t dat_file_size;
-      dat_converter_list_t* dat_lexer_list = NULL;
-      FILE* dat_file                       = fopen(*argv, "r");
-
-      if (!dat_file)
-      {
-         printf("  could not open dat file '%s': %s\n",
-               *argv, strerror(errno));
-         dat_converter_exit(1);
-      }
-
-      fseek(dat_file, 0, SEEK_END);
-      dat_file_size = ftell(dat_file);
-      fseek(dat_file, 0, SEEK_SET);
-      *dat_buffer = (char*)malloc(dat_file_size + 1);
-      fread(*dat_buffer, 1, dat_file_size, dat_file);
-      fclose(dat_file);
-      (*dat_buffer)[dat_file_size] = '\0';
+      printf("  no dat files given\n");
+      dat_converter_exit(1);
+   }
+   files     = (dat_converter_file_t*)calloc(dat_count, sizeof(*files));
 
-      printf("  %s\n", *argv);
-      dat_lexer_list  = dat_converter_lexer(*dat_buffer, *argv);
-      dat_parser_list = dat_converter_parser(
-            dat_parser_list, dat_lexer_list, match_key);
+   for (i = 0; i < dat_count; i++)
+   {
+      files[i].path = argv[i];
+      printf("  %s\n", argv[i]);
+   }
 
-      dat_converter_list_free(dat_lexer_list);
+   /* Each DAT is parsed on its own, then merged in the order given,
+    * which gives what parsing them one after another did */
+   parse.files     = files;
+   parse.match_key = match_key;
+   dat_converter_run_jobs(dat_converter_parse_file, &parse,
+         dat_count, threads);
 
-      argc--;
-      argv++;
-      dat_buffer++;
+   for (i = 0; i < dat_count; i++)
+   {
+      if (!dat_parser_list)
+         dat_parser_list = files[i].parsed;
+      else
+         dat_converter_merge(dat_parser_list, files[i].parsed);
+      files[i].parsed = NULL;
    }
 
    rdb_file = intfstream_open_file(rdb_path, RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
@@ -841,24 +1055,40 @@ int main(int argc, char** argv)
       dat_converter_exit(1);
    }
 
-   dat_converter_list_item_t* current_item =
-      &dat_parser_list->values[dat_parser_list->count];
-
    dat_converter_value_provider_init();
+
+   convert.items  = dat_parser_list->values;
+   convert.count  = dat_parser_list->count;
+   convert.values = (struct rmsgpack_dom_value*)calloc(
+         convert.count ? convert.count : 1, sizeof(*convert.values));
+   dat_converter_run_jobs(dat_converter_convert_batch, &convert,
+         (convert.count + DAT_CONVERTER_CONVERT_BATCH - 1)
+         / DAT_CONVERTER_CONVERT_BATCH, threads);
+
+   values.values = convert.values;
+   values.next   = convert.count;
    libretrodb_create(rdb_file,
          (libretrodb_value_provider)&dat_converter_value_provider,
-         &current_item);
+         &values);
    dat_converter_value_provider_free();
 
    intfstream_close(rdb_file);
 
+   /* Whatever an error left unwritten */
+   for (i = 0; i < values.next; i++)
+      rmsgpack_dom_value_free(&convert.values[i]);
+   free(convert.values);
+
    dat_converter_list_free(dat_parser_list);
 
-   while (dat_count--)
-      free(dat_buffers[dat_count]);
-   free(dat_buffers);
+   for (i = 0; i < dat_count; i++)
+      free(files[i].buffer);
+   free(files);
 
    dat_converter_match_key_free(match_key);
 
+   if (key_index)
+      dat_converter_write_key_index(rdb_path);
+
    return 0;
 }
@@ -26,14 +26,24 @@
 #else
 #include <unistd.h>
 #endif
+#include <stdio.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <stdlib.h>
 
 #include <streams/file_stream.h>
 #include <retro_endianness.h>
+#include <retro_miscellaneous.h>
 #include <string/stdstring.h>
 #include <compat/strl.h>
+#include <encodings/crc32.h>
+#include <file/file_path.h>
+#include <file/file_write_atomic.h>
+
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
 
 #include "libretrodb.h"
 #include "rmsgpack_dom.h"
@@ -84,6 +94,10 @@ struct libretrodb_cursor
    intfstream_t *fd;
    libretrodb_query_t *query;
    libretrodb_t *db;
+   /* Set when the cursor only visits these items */
+   uint64_t *offsets;
+   size_t offsets_count;
+   size_t offsets_pos;
    int is_valid;
    int eof;
 };
@@ -318,6 +332,396 @@ int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
    return -1;
 }
 
+/* Key indexes
+ *
+ * A sidecar file next to the database, "<path>.idx", keeps one sorted
+ * array of { key, offset } records per field in enum libretrodb_key,
+ * in native byte order so that it can be mapped and searched in place.
+ * It remembers the size and modification time of the database it was
+ * built from and is built again when those change. */
+
+#define KEY_INDEX_MAGIC      "RDBKEYS"
+#define KEY_INDEX_VERSION    1
+#define KEY_INDEX_BYTE_ORDER 0x01020304
+
+typedef struct libretrodb_key_entry
+{
+   uint32_t key;
+   uint32_t reserved;
+   uint64_t offset;
+} libretrodb_key_entry_t;
+
+typedef struct libretrodb_key_header
+{
+   char magic_number[sizeof(KEY_INDEX_MAGIC)];
+   uint32_t version;
+   uint32_t byte_order;
+   int64_t db_size;
+   int64_t db_mtime;
+   uint64_t count[LIBRETRODB_KEY_COUNT];
+} libretrodb_key_header_t;
+
+struct libretrodb_key_index
+{
+   const libretrodb_key_entry_t *entries[LIBRETRODB_KEY_COUNT];
+   uint64_t count[LIBRETRODB_KEY_COUNT];
+   void *data;
+   size_t size;
+#ifdef HAVE_MMAP
+   bool mapped;
+#endif
+};
+
+static const char *libretrodb_key_fields[LIBRETRODB_KEY_COUNT] = {
+   "crc",
+   "serial",
+   "name"
+};
+
+uint32_t libretrodb_key_hash(const void *data, size_t len)
+{
+   return encoding_crc32(0, (const uint8_t*)data, len);
+}
+
+static int libretrodb_key_entry_compare(const void *a, const void *b)
+{
+   const libretrodb_key_entry_t *ea = (const libretrodb_key_entry_t*)a;
+   const libretrodb_key_entry_t *eb = (const libretrodb_key_entry_t*)b;
+
+   if (ea->key != eb->key)
+      return (ea->key < eb->key) ? -1 : 1;
+   if (ea->offset != eb->offset)
+      return (ea->offset < eb->offset) ? -1 : 1;
+   return 0;
+}
+
+static int libretrodb_offset_compare(const void *a, const void *b)
+{
+   uint64_t oa = *(const uint64_t*)a;
+   uint64_t ob = *(const uint64_t*)b;
+   if (oa != ob)
+      return (oa < ob) ? -1 : 1;
+   return 0;
+}
+
+/* The key an item has for @key, if it has one */
+static bool libretrodb_item_key(const struct rmsgpack_dom_value *field,
+      enum libretrodb_key key, uint32_t *out)
+{
+   if (key == LIBRETRODB_KEY_CRC)
+   {
+      uint32_t i;
+      /* Stored big endian, as in the queries */
+      if (     field->type != RDT_BINARY
+            || !field->val.binary.len
+            || field->val.binary.len > 4)
+         return false;
+      *out = 0;
+      for (i = 0; i < field->val.binary.len; i++)
+         *out = (*out << 8) | (uint8_t)field->val.binary.buff[i];
+      return true;
+   }
+
+   if (field->type == RDT_STRING)
+   {
+      if (!field->val.string.len)
+         return false;
+      *out = libretrodb_key_hash(field->val.string.buff,
+            field->val.string.len);
+      return true;
+   }
+   if (field->type == RDT_BINARY)
+   {
+      if (!field->val.binary.len)
+         return false;
+      *out = libretrodb_key_hash(field->val.binary.buff,
+            field->val.binary.len);
+      return true;
+   }
+   return false;
+}
+
+static void libretrodb_key_index_free_data(libretrodb_key_index_t *idx)
+{
+#ifdef HAVE_MMAP
+   if (idx->mapped)
+   {
+      munmap(idx->data, idx->size);
+      idx->mapped = false;
+   }
+   else
+#endif
+      free(idx->data);
+   idx->data = NULL;
+}
+
+static libretrodb_key_index_t *libretrodb_key_index_load(const char *path,
+      int64_t db_size, int64_t db_mtime)
+{
+   unsigned i;
+   uint64_t total;
+   const libretrodb_key_header_t *header;
+   const libretrodb_key_entry_t *entries;
+   libretrodb_key_index_t *idx = (libretrodb_key_index_t*)
+      calloc(1, sizeof(*idx));
+
+   if (!idx)
+      return NULL;
+
+#ifdef HAVE_MMAP
+   {
+      struct stat st;
+      int fd = open(path, O_RDONLY);
+
+      if (fd >= 0)
+      {
+         if (     fstat(fd, &st) == 0
+               && st.st_size >= (off_t)sizeof(*header))
+         {
+            void *data = mmap(NULL, (size_t)st.st_size,
+                  PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+            {
+               idx->data   = data;
+               idx->size   = (size_t)st.st_size;
+               idx->mapped = true;
+            }
+         }
+         close(fd);
+      }
+   }
+   if (!idx->mapped)
+#endif
+   {
+      void *data  = NULL;
+      int64_t len = 0;
+      if (!filestream_read_file(path, &data, &len))
+         goto error;
+      idx->data   = data;
+      idx->size   = (size_t)len;
+   }
+
+   if (idx->size < sizeof(*header))
+      goto error;
+
+   header = (const libretrodb_key_header_t*)idx->data;
+   if (     memcmp(header->magic_number, KEY_INDEX_MAGIC,
+               sizeof(KEY_INDEX_MAGIC)) != 0
+         || header->version    != KEY_INDEX_VERSION
+         || header->byte_order != KEY_INDEX_BYTE_ORDER
+         || header->db_size    != db_size
+         || header->db_mtime   != db_mtime)
+      goto error;
+
+   total   = 0;
+   entries = (const libretrodb_key_entry_t*)(header + 1);
+   for (i = 0; i < LIBRETRODB_KEY_COUNT; i++)
+   {
+      if (header->count[i] > (idx->size - sizeof(*header))
+            / sizeof(*entries) - total)
+         goto error;
+      idx->entries[i] = entries + total;
+      idx->count[i]   = header->count[i];
+      total          += header->count[i];
+   }
+
+   if (sizeof(*header) + total * sizeof(*entries) != idx->size)
+      goto error;
+
+   return idx;
+
+error:
+   libretrodb_key_index_free_data(idx);
+   free(idx);
+   return NULL;
+}
+
+struct libretrodb_key_index_source
+{
+   libretrodb_t *db;
+   int64_t db_size;
+   int64_t db_mtime;
+};
+
+/* Reads through the database once, collecting the keys of each item */
+static bool libretrodb_key_index_write(RFILE *file, void *userdata)
+{
+   const struct libretrodb_key_index_source *src =
+      (const struct libretrodb_key_index_source*)userdata;
+   libretrodb_t *db = src->db;
+   unsigned i;
+   libretrodb_key_header_t header;
+   struct rmsgpack_dom_value item;
+   struct rmsgpack_dom_value fields[LIBRETRODB_KEY_COUNT];
+   libretrodb_key_entry_t *lists[LIBRETRODB_KEY_COUNT];
+   size_t caps[LIBRETRODB_KEY_COUNT];
+   libretrodb_cursor_t cur = {0};
+   uint64_t item_loc;
+   bool ret                = false;
+
+   memset(&header, 0, sizeof(header));
+   memset(lists, 0, sizeof(lists));
+   memset(caps, 0, sizeof(caps));
+
+   for (i = 0; i < LIBRETRODB_KEY_COUNT; i++)
+   {
+      fields[i].type               = RDT_STRING;
+      fields[i].val.string.len     = (uint32_t)strlen(libretrodb_key_fields[i]);
+      fields[i].val.string.buff    = (char*)libretrodb_key_fields[i];
+   }
+
+   item.type = RDT_NULL;
+
+   if (libretrodb_cursor_open(db, &cur, NULL) != 0)
+      return false;
+
+   item_loc = intfstream_tell(cur.fd);
+   while (libretrodb_cursor_read_item(&cur, &item) == 0)
+   {
+      if (item.type == RDT_MAP)
+      {
+         for (i = 0; i < LIBRETRODB_KEY_COUNT; i++)
+         {
+            uint32_t key;
+            struct rmsgpack_dom_value *field =
+               rmsgpack_dom_value_map_value(&item, &fields[i]);
+
+            if (!field || !libretrodb_item_key(field,
+                     (enum libretrodb_key)i, &key))
+               continue;
+
+            if (header.count[i] >= caps[i])
+            {
+               size_t new_cap                = caps[i] ? caps[i] * 2 : 1024;
+               libretrodb_key_entry_t *list  = (libretrodb_key_entry_t*)
+                  realloc(lists[i], new_cap * sizeof(*list));
+               if (!list)
+                  goto end;
+               lists[i]                      = list;
+               caps[i]                       = new_cap;
+            }
+
+            lists[i][header.count[i]].key      = key;
+            lists[i][header.count[i]].reserved = 0;
+            lists[i][header.count[i]].offset   = item_loc;
+            header.count[i]++;
+         }
+      }
+      rmsgpack_dom_value_free(&item);
+      item_loc = intfstream_tell(cur.fd);
+   }
+
+   memcpy(header.magic_number, KEY_INDEX_MAGIC, sizeof(KEY_INDEX_MAGIC));
+   header.version    = KEY_INDEX_VERSION;
+   header.byte_order = KEY_INDEX_BYTE_ORDER;
+   header.db_size    = src->db_size;
+   header.db_mtime   = src->db_mtime;
+
+   if (filestream_write(file, &header, sizeof(header)) != sizeof(header))
+      goto end;
+
+   for (i = 0; i < LIBRETRODB_KEY_COUNT; i++)
+   {
+      int64_t len = (int64_t)(header.count[i] * sizeof(*lists[i]));
+      if (!len)
+         continue;
+      qsort(lists[i], (size_t)header.count[i], sizeof(*lists[i]),
+            libretrodb_key_entry_compare);
+      if (filestream_write(file, lists[i], len) != len)
+         goto end;
+   }
+
+   ret = true;
+
+end:
+   rmsgpack_dom_value_free(&item);
+   libretrodb_cursor_close(&cur);
+   for (i = 0; i < LIBRETRODB_KEY_COUNT; i++)
+      free(lists[i]);
+   return ret;
+}
+
+/**
+ * libretrodb_key_index_open:
+ * @db                  : Handle to database.
+ *
+ * Opens the key index of @db, building it first if it is
+ * missing or stale.
+ *
+ * Returns: the index, or NULL if there is none and it can't be built.
+ **/
+libretrodb_key_index_t *libretrodb_key_index_open(libretrodb_t *db)
+{
+   char path[PATH_MAX_LENGTH];
+   struct libretrodb_key_index_source src;
+   int64_t db_size  = 0;
+   int64_t db_mtime = 0;
+   libretrodb_key_index_t *idx;
+
+   if (     !db
+         || string_is_empty(db->path)
+         || !path_get_size_and_mtime(db->path, &db_size, &db_mtime))
+      return NULL;
+
+   if ((size_t)snprintf(path, sizeof(path), "%s.idx", db->path)
+         >= sizeof(path))
+      return NULL;
+   if ((idx = libretrodb_key_index_load(path, db_size, db_mtime)))
+      return idx;
+
+   /* Another thread may be building it too; whichever finishes
+    * last is the one kept */
+   src.db       = db;
+   src.db_size  = db_size;
+   src.db_mtime = db_mtime;
+   if (!file_write_atomic_cb(path, libretrodb_key_index_write, &src))
+      return NULL;
+   return libretrodb_key_index_load(path, db_size, db_mtime);
+}
+
+void libretrodb_key_index_close(libretrodb_key_index_t *idx)
+{
+   if (!idx)
+      return;
+   libretrodb_key_index_free_data(idx);
+   free(idx);
+}
+
+size_t libretrodb_key_index_find(const libretrodb_key_index_t *idx,
+      enum libretrodb_key key, uint32_t value,
+      uint64_t *offsets, size_t len)
+{
+   size_t i;
+   const libretrodb_key_entry_t *entries;
+   uint64_t lo = 0;
+   uint64_t hi;
+
+   if (!idx || key >= LIBRETRODB_KEY_COUNT)
+      return 0;
+
+   entries = idx->entries[key];
+   hi      = idx->count[key];
+
+   /* First record with a key of at least @value */
+   while (lo < hi)
+   {
+      uint64_t mid = lo + (hi - lo) / 2;
+      if (entries[mid].key < value)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   for (i = 0; lo + i < idx->count[key]
+         && entries[lo + i].key == value; i++)
+   {
+      if (i < len)
+         offsets[i] = entries[lo + i].offset;
+   }
+
+   return i;
+}
+
 /**
  * libretrodb_cursor_reset:
  * @cursor              : Handle to database cursor.
@@ -328,7 +732,8 @@ int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
  **/
 int libretrodb_cursor_reset(libretrodb_cursor_t *cursor)
 {
-   cursor->eof = 0;
+   cursor->eof         = 0;
+   cursor->offsets_pos = 0;
    return (int)intfstream_seek(cursor->fd,
          (ssize_t)(cursor->db->root + sizeof(libretrodb_header_t)),
          RETRO_VFS_SEEK_POSITION_START);
@@ -343,6 +748,18 @@ int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       return EOF;
 
 retry:
+   if (cursor->offsets)
+   {
+      if (cursor->offsets_pos >= cursor->offsets_count)
+      {
+         cursor->eof = 1;
+         return EOF;
+      }
+      intfstream_seek(cursor->fd,
+            (int64_t)cursor->offsets[cursor->offsets_pos++],
+            RETRO_VFS_SEEK_POSITION_START);
+   }
+
    if ((rv = rmsgpack_dom_read(cursor->fd, out)) < 0)
       return rv;
 
@@ -381,11 +798,16 @@ void libretrodb_cursor_close(libretrodb_cursor_t *cursor)
    if (cursor->query)
       libretrodb_query_free(cursor->query);
 
-   cursor->is_valid = 0;
-   cursor->eof      = 1;
-   cursor->fd       = NULL;
-   cursor->db       = NULL;
-   cursor->query    = NULL;
+   if (cursor->offsets)
+      free(cursor->offsets);
+
+   cursor->is_valid      = 0;
+   cursor->eof           = 1;
+   cursor->fd            = NULL;
+   cursor->db            = NULL;
+   cursor->query         = NULL;
+   cursor->offsets       = NULL;
+   cursor->offsets_count = 0;
 }
 
 /**
@@ -423,6 +845,52 @@ int libretrodb_cursor_open(libretrodb_t *db,
    return 0;
 }
 
+/**
+ * libretrodb_cursor_open_offsets:
+ * @db                  : Handle to database.
+ * @cursor              : Handle to database cursor.
+ * @q                   : Query to execute.
+ * @offsets             : Offsets of the items to visit.
+ * @count               : Number of offsets.
+ *
+ * Opens cursor to database like libretrodb_cursor_open(), but only
+ * reads the items at @offsets, in file order and once each.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int libretrodb_cursor_open_offsets(libretrodb_t *db,
+      libretrodb_cursor_t *cursor,
+      libretrodb_query_t *q,
+      const uint64_t *offsets, size_t count)
+{
+   size_t i, j;
+   /* Keep one entry around so that an empty list still ends the cursor */
+   uint64_t *copy = (uint64_t*)malloc((count ? count : 1) * sizeof(*copy));
+
+   if (!copy)
+      return -1;
+
+   if (libretrodb_cursor_open(db, cursor, q) != 0)
+   {
+      free(copy);
+      return -1;
+   }
+
+   if (count)
+   {
+      memcpy(copy, offsets, count * sizeof(*copy));
+      qsort(copy, count, sizeof(*copy), libretrodb_offset_compare);
+   }
+   for (i = j = 0; i < count; i++)
+      if (!j || copy[j - 1] != copy[i])
+         copy[j++] = copy[i];
+
+   cursor->offsets       = copy;
+   cursor->offsets_count = j;
+   cursor->offsets_pos   = 0;
+   return 0;
+}
+
 static int node_iter(void *value, void *ctx)
 {
    struct node_iter_ctx *nictx = (struct node_iter_ctx*)ctx;
@@ -566,6 +1034,9 @@ libretrodb_cursor_t *libretrodb_cursor_new(void)
    dbc->eof                 = 0;
    dbc->query               = NULL;
    dbc->db                  = NULL;
+   dbc->offsets             = NULL;
+   dbc->offsets_count       = 0;
+   dbc->offsets_pos         = 0;
 
    return dbc;
 }
@@ -592,6 +1063,11 @@ libretrodb_t *libretrodb_new(void)
    return db;
 }
 
+uint64_t libretrodb_count(libretrodb_t *db)
+{
+   return db->count;
+}
+
 void libretrodb_free(libretrodb_t *db)
 {
    if (db)
@@ -24,6 +24,7 @@
 #define __LIBRETRODB_H__
 
 #include <stdint.h>
+#include <stddef.h>
 #ifdef _WIN32
 #include <direct.h>
 #else
@@ -43,6 +44,19 @@ typedef struct libretrodb_cursor libretrodb_cursor_t;
 
 typedef struct libretrodb_index libretrodb_index_t;
 
+typedef struct libretrodb_key_index libretrodb_key_index_t;
+
+/* Fields kept in a key index. 'crc' is keyed by its value, the
+ * others by libretrodb_key_hash() of their bytes, so that items found
+ * through those may still need to be checked against a query. */
+enum libretrodb_key
+{
+   LIBRETRODB_KEY_CRC = 0,
+   LIBRETRODB_KEY_SERIAL,
+   LIBRETRODB_KEY_NAME,
+   LIBRETRODB_KEY_COUNT
+};
+
 typedef int (*libretrodb_value_provider)(void *ctx, struct rmsgpack_dom_value *out);
 
 int libretrodb_create(intfstream_t *fd, libretrodb_value_provider value_provider, void *ctx);
@@ -57,6 +71,39 @@ int libretrodb_create_index(libretrodb_t *db, const char *name,
 int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
         const void *key, struct rmsgpack_dom_value *out);
 
+uint64_t libretrodb_count(libretrodb_t *db);
+
+/**
+ * libretrodb_key_index_open:
+ * @db                  : Handle to database.
+ *
+ * Opens the key index kept next to the database in "<path>.idx",
+ * building it first if it is missing or older than the database.
+ *
+ * Returns: the index, or NULL if there is none and it can't be built.
+ **/
+libretrodb_key_index_t *libretrodb_key_index_open(libretrodb_t *db);
+
+void libretrodb_key_index_close(libretrodb_key_index_t *idx);
+
+/**
+ * libretrodb_key_index_find:
+ * @idx                 : Key index.
+ * @key                 : Field to look in.
+ * @value               : Key to look for.
+ * @offsets             : Where to put the offsets of the matching items.
+ * @len                 : Size of @offsets.
+ *
+ * Binary search for the items with @value in field @key.
+ *
+ * Returns: the number of matching items, which may be more than @len.
+ **/
+size_t libretrodb_key_index_find(const libretrodb_key_index_t *idx,
+      enum libretrodb_key key, uint32_t value,
+      uint64_t *offsets, size_t len);
+
+uint32_t libretrodb_key_hash(const void *data, size_t len);
+
 libretrodb_t *libretrodb_new(void);
 
 void libretrodb_free(libretrodb_t *db);
@@ -79,6 +126,24 @@ int libretrodb_cursor_open(libretrodb_t *db,
       libretrodb_cursor_t *cursor,
       libretrodb_query_t *query);
 
+/**
+ * libretrodb_cursor_open_offsets:
+ * @db                  : Handle to database.
+ * @cursor              : Handle to database cursor.
+ * @q                   : Query to execute.
+ * @offsets             : Offsets of the items to visit.
+ * @count               : Number of offsets.
+ *
+ * Opens cursor to database like libretrodb_cursor_open(), but only
+ * reads the items at @offsets, in file order and once each.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int libretrodb_cursor_open_offsets(libretrodb_t *db,
+      libretrodb_cursor_t *cursor,
+      libretrodb_query_t *query,
+      const uint64_t *offsets, size_t count);
+
 /**
  * libretrodb_cursor_reset:
  * @cursor              : Handle to database cursor.
@@ -1,10 +1,14 @@
 #!/usr/bin/env python3
+import hashlib
+import hmac
 import ipaddress
 import json
 import os
+import secrets
 import threading
 import time
 import urllib.parse
+from collections import OrderedDict
 from http.server import BaseHTTPRequestHandler, HTTPServer
 from socketserver import ThreadingMixIn
 
@@ -41,15 +45,71 @@ HOST_METHOD_MITM = 3
 ROOM_TTL_SECONDS = int(os.getenv("LOBBY_ROOM_TTL", "180"))
 MAX_ROOMS = int(os.getenv("LOBBY_MAX_ROOMS", "512"))
 MITM_CONFIG_PATH = os.getenv("LOBBY_MITM_CONFIG", "mitm_servers.json")
+RELAY_CONFIG_PATH = os.getenv("LOBBY_RELAY_CONFIG", "relay_servers.json")
+# RetroArch keeps the list in a 256 byte field and probes at most 8 relays.
+RELAY_LIST_MAX = 8
+RELAY_LIST_LEN_MAX = 255
 LOBBY_TRUST_PROXY = os.getenv("LOBBY_TRUST_PROXY", "")
 LOBBY_PUBLIC_IP = os.getenv("LOBBY_PUBLIC_IP", "")
 LOBBY_PUBLIC_RENDEZVOUS = os.getenv("LOBBY_PUBLIC_RENDEZVOUS", "")
+# Shared with the relay and rendezvous servers (RELAY_TOKEN_SECRET,
+# RENDEZVOUS_TOKEN_SECRET); pairing tokens are only issued when it is set.
+LOBBY_TOKEN_SECRET = os.getenv("LOBBY_TOKEN_SECRET", "")
+LOBBY_TOKEN_TTL = int(os.getenv("LOBBY_TOKEN_TTL", "60"))
+# RetroArch keeps session names in a 32 byte field.
+TOKEN_SESSION_MAX = 31
+TOKEN_SESSION_CHARS = frozenset(
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_-"
+)
+
+# How often expired rooms are dropped, and how many removals /list?since=
+# remembers before a stale client gets the full list again.
+LOBBY_PRUNE_INTERVAL = int(os.getenv("LOBBY_PRUNE_INTERVAL", "5"))
+LOBBY_DELTA_HISTORY = int(os.getenv("LOBBY_DELTA_HISTORY", "1024"))
+
+# Matchmaking. Beacons are extra landmarks beside the relays; anything that
+# answers the relay ping will do. A queued player polls at least every
+# LOBBY_MATCH_TTL seconds or leaves the queue, and accepts a pairing whose
+# estimated RTT is within LOBBY_MATCH_RTT_START ms, widened by
+# LOBBY_MATCH_RTT_WIDEN ms per second queued up to LOBBY_MATCH_RTT_MAX.
+BEACON_CONFIG_PATH = os.getenv("LOBBY_BEACON_CONFIG", "beacon_servers.json")
+LOBBY_MATCH_TTL = int(os.getenv("LOBBY_MATCH_TTL", "15"))
+LOBBY_MATCH_MAX_QUEUED = int(os.getenv("LOBBY_MATCH_MAX_QUEUED", "8192"))
+LOBBY_MATCH_RTT_START = int(os.getenv("LOBBY_MATCH_RTT_START", "60"))
+LOBBY_MATCH_RTT_WIDEN = int(os.getenv("LOBBY_MATCH_RTT_WIDEN", "5"))
+LOBBY_MATCH_RTT_MAX = int(os.getenv("LOBBY_MATCH_RTT_MAX", "250"))
+LOBBY_MATCH_RENDEZVOUS_PORT = int(os.getenv("LOBBY_MATCH_RENDEZVOUS_PORT", "7000"))
+# Each player is indexed under its nearest landmarks, in RTT buckets of
+# MATCH_BUCKET_MS; a search looks at no more than MATCH_SCAN_MAX of them.
+MATCH_INDEX_LANDMARKS = 3
+MATCH_BUCKET_MS = 10
+MATCH_SCAN_MAX = 256
 
 _rooms_by_id = {}
 _rooms_by_key = {}
+# The same rooms, oldest announcement first and least recently changed first,
+# so pruning and deltas only touch the rooms they return.
+_rooms_by_updated = OrderedDict()
+_rooms_by_version = OrderedDict()
+# Removed room id -> list version it was removed in, oldest first.
+_removed = OrderedDict()
 _next_id = 1
 _rooms_lock = threading.Lock()
 
+# The list version is "<epoch>.<n>": n counts room changes, and a restarted
+# server gets a new epoch so clients cannot mistake its n for the old one.
+_list_epoch = int(time.time())
+_list_version = 0
+# Versions before this were trimmed from _removed; older clients get it all.
+_delta_horizon = 0
+_list_cache = {"version": -1, "payload": b""}
+
+# Queued players by ticket, least recently polled first, and the index:
+# compatibility key -> landmark -> bucket -> {ticket: entry}.
+_match_tickets = OrderedDict()
+_match_index = {}
+_match_lock = threading.Lock()
+
 
 def _now():
     return int(time.time())
@@ -91,13 +151,330 @@ def _load_mitm_config():
     return {}
 
 
+def _load_endpoint_list(*paths):
+    """Returns the endpoints in the config files as "name=addr:port;...",
+    each file sorted by name, the first of a name kept."""
+    entries = []
+    names = set()
+    for path in paths:
+        if not os.path.exists(path):
+            continue
+        try:
+            with open(path, "r", encoding="utf-8") as handle:
+                data = json.load(handle)
+        except (OSError, json.JSONDecodeError):
+            continue
+        if not isinstance(data, dict):
+            continue
+        for name in sorted(data.keys()):
+            entry = data[name]
+            if not isinstance(entry, dict) or name in names:
+                continue
+            addr = str(entry.get("addr", ""))
+            port = _coerce_int(entry.get("port"), 0)
+            if not addr or port < 1 or port > 65535:
+                continue
+            if any(c in name + addr for c in "=:; "):
+                continue
+            item = "{}={}:{}".format(name, addr, port)
+            if len(";".join(entries + [item])) > RELAY_LIST_LEN_MAX:
+                return ";".join(entries)
+            entries.append(item)
+            names.add(name)
+            if len(entries) >= RELAY_LIST_MAX:
+                return ";".join(entries)
+    return ";".join(entries)
+
+
+def _load_relay_list():
+    """Returns the relay endpoints as "name=addr:port;..." sorted by name."""
+    return _load_endpoint_list(RELAY_CONFIG_PATH)
+
+
+def _load_landmark_list():
+    """The relays, then the beacons: what matchmaking clients measure."""
+    return _load_endpoint_list(RELAY_CONFIG_PATH, BEACON_CONFIG_PATH)
+
+
+def _pairing_session(fields):
+    """Returns the relay session or rendezvous room a token pairs, or ""."""
+    if not fields.get("ggpo"):
+        return ""
+    if fields.get("ggpo_relay"):
+        session = fields.get("ggpo_relay_session", "")
+    elif fields.get("rendezvous"):
+        session = fields.get("rendezvous_room", "")
+    else:
+        return ""
+    if not session or len(session) > TOKEN_SESSION_MAX:
+        return ""
+    if any(c not in TOKEN_SESSION_CHARS for c in session):
+        return ""
+    return session
+
+
+def _make_token(session, slot, ttl):
+    """Signs "<session>.<slot>.<expiry>" with the first 8 bytes of an
+    HMAC-SHA256, appended in hex."""
+    if not LOBBY_TOKEN_SECRET or not session:
+        return ""
+    body = "{}.{}.{}".format(session, slot, _now() + ttl)
+    mac = hmac.new(LOBBY_TOKEN_SECRET.encode("utf-8"), body.encode("ascii"),
+                   hashlib.sha256).hexdigest()[:16]
+    return "{}.{}".format(body, mac)
+
+
+def _parse_rtts(value, landmarks):
+    """Returns {landmark: ms} from "name=ms;...", known landmarks only;
+    a negative or missing time is a landmark that did not answer."""
+    rtts = {}
+    for item in value.split(";"):
+        name, _, ms = item.partition("=")
+        ms = _coerce_int(ms.strip(), -1)
+        name = name.strip()
+        if name in landmarks and 0 <= ms < 10000:
+            rtts[name] = ms
+    return rtts
+
+
+def _match_key(params):
+    return "{}:{}".format(params.get("core_name", ""),
+                          _coerce_hex(params.get("game_crc", "")))
+
+
+def _match_limit(entry, now):
+    widened = LOBBY_MATCH_RTT_START + (now - entry["queued"]) * LOBBY_MATCH_RTT_WIDEN
+    return min(widened, LOBBY_MATCH_RTT_MAX)
+
+
+def _match_estimate(a, b):
+    """Estimated RTT between two players, and the landmark it goes through.
+    A round trip through landmark i costs a[i] + b[i]; the relay session
+    that pairing would get runs the cheapest of those, and a direct path
+    is usually shorter still."""
+    best, via = None, ""
+    for name, ms in a["rtts"].items():
+        other = b["rtts"].get(name)
+        if other is not None and (best is None or ms + other < best):
+            best, via = ms + other, name
+    return best, via
+
+
+def _match_index_add(entry):
+    landmarks = _match_index.setdefault(entry["key"], {})
+    nearest = sorted(entry["rtts"].items(), key=lambda item: item[1])
+    for name, ms in nearest[:MATCH_INDEX_LANDMARKS]:
+        bucket = min(ms, LOBBY_MATCH_RTT_MAX) // MATCH_BUCKET_MS
+        buckets = landmarks.setdefault(name, {})
+        buckets.setdefault(bucket, {})[entry["ticket"]] = entry
+        entry["buckets"].append((name, bucket))
+
+
+def _match_index_remove(entry):
+    landmarks = _match_index.get(entry["key"], {})
+    for name, bucket in entry["buckets"]:
+        buckets = landmarks.get(name, {})
+        queued = buckets.get(bucket, {})
+        queued.pop(entry["ticket"], None)
+        if not queued:
+            buckets.pop(bucket, None)
+        if not buckets:
+            landmarks.pop(name, None)
+    if not landmarks:
+        _match_index.pop(entry["key"], None)
+    entry["buckets"] = []
+
+
+def _match_find(entry, now):
+    """Returns (peer, rtt, landmark) for the queued player the estimate puts
+    closest to entry within both players' limits, or None.
+
+    Through each of entry's landmarks, from the nearest, the buckets are
+    read in order while the landmark alone could still beat the best
+    found, so the search stops early once a close peer turns up. A peer
+    is only found through its MATCH_INDEX_LANDMARKS nearest landmarks."""
+    landmarks = _match_index.get(entry["key"], {})
+    limit = _match_limit(entry, now)
+    best = None
+    scanned = 0
+    for name, ms in sorted(entry["rtts"].items(), key=lambda item: item[1]):
+        buckets = landmarks.get(name)
+        if not buckets:
+            continue
+        bound = limit if best is None else min(limit, best[1] - 1)
+        for bucket in range(0, LOBBY_MATCH_RTT_MAX // MATCH_BUCKET_MS + 1):
+            if ms + bucket * MATCH_BUCKET_MS > bound:
+                break
+            for peer in buckets.get(bucket, {}).values():
+                if peer is entry:
+                    continue
+                rtt, via = _match_estimate(entry, peer)
+                if rtt is not None and rtt <= bound and rtt <= _match_limit(peer, now):
+                    best = (peer, rtt, via)
+                    bound = rtt - 1
+                scanned += 1
+                if scanned >= MATCH_SCAN_MAX:
+                    return best
+    return best
+
+
+def _match_pair(host, client, rtt, via):
+    """Takes both players out of the queue with a rendezvous room each
+    finds on its next poll."""
+    room = "mm" + secrets.token_hex(8)
+    server = _normalize_rendezvous_server("")
+    for entry, role, slot, peer in ((host, "host", 1, client), (client, "client", 2, host)):
+        _match_index_remove(entry)
+        entry["result"] = {
+            "role": role,
+            "peer": peer["username"],
+            "rtt": rtt,
+            "via": via,
+            "rendezvous_server": server,
+            "rendezvous_port": LOBBY_MATCH_RENDEZVOUS_PORT,
+            "rendezvous_room": room,
+            "ggpo_token": _make_token(room, slot, LOBBY_TOKEN_TTL),
+        }
+
+
+def _match_remove(ticket):
+    entry = _match_tickets.pop(ticket, None)
+    if entry is not None:
+        _match_index_remove(entry)
+
+
+def _prune_match_queue():
+    cutoff = _now() - LOBBY_MATCH_TTL
+    while _match_tickets:
+        ticket, entry = next(iter(_match_tickets.items()))
+        if entry["polled"] >= cutoff:
+            break
+        _match_remove(ticket)
+
+
+def _match_response(entry, now):
+    lines = ["ticket={}".format(entry["ticket"])]
+    result = entry["result"]
+    if result is None:
+        lines.append("status=queued")
+        lines.append("wait={}".format(now - entry["queued"]))
+        lines.append("max_rtt={}".format(_match_limit(entry, now)))
+    else:
+        lines.append("status=matched")
+        for key in ("role", "peer", "rtt", "via", "rendezvous_server",
+                    "rendezvous_port", "rendezvous_room", "ggpo_token"):
+            lines.append("{}={}".format(key, result[key]))
+    return "\n".join(lines) + "\n"
+
+
+def _version_tag(version):
+    return "{}.{}".format(_list_epoch, version)
+
+
+def _parse_version_tag(value):
+    """Returns n from one of our "<epoch>.<n>" tags, or None."""
+    epoch, _, version = value.strip().strip('"').partition(".")
+    if _coerce_int(epoch, -1) != _list_epoch:
+        return None
+    version = _coerce_int(version, -1)
+    if version < 0 or version > _list_version:
+        return None
+    return version
+
+
+def _bump_version():
+    global _list_version
+    _list_version += 1
+    return _list_version
+
+
+def _store_room(room_id, key, fields):
+    """Adds or refreshes a room; only a change of fields is a new version."""
+    room = _rooms_by_id.get(room_id)
+    if room is None or room["fields"] != fields:
+        room = {
+            "id": room_id,
+            "key": key,
+            "fields": fields,
+            "record": {"fields": dict(fields, id=room_id)},
+            "version": _bump_version(),
+        }
+        _rooms_by_id[room_id] = room
+        _rooms_by_version[room_id] = room
+        _rooms_by_version.move_to_end(room_id)
+    room["updated"] = _now()
+    _rooms_by_updated[room_id] = room
+    _rooms_by_updated.move_to_end(room_id)
+    _removed.pop(room_id, None)
+
+
+def _remove_room(room_id):
+    global _delta_horizon
+    room = _rooms_by_id.pop(room_id)
+    _rooms_by_key.pop(room["key"], None)
+    _rooms_by_updated.pop(room_id, None)
+    _rooms_by_version.pop(room_id, None)
+    _removed[room_id] = _bump_version()
+    while len(_removed) > LOBBY_DELTA_HISTORY:
+        _, version = _removed.popitem(last=False)
+        _delta_horizon = version
+
+
 def _prune_rooms():
     cutoff = _now() - ROOM_TTL_SECONDS
-    for room_id in list(_rooms_by_id.keys()):
-        if _rooms_by_id[room_id]["updated"] < cutoff:
-            key = _rooms_by_id[room_id]["key"]
-            _rooms_by_id.pop(room_id, None)
-            _rooms_by_key.pop(key, None)
+    while _rooms_by_updated:
+        room_id, room = next(iter(_rooms_by_updated.items()))
+        if room["updated"] >= cutoff:
+            break
+        _remove_room(room_id)
+
+
+def _prune_loop():
+    while True:
+        time.sleep(LOBBY_PRUNE_INTERVAL)
+        with _rooms_lock:
+            _prune_rooms()
+        with _match_lock:
+            _prune_match_queue()
+
+
+def _full_list():
+    """Returns (version, payload), serializing once per list version."""
+    if _list_cache["version"] != _list_version:
+        records = [room["record"] for room in _rooms_by_id.values()]
+        payload = json.dumps(
+            {"version": _version_tag(_list_version), "records": records},
+            separators=(",", ":"),
+        )
+        _list_cache["version"] = _list_version
+        _list_cache["payload"] = payload.encode("utf-8")
+    return _list_version, _list_cache["payload"]
+
+
+def _delta_list(since):
+    """Returns the rooms changed and removed after version `since`."""
+    records = []
+    for room in reversed(_rooms_by_version.values()):
+        if room["version"] <= since:
+            break
+        records.append(room["record"])
+    records.reverse()
+    removed = []
+    for room_id in reversed(_removed):
+        if _removed[room_id] <= since:
+            break
+        removed.append(room_id)
+    removed.reverse()
+    payload = json.dumps(
+        {
+            "version": _version_tag(_list_version),
+            "since": _version_tag(since),
+            "records": records,
+            "removed": removed,
+        },
+        separators=(",", ":"),
+    )
+    return payload.encode("utf-8")
 
 
 def _room_key(fields):
@@ -138,6 +515,7 @@ def _extract_fields(params, client_ip):
     fields["ggpo_relay_server"] = params.get("ggpo_relay_server", "")
     fields["ggpo_relay_session"] = params.get("ggpo_relay_session", "")
     fields["ggpo_relay_port"] = _coerce_int(params.get("ggpo_relay_port"), 0)
+    fields["ggpo_relays"] = _load_relay_list() if fields["ggpo_relay"] else ""
     fields["mitm_server"] = params.get("mitm_server", "")
     fields["ip"] = _maybe_override_ip(client_ip)
     fields["connectable"] = True
@@ -170,7 +548,7 @@ def _extract_fields(params, client_ip):
     return fields
 
 
-def _plain_response(fields, room_id):
+def _plain_response(fields, room_id, token=""):
     lines = [
         "id={}".format(room_id),
         "username={}".format(fields.get("username", "")),
@@ -193,6 +571,7 @@ def _plain_response(fields, room_id):
         "ggpo_relay_server={}".format(fields.get("ggpo_relay_server", "")),
         "ggpo_relay_session={}".format(fields.get("ggpo_relay_session", "")),
         "ggpo_relay_port={}".format(fields.get("ggpo_relay_port", 0)),
+        "ggpo_relays={}".format(fields.get("ggpo_relays", "")),
         "has_password={}".format(1 if fields.get("has_password") else 0),
         "has_spectate_password={}".format(
             1 if fields.get("has_spectate_password") else 0
@@ -200,6 +579,8 @@ def _plain_response(fields, room_id):
         "country={}".format(fields.get("country", "")),
         "connectable={}".format(1 if fields.get("connectable") else 0),
     ]
+    if token:
+        lines.append("ggpo_token={}".format(token))
     return "\n".join(lines) + "\n"
 
 
@@ -267,18 +648,72 @@ class LobbyHandler(BaseHTTPRequestHandler):
     def log_message(self, fmt, *args):
         return
 
-    def _send(self, code, body, content_type="text/plain"):
+    def _send(self, code, body, content_type="text/plain", etag=""):
         if isinstance(body, str):
             body = body.encode("utf-8", "replace")
         self.send_response(code)
         self.send_header("Content-Type", content_type)
         self.send_header("Content-Length", str(len(body)))
+        if etag:
+            self.send_header("ETag", '"{}"'.format(etag))
         self.end_headers()
         self.wfile.write(body)
 
+    def _match(self, params):
+        """Queues a player, or polls or leaves with the ticket it got."""
+        now = _now()
+        ticket = params.get("ticket", "")
+        with _match_lock:
+            _prune_match_queue()
+            entry = _match_tickets.get(ticket) if ticket else None
+            if _coerce_bool(params.get("leave")):
+                if entry is not None:
+                    _match_remove(ticket)
+                self._send(200, "status=left\n")
+                return
+            if ticket and entry is None:
+                self._send(200, "status=expired\n")
+                return
+
+            if entry is None:
+                landmarks = set(item.partition("=")[0]
+                                for item in _load_landmark_list().split(";") if item)
+                rtts = _parse_rtts(params.get("rtts", ""), landmarks)
+                if not rtts:
+                    self._send(400, "No landmark RTTs\n")
+                    return
+                if len(_match_tickets) >= LOBBY_MATCH_MAX_QUEUED:
+                    self._send(503, "Queue Full\n")
+                    return
+                entry = {
+                    "ticket": secrets.token_hex(8),
+                    "key": _match_key(params),
+                    "username": params.get("username", ""),
+                    "rtts": rtts,
+                    "buckets": [],
+                    "queued": now,
+                    "result": None,
+                }
+                _match_tickets[entry["ticket"]] = entry
+                _match_index_add(entry)
+
+            entry["polled"] = now
+            _match_tickets.move_to_end(entry["ticket"])
+            if entry["result"] is None:
+                found = _match_find(entry, now)
+                if found is not None:
+                    # the one queued longer hosts
+                    peer, rtt, via = found
+                    if peer["queued"] <= entry["queued"]:
+                        _match_pair(peer, entry, rtt, via)
+                    else:
+                        _match_pair(entry, peer, rtt, via)
+            body = _match_response(entry, now)
+        self._send(200, body)
+
     def do_POST(self):
         parsed = urllib.parse.urlparse(self.path)
-        if parsed.path != "/add":
+        if parsed.path not in ("/add", "/match"):
             self._send(404, "Not Found\n")
             return
 
@@ -287,6 +722,10 @@ class LobbyHandler(BaseHTTPRequestHandler):
         params = urllib.parse.parse_qs(raw, keep_blank_values=True)
         flat = {k: v[0] if v else "" for k, v in params.items()}
 
+        if parsed.path == "/match":
+            self._match(flat)
+            return
+
         client_ip = _resolve_client_ip(self)
         fields = _extract_fields(flat, client_ip)
 
@@ -303,25 +742,52 @@ class LobbyHandler(BaseHTTPRequestHandler):
                 _next_id += 1
                 _rooms_by_key[key] = room_id
 
-            _rooms_by_id[room_id] = {
-                "id": room_id,
-                "key": key,
-                "fields": fields,
-                "updated": _now(),
-            }
+            _store_room(room_id, key, fields)
 
-        self._send(200, _plain_response(fields, room_id))
+        # The host keeps its token while it keeps announcing the room.
+        token = _make_token(_pairing_session(fields), 1,
+                            ROOM_TTL_SECONDS + LOBBY_TOKEN_TTL)
+        self._send(200, _plain_response(fields, room_id, token))
 
     def do_GET(self):
         parsed = urllib.parse.urlparse(self.path)
         if parsed.path == "/list":
+            params = urllib.parse.parse_qs(parsed.query, keep_blank_values=True)
+            since = params.get("since", [""])[0]
+            match = self.headers.get("If-None-Match", "")
+            with _rooms_lock:
+                version = _list_version
+                if match and _parse_version_tag(match) == version:
+                    payload = None
+                else:
+                    since = _parse_version_tag(since) if since else None
+                    if since is not None and since >= _delta_horizon:
+                        payload = _delta_list(since)
+                    else:
+                        version, payload = _full_list()
+            if payload is None:
+                self.send_response(304)
+                self.send_header("ETag", '"{}"'.format(_version_tag(version)))
+                self.end_headers()
+                return
+            self._send(200, payload, "application/json", _version_tag(version))
+            return
+
+        if parsed.path == "/join":
+            params = urllib.parse.parse_qs(parsed.query, keep_blank_values=True)
+            room_id = _coerce_int(params.get("id", [""])[0], 0)
             with _rooms_lock:
-                _prune_rooms()
-                records = []
-                for room in _rooms_by_id.values():
-                    records.append({"fields": room["fields"]})
-            payload = json.dumps({"records": records}, separators=(",", ":"))
-            self._send(200, payload, "application/json")
+                room = _rooms_by_id.get(room_id)
+                fields = room["fields"] if room else None
+            if fields is None:
+                self._send(404, "Not Found\n")
+                return
+            token = _make_token(_pairing_session(fields), 2, LOBBY_TOKEN_TTL)
+            self._send(200, "ggpo_token={}\n".format(token))
+            return
+
+        if parsed.path == "/landmarks":
+            self._send(200, "landmarks={}\n".format(_load_landmark_list()))
             return
 
         if parsed.path == "/tunnel":
@@ -343,6 +809,7 @@ def main():
     host = os.getenv("LOBBY_BIND", "0.0.0.0")
     port = int(os.getenv("LOBBY_PORT", "55435"))
     server = ThreadingHTTPServer((host, port), LobbyHandler)
+    threading.Thread(target=_prune_loop, daemon=True).start()
     print("Lobby server listening on {}:{} (TTL={}s)".format(
         host, port, ROOM_TTL_SECONDS
     ))
@@ -0,0 +1,279 @@
+/* Load test client for the GGPO rendezvous server.
+ *
+ * Usage: rendezvous_loadtest <server_ip> [port] [pairs] [seconds]
+ *
+ * Runs `pairs` host/client socket pairs in parallel.  Each pair registers a
+ * fresh room as host and client and starts on the next room as soon as the
+ * client sees PEER, so the server holds every room paired in the last
+ * ROOM_TIMEOUT_SEC.  Prints pairings per second and pairing latency once a
+ * second and in total.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define snprintf _snprintf
+#endif
+
+#define DEFAULT_PORT 7000
+#define DEFAULT_PAIRS 32
+#define DEFAULT_SECONDS 10
+#define BUF_SIZE 256
+#define MAGIC "RNDV1"
+#define PEER_BURST_COUNT 3
+#define RETRY_MS 1000
+
+#ifdef _WIN32
+typedef SOCKET socket_t;
+#define INVALID_SOCKET_FD INVALID_SOCKET
+static void close_socket(socket_t fd)
+{
+   closesocket(fd);
+}
+#else
+typedef int socket_t;
+#define INVALID_SOCKET_FD (-1)
+static void close_socket(socket_t fd)
+{
+   close(fd);
+}
+#endif
+
+typedef struct pair_state
+{
+   socket_t host;
+   socket_t client;
+   unsigned long room;
+   double started_ms;
+   int pending_peers;    /* PEER datagrams still due to the client */
+} pair_state_t;
+
+static double now_ms(void)
+{
+#ifdef _WIN32
+   return (double)GetTickCount();
+#else
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+#endif
+}
+
+static socket_t open_socket(void)
+{
+   struct sockaddr_in addr;
+   socket_t fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+   if (fd == INVALID_SOCKET_FD)
+      return fd;
+
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family      = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_ANY);
+   if (bind(fd, (const struct sockaddr*)&addr, sizeof(addr)) < 0)
+   {
+      close_socket(fd);
+      return INVALID_SOCKET_FD;
+   }
+   return fd;
+}
+
+static void send_role(socket_t fd, const struct sockaddr_in *server,
+      char role, unsigned pair, unsigned long room)
+{
+   char msg[BUF_SIZE];
+   int len = snprintf(msg, sizeof(msg), "%s %c lt%u_%lu", MAGIC, role, pair, room);
+
+   if (len <= 0 || len >= (int)sizeof(msg))
+      return;
+   sendto(fd, msg, len, 0, (const struct sockaddr*)server, sizeof(*server));
+}
+
+static void start_room(pair_state_t *pair, unsigned index,
+      const struct sockaddr_in *server, double now)
+{
+   pair->room++;
+   pair->started_ms = now;
+   send_role(pair->host, server, 'H', index, pair->room);
+   send_role(pair->client, server, 'C', index, pair->room);
+}
+
+static void drain(socket_t fd, pair_state_t *pair, int is_client,
+      unsigned long *pairings, double *latency_ms, unsigned index,
+      const struct sockaddr_in *server, double now)
+{
+   char buf[BUF_SIZE];
+   int len = (int)recv(fd, buf, sizeof(buf) - 1, 0);
+
+   if (len <= 0 || !is_client)
+      return;
+   buf[len] = '\0';
+   if (strncmp(buf, "PEER ", 5) != 0)
+      return;
+
+   /* The server answers each pairing with a burst; the first of each burst
+    * completes the room, the rest are only drained. */
+   if (pair->pending_peers-- % PEER_BURST_COUNT != 0)
+      return;
+   (*pairings)++;
+   *latency_ms += now - pair->started_ms;
+   pair->pending_peers += PEER_BURST_COUNT;
+   start_room(pair, index, server, now);
+}
+
+int main(int argc, char **argv)
+{
+   struct sockaddr_in server;
+   unsigned port = DEFAULT_PORT;
+   unsigned pairs = DEFAULT_PAIRS;
+   unsigned seconds = DEFAULT_SECONDS;
+   pair_state_t *state;
+   unsigned long pairings = 0;
+   unsigned long window_pairings = 0;
+   unsigned long retries = 0;
+   double latency_ms = 0.0;
+   double start, last_report;
+   unsigned i;
+
+#ifdef _WIN32
+   WSADATA wsa_data;
+   if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0)
+      return 1;
+#endif
+
+   if (argc < 2)
+   {
+      fprintf(stderr, "Usage: %s <server_ip> [port] [pairs] [seconds]\n", argv[0]);
+      return 1;
+   }
+   if (argc > 2)
+      port = (unsigned)strtoul(argv[2], NULL, 10);
+   if (argc > 3)
+      pairs = (unsigned)strtoul(argv[3], NULL, 10);
+   if (argc > 4)
+      seconds = (unsigned)strtoul(argv[4], NULL, 10);
+   if (port < 1 || port > 65535 || pairs < 1 || pairs * 2 > FD_SETSIZE - 8)
+   {
+      fprintf(stderr, "Invalid port or pair count.\n");
+      return 1;
+   }
+
+   memset(&server, 0, sizeof(server));
+   server.sin_family = AF_INET;
+   server.sin_port   = htons((unsigned short)port);
+   if (inet_pton(AF_INET, argv[1], &server.sin_addr) != 1)
+   {
+      fprintf(stderr, "Invalid server address: %s\n", argv[1]);
+      return 1;
+   }
+
+   state = (pair_state_t*)calloc(pairs, sizeof(*state));
+   if (!state)
+      return 1;
+
+   start = last_report = now_ms();
+   for (i = 0; i < pairs; i++)
+   {
+      state[i].host   = open_socket();
+      state[i].client = open_socket();
+      if (state[i].host == INVALID_SOCKET_FD || state[i].client == INVALID_SOCKET_FD)
+      {
+         fprintf(stderr, "Failed to open sockets for pair %u.\n", i);
+         return 1;
+      }
+      state[i].pending_peers = PEER_BURST_COUNT;
+      start_room(&state[i], i, &server, start);
+   }
+
+   for (;;)
+   {
+      fd_set fds;
+      struct timeval tv;
+      socket_t max_fd = 0;
+      double now;
+
+      FD_ZERO(&fds);
+      for (i = 0; i < pairs; i++)
+      {
+         FD_SET(state[i].host, &fds);
+         FD_SET(state[i].client, &fds);
+         if (state[i].host > max_fd)
+            max_fd = state[i].host;
+         if (state[i].client > max_fd)
+            max_fd = state[i].client;
+      }
+      tv.tv_sec  = 0;
+      tv.tv_usec = 100 * 1000;
+
+      if (select((int)max_fd + 1, &fds, NULL, NULL, &tv) < 0)
+         break;
+
+      now = now_ms();
+      for (i = 0; i < pairs; i++)
+      {
+         unsigned long before = pairings;
+
+         if (FD_ISSET(state[i].host, &fds))
+            drain(state[i].host, &state[i], 0, &pairings, &latency_ms, i, &server, now);
+         if (FD_ISSET(state[i].client, &fds))
+            drain(state[i].client, &state[i], 1, &pairings, &latency_ms, i, &server, now);
+         window_pairings += pairings - before;
+
+         /* A lost datagram leaves the pair waiting; move on to a new room. */
+         if (now - state[i].started_ms > RETRY_MS)
+         {
+            retries++;
+            state[i].pending_peers = PEER_BURST_COUNT;
+            start_room(&state[i], i, &server, now);
+         }
+      }
+
+      if (now - last_report >= 1000.0)
+      {
+         printf("%.0f pairings/s, %lu total, %lu retries\n",
+               window_pairings * 1000.0 / (now - last_report), pairings, retries);
+         fflush(stdout);
+         window_pairings = 0;
+         last_report     = now;
+      }
+
+      if (now - start >= seconds * 1000.0)
+         break;
+   }
+
+   {
+      double elapsed = (now_ms() - start) / 1000.0;
+      printf("%lu pairings in %.1f s: %.0f pairings/s, mean latency %.2f ms, %lu retries\n",
+            pairings, elapsed, elapsed > 0 ? pairings / elapsed : 0.0,
+            pairings ? latency_ms / pairings : 0.0, retries);
+   }
+
+   for (i = 0; i < pairs; i++)
+   {
+      close_socket(state[i].host);
+      close_socket(state[i].client);
+   }
+   free(state);
+
+#ifdef _WIN32
+   WSACleanup();
+#endif
+
+   return 0;
+}
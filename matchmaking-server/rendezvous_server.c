@@ -1,9 +1,24 @@
 /* Simple GGPO rendezvous server for RetroArch.
  * Protocol (UDP, ASCII):
- *  Client -> server: "RNDV1 H <room>" or "RNDV1 C <room>"
- *  Server -> client: "WAIT <room>" or "PEER <ip> <port>"
+ *  Client -> server: "RNDV1 H <room> [note]" or "RNDV1 C <room> [note]"
+ *                    or "RNDV1 T <token> [note]"
+ *  Server -> client: "WAIT <room>", "PEER <ip> <port> [note]" or
+ *                    "ERR <token> <reason>"
+ * The optional note is an opaque token passed on to the other side (the
+ * GGPO relay selection sends its relay RTTs this way).  T registers with a
+ * lobby pairing token, which names the room and the side; see check_token().
+ *
+ * Usage: rendezvous_server [port] [max_rooms]
+ * max_rooms defaults to RENDEZVOUS_MAX_ROOMS or DEFAULT_MAX_ROOMS.
+ *
+ *        rendezvous_server --relay [port] [max_sessions]
+ * runs the GGPO UDP relay instead (see relay_main()).
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -18,6 +33,9 @@
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <unistd.h>
+#if defined(__linux__)
+#define HAVE_RECVMMSG
+#endif
 #endif
 
 #if defined(_MSC_VER) && _MSC_VER < 1900
@@ -25,13 +43,21 @@
 #endif
 
 #define DEFAULT_PORT 7000
-#define MAX_ROOMS 128
+#define DEFAULT_MAX_ROOMS 262144
+#define MAX_ROOMS_LIMIT (1u << 24)
 #define ROOM_NAME_MAX 64
+#define NOTE_MAX 48
 #define BUF_SIZE 256
 #define MAGIC "RNDV1"
 #define ROOM_TIMEOUT_SEC 30
 #define PEER_BURST_COUNT 3
 
+/* One slot per second; must exceed ROOM_TIMEOUT_SEC + 1 so a deadline never
+ * wraps onto the slot being drained. */
+#define WHEEL_SLOTS 64
+/* Datagrams taken per recvmmsg() call where it is available. */
+#define RECV_BATCH 64
+#define ROOM_NONE 0xffffffffu
 #ifdef _WIN32
 typedef SOCKET socket_t;
 #define INVALID_SOCKET_FD INVALID_SOCKET
@@ -55,55 +81,372 @@ typedef struct room_entry
    int has_client;
    struct sockaddr_in host_addr;
    struct sockaddr_in client_addr;
+   char host_note[NOTE_MAX];
+   char client_note[NOTE_MAX];
    time_t host_seen;
    time_t client_seen;
+   unsigned hash;
+   unsigned next;        /* timer wheel chain, or the free list */
 } room_entry_t;
 
-static room_entry_t rooms[MAX_ROOMS];
-static size_t room_count = 0;
+/* Rooms live in a fixed pool so their indices stay put; the open-addressing
+ * table (linear probing, at most half full) maps names to pool indices, and
+ * each live room sits in exactly one wheel slot.  Refreshing a room does not
+ * move it: when its slot comes round it is either expired or rescheduled. */
+static room_entry_t *rooms;
+static unsigned *room_table;
+static unsigned room_table_mask;
+static unsigned room_capacity;
+static unsigned room_count;
+static unsigned room_free = ROOM_NONE;
+static unsigned room_wheel[WHEEL_SLOTS];
+static time_t wheel_time;
+static const char *token_secret;   /* RENDEZVOUS_TOKEN_SECRET */
+
+static unsigned hash_name(const char *name)
+{
+   /* FNV-1a */
+   unsigned h = 2166136261u;
+
+   while (*name)
+   {
+      h ^= (unsigned char)*name++;
+      h *= 16777619u;
+   }
+   return h;
+}
+
+/* ---------------------------------------------------------------------
+ * Lobby pairing tokens (lobby-server/README.md):
+ * "<session>.<slot>.<expiry>.<mac>", where mac is the first 8 bytes of
+ * HMAC-SHA256(secret, "<session>.<slot>.<expiry>") in hex.
+ * --------------------------------------------------------------------- */
+
+#define TOKEN_MAC_HEX 16
+
+static const unsigned sha256_k[64] = {
+   0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+   0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+   0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+   0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+   0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+   0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+   0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+   0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+   0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+   0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+   0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
 
-static room_entry_t *find_or_create_room(const char *name)
+#define SHA_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_block(unsigned *state, const unsigned char *p)
 {
+   unsigned w[64];
+   unsigned a, b, c, d, e, f, g, h;
+   int i;
+
+   for (i = 0; i < 16; i++)
+      w[i] = (unsigned)p[i * 4] << 24 | (unsigned)p[i * 4 + 1] << 16
+         | (unsigned)p[i * 4 + 2] << 8 | (unsigned)p[i * 4 + 3];
+   for (i = 16; i < 64; i++)
+      w[i] = w[i - 16] + w[i - 7]
+         + (SHA_ROTR(w[i - 15], 7) ^ SHA_ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3))
+         + (SHA_ROTR(w[i - 2], 17) ^ SHA_ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10));
+
+   a = state[0]; b = state[1]; c = state[2]; d = state[3];
+   e = state[4]; f = state[5]; g = state[6]; h = state[7];
+   for (i = 0; i < 64; i++)
+   {
+      unsigned t1 = h + (SHA_ROTR(e, 6) ^ SHA_ROTR(e, 11) ^ SHA_ROTR(e, 25))
+         + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+      unsigned t2 = (SHA_ROTR(a, 2) ^ SHA_ROTR(a, 13) ^ SHA_ROTR(a, 22))
+         + ((a & b) ^ (a & c) ^ (b & c));
+
+      h = g; g = f; f = e; e = d + t1;
+      d = c; c = b; b = a; a = t1 + t2;
+   }
+   state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+   state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+/* SHA-256 of a followed by b, which is all HMAC needs. */
+static void sha256_two(const unsigned char *a, size_t a_len,
+      const unsigned char *b, size_t b_len, unsigned char *out)
+{
+   unsigned state[8] = {
+      0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+      0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+   };
+   unsigned char block[64];
+   size_t total = a_len + b_len;
+   size_t used  = 0;
    size_t i;
 
-   for (i = 0; i < room_count; i++)
+   for (i = 0; i < total; i++)
+   {
+      block[used++] = i < a_len ? a[i] : b[i - a_len];
+      if (used == sizeof(block))
+      {
+         sha256_block(state, block);
+         used = 0;
+      }
+   }
+
+   block[used++] = 0x80;
+   if (used > 56)
+   {
+      memset(block + used, 0, sizeof(block) - used);
+      sha256_block(state, block);
+      used = 0;
+   }
+   memset(block + used, 0, 56 - used);
+   for (i = 0; i < 8; i++)
+      block[56 + i] = (unsigned char)((unsigned long long)total * 8
+            >> (56 - 8 * i));
+   sha256_block(state, block);
+
+   for (i = 0; i < 32; i++)
+      out[i] = (unsigned char)(state[i / 4] >> (24 - 8 * (i % 4)));
+}
+
+static void hmac_sha256(const char *key, const char *msg, unsigned char *out)
+{
+   unsigned char k[64];
+   unsigned char pad[64];
+   unsigned char inner[32];
+   size_t key_len = strlen(key);
+   int i;
+
+   memset(k, 0, sizeof(k));
+   if (key_len > sizeof(k))
+      sha256_two((const unsigned char*)key, key_len, NULL, 0, k);
+   else
+      memcpy(k, key, key_len);
+
+   for (i = 0; i < 64; i++)
+      pad[i] = k[i] ^ 0x36;
+   sha256_two(pad, sizeof(pad), (const unsigned char*)msg, strlen(msg), inner);
+   for (i = 0; i < 64; i++)
+      pad[i] = k[i] ^ 0x5c;
+   sha256_two(pad, sizeof(pad), inner, sizeof(inner), out);
+}
+
+/* Checks a lobby pairing token.  On success copies out the session it names
+ * and its slot (1 host, 2 client) and returns NULL; otherwise returns the
+ * reason to send back. */
+static const char *check_token(const char *secret, const char *token,
+      time_t now, char *session, size_t session_size, int *slot)
+{
+   char body[BUF_SIZE];
+   unsigned char mac[32];
+   static const char hex[] = "0123456789abcdef";
+   const char *dot1 = strchr(token, '.');
+   const char *dot2 = dot1 ? strchr(dot1 + 1, '.') : NULL;
+   const char *dot3 = dot2 ? strchr(dot2 + 1, '.') : NULL;
+   unsigned long expiry;
+   unsigned diff = 0;
+   char *end;
+   int i;
+
+   if (!secret || !*secret)
+      return "no_token_secret";
+   if (!dot3 || dot1 == token || dot2 - dot1 != 2
+         || (dot1[1] != '1' && dot1[1] != '2')
+         || (size_t)(dot1 - token) >= session_size
+         || (size_t)(dot3 - token) >= sizeof(body)
+         || strlen(dot3 + 1) != TOKEN_MAC_HEX)
+      return "bad_token";
+
+   memcpy(body, token, (size_t)(dot3 - token));
+   body[dot3 - token] = '\0';
+   hmac_sha256(secret, body, mac);
+   for (i = 0; i < TOKEN_MAC_HEX; i++)
+   {
+      char c = dot3[1 + i];
+
+      if (c >= 'A' && c <= 'F')
+         c = (char)(c - 'A' + 'a');
+      diff |= (unsigned)(c ^ hex[(mac[i / 2] >> (i & 1 ? 0 : 4)) & 0xf]);
+   }
+   if (diff)
+      return "bad_token";
+
+   expiry = strtoul(dot2 + 1, &end, 10);
+   if (end != dot3)
+      return "bad_token";
+   if ((time_t)expiry < now)
+      return "expired_token";
+
+   memcpy(session, token, (size_t)(dot1 - token));
+   session[dot1 - token] = '\0';
+   *slot = dot1[1] - '0';
+   return NULL;
+}
+
+static int rooms_init(unsigned capacity)
+{
+   unsigned slots = 1;
+   unsigned i;
+
+   while (slots < capacity * 2)
+      slots <<= 1;
+
+   rooms      = (room_entry_t*)calloc(capacity, sizeof(*rooms));
+   room_table = (unsigned*)malloc(slots * sizeof(*room_table));
+   if (!rooms || !room_table)
+      return 0;
+
+   for (i = 0; i < slots; i++)
+      room_table[i] = ROOM_NONE;
+   for (i = 0; i < WHEEL_SLOTS; i++)
+      room_wheel[i] = ROOM_NONE;
+
+   room_table_mask = slots - 1;
+   room_capacity   = capacity;
+   room_free       = ROOM_NONE;
+   room_count      = 0;
+   wheel_time      = time(NULL);
+   return 1;
+}
+
+static int side_alive(int present, time_t seen, time_t now)
+{
+   return present && (now - seen) <= ROOM_TIMEOUT_SEC;
+}
+
+/* Queues a room on the slot of the first second one of its sides can be
+ * stale in. */
+static void schedule_room(unsigned index)
+{
+   room_entry_t *room = &rooms[index];
+   time_t seen;
+   unsigned slot;
+
+   if (room->has_host && room->has_client)
+      seen = room->host_seen < room->client_seen
+         ? room->host_seen : room->client_seen;
+   else
+      seen = room->has_host ? room->host_seen : room->client_seen;
+
+   if (seen + ROOM_TIMEOUT_SEC + 1 <= wheel_time)
+      seen = wheel_time - ROOM_TIMEOUT_SEC;
+   slot = (unsigned)((seen + ROOM_TIMEOUT_SEC + 1) % WHEEL_SLOTS);
+   room->next       = room_wheel[slot];
+   room_wheel[slot] = index;
+}
+
+static unsigned *find_slot(const char *name, unsigned hash)
+{
+   unsigned pos = hash & room_table_mask;
+
+   for (;;)
    {
-      if (strcmp(rooms[i].name, name) == 0)
-         return &rooms[i];
+      unsigned index = room_table[pos];
+
+      if (index == ROOM_NONE)
+         return &room_table[pos];
+      if (rooms[index].hash == hash && strcmp(rooms[index].name, name) == 0)
+         return &room_table[pos];
+      pos = (pos + 1) & room_table_mask;
    }
+}
 
-   if (room_count >= MAX_ROOMS)
+static void remove_room(unsigned index)
+{
+   unsigned pos = rooms[index].hash & room_table_mask;
+   unsigned hole;
+
+   while (room_table[pos] != index)
+      pos = (pos + 1) & room_table_mask;
+
+   /* Backward-shift deletion keeps probe chains intact without tombstones. */
+   hole = pos;
+   for (;;)
+   {
+      unsigned home;
+      unsigned moved;
+
+      pos = (pos + 1) & room_table_mask;
+      moved = room_table[pos];
+      if (moved == ROOM_NONE)
+         break;
+      home = rooms[moved].hash & room_table_mask;
+      if (((pos - home) & room_table_mask) >= ((pos - hole) & room_table_mask))
+      {
+         room_table[hole] = moved;
+         hole = pos;
+      }
+   }
+   room_table[hole] = ROOM_NONE;
+
+   rooms[index].next = room_free;
+   room_free         = index;
+   room_count--;
+}
+
+static room_entry_t *find_or_create_room(const char *name, int *created)
+{
+   unsigned hash = hash_name(name);
+   unsigned *slot = find_slot(name, hash);
+   unsigned index;
+   room_entry_t *room;
+
+   *created = 0;
+   if (*slot != ROOM_NONE)
+      return &rooms[*slot];
+
+   if (room_count >= room_capacity)
       return NULL;
 
-   memset(&rooms[room_count], 0, sizeof(rooms[room_count]));
-   snprintf(rooms[room_count].name, sizeof(rooms[room_count].name), "%s", name);
-   return &rooms[room_count++];
+   if (room_free != ROOM_NONE)
+   {
+      index     = room_free;
+      room_free = rooms[index].next;
+   }
+   else
+      index = room_count;
+
+   room = &rooms[index];
+   memset(room, 0, sizeof(*room));
+   snprintf(room->name, sizeof(room->name), "%s", name);
+   room->hash = hash;
+   *slot      = index;
+   room_count++;
+   *created   = 1;
+   return room;
 }
 
-static void prune_rooms(void)
+/* Drains the wheel slots between the last call and now. */
+static void expire_rooms(time_t now)
 {
-   size_t i = 0;
-   time_t now = time(NULL);
+   unsigned steps = 0;
 
-   while (i < room_count)
+   while (wheel_time < now)
    {
-      room_entry_t *room = &rooms[i];
+      unsigned index;
 
-      if (room->has_host && (now - room->host_seen) > ROOM_TIMEOUT_SEC)
-         room->has_host = 0;
-      if (room->has_client && (now - room->client_seen) > ROOM_TIMEOUT_SEC)
-         room->has_client = 0;
+      wheel_time++;
+      index = room_wheel[wheel_time % WHEEL_SLOTS];
+      room_wheel[wheel_time % WHEEL_SLOTS] = ROOM_NONE;
 
-      if (!room->has_host && !room->has_client)
+      while (index != ROOM_NONE)
       {
-         if (i + 1 < room_count)
-            memmove(&rooms[i], &rooms[i + 1],
-                  (room_count - i - 1) * sizeof(*rooms));
-         room_count--;
-         continue;
+         room_entry_t *room = &rooms[index];
+         unsigned next      = room->next;
+
+         room->has_host   = side_alive(room->has_host, room->host_seen, wheel_time);
+         room->has_client = side_alive(room->has_client, room->client_seen, wheel_time);
+         if (!room->has_host && !room->has_client)
+            remove_room(index);
+         else
+            schedule_room(index);
+         index = next;
       }
 
-      i++;
+      /* After a long stall one pass over the wheel has seen every room. */
+      if (++steps >= WHEEL_SLOTS)
+         wheel_time = now;
    }
 }
 
@@ -125,7 +468,7 @@ static void send_wait(socket_t sock, const struct sockaddr_in *to,
 }
 
 static void send_peer(socket_t sock, const struct sockaddr_in *to,
-      const struct sockaddr_in *peer)
+      const struct sockaddr_in *peer, const char *note)
 {
    char msg[BUF_SIZE];
    char ip[INET_ADDRSTRLEN];
@@ -135,7 +478,8 @@ static void send_peer(socket_t sock, const struct sockaddr_in *to,
    if (!inet_ntop(AF_INET, &peer->sin_addr, ip, sizeof(ip)))
       return;
 
-   len = snprintf(msg, sizeof(msg), "PEER %s %u", ip, (unsigned)port);
+   len = snprintf(msg, sizeof(msg), note[0] ? "PEER %s %u %s" : "PEER %s %u",
+         ip, (unsigned)port, note);
    if (len < 0)
       return;
    if (len >= (int)sizeof(msg))
@@ -147,12 +491,955 @@ static void send_peer(socket_t sock, const struct sockaddr_in *to,
 }
 
 static void send_peer_burst(socket_t sock, const struct sockaddr_in *to,
-      const struct sockaddr_in *peer)
+      const struct sockaddr_in *peer, const char *note, int count)
 {
    int i;
 
-   for (i = 0; i < PEER_BURST_COUNT; i++)
-      send_peer(sock, to, peer);
+   for (i = 0; i < count; i++)
+      send_peer(sock, to, peer, note);
+}
+
+static void send_error(socket_t sock, const struct sockaddr_in *to,
+      const char *token, const char *reason)
+{
+   char msg[BUF_SIZE];
+   int len = snprintf(msg, sizeof(msg), "ERR %s %s", token, reason);
+
+   if (len <= 0)
+      return;
+   if (len >= (int)sizeof(msg))
+      len = (int)sizeof(msg) - 1;
+   sendto(sock, msg, len, 0, (const struct sockaddr*)to, sizeof(*to));
+}
+
+static void handle_packet(socket_t sock, char *buf, int len,
+      const struct sockaddr_in *from, time_t now)
+{
+   char magic[6];
+   char role = '\0';
+   char room_name[ROOM_NAME_MAX];
+   char note[NOTE_MAX];
+   room_entry_t *room;
+   int created;
+   int burst = PEER_BURST_COUNT;
+
+   buf[len] = '\0';
+   note[0]  = '\0';
+
+   if (sscanf(buf, "%5s %c %63s %47s", magic, &role, room_name, note) < 3)
+      return;
+   if (strcmp(magic, MAGIC) != 0)
+      return;
+   if (role == 'T')
+   {
+      char session[ROOM_NAME_MAX];
+      int slot;
+      const char *error = check_token(token_secret, room_name, now,
+            session, sizeof(session), &slot);
+
+      if (error)
+      {
+         send_error(sock, from, room_name, error);
+         return;
+      }
+      memcpy(room_name, session, strlen(session) + 1);
+      role  = slot == 1 ? 'H' : 'C';
+      /* Token clients retry until they see PEER; one copy does. */
+      burst = 1;
+   }
+   if (role != 'H' && role != 'C')
+      return;
+
+   room = find_or_create_room(room_name, &created);
+   if (!room)
+      return;
+
+   /* The wheel runs up to a second late; never pair with a stale side. */
+   room->has_host   = side_alive(room->has_host, room->host_seen, now);
+   room->has_client = side_alive(room->has_client, room->client_seen, now);
+
+   if (role == 'H')
+   {
+      room->host_addr = *from;
+      room->host_seen = now;
+      room->has_host  = 1;
+      memcpy(room->host_note, note, strlen(note) + 1);
+   }
+   else
+   {
+      room->client_addr = *from;
+      room->client_seen = now;
+      room->has_client  = 1;
+      memcpy(room->client_note, note, strlen(note) + 1);
+   }
+
+   if (created)
+      schedule_room((unsigned)(room - rooms));
+
+   if (room->has_host && room->has_client)
+   {
+      send_peer_burst(sock, &room->host_addr, &room->client_addr,
+            room->client_note, burst);
+      send_peer_burst(sock, &room->client_addr, &room->host_addr,
+            room->host_note, burst);
+   }
+   else
+   {
+      send_wait(sock, from, room_name);
+   }
+}
+
+/* ---------------------------------------------------------------------
+ * Relay mode: rendezvous_server --relay [port] [max_sessions]
+ *
+ * A native build of relay-server/relay_server.py.  It speaks the same
+ * RARELAY1 HELLO/BYE/PING control protocol and forwards every other
+ * datagram between the two clients of a session.  On Linux each core gets
+ * a worker with its own SO_REUSEPORT socket and recvmmsg/sendmmsg batches;
+ * a client's datagrams always hash to the same worker, and any worker can
+ * send from the shared port.  Forwarding reads the tables under a shared
+ * lock taken once per batch; control messages take it exclusively.
+ *
+ * "RARELAY1 TOKEN <token>" is a HELLO for the session and slot a lobby
+ * pairing token names, checked against RELAY_TOKEN_SECRET.  Whichever
+ * client completes a session, the other one is told READY at once.
+ *
+ * Extra command: "RARELAY1 STATS <session>" answers
+ * "RARELAY1 STATS <session> <packets1> <bytes1> <packets2> <bytes2>", the
+ * traffic forwarded from each slot.  RELAY_STATS_FILE, if set, is rewritten
+ * with one such line per session every RELAY_STATS_INTERVAL seconds.
+ * --------------------------------------------------------------------- */
+
+#define RELAY_DEFAULT_PORT 7001
+#define RELAY_DEFAULT_MAX_SESSIONS 65536
+#define RELAY_DEFAULT_SESSION_TTL 120
+#define RELAY_DEFAULT_CLIENT_TTL 30
+#define RELAY_DEFAULT_MAGIC "RARELAY1"
+#define RELAY_MAGIC_MAX 32
+#define RELAY_SESSION_MAX 64
+#define RELAY_MAX_PACKET 8192
+#define RELAY_MAX_WORKERS 64
+#define RELAY_STATS_INTERVAL 10
+#define RELAY_BCAST_MAGIC "RABCAST1"
+
+#if defined(__linux__)
+#define HAVE_RELAY_WORKERS
+#include <pthread.h>
+#endif
+
+#if defined(HAVE_RELAY_WORKERS)
+typedef pthread_rwlock_t relay_lock_t;
+#define relay_lock_init(l)   pthread_rwlock_init((l), NULL)
+#define relay_read_lock(l)   pthread_rwlock_rdlock(l)
+#define relay_write_lock(l)  pthread_rwlock_wrlock(l)
+#define relay_unlock(l)      pthread_rwlock_unlock(l)
+/* Forwarding updates these under the shared lock. */
+#define relay_add(p, v)      __atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+#define relay_store(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#else
+typedef int relay_lock_t;
+#define relay_lock_init(l)   (*(l) = 0)
+#define relay_read_lock(l)   ((void)(l))
+#define relay_write_lock(l)  ((void)(l))
+#define relay_unlock(l)      ((void)(l))
+#define relay_add(p, v)      (*(p) += (v))
+#define relay_store(p, v)    (*(p) = (v))
+#endif
+
+typedef struct relay_client
+{
+   struct sockaddr_in addr;
+   int present;
+   time_t last_seen;
+   unsigned long long packets;   /* forwarded from this client */
+   unsigned long long bytes;
+} relay_client_t;
+
+typedef struct relay_session
+{
+   char name[RELAY_SESSION_MAX];
+   unsigned hash;
+   int live;
+   time_t updated;
+   relay_client_t clients[2];
+   unsigned next_free;
+} relay_session_t;
+
+typedef struct relay_state
+{
+   relay_lock_t lock;
+   char magic[RELAY_MAGIC_MAX];
+   size_t magic_len;
+   time_t session_ttl;
+   time_t client_ttl;
+   relay_session_t *sessions;
+   unsigned capacity;
+   unsigned count;
+   unsigned high_water;          /* sessions[] beyond this were never used */
+   unsigned free_list;
+   unsigned *session_table;      /* name -> session index */
+   unsigned session_mask;
+   unsigned *addr_table;         /* client address -> session * 2 + slot */
+   unsigned addr_mask;
+   time_t last_prune;
+   time_t last_stats;
+   const char *stats_file;
+   const char *token_secret;
+   unsigned stats_interval;
+} relay_state_t;
+
+static relay_state_t relay;
+
+static unsigned relay_hash_addr(const struct sockaddr_in *addr)
+{
+   unsigned h = (unsigned)addr->sin_addr.s_addr * 2654435761u;
+   return h ^ ((unsigned)addr->sin_port * 40503u);
+}
+
+static int relay_addr_equal(const struct sockaddr_in *a,
+      const struct sockaddr_in *b)
+{
+   return a->sin_addr.s_addr == b->sin_addr.s_addr
+      && a->sin_port == b->sin_port;
+}
+
+static const struct sockaddr_in *relay_entry_addr(unsigned entry)
+{
+   return &relay.sessions[entry >> 1].clients[entry & 1].addr;
+}
+
+static unsigned relay_find_addr(const struct sockaddr_in *addr)
+{
+   unsigned pos = relay_hash_addr(addr) & relay.addr_mask;
+
+   for (;;)
+   {
+      unsigned entry = relay.addr_table[pos];
+
+      if (entry == ROOM_NONE || relay_addr_equal(relay_entry_addr(entry), addr))
+         return entry;
+      pos = (pos + 1) & relay.addr_mask;
+   }
+}
+
+static void relay_insert_addr(unsigned entry)
+{
+   unsigned pos = relay_hash_addr(relay_entry_addr(entry)) & relay.addr_mask;
+
+   while (relay.addr_table[pos] != ROOM_NONE)
+      pos = (pos + 1) & relay.addr_mask;
+   relay.addr_table[pos] = entry;
+}
+
+/* Backward-shift deletion, as for the room table. */
+static void relay_table_remove(unsigned *table, unsigned mask, unsigned pos,
+      unsigned (*home_of)(unsigned))
+{
+   unsigned hole = pos;
+
+   for (;;)
+   {
+      unsigned home;
+      unsigned moved;
+
+      pos   = (pos + 1) & mask;
+      moved = table[pos];
+      if (moved == ROOM_NONE)
+         break;
+      home = home_of(moved) & mask;
+      if (((pos - home) & mask) >= ((pos - hole) & mask))
+      {
+         table[hole] = moved;
+         hole        = pos;
+      }
+   }
+   table[hole] = ROOM_NONE;
+}
+
+static unsigned relay_addr_home(unsigned entry)
+{
+   return relay_hash_addr(relay_entry_addr(entry));
+}
+
+static unsigned relay_session_home(unsigned index)
+{
+   return relay.sessions[index].hash;
+}
+
+static void relay_remove_addr(unsigned entry)
+{
+   unsigned pos = relay_addr_home(entry) & relay.addr_mask;
+
+   while (relay.addr_table[pos] != entry)
+   {
+      if (relay.addr_table[pos] == ROOM_NONE)
+         return;
+      pos = (pos + 1) & relay.addr_mask;
+   }
+   relay_table_remove(relay.addr_table, relay.addr_mask, pos, relay_addr_home);
+}
+
+static void relay_drop_client(unsigned entry)
+{
+   relay_client_t *client = &relay.sessions[entry >> 1].clients[entry & 1];
+
+   if (!client->present)
+      return;
+   relay_remove_addr(entry);
+   client->present = 0;
+}
+
+static unsigned relay_find_session(const char *name, unsigned hash)
+{
+   unsigned pos = hash & relay.session_mask;
+
+   for (;;)
+   {
+      unsigned index = relay.session_table[pos];
+
+      if (index == ROOM_NONE)
+         return ROOM_NONE;
+      if (relay.sessions[index].hash == hash
+            && strcmp(relay.sessions[index].name, name) == 0)
+         return index;
+      pos = (pos + 1) & relay.session_mask;
+   }
+}
+
+static unsigned relay_create_session(const char *name, unsigned hash,
+      time_t now)
+{
+   unsigned pos = hash & relay.session_mask;
+   unsigned index;
+   relay_session_t *session;
+
+   if (relay.count >= relay.capacity)
+      return ROOM_NONE;
+
+   if (relay.free_list != ROOM_NONE)
+   {
+      index           = relay.free_list;
+      relay.free_list = relay.sessions[index].next_free;
+   }
+   else
+      index = relay.high_water++;
+
+   session = &relay.sessions[index];
+   memset(session, 0, sizeof(*session));
+   snprintf(session->name, sizeof(session->name), "%s", name);
+   session->hash    = hash;
+   session->live    = 1;
+   session->updated = now;
+
+   while (relay.session_table[pos] != ROOM_NONE)
+      pos = (pos + 1) & relay.session_mask;
+   relay.session_table[pos] = index;
+   relay.count++;
+   return index;
+}
+
+static void relay_remove_session(unsigned index)
+{
+   unsigned pos = relay.sessions[index].hash & relay.session_mask;
+
+   relay_drop_client(index * 2);
+   relay_drop_client(index * 2 + 1);
+
+   while (relay.session_table[pos] != index)
+      pos = (pos + 1) & relay.session_mask;
+   relay_table_remove(relay.session_table, relay.session_mask, pos,
+         relay_session_home);
+
+   relay.sessions[index].live      = 0;
+   relay.sessions[index].next_free = relay.free_list;
+   relay.free_list                 = index;
+   relay.count--;
+}
+
+static int relay_init(unsigned capacity)
+{
+   unsigned slots = 1;
+   unsigned i;
+
+   while (slots < capacity * 2)
+      slots <<= 1;
+
+   relay.sessions      = (relay_session_t*)calloc(capacity, sizeof(*relay.sessions));
+   relay.session_table = (unsigned*)malloc(slots * sizeof(*relay.session_table));
+   relay.addr_table    = (unsigned*)malloc(slots * 2 * sizeof(*relay.addr_table));
+   if (!relay.sessions || !relay.session_table || !relay.addr_table)
+      return 0;
+
+   for (i = 0; i < slots; i++)
+      relay.session_table[i] = ROOM_NONE;
+   for (i = 0; i < slots * 2; i++)
+      relay.addr_table[i] = ROOM_NONE;
+
+   relay.session_mask = slots - 1;
+   relay.addr_mask    = slots * 2 - 1;
+   relay.capacity     = capacity;
+   relay.free_list    = ROOM_NONE;
+   relay.last_prune   = time(NULL);
+   relay.last_stats   = relay.last_prune;
+   relay_lock_init(&relay.lock);
+   return 1;
+}
+
+static long relay_env_long(const char *name, long fallback)
+{
+   const char *raw = getenv(name);
+   char *end;
+   long value;
+
+   if (!raw || !*raw)
+      return fallback;
+   value = strtol(raw, &end, 10);
+   return *end ? fallback : value;
+}
+
+static void relay_reply(socket_t sock, const struct sockaddr_in *to,
+      const char *status, const char *session, const char *extra)
+{
+   char msg[BUF_SIZE];
+   int len = snprintf(msg, sizeof(msg), "%s %s %s%s%s\n", relay.magic, status,
+         session, extra ? " " : "", extra ? extra : "");
+
+   if (len <= 0)
+      return;
+   if (len >= (int)sizeof(msg))
+      len = (int)sizeof(msg) - 1;
+   sendto(sock, msg, len, 0, (const struct sockaddr*)to, sizeof(*to));
+}
+
+static void relay_format_stats(char *out, size_t size,
+      const relay_session_t *session)
+{
+   snprintf(out, size, "%llu %llu %llu %llu",
+         session->clients[0].packets, session->clients[0].bytes,
+         session->clients[1].packets, session->clients[1].bytes);
+}
+
+/* Expires idle clients and sessions; called with the lock held exclusively. */
+static void relay_prune(time_t now)
+{
+   unsigned i;
+   int slot;
+
+   for (i = 0; i < relay.high_water; i++)
+   {
+      relay_session_t *session = &relay.sessions[i];
+
+      if (!session->live)
+         continue;
+      for (slot = 0; slot < 2; slot++)
+         if (session->clients[slot].present
+               && now - session->clients[slot].last_seen > relay.client_ttl)
+            relay_drop_client(i * 2 + slot);
+      if (!session->clients[0].present && !session->clients[1].present
+            && now - session->updated > relay.session_ttl)
+         relay_remove_session(i);
+   }
+}
+
+static void relay_write_stats(void)
+{
+   char path[1024];
+   char line[BUF_SIZE];
+   FILE *out;
+   unsigned i;
+
+   snprintf(path, sizeof(path), "%s.tmp", relay.stats_file);
+   out = fopen(path, "w");
+   if (!out)
+      return;
+   for (i = 0; i < relay.high_water; i++)
+   {
+      if (!relay.sessions[i].live)
+         continue;
+      relay_format_stats(line, sizeof(line), &relay.sessions[i]);
+      fprintf(out, "%s %s\n", relay.sessions[i].name, line);
+   }
+   fclose(out);
+   remove(relay.stats_file);
+   rename(path, relay.stats_file);
+}
+
+/* Runs the periodic work at most once a second, from whichever worker gets
+ * there first. */
+static void relay_housekeeping(time_t now)
+{
+   if (now == relay.last_prune)
+      return;
+
+   relay_write_lock(&relay.lock);
+   if (now != relay.last_prune)
+   {
+      relay_prune(now);
+      relay.last_prune = now;
+      if (relay.stats_file
+            && now - relay.last_stats >= (time_t)relay.stats_interval)
+      {
+         relay_write_stats();
+         relay.last_stats = now;
+      }
+   }
+   relay_unlock(&relay.lock);
+}
+
+static int relay_is_control(const char *buf, int len)
+{
+   return len > (int)relay.magic_len
+      && memcmp(buf, relay.magic, relay.magic_len) == 0
+      && buf[relay.magic_len] == ' ';
+}
+
+/* Handles one control datagram; called with the lock held exclusively. */
+static void relay_control(socket_t sock, char *buf, int len,
+      const struct sockaddr_in *from, time_t now)
+{
+   char magic[RELAY_MAGIC_MAX];
+   char cmd[16];
+   char name[RELAY_SESSION_MAX];
+   char slot_token[16];
+   int fields;
+   unsigned index;
+   unsigned entry;
+   relay_session_t *session;
+   int slot;
+   size_t i;
+
+   buf[len] = '\0';
+   fields = sscanf(buf, "%31s %15s %63s %15s", magic, cmd, name, slot_token);
+   if (fields < 3 || strcmp(magic, relay.magic) != 0)
+      return;
+   for (i = 0; cmd[i]; i++)
+      if (cmd[i] >= 'a' && cmd[i] <= 'z')
+         cmd[i] = (char)(cmd[i] - 'a' + 'A');
+
+   if (strcmp(cmd, "TOKEN") == 0)
+   {
+      char session_name[RELAY_SESSION_MAX];
+      const char *error = check_token(relay.token_secret, name, now,
+            session_name, sizeof(session_name), &slot);
+
+      if (error)
+      {
+         relay_reply(sock, from, "ERR", name, error);
+         return;
+      }
+      memcpy(name, session_name, strlen(session_name) + 1);
+      snprintf(slot_token, sizeof(slot_token), "%d", slot);
+      snprintf(cmd, sizeof(cmd), "HELLO");
+      fields = 4;
+   }
+
+   index = relay_find_session(name, hash_name(name));
+
+   if (strcmp(cmd, "HELLO") == 0)
+   {
+      char slot_text[8];
+      int joined;
+
+      if (index == ROOM_NONE)
+      {
+         index = relay_create_session(name, hash_name(name), now);
+         if (index == ROOM_NONE)
+         {
+            relay_reply(sock, from, "FULL", name, NULL);
+            return;
+         }
+      }
+      session = &relay.sessions[index];
+
+      if (fields >= 4)
+      {
+         if (strcmp(slot_token, "1") != 0 && strcmp(slot_token, "2") != 0)
+         {
+            relay_reply(sock, from, "ERR", name, "bad_slot");
+            return;
+         }
+         slot = slot_token[0] - '1';
+      }
+      else
+         slot = session->clients[0].present ? 1 : 0;
+
+      if (session->clients[slot].present
+            && !relay_addr_equal(&session->clients[slot].addr, from))
+      {
+         relay_reply(sock, from, "BUSY", name, NULL);
+         return;
+      }
+
+      entry = relay_find_addr(from);
+      if (entry != ROOM_NONE && entry != index * 2 + slot)
+         relay_drop_client(entry);
+
+      joined = !session->clients[slot].present;
+      if (joined)
+      {
+         session->clients[slot].addr    = *from;
+         session->clients[slot].present = 1;
+         relay_insert_addr(index * 2 + slot);
+      }
+      session->clients[slot].last_seen = now;
+      session->updated                 = now;
+
+      snprintf(slot_text, sizeof(slot_text), "%d", slot + 1);
+      if (session->clients[0].present && session->clients[1].present)
+      {
+         relay_reply(sock, from, "READY", name, slot_text);
+         /* The waiting side hears now rather than on its next HELLO. */
+         if (joined)
+            relay_reply(sock, &session->clients[slot ^ 1].addr, "READY",
+                  name, slot ? "1" : "2");
+      }
+      else
+         relay_reply(sock, from, "WAIT", name, slot_text);
+      return;
+   }
+
+   if (strcmp(cmd, "BYE") == 0)
+   {
+      entry = relay_find_addr(from);
+      if (entry != ROOM_NONE)
+         relay_drop_client(entry);
+      relay_reply(sock, from, "OK", name, NULL);
+      return;
+   }
+
+   if (strcmp(cmd, "PING") == 0)
+   {
+      entry = relay_find_addr(from);
+      if (entry != ROOM_NONE)
+      {
+         relay.sessions[entry >> 1].clients[entry & 1].last_seen = now;
+         relay.sessions[entry >> 1].updated                      = now;
+      }
+      relay_reply(sock, from, "PONG", name, NULL);
+      return;
+   }
+
+   if (strcmp(cmd, "STATS") == 0)
+   {
+      char stats[BUF_SIZE];
+
+      if (index == ROOM_NONE)
+      {
+         relay_reply(sock, from, "ERR", name, "unknown_session");
+         return;
+      }
+      relay_format_stats(stats, sizeof(stats), &relay.sessions[index]);
+      relay_reply(sock, from, "STATS", name, stats);
+      return;
+   }
+
+   relay_reply(sock, from, "ERR", name, "unknown_command");
+}
+
+/* Looks up where a data datagram goes; called with the lock held shared.
+ * Returns 0 if it has nowhere to go. */
+static int relay_route(const struct sockaddr_in *from, int len, time_t now,
+      struct sockaddr_in *to)
+{
+   unsigned entry = relay_find_addr(from);
+   relay_session_t *session;
+   relay_client_t *client;
+   relay_client_t *other;
+
+   if (entry == ROOM_NONE)
+      return 0;
+   session = &relay.sessions[entry >> 1];
+   client  = &session->clients[entry & 1];
+   other   = &session->clients[(entry & 1) ^ 1];
+
+   if (client->last_seen != now)
+      relay_store(&client->last_seen, now);
+   if (session->updated != now)
+      relay_store(&session->updated, now);
+   if (!other->present)
+      return 0;
+
+   relay_add(&client->packets, 1);
+   relay_add(&client->bytes, (unsigned long long)len);
+   *to = other->addr;
+   return 1;
+}
+
+#ifdef HAVE_RECVMMSG
+typedef struct relay_worker
+{
+   socket_t sock;
+   char bufs[RECV_BATCH][RELAY_MAX_PACKET];
+   struct sockaddr_in froms[RECV_BATCH];
+   struct sockaddr_in tos[RECV_BATCH];
+   struct iovec iovs[RECV_BATCH];
+   struct iovec out_iovs[RECV_BATCH];
+   struct mmsghdr msgs[RECV_BATCH];
+   struct mmsghdr out[RECV_BATCH];
+} relay_worker_t;
+
+static void *relay_worker_main(void *arg)
+{
+   relay_worker_t *worker = (relay_worker_t*)arg;
+   int i;
+
+   for (i = 0; i < RECV_BATCH; i++)
+   {
+      worker->iovs[i].iov_base = worker->bufs[i];
+      worker->iovs[i].iov_len  = RELAY_MAX_PACKET - 1;
+   }
+
+   for (;;)
+   {
+      int count;
+      int sends = 0;
+      int sent  = 0;
+      int has_control = 0;
+      time_t now;
+
+      for (i = 0; i < RECV_BATCH; i++)
+      {
+         memset(&worker->msgs[i].msg_hdr, 0, sizeof(worker->msgs[i].msg_hdr));
+         worker->msgs[i].msg_hdr.msg_name    = &worker->froms[i];
+         worker->msgs[i].msg_hdr.msg_namelen = sizeof(worker->froms[i]);
+         worker->msgs[i].msg_hdr.msg_iov     = &worker->iovs[i];
+         worker->msgs[i].msg_hdr.msg_iovlen  = 1;
+      }
+
+      count = recvmmsg(worker->sock, worker->msgs, RECV_BATCH,
+            MSG_WAITFORONE, NULL);
+      if (count <= 0)
+         continue;
+
+      now = time(NULL);
+      relay_housekeeping(now);
+
+      /* Fast path: route the data datagrams under one shared lock and send
+       * them straight out of the receive buffers. */
+      relay_read_lock(&relay.lock);
+      for (i = 0; i < count; i++)
+      {
+         const char *buf = worker->bufs[i];
+         int len = (int)worker->msgs[i].msg_len;
+
+         if (len <= 0)
+            continue;
+         if (relay_is_control(buf, len))
+         {
+            has_control = 1;
+            continue;
+         }
+         /* Broadcast fan-out needs the match buffer; relay_server.py only. */
+         if (len >= 8 && memcmp(buf, RELAY_BCAST_MAGIC, 8) == 0)
+            continue;
+         if (!relay_route(&worker->froms[i], len, now, &worker->tos[sends]))
+            continue;
+
+         worker->out_iovs[sends].iov_base = worker->bufs[i];
+         worker->out_iovs[sends].iov_len  = (size_t)len;
+         memset(&worker->out[sends].msg_hdr, 0, sizeof(worker->out[sends].msg_hdr));
+         worker->out[sends].msg_hdr.msg_name    = &worker->tos[sends];
+         worker->out[sends].msg_hdr.msg_namelen = sizeof(worker->tos[sends]);
+         worker->out[sends].msg_hdr.msg_iov     = &worker->out_iovs[sends];
+         worker->out[sends].msg_hdr.msg_iovlen  = 1;
+         sends++;
+      }
+      relay_unlock(&relay.lock);
+
+      while (sent < sends)
+      {
+         int n = sendmmsg(worker->sock, worker->out + sent, sends - sent, 0);
+         if (n <= 0)
+            break;
+         sent += n;
+      }
+
+      if (!has_control)
+         continue;
+
+      relay_write_lock(&relay.lock);
+      for (i = 0; i < count; i++)
+      {
+         int len = (int)worker->msgs[i].msg_len;
+
+         if (len > 0 && relay_is_control(worker->bufs[i], len))
+            relay_control(worker->sock, worker->bufs[i], len,
+                  &worker->froms[i], now);
+      }
+      relay_unlock(&relay.lock);
+   }
+
+   return NULL;
+}
+#else
+static void relay_loop(socket_t sock)
+{
+   static char buf[RELAY_MAX_PACKET];
+
+   for (;;)
+   {
+      struct sockaddr_in from;
+      struct sockaddr_in to;
+      socklen_t from_len = sizeof(from);
+      int len;
+      time_t now;
+
+      memset(&from, 0, sizeof(from));
+      len = (int)recvfrom(sock, buf, sizeof(buf) - 1, 0,
+            (struct sockaddr*)&from, &from_len);
+      if (len <= 0)
+         continue;
+
+      now = time(NULL);
+      relay_housekeeping(now);
+      if (relay_is_control(buf, len))
+         relay_control(sock, buf, len, &from, now);
+      else if (!(len >= 8 && memcmp(buf, RELAY_BCAST_MAGIC, 8) == 0)
+            && relay_route(&from, len, now, &to))
+         sendto(sock, buf, len, 0, (const struct sockaddr*)&to, sizeof(to));
+   }
+}
+#endif
+
+static socket_t relay_open_socket(unsigned port, int reuse_port)
+{
+   struct sockaddr_in addr;
+   socket_t sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+   int opt = 1;
+   int bufsize = 4 * 1024 * 1024;
+
+   if (sock == INVALID_SOCKET_FD)
+      return sock;
+
+   setsockopt(sock, SOL_SOCKET, SO_REUSEADDR,
+         (const char*)&opt, (socklen_t)sizeof(opt));
+#ifdef SO_REUSEPORT
+   if (reuse_port)
+      setsockopt(sock, SOL_SOCKET, SO_REUSEPORT,
+            (const char*)&opt, (socklen_t)sizeof(opt));
+#endif
+   setsockopt(sock, SOL_SOCKET, SO_RCVBUF,
+         (const char*)&bufsize, (socklen_t)sizeof(bufsize));
+   setsockopt(sock, SOL_SOCKET, SO_SNDBUF,
+         (const char*)&bufsize, (socklen_t)sizeof(bufsize));
+
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family      = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_ANY);
+   addr.sin_port        = htons((unsigned short)port);
+
+   if (bind(sock, (const struct sockaddr*)&addr, sizeof(addr)) < 0)
+   {
+      close_socket(sock);
+      return INVALID_SOCKET_FD;
+   }
+   return sock;
+}
+
+static int relay_main(int argc, char **argv)
+{
+   unsigned port = RELAY_DEFAULT_PORT;
+   long capacity = relay_env_long("RELAY_MAX_SESSIONS", RELAY_DEFAULT_MAX_SESSIONS);
+   const char *magic = getenv("RELAY_MAGIC");
+   unsigned workers = 1;
+#ifdef HAVE_RELAY_WORKERS
+   static relay_worker_t *pool[RELAY_MAX_WORKERS];
+   pthread_t threads[RELAY_MAX_WORKERS];
+   long cores = sysconf(_SC_NPROCESSORS_ONLN);
+   unsigned w;
+#endif
+
+   if (argc > 1)
+   {
+      port = (unsigned)strtoul(argv[1], NULL, 10);
+      if (port > 65535)
+      {
+         fprintf(stderr, "Invalid port: %u\n", port);
+         return 1;
+      }
+   }
+   if (argc > 2)
+      capacity = (long)strtoul(argv[2], NULL, 10);
+   if (capacity < 1 || capacity > (long)MAX_ROOMS_LIMIT)
+   {
+      fprintf(stderr, "Invalid session capacity: %ld\n", capacity);
+      return 1;
+   }
+
+   /* Same fallbacks as relay_server.py. */
+   if (!magic || !*magic || strchr(magic, ' ')
+         || strlen(magic) >= RELAY_MAGIC_MAX)
+      magic = RELAY_DEFAULT_MAGIC;
+   snprintf(relay.magic, sizeof(relay.magic), "%s", magic);
+   relay.magic_len      = strlen(relay.magic);
+   relay.session_ttl    = (time_t)relay_env_long("RELAY_SESSION_TTL",
+         RELAY_DEFAULT_SESSION_TTL);
+   relay.client_ttl     = (time_t)relay_env_long("RELAY_CLIENT_TTL",
+         RELAY_DEFAULT_CLIENT_TTL);
+   relay.stats_file     = getenv("RELAY_STATS_FILE");
+   relay.token_secret   = getenv("RELAY_TOKEN_SECRET");
+   relay.stats_interval = (unsigned)relay_env_long("RELAY_STATS_INTERVAL",
+         RELAY_STATS_INTERVAL);
+   if (relay.stats_file && !*relay.stats_file)
+      relay.stats_file = NULL;
+
+   if (!relay_init((unsigned)capacity))
+   {
+      fprintf(stderr, "Failed to allocate %ld sessions.\n", capacity);
+      return 1;
+   }
+
+#ifdef HAVE_RELAY_WORKERS
+   workers = (unsigned)relay_env_long("RELAY_WORKERS", cores > 0 ? cores : 1);
+   if (workers < 1)
+      workers = 1;
+   if (workers > RELAY_MAX_WORKERS)
+      workers = RELAY_MAX_WORKERS;
+
+   for (w = 0; w < workers; w++)
+   {
+      pool[w] = (relay_worker_t*)calloc(1, sizeof(*pool[w]));
+      if (!pool[w])
+         return 1;
+      pool[w]->sock = relay_open_socket(port, workers > 1);
+      if (pool[w]->sock == INVALID_SOCKET_FD)
+      {
+         fprintf(stderr, "Failed to bind UDP port %u.\n", port);
+         return 1;
+      }
+   }
+
+   printf("GGPO relay listening on UDP %u (%u workers, %ld sessions)\n",
+         port, workers, capacity);
+   fflush(stdout);
+
+   for (w = 1; w < workers; w++)
+   {
+      if (pthread_create(&threads[w], NULL, relay_worker_main, pool[w]) != 0)
+      {
+         fprintf(stderr, "Failed to start relay worker %u.\n", w);
+         return 1;
+      }
+   }
+   relay_worker_main(pool[0]);
+#else
+   {
+      socket_t sock = relay_open_socket(port, 0);
+
+      if (sock == INVALID_SOCKET_FD)
+      {
+         fprintf(stderr, "Failed to bind UDP port %u.\n", port);
+         return 1;
+      }
+      printf("GGPO relay listening on UDP %u (%u worker, %ld sessions)\n",
+            port, workers, capacity);
+      fflush(stdout);
+      relay_loop(sock);
+      close_socket(sock);
+   }
+#endif
+
+   return 0;
 }
 
 int main(int argc, char **argv)
@@ -160,6 +1447,15 @@ int main(int argc, char **argv)
    socket_t sock = INVALID_SOCKET_FD;
    struct sockaddr_in addr;
    unsigned port = DEFAULT_PORT;
+   unsigned long capacity = DEFAULT_MAX_ROOMS;
+   const char *env_capacity = getenv("RENDEZVOUS_MAX_ROOMS");
+#ifdef HAVE_RECVMMSG
+   static char bufs[RECV_BATCH][BUF_SIZE];
+   static struct sockaddr_in froms[RECV_BATCH];
+   static struct iovec iovs[RECV_BATCH];
+   static struct mmsghdr msgs[RECV_BATCH];
+   int i;
+#endif
 
 #ifdef _WIN32
    WSADATA wsa_data;
@@ -167,6 +1463,9 @@ int main(int argc, char **argv)
       return 1;
 #endif
 
+   if (argc > 1 && strcmp(argv[1], "--relay") == 0)
+      return relay_main(argc - 1, argv + 1);
+
    if (argc > 1)
    {
       port = (unsigned)strtoul(argv[1], NULL, 10);
@@ -177,6 +1476,22 @@ int main(int argc, char **argv)
       }
    }
 
+   if (argc > 2)
+      capacity = strtoul(argv[2], NULL, 10);
+   else if (env_capacity && *env_capacity)
+      capacity = strtoul(env_capacity, NULL, 10);
+   if (capacity < 1 || capacity > MAX_ROOMS_LIMIT)
+   {
+      fprintf(stderr, "Invalid room capacity: %lu\n", capacity);
+      return 1;
+   }
+   if (!rooms_init((unsigned)capacity))
+   {
+      fprintf(stderr, "Failed to allocate %lu rooms.\n", capacity);
+      return 1;
+   }
+   token_secret = getenv("RENDEZVOUS_TOKEN_SECRET");
+
    sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
    if (sock == INVALID_SOCKET_FD)
    {
@@ -190,6 +1505,14 @@ int main(int argc, char **argv)
             (const char*)&opt, (socklen_t)sizeof(opt));
    }
 
+   {
+      /* Sign-up bursts arrive faster than a single batch; let the kernel
+       * hold them rather than drop them. */
+      int rcvbuf = 4 * 1024 * 1024;
+      setsockopt(sock, SOL_SOCKET, SO_RCVBUF,
+            (const char*)&rcvbuf, (socklen_t)sizeof(rcvbuf));
+   }
+
    memset(&addr, 0, sizeof(addr));
    addr.sin_family = AF_INET;
    addr.sin_addr.s_addr = htonl(INADDR_ANY);
@@ -202,19 +1525,50 @@ int main(int argc, char **argv)
       return 1;
    }
 
-   printf("GGPO rendezvous server listening on UDP %u\n", port);
+   printf("GGPO rendezvous server listening on UDP %u (%lu rooms)\n",
+         port, capacity);
+
+#ifdef HAVE_RECVMMSG
+   for (i = 0; i < RECV_BATCH; i++)
+   {
+      iovs[i].iov_base = bufs[i];
+      iovs[i].iov_len  = BUF_SIZE - 1;
+   }
+#endif
 
    for (;;)
    {
+      time_t now;
+#ifdef HAVE_RECVMMSG
+      int count;
+
+      for (i = 0; i < RECV_BATCH; i++)
+      {
+         memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+         msgs[i].msg_hdr.msg_name    = &froms[i];
+         msgs[i].msg_hdr.msg_namelen = sizeof(froms[i]);
+         msgs[i].msg_hdr.msg_iov     = &iovs[i];
+         msgs[i].msg_hdr.msg_iovlen  = 1;
+      }
+
+      /* Block for the first datagram, then take whatever else is queued. */
+      count = recvmmsg(sock, msgs, RECV_BATCH, MSG_WAITFORONE, NULL);
+      if (count <= 0)
+         continue;
+
+      now = time(NULL);
+      expire_rooms(now);
+      for (i = 0; i < count; i++)
+      {
+         if (msgs[i].msg_len == 0)
+            continue;
+         handle_packet(sock, bufs[i], (int)msgs[i].msg_len, &froms[i], now);
+      }
+#else
       struct sockaddr_in from;
       socklen_t from_len = sizeof(from);
       char buf[BUF_SIZE];
-      char magic[6];
-      char role = '\0';
-      char room_name[ROOM_NAME_MAX];
       int recvd;
-      time_t now;
-      room_entry_t *room;
 
       memset(&from, 0, sizeof(from));
       recvd = (int)recvfrom(sock, buf, sizeof(buf) - 1, 0,
@@ -222,45 +1576,10 @@ int main(int argc, char **argv)
       if (recvd <= 0)
          continue;
 
-      buf[recvd] = '\0';
-
-      if (sscanf(buf, "%5s %c %63s", magic, &role, room_name) != 3)
-         continue;
-      if (strcmp(magic, MAGIC) != 0)
-         continue;
-
-      prune_rooms();
-      room = find_or_create_room(room_name);
-      if (!room)
-         continue;
-
       now = time(NULL);
-      if (role == 'H')
-      {
-         room->host_addr = from;
-         room->host_seen = now;
-         room->has_host  = 1;
-      }
-      else if (role == 'C')
-      {
-         room->client_addr = from;
-         room->client_seen = now;
-         room->has_client  = 1;
-      }
-      else
-      {
-         continue;
-      }
-
-      if (room->has_host && room->has_client)
-      {
-         send_peer_burst(sock, &room->host_addr, &room->client_addr);
-         send_peer_burst(sock, &room->client_addr, &room->host_addr);
-      }
-      else
-      {
-         send_wait(sock, &from, room_name);
-      }
+      expire_rooms(now);
+      handle_packet(sock, buf, recvd, &from, now);
+#endif
    }
 
    close_socket(sock);
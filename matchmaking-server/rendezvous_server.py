@@ -1,6 +1,12 @@
 #!/usr/bin/env python3
-"""Simple GGPO rendezvous server for RetroArch (UDP, ASCII)."""
+"""Simple GGPO rendezvous server for RetroArch (UDP, ASCII).
 
+"RNDV1 T <token> [note]" registers with a lobby pairing token, checked
+against RENDEZVOUS_TOKEN_SECRET, in place of "RNDV1 H|C <room> [note]".
+"""
+
+import hashlib
+import hmac
 import logging
 import os
 import socket
@@ -10,6 +16,7 @@ import time
 DEFAULT_PORT = 7000
 MAX_ROOMS = 128
 ROOM_NAME_MAX = 64
+NOTE_MAX = 48
 BUF_SIZE = 256
 MAGIC = "RNDV1"
 ROOM_TIMEOUT_SEC = 30
@@ -38,6 +45,8 @@ def find_or_create_room(rooms, name):
         "has_client": False,
         "host_addr": None,
         "client_addr": None,
+        "host_note": "",
+        "client_note": "",
         "host_seen": 0,
         "client_seen": 0,
     }
@@ -63,20 +72,47 @@ def prune_rooms(rooms):
         i += 1
 
 
+def check_token(token, secret):
+    """Returns (room, role) for a lobby pairing token, or an error reason
+    (see lobby-server/README.md for the format)."""
+    if not secret:
+        return "no_token_secret"
+    parts = token.split(".")
+    if len(parts) != 4 or parts[1] not in ("1", "2"):
+        return "bad_token"
+    body = ".".join(parts[:3])
+    mac = hmac.new(secret.encode("utf-8"), body.encode("ascii", "replace"),
+                   hashlib.sha256).hexdigest()[:16]
+    if not hmac.compare_digest(mac, parts[3].lower()):
+        return "bad_token"
+    try:
+        expiry = int(parts[2], 10)
+    except ValueError:
+        return "bad_token"
+    if expiry < time.time():
+        return "expired_token"
+    return parts[0], "H" if parts[1] == "1" else "C"
+
+
 def send_wait(sock, to_addr, room):
     msg = f"WAIT {room}"
     sock.sendto(msg.encode("ascii", "replace"), to_addr)
 
 
-def send_peer(sock, to_addr, peer_addr):
+def send_peer(sock, to_addr, peer_addr, note):
     ip, port = peer_addr
-    msg = f"PEER {ip} {port}"
+    msg = f"PEER {ip} {port} {note}" if note else f"PEER {ip} {port}"
     sock.sendto(msg.encode("ascii", "replace"), to_addr)
 
 
-def send_peer_burst(sock, to_addr, peer_addr):
-    for _ in range(PEER_BURST_COUNT):
-        send_peer(sock, to_addr, peer_addr)
+def send_peer_burst(sock, to_addr, peer_addr, note, count=PEER_BURST_COUNT):
+    for _ in range(count):
+        send_peer(sock, to_addr, peer_addr, note)
+
+
+def send_error(sock, to_addr, token, reason):
+    msg = f"ERR {token} {reason}"
+    sock.sendto(msg.encode("ascii", "replace"), to_addr)
 
 
 def parse_port(argv):
@@ -104,6 +140,7 @@ def main(argv):
     sock.bind(("0.0.0.0", port))
 
     logger.info("GGPO rendezvous server listening on UDP %s", port)
+    token_secret = os.getenv("RENDEZVOUS_TOKEN_SECRET", "")
 
     rooms = []
     while True:
@@ -117,10 +154,23 @@ def main(argv):
             logger.debug("Dropping malformed packet from %s:%s", addr[0], addr[1])
             continue
         magic, role_token, room_name = parts[0], parts[1], parts[2]
+        # Optional opaque note passed on to the other side with PEER.
+        note = parts[3][: NOTE_MAX - 1] if len(parts) > 3 else ""
         if magic != MAGIC:
             logger.debug("Dropping packet with bad magic from %s:%s", addr[0], addr[1])
             continue
         role = role_token[:1]
+        burst = PEER_BURST_COUNT
+        if role == "T":
+            checked = check_token(room_name, token_secret)
+            if isinstance(checked, str):
+                logger.debug("Refusing token from %s:%s: %s", addr[0], addr[1],
+                             checked)
+                send_error(sock, addr, room_name, checked)
+                continue
+            room_name, role = checked
+            # Token clients retry until they see PEER; one copy does.
+            burst = 1
         room_name = room_name[: ROOM_NAME_MAX - 1]
         if not room_name:
             continue
@@ -138,11 +188,13 @@ def main(argv):
             room["host_addr"] = addr
             room["host_seen"] = now
             room["has_host"] = True
+            room["host_note"] = note
             logger.info("Room %s host registered at %s:%s.", room_name, addr[0], addr[1])
         elif role == "C":
             room["client_addr"] = addr
             room["client_seen"] = now
             room["has_client"] = True
+            room["client_note"] = note
             logger.info("Room %s client registered at %s:%s.", room_name, addr[0], addr[1])
         else:
             logger.debug("Dropping packet with unknown role from %s:%s", addr[0], addr[1])
@@ -157,8 +209,10 @@ def main(argv):
                 room["client_addr"][0],
                 room["client_addr"][1],
             )
-            send_peer_burst(sock, room["host_addr"], room["client_addr"])
-            send_peer_burst(sock, room["client_addr"], room["host_addr"])
+            send_peer_burst(sock, room["host_addr"], room["client_addr"],
+                            room["client_note"], burst)
+            send_peer_burst(sock, room["client_addr"], room["host_addr"],
+                            room["host_note"], burst)
         else:
             logger.debug("Room %s waiting for peer.", room_name)
             send_wait(sock, addr, room_name)
@@ -104,6 +104,8 @@
 
 #if defined(HAVE_LIBNX)
 #include "../../switch_performance_profiles.h"
+
+void libnx_apply_overclock(void);
 #endif
 
 #ifdef HAVE_MIST
@@ -4270,19 +4272,16 @@ static int action_ok_set_switch_cpu_profile(const char *path,
    settings_t *settings          = config_get_ptr();
 
    settings->uints.libnx_overclock = entry_idx;
+   libnx_apply_overclock();
 
-   if (hosversionBefore(8, 0, 0))
-      pcvSetClockRate(PcvModule_CpuBus, (u32)profile_clock);
+   /* TODO/FIXME - localize */
+   if (entry_idx == SWITCH_AUTO_CPU_PROFILE)
+      _len  = strlcpy(command, "Clock set by frame time", sizeof(command));
    else
    {
-      ClkrstSession session = {0};
-      clkrstOpenSession(&session, PcvModuleId_CpuBus, 3);
-      clkrstSetClockRate(&session, profile_clock);
-      clkrstCloseSession(&session);
+      _len  = strlcpy(command, "Current clock set to", sizeof(command));
+      _len += snprintf(command + _len, sizeof(command) - _len, "%i", profile_clock);
    }
-   /* TODO/FIXME - localize */
-   _len  = strlcpy(command, "Current clock set to", sizeof(command));
-   _len += snprintf(command + _len, sizeof(command) - _len, "%i", profile_clock);
 
    runloop_msg_queue_push(command, _len, 1, 90, true, NULL,
          MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
@@ -6746,6 +6745,8 @@ static int action_ok_netplay_connect_room(const char *path, const char *label,
       return -1;
 
    room = &net_st->room_list[room_index];
+   net_st->ggpo_relay_list[0] = '\0';
+   net_st->ggpo_token[0]      = '\0';
 
    if (room->ggpo)
    {
@@ -6787,9 +6788,27 @@ static int action_ok_netplay_connect_room(const char *path, const char *label,
          if (room->ggpo_relay_port > 0 && room->ggpo_relay_port <= 65535)
             settings->uints.netplay_ggpo_relay_port =
                (unsigned)room->ggpo_relay_port;
+         /* Relay selection agrees on a relay through the rendezvous server. */
+         if (!string_is_empty(room->ggpo_relays) &&
+               !string_is_empty(room->rendezvous_server))
+         {
+            strlcpy(settings->paths.netplay_rendezvous_server,
+               room->rendezvous_server,
+               sizeof(settings->paths.netplay_rendezvous_server));
+            if (room->rendezvous_port > 0 && room->rendezvous_port <= 65535)
+               settings->uints.netplay_rendezvous_port =
+                  (unsigned)room->rendezvous_port;
+         }
+         strlcpy(net_st->ggpo_relay_list, room->ggpo_relays,
+            sizeof(net_st->ggpo_relay_list));
       }
       else
          settings->bools.netplay_use_ggpo_relay = false;
+
+      /* Fetched while the content loads; registration starts without it
+       * if it is late. */
+      if (!room->lan && room->id > 0)
+         netplay_lobby_join_query(room->id);
    }
    else
    {
@@ -6818,73 +6837,100 @@ static int action_ok_netplay_connect_room(const char *path, const char *label,
    return 0;
 }
 
-static void netplay_refresh_rooms_cb(retro_task_t *task, void *task_data,
-      void *user_data, const char *err)
+static bool netplay_refresh_rooms_menu_active(void)
 {
-   char *room_data              = NULL;
    const char *path             = NULL;
    const char *label            = NULL;
    unsigned menu_type           = 0;
    enum msg_hash_enums enum_idx = MSG_UNKNOWN;
-   http_transfer_data_t *data   = (http_transfer_data_t*)task_data;
+
+   menu_entries_get_last_stack(&path, &label, &menu_type, &enum_idx, NULL);
+
+   return string_is_equal(label, msg_hash_to_str(MENU_ENUM_LABEL_NETPLAY_TAB))
+       || string_is_equal(label, msg_hash_to_str(MENU_ENUM_LABEL_NETPLAY));
+}
+
+static void netplay_refresh_rooms_parsed_cb(retro_task_t *task,
+      void *task_data, void *user_data, const char *err)
+{
+   int room_count;
+   struct netplay_rooms *rooms  = (struct netplay_rooms*)task_data;
    net_driver_state_t *net_st   = networking_state_get_ptr();
    struct menu_state *menu_st   = menu_state_get_ptr();
 
+   if (err || !rooms)
+   {
+      RARCH_ERR("[Netplay] %s.\n", msg_hash_to_str(MSG_DOWNLOAD_FAILED));
+      return;
+   }
+
+   /* Keep the delta even if we left the netplay menu. */
+   room_count = netplay_rooms_merge_lobby(rooms);
+
+   /* Don't push the results if we left the netplay menu */
+   if (!netplay_refresh_rooms_menu_active())
+      return;
+
    free(net_st->room_list);
    net_st->room_list  = NULL;
    net_st->room_count = 0;
 
-   menu_entries_get_last_stack(&path, &label, &menu_type, &enum_idx, NULL);
+   if (room_count > 0)
+   {
+      net_st->room_list = (struct netplay_room*)calloc(room_count,
+         sizeof(*net_st->room_list));
+      if (net_st->room_list)
+      {
+         net_st->room_count = room_count;
+         memcpy(net_st->room_list, net_st->lobby_rooms,
+            room_count * sizeof(*net_st->room_list));
+      }
+   }
+
+   menu_st->flags                  |= MENU_ST_FLAG_ENTRIES_NEED_REFRESH
+                                    | MENU_ST_FLAG_PREVENT_POPULATE;
+}
+
+static void netplay_refresh_rooms_cb(retro_task_t *task, void *task_data,
+      void *user_data, const char *err)
+{
+   char *room_data              = NULL;
+   http_transfer_data_t *data   = (http_transfer_data_t*)task_data;
+   net_driver_state_t *net_st   = networking_state_get_ptr();
+   struct menu_state *menu_st   = menu_state_get_ptr();
 
    /* Don't push the results if we left the netplay menu */
-   if (     !string_is_equal(label, msg_hash_to_str(MENU_ENUM_LABEL_NETPLAY_TAB))
-         && !string_is_equal(label, msg_hash_to_str(MENU_ENUM_LABEL_NETPLAY)))
+   if (!netplay_refresh_rooms_menu_active())
       return;
 
    if (err)
    {
       RARCH_ERR("[Netplay] %s: %s.\n", msg_hash_to_str(MSG_DOWNLOAD_FAILED), err);
-      goto done;
+      goto error;
    }
    if (!data || !data->data || !data->len || data->status != 200)
    {
       RARCH_ERR("[Netplay] %s.\n", msg_hash_to_str(MSG_DOWNLOAD_FAILED));
-      goto done;
+      goto error;
    }
 
    room_data = (char*)malloc(data->len + 1);
    if (!room_data)
-      goto done;
+      goto error;
    memcpy(room_data, data->data, data->len);
    room_data[data->len] = '\0';
 
-   if (!string_is_empty(room_data))
-   {
-      int room_count;
-
-      netplay_rooms_parse(room_data, strlen(room_data));
-
-      if ((room_count = netplay_rooms_get_count()) > 0)
-      {
-         net_st->room_list = (struct netplay_room*)calloc(room_count,
-            sizeof(*net_st->room_list));
-         if (net_st->room_list)
-         {
-            int i;
-
-            net_st->room_count = room_count;
-            for (i = 0; i < room_count; i++)
-               memcpy(&net_st->room_list[i], netplay_room_get(i),
-                  sizeof(*net_st->room_list));
-         }
-      }
-
-      netplay_rooms_free();
-   }
+   /* Parsed off the main thread; the menu keeps the old rooms until the
+    * new ones are in. */
+   if (task_push_netplay_rooms_parse(room_data, data->len,
+         netplay_refresh_rooms_parsed_cb))
+      return;
 
-   free(room_data);
+error:
+   free(net_st->room_list);
+   net_st->room_list  = NULL;
+   net_st->room_count = 0;
 
-done:
    menu_st->flags                  |= MENU_ST_FLAG_ENTRIES_NEED_REFRESH
                                     | MENU_ST_FLAG_PREVENT_POPULATE;
 }
@@ -6892,7 +6938,17 @@ done:
 static int action_ok_push_netplay_refresh_rooms(const char *path,
       const char *label, unsigned type, size_t idx, size_t entry_idx)
 {
-   task_push_http_transfer(FILE_PATH_LOBBY_LIBRETRO_URL "list", true, NULL,
+   char url[256];
+   net_driver_state_t *net_st = networking_state_get_ptr();
+
+   /* Only ask for what changed since the rooms we already have. */
+   if (!string_is_empty(net_st->lobby_version))
+      snprintf(url, sizeof(url), "%s?since=%s",
+            FILE_PATH_LOBBY_LIBRETRO_URL "list", net_st->lobby_version);
+   else
+      strlcpy(url, FILE_PATH_LOBBY_LIBRETRO_URL "list", sizeof(url));
+
+   task_push_http_transfer(url, true, NULL,
       netplay_refresh_rooms_cb, NULL);
 
    return 0;
@@ -8853,6 +8909,25 @@ static int action_ok_playlist_clean(const char *path,
    return 0;
 }
 
+static int action_ok_playlist_build_thumbnail_pack(const char *path,
+      const char *label, unsigned type, size_t idx, size_t entry_idx)
+{
+   playlist_t *playlist               = playlist_get_cached();
+   playlist_config_t *playlist_config = NULL;
+
+   if (!playlist)
+      return -1;
+
+   playlist_config = playlist_get_config(playlist);
+
+   if (!playlist_config || string_is_empty(playlist_config->path))
+      return -1;
+
+   task_push_thumbnail_pack(playlist_config);
+
+   return 0;
+}
+
 static int action_ok_playlist_refresh(const char *path,
       const char *label, unsigned type, size_t idx, size_t entry_idx)
 {
@@ -9290,6 +9365,7 @@ static int menu_cbs_init_bind_ok_compare_label(menu_file_list_cbs_t *cbs,
          {MENU_ENUM_LABEL_PLAYLIST_MANAGER_SETTINGS,           action_ok_push_playlist_manager_settings},
          {MENU_ENUM_LABEL_PLAYLIST_MANAGER_RESET_CORES,        action_ok_playlist_reset_cores},
          {MENU_ENUM_LABEL_PLAYLIST_MANAGER_CLEAN_PLAYLIST,     action_ok_playlist_clean},
+         {MENU_ENUM_LABEL_PLAYLIST_MANAGER_BUILD_THUMBNAIL_PACK, action_ok_playlist_build_thumbnail_pack},
          {MENU_ENUM_LABEL_PLAYLIST_MANAGER_REFRESH_PLAYLIST,   action_ok_playlist_refresh},
          {MENU_ENUM_LABEL_RECORDING_SETTINGS,                  action_ok_push_recording_settings_list},
          {MENU_ENUM_LABEL_INPUT_RETROPAD_BINDS,                action_ok_push_input_retropad_binds_list},
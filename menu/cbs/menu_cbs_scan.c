@@ -44,6 +44,7 @@ void handle_dbscan_finished(retro_task_t *task,
    if (menu_st->driver_ctx->environ_cb)
       menu_st->driver_ctx->environ_cb(MENU_ENVIRON_RESET_HORIZONTAL_LIST,
             NULL, menu_st->userdata);
+   menu_explore_rebuild();
 }
 
 int action_scan_file(const char *path,
@@ -292,6 +292,7 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_playlist_manager_reset_cores,  MENU_
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_playlist_manager_label_display_mode, MENU_ENUM_SUBLABEL_PLAYLIST_MANAGER_LABEL_DISPLAY_MODE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_playlist_manager_sort_mode, MENU_ENUM_SUBLABEL_PLAYLIST_MANAGER_SORT_MODE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_playlist_manager_clean_playlist, MENU_ENUM_SUBLABEL_PLAYLIST_MANAGER_CLEAN_PLAYLIST)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_playlist_manager_build_thumbnail_pack, MENU_ENUM_SUBLABEL_PLAYLIST_MANAGER_BUILD_THUMBNAIL_PACK)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_playlist_manager_refresh_playlist, MENU_ENUM_SUBLABEL_PLAYLIST_MANAGER_REFRESH_PLAYLIST)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_delete_playlist,               MENU_ENUM_SUBLABEL_DELETE_PLAYLIST)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_network_settings_list,         MENU_ENUM_SUBLABEL_NETWORK_SETTINGS)
@@ -323,6 +324,7 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_cheevos_unlock_sound_enable,   MENU_
 #endif
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_cheevos_auto_screenshot,       MENU_ENUM_SUBLABEL_CHEEVOS_AUTO_SCREENSHOT)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_cheevos_start_active,          MENU_ENUM_SUBLABEL_CHEEVOS_START_ACTIVE)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_cheevos_threaded,              MENU_ENUM_SUBLABEL_CHEEVOS_THREADED)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_cheevos_verbose_enable,        MENU_ENUM_SUBLABEL_CHEEVOS_VERBOSE_ENABLE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_cheevos_appearance_settings,   MENU_ENUM_SUBLABEL_CHEEVOS_APPEARANCE_SETTINGS)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_cheevos_appearance_anchor,     MENU_ENUM_SUBLABEL_CHEEVOS_APPEARANCE_ANCHOR)
@@ -532,6 +534,7 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_video_monitor_index,           MENU_
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_video_refresh_rate_auto,       MENU_ENUM_SUBLABEL_VIDEO_REFRESH_RATE_AUTO)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_video_hard_sync,               MENU_ENUM_SUBLABEL_VIDEO_HARD_SYNC)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_video_hard_sync_frames,        MENU_ENUM_SUBLABEL_VIDEO_HARD_SYNC_FRAMES)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_video_kms_direct_scanout,      MENU_ENUM_SUBLABEL_VIDEO_KMS_DIRECT_SCANOUT)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_video_threaded,                MENU_ENUM_SUBLABEL_VIDEO_THREADED)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_settings,                      MENU_ENUM_SUBLABEL_SETTINGS)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_config_save_on_exit,           MENU_ENUM_SUBLABEL_CONFIG_SAVE_ON_EXIT)
@@ -540,6 +543,7 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_configuration_settings_list,   MENU_
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_configurations_list_list,      MENU_ENUM_SUBLABEL_CONFIGURATIONS_LIST)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_video_shared_context,          MENU_ENUM_SUBLABEL_VIDEO_SHARED_CONTEXT)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_driver_switch_enable,          MENU_ENUM_SUBLABEL_DRIVER_SWITCH_ENABLE)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_content_switch_seamless,       MENU_ENUM_SUBLABEL_CONTENT_SWITCH_SEAMLESS)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_audio_latency,                 MENU_ENUM_SUBLABEL_AUDIO_LATENCY)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_audio_rate_control_delta,      MENU_ENUM_SUBLABEL_AUDIO_RATE_CONTROL_DELTA)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_audio_mute,                    MENU_ENUM_SUBLABEL_AUDIO_MUTE)
@@ -556,6 +560,7 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_camera_allow,                  MENU_
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_location_allow,                MENU_ENUM_SUBLABEL_LOCATION_ALLOW)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_input_max_users,               MENU_ENUM_SUBLABEL_INPUT_MAX_USERS)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_input_poll_type_behavior,      MENU_ENUM_SUBLABEL_INPUT_POLL_TYPE_BEHAVIOR)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_input_joypad_thread,           MENU_ENUM_SUBLABEL_INPUT_JOYPAD_THREAD)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_input_bind_timeout,            MENU_ENUM_SUBLABEL_INPUT_BIND_TIMEOUT)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_input_bind_hold,               MENU_ENUM_SUBLABEL_INPUT_BIND_HOLD)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_audio_volume,                  MENU_ENUM_SUBLABEL_AUDIO_VOLUME)
@@ -595,6 +600,7 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_core_allow_rotate,             MENU_
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_dummy_on_core_shutdown,        MENU_ENUM_SUBLABEL_DUMMY_ON_CORE_SHUTDOWN)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_core_option_category_enable,   MENU_ENUM_SUBLABEL_CORE_OPTION_CATEGORY_ENABLE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_core_info_cache_enable,        MENU_ENUM_SUBLABEL_CORE_INFO_CACHE_ENABLE)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_content_patch_cache_enable,    MENU_ENUM_SUBLABEL_CONTENT_PATCH_CACHE_ENABLE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_core_info_savestate_bypass,    MENU_ENUM_SUBLABEL_CORE_INFO_SAVESTATE_BYPASS)
 #ifndef HAVE_DYNAMIC
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_always_reload_core_on_run_content, MENU_ENUM_SUBLABEL_ALWAYS_RELOAD_CORE_ON_RUN_CONTENT)
@@ -757,6 +763,7 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_replay_auto_index,             MENU_
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_block_sram_overwrite,          MENU_ENUM_SUBLABEL_BLOCK_SRAM_OVERWRITE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_fastforward_ratio,             MENU_ENUM_SUBLABEL_FASTFORWARD_RATIO)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_fastforward_frameskip,         MENU_ENUM_SUBLABEL_FASTFORWARD_FRAMESKIP)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_fastforward_frame_batch,       MENU_ENUM_SUBLABEL_FASTFORWARD_FRAME_BATCH)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_vrr_runloop_enable,            MENU_ENUM_SUBLABEL_VRR_RUNLOOP_ENABLE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_menu_throttle_framerate,       MENU_ENUM_SUBLABEL_MENU_ENUM_THROTTLE_FRAMERATE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_slowmotion_ratio,              MENU_ENUM_SUBLABEL_SLOWMOTION_RATIO)
@@ -767,6 +774,9 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_runahead_mode,                 MENU_
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_runahead_mode,                 MENU_ENUM_SUBLABEL_RUNAHEAD_MODE_NO_SECOND_INSTANCE)
 #endif
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_run_ahead_hide_warnings,       MENU_ENUM_SUBLABEL_RUN_AHEAD_HIDE_WARNINGS)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_run_ahead_secondary_thread,    MENU_ENUM_SUBLABEL_RUN_AHEAD_SECONDARY_THREAD)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_input_predictor,               MENU_ENUM_SUBLABEL_INPUT_PREDICTOR)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_latency_test,                  MENU_ENUM_SUBLABEL_LATENCY_TEST)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_run_ahead_frames,              MENU_ENUM_SUBLABEL_RUN_AHEAD_FRAMES)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_preempt_frames,                MENU_ENUM_SUBLABEL_PREEMPT_FRAMES)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_input_block_timeout,           MENU_ENUM_SUBLABEL_INPUT_BLOCK_TIMEOUT)
@@ -812,9 +822,11 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_cheat_file_save_as,            MENU_
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_rewind_granularity,            MENU_ENUM_SUBLABEL_REWIND_GRANULARITY)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_rewind_buffer_size,            MENU_ENUM_SUBLABEL_REWIND_BUFFER_SIZE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_rewind_buffer_size_step,       MENU_ENUM_SUBLABEL_REWIND_BUFFER_SIZE_STEP)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_rewind_disk_buffer_size,       MENU_ENUM_SUBLABEL_REWIND_DISK_BUFFER_SIZE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_libretro_log_level,            MENU_ENUM_SUBLABEL_LIBRETRO_LOG_LEVEL)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_frontend_log_level,            MENU_ENUM_SUBLABEL_FRONTEND_LOG_LEVEL)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_perfcnt_enable,                MENU_ENUM_SUBLABEL_PERFCNT_ENABLE)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_frame_timeline_enable,         MENU_ENUM_SUBLABEL_FRAME_TIMELINE_ENABLE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_savestate_auto_save,           MENU_ENUM_SUBLABEL_SAVESTATE_AUTO_SAVE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_savestate_auto_load,           MENU_ENUM_SUBLABEL_SAVESTATE_AUTO_LOAD)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_savestate_thumbnail_enable,    MENU_ENUM_SUBLABEL_SAVESTATE_THUMBNAIL_ENABLE)
@@ -825,6 +837,7 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_autosave_interval,             MENU_
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_replay_max_keep,               MENU_ENUM_SUBLABEL_REPLAY_MAX_KEEP)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_replay_checkpoint_interval,    MENU_ENUM_SUBLABEL_REPLAY_CHECKPOINT_INTERVAL)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_replay_checkpoint_deserialize, MENU_ENUM_SUBLABEL_REPLAY_CHECKPOINT_DESERIALIZE)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_replay_checkpoint_flush, MENU_ENUM_SUBLABEL_REPLAY_CHECKPOINT_FLUSH)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_input_remap_binds_enable,      MENU_ENUM_SUBLABEL_INPUT_REMAP_BINDS_ENABLE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_input_remap_sort_by_controller_enable,      MENU_ENUM_SUBLABEL_INPUT_REMAP_SORT_BY_CONTROLLER_ENABLE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_input_autodetect_enable,       MENU_ENUM_SUBLABEL_INPUT_AUTODETECT_ENABLE)
@@ -1011,6 +1024,7 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_core_updater_auto_extract_archive,
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_core_updater_show_experimental_cores,  MENU_ENUM_SUBLABEL_CORE_UPDATER_SHOW_EXPERIMENTAL_CORES)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_core_updater_auto_backup,              MENU_ENUM_SUBLABEL_CORE_UPDATER_AUTO_BACKUP)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_core_updater_auto_backup_history_size, MENU_ENUM_SUBLABEL_CORE_UPDATER_AUTO_BACKUP_HISTORY_SIZE)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_network_http_concurrent_downloads,   MENU_ENUM_SUBLABEL_NETWORK_HTTP_CONCURRENT_DOWNLOADS)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_refresh_rooms,                 MENU_ENUM_SUBLABEL_NETPLAY_REFRESH_ROOMS)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_refresh_lan,                   MENU_ENUM_SUBLABEL_NETPLAY_REFRESH_LAN)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_rename_entry,                          MENU_ENUM_SUBLABEL_RENAME_ENTRY)
@@ -1091,6 +1105,7 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_core_options_reset,
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_core_options_flush,                    MENU_ENUM_SUBLABEL_CORE_OPTIONS_FLUSH)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_show_advanced_settings,                MENU_ENUM_SUBLABEL_SHOW_ADVANCED_SETTINGS)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_threaded_data_runloop_enable,          MENU_ENUM_SUBLABEL_THREADED_DATA_RUNLOOP_ENABLE)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_threaded_data_runloop_workers,         MENU_ENUM_SUBLABEL_THREADED_DATA_RUNLOOP_WORKERS)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_playlist_entry_rename,                 MENU_ENUM_SUBLABEL_PLAYLIST_ENTRY_RENAME)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_playlist_entry_remove,                 MENU_ENUM_SUBLABEL_PLAYLIST_ENTRY_REMOVE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_system_directory,                      MENU_ENUM_SUBLABEL_SYSTEM_DIRECTORY)
@@ -1261,6 +1276,7 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_shader_options,
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_shader_apply_changes,                  MENU_ENUM_SUBLABEL_SHADER_APPLY_CHANGES)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_shader_watch_for_changes,              MENU_ENUM_SUBLABEL_SHADER_WATCH_FOR_CHANGES)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_video_shader_remember_last_dir,        MENU_ENUM_SUBLABEL_VIDEO_SHADER_REMEMBER_LAST_DIR)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_video_shader_cache_enable,             MENU_ENUM_SUBLABEL_VIDEO_SHADER_CACHE_ENABLE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_shader_num_passes,                     MENU_ENUM_SUBLABEL_VIDEO_SHADER_NUM_PASSES)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_shader_preset,                         MENU_ENUM_SUBLABEL_VIDEO_SHADER_PRESET)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_shader_preset_prepend,                 MENU_ENUM_SUBLABEL_VIDEO_SHADER_PRESET_PREPEND)
@@ -1324,7 +1340,14 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_ggpo_disconnect_notify_start
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_ggpo_lz4_accel,                 MENU_ENUM_SUBLABEL_NETPLAY_GGPO_LZ4_ACCEL)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_ggpo_send_interval,            MENU_ENUM_SUBLABEL_NETPLAY_GGPO_SEND_INTERVAL)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_ggpo_max_input_bits,           MENU_ENUM_SUBLABEL_NETPLAY_GGPO_MAX_INPUT_BITS)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_ggpo_input_fec,                MENU_ENUM_SUBLABEL_NETPLAY_GGPO_INPUT_FEC)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_ggpo_drift_correction,         MENU_ENUM_SUBLABEL_NETPLAY_GGPO_DRIFT_CORRECTION)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_ggpo_prediction_frames,        MENU_ENUM_SUBLABEL_NETPLAY_GGPO_PREDICTION_FRAMES)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_ggpo_keyframe_interval,        MENU_ENUM_SUBLABEL_NETPLAY_GGPO_KEYFRAME_INTERVAL)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_ggpo_checksum_interval,        MENU_ENUM_SUBLABEL_NETPLAY_GGPO_CHECKSUM_INTERVAL)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_ggpo_replay_crossfade,         MENU_ENUM_SUBLABEL_NETPLAY_GGPO_REPLAY_CROSSFADE)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_ggpo_audio_splice_frames,      MENU_ENUM_SUBLABEL_NETPLAY_GGPO_AUDIO_SPLICE_FRAMES)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_ggpo_network_thread,           MENU_ENUM_SUBLABEL_NETPLAY_GGPO_NETWORK_THREAD)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_ggpo_network_delay,            MENU_ENUM_SUBLABEL_NETPLAY_GGPO_NETWORK_DELAY)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_ggpo_oop_percent,              MENU_ENUM_SUBLABEL_NETPLAY_GGPO_OOP_PERCENT)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_core_lock,                             MENU_ENUM_SUBLABEL_CORE_LOCK)
@@ -2826,6 +2849,9 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_VIDEO_SHADER_REMEMBER_LAST_DIR:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_video_shader_remember_last_dir);
             break;
+         case MENU_ENUM_LABEL_VIDEO_SHADER_CACHE_ENABLE:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_video_shader_cache_enable);
+            break;
          case MENU_ENUM_LABEL_VIDEO_FONT_PATH:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_video_font_path);
             break;
@@ -3457,6 +3483,9 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_THREADED_DATA_RUNLOOP_ENABLE:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_threaded_data_runloop_enable);
             break;
+         case MENU_ENUM_LABEL_THREADED_DATA_RUNLOOP_WORKERS:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_threaded_data_runloop_workers);
+            break;
          case MENU_ENUM_LABEL_SHOW_ADVANCED_SETTINGS:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_show_advanced_settings);
             break;
@@ -3725,6 +3754,9 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_CORE_UPDATER_AUTO_BACKUP_HISTORY_SIZE:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_core_updater_auto_backup_history_size);
             break;
+         case MENU_ENUM_LABEL_NETWORK_HTTP_CONCURRENT_DOWNLOADS:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_network_http_concurrent_downloads);
+            break;
          case MENU_ENUM_LABEL_CORE_UPDATER_BUILDBOT_URL:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_core_updater_buildbot_url);
             break;
@@ -4194,6 +4226,9 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_REPLAY_CHECKPOINT_DESERIALIZE:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_replay_checkpoint_deserialize);
             break;
+         case MENU_ENUM_LABEL_REPLAY_CHECKPOINT_FLUSH:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_replay_checkpoint_flush);
+            break;
          case MENU_ENUM_LABEL_SAVESTATE_MAX_KEEP:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_savestate_max_keep);
             break;
@@ -4218,6 +4253,9 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_PERFCNT_ENABLE:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_perfcnt_enable);
             break;
+         case MENU_ENUM_LABEL_FRAME_TIMELINE_ENABLE:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_frame_timeline_enable);
+            break;
          case MENU_ENUM_LABEL_FRONTEND_LOG_LEVEL:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_frontend_log_level);
             break;
@@ -4241,6 +4279,9 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_REWIND_BUFFER_SIZE_STEP:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_rewind_buffer_size_step);
             break;
+         case MENU_ENUM_LABEL_REWIND_DISK_BUFFER_SIZE:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_rewind_disk_buffer_size);
+            break;
          case MENU_ENUM_LABEL_CHEAT_IDX:
 #ifdef HAVE_CHEATS
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_cheat_idx);
@@ -4373,6 +4414,15 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_RUN_AHEAD_HIDE_WARNINGS:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_run_ahead_hide_warnings);
             break;
+         case MENU_ENUM_LABEL_RUN_AHEAD_SECONDARY_THREAD:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_run_ahead_secondary_thread);
+            break;
+         case MENU_ENUM_LABEL_INPUT_PREDICTOR:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_input_predictor);
+            break;
+         case MENU_ENUM_LABEL_LATENCY_TEST:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_latency_test);
+            break;
          case MENU_ENUM_LABEL_RUN_AHEAD_FRAMES:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_run_ahead_frames);
             break;
@@ -4388,6 +4438,9 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_FASTFORWARD_FRAMESKIP:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_fastforward_frameskip);
             break;
+         case MENU_ENUM_LABEL_FASTFORWARD_FRAME_BATCH:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_fastforward_frame_batch);
+            break;
          case MENU_ENUM_LABEL_VRR_RUNLOOP_ENABLE:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_vrr_runloop_enable);
             break;
@@ -4746,6 +4799,9 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_CORE_INFO_CACHE_ENABLE:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_core_info_cache_enable);
             break;
+         case MENU_ENUM_LABEL_CONTENT_PATCH_CACHE_ENABLE:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_content_patch_cache_enable);
+            break;
          case MENU_ENUM_LABEL_CORE_INFO_SAVESTATE_BYPASS:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_core_info_savestate_bypass);
             break;
@@ -4847,6 +4903,9 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_INPUT_POLL_TYPE_BEHAVIOR:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_input_poll_type_behavior);
             break;
+         case MENU_ENUM_LABEL_INPUT_JOYPAD_THREAD:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_input_joypad_thread);
+            break;
          case MENU_ENUM_LABEL_INPUT_MAX_USERS:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_input_max_users);
             break;
@@ -4887,6 +4946,9 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_DRIVER_SWITCH_ENABLE:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_driver_switch_enable);
             break;
+         case MENU_ENUM_LABEL_CONTENT_SWITCH_SEAMLESS:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_content_switch_seamless);
+            break;
          case MENU_ENUM_LABEL_VIDEO_SHARED_CONTEXT:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_video_shared_context);
             break;
@@ -4964,6 +5026,9 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_CHEEVOS_START_ACTIVE:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_cheevos_start_active);
             break;
+         case MENU_ENUM_LABEL_CHEEVOS_THREADED:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_cheevos_threaded);
+            break;
          case MENU_ENUM_LABEL_CHEEVOS_APPEARANCE_SETTINGS:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_cheevos_appearance_settings);
             break;
@@ -5034,6 +5099,9 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_VIDEO_HARD_SYNC_FRAMES:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_video_hard_sync_frames);
             break;
+         case MENU_ENUM_LABEL_VIDEO_KMS_DIRECT_SCANOUT:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_video_kms_direct_scanout);
+            break;
          case MENU_ENUM_LABEL_VIDEO_REFRESH_RATE_AUTO:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_video_refresh_rate_auto);
             break;
@@ -5339,6 +5407,9 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_PLAYLIST_MANAGER_CLEAN_PLAYLIST:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_playlist_manager_clean_playlist);
             break;
+         case MENU_ENUM_LABEL_PLAYLIST_MANAGER_BUILD_THUMBNAIL_PACK:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_playlist_manager_build_thumbnail_pack);
+            break;
          case MENU_ENUM_LABEL_PLAYLIST_MANAGER_REFRESH_PLAYLIST:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_playlist_manager_refresh_playlist);
             break;
@@ -5616,9 +5687,30 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_NETPLAY_GGPO_MAX_INPUT_BITS:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_netplay_ggpo_max_input_bits);
             break;
+         case MENU_ENUM_LABEL_NETPLAY_GGPO_INPUT_FEC:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_netplay_ggpo_input_fec);
+            break;
+         case MENU_ENUM_LABEL_NETPLAY_GGPO_DRIFT_CORRECTION:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_netplay_ggpo_drift_correction);
+            break;
          case MENU_ENUM_LABEL_NETPLAY_GGPO_PREDICTION_FRAMES:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_netplay_ggpo_prediction_frames);
             break;
+         case MENU_ENUM_LABEL_NETPLAY_GGPO_KEYFRAME_INTERVAL:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_netplay_ggpo_keyframe_interval);
+            break;
+         case MENU_ENUM_LABEL_NETPLAY_GGPO_CHECKSUM_INTERVAL:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_netplay_ggpo_checksum_interval);
+            break;
+         case MENU_ENUM_LABEL_NETPLAY_GGPO_REPLAY_CROSSFADE:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_netplay_ggpo_replay_crossfade);
+            break;
+         case MENU_ENUM_LABEL_NETPLAY_GGPO_AUDIO_SPLICE_FRAMES:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_netplay_ggpo_audio_splice_frames);
+            break;
+         case MENU_ENUM_LABEL_NETPLAY_GGPO_NETWORK_THREAD:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_netplay_ggpo_network_thread);
+            break;
          case MENU_ENUM_LABEL_NETPLAY_GGPO_NETWORK_DELAY:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_netplay_ggpo_network_delay);
             break;
@@ -9885,6 +9885,10 @@ static int materialui_environ(enum menu_environ_cb type, void *data,
       case MENU_ENVIRON_DISABLE_SCREENSAVER:
          mui->flags &= ~MUI_FLAG_SHOW_SCREENSAVER;
          break;
+      case MENU_ENVIRON_IS_STATIC:
+         if (mui->flags & MUI_FLAG_SHOW_SCREENSAVER)
+            return -1;
+         break;
       default:
          return -1;
    }
@@ -2281,6 +2281,7 @@ static uintptr_t ozone_entries_icon_get_texture(
       case MENU_ENUM_LABEL_CLOUD_SYNC_SYNC_NOW:
       case MENU_ENUM_LABEL_FRAME_TIME_COUNTER_SETTINGS:
       case MENU_ENUM_LABEL_PLAYLIST_MANAGER_CLEAN_PLAYLIST:
+      case MENU_ENUM_LABEL_PLAYLIST_MANAGER_BUILD_THUMBNAIL_PACK:
       case MENU_ENUM_LABEL_PLAYLIST_MANAGER_REFRESH_PLAYLIST:
       case MENU_ENUM_LABEL_CLOUD_SYNC_SETTINGS:
             return ozone->icons_textures[OZONE_ENTRIES_ICONS_TEXTURE_RELOAD];
@@ -10791,7 +10792,16 @@ static void ozone_render(void *data,
 
             if (     (ozone->thumbnails.right.status != GFX_THUMBNAIL_STATUS_UNKNOWN)
                   && (ozone->thumbnails.left.status  != GFX_THUMBNAIL_STATUS_UNKNOWN))
+            {
                ozone->thumbnails.pending = OZONE_PENDING_THUMBNAIL_NONE;
+
+               /* Have the next entries ready when scrolling on */
+               if (!(ozone->flags & OZONE_FLAG_IS_EXPLORE_LIST))
+                  gfx_thumbnail_prefetch(
+                        menu_st->thumbnail_path_data,
+                        playlist, selection,
+                        gfx_thumbnail_upscale_threshold);
+            }
             break;
          case OZONE_PENDING_THUMBNAIL_RIGHT:
             gfx_thumbnail_request_stream(
@@ -13163,6 +13173,10 @@ static int ozone_environ_cb(enum menu_environ_cb type, void *data, void *userdat
       case MENU_ENVIRON_DISABLE_SCREENSAVER:
          ozone->flags &= ~OZONE_FLAG_SHOW_SCREENSAVER;
          break;
+      case MENU_ENVIRON_IS_STATIC:
+         if (ozone->flags & OZONE_FLAG_SHOW_SCREENSAVER)
+            return -1;
+         break;
       default:
          return -1;
    }
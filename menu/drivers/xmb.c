@@ -3118,6 +3118,14 @@ static int xmb_environ(enum menu_environ_cb type, void *data, void *userdata)
       case MENU_ENVIRON_DISABLE_SCREENSAVER:
          xmb->show_screensaver = false;
          break;
+      case MENU_ENVIRON_IS_STATIC:
+         /* The ribbon and particle backgrounds move
+          * all the time */
+         if (     xmb->show_screensaver
+               || (config_get_ptr()->uints.menu_xmb_shader_pipeline
+                  > XMB_SHADER_PIPELINE_WALLPAPER))
+            return -1;
+         break;
       default:
          return -1;
    }
@@ -3543,6 +3551,7 @@ static uintptr_t xmb_icon_get_id(xmb_handle_t *xmb,
       case MENU_ENUM_LABEL_CLOUD_SYNC_SYNC_NOW:
       case MENU_ENUM_LABEL_FRAME_TIME_COUNTER_SETTINGS:
       case MENU_ENUM_LABEL_PLAYLIST_MANAGER_CLEAN_PLAYLIST:
+      case MENU_ENUM_LABEL_PLAYLIST_MANAGER_BUILD_THUMBNAIL_PACK:
       case MENU_ENUM_LABEL_PLAYLIST_MANAGER_REFRESH_PLAYLIST:
       case MENU_ENUM_LABEL_CLOUD_SYNC_SETTINGS:
          return xmb->textures.list[XMB_TEXTURE_RELOAD];
@@ -3817,6 +3826,7 @@ static uintptr_t xmb_icon_get_id(xmb_handle_t *xmb,
       case MENU_ENUM_LABEL_FRAME_THROTTLE_SETTINGS:
       case MENU_ENUM_LABEL_SETTINGS_SHOW_FRAME_THROTTLE:
       case MENU_ENUM_LABEL_FASTFORWARD_FRAMESKIP:
+      case MENU_ENUM_LABEL_FASTFORWARD_FRAME_BATCH:
          return xmb->textures.list[XMB_TEXTURE_FRAMESKIP];
       case MENU_ENUM_LABEL_QUICK_MENU_START_RECORDING:
       case MENU_ENUM_LABEL_QUICK_MENU_SHOW_START_RECORDING:
@@ -4344,6 +4354,7 @@ static bool xmb_animation_line_ticker(gfx_animation_t *p_anim, gfx_animation_ctx
 {
    char *wrapped_str            = NULL;
    size_t wrapped_str_len       = 0;
+   memarena_t *scratch          = video_driver_frame_scratch();
    size_t line_ticker_str_len   = 0;
    struct string_list lines     = {0};
    size_t line_offset           = 0;
@@ -4362,7 +4373,7 @@ static bool xmb_animation_line_ticker(gfx_animation_t *p_anim, gfx_animation_ctx
    /* Line wrap input string */
    line_ticker_str_len = strlen(line_ticker->str);
    wrapped_str_len     = line_ticker_str_len + 1 + 10; /* 10 bytes use for inserting '\n' */
-   if (!(wrapped_str   = (char*)malloc(wrapped_str_len)))
+   if (!(wrapped_str   = (char*)memarena_alloc(scratch, wrapped_str_len)))
       goto end;
    wrapped_str[0] = '\0';
 
@@ -4424,7 +4435,7 @@ end:
 
    if (wrapped_str)
    {
-      free(wrapped_str);
+      memarena_release(scratch, wrapped_str);
       wrapped_str = NULL;
    }
 
@@ -4635,6 +4646,7 @@ static bool xmb_animation_line_ticker_smooth(gfx_animation_t *p_anim, gfx_animat
 {
    char *wrapped_str              = NULL;
    const char *wideglyph_str      = NULL;
+   memarena_t *scratch            = video_driver_frame_scratch();
    size_t line_ticker_src_len     = 0;
    size_t wrapped_str_len         = 0;
    struct string_list lines       = {0};
@@ -4706,7 +4718,7 @@ static bool xmb_animation_line_ticker_smooth(gfx_animation_t *p_anim, gfx_animat
    line_ticker_src_len = strlen(line_ticker->src_str);
    /* 10 bytes use for inserting '\n' */
    wrapped_str_len     = line_ticker_src_len + 1 + 10;
-   if (!(wrapped_str   = (char*)malloc(wrapped_str_len)))
+   if (!(wrapped_str   = (char*)memarena_alloc(scratch, wrapped_str_len)))
       goto end;
    wrapped_str[0] = '\0';
 
@@ -4816,7 +4828,7 @@ end:
 
    if (wrapped_str)
    {
-      free(wrapped_str);
+      memarena_release(scratch, wrapped_str);
       wrapped_str = NULL;
    }
 
@@ -7223,7 +7235,16 @@ static void xmb_render(void *data,
 
             if (     xmb->thumbnails.right.status != GFX_THUMBNAIL_STATUS_UNKNOWN
                   && xmb->thumbnails.left.status  != GFX_THUMBNAIL_STATUS_UNKNOWN)
+            {
                xmb->thumbnails.pending = XMB_PENDING_THUMBNAIL_NONE;
+
+               /* Have the next entries ready when scrolling on */
+               if (!xmb->is_explore_list)
+                  gfx_thumbnail_prefetch(
+                        menu_st->thumbnail_path_data,
+                        playlist, selection,
+                        gfx_thumbnail_upscale_threshold);
+            }
             break;
          case XMB_PENDING_THUMBNAIL_RIGHT:
             gfx_thumbnail_request_stream(
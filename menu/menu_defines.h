@@ -106,6 +106,10 @@ enum menu_environ_cb
    MENU_ENVIRON_DISABLE_MOUSE_CURSOR,
    MENU_ENVIRON_ENABLE_SCREENSAVER,
    MENU_ENVIRON_DISABLE_SCREENSAVER,
+   /* Returns 0 if the driver draws nothing that moves
+    * on its own, so that an unchanged menu need not be
+    * drawn again */
+   MENU_ENVIRON_IS_STATIC,
    MENU_ENVIRON_LAST
 };
 
@@ -5120,6 +5120,13 @@ static bool menu_displaylist_parse_playlist_manager_settings(
          MENU_ENUM_LABEL_PLAYLIST_MANAGER_CLEAN_PLAYLIST,
          MENU_SETTING_ACTION_PLAYLIST_MANAGER_CLEAN_PLAYLIST, 0, 0, NULL);
 
+   /* Build thumbnail pack */
+   menu_entries_append(list,
+         msg_hash_to_str(MENU_ENUM_LABEL_VALUE_PLAYLIST_MANAGER_BUILD_THUMBNAIL_PACK),
+         msg_hash_to_str(MENU_ENUM_LABEL_PLAYLIST_MANAGER_BUILD_THUMBNAIL_PACK),
+         MENU_ENUM_LABEL_PLAYLIST_MANAGER_BUILD_THUMBNAIL_PACK,
+         MENU_SETTING_ACTION_PLAYLIST_MANAGER_BUILD_THUMBNAIL_PACK, 0, 0, NULL);
+
    /* Delete playlist */
    menu_entries_append(list,
          msg_hash_to_str(MENU_ENUM_LABEL_VALUE_DELETE_PLAYLIST),
@@ -7604,6 +7611,13 @@ unsigned menu_displaylist_build_list(
                      0, 0, 0, NULL))
                count++;
 
+#if defined(HAVE_SLANG)
+            if (MENU_DISPLAYLIST_PARSE_SETTINGS_ENUM(list,
+                     MENU_ENUM_LABEL_VIDEO_SHADER_CACHE_ENABLE,
+                     PARSE_ONLY_BOOL, false) == 0)
+               count++;
+#endif
+
             if (MENU_DISPLAYLIST_PARSE_SETTINGS_ENUM(list,
                      MENU_ENUM_LABEL_VIDEO_SHADER_PRESET_SAVE_REFERENCE,
                      PARSE_ONLY_BOOL, false) == 0)
@@ -8345,6 +8359,9 @@ unsigned menu_displaylist_build_list(
                {MENU_ENUM_LABEL_INPUT_BLOCK_TIMEOUT,                   PARSE_ONLY_UINT,  true},
 #endif
                {MENU_ENUM_LABEL_INPUT_POLL_TYPE_BEHAVIOR,              PARSE_ONLY_UINT,  true},
+#ifdef HAVE_THREADS
+               {MENU_ENUM_LABEL_INPUT_JOYPAD_THREAD,                   PARSE_ONLY_BOOL,  true},
+#endif
                {MENU_ENUM_LABEL_INPUT_DRIVER,                          PARSE_ONLY_STRING_OPTIONS, true},
                {MENU_ENUM_LABEL_JOYPAD_DRIVER,                         PARSE_ONLY_STRING_OPTIONS, true},
             };
@@ -9210,7 +9227,14 @@ unsigned menu_displaylist_build_list(
                {MENU_ENUM_LABEL_NETPLAY_GGPO_LZ4_ACCEL,             PARSE_ONLY_UINT,   true},
                {MENU_ENUM_LABEL_NETPLAY_GGPO_SEND_INTERVAL,         PARSE_ONLY_UINT,   true},
                {MENU_ENUM_LABEL_NETPLAY_GGPO_MAX_INPUT_BITS,        PARSE_ONLY_UINT,   true},
+               {MENU_ENUM_LABEL_NETPLAY_GGPO_INPUT_FEC,             PARSE_ONLY_UINT,   true},
+               {MENU_ENUM_LABEL_NETPLAY_GGPO_DRIFT_CORRECTION,      PARSE_ONLY_UINT,   true},
                {MENU_ENUM_LABEL_NETPLAY_GGPO_PREDICTION_FRAMES,     PARSE_ONLY_UINT,   true},
+               {MENU_ENUM_LABEL_NETPLAY_GGPO_KEYFRAME_INTERVAL,     PARSE_ONLY_UINT,   true},
+               {MENU_ENUM_LABEL_NETPLAY_GGPO_CHECKSUM_INTERVAL,     PARSE_ONLY_UINT,   true},
+               {MENU_ENUM_LABEL_NETPLAY_GGPO_REPLAY_CROSSFADE,      PARSE_ONLY_BOOL,   true},
+               {MENU_ENUM_LABEL_NETPLAY_GGPO_AUDIO_SPLICE_FRAMES,   PARSE_ONLY_UINT,   true},
+               {MENU_ENUM_LABEL_NETPLAY_GGPO_NETWORK_THREAD,        PARSE_ONLY_BOOL,   true},
                {MENU_ENUM_LABEL_NETPLAY_GGPO_NETWORK_DELAY,         PARSE_ONLY_UINT,   true},
                {MENU_ENUM_LABEL_NETPLAY_GGPO_OOP_PERCENT,           PARSE_ONLY_UINT,   true},
                {MENU_ENUM_LABEL_NETPLAY_NAT_TRAVERSAL,              PARSE_ONLY_BOOL,   true},
@@ -9599,6 +9623,9 @@ unsigned menu_displaylist_build_list(
                {MENU_ENUM_LABEL_CHEEVOS_AUTO_SCREENSHOT,                               PARSE_ONLY_BOOL,   false  },
 #endif
                {MENU_ENUM_LABEL_CHEEVOS_START_ACTIVE,                                  PARSE_ONLY_BOOL,   false  },
+#ifdef HAVE_THREADS
+               {MENU_ENUM_LABEL_CHEEVOS_THREADED,                                      PARSE_ONLY_BOOL,   false  },
+#endif
             };
 
             for (i = 0; i < ARRAY_SIZE(build_list); i++)
@@ -9740,6 +9767,7 @@ unsigned menu_displaylist_build_list(
                {MENU_ENUM_LABEL_MOUSE_ENABLE,                                          PARSE_ONLY_BOOL,   true},
                {MENU_ENUM_LABEL_POINTER_ENABLE,                                        PARSE_ONLY_BOOL,   true},
                {MENU_ENUM_LABEL_THREADED_DATA_RUNLOOP_ENABLE,                          PARSE_ONLY_BOOL,   true},
+               {MENU_ENUM_LABEL_THREADED_DATA_RUNLOOP_WORKERS,                         PARSE_ONLY_UINT,   true},
                {MENU_ENUM_LABEL_MENU_SCREENSAVER_TIMEOUT,                              PARSE_ONLY_UINT,   false},
                {MENU_ENUM_LABEL_MENU_SCREENSAVER_ANIMATION,                            PARSE_ONLY_UINT,   false},
                {MENU_ENUM_LABEL_MENU_SCREENSAVER_ANIMATION_SPEED,                      PARSE_ONLY_FLOAT,  false},
@@ -10113,6 +10141,13 @@ unsigned menu_displaylist_build_list(
                   count++;
             }
 
+#ifdef HAVE_KMS
+            if (MENU_DISPLAYLIST_PARSE_SETTINGS_ENUM(list,
+                     MENU_ENUM_LABEL_VIDEO_KMS_DIRECT_SCANOUT,
+                     PARSE_ONLY_BOOL, false) == 0)
+               count++;
+#endif
+
             if (video_driver_test_all_flags(GFX_CTX_FLAGS_CUSTOMIZABLE_FRAME_LATENCY))
             {
                if (MENU_DISPLAYLIST_PARSE_SETTINGS_ENUM(list,
@@ -10675,8 +10710,12 @@ unsigned menu_displaylist_build_list(
                {MENU_ENUM_LABEL_RUNAHEAD_MODE,                         PARSE_ONLY_UINT, false },
                {MENU_ENUM_LABEL_RUN_AHEAD_FRAMES,                      PARSE_ONLY_UINT, false },
                {MENU_ENUM_LABEL_PREEMPT_FRAMES,                        PARSE_ONLY_UINT, false },
+#if defined(HAVE_THREADS) && (defined(HAVE_DYNAMIC) || defined(HAVE_DYLIB))
+               {MENU_ENUM_LABEL_RUN_AHEAD_SECONDARY_THREAD,            PARSE_ONLY_BOOL, false },
+#endif
                {MENU_ENUM_LABEL_RUN_AHEAD_HIDE_WARNINGS,               PARSE_ONLY_BOOL, false },
 #endif
+               {MENU_ENUM_LABEL_INPUT_PREDICTOR,                       PARSE_ONLY_UINT, true },
                {MENU_ENUM_LABEL_AUDIO_LATENCY,                         PARSE_ONLY_UINT, true },
 #ifdef HAVE_MICROPHONE
                {MENU_ENUM_LABEL_MICROPHONE_LATENCY,                    PARSE_ONLY_UINT, true },
@@ -10743,6 +10782,11 @@ unsigned menu_displaylist_build_list(
                         if (preempt_enabled)
                            build_list[i].checked = true;
                         break;
+                     case MENU_ENUM_LABEL_RUN_AHEAD_SECONDARY_THREAD:
+                        if (     runahead_enabled
+                              && settings->bools.run_ahead_secondary_instance)
+                           build_list[i].checked = true;
+                        break;
                      case MENU_ENUM_LABEL_RUN_AHEAD_HIDE_WARNINGS:
                         if (runahead_enabled || preempt_enabled)
                            build_list[i].checked = true;
@@ -10778,6 +10822,11 @@ unsigned menu_displaylist_build_list(
                      MENU_ENUM_LABEL_GAMEMODE_ENABLE, PARSE_ONLY_BOOL, false) == 0)
                count++;
 #endif /*HAVE_LAKKA?*/
+
+            if (flags & RUNLOOP_FLAG_CORE_RUNNING)
+               if (MENU_DISPLAYLIST_PARSE_SETTINGS_ENUM(list,
+                        MENU_ENUM_LABEL_LATENCY_TEST, PARSE_ACTION, false) == 0)
+                  count++;
          }
          break;
       case DISPLAYLIST_ONSCREEN_NOTIFICATIONS_SETTINGS_LIST:
@@ -11086,6 +11135,7 @@ unsigned menu_displaylist_build_list(
                {MENU_ENUM_LABEL_REPLAY_MAX_KEEP,                    PARSE_ONLY_UINT, false},
                {MENU_ENUM_LABEL_REPLAY_CHECKPOINT_INTERVAL,         PARSE_ONLY_UINT, true},
                {MENU_ENUM_LABEL_REPLAY_CHECKPOINT_DESERIALIZE,      PARSE_ONLY_BOOL, true},
+               {MENU_ENUM_LABEL_REPLAY_CHECKPOINT_FLUSH,            PARSE_ONLY_BOOL, true},
                {MENU_ENUM_LABEL_CONTENT_RUNTIME_LOG,                PARSE_ONLY_BOOL, true},
                {MENU_ENUM_LABEL_CONTENT_RUNTIME_LOG_AGGREGATE,      PARSE_ONLY_BOOL, true},
 #if HAVE_CLOUDSYNC
@@ -11393,6 +11443,7 @@ unsigned menu_displaylist_build_list(
                {MENU_ENUM_LABEL_CORE_UPDATER_BUILDBOT_URL,             PARSE_ONLY_STRING},
                {MENU_ENUM_LABEL_BUILDBOT_ASSETS_URL,                   PARSE_ONLY_STRING},
                {MENU_ENUM_LABEL_CORE_UPDATER_AUTO_EXTRACT_ARCHIVE,     PARSE_ONLY_BOOL},
+               {MENU_ENUM_LABEL_NETWORK_HTTP_CONCURRENT_DOWNLOADS,     PARSE_ONLY_UINT},
                {MENU_ENUM_LABEL_CORE_UPDATER_SHOW_EXPERIMENTAL_CORES,  PARSE_ONLY_BOOL},
                {MENU_ENUM_LABEL_CORE_UPDATER_AUTO_BACKUP,              PARSE_ONLY_BOOL},
                {MENU_ENUM_LABEL_CORE_UPDATER_AUTO_BACKUP_HISTORY_SIZE, PARSE_ONLY_UINT},
@@ -11561,9 +11612,11 @@ unsigned menu_displaylist_build_list(
             static const menu_displaylist_build_info_t build_list[] = {
                {MENU_ENUM_LABEL_CORE_INFO_CACHE_ENABLE,            PARSE_ONLY_BOOL},
                {MENU_ENUM_LABEL_CORE_INFO_SAVESTATE_BYPASS,        PARSE_ONLY_BOOL},
+               {MENU_ENUM_LABEL_CONTENT_PATCH_CACHE_ENABLE,        PARSE_ONLY_BOOL},
                {MENU_ENUM_LABEL_SYSTEMFILES_IN_CONTENT_DIR_ENABLE, PARSE_ONLY_BOOL},
                {MENU_ENUM_LABEL_CORE_OPTION_CATEGORY_ENABLE,       PARSE_ONLY_BOOL},
                {MENU_ENUM_LABEL_DRIVER_SWITCH_ENABLE,              PARSE_ONLY_BOOL},
+               {MENU_ENUM_LABEL_CONTENT_SWITCH_SEAMLESS,           PARSE_ONLY_BOOL},
                {MENU_ENUM_LABEL_VIDEO_ALLOW_ROTATE,                PARSE_ONLY_BOOL},
                {MENU_ENUM_LABEL_VIDEO_SHARED_CONTEXT,              PARSE_ONLY_BOOL},
                {MENU_ENUM_LABEL_DUMMY_ON_CORE_SHUTDOWN,            PARSE_ONLY_BOOL},
@@ -11714,6 +11767,7 @@ unsigned menu_displaylist_build_list(
                {MENU_ENUM_LABEL_LOG_TO_FILE,           PARSE_ONLY_BOOL, true},
                {MENU_ENUM_LABEL_LOG_TO_FILE_TIMESTAMP, PARSE_ONLY_BOOL, false},
                {MENU_ENUM_LABEL_PERFCNT_ENABLE,        PARSE_ONLY_BOOL, true},
+               {MENU_ENUM_LABEL_FRAME_TIMELINE_ENABLE, PARSE_ONLY_BOOL, true},
             };
 
             for (i = 0; i < ARRAY_SIZE(build_list); i++)
@@ -11771,6 +11825,7 @@ unsigned menu_displaylist_build_list(
                {MENU_ENUM_LABEL_REWIND_GRANULARITY,      PARSE_ONLY_UINT, true },
                {MENU_ENUM_LABEL_REWIND_BUFFER_SIZE,      PARSE_ONLY_SIZE, true },
                {MENU_ENUM_LABEL_REWIND_BUFFER_SIZE_STEP, PARSE_ONLY_UINT, true },
+               {MENU_ENUM_LABEL_REWIND_DISK_BUFFER_SIZE, PARSE_ONLY_UINT, true },
                {MENU_ENUM_LABEL_AUDIO_REWIND_MUTE,       PARSE_ONLY_BOOL, true },
             };
 
@@ -11798,6 +11853,7 @@ unsigned menu_displaylist_build_list(
                {MENU_ENUM_LABEL_FRAME_TIME_COUNTER_SETTINGS, PARSE_ACTION,     true },
                {MENU_ENUM_LABEL_FASTFORWARD_RATIO,           PARSE_ONLY_FLOAT, true },
                {MENU_ENUM_LABEL_FASTFORWARD_FRAMESKIP,       PARSE_ONLY_BOOL,  true },
+               {MENU_ENUM_LABEL_FASTFORWARD_FRAME_BATCH,     PARSE_ONLY_BOOL,  true },
                {MENU_ENUM_LABEL_AUDIO_FASTFORWARD_MUTE,      PARSE_ONLY_BOOL,  true },
                {MENU_ENUM_LABEL_AUDIO_FASTFORWARD_SPEEDUP,   PARSE_ONLY_BOOL,  true },
                {MENU_ENUM_LABEL_SLOWMOTION_RATIO,            PARSE_ONLY_FLOAT, true },
@@ -12405,7 +12461,14 @@ bool menu_displaylist_ctl(enum menu_displaylist_ctl_state type,
                   {MENU_ENUM_LABEL_NETPLAY_GGPO_LZ4_ACCEL,             PARSE_ONLY_UINT,   true},
                   {MENU_ENUM_LABEL_NETPLAY_GGPO_SEND_INTERVAL,         PARSE_ONLY_UINT,   true},
                   {MENU_ENUM_LABEL_NETPLAY_GGPO_MAX_INPUT_BITS,        PARSE_ONLY_UINT,   true},
+                  {MENU_ENUM_LABEL_NETPLAY_GGPO_INPUT_FEC,             PARSE_ONLY_UINT,   true},
+                  {MENU_ENUM_LABEL_NETPLAY_GGPO_DRIFT_CORRECTION,      PARSE_ONLY_UINT,   true},
                   {MENU_ENUM_LABEL_NETPLAY_GGPO_PREDICTION_FRAMES,     PARSE_ONLY_UINT,   true},
+                  {MENU_ENUM_LABEL_NETPLAY_GGPO_KEYFRAME_INTERVAL,     PARSE_ONLY_UINT,   true},
+                  {MENU_ENUM_LABEL_NETPLAY_GGPO_CHECKSUM_INTERVAL,     PARSE_ONLY_UINT,   true},
+                  {MENU_ENUM_LABEL_NETPLAY_GGPO_REPLAY_CROSSFADE,      PARSE_ONLY_BOOL,   true},
+                  {MENU_ENUM_LABEL_NETPLAY_GGPO_AUDIO_SPLICE_FRAMES,   PARSE_ONLY_UINT,   true},
+                  {MENU_ENUM_LABEL_NETPLAY_GGPO_NETWORK_THREAD,        PARSE_ONLY_BOOL,   true},
                   {MENU_ENUM_LABEL_NETPLAY_GGPO_NETWORK_DELAY,         PARSE_ONLY_UINT,   true},
                   {MENU_ENUM_LABEL_NETPLAY_GGPO_OOP_PERCENT,           PARSE_ONLY_UINT,   true},
                   {MENU_ENUM_LABEL_NETPLAY_NAT_TRAVERSAL,      PARSE_ONLY_BOOL,   true},
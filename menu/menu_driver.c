@@ -67,6 +67,7 @@
 #endif
 
 #include "../gfx/gfx_animation.h"
+#include "../gfx/gfx_thumbnail.h"
 #include "../input/input_driver.h"
 #include "../input/input_remapping.h"
 #include "../performance_counters.h"
@@ -2513,6 +2514,23 @@ static void menu_input_key_bind_poll_bind_state_internal(
  * Sublabel: each entry has a sublabel, which consists of one or more lines of additional information.
  * This function callback lets us render that text.
  */
+
+/* The callbacks bound for the last entry appended. A directory
+ * listing appends thousands of entries that differ only in their
+ * path, which none of the binders look at, so a run of them after
+ * the first copies its callbacks instead of binding again. */
+static struct menu_cbs_init_last
+{
+   menu_file_list_cbs_t cbs;
+   const file_list_t *list;
+   const menu_ctx_driver_t *driver_ctx;
+   size_t idx;
+   unsigned type;
+   char label[NAME_MAX_LENGTH];
+   char menu_lbl[NAME_MAX_LENGTH];
+   bool valid;
+} menu_cbs_init_last_st;
+
 static void menu_cbs_init(
       struct menu_state *menu_st,
       const menu_ctx_driver_t *menu_driver_ctx,
@@ -2545,6 +2563,40 @@ static void menu_cbs_init(
       RARCH_LOG("\t\t\tenum_idx %d [%s]\n", cbs->enum_idx, msg_hash_to_str(cbs->enum_idx));
 #endif
 
+   {
+      struct menu_cbs_init_last *last = &menu_cbs_init_last_st;
+
+      if (     last->valid
+            && (last->list         == list)
+            && (last->idx + 1      == idx)
+            && (last->driver_ctx   == menu_driver_ctx)
+            && (last->type         == type)
+            && (last->cbs.enum_idx == cbs->enum_idx)
+            && (last->cbs.setting  == cbs->setting)
+            && string_is_equal(last->label, label)
+            && string_is_equal(last->menu_lbl, menu_lbl))
+      {
+         cbs->action_iterate       = last->cbs.action_iterate;
+         cbs->action_deferred_push = last->cbs.action_deferred_push;
+         cbs->action_select        = last->cbs.action_select;
+         cbs->action_get_title     = last->cbs.action_get_title;
+         cbs->action_ok            = last->cbs.action_ok;
+         cbs->action_cancel        = last->cbs.action_cancel;
+         cbs->action_scan          = last->cbs.action_scan;
+         cbs->action_start         = last->cbs.action_start;
+         cbs->action_info          = last->cbs.action_info;
+         cbs->action_left          = last->cbs.action_left;
+         cbs->action_right         = last->cbs.action_right;
+         cbs->action_label         = last->cbs.action_label;
+         cbs->action_sublabel      = last->cbs.action_sublabel;
+         cbs->action_get_value     = last->cbs.action_get_value;
+         last->idx                 = idx;
+         return;
+      }
+
+      last->valid = false;
+   }
+
    /* It will try to find a corresponding callback function inside
     * menu_cbs_ok.c, then map this callback to the entry. */
    menu_cbs_init_bind_ok(cbs, path, label, lbl_len, type, idx, menu_lbl, menu_lbl_len);
@@ -2599,6 +2651,21 @@ static void menu_cbs_init(
 
    if (menu_driver_ctx && menu_driver_ctx->bind_init)
       menu_driver_ctx->bind_init(cbs, path, label, type, idx);
+
+   /* Labels too long to keep are bound every time */
+   if (     (lbl_len      < sizeof(menu_cbs_init_last_st.label))
+         && (menu_lbl_len < sizeof(menu_cbs_init_last_st.menu_lbl)))
+   {
+      struct menu_cbs_init_last *last = &menu_cbs_init_last_st;
+      last->cbs        = *cbs;
+      last->list       = list;
+      last->driver_ctx = menu_driver_ctx;
+      last->idx        = idx;
+      last->type       = type;
+      strlcpy(last->label,    label,    sizeof(last->label));
+      strlcpy(last->menu_lbl, menu_lbl, sizeof(last->menu_lbl));
+      last->valid      = true;
+   }
 }
 
 #if defined(HAVE_CG) || defined(HAVE_GLSL) || defined(HAVE_SLANG) || defined(HAVE_HLSL)
@@ -6889,6 +6956,7 @@ bool menu_driver_ctl(enum rarch_menu_ctl_state state, void *data)
             if (menu_st->thumbnail_path_data)
                free(menu_st->thumbnail_path_data);
             menu_st->thumbnail_path_data    = NULL;
+            gfx_thumbnail_cache_free();
 
             if (menu_st->driver_data->core_buf)
                free(menu_st->driver_data->core_buf);
@@ -8167,6 +8235,72 @@ int generic_menu_entry_action(
 }
 
 /* Iterate the menu driver for one frame. */
+/* How long a playlist entry has to stay highlighted
+ * before its core and content are preloaded */
+#define MENU_PRELOAD_DELAY 250000
+
+/* Preloads the highlighted playlist entry once the
+ * selection has settled on it, so browsing quickly
+ * through a playlist doesn't read every entry. */
+static void menu_driver_preload_selection(
+      struct menu_state *menu_st,
+      retro_time_t current_time)
+{
+   static file_list_t *last_list      = NULL;
+   static size_t last_selection       = 0;
+   static retro_time_t last_change    = 0;
+   static bool preloaded              = false;
+   char content_path[PATH_MAX_LENGTH];
+   menu_list_t *menu_list             = menu_st->entries.list;
+   file_list_t *selection_buf         = MENU_LIST_GET_SELECTION(menu_list, (unsigned)0);
+   size_t selection                   = menu_st->selection_ptr;
+   const struct playlist_entry *entry = NULL;
+   core_info_t *core_info             = NULL;
+   playlist_t *playlist               = NULL;
+
+   if (     !selection_buf
+         || (selection >= selection_buf->size)
+         || (selection_buf->list[selection].type != FILE_TYPE_RPL_ENTRY))
+   {
+      last_list = NULL;
+      return;
+   }
+
+   if (     (selection_buf != last_list)
+         || (selection     != last_selection))
+   {
+      last_list      = selection_buf;
+      last_selection = selection;
+      last_change    = current_time;
+      preloaded      = false;
+      return;
+   }
+
+   if (     preloaded
+         || (current_time - last_change < MENU_PRELOAD_DELAY))
+      return;
+   preloaded = true;
+
+   if (!(playlist = playlist_get_cached()))
+      return;
+   playlist_get_index(playlist,
+         selection_buf->list[selection].entry_idx, &entry);
+   if (!entry || string_is_empty(entry->path))
+      return;
+
+   strlcpy(content_path, entry->path, sizeof(content_path));
+   playlist_resolve_path(PLAYLIST_LOAD, false,
+         content_path, sizeof(content_path));
+
+   if (playlist_entry_has_core(entry))
+      core_info = playlist_entry_get_core_info(entry);
+   else
+      core_info = playlist_get_default_core_info(playlist);
+
+   task_push_content_preload(core_info ? core_info->path : NULL,
+         content_path);
+}
+
 bool menu_driver_iterate(
       struct menu_state *menu_st,
       gfx_display_t *p_disp,
@@ -8175,6 +8309,9 @@ bool menu_driver_iterate(
       enum menu_action action,
       retro_time_t current_time)
 {
+   if (settings->bools.content_switch_seamless)
+      menu_driver_preload_selection(menu_st, current_time);
+
    return ( menu_st->driver_data
          && generic_menu_iterate(
             menu_st,
@@ -8186,6 +8323,57 @@ bool menu_driver_iterate(
             current_time) != -1);
 }
 
+/* How long an unchanged menu may go without being drawn */
+#define MENU_STATIC_FRAME_MAX_AGE 1000000
+
+bool menu_driver_frame_is_static(
+      struct menu_state *menu_st,
+      gfx_display_t *p_disp,
+      gfx_animation_t *p_anim,
+      unsigned width,
+      unsigned height,
+      bool overlays_static)
+{
+   menu_handle_t *menu            = menu_st->driver_data;
+   menu_input_pointer_t *pointer  = &menu_st->input_state.pointer;
+   bool driver_static             =
+             menu_st->driver_ctx
+          && menu_st->driver_ctx->environ_cb
+          && (menu_st->driver_ctx->environ_cb(MENU_ENVIRON_IS_STATIC,
+                NULL, menu_st->userdata) == 0);
+
+   if (     driver_static
+         && overlays_static
+         && menu
+         && !BIT64_GET(menu->state, MENU_STATE_RENDER_FRAMEBUFFER)
+         && !BIT64_GET(menu->state, MENU_STATE_RENDER_MESSAGEBOX)
+         && !(p_disp->flags & GFX_DISP_FLAG_FB_DIRTY)
+         && !ANIM_IS_ACTIVE(p_anim)
+         && !menu_input_dialog_get_display_kb()
+         && !pointer->flags
+         && (pointer->y_accel == 0.0f)
+         && (pointer->x == menu_st->last_frame_pointer_x)
+         && (pointer->y == menu_st->last_frame_pointer_y)
+         && (width  == menu_st->last_frame_width)
+         && (height == menu_st->last_frame_height)
+         && (menu_st->current_time_us - menu_st->last_frame_time_us
+            < MENU_STATIC_FRAME_MAX_AGE))
+      return true;
+
+   menu_st->last_frame_time_us   = menu_st->current_time_us;
+   menu_st->last_frame_width     = width;
+   menu_st->last_frame_height    = height;
+   menu_st->last_frame_pointer_x = pointer->x;
+   menu_st->last_frame_pointer_y = pointer->y;
+
+   /* Drivers that take part only need the flag for
+    * the frame about to be drawn; RGUI clears it itself */
+   if (driver_static)
+      p_disp->flags             &= ~GFX_DISP_FLAG_FB_DIRTY;
+
+   return false;
+}
+
 bool menu_input_dialog_start_search(void)
 {
    input_driver_state_t *input_st          = input_state_get_ptr();
@@ -273,6 +273,7 @@ enum menu_settings_type
    MENU_SETTING_ACTION_PLAYLIST_MANAGER_RESET_CORES,
    MENU_SETTING_ACTION_PLAYLIST_MANAGER_CLEAN_PLAYLIST,
    MENU_SETTING_ACTION_PLAYLIST_MANAGER_REFRESH_PLAYLIST,
+   MENU_SETTING_ACTION_PLAYLIST_MANAGER_BUILD_THUMBNAIL_PACK,
 
    MENU_SETTING_MANUAL_CONTENT_SCAN_DIR,
    MENU_SETTING_MANUAL_CONTENT_SCAN_SYSTEM_NAME,
@@ -470,6 +471,8 @@ struct menu_state
    retro_time_t powerstate_last_time_us;
    retro_time_t datetime_last_time_us;
    retro_time_t input_last_time_us;
+   /* When the menu last drew a frame */
+   retro_time_t last_frame_time_us;
    menu_input_t input_state;               /* retro_time_t alignment */
 
    retro_time_t prev_start_time;
@@ -509,6 +512,9 @@ struct menu_state
    unsigned input_dialog_kb_type;
    unsigned input_dialog_kb_idx;
    unsigned input_driver_flushing_input;
+   /* Video size of the last frame drawn */
+   unsigned last_frame_width;
+   unsigned last_frame_height;
    menu_dialog_t dialog_st;
    enum menu_action prev_action;
 #ifdef HAVE_RUNAHEAD
@@ -517,6 +523,9 @@ struct menu_state
 
    /* int16_t alignment */
    menu_input_pointer_hw_state_t input_pointer_hw_state;
+   /* Pointer position of the last frame drawn */
+   int16_t last_frame_pointer_x;
+   int16_t last_frame_pointer_y;
 
    uint16_t flags;
 #ifdef HAVE_OVERLAY
@@ -616,6 +625,9 @@ void menu_explore_context_deinit(void);
 void menu_explore_free_state(explore_state_t *state);
 void menu_explore_free(void);
 void menu_explore_set_state(explore_state_t *state);
+/* Rebuilds the explore index in the background, after the
+ * playlists or databases changed */
+void menu_explore_rebuild(void);
 #endif
 
 const char *menu_driver_ident(void);
@@ -731,6 +743,26 @@ bool menu_driver_iterate(
       enum menu_action action,
       retro_time_t current_time);
 
+/**
+ * menu_driver_frame_is_static:
+ * @overlays_static      : nothing drawn over the menu
+ *                         (messages, statistics) changes
+ *
+ * Call after menu_driver_iterate(). Tells whether the
+ * frame the menu would draw now is the one on screen, in
+ * which case it need be neither drawn nor presented. When
+ * it returns false the frame must be drawn; the state it
+ * was drawn from is remembered. Unchanged menus are still
+ * drawn once a second, for clocks and status indicators.
+ **/
+bool menu_driver_frame_is_static(
+      struct menu_state *menu_st,
+      gfx_display_t *p_disp,
+      gfx_animation_t *p_anim,
+      unsigned width,
+      unsigned height,
+      bool overlays_static);
+
 void menu_display_common_image_upload(void *data,
       void *user_data, unsigned type);
 
@@ -20,6 +20,9 @@
 #include <compat/strl.h>
 #include <array/rbuf.h>
 #include <array/rhmap.h>
+#include <features/features_cpu.h>
+#include <file/file_path.h>
+#include <file/file_write_atomic.h>
 #include <formats/rjson.h>
 #include <formats/rjson_helpers.h>
 #include <retro_endianness.h>
@@ -171,6 +174,64 @@ explore_by_info[EXPLORE_CAT_COUNT] =
 
 /* TODO/FIXME - static global */
 static explore_state_t* explore_state;
+/* A rebuilt state that arrived while the explore menu was open
+ * below its top level, swapped in once it is back there */
+static explore_state_t* explore_state_pending;
+/* Inputs changed while a build was running */
+static bool explore_rebuild_pending;
+
+#define EXPLORE_CACHE_MAGIC      "RAEXPLR"
+#define EXPLORE_CACHE_VERSION    1
+#define EXPLORE_CACHE_BYTE_ORDER 0x01020304
+/* Entry fields that are not pool offsets */
+#define EXPLORE_CACHE_FIELD_YES  0xFFFFFFFF
+#define EXPLORE_CACHE_FIELD_NO   0xFFFFFFFE
+
+/* The explore cache holds the database fields of every entry
+ * from the last build, along with the size and modification time
+ * of each playlist and database it was built from. While those
+ * stay the same, a build reads the playlists but none of the
+ * databases. Native byte order, strings are offsets into the pool
+ * at the end. */
+typedef struct
+{
+   char magic[8];
+   uint32_t version;
+   uint32_t byte_order;
+   uint32_t field_count;
+   uint32_t input_count;
+   uint32_t entry_count;
+   uint32_t pool_size;
+} explore_cache_header_t;
+
+typedef struct
+{
+   /* -1 for a file that does not exist */
+   int64_t size;
+   int64_t mtime;
+   uint32_t path;
+   uint32_t reserved;
+} explore_cache_input_t;
+
+typedef struct
+{
+   uint32_t playlist;
+   uint32_t entry;
+   uint32_t fields[EXPLORE_CAT_COUNT];
+   uint32_t original_title;
+} explore_cache_entry_t;
+
+typedef struct
+{
+   char *pool;
+   /* String -> pool offset, to store each string once */
+   uint32_t *offsets;
+   explore_cache_input_t *inputs;
+   /* Parallel to the entries of the state being built */
+   explore_cache_entry_t *entries;
+   /* An input could not be queried, or memory ran out */
+   bool unusable;
+} explore_cache_t;
 
 #if defined(_MSC_VER)
 #define EX_ALIGNOF(type) ((int)__alignof(type))
@@ -294,6 +355,22 @@ static int explore_check_company_suffix(const char* p, bool search_reverse)
    return 0;
 }
 
+/* Appends the offsets of the RDB entries with @value in field @key */
+static uint64_t *explore_add_offsets(uint64_t *offsets,
+      const libretrodb_key_index_t *key_idx, enum libretrodb_key key,
+      uint32_t value)
+{
+   size_t len   = RBUF_LEN(offsets);
+   size_t found = libretrodb_key_index_find(key_idx, key, value, NULL, 0);
+
+   if (found && RBUF_TRYFIT(offsets, len + found))
+   {
+      RBUF_RESIZE(offsets, len + found);
+      libretrodb_key_index_find(key_idx, key, value, offsets + len, found);
+   }
+   return offsets;
+}
+
 static void explore_add_unique_string(
       explore_state_t *state,
       explore_string_t** maps[EXPLORE_CAT_COUNT], explore_entry_t *e,
@@ -386,6 +463,257 @@ static void explore_add_unique_string(
    }
 }
 
+/* Fills in the categories of a new entry from its database
+ * fields, as read from a database or from the explore cache */
+static void explore_fill_entry(explore_state_t *state,
+      explore_string_t** maps[EXPLORE_CAT_COUNT], explore_entry_t *e,
+      const char *fields[EXPLORE_CAT_COUNT], const char *original_title,
+      explore_string_t ***split_buf)
+{
+   unsigned cat;
+
+   for (cat = 0; cat < EXPLORE_CAT_COUNT; cat++)
+      e->by[cat]    = NULL;
+   e->split         = NULL;
+
+   for (cat = 0; cat != EXPLORE_CAT_COUNT; cat++)
+      explore_add_unique_string(state, maps, e, cat, fields[cat],
+            split_buf);
+
+#ifdef EXPLORE_SHOW_ORIGINAL_TITLE
+   e->original_title = NULL;
+   if (original_title && *original_title)
+   {
+      size_t _len       = strlen(original_title) + 1;
+      e->original_title = (char*)ex_arena_alloc(&state->arena, _len);
+      memcpy(e->original_title, original_title, _len);
+   }
+#endif
+
+   if (RBUF_LEN(*split_buf))
+   {
+      size_t _len;
+
+      RBUF_PUSH(*split_buf, NULL); /* terminator */
+      _len     = RBUF_SIZEOF(*split_buf);
+      e->split = (explore_string_t **)ex_arena_alloc(&state->arena, _len);
+      memcpy(e->split, *split_buf, _len);
+      RBUF_CLEAR(*split_buf);
+   }
+}
+
+static uint32_t explore_cache_add_string(explore_cache_t *cache,
+      const char *str)
+{
+   size_t _len;
+   uint32_t offset;
+
+   if (!str || !*str)
+      return 0;
+   if ((offset = RHMAP_GET_STR(cache->offsets, str)))
+      return offset;
+
+   _len   = strlen(str) + 1;
+   offset = (uint32_t)RBUF_LEN(cache->pool);
+   if (     (size_t)offset + _len > UINT32_MAX
+         || !RBUF_TRYFIT(cache->pool, offset + _len))
+   {
+      cache->unusable = true;
+      return 0;
+   }
+   RBUF_RESIZE(cache->pool, offset + _len);
+   memcpy(cache->pool + offset, str, _len);
+   RHMAP_SET_STR(cache->offsets, str, offset);
+   return offset;
+}
+
+static void explore_cache_add_input(explore_cache_t *cache,
+      const char *path)
+{
+   explore_cache_input_t input;
+
+   input.size     = -1;
+   input.mtime    = 0;
+   input.path     = explore_cache_add_string(cache, path);
+   input.reserved = 0;
+
+   /* Without a modification time a change would go unnoticed */
+   if (     path_is_valid(path)
+         && !path_get_size_and_mtime(path, &input.size, &input.mtime))
+      cache->unusable = true;
+
+   RBUF_PUSH(cache->inputs, input);
+}
+
+static void explore_cache_deinit(explore_cache_t *cache)
+{
+   RBUF_FREE(cache->pool);
+   RHMAP_FREE(cache->offsets);
+   RBUF_FREE(cache->inputs);
+   RBUF_FREE(cache->entries);
+}
+
+/* Records the fields explore_fill_entry() was given */
+static void explore_cache_set_entry(explore_cache_t *cache,
+      explore_cache_entry_t *record,
+      uint32_t playlist, uint32_t entry,
+      const char *fields[EXPLORE_CAT_COUNT], const char *original_title)
+{
+   unsigned cat;
+   const char *yes = msg_hash_to_str(MENU_ENUM_LABEL_VALUE_YES);
+
+   record->playlist = playlist;
+   record->entry    = entry;
+
+   for (cat = 0; cat != EXPLORE_CAT_COUNT; cat++)
+   {
+      /* Stored as such, so that the cache holds no translation */
+      if (explore_by_info[cat].is_boolean && fields[cat])
+         record->fields[cat] = (fields[cat] == yes)
+               ? EXPLORE_CACHE_FIELD_YES
+               : EXPLORE_CACHE_FIELD_NO;
+      else
+         record->fields[cat] = explore_cache_add_string(cache, fields[cat]);
+   }
+
+   record->original_title   = explore_cache_add_string(cache, original_title);
+}
+
+static const char *explore_cache_get_field(const char *pool,
+      uint32_t field)
+{
+   if (field == EXPLORE_CACHE_FIELD_YES)
+      return msg_hash_to_str(MENU_ENUM_LABEL_VALUE_YES);
+   if (field == EXPLORE_CACHE_FIELD_NO)
+      return msg_hash_to_str(MENU_ENUM_LABEL_VALUE_NO);
+   return field ? pool + field : NULL;
+}
+
+/* Fills the entries of @state from the cache at @path, if it was
+ * built from exactly the inputs recorded in @cache */
+static bool explore_cache_load(explore_state_t *state,
+      const char *path, const explore_cache_t *cache,
+      explore_string_t** maps[EXPLORE_CAT_COUNT],
+      explore_string_t ***split_buf)
+{
+   uint32_t i, j;
+   const explore_cache_header_t *header;
+   const explore_cache_input_t *inputs;
+   const explore_cache_entry_t *entries;
+   const char *pool;
+   void *data   = NULL;
+   int64_t size = 0;
+   bool success = false;
+
+   if (     cache->unusable
+         || !path_is_valid(path)
+         || !filestream_read_file(path, &data, &size))
+      return false;
+
+   header = (const explore_cache_header_t*)data;
+   if (     (size_t)size < sizeof(*header)
+         || memcmp(header->magic, EXPLORE_CACHE_MAGIC,
+               sizeof(EXPLORE_CACHE_MAGIC)) != 0
+         || header->version     != EXPLORE_CACHE_VERSION
+         || header->byte_order  != EXPLORE_CACHE_BYTE_ORDER
+         || header->field_count != EXPLORE_CAT_COUNT
+         || header->input_count != RBUF_LEN(cache->inputs)
+         || header->entry_count > ((size_t)size - sizeof(*header)
+            - (size_t)header->input_count * sizeof(*inputs))
+            / sizeof(*entries)
+         || header->pool_size  != (size_t)size - sizeof(*header)
+            - (size_t)header->input_count * sizeof(*inputs)
+            - (size_t)header->entry_count * sizeof(*entries)
+         || !header->pool_size)
+      goto end;
+
+   inputs  = (const explore_cache_input_t*)(header + 1);
+   entries = (const explore_cache_entry_t*)(inputs + header->input_count);
+   pool    = (const char*)(entries + header->entry_count);
+
+   if (pool[header->pool_size - 1] != '\0')
+      goto end;
+
+   for (i = 0; i < header->input_count; i++)
+   {
+      const explore_cache_input_t *input = &cache->inputs[i];
+      if (     inputs[i].size  != input->size
+            || inputs[i].mtime != input->mtime
+            || inputs[i].path  >= header->pool_size
+            || !string_is_equal(pool + inputs[i].path,
+                  cache->pool + input->path))
+         goto end;
+   }
+
+   for (i = 0; i < header->entry_count; i++)
+   {
+      if (     entries[i].playlist >= RBUF_LEN(state->playlists)
+            || entries[i].entry    >= playlist_size(
+                  state->playlists[entries[i].playlist])
+            || entries[i].original_title >= header->pool_size)
+         goto end;
+      for (j = 0; j < EXPLORE_CAT_COUNT; j++)
+         if (     entries[i].fields[j] >= header->pool_size
+               && entries[i].fields[j] <  EXPLORE_CACHE_FIELD_NO)
+            goto end;
+   }
+
+   if (header->entry_count)
+      RBUF_RESIZE(state->entries, header->entry_count);
+
+   for (i = 0; i < header->entry_count; i++)
+   {
+      const char *fields[EXPLORE_CAT_COUNT];
+      explore_entry_t *e = &state->entries[i];
+
+      playlist_get_index(state->playlists[entries[i].playlist],
+            entries[i].entry, &e->playlist_entry);
+
+      for (j = 0; j < EXPLORE_CAT_COUNT; j++)
+         fields[j] = explore_cache_get_field(pool, entries[i].fields[j]);
+
+      explore_fill_entry(state, maps, e, fields,
+            explore_cache_get_field(pool, entries[i].original_title),
+            split_buf);
+   }
+
+   success = true;
+
+end:
+   free(data);
+   return success;
+}
+
+static void explore_cache_write(const char *path,
+      const explore_cache_t *cache)
+{
+   explore_cache_header_t header;
+   struct file_write_block blocks[4];
+
+   if (cache->unusable)
+      return;
+
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, EXPLORE_CACHE_MAGIC, sizeof(EXPLORE_CACHE_MAGIC));
+   header.version     = EXPLORE_CACHE_VERSION;
+   header.byte_order  = EXPLORE_CACHE_BYTE_ORDER;
+   header.field_count = EXPLORE_CAT_COUNT;
+   header.input_count = (uint32_t)RBUF_LEN(cache->inputs);
+   header.entry_count = (uint32_t)RBUF_LEN(cache->entries);
+   header.pool_size   = (uint32_t)RBUF_LEN(cache->pool);
+
+   blocks[0].data = &header;
+   blocks[0].size = sizeof(header);
+   blocks[1].data = cache->inputs;
+   blocks[1].size = (int64_t)RBUF_SIZEOF(cache->inputs);
+   blocks[2].data = cache->entries;
+   blocks[2].size = (int64_t)RBUF_SIZEOF(cache->entries);
+   blocks[3].data = cache->pool;
+   blocks[3].size = (int64_t)RBUF_LEN(cache->pool);
+   if (!file_write_atomic(path, blocks, ARRAY_SIZE(blocks)))
+      RARCH_WARN("[Explore] Failed to write cache file: \"%s\".\n", path);
+}
+
 static void explore_unload_icons(explore_state_t *state)
 {
    unsigned i;
@@ -452,11 +780,15 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
       const char *directory_database)
 {
    unsigned i;
+   explore_cache_t cache;
    char tmp[PATH_MAX_LENGTH];
+   char cache_path[PATH_MAX_LENGTH];
    struct explore_source
    {
       const struct playlist_entry *source;
       uint32_t entry_index, meta_count;
+      /* Where the entry is, for the explore cache */
+      uint32_t playlist_index, playlist_entry;
    };
    struct explore_rdb
    {
@@ -471,12 +803,18 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
    explore_string_t **cat_maps[EXPLORE_CAT_COUNT] = {NULL};
    explore_string_t **split_buf                   = NULL;
    libretro_vfs_implementation_dir *dir           = NULL;
+   bool from_cache                                = false;
+   retro_time_t start_time                        = cpu_features_get_time_usec();
 
    explore_state_t *state = (explore_state_t*)calloc(1, sizeof(*state));
 
    if (!state)
       return NULL;
 
+   memset(&cache, 0, sizeof(cache));
+   /* Offset 0 stands for an empty string */
+   RBUF_PUSH(cache.pool, '\0');
+
    state->label_explore_item_str    =
       msg_hash_to_str(MENU_ENUM_LABEL_EXPLORE_ITEM);
 
@@ -513,6 +851,7 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
 
       fill_pathname_join_special(playlist_config.path,
             directory_playlist, fname, sizeof(playlist_config.path));
+      explore_cache_add_input(&cache, playlist_config.path);
       playlist_config.capacity          = COLLECTION_SIZE;
       playlist                          = playlist_init(&playlist_config);
 
@@ -523,7 +862,7 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
       {
          int rdb_num;
          uint32_t entry_crc32;
-         struct explore_source src = { NULL, (uint32_t)-1, 0 };
+         struct explore_source src = { NULL, (uint32_t)-1, 0, 0, 0 };
          struct explore_rdb* rdb             = NULL;
          const struct playlist_entry *entry  = NULL;
          const char *db_name                 = fname;
@@ -581,6 +920,8 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
                ext_path[3] = 'b';
             }
 
+            explore_cache_add_input(&cache, tmp);
+
             if (libretrodb_open(tmp, newrdb.handle, false) != 0)
             {
                /* Invalid RDB file */
@@ -603,7 +944,9 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
             rdb->count++;
             entry_crc32 = (uint32_t)strtoul(
                   (entry->crc32 ? entry->crc32 : ""), NULL, 16);
-            src.source = entry;
+            src.source         = entry;
+            src.playlist_index = (uint32_t)RBUF_LEN(state->playlists);
+            src.playlist_entry = (uint32_t)j;
             if (entry_crc32)
             {
                RHMAP_SET(rdb->playlist_crcs, entry_crc32, src);
@@ -622,31 +965,68 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
          playlist_free(playlist);
    }
 
+   fill_pathname_join_special(cache_path, directory_playlist,
+         FILE_PATH_EXPLORE_CACHE, sizeof(cache_path));
+   from_cache = explore_cache_load(state, cache_path, &cache,
+         cat_maps, &split_buf);
+
    /* Loop through all RDBs referenced in the playlists
     * and load meta data strings */
    for (i = 0; i != RBUF_LEN(rdbs); i++)
    {
+      size_t j;
+      bool more;
       struct rmsgpack_dom_value item;
-      struct explore_rdb* rdb  = &rdbs[i];
-      libretrodb_cursor_t *cur = libretrodb_cursor_new();
-      bool more                =
-         (
-          libretrodb_cursor_open(rdb->handle, cur, NULL) == 0
-          && libretrodb_cursor_read_item(cur, &item) == 0);
+      struct explore_rdb* rdb         = &rdbs[i];
+      libretrodb_cursor_t *cur        = libretrodb_cursor_new();
+      libretrodb_key_index_t *key_idx = NULL;
+      uint64_t *offsets               = NULL;
+
+      /* When the playlists cover little of the RDB, only read the
+       * entries its key index has for their CRCs and names */
+      if (from_cache)
+         more = false;
+      else if ((uint64_t)rdb->count * 4 < libretrodb_count(rdb->handle)
+            && (key_idx = libretrodb_key_index_open(rdb->handle)))
+      {
+         for (j = 0; j < RHMAP_CAP(rdb->playlist_crcs); j++)
+         {
+            if (RHMAP_KEY(rdb->playlist_crcs, j))
+               offsets = explore_add_offsets(offsets, key_idx,
+                     LIBRETRODB_KEY_CRC, RHMAP_KEY(rdb->playlist_crcs, j));
+         }
+         for (j = 0; j < RHMAP_CAP(rdb->playlist_names); j++)
+         {
+            const char *label;
+            if (!RHMAP_KEY(rdb->playlist_names, j))
+               continue;
+            label   = RHMAP_KEY_STR(rdb->playlist_names, j);
+            offsets = explore_add_offsets(offsets, key_idx,
+                  LIBRETRODB_KEY_NAME,
+                  libretrodb_key_hash(label, strlen(label)));
+         }
+         libretrodb_key_index_close(key_idx);
+
+         more = libretrodb_cursor_open_offsets(rdb->handle, cur, NULL,
+               offsets, RBUF_LEN(offsets)) == 0;
+         RBUF_FREE(offsets);
+      }
+      else
+         more = libretrodb_cursor_open(rdb->handle, cur, NULL) == 0;
+
+      more = more && libretrodb_cursor_read_item(cur, &item) == 0;
 
       for (; more; more = (rmsgpack_dom_value_free(&item),
                libretrodb_cursor_read_item(cur, &item) == 0))
       {
-         unsigned k, l, cat;
+         unsigned k, cat;
          explore_entry_t* e;
          const char *fields[EXPLORE_CAT_COUNT];
          char numeric_buf[EXPLORE_CAT_COUNT][16];
          uint32_t crc32                     = 0;
          uint32_t meta_count                = 0;
          char *name                         = NULL;
-#ifdef EXPLORE_SHOW_ORIGINAL_TITLE
          char *original_title               = NULL;
-#endif
          struct explore_source* src         = NULL;
 
          if (item.type != RDT_MAP)
@@ -747,47 +1127,19 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
          {
             src->entry_index = (uint32_t)RBUF_LEN(state->entries);
             RBUF_RESIZE(state->entries, src->entry_index + 1);
+            RBUF_RESIZE(cache.entries, src->entry_index + 1);
          }
          e = &state->entries[src->entry_index];
          src->meta_count = meta_count;
          e->playlist_entry = src->source;
-         for (l = 0; l < EXPLORE_CAT_COUNT; l++)
-            e->by[l]       = NULL;
-         e->split          = NULL;
-#ifdef EXPLORE_SHOW_ORIGINAL_TITLE
-         e->original_title = NULL;
-#endif
 
          fields[EXPLORE_BY_SYSTEM] = rdb->systemname;
 
-         for (cat = 0; cat != EXPLORE_CAT_COUNT; cat++)
-         {
-            explore_add_unique_string(state,
-                  cat_maps, e, cat,
-                  fields[cat], &split_buf);
-         }
-
-#ifdef EXPLORE_SHOW_ORIGINAL_TITLE
-         if (original_title && *original_title)
-         {
-            size_t _len       = strlen(original_title) + 1;
-            e->original_title = (char*)
-               ex_arena_alloc(&state->arena, _len);
-            memcpy(e->original_title, original_title, _len);
-         }
-#endif
-
-         if (RBUF_LEN(split_buf))
-         {
-            size_t _len;
-
-            RBUF_PUSH(split_buf, NULL); /* terminator */
-            _len       = RBUF_SIZEOF(split_buf);
-            e->split   = (explore_string_t **)
-               ex_arena_alloc(&state->arena, _len);
-            memcpy(e->split, split_buf, _len);
-            RBUF_CLEAR(split_buf);
-         }
+         explore_fill_entry(state, cat_maps, e, fields, original_title,
+               &split_buf);
+         explore_cache_set_entry(&cache, &cache.entries[src->entry_index],
+               src->playlist_index, src->playlist_entry,
+               fields, original_title);
 
          /* if all entries have found connections, we can leave early */
          if (--rdb->count == 0)
@@ -808,6 +1160,15 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
    RHMAP_FREE(rdb_indices);
    RBUF_FREE(rdbs);
 
+   if (!from_cache)
+      explore_cache_write(cache_path, &cache);
+   explore_cache_deinit(&cache);
+
+   RARCH_LOG("[Explore] Indexed %u entries%s in %.1f ms.\n",
+         (unsigned)RBUF_LEN(state->entries),
+         from_cache ? " from cache" : "",
+         (cpu_features_get_time_usec() - start_time) / 1000.0f);
+
    for (i = 0; i != EXPLORE_CAT_COUNT; i++)
    {
       uint32_t idx;
@@ -1323,6 +1684,15 @@ unsigned menu_displaylist_explore(file_list_t *list, settings_t *settings)
    unsigned previous_type       = (depth > 1 ? stack_top[depth - 2].type : 0);
    unsigned current_cat         = current_type - EXPLORE_TYPE_FIRSTCATEGORY;
 
+   /* Back at the top, nothing points into the old state */
+   if (explore_state_pending && depth <= 1)
+   {
+      explore_state_t *pending = explore_state_pending;
+      explore_state_pending    = NULL;
+      menu_explore_set_state(pending);
+      state                    = explore_state;
+   }
+
    /* overwrite the menu title function with our custom one */
    /* depth 1 is never popped so we can only do this on sub menus */
    if (depth > 1)
@@ -1835,8 +2205,39 @@ bool menu_explore_is_content_list(void)
 
 void menu_explore_context_init(void)
 {
+   settings_t *settings = config_get_ptr();
+
    if (explore_state)
       explore_load_icons(explore_state);
+   /* Build the index ahead of the view being opened, where
+    * that does not hold up the main thread */
+   else if (     settings->bools.menu_content_show_explore
+            && task_queue_is_threaded()
+            && !menu_explore_init_in_progress(NULL))
+      task_push_menu_explore_init(
+            settings->paths.directory_playlist,
+            settings->paths.path_content_database);
+}
+
+void menu_explore_rebuild(void)
+{
+   settings_t *settings = config_get_ptr();
+
+   if (menu_explore_init_in_progress(NULL))
+   {
+      /* The running build may have read the old inputs */
+      explore_rebuild_pending = true;
+      return;
+   }
+
+   if (     !explore_state
+         && !explore_state_pending
+         && !settings->bools.menu_content_show_explore)
+      return;
+
+   task_push_menu_explore_init(
+         settings->paths.directory_playlist,
+         settings->paths.path_content_database);
 }
 
 void menu_explore_context_deinit(void)
@@ -1867,6 +2268,13 @@ void menu_explore_free_state(explore_state_t *state)
 
 void menu_explore_free(void)
 {
+   if (explore_state_pending)
+   {
+      menu_explore_free_state(explore_state_pending);
+      free(explore_state_pending);
+      explore_state_pending = NULL;
+   }
+
    if (!explore_state)
       return;
 
@@ -1875,16 +2283,56 @@ void menu_explore_free(void)
    explore_state = NULL;
 }
 
+/* Whether a menu below the explore view's top level is open,
+ * whose entries hold indices into the current state */
+static bool explore_is_open_below_top(void)
+{
+   size_t i;
+   struct menu_state *menu_st = menu_state_get_ptr();
+   file_list_t *menu_stack    = MENU_LIST_GET(menu_st->entries.list, 0);
+
+   if (!menu_stack)
+      return false;
+
+   for (i = 0; i < menu_stack->size; i++)
+   {
+      const menu_file_list_cbs_t *cbs = (const menu_file_list_cbs_t*)
+         menu_stack->list[i].actiondata;
+      if (cbs && cbs->action_get_title == explore_action_get_title)
+         return true;
+   }
+
+   return false;
+}
+
 void menu_explore_set_state(explore_state_t *state)
 {
    if (!state)
       return;
 
-   if (explore_state)
-      menu_explore_free();
+   if (explore_state && explore_is_open_below_top())
+   {
+      if (explore_state_pending)
+      {
+         menu_explore_free_state(explore_state_pending);
+         free(explore_state_pending);
+      }
+      explore_state_pending = state;
+   }
+   else
+   {
+      if (explore_state)
+         menu_explore_free();
+
+      /* needs to be done now on the main thread */
+      explore_load_icons(state);
 
-   /* needs to be done now on the main thread */
-   explore_load_icons(state);
+      explore_state = state;
+   }
 
-   explore_state = state;
+   if (explore_rebuild_pending)
+   {
+      explore_rebuild_pending = false;
+      menu_explore_rebuild();
+   }
 }
@@ -116,6 +116,7 @@
 #include "../playlist.h"
 #include "../manual_content_scan.h"
 #include "../input/input_remapping.h"
+#include "../deps/ggpo/src/include/ggpo_predict.h"
 
 #include "../tasks/tasks_internal.h"
 
@@ -7000,6 +7001,25 @@ static size_t setting_get_string_representation_runahead_mode(
 }
 #endif
 
+static size_t setting_get_string_representation_input_predictor(
+      rarch_setting_t *setting,
+      char *s, size_t len)
+{
+   if (setting)
+   {
+      switch (*setting->value.target.unsigned_integer)
+      {
+         case GGPO_PREDICT_HOLD:
+            return strlcpy(s, msg_hash_to_str(
+                     MENU_ENUM_LABEL_VALUE_INPUT_PREDICTOR_HOLD), len);
+         default:
+            return strlcpy(s, msg_hash_to_str(
+                     MENU_ENUM_LABEL_VALUE_INPUT_PREDICTOR_REPEAT), len);
+      }
+   }
+   return 0;
+}
+
 static size_t setting_get_string_representation_input_touch_scale(
       rarch_setting_t *setting, char *s, size_t len)
 {
@@ -11074,9 +11094,9 @@ static bool setting_append_list(
          {
             unsigned i, listing = 0;
 #ifndef HAVE_DYNAMIC
-            struct bool_entry bool_entries[11];
+            struct bool_entry bool_entries[12];
 #else
-            struct bool_entry bool_entries[10];
+            struct bool_entry bool_entries[11];
 #endif
             START_GROUP(list, list_info, &group_info,
                   msg_hash_to_str(MENU_ENUM_LABEL_VALUE_CORE_SETTINGS), parent_group);
@@ -11103,6 +11123,14 @@ static bool setting_append_list(
                bool_entries[listing].flags      |= SD_FLAG_DEFAULT_VALUE;
             listing++;
 
+            bool_entries[listing].target         = &settings->bools.content_switch_seamless;
+            bool_entries[listing].name_enum_idx  = MENU_ENUM_LABEL_CONTENT_SWITCH_SEAMLESS;
+            bool_entries[listing].SHORT_enum_idx = MENU_ENUM_LABEL_VALUE_CONTENT_SWITCH_SEAMLESS;
+            bool_entries[listing].flags          = SD_FLAG_ADVANCED;
+            if (DEFAULT_CONTENT_SWITCH_SEAMLESS)
+               bool_entries[listing].flags      |= SD_FLAG_DEFAULT_VALUE;
+            listing++;
+
             bool_entries[listing].target         = &settings->bools.load_dummy_on_core_shutdown;
             bool_entries[listing].name_enum_idx  = MENU_ENUM_LABEL_DUMMY_ON_CORE_SHUTDOWN;
             bool_entries[listing].SHORT_enum_idx = MENU_ENUM_LABEL_VALUE_DUMMY_ON_CORE_SHUTDOWN;
@@ -11158,6 +11186,14 @@ static bool setting_append_list(
                bool_entries[listing].flags      |= SD_FLAG_DEFAULT_VALUE;
             listing++;
 
+            bool_entries[listing].target         = &settings->bools.content_patch_cache_enable;
+            bool_entries[listing].name_enum_idx  = MENU_ENUM_LABEL_CONTENT_PATCH_CACHE_ENABLE;
+            bool_entries[listing].SHORT_enum_idx = MENU_ENUM_LABEL_VALUE_CONTENT_PATCH_CACHE_ENABLE;
+            bool_entries[listing].flags          = SD_FLAG_ADVANCED;
+            if (DEFAULT_CONTENT_PATCH_CACHE_ENABLE)
+               bool_entries[listing].flags      |= SD_FLAG_DEFAULT_VALUE;
+            listing++;
+
 #ifndef HAVE_DYNAMIC
             bool_entries[listing].target         = &settings->bools.always_reload_core_on_run_content;
             bool_entries[listing].name_enum_idx  = MENU_ENUM_LABEL_ALWAYS_RELOAD_CORE_ON_RUN_CONTENT;
@@ -11448,6 +11484,21 @@ static bool setting_append_list(
                   general_write_handler,
                   general_read_handler,
                   SD_FLAG_ADVANCED);
+
+            CONFIG_BOOL(
+                  list, list_info,
+                  &settings->bools.frame_timeline_enable,
+                  MENU_ENUM_LABEL_FRAME_TIMELINE_ENABLE,
+                  MENU_ENUM_LABEL_VALUE_FRAME_TIMELINE_ENABLE,
+                  DEFAULT_FRAME_TIMELINE_ENABLE,
+                  MENU_ENUM_LABEL_VALUE_OFF,
+                  MENU_ENUM_LABEL_VALUE_ON,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler,
+                  SD_FLAG_ADVANCED);
          }
          END_SUB_GROUP(list, list_info, parent_group);
          END_GROUP(list, list_info, parent_group);
@@ -11696,6 +11747,21 @@ static bool setting_append_list(
                   general_write_handler,
                   general_read_handler,
                   SD_FLAG_NONE);
+
+            CONFIG_BOOL(
+                  list, list_info,
+                  &settings->bools.replay_checkpoint_flush,
+                  MENU_ENUM_LABEL_REPLAY_CHECKPOINT_FLUSH,
+                  MENU_ENUM_LABEL_VALUE_REPLAY_CHECKPOINT_FLUSH,
+                  DEFAULT_REPLAY_CHECKPOINT_FLUSH,
+                  MENU_ENUM_LABEL_VALUE_OFF,
+                  MENU_ENUM_LABEL_VALUE_ON,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler,
+                  SD_FLAG_NONE);
 #endif
 
             CONFIG_BOOL(
@@ -12088,6 +12154,20 @@ static bool setting_append_list(
             (*list)[list_info->index - 1].offset_by     = 1;
             menu_settings_list_current_add_range(list, list_info, 1, 100, 1, true, true);
 
+            CONFIG_UINT(
+                  list, list_info,
+                  &settings->uints.rewind_disk_buffer_size,
+                  MENU_ENUM_LABEL_REWIND_DISK_BUFFER_SIZE,
+                  MENU_ENUM_LABEL_VALUE_REWIND_DISK_BUFFER_SIZE,
+                  DEFAULT_REWIND_DISK_BUFFER_SIZE,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler);
+            (*list)[list_info->index - 1].action_ok     = &setting_action_ok_uint;
+            menu_settings_list_current_add_range(list, list_info, 0, 65536, 256, true, true);
+
          END_SUB_GROUP(list, list_info, parent_group);
          END_GROUP(list, list_info, parent_group);
          break;
@@ -14040,6 +14120,23 @@ static bool setting_append_list(
             (*list)[list_info->index - 1].action_ok = &setting_action_ok_uint;
             menu_settings_list_current_add_range(list, list_info, MINIMUM_HARD_SYNC_FRAMES, MAXIMUM_HARD_SYNC_FRAMES, 1, true, true);
 
+#ifdef HAVE_KMS
+            CONFIG_BOOL(
+                  list, list_info,
+                  &settings->bools.video_kms_direct_scanout,
+                  MENU_ENUM_LABEL_VIDEO_KMS_DIRECT_SCANOUT,
+                  MENU_ENUM_LABEL_VALUE_VIDEO_KMS_DIRECT_SCANOUT,
+                  DEFAULT_VIDEO_KMS_DIRECT_SCANOUT,
+                  MENU_ENUM_LABEL_VALUE_OFF,
+                  MENU_ENUM_LABEL_VALUE_ON,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler,
+                  SD_FLAG_ADVANCED);
+#endif
+
             if (video_driver_test_all_flags(GFX_CTX_FLAGS_ADAPTIVE_VSYNC))
             {
                CONFIG_BOOL(
@@ -14162,6 +14259,22 @@ static bool setting_append_list(
                   SD_FLAG_NONE
                   );
 
+            CONFIG_BOOL(
+                  list, list_info,
+                  &settings->bools.video_shader_cache_enable,
+                  MENU_ENUM_LABEL_VIDEO_SHADER_CACHE_ENABLE,
+                  MENU_ENUM_LABEL_VALUE_VIDEO_SHADER_CACHE_ENABLE,
+                  DEFAULT_VIDEO_SHADER_CACHE_ENABLE,
+                  MENU_ENUM_LABEL_VALUE_OFF,
+                  MENU_ENUM_LABEL_VALUE_ON,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler,
+                  SD_FLAG_NONE
+                  );
+
             {
 #if defined(HAVE_STEAM) && defined(HAVE_MIST)
                bool on_deck = false;
@@ -15370,6 +15483,23 @@ static bool setting_append_list(
             menu_settings_list_current_add_range(list, list_info, 0, 2, 1, true, true);
             SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_LAKKA_ADVANCED);
 
+#ifdef HAVE_THREADS
+            CONFIG_BOOL(
+                  list, list_info,
+                  &settings->bools.input_joypad_thread,
+                  MENU_ENUM_LABEL_INPUT_JOYPAD_THREAD,
+                  MENU_ENUM_LABEL_VALUE_INPUT_JOYPAD_THREAD,
+                  DEFAULT_INPUT_JOYPAD_THREAD,
+                  MENU_ENUM_LABEL_VALUE_OFF,
+                  MENU_ENUM_LABEL_VALUE_ON,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler,
+                  SD_FLAG_ADVANCED);
+#endif
+
 #ifdef GEKKO
             CONFIG_UINT(
                   list, list_info,
@@ -16505,6 +16635,22 @@ static bool setting_append_list(
                SD_FLAG_NONE
                );
 
+         CONFIG_BOOL(
+               list, list_info,
+               &settings->bools.fastforward_frame_batch,
+               MENU_ENUM_LABEL_FASTFORWARD_FRAME_BATCH,
+               MENU_ENUM_LABEL_VALUE_FASTFORWARD_FRAME_BATCH,
+               DEFAULT_FASTFORWARD_FRAME_BATCH,
+               MENU_ENUM_LABEL_VALUE_OFF,
+               MENU_ENUM_LABEL_VALUE_ON,
+               &group_info,
+               &subgroup_info,
+               parent_group,
+               general_write_handler,
+               general_read_handler,
+               SD_FLAG_ADVANCED
+               );
+
          CONFIG_BOOL(
                list, list_info,
                &settings->bools.vrr_runloop_enable,
@@ -16595,6 +16741,24 @@ static bool setting_append_list(
          (*list)[list_info->index - 1].change_handler = runahead_change_handler;
          menu_settings_list_current_add_range(list, list_info, 1, MAX_RUNAHEAD_FRAMES, 1, true, true);
 
+#if defined(HAVE_THREADS) && (defined(HAVE_DYNAMIC) || defined(HAVE_DYLIB))
+         CONFIG_BOOL(
+               list, list_info,
+               &settings->bools.run_ahead_secondary_thread,
+               MENU_ENUM_LABEL_RUN_AHEAD_SECONDARY_THREAD,
+               MENU_ENUM_LABEL_VALUE_RUN_AHEAD_SECONDARY_THREAD,
+               DEFAULT_RUN_AHEAD_SECONDARY_THREAD,
+               MENU_ENUM_LABEL_VALUE_OFF,
+               MENU_ENUM_LABEL_VALUE_ON,
+               &group_info,
+               &subgroup_info,
+               parent_group,
+               general_write_handler,
+               general_read_handler,
+               SD_FLAG_ADVANCED
+               );
+#endif
+
          CONFIG_BOOL(
                list, list_info,
                &settings->bools.run_ahead_hide_warnings,
@@ -16629,6 +16793,33 @@ static bool setting_append_list(
          menu_settings_list_current_add_range(list, list_info, 1, MAX_RUNAHEAD_FRAMES, 1, true, true);
 #endif
 
+         CONFIG_UINT(
+               list, list_info,
+               &settings->uints.input_predictor,
+               MENU_ENUM_LABEL_INPUT_PREDICTOR,
+               MENU_ENUM_LABEL_VALUE_INPUT_PREDICTOR,
+               DEFAULT_INPUT_PREDICTOR,
+               &group_info,
+               &subgroup_info,
+               parent_group,
+               general_write_handler,
+               general_read_handler);
+         (*list)[list_info->index - 1].ui_type   = ST_UI_TYPE_UINT_COMBOBOX;
+         (*list)[list_info->index - 1].action_ok = &setting_action_ok_uint;
+         (*list)[list_info->index - 1].get_string_representation =
+               &setting_get_string_representation_input_predictor;
+         menu_settings_list_current_add_range(list, list_info,
+               0, GGPO_PREDICT_MODEL_COUNT - 1, 1, true, true);
+
+         CONFIG_ACTION(
+               list, list_info,
+               MENU_ENUM_LABEL_LATENCY_TEST,
+               MENU_ENUM_LABEL_VALUE_LATENCY_TEST,
+               &group_info,
+               &subgroup_info,
+               parent_group);
+         MENU_SETTINGS_LIST_CURRENT_ADD_CMD(list, list_info, CMD_EVENT_LATENCY_TEST);
+
 #ifdef ANDROID
          CONFIG_UINT(
             list, list_info,
@@ -18950,6 +19141,22 @@ static bool setting_append_list(
                general_read_handler,
                SD_FLAG_ADVANCED
                );
+
+         CONFIG_UINT(
+               list, list_info,
+               &settings->uints.threaded_data_runloop_workers,
+               MENU_ENUM_LABEL_THREADED_DATA_RUNLOOP_WORKERS,
+               MENU_ENUM_LABEL_VALUE_THREADED_DATA_RUNLOOP_WORKERS,
+               DEFAULT_THREADED_DATA_RUNLOOP_WORKERS,
+               &group_info,
+               &subgroup_info,
+               parent_group,
+               general_write_handler,
+               general_read_handler);
+         (*list)[list_info->index - 1].ui_type   = ST_UI_TYPE_UINT_SPINBOX;
+         (*list)[list_info->index - 1].action_ok = &setting_action_ok_uint;
+         menu_settings_list_current_add_range(list, list_info, 0, TASK_QUEUE_MAX_WORKERS, 1, true, true);
+         SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ADVANCED);
 #endif
 
          END_SUB_GROUP(list, list_info, parent_group);
@@ -22539,6 +22746,24 @@ static bool setting_append_list(
                SD_FLAG_ADVANCED
                );
 
+#ifdef HAVE_THREADS
+         CONFIG_BOOL(
+               list, list_info,
+               &settings->bools.cheevos_threaded,
+               MENU_ENUM_LABEL_CHEEVOS_THREADED,
+               MENU_ENUM_LABEL_VALUE_CHEEVOS_THREADED,
+               false,
+               MENU_ENUM_LABEL_VALUE_OFF,
+               MENU_ENUM_LABEL_VALUE_ON,
+               &group_info,
+               &subgroup_info,
+               parent_group,
+               general_write_handler,
+               general_read_handler,
+               SD_FLAG_ADVANCED
+               );
+#endif
+
          CONFIG_BOOL(
                list, list_info,
                &settings->bools.cheevos_hardcore_mode_enable,
@@ -22901,6 +23126,23 @@ static bool setting_append_list(
                SD_FLAG_NONE
                );
 
+         CONFIG_UINT(
+               list, list_info,
+               &settings->uints.network_http_concurrent_downloads,
+               MENU_ENUM_LABEL_NETWORK_HTTP_CONCURRENT_DOWNLOADS,
+               MENU_ENUM_LABEL_VALUE_NETWORK_HTTP_CONCURRENT_DOWNLOADS,
+               DEFAULT_NETWORK_HTTP_CONCURRENT_DOWNLOADS,
+               &group_info,
+               &subgroup_info,
+               parent_group,
+               general_write_handler,
+               general_read_handler);
+         (*list)[list_info->index - 1].ui_type   = ST_UI_TYPE_UINT_COMBOBOX;
+         (*list)[list_info->index - 1].action_ok = &setting_action_ok_uint;
+         (*list)[list_info->index - 1].offset_by = 1;
+         menu_settings_list_current_add_range(list, list_info, (*list)[list_info->index - 1].offset_by, 4, 1, true, true);
+         SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ADVANCED);
+
 #ifdef HAVE_UPDATE_CORES
          CONFIG_BOOL(
                list, list_info,
@@ -23564,6 +23806,40 @@ static bool setting_append_list(
             SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ALLOW_INPUT);
             SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ADVANCED);
 
+            CONFIG_UINT(
+                  list, list_info,
+                  &settings->uints.netplay_ggpo_input_fec,
+                  MENU_ENUM_LABEL_NETPLAY_GGPO_INPUT_FEC,
+                  MENU_ENUM_LABEL_VALUE_NETPLAY_GGPO_INPUT_FEC,
+                  DEFAULT_NETPLAY_GGPO_INPUT_FEC,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler);
+            (*list)[list_info->index - 1].ui_type   = ST_UI_TYPE_UINT_SPINBOX;
+            (*list)[list_info->index - 1].action_ok = &setting_action_ok_uint;
+            menu_settings_list_current_add_range(list, list_info, 0, 3, 1, true, true);
+            SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ALLOW_INPUT);
+            SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ADVANCED);
+
+            CONFIG_UINT(
+                  list, list_info,
+                  &settings->uints.netplay_ggpo_drift_correction,
+                  MENU_ENUM_LABEL_NETPLAY_GGPO_DRIFT_CORRECTION,
+                  MENU_ENUM_LABEL_VALUE_NETPLAY_GGPO_DRIFT_CORRECTION,
+                  DEFAULT_NETPLAY_GGPO_DRIFT_CORRECTION,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler);
+            (*list)[list_info->index - 1].ui_type   = ST_UI_TYPE_UINT_SPINBOX;
+            (*list)[list_info->index - 1].action_ok = &setting_action_ok_uint;
+            menu_settings_list_current_add_range(list, list_info, 0, 5, 1, true, true);
+            SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ALLOW_INPUT);
+            SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ADVANCED);
+
             CONFIG_UINT(
                   list, list_info,
                   &settings->uints.netplay_ggpo_prediction_frames,
@@ -23577,10 +23853,90 @@ static bool setting_append_list(
                   general_read_handler);
             (*list)[list_info->index - 1].ui_type   = ST_UI_TYPE_UINT_SPINBOX;
             (*list)[list_info->index - 1].action_ok = &setting_action_ok_uint;
-            menu_settings_list_current_add_range(list, list_info, 0, 8, 1, true, true);
+            menu_settings_list_current_add_range(list, list_info, 0, 32, 1, true, true);
+            SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ALLOW_INPUT);
+            SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ADVANCED);
+
+            CONFIG_UINT(
+                  list, list_info,
+                  &settings->uints.netplay_ggpo_keyframe_interval,
+                  MENU_ENUM_LABEL_NETPLAY_GGPO_KEYFRAME_INTERVAL,
+                  MENU_ENUM_LABEL_VALUE_NETPLAY_GGPO_KEYFRAME_INTERVAL,
+                  DEFAULT_NETPLAY_GGPO_KEYFRAME_INTERVAL,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler);
+            (*list)[list_info->index - 1].ui_type   = ST_UI_TYPE_UINT_SPINBOX;
+            (*list)[list_info->index - 1].action_ok = &setting_action_ok_uint;
+            menu_settings_list_current_add_range(list, list_info, 0, 16, 1, true, true);
+            SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ALLOW_INPUT);
+            SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ADVANCED);
+
+            CONFIG_UINT(
+                  list, list_info,
+                  &settings->uints.netplay_ggpo_checksum_interval,
+                  MENU_ENUM_LABEL_NETPLAY_GGPO_CHECKSUM_INTERVAL,
+                  MENU_ENUM_LABEL_VALUE_NETPLAY_GGPO_CHECKSUM_INTERVAL,
+                  DEFAULT_NETPLAY_GGPO_CHECKSUM_INTERVAL,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler);
+            (*list)[list_info->index - 1].ui_type   = ST_UI_TYPE_UINT_SPINBOX;
+            (*list)[list_info->index - 1].action_ok = &setting_action_ok_uint;
+            menu_settings_list_current_add_range(list, list_info, 0, 600, 1, true, true);
             SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ALLOW_INPUT);
             SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ADVANCED);
 
+            CONFIG_BOOL(
+                  list, list_info,
+                  &settings->bools.netplay_ggpo_replay_crossfade,
+                  MENU_ENUM_LABEL_NETPLAY_GGPO_REPLAY_CROSSFADE,
+                  MENU_ENUM_LABEL_VALUE_NETPLAY_GGPO_REPLAY_CROSSFADE,
+                  DEFAULT_NETPLAY_GGPO_REPLAY_CROSSFADE,
+                  MENU_ENUM_LABEL_VALUE_OFF,
+                  MENU_ENUM_LABEL_VALUE_ON,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler,
+                  SD_FLAG_ADVANCED);
+
+            CONFIG_UINT(
+                  list, list_info,
+                  &settings->uints.netplay_ggpo_audio_splice_frames,
+                  MENU_ENUM_LABEL_NETPLAY_GGPO_AUDIO_SPLICE_FRAMES,
+                  MENU_ENUM_LABEL_VALUE_NETPLAY_GGPO_AUDIO_SPLICE_FRAMES,
+                  DEFAULT_NETPLAY_GGPO_AUDIO_SPLICE_FRAMES,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler);
+            (*list)[list_info->index - 1].ui_type   = ST_UI_TYPE_UINT_SPINBOX;
+            (*list)[list_info->index - 1].action_ok = &setting_action_ok_uint;
+            menu_settings_list_current_add_range(list, list_info, 0, NETPLAY_GGPO_SPLICE_MAX_FRAMES, 1, true, true);
+            SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ADVANCED);
+
+            CONFIG_BOOL(
+                  list, list_info,
+                  &settings->bools.netplay_ggpo_network_thread,
+                  MENU_ENUM_LABEL_NETPLAY_GGPO_NETWORK_THREAD,
+                  MENU_ENUM_LABEL_VALUE_NETPLAY_GGPO_NETWORK_THREAD,
+                  DEFAULT_NETPLAY_GGPO_NETWORK_THREAD,
+                  MENU_ENUM_LABEL_VALUE_OFF,
+                  MENU_ENUM_LABEL_VALUE_ON,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler,
+                  SD_FLAG_ADVANCED);
+
             CONFIG_UINT(
                   list, list_info,
                   &settings->uints.netplay_ggpo_network_delay,
@@ -38,6 +38,11 @@
 /* TODO/FIXME - static public global variable */
 static unsigned uint_user_language;
 
+/* What msg_hash_to_str() returned for each enum, in
+ * msg_hash_table_language; NULL where not looked up yet */
+static const char *msg_hash_table[MSG_LAST];
+static unsigned msg_hash_table_language = RETRO_LANGUAGE_LAST;
+
 int msg_hash_get_help_enum(enum msg_hash_enums msg, char *s, size_t len)
 {
    int ret = msg_hash_get_help_us_enum(msg, s, len);
@@ -566,7 +571,7 @@ static const char *msg_hash_to_str_ga(enum msg_hash_enums msg)
 }
 #endif
 
-const char *msg_hash_to_str(enum msg_hash_enums msg)
+static const char *msg_hash_lookup(enum msg_hash_enums msg)
 {
    const char *ret = NULL;
 
@@ -689,6 +694,35 @@ const char *msg_hash_to_str(enum msg_hash_enums msg)
    return msg_hash_to_str_us(msg);
 }
 
+/* Menus ask for every visible label each frame; past the first time,
+ * that is a table read instead of the language's switch and the
+ * fallback to English */
+const char *msg_hash_to_str(enum msg_hash_enums msg)
+{
+   const char *ret;
+
+   if ((unsigned)msg >= MSG_LAST)
+      return msg_hash_lookup(msg);
+
+   /* The language is also set through msg_hash_get_uint() */
+   if (msg_hash_table_language != uint_user_language)
+   {
+      memset((void*)msg_hash_table, 0, sizeof(msg_hash_table));
+      msg_hash_table_language = uint_user_language;
+   }
+
+   if ((ret = msg_hash_table[msg]))
+      return ret;
+
+   ret = msg_hash_lookup(msg);
+   /* These labels share one buffer, rewritten by each lookup */
+   if (     msg >= MENU_ENUM_LABEL_INPUT_HOTKEY_BIND_BEGIN
+         && msg <= MENU_ENUM_LABEL_INPUT_HOTKEY_BIND_END)
+      return ret;
+   msg_hash_table[msg] = ret;
+   return ret;
+}
+
 uint32_t msg_hash_calculate(const char *s)
 {
    return djb2_calculate(s);
@@ -217,6 +217,8 @@ enum msg_hash_enums
    MSG_NETPLAY_DIFFERENT_CORE_VERSIONS,
    MSG_NETPLAY_ENDIAN_DEPENDENT,
    MSG_NETPLAY_PLATFORM_DEPENDENT,
+   MSG_NETPLAY_GGPO_DESYNC,
+   MSG_NETPLAY_GGPO_INPUT_LAYOUT_MISMATCH,
    MSG_NETPLAY_ENTER_PASSWORD,
    MSG_NETPLAY_ENTER_CHAT,
    MSG_NETPLAY_INCORRECT_PASSWORD,
@@ -871,6 +873,9 @@ enum msg_hash_enums
    MENU_ENUM_LABEL_VALUE_RUNAHEAD_MODE_SECOND_INSTANCE,
    MENU_ENUM_LABEL_VALUE_RUNAHEAD_MODE_PREEMPTIVE_FRAMES,
 
+   MENU_ENUM_LABEL_VALUE_INPUT_PREDICTOR_REPEAT,
+   MENU_ENUM_LABEL_VALUE_INPUT_PREDICTOR_HOLD,
+
    MENU_LABEL(CHEEVOS_UNLOCKED_ENTRY),
    MENU_LABEL(CHEEVOS_UNLOCKED_ENTRY_HARDCORE),
    MENU_LABEL(CHEEVOS_LOCKED_ENTRY),
@@ -1406,6 +1411,7 @@ enum msg_hash_enums
    MENU_LABEL(MENU_INPUT_SWAP_OK_CANCEL),
    MENU_LABEL(MENU_INPUT_SWAP_SCROLL),
    MENU_LBL_H(INPUT_POLL_TYPE_BEHAVIOR),
+   MENU_LABEL(INPUT_JOYPAD_THREAD),
    MENU_LABEL(RUNAHEAD_MODE),
 #if !(defined(HAVE_DYNAMIC) || defined(HAVE_DYLIB))
    MENU_ENUM_SUBLABEL_RUNAHEAD_MODE_NO_SECOND_INSTANCE,
@@ -1468,6 +1474,7 @@ enum msg_hash_enums
    MENU_LABEL(VIDEO_ADAPTIVE_VSYNC),
    MENU_LABEL(VIDEO_HARD_SYNC),
    MENU_LBL_H(VIDEO_HARD_SYNC_FRAMES),
+   MENU_LABEL(VIDEO_KMS_DIRECT_SCANOUT),
    MENU_LABEL(VIDEO_WINDOWED_FULLSCREEN),
    MENU_LABEL(VIDEO_AUTOSWITCH_REFRESH_RATE),
    MENU_LABEL(VIDEO_AUTOSWITCH_PAL_THRESHOLD),
@@ -1524,6 +1531,7 @@ enum msg_hash_enums
 
    MENU_LABEL(VIDEO_SHARED_CONTEXT),
    MENU_LABEL(DRIVER_SWITCH_ENABLE),
+   MENU_LABEL(CONTENT_SWITCH_SEAMLESS),
    MENU_LBL_H(VIDEO_THREADED),
 
    MENU_LABEL(VIDEO_SWAP_INTERVAL),
@@ -1615,6 +1623,7 @@ enum msg_hash_enums
    MENU_LABEL(NAVIGATION_WRAPAROUND),
    MENU_LABEL(SHOW_ADVANCED_SETTINGS),
    MENU_LABEL(THREADED_DATA_RUNLOOP_ENABLE),
+   MENU_LABEL(THREADED_DATA_RUNLOOP_WORKERS),
    MENU_LABEL(XMB_ALPHA_FACTOR),
    MENU_LABEL(XMB_CURRENT_MENU_ICON),
    MENU_LABEL(MENU_FONT_COLOR_RED),
@@ -1948,6 +1957,7 @@ enum msg_hash_enums
    MENU_LABEL(CHEEVOS_UNLOCK_SOUND_ENABLE),
    MENU_LABEL(CHEEVOS_AUTO_SCREENSHOT),
    MENU_LABEL(CHEEVOS_START_ACTIVE),
+   MENU_LABEL(CHEEVOS_THREADED),
    MENU_LABEL(CHEEVOS_CHALLENGE_INDICATORS),
    MENU_LABEL(CHEEVOS_ENABLE),
    MENU_LABEL(CHEEVOS_DESCRIPTION),
@@ -2414,6 +2424,7 @@ enum msg_hash_enums
    MENU_LABEL(REWIND_GRANULARITY),
    MENU_LABEL(REWIND_BUFFER_SIZE),
    MENU_LABEL(REWIND_BUFFER_SIZE_STEP),
+   MENU_LABEL(REWIND_DISK_BUFFER_SIZE),
    /* TODO/FIXME: INPUT_META_REWIND is incorrectly defined;
     * the LABEL/SUBLABEL enums should be entered 'manually',
     * like all the other hotkeys. Moreover, the resultant
@@ -2547,7 +2558,14 @@ enum msg_hash_enums
    MENU_LABEL(NETPLAY_GGPO_LZ4_ACCEL),
    MENU_LABEL(NETPLAY_GGPO_SEND_INTERVAL),
    MENU_LABEL(NETPLAY_GGPO_MAX_INPUT_BITS),
+   MENU_LABEL(NETPLAY_GGPO_INPUT_FEC),
+   MENU_LABEL(NETPLAY_GGPO_DRIFT_CORRECTION),
    MENU_LABEL(NETPLAY_GGPO_PREDICTION_FRAMES),
+   MENU_LABEL(NETPLAY_GGPO_KEYFRAME_INTERVAL),
+   MENU_LABEL(NETPLAY_GGPO_CHECKSUM_INTERVAL),
+   MENU_LABEL(NETPLAY_GGPO_REPLAY_CROSSFADE),
+   MENU_LABEL(NETPLAY_GGPO_AUDIO_SPLICE_FRAMES),
+   MENU_LABEL(NETPLAY_GGPO_NETWORK_THREAD),
    MENU_LABEL(NETPLAY_GGPO_NETWORK_DELAY),
    MENU_LABEL(NETPLAY_GGPO_OOP_PERCENT),
    MENU_LABEL(NETPLAY_SPECTATOR_MODE_ENABLE), /* deprecated */
@@ -2584,6 +2602,7 @@ enum msg_hash_enums
    MENU_LABEL(NETPLAY_SPECTATE_PASSWORD),
    MENU_LABEL(NETPLAY_MODE), /* deprecated */
    MENU_LABEL(PERFCNT_ENABLE),
+   MENU_LABEL(FRAME_TIMELINE_ENABLE),
    MENU_LABEL(OVERLAY_SCALE_LANDSCAPE),
    MENU_LABEL(OVERLAY_ASPECT_ADJUST_LANDSCAPE),
    MENU_LABEL(OVERLAY_X_SEPARATION_LANDSCAPE),
@@ -2611,6 +2630,7 @@ enum msg_hash_enums
 
    MENU_LBL_H(FASTFORWARD_RATIO),
    MENU_LABEL(FASTFORWARD_FRAMESKIP),
+   MENU_LABEL(FASTFORWARD_FRAME_BATCH),
    MENU_LBL_H(VRR_RUNLOOP_ENABLE),
    MENU_LABEL(REWIND_ENABLE),
    MENU_LABEL(CHEAT_APPLY_AFTER_TOGGLE),
@@ -2632,6 +2652,7 @@ enum msg_hash_enums
    MENU_LBL_H(AUTOSAVE_INTERVAL),
    MENU_LBL_H(REPLAY_CHECKPOINT_INTERVAL),
    MENU_LBL_H(REPLAY_CHECKPOINT_DESERIALIZE),
+   MENU_LABEL(REPLAY_CHECKPOINT_FLUSH),
    MENU_LBL_H(CONFIG_SAVE_ON_EXIT),
    MENU_LABEL(REMAP_SAVE_ON_EXIT),
    MENU_LABEL(CONFIGURATION_LIST),
@@ -2828,6 +2849,9 @@ enum msg_hash_enums
    MENU_LABEL(SLOWMOTION_RATIO),
    MENU_LABEL(RUN_AHEAD_UNSUPPORTED),
    MENU_LABEL(RUN_AHEAD_HIDE_WARNINGS),
+   MENU_LABEL(RUN_AHEAD_SECONDARY_THREAD),
+   MENU_LABEL(INPUT_PREDICTOR),
+   MENU_LABEL(LATENCY_TEST),
    MENU_LABEL(RUN_AHEAD_FRAMES),
    MENU_LABEL(PREEMPT_FRAMES),
    MENU_LABEL(INPUT_BLOCK_TIMEOUT),
@@ -3040,6 +3064,7 @@ enum msg_hash_enums
    MENU_LABEL(CORE_INFO_SAVESTATE_BYPASS),
    MENU_LABEL(CORE_OPTION_CATEGORY_ENABLE),
    MENU_LABEL(CORE_INFO_CACHE_ENABLE),
+   MENU_LABEL(CONTENT_PATCH_CACHE_ENABLE),
 #ifndef HAVE_DYNAMIC
    MENU_LABEL(ALWAYS_RELOAD_CORE_ON_RUN_CONTENT),
 #endif
@@ -3076,6 +3101,7 @@ enum msg_hash_enums
    MENU_LABEL(CORE_UPDATER_SHOW_EXPERIMENTAL_CORES),
    MENU_LABEL(CORE_UPDATER_AUTO_BACKUP),
    MENU_LABEL(CORE_UPDATER_AUTO_BACKUP_HISTORY_SIZE),
+   MENU_LABEL(NETWORK_HTTP_CONCURRENT_DOWNLOADS),
    MENU_LABEL(CORE_UPDATER_BUILDBOT_URL),
    MENU_LABEL(BUILDBOT_ASSETS_URL),
    MENU_LABEL(CORE_SET_SUPPORTS_NO_CONTENT_ENABLE),
@@ -3150,6 +3176,9 @@ enum msg_hash_enums
    MSG_EXTRACTING_CORE,
    MSG_CORE_INSTALLED,
    MSG_CORE_INSTALL_FAILED,
+   MSG_CHD_VERIFYING,
+   MSG_CHD_VERIFIED,
+   MSG_CHD_VERIFY_FAILED,
    MSG_SCANNING_CORES,
    MSG_CHECKING_CORE,
    MSG_ALL_CORES_UPDATED,
@@ -3229,6 +3258,7 @@ enum msg_hash_enums
    MENU_LBL_H(SHADER_APPLY_CHANGES),
    MENU_LBL_H(SHADER_WATCH_FOR_CHANGES),
    MENU_LABEL(VIDEO_SHADER_REMEMBER_LAST_DIR),
+   MENU_LABEL(VIDEO_SHADER_CACHE_ENABLE),
 
    MENU_ENUM_LABEL_MESSAGE,
    MENU_ENUM_LABEL_INFO_SCREEN,
@@ -3371,6 +3401,11 @@ enum msg_hash_enums
    MSG_PLAYLIST_MANAGER_CLEANING_PLAYLIST,
    MSG_PLAYLIST_MANAGER_PLAYLIST_CLEANED,
 
+   MENU_LABEL(PLAYLIST_MANAGER_BUILD_THUMBNAIL_PACK),
+
+   MSG_PLAYLIST_MANAGER_BUILDING_THUMBNAIL_PACK,
+   MSG_PLAYLIST_MANAGER_THUMBNAIL_PACK_BUILT,
+
    MENU_LABEL(PLAYLIST_MANAGER_REFRESH_PLAYLIST),
 
    MSG_PLAYLIST_MANAGER_REFRESH_MISSING_CONFIG,
@@ -148,6 +148,7 @@ bool natt_device_next(struct natt_discovery *discovery,
    *device->control      = '\0';
    *device->service_type = '\0';
    device->busy          = false;
+   device->pmp           = false;
 
    recvd = recvfrom(discovery->fd, buf, sizeof(buf), 0,
       (struct sockaddr*)&addr, &addr_size);
@@ -223,6 +224,239 @@ void natt_device_end(struct natt_discovery *discovery)
    }
 }
 
+/* NAT-PMP (RFC 6886) */
+#define NATT_PMP_PORT        5351
+#define NATT_PMP_TRIES       2
+#define NATT_PMP_TIMEOUT     250000
+/* Mappings aren't renewed, so ask for one that outlasts any session */
+#define NATT_PMP_LIFETIME    86400
+
+bool natt_pmp_gateway(struct sockaddr_in *gateway)
+{
+   bool ret = false;
+#if defined(__linux__)
+   char line[256];
+   FILE *fp;
+
+   if (!gateway)
+      return false;
+
+   if (!(fp = fopen("/proc/net/route", "r")))
+      return false;
+
+   /* The entry with destination 0 and the gateway flag;
+      addresses are printed as the raw network order word. */
+   while (!ret && fgets(line, sizeof(line), fp))
+   {
+      char iface[64];
+      unsigned long dest, gw, flags;
+
+      if (sscanf(line, "%63s %lx %lx %lx", iface, &dest, &gw, &flags) != 4)
+         continue;
+      if (dest || !gw || !(flags & 0x2))
+         continue;
+
+      memset(gateway, 0, sizeof(*gateway));
+      gateway->sin_family      = AF_INET;
+      gateway->sin_addr.s_addr = (uint32_t)gw;
+      ret = true;
+   }
+
+   fclose(fp);
+#endif
+
+   return ret;
+}
+
+bool natt_pmp_init(struct natt_device *device,
+   const struct sockaddr_in *gateway)
+{
+   int fd;
+   struct sockaddr_in addr;
+
+   if (!device || !gateway)
+      return false;
+
+   addr          = *gateway;
+   addr.sin_port = htons(NATT_PMP_PORT);
+
+   fd = socket_create("natt_pmp",
+      SOCKET_DOMAIN_INET, SOCKET_TYPE_DATAGRAM, SOCKET_PROTOCOL_UDP);
+   if (fd < 0)
+      return false;
+
+   /* Connected, so only the gateway's replies get through. */
+   if (     connect(fd, (struct sockaddr*)&addr, sizeof(addr))
+         || !socket_nonblock(fd))
+   {
+      socket_close(fd);
+      return false;
+   }
+
+   memset(device, 0, sizeof(*device));
+   device->addr        = *gateway;
+   device->pmp_fd      = fd;
+   device->pmp_timeout = -1;
+   device->pmp         = true;
+
+   return true;
+}
+
+static bool natt_pmp_send(struct natt_device *device, size_t len)
+{
+   if (device->pmp_fd < 0)
+      return false;
+
+   /* A send that would block is retried with the others. */
+   if (send(device->pmp_fd, (const char*)device->pmp_msg, len, 0) < 0
+         && !isagain(-1))
+      return false;
+
+   device->pmp_len     = len;
+   device->pmp_tries   = 1;
+   device->pmp_timeout = cpu_features_get_time_usec() + NATT_PMP_TIMEOUT;
+
+   return true;
+}
+
+static bool natt_pmp_map(struct natt_device *device,
+   struct natt_request *request, uint32_t lifetime)
+{
+   uint8_t  *msg = device->pmp_msg;
+   uint16_t port;
+
+   if (!request || !request->addr.sin_port)
+      return false;
+
+   port             = ntohs(request->addr.sin_port);
+   request->success = false;
+
+   msg[0]  = 0;
+   msg[1]  = (request->proto == SOCKET_PROTOCOL_UDP) ? 1 : 2;
+   msg[2]  = 0;
+   msg[3]  = 0;
+   msg[4]  = (uint8_t)(port >> 8);
+   msg[5]  = (uint8_t)port;
+   /* Removal wants the suggested external port to be 0 */
+   msg[6]  = lifetime ? (uint8_t)(port >> 8) : 0;
+   msg[7]  = lifetime ? (uint8_t)port        : 0;
+   msg[8]  = (uint8_t)(lifetime >> 24);
+   msg[9]  = (uint8_t)(lifetime >> 16);
+   msg[10] = (uint8_t)(lifetime >> 8);
+   msg[11] = (uint8_t)lifetime;
+
+   return natt_pmp_send(device, 12);
+}
+
+bool natt_pmp_external_address(struct natt_device *device)
+{
+   if (!device)
+      return false;
+
+   memset(&device->ext_addr, 0, sizeof(device->ext_addr));
+   device->pmp_msg[0] = 0;
+   device->pmp_msg[1] = 0;
+
+   return natt_pmp_send(device, 2);
+}
+
+bool natt_pmp_open_port(struct natt_device *device,
+   struct natt_request *request)
+{
+   if (!device)
+      return false;
+
+   return natt_pmp_map(device, request, NATT_PMP_LIFETIME);
+}
+
+bool natt_pmp_close_port(struct natt_device *device,
+   struct natt_request *request)
+{
+   if (!device)
+      return false;
+
+   return natt_pmp_map(device, request, 0);
+}
+
+bool natt_pmp_poll(struct natt_device *device,
+   struct natt_request *request)
+{
+   uint8_t buf[16];
+   ssize_t recvd;
+
+   if (!device || device->pmp_fd < 0 || !device->pmp_len)
+      return false;
+
+   recvd = recv(device->pmp_fd, (char*)buf, sizeof(buf), 0);
+   if (recvd < 0)
+   {
+      retro_time_t now;
+
+      if (!isagain((int)recvd))
+         return false;
+
+      now = cpu_features_get_time_usec();
+      if (now < device->pmp_timeout)
+         return true;
+      if (device->pmp_tries >= NATT_PMP_TRIES)
+         return false;
+
+      /* Retransmit, doubling the wait each time. */
+      send(device->pmp_fd, (const char*)device->pmp_msg,
+         device->pmp_len, 0);
+      device->pmp_timeout = now
+         + ((retro_time_t)NATT_PMP_TIMEOUT << device->pmp_tries);
+      device->pmp_tries++;
+
+      return true;
+   }
+
+   /* Not a reply to what we've sent; keep waiting. */
+   if (recvd < 4 || buf[0] || buf[1] != (128 | device->pmp_msg[1]))
+      return true;
+
+   /* The gateway turned us down. */
+   if (buf[2] || buf[3])
+      return false;
+
+   if (!device->pmp_msg[1])
+   {
+      if (recvd < 12)
+         return true;
+
+      device->ext_addr.sin_family = AF_INET;
+      memcpy(&device->ext_addr.sin_addr, buf + 8,
+         sizeof(device->ext_addr.sin_addr));
+   }
+   else
+   {
+      if (recvd < 16 || !request)
+         return true;
+      if (memcmp(buf + 8, device->pmp_msg + 4, 2))
+         return true;
+
+      request->addr.sin_port = htons((uint16_t)((buf[10] << 8) | buf[11]));
+      request->success       = true;
+   }
+
+   device->pmp_len = 0;
+
+   return true;
+}
+
+void natt_pmp_end(struct natt_device *device)
+{
+   if (device)
+   {
+      if (device->pmp_fd >= 0)
+         socket_close(device->pmp_fd);
+
+      device->pmp_fd      = -1;
+      device->pmp_len     = 0;
+      device->pmp_timeout = -1;
+   }
+}
+
 static bool natt_build_control_url(
       rxml_node_t *control_url,
       struct natt_device *device)
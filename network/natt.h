@@ -31,6 +31,10 @@ enum natt_forward_type
 /* Use this enum to implement a higher-level interface. */
 enum nat_traversal_status
 {
+   NAT_TRAVERSAL_STATUS_PMP_DISCOVERY,
+   NAT_TRAVERSAL_STATUS_PMP_EXTERNAL_ADDRESS,
+   NAT_TRAVERSAL_STATUS_PMP_OPEN,
+   NAT_TRAVERSAL_STATUS_PMP_OPENING,
    NAT_TRAVERSAL_STATUS_DISCOVERY,
    NAT_TRAVERSAL_STATUS_SELECT_DEVICE,
    NAT_TRAVERSAL_STATUS_QUERY_DEVICE,
@@ -58,6 +62,13 @@ struct natt_device
    char desc        [256];
    char control     [256];
    char service_type[256];
+   /* NAT-PMP: the last request, kept for retransmission. */
+   retro_time_t pmp_timeout;
+   size_t pmp_len;
+   int pmp_fd;
+   unsigned pmp_tries;
+   uint8_t pmp_msg[12];
+   bool pmp;
    bool busy;
 };
 
@@ -86,6 +97,7 @@ struct nat_traversal_data
    unsigned close_index;
    uint16_t announce_port;
    bool announce_ready;
+   bool discovering;
 };
 
 /**
@@ -124,6 +136,98 @@ bool natt_device_next(struct natt_discovery *discovery,
  */
 void natt_device_end(struct natt_discovery *discovery);
 
+/**
+ * natt_pmp_gateway:
+ *
+ * @gateway : Pointer to an address that will be written to.
+ *
+ * Looks up the default gateway, where a NAT-PMP server would listen.
+ *
+ * Returns: true if a gateway was found.
+ */
+bool natt_pmp_gateway(struct sockaddr_in *gateway);
+
+/**
+ * natt_pmp_init:
+ *
+ * @device  : Pointer to a device object that will be written to.
+ * @gateway : Address of the gateway to talk to.
+ *
+ * Opens a NAT-PMP (RFC 6886) channel to a gateway. Unlike UPnP,
+ * each request is a single datagram and its answer; no discovery
+ * or description fetch is needed.
+ *
+ * Returns: true if the channel was opened.
+ */
+bool natt_pmp_init(struct natt_device *device,
+   const struct sockaddr_in *gateway);
+
+/**
+ * natt_pmp_external_address:
+ *
+ * @device : Pointer to a NAT-PMP device.
+ *
+ * Asks the gateway for its external address.
+ * Follow with natt_pmp_poll.
+ *
+ * Returns: true if the request was sent.
+ */
+bool natt_pmp_external_address(struct natt_device *device);
+
+/**
+ * natt_pmp_open_port:
+ *
+ * @device  : Pointer to a NAT-PMP device.
+ * @request : Port forwarding request information.
+ *
+ * Asks the gateway to forward a port.
+ * Follow with natt_pmp_poll.
+ *
+ * Returns: true if the request was sent.
+ */
+bool natt_pmp_open_port(struct natt_device *device,
+   struct natt_request *request);
+
+/**
+ * natt_pmp_close_port:
+ *
+ * @device  : Pointer to a NAT-PMP device.
+ * @request : Port unforwarding request information.
+ *
+ * Asks the gateway to drop a forwarded port. The answer
+ * needn't be waited for.
+ *
+ * Returns: true if the request was sent.
+ */
+bool natt_pmp_close_port(struct natt_device *device,
+   struct natt_request *request);
+
+/**
+ * natt_pmp_poll:
+ *
+ * @device  : Pointer to a NAT-PMP device.
+ * @request : The request being forwarded, or NULL for
+ *            natt_pmp_external_address.
+ *
+ * Checks for the gateway's answer, retransmitting as needed.
+ *
+ * Returns: true if the answer was received or if timeout has not
+ * yet been reached. If device->ext_addr.sin_family is AF_INET, or
+ * request->success is true, the request completed successfully;
+ * request->addr.sin_port is then the external port.
+ */
+bool natt_pmp_poll(struct natt_device *device,
+   struct natt_request *request);
+
+/**
+ * natt_pmp_end:
+ *
+ * @device : Pointer to a NAT-PMP device.
+ *
+ * Closes the channel to the gateway.
+ */
+void natt_pmp_end(struct natt_device *device);
+
 /**
  * natt_query_device:
  *
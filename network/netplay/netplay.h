@@ -64,6 +64,50 @@ struct netplay_fork_args
 };
 #endif
 
+/* Most core frames of audio the GGPO splice buffer holds back */
+#define NETPLAY_GGPO_SPLICE_MAX_FRAMES 8
+
+#ifdef HAVE_GGPO
+#define NETPLAY_GGPO_RESOLVE_PEER       0
+#define NETPLAY_GGPO_RESOLVE_RENDEZVOUS 1
+#define NETPLAY_GGPO_RESOLVE_RELAY      2
+#define NETPLAY_GGPO_RESOLVE_CANDIDATE  3 /* first of the relay candidates */
+#define NETPLAY_GGPO_RESOLVE_MAX        11
+
+/* Host names looked up by task_push_netplay_ggpo_resolve, off the main
+ * thread where tasks are threaded. Empty hosts are skipped; addr is NULL
+ * wherever a lookup failed. */
+struct netplay_ggpo_resolve
+{
+   struct addrinfo *addr[NETPLAY_GGPO_RESOLVE_MAX];
+   unsigned next;
+   uint16_t port[NETPLAY_GGPO_RESOLVE_MAX];
+   char host[NETPLAY_GGPO_RESOLVE_MAX][NETPLAY_HOST_LONGSTR_LEN];
+};
+
+void netplay_ggpo_resolve_free(struct netplay_ggpo_resolve *resolve);
+
+/* GGPO's decoded states around a desync, written out together with a
+ * per-block hash report by task_push_netplay_ggpo_desync_dump. base is
+ * the last sample both peers agreed on, or NULL. The task frees it. */
+struct netplay_ggpo_desync_dump
+{
+   uint8_t *state;
+   uint8_t *base;
+   size_t state_size;
+   size_t base_size;
+   int frame;
+   int base_frame;
+   int player;
+   uint32_t local_checksum;
+   uint32_t remote_checksum;
+   unsigned step;
+   char path[PATH_MAX_LENGTH]; /* without extension */
+};
+
+void netplay_ggpo_desync_dump_free(struct netplay_ggpo_desync_dump *dump);
+#endif
+
 struct netplay_room
 {
    struct netplay_room *next;
@@ -92,6 +136,7 @@ struct netplay_room
    char rendezvous_room[NETPLAY_HOST_STR_LEN];
    char ggpo_relay_server[NETPLAY_HOST_LONGSTR_LEN];
    char ggpo_relay_session[NETPLAY_HOST_STR_LEN];
+   char ggpo_relays[NETPLAY_HOST_LONGSTR_LEN];
    bool has_password;
    bool has_spectate_password;
    bool connectable;
@@ -106,6 +151,13 @@ struct netplay_rooms
 {
    struct netplay_room *head;
    struct netplay_room *cur;
+   /* Ids the lobby removed since the delta's base version */
+   int *removed;
+   size_t removed_count;
+   size_t removed_size;
+   /* Lobby list version; set with delta when this is only the changes */
+   char version[32];
+   bool delta;
 };
 
 struct netplay_host
@@ -158,6 +210,9 @@ typedef struct
    struct netplay_room host_room;
    struct netplay_room *room_list;
    struct netplay_rooms *rooms_data;
+   /* Lobby rooms as of lobby_version, kept so a refresh only fetches
+    * what changed since */
+   struct netplay_room *lobby_rooms;
    struct retro_netpacket_callback *core_netpacket_interface;
    /* Used while Netplay is running */
    netplay_t *data;
@@ -169,14 +224,24 @@ typedef struct
    int lan_ad_client_fd;
 #endif
    int room_count;
+   int lobby_room_count;
    int latest_ping;
-   int ggpo_stats_ping;
+   /* Per-frame time spent merging shared devices' input, over the
+    * last stats window (classic netplay) */
+   uint32_t merge_us_avg;
+   uint32_t merge_us_max;
+   int ggpo_stats_ping_us;
    int ggpo_stats_send_queue_len;
    int ggpo_stats_recv_queue_len;
    int ggpo_stats_kbps_sent;
    int ggpo_stats_local_frames_behind;
    int ggpo_stats_remote_frames_behind;
+   int ggpo_stats_drift_x100;
    uint32_t ggpo_stats_rollback_frames;
+   uint32_t ggpo_stats_replay_saved_us;
+   /* How long after the previous frame ended local input is latched */
+   uint32_t ggpo_stats_latch_us;
+   uint32_t ggpo_stats_delay_frames;
    bool ggpo_stats_valid;
    uint32_t ggpo_state_size;
    uint32_t ggpo_state_save_us;
@@ -198,10 +263,33 @@ typedef struct
    uint32_t ggpo_compress_job_queue_max;
    uint32_t ggpo_compress_result_queue_max;
    bool ggpo_compress_stats_valid;
+   uint32_t ggpo_setup_resolve_ms;
+   uint32_t ggpo_setup_exchange_ms;
+   uint32_t ggpo_setup_session_ms;
+   uint32_t ggpo_setup_sync_ms;
+   bool ggpo_setup_token;
+   /* The session fell back from UDP to the control channel */
+   bool ggpo_setup_tunnel;
+   bool ggpo_setup_stats_valid;
+   /* Rollback depth from --netplay-synctest; non-zero runs the core under
+    * GGPO's sync test instead of a session */
+   unsigned ggpo_synctest_frames;
+   /* Relay broadcast from --netplay-spectate; non-empty runs the core as
+    * a spectator of it instead of a player */
+   char ggpo_spectate_session[NETPLAY_HOST_STR_LEN * 2];
+   /* Relay broadcast from --netplay-broadcast, which a player's session
+    * feeds for spectators */
+   char ggpo_broadcast_session[NETPLAY_HOST_STR_LEN * 2];
    unsigned server_port_deferred;
    uint8_t flags;
    char server_address_deferred[256];
    char server_session_deferred[32];
+   /* Relays offered by the lobby room being joined, as name=addr:port;... */
+   char ggpo_relay_list[NETPLAY_HOST_LONGSTR_LEN];
+   /* Lobby pairing token for the GGPO relay or rendezvous server; a host's
+    * comes with its announcement, a client's from the room's /join. */
+   char ggpo_token[NETPLAY_HOST_STR_LEN * 2];
+   char lobby_version[32];
 } net_driver_state_t;
 
 net_driver_state_t *networking_state_get_ptr(void);
@@ -214,6 +302,19 @@ int netplay_rooms_parse(const char *buf, size_t len);
 int netplay_rooms_get_count(void);
 struct netplay_room *netplay_room_get(int index);
 void netplay_rooms_free(void);
+void netplay_rooms_data_free(struct netplay_rooms *rooms);
+int netplay_rooms_merge_lobby(const struct netplay_rooms *data);
+
+/* Incremental room list parsing, for tasks */
+struct netplay_rooms_parser;
+struct netplay_rooms_parser *netplay_rooms_parser_new(const char *buf,
+      size_t len, bool filter);
+int netplay_rooms_parser_step(struct netplay_rooms_parser *parser,
+      unsigned events);
+struct netplay_rooms *netplay_rooms_parser_take(
+      struct netplay_rooms_parser *parser);
+void netplay_rooms_parser_free(struct netplay_rooms_parser *parser);
+bool netplay_lobby_join_query(int room_id);
 
 /**
  * init_netplay
@@ -71,6 +71,7 @@ enum rarch_netplay_ctl_state
    RARCH_NETPLAY_CTL_RESET,
    RARCH_NETPLAY_CTL_DISCONNECT,
    RARCH_NETPLAY_CTL_FINISHED_NAT_TRAVERSAL,
+   RARCH_NETPLAY_CTL_FINISHED_GGPO_RESOLVE,
    RARCH_NETPLAY_CTL_DESYNC_PUSH,
    RARCH_NETPLAY_CTL_DESYNC_POP,
    RARCH_NETPLAY_CTL_KICK_CLIENT,
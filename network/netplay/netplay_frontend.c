@@ -35,10 +35,18 @@
 #include <net/net_socket.h>
 #include <net/net_http.h>
 #include <file/file_path.h>
+#include <streams/file_stream.h>
+#include <file/config_file.h>
 #include <encodings/crc32.h>
 #include <encodings/base64.h>
 #include <features/features_cpu.h>
+#include <memalign.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 #include <lrc_hash.h>
+#define XXH_INLINE_ALL
+#include <xxHash/xxhash.h>
 #ifdef HAVE_LZ4
 #include <lz4.h>
 #endif
@@ -85,6 +93,10 @@
 
 #include "netplay_private.h"
 
+#ifdef HAVE_BSV_MOVIE
+#include "../../input/bsv/bsvmovie.h"
+#endif
+
 #ifdef HAVE_GGPO
 #include <ggponet.h>
 #define GGPO_INPUT_MAX_BYTES 15
@@ -95,6 +107,17 @@
 #define GGPO_RELAY_MAGIC "RARELAY1"
 #define GGPO_RELAY_RETRY_USEC 1000000
 #define GGPO_RELAY_MAX_MSG 256
+#define GGPO_RELAY_PROBE_COUNT 4
+#define GGPO_RELAY_PROBE_INTERVAL_USEC 100000
+#define GGPO_RELAY_PROBE_WAIT_USEC 300000
+#define GGPO_RELAY_LIST_WAIT_USEC 10000000
+#define GGPO_RELAY_RTT_MAX_MS 999
+#define GGPO_RELAY_NOTE_MAX 48
+/* Registrations a server may leave unanswered before the pairing token is
+ * taken for one it does not understand */
+#define GGPO_TOKEN_UNANSWERED_SENDS 2
+/* Longest a spectator waits for the next frame's inputs each iteration */
+#define GGPO_SPECTATE_WAIT_MS 4
 #ifndef DEFAULT_NETPLAY_RENDEZVOUS_PORT
 #define DEFAULT_NETPLAY_RENDEZVOUS_PORT 7000
 #endif
@@ -187,6 +210,15 @@ static bool netplay_mitm_session_requested(const mitm_id_t *id)
 #endif
 
 #define GGPO_STATE_LOG_INTERVAL_USEC 1000000
+/* Length of the fade-in applied to the first live audio after a rollback. */
+#define GGPO_REPLAY_CROSSFADE_FRAMES 64
+/* Length of the crossfade into spliced audio, in audio frames. */
+#define GGPO_SPLICE_CROSSFADE_FRAMES 128
+/* Memory map regions worth compressing apart, and how many are kept. */
+#define GGPO_STATE_REGION_MIN (64 * 1024)
+#define GGPO_STATE_REGIONS_MAX 16
+/* Bytes of a region matched to find it in the state */
+#define GGPO_STATE_REGION_PROBE 64
 
 static void netplay_free_state_bases(struct netplay_connection *connection);
 static bool netplay_resize_state_buffers(netplay_t *netplay, size_t state_size);
@@ -235,11 +267,6 @@ struct mode_payload
    char     nick[NETPLAY_NICK_LEN];
 };
 
-struct vote_count
-{
-   uint16_t votes[32];
-};
-
 const mitm_server_t netplay_mitm_server_list[NETPLAY_MITM_SERVERS] = {
    { "nyc",       MENU_ENUM_LABEL_VALUE_NETPLAY_MITM_SERVER_LOCATION_1 },
    { "madrid",    MENU_ENUM_LABEL_VALUE_NETPLAY_MITM_SERVER_LOCATION_2 },
@@ -270,8 +297,15 @@ static void netplay_ggpo_rendezvous_close(netplay_t *netplay);
 static bool netplay_ggpo_relay_start(netplay_t *netplay, uint16_t port);
 static bool netplay_ggpo_relay_poll(netplay_t *netplay);
 static void netplay_ggpo_relay_close(netplay_t *netplay);
+static bool netplay_ggpo_bringup_start(netplay_t *netplay,
+      const char *server);
 static bool netplay_ggpo_pre_frame(netplay_t *netplay);
 static void netplay_ggpo_post_frame(netplay_t *netplay);
+static void netplay_ggpo_tunnel_recv(netplay_t *netplay,
+      struct netplay_connection *connection, const void *data, size_t len);
+static void netplay_ggpo_splice_tag(struct netplay_ggpo_audio_splice *splice);
+static void netplay_ggpo_splice_begin_replay(netplay_t *netplay);
+static void netplay_ggpo_splice_free(netplay_t *netplay);
 static int16_t netplay_input_state_ggpo(netplay_t *netplay,
       unsigned port, unsigned device, unsigned idx, unsigned id);
 #endif
@@ -282,6 +316,11 @@ static int16_t netplay_input_state_ggpo(netplay_t *netplay,
 #define NETPLAYSTATE_MEM_BLOCK "MEM "
 #define NETPLAYSTATE_CHEEVOS_BLOCK "ACHV"
 #define NETPLAYSTATE_END_BLOCK "END "
+#define NETPLAYSTATE_PAD_BLOCK "PAD "
+/* A core state with a stable layout starts on, and the blocks after it
+ * start past, a boundary of this size, so frame to frame deltas (GGPO
+ * codes them in 256-byte blocks) see the core's blocks and ours apart. */
+#define NETPLAYSTATE_CORE_ALIGN 256
 
 #ifdef HAVE_NETPLAYDISCOVERY
 /** Initialize Netplay discovery (client) */
@@ -799,6 +838,7 @@ static bool netplay_init_socket_buffer(struct socket_buffer *sbuf, size_t len)
       return false;
    sbuf->bufsz = len;
    sbuf->start = sbuf->read = sbuf->end = 0;
+   sbuf->copied = sbuf->direct = 0;
 
    return true;
 }
@@ -2214,6 +2254,71 @@ static void netplay_apply_delta(uint8_t *dst, const uint8_t *base,
       dst[i] = base[i] ^ delta[i];
 }
 
+/* Packs the blocks of @current that differ from @base as a bitmap of
+ * changed blocks followed by the XOR of each changed block.
+ * @dst must hold @size plus the bitmap. Returns the packed size. */
+static size_t netplay_pack_block_delta(uint8_t *dst, const uint8_t *current,
+      const uint8_t *base, size_t size)
+{
+   size_t i;
+   size_t map_size = NETPLAY_STATE_BLOCKS_MAP_SIZE(size);
+   size_t packed   = map_size;
+
+   memset(dst, 0, map_size);
+
+   for (i = 0; i * NETPLAY_STATE_BLOCK_SIZE < size; i++)
+   {
+      size_t offset = i * NETPLAY_STATE_BLOCK_SIZE;
+      size_t len    = size - offset;
+
+      if (len > NETPLAY_STATE_BLOCK_SIZE)
+         len = NETPLAY_STATE_BLOCK_SIZE;
+
+      if (!memcmp(current + offset, base + offset, len))
+         continue;
+
+      dst[i >> 3] |= (uint8_t)(1 << (i & 7));
+      netplay_xor_delta(dst + packed, current + offset, base + offset, len);
+      packed += len;
+   }
+
+   return packed;
+}
+
+static bool netplay_unpack_block_delta(uint8_t *dst, const uint8_t *base,
+      const uint8_t *delta, size_t delta_size, size_t size)
+{
+   size_t i;
+   size_t map_size = NETPLAY_STATE_BLOCKS_MAP_SIZE(size);
+   size_t packed   = map_size;
+
+   if (delta_size < map_size)
+      return false;
+
+   for (i = 0; i * NETPLAY_STATE_BLOCK_SIZE < size; i++)
+   {
+      size_t offset = i * NETPLAY_STATE_BLOCK_SIZE;
+      size_t len    = size - offset;
+
+      if (len > NETPLAY_STATE_BLOCK_SIZE)
+         len = NETPLAY_STATE_BLOCK_SIZE;
+
+      if (!(delta[i >> 3] & (1 << (i & 7))))
+      {
+         memcpy(dst + offset, base + offset, len);
+         continue;
+      }
+
+      if (delta_size - packed < len)
+         return false;
+
+      netplay_apply_delta(dst + offset, base + offset, delta + packed, len);
+      packed += len;
+   }
+
+   return packed == delta_size;
+}
+
 static void netplay_free_state_bases(struct netplay_connection *connection)
 {
    free(connection->state_base_send);
@@ -2255,10 +2360,11 @@ static bool netplay_resize_state_bases(netplay_t *netplay, size_t state_size)
 /**
  * netplay_delta_frame_crc
  *
- * Get the CRC for the serialization of this frame.
+ * Get the hash for the serialization of this frame, with the algorithm
+ * agreed with the peer.
  */
 static uint32_t netplay_delta_frame_crc(netplay_t *netplay,
-      struct delta_frame *delta)
+      struct delta_frame *delta, enum netplay_state_hash hash)
 {
    const uint8_t* input;
 
@@ -2266,6 +2372,8 @@ static uint32_t netplay_delta_frame_crc(netplay_t *netplay,
    input = netplay_get_savestate_coremem(netplay,
       (const uint8_t*)delta->state);
 
+   if (hash == NETPLAY_STATE_HASH_XXH3)
+      return (uint32_t)XXH3_64bits(input, netplay->coremem_size);
    return encoding_crc32(0L, input, netplay->coremem_size);
 }
 
@@ -2296,7 +2404,7 @@ static void netplay_delta_frame_free(struct delta_frame *delta)
 
    if (delta->state)
    {
-      free(delta->state);
+      memalign_free_large(delta->state);
       delta->state = NULL;
    }
 
@@ -2401,44 +2509,107 @@ static uint32_t netplay_expected_input_size(netplay_t *netplay,
 }
 
 #ifdef HAVE_GGPO
+static unsigned netplay_ggpo_bit_count(uint32_t bits)
+{
+   unsigned count = 0;
+   for (; bits; bits &= bits - 1)
+      count++;
+   return count;
+}
+
+/**
+ * netplay_ggpo_declared_input
+ *
+ * The joypad buttons and analog axes the core has input descriptors
+ * for on either port. Both peers run the same core on the same two
+ * ports, so they come to the same set.
+ */
+static void netplay_ggpo_declared_input(unsigned port_a, unsigned port_b,
+      uint16_t *buttons, uint8_t *axes)
+{
+   unsigned i, p;
+   unsigned ports[2];
+   rarch_system_info_t *sys_info = &runloop_state_get_ptr()->system;
+
+   ports[0] = port_a;
+   ports[1] = port_b;
+   *buttons = 0;
+   *axes    = 0;
+
+   for (p = 0; p < 2; p++)
+   {
+      const char **desc = sys_info->input_desc_btn[ports[p]];
+      for (i = 0; i <= RETRO_DEVICE_ID_JOYPAD_R3; i++)
+         if (desc[i])
+            *buttons |= 1 << i;
+      /* X+ and X- of a stick share a descriptor, as do Y+ and Y- */
+      for (i = 0; i < 4; i++)
+         if (desc[RARCH_ANALOG_LEFT_X_PLUS + i * 2])
+            *axes |= 1 << i;
+   }
+}
+
+static void netplay_ggpo_port_layout(netplay_t *netplay, unsigned port,
+      uint16_t buttons, uint8_t axes)
+{
+   struct netplay_ggpo_layout *layout = &netplay->ggpo_layout[port];
+   unsigned dtype = netplay->config_devices[port] & RETRO_DEVICE_MASK;
+
+   layout->words  = netplay_expected_input_size(netplay, 1 << port);
+   layout->size   = layout->words * sizeof(uint32_t);
+   layout->packed = false;
+
+   if (dtype == RETRO_DEVICE_JOYPAD)
+      axes = 0;
+   else if (dtype != RETRO_DEVICE_ANALOG)
+      return;
+   /* A core without descriptors gets the whole device */
+   if (!buttons && !axes)
+      return;
+
+   layout->buttons = buttons;
+   layout->axes    = axes;
+   layout->size    = (netplay_ggpo_bit_count(buttons) + 7) / 8
+      + netplay_ggpo_bit_count(axes) * sizeof(int16_t);
+   layout->packed  = true;
+}
+
 static bool netplay_ggpo_init_input_layout(netplay_t *netplay,
       unsigned local_device_port, unsigned remote_device_port)
 {
-   uint32_t size_local  = 0;
-   uint32_t size_remote = 0;
-   uint32_t max_words   = 0;
+   struct netplay_ggpo_layout *local;
+   struct netplay_ggpo_layout *remote;
+   uint16_t buttons = 0;
+   uint8_t axes     = 0;
 
    if (!netplay)
       return false;
 
-   memset(netplay->ggpo_device_offsets, 0, sizeof(netplay->ggpo_device_offsets));
-   memset(netplay->ggpo_device_words, 0, sizeof(netplay->ggpo_device_words));
+   memset(netplay->ggpo_layout, 0, sizeof(netplay->ggpo_layout));
+   netplay->ggpo_buttons_read    = 0;
+   netplay->ggpo_layout_mismatch = false;
 
    if (local_device_port >= MAX_INPUT_DEVICES ||
-       remote_device_port >= MAX_INPUT_DEVICES)
+       remote_device_port >= MAX_INPUT_DEVICES ||
+       local_device_port >= MAX_USERS ||
+       remote_device_port >= MAX_USERS)
       return false;
 
-   size_local  = netplay_expected_input_size(netplay, 1 << local_device_port);
-   size_remote = netplay_expected_input_size(netplay, 1 << remote_device_port);
+   netplay_ggpo_declared_input(local_device_port, remote_device_port,
+         &buttons, &axes);
+   netplay_ggpo_port_layout(netplay, local_device_port, buttons, axes);
+   netplay_ggpo_port_layout(netplay, remote_device_port, buttons, axes);
+   local  = &netplay->ggpo_layout[local_device_port];
+   remote = &netplay->ggpo_layout[remote_device_port];
 
-   if (!size_local || !size_remote)
+   if (!local->words || !remote->words)
    {
       RARCH_ERR("[Netplay] GGPO input layout is empty or unsupported.\n");
       return false;
    }
 
-   max_words = (size_local > size_remote) ? size_local : size_remote;
-
-   netplay->ggpo_device_offsets[local_device_port]  = 0;
-   netplay->ggpo_device_offsets[remote_device_port] = 0;
-   netplay->ggpo_device_words[local_device_port]    = size_local;
-   netplay->ggpo_device_words[remote_device_port]   = size_remote;
-
-   netplay->ggpo_input_words = max_words;
-   netplay->ggpo_input_size  = max_words * sizeof(uint32_t);
-
-   if (!netplay->ggpo_input_size)
-      return false;
+   /* Every player sends the same size */
+   netplay->ggpo_input_size = MAX(local->size, remote->size);
 
    if (netplay->ggpo_input_size > GGPO_INPUT_MAX_BYTES)
    {
@@ -2448,10 +2619,91 @@ static bool netplay_ggpo_init_input_layout(netplay_t *netplay,
       return false;
    }
 
+   netplay->ggpo_buttons_known = (local->packed || remote->packed)
+      ? buttons : 0xFFFF;
+   if (local->packed || remote->packed)
+      RARCH_LOG("[GGPO] Input layout: %u bytes a frame, buttons 0x%04X, "
+            "axes 0x%X, as the core declares.\n",
+            (unsigned)netplay->ggpo_input_size, buttons, axes);
+   else
+      RARCH_LOG("[GGPO] Input layout: %u bytes a frame.\n",
+            (unsigned)netplay->ggpo_input_size);
+
    return true;
 }
 
-static void netplay_ggpo_collect_local_input(netplay_t *netplay, uint32_t *input)
+/* Input comes zeroed, so only the bits that are set are written */
+static void netplay_ggpo_pack_input(const struct netplay_ggpo_layout *layout,
+      const uint32_t *state, uint8_t *input)
+{
+   unsigned i;
+   unsigned bit = 0;
+
+   if (!layout->packed)
+   {
+      memcpy(input, state, layout->size);
+      return;
+   }
+
+   for (i = 0; i <= RETRO_DEVICE_ID_JOYPAD_R3; i++)
+   {
+      if (!(layout->buttons & (1 << i)))
+         continue;
+      if (state[0] & (1U << i))
+         input[bit >> 3] |= (uint8_t)(1 << (bit & 7));
+      bit++;
+   }
+   input += (bit + 7) >> 3;
+
+   for (i = 0; i < 4; i++)
+   {
+      uint16_t value;
+      if (!(layout->axes & (1 << i)))
+         continue;
+      value    = (uint16_t)(state[1 + (i >> 1)] >> ((i & 1) * 16));
+      *input++ = (uint8_t)value;
+      *input++ = (uint8_t)(value >> 8);
+   }
+}
+
+static void netplay_ggpo_unpack_input(
+      const struct netplay_ggpo_layout *layout,
+      const uint8_t *input, uint32_t *state)
+{
+   unsigned i;
+   unsigned bit = 0;
+
+   memset(state, 0, NETPLAY_GGPO_DEVICE_WORDS * sizeof(uint32_t));
+
+   if (!layout->packed)
+   {
+      memcpy(state, input, layout->size);
+      return;
+   }
+
+   for (i = 0; i <= RETRO_DEVICE_ID_JOYPAD_R3; i++)
+   {
+      if (!(layout->buttons & (1 << i)))
+         continue;
+      if (input[bit >> 3] & (1 << (bit & 7)))
+         state[0] |= 1U << i;
+      bit++;
+   }
+   input += (bit + 7) >> 3;
+
+   for (i = 0; i < 4; i++)
+   {
+      uint32_t value;
+      if (!(layout->axes & (1 << i)))
+         continue;
+      value = (uint32_t)input[0] | ((uint32_t)input[1] << 8);
+      state[1 + (i >> 1)] |= value << ((i & 1) * 16);
+      input += 2;
+   }
+}
+
+static void netplay_ggpo_collect_local_input(netplay_t *netplay,
+      uint32_t devices, uint32_t *input)
 {
    unsigned port;
    retro_input_state_t cb = netplay->cbs.state_cb;
@@ -2464,21 +2716,21 @@ static void netplay_ggpo_collect_local_input(netplay_t *netplay, uint32_t *input
    for (port = 0; port < MAX_INPUT_DEVICES; port++)
    {
       unsigned dtype;
-      uint32_t *state;
+      uint32_t state[NETPLAY_GGPO_DEVICE_WORDS];
       unsigned i;
       unsigned input_port = port;
 
-      if (!(netplay->ggpo_local_devices & (1U << port)))
+      if (!(devices & (1U << port)))
          continue;
 
-      if (!netplay->ggpo_device_words[port])
+      if (!netplay->ggpo_layout[port].words)
          continue;
 
       if (swap_input)
          input_port = 0;
 
       dtype = netplay->config_devices[port] & RETRO_DEVICE_MASK;
-      state = input + netplay->ggpo_device_offsets[port];
+      memset(state, 0, sizeof(state));
 
       switch (dtype)
       {
@@ -2532,7 +2784,7 @@ static void netplay_ggpo_collect_local_input(netplay_t *netplay, uint32_t *input
                   {
                      bit = 0;
                      word++;
-                     if (word >= netplay->ggpo_device_words[port])
+                     if (word >= netplay->ggpo_layout[port].words)
                         break;
                   }
                }
@@ -2542,6 +2794,10 @@ static void netplay_ggpo_collect_local_input(netplay_t *netplay, uint32_t *input
          default:
             break;
       }
+
+      /* Each player sends one device, at the start of its input */
+      netplay_ggpo_pack_input(&netplay->ggpo_layout[port], state,
+            (uint8_t*)input);
    }
 }
 
@@ -2549,8 +2805,8 @@ static int16_t netplay_input_state_ggpo(netplay_t *netplay,
       unsigned port, unsigned device,
       unsigned idx, unsigned id)
 {
-   const uint32_t *curr_input_state = NULL;
-   uint32_t *player_inputs          = NULL;
+   uint32_t curr_input_state[NETPLAY_GGPO_DEVICE_WORDS];
+   const uint8_t *player_inputs     = NULL;
    uint32_t player_index            = 0;
    uint32_t words                   = 0;
 
@@ -2572,7 +2828,7 @@ static int16_t netplay_input_state_ggpo(netplay_t *netplay,
          return 0;
    }
 
-   words = netplay->ggpo_device_words[port];
+   words = netplay->ggpo_layout[port].words;
    if (!words)
       return 0;
 
@@ -2583,15 +2839,18 @@ static int16_t netplay_input_state_ggpo(netplay_t *netplay,
    else
       return 0;
 
-   player_inputs = netplay->ggpo_sync_inputs +
-      (player_index * netplay->ggpo_input_words);
-   curr_input_state = player_inputs + netplay->ggpo_device_offsets[port];
+   player_inputs = (const uint8_t*)netplay->ggpo_sync_inputs
+      + player_index * netplay->ggpo_input_size;
+   netplay_ggpo_unpack_input(&netplay->ggpo_layout[port], player_inputs,
+         curr_input_state);
 
    switch (device)
    {
       case RETRO_DEVICE_JOYPAD:
          if (id == RETRO_DEVICE_ID_JOYPAD_MASK)
             return curr_input_state[0];
+         if (id <= RETRO_DEVICE_ID_JOYPAD_R3)
+            netplay->ggpo_buttons_read |= 1U << id;
          return ((1U << id) & curr_input_state[0]) ? 1 : 0;
 
       case RETRO_DEVICE_ANALOG:
@@ -2647,6 +2906,114 @@ static bool netplay_ggpo_relay_enabled(void)
    return settings->bools.netplay_use_ggpo_relay;
 }
 
+/* A sync test or spectator node runs alone: no peer, lobby or
+ * control channel. */
+static bool netplay_ggpo_standalone(void)
+{
+   return networking_driver_st.ggpo_synctest_frames
+      || !string_is_empty(networking_driver_st.ggpo_spectate_session);
+}
+
+/* The GGPO relay's numeric address and port, which relay broadcasts
+ * are sent to. Looked up in place; only --netplay-broadcast and
+ * --netplay-spectate need it. */
+static bool netplay_ggpo_broadcast_relay(char *ip, size_t len,
+      uint16_t *port)
+{
+   settings_t *settings  = config_get_ptr();
+   const char *server    = settings->paths.netplay_ggpo_relay_server;
+   struct addrinfo *addr = NULL;
+   struct addrinfo hints = {0};
+   char port_buf[6];
+
+   *port = (uint16_t)settings->uints.netplay_ggpo_relay_port;
+   if (!*port)
+      *port = DEFAULT_NETPLAY_GGPO_RELAY_PORT;
+
+   if (string_is_empty(server))
+   {
+      RARCH_ERR("[Netplay] GGPO relay broadcasts require a relay server.\n");
+      return false;
+   }
+
+   snprintf(port_buf, sizeof(port_buf), "%hu", (unsigned short)*port);
+   hints.ai_family   = AF_INET;
+   hints.ai_socktype = SOCK_DGRAM;
+   hints.ai_flags   |= AI_NUMERICSERV;
+
+   if (getaddrinfo_retro(server, port_buf, &hints, &addr) || !addr)
+   {
+      RARCH_ERR("[Netplay] GGPO failed to resolve relay: %s\n", server);
+      return false;
+   }
+
+   if (getnameinfo_retro(addr->ai_addr, addr->ai_addrlen,
+         ip, len, NULL, 0, NI_NUMERICHOST))
+      strlcpy(ip, server, len);
+
+   freeaddrinfo_retro(addr);
+   return true;
+}
+
+/* Lets a spectator run unthrottled; once it has caught up, the inputs
+ * arriving pace it. */
+static void netplay_ggpo_spectator_fastforward(bool enable)
+{
+   runloop_state_t *runloop_st = runloop_state_get_ptr();
+
+   runloop_st->fastmotion_override.next.ratio          = 0.0f;
+   runloop_st->fastmotion_override.next.fastforward    = enable;
+   runloop_st->fastmotion_override.next.notification   = false;
+   runloop_st->fastmotion_override.next.inhibit_toggle = enable;
+   runloop_st->fastmotion_override.pending             = true;
+}
+
+/* The lobby's pairing token, while it names this session and side and no
+ * server has turned it down. */
+static const char *netplay_ggpo_token(netplay_t *netplay, const char *session)
+{
+   net_driver_state_t *net_st = &networking_driver_st;
+   const char *token          = net_st->ggpo_token;
+   size_t _len                = strlen(session);
+
+   if (netplay->ggpo_token_dropped || string_is_empty(token))
+      return NULL;
+   if (     strncmp(token, session, _len)
+         || token[_len]     != '.'
+         || token[_len + 1] != (netplay->is_server ? '1' : '2')
+         || token[_len + 2] != '.')
+      return NULL;
+   return token;
+}
+
+static void netplay_ggpo_token_drop(netplay_t *netplay, const char *why)
+{
+   if (netplay->ggpo_token_dropped)
+      return;
+   RARCH_WARN("[Netplay] GGPO pairing token %s, registering without it.\n",
+         why);
+   netplay->ggpo_token_dropped = true;
+}
+
+/* Picks the token for the next registration, giving up on it once a
+ * server has ignored a few. */
+static const char *netplay_ggpo_token_next(netplay_t *netplay,
+      const char *session)
+{
+   const char *token = netplay_ggpo_token(netplay, session);
+
+   if (!token)
+      return NULL;
+   if (     !netplay->ggpo_token_answered
+         && netplay->ggpo_token_sends >= GGPO_TOKEN_UNANSWERED_SENDS)
+   {
+      netplay_ggpo_token_drop(netplay, "went unanswered");
+      return NULL;
+   }
+   netplay->ggpo_token_sends++;
+   return token;
+}
+
 static bool netplay_ggpo_rendezvous_parse_peer(const char *buf,
       char *peer_address, size_t peer_address_size, uint16_t *peer_port)
 {
@@ -2669,7 +3036,7 @@ static bool netplay_ggpo_rendezvous_parse_peer(const char *buf,
 }
 
 static bool netplay_ggpo_rendezvous_send(int fd, struct addrinfo *addr,
-      bool is_server, const char *room)
+      bool is_server, const char *room, const char *token)
 {
    char msg[GGPO_RENDEZVOUS_MAX_MSG];
    char role = is_server ? 'H' : 'C';
@@ -2678,8 +3045,12 @@ static bool netplay_ggpo_rendezvous_send(int fd, struct addrinfo *addr,
    if (!addr || string_is_empty(room))
       return false;
 
-   msg_len = snprintf(msg, sizeof(msg), "%s %c %s",
-         GGPO_RENDEZVOUS_MAGIC, role, room);
+   if (token)
+      msg_len = snprintf(msg, sizeof(msg), "%s T %s",
+            GGPO_RENDEZVOUS_MAGIC, token);
+   else
+      msg_len = snprintf(msg, sizeof(msg), "%s %c %s",
+            GGPO_RENDEZVOUS_MAGIC, role, room);
    if (msg_len <= 0 || msg_len >= (int)sizeof(msg))
       return false;
 
@@ -2773,7 +3144,7 @@ static bool netplay_ggpo_rendezvous_resolve_peer(char *peer_address,
 
       if (now >= next_send)
       {
-         netplay_ggpo_rendezvous_send(fd, addr, false, room);
+         netplay_ggpo_rendezvous_send(fd, addr, false, room, NULL);
          next_send = now + GGPO_RENDEZVOUS_RETRY_USEC;
       }
 
@@ -2804,12 +3175,97 @@ static bool netplay_ggpo_rendezvous_resolve_peer(char *peer_address,
    return false;
 }
 
+void netplay_ggpo_resolve_free(struct netplay_ggpo_resolve *resolve)
+{
+   unsigned i;
+
+   if (!resolve)
+      return;
+
+   for (i = 0; i < NETPLAY_GGPO_RESOLVE_MAX; i++)
+      if (resolve->addr[i])
+         freeaddrinfo_retro(resolve->addr[i]);
+   free(resolve);
+}
+
+void netplay_ggpo_desync_dump_free(struct netplay_ggpo_desync_dump *dump)
+{
+   if (!dump)
+      return;
+
+   free(dump->state);
+   free(dump->base);
+   free(dump);
+}
+
+static bool netplay_ggpo_resolve_push(netplay_t *netplay,
+      struct netplay_ggpo_resolve *resolve)
+{
+   netplay->ggpo_resolve = resolve;
+   if (task_push_netplay_ggpo_resolve(resolve))
+      return true;
+
+   netplay->ggpo_resolve = NULL;
+   netplay_ggpo_resolve_free(resolve);
+   return false;
+}
+
+/* Takes one finished lookup over from netplay->ggpo_resolved. */
+static struct addrinfo *netplay_ggpo_resolved_take(netplay_t *netplay,
+      unsigned slot)
+{
+   struct addrinfo *addr;
+
+   if (!netplay->ggpo_resolved)
+      return NULL;
+
+   addr = netplay->ggpo_resolved->addr[slot];
+   netplay->ggpo_resolved->addr[slot] = NULL;
+   if (!addr)
+      RARCH_ERR("[Netplay] GGPO failed to resolve host: %s\n",
+            netplay->ggpo_resolved->host[slot]);
+   return addr;
+}
+
+static void netplay_ggpo_resolved_done(netplay_t *netplay)
+{
+   netplay_ggpo_resolve_free(netplay->ggpo_resolved);
+   netplay->ggpo_resolved = NULL;
+}
+
+/* GGPO later resolves these again; numeric ones cost nothing. */
+static void netplay_ggpo_addr_to_ip(const struct addrinfo *addr,
+      char *ip, size_t ip_size)
+{
+   if (getnameinfo_retro(addr->ai_addr, addr->ai_addrlen,
+         ip, ip_size, NULL, 0, NI_NUMERICHOST))
+      ip[0] = '\0';
+}
+
+static int netplay_ggpo_open_udp(uint16_t local_port)
+{
+   struct addrinfo *bind_addr = NULL;
+   int fd = socket_init((void**)&bind_addr, local_port, NULL,
+         SOCKET_TYPE_DATAGRAM, AF_INET);
+
+   if (fd < 0 || !bind_addr ||
+         !socket_bind(fd, bind_addr) ||
+         !socket_nonblock(fd))
+   {
+      if (fd >= 0)
+         socket_close(fd);
+      fd = -1;
+   }
+   if (bind_addr)
+      freeaddrinfo_retro(bind_addr);
+   return fd;
+}
+
 static bool netplay_ggpo_rendezvous_start(netplay_t *netplay, uint16_t port)
 {
    settings_t *settings = config_get_ptr();
    const char *server = settings->paths.netplay_rendezvous_server;
    const char *room = settings->paths.netplay_rendezvous_room;
-   uint16_t server_port = (uint16_t)settings->uints.netplay_rendezvous_port;
    uint16_t local_port = port;
 
    if (!netplay || !netplay_ggpo_rendezvous_enabled())
@@ -2821,14 +3277,17 @@ static bool netplay_ggpo_rendezvous_start(netplay_t *netplay, uint16_t port)
       return false;
    }
 
-   if (!server_port)
-      server_port = DEFAULT_NETPLAY_RENDEZVOUS_PORT;
-
    if (!netplay->is_server)
       local_port = (uint16_t)(port + 1);
 
-   if (!netplay_ggpo_rendezvous_open_socket(local_port, server, server_port,
-         &netplay->ggpo_rendezvous_fd, &netplay->ggpo_rendezvous_addr))
+   netplay->ggpo_rendezvous_addr = netplay_ggpo_resolved_take(netplay,
+         NETPLAY_GGPO_RESOLVE_RENDEZVOUS);
+   netplay_ggpo_resolved_done(netplay);
+   if (!netplay->ggpo_rendezvous_addr)
+      return false;
+
+   netplay->ggpo_rendezvous_fd = netplay_ggpo_open_udp(local_port);
+   if (netplay->ggpo_rendezvous_fd < 0)
    {
       RARCH_ERR("[Netplay] GGPO rendezvous failed to open socket.\n");
       netplay_ggpo_rendezvous_close(netplay);
@@ -2861,7 +3320,8 @@ static bool netplay_ggpo_rendezvous_poll(netplay_t *netplay)
    if (now >= netplay->ggpo_rendezvous_next_send)
    {
       netplay_ggpo_rendezvous_send(netplay->ggpo_rendezvous_fd,
-            netplay->ggpo_rendezvous_addr, netplay->is_server, room);
+            netplay->ggpo_rendezvous_addr, netplay->is_server, room,
+            netplay_ggpo_token_next(netplay, room));
       netplay->ggpo_rendezvous_next_send = now + GGPO_RENDEZVOUS_RETRY_USEC;
    }
 
@@ -2884,6 +3344,14 @@ static bool netplay_ggpo_rendezvous_poll(netplay_t *netplay)
          netplay_ggpo_rendezvous_close(netplay);
          return true;
       }
+      if (string_starts_with(buf, "WAIT "))
+         netplay->ggpo_token_answered = true;
+      else if (string_starts_with(buf, "ERR ")
+            && netplay_ggpo_token(netplay, room))
+      {
+         netplay_ggpo_token_drop(netplay, "was refused");
+         netplay->ggpo_rendezvous_next_send = 0;
+      }
    }
 
    return false;
@@ -2911,7 +3379,7 @@ static void netplay_ggpo_rendezvous_close(netplay_t *netplay)
 }
 
 static bool netplay_ggpo_relay_send(int fd, struct addrinfo *addr,
-      bool is_server, const char *session)
+      bool is_server, const char *session, const char *token)
 {
    char msg[GGPO_RELAY_MAX_MSG];
    int slot = is_server ? 1 : 2;
@@ -2920,63 +3388,421 @@ static bool netplay_ggpo_relay_send(int fd, struct addrinfo *addr,
    if (!addr || string_is_empty(session))
       return false;
 
-   msg_len = snprintf(msg, sizeof(msg), "%s HELLO %s %d",
-         GGPO_RELAY_MAGIC, session, slot);
+   if (token)
+      msg_len = snprintf(msg, sizeof(msg), "%s TOKEN %s",
+            GGPO_RELAY_MAGIC, token);
+   else
+      msg_len = snprintf(msg, sizeof(msg), "%s HELLO %s %d",
+            GGPO_RELAY_MAGIC, session, slot);
    if (msg_len <= 0 || msg_len >= (int)sizeof(msg))
       return false;
 
    return sendto(fd, msg, msg_len, 0, addr->ai_addr, addr->ai_addrlen) == msg_len;
 }
 
-static bool netplay_ggpo_relay_open_socket(uint16_t local_port,
-      const char *server, uint16_t server_port, int *out_fd,
-      struct addrinfo **out_addr)
+static bool netplay_ggpo_relay_same_addr(const struct sockaddr_storage *from,
+      const struct addrinfo *addr)
 {
-   struct addrinfo *bind_addr = NULL;
-   struct addrinfo hints = {0};
-   char port_buf[6];
-   int fd = -1;
+   const struct sockaddr_in *a = (const struct sockaddr_in*)from;
+   const struct sockaddr_in *b;
 
-   if (string_is_empty(server) || !out_fd || !out_addr)
+   if (!addr || from->ss_family != AF_INET || addr->ai_family != AF_INET)
       return false;
+   b = (const struct sockaddr_in*)addr->ai_addr;
+   return a->sin_port == b->sin_port
+      && a->sin_addr.s_addr == b->sin_addr.s_addr;
+}
 
-   fd = socket_init((void**)&bind_addr, local_port, NULL,
-         SOCKET_TYPE_DATAGRAM, AF_INET);
-   if (fd < 0 || !bind_addr)
-      goto error;
-
-   if (!socket_bind(fd, bind_addr))
-      goto error;
+/* Both peers must be offered the same list; they compare this hash. */
+static uint32_t netplay_ggpo_relay_list_hash(const char *list)
+{
+   uint32_t hash = 2166136261u;
 
-   freeaddrinfo_retro(bind_addr);
-   bind_addr = NULL;
+   while (*list)
+   {
+      hash ^= (uint8_t)*list++;
+      hash *= 16777619u;
+   }
+   return hash;
+}
 
-   if (!socket_nonblock(fd))
-      goto error;
+static const char *netplay_ggpo_relay_list(netplay_t *netplay)
+{
+   net_driver_state_t *net_st = &networking_driver_st;
 
-   snprintf(port_buf, sizeof(port_buf), "%hu", (unsigned short)server_port);
-   hints.ai_family = AF_INET;
-   hints.ai_socktype = SOCK_DGRAM;
-   hints.ai_flags |= AI_NUMERICSERV;
+   return netplay->is_server
+      ? net_st->host_room.ggpo_relays
+      : net_st->ggpo_relay_list;
+}
 
-   if (getaddrinfo_retro(server, port_buf, &hints, out_addr) || !*out_addr)
-      goto error;
+/**
+ * netplay_ggpo_relay_parse_list
+ *
+ * Splits the lobby's "name=addr:port;..." relay list into candidates and
+ * queues their lookups in @resolve. Entries that do not parse or resolve
+ * are skipped, but keep their place so that both peers index the list the
+ * same way.
+ **/
+static unsigned netplay_ggpo_relay_parse_list(netplay_t *netplay,
+      const char *list, struct netplay_ggpo_resolve *resolve)
+{
+   unsigned count = 0;
+
+   while (*list && count < NETPLAY_GGPO_RELAY_CANDIDATES)
+   {
+      struct netplay_ggpo_relay_candidate *candidate =
+         &netplay->ggpo_relay_candidates[count++];
+      const char *end   = strchr(list, ';');
+      size_t len        = end ? (size_t)(end - list) : strlen(list);
+      const char *name;
+      const char *colon;
+      char entry[NETPLAY_HOST_LONGSTR_LEN];
+      unsigned port;
+
+      candidate->addr   = NULL;
+      candidate->rtt_ms = -1;
+      candidate->port   = 0;
+      candidate->server[0] = '\0';
+
+      if (len >= sizeof(entry))
+         len = sizeof(entry) - 1;
+      memcpy(entry, list, len);
+      entry[len] = '\0';
+      list += len;
+      if (*list == ';')
+         list++;
+
+      name = strchr(entry, '=');
+      colon = name ? strrchr(name, ':') : NULL;
+      if (!colon || colon == name + 1)
+         continue;
+      port = (unsigned)strtoul(colon + 1, NULL, 10);
+      if (!port || port > UINT16_MAX ||
+            (size_t)(colon - name - 1) >= sizeof(candidate->server))
+         continue;
 
-   *out_fd = fd;
-   return true;
+      memcpy(candidate->server, name + 1, colon - name - 1);
+      candidate->server[colon - name - 1] = '\0';
+      candidate->port = (uint16_t)port;
+      strlcpy(resolve->host[NETPLAY_GGPO_RESOLVE_CANDIDATE + count - 1],
+            candidate->server, sizeof(resolve->host[0]));
+      resolve->port[NETPLAY_GGPO_RESOLVE_CANDIDATE + count - 1] =
+         candidate->port;
+   }
 
-error:
-   if (bind_addr)
-      freeaddrinfo_retro(bind_addr);
-   if (fd >= 0)
-      socket_close(fd);
-   return false;
+   return count;
 }
 
-static bool netplay_ggpo_relay_start(netplay_t *netplay, uint16_t port)
+static void netplay_ggpo_relay_free_candidates(netplay_t *netplay)
 {
-   settings_t *settings = config_get_ptr();
-   const char *server = settings->paths.netplay_ggpo_relay_server;
+   unsigned i;
+
+   for (i = 0; i < netplay->ggpo_relay_candidate_count; i++)
+   {
+      if (netplay->ggpo_relay_candidates[i].addr)
+      {
+         freeaddrinfo_retro(netplay->ggpo_relay_candidates[i].addr);
+         netplay->ggpo_relay_candidates[i].addr = NULL;
+      }
+   }
+   netplay->ggpo_relay_candidate_count = 0;
+
+   if (netplay->ggpo_relay_rendezvous_addr)
+   {
+      freeaddrinfo_retro(netplay->ggpo_relay_rendezvous_addr);
+      netplay->ggpo_relay_rendezvous_addr = NULL;
+   }
+}
+
+static void netplay_ggpo_relay_send_probes(netplay_t *netplay)
+{
+   char msg[GGPO_RELAY_MAX_MSG];
+   unsigned i;
+   int msg_len = snprintf(msg, sizeof(msg), "%s PING probe%u",
+         GGPO_RELAY_MAGIC, netplay->ggpo_relay_probe_round);
+
+   for (i = 0; i < netplay->ggpo_relay_candidate_count; i++)
+   {
+      struct addrinfo *addr = netplay->ggpo_relay_candidates[i].addr;
+
+      if (addr)
+         sendto(netplay->ggpo_relay_fd, msg, msg_len, 0,
+               addr->ai_addr, addr->ai_addrlen);
+   }
+}
+
+static void netplay_ggpo_relay_on_pong(netplay_t *netplay,
+      const struct sockaddr_storage *from, const char *name)
+{
+   char expected[16];
+   unsigned i;
+   int rtt_ms;
+
+   snprintf(expected, sizeof(expected), "probe%u",
+         netplay->ggpo_relay_probe_round);
+   if (!string_is_equal(name, expected))
+      return;
+
+   rtt_ms = (int)((cpu_features_get_time_usec()
+         - netplay->ggpo_relay_probe_sent) / 1000);
+   if (rtt_ms > GGPO_RELAY_RTT_MAX_MS)
+      rtt_ms = GGPO_RELAY_RTT_MAX_MS;
+
+   for (i = 0; i < netplay->ggpo_relay_candidate_count; i++)
+   {
+      struct netplay_ggpo_relay_candidate *candidate =
+         &netplay->ggpo_relay_candidates[i];
+
+      if (netplay_ggpo_relay_same_addr(from, candidate->addr) &&
+            (candidate->rtt_ms < 0 || rtt_ms < candidate->rtt_ms))
+         candidate->rtt_ms = rtt_ms;
+   }
+}
+
+/* "RNDV1 H|C ggporelay.<session> <list hash>/<rtt>,<rtt>,..." */
+static void netplay_ggpo_relay_send_rtts(netplay_t *netplay)
+{
+   char msg[GGPO_RENDEZVOUS_MAX_MSG];
+   char note[GGPO_RELAY_NOTE_MAX];
+   size_t len;
+   unsigned i;
+   int msg_len;
+
+   len = snprintf(note, sizeof(note), "%08x/",
+         (unsigned)netplay->ggpo_relay_list_hash);
+   for (i = 0; i < netplay->ggpo_relay_candidate_count; i++)
+      len += snprintf(note + len, sizeof(note) - len, i ? ",%d" : "%d",
+            netplay->ggpo_relay_candidates[i].rtt_ms);
+
+   msg_len = snprintf(msg, sizeof(msg), "%s %c ggporelay.%s %s",
+         GGPO_RENDEZVOUS_MAGIC, netplay->is_server ? 'H' : 'C',
+         netplay->ggpo_relay_session, note);
+   if (msg_len <= 0 || msg_len >= (int)sizeof(msg))
+      return;
+
+   sendto(netplay->ggpo_relay_fd, msg, msg_len, 0,
+         netplay->ggpo_relay_rendezvous_addr->ai_addr,
+         netplay->ggpo_relay_rendezvous_addr->ai_addrlen);
+}
+
+/**
+ * netplay_ggpo_relay_choose
+ * @peer                 : "PEER <ip> <port> [note]" from the rendezvous server
+ *
+ * Picks the relay minimising the worse of both peers' round trips, the
+ * lowest index on a tie, so both sides come to the same answer. Without a
+ * usable answer the configured relay stays in place.
+ **/
+static void netplay_ggpo_relay_choose(netplay_t *netplay, const char *peer)
+{
+   int peer_rtt[NETPLAY_GGPO_RELAY_CANDIDATES];
+   char note[GGPO_RELAY_NOTE_MAX];
+   struct netplay_ggpo_relay_candidate *best = NULL;
+   int best_rtt = 0;
+   unsigned count = 0;
+   unsigned i;
+   const char *p;
+   char *end;
+
+   if (sscanf(peer, "PEER %*s %*u %47s", note) != 1)
+   {
+      RARCH_LOG("[Netplay] GGPO peer sent no relay RTTs, using the configured relay.\n");
+      return;
+   }
+
+   if ((uint32_t)strtoul(note, &end, 16) != netplay->ggpo_relay_list_hash
+         || *end != '/')
+   {
+      RARCH_WARN("[Netplay] GGPO peer has a different relay list, using the configured relay.\n");
+      return;
+   }
+
+   for (p = end + 1; *p && count < NETPLAY_GGPO_RELAY_CANDIDATES; count++)
+   {
+      peer_rtt[count] = (int)strtol(p, &end, 10);
+      if (end == p)
+         break;
+      p = (*end == ',') ? end + 1 : end;
+   }
+
+   for (i = 0; i < count && i < netplay->ggpo_relay_candidate_count; i++)
+   {
+      struct netplay_ggpo_relay_candidate *candidate =
+         &netplay->ggpo_relay_candidates[i];
+      int worst = candidate->rtt_ms > peer_rtt[i]
+         ? candidate->rtt_ms : peer_rtt[i];
+
+      if (candidate->rtt_ms < 0 || peer_rtt[i] < 0)
+         continue;
+      if (!best || worst < best_rtt)
+      {
+         best     = candidate;
+         best_rtt = worst;
+      }
+   }
+
+   if (!best)
+   {
+      RARCH_WARN("[Netplay] No GGPO relay answered both peers, using the configured relay.\n");
+      return;
+   }
+
+   RARCH_LOG("[Netplay] GGPO relay %s:%hu chosen, %d ms worst RTT.\n",
+         best->server, (unsigned short)best->port, best_rtt);
+
+   freeaddrinfo_retro(netplay->ggpo_relay_addr);
+   netplay->ggpo_relay_addr = best->addr;
+   best->addr = NULL;
+   netplay_ggpo_addr_to_ip(netplay->ggpo_relay_addr,
+         netplay->ggpo_peer_address, sizeof(netplay->ggpo_peer_address));
+   netplay->ggpo_peer_port = best->port;
+}
+
+/**
+ * netplay_ggpo_relay_select
+ *
+ * Steps relay selection: once the lobby's relay list is known, ping every
+ * relay in it, then swap the RTTs with the peer through the rendezvous
+ * server and pick one. Any step that fails falls back to the configured
+ * relay.
+ **/
+static void netplay_ggpo_relay_select(netplay_t *netplay, retro_time_t now)
+{
+   net_driver_state_t *net_st = &networking_driver_st;
+   settings_t *settings       = config_get_ptr();
+
+   switch (netplay->ggpo_relay_stage)
+   {
+      case NETPLAY_GGPO_RELAY_LIST:
+      {
+         const char *list   = netplay_ggpo_relay_list(netplay);
+         const char *server = settings->paths.netplay_rendezvous_server;
+         uint16_t port      =
+            (uint16_t)settings->uints.netplay_rendezvous_port;
+         struct netplay_ggpo_resolve *resolve;
+
+         /* Candidate lookups run as a task like the bring-up ones. */
+         if (netplay->ggpo_resolve)
+            break;
+         if (netplay->ggpo_resolved)
+         {
+            unsigned i;
+
+            netplay->ggpo_relay_stage = NETPLAY_GGPO_RELAY_HELLO;
+            netplay->ggpo_relay_rendezvous_addr = netplay_ggpo_resolved_take(
+                  netplay, NETPLAY_GGPO_RESOLVE_RENDEZVOUS);
+            for (i = 0; i < netplay->ggpo_relay_candidate_count; i++)
+               if (netplay->ggpo_relay_candidates[i].port)
+                  netplay->ggpo_relay_candidates[i].addr =
+                     netplay_ggpo_resolved_take(netplay,
+                           NETPLAY_GGPO_RESOLVE_CANDIDATE + i);
+            netplay_ggpo_resolved_done(netplay);
+
+            if (!netplay->ggpo_relay_rendezvous_addr)
+               RARCH_WARN("[Netplay] GGPO relay selection needs a rendezvous server, using the configured relay.\n");
+            else
+            {
+               netplay->ggpo_relay_probe_round = 0;
+               netplay->ggpo_relay_probe_sent  = 0;
+               netplay->ggpo_relay_stage       = NETPLAY_GGPO_RELAY_PROBE;
+            }
+            break;
+         }
+
+         if (string_is_empty(list))
+         {
+            if (now >= netplay->ggpo_relay_deadline)
+               netplay->ggpo_relay_stage = NETPLAY_GGPO_RELAY_HELLO;
+            break;
+         }
+
+         /* The lobby names a rendezvous server for hosts without one. */
+         if (string_is_empty(server) && netplay->is_server)
+         {
+            server = net_st->host_room.rendezvous_server;
+            if (net_st->host_room.rendezvous_port > 0)
+               port = (uint16_t)net_st->host_room.rendezvous_port;
+         }
+         if (!port)
+            port = DEFAULT_NETPLAY_RENDEZVOUS_PORT;
+
+         netplay->ggpo_relay_stage = NETPLAY_GGPO_RELAY_HELLO;
+         if (string_is_empty(server))
+         {
+            RARCH_WARN("[Netplay] GGPO relay selection needs a rendezvous server, using the configured relay.\n");
+            break;
+         }
+
+         resolve = (struct netplay_ggpo_resolve*)calloc(1, sizeof(*resolve));
+         if (!resolve)
+            break;
+         strlcpy(resolve->host[NETPLAY_GGPO_RESOLVE_RENDEZVOUS], server,
+               sizeof(resolve->host[0]));
+         resolve->port[NETPLAY_GGPO_RESOLVE_RENDEZVOUS] = port;
+
+         netplay->ggpo_relay_list_hash       = netplay_ggpo_relay_list_hash(list);
+         netplay->ggpo_relay_candidate_count =
+            netplay_ggpo_relay_parse_list(netplay, list, resolve);
+         if (!netplay->ggpo_relay_candidate_count)
+         {
+            netplay_ggpo_resolve_free(resolve);
+            break;
+         }
+
+         if (netplay_ggpo_resolve_push(netplay, resolve))
+            netplay->ggpo_relay_stage = NETPLAY_GGPO_RELAY_LIST;
+         break;
+      }
+
+      case NETPLAY_GGPO_RELAY_PROBE:
+         if (netplay->ggpo_relay_probe_round < GGPO_RELAY_PROBE_COUNT)
+         {
+            if (now >= netplay->ggpo_relay_probe_sent
+                  + GGPO_RELAY_PROBE_INTERVAL_USEC)
+            {
+               netplay->ggpo_relay_probe_round++;
+               netplay->ggpo_relay_probe_sent = now;
+               netplay_ggpo_relay_send_probes(netplay);
+            }
+         }
+         else if (now >= netplay->ggpo_relay_probe_sent
+               + GGPO_RELAY_PROBE_WAIT_USEC)
+         {
+            netplay->ggpo_relay_stage    = NETPLAY_GGPO_RELAY_AGREE;
+            netplay->ggpo_relay_deadline = now
+               + GGPO_RENDEZVOUS_CLIENT_TIMEOUT_USEC;
+            netplay->ggpo_relay_probe_sent = 0;
+         }
+         break;
+
+      case NETPLAY_GGPO_RELAY_AGREE:
+         /* The host waits for as long as it takes a client to join. */
+         if (!netplay->is_server && now >= netplay->ggpo_relay_deadline)
+         {
+            RARCH_WARN("[Netplay] GGPO relay selection timed out, using the configured relay.\n");
+            netplay->ggpo_relay_stage = NETPLAY_GGPO_RELAY_HELLO;
+            break;
+         }
+         /* probe_sent doubles as the resend timer from here on. */
+         if (now >= netplay->ggpo_relay_probe_sent)
+         {
+            netplay_ggpo_relay_send_rtts(netplay);
+            netplay->ggpo_relay_probe_sent = now + GGPO_RENDEZVOUS_RETRY_USEC;
+         }
+         break;
+
+      case NETPLAY_GGPO_RELAY_HELLO:
+         break;
+   }
+
+   if (netplay->ggpo_relay_stage == NETPLAY_GGPO_RELAY_HELLO)
+      netplay->ggpo_relay_next_send = 0;
+}
+
+static bool netplay_ggpo_relay_start(netplay_t *netplay, uint16_t port)
+{
+   settings_t *settings = config_get_ptr();
+   const char *server = settings->paths.netplay_ggpo_relay_server;
    const char *session = settings->paths.netplay_ggpo_relay_session;
    uint16_t server_port = (uint16_t)settings->uints.netplay_ggpo_relay_port;
    uint16_t local_port = port;
@@ -2996,22 +3822,35 @@ static bool netplay_ggpo_relay_start(netplay_t *netplay, uint16_t port)
    if (!netplay->is_server)
       local_port = (uint16_t)(port + 1);
 
-   if (!netplay_ggpo_relay_open_socket(local_port, server, server_port,
-         &netplay->ggpo_relay_fd, &netplay->ggpo_relay_addr))
+   netplay->ggpo_relay_addr = netplay_ggpo_resolved_take(netplay,
+         NETPLAY_GGPO_RESOLVE_RELAY);
+   netplay_ggpo_resolved_done(netplay);
+   if (!netplay->ggpo_relay_addr)
+      return false;
+
+   netplay->ggpo_relay_fd = netplay_ggpo_open_udp(local_port);
+   if (netplay->ggpo_relay_fd < 0)
    {
       RARCH_ERR("[Netplay] GGPO relay failed to open socket.\n");
       netplay_ggpo_relay_close(netplay);
       return false;
    }
 
-   strlcpy(netplay->ggpo_peer_address, server,
-         sizeof(netplay->ggpo_peer_address));
+   netplay_ggpo_addr_to_ip(netplay->ggpo_relay_addr,
+         netplay->ggpo_peer_address, sizeof(netplay->ggpo_peer_address));
    strlcpy(netplay->ggpo_relay_session, session,
          sizeof(netplay->ggpo_relay_session));
    netplay->ggpo_peer_port = server_port;
    netplay->ggpo_relay_next_send = 0;
    netplay->ggpo_relay_active = true;
 
+   /* A client has its lobby room's list already; a host gets one with the
+    * reply to its first announcement. */
+   netplay->ggpo_relay_stage = NETPLAY_GGPO_RELAY_LIST;
+   netplay->ggpo_relay_deadline = cpu_features_get_time_usec();
+   if (netplay->is_server && settings->bools.netplay_public_announce)
+      netplay->ggpo_relay_deadline += GGPO_RELAY_LIST_WAIT_USEC;
+
    return true;
 }
 
@@ -3019,6 +3858,7 @@ static bool netplay_ggpo_relay_poll(netplay_t *netplay)
 {
    const char *session = NULL;
    retro_time_t now;
+   bool hello;
 
    if (!netplay || !netplay->ggpo_relay_active)
       return false;
@@ -3031,10 +3871,19 @@ static bool netplay_ggpo_relay_poll(netplay_t *netplay)
 
    now = cpu_features_get_time_usec();
 
-   if (now >= netplay->ggpo_relay_next_send)
+   if (netplay->ggpo_relay_stage != NETPLAY_GGPO_RELAY_HELLO)
+      netplay_ggpo_relay_select(netplay, now);
+
+   /* Until a relay is chosen the host also waits at the configured one, for
+    * a client that does not take part in the selection. */
+   hello = netplay->is_server
+      || netplay->ggpo_relay_stage == NETPLAY_GGPO_RELAY_HELLO;
+
+   if (hello && now >= netplay->ggpo_relay_next_send)
    {
       netplay_ggpo_relay_send(netplay->ggpo_relay_fd,
-            netplay->ggpo_relay_addr, netplay->is_server, session);
+            netplay->ggpo_relay_addr, netplay->is_server, session,
+            netplay_ggpo_token_next(netplay, session));
       netplay->ggpo_relay_next_send = now + GGPO_RELAY_RETRY_USEC;
    }
 
@@ -3043,7 +3892,7 @@ static bool netplay_ggpo_relay_poll(netplay_t *netplay)
       char buf[GGPO_RELAY_MAX_MSG];
       char magic[16] = {0};
       char status[16] = {0};
-      char session_buf[NETPLAY_HOST_STR_LEN] = {0};
+      char session_buf[NETPLAY_HOST_STR_LEN * 2] = {0};
       struct sockaddr_storage from = {0};
       socklen_t from_len = sizeof(from);
       ssize_t recvd = recvfrom(netplay->ggpo_relay_fd,
@@ -3054,13 +3903,50 @@ static bool netplay_ggpo_relay_poll(netplay_t *netplay)
          break;
 
       buf[recvd] = '\0';
+      if (string_starts_with(buf, "PEER "))
+      {
+         if (netplay->ggpo_relay_stage == NETPLAY_GGPO_RELAY_AGREE)
+         {
+            netplay_ggpo_relay_choose(netplay, buf);
+            netplay->ggpo_relay_stage = NETPLAY_GGPO_RELAY_HELLO;
+            netplay_ggpo_relay_send(netplay->ggpo_relay_fd,
+                  netplay->ggpo_relay_addr, netplay->is_server, session,
+                  netplay_ggpo_token_next(netplay, session));
+            netplay->ggpo_relay_next_send = now + GGPO_RELAY_RETRY_USEC;
+            hello = true;
+         }
+         continue;
+      }
       if (sscanf(buf, "%15s %15s %63s", magic, status, session_buf) < 2)
          continue;
       if (!string_is_equal(magic, GGPO_RELAY_MAGIC))
          continue;
+      if (string_is_equal(status, "PONG"))
+      {
+         if (netplay->ggpo_relay_stage == NETPLAY_GGPO_RELAY_PROBE)
+            netplay_ggpo_relay_on_pong(netplay, &from, session_buf);
+         continue;
+      }
+      if (!hello)
+         continue;
+      /* Once selection ran, only the relay in use counts; the configured
+       * one may still answer the host's earlier hellos. */
+      if (netplay->ggpo_relay_candidate_count &&
+            !netplay_ggpo_relay_same_addr(&from, netplay->ggpo_relay_addr))
+         continue;
+      /* Relays name the token, not the session, when they refuse it. */
+      if (string_is_equal(status, "ERR")
+            && netplay_ggpo_token(netplay, session)
+            && string_is_equal(session_buf, netplay_ggpo_token(netplay, session)))
+      {
+         netplay_ggpo_token_drop(netplay, "was refused");
+         netplay->ggpo_relay_next_send = 0;
+         continue;
+      }
       if (!string_is_empty(session_buf) &&
             !string_is_equal(session_buf, session))
          continue;
+      netplay->ggpo_token_answered = true;
 
       if (string_is_equal(status, "READY"))
       {
@@ -3100,11 +3986,95 @@ static void netplay_ggpo_relay_close(netplay_t *netplay)
       netplay->ggpo_relay_addr = NULL;
    }
 
+   netplay_ggpo_relay_free_candidates(netplay);
    netplay->ggpo_relay_active = false;
    netplay->ggpo_relay_next_send = 0;
 }
 #endif
 
+/**
+ * netplay_sendv_nonblocking
+ *
+ * Send two buffers back to back without blocking, in one gather write
+ * where the platform has one.
+ *
+ * Returns the number of bytes sent, or -1 on error.
+ */
+static ssize_t netplay_sendv_nonblocking(int fd,
+      const void *a, size_t a_len, const void *b, size_t b_len)
+{
+#if (defined(_WIN32) && !defined(_XBOX)) || defined(__linux__) \
+      || defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) \
+      || defined(__NetBSD__)
+   const uint8_t *pa = (const uint8_t*)a;
+   const uint8_t *pb = (const uint8_t*)b;
+   size_t      total = 0;
+
+   while (a_len + b_len)
+   {
+      ssize_t ret;
+#ifdef _WIN32
+      WSABUF bufs[2];
+      DWORD  sent = 0;
+
+      bufs[0].buf = (char*)pa;
+      bufs[0].len = (ULONG)a_len;
+      bufs[1].buf = (char*)pb;
+      bufs[1].len = (ULONG)b_len;
+      ret = (WSASend(fd, a_len ? bufs : bufs + 1, a_len ? 2 : 1, &sent, 0,
+            NULL, NULL) == SOCKET_ERROR) ? SOCKET_ERROR : (ssize_t)sent;
+#else
+      struct iovec  iov[2];
+      struct msghdr msg;
+
+      memset(&msg, 0, sizeof(msg));
+      iov[0].iov_base = (void*)pa;
+      iov[0].iov_len  = a_len;
+      iov[1].iov_base = (void*)pb;
+      iov[1].iov_len  = b_len;
+      msg.msg_iov     = a_len ? iov : iov + 1;
+      msg.msg_iovlen  = a_len ? 2 : 1;
+      ret = sendmsg(fd, &msg, MSG_NOSIGNAL);
+#endif
+
+      if (!ret)
+         break;
+
+      if (ret < 0)
+      {
+         if (isagain((int)ret))
+            break;
+
+         return -1;
+      }
+
+      total += (size_t)ret;
+      if ((size_t)ret >= a_len)
+      {
+         pb    += (size_t)ret - a_len;
+         b_len -= (size_t)ret - a_len;
+         a_len  = 0;
+      }
+      else
+      {
+         pa    += ret;
+         a_len -= ret;
+      }
+   }
+
+   return (ssize_t)total;
+#else
+   ssize_t sent = socket_send_all_nonblocking(fd, a, a_len, true);
+   ssize_t more;
+
+   if (sent < 0 || (size_t)sent < a_len || !b_len)
+      return sent;
+   if ((more = socket_send_all_nonblocking(fd, b, b_len, true)) < 0)
+      return -1;
+   return sent + more;
+#endif
+}
+
 static size_t buf_used(struct socket_buffer *sbuf)
 {
    if (sbuf->end < sbuf->start)
@@ -3205,10 +4175,12 @@ bool netplay_send(
        * need to do a blocking send */
       if (!socket_send_all_blocking(sockfd, buf, len, true))
          return false;
+      sbuf->direct += len;
       return true;
    }
 
    /* Copy it into our buffer */
+   sbuf->copied += len;
    if (sbuf->bufsz - sbuf->end < len)
    {
       /* Half at a time */
@@ -3229,6 +4201,42 @@ bool netplay_send(
    return true;
 }
 
+bool netplay_send_pair(struct socket_buffer *sbuf, int sockfd,
+      const void *header, size_t header_len,
+      const void *payload, size_t payload_len)
+{
+   ssize_t sent;
+
+   if (buf_used(sbuf) && !netplay_send_flush(sbuf, sockfd, false))
+      return false;
+
+   /* Anything still queued has to go first. */
+   if (buf_used(sbuf))
+      return netplay_send(sbuf, sockfd, header, header_len)
+          && netplay_send(sbuf, sockfd, payload, payload_len);
+
+   if ((sent = netplay_sendv_nonblocking(sockfd, header, header_len,
+         payload, payload_len)) < 0)
+      return false;
+
+   sbuf->direct += (size_t)sent;
+
+   if ((size_t)sent < header_len)
+   {
+      if (!netplay_send(sbuf, sockfd, (const uint8_t*)header + sent,
+            header_len - (size_t)sent))
+         return false;
+      sent = 0;
+   }
+   else
+      sent -= (ssize_t)header_len;
+
+   if ((size_t)sent >= payload_len)
+      return true;
+   return netplay_send(sbuf, sockfd, (const uint8_t*)payload + sent,
+         payload_len - (size_t)sent);
+}
+
 /**
  * netplay_send_flush
  *
@@ -3285,19 +4293,21 @@ bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block)
       }
       else
       {
-         ssize_t sent = socket_send_all_nonblocking(
-               sockfd, sbuf->data + sbuf->start,
-               sbuf->bufsz - sbuf->start, true);
+         /* Both halves in one write */
+         size_t  chunka = sbuf->bufsz - sbuf->start;
+         ssize_t sent   = netplay_sendv_nonblocking(sockfd,
+               sbuf->data + sbuf->start, chunka, sbuf->data, sbuf->end);
 
          if (sent < 0)
             return false;
 
-         sbuf->start += sent;
-
-         if (sbuf->start >= sbuf->bufsz)
+         if ((size_t)sent < chunka)
+            sbuf->start += sent;
+         else
          {
-            sbuf->start = 0;
-            return netplay_send_flush(sbuf, sockfd, false);
+            sbuf->start = (size_t)sent - chunka;
+            if (sbuf->start == sbuf->end)
+               sbuf->start = sbuf->end = 0;
          }
       }
 
@@ -3306,21 +4316,15 @@ bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block)
    return true;
 }
 
-/**
- * netplay_recv
- *
- * Receive buffered or fresh data.
- *
- * Returns number of bytes returned, which may be short, 0, or -1 on error.
- */
-ssize_t netplay_recv(struct socket_buffer *sbuf, int sockfd,
-      void *buf, size_t len)
+/* Receives whatever fits unless len bytes are already unread. */
+static bool netplay_recv_fill(struct socket_buffer *sbuf, int sockfd,
+      size_t len)
 {
    ssize_t recvd;
    bool err = false;
 
    if (buf_unread(sbuf) >= len || !buf_remaining(sbuf))
-      goto copy;
+      return true;
 
    /* Receive whatever we can into the buffer */
    if (sbuf->end >= sbuf->start)
@@ -3330,7 +4334,7 @@ ssize_t netplay_recv(struct socket_buffer *sbuf, int sockfd,
          ((sbuf->start == 0) ? 1 : 0));
 
       if (recvd < 0 || err)
-         return -1;
+         return false;
 
       sbuf->end += recvd;
 
@@ -3345,7 +4349,7 @@ ssize_t netplay_recv(struct socket_buffer *sbuf, int sockfd,
                sbuf->data, sbuf->start - 1);
 
             if (recvd < 0 || err)
-               return -1;
+               return false;
 
             sbuf->end += recvd;
          }
@@ -3358,13 +4362,30 @@ ssize_t netplay_recv(struct socket_buffer *sbuf, int sockfd,
             sbuf->start - sbuf->end - 1);
 
       if (recvd < 0 || err)
-         return -1;
+         return false;
 
       sbuf->end += recvd;
    }
 
+   return true;
+}
+
+/**
+ * netplay_recv
+ *
+ * Receive buffered or fresh data.
+ *
+ * Returns number of bytes returned, which may be short, 0, or -1 on error.
+ */
+ssize_t netplay_recv(struct socket_buffer *sbuf, int sockfd,
+      void *buf, size_t len)
+{
+   ssize_t recvd;
+
+   if (!netplay_recv_fill(sbuf, sockfd, len))
+      return -1;
+
    /* Now copy it into the reader */
-copy:
    if (sbuf->end >= sbuf->read || (sbuf->bufsz - sbuf->read) >= len)
    {
       size_t unread = buf_unread(sbuf);
@@ -3403,9 +4424,34 @@ copy:
       recvd      = chunka + chunkb;
    }
 
+   sbuf->copied += (size_t)recvd;
+
    return recvd;
 }
 
+ssize_t netplay_recv_direct(struct socket_buffer *sbuf, int sockfd,
+      void *buf, size_t len, const void **out)
+{
+   *out = buf;
+
+   if (!netplay_recv_fill(sbuf, sockfd, len))
+      return -1;
+
+   if (     len
+         && buf_unread(sbuf) >= len
+         && sbuf->bufsz - sbuf->read >= len)
+   {
+      *out          = sbuf->data + sbuf->read;
+      sbuf->read   += len;
+      if (sbuf->read >= sbuf->bufsz)
+         sbuf->read = 0;
+      sbuf->direct += len;
+      return (ssize_t)len;
+   }
+
+   return netplay_recv(sbuf, sockfd, buf, len);
+}
+
 /**
  * netplay_recv_reset
  *
@@ -3507,23 +4553,39 @@ static bool netplay_cmd_crc(netplay_t *netplay, struct delta_frame *delta)
 {
    size_t i;
    uint32_t payload[2];
+   uint32_t hashes[NETPLAY_STATE_HASH_LAST];
+   bool hashed[NETPLAY_STATE_HASH_LAST] = {0};
    bool success = true;
    NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
 
    payload[0]   = htonl(delta->frame);
-   payload[1]   = htonl(delta->crc);
 
    for (i = 0; i < netplay->connections_size; i++)
    {
-      if (     (netplay->connections[i].flags & NETPLAY_CONN_FLAG_ACTIVE)
-            && (netplay->connections[i].mode >= NETPLAY_CONNECTION_CONNECTED))
-         success = netplay_send_raw_cmd(netplay, &netplay->connections[i],
-            NETPLAY_CMD_CRC, payload, sizeof(payload)) && success;
-   }
-   return success;
-}
+      struct netplay_connection *connection = &netplay->connections[i];
+      enum netplay_state_hash hash;
 
-/**
+      if (     !(connection->flags & NETPLAY_CONN_FLAG_ACTIVE)
+            ||  (connection->mode < NETPLAY_CONNECTION_CONNECTED))
+         continue;
+
+      /* Each algorithm in use is only run once per frame */
+      hash = NETPLAY_CONNECTION_STATE_HASH(connection);
+      if (!hashed[hash])
+      {
+         hashes[hash] = netplay->state_size ?
+            netplay_delta_frame_crc(netplay, delta, hash) : 0;
+         hashed[hash] = true;
+      }
+
+      payload[1] = htonl(hashes[hash]);
+      success    = netplay_send_raw_cmd(netplay, connection,
+         NETPLAY_CMD_CRC, payload, sizeof(payload)) && success;
+   }
+   return success;
+}
+
+/**
  * netplay_cmd_request_savestate
  *
  * Send a savestate request command.
@@ -3542,6 +4604,23 @@ static bool netplay_cmd_request_savestate(netplay_t *netplay)
       NETPLAY_CMD_REQUEST_SAVESTATE, NULL, 0);
 }
 
+/**
+ * netplay_cmd_ack_savestate
+ *
+ * Tell the server whether a savestate was applied, so it stops sending
+ * deltas against a base we do not have.
+ */
+static bool netplay_cmd_ack_savestate(netplay_t *netplay,
+   struct netplay_connection *connection,
+   uint32_t frame, uint32_t status)
+{
+   uint32_t payload[2];
+   payload[0] = htonl(frame);
+   payload[1] = htonl(status);
+   return netplay_send_raw_cmd(netplay, connection,
+      NETPLAY_CMD_LOAD_SAVESTATE_ACK, payload, sizeof(payload));
+}
+
 /**
  * netplay_cmd_stall
  *
@@ -3638,221 +4717,161 @@ netplay_input_state_t netplay_device_client_state(netplay_t *netplay,
          client, dsize, false, true);
 }
 
-/**
- * netplay_merge_digital
- * @netplay             : pointer to netplay object
- * @resstate            : state being resolved
- * @simframe            : frame in which merging is being performed
- * @device              : device being merged
- * @clients             : bitmap of clients being merged
- * @digital             : bitmap of digital bits
- */
-static void netplay_merge_digital(netplay_t *netplay,
-      netplay_input_state_t resstate, struct delta_frame *simframe,
-      uint32_t device, uint32_t clients, const uint32_t *digital)
+static void netplay_merge_digital_or(netplay_input_state_t resstate,
+      const netplay_input_state_t *states, unsigned count,
+      unsigned first, unsigned words)
 {
-   netplay_input_state_t simstate;
-   uint32_t word, bit, client;
-   uint8_t share_mode = netplay->device_share_modes[device]
-      & NETPLAY_SHARE_DIGITAL_BITS;
+   unsigned i, word;
+   for (i = 0; i < count; i++)
+      for (word = first; word < first + words; word++)
+         resstate->data[word] |= states[i]->data[word];
+}
 
-   /* Make sure all real clients are accounted for */
-   for (simstate = simframe->real_input[device];
-         simstate; simstate = simstate->next)
-   {
-      if (!simstate->used || simstate->size != resstate->size)
-         continue;
-      clients |= 1 << simstate->client_num;
-   }
+static void netplay_merge_digital_xor(netplay_input_state_t resstate,
+      const netplay_input_state_t *states, unsigned count,
+      unsigned first, unsigned words)
+{
+   unsigned i, word;
+   for (i = 0; i < count; i++)
+      for (word = first; word < first + words; word++)
+         resstate->data[word] ^= states[i]->data[word];
+}
 
-   if (share_mode == NETPLAY_SHARE_DIGITAL_VOTE)
+/* A bit is set if more than half the clients set it */
+static void netplay_merge_digital_vote(netplay_input_state_t resstate,
+      const netplay_input_state_t *states, unsigned count,
+      unsigned first, unsigned words)
+{
+   unsigned i, word, bit;
+   for (word = first; word < first + words; word++)
    {
-      unsigned i, j;
-      /* This just assumes we have no more than
-       * three words, will need to be adjusted for new devices */
-      struct vote_count votes[3];
-      /* Vote mode requires counting all the bits */
-      uint32_t client_count      = 0;
-
-      for (i = 0; i < 3; i++)
-         for (j = 0; j < 32; j++)
-            votes[i].votes[j] = 0;
-
-      for (client = 0; client < MAX_CLIENTS; client++)
-      {
-         if (!(clients & (1 << client)))
-            continue;
-
-         simstate = netplay_device_client_state(
-               netplay, simframe, device, client);
-
-         if (!simstate)
-            continue;
-         client_count++;
-
-         for (word = 0; word < resstate->size; word++)
-         {
-            if (!digital[word])
-               continue;
-            for (bit = 0; bit < 32; bit++)
-            {
-               if (!(digital[word] & (1 << bit)))
-                  continue;
-               if (simstate->data[word] & (1 << bit))
-                  votes[word].votes[bit]++;
-            }
-         }
-      }
-
-      /* Now count all the bits */
-      client_count /= 2;
-      for (word = 0; word < resstate->size; word++)
+      for (bit = 0; bit < 32; bit++)
       {
-         for (bit = 0; bit < 32; bit++)
-         {
-            if (votes[word].votes[bit] > client_count)
-               resstate->data[word] |= (1 << bit);
-         }
+         unsigned votes = 0;
+         for (i = 0; i < count; i++)
+            votes += (states[i]->data[word] >> bit) & 1;
+         if (votes > count / 2)
+            resstate->data[word] |= UINT32_C(1) << bit;
       }
    }
-   else /* !VOTE */
+}
+
+/* Each word holds two axes; the one pushed furthest wins,
+ * the positive one on a tie */
+static void netplay_merge_analog_max(netplay_input_state_t resstate,
+      const netplay_input_state_t *states, unsigned count,
+      unsigned first, unsigned words)
+{
+   unsigned i, word, bit;
+   for (word = first; word < first + words; word++)
    {
-      for (client = 0; client < MAX_CLIENTS; client++)
+      for (bit = 0; bit < 32; bit += 16)
       {
-         if (!(clients & (1 << client)))
-            continue;
-         simstate = netplay_device_client_state(
-               netplay, simframe, device, client);
-
-         if (!simstate)
-            continue;
-         for (word = 0; word < resstate->size; word++)
+         int32_t value = 0;
+         for (i = 0; i < count; i++)
          {
-            uint32_t part;
-            if (!digital[word])
-               continue;
-            part = simstate->data[word];
-
-            if (digital[word] == (uint32_t) -1)
-            {
-               /* Combine the whole word */
-               switch (share_mode)
-               {
-                  case NETPLAY_SHARE_DIGITAL_XOR:
-                     resstate->data[word] ^= part;
-                     break;
-                  default:
-                     resstate->data[word] |= part;
-               }
-
-            }
-            else /* !whole word */
-            {
-               for (bit = 0; bit < 32; bit++)
-               {
-                  if (!(digital[word] & (1 << bit)))
-                     continue;
-                  switch (share_mode)
-                  {
-                     case NETPLAY_SHARE_DIGITAL_XOR:
-                        resstate->data[word] ^= part & (1 << bit);
-                        break;
-                     default:
-                        resstate->data[word] |= part & (1 << bit);
-                  }
-               }
-            }
+            int32_t new_value = (int16_t)((states[i]->data[word] >> bit)
+                  & 0xFFFF);
+            if (     abs(new_value)  > abs(value)
+                  || (abs(new_value) == abs(value) && new_value > value))
+               value = new_value;
          }
+         resstate->data[word] |= ((uint32_t)(uint16_t)value) << bit;
       }
-
    }
 }
 
-/**
- * merge_analog_part
- * @netplay             : pointer to netplay object
- * @resstate            : state being resolved
- * @simframe            : frame in which merging is being performed
- * @device              : device being merged
- * @clients             : bitmap of clients being merged
- * @word                : word to merge
- * @bit                 : first bit to merge
- */
-static void merge_analog_part(netplay_t *netplay,
-      netplay_input_state_t resstate, struct delta_frame *simframe,
-      uint32_t device, uint32_t clients, uint32_t word, uint8_t bit)
+static void netplay_merge_analog_average(netplay_input_state_t resstate,
+      const netplay_input_state_t *states, unsigned count,
+      unsigned first, unsigned words)
 {
-   netplay_input_state_t simstate;
-   uint32_t client, client_count = 0;
-   uint8_t share_mode            = netplay->device_share_modes[device]
-      & NETPLAY_SHARE_ANALOG_BITS;
-   int32_t value                 = 0, new_value;
-
-   /* Make sure all real clients are accounted for */
-   for (simstate = simframe->real_input[device]; simstate; simstate = simstate->next)
-   {
-      if (!simstate->used || simstate->size != resstate->size)
-         continue;
-      clients |= 1 << simstate->client_num;
-   }
-
-   for (client = 0; client < MAX_CLIENTS; client++)
+   unsigned i, word, bit;
+   if (!count)
+      return;
+   for (word = first; word < first + words; word++)
    {
-      if (!(clients & (1 << client)))
-         continue;
-      simstate = netplay_device_client_state(
-            netplay, simframe, device, client);
-      if (!simstate)
-         continue;
-      client_count++;
-      new_value = (int16_t) ((simstate->data[word]>>bit) & 0xFFFF);
-      switch (share_mode)
+      for (bit = 0; bit < 32; bit += 16)
       {
-         case NETPLAY_SHARE_ANALOG_AVERAGE:
-            value += (int32_t) new_value;
-            break;
-         default:
-            if (   abs(new_value)   > abs(value)
-                || (abs(new_value) == abs(value)
-                && new_value > value))
-               value = new_value;
+         int32_t value = 0;
+         for (i = 0; i < count; i++)
+            value += (int16_t)((states[i]->data[word] >> bit) & 0xFFFF);
+         value /= (int32_t)count;
+         resstate->data[word] |= ((uint32_t)(uint16_t)value) << bit;
       }
    }
-
-   if (share_mode == NETPLAY_SHARE_ANALOG_AVERAGE)
-      if (client_count > 0) /* Prevent potential divide by zero */
-         value /= client_count;
-
-   resstate->data[word] |= ((uint32_t) (uint16_t) value) << bit;
 }
 
 /**
- * netplay_merge_analog
+ * netplay_merge_kernel_get
  * @netplay             : pointer to netplay object
- * @resstate            : state being resolved
- * @simframe            : frame in which merging is being performed
  * @device              : device being merged
- * @clients             : bitmap of clients being merged
  * @dtype               : device type
+ * @dsize               : input size of the device, in words
+ *
+ * Returns the device's merge kernel, picking it again if the device's
+ * type, share mode or size changed since the last call.
  */
-static void netplay_merge_analog(netplay_t *netplay,
-      netplay_input_state_t resstate, struct delta_frame *simframe,
-      uint32_t device, uint32_t clients, unsigned dtype)
+static const struct netplay_merge_kernel *netplay_merge_kernel_get(
+      netplay_t *netplay, uint32_t device, unsigned dtype, uint32_t dsize)
 {
-   /* Devices with no analog parts */
-   if (dtype == RETRO_DEVICE_JOYPAD || dtype == RETRO_DEVICE_KEYBOARD)
-      return;
+   struct netplay_merge_kernel *kernel = &netplay->merge_kernels[device];
+   uint8_t share_mode = netplay->device_share_modes[device];
+   uint32_t key       = UINT32_C(0x80000000) | (dsize << 16)
+      | ((uint32_t)share_mode << 8) | (dtype & 0xFF);
+   unsigned analog_words;
+
+   if (kernel->key == key)
+      return kernel;
+
+   switch (share_mode & NETPLAY_SHARE_DIGITAL_BITS)
+   {
+      case NETPLAY_SHARE_DIGITAL_XOR:
+         kernel->digital = netplay_merge_digital_xor;
+         break;
+      case NETPLAY_SHARE_DIGITAL_VOTE:
+         kernel->digital = netplay_merge_digital_vote;
+         break;
+      default:
+         kernel->digital = netplay_merge_digital_or;
+         break;
+   }
 
-   /* All other devices have at least one analog word */
-   merge_analog_part(netplay, resstate, simframe, device, clients, 1, 0);
-   merge_analog_part(netplay, resstate, simframe, device, clients, 1, 16);
+   if ((share_mode & NETPLAY_SHARE_ANALOG_BITS)
+         == NETPLAY_SHARE_ANALOG_AVERAGE)
+      kernel->analog = netplay_merge_analog_average;
+   else
+      kernel->analog = netplay_merge_analog_max;
 
-   /* And the ANALOG device has two (two sticks) */
-   if (dtype == RETRO_DEVICE_ANALOG)
+   /* The keyboard is all buttons; other devices have theirs in the
+    * first word, followed by one word of axes per stick... */
+   switch (dtype)
    {
-      merge_analog_part(netplay, resstate, simframe, device, clients, 2, 0);
-      merge_analog_part(netplay, resstate, simframe, device, clients, 2, 16);
+      case RETRO_DEVICE_KEYBOARD:
+         kernel->digital_words = 5;
+         analog_words          = 0;
+         break;
+      case RETRO_DEVICE_JOYPAD:
+         kernel->digital_words = 1;
+         analog_words          = 0;
+         break;
+      case RETRO_DEVICE_ANALOG:
+         kernel->digital_words = 1;
+         analog_words          = 2;
+         break;
+      default:
+         kernel->digital_words = 1;
+         analog_words          = 1;
+         break;
    }
+   /* ...as far as the device's input goes */
+   kernel->digital_words = (uint8_t)MIN(kernel->digital_words, dsize);
+   kernel->analog_words  = (uint8_t)MIN(analog_words,
+         dsize - kernel->digital_words);
+   if (!kernel->analog_words)
+      kernel->analog = NULL;
+   kernel->key           = key;
+
+   return kernel;
 }
 
 /**
@@ -3999,13 +5018,10 @@ static bool netplay_resolve_input(netplay_t *netplay,
       else
       {
          /* Merge them */
-         /* Most devices have all the digital parts in the first word. */
-         static const uint32_t digital_common[3]   = {~0u, 0u, 0u};
-         static const uint32_t digital_keyboard[5] = {~0u, ~0u, ~0u, ~0u, ~0u};
-         const uint32_t *digital                   = digital_common;
-
-         if (dtype == RETRO_DEVICE_KEYBOARD)
-            digital = digital_keyboard;
+         netplay_input_state_t states[MAX_CLIENTS];
+         const struct netplay_merge_kernel *kernel;
+         unsigned count           = 0;
+         retro_time_t merge_start = cpu_features_get_time_usec();
 
          oldresstate = netplay_input_state_for(
                &simframe->resolved_input[device], 1, dsize, false, false);
@@ -4015,15 +5031,28 @@ static bool netplay_resolve_input(netplay_t *netplay,
          memcpy(oldresstate->data, resstate->data, dsize * sizeof(uint32_t));
          memset(resstate->data, 0, dsize * sizeof(uint32_t));
 
-         netplay_merge_digital(netplay, resstate, simframe,
-               device, clients, digital);
-         netplay_merge_analog(netplay, resstate, simframe,
-               device, clients, dtype);
+         /* Look every client's state up once, for all the words */
+         for (client = 0; client < MAX_CLIENTS; client++)
+         {
+            if (!(clients & (1 << client)))
+               continue;
+            if ((simstate = netplay_device_client_state(
+                        netplay, simframe, device, client)))
+               states[count++] = simstate;
+         }
+
+         kernel = netplay_merge_kernel_get(netplay, device, dtype, dsize);
+         kernel->digital(resstate, states, count,
+               0, kernel->digital_words);
+         if (kernel->analog)
+            kernel->analog(resstate, states, count,
+                  kernel->digital_words, kernel->analog_words);
 
          if (memcmp(resstate->data, oldresstate->data,
                   dsize * sizeof(uint32_t)))
             ret = true;
 
+         netplay->merge_time += cpu_features_get_time_usec() - merge_start;
       }
    }
 
@@ -4037,11 +5066,7 @@ static void netplay_handle_frame_hash(netplay_t *netplay,
    if (netplay->is_server)
    {
       if (netplay->check_frames && (delta->frame % netplay->check_frames) == 0)
-      {
-         delta->crc = netplay->state_size ?
-            netplay_delta_frame_crc(netplay, delta) : 0;
          netplay_cmd_crc(netplay, delta);
-      }
    }
    else
    {
@@ -4049,7 +5074,8 @@ static void netplay_handle_frame_hash(netplay_t *netplay,
       {
          /* We have a remote CRC, so check it. */
          uint32_t local_crc = netplay->state_size ?
-            netplay_delta_frame_crc(netplay, delta) : 0;
+            netplay_delta_frame_crc(netplay, delta,
+               NETPLAY_CONNECTION_STATE_HASH(&netplay->connections[0])) : 0;
 
          if (local_crc != delta->crc)
          {
@@ -4811,7 +5837,7 @@ static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
 #ifdef DEBUG_NONDETERMINISTIC_CORES
          if (ptr->have_remote && netplay_delta_frame_ready(netplay, &netplay->buffer[netplay->replay_ptr], netplay->replay_frame_count))
          {
-            RARCH_LOG("PRE  %u: %X\n", netplay->replay_frame_count-1, netplay->state_size ? netplay_delta_frame_crc(netplay, ptr) : 0);
+            RARCH_LOG("PRE  %u: %X\n", netplay->replay_frame_count-1, netplay->state_size ? netplay_delta_frame_crc(netplay, ptr, NETPLAY_STATE_HASH_CRC32) : 0);
             if (netplay->is_server)
                RARCH_LOG("INP  %X %X\n", ptr->real_input_state[0], ptr->self_state[0]);
             else
@@ -4822,7 +5848,7 @@ static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
             memset(serial_info.data, 0, serial_info.size);
             core_serialize_special(&serial_info);
 
-            RARCH_LOG("POST %u: %X\n", netplay->replay_frame_count-1, netplay->state_size ? netplay_delta_frame_crc(netplay, ptr) : 0);
+            RARCH_LOG("POST %u: %X\n", netplay->replay_frame_count-1, netplay->state_size ? netplay_delta_frame_crc(netplay, ptr, NETPLAY_STATE_HASH_CRC32) : 0);
          }
 #endif
 
@@ -4839,6 +5865,22 @@ static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
       /* Average our time */
       netplay->frame_run_time_avg   = netplay->frame_run_time_sum / NETPLAY_FRAME_RUN_TIME_WINDOW;
 
+      /* Same window for the input merge cost */
+      netplay->merge_time_sum      += netplay->merge_time;
+      netplay->merge_time_max       = MAX(netplay->merge_time_max,
+            netplay->merge_time);
+      netplay->merge_time           = 0;
+      if (++netplay->merge_time_frames >= NETPLAY_FRAME_RUN_TIME_WINDOW)
+      {
+         net_driver_state_t *net_st = &networking_driver_st;
+         net_st->merge_us_avg       = (uint32_t)(netplay->merge_time_sum
+               / NETPLAY_FRAME_RUN_TIME_WINDOW);
+         net_st->merge_us_max       = (uint32_t)netplay->merge_time_max;
+         netplay->merge_time_sum    = 0;
+         netplay->merge_time_max    = 0;
+         netplay->merge_time_frames = 0;
+      }
+
       if (netplay->unread_frame_count < netplay->run_frame_count)
       {
          netplay->other_ptr         = netplay->unread_ptr;
@@ -5035,6 +6077,20 @@ static void netplay_hangup(netplay_t *netplay,
    was_playing = connection->mode == NETPLAY_CONNECTION_PLAYING ||
       connection->mode == NETPLAY_CONNECTION_SLAVE;
 
+   {
+      uint64_t copied = connection->send_packet_buffer.copied
+         + connection->recv_packet_buffer.copied;
+      uint64_t direct = connection->send_packet_buffer.direct
+         + connection->recv_packet_buffer.direct;
+
+      RARCH_LOG("[Netplay] Socket buffers copied %llu bytes "
+            "(%llu per frame), %llu bytes went without a copy.\n",
+            (unsigned long long)copied,
+            (unsigned long long)(copied / (netplay->self_frame_count
+               ? netplay->self_frame_count : 1)),
+            (unsigned long long)direct);
+   }
+
    /* Report this disconnection */
    if (netplay->is_server)
    {
@@ -5332,6 +6388,11 @@ bool netplay_send_raw_cmd(netplay_t *netplay,
    cmdbuf[0] = htonl(cmd);
    cmdbuf[1] = htonl(len);
 
+   /* Below this, copying is cheaper than a write of its own */
+   if (len >= NETPLAY_SEND_DIRECT_MIN)
+      return netplay_send_pair(&connection->send_packet_buffer,
+            connection->fd, cmdbuf, sizeof(cmdbuf), data, len);
+
    if (!netplay_send(&connection->send_packet_buffer, connection->fd, cmdbuf,
          sizeof(cmdbuf)))
       return false;
@@ -6828,7 +7889,8 @@ static bool netplay_get_cmd(netplay_t *netplay,
                uint32_t local_crc = 0;
                if (netplay->state_size)
                   local_crc       = netplay_delta_frame_crc(
-                        netplay, &netplay->buffer[tmp_ptr]);
+                        netplay, &netplay->buffer[tmp_ptr],
+                        NETPLAY_CONNECTION_STATE_HASH(connection));
 
                /* Problem! */
                if (buffer[1] != local_crc)
@@ -6859,6 +7921,7 @@ static bool netplay_get_cmd(netplay_t *netplay,
             size_t   load_ptr;
             uint32_t load_frame_count;
             uint32_t rd, wn;
+            const void *zdata = NULL;
             struct compression_transcoder *ctrans = NULL;
             NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
 
@@ -6969,39 +8032,54 @@ static bool netplay_get_cmd(netplay_t *netplay,
                return netplay_cmd_nak(netplay, connection);
             }
 
-            RECV(netplay->zbuffer, state_size_raw)
+            /* Decompressed from the socket buffer when it holds the
+             * whole payload in one piece */
+            recvd = netplay_recv_direct(&connection->recv_packet_buffer,
+                  connection->fd, netplay->zbuffer, state_size_raw, &zdata);
+            if (recvd < 0)
                return false;
+            if (recvd < (ssize_t)state_size_raw)
+               goto shrt;
 
             ctrans->decompression_backend->set_in(
                ctrans->decompression_stream,
-               netplay->zbuffer, state_size_raw);
+               (const uint8_t*)zdata, state_size_raw);
 
             if (flags & NETPLAY_STATE_FLAG_DELTA)
             {
-               uint32_t base_crc_local;
+               bool has_base =
+                      connection->state_base_recv_valid
+                  &&  connection->state_base_recv
+                  &&  connection->state_base_size == state_size;
 
-               if (   !connection->state_base_recv_valid
-                   || !connection->state_base_recv
-                   ||  connection->state_base_size != state_size)
+               if (has_base && encoding_crc32(0L,
+                     connection->state_base_recv, state_size) != base_crc)
                {
-                  RARCH_ERR("[Netplay] Missing base state for delta savestate.\n");
-                  netplay_cmd_request_savestate(netplay);
-                  return netplay_cmd_nak(netplay, connection);
+                  RARCH_ERR("[Netplay] Delta savestate base mismatch.\n");
+                  connection->state_base_recv_valid = false;
+                  has_base                          = false;
                }
+               else if (!has_base)
+                  RARCH_ERR("[Netplay] Missing base state for delta savestate.\n");
 
-               base_crc_local = encoding_crc32(0L,
-                  connection->state_base_recv, state_size);
-               if (base_crc_local != base_crc)
+               if (!has_base)
                {
-                  RARCH_ERR("[Netplay] Delta savestate base mismatch.\n");
-                  connection->state_base_recv_valid = false;
+                  /* Newer servers drop their base and send a full state. */
+                  if (connection->netplay_protocol >= 9)
+                  {
+                     netplay_cmd_ack_savestate(netplay, connection, frame,
+                        NETPLAY_STATE_ACK_NO_BASE);
+                     netplay_cmd_request_savestate(netplay);
+                     break;
+                  }
                   netplay_cmd_request_savestate(netplay);
                   return netplay_cmd_nak(netplay, connection);
                }
 
                ctrans->decompression_backend->set_out(
                   ctrans->decompression_stream,
-                  netplay->delta_buffer, state_size);
+                  netplay->delta_buffer,
+                  (uint32_t)netplay->delta_buffer_size);
                if (!ctrans->decompression_backend->trans(
                      ctrans->decompression_stream,
                      true, &rd, &wn, NULL))
@@ -7010,11 +8088,28 @@ static bool netplay_get_cmd(netplay_t *netplay,
                   return netplay_cmd_nak(netplay, connection);
                }
 
-               netplay_apply_delta(
-                  (uint8_t*)netplay->buffer[load_ptr].state,
-                  connection->state_base_recv,
-                  netplay->delta_buffer,
-                  state_size);
+               if (flags & NETPLAY_STATE_FLAG_BLOCKS)
+               {
+                  if (!netplay_unpack_block_delta(
+                        (uint8_t*)netplay->buffer[load_ptr].state,
+                        connection->state_base_recv,
+                        netplay->delta_buffer, wn, state_size))
+                  {
+                     RARCH_ERR("[Netplay] Invalid block delta savestate.\n");
+                     return netplay_cmd_nak(netplay, connection);
+                  }
+               }
+               else if (wn == state_size)
+                  netplay_apply_delta(
+                     (uint8_t*)netplay->buffer[load_ptr].state,
+                     connection->state_base_recv,
+                     netplay->delta_buffer,
+                     state_size);
+               else
+               {
+                  RARCH_ERR("[Netplay] Invalid delta savestate size.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
             }
             else
             {
@@ -7102,6 +8197,40 @@ static bool netplay_get_cmd(netplay_t *netplay,
             netplay->other_ptr                     = load_ptr;
             netplay->other_frame_count             = load_frame_count;
 
+            if (connection->netplay_protocol >= 9)
+               netplay_cmd_ack_savestate(netplay, connection, frame,
+                  NETPLAY_STATE_ACK_APPLIED);
+
+            break;
+         }
+
+      case NETPLAY_CMD_LOAD_SAVESTATE_ACK:
+         {
+            uint32_t payload[2];
+
+            if (!netplay->is_server)
+            {
+               RARCH_ERR("[Netplay] NETPLAY_CMD_LOAD_SAVESTATE_ACK from server.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            if (cmd_size != sizeof(payload))
+            {
+               RARCH_ERR("[Netplay] Received invalid payload size for NETPLAY_CMD_LOAD_SAVESTATE_ACK.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(payload, sizeof(payload))
+               return false;
+
+            /* The next state goes out whole. */
+            if (ntohl(payload[1]) == NETPLAY_STATE_ACK_NO_BASE)
+            {
+               RARCH_WARN("[Netplay] Client has no base for frame %u, "
+                  "sending a full savestate.\n", (unsigned)ntohl(payload[0]));
+               connection->state_base_send_valid = false;
+            }
+
             break;
          }
 
@@ -7363,6 +8492,27 @@ static bool netplay_get_cmd(netplay_t *netplay,
             break;
          }
 
+#ifdef HAVE_GGPO
+      case NETPLAY_CMD_GGPO_TUNNEL:
+         {
+            uint8_t buf[GGPO_TUNNEL_MAX_PACKET];
+
+            if (     netplay->modus != NETPLAY_MODUS_GGPO
+                  || cmd_size > sizeof(buf))
+            {
+               RARCH_ERR("[Netplay] Received an unexpected GGPO tunnel packet.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+            if (cmd_size)
+            {
+               RECV(buf, cmd_size)
+                  return false;
+            }
+            netplay_ggpo_tunnel_recv(netplay, connection, buf, cmd_size);
+         }
+         break;
+#endif
+
       case NETPLAY_CMD_PLAYER_CHAT:
          {
             char nickname[NETPLAY_NICK_LEN];
@@ -7627,8 +8777,10 @@ static void netplay_announce_nat_traversal(netplay_t *netplay,
    struct sockaddr_in *addr = &nat->request.addr;
    uint16_t announce_port = ext_port;
 
-   /* Start announcing immediately. */
-   netplay->next_announce = cpu_features_get_time_usec();
+   /* Announce again right away with the forwarded port,
+      unless an announcement is already on its way. */
+   if (netplay->next_announce != -1)
+      netplay->next_announce = cpu_features_get_time_usec();
 
    if (net_st->nat_traversal_request.status == NAT_TRAVERSAL_STATUS_OPENED)
    {
@@ -8117,6 +9269,14 @@ static void netplay_write_block_header(unsigned char* output, const char* header
    output[7] = ((len >> 24) & 0xFF);
 }
 
+/* Fills len bytes, header included, with a block readers skip. The
+ * body is cleared so a reused buffer hashes the same as a fresh one. */
+static void netplay_write_pad_block(unsigned char* output, size_t len)
+{
+   netplay_write_block_header(output, NETPLAYSTATE_PAD_BLOCK, len - 8);
+   memset(output + 8, 0, len - 8);
+}
+
 static size_t netplay_zbuffer_size_for_state(size_t state_size)
 {
    size_t zbuffer_size = state_size * 2;
@@ -8136,7 +9296,8 @@ static bool netplay_resize_state_buffers(netplay_t *netplay, size_t state_size)
 
    for (i = 0; i < netplay->buffer_size; i++)
    {
-      void *state = realloc(netplay->buffer[i].state, state_size);
+      void *state = memalign_realloc_large(netplay->buffer[i].state,
+            state_size);
       if (!state)
          return false;
       netplay->buffer[i].state = state;
@@ -8159,19 +9320,22 @@ static bool netplay_resize_state_buffers(netplay_t *netplay, size_t state_size)
 
    if (netplay->delta_buffer)
    {
-      uint8_t *delta_buffer = (uint8_t*)realloc(netplay->delta_buffer,
-         state_size);
+      uint8_t *delta_buffer = (uint8_t*)memalign_realloc_large(
+         netplay->delta_buffer,
+         state_size + NETPLAY_STATE_BLOCKS_MAP_SIZE(state_size));
       if (!delta_buffer)
          return false;
       netplay->delta_buffer = delta_buffer;
    }
    else
    {
-      netplay->delta_buffer = (uint8_t*)malloc(state_size);
+      netplay->delta_buffer = (uint8_t*)memalign_alloc_large(
+         state_size + NETPLAY_STATE_BLOCKS_MAP_SIZE(state_size));
       if (!netplay->delta_buffer)
          return false;
    }
-   netplay->delta_buffer_size = state_size;
+   netplay->delta_buffer_size = state_size
+      + NETPLAY_STATE_BLOCKS_MAP_SIZE(state_size);
 
    if (!netplay_resize_state_bases(netplay, state_size))
       return false;
@@ -8180,6 +9344,19 @@ static bool netplay_resize_state_buffers(netplay_t *netplay, size_t state_size)
    return true;
 }
 
+/* Whether the core keeps its state the same size and each part of it
+ * at the same offset. Cores can say so with a quirk; one that reports
+ * dirty blocks indexes them by offset and so has said it already. */
+static bool netplay_core_layout_stable(void)
+{
+   uint64_t quirks = core_serialization_quirks();
+
+   if (quirks & RETRO_SERIALIZATION_QUIRK_CORE_VARIABLE_SIZE)
+      return false;
+   return (quirks & RETRO_SERIALIZATION_QUIRK_STABLE_LAYOUT)
+      || core_serialize_dirty_block_size();
+}
+
 static bool netplay_init_serialization(netplay_t *netplay)
 {
    size_t i;
@@ -8200,8 +9377,28 @@ static bool netplay_init_serialization(netplay_t *netplay)
 
       netplay->coremem_size = info_size;
 
-      /* 8-byte identifier, 8-byte block header, content, 8-byte terminator */
-      info_size = 8 + 8 + CONTENT_ALIGN_SIZE(info_size) + 8;
+      /* 8-byte identifier, 8-byte block header, content, 8-byte
+       * terminator; a stable layout pads either side of the content */
+      if (netplay_core_layout_stable())
+      {
+         size_t end = NETPLAYSTATE_CORE_ALIGN + CONTENT_ALIGN_SIZE(info_size);
+
+         netplay->coremem_offset = NETPLAYSTATE_CORE_ALIGN;
+         netplay->coremem_end    = (end + NETPLAYSTATE_CORE_ALIGN - 1)
+            & ~(size_t)(NETPLAYSTATE_CORE_ALIGN - 1);
+         /* A pad block needs room for its header */
+         if (netplay->coremem_end != end && netplay->coremem_end - end < 8)
+            netplay->coremem_end += NETPLAYSTATE_CORE_ALIGN;
+
+         RARCH_LOG("[Netplay] Core state has a stable layout, aligning it to %u bytes.\n",
+               (unsigned)NETPLAYSTATE_CORE_ALIGN);
+      }
+      else
+      {
+         netplay->coremem_offset = 16;
+         netplay->coremem_end    = 16 + CONTENT_ALIGN_SIZE(info_size);
+      }
+      info_size = netplay->coremem_end + 8;
 
 #ifdef HAVE_CHEEVOS
       {
@@ -8227,10 +9424,15 @@ static bool netplay_init_serialization(netplay_t *netplay)
 
    for (i = 0; i < netplay->buffer_size; i++)
    {
-      netplay->buffer[i].state = calloc(1, netplay->state_size);
+      netplay->buffer[i].state = memalign_alloc_large(netplay->state_size);
       if (!netplay->buffer[i].state)
          return false;
+      memset(netplay->buffer[i].state, 0, netplay->state_size);
    }
+   if (netplay->buffer_size)
+      RARCH_LOG("[Netplay] State buffers in %s.\n",
+            memalign_backing_name(
+               memalign_large_backing(netplay->buffer[0].state)));
 
    netplay->zbuffer_size = netplay_zbuffer_size_for_state(netplay->state_size);
    netplay->zbuffer         = (uint8_t*)calloc(1, netplay->zbuffer_size);
@@ -8240,8 +9442,10 @@ static bool netplay_init_serialization(netplay_t *netplay)
       return false;
    }
 
-   netplay->delta_buffer_size = netplay->state_size;
-   netplay->delta_buffer      = (uint8_t*)malloc(netplay->delta_buffer_size);
+   netplay->delta_buffer_size = netplay->state_size
+      + NETPLAY_STATE_BLOCKS_MAP_SIZE(netplay->state_size);
+   netplay->delta_buffer      = (uint8_t*)memalign_alloc_large(
+         netplay->delta_buffer_size);
    if (!netplay->delta_buffer)
       return false;
 
@@ -8359,13 +9563,161 @@ static void netplay_ggpo_set_env_int(const char *name, unsigned value)
 #endif
 }
 
+/* <config>/<core>/<core>.ggpo, beside the core's overrides */
+static bool netplay_ggpo_profile_path(char *s, size_t len)
+{
+   char config_directory[DIR_MAX_LENGTH];
+   const char *core_name =
+      runloop_state_get_ptr()->system.info.library_name;
+
+   if (string_is_empty(core_name))
+      return false;
+
+   fill_pathname_application_special(config_directory,
+         sizeof(config_directory), APPLICATION_SPECIAL_DIRECTORY_CONFIG);
+   if (string_is_empty(config_directory))
+      return false;
+
+   fill_pathname_join_special_ext(s, config_directory, core_name,
+         core_name, ".ggpo", len);
+   return true;
+}
+
+/**
+ * netplay_ggpo_profile_update
+ * @netplay              : pointer to netplay object
+ *
+ * Once a session has run NETPLAY_GGPO_PROFILE_FRAMES live frames and
+ * replayed enough to know what a resimulated frame costs, works out the
+ * widest prediction window whose worst-case rollback (one load, then a
+ * run and a save per frame, on top of the live frame) still fits in
+ * NETPLAY_GGPO_PROFILE_BUDGET_PCT of the frame time, and an LZ4
+ * acceleration for the state size. Both go to the core's profile, which
+ * later sessions start from where the settings are left at 0; the
+ * saved-frame ring is sized at session start, so this one keeps its
+ * window.
+ **/
+static void netplay_ggpo_profile_update(netplay_t *netplay)
+{
+   char path[PATH_MAX_LENGTH];
+   char dir[DIR_MAX_LENGTH];
+   GGPOStateStats stats = {0};
+   double fps = video_state_get_ptr()->av_info.timing.fps;
+   config_file_t *conf;
+   uint32_t save_us, load_us, replay_us, step_us, budget_us;
+   unsigned window = 1;
+   unsigned accel;
+
+   if (     netplay->ggpo_replay_samples < NETPLAY_GGPO_PROFILE_MIN_REPLAYS
+         || !netplay->ggpo_state_save_samples
+         || !netplay->ggpo_state_load_samples
+         || fps <= 0)
+      return;
+
+   netplay->ggpo_profile_done = true;
+
+   save_us   = (uint32_t)(netplay->ggpo_state_save_accum_us
+         / netplay->ggpo_state_save_samples);
+   load_us   = (uint32_t)(netplay->ggpo_state_load_accum_us
+         / netplay->ggpo_state_load_samples);
+   replay_us = (uint32_t)(netplay->ggpo_replay_accum_us
+         / netplay->ggpo_replay_samples);
+   step_us   = replay_us + save_us;
+   budget_us = (uint32_t)(1000000.0 / fps)
+      * NETPLAY_GGPO_PROFILE_BUDGET_PCT / 100;
+
+   if (!step_us)
+      window = NETPLAY_GGPO_PROFILE_MAX_WINDOW;
+   else if (budget_us > load_us + step_us)
+      window = (budget_us - load_us - step_us) / step_us;
+   if (window < 1)
+      window = 1;
+   else if (window > NETPLAY_GGPO_PROFILE_MAX_WINDOW)
+      window = NETPLAY_GGPO_PROFILE_MAX_WINDOW;
+
+   /* Bigger states compress faster at some cost in ratio; a compressor
+    * that has been queueing gets one more step. */
+   if (netplay->ggpo_state_size <= 256 * 1024)
+      accel = 1;
+   else if (netplay->ggpo_state_size <= 2 * 1024 * 1024)
+      accel = 4;
+   else
+      accel = 8;
+   if (     GGPO_SUCCEEDED(ggpo_get_state_stats(netplay->ggpo, &stats))
+         && stats.compress_job_queue_max > 2)
+      accel *= 2;
+
+   RARCH_LOG("[GGPO] Core profile: state %u bytes, save %u us, load %u us, "
+         "replay %u us of a %u us budget; prediction window %u, "
+         "LZ4 acceleration %u.\n",
+         netplay->ggpo_state_size, save_us, load_us, replay_us, budget_us,
+         window, accel);
+
+   if (!netplay_ggpo_profile_path(path, sizeof(path)))
+      return;
+
+   fill_pathname_basedir(dir, path, sizeof(dir));
+   if (!path_is_directory(dir) && !path_mkdir(dir))
+      return;
+
+   if (!(conf = config_file_new_alloc()))
+      return;
+
+   config_set_uint(conf, "ggpo_prediction_frames", window);
+   config_set_uint(conf, "ggpo_lz4_accel", accel);
+   config_set_uint(conf, "ggpo_state_size", netplay->ggpo_state_size);
+   config_set_uint(conf, "ggpo_state_save_us", save_us);
+   config_set_uint(conf, "ggpo_state_load_us", load_us);
+   config_set_uint(conf, "ggpo_replay_us", replay_us);
+   if (!config_file_write(conf, path, true))
+      RARCH_WARN("[GGPO] Could not write core profile \"%s\".\n", path);
+   config_file_free(conf);
+}
+
+#ifdef HAVE_THREADS
+/* Puts GGPO's threads in the role registry, under GGPO's names */
+static void __cdecl netplay_ggpo_thread_hook(const char *role, bool started)
+{
+   if (started)
+      sthread_role_register(role);
+   else
+      sthread_role_unregister();
+}
+#endif
+
 static void netplay_ggpo_apply_env_settings(const settings_t *settings)
 {
+   unsigned lz4_accel;
+   unsigned prediction_frames;
+
    if (!settings)
       return;
 
-   netplay_ggpo_set_env_int("ggpo.sync.lz4_accel",
-         settings->uints.netplay_ggpo_lz4_accel);
+   lz4_accel         = settings->uints.netplay_ggpo_lz4_accel;
+   prediction_frames = settings->uints.netplay_ggpo_prediction_frames;
+
+   /* Settings left at 0 start from what earlier sessions measured. */
+   if (!lz4_accel || !prediction_frames)
+   {
+      char path[PATH_MAX_LENGTH];
+      config_file_t *conf = NULL;
+
+      if (     netplay_ggpo_profile_path(path, sizeof(path))
+            && path_is_valid(path)
+            && (conf = config_file_new(path)))
+      {
+         if (!lz4_accel)
+            config_get_uint(conf, "ggpo_lz4_accel", &lz4_accel);
+         if (!prediction_frames)
+            config_get_uint(conf, "ggpo_prediction_frames",
+                  &prediction_frames);
+         config_file_free(conf);
+         RARCH_LOG("[GGPO] Core profile: prediction window %u, "
+               "LZ4 acceleration %u.\n", prediction_frames, lz4_accel);
+      }
+   }
+
+   netplay_ggpo_set_env_int("ggpo.sync.lz4_accel", lz4_accel);
    netplay_ggpo_set_env_int("ggpo.network.delay",
          settings->uints.netplay_ggpo_network_delay);
    netplay_ggpo_set_env_int("ggpo.oop.percent",
@@ -8374,8 +9726,29 @@ static void netplay_ggpo_apply_env_settings(const settings_t *settings)
          settings->uints.netplay_ggpo_send_interval);
    netplay_ggpo_set_env_int("ggpo.network.max_input_bits",
          settings->uints.netplay_ggpo_max_input_bits);
+   netplay_ggpo_set_env_int("ggpo.network.fec",
+         settings->uints.netplay_ggpo_input_fec);
    netplay_ggpo_set_env_int("ggpo.sync.prediction_frames",
-         settings->uints.netplay_ggpo_prediction_frames);
+         prediction_frames);
+   netplay_ggpo_set_env_int("ggpo.sync.keyframe_interval",
+         settings->uints.netplay_ggpo_keyframe_interval);
+   netplay_ggpo_set_env_int("ggpo.network.thread",
+         settings->bools.netplay_ggpo_network_thread ? 1 : 0);
+   /* Only the leading joypad word holds buttons; analog words repeat. */
+   netplay_ggpo_set_env_int("ggpo.input.predictor",
+         settings->uints.input_predictor);
+   netplay_ggpo_set_env_int("ggpo.input.predict_bytes", sizeof(uint32_t));
+   /* Peers compare confirmed frames that are multiples of this, so keep it
+    * a multiple of the checksum interval or every exchanged checksum is 0. */
+   netplay_ggpo_set_env_int("ggpo.sync.checksum_frames",
+         settings->uints.netplay_ggpo_checksum_interval
+         ? ((60 + settings->uints.netplay_ggpo_checksum_interval - 1)
+            / settings->uints.netplay_ggpo_checksum_interval)
+            * settings->uints.netplay_ggpo_checksum_interval
+         : 60);
+#ifdef HAVE_THREADS
+   ggpo_set_thread_hook(netplay_ggpo_thread_hook);
+#endif
 }
 
 static bool netplay_ggpo_update_delta_stats(netplay_t *netplay)
@@ -8422,43 +9795,243 @@ static bool netplay_ggpo_update_delta_stats(netplay_t *netplay)
    return true;
 }
 
-static bool __cdecl netplay_ggpo_save_game_state(
-      unsigned char **buffer, int *len, int *checksum, int frame)
+/* Passes the blocks the core reports dirty since the state GGPO last
+ * saved or loaded on as hint ranges. The core state sits after the
+ * NETPLAY and MEM headers; everything after it is hinted as changed. */
+static void netplay_ggpo_hint_state_changes(netplay_t *netplay,
+      size_t state_size)
 {
-   netplay_t *netplay = networking_driver_st.data;
-   retro_ctx_serialize_info_t serial_info = {0};
-   unsigned char *data = NULL;
-   retro_time_t start_usec;
-   retro_time_t end_usec;
+   size_t i, count  = 0;
+   size_t block     = core_serialize_dirty_block_size();
+   size_t core_end  = netplay->coremem_offset + netplay->coremem_size;
+   size_t blocks    = (netplay->coremem_size + block - 1) / block;
+
+   if (blocks > netplay->ggpo_dirty_blocks)
+   {
+      /* Alternating blocks need a range each, plus the tail */
+      uint8_t *map             = (uint8_t*)realloc(
+            netplay->ggpo_dirty_map, (blocks + 7) / 8);
+      GGPOStateRange *ranges;
+
+      if (map)
+         netplay->ggpo_dirty_map = map;
+      ranges = (GGPOStateRange*)realloc(netplay->ggpo_dirty_ranges,
+            (blocks / 2 + 2) * sizeof(*ranges));
+      if (ranges)
+         netplay->ggpo_dirty_ranges = ranges;
+      if (!map || !ranges)
+         return;
+      netplay->ggpo_dirty_blocks = blocks;
+   }
+
+   if (!core_serialize_dirty(netplay->ggpo_dirty_map, (blocks + 7) / 8))
+      return;
+
+   for (i = 0; i < blocks; i++)
+   {
+      size_t offset, length;
+
+      if (!(netplay->ggpo_dirty_map[i / 8] & (1 << (i % 8))))
+         continue;
+
+      offset = netplay->coremem_offset + i * block;
+      length = MIN(block, core_end - offset);
+      if (count && (size_t)(netplay->ggpo_dirty_ranges[count - 1].offset
+               + netplay->ggpo_dirty_ranges[count - 1].length) == offset)
+         netplay->ggpo_dirty_ranges[count - 1].length += (int)length;
+      else
+      {
+         netplay->ggpo_dirty_ranges[count].offset = (int)offset;
+         netplay->ggpo_dirty_ranges[count].length = (int)length;
+         count++;
+      }
+   }
+
+   /* Alignment padding and the achievements block */
+   if (state_size > core_end)
+   {
+      netplay->ggpo_dirty_ranges[count].offset = (int)core_end;
+      netplay->ggpo_dirty_ranges[count].length = (int)(state_size - core_end);
+      count++;
+   }
+
+   ggpo_hint_state_changes(netplay->ggpo, netplay->ggpo_dirty_ranges,
+         (int)count);
+}
+
+/* Where the len bytes at region sit in the state, or -1. A probe that
+ * is not one byte repeated is looked for first, then all of it. */
+static ssize_t netplay_ggpo_find_region(const uint8_t *state,
+      size_t state_size, const uint8_t *region, size_t len)
+{
+   size_t probe;
+   const uint8_t *pos = state;
+   const uint8_t *end = state + state_size;
+
+   for (probe = 0; probe + GGPO_STATE_REGION_PROBE <= len;
+         probe += GGPO_STATE_REGION_PROBE)
+      if (memcmp(region + probe, region + probe + 1,
+               GGPO_STATE_REGION_PROBE - 1))
+         break;
+   if (probe + GGPO_STATE_REGION_PROBE > len)
+      return -1;
+
+   while ((pos = (const uint8_t*)memchr(pos, region[probe],
+               end - pos)))
+   {
+      size_t start = pos - state;
+
+      if (start >= probe
+            && start - probe + len <= state_size
+            && !memcmp(pos, region + probe, GGPO_STATE_REGION_PROBE)
+            && !memcmp(state + start - probe, region, len))
+         return (ssize_t)(start - probe);
+      pos++;
+   }
+   return -1;
+}
+
+/* Tells GGPO where the large regions of the core's memory map sit in
+ * its state, so keyframes are compressed region by region. Only for a
+ * stable layout, where they stay where they were found. A region that
+ * is read-only, can't be found or overlaps one already placed is left
+ * out; regions only steer compression, so that costs no more than
+ * speed. */
+static void netplay_ggpo_set_state_regions(netplay_t *netplay)
+{
+   size_t i;
+   unsigned count = 0;
+   GGPOStateRegion regions[GGPO_STATE_REGIONS_MAX];
+   retro_ctx_serialize_info_t serial_info = {0};
+   const rarch_memory_map_t *mmaps =
+      &runloop_state_get_ptr()->system.mmaps;
+   uint8_t *state;
+   const uint8_t *core;
+
+   if (!mmaps->num_descriptors || !netplay_core_layout_stable())
+      return;
+   if (!(state = (uint8_t*)malloc(netplay->state_size)))
+      return;
+
+   serial_info.data = state;
+   serial_info.size = netplay->state_size;
+   if (!netplay_build_savestate(netplay, &serial_info, false))
+   {
+      free(state);
+      return;
+   }
+   core = state + netplay->coremem_offset;
+
+   for (i = 0; i < mmaps->num_descriptors
+         && count < GGPO_STATE_REGIONS_MAX; i++)
+   {
+      unsigned j;
+      ssize_t offset;
+      const struct retro_memory_descriptor *desc =
+         &mmaps->descriptors[i].core;
+
+      if (     !desc->ptr
+            || (desc->flags & RETRO_MEMDESC_CONST)
+            || desc->len < GGPO_STATE_REGION_MIN
+            || desc->len > netplay->coremem_size)
+         continue;
+      if ((offset = netplay_ggpo_find_region(core, netplay->coremem_size,
+               (const uint8_t*)desc->ptr + desc->offset, desc->len)) < 0)
+         continue;
+      offset += netplay->coremem_offset;
+
+      /* Mirrors of one block all find the same place */
+      for (j = 0; j < count; j++)
+         if (     (size_t)offset < (size_t)(regions[j].offset + regions[j].length)
+               && (size_t)regions[j].offset < (size_t)offset + desc->len)
+            break;
+      if (j < count)
+         continue;
+
+      regions[count].offset = (int)offset;
+      regions[count].length = (int)desc->len;
+      if (desc->flags & RETRO_MEMDESC_VIDEO_RAM)
+         regions[count].kind = GGPO_STATE_REGION_VIDEO_RAM;
+      else if (desc->flags & RETRO_MEMDESC_SAVE_RAM)
+         regions[count].kind = GGPO_STATE_REGION_SAVE_RAM;
+      else if (desc->flags & RETRO_MEMDESC_SYSTEM_RAM)
+         regions[count].kind = GGPO_STATE_REGION_WORK_RAM;
+      else
+         regions[count].kind = GGPO_STATE_REGION_OTHER;
+      count++;
+   }
+   free(state);
+
+   if (count)
+   {
+      RARCH_LOG("[GGPO] Found %u memory map regions in the core state.\n",
+            count);
+      ggpo_set_state_regions(netplay->ggpo, regions, (int)count);
+   }
+}
+
+static bool __cdecl netplay_ggpo_save_game_state(
+      unsigned char **buffer, int *len, int *checksum, int frame)
+{
+   netplay_t *netplay = networking_driver_st.data;
+   retro_ctx_serialize_info_t serial_info = {0};
+   unsigned char *data = NULL;
+   bool reused = false;
+   bool baseline;
+   retro_time_t start_usec;
+   retro_time_t end_usec;
    uint32_t elapsed_us;
    uint32_t save_avg_us = 0;
    uint32_t load_avg_us = 0;
    uint32_t delta_total = 0;
 
-   (void)frame;
-
    if (!netplay || !len || !buffer)
       return false;
 
    start_usec = cpu_features_get_time_usec();
 
-   data = (unsigned char*)malloc(netplay->state_size);
-   if (!data)
-      return false;
+   /* GGPO hands back one of our earlier buffers along with its capacity;
+    * serialize straight into it unless the state has outgrown it. */
+   if (*buffer && *len > 0 && (size_t)*len >= netplay->state_size)
+   {
+      data   = *buffer;
+      reused = true;
+   }
+   else
+   {
+      data   = (unsigned char*)memalign_alloc_large(netplay->state_size);
+      if (!data)
+         return false;
+   }
 
    serial_info.data = data;
    serial_info.size = netplay->state_size;
 
+   baseline = netplay->ggpo_dirty_baseline
+      && netplay->ggpo_dirty_generation == core_serialize_generation();
+   /* GGPO drops the frame on failure, so nothing is left to delta against */
+   netplay->ggpo_dirty_baseline = false;
+
    if (!netplay_build_savestate(netplay, &serial_info, true))
    {
-      free(data);
+      if (!reused)
+         memalign_free_large(data);
       return false;
    }
 
    *buffer = data;
    *len = (int)serial_info.size;
+
+   if (core_serialize_dirty_block_size())
+   {
+      if (baseline)
+         netplay_ggpo_hint_state_changes(netplay, serial_info.size);
+      netplay->ggpo_dirty_generation = core_serialize_generation();
+      netplay->ggpo_dirty_baseline   = true;
+   }
+   /* See netplay_ggpo_checksum_game_state */
    if (checksum)
-      *checksum = (int)encoding_crc32(0, data, serial_info.size);
+      *checksum = 0;
 
    end_usec = cpu_features_get_time_usec();
    elapsed_us = (uint32_t)(end_usec - start_usec);
@@ -8468,6 +10041,9 @@ static bool __cdecl netplay_ggpo_save_game_state(
    netplay->ggpo_state_save_samples++;
    if (elapsed_us > netplay->ggpo_state_save_max_us)
       netplay->ggpo_state_save_max_us = elapsed_us;
+   if (netplay->ggpo_synctest)
+      netplay->ggpo_synctest->save_us[netplay->ggpo_synctest->save_count++
+         % NETPLAY_GGPO_SYNCTEST_SAMPLES] = elapsed_us;
    netplay->ggpo_state_size = (uint32_t)serial_info.size;
 
    if (verbosity_is_enabled())
@@ -8478,6 +10054,8 @@ static bool __cdecl netplay_ggpo_save_game_state(
       if (end_usec - netplay->ggpo_state_log_time >=
             GGPO_STATE_LOG_INTERVAL_USEC)
       {
+         GGPORollbackStats rb;
+
          netplay_ggpo_update_delta_stats(netplay);
 
          if (netplay->ggpo_state_save_samples)
@@ -8501,6 +10079,17 @@ static bool __cdecl netplay_ggpo_save_game_state(
             netplay->ggpo_delta_ratio_max,
             netplay->ggpo_delta_keyframes, delta_total);
 
+         if (     GGPO_SUCCEEDED(ggpo_get_rollback_stats(netplay->ggpo, &rb))
+               && rb.rollbacks > 0)
+            RARCH_LOG("[GGPO] Rollbacks %d (%d frames), depth p50/p95/p99/max %d/%d/%d/%d, total p50/p95/p99 %d/%d/%d us (max %d us), load p99 %d us, resim p99 %d us, save p99 %d us, predicted %d/%d frames.\n",
+               rb.rollbacks, rb.frames_resimulated,
+               rb.depth_p50, rb.depth_p95, rb.depth_p99, rb.depth_max,
+               rb.total.p50_us, rb.total.p95_us, rb.total.p99_us,
+               rb.total.max_us, rb.load.p99_us, rb.resim.p99_us,
+               rb.save.p99_us,
+               rb.predicted_frames - rb.mispredicted_frames,
+               rb.predicted_frames);
+
          netplay->ggpo_state_log_time = end_usec;
       }
    }
@@ -8508,6 +10097,21 @@ static bool __cdecl netplay_ggpo_save_game_state(
    return true;
 }
 
+/* GGPO calls this from its compression thread once the state has been
+ * handed over, so hashing stays off the frame. Only sampled frames are
+ * hashed; the rest carry no checksum. */
+static int __cdecl netplay_ggpo_checksum_game_state(
+      const unsigned char *buffer, int len, int frame)
+{
+   netplay_t *netplay = networking_driver_st.data;
+
+   if (     !netplay
+         || !netplay->ggpo_checksum_interval
+         || (frame % netplay->ggpo_checksum_interval) != 0)
+      return 0;
+   return (int)(uint32_t)XXH3_64bits(buffer, (size_t)len);
+}
+
 static bool __cdecl netplay_ggpo_load_game_state(unsigned char *buffer, int len)
 {
    netplay_t *netplay = networking_driver_st.data;
@@ -8522,11 +10126,18 @@ static bool __cdecl netplay_ggpo_load_game_state(unsigned char *buffer, int len)
 
    start_usec = cpu_features_get_time_usec();
 
+   /* A rollback before this one in the same gap is over */
+   netplay_ggpo_splice_tag(&netplay->ggpo_splice);
+
    serial_info.data_const = buffer;
    serial_info.size = (size_t)len;
 
    result = netplay_process_savestate(netplay, &serial_info);
 
+   /* GGPO deltas the next save against this state either way */
+   netplay->ggpo_dirty_generation = core_serialize_generation();
+   netplay->ggpo_dirty_baseline   = result;
+
    end_usec = cpu_features_get_time_usec();
    elapsed_us = (uint32_t)(end_usec - start_usec);
 
@@ -8535,6 +10146,9 @@ static bool __cdecl netplay_ggpo_load_game_state(unsigned char *buffer, int len)
    netplay->ggpo_state_load_samples++;
    if (elapsed_us > netplay->ggpo_state_load_max_us)
       netplay->ggpo_state_load_max_us = elapsed_us;
+   if (netplay->ggpo_synctest)
+      netplay->ggpo_synctest->load_us[netplay->ggpo_synctest->load_count++
+         % NETPLAY_GGPO_SYNCTEST_SAMPLES] = elapsed_us;
 
    return result;
 }
@@ -8542,21 +10156,22 @@ static bool __cdecl netplay_ggpo_load_game_state(unsigned char *buffer, int len)
 static bool __cdecl netplay_ggpo_log_game_state(
       char *filename, unsigned char *buffer, int len)
 {
-   (void)filename;
-   (void)buffer;
-   (void)len;
-   return true;
+   if (!filename || !buffer || len <= 0)
+      return false;
+
+   return filestream_write_file(filename, buffer, len);
 }
 
 static void __cdecl netplay_ggpo_free_buffer(void *buffer)
 {
-   free(buffer);
+   memalign_free_large(buffer);
 }
 
 static bool __cdecl netplay_ggpo_advance_frame(int flags)
 {
    netplay_t *netplay = networking_driver_st.data;
    GGPOErrorCode result;
+   retro_time_t start_usec;
    int disconnect_flags = 0;
 
    (void)flags;
@@ -8579,6 +10194,8 @@ static bool __cdecl netplay_ggpo_advance_frame(int flags)
    netplay->ggpo_in_rollback = true;
    netplay->is_replay = true;
 
+   start_usec = cpu_features_get_time_usec();
+   netplay_ggpo_splice_begin_replay(netplay);
 #ifdef HAVE_THREADS
    autosave_lock();
 #endif
@@ -8586,6 +10203,9 @@ static bool __cdecl netplay_ggpo_advance_frame(int flags)
 #ifdef HAVE_THREADS
    autosave_unlock();
 #endif
+   netplay->ggpo_replay_accum_us += (uint64_t)
+      (cpu_features_get_time_usec() - start_usec);
+   netplay->ggpo_replay_samples++;
 
    netplay->is_replay = false;
    netplay->ggpo_in_rollback = false;
@@ -8595,6 +10215,449 @@ static bool __cdecl netplay_ggpo_advance_frame(int flags)
    return true;
 }
 
+/* Batched rollback: GGPO hands over the inputs for a whole run of frames
+ * and saves state itself afterwards, so the core can be run back to back
+ * under a single autosave lock. */
+static bool __cdecl netplay_ggpo_advance_frames(const void *inputs, int size,
+      const int *disconnect_flags, int count, int flags)
+{
+   netplay_t *netplay = networking_driver_st.data;
+   retro_time_t start_usec;
+   size_t frame_size;
+   int i;
+
+   (void)flags;
+
+   if (!netplay || !netplay->ggpo || !inputs || count <= 0)
+      return false;
+
+   frame_size = netplay->ggpo_input_size * netplay->ggpo_player_count;
+   if (size <= 0 || (size_t)size < frame_size)
+      return false;
+
+   netplay->ggpo_rollback_frames += (uint32_t)count;
+   netplay->ggpo_in_rollback = true;
+   netplay->is_replay = true;
+
+   start_usec = cpu_features_get_time_usec();
+#ifdef HAVE_THREADS
+   autosave_lock();
+#endif
+   for (i = 0; i < count; i++)
+   {
+      memcpy(netplay->ggpo_sync_inputs,
+            (const uint8_t*)inputs + (size_t)i * (size_t)size, frame_size);
+      netplay->ggpo_disconnect_flags = disconnect_flags
+         ? (uint32_t)disconnect_flags[i] : 0;
+      netplay_ggpo_splice_begin_replay(netplay);
+      core_run();
+   }
+#ifdef HAVE_THREADS
+   autosave_unlock();
+#endif
+   netplay->ggpo_replay_accum_us += (uint64_t)
+      (cpu_features_get_time_usec() - start_usec);
+   netplay->ggpo_replay_samples += (uint32_t)count;
+
+   netplay->is_replay = false;
+   netplay->ggpo_in_rollback = false;
+
+   return true;
+}
+
+/* Copies a state GGPO kept for an exchanged checksum, or returns NULL
+ * once it has been dropped from the history. */
+static uint8_t *netplay_ggpo_checksum_state(netplay_t *netplay, int frame,
+      size_t *size)
+{
+   uint8_t *buf;
+   int len = 0;
+
+   if (frame < 0
+         || !GGPO_SUCCEEDED(ggpo_get_checksum_state(netplay->ggpo, frame,
+               NULL, &len))
+         || len <= 0
+         || !(buf = (uint8_t*)malloc((size_t)len)))
+      return NULL;
+
+   if (!GGPO_SUCCEEDED(ggpo_get_checksum_state(netplay->ggpo, frame,
+         buf, &len)))
+   {
+      free(buf);
+      return NULL;
+   }
+
+   *size = (size_t)len;
+   return buf;
+}
+
+/**
+ * netplay_ggpo_desync
+ * @netplay              : pointer to netplay object
+ * @info                 : the GGPO_EVENTCODE_DESYNC event
+ *
+ * A peer's checksum of a confirmed frame differs from ours. Logs it, tells
+ * the user once per session, and hands the states at the frame and at the
+ * last matching one to a task that writes them out with a block report.
+ * Only the first few desyncs are dumped; after one the peers rarely agree
+ * again, and every later frame would otherwise land on disk.
+ **/
+static void netplay_ggpo_desync(netplay_t *netplay, const GGPOEvent *info)
+{
+   struct netplay_ggpo_desync_dump *dump;
+   const char *dir = dir_get_ptr(RARCH_DIR_SAVESTATE);
+   char name[64];
+
+   /* The sync test has written both states to synclogs/ already; the
+    * first divergence is all a qualification run needs. */
+   if (netplay->ggpo_synctest)
+   {
+      if (netplay->ggpo_synctest->first_desync < 0)
+      {
+         RARCH_ERR("[GGPO] Frame %d replayed to checksum %08x, first run "
+               "had %08x.\n",
+               info->u.desync.frame,
+               (unsigned)info->u.desync.local_checksum,
+               (unsigned)info->u.desync.remote_checksum);
+         netplay->ggpo_synctest->first_desync = info->u.desync.frame;
+         netplay->ggpo_synctest->last_match   =
+            info->u.desync.last_match_frame;
+         runloop_state_get_ptr()->flags |= RUNLOOP_FLAG_SHUTDOWN_INITIATED;
+      }
+      return;
+   }
+
+   RARCH_ERR("[GGPO] Desync at frame %d: checksum %08x, player %d has "
+         "%08x; last match at frame %d.\n",
+         info->u.desync.frame, (unsigned)info->u.desync.local_checksum,
+         (int)info->u.desync.player,
+         (unsigned)info->u.desync.remote_checksum,
+         info->u.desync.last_match_frame);
+
+   if (netplay->ggpo_desyncs++ >= NETPLAY_GGPO_DESYNC_DUMPS)
+      return;
+
+   if (netplay->ggpo_desyncs == 1)
+   {
+      char msg[128];
+      size_t _len = snprintf(msg, sizeof(msg),
+            msg_hash_to_str(MSG_NETPLAY_GGPO_DESYNC), info->u.desync.frame);
+      runloop_msg_queue_push(msg, _len, 1, 180, false, NULL,
+            MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_WARNING);
+   }
+
+   if (string_is_empty(dir))
+      return;
+
+   if (!(dump = (struct netplay_ggpo_desync_dump*)calloc(1, sizeof(*dump))))
+      return;
+
+   dump->frame           = info->u.desync.frame;
+   dump->base_frame      = info->u.desync.last_match_frame;
+   dump->player          = (int)info->u.desync.player;
+   dump->local_checksum  = (uint32_t)info->u.desync.local_checksum;
+   dump->remote_checksum = (uint32_t)info->u.desync.remote_checksum;
+   dump->state = netplay_ggpo_checksum_state(netplay, dump->frame,
+         &dump->state_size);
+   dump->base  = netplay_ggpo_checksum_state(netplay, dump->base_frame,
+         &dump->base_size);
+
+   if (!dump->state)
+   {
+      RARCH_WARN("[GGPO] State of frame %d is no longer kept.\n",
+            dump->frame);
+      netplay_ggpo_desync_dump_free(dump);
+      return;
+   }
+
+   snprintf(name, sizeof(name), "netplay_desync_%d_%08x",
+         dump->frame, (unsigned)dump->local_checksum);
+   fill_pathname_join_special(dump->path, dir, name, sizeof(dump->path));
+
+   if (!task_push_netplay_ggpo_desync_dump(dump))
+      netplay_ggpo_desync_dump_free(dump);
+}
+
+/**
+ * netplay_ggpo_delay_init
+ * @netplay              : pointer to netplay object
+ * @settings             : settings the session starts with
+ *
+ * Starts the session at netplay_input_latency_frames_min frames of
+ * input delay. With netplay_input_latency_frames_range set, the delay
+ * then follows the link within that many frames above it.
+ **/
+static void netplay_ggpo_delay_init(netplay_t *netplay,
+      const settings_t *settings)
+{
+   struct netplay_ggpo_delay *delay = &netplay->ggpo_delay;
+
+   free(delay->last_input);
+   memset(delay, 0, sizeof(*delay));
+   delay->frames_min = settings->uints.netplay_input_latency_frames_min;
+   delay->frames_max = delay->frames_min
+      + settings->uints.netplay_input_latency_frames_range;
+   delay->frames     = delay->frames_min;
+   delay->target     = delay->frames_min;
+   delay->leader     = netplay->ggpo_local_player_index
+      < netplay->ggpo_remote_player_index;
+   if (delay->frames_max > delay->frames_min)
+      delay->last_input = (uint32_t*)calloc(1, netplay->ggpo_input_size);
+   delay->enabled    = delay->last_input != NULL;
+
+   if (delay->frames)
+      ggpo_set_frame_delay(netplay->ggpo, netplay->ggpo_local_handle,
+            (int)delay->frames);
+}
+
+static void netplay_ggpo_delay_set_target(netplay_t *netplay,
+      unsigned frames)
+{
+   struct netplay_ggpo_delay *delay = &netplay->ggpo_delay;
+
+   if (frames < delay->frames_min)
+      frames = delay->frames_min;
+   else if (frames > delay->frames_max)
+      frames = delay->frames_max;
+   if (frames == delay->target)
+      return;
+
+   RARCH_LOG("[GGPO] Input delay going from %u to %u frames.\n",
+         delay->target, frames);
+   delay->target       = frames;
+   delay->hold_until   = cpu_features_get_time_usec()
+      + NETPLAY_GGPO_DELAY_HOLD_USEC;
+   delay->up_samples   = 0;
+   delay->down_samples = 0;
+}
+
+static void netplay_ggpo_delay_propose(netplay_t *netplay, unsigned frames)
+{
+   struct netplay_ggpo_delay *delay = &netplay->ggpo_delay;
+   uint8_t msg[3];
+   GGPOErrorCode result;
+
+   msg[0] = NETPLAY_GGPO_CONTROL_DELAY;
+   msg[1] = ++delay->seq;
+   msg[2] = (uint8_t)frames;
+   result = ggpo_send_control(netplay->ggpo, netplay->ggpo_remote_handle,
+         msg, sizeof(msg));
+   if (result == GGPO_ERRORCODE_UNSUPPORTED)
+   {
+      /* Changing on one side only would hand the other an advantage */
+      RARCH_LOG("[GGPO] The peer can't agree on input delay changes; "
+            "keeping %u frames.\n", delay->target);
+      delay->enabled = false;
+   }
+   else if (GGPO_SUCCEEDED(result))
+      delay->proposing = true;
+}
+
+/**
+ * netplay_ggpo_delay_sample
+ * @netplay              : pointer to netplay object
+ * @now                  : current time
+ *
+ * The leader's side of the adaptive input delay. The delay wants to
+ * cover the one-way trip and twice the jitter, less
+ * NETPLAY_GGPO_DELAY_ROLLBACK frames left to rollback; going down
+ * needs half a frame more room than going up, so a ping on the edge
+ * doesn't flip it every sample. A quarter of the rollbacks since the
+ * last sample running deeper than NETPLAY_GGPO_DELAY_DEEP frames asks
+ * for a frame more whatever the ping says, and any deep one holds it.
+ **/
+static void netplay_ggpo_delay_sample(netplay_t *netplay, retro_time_t now)
+{
+   struct netplay_ggpo_delay *delay = &netplay->ggpo_delay;
+   GGPONetworkStats stats;
+   GGPORollbackStats rollback;
+   double fps = video_state_get_ptr()->av_info.timing.fps;
+   uint32_t frame_us, need_us, ping_us, dev_us;
+   unsigned up, down, rollbacks, deep, i;
+   unsigned deep_total  = 0;
+
+   delay->next_sample = now + NETPLAY_GGPO_DELAY_SAMPLE_USEC;
+   if (     !GGPO_SUCCEEDED(ggpo_get_network_stats(netplay->ggpo,
+                  netplay->ggpo_remote_handle, &stats))
+         || !GGPO_SUCCEEDED(ggpo_get_rollback_stats(netplay->ggpo, &rollback))
+         || stats.network.ping_us <= 0)
+      return;
+
+   for (i = NETPLAY_GGPO_DELAY_DEEP + 1; i < GGPO_ROLLBACK_DEPTH_BUCKETS; i++)
+      deep_total += (unsigned)rollback.depth_histogram[i];
+   rollbacks             = (unsigned)rollback.rollbacks - delay->rollbacks;
+   deep                  = deep_total - delay->deep_rollbacks;
+   delay->rollbacks      = (unsigned)rollback.rollbacks;
+   delay->deep_rollbacks = deep_total;
+
+   ping_us = (uint32_t)stats.network.ping_us;
+   if (!delay->ping_us)
+   {
+      /* The first sample only sets the baselines */
+      delay->ping_us = ping_us;
+      return;
+   }
+   dev_us = (ping_us > delay->ping_us)
+      ? ping_us - delay->ping_us : delay->ping_us - ping_us;
+   delay->ping_us   = (delay->ping_us   * 3 + ping_us) / 4;
+   delay->jitter_us = (delay->jitter_us * 3 + dev_us)  / 4;
+
+   if (delay->proposing || now < delay->hold_until)
+      return;
+
+   frame_us = (uint32_t)(1000000.0 / ((fps > 0) ? fps : 60.0));
+   need_us  = delay->ping_us / 2 + 2 * delay->jitter_us;
+   up       = (need_us + frame_us - 1) / frame_us;
+   down     = (need_us + frame_us / 2 + frame_us - 1) / frame_us;
+   up       = (up   > NETPLAY_GGPO_DELAY_ROLLBACK)
+      ? up   - NETPLAY_GGPO_DELAY_ROLLBACK : 0;
+   down     = (down > NETPLAY_GGPO_DELAY_ROLLBACK)
+      ? down - NETPLAY_GGPO_DELAY_ROLLBACK : 0;
+
+   if (     delay->target < delay->frames_max
+         && (up > delay->target || (rollbacks && deep * 4 >= rollbacks)))
+      delay->up_samples++;
+   else
+      delay->up_samples = 0;
+   if (     delay->target > delay->frames_min
+         && down < delay->target && !deep)
+      delay->down_samples++;
+   else
+      delay->down_samples = 0;
+
+   if (delay->up_samples >= NETPLAY_GGPO_DELAY_UP_SAMPLES)
+      netplay_ggpo_delay_propose(netplay, delay->target + 1);
+   else if (delay->down_samples >= NETPLAY_GGPO_DELAY_DOWN_SAMPLES)
+      netplay_ggpo_delay_propose(netplay, delay->target - 1);
+}
+
+static void netplay_ggpo_delay_on_control(netplay_t *netplay,
+      const GGPOEvent *info)
+{
+   struct netplay_ggpo_delay *delay = &netplay->ggpo_delay;
+   const unsigned char *data        = info->u.control.data;
+   unsigned frames;
+
+   if (info->u.control.size < 3)
+      return;
+   frames = data[2];
+
+   switch (data[0])
+   {
+      case NETPLAY_GGPO_CONTROL_DELAY:
+         {
+            /* Answer with what our own range allows; a side left
+             * without one keeps its delay */
+            uint8_t ack[3];
+            if (!delay->enabled)
+               frames = delay->target;
+            else if (frames < delay->frames_min)
+               frames = delay->frames_min;
+            else if (frames > delay->frames_max)
+               frames = delay->frames_max;
+            ack[0] = NETPLAY_GGPO_CONTROL_DELAY_ACK;
+            ack[1] = data[1];
+            ack[2] = (uint8_t)frames;
+            ggpo_send_control(netplay->ggpo, info->u.control.player,
+                  ack, sizeof(ack));
+            netplay_ggpo_delay_set_target(netplay, frames);
+         }
+         break;
+
+      case NETPLAY_GGPO_CONTROL_DELAY_ACK:
+         if (!delay->proposing || data[1] != delay->seq)
+            break;
+         delay->proposing = false;
+         if (frames == delay->target)
+            delay->hold_until = cpu_features_get_time_usec()
+               + NETPLAY_GGPO_DELAY_HOLD_USEC;
+         else
+            netplay_ggpo_delay_set_target(netplay, frames);
+         break;
+   }
+}
+
+/* Steps the frame delay a frame towards the agreed target, when the
+ * input about to be added is the same as the last one added */
+static void netplay_ggpo_delay_step(netplay_t *netplay)
+{
+   struct netplay_ggpo_delay *delay = &netplay->ggpo_delay;
+   unsigned frames;
+
+   if (     delay->frames == delay->target
+         || !delay->last_input_valid
+         || memcmp(delay->last_input, netplay->ggpo_local_input,
+               netplay->ggpo_input_size))
+      return;
+
+   frames = (delay->target > delay->frames)
+      ? delay->frames + 1 : delay->frames - 1;
+   if (GGPO_SUCCEEDED(ggpo_set_frame_delay(netplay->ggpo,
+         netplay->ggpo_local_handle, (int)frames)))
+      delay->frames = frames;
+}
+
+/* The layout of the one device a player sends */
+static const struct netplay_ggpo_layout *netplay_ggpo_player_layout(
+      netplay_t *netplay, uint32_t devices)
+{
+   unsigned port;
+   for (port = 0; port < MAX_INPUT_DEVICES - 1; port++)
+      if (devices & (1U << port))
+         break;
+   return &netplay->ggpo_layout[port];
+}
+
+/* Tells the peer how this side packs both players' input. Both come
+ * to the same layout on their own; this catches a peer whose core
+ * declares other input. */
+static void netplay_ggpo_layout_send(netplay_t *netplay)
+{
+   uint8_t msg[8];
+   const struct netplay_ggpo_layout *local  = netplay_ggpo_player_layout(
+         netplay, netplay->ggpo_local_devices);
+   const struct netplay_ggpo_layout *remote = netplay_ggpo_player_layout(
+         netplay, netplay->ggpo_remote_devices);
+
+   msg[0] = NETPLAY_GGPO_CONTROL_LAYOUT;
+   msg[1] = (uint8_t)netplay->ggpo_input_size;
+   msg[2] = (uint8_t)local->buttons;
+   msg[3] = (uint8_t)(local->buttons >> 8);
+   msg[4] = local->axes;
+   msg[5] = (uint8_t)remote->buttons;
+   msg[6] = (uint8_t)(remote->buttons >> 8);
+   msg[7] = remote->axes;
+   ggpo_send_control(netplay->ggpo, netplay->ggpo_remote_handle,
+         msg, sizeof(msg));
+}
+
+static void netplay_ggpo_layout_on_control(netplay_t *netplay,
+      const GGPOEvent *info)
+{
+   const unsigned char *data                = info->u.control.data;
+   const struct netplay_ggpo_layout *local  = netplay_ggpo_player_layout(
+         netplay, netplay->ggpo_local_devices);
+   const struct netplay_ggpo_layout *remote = netplay_ggpo_player_layout(
+         netplay, netplay->ggpo_remote_devices);
+
+   if (info->u.control.size < 8)
+      return;
+
+   /* The peer's local player is our remote one */
+   if (     data[1]                     == netplay->ggpo_input_size
+         && (data[2] | (data[3] << 8))  == remote->buttons
+         && data[4]                     == remote->axes
+         && (data[5] | (data[6] << 8))  == local->buttons
+         && data[7]                     == local->axes)
+      return;
+
+   RARCH_ERR("[GGPO] The peer packs its input in %u bytes, buttons "
+         "0x%04X/0x%04X, axes 0x%X/0x%X; this side in %u bytes.\n",
+         data[1], data[2] | (data[3] << 8), data[5] | (data[6] << 8),
+         data[4], data[7], (unsigned)netplay->ggpo_input_size);
+   netplay->ggpo_layout_mismatch = true;
+}
+
 static bool __cdecl netplay_ggpo_on_event(GGPOEvent *info)
 {
    netplay_t *netplay = networking_driver_st.data;
@@ -8613,6 +10676,26 @@ static bool __cdecl netplay_ggpo_on_event(GGPOEvent *info)
          netplay->ggpo_running = true;
          netplay->stall = NETPLAY_STALL_NONE;
          netplay->self_mode = NETPLAY_CONNECTION_PLAYING;
+         if (!netplay->ggpo_synctest && !netplay->ggpo_spectator)
+            netplay_ggpo_layout_send(netplay);
+         if (netplay->ggpo_bringup == NETPLAY_GGPO_BRINGUP_SYNC)
+         {
+            retro_time_t now = cpu_features_get_time_usec();
+
+            netplay->ggpo_bringup_sync_us =
+               (uint32_t)(now - netplay->ggpo_bringup_session_start);
+            RARCH_LOG("[Netplay] GGPO bring-up took %u ms: lookup %u ms, "
+                  "exchange %u ms%s, session %u ms, sync %u ms; "
+                  "state ready after %u ms.\n",
+                  (unsigned)((now - netplay->ggpo_bringup_start) / 1000),
+                  netplay->ggpo_bringup_resolve_us / 1000,
+                  netplay->ggpo_bringup_exchange_us / 1000,
+                  netplay->ggpo_bringup_token ? " (token)" : "",
+                  netplay->ggpo_bringup_session_us / 1000,
+                  netplay->ggpo_bringup_sync_us / 1000,
+                  netplay->ggpo_bringup_state_us / 1000);
+            netplay->ggpo_bringup = NETPLAY_GGPO_BRINGUP_DONE;
+         }
          break;
 
       case GGPO_EVENTCODE_TIMESYNC:
@@ -8628,16 +10711,67 @@ static bool __cdecl netplay_ggpo_on_event(GGPOEvent *info)
          netplay->stall = NETPLAY_STALL_NONE;
          break;
 
+      /* The peer restarted within ggpo.network.reconnect_window; hold
+       * still until it has the state to carry on from */
+      case GGPO_EVENTCODE_PEER_REJOINING:
+         RARCH_LOG("[Netplay] GGPO peer is rejoining.\n");
+         netplay->stall = NETPLAY_STALL_RUNNING_FAST;
+         break;
+
+      case GGPO_EVENTCODE_PEER_REJOINED:
+         RARCH_LOG("[Netplay] GGPO peer rejoined at frame %d after %d ms "
+               "(%d bytes of state).\n",
+               info->u.rejoined.frame, info->u.rejoined.resume_ms,
+               info->u.rejoined.state_bytes);
+         netplay->stall = NETPLAY_STALL_NONE;
+         break;
+
+      case GGPO_EVENTCODE_KEYFRAME_LOADED:
+         RARCH_LOG("[Netplay] GGPO spectating from the relay's keyframe at frame %d "
+               "(%d bytes of state).\n",
+               info->u.keyframe_loaded.frame,
+               info->u.keyframe_loaded.state_bytes);
+         break;
+
       case GGPO_EVENTCODE_DISCONNECTED_FROM_PEER:
          netplay->ggpo_running = false;
          netplay->self_mode = NETPLAY_CONNECTION_NONE;
          netplay->stall = NETPLAY_STALL_NONE;
+         /* The broadcast ended and every frame was played; a node has
+          * nothing left to do, and quitting closes its recordings. */
+         if (netplay->ggpo_spectator)
+            runloop_state_get_ptr()->flags |= RUNLOOP_FLAG_SHUTDOWN_INITIATED;
+         break;
+
+      case GGPO_EVENTCODE_DESYNC:
+         netplay_ggpo_desync(netplay, info);
+         break;
+
+      case GGPO_EVENTCODE_CONTROL:
+         if (     info->u.control.size > 0
+               && info->u.control.data[0] == NETPLAY_GGPO_CONTROL_LAYOUT)
+            netplay_ggpo_layout_on_control(netplay, info);
+         else
+            netplay_ggpo_delay_on_control(netplay, info);
          break;
    }
 
    return true;
 }
 
+static void netplay_ggpo_session_callbacks(GGPOSessionCallbacks *cb)
+{
+   cb->begin_game      = netplay_ggpo_begin_game;
+   cb->save_game_state = netplay_ggpo_save_game_state;
+   cb->load_game_state = netplay_ggpo_load_game_state;
+   cb->log_game_state  = netplay_ggpo_log_game_state;
+   cb->free_buffer     = netplay_ggpo_free_buffer;
+   cb->advance_frame   = netplay_ggpo_advance_frame;
+   cb->advance_frames  = netplay_ggpo_advance_frames;
+   cb->on_event        = netplay_ggpo_on_event;
+   cb->checksum_game_state = netplay_ggpo_checksum_game_state;
+}
+
 static bool netplay_ggpo_init_session(netplay_t *netplay,
       const char *peer_address, uint16_t port)
 {
@@ -8674,19 +10808,305 @@ static bool netplay_ggpo_init_session(netplay_t *netplay,
       return false;
    }
 
-   netplay->ggpo_base_port = port;
+   netplay->ggpo_base_port = port;
+
+   if (netplay->is_server)
+      local_port = port;
+   else
+      local_port = (uint16_t)(port + 1);
+
+   if (netplay->ggpo_peer_port)
+      remote_port = netplay->ggpo_peer_port;
+   else if (netplay->is_server)
+      remote_port = (uint16_t)(port + 1);
+   else
+      remote_port = port;
+
+   if (!network_init())
+   {
+      RARCH_ERR("[Netplay] GGPO failed to initialize networking.\n");
+      return false;
+   }
+
+   snprintf(port_buf, sizeof(port_buf), "%hu", (unsigned short)port);
+   hints.ai_family = AF_INET;
+   hints.ai_socktype = SOCK_DGRAM;
+   hints.ai_flags |= AI_NUMERICSERV;
+
+   if (getaddrinfo_retro(peer_address, port_buf, &hints, &addr) || !addr)
+   {
+      RARCH_ERR("[Netplay] GGPO failed to resolve host: %s\n", peer_address);
+      return false;
+   }
+
+   if (!getnameinfo_retro(addr->ai_addr, addr->ai_addrlen,
+         resolved_ip, sizeof(resolved_ip), NULL, 0, NI_NUMERICHOST))
+      peer_ip = resolved_ip;
+   else
+      peer_ip = peer_address;
+
+   freeaddrinfo_retro(addr);
+   addr = NULL;
+
+   if (!netplay->state_size)
+   {
+      if (!netplay_wait_and_init_serialization(netplay))
+         return false;
+   }
+
+   netplay->ggpo_local_devices  = 1U << local_device_port;
+   netplay->ggpo_remote_devices = 1U << remote_device_port;
+   netplay->self_devices        = netplay->ggpo_local_devices;
+
+   if (!netplay_ggpo_init_input_layout(
+         netplay, local_device_port, remote_device_port))
+   {
+      RARCH_ERR("[Netplay] GGPO input layout is invalid.\n");
+      return false;
+   }
+
+   netplay->ggpo_player_count = 2;
+   netplay->ggpo_local_player_index = netplay->is_server ? 0 : 1;
+   netplay->ggpo_remote_player_index = netplay->is_server ? 1 : 0;
+   netplay->ggpo_local_devices = 1U << local_device_port;
+   netplay->ggpo_remote_devices = 1U << remote_device_port;
+   netplay->self_devices = netplay->ggpo_local_devices;
+
+   netplay->ggpo_local_input = (uint32_t*)calloc(1, netplay->ggpo_input_size);
+   netplay->ggpo_sync_inputs = (uint32_t*)calloc(
+         netplay->ggpo_player_count, netplay->ggpo_input_size);
+   if (!netplay->ggpo_local_input || !netplay->ggpo_sync_inputs)
+      return false;
+
+   netplay->ggpo_state_save_accum_us = 0;
+   netplay->ggpo_state_load_accum_us = 0;
+   netplay->ggpo_state_save_samples = 0;
+   netplay->ggpo_state_load_samples = 0;
+   netplay->ggpo_state_size = 0;
+   netplay->ggpo_state_save_us = 0;
+   netplay->ggpo_state_load_us = 0;
+   netplay->ggpo_state_save_max_us = 0;
+   netplay->ggpo_state_load_max_us = 0;
+   netplay->ggpo_delta_ratio_last = 0;
+   netplay->ggpo_delta_ratio_avg = 0;
+   netplay->ggpo_delta_ratio_max = 0;
+   netplay->ggpo_delta_frames = 0;
+   netplay->ggpo_delta_keyframes = 0;
+   netplay->ggpo_compress_job_queue_len = 0;
+   netplay->ggpo_compress_result_queue_len = 0;
+   netplay->ggpo_compress_pending_count = 0;
+   netplay->ggpo_compress_job_queue_max = 0;
+   netplay->ggpo_compress_result_queue_max = 0;
+   netplay->ggpo_compress_stats_valid = false;
+   netplay->ggpo_delta_stats_valid = false;
+   netplay->ggpo_dirty_baseline = false;
+   netplay->ggpo_state_log_time = 0;
+   netplay->ggpo_checksum_interval =
+      settings->uints.netplay_ggpo_checksum_interval;
+   netplay->ggpo_desyncs = 0;
+   netplay->ggpo_replay_accum_us = 0;
+   netplay->ggpo_replay_samples = 0;
+   netplay->ggpo_profile_frames = 0;
+   netplay->ggpo_profile_done = false;
+
+   netplay_ggpo_session_callbacks(&cb);
+
+   game_name = runloop_state_get_ptr()->system.info.library_name;
+   if (string_is_empty(game_name))
+      game_name = "retroarch";
+
+   netplay_ggpo_apply_env_settings(settings);
+
+   if (netplay->ggpo_tunnel)
+      result = ggpo_start_tunnel_session(&netplay->ggpo, &cb, game_name,
+            (int)netplay->ggpo_player_count,
+            (int)netplay->ggpo_input_size);
+   else
+      result = ggpo_start_session(&netplay->ggpo, &cb, game_name,
+            (int)netplay->ggpo_player_count,
+            (int)netplay->ggpo_input_size, local_port);
+   if (!GGPO_SUCCEEDED(result))
+      return false;
+
+   /* Every save buffer is state_size bytes, which lets GGPO offer them
+    * back to netplay_ggpo_save_game_state for reuse. */
+   ggpo_set_state_buffer_capacity(netplay->ggpo, (int)netplay->state_size);
+   netplay_ggpo_set_state_regions(netplay);
+   ggpo_set_disconnect_timeout(netplay->ggpo,
+         (int)settings->uints.netplay_ggpo_disconnect_timeout);
+   ggpo_set_disconnect_notify_start(netplay->ggpo,
+         (int)settings->uints.netplay_ggpo_disconnect_notify_start);
+   /* The setting is the largest slowdown in percent; 0 keeps stalls. */
+   ggpo_set_timesync_mode(netplay->ggpo,
+         settings->uints.netplay_ggpo_drift_correction
+         ? GGPO_TIMESYNC_SLEW : GGPO_TIMESYNC_STALL,
+         (int)settings->uints.netplay_ggpo_drift_correction * 10);
+   netplay->ggpo_slew_debt = 0;
+
+   player.size = sizeof(player);
+   player.type = GGPO_PLAYERTYPE_LOCAL;
+   player.player_num = (int)netplay->ggpo_local_player_index + 1;
+   result = ggpo_add_player(netplay->ggpo, &player,
+         &netplay->ggpo_local_handle);
+   if (!GGPO_SUCCEEDED(result))
+      return false;
+
+   netplay_ggpo_delay_init(netplay, settings);
+
+   memset(&player, 0, sizeof(player));
+   player.size = sizeof(player);
+   player.type = GGPO_PLAYERTYPE_REMOTE;
+   player.player_num = (int)netplay->ggpo_remote_player_index + 1;
+   strlcpy(player.u.remote.ip_address, peer_ip,
+         sizeof(player.u.remote.ip_address));
+   player.u.remote.port = remote_port;
+
+   result = ggpo_add_player(netplay->ggpo, &player,
+         &netplay->ggpo_remote_handle);
+   if (!GGPO_SUCCEEDED(result))
+      return false;
+
+   /* Spectators are fed by the relay, so they cost this player one
+    * send per confirmed frame however many there are. */
+   if (!string_is_empty(networking_driver_st.ggpo_broadcast_session))
+   {
+      char relay_ip[64];
+      uint16_t relay_port = 0;
+
+      if (     netplay_ggpo_broadcast_relay(relay_ip, sizeof(relay_ip),
+                  &relay_port)
+            && GGPO_SUCCEEDED(ggpo_start_relay_broadcast(netplay->ggpo,
+                  relay_ip, relay_port,
+                  networking_driver_st.ggpo_broadcast_session)))
+         RARCH_LOG("[GGPO] Broadcasting as \"%s\" through %s:%hu.\n",
+               networking_driver_st.ggpo_broadcast_session,
+               relay_ip, (unsigned short)relay_port);
+      else
+         RARCH_WARN("[GGPO] Could not start the relay broadcast.\n");
+   }
+
+   netplay->ggpo_running = false;
+   netplay->self_mode = NETPLAY_CONNECTION_CONNECTED;
+
+   return true;
+}
+
+/**
+ * netplay_ggpo_init_synctest
+ * @netplay              : pointer to netplay object
+ *
+ * Starts GGPO's sync test in place of a session, for --netplay-synctest.
+ * Both players are local, on ports 1 and 2 as for a host, and every frame
+ * is hashed so GGPO can compare each replay with the first run.
+ *
+ * Returns: true on success, false otherwise.
+ **/
+static bool netplay_ggpo_init_synctest(netplay_t *netplay)
+{
+   GGPOErrorCode result;
+   GGPOSessionCallbacks cb = {0};
+   GGPOPlayer player = {0};
+   settings_t *settings = config_get_ptr();
+   unsigned frames = networking_driver_st.ggpo_synctest_frames;
+   const char *game_name = NULL;
+
+   if (!netplay->state_size)
+   {
+      if (!netplay_wait_and_init_serialization(netplay))
+         return false;
+   }
+
+   if (!netplay_ggpo_init_input_layout(netplay, 0, 1))
+   {
+      RARCH_ERR("[Netplay] GGPO input layout is invalid.\n");
+      return false;
+   }
+
+   netplay->ggpo_player_count = 2;
+   netplay->ggpo_local_player_index = 0;
+   netplay->ggpo_remote_player_index = 1;
+   netplay->ggpo_local_devices = 1U << 0;
+   netplay->ggpo_remote_devices = 1U << 1;
+   netplay->self_devices = netplay->ggpo_local_devices
+      | netplay->ggpo_remote_devices;
+
+   netplay->ggpo_local_input = (uint32_t*)calloc(1, netplay->ggpo_input_size);
+   netplay->ggpo_sync_inputs = (uint32_t*)calloc(
+         netplay->ggpo_player_count, netplay->ggpo_input_size);
+   netplay->ggpo_synctest = (struct netplay_ggpo_synctest*)calloc(1,
+         sizeof(*netplay->ggpo_synctest));
+   if (     !netplay->ggpo_local_input
+         || !netplay->ggpo_sync_inputs
+         || !netplay->ggpo_synctest)
+      return false;
+
+   netplay->ggpo_synctest->first_desync = -1;
+   netplay->ggpo_synctest->last_match = -1;
+   netplay->ggpo_checksum_interval = 1;
+
+   netplay_ggpo_session_callbacks(&cb);
+
+   game_name = runloop_state_get_ptr()->system.info.library_name;
+   if (string_is_empty(game_name))
+      game_name = "retroarch";
+
+   netplay_ggpo_apply_env_settings(settings);
+   netplay_ggpo_set_env_int("ggpo.synctest.soak", 1);
+
+   result = ggpo_start_synctest(&netplay->ggpo, &cb, (char*)game_name,
+         (int)netplay->ggpo_player_count,
+         (int)netplay->ggpo_input_size, (int)frames);
+   if (!GGPO_SUCCEEDED(result))
+      return false;
+
+   ggpo_set_state_buffer_capacity(netplay->ggpo, (int)netplay->state_size);
+   netplay_ggpo_set_state_regions(netplay);
+
+   player.size = sizeof(player);
+   player.type = GGPO_PLAYERTYPE_LOCAL;
+   player.player_num = 1;
+   result = ggpo_add_player(netplay->ggpo, &player,
+         &netplay->ggpo_local_handle);
+   if (!GGPO_SUCCEEDED(result))
+      return false;
+
+   player.player_num = 2;
+   result = ggpo_add_player(netplay->ggpo, &player,
+         &netplay->ggpo_remote_handle);
+   if (!GGPO_SUCCEEDED(result))
+      return false;
+
+   netplay->ggpo_running = false;
+   netplay->self_mode = NETPLAY_CONNECTION_CONNECTED;
+   netplay->ggpo_synctest->start = cpu_features_get_time_usec();
+
+   RARCH_LOG("[GGPO] Sync test started, replaying every %u frame(s).\n",
+         frames);
 
-   if (netplay->is_server)
-      local_port = port;
-   else
-      local_port = (uint16_t)(port + 1);
+   return true;
+}
 
-   if (netplay->ggpo_peer_port)
-      remote_port = netplay->ggpo_peer_port;
-   else if (netplay->is_server)
-      remote_port = (uint16_t)(port + 1);
-   else
-      remote_port = port;
+/**
+ * netplay_ggpo_init_spectator
+ * @netplay              : pointer to netplay object
+ *
+ * Joins the relay broadcast named by --netplay-spectate in place of a
+ * session. The relay keeps the whole match and its latest keyframe; the
+ * node loads that and plays on from there, unthrottled, so one that
+ * joins late catches up. No
+ * device is local; ports 1 and 2 play the broadcast's two players.
+ *
+ * Returns: true on success, false otherwise.
+ **/
+static bool netplay_ggpo_init_spectator(netplay_t *netplay)
+{
+   GGPOErrorCode result;
+   GGPOSessionCallbacks cb = {0};
+   settings_t *settings = config_get_ptr();
+   const char *session  = networking_driver_st.ggpo_spectate_session;
+   const char *game_name = NULL;
+   char relay_ip[64];
+   uint16_t relay_port = 0;
 
    if (!network_init())
    {
@@ -8694,25 +11114,9 @@ static bool netplay_ggpo_init_session(netplay_t *netplay,
       return false;
    }
 
-   snprintf(port_buf, sizeof(port_buf), "%hu", (unsigned short)port);
-   hints.ai_family = AF_INET;
-   hints.ai_socktype = SOCK_DGRAM;
-   hints.ai_flags |= AI_NUMERICSERV;
-
-   if (getaddrinfo_retro(peer_address, port_buf, &hints, &addr) || !addr)
-   {
-      RARCH_ERR("[Netplay] GGPO failed to resolve host: %s\n", peer_address);
+   if (!netplay_ggpo_broadcast_relay(relay_ip, sizeof(relay_ip),
+         &relay_port))
       return false;
-   }
-
-   if (!getnameinfo_retro(addr->ai_addr, addr->ai_addrlen,
-         resolved_ip, sizeof(resolved_ip), NULL, 0, NI_NUMERICHOST))
-      peer_ip = resolved_ip;
-   else
-      peer_ip = peer_address;
-
-   freeaddrinfo_retro(addr);
-   addr = NULL;
 
    if (!netplay->state_size)
    {
@@ -8720,60 +11124,25 @@ static bool netplay_ggpo_init_session(netplay_t *netplay,
          return false;
    }
 
-   netplay->ggpo_local_devices  = 1U << local_device_port;
-   netplay->ggpo_remote_devices = 1U << remote_device_port;
-   netplay->self_devices        = netplay->ggpo_local_devices;
-
-   if (!netplay_ggpo_init_input_layout(
-         netplay, local_device_port, remote_device_port))
+   if (!netplay_ggpo_init_input_layout(netplay, 0, 1))
    {
       RARCH_ERR("[Netplay] GGPO input layout is invalid.\n");
       return false;
    }
 
    netplay->ggpo_player_count = 2;
-   netplay->ggpo_local_player_index = netplay->is_server ? 0 : 1;
-   netplay->ggpo_remote_player_index = netplay->is_server ? 1 : 0;
-   netplay->ggpo_local_devices = 1U << local_device_port;
-   netplay->ggpo_remote_devices = 1U << remote_device_port;
-   netplay->self_devices = netplay->ggpo_local_devices;
+   netplay->ggpo_local_player_index = 0;
+   netplay->ggpo_remote_player_index = 1;
+   netplay->ggpo_local_devices = 1U << 0;
+   netplay->ggpo_remote_devices = 1U << 1;
+   netplay->self_devices = 0;
 
-   netplay->ggpo_local_input = (uint32_t*)calloc(1, netplay->ggpo_input_size);
    netplay->ggpo_sync_inputs = (uint32_t*)calloc(
          netplay->ggpo_player_count, netplay->ggpo_input_size);
-   if (!netplay->ggpo_local_input || !netplay->ggpo_sync_inputs)
+   if (!netplay->ggpo_sync_inputs)
       return false;
 
-   netplay->ggpo_state_save_accum_us = 0;
-   netplay->ggpo_state_load_accum_us = 0;
-   netplay->ggpo_state_save_samples = 0;
-   netplay->ggpo_state_load_samples = 0;
-   netplay->ggpo_state_size = 0;
-   netplay->ggpo_state_save_us = 0;
-   netplay->ggpo_state_load_us = 0;
-   netplay->ggpo_state_save_max_us = 0;
-   netplay->ggpo_state_load_max_us = 0;
-   netplay->ggpo_delta_ratio_last = 0;
-   netplay->ggpo_delta_ratio_avg = 0;
-   netplay->ggpo_delta_ratio_max = 0;
-   netplay->ggpo_delta_frames = 0;
-   netplay->ggpo_delta_keyframes = 0;
-   netplay->ggpo_compress_job_queue_len = 0;
-   netplay->ggpo_compress_result_queue_len = 0;
-   netplay->ggpo_compress_pending_count = 0;
-   netplay->ggpo_compress_job_queue_max = 0;
-   netplay->ggpo_compress_result_queue_max = 0;
-   netplay->ggpo_compress_stats_valid = false;
-   netplay->ggpo_delta_stats_valid = false;
-   netplay->ggpo_state_log_time = 0;
-
-   cb.begin_game = netplay_ggpo_begin_game;
-   cb.save_game_state = netplay_ggpo_save_game_state;
-   cb.load_game_state = netplay_ggpo_load_game_state;
-   cb.log_game_state = netplay_ggpo_log_game_state;
-   cb.free_buffer = netplay_ggpo_free_buffer;
-   cb.advance_frame = netplay_ggpo_advance_frame;
-   cb.on_event = netplay_ggpo_on_event;
+   netplay_ggpo_session_callbacks(&cb);
 
    game_name = runloop_state_get_ptr()->system.info.library_name;
    if (string_is_empty(game_name))
@@ -8781,46 +11150,111 @@ static bool netplay_ggpo_init_session(netplay_t *netplay,
 
    netplay_ggpo_apply_env_settings(settings);
 
-   result = ggpo_start_session(&netplay->ggpo, &cb, game_name,
+   /* A replay has to cover the whole match; anything else starts from
+    * the relay's keyframe and skips what came before it. */
+#ifdef HAVE_BSV_MOVIE
+   {
+      input_driver_state_t *input_st = input_state_get_ptr();
+      netplay_ggpo_set_env_int("ggpo.broadcast.from_start",
+            BSV_MOVIE_IS_RECORDING() ? 1 : 0);
+   }
+#endif
+
+   /* Any free port; the relay answers whichever one joins. */
+   result = ggpo_start_relay_spectating(&netplay->ggpo, &cb, game_name,
          (int)netplay->ggpo_player_count,
-         (int)netplay->ggpo_input_size, local_port);
+         (int)netplay->ggpo_input_size, 0,
+         relay_ip, relay_port, session);
    if (!GGPO_SUCCEEDED(result))
       return false;
 
-   ggpo_set_disconnect_timeout(netplay->ggpo,
-         (int)settings->uints.netplay_ggpo_disconnect_timeout);
-   ggpo_set_disconnect_notify_start(netplay->ggpo,
-         (int)settings->uints.netplay_ggpo_disconnect_notify_start);
+   ggpo_set_state_buffer_capacity(netplay->ggpo, (int)netplay->state_size);
 
-   player.size = sizeof(player);
-   player.type = GGPO_PLAYERTYPE_LOCAL;
-   player.player_num = (int)netplay->ggpo_local_player_index + 1;
-   result = ggpo_add_player(netplay->ggpo, &player,
-         &netplay->ggpo_local_handle);
-   if (!GGPO_SUCCEEDED(result))
-      return false;
+   netplay->ggpo_running = false;
+   netplay->ggpo_spectator = true;
+   netplay->ggpo_spectator_frames = 0;
+   netplay->ggpo_spectator_start = cpu_features_get_time_usec();
+   netplay->self_mode = NETPLAY_CONNECTION_CONNECTED;
+   netplay_ggpo_spectator_fastforward(true);
 
-   if (settings->uints.netplay_input_latency_frames_min > 0)
-      ggpo_set_frame_delay(netplay->ggpo, netplay->ggpo_local_handle,
-            (int)settings->uints.netplay_input_latency_frames_min);
+   RARCH_LOG("[GGPO] Spectating \"%s\" through %s:%hu.\n",
+         session, relay_ip, (unsigned short)relay_port);
 
-   memset(&player, 0, sizeof(player));
-   player.size = sizeof(player);
-   player.type = GGPO_PLAYERTYPE_REMOTE;
-   player.player_num = (int)netplay->ggpo_remote_player_index + 1;
-   strlcpy(player.u.remote.ip_address, peer_ip,
-         sizeof(player.u.remote.ip_address));
-   player.u.remote.port = remote_port;
+   return true;
+}
 
-   result = ggpo_add_player(netplay->ggpo, &player,
-         &netplay->ggpo_remote_handle);
-   if (!GGPO_SUCCEEDED(result))
-      return false;
+static int netplay_ggpo_synctest_compare(const void *a, const void *b)
+{
+   uint32_t x = *(const uint32_t*)a;
+   uint32_t y = *(const uint32_t*)b;
 
-   netplay->ggpo_running = false;
-   netplay->self_mode = NETPLAY_CONNECTION_CONNECTED;
+   return (x > y) - (x < y);
+}
 
-   return true;
+/* p50, p95 and p99 of a sample ring, which is sorted in place. */
+static void netplay_ggpo_synctest_percentiles(uint32_t *samples,
+      uint64_t count, uint32_t *pct)
+{
+   size_t n = (count < NETPLAY_GGPO_SYNCTEST_SAMPLES)
+      ? (size_t)count : NETPLAY_GGPO_SYNCTEST_SAMPLES;
+
+   if (!n)
+   {
+      pct[0] = pct[1] = pct[2] = 0;
+      return;
+   }
+
+   qsort(samples, n, sizeof(*samples), netplay_ggpo_synctest_compare);
+   pct[0] = samples[(n - 1) * 50 / 100];
+   pct[1] = samples[(n - 1) * 95 / 100];
+   pct[2] = samples[(n - 1) * 99 / 100];
+}
+
+/**
+ * netplay_ggpo_synctest_report
+ * @netplay              : pointer to netplay object
+ *
+ * Logs the outcome of a --netplay-synctest run: the first divergent frame,
+ * if any, the save and load cost distribution (percentiles over the newest
+ * NETPLAY_GGPO_SYNCTEST_SAMPLES calls, maxima over the run) and throughput,
+ * counting replayed frames as well as live ones.
+ **/
+static void netplay_ggpo_synctest_report(netplay_t *netplay)
+{
+   struct netplay_ggpo_synctest *synctest = netplay->ggpo_synctest;
+   retro_time_t elapsed_us =
+      cpu_features_get_time_usec() - synctest->start;
+   uint64_t run = synctest->frames + netplay->ggpo_rollback_frames;
+   uint32_t save[3];
+   uint32_t load[3];
+
+   if (elapsed_us <= 0)
+      elapsed_us = 1;
+
+   netplay_ggpo_synctest_percentiles(synctest->save_us,
+         synctest->save_count, save);
+   netplay_ggpo_synctest_percentiles(synctest->load_us,
+         synctest->load_count, load);
+
+   RARCH_LOG("[GGPO] Sync test ran %llu frames (%u replayed) in %u ms: "
+         "%u frames/s live, %u run.\n",
+         (unsigned long long)synctest->frames,
+         netplay->ggpo_rollback_frames,
+         (unsigned)(elapsed_us / 1000),
+         (unsigned)(synctest->frames * 1000000 / elapsed_us),
+         (unsigned)(run * 1000000 / elapsed_us));
+   RARCH_LOG("[GGPO] Sync test state %u bytes, save p50/p95/p99/max "
+         "%u/%u/%u/%u us, load p50/p95/p99/max %u/%u/%u/%u us.\n",
+         netplay->ggpo_state_size,
+         save[0], save[1], save[2], netplay->ggpo_state_save_max_us,
+         load[0], load[1], load[2], netplay->ggpo_state_load_max_us);
+
+   if (synctest->first_desync >= 0)
+      RARCH_ERR("[GGPO] Sync test failed: frame %d diverged on replay "
+            "(last match at frame %d).\n",
+            synctest->first_desync, synctest->last_match);
+   else
+      RARCH_LOG("[GGPO] Sync test passed: every replay matched.\n");
 }
 #endif
 
@@ -8838,17 +11272,52 @@ static void netplay_free(netplay_t *netplay)
    netplay_ggpo_rendezvous_close(netplay);
    netplay_ggpo_relay_close(netplay);
 
+   /* An in-flight lookup frees itself once nobody claims it. */
+   netplay->ggpo_resolve = NULL;
+   netplay_ggpo_resolved_done(netplay);
+
    if (netplay->ggpo)
    {
+      if (netplay->ggpo_synctest)
+         netplay_ggpo_synctest_report(netplay);
+      if (netplay->ggpo_tunnel_dropped)
+         RARCH_LOG("[GGPO] Dropped %u tunnelled datagrams behind a backed up control channel.\n",
+               (unsigned)netplay->ggpo_tunnel_dropped);
       ggpo_close_session(netplay->ggpo);
       netplay->ggpo = NULL;
    }
 
+   if (netplay->ggpo_spectator)
+   {
+      retro_time_t elapsed_us = cpu_features_get_time_usec()
+         - netplay->ggpo_spectator_start;
+
+      RARCH_LOG("[GGPO] Spectated %llu frames in %u ms.\n",
+            (unsigned long long)netplay->ggpo_spectator_frames,
+            (unsigned)(elapsed_us / 1000));
+      netplay_ggpo_spectator_fastforward(false);
+      netplay->ggpo_spectator = false;
+   }
+
+   free(netplay->ggpo_synctest);
+   netplay->ggpo_synctest = NULL;
+
    free(netplay->ggpo_local_input);
    netplay->ggpo_local_input = NULL;
 
    free(netplay->ggpo_sync_inputs);
    netplay->ggpo_sync_inputs = NULL;
+
+   free(netplay->ggpo_delay.last_input);
+   netplay->ggpo_delay.last_input = NULL;
+
+   free(netplay->ggpo_dirty_map);
+   netplay->ggpo_dirty_map = NULL;
+   free(netplay->ggpo_dirty_ranges);
+   netplay->ggpo_dirty_ranges = NULL;
+   netplay->ggpo_dirty_blocks = 0;
+
+   netplay_ggpo_splice_free(netplay);
 #endif
 
    if (netplay->listen_fd >= 0)
@@ -8894,7 +11363,7 @@ static void netplay_free(netplay_t *netplay)
    }
 
    free(netplay->zbuffer);
-   free(netplay->delta_buffer);
+   memalign_free_large(netplay->delta_buffer);
 
    if (netplay->compress_nil.compression_stream)
       netplay->compress_nil.compression_backend->stream_free(
@@ -9081,15 +11550,7 @@ static netplay_t *netplay_new(const char *server, const char *mitm,
       }
      if (!netplay_init_buffers(netplay))
         goto failure;
-      if (netplay_ggpo_relay_enabled())
-      {
-         if (!netplay_ggpo_relay_start(netplay, port))
-            goto failure;
-         return netplay;
-      }
-      if (netplay_ggpo_rendezvous_enabled())
-         return netplay;
-      if (!netplay_ggpo_init_session(netplay, server, port))
+      if (!netplay_ggpo_bringup_start(netplay, server))
          goto failure;
       return netplay;
    }
@@ -9128,6 +11589,7 @@ static void netplay_send_savestate(netplay_t *netplay,
    size_t state_size    = serial_info->size;
    uint32_t flags       = 0;
    uint32_t base_crc    = 0;
+   size_t input_size    = state_size;
    bool use_delta       = false;
    NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
 
@@ -9154,13 +11616,26 @@ static void netplay_send_savestate(netplay_t *netplay,
             && connection->state_base_send
             && connection->state_base_size == state_size
             && netplay->delta_buffer
-            && netplay->delta_buffer_size >= state_size)
+            && netplay->delta_buffer_size >= state_size
+               + NETPLAY_STATE_BLOCKS_MAP_SIZE(state_size))
          use_delta = true;
 
       if (use_delta)
       {
-         netplay_xor_delta(netplay->delta_buffer, input,
-            connection->state_base_send, state_size);
+         /* Only the changed blocks when the peer can rebuild the
+          * rest from its base; it tells us when it has none. */
+         if (connection->netplay_protocol >= 9)
+            input_size = netplay_pack_block_delta(netplay->delta_buffer,
+               input, connection->state_base_send, state_size);
+
+         if (input_size < state_size)
+            flags |= NETPLAY_STATE_FLAG_BLOCKS;
+         else
+         {
+            netplay_xor_delta(netplay->delta_buffer, input,
+               connection->state_base_send, state_size);
+            input_size = state_size;
+         }
          flags    |= NETPLAY_STATE_FLAG_DELTA;
          base_crc  = encoding_crc32(0L, connection->state_base_send,
             state_size);
@@ -9170,7 +11645,7 @@ static void netplay_send_savestate(netplay_t *netplay,
 
    /* Compress it */
    ctrans->compression_backend->set_in(ctrans->compression_stream,
-      input, (uint32_t)state_size);
+      input, (uint32_t)input_size);
    ctrans->compression_backend->set_out(ctrans->compression_stream,
       netplay->zbuffer, (uint32_t)netplay->zbuffer_size);
    if (!ctrans->compression_backend->trans(ctrans->compression_stream, true,
@@ -9193,10 +11668,8 @@ static void netplay_send_savestate(netplay_t *netplay,
       header[5] = htonl(base_crc);
    }
 
-   if (  !netplay_send(&connection->send_packet_buffer,
-            connection->fd, header, header_words * sizeof(uint32_t))
-      || !netplay_send(&connection->send_packet_buffer,
-            connection->fd, netplay->zbuffer, wn))
+   if (!netplay_send_pair(&connection->send_packet_buffer, connection->fd,
+         header, header_words * sizeof(uint32_t), netplay->zbuffer, wn))
    {
       netplay_hangup(netplay, connection);
       return;
@@ -9446,17 +11919,25 @@ static bool netplay_build_savestate(netplay_t* netplay, retro_ctx_serialize_info
    output[7] = NETPLAYSTATE_VERSION;
    output += 8;
 
+   /* Padding is written as a block of its own, which readers skip */
+   if (netplay->coremem_offset > 16)
+      netplay_write_pad_block(output, netplay->coremem_offset - 16);
+   output = buffer + netplay->coremem_offset - 8;
+
    /* important - write the unaligned size - some cores fail if they aren't passed the exact right size. */
    netplay_write_block_header(output, NETPLAYSTATE_MEM_BLOCK, netplay->coremem_size);
    output += 8;
 
-   /* capture the core state */
+   /* capture the core state straight into the buffer */
    serial_info->data = output;
    serial_info->size = netplay->coremem_size;
    if (!core_serialize_special(serial_info))
       return false;
 
    output += CONTENT_ALIGN_SIZE(netplay->coremem_size);
+   if (buffer + netplay->coremem_end > output)
+      netplay_write_pad_block(output, buffer + netplay->coremem_end - output);
+   output = buffer + netplay->coremem_end;
 
 #ifdef HAVE_CHEEVOS
    if (netplay->is_server || (force_capture_achievements && netplay->cheevos_size > 8))
@@ -10100,73 +12581,292 @@ static bool netplay_is_alive(netplay_t *netplay)
  **/
 static bool netplay_should_skip(netplay_t *netplay)
 {
-   if (!netplay)
-      return false;
+   if (!netplay)
+      return false;
+
+   return netplay->is_replay &&
+      netplay->self_mode >= NETPLAY_CONNECTION_CONNECTED;
+}
+
+static size_t retrieve_client_count(netplay_t *netplay,
+      unsigned *players, unsigned *spectators)
+{
+   size_t i, r = 0;
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+
+      /* We only want info from already connected clients. */
+      if (     (connection->flags & NETPLAY_CONN_FLAG_ACTIVE)
+            && (connection->mode >= NETPLAY_CONNECTION_CONNECTED))
+      {
+         r++;
+         if (connection->mode == NETPLAY_CONNECTION_SPECTATING)
+            (*spectators)++;
+         else if (connection->mode == NETPLAY_CONNECTION_PLAYING
+               || connection->mode == NETPLAY_CONNECTION_SLAVE)
+            (*players)++;
+      }
+   }
+
+   return r;
+}
+
+bool init_netplay_deferred(const char *server, unsigned port, const char *mitm_session)
+{
+   net_driver_state_t *net_st = &networking_driver_st;
+
+   if (string_is_empty(server) || !port)
+   {
+      net_st->flags &= ~NET_DRIVER_ST_FLAG_NETPLAY_CLIENT_DEFERRED;
+      return false;
+   }
+
+   strlcpy(net_st->server_address_deferred, server,
+      sizeof(net_st->server_address_deferred));
+   net_st->server_port_deferred    = port;
+   strlcpy(net_st->server_session_deferred, mitm_session,
+      sizeof(net_st->server_session_deferred));
+   net_st->flags |= NET_DRIVER_ST_FLAG_NETPLAY_CLIENT_DEFERRED;
+
+   return true;
+}
+
+/**
+ * input_poll_net
+ * @netplay              : pointer to netplay object
+ *
+ * Poll the network if necessary.
+ */
+void input_poll_net(netplay_t *netplay)
+{
+   if (!netplay_should_skip(netplay))
+   {
+      input_driver_state_t *input_st = input_state_get_ptr();
+
+      netplay_poll(netplay, input_st->flags & INP_FLAG_BLOCK_LIBRETRO_INPUT);
+   }
+}
+
+#ifdef HAVE_GGPO
+/* Exponential moving average (1/8) of a live callback's cost. */
+static void netplay_ggpo_note_live_cost(uint32_t *avg_us, retro_time_t start)
+{
+   uint32_t elapsed = (uint32_t)(cpu_features_get_time_usec() - start);
+   *avg_us = *avg_us ? (*avg_us * 7 + elapsed) / 8 : elapsed;
+}
+
+/* Ramp a live sample in from the last one actually played, so the jump
+ * between the mispredicted audio and the corrected timeline is not heard
+ * as a click. */
+static void netplay_ggpo_crossfade(netplay_t *netplay,
+      int16_t *left, int16_t *right)
+{
+   uint32_t pos = GGPO_REPLAY_CROSSFADE_FRAMES -
+      netplay->ggpo_audio_crossfade_pos;
+
+   *left  = (int16_t)(netplay->ggpo_audio_last[0] +
+         ((int32_t)(*left  - netplay->ggpo_audio_last[0]) * (int32_t)pos) /
+         GGPO_REPLAY_CROSSFADE_FRAMES);
+   *right = (int16_t)(netplay->ggpo_audio_last[1] +
+         ((int32_t)(*right - netplay->ggpo_audio_last[1]) * (int32_t)pos) /
+         GGPO_REPLAY_CROSSFADE_FRAMES);
+   netplay->ggpo_audio_crossfade_pos--;
+}
+
+static size_t netplay_ggpo_audio_batch(netplay_t *netplay,
+      const int16_t *data, size_t frames)
+{
+   int16_t faded[GGPO_REPLAY_CROSSFADE_FRAMES * 2];
+   size_t head   = 0;
+   size_t result = 0;
+   retro_time_t start = cpu_features_get_time_usec();
+
+   if (netplay->ggpo_audio_crossfade_pos && frames)
+   {
+      size_t i;
+      head = MIN(frames, (size_t)netplay->ggpo_audio_crossfade_pos);
+      for (i = 0; i < head; i++)
+      {
+         faded[i * 2]     = data[i * 2];
+         faded[i * 2 + 1] = data[i * 2 + 1];
+         netplay_ggpo_crossfade(netplay, &faded[i * 2], &faded[i * 2 + 1]);
+      }
+      result = netplay->cbs.sample_batch_cb(faded, head);
+   }
+   if (frames > head)
+      result += netplay->cbs.sample_batch_cb(data + head * 2, frames - head);
+
+   if (frames)
+   {
+      netplay->ggpo_audio_last[0] = data[(frames - 1) * 2];
+      netplay->ggpo_audio_last[1] = data[(frames - 1) * 2 + 1];
+   }
+   netplay_ggpo_note_live_cost(&netplay->ggpo_live_audio_us, start);
+   return result;
+}
+
+static void netplay_ggpo_audio_frame_append(
+      struct netplay_ggpo_audio_frame *frame,
+      const int16_t *data, size_t frames)
+{
+   if (frame->frames + frames > frame->capacity)
+   {
+      size_t capacity = MAX(frame->capacity * 2, frame->frames + frames);
+      int16_t *buf    = (int16_t*)realloc(frame->data,
+            capacity * 2 * sizeof(int16_t));
+      /* Out of memory; the samples are lost */
+      if (!buf)
+         return;
+      frame->data     = buf;
+      frame->capacity = capacity;
+   }
+   memcpy(frame->data + frame->frames * 2, data,
+         frames * 2 * sizeof(int16_t));
+   frame->frames += frames;
+}
+
+/* Moves the first of 'count' frames to the end, keeping its buffer */
+static void netplay_ggpo_audio_frames_rotate(
+      struct netplay_ggpo_audio_frame *frames, unsigned count)
+{
+   struct netplay_ggpo_audio_frame first = frames[0];
+   memmove(frames, frames + 1, (count - 1) * sizeof(*frames));
+   frames[count - 1] = first;
+}
+
+/* Hands the oldest held frames to the driver until 'keep' are left */
+static void netplay_ggpo_splice_release(netplay_t *netplay, unsigned keep)
+{
+   struct netplay_ggpo_audio_splice *splice = &netplay->ggpo_splice;
+
+   while (splice->held_count > keep)
+   {
+      if (splice->held[0].frames)
+         netplay_ggpo_audio_batch(netplay, splice->held[0].data,
+               splice->held[0].frames);
+      netplay_ggpo_audio_frames_rotate(splice->held, splice->held_count);
+      splice->held_count--;
+   }
+}
+
+/* Every rollback resimulates up to the last live frame, so the frames
+ * it ran can be numbered back from there once it is over */
+static void netplay_ggpo_splice_tag(struct netplay_ggpo_audio_splice *splice)
+{
+   unsigned i;
+   unsigned untagged = MIN(splice->replay_untagged, splice->replay_count);
+
+   for (i = 0; i < untagged; i++)
+      splice->replay[splice->replay_count - 1 - i].frame =
+         splice->live_frame - i;
+   splice->replay_untagged = 0;
+}
+
+/* Ramps the start of 'dst' in from 'from' */
+static void netplay_ggpo_splice_crossfade(int16_t *dst,
+      const int16_t *from, size_t frames)
+{
+   size_t i;
+   size_t samples = MIN(frames, GGPO_SPLICE_CROSSFADE_FRAMES) * 2;
 
-   return netplay->is_replay &&
-      netplay->self_mode >= NETPLAY_CONNECTION_CONNECTED;
+   /* Plain integer loop; compilers vectorise it */
+   for (i = 0; i < samples; i++)
+      dst[i] = (int16_t)(from[i] + ((int32_t)(dst[i] - from[i])
+               * (int32_t)(i >> 1)) / GGPO_SPLICE_CROSSFADE_FRAMES);
 }
 
-static size_t retrieve_client_count(netplay_t *netplay,
-      unsigned *players, unsigned *spectators)
+/* Swaps in the resimulated audio for every held frame a rollback ran
+ * again. The seam is crossfaded from the audio that was held, which
+ * carries on from what the driver already has. */
+static void netplay_ggpo_splice_apply(netplay_t *netplay)
 {
-   size_t i, r = 0;
+   unsigned i, j;
+   bool joined                              = false;
+   struct netplay_ggpo_audio_splice *splice = &netplay->ggpo_splice;
 
-   for (i = 0; i < netplay->connections_size; i++)
+   netplay_ggpo_splice_tag(splice);
+
+   for (i = 0; i < splice->held_count; i++)
    {
-      struct netplay_connection *connection = &netplay->connections[i];
+      struct netplay_ggpo_audio_frame *held = &splice->held[i];
 
-      /* We only want info from already connected clients. */
-      if (     (connection->flags & NETPLAY_CONN_FLAG_ACTIVE)
-            && (connection->mode >= NETPLAY_CONNECTION_CONNECTED))
+      for (j = splice->replay_count; j-- > 0; )
       {
-         r++;
-         if (connection->mode == NETPLAY_CONNECTION_SPECTATING)
-            (*spectators)++;
-         else if (connection->mode == NETPLAY_CONNECTION_PLAYING
-               || connection->mode == NETPLAY_CONNECTION_SLAVE)
-            (*players)++;
+         struct netplay_ggpo_audio_frame swap;
+         struct netplay_ggpo_audio_frame *replay = &splice->replay[j];
+
+         if (replay->frame != held->frame)
+            continue;
+
+         if (!joined)
+         {
+            netplay_ggpo_splice_crossfade(replay->data, held->data,
+                  MIN(replay->frames, held->frames));
+            joined = true;
+         }
+
+         swap    = *held;
+         *held   = *replay;
+         *replay = swap;
+         break;
       }
    }
 
-   return r;
+   splice->replay_count = 0;
+   if (joined)
+      splice->splices++;
 }
 
-bool init_netplay_deferred(const char *server, unsigned port, const char *mitm_session)
+/* Opens the held frame that the next live core frame's audio goes to */
+static void netplay_ggpo_splice_begin_frame(netplay_t *netplay,
+      unsigned depth)
 {
-   net_driver_state_t *net_st = &networking_driver_st;
+   struct netplay_ggpo_audio_splice *splice = &netplay->ggpo_splice;
 
-   if (string_is_empty(server) || !port)
-   {
-      net_st->flags &= ~NET_DRIVER_ST_FLAG_NETPLAY_CLIENT_DEFERRED;
-      return false;
-   }
+   if (depth > NETPLAY_GGPO_SPLICE_MAX_FRAMES)
+      depth = NETPLAY_GGPO_SPLICE_MAX_FRAMES;
 
-   strlcpy(net_st->server_address_deferred, server,
-      sizeof(net_st->server_address_deferred));
-   net_st->server_port_deferred    = port;
-   strlcpy(net_st->server_session_deferred, mitm_session,
-      sizeof(net_st->server_session_deferred));
-   net_st->flags |= NET_DRIVER_ST_FLAG_NETPLAY_CLIENT_DEFERRED;
+   netplay_ggpo_splice_release(netplay, depth ? depth - 1 : 0);
+   if (!depth)
+      return;
 
-   return true;
+   splice->held[splice->held_count].frames = 0;
+   splice->held[splice->held_count].frame  = ++splice->live_frame;
+   splice->held_count++;
 }
 
-/**
- * input_poll_net
- * @netplay              : pointer to netplay object
- *
- * Poll the network if necessary.
- */
-void input_poll_net(netplay_t *netplay)
+/* Opens the replay frame a resimulated core frame's audio goes to */
+static void netplay_ggpo_splice_begin_replay(netplay_t *netplay)
 {
-   if (!netplay_should_skip(netplay))
-   {
-      input_driver_state_t *input_st = input_state_get_ptr();
+   struct netplay_ggpo_audio_splice *splice = &netplay->ggpo_splice;
 
-      netplay_poll(netplay, input_st->flags & INP_FLAG_BLOCK_LIBRETRO_INPUT);
+   if (!splice->held_count)
+      return;
+
+   if (splice->replay_count == NETPLAY_GGPO_SPLICE_MAX_FRAMES)
+   {
+      netplay_ggpo_audio_frames_rotate(splice->replay,
+            splice->replay_count);
+      splice->replay_count--;
    }
+   splice->replay[splice->replay_count++].frames = 0;
+   splice->replay_untagged++;
+}
+
+static void netplay_ggpo_splice_free(netplay_t *netplay)
+{
+   unsigned i;
+   struct netplay_ggpo_audio_splice *splice = &netplay->ggpo_splice;
+
+   for (i = 0; i < ARRAY_SIZE(splice->held); i++)
+      free(splice->held[i].data);
+   for (i = 0; i < ARRAY_SIZE(splice->replay); i++)
+      free(splice->replay[i].data);
+   memset(splice, 0, sizeof(*splice));
 }
+#endif
 
 /* Netplay polling callbacks */
 void video_frame_net(const void *data, unsigned width,
@@ -10174,6 +12874,25 @@ void video_frame_net(const void *data, unsigned width,
 {
    net_driver_state_t *net_st  = &networking_driver_st;
    netplay_t          *netplay = net_st->data;
+#ifdef HAVE_GGPO
+   if (netplay && netplay->modus == NETPLAY_MODUS_GGPO)
+   {
+      retro_time_t start;
+
+      /* Replayed frames are never presented; the live frame that follows
+       * the rollback is. */
+      if (netplay_should_skip(netplay))
+      {
+         netplay->ggpo_replay_video_skipped++;
+         netplay->ggpo_replay_saved_us += netplay->ggpo_live_video_us;
+         return;
+      }
+      start = cpu_features_get_time_usec();
+      netplay->cbs.frame_cb(data, width, height, pitch);
+      netplay_ggpo_note_live_cost(&netplay->ggpo_live_video_us, start);
+      return;
+   }
+#endif
    if (!netplay_should_skip(netplay))
       netplay->cbs.frame_cb(data, width, height, pitch);
 }
@@ -10183,7 +12902,27 @@ void audio_sample_net(int16_t left, int16_t right)
    net_driver_state_t *net_st  = &networking_driver_st;
    netplay_t          *netplay = net_st->data;
    if (!netplay_should_skip(netplay) && !netplay->stall)
+   {
+#ifdef HAVE_GGPO
+      if (netplay->modus == NETPLAY_MODUS_GGPO)
+      {
+         if (netplay->ggpo_splice.held_count)
+         {
+            int16_t frame[2];
+            frame[0] = left;
+            frame[1] = right;
+            netplay_ggpo_audio_frame_append(&netplay->ggpo_splice.held[
+                  netplay->ggpo_splice.held_count - 1], frame, 1);
+            return;
+         }
+         if (netplay->ggpo_audio_crossfade_pos)
+            netplay_ggpo_crossfade(netplay, &left, &right);
+         netplay->ggpo_audio_last[0] = left;
+         netplay->ggpo_audio_last[1] = right;
+      }
+#endif
       netplay->cbs.sample_cb(left, right);
+   }
 }
 
 size_t audio_sample_batch_net(const int16_t *data, size_t frames)
@@ -10191,7 +12930,38 @@ size_t audio_sample_batch_net(const int16_t *data, size_t frames)
    net_driver_state_t *net_st  = &networking_driver_st;
    netplay_t          *netplay = net_st->data;
    if (!netplay_should_skip(netplay) && !netplay->stall)
+   {
+#ifdef HAVE_GGPO
+      if (netplay->modus == NETPLAY_MODUS_GGPO)
+      {
+         if (netplay->ggpo_splice.held_count)
+         {
+            netplay_ggpo_audio_frame_append(&netplay->ggpo_splice.held[
+                  netplay->ggpo_splice.held_count - 1], data, frames);
+            return frames;
+         }
+         return netplay_ggpo_audio_batch(netplay, data, frames);
+      }
+#endif
       return netplay->cbs.sample_batch_cb(data, frames);
+   }
+#ifdef HAVE_GGPO
+   /* Replayed audio goes to a discard sink; it was already heard, with
+    * the mispredicted inputs, the first time round. Unless it is for
+    * frames the splice buffer still holds back. */
+   if (netplay && netplay->is_replay && netplay->modus == NETPLAY_MODUS_GGPO)
+   {
+      struct netplay_ggpo_audio_splice *splice = &netplay->ggpo_splice;
+      if (splice->held_count && splice->replay_count)
+      {
+         netplay_ggpo_audio_frame_append(
+               &splice->replay[splice->replay_count - 1], data, frames);
+         return frames;
+      }
+      netplay->ggpo_replay_audio_skipped++;
+      netplay->ggpo_replay_saved_us += netplay->ggpo_live_audio_us;
+   }
+#endif
    return frames;
 }
 
@@ -10293,6 +13063,12 @@ static void netplay_announce_cb(retro_task_t *task, void *task_data,
                   sizeof(host_room->ggpo_relay_session));
             else if (string_is_equal(key, "ggpo_relay_port"))
                host_room->ggpo_relay_port = (int)strtol(value, NULL, 10);
+            else if (string_is_equal(key, "ggpo_relays"))
+               strlcpy(host_room->ggpo_relays, value,
+                  sizeof(host_room->ggpo_relays));
+            else if (string_is_equal(key, "ggpo_token"))
+               strlcpy(net_st->ggpo_token, value,
+                  sizeof(net_st->ggpo_token));
             else if (string_is_equal(key, "has_password"))
                host_room->has_password =
                      string_is_equal_case_insensitive(value, "true")
@@ -10454,15 +13230,17 @@ static void netplay_announce(netplay_t *netplay)
    use_rendezvous = is_ggpo && settings->bools.netplay_use_rendezvous
       && !use_ggpo_relay;
 
-   if (use_rendezvous)
+   /* Relay hosts pass their rendezvous server on for relay selection. */
+   if (use_rendezvous || (use_ggpo_relay &&
+         !string_is_empty(settings->paths.netplay_rendezvous_server)))
    {
       rendezvous_port = (int)settings->uints.netplay_rendezvous_port;
       if (!rendezvous_port)
          rendezvous_port = DEFAULT_NETPLAY_RENDEZVOUS_PORT;
       net_http_urlencode(&rendezvous_server,
             settings->paths.netplay_rendezvous_server);
-      net_http_urlencode(&rendezvous_room,
-            settings->paths.netplay_rendezvous_room);
+      net_http_urlencode(&rendezvous_room, use_rendezvous
+            ? settings->paths.netplay_rendezvous_room : "");
    }
    else
    {
@@ -10672,6 +13450,45 @@ static bool netplay_mitm_query(const char *handle)
    return !string_is_empty(host_room->mitm_address) && host_room->mitm_port;
 }
 
+static void netplay_lobby_join_query_cb(retro_task_t *task, void *task_data,
+      void *user_data, const char *err)
+{
+   const char *token;
+   http_transfer_data_t *data  = (http_transfer_data_t*)task_data;
+   net_driver_state_t   *net_st = &networking_driver_st;
+   size_t _len                  = STRLEN_CONST("ggpo_token=");
+
+   if (err || !data || !data->data || !data->len || data->status != 200)
+   {
+      RARCH_WARN("[Netplay] Failed to get a pairing token from the lobby server.\n");
+      return;
+   }
+
+   /* The reply is the single line "ggpo_token=<token>". */
+   if (     data->len <= _len
+         || strncmp(data->data, "ggpo_token=", _len))
+      return;
+   token = data->data + _len;
+   _len  = data->len - _len;
+   while (_len && (token[_len - 1] == '\n' || token[_len - 1] == '\r'))
+      _len--;
+   if (!_len || _len >= sizeof(net_st->ggpo_token))
+      return;
+
+   memcpy(net_st->ggpo_token, token, _len);
+   net_st->ggpo_token[_len] = '\0';
+}
+
+bool netplay_lobby_join_query(int room_id)
+{
+   char query[256];
+
+   snprintf(query, sizeof(query), FILE_PATH_LOBBY_LIBRETRO_URL "join?id=%d",
+         room_id);
+   return task_push_http_transfer(query, true, NULL,
+         netplay_lobby_join_query_cb, NULL) != NULL;
+}
+
 int16_t input_state_net(unsigned port, unsigned device,
       unsigned idx, unsigned id)
 {
@@ -10683,7 +13500,19 @@ int16_t input_state_net(unsigned port, unsigned device,
       if (netplay->modus == NETPLAY_MODUS_GGPO)
       {
          if (netplay_is_alive(netplay))
-            return netplay_input_state_ggpo(netplay, port, device, idx, id);
+         {
+            int16_t result = netplay_input_state_ggpo(netplay,
+                  port, device, idx, id);
+#ifdef HAVE_BSV_MOVIE
+            /* A spectator never rolls back, so what it plays is the
+             * match as confirmed, and can be replayed from the file. */
+            input_driver_state_t *input_st = input_state_get_ptr();
+            if (netplay->ggpo_spectator && BSV_MOVIE_IS_RECORDING())
+               bsv_movie_push_input_event(input_st->bsv_movie_state_handle,
+                     port, device, idx, id, result);
+#endif
+            return result;
+         }
          return netplay->cbs.state_cb(port, device, idx, id);
       }
 #endif
@@ -10791,95 +13620,455 @@ static void netplay_ggpo_poll_control(netplay_t *netplay)
       {
          net_driver_state_t *net_st = &networking_driver_st;
 
-         if (net_st->lan_ad_server_fd >= 0 || init_lan_ad_server_socket())
-            netplay_lan_ad_server(netplay);
-      }
-#endif
+         if (net_st->lan_ad_server_fd >= 0 || init_lan_ad_server_socket())
+            netplay_lan_ad_server(netplay);
+      }
+#endif
+
+      if (settings->bools.netplay_public_announce &&
+            netplay->next_announce != -1)
+      {
+         if (cpu_features_get_time_usec() >= netplay->next_announce)
+            netplay_announce(netplay);
+      }
+   }
+   else if (netplay->connections_size &&
+         (netplay->connections[0].flags & NETPLAY_CONN_FLAG_ACTIVE))
+   {
+      if (netplay->next_ping != -1)
+      {
+         retro_time_t ctime = cpu_features_get_time_usec();
+
+         if (ctime >= netplay->next_ping)
+         {
+            netplay_request_ping(netplay, &netplay->connections[0]);
+            netplay->next_ping = ctime + NETPLAY_PING_TIME;
+         }
+      }
+   }
+}
+
+/* Queues the host lookups for bring-up; pre_frame carries on from there,
+ * so content keeps loading while they run. */
+static bool netplay_ggpo_bringup_start(netplay_t *netplay, const char *server)
+{
+   settings_t *settings = config_get_ptr();
+   struct netplay_ggpo_resolve *resolve;
+   const char *host     = server;
+   unsigned slot        = NETPLAY_GGPO_RESOLVE_PEER;
+   uint16_t port        = netplay->ggpo_base_port;
+
+   /* A sync test or spectator has nobody to look up; bringup_poll
+    * starts it. */
+   if (netplay_ggpo_standalone())
+      return true;
+
+   if (!network_init())
+   {
+      RARCH_ERR("[Netplay] GGPO failed to initialize networking.\n");
+      return false;
+   }
+
+   if (netplay_ggpo_relay_enabled())
+   {
+      slot = NETPLAY_GGPO_RESOLVE_RELAY;
+      host = settings->paths.netplay_ggpo_relay_server;
+      port = (uint16_t)settings->uints.netplay_ggpo_relay_port;
+      if (!port)
+         port = DEFAULT_NETPLAY_GGPO_RELAY_PORT;
+   }
+   else if (netplay_ggpo_rendezvous_enabled())
+   {
+      slot = NETPLAY_GGPO_RESOLVE_RENDEZVOUS;
+      host = settings->paths.netplay_rendezvous_server;
+      port = (uint16_t)settings->uints.netplay_rendezvous_port;
+      if (!port)
+         port = DEFAULT_NETPLAY_RENDEZVOUS_PORT;
+   }
+   else if (string_is_empty(host))
+      host = settings->paths.netplay_server;
+
+   resolve = (struct netplay_ggpo_resolve*)calloc(1, sizeof(*resolve));
+   if (!resolve)
+      return false;
+
+   /* An empty host is left for the start functions to report. */
+   if (!string_is_empty(host))
+   {
+      strlcpy(resolve->host[slot], host, sizeof(resolve->host[slot]));
+      resolve->port[slot] = port;
+   }
+
+   /* A host's token arrives with its first announcement. */
+   if (netplay->is_server)
+      networking_driver_st.ggpo_token[0] = '\0';
+
+   netplay->ggpo_bringup       = NETPLAY_GGPO_BRINGUP_RESOLVE;
+   netplay->ggpo_bringup_start = cpu_features_get_time_usec();
+
+   return netplay_ggpo_resolve_push(netplay, resolve);
+}
+
+static bool netplay_ggpo_bringup_session(netplay_t *netplay, const char *after)
+{
+   retro_time_t now = cpu_features_get_time_usec();
+
+   netplay->ggpo_bringup_exchange_us =
+      (uint32_t)(now - netplay->ggpo_bringup_start)
+      - netplay->ggpo_bringup_resolve_us;
+
+   if (!netplay_ggpo_init_session(netplay,
+         netplay->ggpo_peer_address, netplay->ggpo_base_port))
+   {
+      RARCH_ERR("[Netplay] GGPO failed to start after %s.\n", after);
+      netplay_disconnect(netplay);
+      return false;
+   }
+
+   netplay->ggpo_bringup_token         = netplay->ggpo_token_sends
+      && netplay->ggpo_token_answered && !netplay->ggpo_token_dropped;
+   netplay->ggpo_bringup_session_start = cpu_features_get_time_usec();
+   netplay->ggpo_bringup_session_us    =
+      (uint32_t)(netplay->ggpo_bringup_session_start - now);
+   /* Quirky cores only serialize after running frames, which
+    * init_session does itself. */
+   if (!netplay->ggpo_bringup_state_us)
+      netplay->ggpo_bringup_state_us = (uint32_t)
+         (netplay->ggpo_bringup_session_start - netplay->ggpo_bringup_start);
+   netplay->ggpo_bringup = NETPLAY_GGPO_BRINGUP_SYNC;
+   return true;
+}
+
+/* A peer whose network drops the session's UDP can usually still reach
+ * the other over the control channel, which goes through the tunnel
+ * server when there is one. The client asks once UDP has not
+ * synchronized for NETPLAY_GGPO_TUNNEL_PROBE_USEC; a host that is not
+ * running yet restarts its session on the tunnel transport and echoes
+ * the request, and the client restarts its own on the echo. A host
+ * without this command skips it, and the session stays on UDP. */
+static void netplay_ggpo_tunnel_recv(netplay_t *netplay,
+      struct netplay_connection *connection, const void *data, size_t len)
+{
+   if (len)
+   {
+      if (     netplay->ggpo
+            && netplay->ggpo_tunnel
+            && connection == &netplay->connections[
+               netplay->ggpo_tunnel_connection])
+         ggpo_tunnel_write(netplay->ggpo, data, (int)len);
+      return;
+   }
+
+   if (netplay->ggpo_tunnel)
+   {
+      /* The client asked again before our echo arrived. */
+      if (netplay->is_server)
+         netplay_send_raw_cmd(netplay, connection,
+               NETPLAY_CMD_GGPO_TUNNEL, NULL, 0);
+      return;
+   }
+
+   /* A host still bringing its session up is asked again later. */
+   if (netplay->is_server && netplay->ggpo_running)
+      RARCH_WARN("[GGPO] Not tunnelling a session that already runs over UDP.\n");
+   else if (netplay->is_server
+         ? netplay->ggpo != NULL
+         : netplay->ggpo_tunnel_asked != 0)
+   {
+      netplay->ggpo_tunnel_pending    = true;
+      netplay->ggpo_tunnel_connection =
+         (size_t)(connection - netplay->connections);
+   }
+}
+
+/* Switches to the tunnel once agreed, or asks for it once UDP has had
+ * its chance. Returns false if netplay was torn down. */
+static bool netplay_ggpo_tunnel_poll(netplay_t *netplay)
+{
+   struct netplay_connection *connection;
+   retro_time_t now;
+
+   if (netplay->ggpo_tunnel_pending)
+   {
+      size_t conn_idx = netplay->ggpo_tunnel_connection;
+
+      netplay->ggpo_tunnel_pending = false;
+      ggpo_close_session(netplay->ggpo);
+      netplay->ggpo = NULL;
+      free(netplay->ggpo_local_input);
+      netplay->ggpo_local_input = NULL;
+      free(netplay->ggpo_sync_inputs);
+      netplay->ggpo_sync_inputs = NULL;
+
+      netplay->ggpo_tunnel         = true;
+      netplay->ggpo_tunnel_dropped = 0;
+      if (!netplay_ggpo_bringup_session(netplay, "moving to the tunnel"))
+         return false;
+
+      RARCH_LOG("[GGPO] Session moved to the control channel.\n");
+      if (netplay->is_server)
+      {
+         connection = &netplay->connections[conn_idx];
+         if (!netplay_send_raw_cmd(netplay, connection,
+                  NETPLAY_CMD_GGPO_TUNNEL, NULL, 0))
+            netplay_hangup(netplay, connection);
+      }
+      return true;
+   }
+
+   if (     netplay->is_server
+         || !netplay->ggpo
+         || netplay->ggpo_tunnel
+         || netplay->ggpo_bringup != NETPLAY_GGPO_BRINGUP_SYNC
+         || !netplay->connections_size)
+      return true;
+
+   connection = &netplay->connections[0];
+   if (     !(connection->flags & NETPLAY_CONN_FLAG_ACTIVE)
+         || connection->mode < NETPLAY_CONNECTION_CONNECTED)
+      return true;
+
+   now = cpu_features_get_time_usec();
+   if (     now - netplay->ggpo_bringup_session_start
+            < NETPLAY_GGPO_TUNNEL_PROBE_USEC
+         || now - netplay->ggpo_tunnel_asked < NETPLAY_GGPO_TUNNEL_PROBE_USEC)
+      return true;
+
+   if (!netplay->ggpo_tunnel_asked)
+      RARCH_LOG("[GGPO] No UDP sync after %u ms; asking the host to tunnel.\n",
+            (unsigned)((now - netplay->ggpo_bringup_session_start) / 1000));
+   netplay->ggpo_tunnel_asked = now;
+   if (     !netplay_send_raw_cmd(netplay, connection,
+               NETPLAY_CMD_GGPO_TUNNEL, NULL, 0)
+         || !netplay_send_flush(&connection->send_packet_buffer,
+               connection->fd, false))
+      netplay_hangup(netplay, connection);
+   return true;
+}
+
+/* Moves what a tunnelled session sent onto the control channel, one
+ * command per datagram, and flushes them in a single write alongside
+ * the frame's other commands. */
+static void netplay_ggpo_tunnel_pump(netplay_t *netplay)
+{
+   uint8_t buf[GGPO_TUNNEL_MAX_PACKET];
+   struct netplay_connection *connection;
+   struct socket_buffer *sbuf;
+
+   if (     !netplay->ggpo
+         || !netplay->ggpo_tunnel
+         || netplay->ggpo_tunnel_connection >= netplay->connections_size)
+      return;
+
+   connection = &netplay->connections[netplay->ggpo_tunnel_connection];
+   if (!(connection->flags & NETPLAY_CONN_FLAG_ACTIVE))
+      return;
+   sbuf = &connection->send_packet_buffer;
+
+   for (;;)
+   {
+      int len = (int)sizeof(buf);
+
+      if (     !GGPO_SUCCEEDED(ggpo_tunnel_read(netplay->ggpo, buf, &len))
+            || !len)
+         break;
+
+      /* TCP holds everything behind a lost segment. Queueing more
+       * behind it only adds latency once it arrives, when the next
+       * input packet will repeat what this one had anyway. */
+      if (buf_used(sbuf) > NETPLAY_GGPO_TUNNEL_BACKLOG)
+      {
+         netplay->ggpo_tunnel_dropped++;
+         continue;
+      }
+      if (!netplay_send_raw_cmd(netplay, connection,
+               NETPLAY_CMD_GGPO_TUNNEL, buf, (size_t)len))
+      {
+         netplay_hangup(netplay, connection);
+         return;
+      }
+   }
+
+   if (!netplay_send_flush(sbuf, connection->fd, false))
+      netplay_hangup(netplay, connection);
+}
+
+/* Steps bring-up once a frame until the session exists.
+ * Returns false while the core should not run yet. */
+static bool netplay_ggpo_bringup_poll(netplay_t *netplay)
+{
+   retro_time_t now = cpu_features_get_time_usec();
 
-      if (settings->bools.netplay_public_announce &&
-            netplay->next_announce != -1)
+   if (networking_driver_st.ggpo_synctest_frames)
+   {
+      if (!netplay_ggpo_init_synctest(netplay))
       {
-         if (cpu_features_get_time_usec() >= netplay->next_announce)
-            netplay_announce(netplay);
+         RARCH_ERR("[Netplay] GGPO sync test failed to start.\n");
+         netplay_disconnect(netplay);
+         return false;
       }
+      /* Raise GGPO_EVENTCODE_RUNNING now, so the first frame of a replay
+       * file already runs under the test. */
+      ggpo_idle(netplay->ggpo, 0);
+      return netplay_ggpo_pre_frame(netplay);
    }
-   else if (netplay->connections_size &&
-         (netplay->connections[0].flags & NETPLAY_CONN_FLAG_ACTIVE))
+
+   if (!string_is_empty(networking_driver_st.ggpo_spectate_session))
    {
-      if (netplay->next_ping != -1)
+      if (!netplay_ggpo_init_spectator(netplay))
       {
-         retro_time_t ctime = cpu_features_get_time_usec();
-
-         if (ctime >= netplay->next_ping)
-         {
-            netplay_request_ping(netplay, &netplay->connections[0]);
-            netplay->next_ping = ctime + NETPLAY_PING_TIME;
-         }
+         RARCH_ERR("[Netplay] GGPO spectator failed to start.\n");
+         netplay_disconnect(netplay);
+         runloop_state_get_ptr()->flags |= RUNLOOP_FLAG_SHUTDOWN_INITIATED;
+         return false;
       }
+      return netplay_ggpo_pre_frame(netplay);
    }
-}
-
-static bool netplay_ggpo_pre_frame(netplay_t *netplay)
-{
-   GGPOErrorCode result;
-   int disconnect_flags = 0;
-
-   if (!netplay)
-      return true;
 
-   netplay_ggpo_poll_control(netplay);
+   /* Learn the state size alongside the network round trips. */
+   if (!netplay->state_size && netplay_try_init_serialization(netplay))
+      netplay->ggpo_bringup_state_us =
+         (uint32_t)(now - netplay->ggpo_bringup_start);
 
-   if (!netplay->ggpo)
+   switch (netplay->ggpo_bringup)
    {
-      if (netplay_ggpo_rendezvous_enabled() &&
-            !netplay->ggpo_rendezvous_active)
-      {
-         if (!netplay->state_size)
-         {
-            if (!netplay_wait_and_init_serialization(netplay))
-               return false;
-         }
+      case NETPLAY_GGPO_BRINGUP_RESOLVE:
+         if (!netplay->ggpo_resolved)
+            return false;
+
+         netplay->ggpo_bringup_resolve_us =
+            (uint32_t)(now - netplay->ggpo_bringup_start);
+         netplay->ggpo_bringup = NETPLAY_GGPO_BRINGUP_EXCHANGE;
 
-         if (!netplay_ggpo_rendezvous_start(netplay, netplay->ggpo_base_port))
+         if (netplay_ggpo_relay_enabled())
          {
-            RARCH_ERR("[Netplay] GGPO rendezvous failed to start.\n");
-            netplay_disconnect(netplay);
+            if (!netplay_ggpo_relay_start(netplay, netplay->ggpo_base_port))
+            {
+               RARCH_ERR("[Netplay] GGPO relay failed to start.\n");
+               netplay_disconnect(netplay);
+            }
          }
-         return false;
-      }
-
-      if (netplay->ggpo_rendezvous_active)
-      {
-         if (netplay_ggpo_rendezvous_poll(netplay))
+         else if (netplay_ggpo_rendezvous_enabled())
          {
-            if (!netplay_ggpo_init_session(netplay,
-                  netplay->ggpo_peer_address, netplay->ggpo_base_port))
+            if (!netplay_ggpo_rendezvous_start(netplay, netplay->ggpo_base_port))
             {
-               RARCH_ERR("[Netplay] GGPO failed to start after rendezvous.\n");
+               RARCH_ERR("[Netplay] GGPO rendezvous failed to start.\n");
                netplay_disconnect(netplay);
             }
          }
-         return false;
-      }
-      if (netplay->ggpo_relay_active)
-      {
-         if (netplay_ggpo_relay_poll(netplay))
+         else
          {
-            if (!netplay_ggpo_init_session(netplay,
-                  netplay->ggpo_peer_address, netplay->ggpo_base_port))
+            struct addrinfo *addr = NULL;
+            bool named            = !string_is_empty(
+                  netplay->ggpo_resolved->host[NETPLAY_GGPO_RESOLVE_PEER]);
+
+            if (named)
+               addr = netplay_ggpo_resolved_take(netplay,
+                     NETPLAY_GGPO_RESOLVE_PEER);
+            netplay_ggpo_resolved_done(netplay);
+
+            if (named && !addr)
             {
-               RARCH_ERR("[Netplay] GGPO failed to start after relay.\n");
                netplay_disconnect(netplay);
+               return false;
+            }
+            if (addr)
+            {
+               netplay_ggpo_addr_to_ip(addr, netplay->ggpo_peer_address,
+                     sizeof(netplay->ggpo_peer_address));
+               freeaddrinfo_retro(addr);
             }
+            netplay_ggpo_bringup_session(netplay, "lookup");
          }
          return false;
-      }
+
+      case NETPLAY_GGPO_BRINGUP_EXCHANGE:
+         if (netplay->ggpo_rendezvous_active)
+         {
+            if (netplay_ggpo_rendezvous_poll(netplay))
+               netplay_ggpo_bringup_session(netplay, "rendezvous");
+            return false;
+         }
+         if (netplay->ggpo_relay_active)
+         {
+            if (netplay_ggpo_relay_poll(netplay))
+               netplay_ggpo_bringup_session(netplay, "relay");
+            return false;
+         }
+         break;
+
+      default:
+         break;
+   }
+
+   return true;
+}
+
+/* A spectator has nothing to send: it runs a frame once the relay has
+ * delivered its inputs, and otherwise waits a little for them. */
+static bool netplay_ggpo_spectator_pre_frame(netplay_t *netplay)
+{
+   int disconnect_flags = 0;
+
+   if (     netplay->ggpo_running
+         && GGPO_SUCCEEDED(ggpo_synchronize_input(netplay->ggpo,
+               netplay->ggpo_sync_inputs,
+               (int)(netplay->ggpo_input_size * netplay->ggpo_player_count),
+               &disconnect_flags)))
+   {
+      netplay->ggpo_disconnect_flags = (uint32_t)disconnect_flags;
+      return true;
+   }
+
+   ggpo_idle(netplay->ggpo, GGPO_SPECTATE_WAIT_MS);
+   return false;
+}
+
+static bool netplay_ggpo_pre_frame(netplay_t *netplay)
+{
+   GGPOErrorCode result;
+   int disconnect_flags = 0;
+
+   if (!netplay)
       return true;
+
+   /* Every input either side sends would be read wrong */
+   if (netplay->ggpo_layout_mismatch)
+   {
+      const char *msg = msg_hash_to_str(
+            MSG_NETPLAY_GGPO_INPUT_LAYOUT_MISMATCH);
+      runloop_msg_queue_push(msg, strlen(msg), 1, 180, false, NULL,
+            MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_ERROR);
+      netplay_disconnect(netplay);
+      return false;
    }
 
+   netplay_ggpo_poll_control(netplay);
+
+   if (!netplay_ggpo_tunnel_poll(netplay))
+      return false;
+
+   if (!netplay->ggpo)
+      return netplay_ggpo_bringup_poll(netplay);
+
+   netplay_ggpo_tunnel_pump(netplay);
+
    if (netplay->ggpo_in_rollback)
       return true;
 
+   /* A rollback ran since the last live frame (from the previous
+    * ggpo_advance_frame or ggpo_idle); fade the next live audio in. */
+   if (netplay->ggpo_rollback_frames != netplay->ggpo_rollback_frames_seen)
+   {
+      settings_t *settings = config_get_ptr();
+      netplay->ggpo_rollback_frames_seen = netplay->ggpo_rollback_frames;
+      netplay->ggpo_rollbacks++;
+      if (netplay->ggpo_splice.held_count)
+         netplay_ggpo_splice_apply(netplay);
+      else if (settings->bools.netplay_ggpo_replay_crossfade)
+         netplay->ggpo_audio_crossfade_pos = GGPO_REPLAY_CROSSFADE_FRAMES;
+   }
+
    if (netplay->local_paused)
       netplay_frontend_paused(netplay, false);
 
@@ -10898,13 +14087,61 @@ static bool netplay_ggpo_pre_frame(netplay_t *netplay)
       return false;
    }
 
+   if (netplay->ggpo_spectator)
+      return netplay_ggpo_spectator_pre_frame(netplay);
+
    if (!netplay->ggpo_running)
    {
       ggpo_idle(netplay->ggpo, 0);
       return false;
    }
 
-   netplay_ggpo_collect_local_input(netplay, netplay->ggpo_local_input);
+   /* Drift correction pays the frame advantage back a slice at a time.
+    * The display clock paces most sessions, so the only way to run
+    * slower is to hold a frame; holding single frames, one every
+    * 1000 / slew_permille, keeps the correction below notice. */
+   {
+      GGPOTimeSyncStats timesync;
+      if (GGPO_SUCCEEDED(ggpo_get_timesync_stats(netplay->ggpo, &timesync))
+            && timesync.mode == GGPO_TIMESYNC_SLEW)
+      {
+         if (timesync.slew_permille <= 0)
+            netplay->ggpo_slew_debt = 0;
+         else if ((netplay->ggpo_slew_debt +=
+                  (uint32_t)timesync.slew_permille) >= 1000)
+         {
+            netplay->ggpo_slew_debt -= 1000;
+            ggpo_idle(netplay->ggpo, 0);
+            return false;
+         }
+      }
+   }
+
+   if (netplay->ggpo_delay.enabled && netplay->ggpo_delay.leader)
+   {
+      retro_time_t now = cpu_features_get_time_usec();
+      if (now >= netplay->ggpo_delay.next_sample)
+         netplay_ggpo_delay_sample(netplay, now);
+   }
+
+   /* Late latch: the previous frame ended and the frame delay slept
+    * since the core last polled, so poll again now and send what
+    * the player is pressing as the frame starts. */
+   core_latch_input();
+   /* Not measured across stalls, which show cached frames */
+   if (     netplay->ggpo_frame_end_time
+         && netplay->ggpo_frame_end_count ==
+            video_state_get_ptr()->frame_count)
+   {
+      uint32_t latch_us = (uint32_t)(cpu_features_get_time_usec()
+            - netplay->ggpo_frame_end_time);
+      netplay->ggpo_latch_us = netplay->ggpo_latch_us
+         ? (netplay->ggpo_latch_us * 7 + latch_us) / 8 : latch_us;
+   }
+   netplay_ggpo_collect_local_input(netplay, netplay->ggpo_local_devices,
+         netplay->ggpo_local_input);
+   if (netplay->ggpo_delay.last_input)
+      netplay_ggpo_delay_step(netplay);
 
    result = ggpo_add_local_input(netplay->ggpo, netplay->ggpo_local_handle,
          netplay->ggpo_local_input, (int)netplay->ggpo_input_size);
@@ -10914,6 +14151,22 @@ static bool netplay_ggpo_pre_frame(netplay_t *netplay)
       return false;
    }
 
+   if (netplay->ggpo_delay.last_input)
+   {
+      memcpy(netplay->ggpo_delay.last_input, netplay->ggpo_local_input,
+            netplay->ggpo_input_size);
+      netplay->ggpo_delay.last_input_valid = true;
+   }
+
+   /* A sync test plays both sides. */
+   if (netplay->ggpo_synctest)
+   {
+      netplay_ggpo_collect_local_input(netplay, netplay->ggpo_remote_devices,
+            netplay->ggpo_local_input);
+      ggpo_add_local_input(netplay->ggpo, netplay->ggpo_remote_handle,
+            netplay->ggpo_local_input, (int)netplay->ggpo_input_size);
+   }
+
    result = ggpo_synchronize_input(netplay->ggpo,
          netplay->ggpo_sync_inputs,
          (int)(netplay->ggpo_input_size * netplay->ggpo_player_count),
@@ -10925,6 +14178,8 @@ static bool netplay_ggpo_pre_frame(netplay_t *netplay)
    }
 
    netplay->ggpo_disconnect_flags = (uint32_t)disconnect_flags;
+   netplay_ggpo_splice_begin_frame(netplay,
+         config_get_ptr()->uints.netplay_ggpo_audio_splice_frames);
    return true;
 }
 
@@ -10936,8 +14191,27 @@ static void netplay_ggpo_post_frame(netplay_t *netplay)
    if (netplay->ggpo_in_rollback)
       return;
 
+   if (netplay->ggpo_synctest)
+      netplay->ggpo_synctest->frames++;
+   else if (netplay->ggpo_spectator)
+      netplay->ggpo_spectator_frames++;
+   else if (!netplay->ggpo_profile_done
+         && !(++netplay->ggpo_profile_frames % NETPLAY_GGPO_PROFILE_FRAMES))
+      netplay_ggpo_profile_update(netplay);
+
+   if (netplay->ggpo_buttons_read & ~netplay->ggpo_buttons_known)
+   {
+      RARCH_WARN("[GGPO] The core reads buttons 0x%04X it has no input "
+            "descriptors for; netplay leaves them released.\n",
+            netplay->ggpo_buttons_read & ~netplay->ggpo_buttons_known);
+      netplay->ggpo_buttons_known |= netplay->ggpo_buttons_read;
+   }
+
    ggpo_advance_frame(netplay->ggpo);
    ggpo_idle(netplay->ggpo, 0);
+   netplay_ggpo_tunnel_pump(netplay);
+   netplay->ggpo_frame_end_time  = cpu_features_get_time_usec();
+   netplay->ggpo_frame_end_count = video_state_get_ptr()->frame_count;
 }
 #endif
 
@@ -11160,12 +14434,16 @@ bool init_netplay(const char *server, unsigned port, const char *mitm_session)
    if (net_st->core_netpacket_interface)
       modus = NETPLAY_MODUS_CORE_PACKET_INTERFACE;
 #ifdef HAVE_GGPO
-   else if (settings->bools.netplay_use_ggpo)
+   else if (settings->bools.netplay_use_ggpo
+         || net_st->ggpo_synctest_frames
+         || !string_is_empty(net_st->ggpo_spectate_session))
       modus = NETPLAY_MODUS_GGPO;
 #endif
 
 #ifdef HAVE_GGPO
-   if (modus == NETPLAY_MODUS_GGPO)
+   if (netplay_ggpo_standalone())
+      tcp_enabled = false;
+   else if (modus == NETPLAY_MODUS_GGPO)
    {
       ggpo_use_relay = settings->bools.netplay_use_ggpo_relay;
       ggpo_use_rendezvous = settings->bools.netplay_use_rendezvous;
@@ -11302,6 +14580,11 @@ bool init_netplay(const char *server, unsigned port, const char *mitm_session)
 
    net_st->data = netplay;
 
+#ifdef HAVE_GGPO
+   if (netplay_ggpo_standalone())
+      return true;
+#endif
+
    if (netplay->modus == NETPLAY_MODUS_GGPO)
    {
       const char *_msg = netplay->is_server ?
@@ -11327,9 +14610,8 @@ bool init_netplay(const char *server, unsigned port, const char *mitm_session)
 
          if (settings->bools.netplay_nat_traversal)
             netplay_init_nat_traversal(netplay);
-         else
-            netplay->next_announce =
-               cpu_features_get_time_usec() + NETPLAY_ANNOUNCE_AFTER;
+         netplay->next_announce =
+            cpu_features_get_time_usec() + NETPLAY_ANNOUNCE_AFTER;
          return true;
       }
 
@@ -11362,14 +14644,13 @@ bool init_netplay(const char *server, unsigned port, const char *mitm_session)
          free(buf);
       }
 
+      /* NAT traversal runs alongside; when it's done,
+         it announces again with the forwarded port. */
       if (netplay->nat_traversal)
-         /* If performing NAT traversal,
-            start announcing after it's done. */
          netplay_init_nat_traversal(netplay);
-      else
-         /* Start announcing after NETPLAY_ANNOUNCE_AFTER. */
-         netplay->next_announce =
-            cpu_features_get_time_usec() + NETPLAY_ANNOUNCE_AFTER;
+      /* Start announcing after NETPLAY_ANNOUNCE_AFTER. */
+      netplay->next_announce =
+         cpu_features_get_time_usec() + NETPLAY_ANNOUNCE_AFTER;
 
       _msg = msg_hash_to_str(MSG_WAITING_FOR_CLIENT);
       runloop_msg_queue_push(_msg, strlen(_msg), 0, 180, false, NULL,
@@ -11609,7 +14890,7 @@ bool netplay_reinit_serialization(void)
     * nothing else, so we have to free them directly */
    for (i = 0; i < netplay->buffer_size; i++)
    {
-      free(netplay->buffer[i].state);
+      memalign_free_large(netplay->buffer[i].state);
       netplay->buffer[i].state = NULL;
    }
 
@@ -11621,7 +14902,7 @@ bool netplay_reinit_serialization(void)
 
    if (netplay->delta_buffer)
    {
-      free(netplay->delta_buffer);
+      memalign_free_large(netplay->delta_buffer);
       netplay->delta_buffer = NULL;
    }
    netplay->delta_buffer_size = 0;
@@ -11874,6 +15155,21 @@ bool netplay_driver_ctl(enum rarch_netplay_ctl_state state, void *data)
             netplay_announce_nat_traversal(netplay, (uintptr_t)data);
          break;
 
+#ifdef HAVE_GGPO
+      case RARCH_NETPLAY_CTL_FINISHED_GGPO_RESOLVE:
+         /* Anything but the lookup we are waiting on is the caller's
+          * to free. */
+         if (netplay && data && netplay->ggpo_resolve == data)
+         {
+            netplay->ggpo_resolve = NULL;
+            netplay_ggpo_resolved_done(netplay);
+            netplay->ggpo_resolved = (struct netplay_ggpo_resolve*)data;
+         }
+         else
+            ret = false;
+         break;
+#endif
+
       case RARCH_NETPLAY_CTL_DESYNC_PUSH:
          if (netplay)
          {
@@ -12394,6 +15690,7 @@ static void gfx_widget_netplay_ggpo_stats_iterate(void *user_data,
    netplay_t          *netplay  = net_st->data;
    settings_t         *settings = config_get_ptr();
    GGPONetworkStats stats;
+   GGPOTimeSyncStats timesync;
 #ifdef HAVE_MENU
    bool menu_open               = menu_state_get_ptr()->flags &
       MENU_ST_FLAG_ALIVE;
@@ -12414,6 +15711,7 @@ static void gfx_widget_netplay_ggpo_stats_iterate(void *user_data,
    net_st->ggpo_compress_pending_count = 0;
    net_st->ggpo_compress_job_queue_max = 0;
    net_st->ggpo_compress_result_queue_max = 0;
+   net_st->ggpo_setup_stats_valid = false;
 
    if (!netplay || !settings->bools.netplay_ggpo_stats_show)
       return;
@@ -12434,13 +15732,21 @@ static void gfx_widget_netplay_ggpo_stats_iterate(void *user_data,
          netplay->ggpo_remote_handle, &stats)))
       return;
 
-   net_st->ggpo_stats_ping               = stats.network.ping;
+   net_st->ggpo_stats_ping_us            = stats.network.ping_us;
    net_st->ggpo_stats_send_queue_len     = stats.network.send_queue_len;
    net_st->ggpo_stats_recv_queue_len     = stats.network.recv_queue_len;
    net_st->ggpo_stats_kbps_sent          = stats.network.kbps_sent;
    net_st->ggpo_stats_local_frames_behind  = stats.timesync.local_frames_behind;
    net_st->ggpo_stats_remote_frames_behind = stats.timesync.remote_frames_behind;
+   net_st->ggpo_stats_drift_x100         = GGPO_SUCCEEDED(
+         ggpo_get_timesync_stats(netplay->ggpo, &timesync))
+      ? timesync.error_x100 : 0;
    net_st->ggpo_stats_rollback_frames    = netplay->ggpo_rollback_frames;
+   net_st->ggpo_stats_replay_saved_us    = netplay->ggpo_rollbacks
+      ? (uint32_t)(netplay->ggpo_replay_saved_us / netplay->ggpo_rollbacks)
+      : 0;
+   net_st->ggpo_stats_latch_us           = netplay->ggpo_latch_us;
+   net_st->ggpo_stats_delay_frames       = netplay->ggpo_delay.frames;
    net_st->ggpo_stats_valid              = true;
 
    net_st->ggpo_state_size               = netplay->ggpo_state_size;
@@ -12458,6 +15764,16 @@ static void gfx_widget_netplay_ggpo_stats_iterate(void *user_data,
       : 0;
    net_st->ggpo_state_stats_valid        = netplay->ggpo_state_save_samples > 0;
 
+   net_st->ggpo_setup_resolve_ms         = netplay->ggpo_bringup_resolve_us / 1000;
+   net_st->ggpo_setup_exchange_ms        = netplay->ggpo_bringup_exchange_us / 1000;
+   net_st->ggpo_setup_session_ms         = netplay->ggpo_bringup_session_us / 1000;
+   net_st->ggpo_setup_sync_ms            = netplay->ggpo_bringup_sync_us / 1000;
+   net_st->ggpo_setup_token              = netplay->ggpo_bringup_token;
+   net_st->ggpo_setup_tunnel             =
+      stats.network.transport == GGPO_TRANSPORT_TUNNEL;
+   net_st->ggpo_setup_stats_valid        =
+      netplay->ggpo_bringup == NETPLAY_GGPO_BRINGUP_DONE;
+
    if (netplay_ggpo_update_delta_stats(netplay))
    {
       net_st->ggpo_delta_ratio_last = netplay->ggpo_delta_ratio_last;
@@ -12475,127 +15791,160 @@ static void gfx_widget_netplay_ggpo_stats_iterate(void *user_data,
    }
 }
 
-static void gfx_widget_netplay_ggpo_stats_frame(void *data, void *userdata)
+#define GGPO_STATS_WIDGET_LINES 6
+
+/* Text of the GGPO stats widget. The stats are sampled
+ * every frame, but the lines are only formatted and
+ * measured again once per GGPO_STATE_LOG_INTERVAL_USEC,
+ * and when the font changes. */
+static struct
+{
+   retro_time_t time;
+   const void *font;
+   unsigned video_width;
+   unsigned video_height;
+   unsigned count;
+   int total_width;
+   int widths[GGPO_STATS_WIDGET_LINES];
+   char lines[GGPO_STATS_WIDGET_LINES][96];
+} ggpo_stats_widget_text;
+
+static void gfx_widget_netplay_ggpo_stats_format(
+      net_driver_state_t *net_st, gfx_widget_font_data_t *font)
 {
-   net_driver_state_t *net_st = &networking_driver_st;
-   settings_t         *settings = config_get_ptr();
-   video_frame_info_t *video_info = (video_frame_info_t*)data;
-   dispgfx_widget_t   *p_dispwidget = (dispgfx_widget_t*)userdata;
-   gfx_display_t      *p_disp = (gfx_display_t*)video_info->disp_userdata;
-   gfx_widget_font_data_t *font = &p_dispwidget->gfx_widget_fonts.regular;
    bool show_state_stats = net_st->ggpo_state_stats_valid;
    bool show_delta_stats = show_state_stats && net_st->ggpo_delta_stats_valid;
    bool show_compress_stats = show_state_stats && net_st->ggpo_compress_stats_valid;
-   int ping = net_st->ggpo_stats_ping;
+   bool show_setup_stats = net_st->ggpo_setup_stats_valid;
+   float ping = net_st->ggpo_stats_ping_us / 1000.0f;
    int send_queue = net_st->ggpo_stats_send_queue_len;
    int recv_queue = net_st->ggpo_stats_recv_queue_len;
    int kbps_sent = net_st->ggpo_stats_kbps_sent;
    int local_behind = net_st->ggpo_stats_local_frames_behind;
    int remote_behind = net_st->ggpo_stats_remote_frames_behind;
+   float drift = net_st->ggpo_stats_drift_x100 / 100.0f;
    uint32_t rollback_frames = net_st->ggpo_stats_rollback_frames;
-   uint32_t state_size = net_st->ggpo_state_size;
-   uint32_t state_save_avg_us = net_st->ggpo_state_save_avg_us;
-   uint32_t state_load_avg_us = net_st->ggpo_state_load_avg_us;
-   uint32_t state_save_max_us = net_st->ggpo_state_save_max_us;
-   uint32_t state_load_max_us = net_st->ggpo_state_load_max_us;
-   uint32_t delta_ratio_avg = net_st->ggpo_delta_ratio_avg;
-   uint32_t delta_ratio_last = net_st->ggpo_delta_ratio_last;
-   uint32_t delta_ratio_max = net_st->ggpo_delta_ratio_max;
-   uint32_t delta_frames = net_st->ggpo_delta_frames;
-   uint32_t delta_keyframes = net_st->ggpo_delta_keyframes;
-   uint32_t compress_job_queue_len = net_st->ggpo_compress_job_queue_len;
-   uint32_t compress_result_queue_len = net_st->ggpo_compress_result_queue_len;
-   uint32_t compress_pending_count = net_st->ggpo_compress_pending_count;
-   uint32_t compress_job_queue_max = net_st->ggpo_compress_job_queue_max;
-   uint32_t compress_result_queue_max = net_st->ggpo_compress_result_queue_max;
-   uint32_t delta_total = 0;
-   char line1[64];
-   char line2[64];
-   char line3[96];
-   char line4[96];
-   char line5[96];
-   size_t line1_len;
-   size_t line2_len;
-   size_t line3_len = 0;
-   size_t line4_len = 0;
-   size_t line5_len = 0;
-   int line1_width;
-   int line2_width;
-   int line3_width = 0;
-   int line4_width = 0;
-   int line5_width = 0;
-   int total_width;
-   unsigned line_height = p_dispwidget->simple_widget_height;
-   unsigned total_lines = 2 + (show_state_stats ? 1 : 0) +
-      (show_delta_stats ? 1 : 0) + (show_compress_stats ? 1 : 0);
-   unsigned total_height = line_height * total_lines;
-   unsigned ping_offset = settings->bools.netplay_ping_show ? line_height : 0;
-   int y;
-   unsigned line_index = 0;
-
-   if (!net_st->ggpo_stats_valid)
-      return;
-
-   if (ping > 999)
-      ping = 999;
-   if (ping < 0)
-      ping = 0;
+   uint32_t replay_saved_us = net_st->ggpo_stats_replay_saved_us;
+   unsigned i;
+   size_t lens[GGPO_STATS_WIDGET_LINES];
+   char (*lines)[96] = ggpo_stats_widget_text.lines;
+   unsigned count = 0;
+
+   if (ping > 999.0f)
+      ping = 999.0f;
+   if (ping < 0.0f)
+      ping = 0.0f;
    if (kbps_sent < 0)
       kbps_sent = 0;
 
-   line1_len = (size_t)snprintf(line1, sizeof(line1),
-         "GGPO PING: %dms  Q: %d/%d  TX: %dKB/s",
-         ping, send_queue, recv_queue, kbps_sent);
-   line2_len = (size_t)snprintf(line2, sizeof(line2),
-         "ROLLBACKS: %u  BEHIND: %d/%d",
-         rollback_frames, local_behind, remote_behind);
+   lens[count++] = (size_t)snprintf(lines[0], sizeof(lines[0]),
+         "GGPO PING: %.*fms  Q: %d/%d  TX: %dKB/s  LATCH: +%.1fms",
+         (ping < 10.0f) ? 2 : 0, ping, send_queue, recv_queue, kbps_sent,
+         net_st->ggpo_stats_latch_us / 1000.0f);
+   if (replay_saved_us)
+      lens[count++] = (size_t)snprintf(lines[1], sizeof(lines[1]),
+            "ROLLBACKS: %u  DELAY: %u  BEHIND: %d/%d  DRIFT: %+.2f  AV SKIP ~%u us/rb",
+            rollback_frames, net_st->ggpo_stats_delay_frames,
+            local_behind, remote_behind, drift, replay_saved_us);
+   else
+      lens[count++] = (size_t)snprintf(lines[1], sizeof(lines[1]),
+            "ROLLBACKS: %u  DELAY: %u  BEHIND: %d/%d  DRIFT: %+.2f",
+            rollback_frames, net_st->ggpo_stats_delay_frames,
+            local_behind, remote_behind, drift);
    if (show_state_stats)
-      line3_len = (size_t)snprintf(line3, sizeof(line3),
+   {
+      lens[count]   = (size_t)snprintf(lines[count], sizeof(lines[count]),
             "STATE %uB  S %u/%u us  L %u/%u us",
-            state_size, state_save_avg_us, state_save_max_us,
-            state_load_avg_us, state_load_max_us);
+            net_st->ggpo_state_size,
+            net_st->ggpo_state_save_avg_us, net_st->ggpo_state_save_max_us,
+            net_st->ggpo_state_load_avg_us, net_st->ggpo_state_load_max_us);
+      count++;
+   }
    if (show_delta_stats)
    {
-      delta_total = delta_frames + delta_keyframes;
-      line4_len = (size_t)snprintf(line4, sizeof(line4),
+      uint32_t delta_total = net_st->ggpo_delta_frames
+         + net_st->ggpo_delta_keyframes;
+      lens[count]   = (size_t)snprintf(lines[count], sizeof(lines[count]),
             "DELTA avg %u%% (last %u%% max %u%%) KF %u/%u",
-            delta_ratio_avg, delta_ratio_last, delta_ratio_max,
-            delta_keyframes, delta_total);
+            net_st->ggpo_delta_ratio_avg, net_st->ggpo_delta_ratio_last,
+            net_st->ggpo_delta_ratio_max,
+            net_st->ggpo_delta_keyframes, delta_total);
+      count++;
    }
    if (show_compress_stats)
-      line5_len = (size_t)snprintf(line5, sizeof(line5),
+   {
+      lens[count]   = (size_t)snprintf(lines[count], sizeof(lines[count]),
             "COMP Q %u/%u P %u HW %u/%u",
-            compress_job_queue_len, compress_result_queue_len,
-            compress_pending_count, compress_job_queue_max,
-            compress_result_queue_max);
-
-   line1_width = font_driver_get_message_width(
-         font->font, line1, line1_len, 1.0f);
-   line2_width = font_driver_get_message_width(
-         font->font, line2, line2_len, 1.0f);
-   total_width = line1_width > line2_width ? line1_width : line2_width;
-   if (show_state_stats)
+            net_st->ggpo_compress_job_queue_len,
+            net_st->ggpo_compress_result_queue_len,
+            net_st->ggpo_compress_pending_count,
+            net_st->ggpo_compress_job_queue_max,
+            net_st->ggpo_compress_result_queue_max);
+      count++;
+   }
+   if (show_setup_stats)
    {
-      line3_width = font_driver_get_message_width(
-            font->font, line3, line3_len, 1.0f);
-      if (line3_width > total_width)
-         total_width = line3_width;
+      lens[count]   = (size_t)snprintf(lines[count], sizeof(lines[count]),
+            "SETUP DNS %u XCHG %u%s START %u SYNC %u ms  VIA %s",
+            net_st->ggpo_setup_resolve_ms, net_st->ggpo_setup_exchange_ms,
+            net_st->ggpo_setup_token ? " (TOKEN)" : "",
+            net_st->ggpo_setup_session_ms, net_st->ggpo_setup_sync_ms,
+            net_st->ggpo_setup_tunnel ? "TCP" : "UDP");
+      count++;
    }
-   if (show_delta_stats)
+
+   ggpo_stats_widget_text.count       = count;
+   ggpo_stats_widget_text.total_width = 0;
+   for (i = 0; i < count; i++)
    {
-      line4_width = font_driver_get_message_width(
-            font->font, line4, line4_len, 1.0f);
-      if (line4_width > total_width)
-         total_width = line4_width;
+      /* snprintf() returns the untruncated length */
+      if (lens[i] >= sizeof(lines[i]))
+         lens[i] = sizeof(lines[i]) - 1;
+      ggpo_stats_widget_text.widths[i] = font_driver_get_message_width(
+            font->font, lines[i], lens[i], 1.0f);
+      if (ggpo_stats_widget_text.widths[i] > ggpo_stats_widget_text.total_width)
+         ggpo_stats_widget_text.total_width = ggpo_stats_widget_text.widths[i];
    }
-   if (show_compress_stats)
+}
+
+static void gfx_widget_netplay_ggpo_stats_frame(void *data, void *userdata)
+{
+   unsigned i;
+   int y;
+   int total_width;
+   net_driver_state_t *net_st = &networking_driver_st;
+   settings_t         *settings = config_get_ptr();
+   video_frame_info_t *video_info = (video_frame_info_t*)data;
+   dispgfx_widget_t   *p_dispwidget = (dispgfx_widget_t*)userdata;
+   gfx_display_t      *p_disp = (gfx_display_t*)video_info->disp_userdata;
+   gfx_widget_font_data_t *font = &p_dispwidget->gfx_widget_fonts.regular;
+   retro_time_t now = cpu_features_get_time_usec();
+   unsigned line_height = p_dispwidget->simple_widget_height;
+   unsigned ping_offset = settings->bools.netplay_ping_show ? line_height : 0;
+   unsigned total_height;
+
+   if (!net_st->ggpo_stats_valid)
+   {
+      /* Show fresh stats as soon as they come back */
+      ggpo_stats_widget_text.font = NULL;
+      return;
+   }
+
+   if (     (ggpo_stats_widget_text.font != font->font)
+         || (ggpo_stats_widget_text.video_width  != video_info->width)
+         || (ggpo_stats_widget_text.video_height != video_info->height)
+         || (now - ggpo_stats_widget_text.time >= GGPO_STATE_LOG_INTERVAL_USEC))
    {
-      line5_width = font_driver_get_message_width(
-            font->font, line5, line5_len, 1.0f);
-      if (line5_width > total_width)
-         total_width = line5_width;
+      gfx_widget_netplay_ggpo_stats_format(net_st, font);
+      ggpo_stats_widget_text.time         = now;
+      ggpo_stats_widget_text.font         = font->font;
+      ggpo_stats_widget_text.video_width  = video_info->width;
+      ggpo_stats_widget_text.video_height = video_info->height;
    }
-   total_width += p_dispwidget->simple_widget_padding * 2;
+
+   total_width  = ggpo_stats_widget_text.total_width
+      + p_dispwidget->simple_widget_padding * 2;
+   total_height = line_height * ggpo_stats_widget_text.count;
 
    y = (int)video_info->height - (int)total_height - (int)ping_offset;
    if (y < 0)
@@ -12616,79 +15965,19 @@ static void gfx_widget_netplay_ggpo_stats_frame(void *data, void *userdata)
          p_dispwidget->backdrop_orig,
          NULL);
 
-   gfx_widgets_draw_text(
-         font,
-         line1,
-         video_info->width - line1_width - p_dispwidget->simple_widget_padding,
-         (float)y + (line_height * line_index) + (line_height / 2.0f) +
-            font->line_centre_offset,
-         video_info->width,
-         video_info->height,
-         0xFFFFFFFF,
-         TEXT_ALIGN_LEFT,
-         true);
-   line_index++;
-
-   gfx_widgets_draw_text(
-         font,
-         line2,
-         video_info->width - line2_width - p_dispwidget->simple_widget_padding,
-         (float)y + (line_height * line_index) + (line_height / 2.0f) +
-            font->line_centre_offset,
-         video_info->width,
-         video_info->height,
-         0xFFFFFFFF,
-         TEXT_ALIGN_LEFT,
-         true);
-   line_index++;
-
-   if (show_state_stats)
-   {
-      gfx_widgets_draw_text(
-            font,
-            line3,
-            video_info->width - line3_width - p_dispwidget->simple_widget_padding,
-            (float)y + (line_height * line_index) + (line_height / 2.0f) +
-               font->line_centre_offset,
-            video_info->width,
-            video_info->height,
-            0xFFFFFFFF,
-            TEXT_ALIGN_LEFT,
-            true);
-      line_index++;
-   }
-
-   if (show_delta_stats)
-   {
-      gfx_widgets_draw_text(
-            font,
-            line4,
-            video_info->width - line4_width - p_dispwidget->simple_widget_padding,
-            (float)y + (line_height * line_index) + (line_height / 2.0f) +
-               font->line_centre_offset,
-            video_info->width,
-            video_info->height,
-            0xFFFFFFFF,
-            TEXT_ALIGN_LEFT,
-            true);
-      line_index++;
-   }
-
-   if (show_compress_stats)
-   {
+   for (i = 0; i < ggpo_stats_widget_text.count; i++)
       gfx_widgets_draw_text(
             font,
-            line5,
-            video_info->width - line5_width - p_dispwidget->simple_widget_padding,
-            (float)y + (line_height * line_index) + (line_height / 2.0f) +
+            ggpo_stats_widget_text.lines[i],
+            video_info->width - ggpo_stats_widget_text.widths[i]
+               - p_dispwidget->simple_widget_padding,
+            (float)y + (line_height * i) + (line_height / 2.0f) +
                font->line_centre_offset,
             video_info->width,
             video_info->height,
             0xFFFFFFFF,
             TEXT_ALIGN_LEFT,
             true);
-      line_index++;
-   }
 }
 #endif
 
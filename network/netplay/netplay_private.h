@@ -29,6 +29,7 @@
 
 #ifdef HAVE_GGPO
 typedef struct GGPOSession GGPOSession;
+typedef struct GGPOStateRange GGPOStateRange;
 typedef int GGPOPlayerHandle;
 struct addrinfo;
 #endif
@@ -86,7 +87,34 @@ struct addrinfo;
 #define NETPLAY_COMPRESSION_SUPPORTED 0
 #endif
 
-#define NETPLAY_STATE_FLAG_DELTA (1U << 0)
+#define NETPLAY_STATE_FLAG_DELTA  (1U << 0)
+/* The delta only carries the changed blocks, after a bitmap of them */
+#define NETPLAY_STATE_FLAG_BLOCKS (1U << 1)
+
+#define NETPLAY_STATE_BLOCK_SIZE 4096
+#define NETPLAY_STATE_BLOCKS_MAP_SIZE(size) \
+   (((((size) + NETPLAY_STATE_BLOCK_SIZE - 1) / NETPLAY_STATE_BLOCK_SIZE) + 7) / 8)
+
+/* State hash used for NETPLAY_CMD_CRC */
+enum netplay_state_hash
+{
+   NETPLAY_STATE_HASH_CRC32 = 0,
+   NETPLAY_STATE_HASH_XXH3,
+   NETPLAY_STATE_HASH_LAST
+};
+
+/* Peers from protocol 10 hash with the low 32 bits of XXH3-64 */
+#define NETPLAY_CONNECTION_STATE_HASH(connection) \
+   ((connection)->netplay_protocol >= 10 \
+      ? NETPLAY_STATE_HASH_XXH3 : NETPLAY_STATE_HASH_CRC32)
+
+/* NETPLAY_CMD_LOAD_SAVESTATE_ACK status */
+#define NETPLAY_STATE_ACK_APPLIED 0
+#define NETPLAY_STATE_ACK_NO_BASE 1
+
+/* Payloads from this size up are sent without copying them into the
+ * socket buffer when it is empty */
+#define NETPLAY_SEND_DIRECT_MIN 4096
 
 /* The keys supported by netplay */
 enum netplay_keys
@@ -174,6 +202,13 @@ enum netplay_cmd
    /* Send a network packet from the raw packet core interface */
    NETPLAY_CMD_NETPACKET      = 0x0048,
 
+   /* Reports whether a state load was applied or had no delta base */
+   NETPLAY_CMD_LOAD_SAVESTATE_ACK = 0x0049,
+
+   /* A GGPO datagram carried over the control channel. Empty, it asks
+    * the host to move the session there, and the host's echo agrees */
+   NETPLAY_CMD_GGPO_TUNNEL    = 0x004A,
+
    /* Misc. commands */
 
    /* Sends multiple config requests over,
@@ -316,6 +351,23 @@ typedef struct netplay_input_state
       due to dynamic resizing. */
 } *netplay_input_state_t;
 
+/* Merges @words words of @count clients' input into @resstate,
+ * starting at word @first. */
+typedef void (*netplay_merge_t)(netplay_input_state_t resstate,
+      const netplay_input_state_t *states, unsigned count,
+      unsigned first, unsigned words);
+
+/* How one shared device's input is merged, picked again whenever its
+ * type, share mode or input size changes rather than every frame. */
+struct netplay_merge_kernel
+{
+   netplay_merge_t digital;
+   netplay_merge_t analog;  /* NULL for devices without axes */
+   uint32_t key;            /* What it was picked for; 0 if unset */
+   uint8_t digital_words;   /* From word 0 */
+   uint8_t analog_words;    /* From the word after the digital ones */
+};
+
 struct delta_frame
 {
    /* The resolved input, i.e., what's actually
@@ -355,6 +407,10 @@ struct socket_buffer
    size_t start;
    size_t end;
    size_t read;
+   /* Bytes copied in or out of data, and bytes sent or decompressed
+    * without passing through it */
+   uint64_t copied;
+   uint64_t direct;
 };
 
 /* We do it like this instead of using sockaddr_storage
@@ -495,6 +551,166 @@ struct netplay_chat
    } messages[NETPLAY_CHAT_MAX_MESSAGES];
 };
 
+#ifdef HAVE_GGPO
+#define NETPLAY_GGPO_RELAY_CANDIDATES 8
+
+/* Desyncs per session whose states are written out */
+#define NETPLAY_GGPO_DESYNC_DUMPS 4
+
+/* Core profile: live frames measured before tuning, replayed frames
+ * needed for a resimulation cost, and the share of the frame time a
+ * worst-case rollback may take. */
+#define NETPLAY_GGPO_PROFILE_FRAMES      300
+#define NETPLAY_GGPO_PROFILE_MIN_REPLAYS 60
+#define NETPLAY_GGPO_PROFILE_BUDGET_PCT  75
+#define NETPLAY_GGPO_PROFILE_MAX_WINDOW  32
+
+/* Save and load times kept for the --netplay-synctest report */
+#define NETPLAY_GGPO_SYNCTEST_SAMPLES 4096
+
+/* How long a client waits for UDP to synchronize before asking to
+ * tunnel the session over the control channel, and asks again */
+#define NETPLAY_GGPO_TUNNEL_PROBE_USEC 3000000
+/* Unsent control channel bytes past which tunnelled datagrams are
+ * dropped rather than queued behind a stalled segment; each input
+ * packet carries every unacknowledged input again */
+#define NETPLAY_GGPO_TUNNEL_BACKLOG    8192
+
+/* Adaptive input delay: how often the link is sampled, the rollback
+ * depth the delay leaves to rollback, the depth past which a rollback
+ * counts as deep, samples in a row needed to go up or down a frame,
+ * and how long a change holds before the next. */
+#define NETPLAY_GGPO_DELAY_SAMPLE_USEC   500000
+#define NETPLAY_GGPO_DELAY_ROLLBACK      2
+#define NETPLAY_GGPO_DELAY_DEEP          4
+#define NETPLAY_GGPO_DELAY_UP_SAMPLES    3
+#define NETPLAY_GGPO_DELAY_DOWN_SAMPLES  10
+#define NETPLAY_GGPO_DELAY_HOLD_USEC     5000000
+
+/* ggpo_send_control payloads, the type in the first byte */
+enum netplay_ggpo_control
+{
+   NETPLAY_GGPO_CONTROL_DELAY = 1,   /* seq, frames: the leader proposes */
+   NETPLAY_GGPO_CONTROL_DELAY_ACK,   /* seq, frames: what the other side takes */
+   NETPLAY_GGPO_CONTROL_LAYOUT       /* size, then per player buttons (2),
+                                      * axes: the input layout in use */
+};
+
+/* Words of the largest device, the keyboard */
+#define NETPLAY_GGPO_DEVICE_WORDS 5
+
+/* How a port's device goes into GGPO input. A joypad or analog device
+ * that the core has input descriptors for sends only the buttons and
+ * analog axes it declares: the buttons bits in ascending order, padded
+ * to a byte, then each of the axes as 16 bits. Anything else sends its
+ * words as they are. */
+struct netplay_ggpo_layout
+{
+   uint32_t words;    /* unpacked, as netplay_expected_input_size */
+   uint32_t size;     /* bytes sent */
+   uint16_t buttons;  /* 1 << RETRO_DEVICE_ID_JOYPAD_* */
+   uint8_t axes;      /* 1 << (stick * 2 + axis) */
+   bool packed;
+};
+
+/* Input delay kept between frames_min and frames_max for the link as
+ * it is now. The lower player index leads: it samples ping, jitter and
+ * the rollback depths, and proposes one frame up or down; the other
+ * side answers with the delay it takes. Each side sets its own frame
+ * delay to the agreed target on a frame whose input is the same as the
+ * one before, where the frame GGPO drops or repeats changes nothing. */
+struct netplay_ggpo_delay
+{
+   retro_time_t next_sample;
+   retro_time_t hold_until;
+   uint32_t *last_input;
+   uint32_t ping_us;         /* moving averages, 1/4 */
+   uint32_t jitter_us;
+   /* Session totals at the last sample */
+   unsigned rollbacks;
+   unsigned deep_rollbacks;
+   unsigned frames_min;
+   unsigned frames_max;
+   unsigned frames;          /* set with ggpo_set_frame_delay */
+   unsigned target;
+   unsigned up_samples;
+   unsigned down_samples;
+   uint8_t seq;
+   bool enabled;
+   bool leader;
+   bool proposing;           /* waiting for the answer to seq */
+   bool last_input_valid;
+};
+
+/* A --netplay-synctest run. The time rings hold the newest
+ * NETPLAY_GGPO_SYNCTEST_SAMPLES calls. */
+struct netplay_ggpo_synctest
+{
+   retro_time_t start;
+   uint64_t frames;          /* live frames; replays are ggpo_rollback_frames */
+   uint64_t save_count;
+   uint64_t load_count;
+   int first_desync;         /* -1 while every replay matched */
+   int last_match;
+   uint32_t save_us[NETPLAY_GGPO_SYNCTEST_SAMPLES];
+   uint32_t load_us[NETPLAY_GGPO_SYNCTEST_SAMPLES];
+};
+
+/* One core frame of audio, interleaved stereo */
+struct netplay_ggpo_audio_frame
+{
+   int16_t *data;
+   size_t frames;
+   size_t capacity;
+   /* Live frame it belongs to */
+   uint32_t frame;
+};
+
+/* Live audio held back from the driver for a few core frames, so that
+ * a rollback can swap in the audio of the corrected timeline before
+ * any of it is heard. */
+struct netplay_ggpo_audio_splice
+{
+   /* Oldest first; the last one is the frame being run */
+   struct netplay_ggpo_audio_frame held[NETPLAY_GGPO_SPLICE_MAX_FRAMES + 1];
+   /* The newest resimulated frames, oldest first */
+   struct netplay_ggpo_audio_frame replay[NETPLAY_GGPO_SPLICE_MAX_FRAMES];
+   unsigned held_count;
+   unsigned replay_count;
+   /* Resimulated frames of the rollback in progress, still untagged */
+   unsigned replay_untagged;
+   /* Live frames started */
+   uint32_t live_frame;
+   uint32_t splices;
+};
+
+/* Relay selection, run before registering with a GGPO relay */
+enum netplay_ggpo_relay_stage
+{
+   NETPLAY_GGPO_RELAY_LIST = 0, /* waiting for the lobby's relay list */
+   NETPLAY_GGPO_RELAY_PROBE,    /* pinging every candidate */
+   NETPLAY_GGPO_RELAY_AGREE,    /* swapping RTTs through the rendezvous server */
+   NETPLAY_GGPO_RELAY_HELLO     /* registering with the chosen relay */
+};
+
+struct netplay_ggpo_relay_candidate
+{
+   struct addrinfo *addr;
+   int rtt_ms; /* best probe round trip, -1 without an answer */
+   uint16_t port;
+   char server[NETPLAY_HOST_STR_LEN * 2];
+};
+
+/* Session bring-up, stepped from pre_frame while content finishes loading */
+enum netplay_ggpo_bringup
+{
+   NETPLAY_GGPO_BRINGUP_RESOLVE = 0, /* host lookups on the task queue */
+   NETPLAY_GGPO_BRINGUP_EXCHANGE,    /* rendezvous or relay registration */
+   NETPLAY_GGPO_BRINGUP_SYNC,        /* session started, peers synchronizing */
+   NETPLAY_GGPO_BRINGUP_DONE
+};
+#endif
+
 struct netplay
 {
    /* We stall if we're far enough ahead that we
@@ -506,6 +722,15 @@ struct netplay
    retro_time_t frame_run_time_sum;
    retro_time_t frame_run_time_avg;
 
+   /* Time spent merging shared devices' input: this frame, and
+    * summed and at most over the current stats window */
+   retro_time_t merge_time;
+   retro_time_t merge_time_sum;
+   retro_time_t merge_time_max;
+   unsigned merge_time_frames;
+
+   struct netplay_merge_kernel merge_kernels[MAX_INPUT_DEVICES];
+
    /* When did we start falling behind? */
    retro_time_t catch_up_time;
    /* How long have we been stalled? */
@@ -550,6 +775,9 @@ struct netplay
    /* Size of savestates (coremem_size + cheevos_size + headers) */
    size_t state_size;
    size_t coremem_size; /* core_serialize_special_size() */
+   /* Where the core state starts and where the blocks after it start */
+   size_t coremem_offset;
+   size_t coremem_end;
 #ifdef HAVE_CHEEVOS
    size_t cheevos_size; /* rcheevos_get_serialize_size() */
 #endif
@@ -714,14 +942,37 @@ struct netplay
    GGPOSession *ggpo;
    GGPOPlayerHandle ggpo_local_handle;
    GGPOPlayerHandle ggpo_remote_handle;
-   uint32_t ggpo_device_words[MAX_INPUT_DEVICES];
-   uint32_t ggpo_device_offsets[MAX_INPUT_DEVICES];
-   uint32_t ggpo_input_words;
+   struct netplay_ggpo_layout ggpo_layout[MAX_INPUT_DEVICES];
+   /* Joypad buttons the core has asked for one at a time, and those
+    * the layout sends or a warning has named */
+   uint32_t ggpo_buttons_read;
+   uint32_t ggpo_buttons_known;
    uint32_t ggpo_input_size;
    uint32_t ggpo_player_count;
    uint32_t ggpo_disconnect_flags;
    uint32_t ggpo_stall_frames;
+   /* Drift correction: permille of a frame owed to the peer; a frame is
+    * held each time it passes 1000. */
+   uint32_t ggpo_slew_debt;
    uint32_t ggpo_rollback_frames;
+   uint32_t ggpo_rollback_frames_seen;
+   uint32_t ggpo_rollbacks;
+   /* Headless resimulation: video frames and audio batches dropped while
+    * replaying, and what the live ones cost, for the saved-time estimate. */
+   uint32_t ggpo_replay_video_skipped;
+   uint32_t ggpo_replay_audio_skipped;
+   uint32_t ggpo_live_video_us;
+   uint32_t ggpo_live_audio_us;
+   uint64_t ggpo_replay_saved_us;
+   /* End of the last live frame, and a moving average (1/8) of how
+    * long after it local input was latched for the next */
+   retro_time_t ggpo_frame_end_time;
+   uint64_t ggpo_frame_end_count;
+   uint32_t ggpo_latch_us;
+   uint32_t ggpo_audio_crossfade_pos;
+   int16_t ggpo_audio_last[2];
+   struct netplay_ggpo_audio_splice ggpo_splice;
+   struct netplay_ggpo_delay ggpo_delay;
    uint32_t ggpo_local_player_index;
    uint32_t ggpo_remote_player_index;
    uint32_t ggpo_local_devices;
@@ -733,6 +984,17 @@ struct netplay
    uint32_t ggpo_state_save_samples;
    uint32_t ggpo_state_load_samples;
    uint32_t ggpo_state_size;
+   uint32_t ggpo_checksum_interval;
+   uint32_t ggpo_desyncs;
+   /* Replayed core_run time, and live frames towards the core profile */
+   uint64_t ggpo_replay_accum_us;
+   uint32_t ggpo_replay_samples;
+   uint32_t ggpo_profile_frames;
+   bool ggpo_profile_done;
+   struct netplay_ggpo_synctest *ggpo_synctest;
+   /* Confirmed frames played by a --netplay-spectate node */
+   uint64_t ggpo_spectator_frames;
+   retro_time_t ggpo_spectator_start;
    uint32_t ggpo_state_save_us;
    uint32_t ggpo_state_load_us;
    uint32_t ggpo_state_save_max_us;
@@ -749,6 +1011,14 @@ struct netplay
    uint32_t ggpo_compress_result_queue_max;
    bool ggpo_compress_stats_valid;
    bool ggpo_delta_stats_valid;
+   /* Cores with SET_SERIALIZE_DIRTY_INTERFACE: the last state GGPO saved
+    * or loaded is the core's dirty baseline while the serialize
+    * generation still matches */
+   uint8_t *ggpo_dirty_map;
+   GGPOStateRange *ggpo_dirty_ranges;
+   size_t ggpo_dirty_blocks;
+   uint32_t ggpo_dirty_generation;
+   bool ggpo_dirty_baseline;
    retro_time_t ggpo_state_log_time;
    uint16_t ggpo_base_port;
    uint16_t ggpo_peer_port;
@@ -760,10 +1030,46 @@ struct netplay
    int ggpo_relay_fd;
    struct addrinfo *ggpo_relay_addr;
    retro_time_t ggpo_relay_next_send;
+   struct netplay_ggpo_relay_candidate
+      ggpo_relay_candidates[NETPLAY_GGPO_RELAY_CANDIDATES];
+   struct addrinfo *ggpo_relay_rendezvous_addr;
+   retro_time_t ggpo_relay_deadline;
+   retro_time_t ggpo_relay_probe_sent;
+   enum netplay_ggpo_relay_stage ggpo_relay_stage;
+   uint32_t ggpo_relay_list_hash;
+   unsigned ggpo_relay_candidate_count;
+   unsigned ggpo_relay_probe_round;
+   /* In-flight lookups, and the finished ones not yet consumed */
+   struct netplay_ggpo_resolve *ggpo_resolve;
+   struct netplay_ggpo_resolve *ggpo_resolved;
+   retro_time_t ggpo_bringup_start;
+   retro_time_t ggpo_bringup_session_start;
+   uint32_t ggpo_bringup_resolve_us;
+   uint32_t ggpo_bringup_exchange_us;
+   uint32_t ggpo_bringup_state_us;
+   uint32_t ggpo_bringup_session_us;
+   uint32_t ggpo_bringup_sync_us;
+   enum netplay_ggpo_bringup ggpo_bringup;
+   /* When the client last asked to tunnel, and the connection the
+    * tunnelled session runs over */
+   retro_time_t ggpo_tunnel_asked;
+   size_t ggpo_tunnel_connection;
+   uint32_t ggpo_tunnel_dropped;
+   /* Registrations sent with the lobby's pairing token, until a server
+    * answers one or turns it down */
+   unsigned ggpo_token_sends;
+   bool ggpo_token_answered;
+   bool ggpo_token_dropped;
+   bool ggpo_bringup_token;
    bool ggpo_running;
+   /* The peer packs its input some other way */
+   bool ggpo_layout_mismatch;
    bool ggpo_in_rollback;
+   bool ggpo_spectator;
    bool ggpo_rendezvous_active;
    bool ggpo_relay_active;
+   bool ggpo_tunnel;
+   bool ggpo_tunnel_pending;
 #endif
 };
 
@@ -787,6 +1093,17 @@ bool netplay_send(struct socket_buffer *sbuf,
       int sockfd, const void *buf,
       size_t len);
 
+/**
+ * netplay_send_pair
+ *
+ * Queue a header and its payload for sending. When nothing is queued
+ * ahead of them, both go out in one gather write from the caller's
+ * buffers and only what the socket does not take is copied.
+ */
+bool netplay_send_pair(struct socket_buffer *sbuf, int sockfd,
+      const void *header, size_t header_len,
+      const void *payload, size_t payload_len);
+
 /**
  * netplay_send_flush
  *
@@ -808,6 +1125,16 @@ bool netplay_send_flush(struct socket_buffer *sbuf,
 ssize_t netplay_recv(struct socket_buffer *sbuf, int sockfd,
       void *buf, size_t len);
 
+/**
+ * netplay_recv_direct
+ *
+ * Like netplay_recv, but points *out at the data inside the buffer
+ * instead of copying it to buf when it is all there in one piece. *out
+ * is only valid until the next receive.
+ */
+ssize_t netplay_recv_direct(struct socket_buffer *sbuf, int sockfd,
+      void *buf, size_t len, const void **out);
+
 /**
  * netplay_recv_reset
  *
@@ -19,7 +19,7 @@
 #define __RARCH_NETPLAY_PROTOCOL_H
 
 #define LOW_NETPLAY_PROTOCOL_VERSION  5
-#define HIGH_NETPLAY_PROTOCOL_VERSION 8
+#define HIGH_NETPLAY_PROTOCOL_VERSION 10
 
 #define NETPLAY_PROTOCOL_VERSION HIGH_NETPLAY_PROTOCOL_VERSION
 
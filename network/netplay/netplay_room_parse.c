@@ -33,9 +33,20 @@ enum netplay_parse_state
    STATE_OBJECT_START,
    STATE_FIELDS_START,
    STATE_FIELDS_OBJECT_START,
+   STATE_REMOVED_START,
    STATE_END
 };
 
+/* Members of a versioned lobby list, {"version", "since", "records",
+ * "removed"}; older lobbies send the bare records array. */
+enum netplay_parse_root
+{
+   ROOT_NONE = 0,
+   ROOT_VERSION,
+   ROOT_SINCE,
+   ROOT_REMOVED
+};
+
 struct netplay_json_context
 {
    bool *cur_member_bool;
@@ -43,9 +54,36 @@ struct netplay_json_context
    int  *cur_member_inthex;
    char *cur_member_string;
    size_t cur_member_size;
+   struct netplay_rooms *rooms;
    enum netplay_parse_state state;
+   enum netplay_parse_root root_member;
+   /* Rooms this client can never join are dropped as they are parsed */
+   bool filter;
+   struct netplay_room *prev;
+};
+
+struct netplay_rooms_parser
+{
+   struct netplay_json_context ctx;
+   rjson_t *json;
 };
 
+static bool netplay_rooms_add_removed(struct netplay_rooms *rooms, int id)
+{
+   if (rooms->removed_count >= rooms->removed_size)
+   {
+      size_t size  = rooms->removed_size ? rooms->removed_size * 2 : 16;
+      int *removed = (int*)realloc(rooms->removed, size * sizeof(*removed));
+
+      if (!removed)
+         return false;
+      rooms->removed      = removed;
+      rooms->removed_size = size;
+   }
+   rooms->removed[rooms->removed_count++] = id;
+   return true;
+}
+
 static bool netplay_json_boolean(void* ctx, bool value)
 {
    struct netplay_json_context* p_ctx = (struct netplay_json_context*)ctx;
@@ -61,7 +99,15 @@ static bool netplay_json_string(void* ctx, const char *p_value, size_t len)
 {
    struct netplay_json_context* p_ctx = (struct netplay_json_context*)ctx;
 
-   if (p_ctx->state == STATE_FIELDS_OBJECT_START)
+   if (p_ctx->state == STATE_START && p_value)
+   {
+      if (p_ctx->root_member == ROOT_VERSION)
+         strlcpy(p_ctx->rooms->version, p_value,
+               sizeof(p_ctx->rooms->version));
+      else if (p_ctx->root_member == ROOT_SINCE)
+         p_ctx->rooms->delta = true;
+   }
+   else if (p_ctx->state == STATE_FIELDS_OBJECT_START)
    {
       if (p_value && len)
       {
@@ -87,6 +133,12 @@ static bool netplay_json_number(void* ctx, const char *p_value, size_t len)
          if (p_ctx->cur_member_int)
             *p_ctx->cur_member_int = (int)strtol(p_value, NULL, 10);
    }
+   else if (p_ctx->state == STATE_REMOVED_START)
+   {
+      if (p_value && len)
+         return netplay_rooms_add_removed(p_ctx->rooms,
+               (int)strtol(p_value, NULL, 10));
+   }
 
    return true;
 }
@@ -94,25 +146,26 @@ static bool netplay_json_number(void* ctx, const char *p_value, size_t len)
 static bool netplay_json_start_object(void* ctx)
 {
    struct netplay_json_context *p_ctx = (struct netplay_json_context*)ctx;
-   net_driver_state_t         *net_st = networking_state_get_ptr();
 
    if (p_ctx->state == STATE_FIELDS_START)
    {
       p_ctx->state = STATE_FIELDS_OBJECT_START;
 
-      if (!net_st->rooms_data->head)
+      if (!p_ctx->rooms->head)
       {
-         net_st->rooms_data->head      = (struct netplay_room*)calloc(1, sizeof(*net_st->rooms_data->head));
-         net_st->rooms_data->cur       = net_st->rooms_data->head;
+         p_ctx->rooms->head      = (struct netplay_room*)calloc(1, sizeof(*p_ctx->rooms->head));
+         p_ctx->prev             = NULL;
+         p_ctx->rooms->cur       = p_ctx->rooms->head;
       }
-      else if (!net_st->rooms_data->cur->next)
+      else if (!p_ctx->rooms->cur->next)
       {
-         net_st->rooms_data->cur->next = (struct netplay_room*)calloc(1, sizeof(*net_st->rooms_data->cur->next));
-         net_st->rooms_data->cur       = net_st->rooms_data->cur->next;
+         p_ctx->rooms->cur->next = (struct netplay_room*)calloc(1, sizeof(*p_ctx->rooms->cur->next));
+         p_ctx->prev             = p_ctx->rooms->cur;
+         p_ctx->rooms->cur       = p_ctx->rooms->cur->next;
       }
 
-      net_st->rooms_data->cur->connectable  = true;
-      net_st->rooms_data->cur->is_retroarch = true;
+      p_ctx->rooms->cur->connectable  = true;
+      p_ctx->rooms->cur->is_retroarch = true;
    }
    else if (p_ctx->state == STATE_ARRAY_START)
       p_ctx->state = STATE_OBJECT_START;
@@ -125,8 +178,28 @@ static bool netplay_json_end_object(void* ctx)
    struct netplay_json_context *p_ctx = (struct netplay_json_context*)ctx;
 
    if (p_ctx->state == STATE_FIELDS_OBJECT_START)
+   {
+      struct netplay_room *room = p_ctx->rooms->cur;
+
       p_ctx->state = STATE_ARRAY_START;
 
+      /* Drop a room this client can never join right away, listing it as
+       * removed so an older copy from a previous list does not linger. */
+      if (     p_ctx->filter
+            && (!room->is_retroarch
+               || !netplay_compatible_version(room->retroarch_version)))
+      {
+         if (room->id)
+            netplay_rooms_add_removed(p_ctx->rooms, room->id);
+         if (p_ctx->prev)
+            p_ctx->prev->next = NULL;
+         else
+            p_ctx->rooms->head = NULL;
+         p_ctx->rooms->cur = p_ctx->prev;
+         free(room);
+      }
+   }
+
    return true;
 }
 
@@ -134,11 +207,22 @@ static bool netplay_json_object_member(void *ctx, const char *p_value,
       size_t len)
 {
    struct netplay_json_context* p_ctx = (struct netplay_json_context*)ctx;
-   net_driver_state_t         *net_st = networking_state_get_ptr();
 
    if (!p_value || !len)
       return true;
 
+   if (p_ctx->state == STATE_START)
+   {
+      if (string_is_equal(p_value, "version"))
+         p_ctx->root_member = ROOT_VERSION;
+      else if (string_is_equal(p_value, "since"))
+         p_ctx->root_member = ROOT_SINCE;
+      else if (string_is_equal(p_value, "removed"))
+         p_ctx->root_member = ROOT_REMOVED;
+      else
+         p_ctx->root_member = ROOT_NONE;
+   }
+
    if (p_ctx->state == STATE_OBJECT_START && !string_is_empty(p_value)
          && string_is_equal(p_value, "fields"))
       p_ctx->state = STATE_FIELDS_START;
@@ -152,115 +236,122 @@ static bool netplay_json_object_member(void *ctx, const char *p_value,
 
       if (!string_is_empty(p_value))
       {
-         if (string_is_equal(p_value, "username"))
+         if (string_is_equal(p_value, "id"))
+            p_ctx->cur_member_int    = &p_ctx->rooms->cur->id;
+         else if (string_is_equal(p_value, "username"))
          {
-            p_ctx->cur_member_string = net_st->rooms_data->cur->nickname;
-            p_ctx->cur_member_size   = sizeof(net_st->rooms_data->cur->nickname);
+            p_ctx->cur_member_string = p_ctx->rooms->cur->nickname;
+            p_ctx->cur_member_size   = sizeof(p_ctx->rooms->cur->nickname);
          }
          else if (string_is_equal(p_value, "game_name"))
          {
-            p_ctx->cur_member_string = net_st->rooms_data->cur->gamename;
-            p_ctx->cur_member_size   = sizeof(net_st->rooms_data->cur->gamename);
+            p_ctx->cur_member_string = p_ctx->rooms->cur->gamename;
+            p_ctx->cur_member_size   = sizeof(p_ctx->rooms->cur->gamename);
          }
          else if (string_is_equal(p_value, "core_name"))
          {
-            p_ctx->cur_member_string = net_st->rooms_data->cur->corename;
-            p_ctx->cur_member_size   = sizeof(net_st->rooms_data->cur->corename);
+            p_ctx->cur_member_string = p_ctx->rooms->cur->corename;
+            p_ctx->cur_member_size   = sizeof(p_ctx->rooms->cur->corename);
          }
          else if (string_is_equal(p_value, "ip"))
          {
-            p_ctx->cur_member_string = net_st->rooms_data->cur->address;
-            p_ctx->cur_member_size   = sizeof(net_st->rooms_data->cur->address);
+            p_ctx->cur_member_string = p_ctx->rooms->cur->address;
+            p_ctx->cur_member_size   = sizeof(p_ctx->rooms->cur->address);
          }
          else if (string_is_equal(p_value, "port"))
-            p_ctx->cur_member_int    = &net_st->rooms_data->cur->port;
+            p_ctx->cur_member_int    = &p_ctx->rooms->cur->port;
          else if (string_is_equal(p_value, "game_crc"))
-            p_ctx->cur_member_inthex = &net_st->rooms_data->cur->gamecrc;
+            p_ctx->cur_member_inthex = &p_ctx->rooms->cur->gamecrc;
          else if (string_is_equal(p_value, "core_version"))
          {
-            p_ctx->cur_member_string = net_st->rooms_data->cur->coreversion;
-            p_ctx->cur_member_size   = sizeof(net_st->rooms_data->cur->coreversion);
+            p_ctx->cur_member_string = p_ctx->rooms->cur->coreversion;
+            p_ctx->cur_member_size   = sizeof(p_ctx->rooms->cur->coreversion);
          }
          else if (string_is_equal(p_value, "has_password"))
-            p_ctx->cur_member_bool   = &net_st->rooms_data->cur->has_password;
+            p_ctx->cur_member_bool   = &p_ctx->rooms->cur->has_password;
          else if (string_is_equal(p_value, "has_spectate_password"))
-            p_ctx->cur_member_bool   = &net_st->rooms_data->cur->has_spectate_password;
+            p_ctx->cur_member_bool   = &p_ctx->rooms->cur->has_spectate_password;
          else if (string_is_equal(p_value, "mitm_ip"))
          {
-            p_ctx->cur_member_string = net_st->rooms_data->cur->mitm_address;
-            p_ctx->cur_member_size   = sizeof(net_st->rooms_data->cur->mitm_address);
+            p_ctx->cur_member_string = p_ctx->rooms->cur->mitm_address;
+            p_ctx->cur_member_size   = sizeof(p_ctx->rooms->cur->mitm_address);
          }
          else if (string_is_equal(p_value, "mitm_port"))
-            p_ctx->cur_member_int    = &net_st->rooms_data->cur->mitm_port;
+            p_ctx->cur_member_int    = &p_ctx->rooms->cur->mitm_port;
          else if (string_is_equal(p_value, "mitm_session"))
          {
-            p_ctx->cur_member_string = net_st->rooms_data->cur->mitm_session;
-            p_ctx->cur_member_size   = sizeof(net_st->rooms_data->cur->mitm_session);
+            p_ctx->cur_member_string = p_ctx->rooms->cur->mitm_session;
+            p_ctx->cur_member_size   = sizeof(p_ctx->rooms->cur->mitm_session);
          }
          else if (string_is_equal(p_value, "rendezvous_server"))
          {
-            p_ctx->cur_member_string = net_st->rooms_data->cur->rendezvous_server;
-            p_ctx->cur_member_size   = sizeof(net_st->rooms_data->cur->rendezvous_server);
+            p_ctx->cur_member_string = p_ctx->rooms->cur->rendezvous_server;
+            p_ctx->cur_member_size   = sizeof(p_ctx->rooms->cur->rendezvous_server);
          }
          else if (string_is_equal(p_value, "rendezvous_room"))
          {
-            p_ctx->cur_member_string = net_st->rooms_data->cur->rendezvous_room;
-            p_ctx->cur_member_size   = sizeof(net_st->rooms_data->cur->rendezvous_room);
+            p_ctx->cur_member_string = p_ctx->rooms->cur->rendezvous_room;
+            p_ctx->cur_member_size   = sizeof(p_ctx->rooms->cur->rendezvous_room);
          }
          else if (string_is_equal(p_value, "rendezvous_port"))
-            p_ctx->cur_member_int    = &net_st->rooms_data->cur->rendezvous_port;
+            p_ctx->cur_member_int    = &p_ctx->rooms->cur->rendezvous_port;
          else if (string_is_equal(p_value, "ggpo_relay_server"))
          {
-            p_ctx->cur_member_string = net_st->rooms_data->cur->ggpo_relay_server;
-            p_ctx->cur_member_size   = sizeof(net_st->rooms_data->cur->ggpo_relay_server);
+            p_ctx->cur_member_string = p_ctx->rooms->cur->ggpo_relay_server;
+            p_ctx->cur_member_size   = sizeof(p_ctx->rooms->cur->ggpo_relay_server);
          }
          else if (string_is_equal(p_value, "ggpo_relay_session"))
          {
-            p_ctx->cur_member_string = net_st->rooms_data->cur->ggpo_relay_session;
-            p_ctx->cur_member_size   = sizeof(net_st->rooms_data->cur->ggpo_relay_session);
+            p_ctx->cur_member_string = p_ctx->rooms->cur->ggpo_relay_session;
+            p_ctx->cur_member_size   = sizeof(p_ctx->rooms->cur->ggpo_relay_session);
          }
          else if (string_is_equal(p_value, "ggpo_relay_port"))
-            p_ctx->cur_member_int    = &net_st->rooms_data->cur->ggpo_relay_port;
+            p_ctx->cur_member_int    = &p_ctx->rooms->cur->ggpo_relay_port;
+         else if (string_is_equal(p_value, "ggpo_relays"))
+         {
+            p_ctx->cur_member_string = p_ctx->rooms->cur->ggpo_relays;
+            p_ctx->cur_member_size   = sizeof(p_ctx->rooms->cur->ggpo_relays);
+         }
          else if (string_is_equal(p_value, "host_method"))
-            p_ctx->cur_member_int    = &net_st->rooms_data->cur->host_method;
+            p_ctx->cur_member_int    = &p_ctx->rooms->cur->host_method;
          else if (string_is_equal(p_value, "ggpo"))
-            p_ctx->cur_member_bool   = &net_st->rooms_data->cur->ggpo;
+            p_ctx->cur_member_bool   = &p_ctx->rooms->cur->ggpo;
          else if (string_is_equal(p_value, "use_rendezvous"))
-            p_ctx->cur_member_bool   = &net_st->rooms_data->cur->use_rendezvous;
+            p_ctx->cur_member_bool   = &p_ctx->rooms->cur->use_rendezvous;
          else if (string_is_equal(p_value, "rendezvous"))
-            p_ctx->cur_member_bool   = &net_st->rooms_data->cur->use_rendezvous;
+            p_ctx->cur_member_bool   = &p_ctx->rooms->cur->use_rendezvous;
          else if (string_is_equal(p_value, "use_ggpo_relay"))
-            p_ctx->cur_member_bool   = &net_st->rooms_data->cur->use_ggpo_relay;
+            p_ctx->cur_member_bool   = &p_ctx->rooms->cur->use_ggpo_relay;
          else if (string_is_equal(p_value, "ggpo_relay"))
-            p_ctx->cur_member_bool   = &net_st->rooms_data->cur->use_ggpo_relay;
+            p_ctx->cur_member_bool   = &p_ctx->rooms->cur->use_ggpo_relay;
          else if (string_is_equal(p_value, "retroarch_version"))
          {
-            p_ctx->cur_member_string = net_st->rooms_data->cur->retroarch_version;
-            p_ctx->cur_member_size   = sizeof(net_st->rooms_data->cur->retroarch_version);
+            p_ctx->cur_member_string = p_ctx->rooms->cur->retroarch_version;
+            p_ctx->cur_member_size   = sizeof(p_ctx->rooms->cur->retroarch_version);
          }
          else if (string_is_equal(p_value, "country"))
          {
-            p_ctx->cur_member_string = net_st->rooms_data->cur->country;
-            p_ctx->cur_member_size   = sizeof(net_st->rooms_data->cur->country);
+            p_ctx->cur_member_string = p_ctx->rooms->cur->country;
+            p_ctx->cur_member_size   = sizeof(p_ctx->rooms->cur->country);
          }
          else if (string_is_equal(p_value, "frontend"))
          {
-            p_ctx->cur_member_string = net_st->rooms_data->cur->frontend;
-            p_ctx->cur_member_size   = sizeof(net_st->rooms_data->cur->frontend);
+            p_ctx->cur_member_string = p_ctx->rooms->cur->frontend;
+            p_ctx->cur_member_size   = sizeof(p_ctx->rooms->cur->frontend);
          }
          else if (string_is_equal(p_value, "subsystem_name"))
          {
-            p_ctx->cur_member_string = net_st->rooms_data->cur->subsystem_name;
-            p_ctx->cur_member_size   = sizeof(net_st->rooms_data->cur->subsystem_name);
+            p_ctx->cur_member_string = p_ctx->rooms->cur->subsystem_name;
+            p_ctx->cur_member_size   = sizeof(p_ctx->rooms->cur->subsystem_name);
          }
          else if (string_is_equal(p_value, "connectable"))
-            p_ctx->cur_member_bool   = &net_st->rooms_data->cur->connectable;
+            p_ctx->cur_member_bool   = &p_ctx->rooms->cur->connectable;
          else if (string_is_equal(p_value, "is_retroarch"))
-            p_ctx->cur_member_bool   = &net_st->rooms_data->cur->is_retroarch;
+            p_ctx->cur_member_bool   = &p_ctx->rooms->cur->is_retroarch;
          else if (string_is_equal(p_value, "player_count"))
-            p_ctx->cur_member_int    = &net_st->rooms_data->cur->player_count;
+            p_ctx->cur_member_int    = &p_ctx->rooms->cur->player_count;
          else if (string_is_equal(p_value, "spectator_count"))
-            p_ctx->cur_member_int    = &net_st->rooms_data->cur->spectator_count;
+            p_ctx->cur_member_int    = &p_ctx->rooms->cur->spectator_count;
       }
    }
 
@@ -272,7 +363,23 @@ static bool netplay_json_start_array(void* ctx)
    struct netplay_json_context* p_ctx = (struct netplay_json_context*)ctx;
 
    if (p_ctx->state == STATE_START)
-      p_ctx->state = STATE_ARRAY_START;
+      p_ctx->state = (p_ctx->root_member == ROOT_REMOVED)
+         ? STATE_REMOVED_START
+         : STATE_ARRAY_START;
+
+   return true;
+}
+
+static bool netplay_json_end_array(void* ctx)
+{
+   struct netplay_json_context* p_ctx = (struct netplay_json_context*)ctx;
+
+   if (     p_ctx->state == STATE_ARRAY_START
+         || p_ctx->state == STATE_REMOVED_START)
+   {
+      p_ctx->state       = STATE_START;
+      p_ctx->root_member = ROOT_NONE;
+   }
 
    return true;
 }
@@ -284,26 +391,31 @@ static void netplay_rooms_err(void *context,
          line, col, err);
 }
 
-void netplay_rooms_free(void)
+void netplay_rooms_data_free(struct netplay_rooms *rooms)
 {
-   net_driver_state_t         *net_st = networking_state_get_ptr();
-   if (net_st->rooms_data)
-   {
-      struct netplay_room *room = net_st->rooms_data->head;
+   struct netplay_room *room;
 
-      if (room)
-      {
-         while (room)
-         {
-            struct netplay_room *next = room->next;
+   if (!rooms)
+      return;
 
-            free(room);
-            room = next;
-         }
-      }
+   room = rooms->head;
+   while (room)
+   {
+      struct netplay_room *next = room->next;
 
-      free(net_st->rooms_data);
+      free(room);
+      room = next;
    }
+
+   free(rooms->removed);
+   free(rooms);
+}
+
+void netplay_rooms_free(void)
+{
+   net_driver_state_t         *net_st = networking_state_get_ptr();
+
+   netplay_rooms_data_free(net_st->rooms_data);
    net_st->rooms_data = NULL;
 }
 
@@ -321,6 +433,9 @@ int netplay_rooms_parse(const char *buf, size_t len)
 
    net_st->rooms_data = (struct netplay_rooms*)
       calloc(1, sizeof(*net_st->rooms_data));
+   ctx.rooms          = net_st->rooms_data;
+   if (!ctx.rooms)
+      return -1;
 
    rjson_parse_quick(buf, len, &ctx, 0,
          netplay_json_object_member,
@@ -329,7 +444,7 @@ int netplay_rooms_parse(const char *buf, size_t len)
          netplay_json_start_object,
          netplay_json_end_object,
          netplay_json_start_array,
-         NULL /* end_array_handler */,
+         netplay_json_end_array,
          netplay_json_boolean,
          NULL /* null handler */,
          netplay_rooms_err);
@@ -337,6 +452,123 @@ int netplay_rooms_parse(const char *buf, size_t len)
    return 0;
 }
 
+struct netplay_rooms_parser *netplay_rooms_parser_new(const char *buf,
+      size_t len, bool filter)
+{
+   struct netplay_rooms_parser *parser = (struct netplay_rooms_parser*)
+      calloc(1, sizeof(*parser));
+
+   if (!parser)
+      return NULL;
+
+   parser->ctx.state  = STATE_START;
+   parser->ctx.filter = filter;
+   parser->ctx.rooms  = (struct netplay_rooms*)
+      calloc(1, sizeof(*parser->ctx.rooms));
+   parser->json       = rjson_open_buffer(buf, len);
+
+   if (!parser->ctx.rooms || !parser->json)
+   {
+      netplay_rooms_parser_free(parser);
+      return NULL;
+   }
+
+   return parser;
+}
+
+/**
+ * netplay_rooms_parser_step
+ * @parser               : parser from netplay_rooms_parser_new.
+ * @events               : JSON elements to parse before returning.
+ *
+ * Parses the next few elements of the room list, so a task can spread a
+ * large list over several iterations.
+ *
+ * Returns: 1 once the list is parsed, 0 if there is more, -1 on error.
+ **/
+int netplay_rooms_parser_step(struct netplay_rooms_parser *parser,
+      unsigned events)
+{
+   void *ctx = &parser->ctx;
+
+   while (events--)
+   {
+      size_t _len;
+      const char *str;
+      bool ok = true;
+
+      switch (rjson_next(parser->json))
+      {
+         case RJSON_STRING:
+            str = rjson_get_string(parser->json, &_len);
+            if (     rjson_get_context_type(parser->json) == RJSON_OBJECT
+                  && (rjson_get_context_count(parser->json) & 1))
+               ok = netplay_json_object_member(ctx, str, _len);
+            else
+               ok = netplay_json_string(ctx, str, _len);
+            break;
+         case RJSON_NUMBER:
+            str = rjson_get_string(parser->json, &_len);
+            ok  = netplay_json_number(ctx, str, _len);
+            break;
+         case RJSON_OBJECT:
+            ok = netplay_json_start_object(ctx);
+            break;
+         case RJSON_OBJECT_END:
+            ok = netplay_json_end_object(ctx);
+            break;
+         case RJSON_ARRAY:
+            ok = netplay_json_start_array(ctx);
+            break;
+         case RJSON_ARRAY_END:
+            ok = netplay_json_end_array(ctx);
+            break;
+         case RJSON_TRUE:
+            ok = netplay_json_boolean(ctx, true);
+            break;
+         case RJSON_FALSE:
+            ok = netplay_json_boolean(ctx, false);
+            break;
+         case RJSON_NULL:
+            break;
+         case RJSON_DONE:
+            return 1;
+         case RJSON_ERROR:
+         default:
+            netplay_rooms_err(ctx,
+                  (int)rjson_get_source_line(parser->json),
+                  (int)rjson_get_source_column(parser->json),
+                  rjson_get_error(parser->json));
+            return -1;
+      }
+
+      if (!ok)
+         return -1;
+   }
+
+   return 0;
+}
+
+/* Hands over the parsed rooms; free them with netplay_rooms_data_free. */
+struct netplay_rooms *netplay_rooms_parser_take(
+      struct netplay_rooms_parser *parser)
+{
+   struct netplay_rooms *rooms = parser->ctx.rooms;
+
+   parser->ctx.rooms = NULL;
+   return rooms;
+}
+
+void netplay_rooms_parser_free(struct netplay_rooms_parser *parser)
+{
+   if (!parser)
+      return;
+   if (parser->json)
+      rjson_free(parser->json);
+   netplay_rooms_data_free(parser->ctx.rooms);
+   free(parser);
+}
+
 struct netplay_room* netplay_room_get(int index)
 {
    int                    cur = 0;
@@ -378,3 +610,87 @@ int netplay_rooms_get_count(void)
 
    return count;
 }
+
+static bool netplay_rooms_removed(const struct netplay_rooms *rooms, int id)
+{
+   size_t i;
+
+   for (i = 0; i < rooms->removed_count; i++)
+      if (rooms->removed[i] == id)
+         return true;
+
+   return false;
+}
+
+/**
+ * netplay_rooms_merge_lobby
+ * @data                 : rooms parsed from a lobby list.
+ *
+ * Folds the parsed list into the lobby rooms kept between refreshes.
+ * A full list replaces them; a delta replaces changed rooms in place,
+ * appends new ones and drops removed ones.
+ *
+ * Returns: the number of lobby rooms.
+ **/
+int netplay_rooms_merge_lobby(const struct netplay_rooms *data)
+{
+   int i;
+   int count                  = 0;
+   int parsed                 = 0;
+   struct netplay_room *room  = NULL;
+   struct netplay_room *rooms = NULL;
+   net_driver_state_t *net_st = networking_state_get_ptr();
+
+   if (!data)
+      return net_st->lobby_room_count;
+
+   if (!data->delta)
+   {
+      free(net_st->lobby_rooms);
+      net_st->lobby_rooms      = NULL;
+      net_st->lobby_room_count = 0;
+   }
+
+   for (room = data->head; room; room = room->next)
+      parsed++;
+
+   if (net_st->lobby_room_count + parsed > 0)
+   {
+      rooms = (struct netplay_room*)malloc(
+            (net_st->lobby_room_count + parsed) * sizeof(*rooms));
+      if (!rooms)
+         return net_st->lobby_room_count;
+   }
+
+   for (i = 0; i < net_st->lobby_room_count; i++)
+   {
+      struct netplay_room *kept = &net_st->lobby_rooms[i];
+
+      if (netplay_rooms_removed(data, kept->id))
+         continue;
+      for (room = data->head; room; room = room->next)
+         if (room->id == kept->id)
+            break;
+      memcpy(&rooms[count], room ? room : kept, sizeof(*rooms));
+      rooms[count++].next = NULL;
+   }
+
+   for (room = data->head; room; room = room->next)
+   {
+      for (i = 0; i < net_st->lobby_room_count; i++)
+         if (net_st->lobby_rooms[i].id == room->id)
+            break;
+      if (i < net_st->lobby_room_count)
+         continue;
+      memcpy(&rooms[count], room, sizeof(*rooms));
+      rooms[count++].next = NULL;
+   }
+
+   free(net_st->lobby_rooms);
+   net_st->lobby_rooms      = rooms;
+   net_st->lobby_room_count = count;
+   strlcpy(net_st->lobby_version, data->version,
+         sizeof(net_st->lobby_version));
+
+   return count;
+}
@@ -160,7 +160,8 @@ DEFINES += -DHAVE_VULKAN \
 endif
 DEFINES += -DHAVE_7ZIP \
 	   -D_7ZIP_ST \
-	   -DHAVE_SL
+	   -DHAVE_SL \
+	   -DHAVE_AAUDIO
 
 ifeq ($(HAVE_CHEEVOS),1)
 DEFINES += -DHAVE_CHEEVOS \
@@ -15,6 +15,7 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
@@ -25,11 +26,21 @@
 #include <compat/posix_string.h>
 #include <string/stdstring.h>
 #include <streams/interface_stream.h>
+#include <streams/file_stream.h>
 #include <file/file_path.h>
+#include <file/file_write_atomic.h>
 #include <file/archive_file.h>
 #include <lists/string_list.h>
 #include <formats/rjson.h>
 #include <array/rbuf.h>
+#include <encodings/crc32.h>
+
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #include "playlist.h"
 #include "verbosity.h"
@@ -69,6 +80,28 @@ enum content_playlist_flags
    CNT_PLAYLIST_FLG_CACHED_EXT = (1 << 3)
 };
 
+enum playlist_index_key
+{
+   PLAYLIST_INDEX_PATH = 0,
+   /* Parent archive of an entry inside one, or the archive
+    * itself, for fuzzy archive matching */
+   PLAYLIST_INDEX_ARCHIVE,
+   PLAYLIST_INDEX_CRC,
+   PLAYLIST_INDEX_LABEL,
+   PLAYLIST_INDEX_COUNT
+};
+
+typedef struct
+{
+   size_t *heads;
+   size_t *next;
+   uint32_t *hashes;
+   size_t mask;
+   size_t base;
+   size_t size;
+   size_t capacity;
+} playlist_index_t;
+
 struct content_playlist
 {
    char *default_core_path;
@@ -79,6 +112,7 @@ struct content_playlist
 
    playlist_manual_scan_record_t scan_record; /* ptr alignment */
    playlist_config_t config;                  /* size_t alignment */
+   playlist_index_t index[PLAYLIST_INDEX_COUNT]; /* size_t alignment */
 
    enum playlist_label_display_mode label_display_mode;
    enum playlist_thumbnail_mode right_thumbnail_mode;
@@ -86,6 +120,9 @@ struct content_playlist
    enum playlist_thumbnail_match_mode thumbnail_match_mode;
    enum playlist_sort_mode sort_mode;
 
+   /* Records in the journal, see playlist_journal_append() */
+   unsigned journal_records;
+
    uint8_t flags;
 };
 
@@ -537,6 +574,481 @@ static bool playlist_core_path_equal(const char *real_core_path,
    return false;
 }
 
+/* Lazily built hash indexes over the entries, one per key. Each
+ * is a chained table: 'heads' holds the slot + 1 of the first
+ * entry in a bucket, 'next' that of the following entry in the
+ * same bucket, 0 ending a chain. A bucket can hold unrelated
+ * entries whose hashes collide, so every candidate is compared in
+ * full before it is taken.
+ * Slots count up from the last entry, so that pushing an entry
+ * to the top takes a fresh slot and dropping the last one only
+ * moves 'base', without renumbering the rest. */
+static void playlist_index_free(playlist_index_t *index)
+{
+   free(index->heads);
+   free(index->next);
+   free(index->hashes);
+   memset(index, 0, sizeof(*index));
+}
+
+static void playlist_index_clear(playlist_t *playlist)
+{
+   unsigned key;
+   for (key = 0; key < PLAYLIST_INDEX_COUNT; key++)
+      playlist_index_free(&playlist->index[key]);
+}
+
+static size_t playlist_index_slot(const playlist_index_t *index,
+      size_t idx)
+{
+   return index->base + index->size - 1 - idx;
+}
+
+/* Returns false if the entry could not be hashed (out of memory);
+ * a hash of 0 leaves the entry out of the index */
+static bool playlist_index_hash(enum playlist_index_key key,
+      struct playlist_entry *entry, uint32_t *hash)
+{
+   *hash = 0;
+
+   switch (key)
+   {
+      case PLAYLIST_INDEX_PATH:
+      case PLAYLIST_INDEX_ARCHIVE:
+         if (!entry->path_id)
+         {
+            if (!(entry->path_id = playlist_path_id_init(entry->path)))
+               return false;
+         }
+         if (string_is_empty(entry->path_id->real_path))
+            break;
+         if (key == PLAYLIST_INDEX_PATH)
+            *hash = entry->path_id->real_path_hash;
+         else if (!string_is_empty(entry->path_id->archive_path))
+            *hash = entry->path_id->archive_path_hash;
+         break;
+      case PLAYLIST_INDEX_CRC:
+         if (!string_is_empty(entry->crc32))
+            *hash = playlist_path_hash(entry->crc32);
+         break;
+      case PLAYLIST_INDEX_LABEL:
+         if (!string_is_empty(entry->label))
+            *hash = playlist_path_hash(entry->label);
+         break;
+      default:
+         break;
+   }
+
+   return true;
+}
+
+static void playlist_index_link(playlist_index_t *index, size_t slot,
+      uint32_t hash)
+{
+   size_t *head;
+
+   index->hashes[slot] = hash;
+   index->next[slot]   = 0;
+
+   if (!hash)
+      return;
+
+   head                = &index->heads[hash & index->mask];
+   index->next[slot]   = *head;
+   *head               = slot + 1;
+}
+
+static void playlist_index_unlink(playlist_index_t *index, size_t slot)
+{
+   size_t *link;
+
+   if (!index->hashes[slot])
+      return;
+
+   link = &index->heads[index->hashes[slot] & index->mask];
+   while (*link && (*link != slot + 1))
+      link = &index->next[*link - 1];
+   if (*link)
+      *link = index->next[slot];
+}
+
+static size_t playlist_index_relabel(size_t link, size_t from, size_t to)
+{
+   if (!link)
+      return 0;
+   if (link - 1 == from)
+      return to + 1;
+   if (link - 1 > from && link - 1 <= to)
+      return link - 1;
+   return link;
+}
+
+/* Follows the entry in slot 'from' moving up to slot 'to', the
+ * ones in between moving down by one to make room */
+static void playlist_index_move(playlist_index_t *index,
+      size_t from, size_t to)
+{
+   size_t i;
+   size_t next;
+   uint32_t hash;
+
+   if (from == to)
+      return;
+
+   for (i = 0; i <= index->mask; i++)
+      index->heads[i] = playlist_index_relabel(index->heads[i], from, to);
+   for (i = index->base; i < index->base + index->size; i++)
+      index->next[i]  = playlist_index_relabel(index->next[i], from, to);
+
+   next = index->next[from];
+   hash = index->hashes[from];
+
+   memmove(index->next + from, index->next + from + 1,
+         (to - from) * sizeof(*index->next));
+   memmove(index->hashes + from, index->hashes + from + 1,
+         (to - from) * sizeof(*index->hashes));
+
+   index->next[to]   = next;
+   index->hashes[to] = hash;
+}
+
+/* Returns the index for 'key', building it if need be, or NULL
+ * if it could not be built */
+static playlist_index_t *playlist_index_get(playlist_t *playlist,
+      enum playlist_index_key key)
+{
+   size_t i;
+   size_t capacity;
+   playlist_index_t *index = &playlist->index[key];
+   size_t _len             = RBUF_LEN(playlist->entries);
+
+   if (index->heads && index->size == _len)
+      return index;
+
+   playlist_index_free(index);
+
+   /* Leave room to grow, so that pushes do not rebuild */
+   for (capacity = 64; capacity < _len * 2; capacity <<= 1);
+
+   index->heads  = (size_t*)calloc(capacity, sizeof(*index->heads));
+   index->next   = (size_t*)malloc(capacity * sizeof(*index->next));
+   index->hashes = (uint32_t*)malloc(capacity * sizeof(*index->hashes));
+
+   if (!index->heads || !index->next || !index->hashes)
+      goto error;
+
+   index->mask     = capacity - 1;
+   index->capacity = capacity;
+   index->size     = _len;
+
+   for (i = 0; i < _len; i++)
+   {
+      uint32_t hash;
+      if (!playlist_index_hash(key, &playlist->entries[i], &hash))
+         goto error;
+      playlist_index_link(index, playlist_index_slot(index, i), hash);
+   }
+
+   return index;
+
+error:
+   playlist_index_free(index);
+   return NULL;
+}
+
+/* Entry 0 has just been inserted, the others shifted down by one */
+static void playlist_index_push_front(playlist_t *playlist)
+{
+   unsigned key;
+
+   for (key = 0; key < PLAYLIST_INDEX_COUNT; key++)
+   {
+      uint32_t hash;
+      playlist_index_t *index = &playlist->index[key];
+
+      if (!index->heads)
+         continue;
+
+      /* Out of slots, or out of step: rebuild on the next lookup */
+      if (     (index->base + index->size + 1 > index->capacity)
+            || (index->size + 1 != RBUF_LEN(playlist->entries))
+            || !playlist_index_hash((enum playlist_index_key)key,
+                  &playlist->entries[0], &hash))
+      {
+         playlist_index_free(index);
+         continue;
+      }
+
+      playlist_index_link(index, index->base + index->size++, hash);
+   }
+}
+
+/* Entry 'idx' is about to be removed */
+static void playlist_index_remove(playlist_t *playlist, size_t idx)
+{
+   unsigned key;
+
+   for (key = 0; key < PLAYLIST_INDEX_COUNT; key++)
+   {
+      size_t slot;
+      playlist_index_t *index = &playlist->index[key];
+
+      if (!index->heads)
+         continue;
+
+      if (idx >= index->size)
+      {
+         playlist_index_free(index);
+         continue;
+      }
+
+      slot = playlist_index_slot(index, idx);
+      playlist_index_unlink(index, slot);
+
+      if (slot == index->base)
+         index->base++;
+      else
+         playlist_index_move(index, slot, index->base + index->size - 1);
+      index->size--;
+   }
+}
+
+/* Entry 'idx' is about to be bumped to the top */
+static void playlist_index_move_front(playlist_t *playlist, size_t idx)
+{
+   unsigned key;
+
+   for (key = 0; key < PLAYLIST_INDEX_COUNT; key++)
+   {
+      playlist_index_t *index = &playlist->index[key];
+
+      if (!index->heads)
+         continue;
+
+      if (idx >= index->size)
+         playlist_index_free(index);
+      else
+         playlist_index_move(index, playlist_index_slot(index, idx),
+               index->base + index->size - 1);
+   }
+}
+
+/* The keys of entry 'idx' have changed */
+static void playlist_index_update(playlist_t *playlist, size_t idx)
+{
+   unsigned key;
+
+   for (key = 0; key < PLAYLIST_INDEX_COUNT; key++)
+   {
+      size_t slot;
+      uint32_t hash;
+      playlist_index_t *index = &playlist->index[key];
+
+      if (!index->heads)
+         continue;
+
+      if (     (idx >= index->size)
+            || !playlist_index_hash((enum playlist_index_key)key,
+                  &playlist->entries[idx], &hash))
+      {
+         playlist_index_free(index);
+         continue;
+      }
+
+      slot = playlist_index_slot(index, idx);
+      if (hash == index->hashes[slot])
+         continue;
+
+      playlist_index_unlink(index, slot);
+      playlist_index_link(index, slot, hash);
+   }
+}
+
+/* Lowest position at or after 'start' in the bucket of 'hash'
+ * whose entry matches 'path_id' */
+static bool playlist_index_find_path_in(playlist_t *playlist,
+      playlist_index_t *index, uint32_t hash,
+      playlist_path_id_t *path_id, size_t start, size_t *idx)
+{
+   size_t link;
+   bool found = false;
+
+   for (link = index->heads[hash & index->mask]; link;
+         link = index->next[link - 1])
+   {
+      size_t pos = playlist_index_slot(index, 0) - (link - 1);
+
+      if (     (pos < start)
+            || (found && pos >= *idx)
+            || (index->hashes[link - 1] != hash))
+         continue;
+
+      if (playlist_path_matches_entry(path_id,
+            &playlist->entries[pos], &playlist->config))
+      {
+         *idx  = pos;
+         found = true;
+      }
+   }
+
+   return found;
+}
+
+/**
+ * playlist_find_path:
+ * @playlist          : Playlist handle.
+ * @path_id           : Path to look for.
+ * @match_empty       : Whether an empty path matches entries
+ *                      without one.
+ * @start             : First position to consider.
+ * @idx               : Position of the entry found.
+ *
+ * Looks for the first entry at or after 'start' that
+ * playlist_path_matches_entry() would match.
+ *
+ * Returns: true if an entry was found.
+ **/
+static bool playlist_find_path(playlist_t *playlist,
+      playlist_path_id_t *path_id, bool match_empty,
+      size_t start, size_t *idx)
+{
+   size_t i, _len;
+   playlist_index_t *index;
+   bool found = false;
+
+   if (string_is_empty(path_id->real_path))
+   {
+      if (!match_empty)
+         return false;
+
+      for (i = start, _len = RBUF_LEN(playlist->entries); i < _len; i++)
+      {
+         if (string_is_empty(playlist->entries[i].path))
+         {
+            *idx = i;
+            return true;
+         }
+      }
+
+      return false;
+   }
+
+   if (!(index = playlist_index_get(playlist, PLAYLIST_INDEX_PATH)))
+      goto linear;
+
+   found = playlist_index_find_path_in(playlist, index,
+         path_id->real_path_hash, path_id, start, idx);
+
+   /* Archive paths that only match on their parent archive */
+#ifdef RARCH_INTERNAL
+   if (playlist->config.fuzzy_archive_match)
+#endif
+   {
+      if (!string_is_empty(path_id->archive_path))
+      {
+         size_t archive_idx;
+
+         if (!(index = playlist_index_get(playlist,
+               PLAYLIST_INDEX_ARCHIVE)))
+            goto linear;
+
+         if (     playlist_index_find_path_in(playlist, index,
+                     path_id->archive_path_hash, path_id, start,
+                     &archive_idx)
+               && (!found || archive_idx < *idx))
+         {
+            *idx  = archive_idx;
+            found = true;
+         }
+      }
+   }
+
+   return found;
+
+linear:
+   for (i = start, _len = RBUF_LEN(playlist->entries); i < _len; i++)
+   {
+      if (playlist_path_matches_entry(path_id,
+            &playlist->entries[i], &playlist->config))
+      {
+         *idx = i;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+static bool playlist_find_string(playlist_t *playlist,
+      enum playlist_index_key key, const char *str,
+      size_t start, size_t *idx)
+{
+   size_t i, _len;
+   playlist_index_t *index;
+   uint32_t hash;
+   bool found = false;
+
+   if (!playlist || string_is_empty(str) || !idx)
+      return false;
+
+   if (!(index = playlist_index_get(playlist, key)))
+   {
+      for (i = start, _len = RBUF_LEN(playlist->entries); i < _len; i++)
+      {
+         const char *entry_str = (key == PLAYLIST_INDEX_CRC)
+               ? playlist->entries[i].crc32
+               : playlist->entries[i].label;
+
+         if (string_is_equal(entry_str, str))
+         {
+            *idx = i;
+            return true;
+         }
+      }
+
+      return false;
+   }
+
+   hash = playlist_path_hash(str);
+
+   for (i = index->heads[hash & index->mask]; i; i = index->next[i - 1])
+   {
+      size_t pos = playlist_index_slot(index, 0) - (i - 1);
+      const char *entry_str;
+
+      if (     (pos < start)
+            || (found && pos >= *idx)
+            || (index->hashes[i - 1] != hash))
+         continue;
+
+      entry_str = (key == PLAYLIST_INDEX_CRC)
+            ? playlist->entries[pos].crc32
+            : playlist->entries[pos].label;
+
+      if (string_is_equal(entry_str, str))
+      {
+         *idx  = pos;
+         found = true;
+      }
+   }
+
+   return found;
+}
+
+bool playlist_find_crc32(playlist_t *playlist, const char *crc32,
+      size_t start, size_t *idx)
+{
+   return playlist_find_string(playlist, PLAYLIST_INDEX_CRC, crc32,
+         start, idx);
+}
+
+bool playlist_find_label(playlist_t *playlist, const char *label,
+      size_t start, size_t *idx)
+{
+   return playlist_find_string(playlist, PLAYLIST_INDEX_LABEL, label,
+         start, idx);
+}
+
 uint32_t playlist_get_size(playlist_t *playlist)
 {
    if (!playlist)
@@ -652,6 +1164,8 @@ void playlist_delete_index(playlist_t *playlist,
    if (idx >= _len)
       return;
 
+   playlist_index_remove(playlist, idx);
+
    /* Free unwanted entry */
    entry_to_delete = (struct playlist_entry *)(playlist->entries + idx);
    if (entry_to_delete)
@@ -686,22 +1200,11 @@ void playlist_delete_by_path(playlist_t *playlist,
    if (!(path_id = playlist_path_id_init(search_path)))
       return;
 
-   while (i < RBUF_LEN(playlist->entries))
-   {
-      if (!playlist_path_matches_entry(path_id,
-            &playlist->entries[i], &playlist->config))
-      {
-         i++;
-         continue;
-      }
-
-      /* Paths are equal - delete entry */
+   /* Entries are shifted up by the delete
+    * operation - carry on from the same position */
+   while (playlist_find_path(playlist, path_id, false, i, &i))
       playlist_delete_index(playlist, i);
 
-      /* Entries are shifted up by the delete
-       * operation - *do not* increment i */
-   }
-
    playlist_path_id_free(path_id);
 }
 
@@ -709,8 +1212,8 @@ void playlist_get_index_by_path(playlist_t *playlist,
       const char *search_path,
       const struct playlist_entry **entry)
 {
+   size_t i;
    playlist_path_id_t *path_id = NULL;
-   size_t i, len;
 
    if (!playlist || !entry || string_is_empty(search_path))
       return;
@@ -718,15 +1221,8 @@ void playlist_get_index_by_path(playlist_t *playlist,
    if (!(path_id = playlist_path_id_init(search_path)))
       return;
 
-   for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
-   {
-      if (!playlist_path_matches_entry(path_id,
-            &playlist->entries[i], &playlist->config))
-         continue;
-
+   if (playlist_find_path(playlist, path_id, false, 0, &i))
       *entry = &playlist->entries[i];
-      break;
-   }
 
    playlist_path_id_free(path_id);
 }
@@ -734,8 +1230,9 @@ void playlist_get_index_by_path(playlist_t *playlist,
 bool playlist_entry_exists(playlist_t *playlist,
       const char *path)
 {
+   size_t i;
+   bool found;
    playlist_path_id_t *path_id = NULL;
-   size_t i, len;
 
    if (!playlist || string_is_empty(path))
       return false;
@@ -743,18 +1240,10 @@ bool playlist_entry_exists(playlist_t *playlist,
    if (!(path_id = playlist_path_id_init(path)))
       return false;
 
-   for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
-   {
-      if (playlist_path_matches_entry(path_id,
-            &playlist->entries[i], &playlist->config))
-      {
-         playlist_path_id_free(path_id);
-         return true;
-      }
-   }
+   found = playlist_find_path(playlist, path_id, false, 0, &i);
 
    playlist_path_id_free(path_id);
-   return false;
+   return found;
 }
 
 void playlist_update(playlist_t *playlist, size_t idx,
@@ -821,6 +1310,8 @@ void playlist_update(playlist_t *playlist, size_t idx,
       entry->crc32       = strdup(update_entry->crc32);
       playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
    }
+
+   playlist_index_update(playlist, idx);
 }
 
 void playlist_update_runtime(playlist_t *playlist, size_t idx,
@@ -846,6 +1337,8 @@ void playlist_update_runtime(playlist_t *playlist, size_t idx,
          entry->path_id  = NULL;
       }
 
+      playlist_index_update(playlist, idx);
+
       if (register_update)
          playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
    }
@@ -983,17 +1476,9 @@ bool playlist_push_runtime(playlist_t *playlist,
    }
 
    len = RBUF_LEN(playlist->entries);
-   for (i = 0; i < len; i++)
+   for (i = 0; playlist_find_path(playlist, path_id, true, i, &i); i++)
    {
       struct playlist_entry tmp;
-      bool equal_path  = (string_is_empty(path_id->real_path)
-            && string_is_empty(playlist->entries[i].path));
-
-      equal_path       = equal_path || playlist_path_matches_entry(
-            path_id, &playlist->entries[i], &playlist->config);
-
-      if (!equal_path)
-         continue;
 
       /* Core name can have changed while still being the same core.
        * Differentiate based on the core path only. */
@@ -1006,6 +1491,7 @@ bool playlist_push_runtime(playlist_t *playlist,
          goto error;
 
       /* Seen it before, bump to top. */
+      playlist_index_move_front(playlist, i);
       tmp = playlist->entries[i];
       memmove(playlist->entries + 1, playlist->entries,
             i * sizeof(struct playlist_entry));
@@ -1020,6 +1506,7 @@ bool playlist_push_runtime(playlist_t *playlist,
    if (len == playlist->config.capacity)
    {
       struct playlist_entry *last_entry = &playlist->entries[len - 1];
+      playlist_index_remove(playlist, len - 1);
       playlist_free_entry(last_entry);
       len--;
    }
@@ -1036,8 +1523,17 @@ bool playlist_push_runtime(playlist_t *playlist,
       memmove(playlist->entries + 1, playlist->entries,
             len * sizeof(struct playlist_entry));
 
+      /* Clear what the entry shifted down left behind */
       playlist->entries[0].path               = NULL;
+      playlist->entries[0].label              = NULL;
       playlist->entries[0].core_path          = NULL;
+      playlist->entries[0].core_name          = NULL;
+      playlist->entries[0].db_name            = NULL;
+      playlist->entries[0].crc32              = NULL;
+      playlist->entries[0].subsystem_ident    = NULL;
+      playlist->entries[0].subsystem_name     = NULL;
+      playlist->entries[0].subsystem_roms     = NULL;
+      playlist->entries[0].entry_slot         = 0;
 
       if (!string_is_empty(path_id->real_path))
          playlist->entries[0].path            = strdup(path_id->real_path);
@@ -1065,6 +1561,8 @@ bool playlist_push_runtime(playlist_t *playlist,
          playlist->entries[0].runtime_str     = strdup(entry->runtime_str);
       if (!string_is_empty(entry->last_played_str))
          playlist->entries[0].last_played_str = strdup(entry->last_played_str);
+
+      playlist_index_push_front(playlist);
    }
 
 success:
@@ -1328,17 +1826,9 @@ bool playlist_push(playlist_t *playlist,
    }
 
    _len = RBUF_LEN(playlist->entries);
-   for (i = 0; i < _len; i++)
+   for (i = 0; playlist_find_path(playlist, path_id, true, i, &i); i++)
    {
       struct playlist_entry tmp;
-      bool equal_path  = (string_is_empty(path_id->real_path)
-                       && string_is_empty(playlist->entries[i].path));
-
-      equal_path       = equal_path || playlist_path_matches_entry(
-            path_id, &playlist->entries[i], &playlist->config);
-
-      if (!equal_path)
-         continue;
 
       /* Core name can have changed while still being the same core.
        * Differentiate based on the core path only. */
@@ -1434,6 +1924,8 @@ bool playlist_push(playlist_t *playlist,
          playlist->entries[i].db_name     = strdup(entry->db_name);
          entry_updated                    = true;
       }
+      if (entry_updated)
+         playlist_index_update(playlist, i);
 
       /* If top entry, we don't want to push a new entry since
        * the top and the entry to be pushed are the same. */
@@ -1446,6 +1938,7 @@ bool playlist_push(playlist_t *playlist,
       }
 
       /* Seen it before, bump to top. */
+      playlist_index_move_front(playlist, i);
       tmp = playlist->entries[i];
       memmove(playlist->entries + 1, playlist->entries,
             i * sizeof(struct playlist_entry));
@@ -1460,6 +1953,7 @@ bool playlist_push(playlist_t *playlist,
    if (_len == playlist->config.capacity)
    {
       struct playlist_entry *last_entry = &playlist->entries[_len - 1];
+      playlist_index_remove(playlist, _len - 1);
       playlist_free_entry(last_entry);
       _len--;
    }
@@ -1530,6 +2024,8 @@ bool playlist_push(playlist_t *playlist,
          for (i = 0; i < entry->subsystem_roms->size; i++)
             string_list_append(playlist->entries[0].subsystem_roms, entry->subsystem_roms->elems[i].data, attributes);
       }
+
+      playlist_index_push_front(playlist);
    }
 
 success:
@@ -2108,6 +2604,18 @@ void playlist_write_file(playlist_t *playlist)
       playlist->flags  &= ~(CNT_PLAYLIST_FLG_COMPRESSED);
 
    RARCH_LOG("[Playlist] Written to file: \"%s\".\n", playlist->config.path);
+
+   /* The file now holds what the journal recorded */
+   if (playlist->journal_records)
+   {
+      char journal_path[PATH_MAX_LENGTH];
+      size_t _len = strlcpy(journal_path, playlist->config.path,
+            sizeof(journal_path));
+      strlcpy(journal_path + _len, FILE_PATH_LPL_JOURNAL_EXTENSION,
+            sizeof(journal_path) - _len);
+      filestream_delete(journal_path);
+      playlist->journal_records = 0;
+   }
 end:
    intfstream_close(file);
    free(file);
@@ -2163,6 +2671,8 @@ void playlist_free(playlist_t *playlist)
       RBUF_FREE(playlist->entries);
    }
 
+   playlist_index_clear(playlist);
+
    free(playlist);
 }
 
@@ -2186,6 +2696,7 @@ void playlist_clear(playlist_t *playlist)
          playlist_free_entry(entry);
    }
    RBUF_CLEAR(playlist->entries);
+   playlist_index_clear(playlist);
 }
 
 /**
@@ -2562,6 +3073,788 @@ static bool JSONObjectMemberHandler(void *context, const char *pValue, size_t le
    return true;
 }
 
+/* Binary cache
+ *
+ * Next to each playlist file, "<path>.bin" keeps its contents as
+ * fixed-size entry records that point into a pool of NUL terminated
+ * strings, in native byte order. It is valid while the playlist file
+ * has the size, modification time and CRC32 it was written for, and
+ * saves parsing the JSON (and inflating it, when compressed) on load. */
+
+#define PLAYLIST_CACHE_MAGIC      "RAPLBIN"
+#define PLAYLIST_CACHE_VERSION    1
+#define PLAYLIST_CACHE_BYTE_ORDER 0x01020304
+
+enum playlist_cache_scan_flags
+{
+   PLAYLIST_CACHE_SCAN_RECURSIVELY = (1 << 0),
+   PLAYLIST_CACHE_SCAN_ARCHIVES    = (1 << 1),
+   PLAYLIST_CACHE_SCAN_FILTER_DAT  = (1 << 2),
+   PLAYLIST_CACHE_SCAN_OVERWRITE   = (1 << 3)
+};
+
+/* String fields are offsets into the pool; 0 is NULL */
+typedef struct
+{
+   char magic[8];
+   uint32_t version;
+   uint32_t byte_order;
+   int64_t file_size;
+   int64_t file_mtime;
+   uint32_t file_crc;
+   uint32_t count;
+   uint32_t pool_size;
+   uint32_t flags;
+   uint32_t label_display_mode;
+   uint32_t right_thumbnail_mode;
+   uint32_t left_thumbnail_mode;
+   uint32_t thumbnail_match_mode;
+   uint32_t sort_mode;
+   uint32_t scan_flags;
+   uint32_t default_core_path;
+   uint32_t default_core_name;
+   uint32_t base_content_directory;
+   uint32_t scan_content_dir;
+   uint32_t scan_file_exts;
+   uint32_t scan_dat_file_path;
+} playlist_cache_header_t;
+
+typedef struct
+{
+   uint32_t path;
+   uint32_t label;
+   uint32_t core_path;
+   uint32_t core_name;
+   uint32_t db_name;
+   uint32_t crc32;
+   uint32_t subsystem_ident;
+   uint32_t subsystem_name;
+   /* First of 'subsystem_rom_count' consecutive strings */
+   uint32_t subsystem_roms;
+   uint32_t subsystem_rom_count;
+   uint32_t entry_slot;
+   uint32_t runtime_hours;
+   uint32_t runtime_minutes;
+   uint32_t runtime_seconds;
+   uint32_t last_played_year;
+   uint32_t last_played_month;
+   uint32_t last_played_day;
+   uint32_t last_played_hour;
+   uint32_t last_played_minute;
+   uint32_t last_played_second;
+} playlist_cache_entry_t;
+
+static void playlist_cache_get_path(const playlist_t *playlist,
+      char *s, size_t len)
+{
+   size_t _len = strlcpy(s, playlist->config.path, len);
+   strlcpy(s + _len, FILE_PATH_LPL_CACHE_EXTENSION, len - _len);
+}
+
+static bool playlist_cache_file_crc(const char *path, uint32_t *crc)
+{
+   int64_t rd;
+   uint8_t *buf;
+   RFILE *file = filestream_open(path, RETRO_VFS_FILE_ACCESS_READ,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return false;
+   if (!(buf = (uint8_t*)malloc(64 * 1024)))
+   {
+      filestream_close(file);
+      return false;
+   }
+
+   *crc = 0;
+   while ((rd = filestream_read(file, buf, 64 * 1024)) > 0)
+      *crc = encoding_crc32(*crc, buf, (size_t)rd);
+
+   free(buf);
+   filestream_close(file);
+   return rd == 0;
+}
+
+typedef struct
+{
+   char *buf;
+   bool oom;
+} playlist_cache_pool_t;
+
+static uint32_t playlist_cache_add(playlist_cache_pool_t *pool,
+      const char *str)
+{
+   size_t _len   = strlen(str) + 1;
+   size_t offset = RBUF_LEN(pool->buf);
+
+   if (!RBUF_TRYFIT(pool->buf, offset + _len))
+   {
+      pool->oom = true;
+      return 0;
+   }
+   RBUF_RESIZE(pool->buf, offset + _len);
+   memcpy(pool->buf + offset, str, _len);
+   return (uint32_t)offset;
+}
+
+static uint32_t playlist_cache_add_string(playlist_cache_pool_t *pool,
+      const char *str)
+{
+   if (string_is_empty(str))
+      return 0;
+   return playlist_cache_add(pool, str);
+}
+
+/* Writes the cache for the playlist file as it is on disk now;
+ * only call with what parsing it gave */
+static void playlist_cache_write(playlist_t *playlist)
+{
+   size_t i;
+   char path[PATH_MAX_LENGTH];
+   struct file_write_block blocks[3];
+   playlist_cache_header_t header;
+   playlist_cache_pool_t pool;
+   playlist_cache_entry_t *records = NULL;
+   size_t count                    = RBUF_LEN(playlist->entries);
+
+   if (string_is_empty(playlist->config.path))
+      return;
+
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, PLAYLIST_CACHE_MAGIC, sizeof(PLAYLIST_CACHE_MAGIC));
+   header.version    = PLAYLIST_CACHE_VERSION;
+   header.byte_order = PLAYLIST_CACHE_BYTE_ORDER;
+
+   if (     !path_get_size_and_mtime(playlist->config.path,
+               &header.file_size, &header.file_mtime)
+         || !playlist_cache_file_crc(playlist->config.path,
+               &header.file_crc))
+      return;
+
+   /* Offset 0 stands for NULL */
+   pool.buf = NULL;
+   pool.oom = false;
+   playlist_cache_add(&pool, "");
+
+   if (count && !(records = (playlist_cache_entry_t*)
+            calloc(count, sizeof(*records))))
+      goto end;
+
+   for (i = 0; i < count; i++)
+   {
+      const struct playlist_entry *entry = &playlist->entries[i];
+      playlist_cache_entry_t *record     = &records[i];
+
+      record->path            = playlist_cache_add_string(&pool, entry->path);
+      record->label           = playlist_cache_add_string(&pool, entry->label);
+      record->core_path       = playlist_cache_add_string(&pool, entry->core_path);
+      record->core_name       = playlist_cache_add_string(&pool, entry->core_name);
+      record->db_name         = playlist_cache_add_string(&pool, entry->db_name);
+      record->crc32           = playlist_cache_add_string(&pool, entry->crc32);
+      record->subsystem_ident = playlist_cache_add_string(&pool, entry->subsystem_ident);
+      record->subsystem_name  = playlist_cache_add_string(&pool, entry->subsystem_name);
+      record->entry_slot         = entry->entry_slot;
+      record->runtime_hours      = entry->runtime_hours;
+      record->runtime_minutes    = entry->runtime_minutes;
+      record->runtime_seconds    = entry->runtime_seconds;
+      record->last_played_year   = entry->last_played_year;
+      record->last_played_month  = entry->last_played_month;
+      record->last_played_day    = entry->last_played_day;
+      record->last_played_hour   = entry->last_played_hour;
+      record->last_played_minute = entry->last_played_minute;
+      record->last_played_second = entry->last_played_second;
+
+      if (entry->subsystem_roms && entry->subsystem_roms->size > 0)
+      {
+         size_t j;
+         record->subsystem_roms      = (uint32_t)RBUF_LEN(pool.buf);
+         record->subsystem_rom_count = (uint32_t)entry->subsystem_roms->size;
+         for (j = 0; j < entry->subsystem_roms->size; j++)
+         {
+            const char *rom = entry->subsystem_roms->elems[j].data;
+            playlist_cache_add(&pool, rom ? rom : "");
+         }
+      }
+   }
+
+   header.count                  = (uint32_t)count;
+   header.flags                  = playlist->flags
+      & (CNT_PLAYLIST_FLG_OLD_FMT | CNT_PLAYLIST_FLG_COMPRESSED);
+   header.label_display_mode     = playlist->label_display_mode;
+   header.right_thumbnail_mode   = playlist->right_thumbnail_mode;
+   header.left_thumbnail_mode    = playlist->left_thumbnail_mode;
+   header.thumbnail_match_mode   = playlist->thumbnail_match_mode;
+   header.sort_mode              = playlist->sort_mode;
+   if (playlist->scan_record.search_recursively)
+      header.scan_flags         |= PLAYLIST_CACHE_SCAN_RECURSIVELY;
+   if (playlist->scan_record.search_archives)
+      header.scan_flags         |= PLAYLIST_CACHE_SCAN_ARCHIVES;
+   if (playlist->scan_record.filter_dat_content)
+      header.scan_flags         |= PLAYLIST_CACHE_SCAN_FILTER_DAT;
+   if (playlist->scan_record.overwrite_playlist)
+      header.scan_flags         |= PLAYLIST_CACHE_SCAN_OVERWRITE;
+   header.default_core_path      = playlist_cache_add_string(&pool,
+         playlist->default_core_path);
+   header.default_core_name      = playlist_cache_add_string(&pool,
+         playlist->default_core_name);
+   header.base_content_directory = playlist_cache_add_string(&pool,
+         playlist->base_content_directory);
+   header.scan_content_dir       = playlist_cache_add_string(&pool,
+         playlist->scan_record.content_dir);
+   header.scan_file_exts         = playlist_cache_add_string(&pool,
+         playlist->scan_record.file_exts);
+   header.scan_dat_file_path     = playlist_cache_add_string(&pool,
+         playlist->scan_record.dat_file_path);
+   header.pool_size              = (uint32_t)RBUF_LEN(pool.buf);
+
+   if (pool.oom || RBUF_LEN(pool.buf) > UINT32_MAX)
+      goto end;
+
+   blocks[0].data = &header;
+   blocks[0].size = sizeof(header);
+   blocks[1].data = records;
+   blocks[1].size = (int64_t)(count * sizeof(*records));
+   blocks[2].data = pool.buf;
+   blocks[2].size = (int64_t)RBUF_LEN(pool.buf);
+   playlist_cache_get_path(playlist, path, sizeof(path));
+   if (!file_write_atomic(path, blocks, ARRAY_SIZE(blocks)))
+      RARCH_WARN("[Playlist] Failed to write cache file: \"%s\".\n", path);
+
+end:
+   free(records);
+   RBUF_FREE(pool.buf);
+}
+
+static char *playlist_cache_strdup(const char *pool, uint32_t pool_size,
+      uint32_t offset, bool *valid)
+{
+   if (!offset)
+      return NULL;
+   if (offset >= pool_size)
+   {
+      *valid = false;
+      return NULL;
+   }
+   return strdup(pool + offset);
+}
+
+/* Fills the playlist from its cache if that is up to date */
+static bool playlist_cache_read(playlist_t *playlist)
+{
+   uint32_t i;
+   char path[PATH_MAX_LENGTH];
+   int64_t file_size, file_mtime;
+   uint32_t file_crc;
+   const playlist_cache_header_t *header;
+   const playlist_cache_entry_t *records;
+   const char *pool;
+   void *data   = NULL;
+   size_t size  = 0;
+   bool mapped  = false;
+   bool valid   = false;
+
+   if (     string_is_empty(playlist->config.path)
+         || !path_get_size_and_mtime(playlist->config.path,
+               &file_size, &file_mtime))
+      return false;
+
+   playlist_cache_get_path(playlist, path, sizeof(path));
+
+#ifdef HAVE_MMAP
+   {
+      struct stat st;
+      int fd = open(path, O_RDONLY);
+
+      if (fd >= 0)
+      {
+         if (     fstat(fd, &st) == 0
+               && st.st_size >= (off_t)sizeof(*header))
+         {
+            void *map = mmap(NULL, (size_t)st.st_size,
+                  PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED)
+            {
+               data   = map;
+               size   = (size_t)st.st_size;
+               mapped = true;
+            }
+         }
+         close(fd);
+      }
+   }
+   if (!mapped)
+#endif
+   {
+      int64_t _len = 0;
+      if (!filestream_read_file(path, &data, &_len))
+         return false;
+      size = (size_t)_len;
+   }
+
+   header  = (const playlist_cache_header_t*)data;
+   if (     size < sizeof(*header)
+         || memcmp(header->magic, PLAYLIST_CACHE_MAGIC,
+               sizeof(PLAYLIST_CACHE_MAGIC)) != 0
+         || header->version    != PLAYLIST_CACHE_VERSION
+         || header->byte_order != PLAYLIST_CACHE_BYTE_ORDER
+         || header->file_size  != file_size
+         || header->file_mtime != file_mtime
+         || header->count       > playlist->config.capacity
+         || header->count       > (size - sizeof(*header)) / sizeof(*records)
+         || header->pool_size  != size - sizeof(*header)
+            - (size_t)header->count * sizeof(*records)
+         || !header->pool_size
+         || header->default_core_path      >= header->pool_size
+         || header->default_core_name      >= header->pool_size
+         || header->base_content_directory >= header->pool_size
+         || header->scan_content_dir       >= header->pool_size
+         || header->scan_file_exts         >= header->pool_size
+         || header->scan_dat_file_path     >= header->pool_size)
+      goto end;
+
+   records = (const playlist_cache_entry_t*)(header + 1);
+   pool    = (const char*)(records + header->count);
+   if (pool[header->pool_size - 1] != '\0')
+      goto end;
+
+   /* Reading the playlist file to hash it is still far cheaper
+    * than parsing it */
+   if (     !playlist_cache_file_crc(playlist->config.path, &file_crc)
+         || file_crc != header->file_crc)
+      goto end;
+
+   if (header->count && !RBUF_TRYFIT(playlist->entries, header->count))
+      goto end;
+
+   valid = true;
+
+   for (i = 0; i < header->count && valid; i++)
+   {
+      const playlist_cache_entry_t *record = &records[i];
+      struct playlist_entry *entry;
+
+      RBUF_RESIZE(playlist->entries, i + 1);
+      entry                  = &playlist->entries[i];
+      memset(entry, 0, sizeof(*entry));
+
+      entry->path            = playlist_cache_strdup(pool,
+            header->pool_size, record->path, &valid);
+      entry->label           = playlist_cache_strdup(pool,
+            header->pool_size, record->label, &valid);
+      entry->core_path       = playlist_cache_strdup(pool,
+            header->pool_size, record->core_path, &valid);
+      entry->core_name       = playlist_cache_strdup(pool,
+            header->pool_size, record->core_name, &valid);
+      entry->db_name         = playlist_cache_strdup(pool,
+            header->pool_size, record->db_name, &valid);
+      entry->crc32           = playlist_cache_strdup(pool,
+            header->pool_size, record->crc32, &valid);
+      entry->subsystem_ident = playlist_cache_strdup(pool,
+            header->pool_size, record->subsystem_ident, &valid);
+      entry->subsystem_name  = playlist_cache_strdup(pool,
+            header->pool_size, record->subsystem_name, &valid);
+      entry->entry_slot         = record->entry_slot;
+      entry->runtime_hours      = record->runtime_hours;
+      entry->runtime_minutes    = record->runtime_minutes;
+      entry->runtime_seconds    = record->runtime_seconds;
+      entry->last_played_year   = record->last_played_year;
+      entry->last_played_month  = record->last_played_month;
+      entry->last_played_day    = record->last_played_day;
+      entry->last_played_hour   = record->last_played_hour;
+      entry->last_played_minute = record->last_played_minute;
+      entry->last_played_second = record->last_played_second;
+
+      if (record->subsystem_rom_count)
+      {
+         uint32_t j;
+         uint32_t offset                  = record->subsystem_roms;
+         union string_list_elem_attr attr = {0};
+
+         if (!(entry->subsystem_roms = string_list_new()))
+            valid = false;
+
+         for (j = 0; j < record->subsystem_rom_count && valid; j++)
+         {
+            if (offset >= header->pool_size)
+               valid = false;
+            else
+            {
+               string_list_append(entry->subsystem_roms,
+                     pool + offset, attr);
+               offset += (uint32_t)strlen(pool + offset) + 1;
+            }
+         }
+      }
+   }
+
+   if (valid)
+   {
+      playlist->flags               &= ~(CNT_PLAYLIST_FLG_OLD_FMT
+            | CNT_PLAYLIST_FLG_COMPRESSED);
+      playlist->flags               |= header->flags
+         & (CNT_PLAYLIST_FLG_OLD_FMT | CNT_PLAYLIST_FLG_COMPRESSED);
+      playlist->label_display_mode   = (enum playlist_label_display_mode)
+         header->label_display_mode;
+      playlist->right_thumbnail_mode = (enum playlist_thumbnail_mode)
+         header->right_thumbnail_mode;
+      playlist->left_thumbnail_mode  = (enum playlist_thumbnail_mode)
+         header->left_thumbnail_mode;
+      playlist->thumbnail_match_mode = (enum playlist_thumbnail_match_mode)
+         header->thumbnail_match_mode;
+      playlist->sort_mode            = (enum playlist_sort_mode)
+         header->sort_mode;
+      playlist->scan_record.search_recursively =
+         (header->scan_flags & PLAYLIST_CACHE_SCAN_RECURSIVELY) != 0;
+      playlist->scan_record.search_archives    =
+         (header->scan_flags & PLAYLIST_CACHE_SCAN_ARCHIVES) != 0;
+      playlist->scan_record.filter_dat_content =
+         (header->scan_flags & PLAYLIST_CACHE_SCAN_FILTER_DAT) != 0;
+      playlist->scan_record.overwrite_playlist =
+         (header->scan_flags & PLAYLIST_CACHE_SCAN_OVERWRITE) != 0;
+      playlist->default_core_path      = playlist_cache_strdup(pool,
+            header->pool_size, header->default_core_path, &valid);
+      playlist->default_core_name      = playlist_cache_strdup(pool,
+            header->pool_size, header->default_core_name, &valid);
+      playlist->base_content_directory = playlist_cache_strdup(pool,
+            header->pool_size, header->base_content_directory, &valid);
+      playlist->scan_record.content_dir   = playlist_cache_strdup(pool,
+            header->pool_size, header->scan_content_dir, &valid);
+      playlist->scan_record.file_exts     = playlist_cache_strdup(pool,
+            header->pool_size, header->scan_file_exts, &valid);
+      playlist->scan_record.dat_file_path = playlist_cache_strdup(pool,
+            header->pool_size, header->scan_dat_file_path, &valid);
+   }
+
+   /* Leave the playlist empty for the file to be parsed */
+   if (!valid)
+      playlist_clear(playlist);
+
+end:
+#ifdef HAVE_MMAP
+   if (mapped)
+      munmap(data, size);
+   else
+#endif
+      free(data);
+   return valid;
+}
+
+/* Pushes recorded since the playlist file was last written, replayed
+ * on load. A record whose size or CRC does not check out (a write
+ * cut short) ends the journal. */
+#define PLAYLIST_JOURNAL_MAGIC       "RAPLJNL"
+#define PLAYLIST_JOURNAL_VERSION     1
+#define PLAYLIST_JOURNAL_BYTE_ORDER  0x01020304
+/* Records taken before the playlist file is rewritten */
+#define PLAYLIST_JOURNAL_MAX_RECORDS 64
+/* subsystem_rom_count of an entry without a subsystem ROM list */
+#define PLAYLIST_JOURNAL_NO_ROMS     0xFFFFFFFF
+
+/* The playlist file the journal was started against */
+typedef struct
+{
+   char magic[8];
+   uint32_t version;
+   uint32_t byte_order;
+   int64_t file_size;
+   int64_t file_mtime;
+} playlist_journal_header_t;
+
+/* Followed by 'size' bytes of NUL terminated strings: path, label,
+ * core path, core name, db name, crc32, subsystem ident, subsystem
+ * name, then the subsystem ROMs. Empty strings stand for NULL. */
+typedef struct
+{
+   uint32_t size;
+   /* Of the fields below and the strings */
+   uint32_t crc;
+   uint32_t entry_slot;
+   uint32_t subsystem_rom_count;
+} playlist_journal_record_t;
+
+static void playlist_journal_get_path(const playlist_t *playlist,
+      char *s, size_t len)
+{
+   size_t _len = strlcpy(s, playlist->config.path, len);
+   strlcpy(s + _len, FILE_PATH_LPL_JOURNAL_EXTENSION, len - _len);
+}
+
+static uint32_t playlist_journal_record_crc(
+      const playlist_journal_record_t *record, const char *strings)
+{
+   uint32_t crc = encoding_crc32(0, (const uint8_t*)&record->entry_slot,
+         sizeof(record->entry_slot) + sizeof(record->subsystem_rom_count));
+   return encoding_crc32(crc, (const uint8_t*)strings, record->size);
+}
+
+/**
+ * playlist_journal_append:
+ * @playlist            : Playlist handle.
+ * @entry               : Entry just pushed.
+ *
+ * Records a push instead of rewriting the playlist file.
+ *
+ * Returns: false if the push has to be saved by writing the
+ * playlist file: the journal is full, the file does not exist
+ * yet, or the record could not be written.
+ **/
+static bool playlist_journal_append(playlist_t *playlist,
+      const struct playlist_entry *entry)
+{
+   size_t i;
+   char path[PATH_MAX_LENGTH];
+   playlist_journal_record_t record;
+   playlist_cache_pool_t pool;
+   RFILE *file = NULL;
+   bool ok     = false;
+
+   if (     string_is_empty(playlist->config.path)
+         || (playlist->journal_records >= PLAYLIST_JOURNAL_MAX_RECORDS))
+      return false;
+
+   pool.buf = NULL;
+   pool.oom = false;
+
+   playlist_cache_add(&pool, entry->path            ? entry->path            : "");
+   playlist_cache_add(&pool, entry->label           ? entry->label           : "");
+   playlist_cache_add(&pool, entry->core_path       ? entry->core_path       : "");
+   playlist_cache_add(&pool, entry->core_name       ? entry->core_name       : "");
+   playlist_cache_add(&pool, entry->db_name         ? entry->db_name         : "");
+   playlist_cache_add(&pool, entry->crc32           ? entry->crc32           : "");
+   playlist_cache_add(&pool, entry->subsystem_ident ? entry->subsystem_ident : "");
+   playlist_cache_add(&pool, entry->subsystem_name  ? entry->subsystem_name  : "");
+
+   record.entry_slot          = entry->entry_slot;
+   record.subsystem_rom_count = PLAYLIST_JOURNAL_NO_ROMS;
+
+   if (entry->subsystem_roms)
+   {
+      record.subsystem_rom_count = (uint32_t)entry->subsystem_roms->size;
+      for (i = 0; i < entry->subsystem_roms->size; i++)
+      {
+         const char *rom = entry->subsystem_roms->elems[i].data;
+         playlist_cache_add(&pool, rom ? rom : "");
+      }
+   }
+
+   if (pool.oom)
+      goto end;
+
+   record.size = (uint32_t)RBUF_LEN(pool.buf);
+   record.crc  = playlist_journal_record_crc(&record, pool.buf);
+
+   playlist_journal_get_path(playlist, path, sizeof(path));
+
+   /* Start the journal against the file as it is now */
+   if (!playlist->journal_records)
+   {
+      playlist_journal_header_t header;
+
+      memset(&header, 0, sizeof(header));
+      memcpy(header.magic, PLAYLIST_JOURNAL_MAGIC,
+            sizeof(PLAYLIST_JOURNAL_MAGIC));
+      header.version    = PLAYLIST_JOURNAL_VERSION;
+      header.byte_order = PLAYLIST_JOURNAL_BYTE_ORDER;
+
+      if (     !path_get_size_and_mtime(playlist->config.path,
+                  &header.file_size, &header.file_mtime)
+            || !(file = filestream_open(path, RETRO_VFS_FILE_ACCESS_WRITE,
+                  RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+         goto end;
+
+      if (filestream_write(file, &header, sizeof(header))
+            != (int64_t)sizeof(header))
+         goto end;
+   }
+   else
+   {
+      if (!(file = filestream_open(path, RETRO_VFS_FILE_ACCESS_READ_WRITE
+                  | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+                  RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+         goto end;
+
+      if (filestream_seek(file, 0, RETRO_VFS_SEEK_POSITION_END) != 0)
+         goto end;
+   }
+
+   ok =     (filestream_write(file, &record, sizeof(record))
+               == (int64_t)sizeof(record))
+         && (filestream_write(file, pool.buf, record.size)
+               == (int64_t)record.size);
+
+end:
+   if (file && filestream_close(file) != 0)
+      ok = false;
+   RBUF_FREE(pool.buf);
+
+   if (!ok)
+      return false;
+
+   playlist->journal_records++;
+   return true;
+}
+
+/* Returns the string at 's' and moves past it, or NULL if it runs
+ * past 'end' */
+static const char *playlist_journal_next_string(const char **s,
+      const char *end)
+{
+   const char *str = *s;
+   const char *nul = (const char*)memchr(str, '\0', end - str);
+
+   if (!nul)
+      return NULL;
+   *s = nul + 1;
+   return str;
+}
+
+static void playlist_journal_delete(playlist_t *playlist)
+{
+   char path[PATH_MAX_LENGTH];
+
+   if (string_is_empty(playlist->config.path))
+      return;
+
+   playlist_journal_get_path(playlist, path, sizeof(path));
+   filestream_delete(path);
+   playlist->journal_records = 0;
+}
+
+/* Reapplies the pushes recorded since the playlist file was
+ * written. A journal cut short is folded into the playlist file
+ * straight away, so that new records do not land behind the
+ * broken one. */
+static void playlist_journal_replay(playlist_t *playlist)
+{
+   char path[PATH_MAX_LENGTH];
+   playlist_journal_header_t header;
+   int64_t file_size, file_mtime;
+   void *buf     = NULL;
+   int64_t len   = 0;
+   size_t pos    = sizeof(header);
+   unsigned done = 0;
+
+   if (string_is_empty(playlist->config.path))
+      return;
+
+   playlist_journal_get_path(playlist, path, sizeof(path));
+
+   if (     !path_is_valid(path)
+         || !filestream_read_file(path, &buf, &len))
+      return;
+
+   if ((size_t)len >= sizeof(header))
+      memcpy(&header, buf, sizeof(header));
+
+   /* Written against another version of the file:
+    * the file already holds what it recorded */
+   if (     ((size_t)len < sizeof(header))
+         || memcmp(header.magic, PLAYLIST_JOURNAL_MAGIC,
+               sizeof(PLAYLIST_JOURNAL_MAGIC))
+         || (header.version    != PLAYLIST_JOURNAL_VERSION)
+         || (header.byte_order != PLAYLIST_JOURNAL_BYTE_ORDER)
+         || !path_get_size_and_mtime(playlist->config.path,
+               &file_size, &file_mtime)
+         || (header.file_size  != file_size)
+         || (header.file_mtime != file_mtime))
+   {
+      free(buf);
+      playlist_journal_delete(playlist);
+      return;
+   }
+
+   while (pos + sizeof(playlist_journal_record_t) <= (size_t)len)
+   {
+      size_t i;
+      playlist_journal_record_t record;
+      struct playlist_entry entry;
+      const char *strings;
+      const char *s;
+      const char *end;
+      const char *fields[8];
+      bool ok = true;
+
+      memcpy(&record, (const char*)buf + pos, sizeof(record));
+      strings = (const char*)buf + pos + sizeof(record);
+
+      if (     (record.size > (size_t)len - pos - sizeof(record))
+            || (record.crc != playlist_journal_record_crc(&record, strings)))
+         break;
+
+      s   = strings;
+      end = strings + record.size;
+
+      for (i = 0; i < ARRAY_SIZE(fields) && ok; i++)
+      {
+         fields[i] = playlist_journal_next_string(&s, end);
+         ok        = (fields[i] != NULL);
+      }
+
+      if (!ok)
+         break;
+
+      memset(&entry, 0, sizeof(entry));
+      entry.path            = (char*)fields[0];
+      entry.label           = (char*)fields[1];
+      entry.core_path       = (char*)fields[2];
+      entry.core_name       = (char*)fields[3];
+      entry.db_name         = (char*)fields[4];
+      entry.crc32           = (char*)fields[5];
+      entry.subsystem_ident = (char*)fields[6];
+      entry.subsystem_name  = (char*)fields[7];
+      entry.entry_slot      = record.entry_slot;
+
+      if (record.subsystem_rom_count != PLAYLIST_JOURNAL_NO_ROMS)
+      {
+         union string_list_elem_attr attr;
+
+         attr.i = 0;
+         if (!(entry.subsystem_roms = string_list_new()))
+            break;
+
+         for (i = 0; i < record.subsystem_rom_count && ok; i++)
+         {
+            const char *rom = playlist_journal_next_string(&s, end);
+            ok              = rom
+               && string_list_append(entry.subsystem_roms, rom, attr);
+         }
+      }
+
+      if (ok)
+         playlist_push(playlist, &entry);
+
+      if (entry.subsystem_roms)
+         string_list_free(entry.subsystem_roms);
+
+      if (!ok)
+         break;
+
+      pos += sizeof(record) + record.size;
+      done++;
+   }
+
+   free(buf);
+
+   playlist->journal_records = done;
+
+   if (done)
+   {
+      RARCH_LOG("[Playlist] Replayed %u journal entries into \"%s\".\n",
+            done, playlist->config.path);
+      playlist->flags |= CNT_PLAYLIST_FLG_MOD;
+   }
+
+   if (pos != (size_t)len)
+   {
+      RARCH_WARN("[Playlist] Journal of \"%s\" is cut short.\n",
+            playlist->config.path);
+      if (done)
+         playlist_write_file(playlist);
+      else
+         playlist_journal_delete(playlist);
+   }
+}
+
 static size_t playlist_get_old_format_metadata_value(
       char *metadata_line, char *s, size_t len)
 {
@@ -2579,16 +3872,22 @@ static size_t playlist_get_old_format_metadata_value(
 static bool playlist_read_file(playlist_t *playlist)
 {
    int test_char;
+   intfstream_t *file;
    bool res             = true;
+   bool complete        = false;
+
+   if (playlist_cache_read(playlist))
+      return true;
+
 #if defined(HAVE_ZLIB)
       /* Always use RZIP interface when reading playlists
        * > this will automatically handle uncompressed
        *   data */
-   intfstream_t *file   = intfstream_open_rzip_file(
+   file                 = intfstream_open_rzip_file(
          playlist->config.path,
          RETRO_VFS_FILE_ACCESS_READ);
 #else
-   intfstream_t *file   = intfstream_open_file(
+   file                 = intfstream_open_file(
          playlist->config.path,
          RETRO_VFS_FILE_ACCESS_READ,
          RETRO_VFS_FILE_ACCESS_HINT_NONE);
@@ -2650,7 +3949,9 @@ static bool playlist_read_file(playlist_t *playlist)
             JSONEndArrayHandler,
             JSONBoolHandler,
             NULL) /* Unused null handler */
-            != RJSON_DONE)
+            == RJSON_DONE)
+         complete = true;
+      else
       {
          if (context.flags & JSON_CTX_FLG_OOM)
          {
@@ -2859,11 +4160,18 @@ static bool playlist_read_file(playlist_t *playlist)
             break;
          }
       }
+
+      complete = true;
    }
 
 end:
    intfstream_close(file);
    free(file);
+
+   /* Not when entries were dropped for the capacity, the cache
+    * has to give what the file does */
+   if (complete && !(playlist->flags & CNT_PLAYLIST_FLG_MOD))
+      playlist_cache_write(playlist);
    return res;
 }
 
@@ -2920,10 +4228,12 @@ playlist_t *playlist_init(const playlist_config_t *config)
 
    /* Set initial values */
    playlist->flags                          = 0;
+   playlist->journal_records                = 0;
    playlist->default_core_name              = NULL;
    playlist->default_core_path              = NULL;
    playlist->base_content_directory         = NULL;
    playlist->entries                        = NULL;
+   memset(playlist->index, 0, sizeof(playlist->index));
    playlist->label_display_mode             = LABEL_DISPLAY_MODE_DEFAULT;
    playlist->right_thumbnail_mode           = PLAYLIST_THUMBNAIL_MODE_DEFAULT;
    playlist->left_thumbnail_mode            = PLAYLIST_THUMBNAIL_MODE_DEFAULT;
@@ -2933,6 +4243,7 @@ playlist_t *playlist_init(const playlist_config_t *config)
    playlist->scan_record.search_recursively = false;
    playlist->scan_record.search_archives    = false;
    playlist->scan_record.filter_dat_content = false;
+   playlist->scan_record.overwrite_playlist = false;
    playlist->scan_record.content_dir        = NULL;
    playlist->scan_record.file_exts          = NULL;
    playlist->scan_record.dat_file_path      = NULL;
@@ -2945,6 +4256,8 @@ playlist_t *playlist_init(const playlist_config_t *config)
    if (!playlist_read_file(playlist))
       goto error;
 
+   playlist_journal_replay(playlist);
+
    /* Try auto-fixing paths if enabled, and playlist
     * base content directory is different */
    if (    config->autofix_paths
@@ -3146,13 +4459,19 @@ void playlist_qsort(playlist_t *playlist)
    qsort(playlist->entries, RBUF_LEN(playlist->entries),
          sizeof(struct playlist_entry),
          (int (*)(const void *, const void *))playlist_qsort_func);
+   playlist_index_clear(playlist);
 }
 
 void command_playlist_push_write(
       playlist_t *playlist,
       const struct playlist_entry *entry)
 {
-   if (playlist && playlist_push(playlist, entry))
+   if (!playlist || !playlist_push(playlist, entry))
+      return;
+
+   /* The file is rewritten once the journal fills up,
+    * or by playlist_write_file() on exit */
+   if (!playlist_journal_append(playlist, entry))
       playlist_write_file(playlist);
 }
 
@@ -317,6 +317,15 @@ void playlist_get_index_by_path(playlist_t *playlist,
 bool playlist_entry_exists(playlist_t *playlist,
       const char *path);
 
+/* Look for the first entry at or after 'start' whose CRC32
+ * (in "XXXXXXXX|crc" form) or label equals the one given,
+ * storing its position in 'idx'. Returns false if none does. */
+bool playlist_find_crc32(playlist_t *playlist, const char *crc32,
+      size_t start, size_t *idx);
+
+bool playlist_find_label(playlist_t *playlist, const char *label,
+      size_t start, size_t *idx);
+
 char *playlist_get_conf_path(playlist_t *playlist);
 
 uint32_t playlist_get_size(playlist_t *playlist);
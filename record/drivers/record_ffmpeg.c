@@ -23,6 +23,7 @@
 #include <compat/strl.h>
 
 #include <boolean.h>
+#include <retro_miscellaneous.h>
 #include <queues/fifo_queue.h>
 #include <rthreads/rthreads.h>
 #include <gfx/scaler/scaler.h>
@@ -60,6 +61,9 @@ extern "C" {
 #endif
 #include <libavutil/avconfig.h>
 #include <libavutil/pixdesc.h>
+#if LIBAVUTIL_VERSION_MAJOR >= 56
+#include <libavutil/hwcontext.h>
+#endif
 #include <libswscale/swscale.h>
 
 #ifdef __cplusplus
@@ -112,6 +116,11 @@ struct ff_video_info
    struct scaler_ctx scaler;
    struct SwsContext *sws;
    bool use_sws;
+
+   /* Set for hardware encoders that only take frames on their own
+    * device (VAAPI, QSV); conv_frame is uploaded into hw_frame. */
+   AVBufferRef *hw_device;
+   AVFrame *hw_frame;
 };
 
 struct ff_audio_info
@@ -160,6 +169,19 @@ struct ff_muxer_info
    AVStream *vstream;
 };
 
+/* What ffmpeg_push_video does when the encoder thread falls a full
+ * queue behind */
+enum ff_queue_policy
+{
+   /* Wait for the encoder; stalls emulation, keeps every frame */
+   FF_QUEUE_BLOCK = 0,
+   /* Throw the frame away, the recording gets shorter */
+   FF_QUEUE_DROP,
+   /* Throw the frame away but leave its timestamp free, so the
+    * previous frame shows for longer and audio stays in sync */
+   FF_QUEUE_DUPLICATE
+};
+
 struct ff_config_param
 {
    config_file_t *conf;
@@ -171,6 +193,7 @@ struct ff_config_param
    unsigned frame_drop_ratio;
    unsigned sample_rate;
    float scale_factor;
+   enum ff_queue_policy queue_policy;
 
    bool audio_enable;
    /* Keep same naming conventions as libavcodec. */
@@ -185,6 +208,15 @@ struct ff_config_param
    AVDictionary *audio_opts;
 };
 
+/* A preallocated frame in the queue to the encoder thread */
+struct ff_video_slot
+{
+   struct record_video_data attr;
+   uint8_t *data;
+   /* Frames left out right before this one by FF_QUEUE_DUPLICATE */
+   unsigned held;
+};
+
 typedef struct ffmpeg
 {
    struct ff_video_info video;
@@ -200,10 +232,22 @@ typedef struct ffmpeg
    slock_t *cond_lock;
    slock_t *lock;
    fifo_buffer_t *audio_fifo;
-   fifo_buffer_t *video_fifo;
-   fifo_buffer_t *attr_fifo;
    sthread_t *thread;
 
+   /* Single producer, single consumer ring of MAX_FRAMES slots.
+    * Only the pushing thread writes video_write and only the encoder
+    * thread writes video_read; the lock just publishes them, nobody
+    * copies a frame while holding it. */
+   struct ff_video_slot *video_slots;
+   uint8_t *video_slot_buf;
+   unsigned video_write;
+   unsigned video_read;
+   /* Pushing thread only */
+   unsigned video_held;
+
+   /* Guarded by lock */
+   struct record_stats stats;
+
    volatile bool alive;
    volatile bool can_sleep;
 } ffmpeg_t;
@@ -393,6 +437,130 @@ static bool ffmpeg_init_audio(ffmpeg_t *handle, const char *audio_resampler)
    return true;
 }
 
+#if !FFMPEG3
+static bool ffmpeg_codec_has_pix_fmt(const AVCodec *codec,
+      enum AVPixelFormat fmt)
+{
+   unsigned i;
+
+   if (!codec->pix_fmts)
+      return false;
+
+   for (i = 0; codec->pix_fmts[i] != AV_PIX_FMT_NONE; i++)
+      if (fmt == codec->pix_fmts[i])
+         return true;
+   return false;
+}
+
+/* Picks the input format of a hardware encoder.
+ *
+ * Encoders that take RGB frames from system memory (NVENC,
+ * VideoToolbox) get them straight from the in-house scaler; the
+ * conversion to YUV then runs on the GPU instead of in swscale.
+ * Only done when the requested format is one such an encoder would
+ * produce anyway. */
+static void ffmpeg_hw_resolve_pix_fmt(struct ff_video_info *video,
+      const AVCodec *codec)
+{
+   static const enum AVPixelFormat rgb_fmts[] = {
+      AV_PIX_FMT_RGB32, AV_PIX_FMT_0RGB32
+   };
+   unsigned i;
+
+   if (     video->pix_fmt != AV_PIX_FMT_YUV420P
+         && video->pix_fmt != AV_PIX_FMT_NV12)
+      return;
+
+   for (i = 0; i < ARRAY_SIZE(rgb_fmts); i++)
+   {
+      if (!ffmpeg_codec_has_pix_fmt(codec, rgb_fmts[i]))
+         continue;
+
+      video->pix_fmt        = rgb_fmts[i];
+      video->scaler.out_fmt = SCALER_FMT_ARGB8888;
+      video->use_sws        = false;
+      RARCH_LOG("[FFmpeg] %s takes %s, converting on the GPU.\n",
+            codec->name, av_get_pix_fmt_name(video->pix_fmt));
+      return;
+   }
+
+   /* QSV takes NV12 from system memory, swscale writes it as
+    * cheaply as YUV420P. */
+   if (     video->pix_fmt == AV_PIX_FMT_YUV420P
+         && ffmpeg_codec_has_pix_fmt(codec, AV_PIX_FMT_NV12))
+      video->pix_fmt = AV_PIX_FMT_NV12;
+}
+
+/* Encoders that don't list the format we convert to among their
+ * system memory formats (VAAPI) want frames on their device; set up
+ * a frame pool there for the converted frames to be uploaded to. */
+static bool ffmpeg_init_hw_frames(struct ff_video_info *video,
+      const AVCodec *codec)
+{
+   int i;
+   int ret;
+   AVHWFramesContext *frames;
+   AVBufferRef *frames_ref          = NULL;
+   const AVCodecHWConfig *config    = NULL;
+
+   if (ffmpeg_codec_has_pix_fmt(codec, video->pix_fmt))
+      return true;
+
+   for (i = 0; (config = avcodec_get_hw_config(codec, i)); i++)
+      if (config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_FRAMES_CTX)
+         break;
+
+   if (!config)
+      return true;
+
+   /* Surfaces are NV12 rather than planar 4:2:0 */
+   if (video->pix_fmt == AV_PIX_FMT_YUV420P)
+      video->pix_fmt = AV_PIX_FMT_NV12;
+   video->use_sws    = true;
+
+   if ((ret = av_hwdevice_ctx_create(&video->hw_device,
+               config->device_type, NULL, NULL, 0)) < 0)
+      goto error;
+
+   if (!(frames_ref = av_hwframe_ctx_alloc(video->hw_device)))
+   {
+      ret = AVERROR(ENOMEM);
+      goto error;
+   }
+
+   frames                    = (AVHWFramesContext*)frames_ref->data;
+   frames->format            = config->pix_fmt;
+   frames->sw_format         = video->pix_fmt;
+   frames->width             = video->codec->width;
+   frames->height            = video->codec->height;
+   frames->initial_pool_size = 16;
+
+   if ((ret = av_hwframe_ctx_init(frames_ref)) < 0)
+      goto error;
+
+   video->codec->pix_fmt       = config->pix_fmt;
+   video->codec->hw_frames_ctx = frames_ref;
+
+   if (!(video->hw_frame = av_frame_alloc()))
+      return false;
+
+   RARCH_LOG("[FFmpeg] %s encodes from %s surfaces (%s).\n",
+         codec->name, av_hwdevice_get_type_name(config->device_type),
+         av_get_pix_fmt_name(video->pix_fmt));
+   return true;
+
+error:
+   {
+      char msg[AV_ERROR_MAX_STRING_SIZE];
+      av_make_error_string(msg, AV_ERROR_MAX_STRING_SIZE, ret);
+      RARCH_ERR("[FFmpeg] Cannot set up %s device for %s. Error code: %s.\n",
+            av_hwdevice_get_type_name(config->device_type), codec->name, msg);
+   }
+   av_buffer_unref(&frames_ref);
+   return false;
+}
+#endif
+
 static bool ffmpeg_init_video(ffmpeg_t *handle)
 {
    size_t size;
@@ -452,6 +620,11 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
       video->scaler.out_fmt = SCALER_FMT_BGR24;
    }
 
+#if !FFMPEG3
+   if (codec->capabilities & AV_CODEC_CAP_HARDWARE)
+      ffmpeg_hw_resolve_pix_fmt(video, codec);
+#endif
+
    switch (param->pix_fmt)
    {
       case FFEMU_PIX_RGB565:
@@ -506,6 +679,12 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
    if (handle->muxer.ctx->oformat->flags & AVFMT_GLOBALHEADER)
       video->codec->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
 
+#if !FFMPEG3
+   if (     (codec->capabilities & AV_CODEC_CAP_HARDWARE)
+         && !ffmpeg_init_hw_frames(video, codec))
+      return false;
+#endif
+
    if (avcodec_open2(video->codec, codec, params->video_opts ?
             &params->video_opts : NULL) != 0)
       return false;
@@ -690,6 +869,11 @@ static bool ffmpeg_init_config_common(struct ff_config_param *params,
          break;
    }
 
+   /* A live stream is better off holding a frame than stalling
+    * the game */
+   if (preset >= RECORD_CONFIG_TYPE_STREAMING_CUSTOM)
+      params->queue_policy = FF_QUEUE_DUPLICATE;
+
    if (preset <= RECORD_CONFIG_TYPE_RECORDING_LOSSLESS_QUALITY)
    {
       if (!video_gpu_record)
@@ -750,6 +934,7 @@ static bool ffmpeg_init_config(struct ff_config_param *params,
 {
    struct config_file_entry entry;
    char pix_fmt[64]         = {0};
+   char queue_policy[16]    = {0};
 
    params->out_pix_fmt      = AV_PIX_FMT_NONE;
    params->scale_factor     = 1;
@@ -787,6 +972,17 @@ static bool ffmpeg_init_config(struct ff_config_param *params,
    config_get_uint(params->conf, "sample_rate", &params->sample_rate);
    config_get_float(params->conf, "scale_factor", &params->scale_factor);
 
+   if (config_get_array(params->conf, "queue_policy", queue_policy,
+            sizeof(queue_policy)))
+   {
+      if (string_is_equal(queue_policy, "drop"))
+         params->queue_policy = FF_QUEUE_DROP;
+      else if (string_is_equal(queue_policy, "duplicate"))
+         params->queue_policy = FF_QUEUE_DUPLICATE;
+      else
+         params->queue_policy = FF_QUEUE_BLOCK;
+   }
+
    params->audio_qscale = config_get_int(params->conf, "audio_global_quality",
          &params->audio_global_quality);
    config_get_int(params->conf, "audio_bit_rate", &params->audio_bit_rate);
@@ -893,14 +1089,31 @@ static void ffmpeg_thread(void *data);
 
 static bool init_thread(ffmpeg_t *handle)
 {
+   unsigned i;
+   size_t slot_size   = handle->params.fb_width * handle->params.fb_height *
+         handle->video.pix_size;
+
    handle->lock       = slock_new();
    handle->cond_lock  = slock_new();
    handle->cond       = scond_new();
    handle->audio_fifo = fifo_new(32000 * sizeof(int16_t) *
          handle->params.channels * MAX_FRAMES / 60); /* Some arbitrary max size. */
-   handle->attr_fifo  = fifo_new(sizeof(struct record_video_data) * MAX_FRAMES);
-   handle->video_fifo = fifo_new(handle->params.fb_width * handle->params.fb_height *
-         handle->video.pix_size * MAX_FRAMES);
+
+   /* For some reason, FFmpeg has a tendency to crash
+    * if we don't overallocate a bit; one spare slot at the end. */
+   handle->video_slots    = (struct ff_video_slot*)
+      calloc(MAX_FRAMES, sizeof(*handle->video_slots));
+   handle->video_slot_buf = (uint8_t*)av_malloc((MAX_FRAMES + 1) * slot_size);
+
+   if (     !handle->lock || !handle->cond_lock || !handle->cond
+         || !handle->audio_fifo
+         || !handle->video_slots || !handle->video_slot_buf)
+      return false;
+
+   for (i = 0; i < MAX_FRAMES; i++)
+      handle->video_slots[i].data = handle->video_slot_buf + i * slot_size;
+
+   handle->stats.video_capacity = MAX_FRAMES;
 
    handle->alive     = true;
    handle->can_sleep = true;
@@ -926,7 +1139,12 @@ static void deinit_thread(ffmpeg_t *handle)
    slock_free(handle->cond_lock);
    scond_free(handle->cond);
 
-   handle->thread = NULL;
+   /* ffmpeg_flush_buffers() drains the queue on this thread after
+    * this; the lock calls then do nothing */
+   handle->lock      = NULL;
+   handle->cond_lock = NULL;
+   handle->cond      = NULL;
+   handle->thread    = NULL;
 }
 
 static void deinit_thread_buf(ffmpeg_t *handle)
@@ -937,17 +1155,10 @@ static void deinit_thread_buf(ffmpeg_t *handle)
       handle->audio_fifo = NULL;
    }
 
-   if (handle->attr_fifo)
-   {
-      fifo_free(handle->attr_fifo);
-      handle->attr_fifo = NULL;
-   }
-
-   if (handle->video_fifo)
-   {
-      fifo_free(handle->video_fifo);
-      handle->video_fifo = NULL;
-   }
+   free(handle->video_slots);
+   av_free(handle->video_slot_buf);
+   handle->video_slots    = NULL;
+   handle->video_slot_buf = NULL;
 }
 
 static void ffmpeg_free(void *data)
@@ -983,6 +1194,8 @@ static void ffmpeg_free(void *data)
 
    av_frame_free(&handle->video.conv_frame);
    av_free(handle->video.conv_frame_buf);
+   av_frame_free(&handle->video.hw_frame);
+   av_buffer_unref(&handle->video.hw_device);
 
    scaler_ctx_gen_reset(&handle->video.scaler);
 
@@ -1082,7 +1295,7 @@ static bool ffmpeg_push_video(void *data,
       const struct record_video_data *vid)
 {
    unsigned y;
-   struct record_video_data attr_data;
+   struct ff_video_slot *slot;
    bool drop_frame  = false;
    ffmpeg_t *handle = (ffmpeg_t*)data;
    int       offset = 0;
@@ -1100,18 +1313,32 @@ static bool ffmpeg_push_video(void *data,
 
    for (;;)
    {
-      unsigned avail;
+      unsigned queued;
 
       slock_lock(handle->lock);
-      avail = (unsigned)FIFO_WRITE_AVAIL(handle->attr_fifo);
+      queued = handle->video_write - handle->video_read;
       slock_unlock(handle->lock);
 
       if (!handle->alive)
          return false;
 
-      if (avail >= sizeof(*vid))
+      if (queued < MAX_FRAMES)
          break;
 
+      if (handle->config.queue_policy != FF_QUEUE_BLOCK)
+      {
+         slock_lock(handle->lock);
+         if (handle->config.queue_policy == FF_QUEUE_DUPLICATE)
+         {
+            handle->video_held++;
+            handle->stats.video_duplicated++;
+         }
+         else
+            handle->stats.video_dropped++;
+         slock_unlock(handle->lock);
+         return true;
+      }
+
       slock_lock(handle->cond_lock);
       if (handle->can_sleep)
       {
@@ -1125,24 +1352,32 @@ static bool ffmpeg_push_video(void *data,
       slock_unlock(handle->cond_lock);
    }
 
-   slock_lock(handle->lock);
+   /* The encoder thread leaves slots past video_read alone, so the
+    * frame goes in without the lock. */
+   slot              = &handle->video_slots[handle->video_write % MAX_FRAMES];
 
    /* Tightly pack our frame to conserve memory.
     * libretro tends to use a very large pitch.
     */
-   attr_data = *vid;
+   slot->attr        = *vid;
+   slot->attr.data   = slot->data;
+   slot->held        = handle->video_held;
+   handle->video_held = 0;
 
-   if (attr_data.is_dupe)
-      attr_data.width = attr_data.height = attr_data.pitch = 0;
+   if (slot->attr.is_dupe)
+      slot->attr.width = slot->attr.height = slot->attr.pitch = 0;
    else
-      attr_data.pitch = (int)(attr_data.width * handle->video.pix_size);
-
-   fifo_write(handle->attr_fifo, &attr_data, sizeof(attr_data));
+      slot->attr.pitch = (int)(slot->attr.width * handle->video.pix_size);
 
-   for (y = 0; y < attr_data.height; y++, offset += vid->pitch)
-      fifo_write(handle->video_fifo,
-            (const uint8_t*)vid->data + offset, attr_data.pitch);
+   for (y = 0; y < slot->attr.height; y++, offset += vid->pitch)
+      memcpy(slot->data + y * slot->attr.pitch,
+            (const uint8_t*)vid->data + offset, slot->attr.pitch);
 
+   slock_lock(handle->lock);
+   handle->video_write++;
+   handle->stats.video_queued = handle->video_write - handle->video_read;
+   if (handle->stats.video_queued > handle->stats.video_max_queued)
+      handle->stats.video_max_queued = handle->stats.video_queued;
    slock_unlock(handle->lock);
    scond_signal(handle->cond);
 
@@ -1175,6 +1410,14 @@ static bool ffmpeg_push_audio(void *data,
             * sizeof(int16_t))
          break;
 
+      if (handle->config.queue_policy != FF_QUEUE_BLOCK)
+      {
+         slock_lock(handle->lock);
+         handle->stats.audio_dropped += (unsigned)audio_data->frames;
+         slock_unlock(handle->lock);
+         return true;
+      }
+
       slock_lock(handle->cond_lock);
       if (handle->can_sleep)
       {
@@ -1288,18 +1531,55 @@ static void ffmpeg_scale_input(ffmpeg_t *handle,
 static bool ffmpeg_push_video_thread(ffmpeg_t *handle,
       const struct record_video_data *vid)
 {
+   AVFrame *frame = handle->video.conv_frame;
+
    if (!vid->is_dupe)
       ffmpeg_scale_input(handle, vid);
 
-   handle->video.conv_frame->pts = handle->video.frame_cnt;
+   if (handle->video.hw_frame)
+   {
+      int ret;
+
+      frame = handle->video.hw_frame;
+      av_frame_unref(frame);
 
-   if (!encode_video(handle, handle->video.conv_frame))
+      if (     (ret = av_hwframe_get_buffer(
+                  handle->video.codec->hw_frames_ctx, frame, 0)) < 0
+            || (ret = av_hwframe_transfer_data(frame,
+                  handle->video.conv_frame, 0)) < 0)
+      {
+         char msg[AV_ERROR_MAX_STRING_SIZE];
+         av_make_error_string(msg, AV_ERROR_MAX_STRING_SIZE, ret);
+         RARCH_ERR("[FFmpeg] Cannot upload video frame. Error code: %s.\n", msg);
+         return false;
+      }
+   }
+
+   frame->pts = handle->video.frame_cnt;
+
+   if (!encode_video(handle, frame))
       return false;
 
    handle->video.frame_cnt++;
    return true;
 }
 
+/* Encodes the oldest queued frame and frees its slot */
+static void ffmpeg_pop_video(ffmpeg_t *handle)
+{
+   struct ff_video_slot *slot =
+      &handle->video_slots[handle->video_read % MAX_FRAMES];
+
+   /* Leave timestamps free for the frames left out before this one */
+   handle->video.frame_cnt += slot->held;
+   ffmpeg_push_video_thread(handle, &slot->attr);
+
+   slock_lock(handle->lock);
+   handle->video_read++;
+   handle->stats.video_queued = handle->video_write - handle->video_read;
+   slock_unlock(handle->lock);
+}
+
 static void planarize_float(float *out, const float *in, size_t frames)
 {
    size_t i;
@@ -1585,8 +1865,6 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
 {
    void *audio_buf       = NULL;
    bool did_work         = false;
-   void *video_buf       = av_malloc(2 * handle->params.fb_width *
-         handle->params.fb_height * handle->video.pix_size);
    size_t audio_buf_size = handle->config.audio_enable ?
       (handle->audio.codec->frame_size *
        handle->params.channels * sizeof(int16_t)) : 0;
@@ -1598,8 +1876,6 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
 
    do
    {
-      struct record_video_data attr_buf;
-
       did_work = false;
 
       if (handle->config.audio_enable)
@@ -1617,14 +1893,9 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
          }
       }
 
-      if (FIFO_READ_AVAIL(handle->attr_fifo) >= sizeof(attr_buf))
+      if (handle->video_write != handle->video_read)
       {
-         fifo_read(handle->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(handle->video_fifo, video_buf,
-               attr_buf.height * attr_buf.pitch);
-         attr_buf.data = video_buf;
-         ffmpeg_push_video_thread(handle, &attr_buf);
-
+         ffmpeg_pop_video(handle);
          did_work = true;
       }
    }while (did_work);
@@ -1636,7 +1907,6 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
    /* Flush out last video. */
    encode_video(handle, NULL);
 
-   av_free(video_buf);
    av_free(audio_buf);
 }
 
@@ -1664,23 +1934,17 @@ static bool ffmpeg_finalize(void *data)
 static void ffmpeg_thread(void *data)
 {
    ffmpeg_t *ff          = (ffmpeg_t*)data;
-   /* For some reason, FFmpeg has a tendency to crash
-    * if we don't overallocate a bit. */
-   void *video_buf       = av_malloc(2 * ff->params.fb_width *
-         ff->params.fb_height * ff->video.pix_size);
    size_t audio_buf_size = ff->config.audio_enable ?
       (ff->audio.codec->frame_size * ff->params.channels * sizeof(int16_t)) : 0;
    void *audio_buf       = audio_buf_size ? av_malloc(audio_buf_size) : NULL;
 
    while (ff->alive)
    {
-      struct record_video_data attr_buf;
-
       bool avail_video = false;
       bool avail_audio = false;
 
       slock_lock(ff->lock);
-      if (FIFO_READ_AVAIL(ff->attr_fifo) >= sizeof(attr_buf))
+      if (ff->video_write != ff->video_read)
          avail_video = true;
 
       if (ff->config.audio_enable)
@@ -1703,17 +1967,11 @@ static void ffmpeg_thread(void *data)
          slock_unlock(ff->cond_lock);
       }
 
-      if (avail_video && video_buf)
+      if (avail_video)
       {
-         slock_lock(ff->lock);
-         fifo_read(ff->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(ff->video_fifo, video_buf,
-               attr_buf.height * attr_buf.pitch);
-         slock_unlock(ff->lock);
+         /* Encode straight from the slot, then hand it back */
+         ffmpeg_pop_video(ff);
          scond_signal(ff->cond);
-
-         attr_buf.data = video_buf;
-         ffmpeg_push_video_thread(ff, &attr_buf);
       }
 
       if (avail_audio && audio_buf)
@@ -1732,15 +1990,164 @@ static void ffmpeg_thread(void *data)
       }
    }
 
-   av_free(video_buf);
    av_free(audio_buf);
 }
 
+static bool ffmpeg_get_stats(void *data, struct record_stats *stats)
+{
+   ffmpeg_t *handle = (ffmpeg_t*)data;
+
+   if (!handle || !handle->thread)
+      return false;
+
+   slock_lock(handle->lock);
+   *stats = handle->stats;
+   slock_unlock(handle->lock);
+   return true;
+}
+
+/* Each part's timestamps go on from where the longest stream of the
+ * part before ended, so that the streams stay together */
+bool ffmpeg_concat_files(const char *path, const char **parts, size_t count)
+{
+   size_t i;
+   unsigned j;
+   unsigned streams     = 0;
+   int64_t *offset      = NULL;
+   int64_t *end         = NULL;
+   int64_t *lead        = NULL;
+   bool *seen           = NULL;
+   bool ret             = false;
+   bool header          = false;
+   AVFormatContext *out = NULL;
+   AVPacket *pkt        = av_packet_alloc();
+
+   if (     !pkt
+         || avformat_alloc_output_context2(&out, NULL, NULL, path) < 0
+         || !out)
+      goto done;
+
+   for (i = 0; i < count; i++)
+   {
+      int64_t shift       = 0;
+      AVFormatContext *in = NULL;
+
+      if (     avformat_open_input(&in, parts[i], NULL, NULL) < 0
+            || avformat_find_stream_info(in, NULL) < 0)
+      {
+         if (in)
+            avformat_close_input(&in);
+         goto done;
+      }
+
+      if (!header)
+      {
+         streams = in->nb_streams;
+         offset  = (int64_t*)calloc(streams, sizeof(*offset));
+         end     = (int64_t*)calloc(streams, sizeof(*end));
+         lead    = (int64_t*)calloc(streams, sizeof(*lead));
+         seen    = (bool*)calloc(streams, sizeof(*seen));
+         if (!offset || !end || !lead || !seen)
+         {
+            avformat_close_input(&in);
+            goto done;
+         }
+         for (j = 0; j < streams; j++)
+         {
+            AVStream *stream = avformat_new_stream(out, NULL);
+            if (     !stream
+                  || avcodec_parameters_copy(stream->codecpar,
+                     in->streams[j]->codecpar) < 0)
+            {
+               avformat_close_input(&in);
+               goto done;
+            }
+            stream->codecpar->codec_tag = 0;
+            stream->time_base           = in->streams[j]->time_base;
+         }
+         if (     (!(out->oformat->flags & AVFMT_NOFILE)
+                  && avio_open(&out->pb, path, AVIO_FLAG_WRITE) < 0)
+               || avformat_write_header(out, NULL) < 0)
+         {
+            avformat_close_input(&in);
+            goto done;
+         }
+         header = true;
+      }
+      else if (in->nb_streams != streams)
+      {
+         avformat_close_input(&in);
+         goto done;
+      }
+
+      /* Where this part starts, in each stream's time base */
+      for (j = 0; j < streams; j++)
+         shift = MAX(shift, av_rescale_q(end[j],
+                  out->streams[j]->time_base, AV_TIME_BASE_Q));
+      for (j = 0; j < streams; j++)
+      {
+         offset[j] = av_rescale_q(shift, AV_TIME_BASE_Q,
+               out->streams[j]->time_base);
+         seen[j]   = false;
+      }
+
+      while (av_read_frame(in, pkt) >= 0)
+      {
+         j = (unsigned)pkt->stream_index;
+         if (j >= streams)
+         {
+            av_packet_unref(pkt);
+            continue;
+         }
+         av_packet_rescale_ts(pkt, in->streams[j]->time_base,
+               out->streams[j]->time_base);
+         /* Reordered frames may start before 0 */
+         if (!seen[j])
+         {
+            seen[j] = true;
+            lead[j] = (pkt->dts != AV_NOPTS_VALUE && pkt->dts < 0)
+               ? -pkt->dts : 0;
+         }
+         if (pkt->pts != AV_NOPTS_VALUE)
+         {
+            pkt->pts += offset[j] + lead[j];
+            end[j]    = MAX(end[j], pkt->pts + pkt->duration);
+         }
+         if (pkt->dts != AV_NOPTS_VALUE)
+            pkt->dts += offset[j] + lead[j];
+         pkt->pos = -1;
+         if (av_interleaved_write_frame(out, pkt) < 0)
+         {
+            avformat_close_input(&in);
+            goto done;
+         }
+      }
+      avformat_close_input(&in);
+   }
+
+   ret = av_write_trailer(out) >= 0;
+
+done:
+   if (out)
+   {
+      if (out->pb && !(out->oformat->flags & AVFMT_NOFILE))
+         avio_closep(&out->pb);
+      avformat_free_context(out);
+   }
+   av_packet_free(&pkt);
+   free(offset);
+   free(end);
+   free(lead);
+   free(seen);
+   return ret;
+}
+
 const record_driver_t record_ffmpeg = {
    ffmpeg_new,
    ffmpeg_free,
    ffmpeg_push_video,
    ffmpeg_push_audio,
    ffmpeg_finalize,
+   ffmpeg_get_stats,
    "ffmpeg",
 };
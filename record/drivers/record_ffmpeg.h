@@ -20,4 +20,8 @@
 
 extern const record_driver_t record_ffmpeg;
 
+/* Joins recordings with the same streams, one after the other, into
+ * @path without encoding them again */
+bool ffmpeg_concat_files(const char *path, const char **parts, size_t count);
+
 #endif
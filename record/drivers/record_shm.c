@@ -0,0 +1,321 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <file/file_path.h>
+#include <string/stdstring.h>
+#include <retro_miscellaneous.h>
+
+#include "record_shm.h"
+
+#ifdef HAVE_RECORD_SHM
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "../../verbosity.h"
+
+/* Orders the data writes before the sequence that publishes them */
+#if defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) \
+         || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+#define RECORD_SHM_BARRIER() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#elif defined(__GNUC__)
+#define RECORD_SHM_BARRIER() __sync_synchronize()
+#elif defined(_MSC_VER)
+#define RECORD_SHM_BARRIER() MemoryBarrier()
+#else
+#define RECORD_SHM_BARRIER() ((void)0)
+#endif
+
+/* Half a second of audio */
+#define RECORD_SHM_AUDIO_SECONDS_DIV 2
+
+typedef struct
+{
+   record_shm_header_t *header;
+   uint8_t *video;
+   int16_t *audio;
+   size_t size;
+   unsigned bpp;
+#ifdef _WIN32
+   HANDLE mapping;
+#endif
+   char name[64];
+} record_shm_t;
+
+static unsigned record_shm_bpp(enum ffemu_pix_format pix_fmt)
+{
+   switch (pix_fmt)
+   {
+      case FFEMU_PIX_ARGB8888:
+         return 4;
+      case FFEMU_PIX_BGR24:
+         return 3;
+      case FFEMU_PIX_RGB565:
+      default:
+         break;
+   }
+   return 2;
+}
+
+static bool record_shm_map(record_shm_t *handle)
+{
+#ifdef _WIN32
+   char name[80];
+   snprintf(name, sizeof(name), "Local\\%s", handle->name);
+   if (!(handle->mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL,
+               PAGE_READWRITE, (DWORD)((uint64_t)handle->size >> 32),
+               (DWORD)handle->size, name)))
+      return false;
+   if (!(handle->header = (record_shm_header_t*)MapViewOfFile(
+               handle->mapping, FILE_MAP_ALL_ACCESS, 0, 0, handle->size)))
+   {
+      CloseHandle(handle->mapping);
+      handle->mapping = NULL;
+      return false;
+   }
+   return true;
+#else
+   void *ptr;
+   char name[80];
+   int fd;
+
+   snprintf(name, sizeof(name), "/%s", handle->name);
+   if ((fd = shm_open(name, O_CREAT | O_RDWR, 0600)) < 0)
+      return false;
+
+   if (ftruncate(fd, (off_t)handle->size) != 0)
+   {
+      close(fd);
+      shm_unlink(name);
+      return false;
+   }
+
+   ptr = mmap(NULL, handle->size, PROT_READ | PROT_WRITE,
+         MAP_SHARED, fd, 0);
+   close(fd);
+   if (ptr == MAP_FAILED)
+   {
+      shm_unlink(name);
+      return false;
+   }
+   handle->header = (record_shm_header_t*)ptr;
+   return true;
+#endif
+}
+
+static void record_shm_unmap(record_shm_t *handle)
+{
+#ifdef _WIN32
+   if (handle->header)
+      UnmapViewOfFile(handle->header);
+   if (handle->mapping)
+      CloseHandle(handle->mapping);
+   handle->mapping = NULL;
+#else
+   char name[80];
+   if (handle->header)
+      munmap(handle->header, handle->size);
+   snprintf(name, sizeof(name), "/%s", handle->name);
+   shm_unlink(name);
+#endif
+   handle->header = NULL;
+}
+
+static void *record_shm_new(const struct record_params *params)
+{
+   char base[PATH_MAX_LENGTH];
+   size_t video_slot_size, audio_capacity;
+   unsigned channels    = params->channels ? params->channels : 2;
+   record_shm_t *handle = (record_shm_t*)calloc(1, sizeof(*handle));
+
+   if (!handle)
+      return NULL;
+
+   fill_pathname_base(base, params->filename, sizeof(base));
+   path_remove_extension(base);
+   /* macOS caps shm names at 31 characters */
+   strlcpy(handle->name, string_is_empty(base) ? "retroarch" : base,
+         MIN(sizeof(handle->name), 31));
+
+   handle->bpp      = record_shm_bpp(params->pix_fmt);
+   video_slot_size  = (size_t)params->fb_width * params->fb_height
+      * handle->bpp;
+   audio_capacity   = (size_t)params->samplerate
+      / RECORD_SHM_AUDIO_SECONDS_DIV;
+   handle->size     = sizeof(record_shm_header_t)
+      + RECORD_SHM_VIDEO_SLOTS * video_slot_size
+      + audio_capacity * channels * sizeof(int16_t);
+
+   if (!record_shm_map(handle))
+   {
+      RARCH_ERR("[SHM] Cannot create shared memory \"%s\".\n",
+            handle->name);
+      free(handle);
+      return NULL;
+   }
+
+   memset(handle->header, 0, sizeof(*handle->header));
+   handle->video                     = (uint8_t*)(handle->header + 1);
+   handle->audio                     = (int16_t*)(handle->video
+         + RECORD_SHM_VIDEO_SLOTS * video_slot_size);
+   handle->header->header_size       = sizeof(record_shm_header_t);
+   handle->header->pix_fmt           = params->pix_fmt;
+   handle->header->video_slot_size   = (uint32_t)video_slot_size;
+   handle->header->video_max_width   = params->fb_width;
+   handle->header->video_max_height  = params->fb_height;
+   handle->header->audio_rate        = (uint32_t)params->samplerate;
+   handle->header->audio_channels    = channels;
+   handle->header->audio_capacity    = (uint32_t)audio_capacity;
+   handle->header->fps               = params->fps;
+   RECORD_SHM_BARRIER();
+   /* Last, so a reader that sees the magic sees the rest */
+   memcpy(handle->header->magic, RECORD_SHM_MAGIC, sizeof(RECORD_SHM_MAGIC));
+
+   RARCH_LOG("[SHM] Exporting %ux%u frames and audio to \"%s\".\n",
+         params->fb_width, params->fb_height, handle->name);
+   return handle;
+}
+
+static bool record_shm_push_video(void *data,
+      const struct record_video_data *video_data)
+{
+   unsigned y, seq, width, height;
+   size_t pitch;
+   uint8_t *dst;
+   const uint8_t *src;
+   record_shm_slot_t *slot;
+   record_shm_t *handle = (record_shm_t*)data;
+
+   if (!handle || !handle->header)
+      return false;
+   /* Readers keep the last frame */
+   if (video_data->is_dupe || !video_data->data)
+      return true;
+
+   width  = MIN(video_data->width,  handle->header->video_max_width);
+   height = MIN(video_data->height, handle->header->video_max_height);
+   pitch  = (size_t)width * handle->bpp;
+   seq    = handle->header->video_seq + 1;
+   /* 0 marks a slot being written */
+   if (!seq)
+      seq = 1;
+   slot   = &handle->header->slots[seq % RECORD_SHM_VIDEO_SLOTS];
+   dst    = handle->video
+      + (seq % RECORD_SHM_VIDEO_SLOTS) * handle->header->video_slot_size;
+   src    = (const uint8_t*)video_data->data;
+
+   slot->seq = 0;
+   RECORD_SHM_BARRIER();
+
+   /* The GPU path hands over the last row with a negative pitch */
+   for (y = 0; y < height; y++, dst += pitch, src += video_data->pitch)
+      memcpy(dst, src, pitch);
+
+   slot->width  = width;
+   slot->height = height;
+   slot->pitch  = (uint32_t)pitch;
+   RECORD_SHM_BARRIER();
+   slot->seq                   = seq;
+   handle->header->video_seq   = seq;
+   return true;
+}
+
+static bool record_shm_push_audio(void *data,
+      const struct record_audio_data *audio_data)
+{
+   size_t frames, capacity, pos, first;
+   uint64_t written;
+   unsigned channels;
+   const int16_t *src;
+   record_shm_t *handle = (record_shm_t*)data;
+
+   if (!handle || !handle->header || !audio_data->frames)
+      return false;
+
+   capacity = handle->header->audio_capacity;
+   channels = handle->header->audio_channels;
+   frames   = audio_data->frames;
+   src      = (const int16_t*)audio_data->data;
+   written  = handle->header->audio_write;
+   if (!capacity)
+      return false;
+
+   /* Only the newest capacity frames can be kept anyway */
+   if (frames > capacity)
+   {
+      src     += (frames - capacity) * channels;
+      written += frames - capacity;
+      frames   = capacity;
+   }
+
+   pos   = (size_t)(written % capacity);
+   first = MIN(frames, capacity - pos);
+   memcpy(handle->audio + pos * channels, src,
+         first * channels * sizeof(int16_t));
+   if (frames > first)
+      memcpy(handle->audio, src + first * channels,
+            (frames - first) * channels * sizeof(int16_t));
+
+   RECORD_SHM_BARRIER();
+   handle->header->audio_write = written + frames;
+   return true;
+}
+
+static bool record_shm_finalize(void *data)
+{
+   record_shm_t *handle = (record_shm_t*)data;
+   if (!handle || !handle->header)
+      return false;
+   handle->header->closed = 1;
+   return true;
+}
+
+static void record_shm_free(void *data)
+{
+   record_shm_t *handle = (record_shm_t*)data;
+   if (!handle)
+      return;
+
+   if (handle->header)
+   {
+      handle->header->closed = 1;
+      record_shm_unmap(handle);
+   }
+   free(handle);
+}
+
+const record_driver_t record_shm = {
+   record_shm_new,
+   record_shm_free,
+   record_shm_push_video,
+   record_shm_push_audio,
+   record_shm_finalize,
+   NULL,
+   "shm",
+};
+
+#endif
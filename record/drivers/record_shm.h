@@ -0,0 +1,80 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RECORD_SHM_H
+#define _RECORD_SHM_H
+
+#include <stdint.h>
+
+#include "../record_driver.h"
+
+#if (defined(_WIN32) && !defined(_XBOX) && !defined(__WINRT__)) \
+      || (defined(__linux__) && !defined(ANDROID)) \
+      || defined(__APPLE__) || defined(__FreeBSD__)
+#define HAVE_RECORD_SHM
+#endif
+
+/* The "shm" record driver writes video frames and audio into a shared
+ * memory object instead of a file, for other programs on the same host
+ * to read as they come. The object is named after the recording path's
+ * base name: "/<name>" with shm_open, "Local\<name>" as a Windows file
+ * mapping. It holds this header, RECORD_SHM_VIDEO_SLOTS video slots of
+ * video_slot_size bytes each, then the audio ring.
+ *
+ * Video: the writer fills the slot after the newest one, sets its seq,
+ * then video_seq. A reader copies slot (video_seq % RECORD_SHM_VIDEO_SLOTS)
+ * and keeps the copy if the slot's seq was video_seq both before and
+ * after. Rows are packed, pitch bytes apart, top-down, in pix_fmt
+ * (enum ffemu_pix_format).
+ *
+ * Audio: interleaved signed 16-bit samples; audio_write counts the
+ * frames ever written, and frame n is at (n % audio_capacity). A reader
+ * that falls more than audio_capacity behind has lost the difference.
+ *
+ * All fields are in the host's byte order. */
+#define RECORD_SHM_MAGIC       "RASHM01"
+#define RECORD_SHM_VIDEO_SLOTS 3
+
+typedef struct record_shm_slot
+{
+   volatile uint32_t seq;
+   uint32_t width;
+   uint32_t height;
+   uint32_t pitch;
+} record_shm_slot_t;
+
+typedef struct record_shm_header
+{
+   char magic[8];
+   uint32_t header_size;
+   uint32_t pix_fmt;
+   uint32_t video_slot_size;
+   uint32_t video_max_width;
+   uint32_t video_max_height;
+   uint32_t audio_rate;
+   uint32_t audio_channels;
+   uint32_t audio_capacity;
+   double fps;
+   /* Set when the writer stops; readers should let go */
+   volatile uint32_t closed;
+   volatile uint32_t video_seq;
+   volatile uint64_t audio_write;
+   record_shm_slot_t slots[RECORD_SHM_VIDEO_SLOTS];
+} record_shm_header_t;
+
+#ifdef HAVE_RECORD_SHM
+extern const record_driver_t record_shm;
+#endif
+
+#endif
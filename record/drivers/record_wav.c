@@ -196,5 +196,6 @@ const record_driver_t record_wav = {
    NULL,
    record_wav_push_audio,
    record_wav_finalize,
+   NULL,
    "wav",
 };
@@ -33,6 +33,7 @@
 #include "record_driver.h"
 #include "drivers/record_ffmpeg.h"
 #include "drivers/record_wav.h"
+#include "drivers/record_shm.h"
 
 static recording_state_t recording_state = {0};
 
@@ -42,6 +43,7 @@ static const record_driver_t record_null = {
    NULL, /* push_video */
    NULL, /* push_audio */
    NULL, /* finalize */
+   NULL, /* get_stats */
    "null",
 };
 
@@ -50,6 +52,9 @@ const record_driver_t *record_drivers[] = {
    &record_ffmpeg,
 #endif
    &record_wav,
+#ifdef HAVE_RECORD_SHM
+   &record_shm,
+#endif
    &record_null,
    NULL,
 };
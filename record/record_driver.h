@@ -98,6 +98,20 @@ struct record_audio_data
    size_t frames;
 };
 
+struct record_stats
+{
+   /* Video frames waiting for the encoder, out of video_capacity */
+   unsigned video_queued;
+   unsigned video_max_queued;
+   unsigned video_capacity;
+   /* Frames the encoder had no room for; see the queue_policy
+    * setting of the FFmpeg config */
+   unsigned video_dropped;
+   unsigned video_duplicated;
+   /* Audio frames */
+   unsigned audio_dropped;
+};
+
 typedef struct record_driver
 {
    void *(*init)(const struct record_params *params);
@@ -107,6 +121,8 @@ typedef struct record_driver
    bool  (*push_audio)(void *data,
          const struct record_audio_data *audio_data);
    bool  (*finalize)(void *data);
+   /* Optional; false when there's nothing to report */
+   bool  (*get_stats)(void *data, struct record_stats *stats);
    const char *ident;
 } record_driver_t;
 
@@ -1,7 +1,12 @@
 #!/usr/bin/env python3
+import hashlib
+import hmac
 import os
 import socket
+import struct
+import threading
 import time
+from http.server import BaseHTTPRequestHandler, HTTPServer
 
 DEFAULT_MAGIC = "RARELAY1"
 
@@ -11,6 +16,29 @@ DEFAULT_SESSION_TTL = 120.0
 DEFAULT_CLIENT_TTL = 30.0
 DEFAULT_MAX_SESSIONS = 512
 DEFAULT_MAX_PACKET = 8192
+DEFAULT_BCAST_MAX_FRAMES = 216000
+DEFAULT_BCAST_MAX_SPECTATORS = 256
+DEFAULT_BCAST_MAX_KEYFRAME = 64 * 1024 * 1024
+
+# Spectator broadcast (see README.md).  Binary, so it can't be confused with
+# the text control channel or with the GGPO packets being forwarded.
+BCAST_MAGIC = b"RABCAST1"
+BCAST_MAX_PACKET = 1200
+BCAST_KEY_CHUNK = 1024
+BCAST_KEY_WINDOW = 16
+BCAST_KEY_HEADER = struct.Struct("<IBIII")   # frame, codec, raw size, size, offset
+
+# Session tagged GGPO traffic (ggpo_start_relay_session, see README.md):
+# the magic, the sender's slot, a length byte and the session id, then the
+# GGPO packet.  The tag, not the address, says which match it belongs to.
+MUX_MAGIC = b"RAMUXGG1"
+
+# Per-session stream telemetry.  Rates and loss are over STATS_WINDOW
+# seconds; latency and jitter are RFC 3550 style running averages.
+STATS_WINDOW = 5.0
+STATS_GAIN = 1.0 / 16.0
+GGPO_HEADER = struct.Struct("<HHB")   # UdpMsg hdr: magic, sequence_number, type
+SEQ_WINDOW = 64
 
 
 def _load_env_file():
@@ -80,6 +108,198 @@ def _get_env_int(name, default):
         return int(default)
 
 
+def _new_stream_stats(now):
+    return {
+        "packets": 0,
+        "bytes": 0,
+        "lost": 0,
+        "forward_us": 0.0,
+        "jitter_us": 0.0,
+        "last_arrival": None,
+        "last_gap": None,
+        "seq_high": None,
+        "seq_seen": 0,
+        "window_start": now,
+        "window_bytes": 0,
+        "window_max_us": 0.0,
+        "window_expected": 0,
+        "window_received": 0,
+        "bytes_per_sec": 0.0,
+        "forward_max_us": 0.0,
+        "loss_percent": 0.0,
+    }
+
+
+def _track_sequence(stats, data):
+    # GGPO numbers each packet per endpoint; FEC copies reuse the number, so
+    # repeats and late arrivals inside SEQ_WINDOW fill holes instead of
+    # counting as new packets.
+    if len(data) < GGPO_HEADER.size:
+        return
+    seq = GGPO_HEADER.unpack_from(data)[1]
+    high = stats["seq_high"]
+    if high is None:
+        stats["seq_high"] = seq
+        stats["seq_seen"] = 1
+        stats["window_expected"] += 1
+        stats["window_received"] += 1
+        return
+    ahead = (seq - high) & 0xffff
+    if ahead == 0:
+        return
+    if ahead < 0x8000:
+        if ahead >= SEQ_WINDOW:
+            stats["seq_seen"] = 0
+        missing = ahead - 1
+        stats["seq_seen"] = ((stats["seq_seen"] << ahead) | 1) & ((1 << SEQ_WINDOW) - 1)
+        stats["seq_high"] = seq
+        stats["lost"] += missing
+        stats["window_expected"] += ahead
+        stats["window_received"] += 1
+        return
+    behind = (high - seq) & 0xffff
+    if behind < SEQ_WINDOW and not stats["seq_seen"] & (1 << behind):
+        stats["seq_seen"] |= 1 << behind
+        stats["lost"] = max(0, stats["lost"] - 1)
+        stats["window_received"] += 1
+
+
+def _record_forward(stats, data, arrival, sent, now):
+    size = len(data)
+    stats["packets"] += 1
+    stats["bytes"] += size
+    stats["window_bytes"] += size
+
+    forward_us = max(0.0, (sent - arrival) * 1e6)
+    stats["forward_us"] += (forward_us - stats["forward_us"]) * STATS_GAIN
+    stats["window_max_us"] = max(stats["window_max_us"], forward_us)
+
+    last = stats["last_arrival"]
+    if last is not None:
+        gap = arrival - last
+        if stats["last_gap"] is not None:
+            delta = abs(gap - stats["last_gap"]) * 1e6
+            stats["jitter_us"] += (delta - stats["jitter_us"]) * STATS_GAIN
+        stats["last_gap"] = gap
+    stats["last_arrival"] = arrival
+
+    _track_sequence(stats, data)
+    _roll_stats_window(stats, now)
+
+
+def _roll_stats_window(stats, now):
+    elapsed = now - stats["window_start"]
+    if elapsed < STATS_WINDOW:
+        return
+    stats["bytes_per_sec"] = stats["window_bytes"] / elapsed
+    stats["forward_max_us"] = stats["window_max_us"]
+    expected = stats["window_expected"]
+    received = min(stats["window_received"], expected)
+    stats["loss_percent"] = (
+        100.0 * (expected - received) / expected if expected else 0.0)
+    stats["window_start"] = now
+    stats["window_bytes"] = 0
+    stats["window_max_us"] = 0.0
+    stats["window_expected"] = 0
+    stats["window_received"] = 0
+
+
+STATS_FIELDS = (
+    ("bps", "bytes_per_sec", "{:.0f}"),
+    ("fwd_us", "forward_us", "{:.0f}"),
+    ("fwd_max_us", "forward_max_us", "{:.0f}"),
+    ("jitter_us", "jitter_us", "{:.0f}"),
+    ("loss_pct", "loss_percent", "{:.1f}"),
+    ("lost", "lost", "{}"),
+)
+
+
+def _format_stats(session):
+    # Same four leading counters as the C relay, then the telemetry per slot.
+    one, two = session["stats"][1], session["stats"][2]
+    fields = ["{} {} {} {}".format(
+        one["packets"], one["bytes"], two["packets"], two["bytes"])]
+    for slot, stats in ((1, one), (2, two)):
+        for name, key, fmt in STATS_FIELDS:
+            fields.append("{}{}={}".format(name, slot, fmt.format(stats[key])))
+    return " ".join(fields)
+
+
+def _format_metrics(sessions, now):
+    lines = [
+        "# TYPE relay_sessions gauge",
+        "relay_sessions {}".format(len(sessions)),
+    ]
+    metrics = (
+        ("relay_packets_total", "counter", "packets"),
+        ("relay_bytes_total", "counter", "bytes"),
+        ("relay_lost_packets_total", "counter", "lost"),
+        ("relay_bytes_per_second", "gauge", "bytes_per_sec"),
+        ("relay_forward_microseconds", "gauge", "forward_us"),
+        ("relay_forward_max_microseconds", "gauge", "forward_max_us"),
+        ("relay_jitter_microseconds", "gauge", "jitter_us"),
+        ("relay_loss_percent", "gauge", "loss_percent"),
+    )
+    snapshot = list(sessions.items())
+    for name, kind, key in metrics:
+        lines.append("# TYPE {} {}".format(name, kind))
+        for session_id, session in snapshot:
+            for slot in (1, 2):
+                stats = session["stats"][slot]
+                _roll_stats_window(stats, now)
+                lines.append('{}{{session="{}",slot="{}"}} {}'.format(
+                    name, session_id.replace("\\", "\\\\").replace('"', '\\"'),
+                    slot, stats[key]))
+    return "\n".join(lines) + "\n"
+
+
+def _start_metrics_server(bind_addr, port, sessions):
+    class Handler(BaseHTTPRequestHandler):
+        def do_GET(self):
+            if self.path.split("?", 1)[0] != "/metrics":
+                self.send_error(404)
+                return
+            body = _format_metrics(sessions, _now()).encode("utf-8")
+            self.send_response(200)
+            self.send_header("Content-Type", "text/plain; version=0.0.4")
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+
+        def log_message(self, fmt, *args):
+            return
+
+    server = HTTPServer((bind_addr, port), Handler)
+    thread = threading.Thread(target=server.serve_forever, daemon=True)
+    thread.start()
+    return server
+
+
+def _enable_rx_timestamps(sock):
+    # Kernel receive times include the queueing an overloaded relay adds.
+    option = getattr(socket, "SO_TIMESTAMPNS", None)
+    if option is None:
+        return False
+    try:
+        sock.setsockopt(socket.SOL_SOCKET, option, 1)
+    except OSError:
+        return False
+    return True
+
+
+def _recv(sock, max_packet, rx_timestamps):
+    if not rx_timestamps:
+        data, addr = sock.recvfrom(max_packet)
+        return data, addr, time.time()
+    data, ancdata, _flags, addr = sock.recvmsg(max_packet, socket.CMSG_SPACE(16))
+    for level, kind, cdata in ancdata:
+        if (level == socket.SOL_SOCKET and kind == socket.SO_TIMESTAMPNS
+                and len(cdata) >= 16):
+            sec, nsec = struct.unpack_from("qq", cdata)
+            return data, addr, sec + nsec / 1e9
+    return data, addr, time.time()
+
+
 def _parse_cmd(data):
     if not data.startswith(MAGIC_PREFIX):
         return None
@@ -100,6 +320,28 @@ def _parse_cmd(data):
     return cmd, session, slot
 
 
+def _check_token(token, secret):
+    """Returns (session_id, slot) for a lobby pairing token, or an error
+    reason (see lobby-server/README.md for the format)."""
+    if not secret:
+        return "no_token_secret"
+    parts = token.split(".")
+    if len(parts) != 4 or parts[1] not in ("1", "2"):
+        return "bad_token"
+    body = ".".join(parts[:3])
+    mac = hmac.new(secret.encode("utf-8"), body.encode("ascii"),
+                   hashlib.sha256).hexdigest()[:16]
+    if not hmac.compare_digest(mac, parts[3].lower()):
+        return "bad_token"
+    try:
+        expiry = int(parts[2], 10)
+    except ValueError:
+        return "bad_token"
+    if expiry < time.time():
+        return "expired_token"
+    return parts[0], parts[1]
+
+
 def _send_response(sock, addr, text):
     payload = (text + "\n").encode("ascii", "replace")
     sock.sendto(payload, addr)
@@ -117,6 +359,57 @@ def _remove_client(address_map, sessions, addr):
         session["clients"][slot] = None
 
 
+def _parse_mux(data):
+    header = len(MUX_MAGIC) + 2
+    if len(data) < header or not data.startswith(MUX_MAGIC):
+        return None
+    slot = data[len(MUX_MAGIC)]
+    session_len = data[len(MUX_MAGIC) + 1]
+    if slot not in (1, 2) or session_len == 0 or len(data) < header + session_len:
+        return None
+    session_id = data[header:header + session_len].decode("ascii", "replace")
+    return session_id, slot, header + session_len
+
+
+def _handle_mux(sock, sessions, packet, data, addr, arrival, now, limits):
+    # The first tagged packet for a slot registers it, like a HELLO; a slot
+    # that has been silent for client_ttl can be taken over by a new address.
+    session_id, slot, offset = packet
+    max_sessions, client_ttl = limits
+    session = sessions.get(session_id)
+    if session is None:
+        if len(sessions) >= max_sessions:
+            return
+        session = {
+            "clients": {1: None, 2: None},
+            "stats": {1: _new_stream_stats(now), 2: _new_stream_stats(now)},
+            "updated": now,
+        }
+        sessions[session_id] = session
+
+    client = session["clients"][slot]
+    if client and client["addr"] != addr:
+        if not client.get("mux") or now - client["last_seen"] <= client_ttl:
+            return
+        client = None
+    if client is None:
+        client = {"addr": addr, "last_seen": now, "mux": True}
+        session["clients"][slot] = client
+        session["stats"][slot] = _new_stream_stats(now)
+    client["last_seen"] = now
+    session["updated"] = now
+
+    other = session["clients"][2 if slot == 1 else 1]
+    if not other or not other.get("mux"):
+        return
+    try:
+        sock.sendto(data, other["addr"])
+    except OSError:
+        return
+    _record_forward(session["stats"][slot], data[offset:], arrival,
+                    time.time(), now)
+
+
 def _prune_sessions(address_map, sessions, now, client_ttl, session_ttl):
     for session_id in list(sessions.keys()):
         session = sessions[session_id]
@@ -124,13 +417,237 @@ def _prune_sessions(address_map, sessions, now, client_ttl, session_ttl):
             if not client:
                 continue
             if now - client["last_seen"] > client_ttl:
-                address_map.pop(client["addr"], None)
+                if not client.get("mux"):
+                    address_map.pop(client["addr"], None)
                 session["clients"][slot] = None
         if session["clients"][1] is None and session["clients"][2] is None:
             if now - session["updated"] > session_ttl:
                 sessions.pop(session_id, None)
 
 
+def _parse_bcast(data):
+    header = len(BCAST_MAGIC) + 2
+    if len(data) < header or not data.startswith(BCAST_MAGIC):
+        return None
+    kind = data[len(BCAST_MAGIC):len(BCAST_MAGIC) + 1]
+    session_len = data[len(BCAST_MAGIC) + 1]
+    if len(data) < header + session_len:
+        return None
+    session_id = data[header:header + session_len]
+    return kind, session_id, data[header + session_len:]
+
+
+def _bcast_header(kind, session_id):
+    return BCAST_MAGIC + kind + bytes((len(session_id),)) + session_id
+
+
+def _bcast_push(sock, bcast, session_id, addr, spectator):
+    # Sends the spectator what it asked for and the relay has, oldest first.
+    size = bcast["frame_size"]
+    header = _bcast_header(b"F", session_id)
+    per_packet = min(255, (BCAST_MAX_PACKET - len(header) - 7) // size)
+    end = min(bcast["next"], spectator["limit"])
+    while spectator["next"] < end:
+        first = spectator["next"]
+        index = first - bcast["base"]
+        if index < 0 or bcast["frames"][index] is None:
+            oldest = bcast["base"]
+            while (oldest < bcast["next"]
+                   and bcast["frames"][oldest - bcast["base"]] is None):
+                oldest += 1
+            sock.sendto(_bcast_header(b"G", session_id)
+                        + struct.pack("<I", oldest), addr)
+            spectator["limit"] = first
+            return
+        count = 0
+        while (count < per_packet and first + count < end
+               and bcast["frames"][index + count] is not None):
+            count += 1
+        payload = b"".join(bcast["frames"][index:index + count])
+        try:
+            sock.sendto(header + struct.pack("<IHB", first, size, count)
+                        + payload, addr)
+        except OSError:
+            return
+        spectator["next"] = first + count
+    if bcast["ended"] is not None:
+        sock.sendto(_bcast_header(b"E", session_id)
+                    + struct.pack("<I", bcast["ended"]), addr)
+
+
+def _bcast_key_push(sock, bcast, session_id, addr, frame, offset):
+    # Up to a window of the keyframe from offset, or from the start if the
+    # spectator was fetching an older one.  Size 0 says there is none.
+    header = _bcast_header(b"K", session_id)
+    key = bcast["keyframe"] if bcast else None
+    if key is not None and key["frame"] < bcast["base"]:
+        key = None
+    if key is None:
+        sock.sendto(header + BCAST_KEY_HEADER.pack(0, 0, 0, 0, 0), addr)
+        return
+    data = key["data"]
+    if frame != key["frame"] or offset > len(data):
+        offset = 0
+    for _ in range(BCAST_KEY_WINDOW):
+        if offset >= len(data):
+            break
+        chunk = data[offset:offset + BCAST_KEY_CHUNK]
+        try:
+            sock.sendto(header + BCAST_KEY_HEADER.pack(
+                key["frame"], key["codec"], key["raw_size"], len(data), offset)
+                + chunk, addr)
+        except OSError:
+            return
+        offset += len(chunk)
+
+
+def _handle_bcast_key(sock, bcast, session_id, body, addr, max_keyframe):
+    # A chunk of the host's next keyframe.  Chunks are kept in order; the
+    # ack says how far the relay got, and the upload replaces the current
+    # keyframe once it is all in.
+    if len(body) < BCAST_KEY_HEADER.size:
+        return
+    frame, codec, raw_size, size, offset = BCAST_KEY_HEADER.unpack_from(body)
+    if size == 0 or size > max_keyframe:
+        return
+    chunk = body[BCAST_KEY_HEADER.size:]
+    key = bcast["keyframe"]
+    if key is not None and key["frame"] == frame:
+        have = len(key["data"])
+    else:
+        upload = bcast["key_upload"]
+        if upload is None or upload["frame"] != frame or upload["size"] != size:
+            upload = {
+                "frame": frame,
+                "codec": codec,
+                "raw_size": raw_size,
+                "size": size,
+                "data": bytearray(),
+            }
+            bcast["key_upload"] = upload
+        if offset == len(upload["data"]) and offset + len(chunk) <= size:
+            upload["data"] += chunk
+        have = len(upload["data"])
+        if have == size:
+            upload["data"] = bytes(upload["data"])
+            bcast["keyframe"] = upload
+            bcast["key_upload"] = None
+    try:
+        sock.sendto(_bcast_header(b"k", session_id)
+                    + struct.pack("<II", frame, have), addr)
+    except OSError:
+        pass
+
+
+def _handle_bcast(sock, bcasts, packet, addr, now, limits):
+    kind, session_id, body = packet
+    max_sessions, max_frames, max_spectators, client_ttl, max_keyframe = limits
+    bcast = bcasts.get(session_id)
+
+    if kind in (b"F", b"B", b"K"):
+        if bcast is None:
+            if len(bcasts) >= max_sessions or kind == b"B":
+                return
+            bcast = {
+                "host": None,
+                "host_seen": 0.0,
+                "frame_size": 0,
+                "base": 0,
+                "next": 0,
+                "frames": [],
+                "ended": None,
+                "spectators": {},
+                "keyframe": None,
+                "key_upload": None,
+                "updated": now,
+            }
+            bcasts[session_id] = bcast
+        if bcast["host"] != addr:
+            if bcast["host"] is not None and now - bcast["host_seen"] <= client_ttl:
+                return
+            bcast["host"] = addr
+        bcast["host_seen"] = now
+        bcast["updated"] = now
+
+        if kind == b"B":
+            if len(body) >= 4:
+                bcast["ended"] = struct.unpack_from("<I", body)[0]
+                for spec_addr, spectator in bcast["spectators"].items():
+                    _bcast_push(sock, bcast, session_id, spec_addr, spectator)
+            return
+
+        if kind == b"K":
+            _handle_bcast_key(sock, bcast, session_id, body, addr, max_keyframe)
+            return
+
+        if len(body) < 7:
+            return
+        first, size, count = struct.unpack_from("<IHB", body)
+        if size == 0 or len(body) < 7 + count * size:
+            return
+        if bcast["frame_size"] == 0:
+            bcast["frame_size"] = size
+        if size != bcast["frame_size"]:
+            return
+        if count and first > bcast["next"]:
+            # The host had to drop frames it could not get acked; spectators
+            # that reach the hole are told the stream is gone.
+            bcast["frames"].extend([None] * (first - bcast["next"]))
+            bcast["next"] = first
+        for i in range(count):
+            if first + i == bcast["next"]:
+                offset = 7 + i * size
+                bcast["frames"].append(body[offset:offset + size])
+                bcast["next"] += 1
+        excess = len(bcast["frames"]) - max_frames
+        if excess > 0:
+            del bcast["frames"][:excess]
+            bcast["base"] += excess
+        try:
+            sock.sendto(_bcast_header(b"A", session_id) + struct.pack(
+                "<IH", bcast["next"], min(len(bcast["spectators"]), 0xffff)),
+                addr)
+        except OSError:
+            pass
+        for spec_addr, spectator in bcast["spectators"].items():
+            _bcast_push(sock, bcast, session_id, spec_addr, spectator)
+        return
+
+    if kind == b"S":
+        if bcast is None or len(body) < 8:
+            return
+        frame, offset = struct.unpack_from("<II", body)
+        bcast["updated"] = now
+        _bcast_key_push(sock, bcast, session_id, addr, frame, offset)
+        return
+
+    if kind == b"J":
+        if bcast is None or bcast["frame_size"] == 0 or len(body) < 6:
+            return
+        from_frame, window = struct.unpack_from("<IH", body)
+        spectator = bcast["spectators"].get(addr)
+        if spectator is None:
+            if len(bcast["spectators"]) >= max_spectators:
+                return
+            spectator = {}
+            bcast["spectators"][addr] = spectator
+        spectator["next"] = from_frame
+        spectator["limit"] = from_frame + window
+        spectator["last_seen"] = now
+        bcast["updated"] = now
+        _bcast_push(sock, bcast, session_id, addr, spectator)
+
+
+def _prune_bcasts(bcasts, now, client_ttl, session_ttl):
+    for session_id in list(bcasts.keys()):
+        bcast = bcasts[session_id]
+        for addr, spectator in list(bcast["spectators"].items()):
+            if now - spectator["last_seen"] > client_ttl:
+                bcast["spectators"].pop(addr, None)
+        if now - bcast["updated"] > session_ttl:
+            bcasts.pop(session_id, None)
+
+
 def main():
     bind_addr = os.getenv("RELAY_BIND", DEFAULT_BIND)
     port = _get_env_int("RELAY_PORT", DEFAULT_PORT)
@@ -138,22 +655,39 @@ def main():
     client_ttl = _get_env_float("RELAY_CLIENT_TTL", DEFAULT_CLIENT_TTL)
     max_sessions = _get_env_int("RELAY_MAX_SESSIONS", DEFAULT_MAX_SESSIONS)
     max_packet = _get_env_int("RELAY_MAX_PACKET", DEFAULT_MAX_PACKET)
+    bcast_max_frames = _get_env_int("RELAY_BCAST_MAX_FRAMES",
+                                    DEFAULT_BCAST_MAX_FRAMES)
+    bcast_max_spectators = _get_env_int("RELAY_BCAST_MAX_SPECTATORS",
+                                        DEFAULT_BCAST_MAX_SPECTATORS)
+    bcast_max_keyframe = _get_env_int("RELAY_BCAST_MAX_KEYFRAME",
+                                      DEFAULT_BCAST_MAX_KEYFRAME)
+    metrics_bind = os.getenv("RELAY_METRICS_BIND", "127.0.0.1")
+    metrics_port = _get_env_int("RELAY_METRICS_PORT", 0)
+    token_secret = os.getenv("RELAY_TOKEN_SECRET", "")
 
     sessions = {}
     address_map = {}
+    bcasts = {}
     last_prune = 0.0
+    bcast_limits = (max_sessions, max(1, bcast_max_frames),
+                    bcast_max_spectators, client_ttl, bcast_max_keyframe)
 
     sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
     sock.bind((bind_addr, port))
     sock.settimeout(1.0)
+    rx_timestamps = _enable_rx_timestamps(sock)
 
     print("GGPO relay listening on {}:{} (ttl={}s)".format(
         bind_addr, port, session_ttl
     ))
+    if metrics_port > 0:
+        _start_metrics_server(metrics_bind, metrics_port, sessions)
+        print("Metrics on http://{}:{}/metrics".format(
+            metrics_bind, metrics_port))
 
     while True:
         try:
-            data, addr = sock.recvfrom(max_packet)
+            data, addr, arrival = _recv(sock, max_packet, rx_timestamps)
         except socket.timeout:
             data = None
             addr = None
@@ -163,14 +697,35 @@ def main():
         now = _now()
         if now - last_prune > 1.0:
             _prune_sessions(address_map, sessions, now, client_ttl, session_ttl)
+            _prune_bcasts(bcasts, now, client_ttl, session_ttl)
             last_prune = now
 
         if not data:
             continue
 
+        bcast_packet = _parse_bcast(data)
+        if bcast_packet:
+            _handle_bcast(sock, bcasts, bcast_packet, addr, now, bcast_limits)
+            continue
+
+        mux_packet = _parse_mux(data)
+        if mux_packet:
+            _handle_mux(sock, sessions, mux_packet, data, addr, arrival, now,
+                        (max_sessions, client_ttl))
+            continue
+
         cmd = _parse_cmd(data)
         if cmd:
             command, session_id, slot_token = cmd
+            if command == "TOKEN":
+                # A lobby-signed HELLO: the token names the session and slot.
+                checked = _check_token(session_id, token_secret)
+                if isinstance(checked, str):
+                    _send_response(sock, addr, "{} ERR {} {}".format(
+                        MAGIC_TEXT, session_id, checked))
+                    continue
+                command = "HELLO"
+                session_id, slot_token = checked
             session = sessions.get(session_id)
             if command == "HELLO":
                 if session is None:
@@ -180,6 +735,8 @@ def main():
                         continue
                     session = {
                         "clients": {1: None, 2: None},
+                        "stats": {1: _new_stream_stats(now),
+                                  2: _new_stream_stats(now)},
                         "updated": now,
                     }
                     sessions[session_id] = session
@@ -200,6 +757,8 @@ def main():
                     continue
 
                 _remove_client(address_map, sessions, addr)
+                if not current:
+                    session["stats"][slot] = _new_stream_stats(now)
                 session["clients"][slot] = {"addr": addr, "last_seen": now}
                 session["updated"] = now
                 address_map[addr] = (session_id, slot)
@@ -209,6 +768,13 @@ def main():
                 _send_response(sock, addr, "{} {} {} {}".format(
                     MAGIC_TEXT, status, session_id, slot
                 ))
+                # Tell the side that was waiting now rather than on its next
+                # HELLO.
+                if ready and not current:
+                    other_slot = 2 if slot == 1 else 1
+                    _send_response(sock, session["clients"][other_slot]["addr"],
+                                   "{} READY {} {}".format(
+                                       MAGIC_TEXT, session_id, other_slot))
                 continue
 
             if command == "BYE":
@@ -229,6 +795,17 @@ def main():
                     MAGIC_TEXT, session_id))
                 continue
 
+            if command == "STATS":
+                if session is None:
+                    _send_response(sock, addr, "{} ERR {} unknown_session".format(
+                        MAGIC_TEXT, session_id))
+                    continue
+                for stats in session["stats"].values():
+                    _roll_stats_window(stats, now)
+                _send_response(sock, addr, "{} STATS {} {}".format(
+                    MAGIC_TEXT, session_id, _format_stats(session)))
+                continue
+
             _send_response(sock, addr, "{} ERR {} unknown_command".format(
                 MAGIC_TEXT, session_id))
             continue
@@ -254,6 +831,7 @@ def main():
             sock.sendto(data, other["addr"])
         except OSError:
             continue
+        _record_forward(session["stats"][slot], data, arrival, time.time(), now)
 
 
 if __name__ == "__main__":
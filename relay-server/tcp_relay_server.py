@@ -3,6 +3,7 @@ import asyncio
 import base64
 import ipaddress
 import os
+import socket
 import struct
 import time
 
@@ -18,6 +19,11 @@ DEFAULT_BIND = "0.0.0.0"
 DEFAULT_PORT = 7002
 DEFAULT_PENDING_TTL = 30.0
 DEFAULT_MAX_SESSIONS = 512
+DEFAULT_SPLICE = 1
+
+COPY_CHUNK = 4096
+# Matches the default pipe capacity, so one splice fills the pipe
+SPLICE_CHUNK = 65536
 
 
 def _load_env_file():
@@ -134,6 +140,10 @@ class Session:
         "link_addresses",
         "created",
         "last_seen",
+        "bytes_to_host",
+        "bytes_to_client",
+        "links_spliced",
+        "links_copied",
     )
 
     def __init__(self, session_id, host_reader, host_writer):
@@ -145,12 +155,27 @@ class Session:
         self.link_addresses = {}
         self.created = _now()
         self.last_seen = self.created
+        self.bytes_to_host = 0
+        self.bytes_to_client = 0
+        self.links_spliced = 0
+        self.links_copied = 0
 
 
-class RelayState:
+class LinkStats:
+    """Bytes one bridged pair has forwarded each way."""
+
+    __slots__ = ("to_host", "to_client")
+
     def __init__(self):
+        self.to_host = 0
+        self.to_client = 0
+
+
+class RelayState:
+    def __init__(self, splice=False):
         self.sessions = {}
         self.link_to_session = {}
+        self.splice = splice
 
 
 async def _safe_close(writer):
@@ -165,27 +190,153 @@ async def _safe_close(writer):
         return
 
 
-async def _bridge(client, host_link):
-    async def pipe(reader, writer):
-        try:
-            while True:
-                data = await reader.read(4096)
-                if not data:
+def _wake(future):
+    if not future.done():
+        future.set_result(None)
+
+
+async def _wait_fd(loop, fd, writable):
+    future = loop.create_future()
+    if writable:
+        loop.add_writer(fd, _wake, future)
+    else:
+        loop.add_reader(fd, _wake, future)
+    try:
+        await future
+    finally:
+        if writable:
+            loop.remove_writer(fd)
+        else:
+            loop.remove_reader(fd)
+
+
+def _detachable(reader, writer):
+    # A plain socket with nothing left to send, and a reader buffer we
+    # can take over
+    return (
+        writer.get_extra_info("socket") is not None
+        and getattr(reader, "_buffer", None) is not None
+        and not writer.transport.get_write_buffer_size()
+    )
+
+
+async def _detach(reader, writer):
+    # Takes the socket away from its transport, along with whatever the
+    # reader had already buffered past the tunnel header.
+    writer.transport.pause_reading()
+    data = bytes(reader._buffer)
+    reader._buffer.clear()
+    sock = socket.socket(fileno=os.dup(writer.get_extra_info("socket").fileno()))
+    sock.setblocking(False)
+    await _safe_close(writer)
+    return sock, data
+
+
+async def _copy(reader, writer, stats, attr):
+    try:
+        while True:
+            data = await reader.read(COPY_CHUNK)
+            if not data:
+                break
+            writer.write(data)
+            await writer.drain()
+            setattr(stats, attr, getattr(stats, attr) + len(data))
+    except (OSError, asyncio.CancelledError):
+        return
+
+
+async def _splice(loop, src, dst, early, stats, attr):
+    # Socket to pipe to socket, so the payload stays in the kernel; the
+    # sockets are non-blocking, SPLICE_F_NONBLOCK covers the pipe.
+    flags = os.SPLICE_F_MOVE | os.SPLICE_F_NONBLOCK
+    read_fd, write_fd = os.pipe()
+    os.set_blocking(read_fd, False)
+    os.set_blocking(write_fd, False)
+    queued = 0
+    try:
+        if early:
+            await loop.sock_sendall(dst, early)
+            setattr(stats, attr, getattr(stats, attr) + len(early))
+        while True:
+            if not queued:
+                try:
+                    queued = os.splice(src.fileno(), write_fd, SPLICE_CHUNK,
+                                       flags=flags)
+                except BlockingIOError:
+                    await _wait_fd(loop, src.fileno(), False)
+                    continue
+                if not queued:
                     break
-                writer.write(data)
-                await writer.drain()
-        except (OSError, asyncio.CancelledError):
-            return
+            try:
+                sent = os.splice(read_fd, dst.fileno(), queued, flags=flags)
+            except BlockingIOError:
+                await _wait_fd(loop, dst.fileno(), True)
+                continue
+            queued -= sent
+            setattr(stats, attr, getattr(stats, attr) + sent)
+    except (OSError, asyncio.CancelledError):
+        return
+    finally:
+        os.close(read_fd)
+        os.close(write_fd)
+
+
+async def _bridge(session, link_id, client, host_link, use_splice):
+    loop = asyncio.get_running_loop()
+    stats = LinkStats()
+    started = _now()
+    sockets = None
+
+    if (
+        use_splice
+        and _detachable(client.reader, client.writer)
+        and _detachable(host_link.reader, host_link.writer)
+    ):
+        client_sock, client_early = await _detach(client.reader, client.writer)
+        host_sock, host_early = await _detach(host_link.reader, host_link.writer)
+        sockets = (client_sock, host_sock)
+        tasks = [
+            asyncio.create_task(_splice(loop, client_sock, host_sock,
+                                        client_early, stats, "to_host")),
+            asyncio.create_task(_splice(loop, host_sock, client_sock,
+                                        host_early, stats, "to_client")),
+        ]
+    else:
+        tasks = [
+            asyncio.create_task(_copy(client.reader, host_link.writer,
+                                      stats, "to_host")),
+            asyncio.create_task(_copy(host_link.reader, client.writer,
+                                      stats, "to_client")),
+        ]
 
-    task_a = asyncio.create_task(pipe(client.reader, host_link.writer))
-    task_b = asyncio.create_task(pipe(host_link.reader, client.writer))
     done, pending = await asyncio.wait(
-        [task_a, task_b], return_when=asyncio.FIRST_COMPLETED
+        tasks, return_when=asyncio.FIRST_COMPLETED
     )
     for task in pending:
         task.cancel()
-    await _safe_close(client.writer)
-    await _safe_close(host_link.writer)
+    await asyncio.gather(*pending, return_exceptions=True)
+    if sockets:
+        for sock in sockets:
+            sock.close()
+    else:
+        await _safe_close(client.writer)
+        await _safe_close(host_link.writer)
+
+    elapsed = max(_now() - started, 1e-3)
+    session.bytes_to_host += stats.to_host
+    session.bytes_to_client += stats.to_client
+    if sockets:
+        session.links_spliced += 1
+    else:
+        session.links_copied += 1
+    print(
+        "link closed: {} ({}, {} bytes to host, {} bytes to client, "
+        "{:.1f}s, {:.0f} B/s)".format(
+            link_id.hex(), "splice" if sockets else "copy",
+            stats.to_host, stats.to_client, elapsed,
+            (stats.to_host + stats.to_client) / elapsed,
+        )
+    )
 
 
 async def _close_session(state, session, reason):
@@ -203,7 +354,14 @@ async def _close_session(state, session, reason):
         state.link_to_session.pop(link_id, None)
         session.link_addresses.pop(link_id, None)
     await _safe_close(session.host_writer)
-    print("session closed: {} ({})".format(session.session_id.hex(), reason))
+    print(
+        "session closed: {} ({}, {} links spliced, {} copied, "
+        "{} bytes to host, {} bytes to client)".format(
+            session.session_id.hex(), reason,
+            session.links_spliced, session.links_copied,
+            session.bytes_to_host, session.bytes_to_client,
+        )
+    )
 
 
 async def _send_id(writer, magic, unique):
@@ -255,7 +413,9 @@ async def _maybe_pair(state, session, link_id):
     session.host_links.pop(link_id, None)
     session.link_addresses.pop(link_id, None)
     state.link_to_session.pop(link_id, None)
-    asyncio.create_task(_bridge(client, host_link))
+    asyncio.create_task(
+        _bridge(session, link_id, client, host_link, state.splice)
+    )
 
 
 async def _handle_client(state, session, reader, writer):
@@ -372,8 +532,11 @@ async def main():
     port = _get_env_int("TCP_RELAY_PORT", DEFAULT_PORT)
     pending_ttl = _get_env_float("TCP_RELAY_PENDING_TTL", DEFAULT_PENDING_TTL)
     max_sessions = _get_env_int("TCP_RELAY_MAX_SESSIONS", DEFAULT_MAX_SESSIONS)
+    # os.splice is Linux only, and Python 3.10 or later
+    splice = (_get_env_int("TCP_RELAY_SPLICE", DEFAULT_SPLICE) != 0
+              and hasattr(os, "splice"))
 
-    state = RelayState()
+    state = RelayState(splice)
     server = await asyncio.start_server(
         lambda r, w: _handle_connection(state, max_sessions, r, w),
         bind_addr,
@@ -381,7 +544,8 @@ async def main():
     )
 
     addrs = ", ".join(str(sock.getsockname()) for sock in server.sockets or [])
-    print("TCP relay listening on {} (pending_ttl={}s)".format(addrs, pending_ttl))
+    print("TCP relay listening on {} (pending_ttl={}s, {})".format(
+        addrs, pending_ttl, "splice" if splice else "copy"))
 
     asyncio.create_task(_cleanup_loop(state, pending_ttl))
 
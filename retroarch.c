@@ -131,6 +131,7 @@
 
 #ifdef HAVE_NETWORKING
 #include <net/net_compat.h>
+#include <net/net_http.h>
 #include <net/net_socket.h>
 #endif
 
@@ -143,6 +144,9 @@
 #endif
 
 #include "input/input_remapping.h"
+#ifdef HAVE_BSV_MOVIE
+#include "input/bsv/replay_export.h"
+#endif
 
 #ifdef HAVE_CHEEVOS
 #include "cheevos/cheevos.h"
@@ -206,6 +210,8 @@
 #include "version_git.h"
 
 #include "retroarch.h"
+#include "frame_timeline.h"
+#include "latency_test.h"
 
 #include "accessibility.h"
 
@@ -272,6 +278,9 @@ enum
 {
    RA_OPT_MENU = 256, /* must be outside the range of a char */
    RA_OPT_CHECK_FRAMES,
+   RA_OPT_NETPLAY_SYNCTEST,
+   RA_OPT_NETPLAY_SPECTATE,
+   RA_OPT_NETPLAY_BROADCAST,
    RA_OPT_PORT,
    RA_OPT_SPECTATE,
    RA_OPT_NICK,
@@ -294,7 +303,9 @@ enum
    RA_OPT_SET_SHADER,
    RA_OPT_DATABASE_SCAN,
    RA_OPT_ACCESSIBILITY,
-   RA_OPT_LOAD_MENU_ON_ERROR
+   RA_OPT_LOAD_MENU_ON_ERROR,
+   RA_OPT_REPLAY_EXPORT,
+   RA_OPT_REPLAY_RANGE
 };
 
 /* DRIVERS */
@@ -1553,18 +1564,22 @@ void drivers_init(
 
       video_st->frame_time_count = 0;
 
-      video_driver_lock_new();
+      if (     !(video_st->flags & VIDEO_FLAG_KEPT_ALIVE)
+            || !video_driver_reuse_kept(settings))
+      {
+         video_driver_lock_new();
 #ifdef HAVE_VIDEO_FILTER
-      video_driver_filter_free();
+         video_driver_filter_free();
 #endif
-      video_st->frame_cache_data  = NULL;
-      if (!video_driver_init_internal(&video_is_threaded,
-               verbosity_enabled))
-         retroarch_fail(1, "video_driver_init_internal()");
+         video_st->frame_cache_data  = NULL;
+         if (!video_driver_init_internal(&video_is_threaded,
+                  verbosity_enabled))
+            retroarch_fail(1, "video_driver_init_internal()");
 
-      if (   !(video_st->flags & VIDEO_FLAG_CACHE_CONTEXT_ACK)
-            && hwr->context_reset)
-         hwr->context_reset();
+         if (   !(video_st->flags & VIDEO_FLAG_CACHE_CONTEXT_ACK)
+               && hwr->context_reset)
+            hwr->context_reset();
+      }
       video_st->flags            &= ~VIDEO_FLAG_CACHE_CONTEXT_ACK;
       runloop_st->frame_time_last = 0;
    }
@@ -1845,24 +1860,32 @@ void driver_uninit(int flags, enum driver_lifetime_flags lifetime_flags)
    if (flags & DRIVER_LED)
       led_driver_free();
 
-   if (flags & DRIVERS_VIDEO_INPUT)
-   {
-      video_driver_free_internal();
-      VIDEO_DRIVER_LOCK_FREE(video_st);
-      video_st->data              = NULL;
+   /* Drivers kept alive for the next core are left running;
+    * drivers_init reuses or frees them */
+   if (video_st->flags & VIDEO_FLAG_KEPT_ALIVE)
       video_st->frame_cache_data  = NULL;
+   else
+   {
+      if (flags & DRIVERS_VIDEO_INPUT)
+      {
+         video_driver_free_internal();
+         VIDEO_DRIVER_LOCK_FREE(video_st);
+         video_st->data              = NULL;
+         video_st->frame_cache_data  = NULL;
+      }
+
+      if ((flags & DRIVER_VIDEO_MASK))
+         video_st->data = NULL;
+
+      if ((flags & DRIVER_INPUT_MASK))
+         input_state_get_ptr()->current_data = NULL;
    }
 
    if (flags & DRIVER_AUDIO_MASK)
       audio_driver_deinit();
 
-   if ((flags & DRIVER_VIDEO_MASK))
-      video_st->data = NULL;
-
-   if ((flags & DRIVER_INPUT_MASK))
-      input_state_get_ptr()->current_data = NULL;
-
-   if ((flags & DRIVER_AUDIO_MASK))
+   if (     (flags & DRIVER_AUDIO_MASK)
+         && !(audio_state_get_ptr()->flags & AUDIO_FLAG_KEPT_ALIVE))
       audio_state_get_ptr()->context_audio_data = NULL;
 
 #ifdef HAVE_MICROPHONE
@@ -3828,7 +3851,10 @@ bool command_event(enum event_command cmd, void *data)
 #endif
                {
                   state_manager_event_init(&runloop_st->rewind_st,
-                        (unsigned)rewind_buf_size);
+                        (unsigned)rewind_buf_size,
+                        (uint64_t)settings->uints.rewind_disk_buffer_size
+                        * 1024 * 1024,
+                        settings->paths.directory_cache);
                }
             }
          }
@@ -4115,6 +4141,7 @@ bool command_event(enum event_command cmd, void *data)
       case CMD_EVENT_HISTORY_INIT:
          {
             playlist_config_t playlist_config;
+            retro_time_t start_time                = cpu_features_get_time_usec();
             const char *_msg                       = NULL;
             bool history_list_enable               = settings->bools.history_list_enable;
             const char *path_content_history       = settings->paths.path_content_history;
@@ -4184,6 +4211,9 @@ bool command_event(enum event_command cmd, void *data)
                      g_defaults.video_history, PLAYLIST_SORT_MODE_OFF);
             }
 #endif
+
+            RARCH_LOG("[Playlist] Loaded history playlists in %.1f ms.\n",
+                  (cpu_features_get_time_usec() - start_time) / 1000.0f);
          }
          break;
       case CMD_EVENT_CORE_INFO_DEINIT:
@@ -4255,6 +4285,25 @@ bool command_event(enum event_command cmd, void *data)
                   settings->paths.directory_runtime_log,
                   settings->paths.directory_playlist);
 
+            if (     settings->bools.frame_timeline_enable
+                  && frame_timeline_is_enabled())
+            {
+               const char *dir = !string_is_empty(settings->paths.log_dir)
+                  ? settings->paths.log_dir
+                  : settings->paths.directory_cache;
+
+               if (!string_is_empty(dir))
+               {
+                  char trace_path[PATH_MAX_LENGTH];
+                  fill_pathname_join_special(trace_path, dir,
+                        "frame_timeline.json", sizeof(trace_path));
+                  if (frame_timeline_write_trace(trace_path))
+                     RARCH_LOG("[Timeline] Wrote \"%s\".\n", trace_path);
+               }
+            }
+            frame_timeline_set_enabled(false);
+            latency_test_stop();
+
             content_reset_savestate_backups();
             hwr = VIDEO_DRIVER_GET_HW_CONTEXT_INTERNAL(video_st);
 #ifdef HAVE_CHEEVOS
@@ -4642,6 +4691,10 @@ bool command_event(enum event_command cmd, void *data)
          task_push_cloud_sync();
          break;
 #endif
+      case CMD_EVENT_LATENCY_TEST:
+         if (runloop_st->flags & RUNLOOP_FLAG_CORE_RUNNING)
+            latency_test_start();
+         break;
       case CMD_EVENT_MENU_RESET_TO_DEFAULT_CONFIG:
          config_set_defaults(global_get_ptr());
          break;
@@ -6642,6 +6695,33 @@ static void retroarch_print_help(const char *arg0)
          "      --check-frames=NUMBER      "
          "Check frames when using netplay.\n"
          , sizeof(buf) - _len);
+#ifdef HAVE_GGPO
+   _len += strlcpy(buf + _len,
+         "      --netplay-synctest=FRAMES  "
+         "Run the content under a GGPO sync test, rolling back FRAMES (1 to 31)\n"
+         "                                 "
+         "  frames every FRAMES frames, and report the first divergent frame,\n"
+         "                                 "
+         "  save/load costs and throughput on exit. Exits on a divergence.\n"
+         "                                 "
+         "  Combine with --play-replay, --eof-exit and --max-frames to qualify a core.\n"
+         "      --netplay-broadcast=SESSION\n"
+         "                                 "
+         "Send the GGPO match's confirmed inputs once to the GGPO relay server\n"
+         "                                 "
+         "  under SESSION, for any number of --netplay-spectate nodes.\n"
+         "      --netplay-spectate=SESSION "
+         "Spectate the GGPO relay broadcast SESSION instead of playing. The\n"
+         "                                 "
+         "  match is played from its first frame as fast as the inputs come,\n"
+         "                                 "
+         "  so a late node catches up, and RetroArch exits when it ends.\n"
+         "                                 "
+         "  Combine with --record-replay and --record to keep it, and a null\n"
+         "                                 "
+         "  video driver to run without a display.\n"
+         , sizeof(buf) - _len);
+#endif
 #ifdef HAVE_NETWORK_CMD
    _len += strlcpy(buf + _len,
          "      --command                  "
@@ -6660,6 +6740,18 @@ static void retroarch_print_help(const char *arg0)
          "Start recording a replay file from the beginning.\n"
          "      --eof-exit                 "
          "Exit upon reaching the end of the replay file.\n"
+#ifdef HAVE_REPLAY_EXPORT
+         "      --replay-export=JOBS       "
+         "Record the replay given with -P to the file given with -r,\n"
+         "                                 "
+         "  playing it in JOBS segments at once (0 for one per CPU core).\n"
+         "                                 "
+         "  Use the null video and audio drivers to run unthrottled.\n"
+#endif
+         "      --replay-range=FIRST-LAST  "
+         "Play only the frames between two checkpoints of the replay,\n"
+         "                                 "
+         "  then exit. Used by --replay-export.\n"
          , sizeof(buf) - _len);
 #endif
 
@@ -6943,6 +7035,11 @@ static bool retroarch_parse_input_and_config(
    bool                 cli_active = false;
    bool               cli_core_set = false;
    bool            cli_content_set = false;
+#ifdef HAVE_BSV_MOVIE
+   bool              replay_export = false;
+   bool               replay_range = false;
+   unsigned     replay_export_jobs = 0;
+#endif
    recording_state_t *rec_st       = recording_state_get_ptr();
    video_driver_state_t *video_st  = video_state_get_ptr();
    runloop_state_t     *runloop_st = runloop_state_get_ptr();
@@ -6979,6 +7076,8 @@ static bool retroarch_parse_input_and_config(
 #ifdef HAVE_BSV_MOVIE
       { "play-replay",        1, NULL, 'P' },
       { "record-replay",      1, NULL, 'R' },
+      { "replay-export",      1, NULL, RA_OPT_REPLAY_EXPORT },
+      { "replay-range",       1, NULL, RA_OPT_REPLAY_RANGE },
 #endif
       { "sram-mode",          1, NULL, 'M' },
 #ifdef HAVE_NETWORKING
@@ -6986,6 +7085,9 @@ static bool retroarch_parse_input_and_config(
       { "connect",            1, NULL, 'C' },
       { "mitm-session",       1, NULL, 'T' },
       { "check-frames",       1, NULL, RA_OPT_CHECK_FRAMES },
+      { "netplay-synctest",   1, NULL, RA_OPT_NETPLAY_SYNCTEST },
+      { "netplay-spectate",   1, NULL, RA_OPT_NETPLAY_SPECTATE },
+      { "netplay-broadcast",  1, NULL, RA_OPT_NETPLAY_BROADCAST },
       { "port",               1, NULL, RA_OPT_PORT },
 #ifdef HAVE_NETWORK_CMD
       { "command",            1, NULL, RA_OPT_COMMAND },
@@ -7443,6 +7545,63 @@ static bool retroarch_parse_input_and_config(
                      (int)strtoul(optarg, NULL, 0));
                break;
 
+            case RA_OPT_NETPLAY_SYNCTEST:
+#ifdef HAVE_GGPO
+               {
+                  net_driver_state_t *net_st = networking_state_get_ptr();
+                  unsigned frames = (unsigned)strtoul(optarg, NULL, 0);
+
+                  if (!frames || frames > 31)
+                  {
+                     RARCH_ERR("Invalid argument in --netplay-synctest.\n");
+                     retroarch_print_help(argv[0]);
+                     retroarch_fail(1, "retroarch_parse_input()");
+                  }
+
+                  net_st->ggpo_synctest_frames = frames;
+                  retroarch_override_setting_set(
+                        RARCH_OVERRIDE_SETTING_NETPLAY_MODE, NULL);
+                  netplay_driver_ctl(RARCH_NETPLAY_CTL_ENABLE_SERVER, NULL);
+               }
+#else
+               RARCH_WARN("--netplay-synctest needs a build with GGPO.\n");
+#endif
+               break;
+
+            case RA_OPT_NETPLAY_SPECTATE:
+            case RA_OPT_NETPLAY_BROADCAST:
+#ifdef HAVE_GGPO
+               {
+                  net_driver_state_t *net_st = networking_state_get_ptr();
+                  bool spectate = (c == RA_OPT_NETPLAY_SPECTATE);
+                  char *session = spectate
+                     ? net_st->ggpo_spectate_session
+                     : net_st->ggpo_broadcast_session;
+
+                  /* The relay takes session ids of up to 64 bytes */
+                  if (     string_is_empty(optarg)
+                        || strlen(optarg) >= sizeof(net_st->ggpo_spectate_session))
+                  {
+                     RARCH_ERR("Invalid argument in --netplay-%s.\n",
+                           spectate ? "spectate" : "broadcast");
+                     retroarch_print_help(argv[0]);
+                     retroarch_fail(1, "retroarch_parse_input()");
+                  }
+
+                  strlcpy(session, optarg,
+                        sizeof(net_st->ggpo_spectate_session));
+                  if (spectate)
+                  {
+                     retroarch_override_setting_set(
+                           RARCH_OVERRIDE_SETTING_NETPLAY_MODE, NULL);
+                     netplay_driver_ctl(RARCH_NETPLAY_CTL_ENABLE_SERVER, NULL);
+                  }
+               }
+#else
+               RARCH_WARN("--netplay-spectate and --netplay-broadcast need a build with GGPO.\n");
+#endif
+               break;
+
             case RA_OPT_PORT:
                retroarch_override_setting_set(
                      RARCH_OVERRIDE_SETTING_NETPLAY_IP_PORT, NULL);
@@ -7565,6 +7724,35 @@ static bool retroarch_parse_input_and_config(
 #endif
                break;
 
+#ifdef HAVE_BSV_MOVIE
+            case RA_OPT_REPLAY_EXPORT:
+               replay_export      = true;
+               replay_export_jobs = (unsigned)strtoul(optarg, NULL, 0);
+               break;
+
+            case RA_OPT_REPLAY_RANGE:
+               {
+                  char *endptr;
+                  input_driver_state_t *input_st = input_state_get_ptr();
+                  int64_t first = strtoll(optarg, &endptr, 0);
+                  int64_t last  = (*endptr == '-')
+                     ? strtoll(endptr + 1, &endptr, 0) : -1;
+
+                  /* LAST is 0 for the end of the replay */
+                  if (     *endptr != '\0' || first < 0
+                        || (last != 0 && last <= first))
+                  {
+                     RARCH_ERR("Invalid argument in --replay-range.\n");
+                     retroarch_print_help(argv[0]);
+                     retroarch_fail(1, "retroarch_parse_input()");
+                  }
+                  input_st->bsv_movie_state.range_first = first;
+                  input_st->bsv_movie_state.range_last  = last;
+                  replay_range                          = true;
+               }
+               break;
+#endif
+
             case 'h':
             case 'V':
             case RA_OPT_VERSION:
@@ -7730,6 +7918,48 @@ static bool retroarch_parse_input_and_config(
          path_is_directory(runloop_st->name.savestate))
       dir_set(RARCH_DIR_SAVESTATE, runloop_st->name.savestate);
 
+#ifdef HAVE_BSV_MOVIE
+   if (replay_export || replay_range)
+   {
+      input_driver_state_t *input_st = input_state_get_ptr();
+
+      if (     !(input_st->bsv_movie_state.flags
+               & BSV_FLAG_MOVIE_START_PLAYBACK)
+            || string_is_empty(rec_st->path))
+      {
+         RARCH_ERR("--replay-export and --replay-range need a replay to "
+               "play (-P) and a file to record to (-r).\n");
+         retroarch_fail(1, "retroarch_parse_input()");
+      }
+
+      /* One segment of an export: report how it went next to the
+       * part it records */
+      if (replay_range)
+      {
+         char *report  = input_st->bsv_movie_state.range_report;
+         size_t _len   = strlcpy(report, rec_st->path,
+               sizeof(input_st->bsv_movie_state.range_report));
+         strlcpy(report + _len, ".range",
+               sizeof(input_st->bsv_movie_state.range_report) - _len);
+      }
+#ifdef HAVE_REPLAY_EXPORT
+      else
+      {
+         verbosity_enable();
+         exit(replay_export_run(argc, argv,
+                  input_st->bsv_movie_state.movie_start_path,
+                  rec_st->path, replay_export_jobs) ? 0 : EXIT_FAILURE);
+      }
+#else
+      else
+      {
+         RARCH_ERR("--replay-export is not available on this platform.\n");
+         retroarch_fail(1, "retroarch_parse_input()");
+      }
+#endif
+   }
+#endif
+
    return verbosity_enabled;
 }
 
@@ -7773,11 +8003,23 @@ static void retroarch_validate_cpu_features(void)
  *
  * @return true on success, otherwise false if there was an error.
  **/
+/* Logs the time since '*phase_time' and starts the next phase */
+static void retroarch_log_startup_phase(const char *phase,
+      retro_time_t *phase_time)
+{
+   retro_time_t now = cpu_features_get_time_usec();
+   RARCH_LOG("[Startup] %s: %.1f ms.\n", phase,
+         (now - *phase_time) / 1000.0f);
+   *phase_time      = now;
+}
+
 bool retroarch_main_init(int argc, char *argv[])
 {
 #if defined(DEBUG) && defined(HAVE_DRMINGW)
    char log_file_name[128];
 #endif
+   retro_time_t startup_time     = cpu_features_get_time_usec();
+   retro_time_t phase_time       = startup_time;
    bool verbosity_enabled        = false;
    bool           init_failed    = false;
    struct rarch_state *p_rarch   = &rarch_st;
@@ -7828,6 +8070,8 @@ bool retroarch_main_init(int argc, char *argv[])
    dir_check_config();
 #endif
 
+   retroarch_log_startup_phase("Config", &phase_time);
+
 #ifdef HAVE_ACCESSIBILITY
    accessibility_enable                = settings->bools.accessibility_enable;
    accessibility_narrator_speech_speed = settings->uints.accessibility_narrator_speech_speed;
@@ -8056,6 +8300,8 @@ bool retroarch_main_init(int argc, char *argv[])
 #endif
    }
 
+   retroarch_log_startup_phase("Core", &phase_time);
+
 #ifdef HAVE_CHEATS
    cheat_manager_state_free();
    command_event_init_cheats(
@@ -8069,6 +8315,8 @@ bool retroarch_main_init(int argc, char *argv[])
          );
 #endif
    drivers_init(settings, DRIVERS_CMD_ALL, (enum driver_lifetime_flags)0, verbosity_enabled);
+   /* Includes core info, which the menu driver loads */
+   retroarch_log_startup_phase("Drivers", &phase_time);
 #ifdef HAVE_COMMAND
    input_driver_deinit_command(input_st);
    input_driver_init_command(input_st, settings);
@@ -8131,6 +8379,9 @@ bool retroarch_main_init(int argc, char *argv[])
    game_ai_init();
 #endif
 
+   RARCH_LOG("[Startup] Total: %.1f ms.\n",
+         (cpu_features_get_time_usec() - startup_time) / 1000.0f);
+
    return true;
 
 error:
@@ -8145,6 +8396,12 @@ void retroarch_init_task_queue(void)
 #ifdef HAVE_THREADS
    settings_t *settings        = config_get_ptr();
    bool threaded_enable        = settings->bools.threaded_data_runloop_enable;
+
+   task_queue_set_workers(settings->uints.threaded_data_runloop_workers);
+#ifdef HAVE_NETWORKING
+   /* HTTP transfers run on several workers at once */
+   net_http_global_init();
+#endif
 #else
    bool threaded_enable        = false;
 #endif
@@ -8771,6 +9028,7 @@ void retroarch_favorites_init(void)
    bool playlist_sort_alphabetical     = settings ? settings->bools.playlist_sort_alphabetical : false;
    playlist_config_t playlist_config;
    enum playlist_sort_mode current_sort_mode;
+   retro_time_t start_time             = cpu_features_get_time_usec();
 
    playlist_config.capacity            = COLLECTION_SIZE;
    playlist_config.old_format          = settings ? settings->bools.playlist_use_old_format : false;
@@ -8803,6 +9061,9 @@ void retroarch_favorites_init(void)
    if (   (playlist_sort_alphabetical && (current_sort_mode == PLAYLIST_SORT_MODE_DEFAULT))
        || (current_sort_mode == PLAYLIST_SORT_MODE_ALPHABETICAL))
       playlist_qsort(g_defaults.content_favorites);
+
+   RARCH_LOG("[Playlist] Loaded favorites in %.1f ms.\n",
+         (cpu_features_get_time_usec() - start_time) / 1000.0f);
 }
 
 void retroarch_favorites_deinit(void)
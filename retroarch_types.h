@@ -320,6 +320,8 @@ typedef struct content_file_info
    size_t data_size;
    bool file_in_archive;
    bool persistent_data;
+   /* data is a file mapping rather than a heap buffer */
+   bool data_mapped;
 } content_file_info_t;
 
 typedef struct content_file_list
@@ -28,10 +28,17 @@
 #endif
 #endif
 
+#include <encodings/crc32.h>
 #include <encodings/utf.h>
+#include <features/features_cpu.h>
+#include <file/file_path.h>
+#include <lists/dir_list.h>
 #include <string/stdstring.h>
 #include <streams/file_stream.h>
 #include <time/rtime.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "configuration.h"
 #include "content.h"
@@ -180,9 +187,143 @@ static void strcat_alloc(char **dst, const char *s)
    strcpy(src + _len, s);
 }
 
+#ifdef HAVE_THREADS
+/* Runs the secondary core's speculative frame alongside the main core's
+ * real one. The secondary gets the inputs it read last, copied before
+ * each frame, and its video is kept for the main thread to present;
+ * its audio is dropped as in the serial mode. */
+struct runahead_secondary_worker
+{
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   void *frame;
+   size_t frame_size;
+   size_t pitch;
+   unsigned width;
+   unsigned height;
+   unsigned num_inputs;
+   runahead_input_query_t queries[RUNAHEAD_MAX_INPUT_QUERIES];
+   int16_t inputs[RUNAHEAD_MAX_INPUT_QUERIES];
+   bool has_frame;
+   bool missed_input;
+   bool busy;
+   bool quit;
+};
+
+static void runahead_secondary_worker_loop(void *data)
+{
+   runloop_state_t *runloop_st              = runloop_state_get_ptr();
+   struct runahead_secondary_worker *worker =
+      (struct runahead_secondary_worker*)data;
+
+   slock_lock(worker->lock);
+   for (;;)
+   {
+      while (!worker->busy && !worker->quit)
+         scond_wait(worker->cond, worker->lock);
+      if (worker->quit)
+         break;
+      slock_unlock(worker->lock);
+
+      runloop_st->secondary_core.retro_run();
+
+      slock_lock(worker->lock);
+      worker->busy = false;
+      scond_signal(worker->cond);
+   }
+   slock_unlock(worker->lock);
+}
+
+static void runahead_secondary_worker_frame(const void *data,
+      unsigned width, unsigned height, size_t pitch)
+{
+   struct runahead_secondary_worker *worker =
+      runloop_state_get_ptr()->secondary_worker;
+   size_t len                               = pitch * height;
+
+   /* NULL repeats the last frame */
+   worker->has_frame = data && data != RETRO_HW_FRAME_BUFFER_VALID;
+   worker->width     = width;
+   worker->height    = height;
+   worker->pitch     = pitch;
+
+   if (!worker->has_frame)
+      return;
+
+   if (len > worker->frame_size)
+   {
+      void *frame = realloc(worker->frame, len);
+      if (!frame)
+      {
+         worker->has_frame = false;
+         return;
+      }
+      worker->frame      = frame;
+      worker->frame_size = len;
+   }
+   memcpy(worker->frame, data, len);
+}
+
+static void runahead_secondary_worker_sample(int16_t left, int16_t right) { }
+
+static size_t runahead_secondary_worker_sample_batch(
+      const int16_t *data, size_t frames)
+{
+   return frames;
+}
+
+static int16_t runahead_secondary_worker_input_state(unsigned port,
+      unsigned device, unsigned index, unsigned id)
+{
+   unsigned i;
+   struct runahead_secondary_worker *worker =
+      runloop_state_get_ptr()->secondary_worker;
+
+   for (i = 0; i < worker->num_inputs; i++)
+   {
+      const runahead_input_query_t *query = &worker->queries[i];
+      if (     (query->id     == id)
+            && (query->port   == port)
+            && (query->device == device)
+            && (query->index  == index))
+         return worker->inputs[i];
+   }
+
+   /* Not read by the main core yet, so its value is unknown here */
+   worker->missed_input = true;
+   return 0;
+}
+
+static void runahead_secondary_worker_free(runloop_state_t *runloop_st)
+{
+   struct runahead_secondary_worker *worker = runloop_st->secondary_worker;
+
+   if (!worker)
+      return;
+
+   if (worker->thread)
+   {
+      slock_lock(worker->lock);
+      worker->quit = true;
+      scond_signal(worker->cond);
+      slock_unlock(worker->lock);
+      sthread_join(worker->thread);
+   }
+   scond_free(worker->cond);
+   slock_free(worker->lock);
+   free(worker->frame);
+   free(worker);
+   runloop_st->secondary_worker = NULL;
+}
+#endif
+
 void runahead_secondary_core_destroy(void *data)
 {
    runloop_state_t *runloop_st      = (runloop_state_t*)data;
+#ifdef HAVE_THREADS
+   runahead_secondary_worker_free(runloop_st);
+#endif
    if (!runloop_st->secondary_lib_handle)
       return;
 
@@ -198,7 +339,9 @@ void runahead_secondary_core_destroy(void *data)
 
    dylib_close(runloop_st->secondary_lib_handle);
    runloop_st->secondary_lib_handle = NULL;
-   filestream_delete(runloop_st->secondary_library_path);
+   if (!runloop_st->secondary_library_cached)
+      filestream_delete(runloop_st->secondary_library_path);
+   runloop_st->secondary_library_cached = false;
    if (runloop_st->secondary_library_path)
       free(runloop_st->secondary_library_path);
    runloop_st->secondary_library_path = NULL;
@@ -319,17 +462,93 @@ static bool write_file_with_random_name(char **temp_dll_path,
 }
 
 
+/* The CRC32 of a core file, remembered for as long as the
+ * file keeps its size and modification time so that later
+ * sessions of the same core don't read it again */
+static bool secondary_core_get_crc(const char *core_path,
+      const void *data, int64_t size, uint32_t *crc)
+{
+   static char last_path[PATH_MAX_LENGTH];
+   static int64_t last_size     = -1;
+   static int64_t last_mtime    = -1;
+   static uint32_t last_crc     = 0;
+   int64_t file_size            = 0;
+   int64_t mtime                = 0;
+   bool has_mtime               = path_get_size_and_mtime(core_path,
+         &file_size, &mtime);
+
+   if (     has_mtime
+         && string_is_equal(core_path, last_path)
+         && (file_size == last_size)
+         && (mtime     == last_mtime))
+   {
+      *crc = last_crc;
+      return true;
+   }
+
+   if (!data)
+      return false;
+
+   *crc = encoding_crc32(0, (const uint8_t*)data, (size_t)size);
+   if (has_mtime)
+   {
+      strlcpy(last_path, core_path, sizeof(last_path));
+      last_size  = file_size;
+      last_mtime = mtime;
+      last_crc   = *crc;
+   }
+   return true;
+}
+
+/* Removes the cached copies of a core other than 'keep' */
+static void secondary_core_prune_cache(const char *tmp_path,
+      const char *prefix, const char *keep)
+{
+   size_t i;
+   size_t prefix_len         = strlen(prefix);
+   struct string_list *files = dir_list_new(tmp_path, NULL,
+         false, false, false, false);
+
+   if (!files)
+      return;
+
+   for (i = 0; i < files->size; i++)
+   {
+      const char *file = files->elems[i].data;
+      const char *name = path_basename(file);
+
+      if (     !strncmp(name, prefix, prefix_len)
+            && !string_is_equal(file, keep))
+         filestream_delete(file);
+   }
+   string_list_free(files);
+}
+
+/* Gets a copy of the core that can be loaded beside it.
+ * The copies are named after the core's CRC32 and stay in
+ * the temporary directory, so the next session of the same
+ * core loads the existing copy instead of writing a new one.
+ * '*cached' is false for a one-off copy that the caller
+ * deletes when done with it. */
 static char *copy_core_to_temp_file(
       const char *core_path,
-      const char *dir_libretro)
+      const char *dir_libretro,
+      bool *cached)
 {
    char tmp_path[PATH_MAX_LENGTH];
+   char cache_name[NAME_MAX_LENGTH];
+   char cache_path[PATH_MAX_LENGTH];
+   uint32_t crc                = 0;
    bool  failed                = false;
    char  *tmpdir               = NULL;
    char  *tmp_dll_path         = NULL;
    void  *dll_file_data        = NULL;
    int64_t  dll_file_size      = 0;
    const char  *core_base_name = path_basename_nocompression(core_path);
+   const char  *ext            = NULL;
+   size_t _len;
+
+   *cached = false;
 
    if (string_is_empty(core_base_name))
       return NULL;
@@ -347,22 +566,59 @@ static char *copy_core_to_temp_file(
       goto end;
    }
 
-   if (!filestream_read_file(core_path, &dll_file_data, &dll_file_size))
+   /* <core name>.<crc>.<ext>, like snes9x_libretro.1a2b3c4d.so */
+   ext  = path_get_extension(core_base_name);
+   _len = strlcpy(cache_name, core_base_name, sizeof(cache_name));
+   if (!string_is_empty(ext))
+      _len -= strlen(ext) + 1;
+   cache_name[_len] = '\0';
+
+   if (     !secondary_core_get_crc(core_path, NULL, 0, &crc)
+         && !filestream_read_file(core_path, &dll_file_data, &dll_file_size))
+   {
+      failed = true;
+      goto end;
+   }
+   if (dll_file_data)
+      secondary_core_get_crc(core_path, dll_file_data, dll_file_size, &crc);
+
+   snprintf(cache_name + _len, sizeof(cache_name) - _len, ".%08x%s%s",
+         (unsigned)crc, string_is_empty(ext) ? "" : ".",
+         string_is_empty(ext) ? "" : ext);
+   fill_pathname_join_special(cache_path, tmp_path, cache_name,
+         sizeof(cache_path));
+
+   if (path_is_valid(cache_path))
+   {
+      *cached = true;
+      RARCH_LOG("[Run-Ahead] Using cached core copy \"%s\".\n", cache_path);
+      tmp_dll_path = strdup(cache_path);
+      goto end;
+   }
+
+   if (     !dll_file_data
+         && !filestream_read_file(core_path, &dll_file_data, &dll_file_size))
    {
       failed = true;
       goto end;
    }
 
+   /* Written under another name first, so that no other
+    * instance ever loads a partly written copy */
    strcat_alloc(&tmp_dll_path, tmp_path);
    strcat_alloc(&tmp_dll_path, PATH_DEFAULT_SLASH());
    strcat_alloc(&tmp_dll_path, core_base_name);
 
-   if (!filestream_write_file(tmp_dll_path, dll_file_data, dll_file_size))
+   if (!write_file_with_random_name(&tmp_dll_path,
+            tmp_path, dll_file_data, dll_file_size))
+      failed = true;
+   else if (!filestream_rename(tmp_dll_path, cache_path))
    {
-      /* try other file names */
-      if (!write_file_with_random_name(&tmp_dll_path,
-               tmp_path, dll_file_data, dll_file_size))
-         failed = true;
+      cache_name[_len + 1] = '\0';
+      secondary_core_prune_cache(tmp_path, cache_name, cache_path);
+      free(tmp_dll_path);
+      tmp_dll_path = strdup(cache_path);
+      *cached      = true;
    }
 
 end:
@@ -389,7 +645,29 @@ static bool runloop_environment_secondary_core_hook(
       unsigned cmd, void *data)
 {
    runloop_state_t *runloop_st    = runloop_state_get_ptr();
-   bool result                    = runloop_environment_cb(cmd, data);
+   bool result;
+
+   /* The interface would point into the secondary instance, and nothing
+    * diffs its states */
+   if (cmd == RETRO_ENVIRONMENT_SET_SERIALIZE_DIRTY_INTERFACE)
+      return false;
+
+#ifdef HAVE_THREADS
+   /* Updates are only handed out between worker frames, and the main
+    * thread owns the runloop flags while one runs. */
+   if (     runloop_st->secondary_worker
+         && sthread_isself(runloop_st->secondary_worker->thread))
+   {
+      if (cmd == RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE)
+      {
+         *(bool*)data = false;
+         return true;
+      }
+      return runloop_environment_cb(cmd, data);
+   }
+#endif
+
+   result                         = runloop_environment_cb(cmd, data);
 
    if (runloop_st->flags & RUNLOOP_FLAG_HAS_VARIABLE_UPDATE)
    {
@@ -421,6 +699,8 @@ static bool secondary_core_create(runloop_state_t *runloop_st,
       last_core_type             = runloop_st->last_core_type;
    rarch_system_info_t *sys_info = &runloop_st->system;
    uint8_t flags                 = content_get_flags();
+   retro_time_t start_time       = cpu_features_get_time_usec();
+   retro_time_t copy_time;
 
    if (     (last_core_type != CORE_TYPE_PLAIN)
          || (!runloop_st->load_content_info)
@@ -431,10 +711,12 @@ static bool secondary_core_create(runloop_state_t *runloop_st,
       free(runloop_st->secondary_library_path);
    runloop_st->secondary_library_path = NULL;
    runloop_st->secondary_library_path = copy_core_to_temp_file(
-		   path_get(RARCH_PATH_CORE), path_directory_libretro);
+         path_get(RARCH_PATH_CORE), path_directory_libretro,
+         &runloop_st->secondary_library_cached);
 
    if (!runloop_st->secondary_library_path)
       return false;
+   copy_time = cpu_features_get_time_usec();
 
    /* Load Core */
    if (!runloop_init_libretro_symbols(runloop_st,
@@ -519,6 +801,13 @@ static bool secondary_core_create(runloop_state_t *runloop_st,
    runahead_clear_controller_port_map(runloop_st);
 #endif
 
+   RARCH_LOG("[Run-Ahead] Secondary instance created in %.1f ms "
+         "(core copy %.1f ms%s, load %.1f ms).\n",
+         (cpu_features_get_time_usec() - start_time) / 1000.0f,
+         (copy_time - start_time) / 1000.0f,
+         runloop_st->secondary_library_cached ? ", cached" : "",
+         (cpu_features_get_time_usec() - copy_time) / 1000.0f);
+
    return true;
 
 error:
@@ -594,6 +883,96 @@ static bool secondary_core_run_use_last_input(runloop_state_t *runloop_st)
    return true;
 }
 
+#ifdef HAVE_THREADS
+/* The worker only runs software-rendered cores, and never while a core
+ * option update is waiting to reach the secondary. */
+static bool runahead_secondary_worker_ready(runloop_state_t *runloop_st)
+{
+   struct runahead_secondary_worker *worker = runloop_st->secondary_worker;
+   struct retro_hw_render_callback *hwr     = video_driver_get_hw_context();
+
+   if (     (hwr && hwr->context_type != RETRO_HW_CONTEXT_NONE)
+         || (runloop_st->flags & RUNLOOP_FLAG_HAS_VARIABLE_UPDATE)
+         ||  runloop_st->runahead_ring.queries_overflow
+         || !runloop_st->secondary_lib_handle)
+      return false;
+
+   if (worker)
+      return true;
+
+   if (!(worker = (struct runahead_secondary_worker*)
+            calloc(1, sizeof(*worker))))
+      return false;
+
+   runloop_st->secondary_worker = worker;
+   worker->lock                 = slock_new();
+   worker->cond                 = scond_new();
+   if (     !worker->lock
+         || !worker->cond
+         || !(worker->thread = sthread_create(
+               runahead_secondary_worker_loop, worker)))
+   {
+      runahead_secondary_worker_free(runloop_st);
+      return false;
+   }
+
+   return true;
+}
+
+/* Starts the secondary's next frame on the inputs it read last */
+static void runahead_secondary_worker_start(runloop_state_t *runloop_st)
+{
+   unsigned i;
+   struct runahead_secondary_worker *worker = runloop_st->secondary_worker;
+   const runahead_ring_t *ring              = &runloop_st->runahead_ring;
+
+   for (i = 0; i < ring->num_queries; i++)
+   {
+      const runahead_input_query_t *query = &ring->queries[i];
+      worker->queries[i] = *query;
+      worker->inputs[i]  = input_state_get_last(query->port,
+            query->device, query->index, query->id);
+   }
+   worker->num_inputs   = ring->num_queries;
+   worker->has_frame    = false;
+   worker->missed_input = false;
+
+   runloop_st->secondary_core.retro_set_video_refresh(
+         runahead_secondary_worker_frame);
+   runloop_st->secondary_core.retro_set_audio_sample(
+         runahead_secondary_worker_sample);
+   runloop_st->secondary_core.retro_set_audio_sample_batch(
+         runahead_secondary_worker_sample_batch);
+   runloop_st->secondary_core.retro_set_input_poll(
+         secondary_core_input_poll_null);
+   runloop_st->secondary_core.retro_set_input_state(
+         runahead_secondary_worker_input_state);
+
+   slock_lock(worker->lock);
+   worker->busy = true;
+   scond_signal(worker->cond);
+   slock_unlock(worker->lock);
+}
+
+static void runahead_secondary_worker_wait(runloop_state_t *runloop_st)
+{
+   struct runahead_secondary_worker *worker = runloop_st->secondary_worker;
+   struct retro_callbacks *cbs              = &runloop_st->secondary_callbacks;
+
+   slock_lock(worker->lock);
+   while (worker->busy)
+      scond_wait(worker->cond, worker->lock);
+   slock_unlock(worker->lock);
+
+   runloop_st->secondary_core.retro_set_video_refresh(cbs->frame_cb);
+   runloop_st->secondary_core.retro_set_audio_sample(cbs->sample_cb);
+   runloop_st->secondary_core.retro_set_audio_sample_batch(
+         cbs->sample_batch_cb);
+   runloop_st->secondary_core.retro_set_input_poll(cbs->poll_cb);
+   runloop_st->secondary_core.retro_set_input_state(cbs->state_cb);
+}
+#endif
+
 void runahead_remember_controller_port_device(void *data,
 		long port, long device)
 {
@@ -804,6 +1183,46 @@ static void runahead_input_state_set_last(
    }
 }
 
+/* Forgets every ring state, leaving the core's current state as the one
+ * real input continues from. */
+static void runahead_ring_reset(runahead_ring_t *ring)
+{
+   ring->num_states       = 0;
+   ring->next_state       = 0;
+   ring->ahead            = 0;
+   ring->num_queries      = 0;
+   ring->queries_overflow = false;
+}
+
+static void runahead_input_query_add(runahead_ring_t *ring,
+      unsigned port, unsigned device, unsigned index, unsigned id)
+{
+   unsigned i;
+   runahead_input_query_t *query;
+
+   for (i = 0; i < ring->num_queries; i++)
+   {
+      query = &ring->queries[i];
+      if (     (query->id     == id)
+            && (query->port   == port)
+            && (query->device == device)
+            && (query->index  == index))
+         return;
+   }
+
+   if (ring->num_queries >= RUNAHEAD_MAX_INPUT_QUERIES)
+   {
+      ring->queries_overflow = true;
+      return;
+   }
+
+   query         = &ring->queries[ring->num_queries++];
+   query->port   = port;
+   query->device = device;
+   query->index  = index;
+   query->id     = id;
+}
+
 static int16_t runahead_input_state_with_logging(unsigned port,
       unsigned device, unsigned index, unsigned id)
 {
@@ -820,7 +1239,11 @@ static int16_t runahead_input_state_with_logging(unsigned port,
          runloop_st->flags     |= RUNLOOP_FLAG_INPUT_IS_DIRTY;
       /*arbitrary limit of up to 65536 elements in state array*/
       if (id < 65536)
+      {
          runahead_input_state_set_last(runloop_st, port, device, index, id, result);
+         runahead_input_query_add(&runloop_st->runahead_ring,
+               port, device, index, id);
+      }
       return result;
    }
    return 0;
@@ -830,6 +1253,7 @@ static void runahead_reset_hook(void)
 {
    runloop_state_t *runloop_st = runloop_state_get_ptr();
    runloop_st->flags          |= RUNLOOP_FLAG_INPUT_IS_DIRTY;
+   runahead_ring_reset(&runloop_st->runahead_ring);
    if (runloop_st->retro_reset_callback_original)
       runloop_st->retro_reset_callback_original();
 }
@@ -838,6 +1262,7 @@ static bool runahead_unserialize_hook(const void *buf, size_t len)
 {
    runloop_state_t *runloop_st = runloop_state_get_ptr();
    runloop_st->flags          |= RUNLOOP_FLAG_INPUT_IS_DIRTY;
+   runahead_ring_reset(&runloop_st->runahead_ring);
    if (runloop_st->retro_unserialize_callback_original)
       return runloop_st->retro_unserialize_callback_original(buf, len);
    return false;
@@ -961,6 +1386,16 @@ static void runahead_remove_hooks(runloop_state_t *runloop_st)
 
 static void runahead_destroy(runloop_state_t *runloop_st)
 {
+   runahead_predict_t *predict = &runloop_st->runahead_predict;
+
+   if (predict->predicted_frames)
+      RARCH_LOG("[Run-Ahead] Input prediction held for %u of %u frames (%u%%).\n",
+            predict->predicted_frames - predict->mispredicted_frames,
+            predict->predicted_frames,
+            (unsigned)((predict->predicted_frames
+                  - predict->mispredicted_frames) * 100ULL
+                  / predict->predicted_frames));
+
    mylist_destroy(&runloop_st->runahead_save_state_list);
    runahead_remove_hooks(runloop_st);
    runahead_clear_variables(runloop_st);
@@ -1012,6 +1447,7 @@ static void runahead_err(runloop_state_t *runloop_st)
 {
    runloop_st->flags &= ~RUNLOOP_FLAG_RUNAHEAD_AVAILABLE;
    mylist_destroy(&runloop_st->runahead_save_state_list);
+   runahead_ring_reset(&runloop_st->runahead_ring);
    runahead_remove_hooks(runloop_st);
    runloop_st->runahead_save_state_size       = 0;
    runloop_st->flags                         |= RUNLOOP_FLAG_RUNAHEAD_SAVE_STATE_SIZE_KNOWN;
@@ -1056,11 +1492,11 @@ static bool runahead_save_state(runloop_state_t *runloop_st)
    return false;
 }
 
-static bool runahead_load_state(runloop_state_t *runloop_st)
+static bool runahead_load_state(runloop_state_t *runloop_st, unsigned slot)
 {
    retro_ctx_serialize_info_t *serialize_info =
       (retro_ctx_serialize_info_t*)
-      runloop_st->runahead_save_state_list->data[0];
+      runloop_st->runahead_save_state_list->data[slot];
    bool last_dirty                            = (runloop_st->flags & RUNLOOP_FLAG_INPUT_IS_DIRTY) ? true : false;
    bool ret                                   = core_unserialize_special(serialize_info);
    if (last_dirty)
@@ -1092,6 +1528,216 @@ static bool runahead_load_state_secondary(runloop_state_t *runloop_st, settings_
 }
 #endif
 
+/* Saves the current frame over the oldest ring state, allocating
+ * entries only as the ring first fills. */
+static bool runahead_ring_save(runloop_state_t *runloop_st)
+{
+   runahead_ring_t *ring = &runloop_st->runahead_ring;
+   my_list *list         = runloop_st->runahead_save_state_list;
+   unsigned slot         = ring->next_state;
+
+   if (!list)
+      return false;
+
+   if ((int)slot >= list->size)
+      mylist_resize(list, slot + 1, true);
+
+   if (     !list->data[slot]
+         || !((retro_ctx_serialize_info_t*)list->data[slot])->data
+         || !core_serialize_special(
+            (retro_ctx_serialize_info_t*)list->data[slot]))
+   {
+      runahead_err(runloop_st);
+      return false;
+   }
+
+   ring->state_frame[slot] = ring->frame;
+   ring->next_state        = (slot + 1) % RUNAHEAD_RING_SIZE;
+   if (ring->num_states < RUNAHEAD_RING_SIZE)
+      ring->num_states++;
+   return true;
+}
+
+/* Newest ring state at or before @frame, -1 if there is none */
+static int runahead_ring_find(const runahead_ring_t *ring, uint64_t frame)
+{
+   unsigned i;
+   int found = -1;
+
+   for (i = 0; i < ring->num_states; i++)
+   {
+      if (     (ring->state_frame[i] <= frame)
+            && (found < 0 || ring->state_frame[i] > ring->state_frame[found]))
+         found = (int)i;
+   }
+
+   return found;
+}
+
+static uint64_t runahead_ring_newest(const runahead_ring_t *ring)
+{
+   unsigned i;
+   uint64_t newest = 0;
+
+   for (i = 0; i < ring->num_states; i++)
+      if (ring->state_frame[i] > newest)
+         newest = ring->state_frame[i];
+
+   return newest;
+}
+
+static bool runahead_predict_covers(const runahead_predict_t *predict,
+      unsigned port, unsigned device, unsigned index, unsigned id)
+{
+   return   (predict->model == GGPO_PREDICT_HOLD)
+         && (port < RUNAHEAD_PREDICT_PORTS)
+         && ((device & RETRO_DEVICE_MASK) == RETRO_DEVICE_JOYPAD)
+         && (index == 0)
+         && (id < 16 || id == RETRO_DEVICE_ID_JOYPAD_MASK);
+}
+
+/* Adds this frame's real buttons to the history, once input is polled */
+static void runahead_predict_record(runloop_state_t *runloop_st)
+{
+   unsigned port;
+   runahead_predict_t *predict = &runloop_st->runahead_predict;
+
+   if (!runloop_st->input_state_callback_original)
+      return;
+
+   for (port = 0; port < RUNAHEAD_PREDICT_PORTS; port++)
+      predict->history[port][predict->history_next] = (uint16_t)
+         runloop_st->input_state_callback_original(port,
+               RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_MASK);
+
+   predict->history_next = (predict->history_next + 1) % GGPO_PREDICT_HISTORY;
+   if (predict->history_count < GGPO_PREDICT_HISTORY)
+      predict->history_count++;
+}
+
+/* Starts a new guess from the history as it stands, for the frames
+ * after the one about to run on real input. */
+static void runahead_predict_rebase(runloop_state_t *runloop_st,
+      unsigned model)
+{
+   unsigned port, i;
+   runahead_predict_t *predict = &runloop_st->runahead_predict;
+   unsigned oldest             = (predict->history_next
+         + GGPO_PREDICT_HISTORY - predict->history_count)
+         % GGPO_PREDICT_HISTORY;
+
+   for (port = 0; port < RUNAHEAD_PREDICT_PORTS; port++)
+   {
+      for (i = 0; i < predict->history_count; i++)
+      {
+         uint16_t word = predict->history[port]
+            [(oldest + i) % GGPO_PREDICT_HISTORY];
+         predict->base[port][i * 2]     = (uint8_t)(word & 0xff);
+         predict->base[port][i * 2 + 1] = (uint8_t)(word >> 8);
+      }
+      ggpo_predict_start((GGPOPredictModel)model, predict->base[port],
+            (int)predict->history_count, 2, 2, &predict->runs[port]);
+   }
+
+   predict->base_count = predict->history_count;
+   predict->base_frame = runloop_st->runahead_ring.frame + 1;
+   predict->model      = model;
+}
+
+/* Fills in the buttons for the frame running to emulated frame 'frame' */
+static void runahead_predict_words(runahead_predict_t *predict,
+      uint64_t frame)
+{
+   unsigned port;
+   int frames_ahead = (int)(frame - predict->base_frame);
+
+   for (port = 0; port < RUNAHEAD_PREDICT_PORTS; port++)
+   {
+      uint8_t out[2];
+      ggpo_predict_runs(&predict->runs[port], predict->base[port],
+            (int)predict->base_count, 2, frames_ahead, out);
+      predict->word[port] = (uint16_t)(out[0] | (out[1] << 8));
+   }
+}
+
+/* Whether this frame's real buttons are what the frames already run
+ * ahead were given for it */
+static bool runahead_predict_held(runloop_state_t *runloop_st)
+{
+   unsigned port;
+   runahead_ring_t *ring       = &runloop_st->runahead_ring;
+   runahead_predict_t *predict = &runloop_st->runahead_predict;
+   unsigned newest             = (predict->history_next
+         + GGPO_PREDICT_HISTORY - 1) % GGPO_PREDICT_HISTORY;
+
+   if (predict->model != GGPO_PREDICT_HOLD)
+      return true;
+
+   runahead_predict_words(predict, ring->frame - ring->ahead + 1);
+   for (port = 0; port < RUNAHEAD_PREDICT_PORTS; port++)
+      if (predict->word[port] != predict->history[port][newest])
+         return false;
+   return true;
+}
+
+static int16_t runahead_input_state_predicted(unsigned port,
+      unsigned device, unsigned index, unsigned id)
+{
+   runloop_state_t *runloop_st = runloop_state_get_ptr();
+   runahead_predict_t *predict = &runloop_st->runahead_predict;
+
+   if (runahead_predict_covers(predict, port, device, index, id))
+   {
+      if (id == RETRO_DEVICE_ID_JOYPAD_MASK)
+         return (int16_t)predict->word[port];
+      return (predict->word[port] >> id) & 1;
+   }
+   if (predict->live)
+      return runahead_input_state_with_logging(port, device, index, id);
+   return input_state_get_last(port, device, index, id);
+}
+
+/* Polls input once for the frame and compares everything the core has
+ * read since the last rollback against what it was given then. The core
+ * only reads input while it runs, so this is the one chance to decide
+ * whether the frames already run ahead still hold before committing
+ * another one. */
+static bool runahead_input_changed(runloop_state_t *runloop_st)
+{
+   unsigned i;
+   runahead_ring_t *ring = &runloop_st->runahead_ring;
+
+   if (ring->queries_overflow || !runloop_st->input_state_callback_original)
+      return true;
+
+   for (i = 0; i < ring->num_queries; i++)
+   {
+      const runahead_input_query_t *query = &ring->queries[i];
+      /* Checked against the prediction instead */
+      if (runahead_predict_covers(&runloop_st->runahead_predict,
+               query->port, query->device, query->index, query->id))
+         continue;
+      if (runloop_st->input_state_callback_original(query->port,
+               query->device, query->index, query->id)
+            != input_state_get_last(query->port,
+               query->device, query->index, query->id))
+         return true;
+   }
+
+   return false;
+}
+
+/* Runs a frame on input runahead_run() has already polled */
+static void runahead_core_run_polled(runloop_state_t *runloop_st)
+{
+   struct retro_callbacks *cbs = &runloop_st->retro_ctx;
+
+   runloop_st->current_core.retro_set_input_poll(retro_input_poll_null);
+   runloop_st->current_core.flags |= RETRO_CORE_FLAG_INPUT_POLLED;
+   runloop_st->current_core.retro_run();
+   runloop_st->current_core.retro_set_input_poll(cbs->poll_cb);
+}
+
 static void runahead_core_run_use_last_input(runloop_state_t *runloop_st)
 {
    struct retro_callbacks *cbs            = &runloop_st->retro_ctx;
@@ -1113,6 +1759,35 @@ static void runahead_core_run_use_last_input(runloop_state_t *runloop_st)
    runloop_st->current_core.retro_set_input_state(cbs->state_cb);
 }
 
+/* Runs the frame to the next emulated frame on predicted buttons. Other
+ * input is either held at what the core last read or, on a frame that
+ * is being run for the first time since the poll, read live. */
+static void runahead_core_run_predicted(runloop_state_t *runloop_st,
+      bool live)
+{
+   struct retro_callbacks *cbs            = &runloop_st->retro_ctx;
+   retro_input_poll_t old_poll_function   = cbs->poll_cb;
+   retro_input_state_t old_input_function = cbs->state_cb;
+   runahead_predict_t *predict            = &runloop_st->runahead_predict;
+
+   runahead_predict_words(predict, runloop_st->runahead_ring.frame + 1);
+   predict->live                          = live;
+
+   cbs->poll_cb                           = retro_input_poll_null;
+   cbs->state_cb                          = runahead_input_state_predicted;
+
+   runloop_st->current_core.retro_set_input_poll(cbs->poll_cb);
+   runloop_st->current_core.retro_set_input_state(cbs->state_cb);
+
+   runloop_st->current_core.retro_run();
+
+   cbs->poll_cb                           = old_poll_function;
+   cbs->state_cb                          = old_input_function;
+
+   runloop_st->current_core.retro_set_input_poll(cbs->poll_cb);
+   runloop_st->current_core.retro_set_input_state(cbs->state_cb);
+}
+
 void runahead_run(void *data,
       int runahead_count,
       bool runahead_hide_warnings,
@@ -1183,37 +1858,50 @@ void runahead_run(void *data,
          || !have_dynamic
          || !(runloop_st->flags & RUNLOOP_FLAG_RUNAHEAD_SECONDARY_CORE_AVAILABLE))
    {
-      /* TODO: multiple savestates for higher performance
-       * when not using secondary core */
-      for (frame_number = 0; frame_number <= runahead_count; frame_number++)
-      {
-         last_frame      = frame_number == runahead_count;
-         suspended_frame = !last_frame;
-
-         if (suspended_frame)
-         {
-            audio_st->flags     |=  AUDIO_FLAG_SUSPENDED;
-            video_st->flags     &= ~VIDEO_FLAG_ACTIVE;
-         }
+      runahead_ring_t *ring       = &runloop_st->runahead_ring;
+      runahead_predict_t *predict = &runloop_st->runahead_predict;
+      unsigned model              = config_get_ptr()->uints.input_predictor;
+      bool held                   = false;
+      int replay_frames           = 0;
 
-         if (frame_number == 0)
-            core_run();
-         else
-            runahead_core_run_use_last_input(runloop_st);
+      /* A forced resync carries on from wherever the core is */
+      if (runloop_st->flags & RUNLOOP_FLAG_RUNAHEAD_FORCE_INPUT_DIRTY)
+         runahead_ring_reset(ring);
 
-         if (suspended_frame)
-         {
-            if (video_st->flags & VIDEO_FLAG_RUNAHEAD_IS_ACTIVE)
-               video_st->flags |=  VIDEO_FLAG_ACTIVE;
-            else
-               video_st->flags &= ~VIDEO_FLAG_ACTIVE;
+      input_driver_poll();
+      runloop_st->current_core.flags |= RETRO_CORE_FLAG_INPUT_POLLED;
+      runahead_predict_record(runloop_st);
 
-            audio_st->flags    &= ~AUDIO_FLAG_SUSPENDED;
-         }
+      if (ring->ahead == (unsigned)runahead_count)
+      {
+         held = (predict->model == model)
+            && !runahead_input_changed(runloop_st)
+            &&  runahead_predict_held(runloop_st);
+         predict->predicted_frames++;
+         if (!held)
+            predict->mispredicted_frames++;
+      }
 
-         if (frame_number == 0)
+      if (held)
+      {
+         /* Input went as predicted, so the frames already run ahead
+          * stand and one more is the frame to show. */
+         runloop_st->flags &= ~RUNLOOP_FLAG_INPUT_IS_DIRTY;
+         if (predict->model == GGPO_PREDICT_HOLD)
+            runahead_core_run_predicted(runloop_st, true);
+         else
+            runahead_core_run_polled(runloop_st);
+         ring->frame++;
+
+         /* It read an input it had not asked for before, and got
+          * something new: the ahead frames can no longer be replayed,
+          * so carry on from here. */
+         if (runloop_st->flags & RUNLOOP_FLAG_INPUT_IS_DIRTY)
+            runahead_ring_reset(ring);
+         else if (ring->frame - runahead_ring_newest(ring)
+               >= (uint64_t)runahead_count)
          {
-            if (!runahead_save_state(runloop_st))
+            if (!runahead_ring_save(runloop_st))
             {
                const char *_msg =
                   msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_SAVE_STATE);
@@ -1223,23 +1911,102 @@ void runahead_run(void *data,
                return;
             }
          }
+      }
+      else
+      {
+         /* Roll back to the last real frame, replaying the held input
+          * from the nearest ring state before it. */
+         if (ring->ahead)
+         {
+            uint64_t real_frame = ring->frame - ring->ahead;
+            int slot            = runahead_ring_find(ring, real_frame);
 
-         if (last_frame)
+            if (slot >= 0)
+            {
+               uint64_t state_frame = ring->state_frame[slot];
+
+               if (!runahead_load_state(runloop_st, (unsigned)slot))
+               {
+                  const char *_msg = msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_LOAD_STATE);
+                  runloop_msg_queue_push(_msg, strlen(_msg), 0, 3 * 60, true, NULL,
+                        MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+                  RARCH_WARN("[Run-Ahead] %s\n", _msg);
+                  return;
+               }
+
+               replay_frames = (int)(real_frame - state_frame);
+               ring->frame   = state_frame;
+            }
+         }
+         runahead_ring_reset(ring);
+
+         for (frame_number = -replay_frames;
+               frame_number <= runahead_count; frame_number++)
          {
-            if (!runahead_load_state(runloop_st))
+            last_frame      = frame_number == runahead_count;
+            suspended_frame = !last_frame;
+
+            if (suspended_frame)
             {
-               const char *_msg = msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_LOAD_STATE);
-               runloop_msg_queue_push(_msg, strlen(_msg), 0, 3 * 60, true, NULL,
-                     MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-               RARCH_WARN("[Run-Ahead] %s\n", _msg);
-               return;
+               audio_st->flags     |=  AUDIO_FLAG_SUSPENDED;
+               video_st->flags     &= ~VIDEO_FLAG_ACTIVE;
+            }
+
+            /* Replayed frames follow the old guess, which real input
+             * has confirmed; the new one starts after frame 0. */
+            if (frame_number == 0)
+            {
+               runahead_predict_rebase(runloop_st, model);
+               runloop_st->flags   &= ~RUNLOOP_FLAG_INPUT_IS_DIRTY;
+               runahead_core_run_polled(runloop_st);
+            }
+            else if (predict->model == GGPO_PREDICT_HOLD)
+               runahead_core_run_predicted(runloop_st, false);
+            else
+               runahead_core_run_use_last_input(runloop_st);
+            ring->frame++;
+
+            if (suspended_frame)
+            {
+               if (video_st->flags & VIDEO_FLAG_RUNAHEAD_IS_ACTIVE)
+                  video_st->flags |=  VIDEO_FLAG_ACTIVE;
+               else
+                  video_st->flags &= ~VIDEO_FLAG_ACTIVE;
+
+               audio_st->flags    &= ~AUDIO_FLAG_SUSPENDED;
+            }
+
+            if (frame_number == 0)
+            {
+               if (!runahead_ring_save(runloop_st))
+               {
+                  const char *_msg =
+                     msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_SAVE_STATE);
+                  runloop_msg_queue_push(_msg, strlen(_msg), 0, 3 * 60, true, NULL,
+                        MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+                  RARCH_WARN("[Run-Ahead] %s\n", _msg);
+                  return;
+               }
             }
          }
+
+         ring->ahead = (unsigned)runahead_count;
       }
+
+      runloop_st->flags &= ~RUNLOOP_FLAG_INPUT_IS_DIRTY;
    }
    else
    {
 #if HAVE_DYNAMIC
+#ifdef HAVE_THREADS
+      bool polled           = false;
+      bool threaded         = false;
+#endif
+      runahead_ring_t *ring = &runloop_st->runahead_ring;
+
+      /* The main core stays on real input here */
+      ring->ahead           = 0;
+
       if (!secondary_core_ensure_exists(runloop_st, config_get_ptr()))
       {
          const char *_msg =
@@ -1252,18 +2019,73 @@ void runahead_run(void *data,
          goto force_input_dirty;
       }
 
+#ifdef HAVE_THREADS
+      /* With input held the secondary's next frame does not depend on
+       * the main core's, so both run at once. */
+      if (     settings->bools.run_ahead_secondary_thread
+            && !(runloop_st->flags & (RUNLOOP_FLAG_INPUT_IS_DIRTY
+                  | RUNLOOP_FLAG_RUNAHEAD_FORCE_INPUT_DIRTY))
+            && runahead_secondary_worker_ready(runloop_st))
+      {
+         input_driver_poll();
+         runloop_st->current_core.flags |= RETRO_CORE_FLAG_INPUT_POLLED;
+         polled = true;
+
+         if (runahead_input_changed(runloop_st))
+            runloop_st->flags |= RUNLOOP_FLAG_INPUT_IS_DIRTY;
+         else
+         {
+            runahead_secondary_worker_start(runloop_st);
+            threaded = true;
+         }
+      }
+#endif
+
       /* run main core with video suspended */
       video_st->flags &= ~VIDEO_FLAG_ACTIVE;
-      core_run();
+#ifdef HAVE_THREADS
+      if (polled)
+         runahead_core_run_polled(runloop_st);
+      else
+#endif
+         core_run();
       if (video_st->flags & VIDEO_FLAG_RUNAHEAD_IS_ACTIVE)
          video_st->flags |=  VIDEO_FLAG_ACTIVE;
       else
          video_st->flags &= ~VIDEO_FLAG_ACTIVE;
 
+#ifdef HAVE_THREADS
+      if (threaded)
+      {
+         struct runahead_secondary_worker *worker =
+            runloop_st->secondary_worker;
+
+         runahead_secondary_worker_wait(runloop_st);
+
+         /* Unless either core read something new, that was the frame
+          * to show; otherwise the secondary is resynced below. */
+         if (worker->missed_input)
+            runloop_st->flags |= RUNLOOP_FLAG_INPUT_IS_DIRTY;
+         else if (!(runloop_st->flags & RUNLOOP_FLAG_INPUT_IS_DIRTY))
+         {
+            runloop_st->secondary_callbacks.frame_cb(
+                  worker->has_frame ? worker->frame : NULL,
+                  worker->width, worker->height, worker->pitch);
+            runloop_st->flags &= ~RUNLOOP_FLAG_RUNAHEAD_FORCE_INPUT_DIRTY;
+            return;
+         }
+      }
+#endif
+
       if (     (runloop_st->flags & RUNLOOP_FLAG_INPUT_IS_DIRTY)
             || (runloop_st->flags & RUNLOOP_FLAG_RUNAHEAD_FORCE_INPUT_DIRTY))
       {
          runloop_st->flags &= ~RUNLOOP_FLAG_INPUT_IS_DIRTY;
+         if (ring->queries_overflow)
+         {
+            ring->num_queries      = 0;
+            ring->queries_overflow = false;
+         }
 
          if (!runahead_save_state(runloop_st))
          {
@@ -1630,6 +2452,7 @@ void preempt_run(preempt_t *preempt, void *data)
          _msg = msg_hash_to_str(MSG_PREEMPT_FAILED_TO_LOAD_STATE);
          goto error;
       }
+      current_core->serialize_generation++;
 
       current_core->retro_run();
       preempt->replay_ptr = PREEMPT_NEXT_PTR(preempt->start_ptr);
@@ -1642,6 +2465,7 @@ void preempt_run(preempt_t *preempt, void *data)
             _msg = msg_hash_to_str(MSG_PREEMPT_FAILED_TO_SAVE_STATE);
             goto error;
          }
+         current_core->serialize_generation++;
 
          current_core->retro_run();
          preempt->replay_ptr = PREEMPT_NEXT_PTR(preempt->replay_ptr);
@@ -1658,6 +2482,7 @@ void preempt_run(preempt_t *preempt, void *data)
       _msg = msg_hash_to_str(MSG_PREEMPT_FAILED_TO_SAVE_STATE);
       goto error;
    }
+   current_core->serialize_generation++;
 
    preempt->start_ptr = PREEMPT_NEXT_PTR(preempt->start_ptr);
    runloop_st->flags &= ~(RUNLOOP_FLAG_REQUEST_SPECIAL_SAVESTATE
@@ -1692,4 +2517,7 @@ void runahead_clear_variables(void *data)
                                           | RUNLOOP_FLAG_RUNAHEAD_SECONDARY_CORE_AVAILABLE
                                           | RUNLOOP_FLAG_RUNAHEAD_FORCE_INPUT_DIRTY;
    runloop_st->runahead_last_frame_count  = 0;
+   runahead_ring_reset(&runloop_st->runahead_ring);
+   memset(&runloop_st->runahead_predict, 0,
+         sizeof(runloop_st->runahead_predict));
 }
@@ -23,6 +23,7 @@
 #include <retro_common_api.h>
 
 #include "core.h"
+#include "deps/ggpo/src/include/ggpo_predict.h"
 
 #define MAX_RUNAHEAD_FRAMES 12
 
@@ -38,6 +39,63 @@ typedef struct my_list_t
    int size;
 } my_list;
 
+/* Savestates kept by single-instance run-ahead to roll back to */
+#define RUNAHEAD_RING_SIZE 4
+/* Distinct input queries re-checked before running on from the ahead state */
+#define RUNAHEAD_MAX_INPUT_QUERIES 128
+
+typedef struct runahead_input_query
+{
+   unsigned port;
+   unsigned device;
+   unsigned index;
+   unsigned id;
+} runahead_input_query_t;
+
+typedef struct runahead_ring
+{
+   /* Emulated frame each runahead_save_state_list entry was taken at */
+   uint64_t state_frame[RUNAHEAD_RING_SIZE];
+   /* Frames emulated by the core, counting replays */
+   uint64_t frame;
+   /* Inputs the core has read since the last rollback */
+   runahead_input_query_t queries[RUNAHEAD_MAX_INPUT_QUERIES];
+   unsigned num_queries;
+   unsigned num_states;
+   unsigned next_state;
+   /* Frames the core is ahead of real input, 0 when there is nothing
+    * to roll back to */
+   unsigned ahead;
+   bool queries_overflow;
+} runahead_ring_t;
+
+/* Ports whose joypad buttons single-instance run-ahead predicts */
+#define RUNAHEAD_PREDICT_PORTS 4
+
+typedef struct runahead_predict
+{
+   /* Emulated frame the first predicted frame runs to */
+   uint64_t base_frame;
+   /* Real joypad button words, one per frame, history_next the oldest
+    * once full */
+   uint16_t history[RUNAHEAD_PREDICT_PORTS][GGPO_PREDICT_HISTORY];
+   /* The history at the last rollback, oldest first, as ggpo_predict()
+    * takes it, and what the model made of it */
+   uint8_t base[RUNAHEAD_PREDICT_PORTS][GGPO_PREDICT_HISTORY * 2];
+   GGPOPredictRuns runs[RUNAHEAD_PREDICT_PORTS];
+   /* Buttons handed to the core for the frame being run */
+   uint16_t word[RUNAHEAD_PREDICT_PORTS];
+   unsigned history_count;
+   unsigned history_next;
+   unsigned base_count;
+   /* GGPOPredictModel the frames run ahead were guessed with */
+   unsigned model;
+   unsigned predicted_frames;
+   unsigned mispredicted_frames;
+   /* Inputs the model does not cover are read live rather than held */
+   bool live;
+} runahead_predict_t;
+
 typedef struct preemptive_frames_data
 {
    /* Savestate buffer */
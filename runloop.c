@@ -46,6 +46,10 @@
 #include <process.h>
 #endif
 
+#if defined(__APPLE__)
+#include <mach/mach_time.h>
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
@@ -219,6 +223,8 @@
 #include "tasks/task_powerstate.h"
 #include "tasks/tasks_internal.h"
 #include "performance_counters.h"
+#include "frame_timeline.h"
+#include "clock_governor.h"
 
 #include "version.h"
 #include "version_git.h"
@@ -318,6 +324,29 @@
 #define PERF_LOG_FMT "[PERF] Avg (%s): %llu ticks, %llu runs.\n"
 #endif
 
+#ifdef _WIN32
+#define PERF_WINDOW_FMT "perf %s calls=%I64u avg=%I64u p50=%u p99=%u max=%u\n"
+#else
+#define PERF_WINDOW_FMT "perf %s calls=%llu avg=%llu p50=%u p99=%u max=%u\n"
+#endif
+
+#define RUNLOOP_PERF_WINDOW_FRAMES 64
+
+typedef struct runloop_perf_slot
+{
+   const struct retro_perf_counter *counter;
+   retro_perf_tick_t last_total;
+   unsigned frames;
+   uint32_t cost[RUNLOOP_PERF_WINDOW_FRAMES];
+} runloop_perf_slot_t;
+
+/* Frontend counters first, then the core's */
+typedef struct runloop_perf_window
+{
+   runloop_perf_slot_t slots[MAX_COUNTERS * 2];
+   unsigned pos;
+} runloop_perf_window_t;
+
 static runloop_state_t runloop_state      = {0};
 
 /* GLOBAL POINTER GETTERS */
@@ -389,6 +418,113 @@ void runloop_log_counters(
    }
 }
 
+static void runloop_perf_window_sample_list(runloop_perf_window_t *window,
+      runloop_perf_slot_t *slots,
+      struct retro_perf_counter **counters, unsigned num)
+{
+   unsigned i;
+   for (i = 0; i < num; i++)
+   {
+      runloop_perf_slot_t *slot = &slots[i];
+      retro_perf_tick_t   delta;
+
+      /* A new counter in this place starts its window over */
+      if (slot->counter != counters[i])
+      {
+         slot->counter    = counters[i];
+         slot->last_total = counters[i]->total;
+         slot->frames     = 0;
+         continue;
+      }
+
+      delta                       = counters[i]->total - slot->last_total;
+      slot->last_total            = counters[i]->total;
+      slot->cost[window->pos]     = delta > UINT32_MAX
+         ? UINT32_MAX : (uint32_t)delta;
+      if (slot->frames < RUNLOOP_PERF_WINDOW_FRAMES)
+         slot->frames++;
+   }
+}
+
+static void runloop_perf_window_sample(runloop_state_t *runloop_st)
+{
+   runloop_perf_window_t *window = runloop_st->perf_window;
+
+   if (!window)
+   {
+      if (!(window = (runloop_perf_window_t*)calloc(1, sizeof(*window))))
+         return;
+      runloop_st->perf_window = window;
+   }
+
+   runloop_perf_window_sample_list(window, window->slots,
+         retro_get_perf_counter_rarch(), retro_get_perf_count_rarch());
+   runloop_perf_window_sample_list(window, window->slots + MAX_COUNTERS,
+         runloop_st->perf_counters_libretro, runloop_st->perf_ptr_libretro);
+   window->pos = (window->pos + 1) % RUNLOOP_PERF_WINDOW_FRAMES;
+}
+
+static int runloop_perf_cost_compare(const void *a, const void *b)
+{
+   uint32_t x = *(const uint32_t*)a;
+   uint32_t y = *(const uint32_t*)b;
+   return (x > y) - (x < y);
+}
+
+static size_t runloop_perf_window_format_list(char *s, size_t len,
+      const runloop_perf_window_t *window, const runloop_perf_slot_t *slots,
+      struct retro_perf_counter **counters, unsigned num)
+{
+   unsigned i, j;
+   size_t _len = 0;
+
+   for (i = 0; i < num && _len < len; i++)
+   {
+      uint32_t cost[RUNLOOP_PERF_WINDOW_FRAMES];
+      const runloop_perf_slot_t *slot = slots ? &slots[i] : NULL;
+      unsigned frames                 = 0;
+      int n;
+
+      if (!counters[i]->call_cnt)
+         continue;
+
+      if (slot && slot->counter == counters[i])
+      {
+         /* The newest frames, wherever the ring has got to */
+         for (j = 1; j <= slot->frames; j++)
+            cost[frames++] = slot->cost[(window->pos
+                  + RUNLOOP_PERF_WINDOW_FRAMES - j)
+                  % RUNLOOP_PERF_WINDOW_FRAMES];
+         qsort(cost, frames, sizeof(cost[0]), runloop_perf_cost_compare);
+      }
+
+      n = snprintf(s + _len, len - _len, PERF_WINDOW_FMT,
+            counters[i]->ident,
+            (unsigned long long)counters[i]->call_cnt,
+            (unsigned long long)(counters[i]->total / counters[i]->call_cnt),
+            frames ? cost[frames / 2]                : 0,
+            frames ? cost[(frames - 1) * 99 / 100]   : 0,
+            frames ? cost[frames - 1]                : 0);
+      if (n < 0)
+         break;
+      _len += (size_t)n;
+   }
+
+   return MIN(_len, len ? len - 1 : 0);
+}
+
+size_t runloop_perf_window_format(char *s, size_t len)
+{
+   const runloop_perf_window_t *window = runloop_state.perf_window;
+   size_t _len = runloop_perf_window_format_list(s, len, window,
+         window ? window->slots : NULL,
+         retro_get_perf_counter_rarch(), retro_get_perf_count_rarch());
+   return _len + runloop_perf_window_format_list(s + _len, len - _len,
+         window, window ? window->slots + MAX_COUNTERS : NULL,
+         runloop_state.perf_counters_libretro,
+         runloop_state.perf_ptr_libretro);
+}
+
 static void runloop_perf_log(void)
 {
    if (!runloop_state.perfcnt_enable)
@@ -2979,6 +3115,12 @@ bool runloop_environment_cb(unsigned cmd, void *data)
          video_driver_state_t *video_st = video_state_get_ptr();
          struct retro_framebuffer *fb   = (struct retro_framebuffer*)data;
 
+#ifdef HAVE_VIDEO_FILTER
+         /* The softfilter writes into the buffer the driver lends */
+         if (video_st->state_filter)
+            return false;
+#endif
+
          if (
                   video_st->poke
                && video_st->poke->get_current_software_framebuffer
@@ -3035,6 +3177,27 @@ bool runloop_environment_cb(unsigned cmd, void *data)
          break;
       }
 
+      case RETRO_ENVIRONMENT_SET_SERIALIZE_DIRTY_INTERFACE:
+      {
+         const struct retro_serialize_dirty_interface *iface =
+            (const struct retro_serialize_dirty_interface*)data;
+
+         if (     !iface
+               || iface->interface_version < 1
+               || !iface->get_dirty
+               || !iface->block_size
+               || (iface->block_size & (iface->block_size - 1)))
+         {
+            RARCH_WARN("[Environ] SET_SERIALIZE_DIRTY_INTERFACE: Invalid interface.\n");
+            return false;
+         }
+
+         RARCH_LOG("[Environ] SET_SERIALIZE_DIRTY_INTERFACE: %u-byte blocks.\n",
+               (unsigned)iface->block_size);
+         runloop_st->current_core.serialize_dirty = *iface;
+         break;
+      }
+
       case RETRO_ENVIRONMENT_SET_HW_SHARED_CONTEXT:
 #ifdef HAVE_LIBNX
          RARCH_LOG("[Environ] SET_HW_SHARED_CONTEXT: Ignored for now.\n");
@@ -3923,6 +4086,8 @@ static void uninit_libretro_symbols(
    runloop_st->perf_ptr_libretro  = 0;
    memset(runloop_st->perf_counters_libretro, 0,
          sizeof(runloop_st->perf_counters_libretro));
+   free(runloop_st->perf_window);
+   runloop_st->perf_window        = NULL;
 }
 
 
@@ -4071,6 +4236,9 @@ void runloop_event_deinit_core(void)
       *video_st                = video_state_get_ptr();
    runloop_state_t *runloop_st = &runloop_state;
    settings_t        *settings = config_get_ptr();
+   retro_time_t unload_time    = cpu_features_get_time_usec();
+   bool video_kept             = false;
+   bool audio_kept             = false;
 
    core_unload_game();
 
@@ -4122,8 +4290,21 @@ void runloop_event_deinit_core(void)
    if (settings->bools.video_frame_delay_auto)
       video_st->frame_delay_target = 0;
 
+   /* Whether the next core can reuse them is only known
+    * once it is loaded; see drivers_init */
+   if (settings->bools.content_switch_seamless)
+   {
+      video_kept = video_driver_keep_alive();
+      audio_kept = audio_driver_keep_alive();
+   }
+
    driver_uninit(DRIVERS_CMD_ALL, (enum driver_lifetime_flags)0);
 
+   RARCH_LOG("[Core] Unload: %.1f ms (video driver %s, audio driver %s).\n",
+         (cpu_features_get_time_usec() - unload_time) / 1000.0f,
+         video_kept ? "kept" : "closed",
+         audio_kept ? "kept" : "closed");
+
 #ifdef HAVE_CONFIGFILE
    if (runloop_st->flags & RUNLOOP_FLAG_OVERRIDES_ACTIVE)
    {
@@ -4602,7 +4783,9 @@ static void core_input_state_poll_maybe(void)
    enum poll_type new_poll_type      = (core_poll_type_override > POLL_TYPE_OVERRIDE_DONTCARE)
       ? (enum poll_type)(core_poll_type_override - 1)
       : (enum poll_type)(runloop_st->current_core.poll_type);
-   if (new_poll_type == POLL_TYPE_NORMAL)
+   /* Already polled for this frame by core_latch_input() */
+   if (     (new_poll_type == POLL_TYPE_NORMAL)
+         && !(runloop_st->current_core.flags & RETRO_CORE_FLAG_INPUT_POLLED))
       input_driver_poll();
 }
 
@@ -5507,6 +5690,32 @@ static bool display_menu_libretro(
 
    return true;
 }
+
+/* Whether anything drawn over the menu changes from
+ * frame to frame; the menu can only skip frames if not */
+static bool runloop_menu_overlays_static(
+      runloop_state_t *runloop_st, settings_t *settings)
+{
+#if defined(HAVE_GFX_WIDGETS)
+   dispgfx_widget_t *p_dispwidget = dispwidget_get_ptr();
+
+   if (     p_dispwidget->active
+         && (   p_dispwidget->current_msgs_size
+             || p_dispwidget->msg_queue_tasks_count))
+      return false;
+#endif
+
+   /* Messages without widgets count down by frames */
+   return   !runloop_st->msg_queue_size
+         && !runloop_st->core_status_msg.set
+         && !recording_state_get_ptr()->data
+         && !settings->bools.video_fps_show
+         && !settings->bools.video_statistics_show
+         && !settings->bools.video_framecount_show
+         && !settings->bools.video_memory_show
+         && !settings->uints.video_black_frame_insertion
+         && (settings->uints.video_shader_subframes <= 1);
+}
 #endif
 
 #define HOTKEY_CHECK(cmd1, cmd2, cond, cond2) \
@@ -6063,6 +6272,7 @@ static enum runloop_state_enum runloop_check_state(
       static enum menu_action
          old_action                 = MENU_ACTION_CANCEL;
       bool focused                  = false;
+      bool menu_frame_static        = false;
       input_bits_t trigger_input    = current_bits;
       unsigned screensaver_timeout  = settings->uints.menu_screensaver_timeout;
 
@@ -6300,7 +6510,20 @@ static enum runloop_state_enum runloop_check_state(
                }
             }
 
-            if (BIT64_GET(menu->state, MENU_STATE_BLIT))
+            gfx_thumbnail_process_uploads();
+
+            /* Neither draw nor present a menu that would
+             * look the same as the frame on screen */
+            if (     !libretro_running
+                  && (menu_st->flags & MENU_ST_FLAG_ALIVE)
+                  && !(runloop_st->flags & RUNLOOP_FLAG_IDLE))
+               menu_frame_static = menu_driver_frame_is_static(
+                     menu_st, p_disp, anim_get_ptr(),
+                     video_st->width, video_st->height,
+                     runloop_menu_overlays_static(runloop_st, settings));
+
+            if (     !menu_frame_static
+                  && BIT64_GET(menu->state, MENU_STATE_BLIT))
             {
                if (menu->driver_ctx->render)
                   menu->driver_ctx->render(
@@ -6310,7 +6533,8 @@ static enum runloop_state_enum runloop_check_state(
                         (runloop_st->flags & RUNLOOP_FLAG_IDLE) ? true : false);
             }
 
-            if (      (menu_st->flags & MENU_ST_FLAG_ALIVE)
+            if (      !menu_frame_static
+                  && (menu_st->flags & MENU_ST_FLAG_ALIVE)
                   && !(runloop_st->flags & RUNLOOP_FLAG_IDLE))
                if (display_menu_libretro(runloop_st, input_st,
                         settings->floats.slowmotion_ratio,
@@ -6330,7 +6554,9 @@ static enum runloop_state_enum runloop_check_state(
       old_input                 = current_bits;
       old_action                = action;
 
-      if (!focused || (runloop_st->flags & RUNLOOP_FLAG_IDLE))
+      if (     !focused
+            || menu_frame_static
+            || (runloop_st->flags & RUNLOOP_FLAG_IDLE))
          return RUNLOOP_STATE_POLLED_AND_SLEEP;
    }
    else
@@ -7157,6 +7383,212 @@ end:
 
 
 
+/* Time before the frame limiter's target that is spun through
+ * rather than slept, to cover the wakeup latency of the timer */
+#define RUNLOOP_FRAME_LIMIT_SPIN_USEC         250
+#define RUNLOOP_FRAME_LIMIT_SPIN_USEC_TIMER   1000
+#define RUNLOOP_FRAME_LIMIT_SPIN_USEC_COARSE  2000
+
+#if defined(_WIN32) && !defined(_XBOX) && !defined(__WINRT__)
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+typedef HANDLE (WINAPI *runloop_create_timer_ex_t)(
+      LPSECURITY_ATTRIBUTES, LPCWSTR, DWORD, DWORD);
+
+/* A high resolution waitable timer (Windows 10 1803 and later)
+ * wakes within a fraction of a millisecond; older systems get a
+ * plain one at the scheduler's granularity */
+static HANDLE runloop_frame_limit_timer(bool *high_res)
+{
+   static HANDLE timer    = NULL;
+   static bool timer_init = false;
+   static bool timer_fine = false;
+
+   if (!timer_init)
+   {
+      runloop_create_timer_ex_t create_timer_ex =
+         (runloop_create_timer_ex_t)GetProcAddress(
+               GetModuleHandleA("kernel32.dll"),
+               "CreateWaitableTimerExW");
+
+      timer_init = true;
+      if (create_timer_ex)
+         timer   = create_timer_ex(NULL, NULL,
+               CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+      timer_fine = (timer != NULL);
+      if (!timer)
+         timer   = CreateWaitableTimerW(NULL, TRUE, NULL);
+   }
+
+   *high_res = timer_fine;
+   return timer;
+}
+#endif
+
+/* Hidden frames at most per fast-forward batch, so input, rewind and
+ * the menu toggle still get a look in on a very fast core. */
+#define FASTFORWARD_BATCH_MAX_FRAMES 32
+/* How often the fast-forward speed is updated */
+#define FASTFORWARD_BATCH_SPEED_USEC 500000
+
+static bool runloop_fastforward_batch_enabled(runloop_state_t *runloop_st,
+      input_driver_state_t *input_st, settings_t *settings)
+{
+   if (     !settings->bools.fastforward_frame_batch
+         || !(runloop_st->flags & RUNLOOP_FLAG_FASTMOTION)
+         || runloop_st->run_frames_and_pause
+         || settings->floats.video_refresh_rate <= 0.0f)
+      return false;
+#ifdef HAVE_NETWORKING
+   if (netplay_driver_ctl(RARCH_NETPLAY_CTL_IS_ENABLED, NULL))
+      return false;
+#endif
+#ifdef HAVE_BSV_MOVIE
+   /* Replays record and play back input one iteration at a time */
+   if (input_st->bsv_movie_state_handle)
+      return false;
+#endif
+   return true;
+}
+
+/**
+ * runloop_fastforward_batch_run:
+ *
+ * Runs the core with video and audio suspended for as many frames as
+ * fit in one display refresh, leaving room for the frame the caller
+ * runs next, which is the only one presented and mixed. A fast-forward
+ * ratio caps the batch at the frames it allows per refresh, and the
+ * frame limiter is moved on by the hidden frames.
+ **/
+static void runloop_fastforward_batch_run(runloop_state_t *runloop_st,
+      settings_t *settings)
+{
+   video_driver_state_t *video_st         = video_state_get_ptr();
+   audio_driver_state_t *audio_st         = audio_state_get_ptr();
+   runloop_fastforward_batch_t *batch     = &runloop_st->fastforward_batch;
+   bool video_active                      = (video_st->flags & VIDEO_FLAG_ACTIVE)
+      ? true : false;
+   retro_time_t budget                    = (retro_time_t)(1000000.0f
+         / settings->floats.video_refresh_rate);
+   retro_time_t start                     = cpu_features_get_time_usec();
+   retro_time_t now                       = start;
+   unsigned max_frames                    = FASTFORWARD_BATCH_MAX_FRAMES;
+   unsigned frames                        = 0;
+#ifdef HAVE_CHEEVOS
+   bool cheevos_enable                    = settings->bools.cheevos_enable;
+#endif
+
+   if (runloop_st->frame_limit_minimum_time > 0)
+      max_frames = MIN(max_frames, MAX(budget
+               / runloop_st->frame_limit_minimum_time, 1));
+
+   while (     frames + 1 < max_frames
+         && now - start + 2 * batch->frame_usec < budget)
+   {
+      retro_time_t frame_start = now;
+
+      if (runloop_st->frame_time.callback)
+         runloop_st->frame_time.callback(runloop_st->frame_time.reference);
+
+      audio_st->flags |=  AUDIO_FLAG_SUSPENDED;
+      video_st->flags &= ~VIDEO_FLAG_ACTIVE;
+      core_run();
+      audio_st->flags &= ~AUDIO_FLAG_SUSPENDED;
+      if (video_active)
+         video_st->flags |= VIDEO_FLAG_ACTIVE;
+
+#ifdef HAVE_CHEEVOS
+      if (cheevos_enable)
+         rcheevos_test();
+#endif
+#ifdef HAVE_CHEATS
+      cheat_manager_apply_retro_cheats();
+#endif
+
+      now               = cpu_features_get_time_usec();
+      batch->frame_usec = batch->frame_usec
+         ? (batch->frame_usec * 7 + (now - frame_start)) / 8
+         : now - frame_start;
+      frames++;
+   }
+
+   if (runloop_st->frame_limit_minimum_time > 0)
+      runloop_st->frame_limit_last_time +=
+         frames * runloop_st->frame_limit_minimum_time;
+
+   batch->frames         = frames + 1;
+   batch->window_frames += frames + 1;
+   if (!batch->window_start)
+      batch->window_start = start;
+   else if (now - batch->window_start >= FASTFORWARD_BATCH_SPEED_USEC)
+   {
+      batch->speed         = (float)(batch->window_frames * 1000000.0
+            / ((now - batch->window_start) * video_st->av_info.timing.fps));
+      batch->window_start  = now;
+      batch->window_frames = 0;
+   }
+}
+
+/**
+ * runloop_frame_limit_wait:
+ * @target               : time to return at, in microseconds
+ *
+ * Sleeps with the finest timer the platform has until shortly
+ * before @target, then spins the rest of the way, so that frames
+ * leave at the content's own rate to well under a millisecond.
+ **/
+static void runloop_frame_limit_wait(retro_time_t target)
+{
+   retro_time_t now  = cpu_features_get_time_usec();
+#if defined(_WIN32) && !defined(_XBOX) && !defined(__WINRT__)
+   bool high_res     = false;
+   HANDLE timer      = runloop_frame_limit_timer(&high_res);
+   retro_time_t spin = high_res
+      ? RUNLOOP_FRAME_LIMIT_SPIN_USEC_TIMER
+      : RUNLOOP_FRAME_LIMIT_SPIN_USEC_COARSE;
+
+   if (target - now > spin)
+   {
+      LARGE_INTEGER due;
+      /* Relative, in 100 ns units */
+      due.QuadPart = -(LONGLONG)(target - now - spin) * 10;
+      if (timer && SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE))
+         WaitForSingleObject(timer, INFINITE);
+      else
+         Sleep((DWORD)((target - now - spin) / 1000));
+   }
+#elif defined(__APPLE__)
+   if (target - now > RUNLOOP_FRAME_LIMIT_SPIN_USEC)
+   {
+      mach_timebase_info_data_t timebase;
+      uint64_t ticks = (uint64_t)(target - now
+            - RUNLOOP_FRAME_LIMIT_SPIN_USEC) * 1000;
+      mach_timebase_info(&timebase);
+      if (timebase.numer)
+         ticks = ticks * timebase.denom / timebase.numer;
+      mach_wait_until(mach_absolute_time() + ticks);
+   }
+#elif defined(__linux__) || defined(__FreeBSD__) || defined(__NetBSD__) \
+   || defined(__OpenBSD__) || defined(__DragonFly__)
+   if (target - now > RUNLOOP_FRAME_LIMIT_SPIN_USEC)
+   {
+      struct timespec tv;
+      retro_time_t usec = target - now - RUNLOOP_FRAME_LIMIT_SPIN_USEC;
+      tv.tv_sec         = (time_t)(usec / 1000000);
+      tv.tv_nsec        = (long)(usec % 1000000) * 1000;
+      nanosleep(&tv, NULL);
+   }
+#else
+   if (target - now > RUNLOOP_FRAME_LIMIT_SPIN_USEC_COARSE)
+      retro_sleep((unsigned)((target - now
+                  - RUNLOOP_FRAME_LIMIT_SPIN_USEC_COARSE) / 1000));
+#endif
+
+   while (cpu_features_get_time_usec() < target);
+}
+
 /**
  * runloop_iterate:
  *
@@ -7404,7 +7836,15 @@ int runloop_iterate(void)
          preempt_run(runloop_st->preempt_data, runloop_st);
       else
 #endif
+      {
+         if (runloop_fastforward_batch_enabled(runloop_st, input_st,
+                  settings))
+            runloop_fastforward_batch_run(runloop_st, settings);
+         else if (runloop_st->fastforward_batch.frames)
+            memset(&runloop_st->fastforward_batch, 0,
+                  sizeof(runloop_st->fastforward_batch));
          core_run();
+      }
    }
 
    /* Increment runtime tick counter after each call to
@@ -7412,6 +7852,9 @@ int runloop_iterate(void)
    runloop_st->core_runtime_usec += runloop_core_runtime_tick(
          runloop_st, slowmotion_ratio, current_time);
 
+   if (runloop_st->perfcnt_enable)
+      runloop_perf_window_sample(runloop_st);
+
 #ifdef HAVE_CHEEVOS
    if (cheevos_enable)
       rcheevos_test();
@@ -7423,7 +7866,9 @@ int runloop_iterate(void)
    presence_update(PRESENCE_GAME);
 #endif
 #ifdef HAVE_BSV_MOVIE
-   bsv_movie_next_frame(input_st);
+   /* A frame netplay held never ran, so it has no inputs to record */
+   if (!(runloop_st->current_core.flags & RETRO_CORE_FLAG_FRAME_HELD))
+      bsv_movie_next_frame(input_st);
    if (input_st->bsv_movie_state.flags & BSV_FLAG_MOVIE_END)
    {
       movie_stop_playback(input_st);
@@ -7488,10 +7933,30 @@ end:
               || (runloop_st->flags & RUNLOOP_FLAG_PAUSED)))
    {
       const retro_time_t end_frame_time  = cpu_features_get_time_usec();
-      const retro_time_t to_sleep_ms     = (
-            (  runloop_st->frame_limit_last_time
-             + runloop_st->frame_limit_minimum_time)
-            - end_frame_time) / 1000;
+      const retro_time_t target_time     =
+              runloop_st->frame_limit_last_time
+            + runloop_st->frame_limit_minimum_time;
+      const retro_time_t to_sleep_ms     =
+            (target_time - end_frame_time) / 1000;
+      /* Pace running content to the microsecond when 'Sync to Exact
+       * Content Framerate' is on, so that a VRR display refreshes at
+       * the core's rate without whole-millisecond jitter */
+      bool precise_wait                  = vrr_runloop_enable
+         && !(runloop_st->flags & RUNLOOP_FLAG_PAUSED)
+#ifdef HAVE_MENU
+         && !(menu_state_get_ptr()->flags & MENU_ST_FLAG_ALIVE)
+#endif
+         ;
+
+      if (precise_wait && target_time > end_frame_time)
+      {
+         runloop_st->frame_limit_last_time = target_time;
+#if defined(HAVE_COCOATOUCH)
+         if (uico_state_get_ptr()->flags & UICO_ST_FLAG_IS_ON_FOREGROUND)
+#endif
+            runloop_frame_limit_wait(target_time);
+         return 1;
+      }
 
       if (to_sleep_ms > 0)
       {
@@ -7947,6 +8412,7 @@ bool core_unserialize(retro_ctx_serialize_info_t *info)
    runloop_state_t *runloop_st  = &runloop_state;
    if (!info || !runloop_st->current_core.retro_unserialize(info->data_const, info->size))
       return false;
+   runloop_st->current_core.serialize_generation++;
 
 #ifdef HAVE_NETWORKING
    netplay_driver_ctl(RARCH_NETPLAY_CTL_LOAD_SAVESTATE, info);
@@ -7969,6 +8435,8 @@ bool core_unserialize_special(retro_ctx_serialize_info_t *info)
    runloop_st->flags |=  RUNLOOP_FLAG_REQUEST_SPECIAL_SAVESTATE;
    ret = runloop_st->current_core.retro_unserialize(info->data_const, info->size);
    runloop_st->flags &= ~RUNLOOP_FLAG_REQUEST_SPECIAL_SAVESTATE;
+   if (ret)
+      runloop_st->current_core.serialize_generation++;
 
 #ifdef HAVE_NETWORKING
    if (ret)
@@ -7983,6 +8451,7 @@ bool core_serialize(retro_ctx_serialize_info_t *info)
    runloop_state_t *runloop_st  = &runloop_state;
    if (!info || !runloop_st->current_core.retro_serialize(info->data, info->size))
       return false;
+   runloop_st->current_core.serialize_generation++;
    return true;
 }
 
@@ -7998,10 +8467,34 @@ bool core_serialize_special(retro_ctx_serialize_info_t *info)
    ret                = runloop_st->current_core.retro_serialize(
                         info->data, info->size);
    runloop_st->flags &= ~RUNLOOP_FLAG_REQUEST_SPECIAL_SAVESTATE;
+   if (ret)
+      runloop_st->current_core.serialize_generation++;
 
    return ret;
 }
 
+size_t core_serialize_dirty_block_size(void)
+{
+   runloop_state_t *runloop_st  = &runloop_state;
+   return runloop_st->current_core.serialize_dirty.get_dirty
+      ? runloop_st->current_core.serialize_dirty.block_size : 0;
+}
+
+uint32_t core_serialize_generation(void)
+{
+   runloop_state_t *runloop_st  = &runloop_state;
+   return runloop_st->current_core.serialize_generation;
+}
+
+bool core_serialize_dirty(uint8_t *bitmap, size_t len)
+{
+   runloop_state_t *runloop_st  = &runloop_state;
+   if (!runloop_st->current_core.serialize_dirty.get_dirty || !bitmap)
+      return false;
+   memset(bitmap, 0, len);
+   return runloop_st->current_core.serialize_dirty.get_dirty(bitmap, len);
+}
+
 size_t core_serialize_size(void)
 {
    runloop_state_t *runloop_st  = &runloop_state;
@@ -8031,6 +8524,7 @@ void core_reset(void)
    video_driver_state_t *video_st = video_state_get_ptr();
    video_st->frame_cache_data     = NULL;
    runloop_st->current_core.retro_reset();
+   runloop_st->current_core.serialize_generation++;
 }
 
 void core_run(void)
@@ -8046,25 +8540,50 @@ void core_run(void)
    bool early_polling          = new_poll_type == POLL_TYPE_EARLY;
    bool late_polling           = new_poll_type == POLL_TYPE_LATE;
 #ifdef HAVE_NETWORKING
-   bool netplay_preframe       = netplay_driver_ctl(
+   bool netplay_preframe;
+#endif
+
+   current_core->flags        &= ~(RETRO_CORE_FLAG_INPUT_POLLED
+                                 | RETRO_CORE_FLAG_FRAME_HELD);
+
+#ifdef HAVE_NETWORKING
+   netplay_preframe            = netplay_driver_ctl(
          RARCH_NETPLAY_CTL_PRE_FRAME, NULL);
 
    if (!netplay_preframe)
    {
       /* Paused due to netplay. We must poll and display something so that a
        * netplay peer pausing doesn't just hang. */
-      input_driver_poll();
+      if (!(current_core->flags & RETRO_CORE_FLAG_INPUT_POLLED))
+         input_driver_poll();
       video_driver_cached_frame();
+      current_core->flags     |= RETRO_CORE_FLAG_FRAME_HELD;
       return;
    }
 #endif
 
    if (early_polling)
       input_driver_poll();
-   else if (late_polling)
-      current_core->flags &= ~RETRO_CORE_FLAG_INPUT_POLLED;
 
-   current_core->retro_run();
+   {
+      retro_time_t timeline_start = frame_timeline_begin();
+      current_core->retro_run();
+      frame_timeline_end(FRAME_TIMELINE_CORE_RUN, timeline_start);
+   }
+
+   if (clock_governor_is_active())
+   {
+      video_driver_state_t *video_st = video_state_get_ptr();
+      double fps                     = video_st->av_info.timing.fps;
+      clock_governor_frame(fps > 0.0 ? (float)(1000.0 / fps) : 0.0f,
+            runloop_st->system.info.library_name,
+#ifdef HAVE_NETWORKING
+            netplay_driver_ctl(RARCH_NETPLAY_CTL_IS_ENABLED, NULL)
+#else
+            false
+#endif
+            );
+   }
 
 #ifdef HAVE_GAME_AI
    {
@@ -8091,6 +8610,13 @@ void core_run(void)
 #endif
 }
 
+void core_latch_input(void)
+{
+   runloop_state_t *runloop_st = &runloop_state;
+   input_driver_poll();
+   runloop_st->current_core.flags |= RETRO_CORE_FLAG_INPUT_POLLED;
+}
+
 bool core_has_set_input_descriptor(void)
 {
    runloop_state_t *runloop_st = &runloop_state;
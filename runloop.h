@@ -161,6 +161,17 @@ typedef struct core_options_callbacks
    retro_core_options_update_display_callback_t update_display;
 } core_options_callbacks_t;
 
+/* Core frames run per display refresh while fast forwarding with
+ * 'fastforward_frame_batch', and the speed they add up to. */
+typedef struct runloop_fastforward_batch
+{
+   retro_time_t frame_usec;      /* running average cost of a hidden frame */
+   retro_time_t window_start;
+   unsigned window_frames;
+   unsigned frames;              /* core frames in the last batch */
+   float speed;                  /* emulated time versus real time */
+} runloop_fastforward_batch_t;
+
 struct runloop
 {
 #if defined(HAVE_CG) || defined(HAVE_GLSL) || defined(HAVE_SLANG) || defined(HAVE_HLSL)
@@ -172,16 +183,20 @@ struct runloop
    retro_time_t frame_limit_minimum_time;
    retro_time_t frame_limit_last_time;
    retro_usec_t frame_time_last;                /* int64_t alignment */
+   runloop_fastforward_batch_t fastforward_batch; /* int64_t alignment */
 
    struct retro_core_t        current_core;     /* uint64_t alignment */
 #if defined(HAVE_RUNAHEAD)
    uint64_t runahead_last_frame_count;          /* uint64_t alignment */
+   runahead_ring_t runahead_ring;               /* uint64_t alignment */
+   runahead_predict_t runahead_predict;         /* uint64_t alignment */
 #if defined(HAVE_DYNAMIC) || defined(HAVE_DYLIB)
    struct retro_core_t secondary_core;          /* uint64_t alignment */
 #endif
    retro_ctx_load_content_info_t *load_content_info;
 #if defined(HAVE_DYNAMIC) || defined(HAVE_DYLIB)
    char    *secondary_library_path;
+   struct runahead_secondary_worker *secondary_worker;
 #endif
    my_list *runahead_save_state_list;
    my_list *input_state_list;
@@ -192,6 +207,8 @@ struct runloop
    struct state_manager_rewind_state rewind_st;
 #endif
    struct retro_perf_counter *perf_counters_libretro[MAX_COUNTERS];
+   /* Recent per-frame cost of each counter, while perfcnt is enabled */
+   struct runloop_perf_window *perf_window;
    bool    *load_no_content_hook;
    struct string_list *subsystem_fullpaths;
    struct retro_subsystem_info subsystem_data[SUBSYSTEM_MAX_SUBSYSTEMS];
@@ -300,6 +317,11 @@ struct runloop
    } name;
 
    bool perfcnt_enable;
+#if defined(HAVE_RUNAHEAD) && (defined(HAVE_DYNAMIC) || defined(HAVE_DYLIB))
+   /* secondary_library_path is a cached copy, kept
+    * for the next session */
+   bool secondary_library_cached;
+#endif
 };
 
 typedef struct runloop runloop_state_t;
@@ -408,6 +430,20 @@ bool secondary_core_ensure_exists(void *data, settings_t *settings);
 void runloop_log_counters(
       struct retro_perf_counter **counters, unsigned num);
 
+/**
+ * runloop_perf_window_format:
+ * @s                   : output buffer
+ * @len                 : size of @s
+ *
+ * Writes a line per performance counter, frontend and core, with its
+ * call count, its average ticks per call and the median, 99th
+ * percentile and maximum of its ticks per frame over the last
+ * RUNLOOP_PERF_WINDOW_FRAMES frames.
+ *
+ * Returns: length of the string written to @s.
+ **/
+size_t runloop_perf_window_format(char *s, size_t len);
+
 void runloop_msg_queue_deinit(void);
 
 void runloop_msg_queue_init(void);
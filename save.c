@@ -61,10 +61,19 @@ struct autosave_st
    unsigned num;
 };
 
+/* SRAM is compared, and written in place, in blocks of this size */
+#define AUTOSAVE_BLOCK_SIZE      4096
+/* Clean blocks between two dirty ones that are written along with
+ * them rather than seeked over */
+#define AUTOSAVE_COALESCE_BLOCKS 2
+
 enum autosave_flags
 {
    AUTOSAVE_FLAG_QUIT           = (1 << 0),
-   AUTOSAVE_FLAG_COMPRESS_FILES = (1 << 1)
+   AUTOSAVE_FLAG_COMPRESS_FILES = (1 << 1),
+   /* The file holds 'buffer' as of the last write, so dirty blocks can
+    * be written over it */
+   AUTOSAVE_FLAG_IN_PLACE       = (1 << 2)
 };
 
 struct autosave
@@ -76,7 +85,13 @@ struct autosave
    slock_t *cond_lock;
    scond_t *cond;
    sthread_t *thread;
+   /* Per block, whether it changed since it was last written */
+   uint8_t *dirty;
    size_t bufsize;
+   size_t blocks;
+   uint64_t bytes_written;
+   time_t start_time;
+   unsigned writes;
    unsigned interval;
    uint8_t flags;
 };
@@ -84,6 +99,120 @@ struct autosave
 static struct autosave_st autosave_state;
 
 
+/* Copies the blocks that changed from the core's SRAM and marks them
+ * dirty. Returns how many there are. */
+static size_t autosave_update(autosave_t *save)
+{
+   size_t i;
+   size_t count           = 0;
+   uint8_t *buffer        = (uint8_t*)save->buffer;
+   const uint8_t *current = (const uint8_t*)save->retro_buffer;
+
+   for (i = 0; i < save->blocks; i++)
+   {
+      size_t offset = i * AUTOSAVE_BLOCK_SIZE;
+      size_t len    = MIN(AUTOSAVE_BLOCK_SIZE, save->bufsize - offset);
+      if (memcmp(buffer + offset, current + offset, len))
+      {
+         memcpy(buffer + offset, current + offset, len);
+         save->dirty[i] = 1;
+      }
+      if (save->dirty[i])
+         count++;
+   }
+
+   return count;
+}
+
+/* Writes the dirty blocks over the file, each run of them at once */
+static bool autosave_write_blocks(autosave_t *save)
+{
+   size_t i;
+   RFILE *file = filestream_open(save->path,
+         RETRO_VFS_FILE_ACCESS_READ_WRITE
+         | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   bool ret    = true;
+
+   if (!file)
+      return false;
+   if (filestream_get_size(file) != (int64_t)save->bufsize)
+   {
+      filestream_close(file);
+      return false;
+   }
+
+   for (i = 0; ret && i < save->blocks; )
+   {
+      size_t start, end, offset, len;
+      if (!save->dirty[i++])
+         continue;
+      start = end = i - 1;
+      while (i < save->blocks && i <= end + AUTOSAVE_COALESCE_BLOCKS + 1)
+         if (save->dirty[i++])
+            end = i - 1;
+      i      = end + 1;
+      offset = start * AUTOSAVE_BLOCK_SIZE;
+      len    = MIN((end + 1) * AUTOSAVE_BLOCK_SIZE, save->bufsize) - offset;
+      if (     filestream_seek(file, offset, RETRO_VFS_SEEK_POSITION_START) != 0
+            || filestream_write(file, (uint8_t*)save->buffer + offset, len)
+               != (int64_t)len)
+         ret = false;
+      else
+         save->bytes_written += len;
+   }
+
+   if (filestream_flush(file) != 0)
+      ret = false;
+   filestream_close(file);
+   return ret;
+}
+
+/* Writes all of 'buffer' to a temporary file and moves it over the save,
+ * so an interrupted write leaves the old one */
+static bool autosave_write_file(autosave_t *save)
+{
+   char tmp_path[PATH_MAX_LENGTH];
+   intfstream_t *file = NULL;
+   bool ret           = false;
+
+   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", save->path);
+
+   /* Should probably deal with this more elegantly. */
+   if (save->flags & AUTOSAVE_FLAG_COMPRESS_FILES)
+      file = intfstream_open_rzip_file(tmp_path,
+            RETRO_VFS_FILE_ACCESS_WRITE);
+   else
+      file = intfstream_open_file(tmp_path,
+            RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return false;
+
+   ret = intfstream_write(file, save->buffer, save->bufsize)
+      == (int64_t)save->bufsize;
+   if (intfstream_flush(file) != 0)
+      ret = false;
+   /* Compressed data is only all out once closed */
+   if (intfstream_close(file) != 0)
+      ret = false;
+   free(file);
+
+   if (ret)
+   {
+      /* Renaming over an existing file fails on some platforms */
+      if (     filestream_rename(tmp_path, save->path) != 0
+            && (     filestream_delete(save->path) != 0
+                  || filestream_rename(tmp_path, save->path) != 0))
+         ret = false;
+      else
+         save->bytes_written += save->bufsize;
+   }
+   if (!ret)
+      filestream_delete(tmp_path);
+   return ret;
+}
+
 /**
  * autosave_thread:
  * @data            : pointer to autosave object
@@ -96,33 +225,34 @@ static void autosave_thread(void *data)
 
    for (;;)
    {
-      bool differ;
+      size_t dirty;
 
       slock_lock(save->lock);
-      differ = memcmp(save->buffer, save->retro_buffer,
-            save->bufsize) != 0;
-      if (differ)
-         memcpy(save->buffer, save->retro_buffer, save->bufsize);
+      dirty = autosave_update(save);
       slock_unlock(save->lock);
 
-      if (differ)
+      if (dirty)
       {
-         intfstream_t *file = NULL;
-
-         /* Should probably deal with this more elegantly. */
-         if (save->flags & AUTOSAVE_FLAG_COMPRESS_FILES)
-            file = intfstream_open_rzip_file(save->path,
-                  RETRO_VFS_FILE_ACCESS_WRITE);
+         bool written;
+
+         /* Compressed saves can only be written whole */
+         if (     !(save->flags & AUTOSAVE_FLAG_COMPRESS_FILES)
+               &&  (save->flags & AUTOSAVE_FLAG_IN_PLACE)
+               && autosave_write_blocks(save))
+            written = true;
+         else if ((written = autosave_write_file(save)))
+         {
+            if (!(save->flags & AUTOSAVE_FLAG_COMPRESS_FILES))
+               save->flags |= AUTOSAVE_FLAG_IN_PLACE;
+         }
          else
-            file = intfstream_open_file(save->path,
-                  RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+            save->flags &= ~AUTOSAVE_FLAG_IN_PLACE;
 
-         if (file)
+         /* Failed blocks stay dirty for the next interval */
+         if (written)
          {
-            intfstream_write(file, save->buffer, save->bufsize);
-            intfstream_flush(file);
-            intfstream_close(file);
-            free(file);
+            memset(save->dirty, 0, save->blocks);
+            save->writes++;
          }
       }
 
@@ -170,6 +300,11 @@ static autosave_t *autosave_new(const char *path,
 
    handle->flags                 = 0;
    handle->bufsize               = len;
+   handle->blocks                = (len + AUTOSAVE_BLOCK_SIZE - 1)
+      / AUTOSAVE_BLOCK_SIZE;
+   handle->bytes_written         = 0;
+   handle->writes                = 0;
+   handle->start_time            = time(NULL);
    handle->interval              = interval;
    if (compress)
       handle->flags             |= AUTOSAVE_FLAG_COMPRESS_FILES;
@@ -182,6 +317,13 @@ static autosave_t *autosave_new(const char *path,
       return NULL;
    }
 
+   if (!(handle->dirty = (uint8_t*)calloc(handle->blocks, 1)))
+   {
+      free(buf);
+      free(handle);
+      return NULL;
+   }
+
    handle->buffer                = buf;
 
    memcpy(handle->buffer, handle->retro_buffer, handle->bufsize);
@@ -212,9 +354,22 @@ static void autosave_free(autosave_t *handle)
    slock_free(handle->cond_lock);
    scond_free(handle->cond);
 
+   if (handle->writes)
+   {
+      time_t elapsed = time(NULL) - handle->start_time;
+      RARCH_LOG("[SRAM] Autosave wrote %u KB to \"%s\" in %u writes"
+            " (%u KB per hour).\n",
+            (unsigned)(handle->bytes_written >> 10), handle->path,
+            handle->writes,
+            (unsigned)((handle->bytes_written >> 10) * 3600
+               / (elapsed > 0 ? (uint64_t)elapsed : 1)));
+   }
+
    if (handle->buffer)
       free(handle->buffer);
    handle->buffer = NULL;
+   free(handle->dirty);
+   handle->dirty  = NULL;
 }
 
 bool autosave_init(bool compress_files, unsigned autosave_interval)
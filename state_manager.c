@@ -25,10 +25,22 @@
 #include <string.h>
 
 #include <retro_inline.h>
+#include <memalign.h>
+#include <retro_miscellaneous.h>
 #include <compat/strl.h>
 #include <lz4.h>
+#include <lz4hc.h>
+#include <file/file_path.h>
+#include <string/stdstring.h>
+#include <streams/file_stream.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "state_manager.h"
+#ifdef HAVE_STATESTREAM
+#include "state_store.h"
+#endif
 #include "msg_hash.h"
 #include "core.h"
 #include "core_info.h"
@@ -46,8 +58,73 @@
 #define STRICT_BUF_SIZE 0
 
 #define STATE_DELTA_FLAG_RAW ((size_t)1)
+/* A full copy of the older state follows the delta. With a block store
+ * that is its superblock sequence instead, and the store holds the rest. */
+#define STATE_DELTA_FLAG_CHECKPOINT ((size_t)2)
 #define STATE_DELTA_HEADER_SIZE (sizeof(size_t) * 2)
 
+/* Pushes between full checkpoints, which bounds the decodes a seek needs */
+#define STATE_MANAGER_CHECKPOINT_INTERVAL 60
+
+/* Entries dropped from the buffer are written to disk in segments of
+ * about this size, repacked with LZ4 HC. Deltas are mostly long runs of
+ * zeroes, which the higher levels crawl through for little gain. */
+#define STATE_MANAGER_SPILL_SEGMENT_SIZE (4 << 20)
+#define STATE_MANAGER_SPILL_LEVEL 4
+
+struct state_manager_spill_segment
+{
+   int64_t offset;
+   size_t size;
+   unsigned entries;
+};
+
+/* The disk buffer continues the history past the oldest entry in RAM.
+ * The file is a ring of segments of its own, newest last in 'segments';
+ * 'staging' holds the entries newer than those, oldest first, each
+ * followed by its size so they can be popped off the end. */
+struct state_manager_spill
+{
+   RFILE *file;
+   struct state_manager_spill_segment *segments;
+   uint8_t *staging;
+   uint8_t *scratch;
+   int64_t capacity;
+   int64_t write_pos;
+   size_t num_segments;
+   size_t cap_segments;
+   size_t staging_len;
+   size_t staging_cap;
+   unsigned staging_entries;
+   char path[PATH_MAX_LENGTH];
+};
+
+#ifdef HAVE_THREADS
+/* Raw states the worker can have queued or free for the next push */
+#define STATE_MANAGER_WORKER_SLOTS 3
+
+/* Pushes hand the raw state to the worker, which deltas and compresses
+ * it into the buffer. The core serializes straight into a free slot, so
+ * the emulation thread never copies a state; the lock only guards the
+ * queue indices. Anything else that touches the buffer waits for the
+ * queue to drain first. */
+struct state_manager_worker
+{
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   /* Every raw block, thisblock included, for freeing */
+   uint8_t *blocks[STATE_MANAGER_WORKER_SLOTS + 1];
+   uint8_t *free_blocks[STATE_MANAGER_WORKER_SLOTS];
+   uint8_t *pending[STATE_MANAGER_WORKER_SLOTS];
+   unsigned num_free;
+   unsigned pending_head;
+   unsigned num_pending;
+   bool busy;
+   bool quit;
+};
+#endif
+
 /* Returns the maximum compressed size of a savestate. */
 static size_t state_manager_raw_maxsize(size_t uncomp)
 {
@@ -97,15 +174,15 @@ static void state_manager_xor_delta(uint8_t *dst,
 }
 
 /*
- * Takes two savestates and creates a patch that turns 'dst' into 'src'.
- * Both 'src' and 'dst' must be returned from state_manager_raw_alloc(),
- * with the same 'len'.
+ * Packs 'len' bytes of 'src' into 'patch', LZ4-compressed unless that
+ * does not make it smaller. A non-zero 'level' uses LZ4 HC, which the
+ * same decoder reads.
  *
  * 'patch' must be size 'state_manager_raw_maxsize(len)' or more.
  * Returns the number of bytes actually written to 'patch'.
  */
-static size_t state_manager_raw_compress(const void *src,
-      const void *dst, size_t len, void *patch, uint8_t *scratch)
+static size_t state_manager_raw_pack(const uint8_t *src, size_t len,
+      void *patch, int level)
 {
    size_t *header          = (size_t*)patch;
    uint8_t *payload        = (uint8_t*)patch + STATE_DELTA_HEADER_SIZE;
@@ -113,13 +190,13 @@ static size_t state_manager_raw_compress(const void *src,
    size_t flags            = 0;
    bool   use_compressed   = false;
 
-   state_manager_xor_delta(scratch,
-         (const uint8_t*)src, (const uint8_t*)dst, len);
-
    if (len <= (size_t)LZ4_MAX_INPUT_SIZE)
    {
       int max_out     = LZ4_compressBound((int)len);
-      int compressed  = LZ4_compress_fast((const char*)scratch,
+      int compressed  = level
+         ? LZ4_compress_HC((const char*)src,
+            (char*)payload, (int)len, max_out, level)
+         : LZ4_compress_fast((const char*)src,
             (char*)payload, (int)len, max_out, 1);
 
       if (compressed > 0 && (size_t)compressed < len)
@@ -131,7 +208,7 @@ static size_t state_manager_raw_compress(const void *src,
 
    if (!use_compressed)
    {
-      memcpy(payload, scratch, len);
+      memcpy(payload, src, len);
       payload_size = len;
       flags |= STATE_DELTA_FLAG_RAW;
    }
@@ -143,24 +220,39 @@ static size_t state_manager_raw_compress(const void *src,
 }
 
 /*
- * Takes 'patch' from a previous call to 'state_manager_raw_compress'
- * and applies it to 'data' ('dst' from that call),
- * yielding 'src' in that call.
+ * Takes two savestates and creates a patch that turns 'dst' into 'src'.
+ * Both 'src' and 'dst' must be returned from state_manager_raw_alloc(),
+ * with the same 'len'.
+ *
+ * 'patch' must be size 'state_manager_raw_maxsize(len)' or more.
+ * Returns the number of bytes actually written to 'patch'.
  */
-static bool state_manager_raw_decompress(const void *patch, void *data,
-      size_t len, uint8_t *scratch)
+static size_t state_manager_raw_compress(const void *src,
+      const void *dst, size_t len, void *patch, uint8_t *scratch)
+{
+   state_manager_xor_delta(scratch,
+         (const uint8_t*)src, (const uint8_t*)dst, len);
+
+   return state_manager_raw_pack(scratch, len, patch, 0);
+}
+
+/*
+ * Unpacks 'patch' from a previous call to 'state_manager_raw_pack'
+ * into 'out'.
+ */
+static bool state_manager_raw_unpack(const void *patch, uint8_t *out,
+      size_t len)
 {
    const size_t *header    = (const size_t*)patch;
    const uint8_t *payload  = (const uint8_t*)patch + STATE_DELTA_HEADER_SIZE;
    size_t payload_size     = header[0];
    size_t flags            = header[1];
-   size_t i;
 
    if (flags & STATE_DELTA_FLAG_RAW)
    {
       if (payload_size != len)
          return false;
-      memcpy(scratch, payload, len);
+      memcpy(out, payload, len);
    }
    else
    {
@@ -172,11 +264,29 @@ static bool state_manager_raw_decompress(const void *patch, void *data,
          return false;
 
       decoded = LZ4_decompress_safe((const char*)payload,
-            (char*)scratch, (int)payload_size, (int)len);
+            (char*)out, (int)payload_size, (int)len);
       if (decoded != (int)len)
          return false;
    }
 
+   return true;
+}
+
+/*
+ * Takes 'patch' from a previous call to 'state_manager_raw_compress'
+ * and applies it to 'data' ('dst' from that call),
+ * yielding 'src' in that call.
+ *
+ * The patch is its own inverse, so applied to 'src' it yields 'dst'.
+ */
+static bool state_manager_raw_decompress(const void *patch, void *data,
+      size_t len, uint8_t *scratch)
+{
+   size_t i;
+
+   if (!state_manager_raw_unpack(patch, scratch, len))
+      return false;
+
    for (i = 0; i < len; i++)
       ((uint8_t*)data)[i] ^= scratch[i];
 
@@ -218,13 +328,295 @@ static INLINE size_t read_size_t(const void *ptr)
    return ret;
 }
 
+#ifdef HAVE_THREADS
+static void state_manager_worker_free(state_manager_t *state)
+{
+   unsigned i;
+   struct state_manager_worker *worker = state->worker;
+
+   if (!worker)
+      return;
+
+   if (worker->thread)
+   {
+      slock_lock(worker->lock);
+      worker->quit = true;
+      scond_broadcast(worker->cond);
+      slock_unlock(worker->lock);
+      sthread_join(worker->thread);
+   }
+   if (worker->cond)
+      scond_free(worker->cond);
+   if (worker->lock)
+      slock_free(worker->lock);
+
+   /* thisblock and nextblock are among these */
+   for (i = 0; i < ARRAY_SIZE(worker->blocks); i++)
+      free(worker->blocks[i]);
+   state->thisblock = NULL;
+   state->nextblock = NULL;
+
+   free(worker);
+   state->worker    = NULL;
+}
+#endif
+
+#ifdef HAVE_STATESTREAM
+/* Where the superblock sequence of a checkpoint sits after 'delta' */
+static uint32_t *state_manager_checkpoint_seq(const uint8_t *delta)
+{
+   const uint8_t *end = delta + STATE_DELTA_HEADER_SIZE
+      + ((const size_t*)delta)[0];
+   return (uint32_t*)(((uintptr_t)end + sizeof(uint32_t) - 1)
+         & ~(uintptr_t)(sizeof(uint32_t) - 1));
+}
+#endif
+
+/* Lets go of what the entry at 'start' keeps outside the buffer, once it
+ * is dropped or popped */
+static void state_manager_discard(state_manager_t *state,
+      const uint8_t *start)
+{
+#ifdef HAVE_STATESTREAM
+   const uint8_t *delta = start + sizeof(size_t);
+
+   if (state->store
+         && (((const size_t*)delta)[1] & STATE_DELTA_FLAG_CHECKPOINT))
+      state_store_release(state->store,
+            state_manager_checkpoint_seq(delta),
+            state_store_seq_len(state->store, state->blocksize));
+#endif
+}
+
+static void state_manager_spill_clear(struct state_manager_spill *spill)
+{
+   spill->num_segments    = 0;
+   spill->staging_len     = 0;
+   spill->staging_entries = 0;
+   spill->write_pos       = 0;
+}
+
+static void state_manager_spill_free(struct state_manager_spill *spill)
+{
+   if (!spill)
+      return;
+
+   if (spill->file)
+   {
+      filestream_close(spill->file);
+      filestream_delete(spill->path);
+   }
+   free(spill->segments);
+   free(spill->staging);
+   free(spill->scratch);
+   free(spill);
+}
+
+static struct state_manager_spill *state_manager_spill_new(
+      const char *dir, uint64_t disk_size,
+      size_t block_size, size_t max_comp_size)
+{
+   struct state_manager_spill *spill = (struct state_manager_spill*)
+      calloc(1, sizeof(*spill));
+
+   if (!spill)
+      return NULL;
+
+   fill_pathname_join_special(spill->path, dir, "rewind.spill",
+         sizeof(spill->path));
+   spill->capacity    = (int64_t)disk_size;
+   spill->staging_cap = STATE_MANAGER_SPILL_SEGMENT_SIZE
+      + max_comp_size + sizeof(size_t) * 2;
+
+   if (     !(spill->staging = (uint8_t*)malloc(spill->staging_cap))
+         || !(spill->scratch = (uint8_t*)malloc(block_size))
+         || !(spill->file    = filestream_open(spill->path,
+               RETRO_VFS_FILE_ACCESS_READ_WRITE,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      RARCH_WARN("[Rewind] Could not create disk buffer \"%s\".\n",
+            spill->path);
+      state_manager_spill_free(spill);
+      return NULL;
+   }
+
+   return spill;
+}
+
+/* Writes the staged entries out as the newest segment, over the oldest
+ * ones once the file wraps. */
+static void state_manager_spill_flush(struct state_manager_spill *spill)
+{
+   size_t drop;
+   int64_t len = (int64_t)spill->staging_len;
+   int64_t pos = spill->write_pos;
+
+   if (!len)
+      return;
+
+   if (len > spill->capacity)
+   {
+      state_manager_spill_clear(spill);
+      return;
+   }
+   if (pos + len > spill->capacity)
+      pos = 0;
+
+   /* Anything this overlaps is lost, and so is all that is older */
+   for (drop = spill->num_segments; drop > 0; drop--)
+   {
+      const struct state_manager_spill_segment *seg =
+         &spill->segments[drop - 1];
+      if (seg->offset < pos + len && pos < seg->offset + (int64_t)seg->size)
+         break;
+   }
+   memmove(spill->segments, spill->segments + drop,
+         (spill->num_segments - drop) * sizeof(*spill->segments));
+   spill->num_segments -= drop;
+
+   if (spill->num_segments == spill->cap_segments)
+   {
+      size_t cap = spill->cap_segments ? spill->cap_segments * 2 : 64;
+      struct state_manager_spill_segment *segments =
+         (struct state_manager_spill_segment*)realloc(spill->segments,
+               cap * sizeof(*segments));
+      if (!segments)
+      {
+         state_manager_spill_clear(spill);
+         return;
+      }
+      spill->segments     = segments;
+      spill->cap_segments = cap;
+   }
+
+   if (     filestream_seek(spill->file, pos,
+               RETRO_VFS_SEEK_POSITION_START) != 0
+         || filestream_write(spill->file, spill->staging, len) != len)
+   {
+      /* The history has to stay contiguous, so drop all of it */
+      RARCH_WARN("[Rewind] Could not write to disk buffer.\n");
+      state_manager_spill_clear(spill);
+      return;
+   }
+
+   spill->segments[spill->num_segments].offset  = pos;
+   spill->segments[spill->num_segments].size    = spill->staging_len;
+   spill->segments[spill->num_segments].entries = spill->staging_entries;
+   spill->num_segments++;
+   spill->write_pos       = pos + len;
+   spill->staging_len     = 0;
+   spill->staging_entries = 0;
+}
+
+/* Stages the entry about to be dropped from the tail of the buffer,
+ * repacked at a higher ratio. Its checkpoint, if any, is left behind:
+ * seeks only use the ones in RAM. */
+static void state_manager_spill_add(state_manager_t *state,
+      const uint8_t *entry)
+{
+   size_t len;
+   uint8_t *out;
+   struct state_manager_spill *spill = state->spill;
+
+   if (spill->staging_len + state->maxcompsize + sizeof(size_t)
+         > spill->staging_cap)
+      state_manager_spill_flush(spill);
+
+   out = spill->staging + spill->staging_len;
+   if (!state_manager_raw_unpack(entry, spill->scratch, state->blocksize))
+   {
+      state_manager_spill_clear(spill);
+      return;
+   }
+   len = state_manager_raw_pack(spill->scratch, state->blocksize, out,
+         STATE_MANAGER_SPILL_LEVEL);
+   len = (len + sizeof(size_t) - 1) & -sizeof(size_t);
+   write_size_t(out + len, len);
+
+   spill->staging_len += len + sizeof(size_t);
+   spill->staging_entries++;
+
+   if (spill->staging_len >= STATE_MANAGER_SPILL_SEGMENT_SIZE)
+      state_manager_spill_flush(spill);
+}
+
+/* Pops the newest entry on disk into thisblock, once the buffer in RAM
+ * has run out. */
+static bool state_manager_spill_pop(state_manager_t *state)
+{
+   size_t len;
+   struct state_manager_spill *spill = state->spill;
+
+   if (!spill->staging_len)
+   {
+      struct state_manager_spill_segment seg;
+
+      if (!spill->num_segments)
+         return false;
+
+      seg = spill->segments[--spill->num_segments];
+      if (     filestream_seek(spill->file, seg.offset,
+                  RETRO_VFS_SEEK_POSITION_START) != 0
+            || filestream_read(spill->file, spill->staging,
+                  (int64_t)seg.size) != (int64_t)seg.size)
+      {
+         RARCH_ERR("[Rewind] Could not read from disk buffer.\n");
+         state_manager_spill_clear(spill);
+         return false;
+      }
+      spill->staging_len     = seg.size;
+      spill->staging_entries = seg.entries;
+      /* Its space goes to whatever is spilled next */
+      spill->write_pos       = seg.offset;
+   }
+
+   len                 = read_size_t(spill->staging
+         + spill->staging_len - sizeof(size_t));
+   spill->staging_len -= len + sizeof(size_t);
+   spill->staging_entries--;
+
+   if (!state_manager_raw_decompress(spill->staging + spill->staging_len,
+            state->thisblock, state->blocksize, state->delta))
+   {
+      RARCH_ERR("[Rewind] Failed to decode state delta.\n");
+      state_manager_spill_clear(spill);
+      return false;
+   }
+
+   return true;
+}
+
+/* Drops the oldest entry in RAM, to disk if there is a disk buffer */
+static void state_manager_drop_tail(state_manager_t *state)
+{
+   state_manager_discard(state, state->tail);
+   if (state->spill)
+      state_manager_spill_add(state, state->tail + sizeof(size_t));
+   state->tail = state->data + read_size_t(state->tail);
+   state->entries--;
+}
+
 static void state_manager_free(state_manager_t *state)
 {
    if (!state)
       return;
 
+#ifdef HAVE_THREADS
+   state_manager_worker_free(state);
+#endif
+   /* Only the worker spills, so this waits for it to stop */
+   state_manager_spill_free(state->spill);
+   state->spill = NULL;
+#ifdef HAVE_STATESTREAM
+   if (state->store)
+   {
+      state_store_deinit(state->store);
+      free(state->store);
+   }
+   state->store = NULL;
+#endif
    if (state->data)
-      free(state->data);
+      memalign_free_large(state->data);
    if (state->thisblock)
       free(state->thisblock);
    if (state->nextblock)
@@ -242,6 +634,161 @@ static void state_manager_free(state_manager_t *state)
    state->delta      = NULL;
 }
 
+/* Deltas 'block' against the last pushed state into the buffer and
+ * makes it the last pushed state. Returns the block it takes over from,
+ * which the next push can reuse. */
+static uint8_t *state_manager_push_block(state_manager_t *state,
+      uint8_t *block)
+{
+   uint8_t *swap = NULL;
+
+   if (state->thisblock_valid)
+   {
+      uint8_t *compressed;
+      const uint8_t *oldb, *newb;
+      size_t headpos, tailpos, remaining;
+      if (state->capacity < sizeof(size_t) + state->maxcompsize)
+      {
+         RARCH_ERR("[Rewind] %s.\n",
+               msg_hash_to_str(MSG_REWIND_BUFFER_CAPACITY_INSUFFICIENT));
+         return block;
+      }
+
+recheckcapacity:;
+      headpos   = state->head - state->data;
+      tailpos   = state->tail - state->data;
+      remaining = (tailpos + state->capacity -
+            sizeof(size_t) - headpos - 1) % state->capacity + 1;
+
+      if (remaining <= state->maxcompsize)
+      {
+         state_manager_drop_tail(state);
+         goto recheckcapacity;
+      }
+
+      oldb              = state->thisblock;
+      newb              = block;
+      compressed        = state->head + sizeof(size_t);
+
+      compressed       += state_manager_raw_compress(oldb, newb,
+            state->blocksize, compressed, state->delta);
+
+      /* Seeks decode forward from here, so keep the older state whole */
+      if (++state->since_checkpoint >= STATE_MANAGER_CHECKPOINT_INTERVAL)
+      {
+         uint8_t *delta = state->head + sizeof(size_t);
+         ((size_t*)delta)[1] |= STATE_DELTA_FLAG_CHECKPOINT;
+#ifdef HAVE_STATESTREAM
+         if (state->store)
+         {
+            uint32_t *seq = state_manager_checkpoint_seq(delta);
+            state_store_insert(state->store, oldb, state->blocksize,
+                  NULL, NULL, seq, 0, NULL);
+            compressed  = (uint8_t*)(seq + state_store_seq_len(
+                     state->store, state->blocksize));
+         }
+         else
+#endif
+         compressed    += state_manager_raw_pack(oldb,
+               state->blocksize, compressed, 0);
+         state->since_checkpoint = 0;
+      }
+
+      if (compressed - state->data + state->maxcompsize > state->capacity)
+      {
+         compressed     = state->data;
+         if (state->tail == state->data + sizeof(size_t))
+            state_manager_drop_tail(state);
+      }
+      write_size_t(compressed, state->head-state->data);
+      compressed       += sizeof(size_t);
+      write_size_t(state->head, compressed-state->data);
+      state->head       = compressed;
+   }
+   else
+      state->thisblock_valid = true;
+
+   swap                      = state->thisblock;
+   state->thisblock          = block;
+
+   state->entries++;
+   return swap;
+}
+
+#ifdef HAVE_THREADS
+static void state_manager_worker_loop(void *data)
+{
+   state_manager_t *state              = (state_manager_t*)data;
+   struct state_manager_worker *worker = state->worker;
+
+   slock_lock(worker->lock);
+   for (;;)
+   {
+      uint8_t *block;
+
+      while (!worker->quit && !worker->num_pending)
+         scond_wait(worker->cond, worker->lock);
+      if (worker->quit)
+         break;
+
+      block                = worker->pending[worker->pending_head];
+      worker->pending_head = (worker->pending_head + 1)
+         % STATE_MANAGER_WORKER_SLOTS;
+      worker->num_pending--;
+      worker->busy         = true;
+      slock_unlock(worker->lock);
+
+      block                = state_manager_push_block(state, block);
+
+      slock_lock(worker->lock);
+      worker->free_blocks[worker->num_free++] = block;
+      worker->busy         = false;
+      scond_broadcast(worker->cond);
+   }
+   slock_unlock(worker->lock);
+}
+
+/* Falls back to pushing on the emulation thread if this fails */
+static void state_manager_worker_init(state_manager_t *state,
+      size_t state_size)
+{
+   unsigned i;
+   uint8_t *this_block                 = state->thisblock;
+   uint8_t *next_block                 = state->nextblock;
+   struct state_manager_worker *worker = (struct state_manager_worker*)
+      calloc(1, sizeof(*worker));
+
+   if (!worker)
+      return;
+
+   state->worker     = worker;
+   worker->blocks[0] = state->thisblock;
+   worker->blocks[1] = state->nextblock;
+   for (i = 2; i < ARRAY_SIZE(worker->blocks); i++)
+      if (!(worker->blocks[i] = (uint8_t*)state_manager_raw_alloc(
+               state_size, (uint16_t)i)))
+         goto error;
+   for (i = 1; i < ARRAY_SIZE(worker->blocks); i++)
+      worker->free_blocks[worker->num_free++] = worker->blocks[i];
+
+   if (     !(worker->lock   = slock_new())
+         || !(worker->cond   = scond_new())
+         || !(worker->thread = sthread_create(
+               state_manager_worker_loop, state)))
+      goto error;
+   return;
+
+error:
+   RARCH_WARN("[Rewind] Could not start the compression thread.\n");
+   /* Keep thisblock and nextblock for pushing on this thread */
+   worker->blocks[0] = NULL;
+   worker->blocks[1] = NULL;
+   state_manager_worker_free(state);
+   state->thisblock  = this_block;
+   state->nextblock  = next_block;
+}
+#endif
+
 static state_manager_t *state_manager_new(
       size_t state_size, size_t buffer_size)
 {
@@ -256,13 +803,20 @@ static state_manager_t *state_manager_new(
       return NULL;
 
    block_size         = (state_size + sizeof(uint16_t) - 1) & -sizeof(uint16_t);
-   /* the compressed data is surrounded by pointers to the other side */
-   max_comp_size      = state_manager_raw_maxsize(block_size) + sizeof(size_t) * 2;
-   state_data         = (uint8_t*)malloc(buffer_size);
+   /* the compressed data is surrounded by pointers to the other side,
+    * and a checkpoint carries a full state after the delta */
+   max_comp_size      = state_manager_raw_maxsize(block_size) * 2 + sizeof(size_t) * 2;
+   /* The ring is walked through every frame; large pages keep it
+    * to a few TLB entries */
+   state_data         = (uint8_t*)memalign_alloc_large(buffer_size);
 
    if (!state_data)
       goto error;
 
+   RARCH_LOG("[Rewind] Buffer of %u MB in %s.\n",
+         (unsigned)(buffer_size / (1024 * 1024)),
+         memalign_backing_name(memalign_large_backing(state_data)));
+
    this_block         = (uint8_t*)state_manager_raw_alloc(state_size, 0);
    next_block         = (uint8_t*)state_manager_raw_alloc(state_size, 1);
    delta_block        = (uint8_t*)malloc(block_size);
@@ -286,17 +840,49 @@ static state_manager_t *state_manager_new(
    state->debugblock  = (uint8_t*)malloc(state_size);
 #endif
 
+#ifdef HAVE_STATESTREAM
+   /* Checkpoints share their unchanged blocks; without the store they
+    * are LZ4 copies */
+   if ((state->store = (state_store_t*)malloc(sizeof(*state->store)))
+         && !state_store_init_for_size(state->store, block_size, 0, 0))
+   {
+      free(state->store);
+      state->store = NULL;
+   }
+#endif
+
+#ifdef HAVE_THREADS
+   state_manager_worker_init(state, state_size);
+#endif
+
    return state;
 
 error:
    if (state_data)
-      free(state_data);
+      memalign_free_large(state_data);
    state_manager_free(state);
    free(state);
 
    return NULL;
 }
 
+#ifdef HAVE_THREADS
+/* Waits for the worker to finish every queued push. It stays idle until
+ * the next one, so the buffer is the caller's until then. */
+static void state_manager_worker_drain(state_manager_t *state)
+{
+   struct state_manager_worker *worker = state->worker;
+
+   if (!worker)
+      return;
+
+   slock_lock(worker->lock);
+   while (worker->num_pending || worker->busy)
+      scond_wait(worker->cond, worker->lock);
+   slock_unlock(worker->lock);
+}
+#endif
+
 static bool state_manager_pop(state_manager_t *state, const void **data)
 {
    size_t start;
@@ -305,6 +891,10 @@ static bool state_manager_pop(state_manager_t *state, const void **data)
 
    *data                        = NULL;
 
+#ifdef HAVE_THREADS
+   state_manager_worker_drain(state);
+#endif
+
    if (state->thisblock_valid)
    {
       state->thisblock_valid    = false;
@@ -315,7 +905,7 @@ static bool state_manager_pop(state_manager_t *state, const void **data)
 
    *data                        = state->thisblock;
    if (state->head == state->tail)
-      return false;
+      return state->spill && state_manager_spill_pop(state);
 
    start                        = read_size_t(state->head - sizeof(size_t));
    state->head                  = state->data + start;
@@ -329,17 +919,151 @@ static bool state_manager_pop(state_manager_t *state, const void **data)
       return false;
    }
 
+   state_manager_discard(state, state->head);
    state->entries--;
    return true;
 }
 
+/*
+ * Same as 'count' pops, but when a checkpoint lies close enough behind
+ * the target, decodes forward from it instead of back from the newest
+ * state. The back links cost a read each, so finding it is cheap. Past
+ * the oldest entry in RAM it pops on into the disk buffer.
+ * Returns false when there was nothing to pop.
+ */
+static bool state_manager_seek(state_manager_t *state, unsigned count,
+      const void **data)
+{
+   unsigned steps, back;
+   uint8_t *head, *pos;
+   uint8_t *checkpoint = NULL;
+   bool popped         = false;
+
+#ifdef HAVE_THREADS
+   state_manager_worker_drain(state);
+#endif
+
+   *data               = state->thisblock;
+   if (!count)
+      return false;
+
+   if (state->thisblock_valid)
+   {
+      state->thisblock_valid = false;
+      state->entries--;
+      popped                 = true;
+      if (!--count)
+         return true;
+   }
+
+   /* Where the head ends up after 'count' pops */
+   head = state->head;
+   for (steps = 0; steps < count && head != state->tail; steps++)
+      head = state->data + read_size_t(head - sizeof(size_t));
+
+   /* Decoding forward from a checkpoint takes one more decode than
+    * entries between it and the target */
+   pos = head;
+   for (back = 1; back + 1 < steps && pos != state->tail; back++)
+   {
+      uint8_t *start        = state->data + read_size_t(pos - sizeof(size_t));
+      const size_t *header  = (const size_t*)(start + sizeof(size_t));
+
+      if (header[1] & STATE_DELTA_FLAG_CHECKPOINT)
+      {
+         checkpoint         = start;
+         break;
+      }
+      pos                   = start;
+   }
+
+   if (!checkpoint)
+   {
+      while (count--)
+      {
+         if (!state_manager_pop(state, data))
+            return popped;
+         popped = true;
+      }
+      return popped;
+   }
+
+   {
+      const uint8_t *delta  = checkpoint + sizeof(size_t);
+      const uint8_t *full   = delta + STATE_DELTA_HEADER_SIZE
+         + ((const size_t*)delta)[0];
+      bool restored;
+
+#ifdef HAVE_STATESTREAM
+      if (state->store)
+         restored = state_store_restore(state->store,
+               state_manager_checkpoint_seq(delta),
+               state_store_seq_len(state->store, state->blocksize),
+               state->thisblock, state->blocksize);
+      else
+#endif
+      restored = state_manager_raw_unpack(full, state->thisblock,
+            state->blocksize);
+
+      if (!restored)
+      {
+         RARCH_ERR("[Rewind] Failed to decode state checkpoint.\n");
+         return popped;
+      }
+
+      for (pos = checkpoint; back--; )
+      {
+         if (!state_manager_raw_decompress(pos + sizeof(size_t),
+                  state->thisblock, state->blocksize, state->delta))
+         {
+            RARCH_ERR("[Rewind] Failed to decode state delta.\n");
+            return popped;
+         }
+         pos = state->data + read_size_t(pos);
+      }
+   }
+
+   for (pos = state->head; pos != head; )
+   {
+      pos = state->data + read_size_t(pos - sizeof(size_t));
+      state_manager_discard(state, pos);
+   }
+
+   state->head     = head;
+   state->entries -= steps;
+   *data           = state->thisblock;
+
+   /* The rest comes from the disk buffer */
+   for (count -= steps; count; count--)
+      if (!state_manager_pop(state, data))
+         break;
+   *data           = state->thisblock;
+   return true;
+}
+
 static void state_manager_push_where(state_manager_t *state, void **data)
 {
+   bool idle = true;
+
+#ifdef HAVE_THREADS
+   if (state->worker)
+   {
+      struct state_manager_worker *worker = state->worker;
+      slock_lock(worker->lock);
+      while (!worker->num_free)
+         scond_wait(worker->cond, worker->lock);
+      state->nextblock = worker->free_blocks[--worker->num_free];
+      idle             = !worker->num_pending && !worker->busy;
+      slock_unlock(worker->lock);
+   }
+#endif
+
    /* We need to ensure we have an uncompressed copy of the last
     * pushed state, or we could end up applying a 'patch' to wrong
-    * savestate, and that'd blow up rather quickly. */
-
-   if (!state->thisblock_valid)
+    * savestate, and that'd blow up rather quickly.
+    *
+    * A push still queued for the worker leaves one behind anyway. */
+   if (idle && !state->thisblock_valid)
    {
       const void *ignored;
       if (state_manager_pop(state, &ignored))
@@ -357,68 +1081,32 @@ static void state_manager_push_where(state_manager_t *state, void **data)
 
 static void state_manager_push_do(state_manager_t *state)
 {
-   uint8_t *swap = NULL;
-
 #if STRICT_BUF_SIZE
    memcpy(state->nextblock, state->debugblock, state->debugsize);
 #endif
 
-   if (state->thisblock_valid)
+#ifdef HAVE_THREADS
+   if (state->worker)
    {
-      uint8_t *compressed;
-      const uint8_t *oldb, *newb;
-      size_t headpos, tailpos, remaining;
-      if (state->capacity < sizeof(size_t) + state->maxcompsize)
-      {
-         RARCH_ERR("[Rewind] %s.\n",
-               msg_hash_to_str(MSG_REWIND_BUFFER_CAPACITY_INSUFFICIENT));
-         return;
-      }
-
-recheckcapacity:;
-      headpos   = state->head - state->data;
-      tailpos   = state->tail - state->data;
-      remaining = (tailpos + state->capacity -
-            sizeof(size_t) - headpos - 1) % state->capacity + 1;
-
-      if (remaining <= state->maxcompsize)
-      {
-         state->tail = state->data + read_size_t(state->tail);
-         state->entries--;
-         goto recheckcapacity;
-      }
-
-      oldb              = state->thisblock;
-      newb              = state->nextblock;
-      compressed        = state->head + sizeof(size_t);
-
-      compressed       += state_manager_raw_compress(oldb, newb,
-            state->blocksize, compressed, state->delta);
-
-      if (compressed - state->data + state->maxcompsize > state->capacity)
-      {
-         compressed     = state->data;
-         if (state->tail == state->data + sizeof(size_t))
-            state->tail = state->data + read_size_t(state->tail);
-      }
-      write_size_t(compressed, state->head-state->data);
-      compressed       += sizeof(size_t);
-      write_size_t(state->head, compressed-state->data);
-      state->head       = compressed;
+      struct state_manager_worker *worker = state->worker;
+      slock_lock(worker->lock);
+      worker->pending[(worker->pending_head + worker->num_pending)
+         % STATE_MANAGER_WORKER_SLOTS] = state->nextblock;
+      worker->num_pending++;
+      scond_broadcast(worker->cond);
+      slock_unlock(worker->lock);
+      state->nextblock = NULL;
+      return;
    }
-   else
-      state->thisblock_valid = true;
-
-   swap                      = state->thisblock;
-   state->thisblock          = state->nextblock;
-   state->nextblock          = swap;
+#endif
 
-   state->entries++;
+   state->nextblock = state_manager_push_block(state, state->nextblock);
 }
 
 void state_manager_event_init(
       struct state_manager_rewind_state *rewind_st,
-      unsigned rewind_buffer_size)
+      unsigned rewind_buffer_size,
+      uint64_t rewind_disk_size, const char *rewind_disk_dir)
 {
    core_info_t *core_info = NULL;
    void *state            = NULL;
@@ -478,6 +1166,17 @@ void state_manager_event_init(
    if (!rewind_st->state)
       RARCH_WARN("[Rewind] %s.\n",
             msg_hash_to_str(MSG_REWIND_INIT_FAILED));
+   else if (rewind_disk_size && !string_is_empty(rewind_disk_dir))
+   {
+      state_manager_t *manager = rewind_st->state;
+
+      /* Set before the first push, which is the first the worker sees */
+      if ((manager->spill = state_manager_spill_new(rewind_disk_dir,
+            rewind_disk_size, manager->blocksize, manager->maxcompsize)))
+         RARCH_LOG("[Rewind] Disk buffer: %u MB in \"%s\"\n",
+               (unsigned)(rewind_disk_size / 1000000),
+               manager->spill->path);
+   }
 
    state_manager_push_where(rewind_st->state, &state);
 
@@ -527,6 +1226,39 @@ void state_manager_event_deinit(
    }
 }
 
+/**
+ * state_manager_rewind_seek:
+ * @count                : rewind entries to go back, one per granularity
+ *
+ * Jumps the running content back @count entries at once, decoding from
+ * the nearest checkpoint rather than through every entry in between.
+ * Clamps to the oldest entry left.
+ *
+ * Returns: true if the content was rewound.
+ **/
+bool state_manager_rewind_seek(
+      struct state_manager_rewind_state *rewind_st,
+      unsigned count)
+{
+   const void *buf = NULL;
+
+   if (!rewind_st || !rewind_st->state || !count)
+      return false;
+
+   /* Both expect to see every rewound frame */
+#ifdef HAVE_NETWORKING
+   if (netplay_driver_ctl(RARCH_NETPLAY_CTL_IS_ENABLED, NULL))
+      return false;
+#endif
+   if (retroarch_ctl(RARCH_CTL_BSV_MOVIE_IS_INITED, NULL))
+      return false;
+
+   if (!state_manager_seek(rewind_st->state, count, &buf))
+      return false;
+
+   return content_deserialize_state(buf, rewind_st->size);
+}
+
 /**
  * check_rewind:
  * @pressed              : was rewind key pressed or held?
@@ -61,7 +61,19 @@ struct state_manager
    size_t maxcompsize;
 
    unsigned entries;
+   /* Pushes since the last full checkpoint */
+   unsigned since_checkpoint;
    bool thisblock_valid;
+   /* Takes the entries dropped from the tail, if enabled */
+   struct state_manager_spill *spill;
+#ifdef HAVE_STATESTREAM
+   /* Holds the blocks of the checkpoints */
+   struct state_store *store;
+#endif
+#ifdef HAVE_THREADS
+   /* Deltas pushed states into the buffer in the background */
+   struct state_manager_worker *worker;
+#endif
 };
 
 typedef struct state_manager state_manager_t;
@@ -80,8 +92,27 @@ void state_manager_event_deinit(
       struct state_manager_rewind_state *rewind_st,
       struct retro_core_t *current_core);
 
+/**
+ * state_manager_event_init:
+ * @rewind_buffer_size   : bytes of history kept in RAM
+ * @rewind_disk_size     : bytes of older history kept in a file in
+ *                         @rewind_disk_dir, or 0 for none
+ **/
 void state_manager_event_init(struct state_manager_rewind_state *rewind_st,
-      unsigned rewind_buffer_size);
+      unsigned rewind_buffer_size,
+      uint64_t rewind_disk_size, const char *rewind_disk_dir);
+
+/**
+ * state_manager_rewind_seek:
+ * @count                : rewind entries to go back, one per granularity
+ *
+ * Jumps the running content back @count entries at once.
+ *
+ * Returns: true if the content was rewound.
+ **/
+bool state_manager_rewind_seek(
+      struct state_manager_rewind_state *rewind_st,
+      unsigned count);
 
 /**
  * check_rewind:
@@ -0,0 +1,358 @@
+/**
+ *  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ *  more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with RetroArch. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifdef HAVE_STATESTREAM
+#include <stdlib.h>
+#include <string.h>
+
+#include <retro_miscellaneous.h>
+#include <features/features_cpu.h>
+
+#include "state_store.h"
+
+#ifdef HAVE_THREADS
+/* A run of whole blocks one worker compares and hashes */
+struct state_store_job
+{
+   state_store_t *store;
+   const uint8_t *state;
+   const uint8_t *prev;
+   size_t first;
+   size_t last;
+};
+#endif
+
+bool state_store_init(state_store_t *store, size_t block_size,
+      size_t superblock_size, uint8_t commit_interval,
+      uint8_t commit_threshold)
+{
+   memset(store, 0, sizeof(*store));
+
+   if (     !(store->blocks         = uint32s_index_new(block_size / 4,
+               commit_interval, commit_threshold))
+         || !(store->superblocks    = uint32s_index_new(superblock_size,
+               commit_interval, commit_threshold))
+         || !(store->superblock_buf = (uint32_t*)calloc(superblock_size,
+               sizeof(uint32_t)))
+         || !(store->padded_block   = (uint8_t*)calloc(block_size, 1)))
+   {
+      state_store_deinit(store);
+      return false;
+   }
+
+   return true;
+}
+
+bool state_store_init_for_size(state_store_t *store, size_t state_size,
+      uint8_t commit_interval, uint8_t commit_threshold)
+{
+   return state_store_init(store,
+         state_size < STATE_STORE_SMALL_STATE_THRESHOLD
+         ? STATE_STORE_SMALL_BLOCK_SIZE : STATE_STORE_BLOCK_SIZE,
+         STATE_STORE_SUPERBLOCK_SIZE, commit_interval, commit_threshold);
+}
+
+void state_store_deinit(state_store_t *store)
+{
+   uint32s_index_free(store->blocks);
+   uint32s_index_free(store->superblocks);
+   free(store->superblock_buf);
+   free(store->padded_block);
+   free(store->block_hashes);
+   free(store->block_same);
+#ifdef HAVE_THREADS
+   if (store->pool)
+      tpool_destroy(store->pool);
+#endif
+   memset(store, 0, sizeof(*store));
+}
+
+void state_store_set_threads(state_store_t *store, unsigned threads)
+{
+#ifdef HAVE_THREADS
+   if (threads > STATE_STORE_MAX_THREADS)
+      threads = STATE_STORE_MAX_THREADS;
+   if (threads < 2)
+      threads = 0;
+   if (threads == store->threads)
+      return;
+   if (store->pool)
+      tpool_destroy(store->pool);
+   store->pool    = threads ? tpool_create(threads) : NULL;
+   store->threads = store->pool ? threads : 0;
+#endif
+}
+
+size_t state_store_block_size(const state_store_t *store)
+{
+   return store->blocks->object_size * sizeof(uint32_t);
+}
+
+size_t state_store_seq_len(const state_store_t *store, size_t state_size)
+{
+   size_t superblock_byte_size = store->superblocks->object_size
+      * state_store_block_size(store);
+   return state_size / superblock_byte_size
+      + (state_size % superblock_byte_size != 0);
+}
+
+#ifdef HAVE_THREADS
+static void state_store_job_run(void *arg)
+{
+   struct state_store_job *job = (struct state_store_job*)arg;
+   state_store_t *store        = job->store;
+   size_t block_byte_size      = state_store_block_size(store);
+   size_t block;
+
+   for (block = job->first; block < job->last; block++)
+   {
+      size_t block_start = block * block_byte_size;
+      if (     job->prev
+            && memcmp(job->prev + block_start, job->state + block_start,
+               block_byte_size) == 0)
+         store->block_same[block] = 1;
+      else
+      {
+         store->block_same[block]   = 0;
+         store->block_hashes[block] = uint32s_index_hash(store->blocks,
+               (const uint32_t*)(job->state + block_start));
+      }
+   }
+}
+
+/* Compares and hashes the whole blocks of 'state' on the pool, leaving
+ * the index lookups to the caller. Returns how many blocks it did. */
+static size_t state_store_prepare(state_store_t *store,
+      const uint8_t *state, size_t state_size, const uint8_t *prev)
+{
+   struct state_store_job jobs[STATE_STORE_MAX_THREADS];
+   size_t i, per_job;
+   size_t count = state_size / state_store_block_size(store);
+
+   if (     !store->pool
+         || state_size < STATE_STORE_PARALLEL_THRESHOLD
+         || count < store->threads)
+      return 0;
+
+   if (count > store->block_cap)
+   {
+      uint32_t *hashes = (uint32_t*)realloc(store->block_hashes,
+            count * sizeof(uint32_t));
+      uint8_t *same;
+      if (!hashes)
+         return 0;
+      store->block_hashes = hashes;
+      if (!(same = (uint8_t*)realloc(store->block_same, count)))
+         return 0;
+      store->block_same = same;
+      store->block_cap  = count;
+   }
+
+   per_job = (count + store->threads - 1) / store->threads;
+   for (i = 0; i < store->threads; i++)
+   {
+      jobs[i].store = store;
+      jobs[i].state = state;
+      jobs[i].prev  = prev;
+      jobs[i].first = MIN(i * per_job, count);
+      jobs[i].last  = MIN(jobs[i].first + per_job, count);
+      if (!tpool_add_work(store->pool, state_store_job_run, &jobs[i]))
+         state_store_job_run(&jobs[i]);
+   }
+   tpool_wait(store->pool);
+
+   return count;
+}
+#endif
+
+void state_store_insert(state_store_t *store,
+      const uint8_t *state, size_t state_size,
+      const uint8_t *prev, const uint32_t *prev_seq,
+      uint32_t *seq, uint64_t frame,
+      const struct state_store_listener *listener)
+{
+   size_t superblock, block;
+   size_t block_byte_size      = state_store_block_size(store);
+   size_t superblock_size      = store->superblocks->object_size;
+   size_t superblock_byte_size = superblock_size * block_byte_size;
+   size_t superblock_count     = state_store_seq_len(store, state_size);
+   uint32_t *superblock_buf    = store->superblock_buf;
+   size_t prepared             = 0;
+   retro_time_t start          = cpu_features_get_time_usec();
+   uint32_t usec;
+
+   if (!prev_seq)
+      prev = NULL;
+
+#ifdef HAVE_THREADS
+   prepared = state_store_prepare(store, state, state_size, prev);
+#endif
+
+   for (superblock = 0; superblock < superblock_count; superblock++)
+   {
+      uint32s_insert_result_t found_block;
+      store->stats.superblocks++;
+      for (block = 0; block < superblock_size; block++)
+      {
+         size_t block_index = superblock * superblock_size + block;
+         size_t block_start = superblock*superblock_byte_size+block*block_byte_size;
+         size_t block_end   = MIN(block_start + block_byte_size, state_size);
+         if (block_index < prepared)
+         {
+            if (prev)
+               store->stats.memcmps++;
+            if (store->block_same[block_index])
+            {
+               store->stats.skipped_blocks++;
+               found_block.index  = uint32s_index_get(store->superblocks,
+                     prev_seq[superblock])[block];
+               found_block.is_new = false;
+               uint32s_index_bump_count(store->blocks, found_block.index);
+            }
+            else
+            {
+               store->stats.hashes++;
+               found_block = uint32s_index_insert_hashed(store->blocks,
+                     (uint32_t*)(state + block_start),
+                     store->block_hashes[block_index], frame);
+            }
+         }
+         else if (block_start > state_size)
+         {
+            /* pad superblocks with zero blocks */
+            found_block.index  = 0;
+            found_block.is_new = false;
+         }
+         else if (   prev
+                  && (++store->stats.memcmps)
+                  && memcmp(prev + block_start, state + block_start,
+                         block_end - block_start) == 0)
+         {
+            store->stats.skipped_blocks++;
+            found_block.index  = uint32s_index_get(store->superblocks,
+                  prev_seq[superblock])[block];
+            found_block.is_new = false;
+            /* bump usage count */
+            uint32s_index_bump_count(store->blocks, found_block.index);
+         }
+         else if (block_start + block_byte_size > state_size)
+         {
+            memset(store->padded_block + (state_size - block_start),
+                  0, block_byte_size - (state_size - block_start));
+            memcpy(store->padded_block, state + block_start,
+                  state_size - block_start);
+            found_block = uint32s_index_insert(store->blocks,
+                  (uint32_t*)store->padded_block, frame);
+            store->stats.hashes++;
+         }
+         else
+         {
+            store->stats.hashes++;
+            found_block = uint32s_index_insert(store->blocks,
+                  (uint32_t*)(state + block_start), frame);
+         }
+         store->stats.blocks++;
+
+         if (found_block.is_new)
+         {
+            if (listener && listener->new_block)
+               listener->new_block(listener->userdata, found_block.index,
+                     uint32s_index_get(store->blocks, found_block.index),
+                     block_byte_size);
+         }
+         else
+            store->stats.reused_blocks++;
+         superblock_buf[block] = found_block.index;
+      }
+      found_block = uint32s_index_insert(store->superblocks,
+            superblock_buf, frame);
+      if (found_block.is_new)
+      {
+         if (listener && listener->new_superblock)
+            listener->new_superblock(listener->userdata, found_block.index,
+                  superblock_buf, superblock_size);
+      }
+      else
+         store->stats.reused_superblocks++;
+      seq[superblock] = found_block.index;
+   }
+   uint32s_index_commit(store->blocks);
+   /* Superblocks are small enough that there's no real benefit to garbage collecting them */
+   /* uint32s_index_commit(store->superblocks); */
+
+   usec                  = (uint32_t)(cpu_features_get_time_usec() - start);
+   store->stats.inserts++;
+   store->stats.bytes   += state_size;
+   store->stats.usec    += usec;
+   if (usec > store->stats.max_usec)
+      store->stats.max_usec = usec;
+}
+
+bool state_store_restore(state_store_t *store, const uint32_t *seq,
+      size_t seq_len, uint8_t *state, size_t state_size)
+{
+   size_t i, j;
+   size_t block_byte_size      = state_store_block_size(store);
+   size_t superblock_size      = store->superblocks->object_size;
+   size_t superblock_byte_size = superblock_size * block_byte_size;
+
+   for (i = 0; i < seq_len; i++)
+   {
+      const uint32_t *superblock = uint32s_index_get(store->superblocks,
+            seq[i]);
+
+      if (!superblock)
+         return false;
+
+      for (j = 0; j < superblock_size; j++)
+      {
+         const uint32_t *block;
+         size_t block_start = MIN(i*superblock_byte_size+j*block_byte_size, state_size);
+         size_t block_end   = MIN(block_start+block_byte_size, state_size);
+         /* This (==) can only happen in the last superblock, if it was padded with extra blocks. */
+         if (block_end <= block_start)
+            break;
+         if (!(block = uint32s_index_get(store->blocks, superblock[j])))
+            return false;
+         memcpy(state + block_start, block, block_end - block_start);
+      }
+   }
+
+   return true;
+}
+
+void state_store_release(state_store_t *store, const uint32_t *seq,
+      size_t seq_len)
+{
+   size_t i, j;
+   size_t superblock_size = store->superblocks->object_size;
+
+   for (i = 0; i < seq_len; i++)
+   {
+      const uint32_t *superblock = uint32s_index_get(store->superblocks,
+            seq[i]);
+
+      if (!superblock)
+         continue;
+
+      /* Inserts take the blocks of a superblock they find again too */
+      for (j = 0; j < superblock_size; j++)
+         uint32s_index_release(store->blocks, superblock[j]);
+      uint32s_index_release(store->superblocks, seq[i]);
+   }
+}
+#endif
@@ -0,0 +1,147 @@
+/**
+ *  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ *  more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with RetroArch. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef __RARCH_STATE_STORE_H
+#define __RARCH_STATE_STORE_H
+
+#ifdef HAVE_STATESTREAM
+#include <stdint.h>
+#include <stddef.h>
+#include <boolean.h>
+#include <retro_common_api.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/tpool.h>
+#endif
+
+#include "input/bsv/uint32s_index.h"
+
+/* States under this size are cut into smaller blocks */
+#define STATE_STORE_SMALL_STATE_THRESHOLD (1 << 20)
+#define STATE_STORE_SUPERBLOCK_SIZE       16    /* measured in blocks */
+#define STATE_STORE_BLOCK_SIZE            16384 /* measured in bytes  */
+#define STATE_STORE_SMALL_BLOCK_SIZE      128   /* measured in bytes  */
+
+/* States at least this big have their blocks compared and hashed on the
+ * worker pool, if the store has one */
+#define STATE_STORE_PARALLEL_THRESHOLD    (1 << 20)
+#define STATE_STORE_MAX_THREADS           8
+
+RETRO_BEGIN_DECLS
+
+/* Told about every block and superblock an insert adds, in the order a
+ * reader needs them, so the caller can write them out. */
+struct state_store_listener
+{
+   void (*new_block)(void *userdata, uint32_t index,
+         const uint32_t *block, size_t len);
+   void (*new_superblock)(void *userdata, uint32_t index,
+         const uint32_t *blocks, size_t count);
+   void *userdata;
+};
+
+struct state_store_stats
+{
+   uint64_t bytes;
+   uint64_t usec;
+   uint32_t max_usec;
+   uint32_t inserts;
+   uint32_t blocks;
+   uint32_t reused_blocks;
+   uint32_t skipped_blocks;
+   uint32_t memcmps;
+   uint32_t hashes;
+   uint32_t superblocks;
+   uint32_t reused_superblocks;
+};
+
+/*
+ * Content-addressed savestate storage. A state is cut into fixed size
+ * blocks, runs of blocks into superblocks, and each distinct block and
+ * superblock is kept once; a state is then its sequence of superblock
+ * indices. States that differ in few places share almost everything.
+ *
+ * With a commit interval the indices collect blocks that saw little use
+ * (see uint32s_index_commit), which suits a replay. Without one, the
+ * counts are references and state_store_release frees what a sequence
+ * no longer needs.
+ */
+typedef struct state_store
+{
+   uint32s_index_t *blocks;
+   uint32s_index_t *superblocks;
+   uint32_t *superblock_buf;
+   uint8_t *padded_block;
+   /* Per block of the state being inserted: its hash, and whether it
+    * matched the previous state */
+   uint32_t *block_hashes;
+   uint8_t *block_same;
+   size_t block_cap;
+#ifdef HAVE_THREADS
+   tpool_t *pool;
+   unsigned threads;
+#endif
+   struct state_store_stats stats;
+} state_store_t;
+
+bool state_store_init(state_store_t *store, size_t block_size,
+      size_t superblock_size, uint8_t commit_interval,
+      uint8_t commit_threshold);
+
+/* Picks the block and superblock sizes for states of 'state_size' */
+bool state_store_init_for_size(state_store_t *store, size_t state_size,
+      uint8_t commit_interval, uint8_t commit_threshold);
+
+void state_store_deinit(state_store_t *store);
+
+/* Spreads the comparing and hashing of big states over 'threads'
+ * workers, or takes it back to the calling thread with 0 or 1 */
+void state_store_set_threads(state_store_t *store, unsigned threads);
+
+size_t state_store_block_size(const state_store_t *store);
+
+/* Superblocks in a sequence for states of 'state_size' */
+size_t state_store_seq_len(const state_store_t *store, size_t state_size);
+
+/**
+ * state_store_insert:
+ * @prev                 : the state @prev_seq was inserted from, or NULL;
+ *                         blocks equal to it skip the lookup
+ * @seq                  : receives state_store_seq_len() superblock
+ *                         indices, and may be @prev_seq
+ * @listener             : told about new blocks and superblocks, or NULL
+ *
+ * Adds @state, taking one reference on every block and superblock of it.
+ **/
+void state_store_insert(state_store_t *store,
+      const uint8_t *state, size_t state_size,
+      const uint8_t *prev, const uint32_t *prev_seq,
+      uint32_t *seq, uint64_t frame,
+      const struct state_store_listener *listener);
+
+/* Rebuilds the state of 'seq' into 'state'. False if a block is gone. */
+bool state_store_restore(state_store_t *store, const uint32_t *seq,
+      size_t seq_len, uint8_t *state, size_t state_size);
+
+/* Drops the references state_store_insert took for 'seq' */
+void state_store_release(state_store_t *store, const uint32_t *seq,
+      size_t seq_len);
+
+RETRO_END_DECLS
+#endif
+
+#endif
@@ -23,6 +23,8 @@ extern char *SWITCH_CPU_PROFILES[];
 extern char *SWITCH_CPU_SPEEDS[];
 extern unsigned SWITCH_CPU_SPEEDS_VALUES[];
 #define SWITCH_DEFAULT_CPU_PROFILE 3 /* Stock Performance */
+/* The last profile: the clock governor picks among the others */
+#define SWITCH_AUTO_CPU_PROFILE    7
 
 #endif
 
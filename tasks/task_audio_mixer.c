@@ -44,6 +44,9 @@ struct audio_mixer_userdata
 struct audio_mixer_handle
 {
    nbio_buf_t *buffer;
+   /* WAV, converted and resampled by the handler so that neither
+    * happens on the main thread */
+   audio_mixer_sound_t *sound;
    retro_task_callback_t cb;
    enum audio_mixer_type type;
    char path[4095];
@@ -58,6 +61,8 @@ static void task_audio_mixer_load_free(retro_task_t *task)
 
    if (mixer)
    {
+      if (mixer->sound)
+         audio_mixer_destroy(mixer->sound);
       if (mixer->buffer)
       {
          if (mixer->buffer->path)
@@ -115,6 +120,7 @@ static void task_audio_mixer_handle_upload_ogg(retro_task_t *task,
    params.buf                  = img->buf;
    params.bufsize              = img->bufsize;
    params.cb                   = NULL;
+   params.handle               = NULL;
    params.basename             = !string_is_empty(img->path) ? strdup(path_basename_nocompression(img->path)) : NULL;
 
    audio_driver_mixer_add_stream(&params);
@@ -146,6 +152,7 @@ static void task_audio_mixer_handle_upload_ogg_and_play(retro_task_t *task,
    params.buf                  = img->buf;
    params.bufsize              = img->bufsize;
    params.cb                   = NULL;
+   params.handle               = NULL;
    params.basename             = !string_is_empty(img->path) ? strdup(path_basename_nocompression(img->path)) : NULL;
 
    audio_driver_mixer_add_stream(&params);
@@ -177,6 +184,7 @@ static void task_audio_mixer_handle_upload_flac(retro_task_t *task,
    params.buf                  = img->buf;
    params.bufsize              = img->bufsize;
    params.cb                   = NULL;
+   params.handle               = NULL;
    params.basename             = !string_is_empty(img->path) ? strdup(path_basename_nocompression(img->path)) : NULL;
 
    audio_driver_mixer_add_stream(&params);
@@ -208,6 +216,7 @@ static void task_audio_mixer_handle_upload_flac_and_play(retro_task_t *task,
    params.buf                  = img->buf;
    params.bufsize              = img->bufsize;
    params.cb                   = NULL;
+   params.handle               = NULL;
    params.basename             = !string_is_empty(img->path) ? strdup(path_basename_nocompression(img->path)) : NULL;
 
    audio_driver_mixer_add_stream(&params);
@@ -239,6 +248,7 @@ static void task_audio_mixer_handle_upload_mp3(retro_task_t *task,
    params.buf                  = img->buf;
    params.bufsize              = img->bufsize;
    params.cb                   = NULL;
+   params.handle               = NULL;
    params.basename             = !string_is_empty(img->path) ? strdup(path_basename_nocompression(img->path)) : NULL;
 
    audio_driver_mixer_add_stream(&params);
@@ -270,6 +280,7 @@ static void task_audio_mixer_handle_upload_mp3_and_play(retro_task_t *task,
    params.buf                  = img->buf;
    params.bufsize              = img->bufsize;
    params.cb                   = NULL;
+   params.handle               = NULL;
    params.basename             = !string_is_empty(img->path) ? strdup(path_basename_nocompression(img->path)) : NULL;
 
    audio_driver_mixer_add_stream(&params);
@@ -301,6 +312,7 @@ static void task_audio_mixer_handle_upload_mod(retro_task_t *task,
    params.buf                  = img->buf;
    params.bufsize              = img->bufsize;
    params.cb                   = NULL;
+   params.handle               = NULL;
    params.basename             = !string_is_empty(img->path) ? strdup(path_basename_nocompression(img->path)) : NULL;
 
    audio_driver_mixer_add_stream(&params);
@@ -332,6 +344,7 @@ static void task_audio_mixer_handle_upload_mod_and_play(retro_task_t *task,
    params.buf                  = img->buf;
    params.bufsize              = img->bufsize;
    params.cb                   = NULL;
+   params.handle               = NULL;
    params.basename             = !string_is_empty(img->path) ? strdup(path_basename_nocompression(img->path)) : NULL;
 
    audio_driver_mixer_add_stream(&params);
@@ -352,6 +365,8 @@ static void task_audio_mixer_handle_upload_wav(retro_task_t *task,
    audio_mixer_stream_params_t params;
    nbio_buf_t *img = (nbio_buf_t*)task_data;
    struct audio_mixer_userdata *user = (struct audio_mixer_userdata*)user_data;
+   nbio_handle_t *nbio               = (nbio_handle_t*)task->state;
+   struct audio_mixer_handle *mixer  = (struct audio_mixer_handle*)nbio->data;
    if (!img || !user)
       return;
 
@@ -364,9 +379,12 @@ static void task_audio_mixer_handle_upload_wav(retro_task_t *task,
    params.buf                  = img->buf;
    params.bufsize              = img->bufsize;
    params.cb                   = NULL;
+   params.handle               = mixer->sound;
    params.basename             = !string_is_empty(img->path) ? strdup(path_basename_nocompression(img->path)) : NULL;
 
-   audio_driver_mixer_add_stream(&params);
+   /* The stream owns the sound now */
+   if (audio_driver_mixer_add_stream(&params))
+      mixer->sound = NULL;
 
    if (img->path)
       free(img->path);
@@ -383,6 +401,8 @@ static void task_audio_mixer_handle_upload_wav_and_play(retro_task_t *task,
    audio_mixer_stream_params_t params;
    nbio_buf_t *img = (nbio_buf_t*)task_data;
    struct audio_mixer_userdata *user = (struct audio_mixer_userdata*)user_data;
+   nbio_handle_t *nbio               = (nbio_handle_t*)task->state;
+   struct audio_mixer_handle *mixer  = (struct audio_mixer_handle*)nbio->data;
    if (!img || !user)
       return;
 
@@ -395,9 +415,12 @@ static void task_audio_mixer_handle_upload_wav_and_play(retro_task_t *task,
    params.buf                  = img->buf;
    params.bufsize              = img->bufsize;
    params.cb                   = NULL;
+   params.handle               = mixer->sound;
    params.basename             = !string_is_empty(img->path) ? strdup(path_basename_nocompression(img->path)) : NULL;
 
-   audio_driver_mixer_add_stream(&params);
+   /* The stream owns the sound now */
+   if (audio_driver_mixer_add_stream(&params))
+      mixer->sound = NULL;
 
    if (img->path)
       free(img->path);
@@ -422,6 +445,16 @@ bool task_audio_mixer_load_handler(retro_task_t *task)
    {
       nbio_buf_t *img = (nbio_buf_t*)malloc(sizeof(*img));
 
+#ifdef HAVE_RWAV
+      if (mixer->type == AUDIO_MIXER_TYPE_WAV)
+      {
+         audio_driver_state_t *audio_st = audio_state_get_ptr();
+         mixer->sound                   = audio_mixer_load_wav(
+               mixer->buffer->buf, (int32_t)mixer->buffer->bufsize,
+               audio_st->resampler_ident, audio_st->resampler_quality);
+      }
+#endif
+
       if (img)
       {
          img->buf     = mixer->buffer->buf;
@@ -0,0 +1,403 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <lrc_hash.h>
+#include <libchdr/chd.h>
+#include <file/file_path.h>
+#include <string/stdstring.h>
+#include <compat/strl.h>
+#include <features/features_cpu.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#include "tasks_internal.h"
+#include "../msg_hash.h"
+#include "../verbosity.h"
+
+/* Threads decoding hunks ahead of the hash */
+#define CHD_VERIFY_MAX_WORKERS 4
+/* Decoded hunks waiting to be hashed, per worker */
+#define CHD_VERIFY_HUNKS_PER_WORKER 8
+/* Hunks hashed per task iteration */
+#define CHD_VERIFY_HUNKS_PER_STEP 64
+
+typedef struct chd_verify_handle chd_verify_handle_t;
+
+#ifdef HAVE_THREADS
+typedef struct chd_verify_worker
+{
+   chd_verify_handle_t *handle;
+   /* Each worker decodes through its own handle; a chd_file keeps
+    * its codec state and file position to itself */
+   chd_file *chd;
+   sthread_t *thread;
+} chd_verify_worker_t;
+#endif
+
+struct chd_verify_handle
+{
+   char *path;
+   chd_file *chd;
+   /* window_size hunk buffers; hunk n is decoded into
+    * slot n % window_size */
+   uint8_t *window;
+   /* Per slot: 0 while pending, 1 when decoded, -1 on error */
+   int8_t *ready;
+   struct sha1_context sha;
+   uint8_t expected[20];
+   uint64_t remaining;
+   uint32_t hunkbytes;
+   uint32_t totalhunks;
+   /* Next hunk to hash */
+   uint32_t hashed;
+   unsigned window_size;
+#ifdef HAVE_THREADS
+   chd_verify_worker_t workers[CHD_VERIFY_MAX_WORKERS];
+   slock_t *lock;
+   scond_t *cond;
+   /* Next hunk to decode */
+   uint32_t next;
+   unsigned num_workers;
+   bool quit;
+#endif
+   bool failed;
+};
+
+#ifdef HAVE_THREADS
+static void chd_verify_worker_thread(void *data)
+{
+   chd_verify_worker_t *worker = (chd_verify_worker_t*)data;
+   chd_verify_handle_t *handle = worker->handle;
+
+   slock_lock(handle->lock);
+   while (!handle->quit && handle->next < handle->totalhunks)
+   {
+      uint32_t hunk;
+      unsigned slot;
+      chd_error err;
+
+      /* Stay within the window the hash has not caught up with */
+      if (handle->next >= handle->hashed + handle->window_size)
+      {
+         scond_wait(handle->cond, handle->lock);
+         continue;
+      }
+
+      hunk = handle->next++;
+      slot = hunk % handle->window_size;
+      slock_unlock(handle->lock);
+
+      err  = chd_read(worker->chd, hunk,
+            handle->window + (size_t)slot * handle->hunkbytes);
+
+      slock_lock(handle->lock);
+      handle->ready[slot] = (err == CHDERR_NONE) ? 1 : -1;
+      scond_broadcast(handle->cond);
+   }
+   slock_unlock(handle->lock);
+}
+
+static void chd_verify_stop_workers(chd_verify_handle_t *handle)
+{
+   unsigned i;
+
+   if (handle->lock)
+   {
+      slock_lock(handle->lock);
+      handle->quit = true;
+      scond_broadcast(handle->cond);
+      slock_unlock(handle->lock);
+   }
+
+   for (i = 0; i < handle->num_workers; i++)
+   {
+      sthread_join(handle->workers[i].thread);
+      chd_close(handle->workers[i].chd);
+   }
+   handle->num_workers = 0;
+}
+
+static void chd_verify_start_workers(chd_verify_handle_t *handle,
+      unsigned count)
+{
+   unsigned i;
+
+   if (!(handle->lock = slock_new()))
+      return;
+   if (!(handle->cond = scond_new()))
+      return;
+
+   for (i = 0; i < count; i++)
+   {
+      chd_verify_worker_t *worker = &handle->workers[handle->num_workers];
+
+      worker->handle = handle;
+      if (chd_open(handle->path, CHD_OPEN_READ, NULL, &worker->chd)
+            != CHDERR_NONE)
+         break;
+      if (!(worker->thread = sthread_create(
+                  chd_verify_worker_thread, worker)))
+      {
+         chd_close(worker->chd);
+         break;
+      }
+      handle->num_workers++;
+   }
+}
+#endif
+
+static void chd_verify_free(chd_verify_handle_t *handle)
+{
+   if (!handle)
+      return;
+
+#ifdef HAVE_THREADS
+   chd_verify_stop_workers(handle);
+   if (handle->cond)
+      scond_free(handle->cond);
+   if (handle->lock)
+      slock_free(handle->lock);
+#endif
+
+   if (handle->chd)
+      chd_close(handle->chd);
+   free(handle->window);
+   free(handle->ready);
+   free(handle->path);
+   free(handle);
+}
+
+/* Waits for the next hunk in hash order, decoding it on the
+ * task's own handle when there are no workers.
+ * Returns false if it could not be decoded. */
+static bool chd_verify_next_hunk(chd_verify_handle_t *handle,
+      const uint8_t **data)
+{
+   unsigned slot = handle->hashed % handle->window_size;
+   bool ok;
+
+#ifdef HAVE_THREADS
+   if (handle->num_workers)
+   {
+      slock_lock(handle->lock);
+      while (!handle->ready[slot])
+         scond_wait(handle->cond, handle->lock);
+      ok = (handle->ready[slot] > 0);
+      slock_unlock(handle->lock);
+   }
+   else
+#endif
+      ok = (chd_read(handle->chd, handle->hashed,
+               handle->window + (size_t)slot * handle->hunkbytes)
+            == CHDERR_NONE);
+
+   *data = handle->window + (size_t)slot * handle->hunkbytes;
+   return ok;
+}
+
+static void chd_verify_release_hunk(chd_verify_handle_t *handle)
+{
+#ifdef HAVE_THREADS
+   if (handle->num_workers)
+   {
+      slock_lock(handle->lock);
+      handle->ready[handle->hashed % handle->window_size] = 0;
+      handle->hashed++;
+      scond_broadcast(handle->cond);
+      slock_unlock(handle->lock);
+      return;
+   }
+#endif
+   handle->hashed++;
+}
+
+static void task_chd_verify_handler(retro_task_t *task)
+{
+   unsigned i;
+   char task_title[PATH_MAX_LENGTH];
+   uint8_t digest[20];
+   size_t _len;
+   bool match;
+   chd_verify_handle_t *handle = (chd_verify_handle_t*)task->state;
+
+   if ((task_get_flags(task) & RETRO_TASK_FLG_CANCELLED) > 0)
+      goto task_finished;
+
+   for (i = 0; i < CHD_VERIFY_HUNKS_PER_STEP
+         && handle->hashed < handle->totalhunks; i++)
+   {
+      const uint8_t *data = NULL;
+      size_t len          = handle->hunkbytes;
+
+      if (!chd_verify_next_hunk(handle, &data))
+      {
+         RARCH_ERR("[CHD] Could not decode hunk %u of \"%s\".\n",
+               (unsigned)handle->hashed, handle->path);
+         handle->failed = true;
+         break;
+      }
+
+      /* The last hunk is padded past the logical size */
+      if (len > handle->remaining)
+         len = (size_t)handle->remaining;
+      sha1_update(&handle->sha, data, len);
+      handle->remaining -= len;
+
+      chd_verify_release_hunk(handle);
+   }
+
+   if (!handle->failed && handle->hashed < handle->totalhunks)
+   {
+      task_set_progress(task, (int8_t)(((uint64_t)handle->hashed * 100)
+               / handle->totalhunks));
+      return;
+   }
+
+   match = !handle->failed
+      && sha1_final(&handle->sha, digest)
+      && !memcmp(digest, handle->expected, sizeof(digest));
+
+   if (match)
+      RARCH_LOG("[CHD] Verified \"%s\".\n", handle->path);
+   else
+      RARCH_ERR("[CHD] Verification of \"%s\" failed.\n", handle->path);
+
+   _len = strlcpy(task_title, msg_hash_to_str(match
+            ? MSG_CHD_VERIFIED : MSG_CHD_VERIFY_FAILED),
+         sizeof(task_title));
+   strlcpy(task_title + _len, path_basename(handle->path),
+         sizeof(task_title) - _len);
+
+   task_free_title(task);
+   task_set_title(task, strdup(task_title));
+   if (!match)
+      task_set_error(task, strdup(msg_hash_to_str(MSG_CHD_VERIFY_FAILED)));
+
+task_finished:
+   task_set_progress(task, 100);
+   task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
+   chd_verify_free(handle);
+   task->state = NULL;
+}
+
+static bool task_chd_verify_finder(retro_task_t *task, void *user_data)
+{
+   chd_verify_handle_t *handle;
+   if (!task || task->handler != task_chd_verify_handler)
+      return false;
+   if (!(handle = (chd_verify_handle_t*)task->state))
+      return false;
+   return string_is_equal(handle->path, (const char*)user_data);
+}
+
+bool task_push_chd_verify(const char *path,
+      retro_task_callback_t cb, void *user_data)
+{
+   size_t _len;
+   char task_title[PATH_MAX_LENGTH];
+   task_finder_data_t find_data;
+   const chd_header *header    = NULL;
+   retro_task_t *task          = NULL;
+   chd_verify_handle_t *handle = NULL;
+
+   if (string_is_empty(path))
+      return false;
+
+   find_data.func     = task_chd_verify_finder;
+   find_data.userdata = (void*)path;
+   if (task_queue_find(&find_data))
+      return false;
+
+   if (!(handle = (chd_verify_handle_t*)calloc(1, sizeof(*handle))))
+      return false;
+
+   handle->path = strdup(path);
+   if (chd_open(path, CHD_OPEN_READ, NULL, &handle->chd) != CHDERR_NONE)
+   {
+      RARCH_ERR("[CHD] Could not open \"%s\".\n", path);
+      goto error;
+   }
+
+   /* Version 3 stores the hash of the raw data as its overall
+    * hash; earlier versions only carry an MD5 */
+   header = chd_get_header(handle->chd);
+   if (header->version < 3)
+   {
+      RARCH_ERR("[CHD] \"%s\" is a version %u CHD, which has no SHA1 to verify.\n",
+            path, header->version);
+      goto error;
+   }
+   memcpy(handle->expected, (header->version == 3)
+         ? header->sha1 : header->rawsha1, sizeof(handle->expected));
+
+   handle->hunkbytes  = header->hunkbytes;
+   handle->totalhunks = header->totalhunks;
+   handle->remaining  = header->logicalbytes;
+   sha1_init(&handle->sha);
+
+#ifdef HAVE_THREADS
+   {
+      unsigned workers = cpu_features_get_core_amount();
+      if (workers > CHD_VERIFY_MAX_WORKERS)
+         workers = CHD_VERIFY_MAX_WORKERS;
+      handle->window_size = workers * CHD_VERIFY_HUNKS_PER_WORKER;
+   }
+#else
+   handle->window_size = 1;
+#endif
+
+   if (!(handle->window = (uint8_t*)malloc(
+               (size_t)handle->window_size * handle->hunkbytes)))
+      goto error;
+   if (!(handle->ready = (int8_t*)calloc(handle->window_size,
+               sizeof(*handle->ready))))
+      goto error;
+
+#ifdef HAVE_THREADS
+   /* With a single core, decoding on the task's handle is as fast */
+   if (handle->window_size > CHD_VERIFY_HUNKS_PER_WORKER)
+      chd_verify_start_workers(handle,
+            handle->window_size / CHD_VERIFY_HUNKS_PER_WORKER);
+#endif
+
+   if (!(task = task_init()))
+      goto error;
+
+   _len = strlcpy(task_title, msg_hash_to_str(MSG_CHD_VERIFYING),
+         sizeof(task_title));
+   strlcpy(task_title + _len, path_basename(path),
+         sizeof(task_title) - _len);
+
+   task->handler   = task_chd_verify_handler;
+   task->state     = handle;
+   task->callback  = cb;
+   task->user_data = user_data;
+   task->title     = strdup(task_title);
+   task->priority  = TASK_PRIORITY_BACKGROUND;
+   task->progress  = 0;
+
+   task_queue_push(task);
+
+   return true;
+
+error:
+   chd_verify_free(handle);
+   return false;
+}
@@ -24,6 +24,8 @@
 #include <time/rtime.h>
 #include <retro_inline.h>
 
+#include <time.h>
+
 #include "../configuration.h"
 #include "../file_path_special.h"
 #include "../network/cloud_sync_driver.h"
@@ -35,6 +37,9 @@
 
 #define MANIFEST_FILENAME_LOCAL  "manifest.local"
 #define MANIFEST_FILENAME_SERVER "manifest.server"
+/* Hashes of the local files by size and modification time, so that
+ * only the files changed since the last sync are read again */
+#define HASH_CACHE_FILENAME      "manifest.hashes"
 
 #define CS_FILE_HASH(item_file) ((char*)((item_file) ? ((item_file)->userdata) : (NULL)))
 #define CS_FILE_KEY(item_file) ((item_file) ? ((item_file)->alt) : (NULL))
@@ -51,6 +56,17 @@ enum task_cloud_sync_phase
    CLOUD_SYNC_PHASE_END
 };
 
+typedef struct
+{
+   char *path;
+   int64_t size;
+   int64_t mtime;
+   /* When the hash was taken; a file changed within the same second
+    * may still have the old mtime, so only older files are trusted */
+   int64_t hashed;
+   char hash[33];
+} task_cloud_sync_hash_t;
+
 typedef struct
 {
    enum task_cloud_sync_phase phase;
@@ -66,6 +82,13 @@ typedef struct
    file_list_t *updated_server_manifest;
    /* local manifest is sometimes different due to conflicts */
    file_list_t *updated_local_manifest;
+   /* Hashes from the last sync, sorted by path */
+   task_cloud_sync_hash_t *hashes;
+   size_t hashes_count;
+   /* Hashes of this sync, written for the next one */
+   task_cloud_sync_hash_t *new_hashes;
+   size_t new_hashes_count;
+   size_t new_hashes_capacity;
    bool need_manifest_uploaded;
    bool failures;
    bool conflicts;
@@ -233,6 +256,133 @@ static void task_cloud_sync_fetch_server_manifest(task_cloud_sync_state_t *sync_
    }
 }
 
+static int task_cloud_sync_hash_cmp(const void *a, const void *b)
+{
+   return strcmp(((const task_cloud_sync_hash_t*)a)->path,
+         ((const task_cloud_sync_hash_t*)b)->path);
+}
+
+static void task_cloud_sync_free_hashes(task_cloud_sync_hash_t *hashes,
+      size_t count)
+{
+   size_t i;
+   for (i = 0; i < count; i++)
+      free(hashes[i].path);
+   free(hashes);
+}
+
+/* Each line is "<hash> <size> <mtime> <hashed> <path>" */
+static void task_cloud_sync_read_hash_cache(task_cloud_sync_state_t *sync_state)
+{
+   char cache_path[PATH_MAX_LENGTH];
+   void *buf   = NULL;
+   int64_t len = 0;
+   size_t lines = 0;
+   char *line, *next;
+   const char *path_dir_core_assets = config_get_ptr()->paths.directory_core_assets;
+
+   fill_pathname_join_special(cache_path, path_dir_core_assets,
+         HASH_CACHE_FILENAME, sizeof(cache_path));
+
+   if (     !path_is_valid(cache_path)
+         || !filestream_read_file(cache_path, &buf, &len))
+      return;
+
+   for (line = (char*)buf; *line; line++)
+      if (*line == '\n')
+         lines++;
+
+   if (lines && (sync_state->hashes = (task_cloud_sync_hash_t*)
+            calloc(lines, sizeof(*sync_state->hashes))))
+   {
+      for (line = (char*)buf; *line && sync_state->hashes_count < lines; line = next)
+      {
+         long long size, mtime, hashed;
+         char hash[33];
+         int path_pos = 0;
+         task_cloud_sync_hash_t *entry;
+
+         if (!(next = strchr(line, '\n')))
+            break;
+         *next++ = '\0';
+
+         if (     sscanf(line, "%32s %lld %lld %lld %n",
+                     hash, &size, &mtime, &hashed, &path_pos) != 4
+               || !path_pos
+               || !line[path_pos]
+               || strlen(hash) != 32)
+            continue;
+
+         entry         = &sync_state->hashes[sync_state->hashes_count];
+         if (!(entry->path = strdup(line + path_pos)))
+            break;
+         entry->size   = size;
+         entry->mtime  = mtime;
+         entry->hashed = hashed;
+         strlcpy(entry->hash, hash, sizeof(entry->hash));
+         sync_state->hashes_count++;
+      }
+
+      qsort(sync_state->hashes, sync_state->hashes_count,
+            sizeof(*sync_state->hashes), task_cloud_sync_hash_cmp);
+   }
+
+   free(buf);
+}
+
+static void task_cloud_sync_write_hash_cache(task_cloud_sync_state_t *sync_state)
+{
+   size_t i;
+   char cache_path[PATH_MAX_LENGTH];
+   RFILE *file;
+   const char *path_dir_core_assets = config_get_ptr()->paths.directory_core_assets;
+
+   fill_pathname_join_special(cache_path, path_dir_core_assets,
+         HASH_CACHE_FILENAME, sizeof(cache_path));
+
+   if (!(file = filestream_open(cache_path,
+         RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      return;
+
+   for (i = 0; i < sync_state->new_hashes_count; i++)
+   {
+      const task_cloud_sync_hash_t *entry = &sync_state->new_hashes[i];
+      filestream_printf(file, "%s %lld %lld %lld %s\n", entry->hash,
+            (long long)entry->size, (long long)entry->mtime,
+            (long long)entry->hashed, entry->path);
+   }
+
+   filestream_close(file);
+}
+
+static void task_cloud_sync_add_hash(task_cloud_sync_state_t *sync_state,
+      const char *path, int64_t size, int64_t mtime, int64_t hashed,
+      const char *hash)
+{
+   task_cloud_sync_hash_t *entry;
+
+   if (sync_state->new_hashes_count == sync_state->new_hashes_capacity)
+   {
+      size_t capacity                 = sync_state->new_hashes_capacity
+         ? sync_state->new_hashes_capacity * 2 : 64;
+      task_cloud_sync_hash_t *hashes  = (task_cloud_sync_hash_t*)realloc(
+            sync_state->new_hashes, capacity * sizeof(*hashes));
+      if (!hashes)
+         return;
+      sync_state->new_hashes          = hashes;
+      sync_state->new_hashes_capacity = capacity;
+   }
+
+   entry         = &sync_state->new_hashes[sync_state->new_hashes_count];
+   if (!(entry->path = strdup(path)))
+      return;
+   entry->size   = size;
+   entry->mtime  = mtime;
+   entry->hashed = hashed;
+   strlcpy(entry->hash, hash, sizeof(entry->hash));
+   sync_state->new_hashes_count++;
+}
+
 static void task_cloud_sync_read_local_manifest(task_cloud_sync_state_t *sync_state)
 {
    char manifest_path[PATH_MAX_LENGTH];
@@ -252,6 +402,8 @@ static void task_cloud_sync_read_local_manifest(task_cloud_sync_state_t *sync_st
       }
    }
 
+   task_cloud_sync_read_hash_cache(sync_state);
+
    sync_state->phase = CLOUD_SYNC_PHASE_BUILD_CURRENT_MANIFEST;
 }
 
@@ -271,6 +423,14 @@ static bool task_cloud_sync_should_ignore_file(const char *filename)
          return true;
    }
 
+   /* playlist caches are rebuilt from the playlists, and journals
+    * are folded into them on exit */
+   if (     string_ends_with(filename,
+               FILE_PATH_LPL_EXTENSION FILE_PATH_LPL_CACHE_EXTENSION)
+         || string_ends_with(filename,
+               FILE_PATH_LPL_EXTENSION FILE_PATH_LPL_JOURNAL_EXTENSION))
+      return true;
+
    if (string_ends_with(filename, "/.DS_Store"))
        return true;
 
@@ -522,6 +682,65 @@ static char *task_cloud_sync_md5_rfile(RFILE *file)
    return hash;
 }
 
+/**
+ * task_cloud_sync_hash_file:
+ * @sync_state           : the sync
+ * @path                 : local file
+ * @file                 : @path opened for reading, or NULL
+ *
+ * Returns the hash of @path from the last sync's cache when the file
+ * has not changed since, and reads it otherwise, opening @path if
+ * @file is NULL.
+ *
+ * Returns: the hash, to be freed, or NULL if the file can't be read.
+ **/
+static char *task_cloud_sync_hash_file(task_cloud_sync_state_t *sync_state,
+      const char *path, RFILE *file)
+{
+   int64_t size, mtime, hashed;
+   char *hash;
+   bool have_stat = path_get_size_and_mtime(path, &size, &mtime);
+
+   if (have_stat && sync_state->hashes_count)
+   {
+      task_cloud_sync_hash_t key;
+      const task_cloud_sync_hash_t *entry;
+
+      key.path = (char*)path;
+      entry    = (const task_cloud_sync_hash_t*)bsearch(&key,
+            sync_state->hashes, sync_state->hashes_count,
+            sizeof(*sync_state->hashes), task_cloud_sync_hash_cmp);
+
+      if (     entry
+            && entry->size  == size
+            && entry->mtime == mtime
+            && entry->mtime <  entry->hashed)
+      {
+         task_cloud_sync_add_hash(sync_state, path, size, mtime,
+               entry->hashed, entry->hash);
+         return strdup(entry->hash);
+      }
+   }
+
+   hashed = (int64_t)time(NULL);
+
+   if (file)
+      hash = task_cloud_sync_md5_rfile(file);
+   else
+   {
+      if (!(file = filestream_open(path,
+            RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS)))
+         return NULL;
+      hash = task_cloud_sync_md5_rfile(file);
+      filestream_close(file);
+   }
+
+   if (hash && have_stat)
+      task_cloud_sync_add_hash(sync_state, path, size, mtime, hashed, hash);
+
+   return hash;
+}
+
 /* don't pass a server/local item_file to this, only current has ->path set */
 static void task_cloud_sync_backup_file(struct item_file *file)
 {
@@ -765,7 +984,9 @@ static void task_cloud_sync_upload_current_file(task_cloud_sync_state_t *sync_st
 
    RARCH_LOG(CSPFX "Uploading \"%s\".\n", path);
 
-   item->userdata = task_cloud_sync_md5_rfile(file);
+   /* Already hashed when it was compared with the server's */
+   if (!item->userdata)
+      item->userdata = task_cloud_sync_hash_file(sync_state, filename, file);
 
    filestream_seek(file, 0, SEEK_SET);
    sync_state->waiting++;
@@ -805,7 +1026,6 @@ static void task_cloud_sync_check_server_current(task_cloud_sync_state_t *sync_s
    struct item_file *local_file   = NULL;
    struct item_file *current_file = &sync_state->current_manifest->list[sync_state->current_idx];
    const char       *filename     = current_file->path;
-   RFILE            *file;
 
    if (task_cloud_sync_should_ignore_file(CS_FILE_KEY(server_file)))
    {
@@ -813,14 +1033,10 @@ static void task_cloud_sync_check_server_current(task_cloud_sync_state_t *sync_s
       return;
    }
 
-   file = filestream_open(filename,
-         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS);
-   if (!file)
+   if (!(current_file->userdata = task_cloud_sync_hash_file(sync_state,
+               filename, NULL)))
       return;
 
-   current_file->userdata = task_cloud_sync_md5_rfile(file);
-   filestream_close(file);
-
    if (string_is_equal(CS_FILE_HASH(server_file), CS_FILE_HASH(current_file)))
    {
       task_cloud_sync_add_to_updated_manifest(sync_state, CS_FILE_KEY(current_file), CS_FILE_HASH(current_file), true);
@@ -1181,6 +1397,8 @@ static void task_cloud_sync_update_manifests(task_cloud_sync_state_t *sync_state
    if (file)
       filestream_close(file);
 
+   task_cloud_sync_write_hash_cache(sync_state);
+
    if (sync_state->need_manifest_uploaded)
    {
       RARCH_LOG(CSPFX "Uploading updated manifest to server...\n");
@@ -1320,6 +1538,9 @@ static void task_cloud_sync_cb(retro_task_t *task, void *task_data,
       file_list_free(sync_state->updated_server_manifest);
    if (sync_state->updated_local_manifest)
       file_list_free(sync_state->updated_local_manifest);
+   task_cloud_sync_free_hashes(sync_state->hashes, sync_state->hashes_count);
+   task_cloud_sync_free_hashes(sync_state->new_hashes,
+         sync_state->new_hashes_count);
 
    free(sync_state);
 }
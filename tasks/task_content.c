@@ -267,6 +267,25 @@ bool content_file_override_set(
    return true;
 }
 
+/* Releases the content data of 'file_info',
+ * whether it was read or mapped */
+static void content_file_info_free_data(
+      content_file_info_t *file_info)
+{
+   if (file_info->data)
+   {
+      if (file_info->data_mapped)
+         filestream_unmap_file(file_info->data,
+               (int64_t)file_info->data_size);
+      else
+         free((void*)file_info->data);
+   }
+
+   file_info->data        = NULL;
+   file_info->data_size   = 0;
+   file_info->data_mapped = false;
+}
+
 /* Frees any content data that is not flagged
  * as 'persistent'. Should be called after
  * content_file_load() */
@@ -284,12 +303,7 @@ static void content_file_list_free_transient_data(
 
       if (file_info->data &&
           !file_info->persistent_data)
-      {
-         free((void*)file_info->data);
-
-         file_info->data      = NULL;
-         file_info->data_size = 0;
-      }
+         content_file_info_free_data(file_info);
    }
 }
 
@@ -341,12 +355,7 @@ static void content_file_list_free_entry(
       file_info->meta = NULL;
    }
 
-   if (file_info->data)
-   {
-      free((void*)file_info->data);
-      file_info->data = NULL;
-   }
-   file_info->data_size       = 0;
+   content_file_info_free_data(file_info);
 
    file_info->file_in_archive = false;
    file_info->persistent_data = false;
@@ -462,12 +471,14 @@ static const char *content_file_list_append_temporary(
    return NULL;
 }
 
-/* Note: Takes ownership of supplied 'data' buffer */
+/* Note: Takes ownership of supplied 'data' buffer
+ * (a file mapping if 'data_mapped' is set) */
 static bool content_file_list_set_info(
       content_file_list_t *file_list,
       const char *path,
       void *data,
       size_t data_size,
+      bool data_mapped,
       bool persistent_data,
       size_t idx)
 {
@@ -515,6 +526,7 @@ static bool content_file_list_set_info(
 
    file_info->data            = data;
    file_info->data_size       = data_size;
+   file_info->data_mapped     = data_mapped;
    file_info->persistent_data = persistent_data;
 
    /* Assign paths
@@ -643,15 +655,45 @@ static bool content_file_list_set_info(
 #define BLCK_REQUIRED      4
 #define BLCK_PERSISTENT    8
 
+/* Returns true if soft patching may be applied to
+ * content file 'idx'. Patching replaces (and frees)
+ * the content buffer, so such content cannot be
+ * mapped */
+static bool content_file_may_patch(
+      content_information_ctx_t *content_ctx,
+      size_t idx,
+      enum rarch_content_type first_content_type)
+{
+#ifdef HAVE_PATCH
+   /* > Only the first patch is looked for here:
+    *   indexed patches are only tried after it */
+   if (     (idx == 0)
+         && (first_content_type == RARCH_CONTENT_NONE)
+         && !(content_ctx->flags & CONTENT_INFO_FLAG_PATCH_IS_BLOCKED))
+      return (!string_is_empty(content_ctx->name_ips)
+               && path_is_valid(content_ctx->name_ips))
+          || (!string_is_empty(content_ctx->name_bps)
+               && path_is_valid(content_ctx->name_bps))
+          || (!string_is_empty(content_ctx->name_ups)
+               && path_is_valid(content_ctx->name_ups))
+          || (!string_is_empty(content_ctx->name_xdelta)
+               && path_is_valid(content_ctx->name_xdelta));
+#endif
+   return false;
+}
+
 /**
  * content_file_load_into_memory:
  * @content_path : path of the content file.
  * @data         : buffer into which the content file will be read.
- * @data_size    : size of the resultant content buffer.
+ * @mapped       : set if @data is a file mapping rather than a
+ *                 heap buffer.
  *
  * Reads the content file into memory. Also performs soft patching
  * (see patch_content function) if soft patching has not been
- * blocked by the user.
+ * blocked by the user. Uncompressed content that will not be
+ * patched is mapped instead, where possible, so that pages are
+ * only read once the core touches them.
  *
  * Returns: non-0 if successful, 0 on error.
  **/
@@ -662,11 +704,14 @@ static size_t content_file_load_into_memory(
       bool content_compressed,
       size_t idx,
       enum rarch_content_type first_content_type,
-      uint8_t **data)
+      uint8_t **data,
+      bool *mapped)
 {
    uint8_t *content_data = NULL;
    int64_t content_size  = 0;
 
+   *mapped               = false;
+
    RARCH_LOG("[Content] %s: \"%s\".\n",
          msg_hash_to_str(MSG_LOADING_CONTENT_FILE), content_path);
 
@@ -680,9 +725,13 @@ static size_t content_file_load_into_memory(
    }
    else
 #endif
-      if (!filestream_read_file(content_path,
+   if (  !content_file_may_patch(content_ctx, idx, first_content_type)
+       && filestream_map_file(content_path,
             (void**)&content_data, &content_size))
-         return 0;
+      *mapped = true;
+   else if (!filestream_read_file(content_path,
+            (void**)&content_data, &content_size))
+      return 0;
 
    if (content_size < 0)
       return 0;
@@ -921,6 +970,8 @@ static bool content_file_load(
    size_t i;
    retro_ctx_load_content_info_t load_info;
    bool used_vfs_fallback_copy                = false;
+   uint64_t bytes_mapped                      = 0;
+   uint64_t bytes_read                        = 0;
 #ifdef __WINRT__
    rarch_system_info_t *sys_info              = &runloop_state_get_ptr()->system;
 #endif
@@ -931,6 +982,7 @@ static bool content_file_load(
       const char *content_path = NULL;
       uint8_t *content_data    = NULL;
       size_t content_size      = 0;
+      bool content_mapped      = false;
       const char *valid_exts   = special
             ? special->roms[i].valid_extensions
             : content_ctx->valid_extensions;
@@ -972,7 +1024,7 @@ static bool content_file_load(
             if ((content_size = content_file_load_into_memory(
                   content_ctx, p_content, content_path,
                   content_compressed, i, first_content_type,
-                  &content_data)) == 0)
+                  &content_data, &content_mapped)) == 0)
             {
                char msg[PATH_MAX_LENGTH];
                snprintf(msg, sizeof(msg), "%s: \"%s\".\n",
@@ -1094,17 +1146,28 @@ static bool content_file_load(
       /* Add current entry to content file list */
       if (!content_file_list_set_info(
             p_content->content_list,
-            content_path, content_data, content_size,
+            content_path, content_data, content_size, content_mapped,
             ((content->elems[i].attr.i & BLCK_PERSISTENT) != 0), i))
       {
          RARCH_LOG("[Content] Failed to process content file: \"%s\".\n", content_path);
-         if (content_data)
+         if (content_mapped)
+            filestream_unmap_file(content_data, (int64_t)content_size);
+         else if (content_data)
             free((void*)content_data);
          *error_enum = MSG_FAILED_TO_LOAD_CONTENT;
          return false;
       }
+
+      if (content_mapped)
+         bytes_mapped += content_size;
+      else
+         bytes_read   += content_size;
    }
 
+   if (bytes_mapped > 0)
+      RARCH_LOG("[Content] Mapped %u KB of content, read %u KB.\n",
+            (unsigned)(bytes_mapped >> 10), (unsigned)(bytes_read >> 10));
+
    /* Load content into core */
    load_info.content = content;
    load_info.special = special;
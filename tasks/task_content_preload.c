@@ -0,0 +1,253 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <file/file_path.h>
+#include <lists/string_list.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+
+#include "tasks_internal.h"
+
+#ifdef HAVE_CONFIG_H
+#include "../config.h"
+#endif
+
+#ifdef HAVE_LIBRETRODB
+#include "task_database_cue.h"
+#endif
+
+#include "../verbosity.h"
+
+/* Read per handler call, so a cancelled preload stops soon */
+#define CONTENT_PRELOAD_CHUNK_SIZE (256 * 1024)
+/* Past this much of one file, the rest is left to the load itself */
+#define CONTENT_PRELOAD_MAX_SIZE   (256 * 1024 * 1024)
+/* Of a disc image, the part a swap reads first: the CHD header,
+ * hunk map and first hunks, or the start of a track */
+#define DISC_PRELOAD_MAX_SIZE      (32 * 1024 * 1024)
+
+typedef struct content_preload
+{
+   RFILE *file;
+   uint8_t *buffer;
+   struct string_list *paths;
+   /* The counter that supersedes this preload when it moves on */
+   const unsigned *generation_src;
+   int64_t read;
+   int64_t max_size;
+   unsigned generation;
+   unsigned step;
+} content_preload_t;
+
+/* Bumped by every push; older preloads see it and stop */
+static unsigned content_preload_generation      = 0;
+static unsigned disc_preload_generation         = 0;
+static char content_preload_last_core[PATH_MAX_LENGTH];
+static char content_preload_last_content[PATH_MAX_LENGTH];
+static char disc_preload_last[PATH_MAX_LENGTH];
+
+/* Opens the file of the current step. For content inside an
+ * archive, the archive itself. */
+static bool task_content_preload_open(content_preload_t *preload)
+{
+   char path[PATH_MAX_LENGTH];
+   const char *delim;
+
+   if (preload->step >= preload->paths->size)
+      return false;
+
+   strlcpy(path, preload->paths->elems[preload->step].data, sizeof(path));
+   if ((delim = path_get_archive_delim(path)))
+      path[delim - path] = '\0';
+
+   if (string_is_empty(path) || !path_is_valid(path))
+      return false;
+
+   preload->file = filestream_open(path, RETRO_VFS_FILE_ACCESS_READ,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   preload->read = 0;
+   return preload->file != NULL;
+}
+
+/* Reads through the core library and the content file once, so that
+ * loading them afterwards comes out of the page cache instead of the
+ * disk. Nothing is kept: the core can't be initialised beside the
+ * running one, and the content loader reads the file again anyway. */
+static void task_content_preload_handler(retro_task_t *task)
+{
+   content_preload_t *preload = (content_preload_t*)task->task_data;
+
+   if (     (task_get_flags(task) & RETRO_TASK_FLG_CANCELLED)
+         || preload->generation != *preload->generation_src)
+      goto done;
+
+   if (!preload->file)
+   {
+      while (     preload->step < preload->paths->size
+               && !task_content_preload_open(preload))
+         preload->step++;
+      if (!preload->file)
+         goto done;
+   }
+
+   if (     preload->read < preload->max_size
+         && filestream_read(preload->file, preload->buffer,
+               CONTENT_PRELOAD_CHUNK_SIZE) > 0)
+   {
+      preload->read += CONTENT_PRELOAD_CHUNK_SIZE;
+      return;
+   }
+
+   RARCH_DBG("[Content] Preloaded \"%s\" (%u KB).\n",
+         path_basename(preload->paths->elems[preload->step].data),
+         (unsigned)(preload->read / 1024));
+   filestream_close(preload->file);
+   preload->file = NULL;
+   preload->step++;
+   return;
+
+done:
+   task_set_progress(task, 100);
+   task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
+}
+
+static void task_content_preload_cleanup(retro_task_t *task)
+{
+   content_preload_t *preload = (content_preload_t*)task->task_data;
+
+   if (preload->file)
+      filestream_close(preload->file);
+   string_list_free(preload->paths);
+   free(preload->buffer);
+   free(preload);
+   task->task_data = NULL;
+}
+
+/* Takes @paths */
+static bool task_content_preload_push(struct string_list *paths,
+      unsigned *generation_src, int64_t max_size)
+{
+   retro_task_t *task;
+   content_preload_t *preload;
+
+   if (!(preload = (content_preload_t*)calloc(1, sizeof(*preload))))
+   {
+      string_list_free(paths);
+      return false;
+   }
+
+   if (   !(preload->buffer = (uint8_t*)malloc(CONTENT_PRELOAD_CHUNK_SIZE))
+       || !(task = task_init()))
+   {
+      string_list_free(paths);
+      free(preload->buffer);
+      free(preload);
+      return false;
+   }
+
+   preload->paths          = paths;
+   preload->generation_src = generation_src;
+   preload->generation     = ++(*generation_src);
+   preload->max_size       = max_size;
+
+   task->handler           = task_content_preload_handler;
+   task->cleanup           = task_content_preload_cleanup;
+   task->task_data         = preload;
+   task->flags            |= RETRO_TASK_FLG_MUTE;
+
+   task_queue_push(task);
+
+   return true;
+}
+
+bool task_push_content_preload(const char *core_path,
+      const char *content_path)
+{
+   union string_list_elem_attr attr;
+   struct string_list *paths;
+
+   if (string_is_empty(core_path) && string_is_empty(content_path))
+      return false;
+
+   /* Already read, or being read */
+   if (     string_is_equal(core_path    ? core_path    : "",
+               content_preload_last_core)
+         && string_is_equal(content_path ? content_path : "",
+               content_preload_last_content))
+      return true;
+
+   if (!(paths = string_list_new()))
+      return false;
+
+   attr.i = 0;
+   if (!string_is_empty(core_path))
+      string_list_append(paths, core_path, attr);
+   if (!string_is_empty(content_path))
+      string_list_append(paths, content_path, attr);
+
+   strlcpy(content_preload_last_core, core_path ? core_path : "",
+         sizeof(content_preload_last_core));
+   strlcpy(content_preload_last_content, content_path ? content_path : "",
+         sizeof(content_preload_last_content));
+
+   return task_content_preload_push(paths, &content_preload_generation,
+         CONTENT_PRELOAD_MAX_SIZE);
+}
+
+bool task_push_disc_preload(const char *image_path)
+{
+   union string_list_elem_attr attr;
+   struct string_list *paths;
+
+   if (string_is_empty(image_path))
+      return false;
+
+   /* Already read, or being read */
+   if (string_is_equal(image_path, disc_preload_last))
+      return true;
+
+   if (!(paths = string_list_new()))
+      return false;
+
+   attr.i = 0;
+   string_list_append(paths, image_path, attr);
+
+#ifdef HAVE_LIBRETRODB
+   /* A cue sheet is only the index; the tracks are what the
+    * core reads */
+   if (string_is_equal_noncase(path_get_extension(image_path), "cue"))
+   {
+      intfstream_t *fd = intfstream_open_file(image_path,
+            RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+      if (fd)
+      {
+         char track_path[PATH_MAX_LENGTH];
+         while (cue_next_file(fd, image_path, track_path, sizeof(track_path)))
+            if (string_list_find_elem(paths, track_path) == 0)
+               string_list_append(paths, track_path, attr);
+         intfstream_close(fd);
+         free(fd);
+      }
+   }
+#endif
+
+   strlcpy(disc_preload_last, image_path, sizeof(disc_preload_last));
+
+   return task_content_preload_push(paths, &disc_preload_generation,
+         DISC_PRELOAD_MAX_SIZE);
+}
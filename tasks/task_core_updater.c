@@ -107,6 +107,10 @@ typedef struct core_updater_download_handle
 } core_updater_download_handle_t;
 
 /* Update installed cores */
+
+/* Most core downloads kept in flight at once */
+#define UPDATE_INSTALLED_CORES_MAX_DOWNLOADS 4
+
 enum update_installed_cores_status
 {
    UPDATE_INSTALLED_CORES_BEGIN = 0,
@@ -123,11 +127,13 @@ typedef struct update_installed_cores_handle
    char *path_dir_core_assets;
    core_updater_list_t* core_list;
    retro_task_t *list_task;
-   retro_task_t *download_task;
+   retro_task_t *download_tasks[UPDATE_INSTALLED_CORES_MAX_DOWNLOADS];
    size_t auto_backup_history_size;
    size_t list_size;
    size_t list_index;
    size_t installed_index;
+   unsigned max_downloads;
+   unsigned num_downloads;
    unsigned num_updated;
    unsigned num_locked;
    enum update_installed_cores_status status;
@@ -932,7 +938,22 @@ static void task_core_updater_download_handler(retro_task_t *task)
             /* Wait for task_push_decompress()
              * callback to trigger */
             if (download_handle->decompress_task_complete)
+            {
                download_handle->status = CORE_UPDATER_DOWNLOAD_END;
+
+               /* Check the installed core against the CRC the
+                * core list gives for it, which also catches a
+                * truncated download or a failed extraction */
+               if (     (download_handle->remote_crc != 0)
+                     && (task_core_updater_get_core_crc(
+                           download_handle->local_core_path)
+                           != download_handle->remote_crc))
+               {
+                  RARCH_ERR("[Core Updater] CRC mismatch for installed core: \"%s\".\n",
+                        download_handle->local_core_path);
+                  download_handle->status = CORE_UPDATER_DOWNLOAD_ERROR;
+               }
+            }
          }
          break;
       case CORE_UPDATER_DOWNLOAD_ERROR:
@@ -1114,6 +1135,7 @@ void *task_push_core_updater_download(
          sizeof(task_title) - _len);
 
    task->handler          = task_core_updater_download_handler;
+   task->priority         = TASK_PRIORITY_BACKGROUND;
    task->state            = download_handle;
    task->title            = strdup(task_title);
    task->progress         = 0;
@@ -1164,6 +1186,29 @@ static void free_update_installed_cores_handle(
    update_installed_handle = NULL;
 }
 
+/* Drops the finished downloads from the in-flight set.
+ * Returns the number still running. */
+static unsigned task_update_installed_cores_reap(
+      update_installed_cores_handle_t *update_installed_handle)
+{
+   unsigned i = 0;
+
+   while (i < update_installed_handle->num_downloads)
+   {
+      uint8_t _flg = task_get_flags(
+            update_installed_handle->download_tasks[i]);
+
+      if ((_flg & RETRO_TASK_FLG_FINISHED) > 0)
+         update_installed_handle->download_tasks[i] =
+               update_installed_handle->download_tasks[
+                     --update_installed_handle->num_downloads];
+      else
+         i++;
+   }
+
+   return update_installed_handle->num_downloads;
+}
+
 static void task_update_installed_cores_handler(retro_task_t *task)
 {
    uint8_t flg;
@@ -1237,10 +1282,11 @@ static void task_update_installed_cores_handler(retro_task_t *task)
             bool core_installed                         = false;
 
             /* Check whether we have reached the end
-             * of the list */
+             * of the list - downloads still in flight
+             * are waited for first */
             if (update_installed_handle->list_index >= update_installed_handle->list_size)
             {
-               update_installed_handle->status = UPDATE_INSTALLED_CORES_END;
+               update_installed_handle->status = UPDATE_INSTALLED_CORES_WAIT_DOWNLOAD;
                break;
             }
 
@@ -1290,6 +1336,7 @@ static void task_update_installed_cores_handler(retro_task_t *task)
       case UPDATE_INSTALLED_CORES_UPDATE_CORE:
          {
             const core_updater_list_entry_t *list_entry = NULL;
+            retro_task_t *download_task                 = NULL;
             uint32_t local_crc                          = 0;
 
             /* Get list entry
@@ -1348,7 +1395,7 @@ static void task_update_installed_cores_handler(retro_task_t *task)
 
             /* Existing core is not the most recent version
              * > Request download */
-            update_installed_handle->download_task = (retro_task_t*)
+            download_task = (retro_task_t*)
                   task_push_core_updater_download(
                         update_installed_handle->core_list,
                         list_entry->remote_filename,
@@ -1360,7 +1407,7 @@ static void task_update_installed_cores_handler(retro_task_t *task)
 
             /* Again, if an error occurred, just return to
              * UPDATE_INSTALLED_CORES_ITERATE state */
-            if (!update_installed_handle->download_task)
+            if (!download_task)
                update_installed_handle->status = UPDATE_INSTALLED_CORES_ITERATE;
             else
             {
@@ -1380,7 +1427,9 @@ static void task_update_installed_cores_handler(retro_task_t *task)
                /* Increment 'updated cores' counter */
                update_installed_handle->num_updated++;
 
-               /* Wait for download to complete */
+               /* Wait for a free download slot */
+               update_installed_handle->download_tasks[
+                     update_installed_handle->num_downloads++] = download_task;
                update_installed_handle->status = UPDATE_INSTALLED_CORES_WAIT_DOWNLOAD;
                RARCH_LOG("[Core Updater] Downloading: \"%s\"...\n",
                      list_entry->display_name);
@@ -1389,30 +1438,20 @@ static void task_update_installed_cores_handler(retro_task_t *task)
          break;
       case UPDATE_INSTALLED_CORES_WAIT_DOWNLOAD:
          {
-            bool download_complete = false;
-
-            /* > If task is running, check 'is finished'
-             *   status
-             * > If task is NULL, then it is finished
-             *   by definition */
-            if (update_installed_handle->download_task)
-            {
-               uint8_t _flg      = task_get_flags(update_installed_handle->download_task);
-               if ((_flg & RETRO_TASK_FLG_FINISHED) > 0)
-                  download_complete = true;
-               else
-                  download_complete = false;
-            }
-            else
-               download_complete = true;
+            unsigned num_downloads = task_update_installed_cores_reap(
+                  update_installed_handle);
 
-            /* If download is complete, return to
-             * UPDATE_INSTALLED_CORES_ITERATE state */
-            if (download_complete)
+            /* Once the whole list has been checked, end
+             * when the last download completes - otherwise
+             * return to UPDATE_INSTALLED_CORES_ITERATE state
+             * as soon as a download slot is free */
+            if (update_installed_handle->list_index >= update_installed_handle->list_size)
             {
-               update_installed_handle->download_task = NULL;
-               update_installed_handle->status        = UPDATE_INSTALLED_CORES_ITERATE;
+               if (num_downloads == 0)
+                  update_installed_handle->status = UPDATE_INSTALLED_CORES_END;
             }
+            else if (num_downloads < update_installed_handle->max_downloads)
+               update_installed_handle->status = UPDATE_INSTALLED_CORES_ITERATE;
          }
          break;
       case UPDATE_INSTALLED_CORES_END:
@@ -1494,6 +1533,7 @@ void task_push_update_installed_cores(
       const char *path_dir_core_assets)
 {
    task_finder_data_t find_data;
+   settings_t *settings                                     = config_get_ptr();
    retro_task_t *task                                       = NULL;
    update_installed_cores_handle_t *update_installed_handle =
          (update_installed_cores_handle_t*)
@@ -1519,7 +1559,9 @@ void task_push_update_installed_cores(
          NULL : strdup(path_dir_core_assets);
    update_installed_handle->core_list                = core_updater_list_init();
    update_installed_handle->list_task                = NULL;
-   update_installed_handle->download_task            = NULL;
+   update_installed_handle->max_downloads            =
+         settings->uints.network_http_concurrent_downloads;
+   update_installed_handle->num_downloads            = 0;
    update_installed_handle->list_size                = 0;
    update_installed_handle->list_index               = 0;
    update_installed_handle->installed_index          = 0;
@@ -1527,6 +1569,11 @@ void task_push_update_installed_cores(
    update_installed_handle->num_locked               = 0;
    update_installed_handle->status                   = UPDATE_INSTALLED_CORES_BEGIN;
 
+   if (update_installed_handle->max_downloads < 1)
+      update_installed_handle->max_downloads = 1;
+   else if (update_installed_handle->max_downloads > UPDATE_INSTALLED_CORES_MAX_DOWNLOADS)
+      update_installed_handle->max_downloads = UPDATE_INSTALLED_CORES_MAX_DOWNLOADS;
+
    if (!update_installed_handle->core_list)
       goto error;
 
@@ -1543,6 +1590,7 @@ void task_push_update_installed_cores(
 
    /* Configure task */
    task->handler          = task_update_installed_cores_handler;
+   task->priority         = TASK_PRIORITY_BACKGROUND;
    task->state            = update_installed_handle;
    task->title            = strdup(msg_hash_to_str(MSG_FETCHING_CORE_LIST));
    task->progress         = 0;
@@ -16,6 +16,7 @@
  */
 
 #include <math.h>
+#include <array/rhmap.h>
 #include <compat/strcasestr.h>
 #include <compat/strl.h>
 #include <retro_miscellaneous.h>
@@ -27,7 +28,12 @@
 #include <formats/logiqx_dat.h>
 #include <formats/m3u_file.h>
 #include <encodings/crc32.h>
+#include <features/features_cpu.h>
+#include <streams/file_stream.h>
 #include <streams/interface_stream.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 #include "tasks_internal.h"
 
 #include "../core_info.h"
@@ -179,9 +185,84 @@ enum db_flags_enum
    DB_HANDLE_FLAG_SCAN_STARTED            = (1 << 1),
    DB_HANDLE_FLAG_SCAN_WITHOUT_CORE_MATCH = (1 << 2),
    DB_HANDLE_FLAG_SHOW_HIDDEN_FILES       = (1 << 3),
-   DB_HANDLE_FLAG_USE_FIRST_MATCH_ONLY    = (1 << 4)
+   DB_HANDLE_FLAG_USE_FIRST_MATCH_ONLY    = (1 << 4),
+   /* Every file of the list was looked at */
+   DB_HANDLE_FLAG_SCAN_COMPLETE           = (1 << 5)
+};
+
+#define DATABASE_SCAN_CACHE_VERSION 1
+
+/* A probe result kept across scans in FILE_PATH_CONTENT_SCAN_CACHE,
+ * under the file's path. It only stands while the file keeps its
+ * size and modification time. */
+typedef struct database_scan_cache_entry
+{
+   int64_t file_size;
+   int64_t mtime;
+   uint64_t size;
+   uint64_t archive_size;
+   char *serial;
+   uint32_t crc;
+   uint32_t archive_crc;
+   int ret;
+   enum database_type type;
+} database_scan_cache_entry_t;
+
+/* What probing one file found: its hashes and sizes, or its serial,
+ * and the lookup that goes with them */
+typedef struct database_scan_probe
+{
+   int64_t file_size;
+   int64_t mtime;
+   uint64_t size;
+   uint64_t archive_size;
+   uint32_t crc;
+   uint32_t archive_crc;
+   int ret;
+   enum database_type type;
+   bool stat_ok;           /* file_size and mtime are valid */
+   bool cached;            /* Taken from the scan cache */
+   char serial[4096];      /* TODO/FIXME - check size */
+} database_scan_probe_t;
+
+#ifdef HAVE_THREADS
+/* Files probed ahead of the database lookups */
+#define DATABASE_SCAN_AHEAD       16
+#define DATABASE_SCAN_MAX_WORKERS 4
+
+enum database_scan_slot_state
+{
+   DATABASE_SCAN_SLOT_FREE = 0,
+   DATABASE_SCAN_SLOT_QUEUED,
+   DATABASE_SCAN_SLOT_RUNNING,
+   DATABASE_SCAN_SLOT_DONE
 };
 
+typedef struct database_scan_slot
+{
+   char *name;
+   size_t index;
+   database_scan_probe_t probe;
+   enum database_scan_slot_state state;
+} database_scan_slot_t;
+
+/* Workers that open, read and hash the next files of the list while
+ * the task matches the current one against the databases. The slot
+ * of list entry i is slots[i % DATABASE_SCAN_AHEAD]; the task fills
+ * and frees slots, the workers only probe the queued ones. */
+typedef struct database_scan_pool
+{
+   sthread_t *threads[DATABASE_SCAN_MAX_WORKERS];
+   const database_scan_cache_entry_t *cache;
+   slock_t *lock;
+   scond_t *cond;
+   size_t next;            /* Next list entry to queue */
+   database_scan_slot_t slots[DATABASE_SCAN_AHEAD];
+   unsigned workers;
+   bool quit;
+} database_scan_pool_t;
+#endif
+
 typedef struct db_handle
 {
    char *playlist_directory;
@@ -191,6 +272,17 @@ typedef struct db_handle
    database_state_handle_t state;
    playlist_config_t playlist_config; /* size_t alignment */
    scan_results_t scan_results;
+   /* Read at the start and left alone during the scan, the workers
+    * look files up in it */
+   database_scan_cache_entry_t *scan_cache;
+   /* Files probed or found in the cache by this scan */
+   database_scan_cache_entry_t *scan_cache_fresh;
+#ifdef HAVE_THREADS
+   database_scan_pool_t *scan_pool;
+#endif
+   retro_time_t scan_start;
+   uint64_t scan_bytes;
+   size_t scan_files;
    unsigned status;
    uint8_t flags;
 } db_handle_t;
@@ -309,20 +401,32 @@ static void task_database_scan_console_output(const char *label, const char *db_
 }
 
 static int task_database_iterate_start(retro_task_t *task,
+      db_handle_t *_db,
       database_info_handle_t *db,
       const char *name)
 {
-   char msg[128];
+   char msg[192];
+   char rate[64];
    const char *basename_path = !string_is_empty(name)
          ? path_basename_nocompression(name) : "";
+   retro_time_t elapsed      = cpu_features_get_time_usec()
+         - _db->scan_start;
 
-   msg[0] = '\0';
+   msg[0]  = '\0';
+   rate[0] = '\0';
+
+   /* TODO/FIXME - localize */
+   if (_db->scan_files && elapsed > 0)
+      snprintf(rate, sizeof(rate), " (%.1f files/s, %.1f MB/s)",
+            _db->scan_files * 1000000.0 / elapsed,
+            _db->scan_bytes / (1.048576 * elapsed));
 
    if (!string_is_empty(basename_path))
       snprintf(msg, sizeof(msg),
-         STRING_REP_USIZE "/" STRING_REP_USIZE ": %s...\n",
+         STRING_REP_USIZE "/" STRING_REP_USIZE "%s: %s...\n",
          db->list_ptr + 1,
          (size_t)db->list->size,
+         rate,
          basename_path);
 
    if (!string_is_empty(msg))
@@ -348,7 +452,7 @@ static int task_database_iterate_start(retro_task_t *task,
 }
 
 static void task_database_cue_prune(database_info_handle_t *db,
-      const char *name)
+      const char *name, size_t start)
 {
    size_t i;
    char path[PATH_MAX_LENGTH];
@@ -362,7 +466,7 @@ static void task_database_cue_prune(database_info_handle_t *db,
 
    while (cue_next_file(fd, name, path, sizeof(path)))
    {
-      for (i = db->list_ptr; i < db->list->size; ++i)
+      for (i = start; i < db->list->size; ++i)
       {
          if (db->list->elems[i].data
                && string_is_equal(path, db->list->elems[i].data))
@@ -617,7 +721,8 @@ static void task_database_iterate_m3u(
    }
 }
 
-static void gdi_prune(database_info_handle_t *db, const char *name)
+static void gdi_prune(database_info_handle_t *db, const char *name,
+      size_t start)
 {
    size_t i;
    char path[PATH_MAX_LENGTH];
@@ -631,7 +736,7 @@ static void gdi_prune(database_info_handle_t *db, const char *name)
 
    while (gdi_next_file(fd, name, path, sizeof(path)))
    {
-      for (i = db->list_ptr; i < db->list->size; ++i)
+      for (i = start; i < db->list->size; ++i)
       {
          if (db->list->elems[i].data
                && string_is_equal(path, db->list->elems[i].data))
@@ -694,82 +799,596 @@ static enum msg_file_type extension_to_file_type(const char *ext)
    return FILE_TYPE_NONE;
 }
 
-static int task_database_iterate_playlist(
-      database_state_handle_t *db_state,
-      database_info_handle_t *db, const char *name)
+static void task_database_scan_cache_free(
+      database_scan_cache_entry_t **cache)
+{
+   size_t i, cap;
+   database_scan_cache_entry_t *map = *cache;
+
+   for (i = 0, cap = RHMAP_CAP(map); i != cap; i++)
+      if (RHMAP_KEY(map, i))
+         free(map[i].serial);
+
+   RHMAP_FREE(map);
+   *cache = NULL;
+}
+
+/* Read only, safe next to other readers */
+static bool task_database_scan_cache_find(
+      const database_scan_cache_entry_t *cache, const char *name,
+      database_scan_probe_t *probe)
+{
+   const database_scan_cache_entry_t *entry;
+   ptrdiff_t idx = RHMAP_IDX_STR(cache, name);
+
+   if (idx < 0)
+      return false;
+
+   entry = &cache[idx];
+   if (     entry->file_size != probe->file_size
+         || entry->mtime     != probe->mtime)
+      return false;
+
+   probe->size         = entry->size;
+   probe->archive_size = entry->archive_size;
+   probe->crc          = entry->crc;
+   probe->archive_crc  = entry->archive_crc;
+   probe->ret          = entry->ret;
+   probe->type         = entry->type;
+   probe->cached       = true;
+   strlcpy(probe->serial, entry->serial ? entry->serial : "",
+         sizeof(probe->serial));
+   return true;
+}
+
+static void task_database_scan_cache_add(
+      database_scan_cache_entry_t **cache, const char *name,
+      const database_scan_probe_t *probe)
+{
+   database_scan_cache_entry_t entry;
+   ptrdiff_t idx;
+   /* The RHMAP macros want a plain lvalue */
+   database_scan_cache_entry_t *map = *cache;
+
+   /* Fields are tab separated, one entry per line */
+   if (strpbrk(probe->serial, "\t\r\n") || strpbrk(name, "\r\n"))
+      return;
+
+   entry.file_size    = probe->file_size;
+   entry.mtime        = probe->mtime;
+   entry.size         = probe->size;
+   entry.archive_size = probe->archive_size;
+   entry.serial       = string_is_empty(probe->serial)
+         ? NULL : strdup(probe->serial);
+   entry.crc          = probe->crc;
+   entry.archive_crc  = probe->archive_crc;
+   entry.ret          = probe->ret;
+   entry.type         = probe->type;
+
+   if ((idx = RHMAP_IDX_STR(map, name)) >= 0)
+      free(map[idx].serial);
+   RHMAP_SET_STR(map, name, entry);
+   *cache = map;
+}
+
+static bool task_database_scan_cache_parse(char *line,
+      database_scan_cache_entry_t *entry, const char **name)
+{
+   unsigned i;
+   char *fields[9];
+   char *s = line;
+
+   for (i = 0; i < ARRAY_SIZE(fields); i++)
+   {
+      fields[i] = s;
+      if (!(s = strchr(s, '\t')))
+         return false;
+      *s++      = '\0';
+   }
+
+   if (string_is_empty(s))
+      return false;
+
+   *name               = s;
+   entry->file_size    = strtoll(fields[0], NULL, 10);
+   entry->mtime        = strtoll(fields[1], NULL, 10);
+   entry->type         = (enum database_type)strtoul(fields[2], NULL, 10);
+   entry->ret          = (int)strtol(fields[3], NULL, 10);
+   entry->crc          = (uint32_t)strtoul(fields[4], NULL, 16);
+   entry->archive_crc  = (uint32_t)strtoul(fields[5], NULL, 16);
+   entry->size         = strtoull(fields[6], NULL, 10);
+   entry->archive_size = strtoull(fields[7], NULL, 10);
+   entry->serial       = string_is_empty(fields[8])
+         ? NULL : strdup(fields[8]);
+   return true;
+}
+
+static database_scan_cache_entry_t *task_database_scan_cache_read(
+      const char *path)
+{
+   char *line;
+   unsigned version                   = 0;
+   unsigned long count                = 0;
+   unsigned long lines                = 0;
+   bool valid                         = false;
+   database_scan_cache_entry_t *cache = NULL;
+   RFILE *file                        = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return NULL;
+
+   if ((line = filestream_getline(file)))
+   {
+      valid = (sscanf(line, "content_scan_cache %u %lu",
+               &version, &count) == 2)
+            && (version == DATABASE_SCAN_CACHE_VERSION);
+      free(line);
+   }
+
+   while (valid && (line = filestream_getline(file)))
+   {
+      database_scan_cache_entry_t entry;
+      const char *name;
+
+      if (!*line && filestream_eof(file))
+      {
+         free(line);
+         break;
+      }
+
+      if ((valid = task_database_scan_cache_parse(line, &entry, &name)))
+      {
+         ptrdiff_t idx = RHMAP_IDX_STR(cache, name);
+         if (idx >= 0)
+            free(cache[idx].serial);
+         RHMAP_SET_STR(cache, name, entry);
+         lines++;
+      }
+      free(line);
+   }
+
+   filestream_close(file);
+
+   /* A short file was cut off while being written */
+   if (!valid || lines != count)
+   {
+      RARCH_WARN("[Scanner] Discarding invalid scan cache \"%s\".\n", path);
+      task_database_scan_cache_free(&cache);
+      return NULL;
+   }
+
+   RARCH_LOG("[Scanner] Loaded %lu entries from the scan cache.\n", count);
+   return cache;
+}
+
+static void task_database_scan_cache_write_entry(RFILE *file,
+      const char *name, const database_scan_cache_entry_t *entry)
 {
+   filestream_printf(file, STRING_REP_INT64 "\t" STRING_REP_INT64
+         "\t%u\t%d\t%08lX\t%08lX\t" STRING_REP_UINT64 "\t"
+         STRING_REP_UINT64 "\t%s\t%s\n",
+         entry->file_size, entry->mtime,
+         (unsigned)entry->type, entry->ret,
+         (unsigned long)entry->crc, (unsigned long)entry->archive_crc,
+         entry->size, entry->archive_size,
+         entry->serial ? entry->serial : "", name);
+}
+
+/* Whether an entry read at the start stays. Entries of files this
+ * scan looked at were replaced, and after a whole directory was
+ * scanned the ones under it that it didn't find are gone. */
+static bool task_database_scan_cache_keep(db_handle_t *db,
+      const char *name, size_t dir_len)
+{
+   if (RHMAP_IDX_STR(db->scan_cache_fresh, name) >= 0)
+      return false;
+   return !dir_len
+      || strncmp(name, db->fullpath, dir_len)
+      || (  !PATH_CHAR_IS_SLASH(name[dir_len])
+         && !PATH_CHAR_IS_SLASH(db->fullpath[dir_len - 1]));
+}
+
+static void task_database_scan_cache_write(db_handle_t *db)
+{
+   size_t i, cap;
+   char path[PATH_MAX_LENGTH];
+   RFILE *file;
+   unsigned long count = (unsigned long)RHMAP_LEN(db->scan_cache_fresh);
+   size_t dir_len      = 0;
+
+   if (     !count
+         || string_is_empty(db->playlist_directory))
+      return;
+
+   if (     (db->flags & DB_HANDLE_FLAG_IS_DIRECTORY)
+         && (db->flags & DB_HANDLE_FLAG_SCAN_COMPLETE)
+         && !string_is_empty(db->fullpath))
+      dir_len = strlen(db->fullpath);
+
+   for (i = 0, cap = RHMAP_CAP(db->scan_cache); i != cap; i++)
+      if (     RHMAP_KEY(db->scan_cache, i)
+            && task_database_scan_cache_keep(db,
+               RHMAP_KEY_STR(db->scan_cache, i), dir_len))
+         count++;
+
+   fill_pathname_join_special(path, db->playlist_directory,
+         FILE_PATH_CONTENT_SCAN_CACHE, sizeof(path));
+
+   if (!(file = filestream_open(path, RETRO_VFS_FILE_ACCESS_WRITE,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      RARCH_WARN("[Scanner] Failed to write scan cache \"%s\".\n", path);
+      return;
+   }
+
+   filestream_printf(file, "content_scan_cache %u %lu\n",
+         DATABASE_SCAN_CACHE_VERSION, count);
+
+   for (i = 0, cap = RHMAP_CAP(db->scan_cache); i != cap; i++)
+   {
+      const char *name = RHMAP_KEY_STR(db->scan_cache, i);
+      if (     RHMAP_KEY(db->scan_cache, i)
+            && task_database_scan_cache_keep(db, name, dir_len))
+         task_database_scan_cache_write_entry(file, name,
+               &db->scan_cache[i]);
+   }
+
+   for (i = 0, cap = RHMAP_CAP(db->scan_cache_fresh); i != cap; i++)
+      if (RHMAP_KEY(db->scan_cache_fresh, i))
+         task_database_scan_cache_write_entry(file,
+               RHMAP_KEY_STR(db->scan_cache_fresh, i),
+               &db->scan_cache_fresh[i]);
+
+   filestream_close(file);
+}
+
+/* Opens and hashes a file, or reads its serial, unless the cache
+ * has it. Touches nothing but 'probe', so it can run on any thread. */
+static void task_database_probe(const database_scan_cache_entry_t *cache,
+      const char *name, database_scan_probe_t *probe)
+{
+   probe->size         = 0;
+   probe->archive_size = 0;
+   probe->crc          = 0;
+   probe->archive_crc  = 0;
+   probe->serial[0]    = '\0';
+   probe->ret          = 1;
+   probe->cached       = false;
+   probe->stat_ok      = path_get_size_and_mtime(name,
+         &probe->file_size, &probe->mtime);
+
+   if (     probe->stat_ok
+         && task_database_scan_cache_find(cache, name, probe))
+      return;
+
    switch (extension_to_file_type(path_get_extension(name)))
    {
       case FILE_TYPE_COMPRESSED:
 #ifdef HAVE_COMPRESSION
-         db->type = DATABASE_TYPE_CRC_LOOKUP;
-         /* first check crc of archive itself */
-         return intfstream_file_get_crc_and_size(name,
-               0, INT64_MAX, &db_state->archive_crc, &db_state->archive_size);
+         probe->type         = DATABASE_TYPE_CRC_LOOKUP;
+         /* The archive lists the CRC of its first file, so only read
+          * the whole archive when it doesn't */
+         probe->crc          = file_archive_get_file_crc32_and_size(
+               name, &probe->size);
+         if (probe->crc)
+            probe->archive_size = (uint64_t)path_get_size(name);
+         else
+            probe->ret       = intfstream_file_get_crc_and_size(name,
+                  0, INT64_MAX, &probe->archive_crc,
+                  &probe->archive_size);
 #else
-         break;
+         probe->type         = DATABASE_TYPE_NONE;
+         probe->ret          = 0;
 #endif
+         break;
       case FILE_TYPE_CUE:
-         task_database_cue_prune(db, name);
-         db_state->serial[0] = '\0';
-         if (task_database_cue_get_serial(name, db_state->serial, sizeof(db_state->serial),&db_state->size))
-            db->type = DATABASE_TYPE_SERIAL_LOOKUP;
+         if (task_database_cue_get_serial(name, probe->serial, sizeof(probe->serial),&probe->size))
+            probe->type = DATABASE_TYPE_SERIAL_LOOKUP;
          else
          {
-            db->type = DATABASE_TYPE_CRC_LOOKUP;
-            db_state->serial[0] = '\0';
+            probe->type      = DATABASE_TYPE_CRC_LOOKUP;
+            probe->serial[0] = '\0';
             RARCH_DBG("[Scanner] Cue file serial not detected, fallback to crc\n");
-            return task_database_cue_get_crc_and_size(name, &db_state->crc, &db_state->size);
+            probe->ret       = task_database_cue_get_crc_and_size(name, &probe->crc, &probe->size);
          }
          break;
       case FILE_TYPE_GDI:
-         gdi_prune(db, name);
-         db_state->serial[0] = '\0';
-         if (task_database_gdi_get_serial(name, db_state->serial, sizeof(db_state->serial),&db_state->size))
-            db->type = DATABASE_TYPE_SERIAL_LOOKUP;
+         if (task_database_gdi_get_serial(name, probe->serial, sizeof(probe->serial),&probe->size))
+            probe->type = DATABASE_TYPE_SERIAL_LOOKUP;
          else
          {
-            db->type = DATABASE_TYPE_CRC_LOOKUP;
-            db_state->serial[0] = '\0';
+            probe->type      = DATABASE_TYPE_CRC_LOOKUP;
+            probe->serial[0] = '\0';
             RARCH_DBG("[Scanner] GDI file serial not detected, fallback to crc\n");
-            return task_database_gdi_get_crc_and_size(name, &db_state->crc, &db_state->size);
+            probe->ret       = task_database_gdi_get_crc_and_size(name, &probe->crc, &probe->size);
          }
          break;
       /* Consider WBFS, RVZ and WIA files similar to ISO files. */
       case FILE_TYPE_WBFS:
       case FILE_TYPE_RVZ:
       case FILE_TYPE_WIA:
-         db_state->serial[0] = '\0';
-         intfstream_file_get_serial(name, 0, INT64_MAX, db_state->serial, sizeof(db_state->serial),&db_state->size);
-         db->type            =  DATABASE_TYPE_SERIAL_LOOKUP;
+         intfstream_file_get_serial(name, 0, INT64_MAX, probe->serial, sizeof(probe->serial),&probe->size);
+         probe->type         = DATABASE_TYPE_SERIAL_LOOKUP;
          break;
       case FILE_TYPE_ISO:
-         db_state->serial[0] = '\0';
-         intfstream_file_get_serial(name, 0, INT64_MAX, db_state->serial, sizeof(db_state->serial),&db_state->size);
-         db->type            =  DATABASE_TYPE_SERIAL_LOOKUP_SIZEHINT;
+         intfstream_file_get_serial(name, 0, INT64_MAX, probe->serial, sizeof(probe->serial),&probe->size);
+         probe->type         = DATABASE_TYPE_SERIAL_LOOKUP_SIZEHINT;
          break;
       case FILE_TYPE_CHD:
-         db_state->serial[0] = '\0';
-         if (task_database_chd_get_serial(name, db_state->serial, sizeof(db_state->serial),&db_state->size))
-            db->type         = DATABASE_TYPE_SERIAL_LOOKUP;
+         if (task_database_chd_get_serial(name, probe->serial, sizeof(probe->serial),&probe->size))
+            probe->type      = DATABASE_TYPE_SERIAL_LOOKUP;
          else
          {
-            db->type         = DATABASE_TYPE_CRC_LOOKUP;
-            db_state->serial[0] = '\0';
+            probe->type      = DATABASE_TYPE_CRC_LOOKUP;
+            probe->serial[0] = '\0';
             RARCH_DBG("[Scanner] CHD file serial not detected, fallback to crc\n");
-            return task_database_chd_get_crc_and_size(name, &db_state->crc, &db_state->size);
+            probe->ret       = task_database_chd_get_crc_and_size(name, &probe->crc, &probe->size);
          }
          break;
       case FILE_TYPE_LUTRO:
-         db->type            = DATABASE_TYPE_ITERATE_LUTRO;
+         probe->type         = DATABASE_TYPE_ITERATE_LUTRO;
          break;
       default:
-         db_state->serial[0] = '\0';
-         db->type            = DATABASE_TYPE_CRC_LOOKUP;
-         return intfstream_file_get_crc_and_size(name, 0, INT64_MAX, &db_state->crc, &db_state->size);
+         probe->type         = DATABASE_TYPE_CRC_LOOKUP;
+         probe->ret          = intfstream_file_get_crc_and_size(name, 0, INT64_MAX, &probe->crc, &probe->size);
+         break;
    }
+}
 
-   return 1;
+/* Drops the files that a CUE or GDI sheet of the list refers to,
+ * before any file is probed. Each sheet only prunes from itself on,
+ * and a sheet pruned by an earlier one doesn't prune. */
+static void task_database_prune(database_info_handle_t *db)
+{
+   size_t i;
+
+   for (i = 0; i < db->list->size; i++)
+   {
+      const char *name = db->list->elems[i].data;
+
+      if (!name)
+         continue;
+
+      switch (extension_to_file_type(path_get_extension(name)))
+      {
+         case FILE_TYPE_CUE:
+            task_database_cue_prune(db, name, i);
+            break;
+         case FILE_TYPE_GDI:
+            gdi_prune(db, name, i);
+            break;
+         default:
+            break;
+      }
+   }
+}
+
+#ifdef HAVE_THREADS
+static void task_database_scan_run(database_scan_pool_t *pool,
+      database_scan_slot_t *slot)
+{
+   slot->state = DATABASE_SCAN_SLOT_RUNNING;
+   slock_unlock(pool->lock);
+   task_database_probe(pool->cache, slot->name, &slot->probe);
+   slock_lock(pool->lock);
+   slot->state = DATABASE_SCAN_SLOT_DONE;
+   scond_broadcast(pool->cond);
+}
+
+static void task_database_scan_worker(void *data)
+{
+   database_scan_pool_t *pool = (database_scan_pool_t*)data;
+
+   slock_lock(pool->lock);
+
+   while (!pool->quit)
+   {
+      unsigned i;
+      database_scan_slot_t *slot = NULL;
+
+      /* Oldest entry first, the task waits on it */
+      for (i = 0; i < DATABASE_SCAN_AHEAD; i++)
+      {
+         database_scan_slot_t *cur = &pool->slots[i];
+         if (     (cur->state == DATABASE_SCAN_SLOT_QUEUED)
+               && (!slot || cur->index < slot->index))
+            slot = cur;
+      }
+
+      if (slot)
+         task_database_scan_run(pool, slot);
+      else
+         scond_wait(pool->cond, pool->lock);
+   }
+
+   slock_unlock(pool->lock);
+}
+
+static void task_database_scan_pool_free(database_scan_pool_t *pool)
+{
+   unsigned i;
+
+   if (!pool)
+      return;
+
+   slock_lock(pool->lock);
+   pool->quit = true;
+   scond_broadcast(pool->cond);
+   slock_unlock(pool->lock);
+
+   for (i = 0; i < pool->workers; i++)
+      sthread_join(pool->threads[i]);
+
+   for (i = 0; i < DATABASE_SCAN_AHEAD; i++)
+      free(pool->slots[i].name);
+
+   scond_free(pool->cond);
+   slock_free(pool->lock);
+   free(pool);
+}
+
+static database_scan_pool_t *task_database_scan_pool_new(
+      const database_scan_cache_entry_t *cache)
+{
+   unsigned workers           = cpu_features_get_core_amount();
+   database_scan_pool_t *pool = (database_scan_pool_t*)
+      calloc(1, sizeof(*pool));
+
+   if (!pool)
+      return NULL;
+
+   /* Probing waits on the disk as much as on the CPU, so keep a
+    * second worker even on one core */
+   if (workers < 2)
+      workers = 2;
+   else if (workers > DATABASE_SCAN_MAX_WORKERS)
+      workers = DATABASE_SCAN_MAX_WORKERS;
+
+   pool->cache = cache;
+
+   if (     !(pool->lock = slock_new())
+         || !(pool->cond = scond_new()))
+      goto error;
+
+   for (pool->workers = 0; pool->workers < workers; pool->workers++)
+      if (!(pool->threads[pool->workers] = sthread_create(
+                  task_database_scan_worker, pool)))
+         break;
+
+   if (!pool->workers)
+      goto error;
+
+   return pool;
+
+error:
+   task_database_scan_pool_free(pool);
+   return NULL;
+}
+
+/* Queues the list entries up to DATABASE_SCAN_AHEAD past 'current' */
+static void task_database_scan_feed(database_scan_pool_t *pool,
+      database_info_handle_t *db, size_t current)
+{
+   bool queued = false;
+
+   if (pool->next < current)
+      pool->next = current;
+
+   slock_lock(pool->lock);
+
+   for (; pool->next < current + DATABASE_SCAN_AHEAD
+         && pool->next < db->list->size; pool->next++)
+   {
+      const char *name = db->list->elems[pool->next].data;
+      database_scan_slot_t *slot;
+
+      /* Pruned, and archive members taken from the archive's
+       * own listing */
+      if (string_is_empty(name) || path_contains_compressed_file(name))
+         continue;
+
+      slot = &pool->slots[pool->next % DATABASE_SCAN_AHEAD];
+      if (slot->state != DATABASE_SCAN_SLOT_FREE)
+         break;
+
+      if (!(slot->name = strdup(name)))
+         break;
+      slot->index = pool->next;
+      slot->state = DATABASE_SCAN_SLOT_QUEUED;
+      queued      = true;
+   }
+
+   if (queued)
+      scond_broadcast(pool->cond);
+   slock_unlock(pool->lock);
+}
+
+/* The probed slot of list entry 'index', probing it here if no
+ * worker has taken it yet; NULL if it was never queued */
+static database_scan_slot_t *task_database_scan_wait(
+      database_scan_pool_t *pool, size_t index)
+{
+   database_scan_slot_t *slot = &pool->slots[index % DATABASE_SCAN_AHEAD];
+
+   slock_lock(pool->lock);
+
+   if (slot->state == DATABASE_SCAN_SLOT_FREE || slot->index != index)
+   {
+      slock_unlock(pool->lock);
+      return NULL;
+   }
+
+   if (slot->state == DATABASE_SCAN_SLOT_QUEUED)
+      task_database_scan_run(pool, slot);
+
+   while (slot->state != DATABASE_SCAN_SLOT_DONE)
+      scond_wait(pool->cond, pool->lock);
+
+   slock_unlock(pool->lock);
+   return slot;
+}
+
+static void task_database_scan_release(database_scan_pool_t *pool,
+      database_scan_slot_t *slot)
+{
+   slock_lock(pool->lock);
+   free(slot->name);
+   slot->name  = NULL;
+   slot->state = DATABASE_SCAN_SLOT_FREE;
+   slock_unlock(pool->lock);
+}
+#endif
+
+static int task_database_iterate_playlist(
+      db_handle_t *_db,
+      database_state_handle_t *db_state,
+      database_info_handle_t *db, const char *name)
+{
+   int ret;
+   database_scan_probe_t local;
+   database_scan_probe_t *probe = NULL;
+#ifdef HAVE_THREADS
+   database_scan_slot_t *slot   = NULL;
+
+   if (     _db->scan_pool
+         && (slot = task_database_scan_wait(_db->scan_pool, db->list_ptr)))
+      probe = &slot->probe;
+#endif
+
+   if (!probe)
+   {
+      probe = &local;
+      task_database_probe(_db->scan_cache, name, probe);
+   }
+
+   db->type               = probe->type;
+   db_state->crc          = probe->crc;
+   db_state->archive_crc  = probe->archive_crc;
+   db_state->size         = probe->size;
+   db_state->archive_size = probe->archive_size;
+   strlcpy(db_state->serial, probe->serial, sizeof(db_state->serial));
+   ret                    = probe->ret;
+
+   /* Failures aren't kept, they may not last */
+   if (probe->stat_ok && probe->ret)
+      task_database_scan_cache_add(&_db->scan_cache_fresh, name, probe);
+
+   if (!probe->cached)
+   {
+      _db->scan_files++;
+      _db->scan_bytes    += probe->archive_size
+         ? probe->archive_size : probe->size;
+   }
+
+#ifdef HAVE_THREADS
+   if (slot)
+      task_database_scan_release(_db->scan_pool, slot);
+   if (_db->scan_pool)
+      task_database_scan_feed(_db->scan_pool, db, db->list_ptr + 1);
+#endif
+
+   return ret;
 }
 
 static int database_info_list_iterate_end_no_match(
@@ -838,8 +1457,12 @@ static int database_info_list_iterate_end_no_match(
    return 0;
 }
 
+/* Entries matching @query. With @crcs or @serial given, which the
+ * query has to require, the key index of the database narrows down
+ * the entries that are read. */
 static int database_info_list_iterate_new(database_state_handle_t *db_state,
-      const char *query)
+      const char *query, const uint32_t *crcs, size_t crc_count,
+      const char *serial)
 {
    const char *new_database = database_info_get_current_name(db_state);
 
@@ -853,7 +1476,14 @@ static int database_info_list_iterate_new(database_state_handle_t *db_state,
       database_info_list_free(db_state->info);
       free(db_state->info);
    }
-   db_state->info = database_info_list_new(new_database, query);
+   if (crc_count)
+      db_state->info = database_info_list_new_crc(new_database, query,
+            crcs, crc_count);
+   else if (serial)
+      db_state->info = database_info_list_new_serial(new_database, query,
+            serial);
+   else
+      db_state->info = database_info_list_new(new_database, query);
    return 0;
 }
 
@@ -1015,13 +1645,13 @@ static void task_database_fill_db_min_max(database_state_handle_t *db_state)
    query[0] = '\0';
 
    snprintf(query, sizeof(query), "{size:min(0)}");
-   database_info_list_iterate_new(db_state, query);
+   database_info_list_iterate_new(db_state, query, NULL, 0, NULL);
 
    if (db_state->info->count > 0)
    {
       db_state->min_sizes[db_state->list_index] = db_state->info->list[db_state->info->count-1].size;
       snprintf(query, sizeof(query), "{size:max(0)}");
-      database_info_list_iterate_new(db_state, query);
+      database_info_list_iterate_new(db_state, query, NULL, 0, NULL);
 
       if (db_state->info->count > 0)
       {
@@ -1128,6 +1758,8 @@ static int task_database_iterate_crc_lookup(
    if (db_state->entry_index == 0)
    {
       char query[50];
+      uint32_t crcs[2];
+      size_t crc_count = 0;
 
       query[0] = '\0';
 
@@ -1154,7 +1786,11 @@ static int task_database_iterate_crc_lookup(
             "{crc:or(b\"%08lX\",b\"%08lX\")}",
             (unsigned long)db_state->crc, (unsigned long)db_state->archive_crc);
 
-      database_info_list_iterate_new(db_state, query);
+      crcs[crc_count++] = db_state->crc;
+      if (db_state->archive_crc && db_state->archive_crc != db_state->crc)
+         crcs[crc_count++] = db_state->archive_crc;
+
+      database_info_list_iterate_new(db_state, query, crcs, crc_count, NULL);
    }
 
    if (db_state->info)
@@ -1354,7 +1990,8 @@ static int task_database_iterate_serial_lookup(
 #ifdef DEBUG
       RARCH_DBG("[Scanner] Serial orig / decoded: \"%s\" / %s \n", db_state->serial, serial_buf);
 #endif
-      database_info_list_iterate_new(db_state, query);
+      database_info_list_iterate_new(db_state, query, NULL, 0,
+            db_state->serial);
 
       free(serial_buf);
    }
@@ -1416,7 +2053,7 @@ static int task_database_iterate(
    switch (db->type)
    {
       case DATABASE_TYPE_ITERATE:
-         return task_database_iterate_playlist(db_state, db, name);
+         return task_database_iterate_playlist(_db, db_state, db, name);
       case DATABASE_TYPE_ITERATE_ARCHIVE:
 #ifdef HAVE_COMPRESSION
          return task_database_iterate_crc_lookup(
@@ -1647,6 +2284,29 @@ static void task_database_handler(retro_task_t *task)
             RARCH_LOG("[Scanner] %s\"%s\"...\n", msg_hash_to_str(MSG_MANUAL_CONTENT_SCAN_START), db->fullpath);
             if (retroarch_override_setting_is_set(RARCH_OVERRIDE_SETTING_DATABASE_SCAN, NULL))
                printf("%s\"%s\"...\n", msg_hash_to_str(MSG_MANUAL_CONTENT_SCAN_START), db->fullpath);
+
+            if (!string_is_empty(db->playlist_directory))
+            {
+               char cache_path[PATH_MAX_LENGTH];
+               fill_pathname_join_special(cache_path,
+                     db->playlist_directory,
+                     FILE_PATH_CONTENT_SCAN_CACHE, sizeof(cache_path));
+               db->scan_cache = task_database_scan_cache_read(cache_path);
+            }
+
+            if (dbinfo->list)
+            {
+               /* Pruning first lets sheets and the files they
+                * refer to be probed in any order */
+               task_database_prune(dbinfo);
+#ifdef HAVE_THREADS
+               if (     dbinfo->list->size > 1
+                     && (db->scan_pool = task_database_scan_pool_new(
+                           db->scan_cache)))
+                  task_database_scan_feed(db->scan_pool, dbinfo, 0);
+#endif
+            }
+            db->scan_start = cpu_features_get_time_usec();
          }
          dbinfo->status = DATABASE_STATUS_ITERATE_START;
          break;
@@ -1665,7 +2325,7 @@ static void task_database_handler(retro_task_t *task)
          task_database_cleanup_state(dbstate);
          dbstate->list_index  = 0;
          dbstate->entry_index = 0;
-         task_database_iterate_start(task, dbinfo, name);
+         task_database_iterate_start(task, db, dbinfo, name);
          break;
       case DATABASE_STATUS_ITERATE:
          {
@@ -1736,6 +2396,8 @@ static void task_database_handler(retro_task_t *task)
                }
             }
 
+            db->flags |= DB_HANDLE_FLAG_SCAN_COMPLETE;
+
             /* Batch update all playlists with accumulated results */
             if (db->scan_results.count > 0)
                scan_results_batch_update_playlists(&db->scan_results, db);
@@ -1768,6 +2430,13 @@ task_finished:
 
    if (db)
    {
+#ifdef HAVE_THREADS
+      task_database_scan_pool_free(db->scan_pool);
+      db->scan_pool = NULL;
+#endif
+      task_database_scan_cache_write(db);
+      task_database_scan_cache_free(&db->scan_cache);
+      task_database_scan_cache_free(&db->scan_cache_fresh);
       if (!string_is_empty(db->playlist_directory))
          free(db->playlist_directory);
       if (!string_is_empty(db->content_database_path))
@@ -1813,6 +2482,7 @@ bool task_push_dbscan(
       goto error;
 
    t->handler                              = task_database_handler;
+   t->priority                             = TASK_PRIORITY_BACKGROUND;
    t->state                                = db;
    t->callback                             = cb;
    t->title                                = strdup(msg_hash_to_str(
@@ -1960,6 +2630,7 @@ end:
    if (menu_st->driver_ctx->environ_cb)
       menu_st->driver_ctx->environ_cb(MENU_ENVIRON_RESET_HORIZONTAL_LIST,
             NULL, menu_st->userdata);
+   menu_explore_rebuild();
 #endif
 }
 
@@ -2397,6 +3068,7 @@ bool task_push_manual_content_scan(
 
    /* > Configure task */
    task->handler                 = task_manual_content_scan_handler;
+   task->priority                = TASK_PRIORITY_BACKGROUND;
    task->state                   = manual_scan;
    task->title                   = strdup(task_title);
    task->progress                = 0;
@@ -22,8 +22,11 @@
 #include <net/net_compat.h>
 #include <retro_timers.h>
 #include <retro_miscellaneous.h>
+#include <features/features_cpu.h>
 
 #ifdef RARCH_INTERNAL
+#include "../configuration.h"
+#include "../verbosity.h"
 #include "../gfx/video_display_server.h"
 #endif
 #include "task_file_transfer.h"
@@ -46,6 +49,7 @@ struct http_handle
       struct http_connection_t *handle;
       transfer_cb_t  cb;
    } connection;
+   retro_time_t start;
    enum http_status_enum status;
    bool error;
    char connection_url[NAME_MAX_LENGTH];
@@ -196,6 +200,20 @@ task_finished:
          if (!mute && net_http_error(http->handle))
             task_set_error(task, strldup("Download failed.",
                sizeof("Download failed.")));
+#ifdef RARCH_INTERNAL
+         else if (!net_http_error(http->handle))
+         {
+            retro_time_t elapsed = cpu_features_get_time_usec()
+               - http->start;
+            unsigned msec        = (unsigned)(elapsed / 1000);
+
+            RARCH_LOG("[HTTP] Downloaded %u bytes from \"%s\" in %u ms (%u KB/s).\n",
+                  (unsigned)_len, http->connection_url, msec,
+                  elapsed > 0
+                  ? (unsigned)((uint64_t)_len * 1000000 / 1024 / elapsed)
+                  : 0);
+         }
+#endif
       }
       net_http_delete(http->handle);
    }
@@ -275,6 +293,7 @@ static void *task_push_http_transfer_generic(
    http->handle              = NULL;
    http->connection.handle   = conn;
    http->connection.cb       = &cb_http_conn_default;
+   http->start               = cpu_features_get_time_usec();
    http->status              = HTTP_STATUS_CONNECTION_TRANSFER;
    http->error               = false;
    http->connection_url[0]   = '\0';
@@ -292,6 +311,12 @@ static void *task_push_http_transfer_generic(
    t->user_data            = user_data;
    t->progress             = -1;
    t->flags               |=  RETRO_TASK_FLG_ALTERNATIVE_LOOK;
+#ifdef RARCH_INTERNAL
+   /* Transfers only touch their own connection, and the connection
+    * pool and DNS cache are locked, so several can run at once */
+   t->concurrency          = (uint8_t)
+      config_get_ptr()->uints.network_http_concurrent_downloads;
+#endif
    if (mute)
       t->flags            |=  RETRO_TASK_FLG_MUTE;
    else
@@ -18,6 +18,7 @@
 #include <string.h>
 
 #include <file/nbio.h>
+#include <file/file_path.h>
 #include <formats/image.h>
 #include <compat/strl.h>
 #include <string/stdstring.h>
@@ -28,6 +29,7 @@
 #include "tasks_internal.h"
 
 #include "../configuration.h"
+#include "../verbosity.h"
 
 enum image_status_enum
 {
@@ -51,6 +53,7 @@ struct nbio_image_handle
    transfer_cb_t  cb;
    struct texture_image ti; /* ptr alignment */
    size_t size;
+   retro_time_t decode_start;
    int processing_final_state;
    unsigned frame_duration;
    unsigned upscale_threshold;
@@ -214,6 +217,7 @@ static int cb_nbio_image_thumbnail(void *data, size_t len)
 
    /* Set image size */
    image->size                     = len;
+   image->decode_start             = cpu_features_get_time_usec();
 
    /* Set task iteration duration */
    if (settings)
@@ -339,6 +343,10 @@ bool task_image_load_handler(retro_task_t *task)
    {
       struct texture_image *img = (struct texture_image*)malloc(sizeof(struct texture_image));
 
+      RARCH_DBG("[Image] Decoded \"%s\" (%ux%u) in %.2f ms.\n",
+            path_basename(nbio->path), image->ti.width, image->ti.height,
+            (cpu_features_get_time_usec() - image->decode_start) / 1000.0);
+
       if (img)
       {
          /* Upscale image, if required */
@@ -433,6 +441,7 @@ bool task_push_image_load(const char *fullpath,
    image->processing_final_state     = 0;
    image->frame_duration             = 0;
    image->size                       = 0;
+   image->decode_start               = 0;
    image->upscale_threshold          = upscale_threshold;
    image->handle                     = NULL;
 
@@ -465,6 +474,7 @@ bool task_push_image_load(const char *fullpath,
 
    t->state           = nbio;
    t->handler         = task_file_load_handler;
+   t->priority        = TASK_PRIORITY_LATENCY;
    t->cleanup         = task_image_load_free;
    t->callback        = cb;
    t->user_data       = user_data;
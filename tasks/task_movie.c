@@ -25,6 +25,7 @@
 #include <file/file_path.h>
 #include <streams/file_stream.h>
 #include <retro_endianness.h>
+#include <features/features_cpu.h>
 
 #ifdef _WIN32
 #include <direct.h>
@@ -53,21 +54,122 @@
 #define REPLAY_DEFAULT_COMMIT_INTERVAL 4
 #define REPLAY_DEFAULT_COMMIT_THRESHOLD 2
 
-/* Superblock and block sizes for incremental savestates. */
-#define DEFAULT_SUPERBLOCK_SIZE 16  /* measured in blocks */
-#define DEFAULT_BLOCK_SIZE      16384 /* measured in bytes  */
-
-#define SMALL_STATE_THRESHOLD (1<<20) /* states < 1MB are "small" and are tuned differently */
-#define SMALL_SUPERBLOCK_SIZE 16  /* measured in blocks */
-#define SMALL_BLOCK_SIZE      128 /* measured in bytes  */
-
 #endif
 
 /* Forward declaration */
 bool content_load_state_in_progress(void* data);
 
+/* Frames one run of the index task reads */
+#define BSV_MOVIE_INDEX_TASK_FRAMES 4096
+
+struct bsv_movie_index_task_state
+{
+   struct bsv_movie_index index;
+   intfstream_t *file;
+   /* Only compared against; the movie may be gone by the callback */
+   bsv_movie_t *movie;
+   int64_t identifier;
+   int64_t pos;
+   uint32_t version;
+};
+
 /* Private functions */
 
+static void task_bsv_movie_index_handler(retro_task_t *task)
+{
+   struct bsv_movie_index_task_state *state =
+      (struct bsv_movie_index_task_state*)task->state;
+
+   if (     !(task_get_flags(task) & RETRO_TASK_FLG_CANCELLED)
+         && !bsv_movie_index_scan(&state->index, state->file,
+            state->version, &state->pos, BSV_MOVIE_INDEX_TASK_FRAMES))
+      return;
+
+   task_set_progress(task, 100);
+   task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
+}
+
+static void bsv_movie_index_task_cb(retro_task_t *task,
+      void *task_data, void *user_data, const char *error)
+{
+   struct bsv_movie_index_task_state *state =
+      (struct bsv_movie_index_task_state*)task->state;
+   input_driver_state_t *input_st = input_state_get_ptr();
+   bsv_movie_t *movie             = state->movie;
+
+   if (task_get_flags(task) & RETRO_TASK_FLG_CANCELLED)
+      return;
+   if (     movie != input_st->bsv_movie_state_handle
+         && movie != input_st->bsv_movie_state_next_handle)
+      return;
+   if (movie->identifier != state->identifier || movie->index_ready)
+      return;
+
+   bsv_movie_index_free(&movie->index);
+   movie->index       = state->index;
+   movie->index_ready = true;
+   memset(&state->index, 0, sizeof(state->index));
+   RARCH_LOG("[Replay] Indexed %u frames.\n", (unsigned)movie->index.frames);
+}
+
+static void task_bsv_movie_index_cleanup(retro_task_t *task)
+{
+   struct bsv_movie_index_task_state *state =
+      (struct bsv_movie_index_task_state*)task->state;
+
+   if (state)
+   {
+      bsv_movie_index_free(&state->index);
+      if (state->file)
+      {
+         intfstream_close(state->file);
+         free(state->file);
+      }
+      free(state);
+   }
+   task->state = NULL;
+}
+
+/* Indexes a replay without one from a stream of its own, a few frames
+ * per run, so the first seeks need not wait for it */
+static bool task_push_bsv_movie_index(bsv_movie_t *handle, const char *path)
+{
+   retro_task_t *task;
+   struct bsv_movie_index_task_state *state =
+      (struct bsv_movie_index_task_state*)calloc(1, sizeof(*state));
+
+   if (!state)
+      return false;
+
+   state->movie      = handle;
+   state->identifier = handle->identifier;
+   state->pos        = handle->min_file_pos;
+   state->version    = handle->version;
+   state->file       = intfstream_open_file(path,
+         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!state->file || !(task = task_init()))
+   {
+      if (state->file)
+      {
+         intfstream_close(state->file);
+         free(state->file);
+      }
+      free(state);
+      return false;
+   }
+
+   task->handler  = task_bsv_movie_index_handler;
+   task->callback = bsv_movie_index_task_cb;
+   task->cleanup  = task_bsv_movie_index_cleanup;
+   task->state    = state;
+   task->flags   |= RETRO_TASK_FLG_MUTE;
+
+   task_queue_push(task);
+
+   return true;
+}
+
 static bool bsv_movie_init_playback(bsv_movie_t *handle, const char *path)
 {
    int64_t *identifier_loc;
@@ -109,6 +211,9 @@ static bool bsv_movie_init_playback(bsv_movie_t *handle, const char *path)
    handle->identifier = swap_if_big64(*identifier_loc);
 
    handle->min_file_pos = header_size + state_size;
+   /* Files without an index are indexed in the background */
+   if (vsn > 0 && !bsv_movie_index_load(handle))
+      task_push_bsv_movie_index(handle, path);
    return bsv_movie_reset_playback(handle);
 }
 
@@ -139,6 +244,8 @@ static bool bsv_movie_init_record(
 
    handle->file             = file;
    handle->version          = REPLAY_FORMAT_VERSION;
+   /* Kept as the frames are written */
+   handle->index_ready      = true;
 #ifdef HAVE_STATESTREAM
    handle->commit_interval  = REPLAY_DEFAULT_COMMIT_INTERVAL;
    handle->commit_threshold = REPLAY_DEFAULT_COMMIT_THRESHOLD;
@@ -162,9 +269,9 @@ static bool bsv_movie_init_record(
    info_size                = core_serialize_size();
    state_size               = (unsigned)info_size;
 #ifdef HAVE_STATESTREAM
-   is_small                 = info_size < SMALL_STATE_THRESHOLD;
-   superblock_size          = is_small ? SMALL_SUPERBLOCK_SIZE : DEFAULT_SUPERBLOCK_SIZE;
-   block_size               = is_small ? SMALL_BLOCK_SIZE : DEFAULT_BLOCK_SIZE;
+   is_small                 = info_size < STATE_STORE_SMALL_STATE_THRESHOLD;
+   superblock_size          = STATE_STORE_SUPERBLOCK_SIZE;
+   block_size               = is_small ? STATE_STORE_SMALL_BLOCK_SIZE : STATE_STORE_BLOCK_SIZE;
 #endif
    header[REPLAY_HEADER_STATE_SIZE_INDEX]      = 0; /* Will fill this in later */
    header[REPLAY_HEADER_FRAME_COUNT_INDEX]     = 0;
@@ -184,27 +291,37 @@ static bool bsv_movie_init_record(
    intfstream_write(handle->file, header, REPLAY_HEADER_LEN_BYTES);
 
 #ifdef HAVE_STATESTREAM
-   handle->superblocks      = uint32s_index_new(superblock_size, handle->commit_interval, handle->commit_threshold);
-   handle->blocks           = uint32s_index_new(block_size/4, handle->commit_interval, handle->commit_threshold);
+   if (!state_store_init(&handle->store, block_size, superblock_size,
+            handle->commit_interval, handle->commit_threshold))
+      return false;
+   /* Leave a core for the emulation thread */
+   state_store_set_threads(&handle->store,
+         cpu_features_get_core_amount() - 1);
 #endif
    if (state_size)
-      return bsv_movie_reset_recording(handle);
-   
-   handle->min_file_pos = sizeof(header);
+   {
+      if (!bsv_movie_reset_recording(handle))
+         return false;
+   }
+   else
+      handle->min_file_pos = sizeof(header);
 
+   /* Frames from here on are written in the background */
+   bsv_movie_writer_start(handle);
    return true;
 }
 
 void bsv_movie_free(bsv_movie_t *handle)
 {
+   bsv_movie_writer_stop(handle);
    intfstream_close(handle->file);
    free(handle->file);
 
    free(handle->frame_pos);
+   bsv_movie_index_free(&handle->index);
 
 #ifdef HAVE_STATESTREAM
-   uint32s_index_free(handle->superblocks);
-   uint32s_index_free(handle->blocks);
+   state_store_deinit(&handle->store);
    free(handle->superblock_seq);
 #endif
    if (handle->last_save)
@@ -379,9 +496,9 @@ bool movie_stop_playback(input_driver_state_t *input_st)
 #ifdef HAVE_STATESTREAM
 #if DEBUG
    RARCH_DBG("[Replay] superblock histogram\n");
-   uint32s_index_print_count_data(input_st->bsv_movie_state_handle->superblocks);
+   uint32s_index_print_count_data(input_st->bsv_movie_state_handle->store.superblocks);
    RARCH_DBG("[Replay] block histogram\n");
-   uint32s_index_print_count_data(input_st->bsv_movie_state_handle->blocks);
+   uint32s_index_print_count_data(input_st->bsv_movie_state_handle->store.blocks);
 #endif
 #endif
    _msg = msg_hash_to_str(MSG_MOVIE_PLAYBACK_ENDED);
@@ -410,12 +527,14 @@ bool movie_stop_record(input_driver_state_t *input_st)
 #ifdef HAVE_STATESTREAM
 #if DEBUG
    RARCH_DBG("[Replay] superblock histogram\n");
-   uint32s_index_print_count_data(movie->superblocks);
+   uint32s_index_print_count_data(movie->store.superblocks);
    RARCH_DBG("[Replay] block histogram\n");
-   uint32s_index_print_count_data(movie->blocks);
+   uint32s_index_print_count_data(movie->store.blocks);
 #endif
 #endif
    frame_count = swap_if_big32(movie->frame_counter);
+   bsv_movie_sync(movie);
+   bsv_movie_index_save(movie);
    intfstream_seek(movie->file, REPLAY_HEADER_FRAME_COUNT_INDEX*sizeof(uint32_t), SEEK_SET);
    intfstream_write(movie->file, &frame_count, sizeof(uint32_t));
    bsv_movie_deinit_full(input_st);
@@ -113,7 +113,7 @@ static bool find_content_by_crc(playlist_config_t *playlist_config,
       if (!(playlist = playlist_init(playlist_config)))
          continue;
 
-      for (j = 0; j < playlist_get_size(playlist); j++)
+      for (j = 0; playlist_find_crc32(playlist, crc_ident, j, &j); j++)
       {
          const struct playlist_entry *entry = NULL;
 
@@ -121,8 +121,7 @@ static bool find_content_by_crc(playlist_config_t *playlist_config,
          if (!entry)
             continue;
 
-         if (string_is_equal(entry->crc32, crc_ident)
-               && !string_is_empty(entry->path))
+         if (!string_is_empty(entry->path))
          {
             if (!string_list_append(paths, entry->path, attr))
             {
@@ -0,0 +1,175 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <streams/file_stream.h>
+
+#include "tasks_internal.h"
+
+#ifdef HAVE_CONFIG_H
+#include "../config.h"
+#endif
+
+#if defined(HAVE_NETWORKING) && defined(HAVE_GGPO)
+
+#define XXH_INLINE_ALL
+#include <xxHash/xxhash.h>
+
+#include "../network/netplay/netplay.h"
+#include "../verbosity.h"
+
+/* Same granularity as the block-level savestate deltas, so the reports of
+ * both peers line up with what netplay would have resent. */
+#define NETPLAY_GGPO_DESYNC_BLOCK_SIZE 4096
+
+static bool task_netplay_ggpo_desync_write_state(
+      const struct netplay_ggpo_desync_dump *dump,
+      const char *suffix, const uint8_t *data, size_t size)
+{
+   char path[PATH_MAX_LENGTH];
+   int path_len = snprintf(path, sizeof(path), "%s%s.state",
+         dump->path, suffix);
+
+   if (path_len < 0 || (size_t)path_len >= sizeof(path))
+   {
+      RARCH_WARN("[GGPO] Desync state path is too long, skipping.\n");
+      return false;
+   }
+   if (filestream_write_file(path, data, (int64_t)size))
+      return true;
+
+   RARCH_WARN("[GGPO] Could not write desync state \"%s\".\n", path);
+   return false;
+}
+
+/* One line per block: offset, XXH3 of the block, and a mark where it
+ * differs from the same block at the base frame. Diffing the reports of
+ * both peers narrows the desync down to the blocks that diverged. */
+static void task_netplay_ggpo_desync_write_report(
+      const struct netplay_ggpo_desync_dump *dump)
+{
+   char path[PATH_MAX_LENGTH];
+   size_t offset;
+   unsigned changed = 0;
+   RFILE *file;
+   int path_len = snprintf(path, sizeof(path), "%s.txt", dump->path);
+
+   if (path_len < 0 || (size_t)path_len >= sizeof(path))
+   {
+      RARCH_WARN("[GGPO] Desync report path is too long, skipping.\n");
+      return;
+   }
+   if (!(file = filestream_open(path, RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      RARCH_WARN("[GGPO] Could not write desync report \"%s\".\n", path);
+      return;
+   }
+
+   filestream_printf(file, "frame %d\nplayer %d\n"
+         "local checksum %08x\nremote checksum %08x\n",
+         dump->frame, dump->player,
+         (unsigned)dump->local_checksum, (unsigned)dump->remote_checksum);
+   if (dump->base)
+      filestream_printf(file, "base frame %d\n", dump->base_frame);
+   filestream_printf(file, "state size %u\nblock size %u\n\n",
+         (unsigned)dump->state_size, NETPLAY_GGPO_DESYNC_BLOCK_SIZE);
+
+   for (offset = 0; offset < dump->state_size;
+         offset += NETPLAY_GGPO_DESYNC_BLOCK_SIZE)
+   {
+      size_t len = dump->state_size - offset;
+      XXH64_hash_t hash;
+      bool differs = false;
+
+      if (len > NETPLAY_GGPO_DESYNC_BLOCK_SIZE)
+         len = NETPLAY_GGPO_DESYNC_BLOCK_SIZE;
+      hash = XXH3_64bits(dump->state + offset, len);
+
+      if (dump->base)
+         differs = offset + len > dump->base_size
+            || memcmp(dump->state + offset, dump->base + offset, len);
+      if (differs)
+         changed++;
+
+      filestream_printf(file, "%08x %08x%08x%s\n", (unsigned)offset,
+            (unsigned)(hash >> 32), (unsigned)hash, differs ? " *" : "");
+   }
+
+   if (dump->base)
+      filestream_printf(file, "\n%u block(s) changed since the base frame\n",
+            changed);
+
+   filestream_close(file);
+   RARCH_LOG("[GGPO] Desync report written to \"%s\".\n", path);
+}
+
+/* One file per call, so an unthreaded task queue spreads the writes over
+ * frames. */
+static void task_netplay_ggpo_desync_dump_handler(retro_task_t *task)
+{
+   struct netplay_ggpo_desync_dump *dump =
+      (struct netplay_ggpo_desync_dump*)task->task_data;
+
+   if (!(task_get_flags(task) & RETRO_TASK_FLG_CANCELLED))
+   {
+      switch (dump->step++)
+      {
+         case 0:
+            task_netplay_ggpo_desync_write_state(dump, "",
+                  dump->state, dump->state_size);
+            return;
+         case 1:
+            if (dump->base)
+               task_netplay_ggpo_desync_write_state(dump, "_base",
+                     dump->base, dump->base_size);
+            return;
+         case 2:
+            task_netplay_ggpo_desync_write_report(dump);
+            break;
+      }
+   }
+
+   task_set_progress(task, 100);
+   task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
+}
+
+static void task_netplay_ggpo_desync_dump_cleanup(retro_task_t *task)
+{
+   netplay_ggpo_desync_dump_free(
+         (struct netplay_ggpo_desync_dump*)task->task_data);
+   task->task_data = NULL;
+}
+
+bool task_push_netplay_ggpo_desync_dump(void *data)
+{
+   retro_task_t *task = task_init();
+
+   if (!task)
+      return false;
+
+   task->handler   = task_netplay_ggpo_desync_dump_handler;
+   task->cleanup   = task_netplay_ggpo_desync_dump_cleanup;
+   task->task_data = data;
+   task->flags    |= RETRO_TASK_FLG_MUTE;
+
+   task_queue_push(task);
+
+   return true;
+}
+#else
+bool task_push_netplay_ggpo_desync_dump(void *data) { return false; }
+#endif
@@ -0,0 +1,88 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+
+#include <string/stdstring.h>
+
+#include "tasks_internal.h"
+
+#ifdef HAVE_CONFIG_H
+#include "../config.h"
+#endif
+
+#if defined(HAVE_NETWORKING) && defined(HAVE_GGPO)
+
+#include "../network/netplay/netplay.h"
+
+/* One lookup per call, so an unthreaded task queue spreads them over
+ * frames instead of stalling one. */
+static void task_netplay_ggpo_resolve_handler(retro_task_t *task)
+{
+   struct netplay_ggpo_resolve *resolve =
+      (struct netplay_ggpo_resolve*)task->task_data;
+
+   while (resolve->next < NETPLAY_GGPO_RESOLVE_MAX)
+   {
+      unsigned i = resolve->next++;
+      struct addrinfo hints = {0};
+      char port_buf[6];
+
+      if (string_is_empty(resolve->host[i]))
+         continue;
+
+      snprintf(port_buf, sizeof(port_buf), "%hu",
+            (unsigned short)resolve->port[i]);
+      hints.ai_family   = AF_INET;
+      hints.ai_socktype = SOCK_DGRAM;
+      hints.ai_flags   |= AI_NUMERICSERV;
+
+      if (getaddrinfo_retro(resolve->host[i], port_buf, &hints,
+            &resolve->addr[i]))
+         resolve->addr[i] = NULL;
+
+      return;
+   }
+
+   task_set_progress(task, 100);
+   task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
+}
+
+static void task_netplay_ggpo_resolve_callback(retro_task_t *task,
+      void *task_data, void *user_data, const char *error)
+{
+   /* Netplay adopts the result, or it has moved on and this is freed. */
+   if (!netplay_driver_ctl(RARCH_NETPLAY_CTL_FINISHED_GGPO_RESOLVE, task_data))
+      netplay_ggpo_resolve_free((struct netplay_ggpo_resolve*)task_data);
+}
+
+bool task_push_netplay_ggpo_resolve(void *data)
+{
+   retro_task_t *task = task_init();
+
+   if (!task)
+      return false;
+
+   task->handler   = task_netplay_ggpo_resolve_handler;
+   task->callback  = task_netplay_ggpo_resolve_callback;
+   task->task_data = data;
+   task->flags    |= RETRO_TASK_FLG_MUTE;
+
+   task_queue_push(task);
+
+   return true;
+}
+#else
+bool task_push_netplay_ggpo_resolve(void *data) { return false; }
+#endif
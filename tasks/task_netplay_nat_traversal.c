@@ -161,10 +161,39 @@ done:
    return ret;
 }
 
+/* Records a forwarded port. Returns true if there are more to forward. */
+static bool task_netplay_nat_traversal_mapped(struct nat_traversal_data *data,
+      const struct natt_device *device)
+{
+   /* Copy the external address into the request. */
+   memcpy(&data->request.addr.sin_addr,
+      &device->ext_addr.sin_addr,
+      sizeof(data->request.addr.sin_addr));
+
+   if (data->port_index == data->announce_index)
+   {
+      data->announce_addr  = data->request.addr;
+      data->announce_port  =
+         (uint16_t)ntohs(data->request.addr.sin_port);
+      data->announce_ready = true;
+   }
+
+   if (data->port_index + 1 < data->port_count)
+   {
+      data->port_index++;
+      return true;
+   }
+
+   return false;
+}
+
 static void task_netplay_nat_traversal_handler(retro_task_t *task)
 {
    static struct natt_discovery discovery = {-1, -1};
    static struct natt_device    device    = {0};
+   /* The device that last forwarded our ports; tried first next time,
+      skipping the discovery. */
+   static struct natt_device    cached    = {0};
    struct nat_traversal_data   *data      = (struct nat_traversal_data*)task->task_data;
 
    /* Try again on the next call. */
@@ -173,17 +202,125 @@ static void task_netplay_nat_traversal_handler(retro_task_t *task)
 
    switch (data->status)
    {
+      case NAT_TRAVERSAL_STATUS_PMP_DISCOVERY:
+         {
+            struct sockaddr_in gateway;
+
+            /* A known IGD goes straight to its control URL. */
+            if (!cached.pmp && !string_is_empty(cached.control))
+            {
+               device = cached;
+
+               if (find_local_address(&device, &data->request))
+               {
+                  data->internal_addr = data->request.addr;
+                  data->port_index    = 0;
+                  data->status        = NAT_TRAVERSAL_STATUS_EXTERNAL_ADDRESS;
+                  break;
+               }
+
+               memset(&cached, 0, sizeof(cached));
+            }
+
+            if (cached.pmp)
+               gateway = cached.addr;
+            else if (!natt_pmp_gateway(&gateway))
+            {
+               data->status = NAT_TRAVERSAL_STATUS_DISCOVERY;
+               break;
+            }
+
+            if (natt_pmp_init(&device, &gateway))
+            {
+               if (natt_pmp_external_address(&device))
+               {
+                  data->status = NAT_TRAVERSAL_STATUS_PMP_EXTERNAL_ADDRESS;
+                  break;
+               }
+
+               natt_pmp_end(&device);
+            }
+
+            data->status = NAT_TRAVERSAL_STATUS_DISCOVERY;
+         }
+         break;
+
+      case NAT_TRAVERSAL_STATUS_PMP_EXTERNAL_ADDRESS:
+         {
+            if (!natt_pmp_poll(&device, NULL))
+               goto pmp_failed;
+
+            if (device.ext_addr.sin_family != AF_INET)
+               break;
+
+            /* Only used for the announcement; the gateway maps
+               whichever address the requests come from. */
+            find_local_address(&device, &data->request);
+
+            data->internal_addr = data->request.addr;
+            data->port_index    = 0;
+
+            data->status = NAT_TRAVERSAL_STATUS_PMP_OPEN;
+         }
+         break;
+
+      case NAT_TRAVERSAL_STATUS_PMP_OPEN:
+         {
+            data->request.addr = data->internal_addr;
+            data->request.addr.sin_port =
+               htons(data->ports[data->port_index]);
+            data->request.proto = data->protos[data->port_index];
+
+            if (!natt_pmp_open_port(&device, &data->request))
+               goto pmp_failed;
+
+            data->status = NAT_TRAVERSAL_STATUS_PMP_OPENING;
+         }
+         break;
+
+      case NAT_TRAVERSAL_STATUS_PMP_OPENING:
+         {
+            if (!natt_pmp_poll(&device, &data->request))
+               goto pmp_failed;
+
+            if (!data->request.success)
+               break;
+
+            if (task_netplay_nat_traversal_mapped(data, &device))
+            {
+               data->status = NAT_TRAVERSAL_STATUS_PMP_OPEN;
+               break;
+            }
+
+            natt_pmp_end(&device);
+            cached = device;
+
+            data->status = NAT_TRAVERSAL_STATUS_OPENED;
+
+            goto finished;
+         }
+         break;
+
       case NAT_TRAVERSAL_STATUS_DISCOVERY:
          {
             if (!natt_init(&discovery))
                goto finished;
 
-            data->status = NAT_TRAVERSAL_STATUS_SELECT_DEVICE;
+            data->discovering = true;
+            data->status      = NAT_TRAVERSAL_STATUS_SELECT_DEVICE;
          }
          break;
 
       case NAT_TRAVERSAL_STATUS_SELECT_DEVICE:
          {
+            /* The cached device failed us; look for another. */
+            if (!data->discovering)
+            {
+               memset(&cached, 0, sizeof(cached));
+               data->status = NAT_TRAVERSAL_STATUS_DISCOVERY;
+               break;
+            }
+
             if (!natt_device_next(&discovery, &device))
             {
                natt_device_end(&discovery);
@@ -262,27 +399,14 @@ static void task_netplay_nat_traversal_handler(retro_task_t *task)
          {
             if (data->request.success)
             {
-               /* Copy the external address into the request. */
-               memcpy(&data->request.addr.sin_addr,
-                  &device.ext_addr.sin_addr,
-                  sizeof(data->request.addr.sin_addr));
-
-               if (data->port_index == data->announce_index)
+               if (task_netplay_nat_traversal_mapped(data, &device))
                {
-                  data->announce_addr  = data->request.addr;
-                  data->announce_port  =
-                     (uint16_t)ntohs(data->request.addr.sin_port);
-                  data->announce_ready = true;
-               }
-
-               if (data->port_index + 1 < data->port_count)
-               {
-                  data->port_index++;
                   data->status = NAT_TRAVERSAL_STATUS_OPEN;
                   break;
                }
 
                natt_device_end(&discovery);
+               cached = device;
 
                data->status = NAT_TRAVERSAL_STATUS_OPENED;
 
@@ -313,7 +437,18 @@ static void task_netplay_nat_traversal_handler(retro_task_t *task)
             data->request.proto = data->protos[data->close_index];
             data->request.success = false;
 
-            natt_close_port(&device, &data->request, false);
+            if (device.pmp)
+            {
+               if (!data->close_index)
+               {
+                  struct sockaddr_in gateway = device.addr;
+                  natt_pmp_init(&device, &gateway);
+               }
+
+               natt_pmp_close_port(&device, &data->request);
+            }
+            else
+               natt_close_port(&device, &data->request, false);
 
             data->status = NAT_TRAVERSAL_STATUS_CLOSING;
          }
@@ -329,6 +464,9 @@ static void task_netplay_nat_traversal_handler(retro_task_t *task)
                break;
             }
 
+            if (device.pmp)
+               natt_pmp_end(&device);
+
             memset(&data->request, 0, sizeof(data->request));
 
             data->status = NAT_TRAVERSAL_STATUS_CLOSED;
@@ -343,6 +481,14 @@ static void task_netplay_nat_traversal_handler(retro_task_t *task)
 
    return;
 
+pmp_failed:
+   natt_pmp_end(&device);
+   /* Fall back to UPnP. */
+   if (cached.pmp)
+      memset(&cached, 0, sizeof(cached));
+   data->status = NAT_TRAVERSAL_STATUS_DISCOVERY;
+   return;
+
 finished:
    task_set_progress(task, 100);
    task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
@@ -413,9 +559,11 @@ bool task_push_netplay_nat_traversal(void *data, uint16_t port)
    natt_data->request.addr.sin_port   = htons(natt_data->ports[0]);
    natt_data->request.proto           = natt_data->protos[0];
    natt_data->request.device          = NULL;
-   natt_data->status                  = NAT_TRAVERSAL_STATUS_DISCOVERY;
+   natt_data->discovering             = false;
+   natt_data->status                  = NAT_TRAVERSAL_STATUS_PMP_DISCOVERY;
 
    task->handler                        = task_netplay_nat_traversal_handler;
+   task->priority                       = TASK_PRIORITY_LATENCY;
    task->callback                       = task_netplay_nat_traversal_callback;
    task->task_data                      = data;
 
@@ -447,6 +595,7 @@ bool task_push_netplay_nat_close(void *data)
    natt_data->status = NAT_TRAVERSAL_STATUS_CLOSE;
 
    task->handler     = task_netplay_nat_traversal_handler;
+   task->priority    = TASK_PRIORITY_LATENCY;
    task->task_data   = data;
 
    task_queue_push(task);
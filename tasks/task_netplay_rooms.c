@@ -0,0 +1,121 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "tasks_internal.h"
+
+#ifdef HAVE_CONFIG_H
+#include "../config.h"
+#endif
+
+#ifdef HAVE_NETWORKING
+
+#include "../network/netplay/netplay.h"
+
+/* JSON elements per iteration; a room is around sixty. */
+#define NETPLAY_ROOMS_PARSE_EVENTS 1024
+
+struct netplay_rooms_parse_state
+{
+   struct netplay_rooms_parser *parser;
+   char *data;
+};
+
+static void task_netplay_rooms_parse_handler(retro_task_t *task)
+{
+   struct netplay_rooms_parse_state *state =
+      (struct netplay_rooms_parse_state*)task->state;
+   uint8_t flg = task_get_flags(task);
+   int ret;
+
+   if ((flg & RETRO_TASK_FLG_CANCELLED) > 0)
+      ret = -1;
+   else
+      ret = netplay_rooms_parser_step(state->parser,
+            NETPLAY_ROOMS_PARSE_EVENTS);
+
+   if (!ret)
+      return;
+
+   if (ret > 0)
+      task->task_data = netplay_rooms_parser_take(state->parser);
+   else
+      task_set_error(task, strdup("Invalid room list"));
+
+   task_set_progress(task, 100);
+   task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
+}
+
+static void task_netplay_rooms_parse_cleanup(retro_task_t *task)
+{
+   struct netplay_rooms_parse_state *state =
+      (struct netplay_rooms_parse_state*)task->state;
+
+   /* The callback only borrows the rooms. */
+   netplay_rooms_data_free((struct netplay_rooms*)task->task_data);
+   task->task_data = NULL;
+
+   if (state)
+   {
+      netplay_rooms_parser_free(state->parser);
+      free(state->data);
+      free(state);
+   }
+   task->state = NULL;
+}
+
+bool task_push_netplay_rooms_parse(char *data, size_t len,
+      retro_task_callback_t cb)
+{
+   retro_task_t *task;
+   struct netplay_rooms_parse_state *state =
+      (struct netplay_rooms_parse_state*)calloc(1, sizeof(*state));
+
+   if (!state)
+   {
+      free(data);
+      return false;
+   }
+
+   state->data   = data;
+   state->parser = netplay_rooms_parser_new(data, len, true);
+
+   if (!state->parser || !(task = task_init()))
+   {
+      netplay_rooms_parser_free(state->parser);
+      free(data);
+      free(state);
+      return false;
+   }
+
+   task->handler  = task_netplay_rooms_parse_handler;
+   task->callback = cb;
+   task->cleanup  = task_netplay_rooms_parse_cleanup;
+   task->state    = state;
+   task->flags   |= RETRO_TASK_FLG_MUTE;
+
+   task_queue_push(task);
+
+   return true;
+}
+#else
+bool task_push_netplay_rooms_parse(char *data, size_t len,
+      retro_task_callback_t cb)
+{
+   free(data);
+   return false;
+}
+#endif
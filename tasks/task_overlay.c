@@ -23,6 +23,10 @@
 #include <streams/file_stream.h>
 #include <string/stdstring.h>
 #include <lrc_hash.h>
+#include <features/features_cpu.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "tasks_internal.h"
 
@@ -99,6 +103,151 @@ static void task_overlay_load_desc_image(
    input_overlay->pos ++;
 }
 
+#ifdef HAVE_THREADS
+/* Fewest images decoded per worker before another is worth starting */
+#define OVERLAY_DECODE_IMAGES_PER_WORKER 4
+#define OVERLAY_DECODE_MAX_WORKERS       4
+
+typedef struct
+{
+   char *paths;
+   struct texture_image *images;
+   bool *loaded;
+   slock_t *lock;
+   size_t count;
+   size_t next;
+} overlay_decode_pool_t;
+
+/* Decodes images off the pool until none are left; decoding one
+ * touches nothing but its own texture_image */
+static void task_overlay_decode_worker(void *data)
+{
+   overlay_decode_pool_t *pool = (overlay_decode_pool_t*)data;
+
+   for (;;)
+   {
+      size_t i;
+
+      slock_lock(pool->lock);
+      i = pool->next++;
+      slock_unlock(pool->lock);
+
+      if (i >= pool->count)
+         break;
+
+      if (pool->paths[i * PATH_MAX_LENGTH])
+         pool->loaded[i] = image_texture_load(&pool->images[i],
+               &pool->paths[i * PATH_MAX_LENGTH]);
+   }
+}
+#endif
+
+/* Decodes the images of descs [first, first + count) of an overlay,
+ * on a few workers when there are enough of them, then hands them to
+ * the descs in order, as task_overlay_load_desc_image() would have */
+static void task_overlay_load_desc_images(
+      overlay_loader_t *loader,
+      struct overlay *input_overlay,
+      unsigned ol_idx, unsigned first, unsigned count)
+{
+   unsigned i;
+   char *paths                  = (char*)malloc(count * PATH_MAX_LENGTH);
+   struct texture_image *images = (struct texture_image*)
+      calloc(count, sizeof(*images));
+   bool *loaded                 = (bool*)calloc(count, sizeof(*loaded));
+#ifdef HAVE_THREADS
+   overlay_decode_pool_t pool;
+   sthread_t *threads[OVERLAY_DECODE_MAX_WORKERS];
+   unsigned num_threads         = 0;
+   unsigned workers             = cpu_features_get_core_amount();
+#endif
+
+   if (!paths || !images || !loaded)
+   {
+      free(paths);
+      free(images);
+      free(loaded);
+      for (i = 0; i < count; i++)
+         task_overlay_load_desc_image(loader,
+               &input_overlay->descs[first + i], input_overlay,
+               ol_idx, first + i);
+      return;
+   }
+
+   for (i = 0; i < count; i++)
+   {
+      char overlay_desc_image_key[32];
+      char image_path[PATH_MAX_LENGTH];
+
+      paths[i * PATH_MAX_LENGTH] = '\0';
+      images[i].supports_rgba    =
+         (loader->flags & OVERLAY_LOADER_RGBA_SUPPORT) ? true : false;
+
+      snprintf(overlay_desc_image_key, sizeof(overlay_desc_image_key),
+            "overlay%u_desc%u_overlay", ol_idx, first + i);
+
+      if (config_get_path(loader->conf, overlay_desc_image_key,
+               image_path, sizeof(image_path)))
+         fill_pathname_resolve_relative(&paths[i * PATH_MAX_LENGTH],
+               loader->overlay_path, image_path, PATH_MAX_LENGTH);
+   }
+
+#ifdef HAVE_THREADS
+   if (workers > OVERLAY_DECODE_MAX_WORKERS)
+      workers = OVERLAY_DECODE_MAX_WORKERS;
+   if (workers > count / OVERLAY_DECODE_IMAGES_PER_WORKER)
+      workers = count / OVERLAY_DECODE_IMAGES_PER_WORKER;
+
+   if (workers > 1 && (pool.lock = slock_new()))
+   {
+      pool.paths  = paths;
+      pool.images = images;
+      pool.loaded = loaded;
+      pool.count  = count;
+      pool.next   = 0;
+
+      /* This thread is one of the workers */
+      while (num_threads < workers - 1)
+      {
+         if (!(threads[num_threads] = sthread_create(
+                     task_overlay_decode_worker, &pool)))
+            break;
+         num_threads++;
+      }
+
+      task_overlay_decode_worker(&pool);
+
+      for (i = 0; i < num_threads; i++)
+         sthread_join(threads[i]);
+      slock_free(pool.lock);
+   }
+   else
+#endif
+   for (i = 0; i < count; i++)
+      if (paths[i * PATH_MAX_LENGTH])
+         loaded[i] = image_texture_load(&images[i],
+               &paths[i * PATH_MAX_LENGTH]);
+
+   for (i = 0; i < count; i++)
+   {
+      struct overlay_desc *desc = &input_overlay->descs[first + i];
+
+      if (loaded[i])
+      {
+         input_overlay->load_images[input_overlay->load_images_size++] =
+            images[i];
+         desc->image       = images[i];
+         desc->image_index = input_overlay->load_images_size - 1;
+      }
+   }
+
+   input_overlay->pos += count;
+
+   free(paths);
+   free(images);
+   free(loaded);
+}
+
 static void task_overlay_redefine_eightway_direction(
       char *str, input_bits_t *data)
 {
@@ -611,21 +760,18 @@ static void task_overlay_deferred_loading(retro_task_t *task)
          loader->overlays[loader->pos].pos = 0;
          break;
       case OVERLAY_IMAGE_TRANSFER_DESC_IMAGE_ITERATE:
-         for (i = 0; i < overlay->pos_increment; i++)
+         if (overlay->pos < overlay->size)
          {
-            if (overlay->pos < overlay->size)
-            {
-               task_overlay_load_desc_image(loader,
-                     &overlay->descs[overlay->pos], overlay,
-                     loader->pos, (unsigned)overlay->pos);
-            }
-            else
-            {
-               overlay->pos       = 0;
-               loader->loading_status = OVERLAY_IMAGE_TRANSFER_DESC_ITERATE;
-               break;
-            }
-
+            size_t count = overlay->size - overlay->pos;
+            if (count > overlay->pos_increment)
+               count = overlay->pos_increment;
+            task_overlay_load_desc_images(loader, overlay,
+                  loader->pos, (unsigned)overlay->pos, (unsigned)count);
+         }
+         else
+         {
+            overlay->pos       = 0;
+            loader->loading_status = OVERLAY_IMAGE_TRANSFER_DESC_ITERATE;
          }
          break;
       case OVERLAY_IMAGE_TRANSFER_DESC_ITERATE:
@@ -26,10 +26,12 @@
 
 #include <compat/msvc.h>
 #include <file/file_path.h>
+#include <file/file_write_atomic.h>
 #include <streams/file_stream.h>
 #include <string/stdstring.h>
 
 #include <encodings/crc32.h>
+#include <queues/task_queue.h>
 
 #include "../runloop.h"
 #include "../msg_hash.h"
@@ -449,12 +451,13 @@ static enum patch_error ups_apply_patch(
    return PATCH_SOURCE_INVALID;
 }
 
-static enum patch_error ips_alloc_targetdata(
+/* Walks every record of the patch to find the target length,
+ * so that nothing is written before the patch is known to be
+ * valid */
+static enum patch_error ips_get_targetlength(
       const uint8_t *patchdata, uint64_t patchlen,
-      uint64_t sourcelength,
-      uint8_t **targetdata, uint64_t *targetlength)
+      uint64_t sourcelength, uint64_t *targetlength)
 {
-   uint8_t *prov_alloc;
    uint32_t offset = 5;
    *targetlength   = sourcelength;
 
@@ -473,26 +476,13 @@ static enum patch_error ips_alloc_targetdata(
       if (address == 0x454f46) /* EOF */
       {
          if (offset == patchlen)
-         {
-            prov_alloc     = (uint8_t*)malloc((size_t) * targetlength);
-            if (!prov_alloc)
-               return PATCH_TARGET_ALLOC_FAILED;
-            free(*targetdata);
-            *targetdata    = prov_alloc;
             return PATCH_SUCCESS;
-         }
          else if (offset == patchlen - 3)
          {
             uint32_t size  = patchdata[offset++] << 16;
             size          |= patchdata[offset++] << 8;
             size          |= patchdata[offset++] << 0;
             *targetlength  = size;
-            prov_alloc     = (uint8_t*)malloc((size_t) * targetlength);
-
-            if (!prov_alloc)
-               return PATCH_TARGET_ALLOC_FAILED;
-            free(*targetdata);
-            *targetdata    = prov_alloc;
             return PATCH_SUCCESS;
          }
       }
@@ -553,12 +543,22 @@ static enum patch_error ips_apply_patch(
          || patchdata[4] != 'H')
       return PATCH_PATCH_INVALID;
 
-   if ((error_patch = ips_alloc_targetdata(
+   if ((error_patch = ips_get_targetlength(
                patchdata, patchlen, sourcelength,
-               targetdata, targetlength)) != PATCH_SUCCESS)
+               targetlength)) != PATCH_SUCCESS)
       return error_patch;
 
-   memcpy(*targetdata, sourcedata, (size_t)sourcelength);
+   /* A target no bigger than the source is patched in place;
+    * the caller owns the source buffer and takes it back as the
+    * target */
+   if (*targetlength <= sourcelength)
+      *targetdata = (uint8_t*)sourcedata;
+   else
+   {
+      if (!(*targetdata = (uint8_t*)malloc((size_t)*targetlength)))
+         return PATCH_TARGET_ALLOC_FAILED;
+      memcpy(*targetdata, sourcedata, (size_t)sourcelength);
+   }
 
    for (;;)
    {
@@ -592,8 +592,10 @@ static enum patch_error ips_apply_patch(
          if (offset > patchlen - _len)
             break;
 
-         while (_len--)
-            (*targetdata)[address++] = patchdata[offset++];
+         /* Records may reach past a truncated target */
+         for (; _len--; address++, offset++)
+            if (address < *targetlength)
+               (*targetdata)[address] = patchdata[offset];
       }
       else /* RLE */
       {
@@ -606,8 +608,9 @@ static enum patch_error ips_apply_patch(
          if (_len == 0) /* Illegal */
             break;
 
-         while (_len--)
-            (*targetdata)[address++] = patchdata[offset];
+         for (; _len--; address++)
+            if (address < *targetlength)
+               (*targetdata)[address] = patchdata[offset];
 
          offset++;
       }
@@ -729,7 +732,9 @@ static bool apply_patch_content(uint8_t **buf,
    if ((err = func((const uint8_t*)patch_data, patch_size, ret_buf,
          ret_size, &patched_content, &target_size)) == PATCH_SUCCESS)
    {
-      free(ret_buf);
+      /* Patches applied in place hand the same buffer back */
+      if (patched_content != ret_buf)
+         free(ret_buf);
       *buf  = patched_content;
       *size = target_size;
 
@@ -862,12 +867,172 @@ static bool try_xdelta_patch(bool allow_xdelta,
     return false;
 }
 
+/* Patched content is cached in <cache dir>/patched, named after
+ * the CRC32 and size of the unpatched content and a CRC32 over
+ * every patch that applies to it */
+#define PATCH_CACHE_DIR "patched"
+
+struct patch_cache_write
+{
+   char path[PATH_MAX_LENGTH];
+   uint8_t *data;
+   int64_t size;
+};
+
+/* The patch file patch_content() would try at 'patch_index' (0 for the
+ * non-indexed one), or NULL if there is none */
+static const char *patch_cache_find_patch(
+      const char *const *names, const bool *allow,
+      unsigned patch_index, char *s, size_t len)
+{
+   unsigned i;
+
+   for (i = 0; i < 4; i++)
+   {
+      size_t _len;
+
+      if (!allow[i] || string_is_empty(names[i]))
+         continue;
+
+      _len = strlcpy(s, names[i], len);
+      if (patch_index && _len + 1 < len)
+      {
+         s[_len]     = '0' + patch_index;
+         s[_len + 1] = '\0';
+      }
+
+      if (path_is_valid(s))
+         return s;
+   }
+
+   return NULL;
+}
+
+static bool patch_cache_get_path(
+      const char *const *names, const bool *allow,
+      const uint8_t *buf, ssize_t size, char *s, size_t len)
+{
+   char patch_path[PATH_MAX_LENGTH];
+   char cache_dir[PATH_MAX_LENGTH];
+   char cache_name[64];
+   unsigned patch_index;
+   uint32_t patch_crc   = 0;
+   settings_t *settings = config_get_ptr();
+
+   if (     !settings->bools.content_patch_cache_enable
+         || string_is_empty(settings->paths.directory_cache))
+      return false;
+
+   for (patch_index = 0; patch_index < 10; patch_index++)
+   {
+      void *patch_data   = NULL;
+      int64_t patch_size = 0;
+
+      if (     !patch_cache_find_patch(names, allow, patch_index,
+                  patch_path, sizeof(patch_path))
+            || !filestream_read_file(patch_path, &patch_data, &patch_size))
+         break;
+
+      patch_crc = encoding_crc32(patch_crc,
+            (const uint8_t*)patch_data, (size_t)patch_size);
+      free(patch_data);
+   }
+
+   if (!patch_index)
+      return false;
+
+   snprintf(cache_name, sizeof(cache_name), "%08x_%x_%08x.bin",
+         (unsigned)encoding_crc32(0, buf, (size_t)size),
+         (unsigned)size, (unsigned)patch_crc);
+   fill_pathname_join_special(cache_dir,
+         settings->paths.directory_cache, PATCH_CACHE_DIR,
+         sizeof(cache_dir));
+   fill_pathname_join_special(s, cache_dir, cache_name, len);
+   return true;
+}
+
+static void patch_cache_write_handler(retro_task_t *task)
+{
+   struct patch_cache_write *cache_write =
+      (struct patch_cache_write*)task->task_data;
+
+   if (!(task_get_flags(task) & RETRO_TASK_FLG_CANCELLED))
+   {
+      char dir[PATH_MAX_LENGTH];
+      struct file_write_block block;
+
+      block.data = cache_write->data;
+      block.size = cache_write->size;
+      fill_pathname_basedir(dir, cache_write->path, sizeof(dir));
+
+      if (     (path_is_directory(dir) || path_mkdir(dir))
+            && file_write_atomic(cache_write->path, &block, 1))
+         RARCH_LOG("[Patch] Cached patched content in \"%s\".\n",
+               cache_write->path);
+      else
+         RARCH_WARN("[Patch] Could not cache patched content in \"%s\".\n",
+               cache_write->path);
+   }
+
+   task_set_progress(task, 100);
+   task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
+}
+
+static void patch_cache_write_cleanup(retro_task_t *task)
+{
+   struct patch_cache_write *cache_write =
+      (struct patch_cache_write*)task->task_data;
+
+   if (cache_write)
+   {
+      free(cache_write->data);
+      free(cache_write);
+   }
+   task->task_data = NULL;
+}
+
+/* The core may keep and modify the content buffer, so the task
+ * writes a copy of it */
+static void patch_cache_push_write(const char *path,
+      const uint8_t *buf, ssize_t size)
+{
+   retro_task_t *task;
+   struct patch_cache_write *cache_write = (struct patch_cache_write*)
+      calloc(1, sizeof(*cache_write));
+
+   if (!cache_write)
+      return;
+
+   strlcpy(cache_write->path, path, sizeof(cache_write->path));
+   cache_write->size = size;
+
+   if (     !(cache_write->data = (uint8_t*)malloc(size ? (size_t)size : 1))
+         || !(task = task_init()))
+   {
+      free(cache_write->data);
+      free(cache_write);
+      return;
+   }
+
+   memcpy(cache_write->data, buf, (size_t)size);
+
+   task->handler   = patch_cache_write_handler;
+   task->cleanup   = patch_cache_write_cleanup;
+   task->task_data = cache_write;
+   task->flags    |= RETRO_TASK_FLG_MUTE;
+
+   task_queue_push(task);
+}
+
 /**
  * patch_content:
  * @buf          : buffer of the content file.
  * @size         : size   of the content file.
  *
- * Apply patch to the content file in-memory.
+ * Apply patch to the content file in-memory. With the patched
+ * content cache enabled, content patched before with the same
+ * patches is loaded from the cache instead, and newly patched
+ * content is added to it in the background.
  *
  **/
 bool patch_content(
@@ -882,11 +1047,13 @@ bool patch_content(
       uint8_t **buf,
       void *data)
 {
+   char cache_path[PATH_MAX_LENGTH];
    ssize_t *size     = (ssize_t*)data;
    bool allow_ups    = !is_bps_pref && !is_ips_pref && !is_xdelta_pref;
    bool allow_ips    = !is_ups_pref && !is_bps_pref && !is_xdelta_pref;
    bool allow_bps    = !is_ups_pref && !is_ips_pref && !is_xdelta_pref;
    bool allow_xdelta = !is_bps_pref && !is_ups_pref && !is_ips_pref;
+   bool cache        = false;
 
    if (    (unsigned)is_ips_pref
          + (unsigned)is_bps_pref
@@ -898,6 +1065,44 @@ bool patch_content(
       return false;
    }
 
+   {
+      /* Same order as the try_*_patch() calls below */
+      const char *names[4];
+      bool allow[4];
+
+      names[0] = name_ips;
+      names[1] = name_bps;
+      names[2] = name_ups;
+      names[3] = name_xdelta;
+      allow[0] = allow_ips;
+      allow[1] = allow_bps;
+      allow[2] = allow_ups;
+#if defined(HAVE_PATCH) && defined(HAVE_XDELTA)
+      allow[3] = allow_xdelta;
+#else
+      allow[3] = false;
+#endif
+
+      if ((cache = patch_cache_get_path(names, allow, *buf, *size,
+                  cache_path, sizeof(cache_path))))
+      {
+         void *cached_data   = NULL;
+         int64_t cached_size = 0;
+
+         if (     path_is_valid(cache_path)
+               && filestream_read_file(cache_path,
+                  &cached_data, &cached_size))
+         {
+            RARCH_LOG("[Patch] Loaded patched content from cache \"%s\".\n",
+                  cache_path);
+            free(*buf);
+            *buf  = (uint8_t*)cached_data;
+            *size = (ssize_t)cached_size;
+            return true;
+         }
+      }
+   }
+
    /* Attempt to apply first (non-indexed) patch */
    if (     try_ips_patch(allow_ips, name_ips, buf, size)
          || try_bps_patch(allow_bps, name_bps, buf, size)
@@ -964,6 +1169,9 @@ bool patch_content(
       free(name_ups_indexed);
       free(name_xdelta_indexed);
 
+      if (cache)
+         patch_cache_push_write(cache_path, *buf, *size);
+
       return true;
    }
 
@@ -613,6 +613,7 @@ bool task_push_pl_thumbnail_download(
 
    /* Configure task */
    task->handler                 = task_pl_thumbnail_download_handler;
+   task->priority                = TASK_PRIORITY_BACKGROUND;
    task->state                   = pl_thumb;
    task->title                   = strdup(system);
    task->progress                = 0;
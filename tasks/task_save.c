@@ -133,6 +133,44 @@ static struct save_state_buf undo_load_buf;
  * This is useful for devices with slow I/O. */
 static struct ram_save_state_buf ram_buf;
 
+/* A state buffer nobody needs any more, kept for the next serialize so
+ * it need not fault in fresh pages. Only the main thread touches it. */
+static struct save_state_buf spare_state_buf;
+
+/* A zeroed buffer of 'len' bytes, the spare one if it is big enough */
+static void *content_state_buf_get(size_t len)
+{
+   void *data = spare_state_buf.data;
+
+   if (data && spare_state_buf.size >= len)
+   {
+      spare_state_buf.data = NULL;
+      spare_state_buf.size = 0;
+      memset(data, 0, len);
+      return data;
+   }
+
+   return calloc(len, 1);
+}
+
+/* Hands a state buffer back, keeping the bigger of it and the spare */
+static void content_state_buf_put(void *data, size_t len)
+{
+   if (!data)
+      return;
+   if (spare_state_buf.data)
+   {
+      if (spare_state_buf.size >= len)
+      {
+         free(data);
+         return;
+      }
+      free(spare_state_buf.data);
+   }
+   spare_state_buf.data = data;
+   spare_state_buf.size = len;
+}
+
 static bool save_state_in_background       = false;
 
 typedef struct rastate_size_info
@@ -228,10 +266,12 @@ bool content_undo_load_state(void)
       }
    }
 
-   /* We need to make a temporary copy of the buffer, to allow the swap below */
-   temp_data              = malloc(undo_load_buf.size);
+   /* Take the buffer, so the swap below can put the current state in
+   its place */
+   temp_data              = undo_load_buf.data;
    temp_data_size         = undo_load_buf.size;
-   memcpy(temp_data, undo_load_buf.data, undo_load_buf.size);
+   undo_load_buf.data     = NULL;
+   undo_load_buf.size     = 0;
 
    /* Swap the current state with the backup state. This way, we can undo
    what we're undoing */
@@ -239,8 +279,7 @@ bool content_undo_load_state(void)
 
    ret = content_deserialize_state(temp_data, temp_data_size);
 
-   /* Clean up the temporary copy */
-   free(temp_data);
+   content_state_buf_put(temp_data, temp_data_size);
    temp_data              = NULL;
 
     /* Flush back. */
@@ -293,6 +332,7 @@ static void undo_save_state_cb(retro_task_t *task,
       undo_save_buf.data = NULL;
    }
 
+   content_state_buf_put(state->data, state->size);
    free(state);
 }
 
@@ -324,14 +364,11 @@ static void task_save_handler_finished(retro_task_t *task,
 
    task_set_data(task, task_data);
 
-   if (state->data)
-   {
-      if (     (state->flags & SAVE_TASK_FLAG_UNDO_SAVE)
-            && (state->data == undo_save_buf.data))
-         undo_save_buf.data = NULL;
-      free(state->data);
-      state->data = NULL;
-   }
+   /* The callback hands the data back on the main thread */
+   if (     state->data
+         && (state->flags & SAVE_TASK_FLAG_UNDO_SAVE)
+         && (state->data == undo_save_buf.data))
+      undo_save_buf.data = NULL;
 
    free(state);
 }
@@ -469,7 +506,8 @@ bool content_serialize_state_rewind(void* buffer, size_t buffer_size)
    return content_write_serialized_state(buffer, &size, true);
 }
 
-static void *content_get_serialized_data(size_t *serial_size)
+/* 'pooled' may take the spare buffer, which only the main thread may */
+static void *content_get_serialized_data(size_t *serial_size, bool pooled)
 {
    size_t _len;
    void* data;
@@ -482,12 +520,15 @@ static void *content_get_serialized_data(size_t *serial_size)
     *   sizes when core requests a larger buffer
     *   than it needs (and leaves the excess
     *   as uninitialised garbage) */
-   if (!(data = calloc(_len, 1)))
+   if (!(data = pooled ? content_state_buf_get(_len) : calloc(_len, 1)))
       return NULL;
 
    if (!content_write_serialized_state(data, &size, false))
    {
-      free(data);
+      if (pooled)
+         content_state_buf_put(data, _len);
+      else
+         free(data);
       return NULL;
    }
 
@@ -525,7 +566,8 @@ static void task_save_handler(retro_task_t *task)
    if (!state->data)
    {
       size_t _len = 0;
-      state->data = content_get_serialized_data(&_len);
+      /* This may be off the main thread */
+      state->data = content_get_serialized_data(&_len, false);
       state->size = (ssize_t)_len;
    }
 
@@ -635,6 +677,7 @@ static bool task_push_undo_save_state(const char *path, void *data, size_t len)
       task->type            = TASK_TYPE_BLOCKING;
       task->state           = state;
       task->handler         = task_save_handler;
+      task->priority        = TASK_PRIORITY_LATENCY;
       task->callback        = undo_save_state_cb;
       task->title           = strdup(msg_hash_to_str(MSG_UNDOING_SAVE_STATE));
 
@@ -1010,21 +1053,15 @@ static void content_load_state_cb(retro_task_t *task,
     * can restore it */
    if (load_data->flags & SAVE_TASK_FLAG_LOAD_TO_BACKUP_BUFF)
    {
-      /* If we were previously backing up a file, let go of it first */
+      /* If we were previously backing up a file, let go of it first;
+       * the file data is kept as it is */
       if (undo_save_buf.data)
-      {
          free(undo_save_buf.data);
-         undo_save_buf.data = NULL;
-      }
-
-      if (!(undo_save_buf.data = malloc(_len)))
-         goto error;
 
-      memcpy(undo_save_buf.data, buf, _len);
+      undo_save_buf.data = buf;
       undo_save_buf.size = _len;
       strlcpy(undo_save_buf.path, load_data->path, sizeof(undo_save_buf.path));
 
-      free(buf);
       free(load_data);
       return;
    }
@@ -1106,7 +1143,7 @@ static void content_load_state_cb(retro_task_t *task,
    if (!ret)
       goto error;
 
-   free(buf);
+   content_state_buf_put(buf, _len);
    free(load_data);
 
    return;
@@ -1139,6 +1176,7 @@ static void save_state_cb(retro_task_t *task,
    free(path);
 #endif
 
+   content_state_buf_put(state->data, state->size);
    free(state);
 }
 
@@ -1188,6 +1226,7 @@ static void task_push_save_state(const char *path, void *data, size_t len, bool
    task->type                    = TASK_TYPE_BLOCKING;
    task->state                   = state;
    task->handler                 = task_save_handler;
+   task->priority                = TASK_PRIORITY_LATENCY;
    task->callback                = save_state_cb;
    task->title                   = strdup(msg_hash_to_str(MSG_SAVING_STATE));
 
@@ -1199,8 +1238,7 @@ static void task_push_save_state(const char *path, void *data, size_t len, bool
    if (!task_queue_push(task))
    {
       /* Another blocking task is already active. */
-      if (data)
-         free(data);
+      content_state_buf_put(data, len);
       if (task->title)
          task_free_title(task);
       free(task);
@@ -1210,8 +1248,7 @@ static void task_push_save_state(const char *path, void *data, size_t len, bool
    return;
 
 error:
-   if (data)
-      free(data);
+   content_state_buf_put(data, len);
    if (state)
       free(state);
    if (task)
@@ -1298,6 +1335,7 @@ static void task_push_load_and_save_state(const char *path, void *data,
    task->state                   = state;
    task->type                    = TASK_TYPE_BLOCKING;
    task->handler                 = task_load_handler;
+   task->priority                = TASK_PRIORITY_LATENCY;
    task->callback                = content_load_and_save_state_cb;
    task->title                   = strdup(msg_hash_to_str(MSG_LOADING_STATE));
 
@@ -1309,8 +1347,7 @@ static void task_push_load_and_save_state(const char *path, void *data,
    if (!task_queue_push(task))
    {
       /* Another blocking task is already active. */
-      if (data)
-         free(data);
+      content_state_buf_put(data, len);
       if (task->title)
          task_free_title(task);
       free(task);
@@ -1345,7 +1382,7 @@ bool content_auto_save_state(const char *path)
    if (_len == 0)
       return false;
 
-   serial_data = content_get_serialized_data(&_len);
+   serial_data = content_get_serialized_data(&_len, true);
    if (!serial_data)
       return false;
 
@@ -1359,20 +1396,20 @@ bool content_auto_save_state(const char *path)
 
    if (!file)
    {
-      free(serial_data);
+      content_state_buf_put(serial_data, _len);
       return false;
    }
 
    if (_len != (size_t)intfstream_write(file, serial_data, _len))
    {
       intfstream_close(file);
-      free(serial_data);
+      content_state_buf_put(serial_data, _len);
       free(file);
       return false;
    }
 
    intfstream_close(file);
-   free(serial_data);
+   content_state_buf_put(serial_data, _len);
    free(file);
 
 #ifdef HAVE_SCREENSHOTS
@@ -1416,7 +1453,7 @@ bool content_save_state(const char *path, bool save_to_disk)
 
    if (!save_state_in_background)
    {
-      if (!(data = content_get_serialized_data(&_len)))
+      if (!(data = content_get_serialized_data(&_len, true)))
       {
          RARCH_ERR("[State] %s \"%s\".\n",
                msg_hash_to_str(MSG_FAILED_TO_SAVE_STATE_TO),
@@ -1449,7 +1486,7 @@ bool content_save_state(const char *path, bool save_to_disk)
    {
       if (!data)
       {
-         if (!(data = content_get_serialized_data(&_len)))
+         if (!(data = content_get_serialized_data(&_len, true)))
          {
             RARCH_ERR("[State] %s \"%s\".\n",
                   msg_hash_to_str(MSG_FAILED_TO_SAVE_STATE_TO),
@@ -1461,21 +1498,10 @@ bool content_save_state(const char *path, bool save_to_disk)
       /* save_to_disk is false, which means we are saving the state
       in undo_load_buf to allow content_undo_load_state() to restore it */
 
-      /* If we were holding onto an old state already, clean it up first */
-      if (undo_load_buf.data)
-      {
-         free(undo_load_buf.data);
-         undo_load_buf.data = NULL;
-      }
-
-      if (!(undo_load_buf.data = malloc(_len)))
-      {
-         free(data);
-         return false;
-      }
-
-      memcpy(undo_load_buf.data, data, _len);
-      free(data);
+      /* If we were holding onto an old state already, hand it back for
+         the next serialize; the new one is kept as it is */
+      content_state_buf_put(undo_load_buf.data, undo_load_buf.size);
+      undo_load_buf.data = data;
       undo_load_buf.size = _len;
       strlcpy(undo_load_buf.path, path, sizeof(undo_load_buf.path));
    }
@@ -1584,6 +1610,7 @@ bool content_load_state(const char *path,
    task->type                   = TASK_TYPE_BLOCKING;
    task->state                  = state;
    task->handler                = task_load_handler;
+   task->priority               = TASK_PRIORITY_LATENCY;
    task->callback               = content_load_state_cb;
    task->title                  = strdup(msg_hash_to_str(MSG_LOADING_STATE));
 
@@ -1652,6 +1679,10 @@ void content_reset_savestate_backups(void)
    ram_buf.state_buf.path[0] = '\0';
    ram_buf.state_buf.size    = 0;
    ram_buf.to_write_file     = false;
+
+   free(spare_state_buf.data);
+   spare_state_buf.data      = NULL;
+   spare_state_buf.size      = 0;
 }
 
 bool content_undo_load_buf_is_empty(void)
@@ -1741,7 +1772,7 @@ bool content_save_state_to_ram(void)
 
    if (!save_state_in_background)
    {
-      if (!(data = content_get_serialized_data(&_len)))
+      if (!(data = content_get_serialized_data(&_len, true)))
       {
          RARCH_ERR("[State] %s.\n",
                msg_hash_to_str(MSG_FAILED_TO_SAVE_SRAM));
@@ -1756,7 +1787,7 @@ bool content_save_state_to_ram(void)
 
    if (!data)
    {
-      if (!(data = content_get_serialized_data(&_len)))
+      if (!(data = content_get_serialized_data(&_len, true)))
       {
          RARCH_ERR("[State] %s.\n",
                msg_hash_to_str(MSG_FAILED_TO_SAVE_SRAM));
@@ -1764,21 +1795,10 @@ bool content_save_state_to_ram(void)
       }
    }
 
-   /* If we were holding onto an old state already, clean it up first */
-   if (ram_buf.state_buf.data)
-   {
-      free(ram_buf.state_buf.data);
-      ram_buf.state_buf.data = NULL;
-   }
-
-   if (!(ram_buf.state_buf.data = malloc(_len)))
-   {
-      free(data);
-      return false;
-   }
-
-   memcpy(ram_buf.state_buf.data, data, _len);
-   free(data);
+   /* If we were holding onto an old state already, hand it back for the
+    * next serialize; the new one is kept as it is */
+   content_state_buf_put(ram_buf.state_buf.data, ram_buf.state_buf.size);
+   ram_buf.state_buf.data = data;
    ram_buf.state_buf.size = _len;
    ram_buf.to_write_file  = true;
 
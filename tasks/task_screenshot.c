@@ -31,6 +31,10 @@
 #include <string/stdstring.h>
 #include <gfx/video_frame.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #ifdef HAVE_RBMP
 #include <formats/rbmp.h>
 #endif
@@ -75,6 +79,7 @@ struct screenshot_task_state
    uint8_t *out_buffer;
    const void *frame;
    void *userbuf;
+   size_t out_buffer_size;
 
    int pitch;
    unsigned width;
@@ -87,6 +92,63 @@ struct screenshot_task_state
    char shotname[NAME_MAX_LENGTH];
 };
 
+#if defined(HAVE_RPNG)
+/* One conversion buffer is kept between screenshots, so that
+ * taking them in a row doesn't allocate a frame's worth each
+ * time. The task thread hands it back, hence the lock, which
+ * is created on the main thread by the first screenshot. */
+static uint8_t *screenshot_pool_buffer;
+static size_t screenshot_pool_size;
+#ifdef HAVE_THREADS
+static slock_t *screenshot_pool_lock;
+#endif
+
+static uint8_t *screenshot_buffer_acquire(size_t len)
+{
+   uint8_t *buf;
+
+#ifdef HAVE_THREADS
+   if (!screenshot_pool_lock)
+      screenshot_pool_lock = slock_new();
+   slock_lock(screenshot_pool_lock);
+#endif
+   buf                    = screenshot_pool_buffer;
+   if (buf && screenshot_pool_size < len)
+   {
+      free(buf);
+      buf                 = NULL;
+   }
+   screenshot_pool_buffer = NULL;
+   screenshot_pool_size   = 0;
+#ifdef HAVE_THREADS
+   slock_unlock(screenshot_pool_lock);
+#endif
+
+   if (!buf)
+      buf = (uint8_t*)malloc(len);
+   return buf;
+}
+
+static void screenshot_buffer_release(uint8_t *buf, size_t len)
+{
+#ifdef HAVE_THREADS
+   slock_lock(screenshot_pool_lock);
+#endif
+   /* Keep the larger one if two screenshots overlapped */
+   if (screenshot_pool_size < len)
+   {
+      free(screenshot_pool_buffer);
+      screenshot_pool_buffer = buf;
+      screenshot_pool_size   = len;
+      buf                    = NULL;
+   }
+#ifdef HAVE_THREADS
+   slock_unlock(screenshot_pool_lock);
+#endif
+   free(buf);
+}
+#endif
+
 static bool screenshot_dump_direct(screenshot_task_state_t *state)
 {
    struct scaler_ctx *scaler     = (struct scaler_ctx*)&state->scaler;
@@ -96,7 +158,11 @@ static bool screenshot_dump_direct(screenshot_task_state_t *state)
    const uint8_t* input          = (const uint8_t*)state->frame + ((int)state->height - 1) * state->pitch;
 
    if (!input)
+   {
+      screenshot_buffer_release(state->out_buffer,
+            state->out_buffer_size);
       return ret;
+   }
 
    if (state->flags & SS_TASK_FLAG_BGR24)
       scaler->in_fmt             = SCALER_FMT_BGR24;
@@ -123,7 +189,7 @@ static bool screenshot_dump_direct(screenshot_task_state_t *state)
          state->width * 3
          );
 
-   free(state->out_buffer);
+   screenshot_buffer_release(state->out_buffer, state->out_buffer_size);
 #elif defined(HAVE_RBMP)
    {
       enum rbmp_source_type bmp_type = RBMP_SOURCE_TYPE_DONT_CARE;
@@ -402,12 +468,13 @@ static bool screenshot_dump(
    }
 
 #if defined(HAVE_RPNG)
-   if (!(buf = (uint8_t*)malloc(width * height * 3)))
+   state->out_buffer_size = (size_t)width * height * 3;
+   if (!(buf = screenshot_buffer_acquire(state->out_buffer_size)))
    {
       free(state);
       return false;
    }
-   state->out_buffer     = buf;
+   state->out_buffer      = buf;
 #endif
 
    if (use_thread)
@@ -445,8 +512,11 @@ static bool screenshot_dump(
 
       free(task);
 
+#if defined(HAVE_RPNG)
       if (state->out_buffer)
-         free(state->out_buffer);
+         screenshot_buffer_release(state->out_buffer,
+               state->out_buffer_size);
+#endif
 
       free(state);
 
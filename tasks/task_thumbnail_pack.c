@@ -0,0 +1,310 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <string/stdstring.h>
+#include <file/file_path.h>
+#include <formats/image.h>
+
+#include "tasks_internal.h"
+
+#include "../msg_hash.h"
+#include "../playlist.h"
+#include "../verbosity.h"
+#include "../gfx/gfx_thumbnail.h"
+#include "../gfx/gfx_thumbnail_pack.h"
+#include "../gfx/gfx_thumbnail_path.h"
+
+enum thumbnail_pack_status
+{
+   THUMBNAIL_PACK_BEGIN = 0,
+   THUMBNAIL_PACK_ITERATE_ENTRY,
+   THUMBNAIL_PACK_END
+};
+
+typedef struct thumbnail_pack_handle
+{
+   gfx_thumbnail_path_data_t *path_data;
+   gfx_thumbnail_pack_writer_t *writer;
+   playlist_t *playlist;
+   char *playlist_name;
+   size_t list_size;
+   size_t list_index;
+   size_t packed;
+   playlist_config_t playlist_config; /* size_t alignment */
+   enum thumbnail_pack_status status;
+} thumbnail_pack_handle_t;
+
+static void free_thumbnail_pack_handle(thumbnail_pack_handle_t *pack)
+{
+   if (!pack)
+      return;
+
+   gfx_thumbnail_pack_writer_free(pack->writer);
+   free(pack->path_data);
+   free(pack->playlist_name);
+   if (pack->playlist)
+      playlist_free(pack->playlist);
+   free(pack);
+}
+
+/* Adds the thumbnails of the current entry, of every
+ * type the menu would show for it */
+static void thumbnail_pack_add_entry(thumbnail_pack_handle_t *pack)
+{
+   unsigned i;
+   uint32_t key;
+   unsigned types                     = 0;
+   const struct playlist_entry *entry = NULL;
+   gfx_thumbnail_path_data_t *path_data = pack->path_data;
+
+   playlist_get_index(pack->playlist, pack->list_index, &entry);
+
+   if (     !entry
+         || !gfx_thumbnail_set_content_playlist(path_data,
+               pack->playlist, pack->list_index))
+      return;
+
+   key = gfx_thumbnail_pack_entry_key(entry);
+
+   for (i = GFX_THUMBNAIL_RIGHT; i <= GFX_THUMBNAIL_ICON; i++)
+   {
+      unsigned type = gfx_thumbnail_get_type_index(path_data,
+            (enum gfx_thumbnail_id)i);
+      if (type >= 1 && type <= GFX_THUMBNAIL_PACK_TYPES)
+         types |= 1 << type;
+   }
+
+   for (i = 1; i <= GFX_THUMBNAIL_PACK_TYPES; i++)
+   {
+      struct texture_image img;
+
+      if (!(types & (1 << i)))
+         continue;
+
+      /* Have the right thumbnail path probe for this type */
+      path_data->playlist_right_mode = (enum playlist_thumbnail_mode)(i + 1);
+      if (     !gfx_thumbnail_update_path(path_data, GFX_THUMBNAIL_RIGHT)
+            || !path_is_valid(path_data->right_path))
+         continue;
+
+      img.pixels        = NULL;
+      img.width         = 0;
+      img.height        = 0;
+      img.supports_rgba = false;
+
+      if (image_texture_load(&img, path_data->right_path))
+      {
+         if (gfx_thumbnail_pack_writer_add(pack->writer,
+                  pack->list_index, i, key, &img))
+            pack->packed++;
+         image_texture_free(&img);
+      }
+   }
+}
+
+static void task_thumbnail_pack_handler(retro_task_t *task)
+{
+   thumbnail_pack_handle_t *pack = NULL;
+
+   if (!task)
+      goto task_finished;
+
+   if (!(pack = (thumbnail_pack_handle_t*)task->state))
+      goto task_finished;
+
+   if ((task_get_flags(task) & RETRO_TASK_FLG_CANCELLED) > 0)
+      goto task_finished;
+
+   switch (pack->status)
+   {
+      case THUMBNAIL_PACK_BEGIN:
+         {
+            char pack_path[PATH_MAX_LENGTH];
+
+            /* Load playlist */
+            if (!path_is_valid(pack->playlist_config.path))
+               goto task_finished;
+
+            if (!(pack->playlist = playlist_init(&pack->playlist_config)))
+               goto task_finished;
+
+            if ((pack->list_size = playlist_size(pack->playlist)) < 1)
+               goto task_finished;
+
+            /* Thumbnails are found as for the menu's
+             * playlist view */
+            if (!(pack->path_data = gfx_thumbnail_path_init()))
+               goto task_finished;
+
+            if (!gfx_thumbnail_set_system(pack->path_data,
+                     pack->playlist_name, pack->playlist))
+               goto task_finished;
+
+            gfx_thumbnail_pack_get_path(pack->playlist_config.path,
+                  pack_path, sizeof(pack_path));
+
+            if (!(pack->writer = gfx_thumbnail_pack_writer_new(
+                        pack_path, pack->list_size)))
+               goto task_finished;
+
+            /* All good - can start iterating */
+            pack->status = THUMBNAIL_PACK_ITERATE_ENTRY;
+         }
+         break;
+      case THUMBNAIL_PACK_ITERATE_ENTRY:
+         /* Update progress display */
+         task_set_progress(task,
+               (pack->list_index * 100) / pack->list_size);
+
+         thumbnail_pack_add_entry(pack);
+
+         if (++pack->list_index >= pack->list_size)
+            pack->status = THUMBNAIL_PACK_END;
+         break;
+      case THUMBNAIL_PACK_END:
+         {
+            size_t _len;
+            char task_title[128];
+
+            if (!gfx_thumbnail_pack_writer_finish(pack->writer))
+            {
+               RARCH_ERR("[Thumbnails] Failed to write thumbnail pack"
+                     " for \"%s\".\n", pack->playlist_name);
+               goto task_finished;
+            }
+
+            RARCH_LOG("[Thumbnails] Packed %u thumbnails of %u entries"
+                  " for \"%s\".\n", (unsigned)pack->packed,
+                  (unsigned)pack->list_size, pack->playlist_name);
+
+            /* Update progress display */
+            task_free_title(task);
+            _len = strlcpy(task_title,
+                  msg_hash_to_str(MSG_PLAYLIST_MANAGER_THUMBNAIL_PACK_BUILT),
+                  sizeof(task_title));
+            strlcpy(task_title + _len, pack->playlist_name,
+                  sizeof(task_title) - _len);
+
+            task_set_title(task, strdup(task_title));
+         }
+         /* fall-through */
+      default:
+         task_set_progress(task, 100);
+         goto task_finished;
+   }
+
+   return;
+
+task_finished:
+   if (task)
+      task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
+}
+
+static void cb_task_thumbnail_pack(
+      retro_task_t *task, void *task_data,
+      void *user_data, const char *err)
+{
+   /* Have the menu open the new pack */
+   gfx_thumbnail_pack_reset();
+}
+
+static void task_thumbnail_pack_free(retro_task_t *task)
+{
+   if (task)
+      free_thumbnail_pack_handle((thumbnail_pack_handle_t*)task->state);
+}
+
+static bool task_thumbnail_pack_finder(retro_task_t *task, void *user_data)
+{
+   thumbnail_pack_handle_t *pack = NULL;
+
+   if (!task || !user_data)
+      return false;
+
+   if (task->handler != task_thumbnail_pack_handler)
+      return false;
+
+   if (!(pack = (thumbnail_pack_handle_t*)task->state))
+      return false;
+
+   return string_is_equal((const char*)user_data,
+         pack->playlist_config.path);
+}
+
+bool task_push_thumbnail_pack(const playlist_config_t *playlist_config)
+{
+   size_t _len;
+   task_finder_data_t find_data;
+   char task_title[128];
+   char playlist_name[NAME_MAX_LENGTH];
+   retro_task_t *task            = NULL;
+   thumbnail_pack_handle_t *pack = NULL;
+
+   /* Sanity check */
+   if (!playlist_config || string_is_empty(playlist_config->path))
+      return false;
+
+   /* The playlist name doubles as the system name */
+   fill_pathname(playlist_name,
+         path_basename(playlist_config->path), "",
+         sizeof(playlist_name));
+
+   if (string_is_empty(playlist_name))
+      return false;
+
+   /* Only one build per playlist at a time */
+   find_data.func     = task_thumbnail_pack_finder;
+   find_data.userdata = (void*)playlist_config->path;
+
+   if (task_queue_find(&find_data))
+      return false;
+
+   if (!(task = task_init()))
+      return false;
+
+   if (     !(pack = (thumbnail_pack_handle_t*)calloc(1, sizeof(*pack)))
+         || !playlist_config_copy(playlist_config, &pack->playlist_config)
+         || !(pack->playlist_name = strdup(playlist_name)))
+      goto error;
+
+   pack->status   = THUMBNAIL_PACK_BEGIN;
+
+   /* Configure task */
+   _len = strlcpy(task_title,
+         msg_hash_to_str(MSG_PLAYLIST_MANAGER_BUILDING_THUMBNAIL_PACK),
+         sizeof(task_title));
+   strlcpy(task_title + _len, playlist_name, sizeof(task_title) - _len);
+
+   task->handler  = task_thumbnail_pack_handler;
+   task->priority = TASK_PRIORITY_BACKGROUND;
+   task->state    = pack;
+   task->title    = strdup(task_title);
+   task->progress = 0;
+   task->callback = cb_task_thumbnail_pack;
+   task->cleanup  = task_thumbnail_pack_free;
+
+   task->flags   |= (RETRO_TASK_FLG_ALTERNATIVE_LOOK);
+
+   task_queue_push(task);
+
+   return true;
+
+error:
+   free(task);
+   free_thumbnail_pack_handle(pack);
+   return false;
+}
@@ -26,6 +26,7 @@
 #endif
 
 #include <encodings/base64.h>
+#include <features/features_cpu.h>
 #include <formats/rbmp.h>
 #include <formats/rpng.h>
 #include <formats/rjson.h>
@@ -50,6 +51,61 @@
 
 #include "tasks_internal.h"
 
+/* Auto mode looks at an unchanged screen again this often */
+#define AI_SERVICE_POLL_USEC   250000
+/* Answers kept for screens seen before */
+#define AI_SERVICE_CACHE_SIZE  8
+/* The thumbnail a frame is hashed from, and the low bits
+ * of its pixels that are left out */
+#define AI_SERVICE_HASH_WIDTH  64
+#define AI_SERVICE_HASH_HEIGHT 48
+#define AI_SERVICE_HASH_SHIFT  3
+#define AI_SERVICE_HASH_SEED   0xcbf29ce484222325ULL
+#define AI_SERVICE_HASH_PRIME  0x100000001b3ULL
+
+/* An answer, keyed by the frame hash and the request URL */
+typedef struct
+{
+   char *data;
+   size_t len;
+   uint64_t key;
+} ai_service_cached_t;
+
+static ai_service_cached_t ai_service_cache[AI_SERVICE_CACHE_SIZE];
+static size_t ai_service_cache_next   = 0;
+/* Key of the last answer shown */
+static uint64_t ai_service_last_key   = 0;
+
+static ai_service_cached_t *ai_service_cache_find(uint64_t key)
+{
+   size_t i;
+   for (i = 0; i < AI_SERVICE_CACHE_SIZE; i++)
+      if (ai_service_cache[i].data && ai_service_cache[i].key == key)
+         return &ai_service_cache[i];
+   return NULL;
+}
+
+static void ai_service_cache_store(uint64_t key,
+      const http_transfer_data_t *data)
+{
+   ai_service_cached_t *entry = NULL;
+   char *copy                 = NULL;
+
+   if (ai_service_cache_find(key))
+      return;
+   if (!(copy = (char*)malloc(data->len)))
+      return;
+   memcpy(copy, data->data, data->len);
+
+   entry                 = &ai_service_cache[ai_service_cache_next];
+   ai_service_cache_next = (ai_service_cache_next + 1)
+      % AI_SERVICE_CACHE_SIZE;
+   free(entry->data);
+   entry->key            = key;
+   entry->data           = copy;
+   entry->len            = data->len;
+}
+
 static void task_auto_translate_handler(retro_task_t *task)
 {
    int               *mode_ptr = (int*)task->user_data;
@@ -153,6 +209,7 @@ static void handle_translation_cb(
    char *txt_str                     = NULL;
    char *auto_str                    = NULL;
    char *key_str                     = NULL;
+   bool applied                      = false;
    settings_t* settings              = config_get_ptr();
    uint32_t runloop_flags            = runloop_get_flags();
 #ifdef HAVE_ACCESSIBILITY
@@ -499,6 +556,7 @@ static void handle_translation_cb(
       params.buf                  = raw_sound_data;
       params.bufsize              = new_sound_size;
       params.cb                   = NULL;
+      params.handle               = NULL;
       params.basename             = NULL;
 
       audio_driver_mixer_add_stream(&params);
@@ -511,6 +569,8 @@ static void handle_translation_cb(
    }
 #endif
 
+   applied = true;
+
    if (key_str)
    {
       size_t i;
@@ -597,6 +657,15 @@ finish:
    if (error)
       RARCH_ERR("[Translation] %s: %s.\n", msg_hash_to_str(MSG_DOWNLOAD_FAILED), error);
 
+   /* user_data is the request key. Answers that press
+    * buttons aren't replayed */
+   if (applied && user_data)
+   {
+      ai_service_last_key = *(uint64_t*)user_data;
+      if (!key_str)
+         ai_service_cache_store(ai_service_last_key, data);
+   }
+
    if (user_data)
       free(user_data);
 
@@ -775,11 +844,251 @@ static const char *ai_service_get_str(enum translation_lang id)
    return "";
 }
 
+/* Writes the service URL for the current language and mode settings */
+static void ai_service_get_url(settings_t *settings,
+      video_driver_state_t *video_st, char *s, size_t len)
+{
+   char separator                  = '?';
+   unsigned ai_service_source_lang = settings->uints.ai_service_source_lang;
+   unsigned ai_service_target_lang = settings->uints.ai_service_target_lang;
+   unsigned ai_service_mode        = settings->uints.ai_service_mode;
+   size_t _len                     = strlcpy(s,
+         settings->arrays.ai_service_url, len);
+
+   /* if query already exists in url, then use &'s instead */
+   if (strrchr(s, '?'))
+      separator = '&';
+
+   /* source lang */
+   if (ai_service_source_lang != TRANSLATION_LANG_DONT_CARE)
+   {
+      const char *lang_source = ai_service_get_str(
+            (enum translation_lang)ai_service_source_lang);
+
+      if (!string_is_empty(lang_source))
+      {
+         s[  _len]  = separator;
+         s[++_len]  = '\0';
+         _len      += strlcpy(s + _len, "source_lang=", len - _len);
+         _len      += strlcpy(s + _len, lang_source,    len - _len);
+         separator  = '&';
+      }
+   }
+
+   /* target lang */
+   if (ai_service_target_lang != TRANSLATION_LANG_DONT_CARE)
+   {
+      const char *lang_target = ai_service_get_str(
+            (enum translation_lang)ai_service_target_lang);
+
+      if (!string_is_empty(lang_target))
+      {
+         s[  _len]  = separator;
+         s[++_len]  = '\0';
+         _len      += strlcpy(s + _len, "target_lang=", len - _len);
+         _len      += strlcpy(s + _len, lang_target,    len - _len);
+         separator  = '&';
+      }
+   }
+
+   /* mode */
+   /*"image" is included for backwards compatibility with
+    * vgtranslate < 1.04 */
+   s[  _len]  = separator;
+   s[++_len]  = '\0';
+   _len      += strlcpy(s + _len, "output=", len - _len);
+
+   switch (ai_service_mode)
+   {
+      case 2:
+         strlcpy(s + _len, "text", len - _len);
+         break;
+      case 1:
+      case 3:
+         _len += strlcpy(s + _len, "sound,wav", len - _len);
+         if (ai_service_mode == 1)
+            break;
+         /* fall-through intentional for ai_service_mode == 3 */
+      case 0:
+         _len += strlcpy(s + _len, "image,png", len - _len);
+#ifdef HAVE_GFX_WIDGETS
+         if (     video_st->poke
+               && video_st->poke->load_texture
+               && video_st->poke->unload_texture)
+            strlcpy(s + _len, ",png-a", len - _len);
+#endif
+         break;
+      default:
+         break;
+   }
+}
+
+/* Hashes a grayscale thumbnail of a top-down BGR24 frame,
+ * so that the same screen hashes the same through scaling
+ * noise and dithering, while a line of new text doesn't */
+static uint64_t ai_service_frame_hash(const uint8_t *bgr,
+      unsigned width, unsigned height)
+{
+   unsigned x, y;
+   uint64_t hash = AI_SERVICE_HASH_SEED;
+
+   hash = (hash ^ width)  * AI_SERVICE_HASH_PRIME;
+   hash = (hash ^ height) * AI_SERVICE_HASH_PRIME;
+
+   for (y = 0; y < AI_SERVICE_HASH_HEIGHT; y++)
+   {
+      unsigned y0 = y       * height / AI_SERVICE_HASH_HEIGHT;
+      unsigned y1 = (y + 1) * height / AI_SERVICE_HASH_HEIGHT;
+      if (y1 == y0)
+         y1 = y0 + 1;
+
+      for (x = 0; x < AI_SERVICE_HASH_WIDTH; x++)
+      {
+         unsigned i, j;
+         uint32_t sum = 0;
+         unsigned x0  = x       * width / AI_SERVICE_HASH_WIDTH;
+         unsigned x1  = (x + 1) * width / AI_SERVICE_HASH_WIDTH;
+         if (x1 == x0)
+            x1 = x0 + 1;
+
+         for (j = y0; j < y1; j++)
+         {
+            const uint8_t *p = bgr + ((size_t)j * width + x0) * 3;
+            for (i = x0; i < x1; i++, p += 3)
+               sum += (p[0] * 29 + p[1] * 150 + p[2] * 77) >> 8;
+         }
+
+         sum  /= (x1 - x0) * (y1 - y0);
+         hash  = (hash ^ (sum >> AI_SERVICE_HASH_SHIFT))
+            * AI_SERVICE_HASH_PRIME;
+      }
+   }
+
+   return hash;
+}
+
+static uint64_t ai_service_request_key(uint64_t frame_hash,
+      const char *url)
+{
+   unsigned char c;
+   uint64_t hash = frame_hash;
+   while ((c = (unsigned char)*(url++)) != '\0')
+      hash = (hash ^ c) * AI_SERVICE_HASH_PRIME;
+   return hash;
+}
+
+static void task_ai_service_replay_handler(retro_task_t *task)
+{
+   task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
+}
+
+static void task_ai_service_replay_cleanup(retro_task_t *task)
+{
+   http_transfer_data_t *data = (http_transfer_data_t*)task->task_data;
+   if (data)
+   {
+      free(data->data);
+      free(data);
+   }
+   task->task_data = NULL;
+}
+
+/* Hands a cached response to handle_translation_cb from the task
+ * queue, as the service's own answer would come. Takes @key */
+static bool ai_service_replay(const ai_service_cached_t *entry,
+      uint64_t *key)
+{
+   retro_task_t *task         = NULL;
+   http_transfer_data_t *data = (http_transfer_data_t*)
+      calloc(1, sizeof(*data));
+
+   if (!data || !(data->data = (char*)malloc(entry->len)))
+      goto error;
+   if (!(task = task_init()))
+      goto error;
+
+   memcpy(data->data, entry->data, entry->len);
+   data->len       = entry->len;
+   data->status    = 200;
+
+   task->handler   = task_ai_service_replay_handler;
+   task->cleanup   = task_ai_service_replay_cleanup;
+   task->callback  = handle_translation_cb;
+   task->task_data = data;
+   task->user_data = key;
+   task->flags    |= RETRO_TASK_FLG_MUTE;
+
+   task_queue_push(task);
+   return true;
+
+error:
+   if (data)
+      free(data->data);
+   free(data);
+   free(key);
+   return false;
+}
+
+static void task_ai_service_wait_handler(retro_task_t *task)
+{
+   retro_time_t *until = (retro_time_t*)task->user_data;
+
+   if (     (task_get_flags(task) & RETRO_TASK_FLG_CANCELLED)
+         || cpu_features_get_time_usec() >= *until)
+      task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
+}
+
+static void task_ai_service_wait_cleanup(retro_task_t *task)
+{
+   free(task->user_data);
+   task->user_data = NULL;
+}
+
+static void ai_service_wait_cb(retro_task_t *task, void *task_data,
+      void *user_data, const char *error)
+{
+   access_state_t *access_st = access_state_get_ptr();
+
+   /* Auto mode may have been turned off meanwhile */
+   if (     access_st->ai_service_auto == 2
+         && !(task_get_flags(task) & RETRO_TASK_FLG_CANCELLED))
+   {
+      bool was_paused = (runloop_get_flags() & RUNLOOP_FLAG_PAUSED)
+         ? true : false;
+      command_event(CMD_EVENT_AI_SERVICE_CALL, &was_paused);
+   }
+}
+
+/* Looks at the screen again in a while, for auto mode on a
+ * screen that hasn't changed since the last answer */
+static bool ai_service_wait(void)
+{
+   retro_time_t *until = (retro_time_t*)malloc(sizeof(*until));
+   retro_task_t *task  = NULL;
+
+   if (!until || !(task = task_init()))
+   {
+      free(until);
+      return false;
+   }
+
+   *until          = cpu_features_get_time_usec() + AI_SERVICE_POLL_USEC;
+   task->handler   = task_ai_service_wait_handler;
+   task->cleanup   = task_ai_service_wait_cleanup;
+   task->callback  = ai_service_wait_cb;
+   task->user_data = until;
+   task->flags    |= RETRO_TASK_FLG_MUTE;
+
+   task_queue_push(task);
+   return true;
+}
+
 bool run_translation_service(settings_t *settings, bool paused)
 {
    struct video_viewport vp;
    size_t pitch;
    unsigned width, height;
+   char new_ai_service_url[PATH_MAX_LENGTH];
    const void *data                  = NULL;
    uint8_t *bit24_image              = NULL;
    uint8_t *bit24_image_prev         = NULL;
@@ -795,6 +1104,8 @@ bool run_translation_service(settings_t *settings, bool paused)
    int bmp64_len                     = 0;
    bool TRANSLATE_USE_BMP            = false;
    char *sys_lbl                     = NULL;
+   uint64_t *key                     = NULL;
+   ai_service_cached_t *cached       = NULL;
    core_info_t *core_info            = NULL;
    video_driver_state_t *video_st    = video_state_get_ptr();
    access_state_t *access_st         = access_state_get_ptr();
@@ -936,6 +1247,31 @@ bool run_translation_service(settings_t *settings, bool paused)
       goto finish;
    }
 
+   /* Auto mode has nothing new to ask about a screen that
+    * hasn't changed, and screens seen before get the answer
+    * they got then */
+   ai_service_get_url(settings, video_st,
+         new_ai_service_url, sizeof(new_ai_service_url));
+   if (!(key = (uint64_t*)malloc(sizeof(*key))))
+      goto finish;
+   *key = ai_service_request_key(
+         ai_service_frame_hash(bit24_image, width, height),
+         new_ai_service_url);
+
+   if (     access_st->ai_service_auto == 2
+         && *key == ai_service_last_key)
+   {
+      error = !ai_service_wait();
+      goto finish;
+   }
+
+   if ((cached = ai_service_cache_find(*key)))
+   {
+      error = !ai_service_replay(cached, key);
+      key   = NULL;
+      goto finish;
+   }
+
    if (TRANSLATE_USE_BMP)
    {
       /*
@@ -1025,113 +1361,15 @@ bool run_translation_service(settings_t *settings, bool paused)
    {
 #ifdef DEBUG
       if (access_st->ai_service_auto != 2)
-         RARCH_LOG("[Translation] Request size: %d\n", bmp64_len);
-#endif
       {
-         char new_ai_service_url[PATH_MAX_LENGTH];
-         char separator                  = '?';
-         unsigned ai_service_source_lang = settings->uints.ai_service_source_lang;
-         unsigned ai_service_target_lang = settings->uints.ai_service_target_lang;
-         const char *ai_service_url      = settings->arrays.ai_service_url;
-         size_t _len                     = strlcpy(new_ai_service_url,
-               ai_service_url, sizeof(new_ai_service_url));
-
-         /* if query already exists in url, then use &'s instead */
-         if (strrchr(new_ai_service_url, '?'))
-            separator = '&';
-
-         /* source lang */
-         if (ai_service_source_lang != TRANSLATION_LANG_DONT_CARE)
-         {
-            const char *lang_source = ai_service_get_str(
-                  (enum translation_lang)ai_service_source_lang);
-
-            if (!string_is_empty(lang_source))
-            {
-               new_ai_service_url[  _len] = separator;
-               new_ai_service_url[++_len] = '\0';
-               _len += strlcpy(new_ai_service_url + _len,
-                     "source_lang=",
-                     sizeof(new_ai_service_url)   - _len);
-               _len += strlcpy(new_ai_service_url + _len,
-                     lang_source,
-                     sizeof(new_ai_service_url)   - _len);
-               separator                  = '&';
-            }
-         }
-
-         /* target lang */
-         if (ai_service_target_lang != TRANSLATION_LANG_DONT_CARE)
-         {
-            const char *lang_target = ai_service_get_str(
-                  (enum translation_lang)ai_service_target_lang);
-
-            if (!string_is_empty(lang_target))
-            {
-               new_ai_service_url[  _len] = separator;
-               new_ai_service_url[++_len] = '\0';
-               _len += strlcpy(new_ai_service_url + _len,
-                     "target_lang=",
-                     sizeof(new_ai_service_url)   - _len);
-               _len += strlcpy(new_ai_service_url + _len,
-                     lang_target,
-                     sizeof(new_ai_service_url)   - _len);
-               separator                  = '&';
-            }
-         }
-
-         /* mode */
-         {
-            unsigned ai_service_mode   = settings->uints.ai_service_mode;
-            /*"image" is included for backwards compatibility with
-             * vgtranslate < 1.04 */
-
-            new_ai_service_url[  _len] = separator;
-            new_ai_service_url[++_len] = '\0';
-            _len += strlcpy(new_ai_service_url          + _len,
-                  "output=",
-                  sizeof(new_ai_service_url)            - _len);
-
-            switch (ai_service_mode)
-            {
-               case 2:
-                  strlcpy(new_ai_service_url       + _len,
-                        "text",
-                        sizeof(new_ai_service_url) - _len);
-                  break;
-               case 1:
-               case 3:
-                  _len += strlcpy(new_ai_service_url    + _len,
-                        "sound,wav",
-                        sizeof(new_ai_service_url)      - _len);
-                  if (ai_service_mode == 1)
-                     break;
-                  /* fall-through intentional for ai_service_mode == 3 */
-               case 0:
-                  _len += strlcpy(new_ai_service_url    + _len,
-                        "image,png",
-                        sizeof(new_ai_service_url)      - _len);
-#ifdef HAVE_GFX_WIDGETS
-                  if (     video_st->poke
-                        && video_st->poke->load_texture
-                        && video_st->poke->unload_texture)
-                     strlcpy(new_ai_service_url       + _len,
-                           ",png-a",
-                           sizeof(new_ai_service_url) - _len);
-#endif
-                  break;
-               default:
-                  break;
-            }
-
-         }
-#ifdef DEBUG
-         if (access_st->ai_service_auto != 2)
-            RARCH_LOG("[Translation] SENDING... %s\n", new_ai_service_url);
-#endif
-         task_push_http_post_transfer(new_ai_service_url,
-               json_buffer, true, NULL, handle_translation_cb, NULL);
+         RARCH_LOG("[Translation] Request size: %d\n", bmp64_len);
+         RARCH_LOG("[Translation] SENDING... %s\n", new_ai_service_url);
       }
+#endif
+      /* The callback frees the key */
+      if (task_push_http_post_transfer(new_ai_service_url,
+            json_buffer, true, NULL, handle_translation_cb, key))
+         key = NULL;
 
       error = false;
    }
@@ -1153,6 +1391,8 @@ finish:
    if (sys_lbl)
       free(sys_lbl);
    sys_lbl = NULL;
+   if (key)
+      free(key);
    if (jsonwriter)
       rjsonwriter_free(jsonwriter);
    return !error;
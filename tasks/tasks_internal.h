@@ -107,6 +107,14 @@ bool task_push_netplay_content_reload(const char *hostname);
 bool task_push_netplay_nat_traversal(void *data, uint16_t port);
 bool task_push_netplay_nat_close(void *data);
 
+bool task_push_netplay_ggpo_resolve(void *data);
+bool task_push_netplay_ggpo_desync_dump(void *data);
+
+/* Takes ownership of data; the callback's task_data is the parsed
+ * struct netplay_rooms, freed once it returns. */
+bool task_push_netplay_rooms_parse(char *data, size_t len,
+      retro_task_callback_t cb);
+
 /* Core updater tasks */
 
 void *task_push_get_core_updater_list(
@@ -174,6 +182,21 @@ bool task_push_core_restore(const char *backup_path,
 bool task_push_pl_manager_reset_cores(const playlist_config_t *playlist_config);
 bool task_push_pl_manager_clean_playlist(const playlist_config_t *playlist_config);
 
+#ifdef HAVE_MENU
+/* Builds the thumbnail pack of a playlist
+ * (see gfx/gfx_thumbnail_pack.h) */
+bool task_push_thumbnail_pack(const playlist_config_t *playlist_config);
+#endif
+
+/* Reads a core and its content ahead of a likely load,
+ * superseding the last preload */
+bool task_push_content_preload(const char *core_path,
+      const char *content_path);
+
+/* Reads the start of a disc image (and a cue sheet's tracks)
+ * ahead of a likely swap, superseding the last disc preload */
+bool task_push_disc_preload(const char *image_path);
+
 bool task_push_image_load(const char *fullpath,
       bool supports_rgba, unsigned upscale_threshold,
       retro_task_callback_t cb, void *userdata);
@@ -226,6 +249,22 @@ void *task_push_decompress(
 
 void task_file_load_handler(retro_task_t *task);
 
+#ifdef HAVE_CHD
+/**
+ * task_push_chd_verify:
+ * @path                 : CHD file to verify
+ *
+ * Decodes every hunk of @path, on worker threads where available,
+ * and checks the data against the SHA1 stored in its header.
+ * The task's error is set if the file does not verify.
+ *
+ * Returns: false if the file cannot be opened, carries no SHA1,
+ * or is already being verified.
+ **/
+bool task_push_chd_verify(const char *path,
+      retro_task_callback_t cb, void *user_data);
+#endif
+
 bool take_screenshot(
       const char *screenshot_dir,
       const char *path, bool silence,